@@ -0,0 +1,43 @@
+#  Copyright (c) 2019, Facebook, Inc.
+#  All rights reserved.
+#
+#  This source code is licensed under the BSD-style license found in the
+#  LICENSE file in the root directory of this source tree.
+#
+# - Find brotli
+# Find the brotli encoder library and includes
+#
+# BROTLI_INCLUDE_DIR - where to find brotli/encode.h, etc.
+# BROTLI_LIBRARIES - List of libraries when using brotli.
+# BROTLI_FOUND - True if brotli found.
+
+find_path(BROTLI_INCLUDE_DIR
+  NAMES brotli/encode.h
+  HINTS ${BROTLI_ROOT_DIR}/include)
+
+find_library(BROTLI_LIBRARIES
+  NAMES brotlienc
+  HINTS ${BROTLI_ROOT_DIR}/lib)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Brotli DEFAULT_MSG
+  BROTLI_LIBRARIES BROTLI_INCLUDE_DIR)
+
+mark_as_advanced(
+  BROTLI_LIBRARIES
+  BROTLI_INCLUDE_DIR
+)
+
+if(BROTLI_FOUND AND NOT TARGET brotli::brotlienc)
+    if("${BROTLI_LIBRARIES}" MATCHES ".*.a$")
+        add_library(brotli::brotlienc STATIC IMPORTED)
+    else()
+        add_library(brotli::brotlienc SHARED IMPORTED)
+    endif()
+    set_target_properties(
+        brotli::brotlienc
+        PROPERTIES
+            IMPORTED_LOCATION ${BROTLI_LIBRARIES}
+            INTERFACE_INCLUDE_DIRECTORIES ${BROTLI_INCLUDE_DIR}
+    )
+endif()
@@ -46,7 +46,6 @@ sudo apt-get install -yq \
     pkg-config \
     libssl-dev \
     libcap-dev \
-    gperf \
     autoconf-archive \
     libevent-dev \
     libtool \
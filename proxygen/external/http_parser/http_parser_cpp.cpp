@@ -28,6 +28,14 @@
 #include <limits.h>
 #include <stdlib.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #if __cplusplus
 #include <limits>
 
@@ -426,6 +434,110 @@ enum http_host_state
 #define IS_HEADER_CHAR(ch)                                                     \
   (ch == CR || ch == LF || ch == 9 || ((unsigned char)ch > 31 && ch != 127))
 
+/**
+ * Bytes that end the fast-forward scan over a general header value: CR, LF,
+ * QT and BS need state machine attention and anything that fails
+ * IS_HEADER_CHAR is an error.  This is every byte <= 31 except HT, plus DEL.
+ **/
+#define IS_HEADER_VALUE_STOP(ch)                                               \
+  ((ch) == QT || (ch) == BS || !IS_HEADER_CHAR(ch) || (ch) == CR || (ch) == LF)
+
+#if defined(__GNUC__)
+# define HTTP_PARSER_CTZ(x) __builtin_ctz(x)
+#endif
+
+/* Return the first byte in [p, end) for which IS_HEADER_VALUE_STOP is true,
+ * or end if there is none.  Whole blocks are classified with SIMD compares
+ * where available; the tail is finished with the scalar test.
+ */
+static inline const char *
+find_header_value_stop(const char *p, const char *end)
+{
+#if defined(HTTP_PARSER_CTZ) && defined(__AVX2__)
+  const __m256i ctl = _mm256_set1_epi8(31);
+  const __m256i ht = _mm256_set1_epi8(9);
+  const __m256i del = _mm256_set1_epi8(127);
+  const __m256i qt = _mm256_set1_epi8(QT);
+  const __m256i bs = _mm256_set1_epi8(BS);
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) p);
+    /* v <= 31 as unsigned, minus HT */
+    __m256i stop = _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctl), ctl);
+    stop = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, ht), stop);
+    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, del));
+    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, qt));
+    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, bs));
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8(stop);
+    if (mask) {
+      return p + HTTP_PARSER_CTZ(mask);
+    }
+  }
+#elif defined(HTTP_PARSER_CTZ) && defined(__SSE2__)
+  const __m128i ctl = _mm_set1_epi8(31);
+  const __m128i ht = _mm_set1_epi8(9);
+  const __m128i del = _mm_set1_epi8(127);
+  const __m128i qt = _mm_set1_epi8(QT);
+  const __m128i bs = _mm_set1_epi8(BS);
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    /* v <= 31 as unsigned, minus HT */
+    __m128i stop = _mm_cmpeq_epi8(_mm_max_epu8(v, ctl), ctl);
+    stop = _mm_andnot_si128(_mm_cmpeq_epi8(v, ht), stop);
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, del));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, qt));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, bs));
+    unsigned int mask = (unsigned int) _mm_movemask_epi8(stop);
+    if (mask) {
+      return p + HTTP_PARSER_CTZ(mask);
+    }
+  }
+#elif defined(HTTP_PARSER_CTZ) && defined(__aarch64__) && \
+  (defined(__ARM_NEON) || defined(__ARM_NEON__))
+  const uint8x16_t ctl = vdupq_n_u8(32);
+  const uint8x16_t ht = vdupq_n_u8(9);
+  const uint8x16_t del = vdupq_n_u8(127);
+  const uint8x16_t qt = vdupq_n_u8(QT);
+  const uint8x16_t bs = vdupq_n_u8(BS);
+  for (; end - p >= 16; p += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *) p);
+    uint8x16_t stop = vbicq_u8(vcltq_u8(v, ctl), vceqq_u8(v, ht));
+    stop = vorrq_u8(stop, vceqq_u8(v, del));
+    stop = vorrq_u8(stop, vceqq_u8(v, qt));
+    stop = vorrq_u8(stop, vceqq_u8(v, bs));
+    if (vmaxvq_u8(stop)) {
+      break;
+    }
+  }
+#endif
+  for (; p != end; ++p) {
+    if (IS_HEADER_VALUE_STOP(*p)) {
+      break;
+    }
+  }
+  return p;
+}
+
+/* Return the first byte in [p, end) that is not a token character, or end.
+ * Header names are short and the token set does not map onto a few SIMD
+ * compares, so this is a tight table walk that stays off the state machine.
+ */
+static inline const char *
+find_non_token(const char *p, const char *end)
+{
+  for (; end - p >= 4; p += 4) {
+    if (!TOKEN(p[0])) return p;
+    if (!TOKEN(p[1])) return p + 1;
+    if (!TOKEN(p[2])) return p + 2;
+    if (!TOKEN(p[3])) return p + 3;
+  }
+  for (; p != end; ++p) {
+    if (!TOKEN(*p)) {
+      break;
+    }
+  }
+  return p;
+}
+
 #define start_state (parser->type == HTTP_REQUEST ? s_pre_start_req : s_pre_start_res)
 
 #define STRICT_CHECK(cond)
@@ -1504,27 +1616,15 @@ size_t http_parser_execute (http_parser *parser,
             case h_general:
 
               // fast-forwarding, wheeeeeee!
-              #define MOVE_THE_HEAD do { \
-                ++p;                     \
-                if (!TOKEN(*p)) {        \
-                  ch = *p;               \
-                  goto notatoken;        \
-                }                        \
-              } while(0);
-
-              if (data + len - p >= 9) {
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-              } else if (data + len - p >= 4) {
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
-                MOVE_THE_HEAD
+              {
+                const char *stop = find_non_token(p + 1, data + len);
+                if (stop != data + len) {
+                  p = stop;
+                  ch = *p;
+                  goto notatoken;
+                }
+                /* out of data; the trailing mark callback covers the span */
+                p = stop - 1;
               }
 
               break;
@@ -1703,32 +1803,15 @@ size_t http_parser_execute (http_parser *parser,
             }
 
             // fast-forwarding, wheee!
-            #define MOVE_FAST do {                    \
-              ++p;                                    \
-              ch = *p;                                \
-              if (ch == CR || ch == LF || ch == QT || \
-                  ch == BS || !IS_HEADER_CHAR(ch)) {  \
-                goto cr_or_lf_or_qt;                  \
-              }                                       \
-            } while(0);
-
-            if (data + len - p >= 12) {
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-            } else if (data + len - p >= 5) {
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
-              MOVE_FAST
+            {
+              const char *stop = find_header_value_stop(p + 1, data + len);
+              if (stop != data + len) {
+                p = stop;
+                ch = *p;
+                goto cr_or_lf_or_qt;
+              }
+              /* out of data; the trailing mark callback covers the span */
+              p = stop - 1;
             }
 
             break;
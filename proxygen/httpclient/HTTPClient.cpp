@@ -0,0 +1,489 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpclient/HTTPClient.h>
+
+#include <folly/Conv.h>
+#include <folly/ScopeGuard.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/utils/URL.h>
+#include <proxygen/lib/utils/WheelTimerInstance.h>
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <netdb.h>
+#include <unordered_map>
+
+namespace proxygen {
+
+namespace {
+
+std::shared_ptr<folly::SSLContext> makeDefaultSSLContext() {
+  auto ctx = std::make_shared<folly::SSLContext>();
+  ctx->setAdvertisedNextProtocols({http2::kProtocolString, "http/1.1"});
+  return ctx;
+}
+
+// Blocks the EventBase of the host until getaddrinfo() returns
+std::vector<folly::SocketAddress> resolve(std::string name, uint16_t port) {
+  if (name.size() > 2 && name.front() == '[' && name.back() == ']') {
+    name = name.substr(1, name.size() - 2);
+  }
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_ADDRCONFIG;
+  struct addrinfo* results = nullptr;
+  int rc = getaddrinfo(name.c_str(), folly::to<std::string>(port).c_str(),
+                       &hints, &results);
+  if (rc != 0) {
+    throw std::runtime_error(
+      folly::to<std::string>("Can't resolve ", name, ": ", gai_strerror(rc)));
+  }
+  SCOPE_EXIT {
+    freeaddrinfo(results);
+  };
+  std::vector<folly::SocketAddress> addresses;
+  for (auto ai = results; ai; ai = ai->ai_next) {
+    folly::SocketAddress address;
+    address.setFromSockaddr(ai->ai_addr, ai->ai_addrlen);
+    addresses.push_back(address);
+  }
+  return addresses;
+}
+
+}
+
+struct HTTPClient::Worker {
+  folly::EventBase* evb{nullptr};
+  folly::UMPSCQueue<std::unique_ptr<PendingRequest>, false> queue;
+  // Set while a drain() is queued to evb
+  std::atomic<bool> drainScheduled{false};
+  // Only used from evb
+  std::unordered_map<std::string, std::shared_ptr<Host>> hosts;
+};
+
+/**
+ * The sessions of a host on one EventBase, and the requests waiting for
+ * one.  Kept alive by the transactions of its sessions too, so that they
+ * can tell it they are done.
+ */
+class HTTPClient::Host : public std::enable_shared_from_this<Host>,
+                         private folly::EventBase::LoopCallback {
+ public:
+  Host(const Options& options,
+       std::shared_ptr<folly::SSLContext> sslContext,
+       folly::EventBase* evb,
+       const PendingRequest& request)
+      : options_(options),
+        sslContext_(std::move(sslContext)),
+        evb_(evb),
+        timeout_(options.connectTimeout, evb),
+        name_(request.hostName),
+        port_(request.port),
+        secure_(request.secure),
+        pool_(std::make_unique<SessionPool>(nullptr,
+                                            options.maxSessionsPerHost,
+                                            options.idleTimeout)) {
+  }
+
+  ~Host() override {
+    close();
+  }
+
+  void add(std::unique_ptr<PendingRequest> request);
+
+  // A transaction of the host's sessions detached
+  void onTransactionDone() {
+    // Once the session is back in the pool
+    if (!closed_ && !isLoopCallbackScheduled()) {
+      evb_->runInLoop(this);
+    }
+  }
+
+  // Fails the waiting requests and closes the sessions
+  void close();
+
+ private:
+  class Connect : public HTTPConnector::Callback {
+   public:
+    Connect(Host& host, const WheelTimerInstance& timeout)
+        : host_(host), connector_(this, timeout) {
+    }
+
+    void connectSuccess(HTTPUpstreamSession* session) override {
+      host_.onConnectDone(this, session, nullptr);
+    }
+
+    void connectError(const folly::AsyncSocketException& ex) override {
+      host_.onConnectDone(this, nullptr, &ex);
+    }
+
+    Host& host_;
+    HTTPConnector connector_;
+    std::list<Connect>::iterator it_;
+  };
+
+  void runLoopCallback() noexcept override {
+    dispatch();
+  }
+
+  // Sends the waiting requests the sessions can take
+  void dispatch();
+
+  // False, leaving request as is, if no session can take it
+  bool send(std::unique_ptr<PendingRequest>& request);
+
+  // Opens the sessions the waiting requests need
+  void maybeConnect();
+  // False if the host can't be resolved
+  bool startConnect();
+  void onConnectDone(Connect* connect,
+                     HTTPUpstreamSession* session,
+                     const folly::AsyncSocketException* ex);
+
+  void failWaiting(const std::string& error);
+
+  const Options& options_;
+  std::shared_ptr<folly::SSLContext> sslContext_;
+  folly::EventBase* evb_;
+  WheelTimerInstance timeout_;
+  const std::string name_;
+  const uint16_t port_;
+  const bool secure_;
+  // Resolved on the first connect, and again after a failed one
+  std::vector<folly::SocketAddress> addresses_;
+  std::unique_ptr<SessionPool> pool_;
+  std::deque<std::unique_ptr<PendingRequest>> waiting_;
+  std::list<Connect> connects_;
+  // Whether the host's sessions take several requests at once; unknown
+  // until the first one is set up
+  folly::Optional<bool> multiplexed_;
+  bool closed_{false};
+};
+
+/**
+ * Sends a request on its transaction and buffers the response, for the
+ * promise of the request.
+ */
+class HTTPClient::Transaction : public HTTPTransactionHandler {
+ public:
+  Transaction(std::shared_ptr<Host> host,
+              std::unique_ptr<PendingRequest> request)
+      : host_(std::move(host)), request_(std::move(request)) {
+  }
+
+  std::unique_ptr<PendingRequest> releaseRequest() {
+    return std::move(request_);
+  }
+
+  void send(std::chrono::milliseconds timeout) {
+    txn_->setIdleTimeout(timeout);
+    txn_->sendHeaders(request_->message);
+    if (request_->body) {
+      txn_->sendBody(std::move(request_->body));
+    }
+    txn_->sendEOM();
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    if (!done_) {
+      fail(HTTPException(HTTPException::Direction::INGRESS,
+                         "Transaction detached without a response"));
+    }
+    host_->onTransactionDone();
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    // The final response follows the 1xx
+    if (!msg->is1xxResponse() || msg->getStatusCode() == 101) {
+      response_.headers = std::move(msg);
+    }
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    body_.append(std::move(chain));
+  }
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override {
+    response_.trailers = std::move(trailers);
+  }
+
+  void onEOM() noexcept override {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+    response_.body = body_.move();
+    request_->promise.setValue(std::move(response_));
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {}
+
+  void onError(const HTTPException& error) noexcept override {
+    fail(error);
+  }
+
+  void onEgressPaused() noexcept override {}
+
+  void onEgressResumed() noexcept override {}
+
+ private:
+  void fail(const HTTPException& error) {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+    request_->promise.setException(error);
+  }
+
+  std::shared_ptr<Host> host_;
+  std::unique_ptr<PendingRequest> request_;
+  HTTPTransaction* txn_{nullptr};
+  Response response_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  bool done_{false};
+};
+
+void HTTPClient::Host::add(std::unique_ptr<PendingRequest> request) {
+  if (closed_) {
+    request->promise.setException(std::runtime_error("HTTPClient closed"));
+    return;
+  }
+  // After the requests already waiting
+  if (waiting_.empty() && send(request)) {
+    return;
+  }
+  if (waiting_.size() >= options_.maxPendingPerHost) {
+    request->promise.setException(
+      std::runtime_error("Too many requests pending for " + name_));
+    return;
+  }
+  waiting_.push_back(std::move(request));
+  maybeConnect();
+}
+
+bool HTTPClient::Host::send(std::unique_ptr<PendingRequest>& request) {
+  auto handler = std::make_unique<Transaction>(shared_from_this(),
+                                               std::move(request));
+  if (!pool_->getTransaction(handler.get())) {
+    request = handler->releaseRequest();
+    return false;
+  }
+  // Deletes itself once detached
+  handler.release()->send(options_.requestTimeout);
+  return true;
+}
+
+void HTTPClient::Host::dispatch() {
+  while (!waiting_.empty() && send(waiting_.front())) {
+    waiting_.pop_front();
+  }
+  if (!waiting_.empty()) {
+    maybeConnect();
+  }
+}
+
+void HTTPClient::Host::maybeConnect() {
+  size_t needed = waiting_.size();
+  if (!multiplexed_ || *multiplexed_) {
+    // The first session tells the protocol, and one more HTTP/2 session
+    // takes all the waiting requests
+    if (!connects_.empty()) {
+      return;
+    }
+    needed = 1;
+  }
+  while (connects_.size() < needed &&
+         pool_->getNumSessions() + connects_.size() <
+           options_.maxSessionsPerHost) {
+    if (!startConnect() || closed_ || waiting_.empty()) {
+      return;
+    }
+  }
+}
+
+bool HTTPClient::Host::startConnect() {
+  if (addresses_.empty()) {
+    try {
+      addresses_ = resolve(name_, port_);
+    } catch (const std::exception& ex) {
+      if (connects_.empty() && pool_->empty()) {
+        failWaiting(ex.what());
+      }
+      return false;
+    }
+  }
+  connects_.emplace_back(*this, timeout_);
+  auto& connect = connects_.back();
+  connect.it_ = std::prev(connects_.end());
+  if (secure_) {
+    connect.connector_.connectSSL(evb_,
+                                  addresses_,
+                                  sslContext_,
+                                  nullptr,
+                                  options_.connectTimeout,
+                                  folly::AsyncSocket::emptyOptionMap,
+                                  folly::AsyncSocket::anyAddress(),
+                                  name_);
+  } else {
+    if (options_.plaintextHTTP2) {
+      connect.connector_.setPlaintextProtocol(
+        http2::kProtocolCleartextString);
+    }
+    connect.connector_.connect(evb_, addresses_, options_.connectTimeout);
+  }
+  return true;
+}
+
+void HTTPClient::Host::onConnectDone(Connect* connect,
+                                     HTTPUpstreamSession* session,
+                                     const folly::AsyncSocketException* ex) {
+  // The connector returns right after its callback
+  connects_.erase(connect->it_);
+  if (session) {
+    multiplexed_ = session->getCodec().supportsParallelRequests();
+    pool_->putSession(session);
+    dispatch();
+    return;
+  }
+  VLOG(4) << "Connecting to " << name_ << " failed: " << ex->what();
+  addresses_.clear();
+  if (connects_.empty() && pool_->empty()) {
+    failWaiting(folly::to<std::string>("Can't connect to ", name_, ": ",
+                                       ex->what()));
+  }
+}
+
+void HTTPClient::Host::failWaiting(const std::string& error) {
+  auto waiting = std::move(waiting_);
+  waiting_.clear();
+  for (auto& request : waiting) {
+    request->promise.setException(std::runtime_error(error));
+  }
+}
+
+void HTTPClient::Host::close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  cancelLoopCallback();
+  // Destroying the connectors cancels the connections without callbacks
+  connects_.clear();
+  failWaiting("HTTPClient closed");
+  // Fails the open transactions, which may still reference the host
+  pool_->closeWithReset();
+}
+
+HTTPClient::HTTPClient(const Options& options,
+                       std::shared_ptr<folly::IOThreadPoolExecutor> executor)
+    : options_(options),
+      executor_(executor ?
+                std::move(executor) :
+                std::make_shared<folly::IOThreadPoolExecutor>(
+                  std::max<size_t>(options.threads, 1),
+                  std::make_shared<folly::NamedThreadFactory>("HTTPClient"))),
+      sslContext_(options.sslContext ?
+                  options.sslContext : makeDefaultSSLContext()) {
+  for (auto& evb : executor_->getAllEventBases()) {
+    workers_.push_back(std::make_unique<Worker>());
+    workers_.back()->evb = evb.get();
+  }
+}
+
+HTTPClient::~HTTPClient() {
+  for (auto& worker : workers_) {
+    // After any drain() queued before
+    worker->evb->runImmediatelyOrRunInEventBaseThreadAndWait([&worker] {
+      std::unique_ptr<PendingRequest> pending;
+      while (worker->queue.try_dequeue(pending)) {
+        pending->promise.setException(std::runtime_error("HTTPClient closed"));
+      }
+      for (auto& host : worker->hosts) {
+        host.second->close();
+      }
+      worker->hosts.clear();
+    });
+  }
+}
+
+folly::SemiFuture<HTTPClient::Response> HTTPClient::request(
+    HTTPMessage request,
+    std::unique_ptr<folly::IOBuf> body) {
+  URL url(request.getURL());
+  if (!url.isValid() || !url.hasHost()) {
+    return folly::makeSemiFuture<Response>(
+      std::invalid_argument("No host in the URL " + request.getURL()));
+  }
+  auto pending = std::make_unique<PendingRequest>();
+  pending->hostKey = folly::to<std::string>(url.getScheme(), "://",
+                                            url.getHostAndPort());
+  pending->hostName = url.getHost();
+  pending->port = url.getPort();
+  pending->secure = url.isSecure();
+
+  auto& headers = request.getHeaders();
+  if (!headers.exists(HTTP_HEADER_HOST)) {
+    headers.set(HTTP_HEADER_HOST, url.getHostAndPort());
+  }
+  if (body && !request.getIsChunked() &&
+      !headers.exists(HTTP_HEADER_CONTENT_LENGTH)) {
+    headers.set(HTTP_HEADER_CONTENT_LENGTH,
+                folly::to<std::string>(body->computeChainDataLength()));
+  }
+  request.setURL(url.getQuery().empty() ?
+                 url.getPath() :
+                 folly::to<std::string>(url.getPath(), '?', url.getQuery()));
+  if (request.getURL().empty()) {
+    request.setURL("/");
+  }
+  pending->message = std::move(request);
+  pending->body = std::move(body);
+  auto future = pending->promise.getSemiFuture();
+
+  auto& worker = *workers_[std::hash<std::string>()(pending->hostKey) %
+                           workers_.size()];
+  worker.queue.enqueue(std::move(pending));
+  if (!worker.drainScheduled.exchange(true)) {
+    worker.evb->runInEventBaseThread([this, &worker] { drain(worker); });
+  }
+  return future;
+}
+
+void HTTPClient::drain(Worker& worker) {
+  // Before dequeuing, so that the requests enqueued from now on schedule
+  // another drain
+  worker.drainScheduled.store(false);
+  std::unique_ptr<PendingRequest> pending;
+  while (worker.queue.try_dequeue(pending)) {
+    auto& host = worker.hosts[pending->hostKey];
+    if (!host) {
+      host = std::make_shared<Host>(options_, sslContext_, worker.evb,
+                                    *pending);
+    }
+    host->add(std::move(pending));
+  }
+}
+
+}
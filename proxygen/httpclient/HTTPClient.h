@@ -0,0 +1,132 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Portability.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/SSLContext.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if FOLLY_HAS_COROUTINES
+#include <folly/experimental/coro/Task.h>
+#endif
+
+namespace proxygen {
+
+/**
+ * An HTTP client for requests to any number of hosts, from any thread.
+ *
+ *   HTTPClient client(HTTPClient::Options{});
+ *   HTTPMessage request;
+ *   request.setMethod(HTTPMethod::GET);
+ *   request.setURL("https://example.com/index.html");
+ *   auto response = client.request(std::move(request)).get();
+ *
+ * Each host (scheme, name and port of the request's absolute URL) belongs
+ * to one of the EventBases of the client, where a SessionPool keeps its
+ * connections, up to maxSessionsPerHost of them.  Requests are queued to
+ * the EventBase of their host on a lock free queue, and picked up in
+ * batches: a burst of requests costs one wakeup of the EventBase.  There,
+ * a request goes on a pooled session that can take one more transaction,
+ * else waits for one while the client connects.
+ *
+ * HTTPS connections negotiate HTTP/2 or HTTP/1.1 with ALPN; plaintext ones
+ * are HTTP/1.1, or HTTP/2 with prior knowledge if plaintextHTTP2.  HTTP/2
+ * sessions take many requests at once, so the client opens more only once
+ * they are full.
+ *
+ * The responses are buffered whole.  Destroying the client fails the
+ * requests not done yet; no request may be made while it is destroyed.
+ */
+class HTTPClient {
+ public:
+  struct Options {
+    // EventBases of the client's own, if no executor is given
+    size_t threads{1};
+    uint32_t maxSessionsPerHost{8};
+    // Requests waiting for a session per host, over which requests fail
+    size_t maxPendingPerHost{1024};
+    std::chrono::milliseconds connectTimeout{1000};
+    // Of the transactions, between any two reads or writes
+    std::chrono::milliseconds requestTimeout{5000};
+    // Unused sessions close after this long
+    std::chrono::milliseconds idleTimeout{60000};
+    // nullptr uses one verifying nothing and offering h2 and http/1.1
+    std::shared_ptr<folly::SSLContext> sslContext;
+    bool plaintextHTTP2{false};
+  };
+
+  struct Response {
+    std::unique_ptr<HTTPMessage> headers;
+    std::unique_ptr<folly::IOBuf> body;
+    std::unique_ptr<HTTPHeaders> trailers;
+  };
+
+  explicit HTTPClient(
+    const Options& options,
+    std::shared_ptr<folly::IOThreadPoolExecutor> executor = nullptr);
+  ~HTTPClient();
+
+  HTTPClient(const HTTPClient&) = delete;
+  HTTPClient& operator=(const HTTPClient&) = delete;
+
+  /**
+   * Sends request to the host of its absolute URL, with body if any, and
+   * completes with the response once it is all received.  Fails with an
+   * HTTPException if the transaction does, with a std::runtime_error if
+   * the host can't be connected to or has too many pending requests, and
+   * with a std::invalid_argument for a URL without host.
+   *
+   * The Host header and the Content-Length of body are set if missing.
+   * Thread-safe.
+   */
+  folly::SemiFuture<Response> request(
+    HTTPMessage request,
+    std::unique_ptr<folly::IOBuf> body = nullptr);
+
+#if FOLLY_HAS_COROUTINES
+  folly::coro::Task<Response> co_request(
+      HTTPMessage request,
+      std::unique_ptr<folly::IOBuf> body = nullptr) {
+    co_return co_await this->request(std::move(request), std::move(body));
+  }
+#endif
+
+ private:
+  class Host;
+  class Transaction;
+  struct Worker;
+
+  struct PendingRequest {
+    std::string hostKey;
+    std::string hostName;
+    uint16_t port{0};
+    bool secure{false};
+    HTTPMessage message;
+    std::unique_ptr<folly::IOBuf> body;
+    folly::Promise<Response> promise;
+  };
+
+  // Picks up the requests queued for worker, on its EventBase
+  void drain(Worker& worker);
+
+  const Options options_;
+  std::shared_ptr<folly::IOThreadPoolExecutor> executor_;
+  std::shared_ptr<folly::SSLContext> sslContext_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+}
@@ -74,23 +74,31 @@ HTTPHeaders CurlClient::parseHeaders(const std::string& headersString) {
   return headers;
 }
 
-void CurlClient::initializeSsl(const string& caPath,
-                               const string& nextProtos,
-                               const string& certPath,
-                               const string& keyPath) {
-  sslContext_ = std::make_shared<folly::SSLContext>();
-  sslContext_->setOptions(SSL_OP_NO_COMPRESSION);
-  sslContext_->setCipherList(folly::ssl::SSLCommonOptions::ciphers());
+folly::SSLContextPtr CurlClient::makeSSLContext(const string& caPath,
+                                                const string& nextProtos,
+                                                const string& certPath,
+                                                const string& keyPath) {
+  auto sslContext = std::make_shared<folly::SSLContext>();
+  sslContext->setOptions(SSL_OP_NO_COMPRESSION);
+  sslContext->setCipherList(folly::ssl::SSLCommonOptions::ciphers());
   if (!caPath.empty()) {
-    sslContext_->loadTrustedCertificates(caPath.c_str());
+    sslContext->loadTrustedCertificates(caPath.c_str());
   }
   if (!certPath.empty() && !keyPath.empty()) {
-    sslContext_->loadCertKeyPairFromFiles(certPath.c_str(), keyPath.c_str());
+    sslContext->loadCertKeyPairFromFiles(certPath.c_str(), keyPath.c_str());
   }
   list<string> nextProtoList;
   folly::splitTo<string>(',', nextProtos, std::inserter(nextProtoList,
                                                         nextProtoList.begin()));
-  sslContext_->setAdvertisedNextProtocols(nextProtoList);
+  sslContext->setAdvertisedNextProtocols(nextProtoList);
+  return sslContext;
+}
+
+void CurlClient::initializeSsl(const string& caPath,
+                               const string& nextProtos,
+                               const string& certPath,
+                               const string& keyPath) {
+  sslContext_ = makeSSLContext(caPath, nextProtos, certPath, keyPath);
   h2c_ = false;
 }
 
@@ -36,6 +36,11 @@ class CurlClient : public proxygen::HTTPConnector::Callback,
 
   static proxygen::HTTPHeaders parseHeaders(const std::string& headersString);
 
+  static folly::SSLContextPtr makeSSLContext(const std::string& caPath,
+                                             const std::string& nextProtos,
+                                             const std::string& certPath,
+                                             const std::string& keyPath);
+
   // initial SSL related structures
   void initializeSsl(const std::string& caPath,
                      const std::string& nextProtos,
@@ -16,9 +16,12 @@
 
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/SSLContext.h>
+#include <folly/FileUtil.h>
 #include <folly/SocketAddress.h>
 #include <proxygen/lib/http/HTTPConnector.h>
 #include "CurlClient.h"
+#include "LoadGenerator.h"
+#include <iostream>
 
 using namespace CurlService;
 using namespace folly;
@@ -46,6 +49,63 @@ DEFINE_int32(recv_window, 65536, "Flow control receive window for h2/spdy");
 DEFINE_bool(h2c, true, "Attempt HTTP/1.1 -> HTTP/2 upgrade");
 DEFINE_string(headers, "", "List of N=V headers separated by ,");
 DEFINE_string(proxy, "", "HTTP proxy URL");
+DEFINE_int32(load_connections, 0, "Generate load with that many connections "
+             "instead of sending one request");
+DEFINE_int32(load_streams, 1, "Requests in flight per connection, at most 1 "
+             "for HTTP/1.x");
+DEFINE_int32(load_rate, 0, "Requests per second, 0 to have each connection "
+             "send the next request as soon as one completes");
+DEFINE_int32(load_duration, 10, "Seconds of load");
+DEFINE_int32(load_threads, 1, "Threads generating load");
+
+namespace {
+
+int generateLoad(const URL& url,
+                 HTTPMethod method,
+                 const HTTPHeaders& headers,
+                 const SocketAddress& addr) {
+  LoadGenerator::Options options;
+  options.address = addr;
+  options.connectTimeout =
+    std::chrono::milliseconds(FLAGS_http_client_connect_timeout);
+  if (url.isSecure()) {
+    options.sslContext = CurlClient::makeSSLContext(
+        FLAGS_ca_path, FLAGS_next_protos, FLAGS_cert_path, FLAGS_key_path);
+    options.serverName = url.getHost();
+  }
+  options.plaintextProto = FLAGS_plaintext_proto;
+  auto& request = options.request;
+  headers.copyTo(request.getHeaders());
+  request.setMethod(method);
+  request.setHTTPVersion(1, 1);
+  request.setURL(url.makeRelativeURL());
+  request.setSecure(url.isSecure());
+  if (!request.getHeaders().exists(HTTP_HEADER_USER_AGENT)) {
+    request.getHeaders().add(HTTP_HEADER_USER_AGENT, "proxygen_curl");
+  }
+  if (!request.getHeaders().exists(HTTP_HEADER_HOST)) {
+    request.getHeaders().add(HTTP_HEADER_HOST, url.getHostAndPort());
+  }
+  if (method == HTTPMethod::POST) {
+    if (!folly::readFile(FLAGS_input_filename.c_str(), options.body)) {
+      LOG(ERROR) << "Couldn't read " << FLAGS_input_filename;
+      return EXIT_FAILURE;
+    }
+    request.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                             folly::to<std::string>(options.body.size()));
+  }
+  options.threads = FLAGS_load_threads;
+  options.connections = FLAGS_load_connections;
+  options.streams = FLAGS_load_streams;
+  options.rate = FLAGS_load_rate;
+  options.duration = std::chrono::seconds(FLAGS_load_duration);
+
+  auto result = LoadGenerator(std::move(options)).run();
+  LoadGenerator::print(result, std::cout);
+  return result.latencies.getCount() > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
 
 int main(int argc, char* argv[]) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -90,6 +150,9 @@ int main(int argc, char* argv[]) {
   } else {
     addr = SocketAddress(url.getHost(), url.getPort(), true);
   }
+  if (FLAGS_load_connections > 0) {
+    return generateLoad(url, httpMethod, headers, addr);
+  }
   LOG(INFO) << "Trying to connect to " << addr;
 
   // Note: HHWheelTimer is a large object and should be created at most
@@ -0,0 +1,411 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "LoadGenerator.h"
+
+#include <cmath>
+#include <deque>
+#include <folly/Format.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/utils/Time.h>
+#include <thread>
+
+using namespace folly;
+using namespace proxygen;
+
+namespace CurlService {
+
+namespace {
+// Values below are exact, larger ones in buckets of kSubBuckets
+const size_t kExactBuckets = 256;
+const size_t kSubBuckets = 128;
+// Bits of the values kept past the highest
+const size_t kSubBucketBits = 7;
+}
+
+size_t LatencyHistogram::getBucket(uint64_t value) {
+  if (value < kExactBuckets) {
+    return value;
+  }
+  size_t shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+  return kExactBuckets + (shift - 1) * kSubBuckets +
+    ((value >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyHistogram::getBucketValue(size_t bucket) {
+  if (bucket < kExactBuckets) {
+    return bucket;
+  }
+  size_t shift = (bucket - kExactBuckets) / kSubBuckets + 1;
+  uint64_t subBucket = (bucket - kExactBuckets) % kSubBuckets + kSubBuckets;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::add(uint64_t value) {
+  auto bucket = getBucket(value);
+  if (bucket >= buckets_.size()) {
+    buckets_.resize(bucket + 1);
+  }
+  buckets_[bucket]++;
+  count_++;
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  if (other.buckets_.size() > buckets_.size()) {
+    buckets_.resize(other.buckets_.size());
+  }
+  for (size_t i = 0; i < other.buckets_.size(); i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const {
+  auto target = std::max<uint64_t>(
+    std::ceil(percentile / 100 * count_), 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    seen += buckets_[i];
+    if (seen >= target) {
+      return std::min(getBucketValue(i), max_);
+    }
+  }
+  return max_;
+}
+
+void LatencyHistogram::printPercentiles(std::ostream& out) const {
+  out << folly::format("{:>12} {:>14} {:>10} {:>14}\n\n", "Value",
+                       "Percentile", "TotalCount", "1/(1-Percentile)");
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    if (buckets_[i] == 0) {
+      continue;
+    }
+    seen += buckets_[i];
+    double fraction = double(seen) / count_;
+    out << folly::format("{:12.3f} {:14.12f} {:10d} {:14.2f}\n",
+                         double(std::min(getBucketValue(i), max_)),
+                         fraction, seen,
+                         fraction < 1 ? 1 / (1 - fraction) : 0.0);
+  }
+  out << folly::format("#[Max     = {:12.3f}, Total count    = {:12d}]\n",
+                       double(max_), count_);
+}
+
+/**
+ * A thread and its share of the connections.
+ */
+class LoadGenerator::Worker {
+ public:
+  class Connection : public HTTPConnector::Callback {
+   public:
+    class Request : public HTTPTransactionHandler {
+     public:
+      Request(Connection& connection, TimePoint start)
+          : connection_(connection), start_(start) {}
+
+      void setTransaction(HTTPTransaction* /*txn*/) noexcept override {}
+
+      void detachTransaction() noexcept override {
+        connection_.onRequestDone(start_, end_, ok_);
+        delete this;
+      }
+
+      void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept
+          override {
+        ok_ = msg->getStatusCode() >= 200 && msg->getStatusCode() < 300;
+      }
+
+      void onBody(std::unique_ptr<folly::IOBuf> /*chain*/) noexcept override {}
+
+      void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept
+          override {}
+
+      void onEOM() noexcept override {
+        end_ = getCurrentTime();
+      }
+
+      void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {}
+
+      void onError(const HTTPException& /*error*/) noexcept override {
+        ok_ = false;
+      }
+
+      void onEgressPaused() noexcept override {}
+
+      void onEgressResumed() noexcept override {}
+
+     private:
+      Connection& connection_;
+      TimePoint start_;
+      TimePoint end_;
+      bool ok_{false};
+    };
+
+    explicit Connection(Worker& worker)
+        : worker_(worker),
+          connector_(this, worker.timer_.get()) {
+    }
+
+    void connect() {
+      const auto& options = worker_.options_;
+      if (options.sslContext) {
+        connector_.connectSSL(&worker_.evb_, options.address,
+                              options.sslContext, nullptr,
+                              options.connectTimeout,
+                              folly::AsyncSocket::emptyOptionMap,
+                              folly::AsyncSocket::anyAddress(),
+                              options.serverName);
+      } else {
+        if (!options.plaintextProto.empty()) {
+          connector_.setPlaintextProtocol(options.plaintextProto);
+        }
+        connector_.connect(&worker_.evb_, options.address,
+                           options.connectTimeout);
+      }
+    }
+
+    void close() {
+      if (session_) {
+        auto session = session_;
+        session_ = nullptr;
+        session->dropConnection();
+      }
+    }
+
+    bool canSend() const {
+      return session_ && inFlight_ < worker_.options_.streams &&
+        session_->supportsMoreTransactions();
+    }
+
+    void sendRequest(TimePoint start) {
+      auto request = new Request(*this, start);
+      auto txn = session_->newTransaction(request);
+      if (!txn) {
+        delete request;
+        worker_.errors_++;
+        return;
+      }
+      inFlight_++;
+      const auto& options = worker_.options_;
+      txn->sendHeaders(options.request);
+      if (!options.body.empty()) {
+        txn->sendBody(folly::IOBuf::copyBuffer(options.body));
+      }
+      txn->sendEOM();
+    }
+
+    // HTTPConnector::Callback
+    void connectSuccess(HTTPUpstreamSession* session) override {
+      session_ = session;
+      worker_.onConnected(*this);
+    }
+
+    void connectError(const folly::AsyncSocketException& ex) override {
+      LOG(ERROR) << "Couldn't connect to " << worker_.options_.address << ": "
+                 << ex.what();
+      worker_.connectErrors_++;
+    }
+
+   private:
+    void onRequestDone(TimePoint start, TimePoint end, bool ok) {
+      inFlight_--;
+      worker_.onRequestDone(*this, start, end, ok);
+    }
+
+    Worker& worker_;
+    HTTPConnector connector_;
+    HTTPUpstreamSession* session_{nullptr};
+    size_t inFlight_{0};
+  };
+
+  Worker(const Options& options, size_t connections, double rate)
+      : options_(options),
+        rate_(rate),
+        timer_(HHWheelTimer::newTimer(
+                 &evb_,
+                 std::chrono::milliseconds(HHWheelTimer::DEFAULT_TICK_INTERVAL),
+                 AsyncTimeout::InternalEnum::NORMAL,
+                 std::chrono::milliseconds(5000))),
+        rateTimeout_(*this) {
+    for (size_t i = 0; i < connections; i++) {
+      connections_.push_back(std::make_unique<Connection>(*this));
+    }
+  }
+
+  void start(TimePoint start) {
+    thread_ = std::thread([this, start] {
+        start_ = start;
+        for (auto& connection : connections_) {
+          connection->connect();
+        }
+        if (rate_ > 0) {
+          rateTimeout_.scheduleTimeout(1);
+        }
+        evb_.loopForever();
+      });
+  }
+
+  void stop(Result& result) {
+    evb_.runInEventBaseThreadAndWait([this] {
+        stopping_ = true;
+        rateTimeout_.cancelTimeout();
+        for (auto& connection : connections_) {
+          connection->close();
+        }
+      });
+    evb_.terminateLoopSoon();
+    thread_.join();
+    // The loop callbacks left, while the connections they use exist
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+    result.latencies.merge(latencies_);
+    result.errors += errors_;
+    result.connectErrors += connectErrors_;
+    result.backlog += backlog_.size();
+  }
+
+ private:
+  class RateTimeout : public folly::AsyncTimeout {
+   public:
+    explicit RateTimeout(Worker& worker)
+        : folly::AsyncTimeout(&worker.evb_), worker_(worker) {}
+
+    void timeoutExpired() noexcept override {
+      worker_.schedule();
+      scheduleTimeout(1);
+    }
+
+   private:
+    Worker& worker_;
+  };
+
+  // Queues the requests due at rate_
+  void schedule() {
+    auto now = getCurrentTime();
+    auto due = uint64_t(
+      std::chrono::duration<double>(now - start_).count() * rate_);
+    for (; scheduled_ < due; scheduled_++) {
+      backlog_.push_back(start_ + std::chrono::microseconds(
+                           uint64_t(scheduled_ * 1e6 / rate_)));
+    }
+    dispatch();
+  }
+
+  // Sends the backlog on the connections with a free stream
+  void dispatch() {
+    for (auto& connection : connections_) {
+      while (!backlog_.empty() && connection->canSend()) {
+        auto scheduled = backlog_.front();
+        backlog_.pop_front();
+        connection->sendRequest(scheduled);
+      }
+    }
+  }
+
+  void onConnected(Connection& connection) {
+    if (rate_ > 0) {
+      dispatch();
+      return;
+    }
+    while (connection.canSend()) {
+      connection.sendRequest(getCurrentTime());
+    }
+  }
+
+  void onRequestDone(Connection& connection, TimePoint start, TimePoint end,
+                     bool ok) {
+    if (stopping_) {
+      return;
+    }
+    if (ok) {
+      latencies_.add(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          end - start).count());
+    } else {
+      errors_++;
+    }
+    // HTTP/1.x sessions don't take the next transaction before they are
+    // done with this one
+    evb_.runInLoop([this, &connection] {
+        if (stopping_) {
+          return;
+        }
+        if (rate_ > 0) {
+          dispatch();
+        } else if (connection.canSend()) {
+          connection.sendRequest(getCurrentTime());
+        }
+      }, true);
+  }
+
+  folly::EventBase evb_;
+  const Options& options_;
+  const double rate_;
+  HHWheelTimer::UniquePtr timer_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  // Destroyed before the connections it dispatches to
+  RateTimeout rateTimeout_;
+  std::thread thread_;
+  TimePoint start_;
+  uint64_t scheduled_{0};
+  std::deque<TimePoint> backlog_;
+  bool stopping_{false};
+  LatencyHistogram latencies_;
+  uint64_t errors_{0};
+  uint64_t connectErrors_{0};
+};
+
+LoadGenerator::Result LoadGenerator::run() {
+  std::vector<std::unique_ptr<Worker>> workers;
+  auto threads = std::max<size_t>(options_.threads, 1);
+  for (size_t i = 0; i < threads; i++) {
+    // Spread the connections and the rate evenly
+    auto connections = options_.connections / threads +
+      (i < options_.connections % threads ? 1 : 0);
+    workers.push_back(std::make_unique<Worker>(
+                        options_, connections,
+                        double(options_.rate) / threads));
+  }
+  auto start = getCurrentTime();
+  for (auto& worker : workers) {
+    worker->start(start);
+  }
+  std::this_thread::sleep_for(options_.duration);
+
+  Result result;
+  for (auto& worker : workers) {
+    worker->stop(result);
+  }
+  result.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+    getCurrentTime() - start);
+  return result;
+}
+
+void LoadGenerator::print(const Result& result, std::ostream& out) {
+  const auto& latencies = result.latencies;
+  double seconds = result.elapsed.count() / 1e6;
+  out << folly::format(
+    "requests: {}, {:.1f}/s, errors: {}, connect errors: {}, "
+    "backlog: {}\n",
+    latencies.getCount(), latencies.getCount() / seconds, result.errors,
+    result.connectErrors, result.backlog);
+  out << folly::format(
+    "latency us: p50 {}, p90 {}, p99 {}, p99.9 {}, max {}\n\n",
+    latencies.getPercentile(50), latencies.getPercentile(90),
+    latencies.getPercentile(99), latencies.getPercentile(99.9),
+    latencies.getMax());
+  latencies.printPercentiles(out);
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/SocketAddress.h>
+#include <folly/io/async/SSLContext.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+namespace CurlService {
+
+/**
+ * Latencies in microseconds, in buckets of at most 1/128 of their value
+ * (HdrHistogram's layout, with 2 significant digits).
+ */
+class LatencyHistogram {
+ public:
+  void add(uint64_t value);
+
+  void merge(const LatencyHistogram& other);
+
+  // The value at or below which percentile% of the values are
+  uint64_t getPercentile(double percentile) const;
+
+  uint64_t getCount() const {
+    return count_;
+  }
+
+  uint64_t getMax() const {
+    return max_;
+  }
+
+  /**
+   * Prints the percentile distribution as HdrHistogram does, for its
+   * plotting tools.
+   */
+  void printPercentiles(std::ostream& out) const;
+
+ private:
+  static size_t getBucket(uint64_t value);
+  // The highest value of bucket
+  static uint64_t getBucketValue(size_t bucket);
+
+  std::vector<uint64_t> buckets_;
+  uint64_t count_{0};
+  uint64_t max_{0};
+};
+
+/**
+ * Sends a request over and over to a server, from connections spread over
+ * threads, each with up to streams requests in flight (HTTP/1.x sessions
+ * only take one).
+ *
+ * With no rate, each connection sends its next request as soon as one
+ * completes (closed loop).  With a rate, requests are scheduled at that
+ * rate whatever the response times, and wait for a stream if all are busy:
+ * their latencies are from their scheduled times, so that a stalled server
+ * shows in them rather than in a lower request rate.
+ */
+class LoadGenerator {
+ public:
+  struct Options {
+    folly::SocketAddress address;
+    // Set for HTTPS
+    std::shared_ptr<folly::SSLContext> sslContext;
+    std::string serverName;
+    // For plaintext HTTP/2 without upgrade
+    std::string plaintextProto;
+    std::chrono::milliseconds connectTimeout{1000};
+    proxygen::HTTPMessage request;
+    std::string body;
+    size_t threads{1};
+    size_t connections{1};
+    size_t streams{1};
+    // Requests per second, 0 for closed loop
+    size_t rate{0};
+    std::chrono::seconds duration{10};
+  };
+
+  struct Result {
+    LatencyHistogram latencies;
+    // Non 2xx responses, and requests that failed
+    uint64_t errors{0};
+    uint64_t connectErrors{0};
+    // Scheduled requests not sent when the load stopped
+    uint64_t backlog{0};
+    std::chrono::microseconds elapsed{0};
+  };
+
+  explicit LoadGenerator(Options options)
+      : options_(std::move(options)) {}
+
+  /**
+   * Connects, sends requests for the duration, and disconnects.
+   */
+  Result run();
+
+  static void print(const Result& result, std::ostream& out);
+
+ private:
+  class Worker;
+
+  Options options_;
+};
+
+}
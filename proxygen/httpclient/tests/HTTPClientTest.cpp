@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpclient/HTTPClient.h>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/ScopedHTTPServer.h>
+
+using namespace proxygen;
+
+namespace {
+
+HTTPMessage makeRequest(HTTPMethod method, const std::string& url) {
+  HTTPMessage request;
+  request.setMethod(method);
+  request.setURL(url);
+  return request;
+}
+
+}
+
+class HTTPClientTest : public testing::Test {
+ public:
+  void SetUp() override {
+    server_ = ScopedHTTPServer::start(
+      [](const HTTPMessage& request,
+         std::unique_ptr<folly::IOBuf> body,
+         ResponseBuilder& response) {
+        response.status(200, "OK")
+          .header("X-Path", request.getURL())
+          .header("X-Host", request.getHeaders().getSingleOrEmpty(
+                              HTTP_HEADER_HOST));
+        if (body) {
+          response.body(std::move(body));
+        }
+      });
+  }
+
+ protected:
+  std::string url(const std::string& path) const {
+    return folly::to<std::string>("http://127.0.0.1:", server_->getPort(),
+                                  path);
+  }
+
+  std::unique_ptr<ScopedHTTPServer> server_;
+};
+
+TEST_F(HTTPClientTest, Get) {
+  HTTPClient client(HTTPClient::Options{});
+  auto response =
+    client.request(makeRequest(HTTPMethod::GET, url("/a?b=c"))).get();
+  ASSERT_TRUE(response.headers);
+  EXPECT_EQ(200, response.headers->getStatusCode());
+  EXPECT_EQ("/a?b=c",
+            response.headers->getHeaders().getSingleOrEmpty("X-Path"));
+  EXPECT_EQ(folly::to<std::string>("127.0.0.1:", server_->getPort()),
+            response.headers->getHeaders().getSingleOrEmpty("X-Host"));
+}
+
+TEST_F(HTTPClientTest, Post) {
+  HTTPClient client(HTTPClient::Options{});
+  auto response = client.request(makeRequest(HTTPMethod::POST, url("/")),
+                                 folly::IOBuf::copyBuffer("hello"))
+                    .get();
+  ASSERT_TRUE(response.body);
+  EXPECT_EQ("hello", response.body->moveToFbString().toStdString());
+}
+
+TEST_F(HTTPClientTest, ConcurrentRequests) {
+  HTTPClient::Options options;
+  options.threads = 2;
+  options.maxSessionsPerHost = 2;
+  HTTPClient client(options);
+  std::vector<folly::SemiFuture<HTTPClient::Response>> futures;
+  for (int i = 0; i < 50; ++i) {
+    futures.push_back(client.request(
+      makeRequest(HTTPMethod::GET, url(folly::to<std::string>("/", i)))));
+  }
+  for (int i = 0; i < 50; ++i) {
+    auto response = std::move(futures[i]).get();
+    EXPECT_EQ(folly::to<std::string>("/", i),
+              response.headers->getHeaders().getSingleOrEmpty("X-Path"));
+  }
+}
+
+TEST_F(HTTPClientTest, NoHost) {
+  HTTPClient client(HTTPClient::Options{});
+  EXPECT_THROW(client.request(makeRequest(HTTPMethod::GET, "/")).get(),
+               std::invalid_argument);
+}
+
+TEST_F(HTTPClientTest, ConnectError) {
+  auto port = server_->getPort();
+  server_.reset();
+  HTTPClient client(HTTPClient::Options{});
+  auto request = makeRequest(
+    HTTPMethod::GET, folly::to<std::string>("http://127.0.0.1:", port, "/"));
+  EXPECT_THROW(client.request(std::move(request)).get(), std::runtime_error);
+}
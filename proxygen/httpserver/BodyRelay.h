@@ -0,0 +1,148 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/httpserver/ResponseHandler.h>
+
+namespace proxygen {
+
+/**
+ * Relays a response body from a source, such as an upstream transaction, to
+ * a ResponseHandler, with the flow control of both coupled: while the
+ * ResponseHandler's egress is paused the body is held in the relay rather
+ * than in the transaction, the source is paused once more than
+ * highWatermark bytes are held, and resumed once they drain below
+ * lowWatermark.  The IOBufs are passed on as received, without copying.
+ *
+ * The relay is driven from the thread of the transaction: the owner passes
+ * it the body and the egress events of the ResponseHandler, and calls
+ * detach() once the ResponseHandler is gone.
+ */
+class BodyRelay {
+ public:
+  class Source {
+   public:
+    virtual ~Source() {}
+
+    virtual void pauseSource() noexcept = 0;
+    virtual void resumeSource() noexcept = 0;
+  };
+
+  struct Options {
+    size_t highWatermark{256 * 1024};
+    size_t lowWatermark{64 * 1024};
+  };
+
+  BodyRelay(ResponseHandler* sink, Source* source, const Options& options)
+      : sink_(sink), source_(source), options_(options) {
+    DCHECK_LE(options_.lowWatermark, options_.highWatermark);
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+    if (!sink_ || !body) {
+      return;
+    }
+    if (!egressPaused_ && body_.empty()) {
+      sink_->sendBody(std::move(body));
+      return;
+    }
+    body_.append(std::move(body));
+    maxBufferedBytes_ = std::max(maxBufferedBytes_, body_.chainLength());
+    if (!sourcePaused_ && body_.chainLength() > options_.highWatermark) {
+      sourcePaused_ = true;
+      numSourcePauses_++;
+      source_->pauseSource();
+    }
+  }
+
+  void onEOM() noexcept {
+    eom_ = true;
+    flush();
+  }
+
+  void onEgressPaused() noexcept {
+    egressPaused_ = true;
+  }
+
+  void onEgressResumed() noexcept {
+    egressPaused_ = false;
+    flush();
+  }
+
+  /**
+   * Drops the body held and stops relaying, e.g. once the ResponseHandler
+   * failed.
+   */
+  void detach() noexcept {
+    sink_ = nullptr;
+    body_.move();
+  }
+
+  bool isEgressPaused() const {
+    return egressPaused_;
+  }
+
+  size_t getBufferedBytes() const {
+    return body_.chainLength();
+  }
+
+  size_t getMaxBufferedBytes() const {
+    return maxBufferedBytes_;
+  }
+
+  uint32_t getNumSourcePauses() const {
+    return numSourcePauses_;
+  }
+
+ private:
+  /**
+   * Passes the body held on while egress isn't paused, lowWatermark bytes
+   * at a time so that a pause midway keeps the rest here, then the EOM
+   * once the body is all passed.
+   */
+  void flush() {
+    if (flushing_) {
+      return;
+    }
+    flushing_ = true;
+    while (sink_ && !egressPaused_ && !body_.empty()) {
+      auto size = std::max<size_t>(options_.lowWatermark, 1);
+      sink_->sendBody(body_.split(std::min(size, body_.chainLength())));
+    }
+    flushing_ = false;
+    if (!sink_) {
+      return;
+    }
+    if (sourcePaused_ && body_.chainLength() <= options_.lowWatermark) {
+      sourcePaused_ = false;
+      source_->resumeSource();
+    }
+    // Nothing left to hold the EOM for, even while paused
+    if (eom_ && body_.empty() && sink_) {
+      eom_ = false;
+      sink_->sendEOM();
+    }
+  }
+
+  ResponseHandler* sink_;
+  Source* source_;
+  const Options options_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  size_t maxBufferedBytes_{0};
+  uint32_t numSourcePauses_{0};
+  bool egressPaused_{false};
+  bool sourcePaused_{false};
+  bool eom_{false};
+  bool flushing_{false};
+};
+
+}
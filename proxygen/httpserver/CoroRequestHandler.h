@@ -0,0 +1,250 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Portability.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <experimental/coroutine>
+#include <folly/Executor.h>
+#include <folly/experimental/coro/Task.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <proxygen/httpserver/RequestHandler.h>
+#include <proxygen/httpserver/ResponseHandler.h>
+#include <proxygen/lib/utils/Exception.h>
+
+namespace proxygen {
+
+/**
+ * RequestHandler running a coroutine per request, for handlers reading and
+ * writing the request in sequence rather than as a state machine:
+ *
+ *   folly::coro::Task<void> handleRequest(
+ *       std::unique_ptr<HTTPMessage> headers) override {
+ *     while (auto body = co_await readBody()) {
+ *       ...
+ *     }
+ *     ResponseBuilder(downstream_).status(200, "OK").send();
+ *     co_await sendBody(std::move(response));
+ *     ResponseBuilder(downstream_).sendWithEOM();
+ *   }
+ *
+ * The coroutine runs on the EventBase of the connection, and the awaitables
+ * resume it from the transaction callbacks on that EventBase, without
+ * rescheduling nor allocating.  readBody() pauses ingress while more than
+ * maxBufferedBody bytes wait to be read, and sendBody() waits while egress
+ * is paused.  Once the request fails they throw a proxygen::Exception with
+ * the ProxygenError.  If the coroutine throws otherwise, the response is
+ * aborted.
+ *
+ * The handler deletes itself once both the coroutine and the transaction are
+ * done, so the coroutine can use its members until it returns.
+ */
+class CoroRequestHandler : public RequestHandler {
+ public:
+  explicit CoroRequestHandler(size_t maxBufferedBody = 64 * 1024)
+      : maxBufferedBody_(maxBufferedBody) {}
+
+  virtual folly::coro::Task<void> handleRequest(
+    std::unique_ptr<HTTPMessage> headers) = 0;
+
+  class BodyAwaiter;
+  class EgressAwaiter;
+
+  /**
+   * The next part of the request body, nullptr once the body is all read.
+   */
+  BodyAwaiter readBody() noexcept {
+    return BodyAwaiter(*this);
+  }
+
+  /**
+   * Waits for egress to be resumed, if paused.
+   */
+  EgressAwaiter waitForEgress() noexcept {
+    return EgressAwaiter(*this, nullptr);
+  }
+
+  /**
+   * Sends body once egress isn't paused.  The headers must have been sent.
+   */
+  EgressAwaiter sendBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+    return EgressAwaiter(*this, std::move(body));
+  }
+
+  class BodyAwaiter {
+   public:
+    explicit BodyAwaiter(CoroRequestHandler& handler) : handler_(handler) {}
+
+    bool await_ready() const noexcept {
+      return !handler_.body_.empty() || handler_.eom_ || handler_.error_;
+    }
+
+    void await_suspend(std::experimental::coroutine_handle<> waiter) noexcept {
+      DCHECK(!handler_.reader_);
+      handler_.reader_ = waiter;
+    }
+
+    std::unique_ptr<folly::IOBuf> await_resume() {
+      handler_.checkError();
+      auto body = handler_.body_.move();
+      handler_.resumeIngressIfPaused();
+      return body;
+    }
+
+    // Already resumed on the EventBase of the handler
+    friend BodyAwaiter co_viaIfAsync(folly::Executor::KeepAlive<>,
+                                     BodyAwaiter awaiter) noexcept {
+      return awaiter;
+    }
+
+   private:
+    CoroRequestHandler& handler_;
+  };
+
+  class EgressAwaiter {
+   public:
+    EgressAwaiter(CoroRequestHandler& handler,
+                  std::unique_ptr<folly::IOBuf> body)
+        : handler_(handler), body_(std::move(body)) {}
+
+    bool await_ready() const noexcept {
+      return !handler_.egressPaused_ || handler_.error_;
+    }
+
+    void await_suspend(std::experimental::coroutine_handle<> waiter) noexcept {
+      DCHECK(!handler_.writer_);
+      handler_.writer_ = waiter;
+    }
+
+    void await_resume() {
+      handler_.checkError();
+      if (body_) {
+        handler_.downstream_->sendBody(std::move(body_));
+      }
+    }
+
+    friend EgressAwaiter co_viaIfAsync(folly::Executor::KeepAlive<>,
+                                       EgressAwaiter awaiter) noexcept {
+      return awaiter;
+    }
+
+   private:
+    CoroRequestHandler& handler_;
+    std::unique_ptr<folly::IOBuf> body_;
+  };
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override {
+    auto evb = folly::EventBaseManager::get()->getExistingEventBase();
+    CHECK(evb);
+    running_ = true;
+    handleRequest(std::move(headers))
+      .scheduleOn(evb)
+      .start()
+      .via(evb)
+      .thenTry([this] (folly::Try<folly::Unit>&& result) {
+          running_ = false;
+          if (result.hasException() && !error_) {
+            LOG(ERROR) << "Request handler failed: "
+                       << folly::exceptionStr(result.exception());
+            if (!done_) {
+              downstream_->sendAbort();
+            }
+          }
+          maybeDelete();
+        });
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    body_.append(std::move(body));
+    if (!ingressPaused_ && body_.chainLength() > maxBufferedBody_) {
+      ingressPaused_ = true;
+      downstream_->pauseIngress();
+    }
+    resume(reader_);
+  }
+
+  void onUpgrade(UpgradeProtocol /*prot*/) noexcept override {}
+
+  void onEOM() noexcept override {
+    eom_ = true;
+    resume(reader_);
+  }
+
+  void requestComplete() noexcept override {
+    done_ = true;
+    maybeDelete();
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    done_ = true;
+    error_ = err;
+    resume(reader_);
+    resume(writer_);
+    maybeDelete();
+  }
+
+  void onEgressPaused() noexcept override {
+    egressPaused_ = true;
+  }
+
+  void onEgressResumed() noexcept override {
+    egressPaused_ = false;
+    resume(writer_);
+  }
+
+ private:
+  void resume(std::experimental::coroutine_handle<>& waiter) {
+    if (waiter) {
+      // Cleared first, the coroutine may wait again
+      auto handle = waiter;
+      waiter = nullptr;
+      handle.resume();
+    }
+  }
+
+  void checkError() const {
+    if (error_) {
+      Exception ex("Request failed: ", getErrorString(error_));
+      ex.setProxygenError(error_);
+      throw ex;
+    }
+  }
+
+  void resumeIngressIfPaused() {
+    if (ingressPaused_ && !done_) {
+      ingressPaused_ = false;
+      downstream_->resumeIngress();
+    }
+  }
+
+  void maybeDelete() {
+    if (done_ && !running_) {
+      delete this;
+    }
+  }
+
+  const size_t maxBufferedBody_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  std::experimental::coroutine_handle<> reader_;
+  std::experimental::coroutine_handle<> writer_;
+  ProxygenError error_{kErrorNone};
+  bool running_{false};
+  bool done_{false};
+  bool eom_{false};
+  bool ingressPaused_{false};
+  bool egressPaused_{false};
+};
+
+}
+
+#endif
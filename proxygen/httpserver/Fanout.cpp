@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/Fanout.h>
+
+#include <algorithm>
+
+namespace proxygen {
+
+Fanout::Fanout(folly::EventBase* evb,
+               const Options& options,
+               Callback* callback)
+    : evb_(evb), options_(options), callback_(callback) {
+}
+
+Fanout::~Fanout() {
+  cancelLoopCallback();
+}
+
+void Fanout::subscribe(ResponseHandler* subscriber) {
+  DCHECK(evb_->isInEventBaseThread());
+  if (index_.count(subscriber)) {
+    return;
+  }
+  subscribers_.push_back(std::make_unique<Subscriber>(subscriber));
+  index_.emplace(subscriber, subscribers_.back().get());
+}
+
+void Fanout::unsubscribe(ResponseHandler* subscriber) {
+  auto it = index_.find(subscriber);
+  if (it == index_.end()) {
+    return;
+  }
+  it->second->handler = nullptr;
+  it->second->held.move();
+  index_.erase(it);
+  numUnsubscribed_++;
+  // Amortized, and never under the loop in flush()
+  if (!delivering_ && numUnsubscribed_ > subscribers_.size() / 2) {
+    compact();
+  }
+}
+
+void Fanout::onEgressPaused(ResponseHandler* subscriber) {
+  auto it = index_.find(subscriber);
+  if (it != index_.end()) {
+    it->second->paused = true;
+  }
+}
+
+void Fanout::onEgressResumed(ResponseHandler* subscriber) {
+  auto it = index_.find(subscriber);
+  if (it == index_.end()) {
+    return;
+  }
+  auto& sub = *it->second;
+  sub.paused = false;
+  if (!sub.held.empty()) {
+    sub.handler->sendBody(sub.held.move());
+  }
+}
+
+void Fanout::publish(std::unique_ptr<folly::IOBuf> message) {
+  DCHECK(evb_->isInEventBaseThread());
+  if (!message || message->computeChainDataLength() == 0) {
+    return;
+  }
+  queue_.append(std::move(message));
+  if (!isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void Fanout::runLoopCallback() noexcept {
+  flush();
+}
+
+void Fanout::flush() {
+  cancelLoopCallback();
+  if (queue_.empty() || delivering_) {
+    return;
+  }
+  auto batch = queue_.move();
+  size_t length = batch->computeChainDataLength();
+  // Each clone costs an IOBuf per element of the chain, per subscriber
+  if (batch->isChained() && length <= kMaxCoalesceSize) {
+    batch->coalesce();
+  }
+
+  delivering_ = true;
+  std::vector<ResponseHandler*> dropped;
+  // Subscribers added from sendBody() wait for the next batch
+  for (size_t i = 0, n = subscribers_.size(); i < n; i++) {
+    auto& sub = *subscribers_[i];
+    if (!sub.handler) {
+      continue;
+    }
+    if (!sub.paused) {
+      sub.handler->sendBody(batch->clone());
+    } else if (sub.held.chainLength() + length <= options_.maxHeldBytes) {
+      sub.held.append(batch->clone());
+    } else {
+      dropped.push_back(sub.handler);
+      unsubscribe(sub.handler);
+    }
+  }
+  delivering_ = false;
+  if (numUnsubscribed_ > subscribers_.size() / 2) {
+    compact();
+  }
+
+  for (auto subscriber : dropped) {
+    callback_->onSubscriberDropped(subscriber);
+  }
+}
+
+void Fanout::compact() {
+  subscribers_.erase(
+      std::remove_if(subscribers_.begin(),
+                     subscribers_.end(),
+                     [](const std::unique_ptr<Subscriber>& sub) {
+                       return sub->handler == nullptr;
+                     }),
+      subscribers_.end());
+  numUnsubscribed_ = 0;
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <memory>
+#include <proxygen/httpserver/ResponseHandler.h>
+#include <unordered_map>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Fans messages out to the ResponseHandlers of subscribers, such as the
+ * exstreams of ExMessageHandlers, from the thread of their event base.
+ *
+ * The messages published in a loop of the event base are delivered together
+ * once its callbacks ran: each subscriber is sent the batch with a single
+ * sendBody(), of a clone of the same buffer, so that the payload is neither
+ * copied per subscriber nor framed per message.  The sessions, having had
+ * the body of all their transactions queued in the same loop, then write
+ * the frames of all of them at once.
+ *
+ * A subscriber whose egress is paused has its batches held, up to
+ * maxHeldBytes, past which it is dropped from the fanout and reported to
+ * the callback.
+ */
+class Fanout : private folly::EventBase::LoopCallback {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {}
+
+    /**
+     * subscriber fell too far behind and was unsubscribed, with what it was
+     * held dropped; typically to abort it.
+     */
+    virtual void onSubscriberDropped(ResponseHandler* subscriber) noexcept = 0;
+  };
+
+  struct Options {
+    size_t maxHeldBytes{1024 * 1024};
+  };
+
+  // Batches up to this size are coalesced, if chained, before the fanout
+  static constexpr size_t kMaxCoalesceSize = 64 * 1024;
+
+  Fanout(folly::EventBase* evb, const Options& options, Callback* callback);
+  ~Fanout() override;
+
+  Fanout(const Fanout&) = delete;
+  Fanout& operator=(const Fanout&) = delete;
+
+  // Delivers the messages published from now on to subscriber
+  void subscribe(ResponseHandler* subscriber);
+
+  /**
+   * Stops delivering to subscriber, dropping what it was held; at the
+   * latest from its handler's requestComplete() or onError().
+   */
+  void unsubscribe(ResponseHandler* subscriber);
+
+  // From the handlers' onEgressPaused() and onEgressResumed()
+  void onEgressPaused(ResponseHandler* subscriber);
+  void onEgressResumed(ResponseHandler* subscriber);
+
+  // Queues message for the end of the loop
+  void publish(std::unique_ptr<folly::IOBuf> message);
+
+  // Delivers what is queued without waiting for the end of the loop
+  void flush();
+
+  size_t getNumSubscribers() const {
+    return index_.size();
+  }
+
+  size_t getQueuedBytes() const {
+    return queue_.chainLength();
+  }
+
+ private:
+  struct Subscriber {
+    explicit Subscriber(ResponseHandler* h) : handler(h) {}
+
+    // Null once unsubscribed
+    ResponseHandler* handler;
+    folly::IOBufQueue held{folly::IOBufQueue::cacheChainLength()};
+    bool paused{false};
+  };
+
+  // folly::EventBase::LoopCallback
+  void runLoopCallback() noexcept override;
+
+  // Removes the unsubscribed from subscribers_
+  void compact();
+
+  folly::EventBase* evb_;
+  const Options options_;
+  Callback* callback_;
+  folly::IOBufQueue queue_{folly::IOBufQueue::cacheChainLength()};
+  std::vector<std::unique_ptr<Subscriber>> subscribers_;
+  std::unordered_map<ResponseHandler*, Subscriber*> index_;
+  size_t numUnsubscribed_{0};
+  bool delivering_{false};
+};
+
+}
@@ -97,6 +97,16 @@ class Filter : public RequestHandler, public ResponseHandler {
     downstream_->sendBody(std::move(body));
   }
 
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override {
+    downstream_->sendFileBody(std::move(file), offset, length);
+  }
+
+  bool spliceTunnel(folly::AsyncSocket& upstream) noexcept override {
+    return downstream_->spliceTunnel(upstream);
+  }
+
   void sendChunkTerminator() noexcept override {
     downstream_->sendChunkTerminator();
   }
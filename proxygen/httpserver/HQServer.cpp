@@ -0,0 +1,211 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/HQServer.h>
+
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <proxygen/httpserver/RequestHandlerAdaptor.h>
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPSessionController.h>
+#include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/server/QuicServer.h>
+#include <quic/server/QuicServerTransport.h>
+#include <quic/server/QuicSharedUDPSocketFactory.h>
+#include <thread>
+
+using folly::EventBase;
+using folly::SocketAddress;
+
+namespace proxygen {
+
+/**
+ * One per connection, deleting itself with its session.
+ */
+class HQServer::SessionController : public HTTPSessionController {
+ public:
+  SessionController(std::shared_ptr<HTTPServerOptions> options,
+                    bool useRFC9218Priorities)
+      : options_(std::move(options)),
+        useRFC9218Priorities_(useRFC9218Priorities) {}
+
+  HQSession* createSession() {
+    wangle::TransportInfo tinfo;
+    session_ = new HQDownstreamSession(options_->idleTimeout, this, tinfo,
+                                       nullptr);
+    if (useRFC9218Priorities_) {
+      session_->useRFC9218Priorities();
+    }
+    if (options_->supportsConnect) {
+      // Extended CONNECT (RFC 9220) for tunnels over HTTP/3 streams
+      session_->setEgressSettings(
+        {HTTPSetting(SettingsId::ENABLE_CONNECT_PROTOCOL, 1)});
+    }
+    return session_;
+  }
+
+  void startSession(std::shared_ptr<quic::QuicSocket> sock) {
+    session_->setSocket(std::move(sock));
+    session_->startNow();
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction& txn,
+                                            HTTPMessage* msg) override {
+    // As HTTPServerAcceptor::newHandler()
+    SocketAddress clientAddr, vipAddr;
+    txn.getPeerAddress(clientAddr);
+    txn.getLocalAddress(vipAddr);
+    msg->setClientAddress(clientAddr);
+    msg->setDstAddress(vipAddr);
+    // The first factory is the outermost filter, the last the application
+    RequestHandler* h = nullptr;
+    auto& factories = options_->handlerFactories;
+    for (auto it = factories.rbegin(); it != factories.rend(); ++it) {
+      h = (*it)->onRequest(h, msg);
+    }
+    return new RequestHandlerAdaptor(h);
+  }
+
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction*, const HTTPException&, const SocketAddress&) override {
+    return nullptr;
+  }
+
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction*, const SocketAddress&) override {
+    return nullptr;
+  }
+
+  void attachSession(HTTPSessionBase*) override {}
+
+  void detachSession(const HTTPSessionBase*) override {
+    delete this;
+  }
+
+ private:
+  std::shared_ptr<HTTPServerOptions> options_;
+  bool useRFC9218Priorities_;
+  HQSession* session_{nullptr};
+};
+
+class HQServer::TransportFactory : public quic::QuicServerTransportFactory {
+ public:
+  TransportFactory(std::shared_ptr<HTTPServerOptions> options,
+                   bool useRFC9218Priorities)
+      : options_(std::move(options)),
+        useRFC9218Priorities_(useRFC9218Priorities) {}
+
+  quic::QuicServerTransport::Ptr make(
+      EventBase* evb,
+      std::unique_ptr<folly::AsyncUDPSocket> socket,
+      const SocketAddress& /* peerAddr */,
+      std::shared_ptr<const fizz::server::FizzServerContext> ctx)
+      noexcept override {
+    auto controller = new SessionController(options_, useRFC9218Priorities_);
+    auto session = controller->createSession();
+    auto transport = quic::QuicServerTransport::make(
+      evb, std::move(socket), *session, std::move(ctx));
+    controller->startSession(transport);
+    return transport;
+  }
+
+ private:
+  std::shared_ptr<HTTPServerOptions> options_;
+  bool useRFC9218Priorities_;
+};
+
+quic::TransportSettings HQServer::getDefaultTransportSettings() {
+  quic::TransportSettings settings;
+  settings.batchingMode = quic::QuicBatchingMode::BATCHING_MODE_GSO;
+  settings.maxBatchSize = quic::kDefaultQuicMaxBatchSize;
+  return settings;
+}
+
+quic::TransportSettings HQServer::getPacedTransportSettings(
+    std::chrono::microseconds tickInterval) {
+  auto settings = getDefaultTransportSettings();
+  settings.pacingEnabled = true;
+  settings.pacingTimerTickInterval = tickInterval;
+  return settings;
+}
+
+HQServer::HQServer(Options options,
+                   std::shared_ptr<HTTPServerOptions> serverOptions)
+    : options_(std::move(options)),
+      serverOptions_(std::move(serverOptions)),
+      server_(quic::QuicServer::createQuicServer()) {
+  CHECK(options_.fizzContext) << "HQServer needs a fizz context";
+  server_->setCongestionControllerFactory(
+    std::make_shared<quic::DefaultCongestionControllerFactory>());
+  server_->setTransportSettings(options_.transportSettings);
+  server_->setQuicServerTransportFactory(
+    std::make_unique<TransportFactory>(serverOptions_,
+                                       options_.useRFC9218Priorities));
+  // A socket per worker, sharing the port
+  server_->setQuicUDPSocketFactory(
+    std::make_unique<quic::QuicSharedUDPSocketFactory>());
+  server_->setFizzContext(options_.fizzContext);
+  server_->setSupportedVersion(options_.versions);
+  if (!options_.healthCheckToken.empty()) {
+    server_->setHealthCheckToken(options_.healthCheckToken);
+  }
+}
+
+HQServer::~HQServer() {
+  stop();
+}
+
+void HQServer::start() {
+  CHECK(!workers_) << "HQServer already started";
+  auto threads = options_.threads;
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_ = std::make_unique<folly::IOThreadPoolExecutor>(
+    threads, std::make_shared<folly::NamedThreadFactory>("HQServerWorker"));
+  auto evbs = workers_->getAllEventBases();
+  std::vector<EventBase*> workerEvbs;
+  for (auto& evb : evbs) {
+    workerEvbs.push_back(evb.get());
+    evb->runInEventBaseThreadAndWait([&] {
+      for (auto& factory : serverOptions_->handlerFactories) {
+        factory->onServerStart(evb.get());
+      }
+    });
+  }
+  server_->initialize(options_.address, workerEvbs,
+                      true /* useDefaultTransport */);
+  server_->start();
+  server_->waitUntilInitialized();
+}
+
+void HQServer::stop() {
+  if (!workers_) {
+    return;
+  }
+  server_->shutdown();
+  for (auto& evb : workers_->getAllEventBases()) {
+    evb->runInEventBaseThreadAndWait([&] {
+      for (auto& factory : serverOptions_->handlerFactories) {
+        factory->onServerStop();
+      }
+    });
+  }
+  workers_->join();
+  workers_.reset();
+}
+
+SocketAddress HQServer::getAddress() const {
+  return server_->getAddress();
+}
+
+void HQServer::rejectNewConnections(bool reject) {
+  server_->rejectNewConnections(reject);
+}
+
+}
@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <fizz/server/FizzServerContext.h>
+#include <folly/SocketAddress.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <proxygen/httpserver/HTTPServerOptions.h>
+#include <quic/QuicConstants.h>
+#include <quic/state/TransportSettings.h>
+
+namespace quic {
+class QuicServer;
+}
+
+namespace proxygen {
+
+/**
+ * HTTP/3 (and h1q) server, running the handler chains of HTTPServerOptions
+ * on QUIC connections.
+ *
+ * The workers share the UDP port: each has a socket of its own bound with
+ * SO_REUSEPORT, and the server routes the packets a worker receives for
+ * another's connection by the worker ID in their connection IDs.
+ *
+ * To serve HTTP/1.x, HTTP/2 and HTTP/3 with the same handlers, construct it
+ * with HTTPServer::getOptions(), which include the filters HTTPServer adds.
+ */
+class HQServer final {
+ public:
+  struct Options {
+    folly::SocketAddress address;
+    // Worker threads, 0 for one per CPU
+    size_t threads{0};
+    std::shared_ptr<const fizz::server::FizzServerContext> fizzContext;
+    // By default batched writes with UDP GSO (mvfst falls back to single
+    // writes when the kernel lacks it), and no pacing
+    quic::TransportSettings transportSettings{getDefaultTransportSettings()};
+    std::vector<quic::QuicVersion> versions{quic::QuicVersion::MVFST};
+    // Packets with this payload get a health check reply, if not empty
+    std::string healthCheckToken;
+    // Schedule the responses by the RFC 9218 Priority header and PRIORITY
+    // frames of the requests (RFC9218PriorityQueue)
+    bool useRFC9218Priorities{true};
+  };
+
+  static quic::TransportSettings getDefaultTransportSettings();
+
+  /**
+   * Transport settings with pacing from the congestion controller, with a
+   * timer of the given resolution.
+   */
+  static quic::TransportSettings getPacedTransportSettings(
+      std::chrono::microseconds tickInterval);
+
+  HQServer(Options options, std::shared_ptr<HTTPServerOptions> serverOptions);
+  ~HQServer();
+
+  /**
+   * Starts the workers, calling onServerStart() of the handler factories on
+   * each, and returns once they are receiving.
+   */
+  void start();
+
+  /**
+   * Closes the connections, calls onServerStop() of the handler factories
+   * on each worker, and joins them.
+   */
+  void stop();
+
+  /**
+   * The address bound, with the port chosen if it was 0.
+   */
+  folly::SocketAddress getAddress() const;
+
+  /**
+   * New connections get a reset, for draining the server.
+   */
+  void rejectNewConnections(bool reject);
+
+ private:
+  class SessionController;
+  class TransportFactory;
+
+  Options options_;
+  std::shared_ptr<HTTPServerOptions> serverOptions_;
+  std::shared_ptr<quic::QuicServer> server_;
+  std::unique_ptr<folly::IOThreadPoolExecutor> workers_;
+};
+
+}
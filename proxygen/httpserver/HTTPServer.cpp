@@ -10,14 +10,41 @@
 
 #include <proxygen/httpserver/HTTPServer.h>
 
+#include <algorithm>
+#include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/experimental/FunctionScheduler.h>
+#include <folly/String.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/system/ThreadName.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <proxygen/httpserver/HTTPServerAcceptor.h>
+#include <proxygen/httpserver/RecycledRequestHandler.h>
 #include <proxygen/httpserver/SignalHandler.h>
+#include <proxygen/httpserver/SocketTakeover.h>
+#include <proxygen/httpserver/filters/EarlyDataFilter.h>
 #include <proxygen/httpserver/filters/RejectConnectFilter.h>
+#include <proxygen/httpserver/filters/RequestDecompressionFilter.h>
+#include <proxygen/httpserver/filters/ResponseCacheFilter.h>
 #include <proxygen/httpserver/filters/ZlibServerFilter.h>
+#include <wangle/bootstrap/ServerSocketFactory.h>
 #include <wangle/ssl/SSLContextManager.h>
+#include <limits>
+
+#ifdef __linux__
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef __has_include
+#if __has_include(<liburing.h>) && \
+    __has_include(<folly/experimental/io/IoUringBackend.h>)
+#include <folly/experimental/io/IoUringBackend.h>
+#define PROXYGEN_HAVE_IO_URING_BACKEND 1
+#endif
+#endif
 
 using folly::AsyncServerSocket;
 using folly::EventBase;
@@ -28,16 +55,206 @@ using folly::ThreadPoolExecutor;
 
 namespace proxygen {
 
+namespace {
+
+#ifdef PROXYGEN_HAVE_IO_URING_BACKEND
+// Submission queue entries of each EventBase, and the most to submit at once
+constexpr size_t kIoUringCapacity = 4096;
+constexpr size_t kIoUringMaxSubmit = 128;
+#endif
+
+// How often the busy sessions of a worker being stopped are polled
+constexpr std::chrono::milliseconds kWorkerDrainPollInterval{10};
+
+// Returns nullptr if io_uring can not be used
+std::unique_ptr<EventBaseManager> makeIoUringEventBaseManager() {
+#ifdef PROXYGEN_HAVE_IO_URING_BACKEND
+  if (folly::IoUringBackend::isAvailable()) {
+    EventBase::Options evbOptions;
+    evbOptions.setBackendFactory([] {
+      folly::IoUringBackend::Options options;
+      options.setCapacity(kIoUringCapacity).setMaxSubmit(kIoUringMaxSubmit);
+      return std::make_unique<folly::IoUringBackend>(options);
+    });
+    return std::make_unique<EventBaseManager>(evbOptions);
+  }
+#endif
+  return nullptr;
+}
+
+#ifdef __linux__
+void pinCurrentThread(const std::vector<size_t>& cpus) {
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpuSet);
+    }
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+    LOG(WARNING) << "Can't pin a worker thread to CPUs "
+                 << folly::join(",", cpus);
+  }
+}
+
+// Parses a sysfs CPU list, e.g. "0-15,32-47"
+std::vector<size_t> getNumaNodeCpus(size_t node) {
+  std::vector<size_t> cpus;
+  std::string cpuList;
+  auto path = folly::to<std::string>(
+    "/sys/devices/system/node/node", node, "/cpulist");
+  if (!folly::readFile(path.c_str(), cpuList)) {
+    LOG(WARNING) << "Can't read the CPUs of NUMA node " << node;
+    return cpus;
+  }
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', folly::trimWhitespace(cpuList), ranges, true);
+  for (auto range : ranges) {
+    folly::StringPiece first;
+    folly::StringPiece last;
+    if (!folly::split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto from = folly::tryTo<size_t>(first);
+    auto to = folly::tryTo<size_t>(last);
+    if (!from.hasValue() || !to.hasValue()) {
+      continue;
+    }
+    for (auto cpu = *from; cpu <= *to && cpu < CPU_SETSIZE; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// The CPUs to pin worker i to, empty to leave it to the OS
+std::vector<size_t> getWorkerCpus(const HTTPServerOptions& options,
+                                  size_t i) {
+  if (!options.workerCpus.empty()) {
+    return {options.workerCpus[i % options.workerCpus.size()]};
+  }
+  if (!options.workerNumaNodes.empty()) {
+    return getNumaNodeCpus(
+      options.workerNumaNodes[i % options.workerNumaNodes.size()]);
+  }
+  if (options.reusePortPerWorker && options.steerToIncomingCpu) {
+    return {i % std::max(1u, std::thread::hardware_concurrency())};
+  }
+  return {};
+}
+
+// Pins the thread of the i-th worker evb, see getWorkerCpus()
+void pinWorker(const HTTPServerOptions& options, EventBase& evb, size_t i) {
+  auto cpus = getWorkerCpus(options, i);
+  if (!cpus.empty()) {
+    evb.runInEventBaseThreadAndWait([&cpus] {
+      pinCurrentThread(cpus);
+    });
+  }
+}
+
+// The CPU the current thread is pinned to, or -1
+int getPinnedCpu() {
+  cpu_set_t cpus;
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0 ||
+      CPU_COUNT(&cpus) != 1) {
+    return -1;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &cpus)) {
+      return cpu;
+    }
+  }
+  return -1;
+}
+#endif
+
+// TCP_DEFER_ACCEPT on the listening sockets of an address
+void setDeferAccept(const AsyncServerSocket& socket,
+                    std::chrono::seconds timeout) {
+#if defined(__linux__) && defined(TCP_DEFER_ACCEPT)
+  int seconds = timeout.count();
+  for (auto fd : socket.getNetworkSockets()) {
+    if (::setsockopt(fd.toFd(), IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds,
+                     sizeof(seconds)) != 0) {
+      LOG(WARNING) << "Can't set TCP_DEFER_ACCEPT=" << seconds;
+    }
+  }
+#else
+  (void)socket;
+  LOG(WARNING) << "TCP_DEFER_ACCEPT is not supported, ignoring "
+               << timeout.count() << "s";
+#endif
+}
+
+/**
+ * Makes the listening sockets of reusePortPerWorker, one per worker created
+ * on the worker itself, and only gives their connections to the acceptor of
+ * the same worker.
+ */
+class PerWorkerSocketFactory : public wangle::AsyncServerSocketFactory {
+ public:
+  explicit PerWorkerSocketFactory(bool steerToIncomingCpu)
+      : steerToIncomingCpu_(steerToIncomingCpu) {}
+
+  std::shared_ptr<folly::AsyncSocketBase> newSocket(
+      folly::SocketAddress address,
+      int backlog,
+      bool reuse,
+      const wangle::ServerSocketConfig& config) override {
+    auto socket = wangle::AsyncServerSocketFactory::newSocket(
+      address, backlog, reuse, config);
+#if defined(__linux__) && defined(SO_INCOMING_CPU)
+    int cpu = steerToIncomingCpu_ ? getPinnedCpu() : -1;
+    if (cpu >= 0) {
+      auto serverSocket =
+        std::dynamic_pointer_cast<AsyncServerSocket>(socket);
+      for (auto fd : serverSocket->getNetworkSockets()) {
+        if (::setsockopt(fd.toFd(), SOL_SOCKET, SO_INCOMING_CPU, &cpu,
+                         sizeof(cpu)) != 0) {
+          LOG(WARNING) << "Can't set SO_INCOMING_CPU=" << cpu;
+        }
+      }
+    }
+#endif
+    return socket;
+  }
+
+  void addAcceptCB(std::shared_ptr<folly::AsyncSocketBase> socket,
+                   wangle::Acceptor* callback,
+                   EventBase* base) override {
+    if (base == socket->getEventBase()) {
+      wangle::AsyncServerSocketFactory::addAcceptCB(socket, callback, base);
+    }
+  }
+
+  // wangle removes the callbacks without their EventBase
+  void removeAcceptCB(std::shared_ptr<folly::AsyncSocketBase> socket,
+                      wangle::Acceptor* callback,
+                      EventBase* base) override {
+    if (callback->getEventBase() == socket->getEventBase()) {
+      wangle::AsyncServerSocketFactory::removeAcceptCB(socket, callback, base);
+    }
+  }
+
+ private:
+  const bool steerToIncomingCpu_;
+};
+
+}
+
 class AcceptorFactory : public wangle::AcceptorFactory {
  public:
   AcceptorFactory(std::shared_ptr<HTTPServerOptions> options,
                   std::shared_ptr<HTTPCodecFactory> codecFactory,
                   AcceptorConfiguration config,
-                  HTTPSession::InfoCallback* sessionInfoCb) :
+                  HTTPSession::InfoCallback* sessionInfoCb,
+                  std::shared_ptr<HTTPSessionRebalancer> rebalancer) :
       options_(options),
       codecFactory_(codecFactory),
       config_(config),
-      sessionInfoCb_(sessionInfoCb) {}
+      sessionInfoCb_(sessionInfoCb),
+      rebalancer_(rebalancer) {}
   std::shared_ptr<wangle::Acceptor> newAcceptor(
       folly::EventBase* eventBase) override {
     auto acc = std::shared_ptr<HTTPServerAcceptor>(
@@ -46,6 +263,12 @@ class AcceptorFactory : public wangle::AcceptorFactory {
       acc->setSessionInfoCallback(sessionInfoCb_);
     }
     acc->init(nullptr, eventBase);
+    if (rebalancer_) {
+      acc->setSessionRebalancer(rebalancer_);
+    }
+    if (options_->adaptiveStreamLimit) {
+      acc->setAdaptiveStreamLimit(options_->adaptiveStreamLimitOptions);
+    }
     return acc;
   }
 
@@ -54,11 +277,16 @@ class AcceptorFactory : public wangle::AcceptorFactory {
   std::shared_ptr<HTTPCodecFactory> codecFactory_;
   AcceptorConfiguration config_;
   HTTPSession::InfoCallback* sessionInfoCb_;
+  std::shared_ptr<HTTPSessionRebalancer> rebalancer_;
 };
 
 HTTPServer::HTTPServer(HTTPServerOptions options):
     options_(std::make_shared<HTTPServerOptions>(std::move(options))) {
 
+  if (options_->recycleRequestHandlers) {
+    setRequestHandlerRecycling(true);
+  }
+
   // Insert a filter to fail all the CONNECT request, if required
   if (!options_->supportsConnect) {
     options_->handlerFactories.insert(
@@ -66,15 +294,68 @@ HTTPServer::HTTPServer(HTTPServerOptions options):
         std::make_unique<RejectConnectFilterFactory>());
   }
 
-  // Add Content Compression filter (gzip), if needed. Should be
-  // final filter
+  // Cache the uncompressed responses, compressing them on hits
+  if (options_->responseCache) {
+    options_->handlerFactories.insert(
+        options_->handlerFactories.begin(),
+        std::make_unique<ResponseCacheFilterFactory>(options_->responseCache));
+  }
+
+  // Add Content Compression filter, if needed. Should be final filter
   if (options_->enableContentCompression) {
+    std::vector<ZlibServerFilterFactory::Encoding> encodings;
+    for (auto type : options_->contentCompressionEncodings) {
+      auto level = options_->contentCompressionLevel;
+      if (type == CompressionType::BROTLI) {
+        level = options_->contentCompressionBrotliLevel;
+      } else if (type == CompressionType::ZSTD) {
+        level = options_->contentCompressionZstdLevel;
+      }
+      encodings.emplace_back(type, level);
+    }
+    auto compressionFactory = std::make_unique<ZlibServerFilterFactory>(
+      encodings,
+      options_->contentCompressionMinimumSize,
+      options_->contentCompressionTypes);
+    compressionFactory->setZstdDictionary(
+      options_->contentCompressionZstdDictionary);
+    compressionFactory->setLevelSelector(
+      options_->contentCompressionLevelSelector);
+    if (options_->contentCompressionExecutor) {
+      compressionFactory->setOffloadExecutor(
+        options_->contentCompressionExecutor,
+        options_->contentCompressionOffloadMinimumSize);
+    }
+    if (options_->contentCompressionCacheSize > 0) {
+      compressionFactory->setCompressedBodyCache(
+        std::make_shared<CompressedBodyCache>(
+          options_->contentCompressionCacheSize));
+    }
+    options_->handlerFactories.insert(
+        options_->handlerFactories.begin(), std::move(compressionFactory));
+  }
+
+  // Decompress request bodies before anything else sees them
+  if (options_->enableRequestDecompression) {
+    RequestDecompressionFilter::Options decompressionOptions;
+    decompressionOptions.maxChunkSize =
+      options_->requestDecompressionChunkSize;
+    decompressionOptions.maxRatio = options_->requestDecompressionMaxRatio;
+    decompressionOptions.maxSize = options_->requestDecompressionMaxSize;
     options_->handlerFactories.insert(
         options_->handlerFactories.begin(),
-        std::make_unique<ZlibServerFilterFactory>(
-          options_->contentCompressionLevel,
-          options_->contentCompressionMinimumSize,
-          options_->contentCompressionTypes));
+        std::make_unique<RequestDecompressionFilterFactory>(
+          decompressionOptions));
+  }
+
+  // Hold or reject replayable requests before anything else runs them
+  if (options_->enableEarlyDataPolicy) {
+    EarlyDataFilter::Options earlyDataOptions;
+    earlyDataOptions.allowed = options_->earlyDataAllowed;
+    earlyDataOptions.rejectUnsafe = options_->rejectUnsafeEarlyData;
+    options_->handlerFactories.insert(
+        options_->handlerFactories.begin(),
+        std::make_unique<EarlyDataFilterFactory>(earlyDataOptions));
   }
 }
 
@@ -90,6 +371,22 @@ void HTTPServer::bind(std::vector<IPConfig> const& addrs) {
   addresses_ = addrs;
 }
 
+// Runs before the bootstrap's observer drops the connections of a worker
+// being stopped, see HTTPServer::setNumWorkers()
+class WorkerStopObserver : public ThreadPoolExecutor::Observer {
+ public:
+  explicit WorkerStopObserver(std::function<void(EventBase*)> onStop)
+      : onStop_(std::move(onStop)) {}
+
+  void threadStarted(ThreadPoolExecutor::ThreadHandle* /*h*/) override {}
+  void threadStopped(ThreadPoolExecutor::ThreadHandle* h) override {
+    onStop_(IOThreadPoolExecutor::getEventBase(h));
+  }
+
+ private:
+  std::function<void(EventBase*)> onStop_;
+};
+
 class HandlerCallbacks : public ThreadPoolExecutor::Observer {
  public:
   explicit HandlerCallbacks(std::shared_ptr<HTTPServerOptions> options) : options_(options) {}
@@ -116,45 +413,310 @@ class HandlerCallbacks : public ThreadPoolExecutor::Observer {
 };
 
 
-void HTTPServer::start(std::function<void()> onSuccess,
-                       std::function<void(std::exception_ptr)> onError) {
-  mainEventBase_ = EventBaseManager::get()->getEventBase();
+void HTTPServer::startWorkers() {
+  EventBaseManager* ioEventBaseManager = EventBaseManager::get();
+  if (options_->useIoUringBackend) {
+    if (!ioUringEventBaseManager_) {
+      ioUringEventBaseManager_ = makeIoUringEventBaseManager();
+    }
+    if (ioUringEventBaseManager_) {
+      ioEventBaseManager = ioUringEventBaseManager_.get();
+    } else {
+      LOG(WARNING) << "io_uring is not available, using the default "
+                   << "event backend";
+    }
+  }
 
-  auto accExe = std::make_shared<IOThreadPoolExecutor>(1);
   auto exe = std::make_shared<IOThreadPoolExecutor>(options_->threads,
-    std::make_shared<folly::NamedThreadFactory>("HTTPSrvExec"));
+    std::make_shared<folly::NamedThreadFactory>("HTTPSrvExec"),
+    ioEventBaseManager);
+  // The workers accept their own connections with reusePortPerWorker
+  bool perWorkerSockets = options_->reusePortPerWorker &&
+    options_->preboundSockets_.empty();
+  std::shared_ptr<PerWorkerSocketFactory> perWorkerSocketFactory;
+  std::shared_ptr<IOThreadPoolExecutor> accExe;
+  if (perWorkerSockets) {
+    perWorkerSocketFactory = std::make_shared<PerWorkerSocketFactory>(
+      options_->steerToIncomingCpu);
+    accExe = exe;
+  } else {
+    accExe = std::make_shared<IOThreadPoolExecutor>(1,
+      std::make_shared<folly::NamedThreadFactory>("IOThreadPool"),
+      ioEventBaseManager);
+  }
+#ifdef __linux__
+  // Pinned before the acceptors and handler factories allocate their thread
+  // local state, which the default memory policy then places on the node
+  // the worker runs on
+  auto evbs = exe->getAllEventBases();
+  FOR_EACH_RANGE (i, 0, evbs.size()) {
+    pinWorker(*options_, *evbs[i], i);
+  }
+#endif
   auto exeObserver = std::make_shared<HandlerCallbacks>(options_);
   // Observer has to be set before bind(), so onServerStart() callbacks run
   exe->addObserver(exeObserver);
+  // Before the bootstrap's, added by group()
+  exe->addObserver(std::make_shared<WorkerStopObserver>(
+    [this] (EventBase* evb) {
+      if (resizingWorkers_) {
+        moveSessionsOff(evb);
+      }
+    }));
+  workers_ = exe;
 
-  try {
-    FOR_EACH_RANGE (i, 0, addresses_.size()) {
-      auto codecFactory = addresses_[i].codecFactory;
-      auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
-      auto factory = std::make_shared<AcceptorFactory>(
-          options_,
-          codecFactory,
-          accConfig,
-          sessionInfoCb_);
-      bootstrap_.push_back(
-          wangle::ServerBootstrap<wangle::DefaultPipeline>());
-      bootstrap_[i].childHandler(factory);
+  FOR_EACH_RANGE (i, 0, addresses_.size()) {
+    auto codecFactory = addresses_[i].codecFactory;
+    auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
+    accConfig.handshakeOffloadPool = handshakeOffloadPool_;
+    // Only moving sessions between the acceptors of the same address, which
+    // have the same configuration
+    std::shared_ptr<HTTPSessionRebalancer> rebalancer;
+    if (options_->rebalanceSessions && options_->threads > 1) {
+      rebalancer = std::make_shared<HTTPSessionRebalancer>(
+        options_->rebalanceOptions);
+    }
+    rebalancers_.push_back(rebalancer);
+    auto factory = std::make_shared<AcceptorFactory>(
+        options_,
+        codecFactory,
+        accConfig,
+        sessionInfoCb_,
+        rebalancer);
+    bootstrap_.push_back(
+        wangle::ServerBootstrap<wangle::DefaultPipeline>());
+    bootstrap_[i].childHandler(factory);
+    if (accConfig.enableTCPFastOpen) {
+      // We need to do this because wangle's bootstrap has 2 acceptor configs
+      // and the socketConfig gets passed to the SocketFactory. The number of
+      // configs should really be one, and when that happens, we can remove
+      // this code path.
+      bootstrap_[i].socketConfig.enableTCPFastOpen = true;
+      bootstrap_[i].socketConfig.fastOpenQueueSize =
+          accConfig.fastOpenQueueSize;
+    }
+    if (perWorkerSockets) {
+      bootstrap_[i].setReusePort(true);
+      bootstrap_[i].channelFactory(perWorkerSocketFactory);
+    }
+    bootstrap_[i].group(accExe, exe);
+    if (options_->preboundSockets_.size() > 0) {
+      bootstrap_[i].bind(std::move(options_->preboundSockets_[i]));
+    } else {
+      bootstrap_[i].bind(addresses_[i].address);
+    }
+    if (addresses_[i].deferAcceptTimeout.count() > 0) {
+      for (auto& socket : bootstrap_[i].getSockets()) {
+        auto serverSocket =
+          std::dynamic_pointer_cast<AsyncServerSocket>(socket);
+        if (serverSocket) {
+          setDeferAccept(*serverSocket, addresses_[i].deferAcceptTimeout);
+        }
+      }
+    }
+    if (rebalancer) {
+      rebalancer->start();
+    }
+  }
+  perWorkerSockets_ = perWorkerSockets;
+}
+
+void HTTPServer::setNumWorkers(size_t threads,
+                               std::chrono::milliseconds drainTimeout) {
+  if (threads == 0) {
+    throw std::invalid_argument("An HTTPServer needs a worker");
+  }
+  if (!workers_ || perWorkerSockets_) {
+    throw std::logic_error(
+      "Only the workers sharing the listening sockets can be resized");
+  }
+  std::lock_guard<std::mutex> guard(resizeMutex_);
+  auto evbs = workers_->getAllEventBases();
+  size_t current = evbs.size();
+  if (threads < current) {
+    drainTimeout_ = drainTimeout;
+    stoppedWorkers_.clear();
+    resizingWorkers_ = true;
+    SCOPE_EXIT {
+      resizingWorkers_ = false;
+    };
+    workers_->setNumThreads(threads);
+    return;
+  }
+  if (threads == current) {
+    return;
+  }
+
+  // The executor's observers start the acceptors and handler factories
+  workers_->setNumThreads(threads);
+#ifdef __linux__
+  // Unlike at start(), after their thread local state was allocated
+  std::vector<EventBase*> existing;
+  for (auto& evb : evbs) {
+    existing.push_back(&*evb);
+  }
+  size_t next = current;
+  for (auto& evb : workers_->getAllEventBases()) {
+    if (std::find(existing.begin(), existing.end(), &*evb) ==
+        existing.end()) {
+      pinWorker(*options_, *evb, next++);
+    }
+  }
+#endif
+  // The new acceptors have the seeds of the configuration
+  if (ticketSeeds_) {
+    updateTicketSeeds(*ticketSeeds_);
+  }
+}
+
+size_t HTTPServer::getNumWorkers() const {
+  return workers_ ? workers_->numThreads() : 0;
+}
+
+void HTTPServer::moveSessionsOff(EventBase* evb) {
+  auto deadline = std::chrono::steady_clock::now() + drainTimeout_;
+  stoppedWorkers_.push_back(evb);
+  while (true) {
+    size_t remaining = 0;
+    for (auto& bootstrap : bootstrap_) {
+      HTTPSessionAcceptor* from = nullptr;
+      std::vector<HTTPSessionAcceptor*> to;
+      bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
+        auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+        if (!sessionAcceptor || !sessionAcceptor->getEventBase()) {
+          return;
+        }
+        auto acceptorEvb = sessionAcceptor->getEventBase();
+        if (acceptorEvb == evb) {
+          from = sessionAcceptor;
+        } else if (std::find(stoppedWorkers_.begin(), stoppedWorkers_.end(),
+                             acceptorEvb) == stoppedWorkers_.end()) {
+          to.push_back(sessionAcceptor);
+        }
+      });
+      if (!from || to.empty()) {
+        continue;
+      }
+      // Spread over the remaining workers, the rebalancer evens them out
+      // later if enabled.  The workers stopped next in this resize still
+      // run the sessions they're handed until they're moved on again.
+      evb->runImmediatelyOrRunInEventBaseThreadAndWait([&] {
+        auto sessions = from->releaseIdleSessions(
+          std::numeric_limits<size_t>::max());
+        FOR_EACH_RANGE (i, 0, sessions.size()) {
+          auto acceptor = to[i % to.size()];
+          auto session = sessions[i];
+          acceptor->getEventBase()->runInEventBaseThread(
+            [acceptor, session] {
+              acceptor->adoptSession(session);
+            });
+        }
+        remaining += from->getNumConnections();
+      });
+    }
+    if (remaining == 0) {
+      return;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      LOG(WARNING) << "Dropping " << remaining << " connections still busy "
+                   << "on a worker being stopped";
+      return;
+    }
+    // The busy sessions are moved once their transactions complete
+    std::this_thread::sleep_for(kWorkerDrainPollInterval);
+  }
+}
+
+void HTTPServer::startInline() {
+  FOR_EACH_RANGE (i, 0, addresses_.size()) {
+    auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
+    accConfig.handshakeOffloadPool = handshakeOffloadPool_;
+    AsyncServerSocket::UniquePtr socket;
+    if (options_->preboundSockets_.size() > 0) {
+      socket = std::move(options_->preboundSockets_[i]);
+      socket->attachEventBase(mainEventBase_);
+    } else {
+      socket.reset(new AsyncServerSocket(mainEventBase_));
       if (accConfig.enableTCPFastOpen) {
-        // We need to do this because wangle's bootstrap has 2 acceptor configs
-        // and the socketConfig gets passed to the SocketFactory. The number of
-        // configs should really be one, and when that happens, we can remove
-        // this code path.
-        bootstrap_[i].socketConfig.enableTCPFastOpen = true;
-        bootstrap_[i].socketConfig.fastOpenQueueSize =
-            accConfig.fastOpenQueueSize;
+        socket->setTFOEnabled(true, accConfig.fastOpenQueueSize);
       }
-      bootstrap_[i].group(accExe, exe);
-      if (options_->preboundSockets_.size() > 0) {
-        bootstrap_[i].bind(std::move(options_->preboundSockets_[i]));
-      } else {
-        bootstrap_[i].bind(addresses_[i].address);
+      socket->bind(addresses_[i].address);
+      // Like the bootstrap, report the port bound
+      socket->getAddress(&addresses_[i].address);
+    }
+    socket->listen(accConfig.acceptBacklog);
+    if (addresses_[i].deferAcceptTimeout.count() > 0) {
+      setDeferAccept(*socket, addresses_[i].deferAcceptTimeout);
+    }
+    inlineSockets_.push_back(std::move(socket));
+  }
+
+  for (auto& factory: options_->handlerFactories) {
+    factory->onServerStart(mainEventBase_);
+  }
+  FOR_EACH_RANGE (i, 0, addresses_.size()) {
+    auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
+    accConfig.handshakeOffloadPool = handshakeOffloadPool_;
+    auto acceptor = HTTPServerAcceptor::make(accConfig, *options_,
+                                             addresses_[i].codecFactory);
+    if (sessionInfoCb_) {
+      acceptor->setSessionInfoCallback(sessionInfoCb_);
+    }
+    // The acceptor is the socket's accept callback on the same EventBase,
+    // so the connections are handed to it directly
+    acceptor->init(inlineSockets_[i].get(), mainEventBase_);
+    inlineSockets_[i]->startAccepting();
+    inlineAcceptors_.push_back(std::move(acceptor));
+  }
+}
+
+void HTTPServer::stopInline() {
+  if (inlineSockets_.empty()) {
+    return;
+  }
+  mainEventBase_->runImmediatelyOrRunInEventBaseThreadAndWait([this] {
+    // Like the workers stopping, drop the remaining connections
+    bool started = !inlineAcceptors_.empty();
+    for (auto& acceptor : inlineAcceptors_) {
+      acceptor->dropAllConnections();
+    }
+    inlineAcceptors_.clear();
+    inlineSockets_.clear();
+    if (started) {
+      for (auto& factory: options_->handlerFactories) {
+        factory->onServerStop();
       }
     }
+  });
+}
+
+void HTTPServer::start(std::function<void()> onSuccess,
+                       std::function<void(std::exception_ptr)> onError) {
+  mainEventBase_ = EventBaseManager::get()->getEventBase();
+  if (options_->handshakeOffloadThreads > 0 && !handshakeOffloadPool_) {
+    HandshakeOffloadPool::Options offloadOptions;
+    offloadOptions.numThreads = options_->handshakeOffloadThreads;
+    offloadOptions.maxQueueDepth = options_->handshakeOffloadMaxQueueDepth;
+    handshakeOffloadPool_ =
+      std::make_shared<HandshakeOffloadPool>(offloadOptions);
+  }
+
+  try {
+    if (options_->threads == 0) {
+      startInline();
+    } else {
+      startWorkers();
+    }
+    resumeTakenConnections();
+    if (options_->ticketSeedProvider) {
+      ticketSeeds_ = options_->ticketSeedProvider->getSeeds();
+      ticketSeedScheduler_ = std::make_unique<folly::FunctionScheduler>();
+      ticketSeedScheduler_->setThreadName("ticket_seeds");
+      ticketSeedScheduler_->addFunction([this] { refreshTicketSeeds(); },
+                                        options_->ticketSeedRefreshInterval,
+                                        "ticket_seeds");
+      ticketSeedScheduler_->start();
+    }
   } catch (const std::exception& ex) {
     stop();
 
@@ -188,14 +750,31 @@ void HTTPServer::stopListening() {
   for (auto& bootstrap : bootstrap_) {
     bootstrap.stop();
   }
+  if (!inlineSockets_.empty() && mainEventBase_) {
+    mainEventBase_->runImmediatelyOrRunInEventBaseThreadAndWait([this] {
+      for (auto& socket : inlineSockets_) {
+        socket->stopAccepting();
+      }
+    });
+  }
 }
 
 void HTTPServer::stop() {
+  // Joins its thread, before the acceptors it updates go away
+  ticketSeedScheduler_.reset();
   stopListening();
 
+  for (auto& rebalancer : rebalancers_) {
+    if (rebalancer) {
+      rebalancer->stop();
+    }
+  }
+
   for (auto& bootstrap : bootstrap_) {
     bootstrap.join();
   }
+  workers_.reset();
+  stopInline();
 
   if (signalHandler_) {
     signalHandler_.reset();
@@ -217,22 +796,30 @@ const std::vector<const folly::AsyncSocketBase*>
       sockets.push_back(bootstrapSockets[j].get());
     }
   }
+  for (auto& socket : inlineSockets_) {
+    sockets.push_back(socket.get());
+  }
 
   return sockets;
 }
 
 int HTTPServer::getListenSocket() const {
-  if (bootstrap_.size() == 0) {
-    return -1;
-  }
+  const folly::AsyncServerSocket* serverSocket = nullptr;
+  if (!inlineSockets_.empty()) {
+    serverSocket = inlineSockets_[0].get();
+  } else {
+    if (bootstrap_.size() == 0) {
+      return -1;
+    }
 
-  auto& bootstrapSockets = bootstrap_[0].getSockets();
-  if (bootstrapSockets.size() == 0) {
-    return -1;
-  }
+    auto& bootstrapSockets = bootstrap_[0].getSockets();
+    if (bootstrapSockets.size() == 0) {
+      return -1;
+    }
 
-  auto serverSocket =
-      std::dynamic_pointer_cast<folly::AsyncServerSocket>(bootstrapSockets[0]);
+    serverSocket = dynamic_cast<const folly::AsyncServerSocket*>(
+      bootstrapSockets[0].get());
+  }
   auto socketFds = serverSocket->getNetworkSockets();
   if (socketFds.size() == 0) {
     return -1;
@@ -243,6 +830,15 @@ int HTTPServer::getListenSocket() const {
 
 
 void HTTPServer::updateTLSCredentials() {
+  if (!inlineAcceptors_.empty()) {
+    mainEventBase_->runInEventBaseThread([this] {
+      for (auto& acceptor : inlineAcceptors_) {
+        if (acceptor->isSSL()) {
+          acceptor->resetSSLContextConfigs();
+        }
+      }
+    });
+  }
   for (auto& bootstrap : bootstrap_) {
     bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
       if (!acceptor || !acceptor->isSSL()) {
@@ -259,7 +855,192 @@ void HTTPServer::updateTLSCredentials() {
   }
 }
 
+void HTTPServer::drainGradually(std::chrono::milliseconds window) {
+  if (!inlineAcceptors_.empty() && mainEventBase_) {
+    mainEventBase_->runInEventBaseThread([this, window] {
+      for (auto& acceptor : inlineAcceptors_) {
+        acceptor->drainGradually(window);
+      }
+    });
+  }
+  for (auto& bootstrap : bootstrap_) {
+    bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
+      auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+      if (!sessionAcceptor || !sessionAcceptor->getEventBase()) {
+        return;
+      }
+      sessionAcceptor->getEventBase()->runInEventBaseThread(
+        [sessionAcceptor, window] {
+          sessionAcceptor->drainGradually(window);
+        });
+    });
+  }
+}
+
+HTTPSessionAcceptor::DrainProgress HTTPServer::getDrainProgress() const {
+  HTTPSessionAcceptor::DrainProgress total;
+  total.finished = true;
+  auto add = [&total] (const HTTPSessionAcceptor& acceptor) {
+    auto progress = acceptor.getDrainProgress();
+    total.drained += progress.drained;
+    total.pending += progress.pending;
+    total.finished = total.finished && progress.finished;
+  };
+  for (auto& acceptor : inlineAcceptors_) {
+    add(*acceptor);
+  }
+  for (auto& bootstrap : bootstrap_) {
+    bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
+      auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+      if (sessionAcceptor) {
+        add(*sessionAcceptor);
+      }
+    });
+  }
+  return total;
+}
+
+void HTTPServer::handOverSockets(int unixFd, bool idleConnections) {
+  // The first server socket of each address, they can have several with
+  // reusePortPerWorker only, all bound to the same port
+  FOR_EACH_RANGE (i, 0, addresses_.size()) {
+    const folly::AsyncServerSocket* serverSocket = nullptr;
+    if (i < inlineSockets_.size()) {
+      serverSocket = inlineSockets_[i].get();
+    } else if (i < bootstrap_.size() && !bootstrap_[i].getSockets().empty()) {
+      serverSocket = dynamic_cast<const folly::AsyncServerSocket*>(
+        bootstrap_[i].getSockets()[0].get());
+    }
+    if (!serverSocket) {
+      continue;
+    }
+    for (auto fd : serverSocket->getNetworkSockets()) {
+      SocketTakeover::sendSocket(
+        unixFd, SocketTakeover::SocketType::LISTENING, i, fd.toFd());
+    }
+  }
+  stopListening();
+
+  if (idleConnections) {
+    auto sendConnections = [unixFd] (HTTPSessionAcceptor& acceptor,
+                                     size_t index) {
+      std::vector<folly::NetworkSocket> fds;
+      acceptor.getEventBase()->runInEventBaseThreadAndWait([&] {
+        fds = acceptor.releaseIdleConnections();
+      });
+      for (auto fd : fds) {
+        SCOPE_EXIT {
+          folly::closeNoInt(fd.toFd());
+        };
+        SocketTakeover::sendSocket(
+          unixFd, SocketTakeover::SocketType::CONNECTION, index, fd.toFd());
+      }
+    };
+    FOR_EACH_RANGE (i, 0, inlineAcceptors_.size()) {
+      sendConnections(*inlineAcceptors_[i], i);
+    }
+    FOR_EACH_RANGE (i, 0, bootstrap_.size()) {
+      std::vector<HTTPSessionAcceptor*> acceptors;
+      bootstrap_[i].forEachWorker([&](wangle::Acceptor* acceptor) {
+        auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+        if (sessionAcceptor && sessionAcceptor->getEventBase()) {
+          acceptors.push_back(sessionAcceptor);
+        }
+      });
+      for (auto acceptor : acceptors) {
+        sendConnections(*acceptor, i);
+      }
+    }
+  }
+  SocketTakeover::sendEnd(unixFd);
+}
+
+void HTTPServer::takeOverSockets(int unixFd) {
+  CHECK(options_->preboundSockets_.empty());
+  auto sockets = SocketTakeover::receiveSockets(unixFd);
+  CHECK_EQ(sockets.listeningFds.size(), addresses_.size())
+    << "The old process handed over the sockets of other addresses";
+  for (auto& fds : sockets.listeningFds) {
+    options_->useExistingSockets(fds);
+  }
+  takenConnections_ = std::move(sockets.connectionFds);
+}
+
+void HTTPServer::resumeTakenConnections() {
+  if (takenConnections_.empty()) {
+    return;
+  }
+  if (!inlineAcceptors_.empty()) {
+    for (auto& conn : takenConnections_) {
+      if (conn.second < inlineAcceptors_.size()) {
+        inlineAcceptors_[conn.second]->resumeConnection(
+          folly::NetworkSocket::fromFd(conn.first));
+      } else {
+        folly::closeNoInt(conn.first);
+      }
+    }
+    takenConnections_.clear();
+    return;
+  }
+
+  // Spread over the workers of each address
+  std::vector<std::vector<HTTPSessionAcceptor*>> acceptors(bootstrap_.size());
+  FOR_EACH_RANGE (i, 0, bootstrap_.size()) {
+    bootstrap_[i].forEachWorker([&](wangle::Acceptor* acceptor) {
+      auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+      if (sessionAcceptor && sessionAcceptor->getEventBase()) {
+        acceptors[i].push_back(sessionAcceptor);
+      }
+    });
+  }
+  FOR_EACH_RANGE (i, 0, takenConnections_.size()) {
+    auto fd = folly::NetworkSocket::fromFd(takenConnections_[i].first);
+    auto index = takenConnections_[i].second;
+    if (index >= acceptors.size() || acceptors[index].empty()) {
+      folly::closeNoInt(fd.toFd());
+      continue;
+    }
+    auto acceptor = acceptors[index][i % acceptors[index].size()];
+    acceptor->getEventBase()->runInEventBaseThread([acceptor, fd] {
+      acceptor->resumeConnection(fd);
+    });
+  }
+  takenConnections_.clear();
+}
+
+void HTTPServer::refreshTicketSeeds() {
+  wangle::TLSTicketKeySeeds seeds;
+  try {
+    seeds = options_->ticketSeedProvider->getSeeds();
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Can't get the ticket seeds: " << ex.what();
+    return;
+  }
+  if (ticketSeeds_ &&
+      ticketSeeds_->oldSeeds == seeds.oldSeeds &&
+      ticketSeeds_->currentSeeds == seeds.currentSeeds &&
+      ticketSeeds_->newSeeds == seeds.newSeeds) {
+    return;
+  }
+  ticketSeeds_ = seeds;
+  updateTicketSeeds(std::move(seeds));
+  if (options_->resumptionStats) {
+    options_->resumptionStats->seedUpdates.fetch_add(
+      1, std::memory_order_relaxed);
+  }
+}
+
 void HTTPServer::updateTicketSeeds(wangle::TLSTicketKeySeeds seeds) {
+  if (!inlineAcceptors_.empty()) {
+    mainEventBase_->runInEventBaseThread([this, seeds] {
+      for (auto& acceptor : inlineAcceptors_) {
+        if (acceptor->isSSL()) {
+          acceptor->setTLSTicketSecrets(
+            seeds.oldSeeds, seeds.currentSeeds, seeds.newSeeds);
+        }
+      }
+    });
+  }
   for (auto& bootstrap : bootstrap_) {
     bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
       if (!acceptor || !acceptor->isSSL()) {
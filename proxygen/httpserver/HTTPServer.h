@@ -15,8 +15,16 @@
 #include <proxygen/httpserver/HTTPServerOptions.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
+#include <proxygen/lib/http/session/HTTPSessionAcceptor.h>
+#include <atomic>
+#include <mutex>
 #include <thread>
 
+namespace folly {
+class EventBaseManager;
+class FunctionScheduler;
+}
+
 namespace proxygen {
 
 class SignalHandler;
@@ -50,6 +58,14 @@ class HTTPServer final {
     std::shared_ptr<HTTPCodecFactory> codecFactory;
     std::vector<wangle::SSLContextConfig> sslConfigs;
 
+    /*
+     * Certificates to load only once a handshake asks for one of their
+     * names, for the names sslConfigs doesn't have, see
+     * LazyCertificateStore.  sslConfigs still needs a default certificate.
+     * Can be shared between addresses.
+     */
+    std::shared_ptr<LazyCertificateStore> lazyCertificates;
+
     /*
      * Sets the initial ticket seeds to use when starting the HTTPServer.
      * Ticket seeds are used to generate the session ticket encryption keys
@@ -77,6 +93,13 @@ class HTTPServer final {
     bool strictSSL{true};
 
     folly::Optional<folly::AsyncSocket::OptionMap> acceptorSocketOptions;
+
+    /*
+     * Has the kernel accept the connections only once they have data, or
+     * after this long (TCP_DEFER_ACCEPT, Linux only), so that the workers
+     * never see the idle ones.  0 disables it.
+     */
+    std::chrono::seconds deferAcceptTimeout{0};
   };
 
   /**
@@ -132,6 +155,64 @@ class HTTPServer final {
    */
   void stop();
 
+  /**
+   * Resize the pool of worker threads, e.g. to follow the daily load or
+   * make room for batch jobs on the same host.  New workers get acceptors
+   * on all the addresses.  Before a worker stops, its sessions move to the
+   * remaining workers once idle; it waits up to drainTimeout for the busy
+   * ones, and drops the connections still busy after it.  Blocks until the
+   * workers are started or stopped.
+   *
+   * Must be called after start() has called onSuccess, from any thread but
+   * the workers, and not concurrently with stop().  Throws
+   * std::invalid_argument if threads is 0, and std::logic_error if the
+   * server runs without workers or with reusePortPerWorker, whose
+   * listening sockets belong to the workers.
+   */
+  void setNumWorkers(size_t threads,
+                     std::chrono::milliseconds drainTimeout =
+                       std::chrono::seconds(5));
+
+  /**
+   * The number of worker threads, 0 if not started or without workers.
+   */
+  size_t getNumWorkers() const;
+
+  /**
+   * Drain the open connections gradually over window instead of all at once
+   * on stop(), so the clients and load balancers don't see a burst of
+   * reconnects and TLS handshakes.  The idle connections are drained first.
+   * Returns right away, typically called after stopListening() and followed
+   * by stop() once getDrainProgress() is finished or after window.
+   */
+  void drainGradually(std::chrono::milliseconds window);
+
+  /**
+   * The progress of drainGradually() summed over all the acceptors, e.g. for
+   * deploy tooling.  Can be called from any thread.
+   */
+  HTTPSessionAcceptor::DrainProgress getDrainProgress() const;
+
+  /**
+   * Hand the listening sockets over to a new process calling
+   * takeOverSockets() on the other end of unixFd (see SocketTakeover), for a
+   * restart without closing them.  Then stops listening, the new process
+   * accepting the new connections.  With idleConnections, also hands over
+   * the idle plaintext HTTP/1.1 connections, the others are left to drain.
+   *
+   * Blocks, must be called after start() and outside of the server's
+   * threads.  Throws std::system_error if sending fails.
+   */
+  void handOverSockets(int unixFd, bool idleConnections);
+
+  /**
+   * Listen on the sockets handed over by handOverSockets() on the other end
+   * of unixFd instead of binding new ones, and serve the connections handed
+   * over once started.  Must be called after bind(), with the same addresses
+   * as the old process, and before start().
+   */
+  void takeOverSockets(int unixFd);
+
   /**
    * Get the list of addresses server is listening on. Empty if sockets are not
    * bound yet.
@@ -149,6 +230,14 @@ class HTTPServer final {
     sessionInfoCb_ = cb;
   }
 
+  /**
+   * The options the server runs with, whose handler chain includes the
+   * filters the server added.  For an HQServer serving the same handlers.
+   */
+  std::shared_ptr<HTTPServerOptions> getOptions() const {
+    return options_;
+  }
+
   /**
    * Returns a file descriptor associated with the listening socket
    */
@@ -165,6 +254,23 @@ class HTTPServer final {
   void updateTicketSeeds(wangle::TLSTicketKeySeeds seeds);
 
  private:
+  // Binds the addresses with bootstrap_ on options_->threads workers
+  void startWorkers();
+
+  // Moves the sessions of the worker on evb to the other workers, as it
+  // stops when shrinking the workers
+  void moveSessionsOff(folly::EventBase* evb);
+
+  // Hands the connections received by takeOverSockets() to the acceptors
+  void resumeTakenConnections();
+
+  // Binds the addresses on mainEventBase_ when threads == 0
+  void startInline();
+  void stopInline();
+
+  // Hands the ticketSeedProvider's seeds to the acceptors when they change
+  void refreshTicketSeeds();
+
   std::shared_ptr<HTTPServerOptions> options_;
 
   /**
@@ -172,6 +278,26 @@ class HTTPServer final {
    */
   folly::EventBase* mainEventBase_{nullptr};
 
+  /**
+   * Hands out the io_uring EventBases of the IO threads, if
+   * useIoUringBackend.  Outlives the threads of bootstrap_.
+   */
+  std::unique_ptr<folly::EventBaseManager> ioUringEventBaseManager_;
+
+  /**
+   * Signs the TLS handshakes of all the acceptors, if
+   * handshakeOffloadThreads.  Kept across restarts.
+   */
+  std::shared_ptr<HandshakeOffloadPool> handshakeOffloadPool_;
+
+  /**
+   * Runs refreshTicketSeeds() every ticketSeedRefreshInterval while
+   * started, if ticketSeedProvider; ticketSeeds_ is the last seeds it
+   * handed out.
+   */
+  std::unique_ptr<folly::FunctionScheduler> ticketSeedScheduler_;
+  folly::Optional<wangle::TLSTicketKeySeeds> ticketSeeds_;
+
   /**
    * Optional signal handlers on which we should shutdown server
    */
@@ -183,6 +309,41 @@ class HTTPServer final {
   std::vector<IPConfig> addresses_;
   std::vector<wangle::ServerBootstrap<wangle::DefaultPipeline>> bootstrap_;
 
+  /**
+   * The worker threads of bootstrap_, and whether they have their own
+   * listening sockets (reusePortPerWorker).
+   */
+  std::shared_ptr<folly::IOThreadPoolExecutor> workers_;
+  bool perWorkerSockets_{false};
+
+  /**
+   * Held while resizing workers_, with the timeout for the busy sessions
+   * of the workers stopped and those already stopped.
+   */
+  std::mutex resizeMutex_;
+  std::atomic<bool> resizingWorkers_{false};
+  std::chrono::milliseconds drainTimeout_{0};
+  std::vector<folly::EventBase*> stoppedWorkers_;
+
+  /**
+   * With rebalanceSessions, moves the sessions between the acceptors of each
+   * address, indexed like bootstrap_.
+   */
+  std::vector<std::shared_ptr<HTTPSessionRebalancer>> rebalancers_;
+
+  /**
+   * With threads == 0, the listening sockets and their acceptors, running
+   * on mainEventBase_ instead of bootstrap_.
+   */
+  std::vector<folly::AsyncServerSocket::UniquePtr> inlineSockets_;
+  std::vector<std::unique_ptr<HTTPServerAcceptor>> inlineAcceptors_;
+
+  /**
+   * The connections received by takeOverSockets(), and the index of their
+   * address, until start()
+   */
+  std::vector<std::pair<int, size_t>> takenConnections_;
+
   /**
    * Callback for session create/destruction
    */
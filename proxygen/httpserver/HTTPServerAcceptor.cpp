@@ -10,6 +10,7 @@
 #include <proxygen/httpserver/HTTPServerAcceptor.h>
 
 #include <folly/ExceptionString.h>
+#include <proxygen/httpserver/filters/DirectResponseHandler.h>
 #include <proxygen/httpserver/RequestHandlerAdaptor.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 #include <proxygen/lib/http/codec/HTTP1xCodec.h>
@@ -31,13 +32,38 @@ AcceptorConfiguration HTTPServerAcceptor::makeConfig(
   conf.initialReceiveWindow = opts.initialReceiveWindow;
   conf.receiveStreamWindowSize = opts.receiveStreamWindowSize;
   conf.receiveSessionWindowSize = opts.receiveSessionWindowSize;
+  conf.maxReceiveSessionWindowSize = opts.maxReceiveSessionWindowSize;
+  conf.maxReceiveStreamWindowSize = opts.maxReceiveStreamWindowSize;
+  conf.frameTraceSize = opts.frameTraceSize;
+  conf.trafficCapture = opts.trafficCapture;
   conf.acceptBacklog = opts.listenBacklog;
   conf.maxConcurrentIncomingStreams = opts.maxConcurrentIncomingStreams;
+  conf.maxPipelineBatch = opts.maxPipelineBatch;
+  conf.maxCoalescedChunkSize = opts.maxCoalescedChunkSize;
+  conf.transportInfoCacheRequests = opts.transportInfoCacheRequests;
+  conf.transportInfoCacheAge = opts.transportInfoCacheAge;
+  conf.egressTargetBytesPerWrite = opts.egressTargetBytesPerWrite;
+  conf.egressBatchMaxLatency = opts.egressBatchMaxLatency;
+  conf.tcpNotSentLowat = opts.tcpNotSentLowat;
+  conf.egressSchedulerQuantum = opts.egressSchedulerQuantum;
+  conf.hibernateTimeout = opts.hibernateTimeout;
+  conf.deferSessionUntilData = opts.deferSessionUntilData;
+  conf.socketTimestampTimeout = opts.socketTimestampTimeout;
+  conf.enableKernelTLS = opts.enableKernelTLS;
+  conf.egressZeroCopyThreshold = opts.egressZeroCopyThreshold;
+  conf.useRFC9218Priorities = opts.useRFC9218Priorities;
+  conf.headerEncodeCacheSize = opts.headerEncodeCacheSize;
+  conf.useStaticHeaderBlockCache = opts.useStaticHeaderBlockCache;
 
   if (opts.enableExHeaders) {
     conf.egressSettings.push_back(
       HTTPSetting(SettingsId::ENABLE_EX_HEADERS, 1));
   }
+  if (opts.supportsConnect) {
+    // Extended CONNECT (RFC 8441) for tunnels over HTTP/2 streams
+    conf.egressSettings.push_back(
+      HTTPSetting(SettingsId::ENABLE_CONNECT_PROTOCOL, 1));
+  }
 
   if (ipConfig.protocol == HTTPServer::Protocol::SPDY) {
     conf.plaintextProtocol = "spdy/3.1";
@@ -45,15 +71,31 @@ AcceptorConfiguration HTTPServerAcceptor::makeConfig(
     conf.plaintextProtocol = http2::kProtocolCleartextString;
   } else if (opts.h2cEnabled) {
     conf.allowedPlaintextUpgradeProtocols = { http2::kProtocolCleartextString };
+    conf.allowH2cPriorKnowledge = true;
   }
 
   conf.sslContextConfigs = ipConfig.sslConfigs;
+  if (ipConfig.lazyCertificates) {
+    conf.lazyCertificates = ipConfig.lazyCertificates;
+    for (auto& sslConfig : conf.sslContextConfigs) {
+      auto store = ipConfig.lazyCertificates;
+      sslConfig.sniNoMatchFn = [store](const char* serverName) {
+        return store->onNoMatch(serverName);
+      };
+    }
+  }
+  if (opts.handshakeOffloadThreads > 0 && !ipConfig.sslConfigs.empty()) {
+    // Only fizz can wait for a signature; HTTPServer sets the pool
+    conf.fizzConfig.enableFizz = true;
+  }
   conf.strictSSL = ipConfig.strictSSL;
   conf.allowInsecureConnectionsOnSecureServer =
       ipConfig.allowInsecureConnectionsOnSecureServer;
   conf.enableTCPFastOpen = ipConfig.enableTCPFastOpen;
   conf.fastOpenQueueSize = ipConfig.fastOpenQueueSize;
-  if (ipConfig.ticketSeeds) {
+  if (opts.ticketSeedProvider) {
+    conf.initialTicketSeeds = opts.ticketSeedProvider->getSeeds();
+  } else if (ipConfig.ticketSeeds) {
     conf.initialTicketSeeds = *ipConfig.ticketSeeds;
   }
   if (ipConfig.acceptorSocketOptions.hasValue()) {
@@ -86,6 +128,9 @@ HTTPServerAcceptor::HTTPServerAcceptor(
     : HTTPSessionAcceptor(conf, codecFactory),
       serverOptions_(options),
       handlerFactories_(handlerFactories) {
+  if (options.admissionController) {
+    setAdmissionController(options.admissionController);
+  }
 }
 
 void HTTPServerAcceptor::setCompletionCallback(std::function<void()> f) {
@@ -105,6 +150,12 @@ HTTPTransactionHandler* HTTPServerAcceptor::newHandler(
   msg->setClientAddress(clientAddr);
   msg->setDstAddress(vipAddr);
 
+  auto& healthCheck = serverOptions_.healthCheck;
+  if (healthCheck && msg->getPath() == healthCheck->getPath()) {
+    return new RequestHandlerAdaptor(
+      new DirectResponseHandler(healthCheck->getResponse()));
+  }
+
   // Create filters chain
   RequestHandler* h = nullptr;
   for (auto& factory: handlerFactories_) {
@@ -120,6 +171,10 @@ void HTTPServerAcceptor::onNewConnection(
     const std::string& nextProtocolName,
     SecureTransportType secureTransportType,
     const wangle::TransportInfo& tinfo) {
+  if (serverOptions_.resumptionStats &&
+      secureTransportType != wangle::SecureTransportType::NONE) {
+    serverOptions_.resumptionStats->recordHandshake(tinfo.sslResume);
+  }
   auto& filter = serverOptions_.newConnectionFilter;
   if (filter) {
     try {
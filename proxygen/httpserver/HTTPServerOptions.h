@@ -9,15 +9,27 @@
  */
 #pragma once
 
+#include <folly/Executor.h>
 #include <folly/Function.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/async/AsyncServerSocket.h>
 #include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/HealthCheck.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/TLSResumption.h>
+#include <proxygen/lib/http/session/AdaptiveStreamLimit.h>
+#include <proxygen/lib/http/session/HTTPAdmissionController.h>
+#include <proxygen/lib/http/session/HTTPSessionRebalancer.h>
+#include <proxygen/lib/utils/CompressionLevelSelector.h>
+#include <proxygen/lib/utils/StreamDecompressor.h>
 #include <signal.h>
 
 namespace proxygen {
 
+class ResponseCache;
+class TrafficCaptureWriter;
+class ZstdDictionary;
+
 /**
  * Configuration options for HTTPServer
  *
@@ -42,10 +54,14 @@ class HTTPServerOptions {
    * Number of threads to start to handle requests. Note that this excludes
    * the thread you call `HTTPServer.start()` in.
    *
+   * With `threads == 0`, no thread is started: accepting, TLS and handling
+   * the requests all run on the thread calling `HTTPServer.start()`, with
+   * no handoff between threads, e.g. for a process per core.  The other
+   * threading options (reusePortPerWorker, workerCpus, useIoUringBackend...)
+   * do not apply then.
+   *
    * XXX: Put some perf numbers to help user decide how many threads to
    *      create.
-   * XXX: Maybe support not creating any more worker threads and doing all
-   *      the work in same thread when `threads == 0`.
    */
   size_t threads = 1;
 
@@ -82,7 +98,8 @@ class HTTPServerOptions {
   uint32_t listenBacklog{1024};
 
   /**
-   * Enable cleartext upgrades to HTTP/2
+   * Enable cleartext upgrades to HTTP/2, and HTTP/2 with prior knowledge
+   * on HTTP/1.1 connections
    */
   bool h2cEnabled{false};
 
@@ -96,7 +113,8 @@ class HTTPServerOptions {
 
   /**
    * Set to true if you want to support CONNECT request. Most likely you
-   * don't want that.
+   * don't want that.  Also advertises extended CONNECT (RFC 8441) over
+   * HTTP/2 and HTTP/3, for tunnels sharing the connection.
    */
   bool supportsConnect{false};
 
@@ -107,6 +125,27 @@ class HTTPServerOptions {
   size_t receiveStreamWindowSize{65536};
   size_t receiveSessionWindowSize{65536};
 
+  /**
+   * When non-zero, the HTTP/2 receive windows are tuned to the measured
+   * bandwidth-delay product, up to these per-session and per-stream memory
+   * budgets, and never below the windows above.
+   */
+  size_t maxReceiveSessionWindowSize{0};
+  size_t maxReceiveStreamWindowSize{0};
+
+  /**
+   * When non-zero, every session keeps a trace of its last frameTraceSize
+   * frames, cheap enough to leave on, for debugging misbehaving connections.
+   */
+  size_t frameTraceSize{0};
+
+  /**
+   * If set, captures the traffic shape of a sample of the sessions, headers
+   * and body sizes and timings, for replay in load tests.  See
+   * TrafficCaptureWriter for the sampling.
+   */
+  std::shared_ptr<TrafficCaptureWriter> trafficCapture;
+
   /**
    * The maximum number of transactions the remote could initiate
    * per connection on protocols that allow multiplexing.
@@ -114,11 +153,201 @@ class HTTPServerOptions {
   uint32_t maxConcurrentIncomingStreams{100};
 
   /**
-   * Set to true to enable gzip content compression. Currently false for
+   * Raise and lower maxConcurrentIncomingStreams on the connections of each
+   * worker as its thread gets busy or the memory budgets fill up, within
+   * the bounds of adaptiveStreamLimitOptions.
+   */
+  bool adaptiveStreamLimit{false};
+  AdaptiveStreamLimit::Options adaptiveStreamLimitOptions;
+
+  /**
+   * The maximum number of pipelined HTTP/1.1 responses that may be sent in a
+   * single write when clients pipeline requests.  1 disables batching.
+   */
+  uint32_t maxPipelineBatch{1};
+
+  /**
+   * Merge the small chunks that handlers send within one event loop
+   * iteration into HTTP/1.1 chunks of up to this many bytes, saving a chunk
+   * header and terminator each.  Nothing waits for more body, so streaming
+   * latency is unchanged.  0 keeps the handlers' chunks.
+   */
+  uint32_t maxCoalescedChunkSize{0};
+
+  /**
+   * Read the TCP_INFO of a connection for getCurrentTransportInfo() once
+   * per transportInfoCacheRequests requests, or once it is
+   * transportInfoCacheAge old, and serve the copy in between.  It is read
+   * once more as the connection closes.  Both 0 read it for every call.
+   */
+  uint32_t transportInfoCacheRequests{0};
+  std::chrono::milliseconds transportInfoCacheAge{0};
+
+  /**
+   * Gather egress into writes of at least this many bytes when there is
+   * enough queued, spending at most egressBatchMaxLatency doing so.  The
+   * target grows while the socket is backed up.  0 writes as soon as any
+   * egress is ready.
+   */
+  uint32_t egressTargetBytesPerWrite{0};
+  std::chrono::microseconds egressBatchMaxLatency{200};
+
+  /**
+   * TCP_NOTSENT_LOWAT to set on accepted sockets, 0 to leave it alone.
+   */
+  uint32_t tcpNotSentLowat{0};
+
+  /**
+   * Share each worker's egress among its connections, in rounds where each
+   * writes at most this many bytes, and where those with little to send go
+   * first.  Keeps a few bulk downloads from holding up the small responses
+   * of the other connections.  0 lets every connection write all it has.
+   */
+  uint32_t egressSchedulerQuantum{0};
+
+  /**
+   * Sign the TLS handshakes on this many threads of their own, instead of
+   * on the workers serving the requests, see HandshakeOffloadPool.  Once
+   * handshakeOffloadMaxQueueDepth signatures are waiting, new handshakes
+   * fail.  Serves TLS 1.3 with fizz; older clients still sign on the
+   * workers.  0 disables it.
+   */
+  size_t handshakeOffloadThreads{0};
+  size_t handshakeOffloadMaxQueueDepth{1024};
+
+  /**
+   * Release header table storage, priority nodes and buffers of connections
+   * that have had no request for this long, 0 to never do so.  Shorter than
+   * idleTimeout to be of any use.
+   */
+  std::chrono::milliseconds hibernateTimeout{0};
+
+  /**
+   * Holds only the socket of the plaintext connections until they send
+   * their first bytes, for idleTimeout at most, to build their session
+   * then.  See also IPConfig::deferAcceptTimeout.
+   */
+  bool deferSessionUntilData{false};
+
+  /**
+   * Time the transmission and acknowledgement of the first and last body
+   * bytes of responses with kernel socket timestamps, reported through
+   * HTTPTransactionTransportCallback.  Timestamps are waited for this
+   * long, 0 to not request them.
+   */
+  std::chrono::milliseconds socketTimestampTimeout{0};
+
+  /**
+   * Have the kernel encrypt the records of TLS sessions established with
+   * OpenSSL (kTLS), see KernelTLS.h.  Sessions the kernel can not take keep
+   * using user space TLS.
+   */
+  bool enableKernelTLS{false};
+
+  /**
+   * Send writes of at least this many bytes, such as large response
+   * bodies, with MSG_ZEROCOPY rather than copying them into the kernel.
+   * Only pays off for writes of tens of kilobytes and up, and only applies
+   * to plaintext connections.  0 to always copy.
+   */
+  size_t egressZeroCopyThreshold{0};
+
+  /**
+   * Run the EventBases of the acceptor and worker threads on io_uring
+   * (folly::IoUringBackend) instead of libevent's epoll.  The socket events
+   * registered and rearmed during a loop are then submitted to the kernel
+   * in batches rather than with a syscall each.  Falls back to epoll, with
+   * a warning, where folly was built without liburing or the kernel does
+   * not support io_uring.
+   */
+  bool useIoUringBackend{false};
+
+  /**
+   * Give every worker thread its own SO_REUSEPORT listening socket, and
+   * accept its connections on the worker itself, instead of accepting on a
+   * single thread handing the connections to the workers.  The kernel then
+   * spreads the connections across the workers.  Ignored with prebound
+   * sockets.
+   */
+  bool reusePortPerWorker{false};
+
+  /**
+   * With reusePortPerWorker, pin worker thread i to CPU i (modulo the CPUs),
+   * unless workerCpus or workerNumaNodes place it.  The listening socket of
+   * a worker pinned to one CPU gets SO_INCOMING_CPU, so the kernel (Linux
+   * 6.1 and later) hands a connection to the worker on the CPU processing
+   * its packets.  Best with one worker per CPU and the interrupts of the NIC
+   * queues spread across them.
+   */
+  bool steerToIncomingCpu{false};
+
+  /**
+   * CPUs to pin the worker threads to, worker i to
+   * workerCpus[i % workerCpus.size()], so they are not migrated.  Linux
+   * only.
+   */
+  std::vector<size_t> workerCpus;
+
+  /**
+   * NUMA nodes to run the worker threads on when workerCpus is empty,
+   * worker i on the CPUs of workerNumaNodes[i % workerNumaNodes.size()],
+   * e.g. the nodes of the NIC queues.  The threads are placed before
+   * allocating their buffers, codec tables and other thread local state,
+   * which the default memory policy then allocates from their node.  Linux
+   * only.
+   */
+  std::vector<size_t> workerNumaNodes;
+
+  /**
+   * Move idle sessions from the busiest worker thread to the least busy one,
+   * as set in rebalanceOptions, when some workers serve most of the long
+   * lived connections.  Ignored with threads <= 1.
+   */
+  bool rebalanceSessions{false};
+  HTTPSessionRebalancer::Options rebalanceOptions;
+
+  /**
+   * Schedule HTTP/2 egress with RFC 9218 urgency buckets rather than the
+   * RFC 7540 dependency tree.  Cheaper with many concurrent streams.
+   */
+  bool useRFC9218Priorities{false};
+
+  /**
+   * Number of repeated header blocks (e.g. identical responses) whose HPACK
+   * encoding is remembered per HTTP/2 connection and re-sent without being
+   * encoded again.  0 disables the cache.
+   */
+  size_t headerEncodeCacheSize{0};
+
+  /**
+   * Keep one copy per worker thread of the encoding of header blocks that
+   * only use the HPACK static table (":status: 200" and the like), and copy
+   * it rather than encoding such blocks on every HTTP/2 connection.
+   */
+  bool useStaticHeaderBlockCache{false};
+
+  /**
+   * Recycle the memory of the RequestHandlerAdaptor and of the built-in
+   * filters of each request on per-thread free lists, rather than
+   * allocating them for every request (see RecycledRequestHandler).  The
+   * filters of handlerFactories can opt in too.  Process wide.
+   */
+  bool recycleRequestHandlers{false};
+
+  /**
+   * Set to true to enable content compression. Currently false for
    * backwards compatibility.
    */
   bool enableContentCompression{false};
 
+  /**
+   * Content encodings to compress with, in order of preference when the
+   * client accepts several with the same qvalue.  BROTLI needs proxygen
+   * built with libbrotlienc.
+   */
+  std::vector<CompressionType> contentCompressionEncodings{
+    CompressionType::GZIP};
+
   /**
    * Requests smaller than the specified number of bytes will not be compressed
    */
@@ -130,6 +359,47 @@ class HTTPServerOptions {
    */
   int contentCompressionLevel{-1};
 
+  /**
+   * Brotli quality, 0 to 11(Slower).  5 compresses about as fast as zlib
+   * level 6, and better.
+   */
+  int contentCompressionBrotliLevel{5};
+
+  /**
+   * Zstd compression level, 1 to 19(Slower).
+   */
+  int contentCompressionZstdLevel{3};
+
+  /**
+   * If set, chooses the level of each compressed response, such as a
+   * ResourceCompressionLevelSelector lowering it as the CPU gets busy.  The
+   * levels above are the defaults.
+   */
+  std::shared_ptr<CompressionLevelSelector> contentCompressionLevelSelector;
+
+  /**
+   * Pre-trained dictionary to compress zstd responses with, instead of the
+   * level above.  Only for clients known to have the same dictionary, such
+   * as other internal services.
+   */
+  std::shared_ptr<const ZstdDictionary> contentCompressionZstdDictionary;
+
+  /**
+   * Bytes of compressed response bodies to cache, for bodies repeated across
+   * requests (static files, JSON by ETag) to be compressed once.  0 disables
+   * the cache.  Only non-chunked responses are cached.
+   */
+  size_t contentCompressionCacheSize{0};
+
+  /**
+   * If set, response bodies of at least contentCompressionOffloadMinimumSize
+   * bytes are compressed on this executor rather than on the I/O threads,
+   * where compressing a few MB would delay every other connection of the
+   * thread.  The executor must outlive the server.
+   */
+  std::shared_ptr<folly::Executor> contentCompressionExecutor;
+  size_t contentCompressionOffloadMinimumSize{256 * 1024};
+
   /**
    * Enable support for pub-sub extension.
    */
@@ -152,6 +422,36 @@ class HTTPServerOptions {
     "text/xml",
   };
 
+  /**
+   * Decompress gzip, deflate and zstd request bodies before the handlers,
+   * in chunks of about requestDecompressionChunkSize bytes.  Bodies
+   * decompressing to more than requestDecompressionMaxRatio times their
+   * compressed size (past 1MB), or to more than requestDecompressionMaxSize
+   * bytes if not 0, are rejected with a 413.
+   */
+  bool enableRequestDecompression{false};
+  size_t requestDecompressionChunkSize{64 * 1024};
+  double requestDecompressionMaxRatio{100};
+  uint64_t requestDecompressionMaxSize{0};
+
+  /**
+   * If set, caches and serves the cacheable responses of the handlers, for
+   * endpoints whose responses are the same for everyone for a little while.
+   * Responses are cached before content compression.
+   */
+  std::shared_ptr<ResponseCache> responseCache;
+
+  /**
+   * Apply a policy to the requests received as TLS 1.3 or QUIC early data,
+   * which can be replayed (see EarlyDataFilter).  Those earlyDataAllowed
+   * accepts, by default the ones with a safe method, go to the handlers at
+   * once, marked Early-Data: 1.  The others wait for the handshake to
+   * complete, or get a 425 (Too Early) with rejectUnsafeEarlyData.
+   */
+  bool enableEarlyDataPolicy{false};
+  std::function<bool(const HTTPMessage&)> earlyDataAllowed;
+  bool rejectUnsafeEarlyData{false};
+
   /**
    * This holds sockets already bound to addresses that the server
    * will listen on and will be empty once the server starts.
@@ -188,5 +488,33 @@ class HTTPServerOptions {
    * throws any exception.
    */
   NewConnectionFilter newConnectionFilter;
+
+  /**
+   * When set, sheds the new connections and requests while it reports the
+   * server overloaded, e.g. a ResourceAdmissionController.  Shared by all
+   * the acceptors, so it must be thread-safe.
+   */
+  std::shared_ptr<HTTPAdmissionController> admissionController;
+
+  /**
+   * When set, the requests for its path are answered from its cached state
+   * by the acceptors themselves, without going through handlerFactories.
+   * The server doesn't start or stop it.
+   */
+  std::shared_ptr<HealthCheck> healthCheck;
+
+  /**
+   * When set, the seeds of the TLS session tickets of all the addresses,
+   * instead of their IPConfig::ticketSeeds, asked for again every
+   * ticketSeedRefreshInterval to follow their rotation.
+   */
+  std::shared_ptr<TicketSeedProvider> ticketSeedProvider;
+  std::chrono::milliseconds ticketSeedRefreshInterval{60000};
+
+  /**
+   * When set, counts the TLS handshakes of the acceptors by how they
+   * resumed, and the updates of the ticketSeedProvider's seeds.
+   */
+  std::shared_ptr<TLSResumptionStats> resumptionStats;
 };
 }
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/HealthCheck.h>
+
+namespace {
+
+std::shared_ptr<const proxygen::PrebuiltResponse> makeResponse(
+    uint16_t code, const std::string& message, const std::string& body) {
+  proxygen::HTTPHeaders headers;
+  headers.add(proxygen::HTTP_HEADER_CONTENT_TYPE, "text/plain");
+  headers.add(proxygen::HTTP_HEADER_CACHE_CONTROL, "no-store");
+  return proxygen::PrebuiltResponse::create(
+    code, message, headers, folly::IOBuf::copyBuffer(body));
+}
+
+}
+
+namespace proxygen {
+
+HealthCheck::HealthCheck(Check check, const Options& options)
+    : check_(std::move(check)),
+      options_(options),
+      healthyResponse_(makeResponse(200, "OK", options.healthyBody)),
+      unhealthyResponse_(makeResponse(503, "Service Unavailable",
+                                      options.unhealthyBody)) {
+}
+
+HealthCheck::~HealthCheck() {
+  stop();
+}
+
+void HealthCheck::start() {
+  std::lock_guard<std::mutex> guard(schedulerMutex_);
+  if (scheduler_) {
+    return;
+  }
+  scheduler_ = std::make_unique<folly::FunctionScheduler>();
+  scheduler_->setThreadName("health_check");
+  scheduler_->addFunction([this] { evaluate(); },
+                          options_.interval,
+                          "health_check");
+  scheduler_->start();
+}
+
+void HealthCheck::stop() {
+  std::lock_guard<std::mutex> guard(schedulerMutex_);
+  scheduler_.reset();
+}
+
+void HealthCheck::evaluate() {
+  bool passed = false;
+  try {
+    passed = check_();
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Health check failed: " << ex.what();
+  }
+  if (passed != checkPassed_.exchange(passed)) {
+    LOG(INFO) << "Health check " << (passed ? "passing" : "failing");
+  }
+}
+
+}
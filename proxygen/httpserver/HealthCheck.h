@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <folly/experimental/FunctionScheduler.h>
+#include <functional>
+#include <mutex>
+#include <proxygen/httpserver/PrebuiltResponse.h>
+
+namespace proxygen {
+
+/**
+ * The health of the server as load balancers' probes are told: the check is
+ * run off the request path, every interval from a scheduler thread, and its
+ * result cached.  The probes are answered from one of two prebuilt
+ * responses, 200 or 503, from the acceptors ahead of the handler chain (see
+ * HTTPServerOptions::healthCheck), so that however often they come they
+ * cost no more than a lookup of the path.
+ *
+ * All public methods are thread-safe.
+ */
+class HealthCheck {
+ public:
+  // True if healthy
+  using Check = std::function<bool()>;
+
+  struct Options {
+    // The path of the probes
+    std::string path{"/health"};
+    std::chrono::milliseconds interval{1000};
+    std::string healthyBody{"OK"};
+    std::string unhealthyBody{"Unhealthy"};
+  };
+
+  /**
+   * Healthy until the check says otherwise; the first run is from start()
+   * or evaluate().
+   */
+  explicit HealthCheck(Check check, const Options& options = Options());
+
+  virtual ~HealthCheck();
+
+  HealthCheck(const HealthCheck&) = delete;
+  HealthCheck& operator=(const HealthCheck&) = delete;
+
+  // Runs the check every interval, from now
+  void start();
+
+  void stop();
+
+  // Runs the check now, from this thread
+  void evaluate();
+
+  /**
+   * Reports unhealthy whatever the check says while draining, e.g. to have
+   * the load balancers move away ahead of a restart.
+   */
+  void setDraining(bool draining) {
+    draining_ = draining;
+  }
+
+  bool isHealthy() const {
+    return checkPassed_.load(std::memory_order_relaxed) &&
+      !draining_.load(std::memory_order_relaxed);
+  }
+
+  const std::string& getPath() const {
+    return options_.path;
+  }
+
+  // The response to a probe now
+  const std::shared_ptr<const PrebuiltResponse>& getResponse() const {
+    return isHealthy() ? healthyResponse_ : unhealthyResponse_;
+  }
+
+ private:
+  Check check_;
+  const Options options_;
+  const std::shared_ptr<const PrebuiltResponse> healthyResponse_;
+  const std::shared_ptr<const PrebuiltResponse> unhealthyResponse_;
+  std::atomic<bool> checkPassed_{true};
+  std::atomic<bool> draining_{false};
+
+  std::unique_ptr<folly::FunctionScheduler> scheduler_;
+  std::mutex schedulerMutex_;
+};
+
+}
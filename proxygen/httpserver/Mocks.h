@@ -31,6 +31,9 @@ class MockResponseHandler : public ResponseHandler {
   GMOCK_METHOD1_(, noexcept, , sendHeaders, void(HTTPMessage&));
   GMOCK_METHOD1_(, noexcept, , sendChunkHeader, void(size_t));
   GMOCK_METHOD1_(, noexcept, , sendBody, void(std::shared_ptr<folly::IOBuf>));
+  GMOCK_METHOD3_(, noexcept, , sendFileBody,
+                 void(std::shared_ptr<folly::File>, off_t, size_t));
+  GMOCK_METHOD1_(, noexcept, , spliceTunnel, bool(folly::AsyncSocket&));
   GMOCK_METHOD0_(, noexcept, , sendChunkTerminator, void());
   GMOCK_METHOD1_(, noexcept, , sendTrailers, void(const HTTPHeaders&));
   GMOCK_METHOD0_(, noexcept, , sendEOM, void());
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Conv.h>
+#include <proxygen/httpserver/ResponseHandler.h>
+#include <proxygen/lib/http/HTTPHeaderTemplate.h>
+
+namespace proxygen {
+
+/**
+ * An immutable complete response, built once and shared by the requests
+ * getting it, e.g. health checks, 204s or canned errors:
+ *
+ *   static const auto kOk = PrebuiltResponse::create(200, "OK", headers,
+ *                                                     body);
+ *   ...
+ *   kOk->send(downstream_);
+ *
+ * The headers go in an HTTPHeaderTemplate, so that HTTP/1.x codecs write
+ * them as one pre-rendered buffer, and the body is sent as a clone of the
+ * shared IOBuf.  Only the status line, the Content-Length and the headers
+ * that cannot be templated (such as Connection) are set per response.
+ */
+class PrebuiltResponse {
+ public:
+  static std::shared_ptr<const PrebuiltResponse> create(
+      uint16_t code,
+      const std::string& message,
+      const HTTPHeaders& headers = HTTPHeaders(),
+      std::unique_ptr<folly::IOBuf> body = nullptr) {
+    return std::shared_ptr<const PrebuiltResponse>(
+      new PrebuiltResponse(code, message, headers, std::move(body)));
+  }
+
+  /**
+   * Sends the whole response, with EOM.
+   */
+  void send(ResponseHandler* handler) const {
+    HTTPMessage msg;
+    msg.setHTTPVersion(1, 1);
+    msg.setStatusCode(code_);
+    msg.setStatusMessage(message_);
+    if (template_) {
+      msg.setHeaderTemplate(template_);
+    }
+    if (hasOwnHeaders_) {
+      ownHeaders_.copyTo(msg.getHeaders());
+    }
+    if (!contentLength_.empty()) {
+      msg.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, contentLength_);
+    }
+    handler->sendHeaders(msg);
+    if (body_) {
+      handler->sendBody(body_->clone());
+    }
+    handler->sendEOM();
+  }
+
+  uint16_t getStatusCode() const {
+    return code_;
+  }
+
+  const folly::IOBuf* getBody() const {
+    return body_.get();
+  }
+
+ private:
+  PrebuiltResponse(uint16_t code,
+                   const std::string& message,
+                   const HTTPHeaders& headers,
+                   std::unique_ptr<folly::IOBuf> body)
+      : code_(code), message_(message), body_(std::move(body)) {
+    HTTPHeaders shared;
+    headers.forEachWithCode([&] (HTTPHeaderCode headerCode,
+                                 const std::string& name,
+                                 const std::string& value) {
+      if (headerCode == HTTP_HEADER_CONTENT_LENGTH) {
+        // Set from the body
+        return;
+      }
+      if (HTTPHeaderTemplate::isTemplatable(headerCode)) {
+        shared.add(name, value);
+      } else {
+        ownHeaders_.add(name, value);
+        hasOwnHeaders_ = true;
+      }
+    });
+    if (shared.size() > 0) {
+      template_ = HTTPHeaderTemplate::create(shared);
+    }
+    if (body_ && body_->empty() && !body_->isChained()) {
+      body_.reset();
+    }
+    if (code_ >= 200 && code_ != 204 && code_ != 304) {
+      contentLength_ = folly::to<std::string>(
+        body_ ? body_->computeChainDataLength() : 0);
+    }
+  }
+
+  const uint16_t code_;
+  const std::string message_;
+  std::shared_ptr<const HTTPHeaderTemplate> template_;
+  HTTPHeaders ownHeaders_;
+  bool hasOwnHeaders_{false};
+  std::string contentLength_;
+  std::unique_ptr<folly::IOBuf> body_;
+};
+
+}
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <proxygen/httpserver/PushPolicy.h>
 #include <proxygen/httpserver/RequestHandler.h>
 
 
@@ -19,6 +20,14 @@ class PushHandler : public RequestHandler {
   PushHandler()
     : innerHandler_(*this) {}
 
+  /**
+   * Reports what became of the push of url to policy, which must outlive
+   * the push: cancelled if the client reset it with CANCEL, complete
+   * otherwise once it's detached.
+   */
+  PushHandler(PushPolicy* policy, std::string url)
+    : innerHandler_(*this), policy_(policy), url_(std::move(url)) {}
+
   // Caller may implement these callbacks if desired
   void requestComplete() noexcept override { delete this; }
   void onError(ProxygenError /*err*/) noexcept override { delete this; }
@@ -33,9 +42,27 @@ class PushHandler : public RequestHandler {
     explicit InnerPushHandler(PushHandler& handler)
       : handler_(handler) {}
 
-    void setTransaction(HTTPTransaction* /*txn*/) noexcept override {}
-    void detachTransaction() noexcept override { handler_.requestComplete(); }
+    void setTransaction(HTTPTransaction* txn) noexcept override {
+      txn_ = txn;
+    }
+    void detachTransaction() noexcept override {
+      if (handler_.policy_ && txn_) {
+        handler_.policy_->onPushComplete(handler_.url_,
+                                         txn_->getEgressBodyBytesSent());
+      }
+      txn_ = nullptr;
+      handler_.requestComplete();
+    }
     void onError(const HTTPException& error) noexcept override {
+      if (handler_.policy_ && txn_) {
+        if (error.hasCodecStatusCode() &&
+            error.getCodecStatusCode() == ErrorCode::CANCEL) {
+          handler_.policy_->onPushCancelled(handler_.url_,
+                                            txn_->getEgressBodyBytesSent());
+        }
+        // Other errors say nothing of the client's want of the resource
+        txn_ = nullptr;
+      }
       handler_.onError(error.getProxygenError());
     }
     void onEgressPaused() noexcept override {
@@ -47,6 +74,7 @@ class PushHandler : public RequestHandler {
 
    private:
     PushHandler& handler_;
+    HTTPTransaction* txn_{nullptr};
   };
 
   void onRequest(std::unique_ptr<HTTPMessage> /*headers*/) noexcept override {
@@ -66,6 +94,8 @@ class PushHandler : public RequestHandler {
   }
 
   InnerPushHandler innerHandler_;
+  PushPolicy* const policy_{nullptr};
+  const std::string url_;
 
 };
 
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/PushPolicy.h>
+
+#include <algorithm>
+
+namespace proxygen {
+
+PushPolicy::PushPolicy(const Options& options)
+    : options_(options), stats_(std::max<size_t>(options.maxResources, 1)) {
+}
+
+bool PushPolicy::shouldPush(const HTTPMessage& request,
+                            const std::string& url) {
+  if (cacheDigestHook_ && cacheDigestHook_(request, url)) {
+    numCacheDigestHits_++;
+    numSuppressed_++;
+    return false;
+  }
+  auto it = stats_.find(url);
+  if (it == stats_.end() || isEffective(it->second)) {
+    return true;
+  }
+  auto& stats = it->second;
+  stats.suppressed++;
+  if (options_.probeInterval > 0 &&
+      stats.suppressed >= options_.probeInterval) {
+    stats.suppressed = 0;
+    return true;
+  }
+  numSuppressed_++;
+  return false;
+}
+
+void PushPolicy::onPushComplete(const std::string& url, uint64_t bytes) {
+  onOutcome(url, bytes, false);
+}
+
+void PushPolicy::onPushCancelled(const std::string& url, uint64_t bytes) {
+  onOutcome(url, bytes, true);
+}
+
+const PushPolicy::Stats* PushPolicy::getStats(const std::string& url) const {
+  auto it = stats_.findWithoutPromotion(url);
+  return it == stats_.end() ? nullptr : &it->second;
+}
+
+bool PushPolicy::isEffective(const Stats& stats) const {
+  if (stats.pushes < options_.minPushes || stats.pushes == 0) {
+    return true;
+  }
+  return double(stats.pushes - stats.cancels) / stats.pushes >=
+    options_.minEffectiveness;
+}
+
+void PushPolicy::onOutcome(const std::string& url,
+                           uint64_t bytes,
+                           bool cancelled) {
+  auto it = stats_.find(url);
+  if (it == stats_.end()) {
+    stats_.set(url, Stats());
+    it = stats_.find(url);
+  }
+  auto& stats = it->second;
+  stats.pushes++;
+  stats.bytesPushed += bytes;
+  if (cancelled) {
+    stats.cancels++;
+    stats.bytesCancelled += bytes;
+  }
+  if (options_.maxPushes > 0 && stats.pushes > options_.maxPushes) {
+    stats.pushes /= 2;
+    stats.cancels /= 2;
+    stats.bytesPushed /= 2;
+    stats.bytesCancelled /= 2;
+  }
+}
+
+}
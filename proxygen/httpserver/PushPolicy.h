@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <functional>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <string>
+
+namespace proxygen {
+
+/**
+ * Decides which resources are worth pushing, from what became of their
+ * previous pushes: a push the client resets with CANCEL was for a resource
+ * it already had, or didn't want, and its bytes wasted.  A resource whose
+ * pushes are cancelled too often stops being pushed, except for one push
+ * in probeInterval, so that it is pushed again if the clients come to
+ * accept it.
+ *
+ * The cache digest hook, if set, is asked first whether the client has the
+ * resource, e.g. from a cache digest it sent with the request.
+ *
+ * Not thread safe; typically one per thread, from the handler factory's
+ * onServerStart(), used by the PushHandlers of its pushes.
+ */
+class PushPolicy {
+ public:
+  struct Options {
+    // Pushes of a resource before its cancellations are held against it
+    uint32_t minPushes{10};
+    // Below this fraction of pushes not cancelled, a resource is suppressed
+    double minEffectiveness{0.5};
+    // While suppressed, one push in this many still goes out; 0 for none
+    uint32_t probeInterval{20};
+    // The counts are halved past this many pushes, to follow the clients
+    uint32_t maxPushes{200};
+    // The resources with stats, least recently pushed evicted first
+    size_t maxResources{1024};
+  };
+
+  struct Stats {
+    uint64_t pushes{0};
+    uint64_t cancels{0};
+    uint64_t bytesPushed{0};
+    uint64_t bytesCancelled{0};
+    // Pushes not admitted since the last one that was
+    uint64_t suppressed{0};
+  };
+
+  // True if the client sending request has url cached
+  using CacheDigestHook = std::function<bool(const HTTPMessage& request,
+                                             folly::StringPiece url)>;
+
+  explicit PushPolicy(const Options& options = Options());
+
+  PushPolicy(const PushPolicy&) = delete;
+  PushPolicy& operator=(const PushPolicy&) = delete;
+
+  void setCacheDigestHook(CacheDigestHook hook) {
+    cacheDigestHook_ = std::move(hook);
+  }
+
+  // Whether to push url in response to request
+  bool shouldPush(const HTTPMessage& request, const std::string& url);
+
+  // The push of url ended, with bytes of its body sent
+  void onPushComplete(const std::string& url, uint64_t bytes);
+
+  // The client reset the push of url with CANCEL, after bytes were sent
+  void onPushCancelled(const std::string& url, uint64_t bytes);
+
+  // Null if url has no stats
+  const Stats* getStats(const std::string& url) const;
+
+  // Pushes not admitted, for any reason
+  uint64_t getNumSuppressed() const {
+    return numSuppressed_;
+  }
+
+  // Pushes not admitted from the cache digest hook
+  uint64_t getNumCacheDigestHits() const {
+    return numCacheDigestHits_;
+  }
+
+ private:
+  bool isEffective(const Stats& stats) const;
+  void onOutcome(const std::string& url, uint64_t bytes, bool cancelled);
+
+  const Options options_;
+  CacheDigestHook cacheDigestHook_;
+  folly::EvictingCacheMap<std::string, Stats> stats_;
+  uint64_t numSuppressed_{0};
+  uint64_t numCacheDigestHits_{0};
+};
+
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/utils/RecyclingAllocator.h>
+
+namespace proxygen {
+
+namespace detail {
+struct RequestHandlerTag {};
+}
+
+/**
+ * Base recycling the memory of the objects a server allocates per request,
+ * the RequestHandlerAdaptor and the filters of the handler chain, on
+ * per-thread free lists (see ThreadLocalFreeList), so that once warm the
+ * chain of a request costs no allocation.  Only the memory is reused: the
+ * objects are constructed and destroyed as with plain new and delete, so
+ * they need no reset.
+ *
+ * Filters opt in by deriving from it as well:
+ *
+ *   class MyFilter : public Filter, public RecycledRequestHandler<MyFilter>
+ *
+ * Recycling is off until setRequestHandlerRecycling(true), which HTTPServer
+ * calls when HTTPServerOptions::recycleRequestHandlers is set.  Objects of
+ * classes deriving from T, of another size, go to the global allocator.
+ */
+template <typename T>
+class RecycledRequestHandler {
+ public:
+  static void* operator new(size_t size) {
+    if (size != sizeof(T)) {
+      return ::operator new(size);
+    }
+    return FreeList<T>::allocate();
+  }
+
+  static void operator delete(void* p, size_t size) {
+    if (size != sizeof(T)) {
+      ::operator delete(p);
+      return;
+    }
+    FreeList<T>::deallocate(p);
+  }
+
+  // operator new above hides the placement form
+  static void* operator new(size_t, void* p) noexcept {
+    return p;
+  }
+  static void operator delete(void*, void*) noexcept {}
+
+ private:
+  // One switch for all, one list per size.  A template for T to be complete
+  // where used
+  template <typename U>
+  using FreeList = ThreadLocalFreeList<detail::RequestHandlerTag, sizeof(U)>;
+};
+
+/**
+ * Switches recycling for every RecycledRequestHandler.
+ */
+inline void setRequestHandlerRecycling(bool enabled) {
+  ThreadLocalFreeList<detail::RequestHandlerTag,
+                      sizeof(void*)>::enable(enabled);
+}
+
+}
@@ -150,6 +150,17 @@ void RequestHandlerAdaptor::sendBody(std::unique_ptr<folly::IOBuf> b) noexcept {
   txn_->sendBody(std::move(b));
 }
 
+void RequestHandlerAdaptor::sendFileBody(std::shared_ptr<folly::File> file,
+                                         off_t offset,
+                                         size_t length) noexcept {
+  txn_->sendFileBody(std::move(file), offset, length);
+}
+
+bool RequestHandlerAdaptor::spliceTunnel(
+    folly::AsyncSocket& upstream) noexcept {
+  return txn_->spliceTunnel(upstream);
+}
+
 void RequestHandlerAdaptor::sendChunkTerminator() noexcept {
   txn_->sendChunkTerminator();
 }
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <proxygen/httpserver/RecycledRequestHandler.h>
 #include <proxygen/httpserver/ResponseHandler.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 
@@ -34,7 +35,8 @@ class PushHandler;
  */
 class RequestHandlerAdaptor
     : public HTTPTransactionHandler,
-      public ResponseHandler {
+      public ResponseHandler,
+      public RecycledRequestHandler<RequestHandlerAdaptor> {
  public:
   explicit RequestHandlerAdaptor(RequestHandler* requestHandler);
 
@@ -58,6 +60,10 @@ class RequestHandlerAdaptor
   void sendHeaders(HTTPMessage& msg) noexcept override;
   void sendChunkHeader(size_t len) noexcept override;
   void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override;
+  bool spliceTunnel(folly::AsyncSocket& upstream) noexcept override;
   void sendChunkTerminator() noexcept override;
   void sendEOM() noexcept override;
   void sendAbort() noexcept override;
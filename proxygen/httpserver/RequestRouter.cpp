@@ -0,0 +1,262 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/RequestRouter.h>
+
+#include <algorithm>
+#include <array>
+#include <proxygen/httpserver/filters/DirectResponseHandler.h>
+#include <stdexcept>
+
+namespace proxygen {
+
+namespace {
+
+constexpr size_t kNumMethods = size_t(HTTPMethod::UNSUB) + 1;
+
+// The segment of path starting at pos, and sets pos past it, to npos if it
+// is the last one
+folly::StringPiece nextSegment(folly::StringPiece path, size_t& pos) {
+  auto slash = path.find('/', pos);
+  folly::StringPiece segment;
+  if (slash == std::string::npos) {
+    segment = path.subpiece(pos);
+    pos = std::string::npos;
+  } else {
+    segment = path.subpiece(pos, slash - pos);
+    pos = slash + 1;
+  }
+  return segment;
+}
+
+// Where the segments of a path start, past its leading '/', or npos if it
+// has none
+size_t firstSegment(folly::StringPiece path) {
+  return path.size() > 1 ? 1 : std::string::npos;
+}
+
+}
+
+struct RequestRouter::Node {
+  using Literal = std::pair<std::string, std::unique_ptr<Node>>;
+
+  Node() {
+    routes.fill(-1);
+  }
+
+  static bool literalLess(const Literal& literal, folly::StringPiece s) {
+    return folly::StringPiece(literal.first) < s;
+  }
+
+  const Node* findLiteral(folly::StringPiece segment) const {
+    auto it = std::lower_bound(literals.begin(), literals.end(), segment,
+                               literalLess);
+    if (it == literals.end() || it->first != segment) {
+      return nullptr;
+    }
+    return it->second.get();
+  }
+
+  Node* addLiteral(folly::StringPiece segment) {
+    auto it = std::lower_bound(literals.begin(), literals.end(), segment,
+                               literalLess);
+    if (it == literals.end() || it->first != segment) {
+      it = literals.emplace(it, segment.str(), std::make_unique<Node>());
+    }
+    return it->second.get();
+  }
+
+  // The route of method ending here, if any, and sets pathMatched if there
+  // are only routes of other methods
+  int32_t getRoute(folly::Optional<HTTPMethod> method,
+                   const Node*& pathMatched) const {
+    if (method && routes[size_t(*method)] >= 0) {
+      return routes[size_t(*method)];
+    }
+    if (anyRoute >= 0) {
+      return anyRoute;
+    }
+    if (methodNotAllowed && !pathMatched) {
+      pathMatched = this;
+    }
+    return -1;
+  }
+
+  // Sorted by segment
+  std::vector<Literal> literals;
+  std::string paramName;
+  std::unique_ptr<Node> param;
+  std::string wildcardName;
+  // Only has routes
+  std::unique_ptr<Node> wildcard;
+
+  // The routes ending here, by method
+  std::array<int32_t, kNumMethods> routes;
+  int32_t anyRoute{-1};
+  // With the Allow header of the methods routed here
+  std::shared_ptr<const PrebuiltResponse> methodNotAllowed;
+};
+
+RequestRouter::RequestRouter()
+    : root_(std::make_unique<Node>()),
+      notFound_(PrebuiltResponse::create(404, "Not Found")) {}
+
+RequestRouter::~RequestRouter() {}
+
+size_t RequestRouter::addRoute(folly::Optional<HTTPMethod> method,
+                               folly::StringPiece pattern,
+                               HandlerFactory factory) {
+  if (pattern.empty() || pattern.front() != '/') {
+    throw std::invalid_argument("Route pattern must start with '/'");
+  }
+  auto node = root_.get();
+  size_t pos = firstSegment(pattern);
+  while (pos != std::string::npos) {
+    auto segment = nextSegment(pattern, pos);
+    if (!segment.empty() && (segment.front() == ':' ||
+                             segment.front() == '*')) {
+      auto name = segment.subpiece(1);
+      if (name.empty()) {
+        throw std::invalid_argument("Route parameter without a name");
+      }
+      bool wildcard = segment.front() == '*';
+      if (wildcard && pos != std::string::npos) {
+        throw std::invalid_argument("Route wildcard must be last");
+      }
+      auto& child = wildcard ? node->wildcard : node->param;
+      auto& childName = wildcard ? node->wildcardName : node->paramName;
+      if (!child) {
+        child = std::make_unique<Node>();
+        childName = name.str();
+      } else if (childName != name) {
+        throw std::invalid_argument(
+          "Route parameter named differently from another route: " +
+          pattern.str());
+      }
+      node = child.get();
+    } else {
+      node = node->addLiteral(segment);
+    }
+  }
+
+  auto& route = method ? node->routes[size_t(*method)] : node->anyRoute;
+  if (route >= 0) {
+    throw std::invalid_argument("Route already added: " + pattern.str());
+  }
+  route = routes_.size();
+  routes_.push_back(Route{pattern.str(), std::move(factory)});
+
+  if (method) {
+    std::string allow;
+    for (size_t i = 0; i < kNumMethods; i++) {
+      if (node->routes[i] >= 0) {
+        if (!allow.empty()) {
+          allow += ", ";
+        }
+        allow += methodToString(HTTPMethod(i));
+      }
+    }
+    HTTPHeaders headers;
+    headers.set(HTTP_HEADER_ALLOW, allow);
+    node->methodNotAllowed =
+      PrebuiltResponse::create(405, "Method Not Allowed", headers);
+  }
+  return route;
+}
+
+const std::string& RequestRouter::getPattern(size_t routeId) const {
+  return routes_.at(routeId).pattern;
+}
+
+int32_t RequestRouter::match(const Node& node,
+                             folly::StringPiece path,
+                             size_t pos,
+                             folly::Optional<HTTPMethod> method,
+                             RouteParams& params,
+                             const Node*& pathMatched) const {
+  if (pos == std::string::npos) {
+    return node.getRoute(method, pathMatched);
+  }
+  size_t segmentPos = pos;
+  auto segment = nextSegment(path, pos);
+  if (auto child = node.findLiteral(segment)) {
+    auto route = match(*child, path, pos, method, params, pathMatched);
+    if (route >= 0) {
+      return route;
+    }
+  }
+  if (node.param && !segment.empty()) {
+    params.push(node.paramName, segment);
+    auto route = match(*node.param, path, pos, method, params, pathMatched);
+    if (route >= 0) {
+      return route;
+    }
+    params.pop();
+  }
+  if (node.wildcard) {
+    auto route = node.wildcard->getRoute(method, pathMatched);
+    if (route >= 0) {
+      params.push(node.wildcardName, path.subpiece(segmentPos));
+      return route;
+    }
+  }
+  return -1;
+}
+
+folly::Optional<size_t> RequestRouter::findRoute(
+    folly::Optional<HTTPMethod> method,
+    folly::StringPiece path,
+    RouteParams& params,
+    bool* pathMatched) const {
+  const Node* matched = nullptr;
+  int32_t route = -1;
+  if (!path.empty() && path.front() == '/') {
+    route = match(*root_, path, firstSegment(path), method, params, matched);
+  }
+  if (pathMatched) {
+    *pathMatched = matched != nullptr;
+  }
+  if (route < 0) {
+    return folly::none;
+  }
+  return size_t(route);
+}
+
+RequestHandler* RequestRouter::onRequest(RequestHandler* upstream,
+                                         HTTPMessage* msg) noexcept {
+  RouteParams params;
+  const Node* matched = nullptr;
+  int32_t route = -1;
+  folly::StringPiece path(msg->getPath());
+  if (!path.empty() && path.front() == '/') {
+    route = match(*root_, path, firstSegment(path), msg->getMethod(),
+                  params, matched);
+  }
+  if (route >= 0) {
+    if (stats_) {
+      stats_->recordRouted(route);
+    }
+    return routes_[route].factory(msg, params);
+  }
+  if (upstream) {
+    return upstream;
+  }
+  if (matched) {
+    if (stats_) {
+      stats_->recordMethodNotAllowed();
+    }
+    return new DirectResponseHandler(matched->methodNotAllowed);
+  }
+  if (stats_) {
+    stats_->recordNotFound();
+  }
+  return new DirectResponseHandler(notFound_);
+}
+
+}
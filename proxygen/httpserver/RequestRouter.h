@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/small_vector.h>
+#include <proxygen/httpserver/PrebuiltResponse.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * The parameters a route extracted from a request's path, by name.  They
+ * point into the path of the HTTPMessage the request was routed from, and
+ * are valid as long as it is not changed.
+ */
+class RouteParams {
+ public:
+  folly::Optional<folly::StringPiece> get(folly::StringPiece name) const {
+    for (const auto& param : params_) {
+      if (param.first == name) {
+        return param.second;
+      }
+    }
+    return folly::none;
+  }
+
+  size_t size() const {
+    return params_.size();
+  }
+
+ private:
+  friend class RequestRouter;
+
+  void push(folly::StringPiece name, folly::StringPiece value) {
+    params_.emplace_back(name, value);
+  }
+
+  void pop() {
+    params_.pop_back();
+  }
+
+  folly::small_vector<std::pair<folly::StringPiece, folly::StringPiece>, 4>
+    params_;
+};
+
+/**
+ * A terminal RequestHandlerFactory handing each request to the handler of
+ * the route its method and path match.  Patterns are paths whose segments
+ * are either literal, a parameter ":name" matching one non empty segment,
+ * or, last, a wildcard "*name" matching the rest of the path:
+ *
+ *   router.addRoute(HTTPMethod::GET, "/users/:id/files", factory);
+ *
+ * The patterns are compiled into a tree of path segments, where literal
+ * segments are searched in sorted arrays, and literals are tried before a
+ * parameter, and a parameter before a wildcard.  Routing a request
+ * allocates nothing but the handler.
+ *
+ * Requests matching no route go to the next handler in the chain if there
+ * is one, or else get a 404; those matching only routes of other methods
+ * get a 405 with an Allow header.  Routes must all be added before the
+ * server starts, lookups are then safe from any thread.
+ */
+class RequestRouter : public RequestHandlerFactory {
+ public:
+  using HandlerFactory =
+    std::function<RequestHandler*(HTTPMessage*, const RouteParams&)>;
+
+  /**
+   * Hooks for per route stats, called from the threads handling the
+   * requests.
+   */
+  class Stats {
+   public:
+    virtual ~Stats() {}
+    // A request was routed to the route addRoute() returned routeId for
+    virtual void recordRouted(size_t routeId) noexcept = 0;
+    // No route matched the path of a request
+    virtual void recordNotFound() noexcept = 0;
+    // Routes matched the path of a request, but not its method
+    virtual void recordMethodNotAllowed() noexcept {}
+  };
+
+  RequestRouter();
+  ~RequestRouter() override;
+
+  /**
+   * Adds the route of pattern for method, or for all methods, including
+   * extension methods, that have no route of their own.  Returns the route
+   * id passed to the stats.  The handler factory must return a handler;
+   * the params it gets are only valid during the call.  Throws
+   * std::invalid_argument on a malformed pattern or one that is already
+   * routed for the method.
+   */
+  size_t addRoute(folly::Optional<HTTPMethod> method,
+                  folly::StringPiece pattern,
+                  HandlerFactory factory);
+
+  void setStats(Stats* stats) {
+    stats_ = stats;
+  }
+
+  size_t getNumRoutes() const {
+    return routes_.size();
+  }
+
+  const std::string& getPattern(size_t routeId) const;
+
+  /**
+   * The route of the request, with its parameters, or none.  Sets
+   * *pathMatched if a route matched the path but not the method.
+   */
+  folly::Optional<size_t> findRoute(folly::Optional<HTTPMethod> method,
+                                    folly::StringPiece path,
+                                    RouteParams& params,
+                                    bool* pathMatched = nullptr) const;
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler* upstream,
+                            HTTPMessage* msg) noexcept override;
+
+ private:
+  struct Node;
+
+  struct Route {
+    std::string pattern;
+    HandlerFactory factory;
+  };
+
+  // The index of the route matching path from pos down node, or -1
+  int32_t match(const Node& node,
+                folly::StringPiece path,
+                size_t pos,
+                folly::Optional<HTTPMethod> method,
+                RouteParams& params,
+                const Node*& pathMatched) const;
+
+  std::unique_ptr<Node> root_;
+  std::vector<Route> routes_;
+  Stats* stats_{nullptr};
+  std::shared_ptr<const PrebuiltResponse> notFound_;
+};
+
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <folly/ScopeGuard.h>
+#include <folly/String.h>
 #include <proxygen/httpserver/ResponseHandler.h>
 
 namespace proxygen {
@@ -60,6 +61,12 @@ namespace proxygen {
  * ResponseBuilder(handler)
  *    .rejectUpgradeRequest() // send '400 Bad Request'
  *
+ * 4. Hint at the subresources of a response still being prepared
+ *
+ * ResponseBuilder(handler)
+ *    .sendEarlyHints({"</style.css>; rel=preload; as=style"});
+ *
+ * Responses sent as is many times are cheaper as a PrebuiltResponse.
  */
 class ResponseBuilder {
  public:
@@ -104,6 +111,17 @@ class ResponseBuilder {
     return *this;
   }
 
+  /**
+   * Send the headers of a shared template (built once with
+   * HTTPHeaderTemplate::create()) ahead of any headers added with header().
+   */
+  ResponseBuilder& headerTemplate(
+      std::shared_ptr<const HTTPHeaderTemplate> tmpl) {
+    CHECK(headers_) << "You need to call `status` before adding headers";
+    headers_->setHeaderTemplate(std::move(tmpl));
+    return *this;
+  }
+
   ResponseBuilder& body(std::unique_ptr<folly::IOBuf> bodyIn) {
     if (bodyIn) {
       if (body_) {
@@ -186,6 +204,24 @@ class ResponseBuilder {
     }
   }
 
+  /**
+   * Sends a '103 Early Hints' with the given Link values coalesced into one
+   * header, ahead of the final response.  Leaves the response in progress
+   * untouched, so it can come before or after status().  The hints are
+   * dropped for HTTP/1.0 clients, which can't receive 1xx responses.
+   */
+  void sendEarlyHints(const std::vector<std::string>& links) {
+    if (links.empty()) {
+      return;
+    }
+    HTTPMessage hints;
+    hints.setHTTPVersion(1, 1);
+    hints.setStatusCode(103);
+    hints.setStatusMessage("Early Hints");
+    hints.getHeaders().add(HTTP_HEADER_LINK, folly::join(", ", links));
+    txn_->sendHeaders(hints);
+  }
+
   enum class UpgradeType {
     CONNECT_REQUEST = 0,
     HTTP_UPGRADE,
@@ -62,6 +62,26 @@ class ResponseHandler {
 
   virtual void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept = 0;
 
+  /**
+   * Sends length bytes of file, from offset, as body without reading them
+   * into memory where the transport allows.  See
+   * HTTPTransaction::sendFileBody.
+   */
+  virtual void sendFileBody(std::shared_ptr<folly::File> /*file*/,
+                            off_t /*offset*/,
+                            size_t /*length*/) noexcept {
+    LOG(FATAL) << "sendFileBody not supported";
+  }
+
+  /**
+   * After the 2xx response to a CONNECT, relays the tunnel to the connected
+   * upstream socket in the kernel, if the transport can.  See
+   * HTTPTransaction::spliceTunnel.
+   */
+  virtual bool spliceTunnel(folly::AsyncSocket& /*upstream*/) noexcept {
+    return false;
+  }
+
   virtual void sendChunkTerminator() noexcept = 0;
 
   virtual void sendEOM() noexcept = 0;
@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/SocketTakeover.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace proxygen {
+
+namespace {
+// Guards against a peer speaking another protocol or version
+const uint32_t kTakeoverMagic = 0x50584731; // "PXG1"
+// Far more addresses than any server binds
+const uint64_t kMaxAddressIndex = 1024;
+
+struct Message {
+  uint32_t magic;
+  uint32_t type;
+  uint64_t index;
+};
+
+[[noreturn]] void throwErrno(const char* what) {
+  throw std::system_error(errno, std::system_category(), what);
+}
+
+sockaddr_un makeAddress(const std::string& path) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::system_error(ENAMETOOLONG, std::system_category(),
+                            "takeover socket path");
+  }
+  memcpy(addr.sun_path, path.c_str(), path.size());
+  return addr;
+}
+
+int makeUnixSocket() {
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throwErrno("takeover socket()");
+  }
+  return fd;
+}
+
+void sendMessage(int unixFd, SocketTakeover::SocketType type, size_t index,
+                 int fd) {
+  Message message{kTakeoverMagic, static_cast<uint32_t>(type), index};
+  iovec iov{&message, sizeof(message)};
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    cmsghdr align;
+  } control;
+  if (fd >= 0) {
+    memset(&control, 0, sizeof(control));
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  }
+
+  ssize_t n;
+  do {
+    n = ::sendmsg(unixFd, &msg, MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    throwErrno("takeover sendmsg()");
+  }
+  if (size_t(n) != sizeof(message)) {
+    throw std::system_error(EPROTO, std::system_category(),
+                            "takeover short write");
+  }
+}
+}
+
+int SocketTakeover::listen(const std::string& path) {
+  auto addr = makeAddress(path);
+  int fd = makeUnixSocket();
+  ::unlink(path.c_str());
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::listen(fd, 1) != 0) {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    throwErrno("takeover listen()");
+  }
+  return fd;
+}
+
+int SocketTakeover::accept(int listenFd) {
+  int fd;
+  do {
+    fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    throwErrno("takeover accept()");
+  }
+  return fd;
+}
+
+int SocketTakeover::connect(const std::string& path) {
+  auto addr = makeAddress(path);
+  int fd = makeUnixSocket();
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    throwErrno("takeover connect()");
+  }
+  return fd;
+}
+
+void SocketTakeover::sendSocket(int unixFd, SocketType type, size_t index,
+                                int fd) {
+  sendMessage(unixFd, type, index, fd);
+}
+
+void SocketTakeover::sendEnd(int unixFd) {
+  sendMessage(unixFd, SocketType::END, 0, -1);
+}
+
+SocketTakeover::Sockets SocketTakeover::receiveSockets(int unixFd) {
+  Sockets sockets;
+  // Closes the fds received so far on errors
+  auto fail = [&sockets] (int err, const char* what) {
+    for (auto& fds : sockets.listeningFds) {
+      for (auto fd : fds) {
+        ::close(fd);
+      }
+    }
+    for (auto& conn : sockets.connectionFds) {
+      ::close(conn.first);
+    }
+    throw std::system_error(err, std::system_category(), what);
+  };
+
+  while (true) {
+    Message message;
+    iovec iov{&message, sizeof(message)};
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    union {
+      char buf[CMSG_SPACE(sizeof(int))];
+      cmsghdr align;
+    } control;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n;
+    do {
+      n = ::recvmsg(unixFd, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+      fail(errno, "takeover recvmsg()");
+    }
+
+    int fd = -1;
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+      memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (size_t(n) != sizeof(message) || message.magic != kTakeoverMagic ||
+        message.index > kMaxAddressIndex) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      fail(EPROTO, n == 0 ? "takeover peer closed" : "takeover bad message");
+    }
+
+    switch (static_cast<SocketType>(message.type)) {
+      case SocketType::END:
+        return sockets;
+      case SocketType::LISTENING:
+        if (fd >= 0) {
+          if (sockets.listeningFds.size() <= message.index) {
+            sockets.listeningFds.resize(message.index + 1);
+          }
+          sockets.listeningFds[message.index].push_back(fd);
+          continue;
+        }
+        break;
+      case SocketType::CONNECTION:
+        if (fd >= 0) {
+          sockets.connectionFds.emplace_back(fd, message.index);
+          continue;
+        }
+        break;
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    fail(EPROTO, "takeover bad socket");
+  }
+}
+
+}
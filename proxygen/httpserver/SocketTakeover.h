@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Passes the sockets of a running HTTPServer to a new process over a Unix
+ * socket, for restarts without closing the listening sockets nor the idle
+ * connections.  See HTTPServer::handOverSockets() and
+ * HTTPServer::takeOverSockets().
+ *
+ * Every message carries one file descriptor (SCM_RIGHTS) and the index of
+ * the server address it belongs to, until an END message.  The functions
+ * throw std::system_error on errors.
+ */
+class SocketTakeover {
+ public:
+  enum class SocketType : uint8_t {
+    LISTENING = 0,
+    CONNECTION = 1,
+    END = 2,
+  };
+
+  struct Sockets {
+    // The listening fds of each server address, in the order of the
+    // addresses
+    std::vector<std::vector<int>> listeningFds;
+    // The connection fds, with the index of their server address
+    std::vector<std::pair<int, size_t>> connectionFds;
+  };
+
+  /**
+   * Binds and listens on a Unix socket at path, replacing a stale one, for
+   * the new process to connect to.  Returns the listening fd.
+   */
+  static int listen(const std::string& path);
+
+  /**
+   * Blocks until the new process connects to the listening fd, returns the
+   * connected fd.
+   */
+  static int accept(int listenFd);
+
+  /**
+   * Connects to the old process listening at path, returns the connected
+   * fd.
+   */
+  static int connect(const std::string& path);
+
+  /**
+   * Sends fd, which is left open, as a socket of the address index.
+   */
+  static void sendSocket(int unixFd, SocketType type, size_t index, int fd);
+
+  /**
+   * Ends the sockets sent.
+   */
+  static void sendEnd(int unixFd);
+
+  /**
+   * Receives the sockets sent until the END message.
+   */
+  static Sockets receiveSockets(int unixFd);
+};
+
+}
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/TLSResumption.h>
+
+#include <folly/Bits.h>
+#include <folly/String.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+namespace proxygen {
+
+DerivedTicketSeedProvider::DerivedTicketSeedProvider(
+    std::string secret,
+    std::chrono::seconds rotationInterval)
+    : rotationInterval_(std::max(rotationInterval, std::chrono::seconds(1))),
+      secret_(std::move(secret)) {
+}
+
+wangle::TLSTicketKeySeeds DerivedTicketSeedProvider::getSeeds() {
+  return getSeedsAt(std::chrono::system_clock::now());
+}
+
+wangle::TLSTicketKeySeeds DerivedTicketSeedProvider::getSeedsAt(
+    std::chrono::system_clock::time_point now) {
+  auto sinceEpoch = std::chrono::duration_cast<std::chrono::seconds>(
+    now.time_since_epoch());
+  int64_t interval = sinceEpoch.count() / rotationInterval_.count();
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  wangle::TLSTicketKeySeeds seeds;
+  seeds.oldSeeds.push_back(deriveSeed(secret_, interval - 1));
+  if (!previousSecret_.empty()) {
+    // Issued before setSecret()
+    seeds.oldSeeds.push_back(deriveSeed(previousSecret_, interval - 1));
+    seeds.oldSeeds.push_back(deriveSeed(previousSecret_, interval));
+  }
+  seeds.currentSeeds.push_back(deriveSeed(secret_, interval));
+  seeds.newSeeds.push_back(deriveSeed(secret_, interval + 1));
+  return seeds;
+}
+
+void DerivedTicketSeedProvider::setSecret(std::string secret) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (secret != secret_) {
+    previousSecret_ = std::move(secret_);
+    secret_ = std::move(secret);
+  }
+}
+
+std::string DerivedTicketSeedProvider::deriveSeed(const std::string& secret,
+                                                  int64_t interval) {
+  uint64_t data = folly::Endian::big(uint64_t(interval));
+  uint8_t seed[EVP_MAX_MD_SIZE];
+  unsigned int seedLength = 0;
+  HMAC(EVP_sha256(), secret.data(), secret.size(),
+       reinterpret_cast<const uint8_t*>(&data), sizeof(data),
+       seed, &seedLength);
+  // The acceptors take hex seeds
+  return folly::hexlify(folly::ByteRange(seed, seedLength));
+}
+
+double TLSResumptionStats::getHitRate() const {
+  uint64_t resumed = sessionIdResumptions.load(std::memory_order_relaxed) +
+    ticketResumptions.load(std::memory_order_relaxed);
+  uint64_t total = resumed + fullHandshakes.load(std::memory_order_relaxed);
+  return total == 0 ? 0 : double(resumed) / total;
+}
+
+}
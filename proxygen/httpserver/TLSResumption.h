@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <wangle/ssl/SSLUtil.h>
+#include <wangle/ssl/TLSTicketKeySeeds.h>
+
+namespace proxygen {
+
+/**
+ * Where the seeds of the TLS session ticket keys of a server come from, see
+ * HTTPServerOptions::ticketSeedProvider.  The server asks for them when it
+ * starts and every ticketSeedRefreshInterval after, and hands them to all
+ * its acceptors, OpenSSL and fizz alike, when they changed.  Servers with
+ * the same seeds resume each other's sessions.
+ *
+ * Rotating means moving the current seeds to old and the new ones to
+ * current: tickets are issued with the current seeds and accepted with any
+ * of the three, so that servers that are a refresh apart still agree.
+ */
+class TicketSeedProvider {
+ public:
+  virtual ~TicketSeedProvider() = default;
+
+  /**
+   * The seeds to use now.  Called from the server's thread, so a provider
+   * distributing the seeds of a fleet should fetch them on its own and
+   * return the last it got.
+   */
+  virtual wangle::TLSTicketKeySeeds getSeeds() = 0;
+};
+
+/**
+ * Seeds derived from a secret shared by a fleet and the time, rotating
+ * every rotationInterval: the seeds of the interval starting at each
+ * multiple of it since the epoch are an HMAC of its number with the
+ * secret, so that every server with the secret and a roughly right clock
+ * has the same seeds, without any coordination.
+ *
+ * Thread-safe.
+ */
+class DerivedTicketSeedProvider : public TicketSeedProvider {
+ public:
+  DerivedTicketSeedProvider(std::string secret,
+                            std::chrono::seconds rotationInterval);
+
+  wangle::TLSTicketKeySeeds getSeeds() override;
+
+  wangle::TLSTicketKeySeeds getSeedsAt(
+    std::chrono::system_clock::time_point now);
+
+  /**
+   * Replaces the secret, e.g. from the fleet's secret store.  The tickets
+   * of the previous one are still accepted until the next call.
+   */
+  void setSecret(std::string secret);
+
+ private:
+  static std::string deriveSeed(const std::string& secret, int64_t interval);
+
+  const std::chrono::seconds rotationInterval_;
+  std::mutex mutex_;
+  std::string secret_;
+  std::string previousSecret_;
+};
+
+/**
+ * How the TLS handshakes of a server ended, see
+ * HTTPServerOptions::resumptionStats.
+ */
+struct TLSResumptionStats {
+  void recordHandshake(wangle::SSLResumeEnum resume) {
+    switch (resume) {
+      case wangle::SSLResumeEnum::HANDSHAKE:
+        fullHandshakes.fetch_add(1, std::memory_order_relaxed);
+        break;
+      case wangle::SSLResumeEnum::RESUME_SESSION_ID:
+        sessionIdResumptions.fetch_add(1, std::memory_order_relaxed);
+        break;
+      case wangle::SSLResumeEnum::RESUME_TICKET:
+        ticketResumptions.fetch_add(1, std::memory_order_relaxed);
+        break;
+      case wangle::SSLResumeEnum::NA:
+        break;
+    }
+  }
+
+  // The share of the handshakes resumed, 0 before any
+  double getHitRate() const;
+
+  std::atomic<uint64_t> fullHandshakes{0};
+  std::atomic<uint64_t> sessionIdResumptions{0};
+  std::atomic<uint64_t> ticketResumptions{0};
+  // Times the ticketSeedProvider's seeds changed
+  std::atomic<uint64_t> seedUpdates{0};
+};
+
+}
@@ -0,0 +1,123 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/AccessLogWriter.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter capturing an AccessLogRecord of each request and pushing
+ * it to its thread's ring of an AccessLogWriter once the request completes
+ * or fails; the formatting and writing happen on the writer's thread.
+ */
+class AccessLogFilter : public Filter {
+ public:
+  AccessLogFilter(RequestHandler* upstream, AccessLogWriter::Ring& ring)
+      : Filter(upstream), ring_(ring) {}
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    start_ = getCurrentTime();
+    record_.timestampMs = millisecondsSinceEpoch().count();
+    auto method = msg->getMethod();
+    if (method) {
+      record_.method = uint8_t(*method);
+    }
+    record_.setPath(msg->getPath());
+    const auto& client = msg->getClientAddress();
+    if (client.isInitialized() && client.isFamilyInet()) {
+      auto addr = client.getIPAddress();
+      record_.clientAddressLength = addr.byteCount();
+      memcpy(record_.clientAddress, addr.bytes(), addr.byteCount());
+      record_.clientPort = client.getPort();
+    }
+    upstream_->onRequest(std::move(msg));
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    record_.bytesReceived += body->computeChainDataLength();
+    upstream_->onBody(std::move(body));
+  }
+
+  void requestComplete() noexcept override {
+    record();
+    Filter::requestComplete();
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    record();
+    Filter::onError(err);
+  }
+
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    // The final status, past any 1xx
+    record_.statusCode = msg.getStatusCode();
+    downstream_->sendHeaders(msg);
+  }
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (body) {
+      record_.bytesSent += body->computeChainDataLength();
+    }
+    downstream_->sendBody(std::move(body));
+  }
+
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override {
+    record_.bytesSent += length;
+    downstream_->sendFileBody(std::move(file), offset, length);
+  }
+
+ private:
+  void record() {
+    record_.durationUs = microsecondsBetween(getCurrentTime(), start_).count();
+    ring_.push(record_);
+  }
+
+  // The writer's, for this thread
+  AccessLogWriter::Ring& ring_;
+  TimePoint start_{getCurrentTime()};
+  AccessLogRecord record_;
+};
+
+class AccessLogFilterFactory : public RequestHandlerFactory {
+ public:
+  // writer must outlive the server using the factory
+  explicit AccessLogFilterFactory(std::shared_ptr<AccessLogWriter> writer)
+      : writer_(std::move(writer)) {}
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+    *ring_ = writer_->newRing();
+  }
+
+  void onServerStop() noexcept override {
+    *ring_ = nullptr;
+  }
+
+  RequestHandler* onRequest(RequestHandler* h, HTTPMessage* /*msg*/)
+      noexcept override {
+    auto ring = *ring_;
+    if (!ring) {
+      return h;
+    }
+    return new AccessLogFilter(h, *ring);
+  }
+
+ private:
+  std::shared_ptr<AccessLogWriter> writer_;
+  folly::ThreadLocal<AccessLogWriter::Ring*> ring_;
+};
+
+}
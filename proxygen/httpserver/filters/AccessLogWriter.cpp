@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/filters/AccessLogWriter.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/IPAddress.h>
+#include <time.h>
+
+namespace proxygen {
+
+AccessLogWriter::AccessLogWriter(const Options& options)
+    : options_(options),
+      file_(options.path, O_WRONLY | O_APPEND | O_CREAT),
+      thread_([this] { run(); }) {}
+
+AccessLogWriter::~AccessLogWriter() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+AccessLogWriter::Ring* AccessLogWriter::newRing() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  rings_.emplace_back(new Ring(std::max<size_t>(options_.ringSize, 1)));
+  return rings_.back().get();
+}
+
+uint64_t AccessLogWriter::getNumDropped() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  uint64_t dropped = 0;
+  for (const auto& ring : rings_) {
+    dropped += ring->getNumDropped();
+  }
+  return dropped;
+}
+
+void AccessLogWriter::format(const AccessLogRecord& record,
+                             std::string& out) {
+  if (record.clientAddressLength > 0) {
+    try {
+      out += folly::IPAddress::fromBinary(
+        folly::ByteRange(record.clientAddress,
+                         record.clientAddressLength)).str();
+    } catch (const std::exception&) {
+      out += '-';
+    }
+  } else {
+    out += '-';
+  }
+
+  time_t seconds = record.timestampMs / 1000;
+  struct tm tm;
+  gmtime_r(&seconds, &tm);
+  char date[32];
+  size_t dateLen = strftime(date, sizeof(date), "%d/%b/%Y:%H:%M:%S +0000",
+                            &tm);
+  out += " - - [";
+  out.append(date, dateLen);
+  out += "] \"";
+  if (record.method != AccessLogRecord::kUnknownMethod) {
+    out += methodToString(HTTPMethod(record.method));
+  } else {
+    out += '-';
+  }
+  out += ' ';
+  out.append(record.path, record.pathLength);
+  out += "\" ";
+  folly::toAppend(record.statusCode, ' ', record.bytesSent, ' ',
+                  record.bytesReceived, ' ', record.durationUs, &out);
+  out += '\n';
+}
+
+void AccessLogWriter::run() {
+  bool stopping = false;
+  while (!stopping) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stopping = cv_.wait_for(lock, options_.flushInterval,
+                              [this] { return stopping_; });
+    }
+    drain();
+  }
+}
+
+void AccessLogWriter::drain() {
+  std::string batch;
+  uint64_t numRecords = 0;
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& ring : rings_) {
+    while (auto record = ring->queue_.frontPtr()) {
+      if (batch.empty()) {
+        batch.reserve(options_.maxBatchBytes);
+      }
+      format(*record, batch);
+      ring->queue_.popFront();
+      numRecords++;
+      if (batch.size() >= options_.maxBatchBytes) {
+        write(batch);
+        batch.clear();
+      }
+    }
+  }
+  if (!batch.empty()) {
+    write(batch);
+  }
+  written_.fetch_add(numRecords, std::memory_order_relaxed);
+}
+
+void AccessLogWriter::write(const std::string& batch) {
+  if (folly::writeFull(file_.fd(), batch.data(), batch.size()) !=
+      ssize_t(batch.size())) {
+    PLOG(ERROR) << "Failed to append to " << options_.path;
+  }
+}
+
+}
@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+#include <folly/ProducerConsumerQueue.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * What an access log line is made of, captured on the request's thread in a
+ * fixed size record that takes no allocation to fill nor to queue.
+ */
+struct AccessLogRecord {
+  static constexpr size_t kMaxPathLength = 128;
+  static constexpr uint8_t kUnknownMethod = 0xff;
+
+  // When the request began
+  int64_t timestampMs{0};
+  uint64_t durationUs{0};
+  uint64_t bytesReceived{0};
+  uint64_t bytesSent{0};
+  // 0 if no response was sent
+  uint16_t statusCode{0};
+  uint16_t clientPort{0};
+  // 4, 16, or 0 for a client without an IP address
+  uint8_t clientAddressLength{0};
+  uint8_t clientAddress[16];
+  // An HTTPMethod, or kUnknownMethod
+  uint8_t method{kUnknownMethod};
+  // Of the path, truncated to kMaxPathLength
+  uint8_t pathLength{0};
+  char path[kMaxPathLength];
+
+  void setPath(folly::StringPiece p) {
+    pathLength = p.size() < kMaxPathLength ? p.size() : kMaxPathLength;
+    memcpy(path, p.data(), pathLength);
+  }
+};
+
+static_assert(std::is_trivially_copyable<AccessLogRecord>::value,
+              "AccessLogRecord is copied around as raw bytes");
+
+/**
+ * Writes the access log of a server from a background thread: every
+ * flushInterval, it drains the records queued by the worker threads,
+ * formats them and appends them to the file in batches of up to
+ * maxBatchBytes, with O_APPEND so that other writers and log rotation
+ * can share the file.
+ *
+ * Each worker thread gets its own Ring, a bounded single producer single
+ * consumer queue: push() takes no lock and never blocks, and drops the
+ * record when the ring is full.
+ */
+class AccessLogWriter {
+ public:
+  struct Options {
+    std::string path;
+    // Records waiting per worker thread
+    size_t ringSize{1024};
+    std::chrono::milliseconds flushInterval{100};
+    size_t maxBatchBytes{64 * 1024};
+  };
+
+  class Ring {
+   public:
+    // False if the record was dropped
+    bool push(const AccessLogRecord& record) {
+      if (!queue_.write(record)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      return true;
+    }
+
+    uint64_t getNumDropped() const {
+      return dropped_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    friend class AccessLogWriter;
+
+    // the queue holds one less than its size
+    explicit Ring(size_t size) : queue_(size + 1) {}
+
+    folly::ProducerConsumerQueue<AccessLogRecord> queue_;
+    std::atomic<uint64_t> dropped_{0};
+  };
+
+  // Throws if the file can't be opened
+  explicit AccessLogWriter(const Options& options);
+
+  // Writes the records still queued, then stops the thread
+  ~AccessLogWriter();
+
+  AccessLogWriter(const AccessLogWriter&) = delete;
+  AccessLogWriter& operator=(const AccessLogWriter&) = delete;
+
+  /**
+   * A ring for the calling thread, and only it, to push() to.  It lives as
+   * long as the writer.
+   */
+  Ring* newRing();
+
+  // The records dropped by all the rings
+  uint64_t getNumDropped() const;
+
+  uint64_t getNumWritten() const {
+    return written_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Appends the log line of record to out, like the Common Log Format with
+   * the request's duration in microseconds and body bytes received after:
+   *   1.2.3.4 - - [10/Oct/2019:13:55:36 +0000] "GET /a" 200 2326 12 851
+   */
+  static void format(const AccessLogRecord& record, std::string& out);
+
+ private:
+  void run();
+  void drain();
+  void write(const std::string& batch);
+
+  const Options options_;
+  folly::File file_;
+  std::atomic<uint64_t> written_{0};
+
+  // Guards rings_, and is used to wait for the next flush, or to stop
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::condition_variable cv_;
+  bool stopping_{false};
+
+  std::thread thread_;
+};
+
+}
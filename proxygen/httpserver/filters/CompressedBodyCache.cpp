@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/filters/CompressedBodyCache.h>
+
+#include <folly/Conv.h>
+#include <folly/Format.h>
+#include <folly/hash/SpookyHashV2.h>
+
+namespace proxygen {
+
+CompressedBodyCache::CompressedBodyCache(size_t maxBytes)
+    : maxBytes_(maxBytes) {
+}
+
+std::string CompressedBodyCache::makeKey(folly::StringPiece key,
+                                         CompressionType type,
+                                         int level) {
+  return folly::to<std::string>(static_cast<int>(type), ':', level, ':', key);
+}
+
+std::string CompressedBodyCache::hashBody(const folly::IOBuf& body) {
+  folly::hash::SpookyHashV2 hasher;
+  hasher.Init(0, 0);
+  for (auto range : body) {
+    hasher.Update(range.data(), range.size());
+  }
+  uint64_t hash1;
+  uint64_t hash2;
+  hasher.Final(&hash1, &hash2);
+  return folly::sformat("{:016x}{:016x}", hash1, hash2);
+}
+
+std::unique_ptr<folly::IOBuf> CompressedBodyCache::get(folly::StringPiece key,
+                                                       CompressionType type,
+                                                       int level) {
+  auto fullKey = makeKey(key, type, level);
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = index_.find(fullKey);
+  if (it == index_.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->body->clone();
+}
+
+void CompressedBodyCache::put(folly::StringPiece key,
+                              CompressionType type,
+                              int level,
+                              const folly::IOBuf& compressed) {
+  auto size = compressed.computeChainDataLength();
+  if (size > maxBytes_ / 8) {
+    return;
+  }
+  auto fullKey = makeKey(key, type, level);
+  auto body = compressed.clone();
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = index_.find(fullKey);
+  if (it != index_.end()) {
+    // Raced with another thread compressing the same body
+    return;
+  }
+  entries_.push_front(Entry{fullKey, std::move(body), size});
+  index_.emplace(std::move(fullKey), entries_.begin());
+  size_ += size;
+  while (size_ > maxBytes_) {
+    auto& lru = entries_.back();
+    size_ -= lru.size;
+    index_.erase(lru.key);
+    entries_.pop_back();
+  }
+}
+
+size_t CompressedBodyCache::getNumEntries() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return entries_.size();
+}
+
+size_t CompressedBodyCache::getSize() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return size_;
+}
+
+}
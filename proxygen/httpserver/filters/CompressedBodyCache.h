@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+namespace proxygen {
+
+/**
+ * A bounded LRU cache of compressed response bodies, shared by the
+ * ZlibServerFilters of all threads so that repeated bodies (static files,
+ * config responses) are compressed once per process rather than once per
+ * request.
+ *
+ * Entries are keyed by the body's strong ETag or content hash, and by the
+ * compression type and level.  Lookups return clones sharing the cached
+ * buffers, so hits copy no body bytes.
+ */
+class CompressedBodyCache {
+ public:
+  // maxBytes bounds the compressed bytes cached
+  explicit CompressedBodyCache(size_t maxBytes);
+
+  /**
+   * The cached body for key compressed as type at level, nullptr if it is
+   * not cached.
+   */
+  std::unique_ptr<folly::IOBuf> get(folly::StringPiece key,
+                                    CompressionType type,
+                                    int level);
+
+  /**
+   * Caches compressed as the body for key compressed as type at level,
+   * evicting the least recently used bodies as needed.  Bodies larger than
+   * an eighth of the cache are not cached.
+   */
+  void put(folly::StringPiece key,
+           CompressionType type,
+           int level,
+           const folly::IOBuf& compressed);
+
+  /**
+   * The key of a body without a strong ETag: a 128-bit hash of its content.
+   */
+  static std::string hashBody(const folly::IOBuf& body);
+
+  size_t getNumEntries() const;
+  size_t getSize() const;
+
+  uint64_t getHits() const {
+    return hits_;
+  }
+
+  uint64_t getMisses() const {
+    return misses_;
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::unique_ptr<folly::IOBuf> body;
+    size_t size;
+  };
+  using EntryList = std::list<Entry>;
+
+  static std::string makeKey(folly::StringPiece key,
+                             CompressionType type,
+                             int level);
+
+  const size_t maxBytes_;
+  mutable std::mutex mutex_;
+  // Most recently used first
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+  size_t size_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+}
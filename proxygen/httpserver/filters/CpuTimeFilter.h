@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/CpuTimeStats.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter adding the thread CPU time of each sampled transaction
+ * (AcceptorConfiguration::cpuTimeSampleRate) to the CpuTimeStats of its
+ * route once it completes.  Transactions not in the sample pass through
+ * without being recorded.
+ */
+class CpuTimeFilter : public Filter {
+ public:
+  struct Options {
+    // The route of a request, null for its path.  Should map requests to a
+    // bounded set of routes, see CpuTimeStats.
+    std::function<std::string(const HTTPMessage&)> route;
+  };
+
+  CpuTimeFilter(RequestHandler* upstream,
+                CpuTimeStats& stats,
+                const Options& options)
+      : Filter(upstream), stats_(stats), options_(options) {}
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    if (txn_ && txn_->isCpuTimeAccounting()) {
+      route_ = options_.route ? options_.route(*msg) : msg->getPath();
+      sampled_ = true;
+    }
+    upstream_->onRequest(std::move(msg));
+  }
+
+  void requestComplete() noexcept override {
+    record();
+    Filter::requestComplete();
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    record();
+    Filter::onError(err);
+  }
+
+ private:
+  void record() {
+    // Scopes still open on the transaction's stack are not counted
+    auto timings = txn_ ? txn_->getPhaseTimings() : nullptr;
+    if (sampled_ && timings) {
+      stats_.record(route_, timings->cpuTime);
+    }
+  }
+
+  // The factory's
+  CpuTimeStats& stats_;
+  const Options& options_;
+  std::string route_;
+  bool sampled_{false};
+};
+
+class CpuTimeFilterFactory : public RequestHandlerFactory {
+ public:
+  CpuTimeFilterFactory(std::shared_ptr<CpuTimeStats> stats,
+                       CpuTimeFilter::Options options)
+      : stats_(std::move(stats)), options_(std::move(options)) {}
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler* h, HTTPMessage* /*msg*/)
+      noexcept override {
+    return new CpuTimeFilter(h, *stats_, options_);
+  }
+
+ private:
+  std::shared_ptr<CpuTimeStats> stats_;
+  CpuTimeFilter::Options options_;
+};
+
+}
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/filters/CpuTimeStats.h>
+
+#include <algorithm>
+
+namespace proxygen {
+
+void CpuTimeStats::record(folly::StringPiece route,
+                          std::chrono::nanoseconds cpuTime) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = routes_.find(route.str());
+  if (it == routes_.end()) {
+    if (routes_.size() >= maxRoutes_) {
+      it = routes_.emplace(otherRoute(), Route()).first;
+    } else {
+      it = routes_.emplace(route.str(), Route()).first;
+    }
+  }
+  auto& stats = it->second;
+  stats.requests++;
+  stats.total += cpuTime;
+  stats.max = std::max(stats.max, cpuTime);
+}
+
+std::unordered_map<std::string, CpuTimeStats::Route>
+CpuTimeStats::getRoutes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return routes_;
+}
+
+void CpuTimeStats::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  routes_.clear();
+}
+
+const std::string& CpuTimeStats::otherRoute() {
+  static const std::string route("other");
+  return route;
+}
+
+}
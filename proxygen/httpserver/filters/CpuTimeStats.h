@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace proxygen {
+
+/**
+ * The thread CPU time of the sampled transactions (see
+ * HTTPTransaction::setCpuTimeAccounting) summed by route, shared by the
+ * CpuTimeFilters of all threads.
+ */
+class CpuTimeStats {
+ public:
+  struct Route {
+    uint64_t requests{0};
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+  };
+
+  // maxRoutes bounds the routes tracked, the others are summed as "other"
+  explicit CpuTimeStats(size_t maxRoutes = 1000) : maxRoutes_(maxRoutes) {}
+
+  void record(folly::StringPiece route, std::chrono::nanoseconds cpuTime);
+
+  // The routes recorded since the last reset()
+  std::unordered_map<std::string, Route> getRoutes() const;
+
+  void reset();
+
+  static const std::string& otherRoute();
+
+ private:
+  const size_t maxRoutes_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Route> routes_;
+};
+
+}
@@ -9,22 +9,29 @@
  */
 #pragma once
 
+#include <proxygen/httpserver/PrebuiltResponse.h>
 #include <proxygen/httpserver/RequestHandler.h>
-#include <proxygen/httpserver/ResponseBuilder.h>
 
 namespace proxygen {
 
 /**
- * Handler that sends a fixed response back.
+ * Handler that sends a fixed response back.  Factories sending the same
+ * response often should build it once and pass the PrebuiltResponse.
  */
 class DirectResponseHandler : public RequestHandler {
  public:
   DirectResponseHandler(int code,
                         std::string message,
                         std::string body)
-      : code_(code),
-        message_(std::move(message)),
-        body_(folly::IOBuf::copyBuffer(body)) {
+      : response_(PrebuiltResponse::create(code,
+                                           message,
+                                           HTTPHeaders(),
+                                           folly::IOBuf::copyBuffer(body))) {
+  }
+
+  explicit DirectResponseHandler(
+      std::shared_ptr<const PrebuiltResponse> response)
+      : response_(std::move(response)) {
   }
 
   void onRequest(std::unique_ptr<HTTPMessage> /*headers*/) noexcept override {}
@@ -34,10 +41,7 @@ class DirectResponseHandler : public RequestHandler {
   void onUpgrade(proxygen::UpgradeProtocol /*prot*/) noexcept override {}
 
   void onEOM() noexcept override {
-    ResponseBuilder(downstream_)
-        .status(code_, std::move(message_))
-        .body(std::move(body_))
-        .sendWithEOM();
+    response_->send(downstream_);
   }
 
   void requestComplete() noexcept override {
@@ -47,9 +51,7 @@ class DirectResponseHandler : public RequestHandler {
   void onError(ProxygenError /*err*/) noexcept override { delete this; }
 
  private:
-  const int code_;
-  std::string message_;
-  std::unique_ptr<folly::IOBuf> body_;
+  std::shared_ptr<const PrebuiltResponse> response_;
 };
 
 }
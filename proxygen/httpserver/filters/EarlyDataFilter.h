@@ -0,0 +1,190 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncTransport.h>
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/http/HTTPMethod.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter applying a policy to requests received as early data
+ * (TLS 1.3 or QUIC 0-RTT), which an attacker can replay.
+ *
+ * Requests the policy allows, by default those with a safe method (see
+ * isSafeMethod()), reach the handler at once with an Early-Data: 1 header
+ * (RFC 8470).  The others wait for the handshake to complete, their ingress
+ * paused and what was already read buffered, or get a 425 (Too Early) with
+ * rejectUnsafe.  Requests already marked Early-Data: 1, by a proxy that
+ * received them as early data, cannot wait for a handshake of ours and get
+ * the 425 if the policy doesn't allow them.
+ */
+class EarlyDataFilter
+    : public Filter,
+      public folly::AsyncTransport::ReplaySafetyCallback {
+ public:
+  struct Options {
+    // Whether a request may run as early data, null for safe methods only.
+    // For per route opt-ins.
+    std::function<bool(const HTTPMessage&)> allowed;
+    // 425 rather than hold the requests not allowed
+    bool rejectUnsafe{false};
+  };
+
+  static bool isAllowedByDefault(const HTTPMessage& msg) {
+    auto method = msg.getMethod();
+    return method && isSafeMethod(*method);
+  }
+
+  EarlyDataFilter(RequestHandler* upstream, const Options& options)
+      : Filter(upstream), options_(options) {}
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    bool forwarded =
+      msg->getHeaders().getSingleOrEmpty(earlyDataHeader()) == "1";
+    bool early = txn_ && !txn_->isReplaySafe();
+    if (!early && !forwarded) {
+      upstream_->onRequest(std::move(msg));
+      return;
+    }
+    bool allowed = options_.allowed ? options_.allowed(*msg)
+                                    : isAllowedByDefault(*msg);
+    if (allowed) {
+      msg->getHeaders().set(earlyDataHeader(), "1");
+      upstream_->onRequest(std::move(msg));
+    } else if (forwarded || options_.rejectUnsafe) {
+      VLOG(4) << "Rejecting early data request " << msg->getURL();
+      upstream_->onError(kErrorEarlyDataRejected);
+      upstream_ = nullptr;
+      ResponseBuilder(downstream_).status(425, "Too Early").sendWithEOM();
+    } else {
+      VLOG(4) << "Holding early data request " << msg->getURL();
+      held_ = std::move(msg);
+      downstream_->pauseIngress();
+      // Calls onReplaySafe() at once if the handshake completed meanwhile
+      txn_->addWaitingForReplaySafety(this);
+    }
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (held_) {
+      heldBody_.append(std::move(body));
+    } else if (upstream_) {
+      upstream_->onBody(std::move(body));
+    }
+  }
+
+  void onUpgrade(UpgradeProtocol protocol) noexcept override {
+    if (held_) {
+      heldUpgrade_ = protocol;
+    } else if (upstream_) {
+      upstream_->onUpgrade(protocol);
+    }
+  }
+
+  void onEOM() noexcept override {
+    if (held_) {
+      heldEOM_ = true;
+    } else if (upstream_) {
+      upstream_->onEOM();
+    }
+  }
+
+  void requestComplete() noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->requestComplete();
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    if (held_ && txn_) {
+      txn_->removeWaitingForReplaySafety(this);
+    }
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->onError(err);
+    }
+    delete this;
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressResumed();
+    }
+  }
+
+  // ReplaySafetyCallback
+  void onReplaySafe() noexcept override {
+    VLOG(4) << "Releasing early data request " << held_->getURL();
+    auto msg = std::move(held_);
+    upstream_->onRequest(std::move(msg));
+    if (!heldBody_.empty()) {
+      upstream_->onBody(heldBody_.move());
+    }
+    if (heldUpgrade_) {
+      upstream_->onUpgrade(*heldUpgrade_);
+    }
+    if (heldEOM_) {
+      upstream_->onEOM();
+    }
+    downstream_->resumeIngress();
+  }
+
+ private:
+  static const std::string& earlyDataHeader() {
+    static const std::string header("Early-Data");
+    return header;
+  }
+
+  // The factory's
+  const Options& options_;
+  // The request waiting for replay safety, and what followed it
+  std::unique_ptr<HTTPMessage> held_;
+  folly::IOBufQueue heldBody_{folly::IOBufQueue::cacheChainLength()};
+  folly::Optional<UpgradeProtocol> heldUpgrade_;
+  bool heldEOM_{false};
+};
+
+class EarlyDataFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit EarlyDataFilterFactory(EarlyDataFilter::Options options)
+      : options_(std::move(options)) {}
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler* h, HTTPMessage* /*msg*/)
+      noexcept override {
+    // Whether the request is early data is only known once the filter has
+    // its transaction
+    return new EarlyDataFilter(h, options_);
+  }
+
+ private:
+  EarlyDataFilter::Options options_;
+};
+
+}
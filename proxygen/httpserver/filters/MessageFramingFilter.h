@@ -0,0 +1,260 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstring>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RecycledRequestHandler.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter for bodies made of length-prefixed messages, as gRPC
+ * carries them: a flags byte (1 for a compressed message) and a big endian
+ * 32 bit length, then the message.
+ *
+ * Each onBody() the handler gets is one message, without its prefix unless
+ * keepPrefix, split off the body by reference, whether the message spans
+ * several DATA frames or a frame carries several messages; nothing is
+ * copied or coalesced.  The messages left wait while the handler has
+ * paused ingress.  Messages over maxMessageSize, and bodies ending within
+ * a message, are rejected with a 413 or 400 if the handler hasn't
+ * responded yet, and the handler gets onError().
+ *
+ * Each sendBody() of the handler is one message likewise, that the
+ * filter prefixes in the headroom of its first buffer when it has 5 free
+ * bytes, or with a buffer of its own chained in front.  Messages go out
+ * whole, so the handler pausing on onEgressPaused() only ever leaves
+ * whole messages buffered.
+ */
+class MessageFramingFilter
+    : public Filter,
+      public RecycledRequestHandler<MessageFramingFilter> {
+ public:
+  struct Options {
+    // Applies to the requests whose Content-Type starts with it, to all if
+    // empty
+    std::string contentType{"application/grpc"};
+    // The longest message accepted, 0 for no limit
+    uint32_t maxMessageSize{4 * 1024 * 1024};
+    // Passes the messages on with their prefix, e.g. to read the flags
+    bool keepPrefix{false};
+    // Prefixes each sendBody(), off for handlers framing their messages
+    // with frame(), e.g. to set the flags
+    bool frameEgress{true};
+  };
+
+  static constexpr size_t kPrefixSize = 5;
+  static constexpr uint8_t kCompressedFlag = 0x01;
+
+  MessageFramingFilter(RequestHandler* upstream, const Options& options)
+      : Filter(upstream), options_(options) {}
+
+  /**
+   * Prefixes message, in its headroom if it can.  Returns the framed
+   * message.
+   */
+  static std::unique_ptr<folly::IOBuf> frame(
+      std::unique_ptr<folly::IOBuf> message, bool compressed = false) {
+    uint32_t length = message ? message->computeChainDataLength() : 0;
+    uint8_t prefix[kPrefixSize] = {
+      uint8_t(compressed ? kCompressedFlag : 0),
+      uint8_t(length >> 24), uint8_t(length >> 16), uint8_t(length >> 8),
+      uint8_t(length)};
+    if (message && message->headroom() >= kPrefixSize &&
+        !message->isSharedOne()) {
+      message->prepend(kPrefixSize);
+      memcpy(message->writableData(), prefix, kPrefixSize);
+      return message;
+    }
+    auto framed = folly::IOBuf::copyBuffer(prefix, kPrefixSize);
+    if (message) {
+      framed->prependChain(std::move(message));
+    }
+    return framed;
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (!upstream_) {
+      return;
+    }
+    pending_.append(std::move(body));
+    deliver();
+  }
+
+  void onEOM() noexcept override {
+    if (!upstream_) {
+      return;
+    }
+    eom_ = true;
+    deliver();
+  }
+
+  void requestComplete() noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->requestComplete();
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->onError(err);
+    }
+    delete this;
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressResumed();
+    }
+  }
+
+  // Response handler
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    // A final response can still follow the 1xx ones
+    if (!msg.is1xxResponse()) {
+      headersSent_ = true;
+    }
+    Filter::sendHeaders(msg);
+  }
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    Filter::sendBody(options_.frameEgress ? frame(std::move(body)) :
+                     std::move(body));
+  }
+
+  void pauseIngress() noexcept override {
+    paused_ = true;
+    Filter::pauseIngress();
+  }
+
+  void resumeIngress() noexcept override {
+    paused_ = false;
+    deliver();
+    if (!paused_ && upstream_) {
+      Filter::resumeIngress();
+    }
+  }
+
+ protected:
+  /**
+   * Passes the complete messages pending on, until the handler pauses
+   * ingress, then the EOM once they are all passed.
+   */
+  void deliver() {
+    if (delivering_) {
+      return;
+    }
+    delivering_ = true;
+    while (!paused_ && upstream_ && pending_.chainLength() >= kPrefixSize) {
+      folly::io::Cursor cursor(pending_.front());
+      cursor.skip(1);
+      auto length = cursor.readBE<uint32_t>();
+      if (options_.maxMessageSize > 0 && length > options_.maxMessageSize) {
+        delivering_ = false;
+        return reject(413, "Payload Too Large");
+      }
+      if (pending_.chainLength() < kPrefixSize + length) {
+        break;
+      }
+      if (!options_.keepPrefix) {
+        pending_.trimStart(kPrefixSize);
+      }
+      auto size = options_.keepPrefix ? kPrefixSize + length : length;
+      // An empty message is still a message
+      upstream_->onBody(size > 0 ? pending_.split(size) :
+                        folly::IOBuf::create(0));
+    }
+    delivering_ = false;
+
+    if (eom_ && !paused_ && upstream_ &&
+        pending_.chainLength() < kPrefixSize) {
+      if (!pending_.empty()) {
+        // Ends within a prefix
+        return reject(400, "Bad Request");
+      }
+      eom_ = false;
+      upstream_->onEOM();
+    } else if (eom_ && !paused_ && upstream_) {
+      // Ends within a message
+      return reject(400, "Bad Request");
+    }
+  }
+
+  // Fails the request, responding unless the handler already has
+  void reject(uint16_t status, const char* message) {
+    VLOG(4) << "Rejecting request body: " << message << ", pending="
+            << pending_.chainLength();
+    pending_.move();
+    auto upstream = upstream_;
+    upstream_ = nullptr;
+    upstream->onError(kErrorParseBody);
+    if (!downstream_) {
+      return;
+    }
+    if (headersSent_) {
+      Filter::sendAbort();
+      return;
+    }
+    ResponseBuilder(downstream_)
+      .status(status, message)
+      .closeConnection()
+      .sendWithEOM();
+  }
+
+  Options options_;
+  // Body not yet passed on
+  folly::IOBufQueue pending_{folly::IOBufQueue::cacheChainLength()};
+  bool eom_{false};
+  bool paused_{false};
+  bool delivering_{false};
+  bool headersSent_{false};
+};
+
+class MessageFramingFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit MessageFramingFilterFactory(
+      const MessageFramingFilter::Options& options)
+      : options_(options) {}
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    const auto& contentType =
+      msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE);
+    if (contentType.compare(0, options_.contentType.size(),
+                            options_.contentType) != 0) {
+      return h;
+    }
+    return new MessageFramingFilter(h, options_);
+  }
+
+ private:
+  MessageFramingFilter::Options options_;
+};
+
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RecycledRequestHandler.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
 
@@ -18,7 +19,8 @@ namespace proxygen {
 /**
  * A filter that rejects CONNECT/UPGRADE requests.
  */
-class RejectConnectFilter : public Filter {
+class RejectConnectFilter : public Filter,
+                            public RecycledRequestHandler<RejectConnectFilter> {
  public:
   explicit RejectConnectFilter(RequestHandler* upstream): Filter(upstream) {
   }
@@ -65,6 +67,14 @@ class RejectConnectFilter : public Filter {
 
   void sendBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
 
+  void sendFileBody(std::shared_ptr<folly::File> /*file*/,
+                    off_t /*offset*/,
+                    size_t /*length*/) noexcept override {}
+
+  bool spliceTunnel(folly::AsyncSocket& /*upstream*/) noexcept override {
+    return false;
+  }
+
   void sendChunkTerminator() noexcept override {
   }
 
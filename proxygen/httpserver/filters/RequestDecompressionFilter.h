@@ -0,0 +1,284 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <folly/io/IOBufQueue.h>
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RecycledRequestHandler.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
+#include <proxygen/lib/utils/UtilInl.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter decompressing the bodies of requests with a gzip, deflate
+ * or zstd Content-Encoding, so that handlers get them decompressed, without
+ * the Content-Encoding and Content-Length headers.
+ *
+ * The body is decompressed in slices sized for the decompressed chunks
+ * passed to the handler to stay around maxChunkSize, and the slices left
+ * wait while the handler has paused ingress, so that memory stays bounded
+ * whatever the body size.  Bodies that are corrupt, or over the ratio or
+ * size limits (decompression bombs), are rejected with a 400 or 413 if the
+ * handler hasn't responded yet, and the handler gets onError().
+ */
+class RequestDecompressionFilter
+    : public Filter,
+      public RecycledRequestHandler<RequestDecompressionFilter> {
+ public:
+  struct Options {
+    // Decompressed bytes passed to each onBody(), about
+    size_t maxChunkSize{64 * 1024};
+    // Decompressed bytes allowed per compressed byte, past ratioMinimumSize
+    // decompressed bytes
+    double maxRatio{100};
+    uint64_t ratioMinimumSize{1024 * 1024};
+    // Decompressed bytes allowed, 0 for no limit
+    uint64_t maxSize{0};
+  };
+
+  RequestDecompressionFilter(RequestHandler* upstream,
+                             CompressionType type,
+                             const Options& options)
+      : Filter(upstream), type_(type), options_(options) {}
+
+  /**
+   * The type to decompress the body of msg with, NONE if its body isn't
+   * encoded, or with more than one content coding or an unsupported one.
+   */
+  static CompressionType getEncoding(const HTTPMessage& msg) {
+    const auto& coding =
+      msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_ENCODING);
+    if (caseInsensitiveEqual(coding, "gzip") ||
+        caseInsensitiveEqual(coding, "x-gzip")) {
+      return CompressionType::GZIP;
+    } else if (caseInsensitiveEqual(coding, "deflate")) {
+      return CompressionType::DEFLATE;
+    } else if (caseInsensitiveEqual(coding, "zstd")) {
+      return CompressionType::ZSTD;
+    }
+    return CompressionType::NONE;
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    decompressor_ = StreamCodecPool::getDecompressor(type_);
+    auto& headers = msg->getHeaders();
+    headers.remove(HTTP_HEADER_CONTENT_ENCODING);
+    headers.remove(HTTP_HEADER_CONTENT_LENGTH);
+    upstream_->onRequest(std::move(msg));
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (!upstream_) {
+      return;
+    }
+    compressedSize_ += body->computeChainDataLength();
+    pending_.append(std::move(body));
+    decompress();
+  }
+
+  void onEOM() noexcept override {
+    if (!upstream_) {
+      return;
+    }
+    eom_ = true;
+    decompress();
+  }
+
+  void requestComplete() noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->requestComplete();
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->onError(err);
+    }
+    delete this;
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressResumed();
+    }
+  }
+
+  // Response handler
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    // A final response can still follow the 1xx ones
+    if (!msg.is1xxResponse()) {
+      headersSent_ = true;
+    }
+    Filter::sendHeaders(msg);
+  }
+
+  void pauseIngress() noexcept override {
+    paused_ = true;
+    Filter::pauseIngress();
+  }
+
+  void resumeIngress() noexcept override {
+    paused_ = false;
+    decompress();
+    if (!paused_ && upstream_) {
+      Filter::resumeIngress();
+    }
+  }
+
+ protected:
+  /**
+   * Passes the pending body on decompressed, one slice at a time, until the
+   * handler pauses ingress, then the EOM once the body is all passed.
+   */
+  void decompress() {
+    if (decompressing_) {
+      return;
+    }
+    decompressing_ = true;
+    while (!paused_ && upstream_ && !pending_.empty()) {
+      auto sliceSize = std::min(sliceSize_, pending_.chainLength());
+      auto slice = pending_.split(sliceSize);
+      auto decompressed = decompressor_->decompress(slice.get());
+      if (decompressor_->hasError()) {
+        decompressing_ = false;
+        return reject(400, "Bad Request");
+      }
+      size_t length = decompressed ? decompressed->computeChainDataLength() : 0;
+      consumedSize_ += sliceSize;
+      decompressedSize_ += length;
+      updateSliceSize(sliceSize, length);
+      if (isOverLimits()) {
+        decompressing_ = false;
+        return reject(413, "Payload Too Large");
+      }
+      if (length > 0) {
+        decompressed_.append(std::move(decompressed));
+      }
+      // Holds small chunks back until the next slice, but not the next body
+      if (decompressed_.chainLength() >= options_.maxChunkSize ||
+          (pending_.empty() && !decompressed_.empty())) {
+        upstream_->onBody(decompressed_.move());
+      }
+    }
+    decompressing_ = false;
+
+    if (eom_ && pending_.empty() && !paused_ && upstream_) {
+      eom_ = false;
+      if (!decompressor_->finished()) {
+        // Truncated body
+        return reject(400, "Bad Request");
+      }
+      upstream_->onEOM();
+    }
+  }
+
+  /**
+   * Sizes the next slice to decompress to about maxChunkSize at the ratio
+   * of the last one.  Slices at most double, and stay small enough for a
+   * sudden run of zeros not to decompress to more than a few MB at once.
+   */
+  void updateSliceSize(size_t in, size_t out) {
+    const size_t minSliceSize = kMinSliceSize;
+    size_t maxSliceSize = std::max(minSliceSize, options_.maxChunkSize / 16);
+    size_t target = sliceSize_ * 2;
+    if (out > 0) {
+      target = std::min<uint64_t>(target,
+                                  uint64_t(in) * options_.maxChunkSize / out);
+    }
+    sliceSize_ = std::max(minSliceSize, std::min(target, maxSliceSize));
+  }
+
+  bool isOverLimits() const {
+    if (options_.maxSize > 0 && decompressedSize_ > options_.maxSize) {
+      return true;
+    }
+    return decompressedSize_ > options_.ratioMinimumSize &&
+      decompressedSize_ > options_.maxRatio * consumedSize_;
+  }
+
+  // Fails the request, responding unless the handler already has
+  void reject(uint16_t status, const char* message) {
+    VLOG(4) << "Rejecting request body: " << message << ", compressed="
+            << compressedSize_ << " decompressed=" << decompressedSize_;
+    pending_.move();
+    decompressed_.move();
+    auto upstream = upstream_;
+    upstream_ = nullptr;
+    upstream->onError(kErrorParseBody);
+    if (!downstream_) {
+      return;
+    }
+    if (headersSent_) {
+      Filter::sendAbort();
+      return;
+    }
+    ResponseBuilder(downstream_)
+      .status(status, message)
+      .closeConnection()
+      .sendWithEOM();
+  }
+
+  static constexpr size_t kMinSliceSize = 64;
+
+  CompressionType type_;
+  Options options_;
+  std::shared_ptr<StreamDecompressor> decompressor_;
+  // Compressed body not yet decompressed
+  folly::IOBufQueue pending_{folly::IOBufQueue::cacheChainLength()};
+  // Decompressed body not yet passed on
+  folly::IOBufQueue decompressed_{folly::IOBufQueue::cacheChainLength()};
+  size_t sliceSize_{kMinSliceSize};
+  uint64_t compressedSize_{0};
+  uint64_t consumedSize_{0};
+  uint64_t decompressedSize_{0};
+  bool eom_{false};
+  bool paused_{false};
+  bool decompressing_{false};
+  bool headersSent_{false};
+};
+
+class RequestDecompressionFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit RequestDecompressionFilterFactory(
+      const RequestDecompressionFilter::Options& options)
+      : options_(options) {}
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    auto type = RequestDecompressionFilter::getEncoding(*msg);
+    if (type == CompressionType::NONE) {
+      return h;
+    }
+    return new RequestDecompressionFilter(h, type, options_);
+  }
+
+ private:
+  RequestDecompressionFilter::Options options_;
+};
+
+}
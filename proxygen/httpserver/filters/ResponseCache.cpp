@@ -0,0 +1,183 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/filters/ResponseCache.h>
+
+#include <algorithm>
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <proxygen/lib/utils/UtilInl.h>
+
+namespace proxygen {
+
+namespace {
+// Calls fn with the name and value ("" if none) of each directive of the
+// Cache-Control headers, until it returns true
+template <typename F>
+bool forEachCacheDirective(const HTTPHeaders& headers, F fn) {
+  return headers.forEachValueOfHeader(
+    HTTP_HEADER_CACHE_CONTROL, [&] (const std::string& value) {
+      std::vector<folly::StringPiece> directives;
+      folly::split(',', value, directives);
+      for (auto directive : directives) {
+        folly::StringPiece name = directive;
+        folly::StringPiece arg;
+        auto eq = directive.find('=');
+        if (eq != folly::StringPiece::npos) {
+          name = directive.subpiece(0, eq);
+          arg = directive.subpiece(eq + 1);
+        }
+        if (fn(folly::trimWhitespace(name), folly::trimWhitespace(arg))) {
+          return true;
+        }
+      }
+      return false;
+    });
+}
+}
+
+ResponseCache::ResponseCache(const Options& options)
+    : options_(options) {
+}
+
+std::string ResponseCache::getKey(const HTTPMessage& request) const {
+  auto method = request.getMethod();
+  if ((method != HTTPMethod::GET && method != HTTPMethod::HEAD) ||
+      request.getHeaders().exists(HTTP_HEADER_AUTHORIZATION)) {
+    return "";
+  }
+  bool noCache = forEachCacheDirective(
+    request.getHeaders(), [] (folly::StringPiece name, folly::StringPiece) {
+      return caseInsensitiveEqual(name, "no-cache") ||
+        caseInsensitiveEqual(name, "no-store");
+    });
+  if (noCache) {
+    return "";
+  }
+
+  auto key = folly::to<std::string>(request.getMethodString(), ' ',
+                                    request.getURL());
+  for (const auto& header : options_.varyHeaders) {
+    folly::toAppend('\n', request.getHeaders().combine(header), &key);
+  }
+  return key;
+}
+
+std::chrono::milliseconds ResponseCache::getTtl(
+    const HTTPMessage& response) const {
+  const std::chrono::milliseconds kNotCacheable(0);
+  const auto& headers = response.getHeaders();
+  if (response.getStatusCode() != 200 ||
+      headers.exists(HTTP_HEADER_SET_COOKIE)) {
+    return kNotCacheable;
+  }
+
+  // Every header the response varies by must be in the key
+  bool unknownVary = headers.forEachValueOfHeader(
+    HTTP_HEADER_VARY, [this] (const std::string& value) {
+      std::vector<folly::StringPiece> names;
+      folly::split(',', value, names);
+      for (auto name : names) {
+        name = folly::trimWhitespace(name);
+        if (name.empty()) {
+          continue;
+        }
+        bool known = false;
+        for (const auto& header : options_.varyHeaders) {
+          known = known || caseInsensitiveEqual(name, header);
+        }
+        if (!known) {
+          return true;
+        }
+      }
+      return false;
+    });
+  if (unknownVary) {
+    return kNotCacheable;
+  }
+
+  // Directives with a value, and s-maxage overriding max-age
+  int64_t maxAge = -1;
+  int64_t sharedMaxAge = -1;
+  bool uncacheable = forEachCacheDirective(
+    headers, [&] (folly::StringPiece name, folly::StringPiece arg) {
+      if (caseInsensitiveEqual(name, "private") ||
+          caseInsensitiveEqual(name, "no-cache") ||
+          caseInsensitiveEqual(name, "no-store")) {
+        return true;
+      }
+      bool shared = caseInsensitiveEqual(name, "s-maxage");
+      if (shared || caseInsensitiveEqual(name, "max-age")) {
+        arg.removePrefix('"');
+        arg.removeSuffix('"');
+        auto seconds = folly::tryTo<int64_t>(arg);
+        // Malformed ages make the response stale
+        (shared ? sharedMaxAge : maxAge) =
+          seconds.hasValue() ? std::max<int64_t>(0, seconds.value()) : 0;
+      }
+      return false;
+    });
+  if (uncacheable) {
+    return kNotCacheable;
+  }
+
+  auto ttl = options_.defaultTtl;
+  auto age = sharedMaxAge >= 0 ? sharedMaxAge : maxAge;
+  if (age >= 0) {
+    ttl = std::chrono::seconds(age);
+  }
+  return std::min(ttl, options_.maxTtl);
+}
+
+std::shared_ptr<const ResponseCache::Response> ResponseCache::get(
+    const std::string& key, TimePoint now) {
+  auto& shard = *shards_;
+  auto it = shard.index.find(key);
+  if (it == shard.index.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  if (it->second->response->expires <= now) {
+    erase(shard, it->second);
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+  return it->second->response;
+}
+
+void ResponseCache::put(const std::string& key,
+                        std::shared_ptr<const Response> response) {
+  auto& shard = *shards_;
+  auto it = shard.index.find(key);
+  if (it != shard.index.end()) {
+    // Concurrent requests for an expired response
+    erase(shard, it->second);
+  }
+  auto size = response->size;
+  shard.entries.push_front(Entry{key, std::move(response)});
+  shard.index.emplace(key, shard.entries.begin());
+  shard.size += size;
+  while (shard.size > options_.maxBytesPerThread) {
+    erase(shard, std::prev(shard.entries.end()));
+  }
+}
+
+void ResponseCache::erase(Shard& shard, EntryList::iterator it) {
+  shard.size -= it->response->size;
+  shard.index.erase(it->key);
+  shard.entries.erase(it);
+}
+
+size_t ResponseCache::getNumEntries() const {
+  return shards_->entries.size();
+}
+
+}
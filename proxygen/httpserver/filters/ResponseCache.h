@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <folly/io/IOBuf.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * A short lived cache of full responses, for endpoints whose responses are
+ * the same for everyone for a little while (see ResponseCacheFilter).
+ *
+ * Each thread has its own size bounded LRU, so lookups take no lock.  The
+ * same response may thus be cached once per thread.
+ */
+class ResponseCache {
+ public:
+  struct Options {
+    // Bytes of headers and bodies cached per thread
+    size_t maxBytesPerThread{16 * 1024 * 1024};
+    // Larger bodies are not cached
+    size_t maxBodySize{256 * 1024};
+    // TTL of the responses without a max-age, 0 not to cache them
+    std::chrono::milliseconds defaultTtl{0};
+    // Longest TTL, whatever the max-age
+    std::chrono::milliseconds maxTtl{1000};
+    // Request headers the responses vary by, and which are part of the key
+    std::vector<std::string> varyHeaders;
+  };
+
+  struct Response {
+    HTTPMessage headers;
+    // nullptr for responses to HEAD requests
+    std::unique_ptr<folly::IOBuf> body;
+    TimePoint created;
+    TimePoint expires;
+    // Bytes of the headers and body
+    size_t size;
+  };
+
+  explicit ResponseCache(const Options& options);
+
+  /**
+   * The key of a cacheable request: its method, URL and vary headers.
+   * Returns an empty string if the request can't be served from cache
+   * (not GET nor HEAD, with credentials or Cache-Control: no-cache).
+   */
+  std::string getKey(const HTTPMessage& request) const;
+
+  /**
+   * How long to cache response for, 0 if it isn't cacheable: not 200, with
+   * cookies, Cache-Control: private, no-cache or no-store, or varying by
+   * other request headers than the configured ones.  s-maxage and max-age
+   * are honored, capped to maxTtl.
+   */
+  std::chrono::milliseconds getTtl(const HTTPMessage& response) const;
+
+  /**
+   * The response cached for key on this thread, nullptr if it isn't cached
+   * or has expired.
+   */
+  std::shared_ptr<const Response> get(const std::string& key, TimePoint now);
+
+  /**
+   * Caches response on this thread, evicting the least recently used ones
+   * as needed.
+   */
+  void put(const std::string& key, std::shared_ptr<const Response> response);
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+  // The counts of all threads
+  uint64_t getHits() const {
+    return hits_;
+  }
+
+  uint64_t getMisses() const {
+    return misses_;
+  }
+
+  // On the current thread
+  size_t getNumEntries() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const Response> response;
+  };
+  using EntryList = std::list<Entry>;
+
+  struct Shard {
+    // Most recently used first
+    EntryList entries;
+    std::unordered_map<std::string, EntryList::iterator> index;
+    size_t size{0};
+  };
+
+  void erase(Shard& shard, EntryList::iterator it);
+
+  const Options options_;
+  folly::ThreadLocal<Shard> shards_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+}
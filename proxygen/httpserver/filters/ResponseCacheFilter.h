@@ -0,0 +1,216 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Conv.h>
+#include <folly/io/IOBufQueue.h>
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RecycledRequestHandler.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/ResponseCache.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter serving responses from a ResponseCache, or caching the
+ * responses of the handler when they are cacheable (see
+ * ResponseCache::getTtl()).
+ *
+ * On hits the handler never sees the request: it gets requestComplete()
+ * right away, to clean up.  Chunked responses are cached whole and served
+ * with a Content-Length.
+ */
+class ResponseCacheFilter : public Filter,
+                            public RecycledRequestHandler<ResponseCacheFilter> {
+ public:
+  // Serves response
+  ResponseCacheFilter(RequestHandler* upstream,
+                      std::shared_ptr<const ResponseCache::Response> response)
+      : Filter(upstream), cached_(std::move(response)) {}
+
+  // Caches the response of upstream as key
+  ResponseCacheFilter(RequestHandler* upstream,
+                      std::shared_ptr<ResponseCache> cache,
+                      std::string key,
+                      bool head)
+      : Filter(upstream),
+        cache_(std::move(cache)),
+        key_(std::move(key)),
+        head_(head) {}
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    if (!cached_) {
+      upstream_->onRequest(std::move(msg));
+      return;
+    }
+    upstream_->requestComplete();
+    upstream_ = nullptr;
+
+    HTTPMessage response(cached_->headers);
+    auto age = std::chrono::duration_cast<std::chrono::seconds>(
+      getCurrentTime() - cached_->created);
+    response.getHeaders().set(HTTP_HEADER_AGE,
+                              folly::to<std::string>(age.count()));
+    downstream_->sendHeaders(response);
+    if (cached_->body) {
+      downstream_->sendBody(cached_->body->clone());
+    }
+    downstream_->sendEOM();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (upstream_) {
+      upstream_->onBody(std::move(body));
+    }
+  }
+
+  void onUpgrade(UpgradeProtocol protocol) noexcept override {
+    if (upstream_) {
+      upstream_->onUpgrade(protocol);
+    }
+  }
+
+  void onEOM() noexcept override {
+    if (upstream_) {
+      upstream_->onEOM();
+    }
+  }
+
+  void requestComplete() noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->requestComplete();
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->onError(err);
+    }
+    delete this;
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressResumed();
+    }
+  }
+
+  // Response handler
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    auto ttl = cache_->getTtl(msg);
+    if (ttl.count() > 0) {
+      response_ = std::make_unique<ResponseCache::Response>();
+      response_->headers = msg;
+      response_->created = getCurrentTime();
+      response_->expires = response_->created + ttl;
+    }
+    Filter::sendHeaders(msg);
+  }
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (response_ && !head_) {
+      body_.append(body->clone());
+      if (body_.chainLength() > cache_->getOptions().maxBodySize) {
+        stopCaching();
+      }
+    }
+    Filter::sendBody(std::move(body));
+  }
+
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override {
+    stopCaching();
+    Filter::sendFileBody(std::move(file), offset, length);
+  }
+
+  void sendEOM() noexcept override {
+    if (response_) {
+      cacheResponse();
+    }
+    Filter::sendEOM();
+  }
+
+  void sendAbort() noexcept override {
+    stopCaching();
+    Filter::sendAbort();
+  }
+
+ protected:
+  void stopCaching() {
+    response_.reset();
+    body_.move();
+  }
+
+  void cacheResponse() {
+    auto& headers = response_->headers.getHeaders();
+    if (!head_) {
+      auto length = body_.chainLength();
+      response_->body = length > 0 ? body_.move() : folly::IOBuf::create(0);
+      response_->headers.setIsChunked(false);
+      headers.remove(HTTP_HEADER_TRANSFER_ENCODING);
+      headers.set(HTTP_HEADER_CONTENT_LENGTH, folly::to<std::string>(length));
+      response_->size = length;
+    } else {
+      response_->size = 0;
+    }
+    headers.forEach([this] (const std::string& name, const std::string& value) {
+        response_->size += name.size() + value.size();
+      });
+    cache_->put(key_, std::move(response_));
+  }
+
+  std::shared_ptr<const ResponseCache::Response> cached_;
+  std::shared_ptr<ResponseCache> cache_;
+  std::string key_;
+  // The response being cached
+  std::unique_ptr<ResponseCache::Response> response_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  bool head_{false};
+};
+
+class ResponseCacheFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit ResponseCacheFilterFactory(std::shared_ptr<ResponseCache> cache)
+      : cache_(std::move(cache)) {}
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    auto key = cache_->getKey(*msg);
+    if (key.empty()) {
+      return h;
+    }
+    auto cached = cache_->get(key, getCurrentTime());
+    if (cached) {
+      return new ResponseCacheFilter(h, std::move(cached));
+    }
+    return new ResponseCacheFilter(h, cache_, std::move(key),
+                                   msg->getMethod() == HTTPMethod::HEAD);
+  }
+
+ private:
+  std::shared_ptr<ResponseCache> cache_;
+};
+
+}
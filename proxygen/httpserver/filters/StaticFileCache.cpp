@@ -0,0 +1,82 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/filters/StaticFileCache.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace proxygen {
+
+namespace {
+bool sameFile(const StaticFileCache::File& file, const struct stat& st) {
+  return file.inode == st.st_ino && file.device == st.st_dev &&
+    file.size == uint64_t(st.st_size) && file.mtime == st.st_mtime;
+}
+
+std::string formatHTTPDate(time_t time) {
+  tm tmTime;
+  gmtime_r(&time, &tmTime);
+  char buf[64];
+  auto len = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tmTime);
+  return std::string(buf, len);
+}
+}
+
+std::shared_ptr<const StaticFileCache::File> StaticFileCache::get(
+    const std::string& path, TimePoint now) {
+  auto& shard = *shards_;
+  auto it = shard.index.find(path);
+  if (it != shard.index.end()) {
+    auto& entry = *it->second;
+    bool valid = now - entry.validated < options_.revalidateInterval;
+    if (!valid) {
+      struct stat st;
+      bool exists = ::stat(path.c_str(), &st) == 0;
+      valid = entry.file ? exists && sameFile(*entry.file, st) : !exists;
+      entry.validated = now;
+    }
+    if (valid) {
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+      return entry.file;
+    }
+    // Created, replaced, modified or removed.  Requests still sending the
+    // old file hold it
+    shard.entries.erase(it->second);
+    shard.index.erase(it);
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  auto file = open(path);
+  shard.entries.push_front(Entry{path, file, now});
+  shard.index.emplace(path, shard.entries.begin());
+  if (shard.entries.size() > options_.maxEntriesPerThread) {
+    shard.index.erase(shard.entries.back().path);
+    shard.entries.pop_back();
+  }
+  return file;
+}
+
+std::shared_ptr<const StaticFileCache::File> StaticFileCache::open(
+    const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  auto file = std::make_shared<folly::File>(fd, true);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    return nullptr;
+  }
+  return std::shared_ptr<const File>(new File{
+    std::move(file), uint64_t(st.st_size), st.st_ino, st.st_dev,
+    st.st_mtime, formatHTTPDate(st.st_mtime)});
+}
+
+}
@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+#include <folly/ThreadLocal.h>
+#include <sys/types.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * A cache of open files and their stat(2), for StaticFileHandler to serve
+ * the popular files without an open and a stat per request.
+ *
+ * Each thread has its own LRU of at most maxEntriesPerThread files, so
+ * lookups take no lock.  An entry is trusted for revalidateInterval, then
+ * the path is stat'ed again: a file replaced or modified since is reopened.
+ * Missing files are cached too, as StaticFileHandler looks up sidecar files
+ * which mostly don't exist.
+ */
+class StaticFileCache {
+ public:
+  struct Options {
+    size_t maxEntriesPerThread{1024};
+    std::chrono::milliseconds revalidateInterval{1000};
+  };
+
+  struct File {
+    std::shared_ptr<folly::File> file;
+    uint64_t size;
+    ino_t inode;
+    dev_t device;
+    time_t mtime;
+    // The Last-Modified header
+    std::string lastModified;
+  };
+
+  explicit StaticFileCache(const Options& options)
+      : options_(options) {}
+
+  /**
+   * The open regular file at path, nullptr if it can't be opened or isn't a
+   * regular file.
+   */
+  std::shared_ptr<const File> get(const std::string& path, TimePoint now);
+
+  // The counts of all threads
+  uint64_t getHits() const {
+    return hits_;
+  }
+
+  uint64_t getMisses() const {
+    return misses_;
+  }
+
+  // On the current thread
+  size_t getNumEntries() const {
+    return shards_->entries.size();
+  }
+
+ private:
+  struct Entry {
+    std::string path;
+    // nullptr if missing, or not a regular file
+    std::shared_ptr<const File> file;
+    TimePoint validated;
+  };
+  using EntryList = std::list<Entry>;
+
+  struct Shard {
+    // Most recently used first
+    EntryList entries;
+    std::unordered_map<std::string, EntryList::iterator> index;
+  };
+
+  static std::shared_ptr<const File> open(const std::string& path);
+
+  const Options options_;
+  folly::ThreadLocal<Shard> shards_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+}
@@ -0,0 +1,159 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/filters/StaticFileHandler.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/utils/UtilInl.h>
+
+namespace proxygen {
+
+namespace {
+// Precompressed sidecar files, e.g. app.js.br next to app.js, best first
+const std::pair<const char*, const char*> kSidecars[] = {
+  {"br", ".br"},
+  {"gzip", ".gz"},
+};
+
+bool acceptsEncoding(const std::vector<RFC2616::TokenQPair>& accepted,
+                     folly::StringPiece encoding) {
+  for (const auto& token : accepted) {
+    if (caseInsensitiveEqual(token.first, encoding)) {
+      return token.second > 0;
+    }
+  }
+  return false;
+}
+
+bool isSafePath(const std::string& path) {
+  if (path.empty() || path[0] != '/' ||
+      path.find('\0') != std::string::npos) {
+    return false;
+  }
+  std::vector<folly::StringPiece> segments;
+  folly::split('/', path, segments);
+  for (auto segment : segments) {
+    if (segment == "..") {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+void StaticFileHandler::onRequest(
+    std::unique_ptr<HTTPMessage> headers) noexcept {
+  auto method = headers->getMethod();
+  if (method != HTTPMethod::GET && method != HTTPMethod::HEAD) {
+    ResponseBuilder(downstream_)
+      .status(405, "Method Not Allowed")
+      .header(HTTP_HEADER_ALLOW, "GET, HEAD")
+      .sendWithEOM();
+    return;
+  }
+  const auto& path = headers->getPath();
+  if (!isSafePath(path)) {
+    sendError(400, "Bad Request");
+    return;
+  }
+  auto fullPath = root_ + path;
+  auto now = getCurrentTime();
+  auto file = cache_->get(fullPath, now);
+  if (!file) {
+    sendError(404, "Not Found");
+    return;
+  }
+
+  HTTPMessage response;
+  response.setHTTPVersion(1, 1);
+  auto& responseHeaders = response.getHeaders();
+  // Serve a precompressed sidecar the client accepts, sparing the
+  // compression filter from compressing the file on every request
+  std::vector<RFC2616::TokenQPair> accepted;
+  RFC2616::parseQvalues(
+    headers->getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT_ENCODING),
+    accepted);
+  bool hasSidecar = false;
+  for (const auto& sidecar : kSidecars) {
+    auto sidecarFile = cache_->get(fullPath + sidecar.second, now);
+    if (!sidecarFile) {
+      continue;
+    }
+    hasSidecar = true;
+    if (acceptsEncoding(accepted, sidecar.first)) {
+      file = std::move(sidecarFile);
+      responseHeaders.add(HTTP_HEADER_CONTENT_ENCODING, sidecar.first);
+      break;
+    }
+  }
+  if (hasSidecar) {
+    responseHeaders.add(HTTP_HEADER_VARY, "Accept-Encoding");
+  }
+  responseHeaders.add(HTTP_HEADER_ACCEPT_RANGES, "bytes");
+  responseHeaders.add(HTTP_HEADER_LAST_MODIFIED, file->lastModified);
+
+  unsigned long firstByte = 0;
+  unsigned long lastByte = file->size - 1;
+  auto range = RFC2616::ByteRange::INVALID;
+  const auto& rangeHeader =
+    headers->getHeaders().getSingleOrEmpty(HTTP_HEADER_RANGE);
+  if (!rangeHeader.empty()) {
+    const auto& ifRange =
+      headers->getHeaders().getSingleOrEmpty(HTTP_HEADER_IF_RANGE);
+    if (ifRange.empty() || ifRange == file->lastModified) {
+      range = RFC2616::parseByteRangeRequest(rangeHeader, file->size,
+                                             firstByte, lastByte);
+    }
+  }
+  uint64_t length = file->size;
+  switch (range) {
+    case RFC2616::ByteRange::SATISFIABLE:
+      length = lastByte - firstByte + 1;
+      response.setStatusCode(206);
+      response.setStatusMessage("Partial Content");
+      responseHeaders.add(
+        HTTP_HEADER_CONTENT_RANGE,
+        folly::to<std::string>("bytes ", firstByte, "-", lastByte, "/",
+                               file->size));
+      break;
+    case RFC2616::ByteRange::UNSATISFIABLE:
+      response.setStatusCode(416);
+      response.setStatusMessage("Range Not Satisfiable");
+      responseHeaders.add(HTTP_HEADER_CONTENT_RANGE,
+                          folly::to<std::string>("bytes */", file->size));
+      responseHeaders.add(HTTP_HEADER_CONTENT_LENGTH, "0");
+      downstream_->sendHeaders(response);
+      downstream_->sendEOM();
+      return;
+    case RFC2616::ByteRange::INVALID:
+      firstByte = 0;
+      response.setStatusCode(200);
+      response.setStatusMessage("OK");
+      break;
+  }
+  responseHeaders.add(HTTP_HEADER_CONTENT_LENGTH,
+                      folly::to<std::string>(length));
+  downstream_->sendHeaders(response);
+  if (method == HTTPMethod::GET && length > 0) {
+    downstream_->sendFileBody(file->file, firstByte, length);
+  }
+  downstream_->sendEOM();
+}
+
+void StaticFileHandler::sendError(uint16_t code, const std::string& message) {
+  ResponseBuilder(downstream_)
+    .status(code, message)
+    .body(message)
+    .sendWithEOM();
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/httpserver/RequestHandler.h>
+#include <proxygen/httpserver/filters/StaticFileCache.h>
+
+namespace proxygen {
+
+/**
+ * Handler serving the files under root, GET and HEAD only.
+ *
+ * Files are looked up in a StaticFileCache, and sent with sendFileBody(), so
+ * that HTTP/1.x sessions write them straight from the page cache with
+ * sendfile(2), and the others read them as egress allows.  A single range
+ * Range request gets a 206 (honoring If-Range with the Last-Modified date),
+ * other range requests the whole file.  A path.br or path.gz file is served
+ * instead if the client accepts that encoding.
+ *
+ * Paths with ".." segments are rejected, nothing else is: root should only
+ * hold files to serve.
+ */
+class StaticFileHandler : public RequestHandler {
+ public:
+  StaticFileHandler(std::shared_ptr<StaticFileCache> cache, std::string root)
+      : cache_(std::move(cache)), root_(std::move(root)) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override;
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
+
+  void onEOM() noexcept override {}
+
+  void onUpgrade(UpgradeProtocol /*prot*/) noexcept override {}
+
+  void requestComplete() noexcept override {
+    delete this;
+  }
+
+  void onError(ProxygenError /*err*/) noexcept override {
+    delete this;
+  }
+
+  void onEgressPaused() noexcept override {
+    // the transaction holds the rest of the file body until egress resumes
+  }
+
+  void onEgressResumed() noexcept override {}
+
+ private:
+  void sendError(uint16_t code, const std::string& message);
+
+  std::shared_ptr<StaticFileCache> cache_;
+  const std::string root_;
+};
+
+}
@@ -9,51 +9,157 @@
  */
 #pragma once
 
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/Executor.h>
 #include <folly/Memory.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <deque>
 
 #include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RecycledRequestHandler.h>
+#include <proxygen/httpserver/filters/CompressedBodyCache.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
-#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/CompressionLevelSelector.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
 #include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/utils/UtilInl.h>
+#include <proxygen/lib/utils/ZstdStreamCompressor.h>
 
 namespace proxygen {
 
 /**
- * A Server filter to perform GZip compression. If there are any errors it will
- * fall back to sending uncompressed responses.
+ * A Server filter to perform content compression, GZip unless given another
+ * encoding (deflate, brotli or zstd). If there are any errors it will fall
+ * back to sending uncompressed responses.
  */
-class ZlibServerFilter : public Filter {
+class ZlibServerFilter : public Filter,
+                         public RecycledRequestHandler<ZlibServerFilter> {
  public:
   explicit ZlibServerFilter(
       RequestHandler* downstream,
       int32_t compressionLevel,
       uint32_t minimumCompressionSize,
       const std::shared_ptr<std::set<std::string>> compressibleContentTypes)
+      : ZlibServerFilter(downstream,
+                         CompressionType::GZIP,
+                         compressionLevel,
+                         minimumCompressionSize,
+                         compressibleContentTypes) {}
+
+  // zstdDictionary, if any, replaces the compression level for ZSTD
+  ZlibServerFilter(
+      RequestHandler* downstream,
+      CompressionType encoding,
+      int32_t compressionLevel,
+      uint32_t minimumCompressionSize,
+      const std::shared_ptr<std::set<std::string>> compressibleContentTypes,
+      std::shared_ptr<const ZstdDictionary> zstdDictionary = nullptr)
       : Filter(downstream),
+        encoding_(encoding),
         compressionLevel_(compressionLevel),
         minimumCompressionSize_(minimumCompressionSize),
-        compressibleContentTypes_(compressibleContentTypes) {}
+        compressibleContentTypes_(compressibleContentTypes),
+        zstdDictionary_(std::move(zstdDictionary)) {}
+
+  ~ZlibServerFilter() override {
+    if (offloadState_) {
+      offloadState_->filter = nullptr;
+    }
+  }
+
+  /**
+   * Compresses the bodies of at least minimumSize bytes on executor rather
+   * than on the event base, keeping the order of the response and pausing
+   * the handler while over twice minimumSize bytes wait to be compressed.
+   */
+  void setOffloadExecutor(std::shared_ptr<folly::Executor> executor,
+                          size_t minimumSize) {
+    CHECK_GT(minimumSize, 0);
+    offloadExecutor_ = std::move(executor);
+    offloadMinimumSize_ = minimumSize;
+    offloadState_ = std::make_shared<OffloadState>(OffloadState{this});
+  }
+
+  /**
+   * Serves the bodies of non-chunked responses from cache, or caches them
+   * once compressed.  url qualifies their ETag, which is only unique per
+   * resource.
+   */
+  void setCompressedBodyCache(std::shared_ptr<CompressedBodyCache> cache,
+                              std::string url) {
+    cache_ = std::move(cache);
+    url_ = std::move(url);
+  }
+
+  /**
+   * Chooses the compression level from the response, the level given to
+   * the constructor being the default.
+   */
+  void setLevelSelector(std::shared_ptr<CompressionLevelSelector> selector) {
+    levelSelector_ = std::move(selector);
+  }
+
+  // The Content-Encoding token of a compression type, empty for NONE
+  static const char* getContentCoding(CompressionType type) {
+    switch (type) {
+      case CompressionType::DEFLATE:
+        return "deflate";
+      case CompressionType::GZIP:
+        return "gzip";
+      case CompressionType::ZSTD:
+        return "zstd";
+      case CompressionType::BROTLI:
+        return "br";
+      case CompressionType::RAW_DEFLATE:
+      case CompressionType::NONE:
+        break;
+    }
+    return "";
+  }
 
   void sendHeaders(HTTPMessage& msg) noexcept override {
+    if (msg.is1xxResponse()) {
+      // Informational, the final response decides the compression
+      Filter::sendHeaders(msg);
+      return;
+    }
     DCHECK(compressor_ == nullptr);
     DCHECK(header_ == false);
 
     chunked_ = msg.getIsChunked();
+    if (offloadExecutor_) {
+      evb_ = folly::EventBaseManager::get()->getExistingEventBase();
+    }
 
-    // Make final determination of whether to compress
+    // Make final determination of whether to compress, never compressing
+    // twice
     compress_ = isCompressibleContentType(msg) &&
-      (chunked_ || isMinimumCompressibleSize(msg));
+      (chunked_ || isMinimumCompressibleSize(msg)) &&
+      !msg.getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING);
 
-    // Add the gzip header
+    // Add the content encoding header
     if (compress_) {
       auto& headers = msg.getHeaders();
-      headers.set(HTTP_HEADER_CONTENT_ENCODING, "gzip");
+      headers.set(HTTP_HEADER_CONTENT_ENCODING, getContentCoding(encoding_));
+    }
+
+    if (compress_ && levelSelector_ && !(encoding_ == CompressionType::ZSTD &&
+                                         zstdDictionary_)) {
+      compressionLevel_ = levelSelector_->getLevel(
+        encoding_, compressionLevel_, chunked_ ? 0 : getContentLength(msg));
     }
 
-    // Initialize compressor
-    compressor_ = std::make_unique<ZlibStreamCompressor>(
-        proxygen::CompressionType::GZIP, compressionLevel_);
-    if (!compressor_ || compressor_->hasError()) {
+    // Initialize compressor, reusing a pooled one
+    if (!compress_) {
+      // Nothing to compress
+    } else if (encoding_ == CompressionType::ZSTD && zstdDictionary_) {
+      compressor_ = std::make_unique<ZstdStreamCompressor>(zstdDictionary_);
+    } else {
+      compressor_ = StreamCodecPool::getCompressor(encoding_,
+                                                   compressionLevel_);
+    }
+    if (compress_ && (!compressor_ || compressor_->hasError())) {
       fail();
       return;
     }
@@ -90,15 +196,161 @@ class ZlibServerFilter : public Filter {
       Filter::sendBody(std::move(body));
       return;
     }
+    if (aborted_) {
+      return;
+    }
 
-    CHECK(compressor_ && !compressor_->hasError());
+    // Keep the order of the bodies compressing on the offload executor
+    if (isOffloading() || shouldOffload(*body)) {
+      enqueue(Op::BODY, std::move(body));
+      return;
+    }
 
+    CHECK(compressor_ && !compressor_->hasError());
     // If it's chunked, never write the trailer, it will be written on EOM
-    auto compressed = compressor_->compress(body.get(), !chunked_);
-    if (compressor_->hasError()) {
+    auto compressed = compressBody(*compressor_, cache_.get(), getCacheKey(),
+                                   encoding_, compressionLevel_, *body,
+                                   !chunked_);
+    if (!compressed) {
       return fail();
     }
+    sendCompressed(std::move(compressed));
+  }
+
+  // The compressor needs the file body in memory
+  void sendFileBody(std::shared_ptr<folly::File> file,
+                    off_t offset,
+                    size_t length) noexcept override {
+    if (!compress_) {
+      Filter::sendFileBody(std::move(file), offset, length);
+      return;
+    }
+    auto body = folly::IOBuf::create(length);
+    auto rc = folly::preadFull(file->fd(), body->writableData(), length,
+                               offset);
+    if (rc != static_cast<ssize_t>(length)) {
+      LOG(ERROR) << "Failed to read file body, rc=" << rc;
+      sendAbort();
+      return;
+    }
+    body->append(length);
+    sendBody(std::move(body));
+  }
 
+  void sendChunkTerminator() noexcept override {
+    if (isOffloading()) {
+      enqueue(Op::CHUNK_TERMINATOR, nullptr);
+      return;
+    }
+    Filter::sendChunkTerminator();
+  }
+
+  void sendEOM() noexcept override {
+    if (isOffloading()) {
+      enqueue(Op::EOM, nullptr);
+      return;
+    }
+
+    // Need to send the trailer for compressed chunked messages
+    if (compress_ && chunked_) {
+
+      auto emptyBuffer = folly::IOBuf::copyBuffer("");
+      CHECK(compressor_ && !compressor_->hasError());
+      auto compressed = compressor_->compress(emptyBuffer.get(), true);
+
+      if (compressor_->hasError()) {
+        fail();
+        return;
+      }
+
+      // "Inject" a chunk with the trailer.
+      Filter::sendChunkHeader(compressed->computeChainDataLength());
+      Filter::sendBody(std::move(compressed));
+      Filter::sendChunkTerminator();
+    }
+
+    Filter::sendEOM();
+  }
+
+  void sendAbort() noexcept override {
+    aborted_ = true;
+    pending_.clear();
+    Filter::sendAbort();
+  }
+
+  void onEgressPaused() noexcept override {
+    egressPaused_ = true;
+    if (!queuePaused_) {
+      Filter::onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    egressPaused_ = false;
+    auto state = offloadState_;
+    if (state) {
+      pumpQueue();
+      if (!state->filter) {
+        return;
+      }
+    }
+    if (!queuePaused_) {
+      Filter::onEgressResumed();
+    }
+  }
+
+ protected:
+  // A response operation waiting for the bodies compressing before it
+  struct Op {
+    enum Type { BODY, CHUNK_TERMINATOR, EOM };
+    Type type;
+    std::unique_ptr<folly::IOBuf> body;
+  };
+
+  // Outlives the filter while it has a body compressing on the executor
+  struct OffloadState {
+    ZlibServerFilter* filter;
+  };
+
+  void fail() {
+    sendAbort();
+  }
+
+  /**
+   * Compresses body, from the cache if cacheKey is not empty, a "hash:"
+   * key being completed with the hash of body.  Returns nullptr on errors.
+   * Runs on the offload executor for large bodies, so only uses its
+   * arguments.
+   */
+  static std::unique_ptr<folly::IOBuf> compressBody(
+      StreamCompressor& compressor,
+      CompressedBodyCache* cache,
+      std::string cacheKey,
+      CompressionType encoding,
+      int32_t level,
+      const folly::IOBuf& body,
+      bool trailer) {
+    if (!cacheKey.empty()) {
+      if (cacheKey == getHashKey()) {
+        cacheKey += CompressedBodyCache::hashBody(body);
+      }
+      auto cached = cache->get(cacheKey, encoding, level);
+      if (cached) {
+        return cached;
+      }
+    }
+    auto compressed = compressor.compress(&body, trailer);
+    if (compressor.hasError()) {
+      return nullptr;
+    }
+    if (!cacheKey.empty()) {
+      cache->put(cacheKey, encoding, level, *compressed);
+    }
+    return compressed;
+  }
+
+  // Sends compressed, with the chunk header or the headers it needs
+  void sendCompressed(std::unique_ptr<folly::IOBuf> compressed) {
     auto compressedBodyLength = compressed->computeChainDataLength();
 
     if (chunked_) {
@@ -119,37 +371,152 @@ class ZlibServerFilter : public Filter {
     Filter::sendBody(std::move(compressed));
   }
 
-  void sendEOM() noexcept override {
+  // Whether response operations wait for bodies compressing
+  bool isOffloading() const {
+    return compressing_ || !pending_.empty();
+  }
 
-    // Need to send the gzip trailer for compressed chunked messages
-    if (compress_ && chunked_) {
+  bool shouldOffload(const folly::IOBuf& body) const {
+    return offloadExecutor_ && evb_ &&
+      body.computeChainDataLength() >= offloadMinimumSize_;
+  }
 
-      auto emptyBuffer = folly::IOBuf::copyBuffer("");
-      CHECK(compressor_ && !compressor_->hasError());
-      auto compressed = compressor_->compress(emptyBuffer.get(), true);
+  void enqueue(Op::Type type, std::unique_ptr<folly::IOBuf> body) {
+    if (body) {
+      queuedBytes_ += body->computeChainDataLength();
+    }
+    pending_.push_back(Op{type, std::move(body)});
+    // Backpressure on the handler while the executor catches up
+    if (!queuePaused_ && queuedBytes_ > 2 * offloadMinimumSize_) {
+      queuePaused_ = true;
+      if (!egressPaused_) {
+        Filter::onEgressPaused();
+      }
+    }
+    pumpQueue();
+  }
 
-      if (compressor_->hasError()) {
-        fail();
+  /**
+   * Runs the pending operations in order, until one compresses on the
+   * executor.  Holds off while egress is paused, there being no point in
+   * compressing what can't be sent yet.
+   */
+  void pumpQueue() {
+    if (pumping_) {
+      return;
+    }
+    pumping_ = true;
+    auto state = offloadState_;
+    while (!compressing_ && !egressPaused_ && !pending_.empty() &&
+           !aborted_) {
+      auto op = std::move(pending_.front());
+      pending_.pop_front();
+      if (op.type == Op::BODY) {
+        queuedBytes_ -= op.body->computeChainDataLength();
+        if (shouldOffload(*op.body)) {
+          startCompressing(std::move(op.body));
+          break;
+        }
+        auto compressed = compressBody(*compressor_, cache_.get(),
+                                       getCacheKey(), encoding_,
+                                       compressionLevel_, *op.body,
+                                       !chunked_);
+        if (!compressed) {
+          pumping_ = false;
+          return fail();
+        }
+        sendCompressed(std::move(compressed));
+      } else if (op.type == Op::CHUNK_TERMINATOR) {
+        Filter::sendChunkTerminator();
+      } else {
+        // The last operation, which may delete this
+        pumping_ = false;
+        sendEOM();
+        return;
+      }
+      if (!state->filter) {
+        // Deleted by an error
         return;
       }
+    }
+    pumping_ = false;
+    maybeResumeHandler();
+  }
 
-      // "Inject" a chunk with the gzip trailer.
-      Filter::sendChunkHeader(compressed->computeChainDataLength());
-      Filter::sendBody(std::move(compressed));
-      Filter::sendChunkTerminator();
+  void maybeResumeHandler() {
+    if (queuePaused_ && queuedBytes_ <= offloadMinimumSize_) {
+      queuePaused_ = false;
+      if (!egressPaused_) {
+        Filter::onEgressResumed();
+      }
     }
+  }
 
-    Filter::sendEOM();
+  // Compresses body on the executor, then sends it from the event base
+  void startCompressing(std::unique_ptr<folly::IOBuf> body) {
+    compressing_ = true;
+    offloadExecutor_->add(
+      [state = offloadState_, evb = evb_, compressor = compressor_,
+       cache = cache_, cacheKey = getCacheKey(), encoding = encoding_,
+       level = compressionLevel_, body = std::move(body),
+       trailer = !chunked_] () mutable {
+        auto compressed = compressBody(*compressor, cache.get(),
+                                       std::move(cacheKey), encoding, level,
+                                       *body, trailer);
+        evb->runInEventBaseThread(
+          [state = std::move(state),
+           compressed = std::move(compressed)] () mutable {
+            if (state->filter) {
+              state->filter->onCompressed(std::move(compressed));
+            }
+          });
+      });
   }
 
- protected:
+  void onCompressed(std::unique_ptr<folly::IOBuf> compressed) {
+    compressing_ = false;
+    if (aborted_) {
+      return;
+    }
+    if (!compressed) {
+      return fail();
+    }
+    auto state = offloadState_;
+    sendCompressed(std::move(compressed));
+    if (state->filter) {
+      pumpQueue();
+    }
+  }
 
-  void fail() {
-    Filter::sendAbort();
+  /**
+   * The cache key of the body of a non-chunked response, empty if it is not
+   * to be cached, getHashKey() for the hash of the body.
+   */
+  std::string getCacheKey() const {
+    if (!cache_ || chunked_ ||
+        (zstdDictionary_ && encoding_ == CompressionType::ZSTD)) {
+      return "";
+    }
+    // A strong ETag saves hashing the body, weak ones don't promise the same
+    // bytes
+    auto etag = responseMessage_->getHeaders().getSingleOrEmpty(
+      HTTP_HEADER_ETAG);
+    if (!etag.empty() && etag[0] == '"') {
+      return folly::to<std::string>("etag:", etag, ':', url_);
+    }
+    return getHashKey();
+  }
+
+  static const char* getHashKey() {
+    return "hash:";
   }
 
   //Verify the response is large enough to compress
   bool isMinimumCompressibleSize(const HTTPMessage& msg) const noexcept {
+    return getContentLength(msg) >= minimumCompressionSize_;
+  }
+
+  static uint32_t getContentLength(const HTTPMessage& msg) noexcept {
     auto contentLengthHeader =
         msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH);
 
@@ -157,8 +524,7 @@ class ZlibServerFilter : public Filter {
     if (!contentLengthHeader.empty()) {
       contentLength = folly::to<uint32_t>(contentLengthHeader);
     }
-
-    return contentLength >= minimumCompressionSize_;
+    return contentLength;
   }
 
   // Check the response's content type against a list of compressible types
@@ -184,25 +550,100 @@ class ZlibServerFilter : public Filter {
   }
 
   std::unique_ptr<HTTPMessage> responseMessage_;
-  std::unique_ptr<ZlibStreamCompressor> compressor_{nullptr};
+  std::shared_ptr<StreamCompressor> compressor_{nullptr};
+  CompressionType encoding_{CompressionType::GZIP};
   int32_t compressionLevel_{4};
   uint32_t minimumCompressionSize_{1000};
   const std::shared_ptr<std::set<std::string>> compressibleContentTypes_;
+  const std::shared_ptr<const ZstdDictionary> zstdDictionary_;
+  std::shared_ptr<CompressedBodyCache> cache_;
+  std::shared_ptr<CompressionLevelSelector> levelSelector_;
+  std::string url_;
+  std::shared_ptr<folly::Executor> offloadExecutor_;
+  size_t offloadMinimumSize_{0};
+  folly::EventBase* evb_{nullptr};
+  std::shared_ptr<OffloadState> offloadState_;
+  std::deque<Op> pending_;
+  // Bytes of the pending bodies
+  size_t queuedBytes_{0};
+  bool compressing_{false};
+  bool pumping_{false};
+  bool egressPaused_{false};
+  // Whether the handler was paused for the pending bodies
+  bool queuePaused_{false};
+  bool aborted_{false};
   bool header_{false};
   bool chunked_{false};
   bool compress_{false};
 };
 
+/**
+ * Compresses the responses to requests accepting one of the encodings given,
+ * with the encoding the client prefers per its Accept-Encoding q-values, then
+ * the first in the order given.
+ */
 class ZlibServerFilterFactory : public RequestHandlerFactory {
  public:
+  // A compression type and its level
+  using Encoding = std::pair<CompressionType, int32_t>;
+
   explicit ZlibServerFilterFactory(
       int32_t compressionLevel,
       uint32_t minimumCompressionSize,
       const std::set<std::string> compressibleContentTypes)
-      : compressionLevel_(compressionLevel),
-        minimumCompressionSize_(minimumCompressionSize),
+      : ZlibServerFilterFactory({{CompressionType::GZIP, compressionLevel}},
+                                minimumCompressionSize,
+                                compressibleContentTypes) {}
+
+  // Encodings this build can't compress with are ignored
+  ZlibServerFilterFactory(
+      const std::vector<Encoding>& encodings,
+      uint32_t minimumCompressionSize,
+      const std::set<std::string> compressibleContentTypes)
+      : minimumCompressionSize_(minimumCompressionSize),
         compressibleContentTypes_(
             std::make_shared<std::set<std::string>>(compressibleContentTypes)) {
+    for (const auto& encoding : encodings) {
+      if (isStreamCompressorSupported(encoding.first)) {
+        encodings_.push_back(encoding);
+      } else {
+        LOG(WARNING) << "Unsupported content encoding "
+                     << static_cast<int>(encoding.first);
+      }
+    }
+  }
+
+  /**
+   * Compresses zstd responses with a pre-trained dictionary, which the
+   * clients must have too.  Meant for traffic between our own services.
+   */
+  void setZstdDictionary(std::shared_ptr<const ZstdDictionary> dictionary) {
+    zstdDictionary_ = std::move(dictionary);
+  }
+
+  /**
+   * Compresses the bodies of at least minimumSize bytes on executor, not to
+   * block the event bases.
+   */
+  void setOffloadExecutor(std::shared_ptr<folly::Executor> executor,
+                          size_t minimumSize) {
+    offloadExecutor_ = std::move(executor);
+    offloadMinimumSize_ = minimumSize;
+  }
+
+  /**
+   * Shares cache between the filters, to compress each repeated body once.
+   */
+  void setCompressedBodyCache(std::shared_ptr<CompressedBodyCache> cache) {
+    cache_ = std::move(cache);
+  }
+
+  /**
+   * Chooses the level of each response with selector, the levels of the
+   * encodings being the defaults.
+   */
+  void setLevelSelector(std::shared_ptr<CompressionLevelSelector> selector) {
+    levelSelector_ = std::move(selector);
   }
 
   void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
@@ -211,13 +652,25 @@ class ZlibServerFilterFactory : public RequestHandlerFactory {
 
   RequestHandler* onRequest(RequestHandler* h,
                             HTTPMessage* msg) noexcept override {
-
-    if (acceptsSupportedCompressionType(msg)) {
+    auto encoding = selectEncoding(*msg);
+    if (encoding != encodings_.end()) {
       auto zlibServerFilter =
           new ZlibServerFilter(h,
-              compressionLevel_,
+              encoding->first,
+              encoding->second,
               minimumCompressionSize_,
-              compressibleContentTypes_);
+              compressibleContentTypes_,
+              zstdDictionary_);
+      if (cache_) {
+        zlibServerFilter->setCompressedBodyCache(cache_, msg->getURL());
+      }
+      if (levelSelector_) {
+        zlibServerFilter->setLevelSelector(levelSelector_);
+      }
+      if (offloadExecutor_) {
+        zlibServerFilter->setOffloadExecutor(offloadExecutor_,
+                                             offloadMinimumSize_);
+      }
       return zlibServerFilter;
     }
 
@@ -225,31 +678,61 @@ class ZlibServerFilterFactory : public RequestHandlerFactory {
     return h;
   }
 
+  /**
+   * The type the response to msg is to be compressed with, NONE if the client
+   * accepts none of the encodings.
+   */
+  CompressionType getEncoding(const HTTPMessage& msg) const noexcept {
+    auto encoding = selectEncoding(msg);
+    return encoding != encodings_.end() ? encoding->first
+                                        : CompressionType::NONE;
+  }
+
  protected:
 
-  // Check whether the client supports a compression type we support
-  bool acceptsSupportedCompressionType(HTTPMessage* msg) noexcept {
+  // The encoding with the highest client qvalue, ties going to the first
+  std::vector<Encoding>::const_iterator selectEncoding(
+      const HTTPMessage& msg) const noexcept {
 
     std::vector<RFC2616::TokenQPair> output;
 
     //Accept encoding header could have qvalues (gzip; q=5.0)
     auto acceptEncodingHeader =
-        msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT_ENCODING);
-
-    if (RFC2616::parseQvalues(acceptEncodingHeader, output)) {
-      std::vector<RFC2616::TokenQPair>::iterator it = std::find_if(
-          output.begin(), output.end(), [](RFC2616::TokenQPair elem) {
-            return elem.first.compare(folly::StringPiece("gzip")) == 0;
-          });
-
-      return (it != output.end());
+        msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT_ENCODING);
+    if (!RFC2616::parseQvalues(acceptEncodingHeader, output)) {
+      return encodings_.end();
     }
 
-    return false;
+    auto best = encodings_.end();
+    double bestQvalue = 0;
+    for (auto it = encodings_.begin(); it != encodings_.end(); ++it) {
+      // An explicit token overrides "*", and q=0 refuses the encoding
+      folly::StringPiece coding(ZlibServerFilter::getContentCoding(it->first));
+      double qvalue = 0;
+      for (const auto& token : output) {
+        if (caseInsensitiveEqual(token.first, coding)) {
+          qvalue = token.second;
+          break;
+        }
+        if (token.first == "*") {
+          qvalue = token.second;
+        }
+      }
+      if (qvalue > bestQvalue) {
+        bestQvalue = qvalue;
+        best = it;
+      }
+    }
+    return best;
   }
 
-  int32_t compressionLevel_;
+  std::vector<Encoding> encodings_;
   uint32_t minimumCompressionSize_;
   const std::shared_ptr<std::set<std::string>> compressibleContentTypes_;
+  std::shared_ptr<const ZstdDictionary> zstdDictionary_;
+  std::shared_ptr<CompressedBodyCache> cache_;
+  std::shared_ptr<CompressionLevelSelector> levelSelector_;
+  std::shared_ptr<folly::Executor> offloadExecutor_;
+  size_t offloadMinimumSize_{0};
 };
 }
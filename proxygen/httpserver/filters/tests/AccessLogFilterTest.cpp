@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/AccessLogFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+class AccessLogFilterTest : public Test {
+ public:
+  AccessLogFilterTest() {
+    options_.path = file_.path().string();
+    // Only drained from the destructor
+    options_.flushInterval = std::chrono::hours(1);
+  }
+
+  std::string readLog() {
+    std::string log;
+    EXPECT_TRUE(folly::readFile(options_.path.c_str(), log));
+    return log;
+  }
+
+ protected:
+  folly::test::TemporaryFile file_;
+  AccessLogWriter::Options options_;
+};
+
+TEST_F(AccessLogFilterTest, Format) {
+  AccessLogRecord record;
+  record.timestampMs = 1570715736000;
+  record.durationUs = 851;
+  record.bytesReceived = 12;
+  record.bytesSent = 2326;
+  record.statusCode = 200;
+  record.method = uint8_t(HTTPMethod::GET);
+  auto addr = folly::IPAddress("1.2.3.4");
+  record.clientAddressLength = addr.byteCount();
+  memcpy(record.clientAddress, addr.bytes(), addr.byteCount());
+  record.setPath("/a");
+
+  std::string line;
+  AccessLogWriter::format(record, line);
+  EXPECT_EQ(line,
+            "1.2.3.4 - - [10/Oct/2019:13:55:36 +0000] \"GET /a\" "
+            "200 2326 12 851\n");
+
+  record.clientAddressLength = 0;
+  record.method = AccessLogRecord::kUnknownMethod;
+  record.setPath(std::string(200, 'x'));
+  line.clear();
+  AccessLogWriter::format(record, line);
+  EXPECT_EQ(line.find("- - ["), 0);
+  EXPECT_NE(line.find("\"- " + std::string(128, 'x') + "\" "),
+            std::string::npos);
+}
+
+TEST_F(AccessLogFilterTest, FilterRecords) {
+  auto writer = std::make_shared<AccessLogWriter>(options_);
+  auto ring = writer->newRing();
+
+  auto requestHandler = new MockRequestHandler();
+  MockResponseHandler responseHandler(requestHandler);
+  EXPECT_CALL(*requestHandler, setResponseHandler(_));
+  EXPECT_CALL(*requestHandler, onRequest(_));
+  EXPECT_CALL(*requestHandler, onBody(_));
+  EXPECT_CALL(*requestHandler, requestComplete());
+  EXPECT_CALL(responseHandler, sendHeaders(_));
+  EXPECT_CALL(responseHandler, sendBody(_));
+
+  auto filter = new AccessLogFilter(requestHandler, *ring);
+  filter->setResponseHandler(&responseHandler);
+  auto msg = std::make_unique<HTTPMessage>();
+  msg->setMethod(HTTPMethod::POST);
+  msg->setURL("/upload?x=1");
+  msg->setClientAddress(folly::SocketAddress("::1", 1234));
+  filter->onRequest(std::move(msg));
+  filter->onBody(folly::IOBuf::copyBuffer("12345"));
+  HTTPMessage response;
+  response.setStatusCode(201);
+  filter->sendHeaders(response);
+  filter->sendBody(folly::IOBuf::copyBuffer("ok"));
+  filter->requestComplete();
+  delete requestHandler;
+
+  writer.reset();
+  auto log = readLog();
+  EXPECT_EQ(log.find("::1 - - ["), 0);
+  EXPECT_NE(log.find("\"POST /upload\" 201 2 5 "), std::string::npos);
+  EXPECT_EQ(log.back(), '\n');
+}
+
+TEST_F(AccessLogFilterTest, DropWhenFull) {
+  options_.ringSize = 2;
+  {
+    AccessLogWriter writer(options_);
+    auto ring = writer.newRing();
+    AccessLogRecord record;
+    record.setPath("/");
+    EXPECT_TRUE(ring->push(record));
+    EXPECT_TRUE(ring->push(record));
+    EXPECT_FALSE(ring->push(record));
+    EXPECT_EQ(ring->getNumDropped(), 1);
+    EXPECT_EQ(writer.getNumDropped(), 1);
+  }
+  auto log = readLog();
+  EXPECT_EQ(std::count(log.begin(), log.end(), '\n'), 2);
+}
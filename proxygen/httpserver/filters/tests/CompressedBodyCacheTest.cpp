@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/filters/CompressedBodyCache.h>
+
+using namespace proxygen;
+
+TEST(CompressedBodyCacheTest, GetPut) {
+  CompressedBodyCache cache(1000);
+  auto body = folly::IOBuf::copyBuffer("compressed");
+  EXPECT_EQ(cache.get("key", CompressionType::GZIP, 4), nullptr);
+
+  cache.put("key", CompressionType::GZIP, 4, *body);
+  auto cached = cache.get("key", CompressionType::GZIP, 4);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(cached->moveToFbString(), "compressed");
+  // Shares the cached buffer
+  EXPECT_TRUE(cache.get("key", CompressionType::GZIP, 4)->isShared());
+
+  // The type and level are part of the key
+  EXPECT_EQ(cache.get("key", CompressionType::GZIP, 6), nullptr);
+  EXPECT_EQ(cache.get("key", CompressionType::ZSTD, 4), nullptr);
+  EXPECT_EQ(cache.getHits(), 2);
+  EXPECT_EQ(cache.getMisses(), 3);
+}
+
+TEST(CompressedBodyCacheTest, EvictLeastRecentlyUsed) {
+  CompressedBodyCache cache(800);
+  auto body = folly::IOBuf::copyBuffer(std::string(100, 'x'));
+  for (int i = 0; i < 8; i++) {
+    cache.put(folly::to<std::string>(i), CompressionType::GZIP, 4, *body);
+  }
+  EXPECT_EQ(cache.getSize(), 800);
+  EXPECT_NE(cache.get("0", CompressionType::GZIP, 4), nullptr);
+
+  // Evicts 1, 0 having been used since
+  cache.put("8", CompressionType::GZIP, 4, *body);
+  EXPECT_EQ(cache.getNumEntries(), 8);
+  EXPECT_EQ(cache.get("1", CompressionType::GZIP, 4), nullptr);
+  EXPECT_NE(cache.get("0", CompressionType::GZIP, 4), nullptr);
+
+  // Too large to cache
+  auto large = folly::IOBuf::copyBuffer(std::string(101, 'x'));
+  cache.put("large", CompressionType::GZIP, 4, *large);
+  EXPECT_EQ(cache.get("large", CompressionType::GZIP, 4), nullptr);
+}
+
+TEST(CompressedBodyCacheTest, HashBody) {
+  auto body = folly::IOBuf::copyBuffer("Hello ");
+  body->prependChain(folly::IOBuf::copyBuffer("World"));
+  auto hash = CompressedBodyCache::hashBody(*body);
+  EXPECT_EQ(hash.size(), 32);
+  EXPECT_EQ(hash,
+            CompressedBodyCache::hashBody(*folly::IOBuf::copyBuffer(
+                "Hello World")));
+  EXPECT_NE(hash,
+            CompressedBodyCache::hashBody(*folly::IOBuf::copyBuffer(
+                "Hello world")));
+}
@@ -0,0 +1,124 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/CpuTimeFilter.h>
+#include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+
+using namespace proxygen;
+using namespace testing;
+using std::chrono::nanoseconds;
+
+namespace {
+
+// A MockResponseHandler on a transaction
+class TxnResponseHandler : public MockResponseHandler {
+ public:
+  TxnResponseHandler(RequestHandler* h, HTTPTransaction* txn)
+      : MockResponseHandler(h) {
+    txn_ = txn;
+  }
+};
+
+}
+
+class CpuTimeFilterTest : public Test {
+ public:
+  void SetUp() override {
+    requestHandler_ = new MockRequestHandler();
+    responseHandler_ =
+      std::make_unique<TxnResponseHandler>(requestHandler_, &txn_);
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_));
+    EXPECT_CALL(*requestHandler_, onRequest(_));
+  }
+
+  void TearDown() override {
+    Mock::VerifyAndClear(requestHandler_);
+    Mock::VerifyAndClear(responseHandler_.get());
+
+    delete requestHandler_;
+  }
+
+ protected:
+  HTTP2PriorityQueue egressQueue_;
+  NiceMock<MockHTTPTransaction> txn_{
+    TransportDirection::DOWNSTREAM, 1, 0, egressQueue_};
+  MockRequestHandler* requestHandler_;
+  std::unique_ptr<TxnResponseHandler> responseHandler_;
+  CpuTimeStats stats_;
+  CpuTimeFilter::Options options_;
+
+  RequestHandler* makeFilter(const std::string& url) {
+    auto filter = new CpuTimeFilter(requestHandler_, stats_, options_);
+    filter->setResponseHandler(responseHandler_.get());
+    HTTPMessage msg;
+    msg.setMethod(HTTPMethod::GET);
+    msg.setURL(url);
+    filter->onRequest(std::make_unique<HTTPMessage>(msg));
+    return filter;
+  }
+};
+
+TEST_F(CpuTimeFilterTest, NotSampled) {
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter("/index.html");
+  filter->requestComplete();
+  EXPECT_TRUE(stats_.getRoutes().empty());
+}
+
+TEST_F(CpuTimeFilterTest, RecordsByPath) {
+  txn_.setCpuTimeAccounting(true);
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter("/index.html?q=1");
+  filter->requestComplete();
+  auto routes = stats_.getRoutes();
+  ASSERT_EQ(routes.size(), 1);
+  EXPECT_EQ(routes["/index.html"].requests, 1);
+}
+
+TEST_F(CpuTimeFilterTest, RecordsOnError) {
+  txn_.setCpuTimeAccounting(true);
+  options_.route = [] (const HTTPMessage& msg) {
+    return msg.getPath().substr(0, msg.getPath().find('/', 1));
+  };
+  EXPECT_CALL(*requestHandler_, onError(kErrorTimeout));
+
+  auto filter = makeFilter("/api/users/1");
+  filter->onError(kErrorTimeout);
+  auto routes = stats_.getRoutes();
+  ASSERT_EQ(routes.size(), 1);
+  EXPECT_EQ(routes["/api"].requests, 1);
+}
+
+TEST(CpuTimeStatsTest, Aggregate) {
+  CpuTimeStats stats(2);
+  stats.record("/a", nanoseconds(100));
+  stats.record("/a", nanoseconds(300));
+  stats.record("/b", nanoseconds(50));
+  // Beyond maxRoutes
+  stats.record("/c", nanoseconds(10));
+  stats.record("/d", nanoseconds(20));
+
+  auto routes = stats.getRoutes();
+  EXPECT_EQ(routes.size(), 3);
+  EXPECT_EQ(routes["/a"].requests, 2);
+  EXPECT_EQ(routes["/a"].total, nanoseconds(400));
+  EXPECT_EQ(routes["/a"].max, nanoseconds(300));
+  EXPECT_EQ(routes["/b"].requests, 1);
+  auto& other = routes[CpuTimeStats::otherRoute()];
+  EXPECT_EQ(other.requests, 2);
+  EXPECT_EQ(other.total, nanoseconds(30));
+
+  stats.reset();
+  EXPECT_TRUE(stats.getRoutes().empty());
+}
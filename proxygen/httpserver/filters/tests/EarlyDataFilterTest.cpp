@@ -0,0 +1,189 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/EarlyDataFilter.h>
+#include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+// A MockResponseHandler on a transaction
+class TxnResponseHandler : public MockResponseHandler {
+ public:
+  TxnResponseHandler(RequestHandler* h, HTTPTransaction* txn)
+      : MockResponseHandler(h) {
+    txn_ = txn;
+  }
+};
+
+}
+
+class EarlyDataFilterTest : public Test {
+ public:
+  void SetUp() override {
+    requestHandler_ = new MockRequestHandler();
+    responseHandler_ =
+      std::make_unique<TxnResponseHandler>(requestHandler_, &txn_);
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_));
+  }
+
+  void TearDown() override {
+    Mock::VerifyAndClear(requestHandler_);
+    Mock::VerifyAndClear(responseHandler_.get());
+
+    delete requestHandler_;
+  }
+
+ protected:
+  HTTP2PriorityQueue egressQueue_;
+  NiceMock<MockHTTPTransaction> txn_{
+    TransportDirection::DOWNSTREAM, 1, 0, egressQueue_};
+  MockRequestHandler* requestHandler_;
+  std::unique_ptr<TxnResponseHandler> responseHandler_;
+  EarlyDataFilter::Options options_;
+
+  RequestHandler* makeFilter(HTTPMethod method, bool replaySafe,
+                             const std::string& url = "/") {
+    EXPECT_CALL(txn_, isReplaySafe()).WillRepeatedly(Return(replaySafe));
+    HTTPMessage msg;
+    msg.setMethod(method);
+    msg.setURL(url);
+    return makeFilter(msg);
+  }
+
+  RequestHandler* makeFilter(const HTTPMessage& msg) {
+    auto filter = new EarlyDataFilter(requestHandler_, options_);
+    filter->setResponseHandler(responseHandler_.get());
+    filter->onRequest(std::make_unique<HTTPMessage>(msg));
+    return filter;
+  }
+
+  void expectEarlyDataHeader(bool early) {
+    EXPECT_CALL(*requestHandler_, onRequest(_))
+      .WillOnce(Invoke([early] (std::shared_ptr<HTTPMessage> msg) {
+          EXPECT_EQ(msg->getHeaders().exists("Early-Data"), early);
+        }));
+  }
+
+  void expectTooEarly() {
+    EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+    EXPECT_CALL(*requestHandler_, onError(kErrorEarlyDataRejected));
+    EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke([] (HTTPMessage& msg) {
+          EXPECT_EQ(msg.getStatusCode(), 425);
+        }));
+    EXPECT_CALL(*responseHandler_, sendEOM());
+  }
+};
+
+TEST_F(EarlyDataFilterTest, ReplaySafe) {
+  expectEarlyDataHeader(false);
+  EXPECT_CALL(txn_, addWaitingForReplaySafety(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter(HTTPMethod::POST, true);
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, SafeMethodAsEarlyData) {
+  expectEarlyDataHeader(true);
+  EXPECT_CALL(txn_, addWaitingForReplaySafety(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter(HTTPMethod::GET, false);
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, UnsafeMethodHeld) {
+  folly::AsyncTransport::ReplaySafetyCallback* callback = nullptr;
+  EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+  EXPECT_CALL(*responseHandler_, pauseIngress());
+  EXPECT_CALL(txn_, addWaitingForReplaySafety(_))
+    .WillOnce(SaveArg<0>(&callback));
+
+  auto filter = makeFilter(HTTPMethod::POST, false);
+  filter->onBody(folly::IOBuf::copyBuffer("hello "));
+  filter->onBody(folly::IOBuf::copyBuffer("world"));
+  filter->onEOM();
+  Mock::VerifyAndClear(requestHandler_);
+  ASSERT_NE(callback, nullptr);
+
+  // Released once the handshake completes
+  InSequence seq;
+  expectEarlyDataHeader(false);
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillOnce(Invoke([] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->moveToFbString(), "hello world");
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*responseHandler_, resumeIngress());
+  callback->onReplaySafe();
+
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, ErrorWhileHeld) {
+  EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+  EXPECT_CALL(txn_, addWaitingForReplaySafety(_));
+  EXPECT_CALL(txn_, removeWaitingForReplaySafety(_));
+  EXPECT_CALL(*requestHandler_, onError(kErrorTimeout));
+
+  auto filter = makeFilter(HTTPMethod::POST, false);
+  filter->onError(kErrorTimeout);
+}
+
+TEST_F(EarlyDataFilterTest, RejectUnsafe) {
+  options_.rejectUnsafe = true;
+  expectTooEarly();
+  EXPECT_CALL(txn_, addWaitingForReplaySafety(_)).Times(0);
+
+  auto filter = makeFilter(HTTPMethod::POST, false);
+  filter->onBody(folly::IOBuf::copyBuffer("dropped"));
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, ForwardedEarlyData) {
+  // A proxy received it as early data, our own connection is replay safe
+  expectTooEarly();
+  EXPECT_CALL(txn_, isReplaySafe()).WillRepeatedly(Return(true));
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::POST);
+  msg.setURL("/");
+  msg.getHeaders().set("Early-Data", "1");
+
+  auto filter = makeFilter(msg);
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST_F(EarlyDataFilterTest, RouteOptIn) {
+  options_.allowed = [] (const HTTPMessage& msg) {
+    return msg.getPath() == "/idempotent" ||
+      EarlyDataFilter::isAllowedByDefault(msg);
+  };
+  expectEarlyDataHeader(true);
+  EXPECT_CALL(txn_, addWaitingForReplaySafety(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter(HTTPMethod::POST, false, "/idempotent");
+  filter->onEOM();
+  filter->requestComplete();
+}
@@ -0,0 +1,222 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/MessageFramingFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+class MessageFramingFilterTest : public Test {
+ public:
+  void SetUp() override {
+    requestHandler_ = new MockRequestHandler();
+    responseHandler_ = std::make_unique<MockResponseHandler>(requestHandler_);
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_));
+  }
+
+  void TearDown() override {
+    Mock::VerifyAndClear(requestHandler_);
+    Mock::VerifyAndClear(responseHandler_.get());
+
+    delete requestHandler_;
+  }
+
+ protected:
+  MockRequestHandler* requestHandler_;
+  std::unique_ptr<MockResponseHandler> responseHandler_;
+  MessageFramingFilter::Options options_;
+
+  MessageFramingFilter* makeFilter() {
+    HTTPMessage msg;
+    msg.getHeaders().set(HTTP_HEADER_CONTENT_TYPE, "application/grpc+proto");
+    MessageFramingFilterFactory factory(options_);
+    auto filter = factory.onRequest(requestHandler_, &msg);
+    EXPECT_NE(filter, requestHandler_);
+    filter->setResponseHandler(responseHandler_.get());
+    filter->onRequest(std::make_unique<HTTPMessage>(msg));
+    return static_cast<MessageFramingFilter*>(filter);
+  }
+
+  // The messages framed, in one buffer
+  static std::unique_ptr<folly::IOBuf> makeBody(
+      const std::vector<std::string>& messages) {
+    folly::IOBufQueue body{folly::IOBufQueue::cacheChainLength()};
+    for (const auto& message : messages) {
+      body.append(
+        MessageFramingFilter::frame(folly::IOBuf::copyBuffer(message)));
+    }
+    return body.move()->cloneCoalesced();
+  }
+
+  // Sends body to filter in chunks of chunkSize
+  static void sendBody(RequestHandler* filter, const folly::IOBuf& body,
+                       size_t chunkSize) {
+    folly::IOBufQueue queue;
+    queue.append(body.clone());
+    while (!queue.empty()) {
+      filter->onBody(queue.split(std::min(chunkSize, queue.chainLength())));
+    }
+  }
+};
+
+TEST(MessageFramingFilterFactoryTest, ContentType) {
+  MockRequestHandler handler;
+  MessageFramingFilterFactory factory(MessageFramingFilter::Options{});
+  HTTPMessage msg;
+  msg.getHeaders().set(HTTP_HEADER_CONTENT_TYPE, "text/plain");
+  EXPECT_EQ(&handler, factory.onRequest(&handler, &msg));
+  msg.getHeaders().set(HTTP_HEADER_CONTENT_TYPE, "application/grpc");
+  auto filter = factory.onRequest(&handler, &msg);
+  EXPECT_NE(&handler, filter);
+  delete filter;
+}
+
+TEST_F(MessageFramingFilterTest, SplitsMessages) {
+  std::vector<std::string> messages{"hello", "", std::string(10000, 'a'),
+                                    "world"};
+  auto body = makeBody(messages);
+  const uint8_t* data = body->data();
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  std::vector<std::string> received;
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> message) {
+        // Referencing the body, not copied
+        if (!message->empty()) {
+          EXPECT_GE(message->data(), data);
+          EXPECT_LT(message->data(), data + body->length());
+        }
+        received.push_back(message->moveToFbString().toStdString());
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter();
+  // Prefixes and messages split over the chunks
+  sendBody(filter, *body, 3);
+  filter->onEOM();
+  filter->requestComplete();
+  EXPECT_EQ(messages, received);
+}
+
+TEST_F(MessageFramingFilterTest, KeepPrefix) {
+  options_.keepPrefix = true;
+  auto body = makeBody({"hello"});
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillOnce(Invoke([&] (std::shared_ptr<folly::IOBuf> message) {
+        EXPECT_EQ(MessageFramingFilter::kPrefixSize + 5,
+                  message->computeChainDataLength());
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter();
+  sendBody(filter, *body, 1024);
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST_F(MessageFramingFilterTest, PauseIngress) {
+  auto body = makeBody({"one", "two", "three"});
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  std::vector<std::string> received;
+  MessageFramingFilter* filter = nullptr;
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> message) {
+        received.push_back(message->moveToFbString().toStdString());
+        filter->pauseIngress();
+      }));
+  EXPECT_CALL(*responseHandler_, pauseIngress()).Times(AtLeast(1));
+  EXPECT_CALL(*responseHandler_, resumeIngress()).Times(AtLeast(1));
+
+  filter = makeFilter();
+  sendBody(filter, *body, 1024);
+  filter->onEOM();
+  // One message until resumed, and no EOM
+  EXPECT_EQ(1, received.size());
+  Mock::VerifyAndClear(requestHandler_);
+
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> message) {
+        received.push_back(message->moveToFbString().toStdString());
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  filter->resumeIngress();
+  filter->requestComplete();
+  EXPECT_EQ(std::vector<std::string>({"one", "two", "three"}), received);
+}
+
+TEST_F(MessageFramingFilterTest, Truncated) {
+  auto body = makeBody({"hello"});
+  body->trimEnd(2);
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  EXPECT_CALL(*requestHandler_, onBody(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onError(kErrorParseBody));
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& msg) {
+        EXPECT_EQ(400, msg.getStatusCode());
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  auto filter = makeFilter();
+  sendBody(filter, *body, 1024);
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST_F(MessageFramingFilterTest, TooLarge) {
+  options_.maxMessageSize = 100;
+  auto body = makeBody({std::string(101, 'a')});
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  EXPECT_CALL(*requestHandler_, onBody(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onError(kErrorParseBody));
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& msg) {
+        EXPECT_EQ(413, msg.getStatusCode());
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  auto filter = makeFilter();
+  // Rejected on the prefix
+  sendBody(filter, *body, 8);
+  filter->requestComplete();
+}
+
+TEST_F(MessageFramingFilterTest, FramesEgress) {
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  std::string sent;
+  const uint8_t* sentData = nullptr;
+  EXPECT_CALL(*responseHandler_, sendBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> body) {
+        sentData = body->data();
+        sent = body->moveToFbString().toStdString();
+      }));
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter();
+  // In the headroom
+  auto message = folly::IOBuf::create(100);
+  message->advance(MessageFramingFilter::kPrefixSize);
+  memcpy(message->writableData(), "hello", 5);
+  message->append(5);
+  auto data = message->data();
+  filter->sendBody(std::move(message));
+  EXPECT_EQ(data - MessageFramingFilter::kPrefixSize, sentData);
+  EXPECT_EQ(std::string("\0\0\0\0\5hello", 10), sent);
+
+  // In a buffer of its own
+  filter->sendBody(folly::IOBuf::copyBuffer("world!"));
+  EXPECT_EQ(std::string("\0\0\0\0\6world!", 11), sent);
+  filter->requestComplete();
+}
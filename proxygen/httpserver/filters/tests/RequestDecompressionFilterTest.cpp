@@ -0,0 +1,234 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/RequestDecompressionFilter.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+// Text compressing about 4:1
+std::string makeBody(size_t size) {
+  static const char* words[] = {"lorem ", "ipsum ", "dolor ", "sit ",
+                                "amet ", "consectetur ", "adipiscing "};
+  std::string body;
+  folly::Random::DefaultGenerator rng(42);
+  while (body.size() < size) {
+    body += words[folly::Random::rand32(7, rng)];
+    body += folly::to<std::string>(folly::Random::rand32(1000, rng));
+  }
+  body.resize(size);
+  return body;
+}
+
+std::unique_ptr<folly::IOBuf> gzip(const std::string& body) {
+  ZlibStreamCompressor compressor(CompressionType::GZIP, 6);
+  auto in = folly::IOBuf::copyBuffer(body);
+  return compressor.compress(in.get());
+}
+
+}
+
+class RequestDecompressionFilterTest : public Test {
+ public:
+  void SetUp() override {
+    requestHandler_ = new MockRequestHandler();
+    responseHandler_ = std::make_unique<MockResponseHandler>(requestHandler_);
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_));
+  }
+
+  void TearDown() override {
+    Mock::VerifyAndClear(requestHandler_);
+    Mock::VerifyAndClear(responseHandler_.get());
+
+    delete requestHandler_;
+  }
+
+ protected:
+  MockRequestHandler* requestHandler_;
+  std::unique_ptr<MockResponseHandler> responseHandler_;
+  RequestDecompressionFilter::Options options_;
+
+  RequestHandler* makeFilter(const std::string& encoding) {
+    HTTPMessage msg;
+    msg.getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, encoding);
+    RequestDecompressionFilterFactory factory(options_);
+    auto filter = factory.onRequest(requestHandler_, &msg);
+    EXPECT_NE(filter, requestHandler_);
+    filter->setResponseHandler(responseHandler_.get());
+
+    auto request = std::make_unique<HTTPMessage>(msg);
+    request->getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, "100");
+    filter->onRequest(std::move(request));
+    return filter;
+  }
+
+  // Sends body to filter in chunks of chunkSize
+  void sendBody(RequestHandler* filter, const folly::IOBuf& body,
+                size_t chunkSize) {
+    folly::IOBufQueue queue;
+    queue.append(body.clone());
+    while (!queue.empty()) {
+      filter->onBody(queue.split(std::min(chunkSize, queue.chainLength())));
+    }
+  }
+};
+
+TEST_F(RequestDecompressionFilterTest, DecompressInChunks) {
+  auto body = makeBody(1024 * 1024);
+  EXPECT_CALL(*requestHandler_, onRequest(_))
+    .WillOnce(Invoke([] (std::shared_ptr<HTTPMessage> msg) {
+        EXPECT_FALSE(msg->getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING));
+        EXPECT_FALSE(msg->getHeaders().exists(HTTP_HEADER_CONTENT_LENGTH));
+      }));
+  std::string decompressed;
+  size_t chunks = 0;
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> chunk) {
+        auto length = chunk->computeChainDataLength();
+        // A slice past maxChunkSize at most
+        EXPECT_LT(length, 2 * options_.maxChunkSize);
+        decompressed += chunk->moveToFbString().toStdString();
+        chunks++;
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*requestHandler_, requestComplete());
+
+  auto filter = makeFilter("gzip");
+  // The whole body at once
+  sendBody(filter, *gzip(body), 1024 * 1024);
+  filter->onEOM();
+  filter->requestComplete();
+
+  EXPECT_EQ(decompressed, body);
+  EXPECT_GE(chunks, body.size() / (2 * options_.maxChunkSize));
+}
+
+TEST_F(RequestDecompressionFilterTest, PauseIngress) {
+  auto body = makeBody(512 * 1024);
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  std::string decompressed;
+  size_t chunks = 0;
+  RequestHandler* filter = nullptr;
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> chunk) {
+        decompressed += chunk->moveToFbString().toStdString();
+        chunks++;
+        // The filter is the handler's ResponseHandler
+        static_cast<RequestDecompressionFilter*>(filter)->pauseIngress();
+      }));
+  EXPECT_CALL(*responseHandler_, pauseIngress()).Times(AtLeast(1));
+  EXPECT_CALL(*responseHandler_, resumeIngress()).Times(AtLeast(1));
+
+  filter = makeFilter("x-gzip");
+  sendBody(filter, *gzip(body), 16 * 1024);
+  filter->onEOM();
+  // One chunk until resumed, and no EOM
+  EXPECT_EQ(chunks, 1);
+
+  bool eom = false;
+  EXPECT_CALL(*requestHandler_, onEOM()).WillOnce(Assign(&eom, true));
+  while (!eom) {
+    auto before = chunks;
+    static_cast<RequestDecompressionFilter*>(filter)->resumeIngress();
+    EXPECT_TRUE(eom || chunks == before + 1);
+  }
+  EXPECT_EQ(decompressed, body);
+
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  filter->requestComplete();
+}
+
+TEST_F(RequestDecompressionFilterTest, RejectBomb) {
+  // 64MB of zeros compress to about 64KB
+  auto body = gzip(std::string(64 * 1024 * 1024, '\0'));
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  size_t decompressed = 0;
+  EXPECT_CALL(*requestHandler_, onBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> chunk) {
+        decompressed += chunk->computeChainDataLength();
+      }));
+  EXPECT_CALL(*requestHandler_, onError(kErrorParseBody));
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& msg) {
+        EXPECT_EQ(msg.getStatusCode(), 413);
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  auto filter = makeFilter("gzip");
+  sendBody(filter, *body, 16 * 1024);
+  filter->onEOM();
+  // Stopped past the ratio limit, long before the end
+  EXPECT_LT(decompressed, 8 * 1024 * 1024);
+  filter->requestComplete();
+}
+
+TEST_F(RequestDecompressionFilterTest, RejectCorruptBody) {
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  EXPECT_CALL(*requestHandler_, onError(kErrorParseBody));
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& msg) {
+        EXPECT_EQ(msg.getStatusCode(), 400);
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  auto filter = makeFilter("gzip");
+  filter->onBody(folly::IOBuf::copyBuffer("not gzip at all"));
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST_F(RequestDecompressionFilterTest, RejectTruncatedBody) {
+  auto body = gzip(makeBody(64 * 1024));
+  body->coalesce();
+  body->trimEnd(16);
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  EXPECT_CALL(*requestHandler_, onBody(_)).Times(AnyNumber());
+  EXPECT_CALL(*requestHandler_, onError(kErrorParseBody));
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& msg) {
+        EXPECT_EQ(msg.getStatusCode(), 400);
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  auto filter = makeFilter("gzip");
+  filter->onBody(std::move(body));
+  filter->onEOM();
+  filter->requestComplete();
+}
+
+TEST(RequestDecompressionFilterFactoryTest, PassThrough) {
+  MockRequestHandler handler;
+  RequestDecompressionFilterFactory factory({});
+  HTTPMessage msg;
+  EXPECT_EQ(factory.onRequest(&handler, &msg), &handler);
+  msg.getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, "br");
+  EXPECT_EQ(factory.onRequest(&handler, &msg), &handler);
+  // Several codings
+  msg.getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, "gzip");
+  msg.getHeaders().add(HTTP_HEADER_CONTENT_ENCODING, "zstd");
+  EXPECT_EQ(factory.onRequest(&handler, &msg), &handler);
+
+  EXPECT_EQ(RequestDecompressionFilter::getEncoding(msg),
+            CompressionType::NONE);
+  msg.getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, "Zstd");
+  EXPECT_EQ(RequestDecompressionFilter::getEncoding(msg),
+            CompressionType::ZSTD);
+}
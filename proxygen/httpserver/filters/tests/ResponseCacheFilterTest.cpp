@@ -0,0 +1,221 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/filters/ResponseCacheFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+HTTPMessage makeRequest(HTTPMethod method, const std::string& url) {
+  HTTPMessage request;
+  request.setMethod(method);
+  request.setURL(url);
+  return request;
+}
+
+HTTPMessage makeResponse(const std::string& cacheControl) {
+  HTTPMessage response;
+  response.setStatusCode(200);
+  if (!cacheControl.empty()) {
+    response.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, cacheControl);
+  }
+  return response;
+}
+
+std::shared_ptr<const ResponseCache::Response> makeCached(size_t size,
+                                                          TimePoint expires) {
+  auto response = std::make_shared<ResponseCache::Response>();
+  response->headers = makeResponse("");
+  response->body = folly::IOBuf::copyBuffer(std::string(size, 'x'));
+  response->created = getCurrentTime();
+  response->expires = expires;
+  response->size = size;
+  return response;
+}
+
+}
+
+TEST(ResponseCacheTest, Key) {
+  ResponseCache::Options options;
+  options.varyHeaders = {"Accept-Language"};
+  ResponseCache cache(options);
+
+  auto request = makeRequest(HTTPMethod::GET, "/foo?bar");
+  auto key = cache.getKey(request);
+  EXPECT_FALSE(key.empty());
+  request.getHeaders().set(HTTP_HEADER_ACCEPT_LANGUAGE, "fr");
+  EXPECT_NE(cache.getKey(request), key);
+  EXPECT_NE(cache.getKey(makeRequest(HTTPMethod::HEAD, "/foo?bar")), key);
+
+  // Not cacheable
+  EXPECT_EQ(cache.getKey(makeRequest(HTTPMethod::POST, "/foo")), "");
+  request.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "max-age=0, no-cache");
+  EXPECT_EQ(cache.getKey(request), "");
+  request.getHeaders().remove(HTTP_HEADER_CACHE_CONTROL);
+  request.getHeaders().set(HTTP_HEADER_AUTHORIZATION, "Basic Zm9vOmJhcg==");
+  EXPECT_EQ(cache.getKey(request), "");
+}
+
+TEST(ResponseCacheTest, Ttl) {
+  ResponseCache::Options options;
+  options.maxTtl = std::chrono::seconds(2);
+  options.varyHeaders = {"Accept-Language"};
+  ResponseCache cache(options);
+  using std::chrono::milliseconds;
+  using std::chrono::seconds;
+
+  EXPECT_EQ(cache.getTtl(makeResponse("max-age=1")), seconds(1));
+  EXPECT_EQ(cache.getTtl(makeResponse("public, max-age=\"1\"")), seconds(1));
+  EXPECT_EQ(cache.getTtl(makeResponse("max-age=10")), seconds(2));
+  EXPECT_EQ(cache.getTtl(makeResponse("s-maxage=0, max-age=1")), seconds(0));
+  EXPECT_EQ(cache.getTtl(makeResponse("max-age=bad")), seconds(0));
+  EXPECT_EQ(cache.getTtl(makeResponse("private, max-age=1")), seconds(0));
+  EXPECT_EQ(cache.getTtl(makeResponse("no-store")), seconds(0));
+  // No max-age, and no default TTL
+  EXPECT_EQ(cache.getTtl(makeResponse("")), seconds(0));
+
+  auto response = makeResponse("max-age=1");
+  response.getHeaders().set(HTTP_HEADER_VARY, "accept-language");
+  EXPECT_EQ(cache.getTtl(response), seconds(1));
+  response.getHeaders().set(HTTP_HEADER_VARY, "Accept-Language, Cookie");
+  EXPECT_EQ(cache.getTtl(response), seconds(0));
+  response.getHeaders().remove(HTTP_HEADER_VARY);
+  response.getHeaders().set(HTTP_HEADER_SET_COOKIE, "id=1");
+  EXPECT_EQ(cache.getTtl(response), seconds(0));
+  response = makeResponse("max-age=1");
+  response.setStatusCode(500);
+  EXPECT_EQ(cache.getTtl(response), seconds(0));
+
+  options.defaultTtl = milliseconds(200);
+  ResponseCache defaultCache(options);
+  EXPECT_EQ(defaultCache.getTtl(makeResponse("")), milliseconds(200));
+}
+
+TEST(ResponseCacheTest, ExpireAndEvict) {
+  ResponseCache::Options options;
+  options.maxBytesPerThread = 300;
+  ResponseCache cache(options);
+  auto now = getCurrentTime();
+
+  cache.put("a", makeCached(100, now + std::chrono::seconds(1)));
+  EXPECT_NE(cache.get("a", now), nullptr);
+  EXPECT_EQ(cache.get("a", now + std::chrono::seconds(1)), nullptr);
+  EXPECT_EQ(cache.getNumEntries(), 0);
+
+  for (auto key : {"a", "b", "c"}) {
+    cache.put(key, makeCached(100, now + std::chrono::seconds(1)));
+  }
+  // "a" is the most recently used
+  EXPECT_NE(cache.get("a", now), nullptr);
+  cache.put("d", makeCached(100, now + std::chrono::seconds(1)));
+  EXPECT_EQ(cache.getNumEntries(), 3);
+  EXPECT_EQ(cache.get("b", now), nullptr);
+  EXPECT_NE(cache.get("a", now), nullptr);
+  EXPECT_EQ(cache.getHits(), 3);
+  EXPECT_EQ(cache.getMisses(), 2);
+}
+
+class ResponseCacheFilterTest : public Test {
+ public:
+  void SetUp() override {
+    requestHandler_ = new MockRequestHandler();
+    ResponseCache::Options options;
+    cache_ = std::make_shared<ResponseCache>(options);
+    factory_ = std::make_unique<ResponseCacheFilterFactory>(cache_);
+  }
+
+  void TearDown() override {
+    Mock::VerifyAndClear(requestHandler_);
+    delete requestHandler_;
+  }
+
+ protected:
+  MockRequestHandler* requestHandler_;
+  std::shared_ptr<ResponseCache> cache_;
+  std::unique_ptr<ResponseCacheFilterFactory> factory_;
+
+  // Has the handler respond with a chunked response
+  void sendRequest(const std::string& cacheControl) {
+    NiceMock<MockResponseHandler> responseHandler(requestHandler_);
+    auto request = makeRequest(HTTPMethod::GET, "/foo");
+    auto filter = factory_->onRequest(requestHandler_, &request);
+    ASSERT_NE(filter, requestHandler_);
+
+    ResponseHandler* downstream = nullptr;
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_))
+      .WillOnce(SaveArg<0>(&downstream));
+    EXPECT_CALL(*requestHandler_, onRequest(_));
+    EXPECT_CALL(*requestHandler_, onEOM());
+    EXPECT_CALL(*requestHandler_, requestComplete());
+    filter->setResponseHandler(&responseHandler);
+    filter->onRequest(std::make_unique<HTTPMessage>(request));
+    filter->onEOM();
+
+    ResponseBuilder(downstream)
+      .status(200, "OK")
+      .header(HTTP_HEADER_CACHE_CONTROL, cacheControl)
+      .send();
+    ResponseBuilder(downstream).body("hello ").send();
+    ResponseBuilder(downstream).body("world").sendWithEOM();
+    filter->requestComplete();
+    Mock::VerifyAndClear(requestHandler_);
+  }
+};
+
+TEST_F(ResponseCacheFilterTest, ServeHit) {
+  sendRequest("max-age=1");
+  EXPECT_EQ(cache_->getNumEntries(), 1);
+
+  // The handler is only told to clean up
+  MockResponseHandler responseHandler(requestHandler_);
+  auto request = makeRequest(HTTPMethod::GET, "/foo");
+  auto filter = factory_->onRequest(requestHandler_, &request);
+  EXPECT_CALL(*requestHandler_, setResponseHandler(_));
+  EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  EXPECT_CALL(responseHandler, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& msg) {
+        EXPECT_EQ(msg.getStatusCode(), 200);
+        EXPECT_FALSE(msg.getIsChunked());
+        EXPECT_EQ(msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH),
+                  "11");
+        EXPECT_EQ(msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_AGE), "0");
+      }));
+  EXPECT_CALL(responseHandler, sendBody(_))
+    .WillOnce(Invoke([] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->moveToFbString(), "hello world");
+      }));
+  EXPECT_CALL(responseHandler, sendEOM());
+
+  filter->setResponseHandler(&responseHandler);
+  filter->onRequest(std::make_unique<HTTPMessage>(request));
+  filter->onEOM();
+  filter->requestComplete();
+  EXPECT_EQ(cache_->getHits(), 1);
+  EXPECT_EQ(cache_->getMisses(), 1);
+}
+
+TEST_F(ResponseCacheFilterTest, Uncacheable) {
+  sendRequest("no-store");
+  EXPECT_EQ(cache_->getNumEntries(), 0);
+  // Still a miss
+  sendRequest("max-age=1");
+  EXPECT_EQ(cache_->getNumEntries(), 1);
+  EXPECT_EQ(cache_->getMisses(), 2);
+
+  auto request = makeRequest(HTTPMethod::POST, "/foo");
+  EXPECT_EQ(factory_->onRequest(requestHandler_, &request), requestHandler_);
+}
@@ -0,0 +1,184 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/StaticFileHandler.h>
+
+using namespace proxygen;
+using namespace testing;
+
+class StaticFileHandlerTest : public Test {
+ public:
+  void SetUp() override {
+    root_ = dir_.path().string();
+    writeFile("/a.txt", std::string(100, 'a'));
+    cache_ = std::make_shared<StaticFileCache>(StaticFileCache::Options());
+  }
+
+  void writeFile(const std::string& path, const std::string& contents) {
+    CHECK(folly::writeFile(contents, (root_ + path).c_str()));
+  }
+
+  // Runs a request, returning the response headers
+  HTTPMessage request(const std::string& path,
+                      HTTPMethod method = HTTPMethod::GET,
+                      HTTPHeaders headers = HTTPHeaders()) {
+    auto handler = new StaticFileHandler(cache_, root_);
+    MockResponseHandler responseHandler(handler);
+    HTTPMessage response;
+    EXPECT_CALL(responseHandler, sendHeaders(_))
+      .WillOnce(SaveArg<0>(&response));
+    EXPECT_CALL(responseHandler, sendBody(_))
+      .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> body) {
+            body_ += body->moveToFbString().toStdString();
+          }));
+    EXPECT_CALL(responseHandler, sendFileBody(_, _, _))
+      .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::File> file,
+                                  off_t offset, size_t length) {
+            fileOffset_ = offset;
+            fileLength_ = length;
+            // The file is shared, don't move its offset
+            std::string contents(length, '\0');
+            CHECK_EQ(folly::preadFull(file->fd(), &contents[0], length,
+                                      offset), length);
+            body_ += contents;
+          }));
+    EXPECT_CALL(responseHandler, sendEOM());
+    handler->setResponseHandler(&responseHandler);
+
+    auto msg = std::make_unique<HTTPMessage>();
+    msg->setMethod(method);
+    msg->setURL(path);
+    headers.copyTo(msg->getHeaders());
+    body_.clear();
+    fileOffset_ = -1;
+    fileLength_ = 0;
+    handler->onRequest(std::move(msg));
+    handler->onEOM();
+    handler->requestComplete();
+    return response;
+  }
+
+  folly::test::TemporaryDirectory dir_;
+  std::string root_;
+  std::shared_ptr<StaticFileCache> cache_;
+  std::string body_;
+  off_t fileOffset_{-1};
+  size_t fileLength_{0};
+};
+
+TEST_F(StaticFileHandlerTest, Get) {
+  auto response = request("/a.txt");
+  EXPECT_EQ(response.getStatusCode(), 200);
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH),
+            "100");
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT_RANGES),
+            "bytes");
+  EXPECT_FALSE(response.getHeaders().getSingleOrEmpty(
+                 HTTP_HEADER_LAST_MODIFIED).empty());
+  EXPECT_EQ(body_, std::string(100, 'a'));
+
+  // From the cache the second time
+  request("/a.txt");
+  // a.txt, and the missing a.txt.br and a.txt.gz
+  EXPECT_EQ(cache_->getHits(), 3);
+  EXPECT_EQ(cache_->getMisses(), 3);
+
+  response = request("/a.txt", HTTPMethod::HEAD);
+  EXPECT_EQ(response.getStatusCode(), 200);
+  EXPECT_EQ(fileOffset_, -1);
+}
+
+TEST_F(StaticFileHandlerTest, Errors) {
+  EXPECT_EQ(request("/missing").getStatusCode(), 404);
+  EXPECT_EQ(request("/").getStatusCode(), 404);
+  EXPECT_EQ(request("/../a.txt").getStatusCode(), 400);
+  EXPECT_EQ(request("/a.txt", HTTPMethod::POST).getStatusCode(), 405);
+}
+
+TEST_F(StaticFileHandlerTest, Range) {
+  HTTPHeaders headers;
+  headers.set(HTTP_HEADER_RANGE, "bytes=10-19");
+  auto response = request("/a.txt", HTTPMethod::GET, headers);
+  EXPECT_EQ(response.getStatusCode(), 206);
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_RANGE),
+            "bytes 10-19/100");
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH),
+            "10");
+  EXPECT_EQ(fileOffset_, 10);
+  EXPECT_EQ(fileLength_, 10);
+
+  headers.set(HTTP_HEADER_RANGE, "bytes=200-");
+  response = request("/a.txt", HTTPMethod::GET, headers);
+  EXPECT_EQ(response.getStatusCode(), 416);
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_RANGE),
+            "bytes */100");
+
+  // Multiple ranges get the whole file
+  headers.set(HTTP_HEADER_RANGE, "bytes=0-1,5-6");
+  EXPECT_EQ(request("/a.txt", HTTPMethod::GET, headers).getStatusCode(), 200);
+  EXPECT_EQ(fileLength_, 100);
+
+  // As does a stale If-Range
+  headers.set(HTTP_HEADER_RANGE, "bytes=10-19");
+  headers.set(HTTP_HEADER_IF_RANGE, "Thu, 01 Jan 1970 00:00:00 GMT");
+  EXPECT_EQ(request("/a.txt", HTTPMethod::GET, headers).getStatusCode(), 200);
+}
+
+TEST_F(StaticFileHandlerTest, Sidecar) {
+  writeFile("/a.txt.gz", "gzipped");
+  HTTPHeaders headers;
+  headers.set(HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate");
+  auto response = request("/a.txt", HTTPMethod::GET, headers);
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(
+              HTTP_HEADER_CONTENT_ENCODING), "gzip");
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(HTTP_HEADER_VARY),
+            "Accept-Encoding");
+  EXPECT_EQ(body_, "gzipped");
+
+  response = request("/a.txt");
+  EXPECT_FALSE(response.getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING));
+  EXPECT_EQ(response.getHeaders().getSingleOrEmpty(HTTP_HEADER_VARY),
+            "Accept-Encoding");
+  EXPECT_EQ(body_, std::string(100, 'a'));
+}
+
+TEST(StaticFileCacheTest, Revalidate) {
+  folly::test::TemporaryDirectory dir;
+  auto path = dir.path().string() + "/f";
+  CHECK(folly::writeFile(std::string("one"), path.c_str()));
+  StaticFileCache::Options options;
+  options.revalidateInterval = std::chrono::seconds(1);
+  StaticFileCache cache(options);
+
+  auto now = getCurrentTime();
+  auto first = cache.get(path, now);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first->size, 3);
+
+  // Replaced: trusted until revalidated
+  auto tmp = path + ".tmp";
+  CHECK(folly::writeFile(std::string("second"), tmp.c_str()));
+  CHECK_EQ(rename(tmp.c_str(), path.c_str()), 0);
+  EXPECT_EQ(cache.get(path, now)->size, 3);
+  auto second = cache.get(path, now + std::chrono::seconds(2));
+  EXPECT_EQ(second->size, 6);
+  EXPECT_NE(second->file->fd(), -1);
+
+  CHECK_EQ(unlink(path.c_str()), 0);
+  EXPECT_FALSE(cache.get(path, now + std::chrono::seconds(4)));
+  EXPECT_EQ(cache.getNumEntries(), 1);
+  CHECK(folly::writeFile(std::string("third"), path.c_str()));
+  EXPECT_FALSE(cache.get(path, now + std::chrono::seconds(4)));
+  EXPECT_EQ(cache.get(path, now + std::chrono::seconds(6))->size, 5);
+}
@@ -9,18 +9,42 @@
  */
 #include <folly/Conv.h>
 #include <folly/ScopeGuard.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <tuple>
 
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <proxygen/httpserver/filters/ZlibServerFilter.h>
 #include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/ZstdStreamDecompressor.h>
 #include <proxygen/httpserver/Mocks.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
 
 using namespace proxygen;
 using namespace testing;
 
+namespace {
+// Records the responses it's asked a level for
+class FixedLevelSelector : public CompressionLevelSelector {
+ public:
+  explicit FixedLevelSelector(int32_t level) : level_(level) {}
+
+  int32_t getLevel(CompressionType type,
+                   int32_t configured,
+                   size_t size) override {
+    calls.push_back(std::make_tuple(type, configured, size));
+    return level_;
+  }
+
+  std::vector<std::tuple<CompressionType, int32_t, size_t>> calls;
+
+ private:
+  int32_t level_;
+};
+}
+
 MATCHER_P(IOBufEquals,
           expected,
           folly::to<std::string>(
@@ -38,7 +62,6 @@ class ZlibServerFilterTest : public Test {
     // requesthandler is the server, responsehandler is the client
     requestHandler_ = new MockRequestHandler();
     responseHandler_ = std::make_unique<MockResponseHandler>(requestHandler_);
-    zd_ = std::make_unique<ZlibStreamDecompressor>(CompressionType::GZIP);
   }
 
   void TearDown() override {
@@ -52,8 +75,14 @@ class ZlibServerFilterTest : public Test {
   ZlibServerFilter* filter_{nullptr};
   MockRequestHandler* requestHandler_;
   std::unique_ptr<MockResponseHandler> responseHandler_;
-  std::unique_ptr<ZlibStreamDecompressor> zd_;
+  std::unique_ptr<StreamDecompressor> zd_;
   ResponseHandler* downstream_{nullptr};
+  // The encodings of the factory, if not only gzip
+  std::vector<ZlibServerFilterFactory::Encoding> encodings_;
+  std::shared_ptr<CompressedBodyCache> cache_;
+  // Compresses every body, if set
+  std::shared_ptr<folly::Executor> executor_;
+  std::shared_ptr<CompressionLevelSelector> levelSelector_;
 
   void exercise_compression(bool expectCompression,
                             std::string url,
@@ -74,6 +103,12 @@ class ZlibServerFilterTest : public Test {
       chunkCount += 1;
     }
 
+    if (expectedEncoding == "zstd") {
+      zd_ = std::make_unique<ZstdStreamDecompressor>();
+    } else {
+      zd_ = std::make_unique<ZlibStreamDecompressor>(CompressionType::GZIP);
+    }
+
     // Request Handler Expectations
     EXPECT_CALL(*requestHandler_, onBody(_)).Times(1);
     EXPECT_CALL(*requestHandler_, onEOM()).Times(1);
@@ -121,8 +156,11 @@ class ZlibServerFilterTest : public Test {
 
               if (expectCompression) {
                 processedBody = zd_->decompress(body.get());
-                ASSERT_FALSE(zd_->hasError())
-                    << "Failed to decompress body. r=" << zd_->getStatus();
+                ASSERT_FALSE(zd_->hasError()) << "Failed to decompress body.";
+                if (!processedBody) {
+                  // zstd writes no output for the end of the frame
+                  return;
+                }
               } else {
                 processedBody = folly::IOBuf::copyBuffer(
                     body->data(), body->length(), 0, 0);
@@ -136,7 +174,10 @@ class ZlibServerFilterTest : public Test {
             }),
             Return()));
 
-    EXPECT_CALL(*responseHandler_, sendEOM()).Times(1);
+    bool eomSent = false;
+    EXPECT_CALL(*responseHandler_, sendEOM())
+      .WillOnce(InvokeWithoutArgs([&] { eomSent = true; }));
+    auto evb = folly::EventBaseManager::get()->getEventBase();
 
     /* Simulate Request/Response  */
 
@@ -145,8 +186,16 @@ class ZlibServerFilterTest : public Test {
     msg.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, acceptedEncoding);
 
     std::set<std::string> compressibleTypes = {"text/html"};
-    auto filterFactory = std::make_unique<ZlibServerFilterFactory>(
-        compressionLevel, minimumCompressionSize, compressibleTypes);
+    auto filterFactory = encodings_.empty() ?
+      std::make_unique<ZlibServerFilterFactory>(
+        compressionLevel, minimumCompressionSize, compressibleTypes) :
+      std::make_unique<ZlibServerFilterFactory>(
+        encodings_, minimumCompressionSize, compressibleTypes);
+    filterFactory->setCompressedBodyCache(cache_);
+    filterFactory->setLevelSelector(levelSelector_);
+    if (executor_) {
+      filterFactory->setOffloadExecutor(executor_, 1);
+    }
 
     auto filter = filterFactory->onRequest(requestHandler_, &msg);
     filter->setResponseHandler(responseHandler_.get());
@@ -183,6 +232,11 @@ class ZlibServerFilterTest : public Test {
           .sendWithEOM();
     }
 
+    // Wait for the bodies compressing on the executor
+    while (!eomSent) {
+      evb->loopOnce();
+    }
+
     filter->requestComplete();
 
     EXPECT_THAT(responseBody, IOBufEquals(originalRequestBody));
@@ -419,8 +473,11 @@ TEST_F(ZlibServerFilterTest, NoResponseBody){
     msg.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, acceptedEncoding);
 
     std::set<std::string> compressibleTypes = {"text/html"};
-    auto filterFactory = std::make_unique<ZlibServerFilterFactory>(
-        compressionLevel, minimumCompressionSize, compressibleTypes);
+    auto filterFactory = encodings_.empty() ?
+      std::make_unique<ZlibServerFilterFactory>(
+        compressionLevel, minimumCompressionSize, compressibleTypes) :
+      std::make_unique<ZlibServerFilterFactory>(
+        encodings_, minimumCompressionSize, compressibleTypes);
 
     auto filter = filterFactory->onRequest(requestHandler_, &msg);
     filter->setResponseHandler(responseHandler_.get());
@@ -438,3 +495,125 @@ TEST_F(ZlibServerFilterTest, NoResponseBody){
     filter->requestComplete();
   });
 }
+
+TEST_F(ZlibServerFilterTest, ZstdCompression) {
+  encodings_ = {{CompressionType::GZIP, 4}, {CompressionType::ZSTD, 3}};
+  ASSERT_NO_FATAL_FAILURE({
+    exercise_compression(true,
+                         std::string("http://locahost/foo.compressme"),
+                         std::string("gzip;q=0.5, zstd"),
+                         std::string("zstd"),
+                         std::string("Hello World"),
+                         std::string("text/html"),
+                         createResponseChain({"Hello ", "World"}));
+  });
+}
+
+TEST_F(ZlibServerFilterTest, NegotiateEncoding) {
+  ZlibServerFilterFactory factory(
+    {{CompressionType::ZSTD, 3}, {CompressionType::GZIP, 4},
+     {CompressionType::DEFLATE, 4}},
+    1, {"text/html"});
+  auto encodingFor = [&] (const std::string& acceptEncoding) {
+    HTTPMessage msg;
+    msg.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, acceptEncoding);
+    return factory.getEncoding(msg);
+  };
+
+  // Ties go to the server preference
+  EXPECT_EQ(encodingFor("gzip, deflate, zstd"), CompressionType::ZSTD);
+  EXPECT_EQ(encodingFor("gzip, deflate"), CompressionType::GZIP);
+  // Then the client qvalues win
+  EXPECT_EQ(encodingFor("zstd;q=0.5, deflate;q=0.8"),
+            CompressionType::DEFLATE);
+  EXPECT_EQ(encodingFor("GZIP"), CompressionType::GZIP);
+  // q=0 refuses an encoding, also over "*"
+  EXPECT_EQ(encodingFor("gzip;q=0"), CompressionType::NONE);
+  EXPECT_EQ(encodingFor("*, zstd;q=0"), CompressionType::GZIP);
+  EXPECT_EQ(encodingFor("*;q=0"), CompressionType::NONE);
+  EXPECT_EQ(encodingFor("identity, br"), CompressionType::NONE);
+  EXPECT_EQ(encodingFor(""), CompressionType::NONE);
+}
+
+// Repeated bodies are compressed once
+TEST_F(ZlibServerFilterTest, CachedCompression) {
+  cache_ = std::make_shared<CompressedBodyCache>(1024 * 1024);
+  for (int i = 0; i < 2; i++) {
+    ASSERT_NO_FATAL_FAILURE({
+      exercise_compression(true,
+                           std::string("http://locahost/foo.compressme"),
+                           std::string("gzip"),
+                           std::string("gzip"),
+                           std::string("Hello World"),
+                           std::string("text/html"),
+                           folly::IOBuf::copyBuffer("Hello World"));
+    });
+  }
+  EXPECT_EQ(cache_->getMisses(), 1);
+  EXPECT_EQ(cache_->getHits(), 1);
+  EXPECT_EQ(cache_->getNumEntries(), 1);
+}
+
+TEST_F(ZlibServerFilterTest, OffloadedCompression) {
+  executor_ = std::make_shared<folly::CPUThreadPoolExecutor>(2);
+  ASSERT_NO_FATAL_FAILURE({
+    exercise_compression(true,
+                         std::string("http://locahost/foo.compressme"),
+                         std::string("gzip"),
+                         std::string("gzip"),
+                         std::string("Hello World"),
+                         std::string("text/html"),
+                         folly::IOBuf::copyBuffer("Hello World"));
+  });
+}
+
+// The chunks compressed on the executor are sent in order
+TEST_F(ZlibServerFilterTest, OffloadedChunkedCompression) {
+  executor_ = std::make_shared<folly::CPUThreadPoolExecutor>(2);
+  ASSERT_NO_FATAL_FAILURE({
+    exercise_compression(true,
+                         std::string("http://locahost/foo.compressme"),
+                         std::string("gzip"),
+                         std::string("gzip"),
+                         std::string("Hello World"),
+                         std::string("text/html"),
+                         createResponseChain({"Hello", " ", "World"}));
+  });
+}
+
+TEST_F(ZlibServerFilterTest, SelectedLevel) {
+  auto selector = std::make_shared<FixedLevelSelector>(1);
+  levelSelector_ = selector;
+  ASSERT_NO_FATAL_FAILURE({
+    exercise_compression(true,
+                         std::string("http://locahost/foo.compressme"),
+                         std::string("gzip"),
+                         std::string("gzip"),
+                         std::string("Hello World"),
+                         std::string("text/html"),
+                         folly::IOBuf::copyBuffer("Hello World"));
+  });
+  // Chunked responses have no size
+  ASSERT_NO_FATAL_FAILURE({
+    exercise_compression(true,
+                         std::string("http://locahost/foo.compressme"),
+                         std::string("gzip"),
+                         std::string("gzip"),
+                         std::string("Hello World"),
+                         std::string("text/html"),
+                         createResponseChain({"Hello", " World"}));
+  });
+  // Not asked for uncompressed responses
+  ASSERT_NO_FATAL_FAILURE({
+    exercise_compression(false,
+                         std::string("http://locahost/foo.compressme"),
+                         std::string("identity"),
+                         std::string(""),
+                         std::string("Hello World"),
+                         std::string("text/html"),
+                         folly::IOBuf::copyBuffer("Hello World"));
+  });
+  ASSERT_EQ(selector->calls.size(), 2);
+  EXPECT_EQ(selector->calls[0], std::make_tuple(CompressionType::GZIP, 4, 11));
+  EXPECT_EQ(selector->calls[1], std::make_tuple(CompressionType::GZIP, 4, 0));
+}
@@ -11,6 +11,7 @@
 
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
 #include <proxygen/lib/http/session/HTTPUpstreamSession.h>
 #include <proxygen/lib/utils/URL.h>
 #include <folly/portability/GFlags.h>
@@ -24,6 +25,21 @@ using std::unique_ptr;
 
 DEFINE_int32(proxy_connect_timeout, 1000,
     "connect timeout in milliseconds");
+DEFINE_bool(proxy_upstream_h2, false,
+    "whether to speak HTTP/2 with prior knowledge to servers, multiplexing "
+    "the requests to a server on a few sessions");
+DEFINE_int32(proxy_relay_high_watermark, 256 * 1024,
+    "response bytes held for a slow client past which the server "
+    "transaction is paused");
+DEFINE_int32(proxy_relay_low_watermark, 64 * 1024,
+    "response bytes held for a slow client below which the server "
+    "transaction is resumed");
+DEFINE_int32(proxy_coalesce_timeout, 500,
+    "how long a coalesced request waits for the response headers of the "
+    "identical request in flight before fetching itself, in milliseconds");
+DEFINE_bool(proxy_splice_tunnels, true,
+    "whether to relay plaintext HTTP/1.1 CONNECT tunnels in the kernel with "
+    "splice(2)");
 
 namespace {
 static const uint32_t kMinReadSize = 1460;
@@ -36,14 +52,27 @@ static const uint8_t CLOSED = READS_SHUTDOWN | WRITES_SHUTDOWN;
 
 namespace ProxyService {
 
-ProxyHandler::ProxyHandler(ProxyStats* stats, folly::HHWheelTimer* timer):
+ProxyHandler::ProxyHandler(ProxyStats* stats,
+                           folly::HHWheelTimer* timer,
+                           UpstreamPools* pools,
+                           RequestCoalescer* coalescer):
     stats_(stats),
+    timer_(timer),
+    pools_(pools),
+    coalescer_(coalescer),
     connector_{this, timer},
     serverHandler_(*this) {
 }
 
 ProxyHandler::~ProxyHandler() {
   VLOG(4) << "deleting ProxyHandler";
+  if (relay_ && relay_->getNumSourcePauses() > 0) {
+    LOG(INFO) << "Held up to " << relay_->getMaxBufferedBytes()
+              << " response bytes for the client, pausing the server "
+              << relay_->getNumSourcePauses() << " times";
+  }
+  stopFollowing();
+  finishLeading(false);
 }
 
 void ProxyHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
@@ -52,6 +81,33 @@ void ProxyHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
 
   stats_->recordRequest();
   request_ = std::move(headers);
+  proxygen::BodyRelay::Options relayOptions;
+  relayOptions.highWatermark = FLAGS_proxy_relay_high_watermark;
+  relayOptions.lowWatermark = std::min(FLAGS_proxy_relay_low_watermark,
+                                       FLAGS_proxy_relay_high_watermark);
+  relay_ = std::make_unique<proxygen::BodyRelay>(downstream_, this,
+                                                 relayOptions);
+
+  // Follow the identical request in flight, if any, or lead the next ones
+  auto key = coalescer_ ? RequestCoalescer::getKey(*request_) : string();
+  if (!key.empty()) {
+    fetch_ = coalescer_->find(key);
+    if (fetch_ && fetch_->follow(this)) {
+      LOG(INFO) << "Following the fetch of " << request_->getURL();
+      if (fetch_ && !fetch_->hasHeaders()) {
+        timer_->scheduleTimeout(
+          &followTimeout_,
+          std::chrono::milliseconds(FLAGS_proxy_coalesce_timeout));
+      }
+      return;
+    }
+    fetch_ = coalescer_->lead(key);
+    leader_ = true;
+  }
+  startFetch();
+}
+
+void ProxyHandler::startFetch() {
   proxygen::URL url(request_->getURL());
 
   folly::SocketAddress addr;
@@ -60,6 +116,7 @@ void ProxyHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
     // code
     addr.setFromHostPort(url.getHost(), url.getPort());
   } catch (...) {
+    finishLeading(false);
     ResponseBuilder(downstream_)
       .status(503, "Bad Gateway")
       .body(folly::to<string>("Could not parse server from URL: ",
@@ -70,20 +127,74 @@ void ProxyHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
 
 
   downstream_->pauseIngress();
-  LOG(INFO) << "Trying to connect to " << addr;
+  LOG(INFO) << "Trying to reach " << addr;
   auto evb = folly::EventBaseManager::get()->getEventBase();
   if (request_->getMethod() == HTTPMethod::CONNECT) {
     upstreamSock_ = folly::AsyncSocket::newSocket(evb);
     upstreamSock_->connect(this, addr, FLAGS_proxy_connect_timeout);
   } else {
-    // A more sophisticated proxy would have a connection pool here
-    const folly::AsyncSocket::OptionMap opts{
-      {{SOL_SOCKET, SO_REUSEADDR}, 1}};
-    downstream_->pauseIngress();
-    connector_.connect(folly::EventBaseManager::get()->getEventBase(), addr,
-                       std::chrono::milliseconds(FLAGS_proxy_connect_timeout),
-                       opts);
+    server_ = addr;
+    txn_ = pools_->getPool(server_).getTransaction(&serverHandler_);
+    if (txn_) {
+      LOG(INFO) << "Reusing a pooled session to " << server_;
+      sendRequest();
+      return;
+    }
+    // Another thread may have an idle session to the server
+    transferring_ = true;
+    pools_->getController(server_)->getIdleSession()
+      .via(evb)
+      .thenValue([this] (HTTPSessionBase* session) {
+          onIdleSession(session);
+        });
+  }
+}
+
+void ProxyHandler::onIdleSession(HTTPSessionBase* session) {
+  transferring_ = false;
+  auto& pool = pools_->getPool(server_);
+  if (session) {
+    LOG(INFO) << "Took an idle session to " << server_
+              << " from another thread";
+    session->attachThreadLocals(
+      folly::EventBaseManager::get()->getEventBase(), nullptr,
+      proxygen::WheelTimerInstance(timer_), nullptr,
+      [] (proxygen::HTTPCodecFilter*) {}, nullptr, nullptr);
+    pool.putSession(session);
+  }
+  if (clientTerminated_) {
+    checkForShutdown();
+    return;
+  }
+  txn_ = session ? pool.getTransaction(&serverHandler_) : nullptr;
+  if (txn_) {
+    sendRequest();
+  } else {
+    connect();
+  }
+}
+
+void ProxyHandler::connect() {
+  LOG(INFO) << "Connecting to " << server_;
+  const folly::AsyncSocket::OptionMap opts{
+    {{SOL_SOCKET, SO_REUSEADDR}, 1}};
+  if (FLAGS_proxy_upstream_h2) {
+    connector_.setPlaintextProtocol(proxygen::http2::kProtocolCleartextString);
+  }
+  connector_.connect(folly::EventBaseManager::get()->getEventBase(), server_,
+                     std::chrono::milliseconds(FLAGS_proxy_connect_timeout),
+                     opts);
+}
+
+void ProxyHandler::sendRequest() {
+  LOG(INFO) << "Forwarding client request: " << request_->getURL()
+            << " to server";
+  txn_->sendHeaders(*request_);
+  if (clientEOM_) {
+    // Received while waiting for a session, or following a coalesced request
+    txn_->sendEOM();
   }
+  downstream_->resumeIngress();
 }
 
 void ProxyHandler::onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
@@ -105,6 +216,7 @@ void ProxyHandler::onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
 }
 
 void ProxyHandler::onEOM() noexcept {
+  clientEOM_ = true;
   if (txn_) {
     LOG(INFO) << "Forwarding client EOM to server";
     txn_->sendEOM();
@@ -112,23 +224,24 @@ void ProxyHandler::onEOM() noexcept {
     LOG(INFO) << "Closing upgraded socket";
     sockStatus_ |= WRITES_SHUTDOWN;
     upstreamSock_->shutdownWrite();
+  } else if (spliced_) {
+    LOG(INFO) << "Spliced tunnel closed";
   } else {
-    LOG(INFO) << "Dropping client EOM to server";
+    LOG(INFO) << "Holding client EOM until connected to server";
   }
 }
 
 void ProxyHandler::connectSuccess(HTTPUpstreamSession* session) {
   LOG(INFO) << "Established " << *session;
-  session_ = std::make_unique<SessionWrapper>(session);
   txn_ = session->newTransaction(&serverHandler_);
-  LOG(INFO) << "Forwarding client request: " << request_->getURL()
-            << " to server";
-  txn_->sendHeaders(*request_);
-  downstream_->resumeIngress();
+  // For the next requests to the server once idle, or at once with HTTP/2
+  pools_->getPool(server_).putSession(session);
+  sendRequest();
 }
 
 void ProxyHandler::connectError(const folly::AsyncSocketException& ex) {
   LOG(ERROR) << "Failed to connect: " << folly::exceptionStr(ex);
+  finishLeading(false);
   if (!clientTerminated_) {
     ResponseBuilder(downstream_)
       .status(503, "Bad Gateway")
@@ -143,6 +256,9 @@ void ProxyHandler::onServerHeadersComplete(
   unique_ptr<HTTPMessage> msg) noexcept {
   CHECK(!clientTerminated_);
   LOG(INFO) << "Forwarding " << msg->getStatusCode() << " response to client";
+  if (leader_ && fetch_) {
+    fetch_->onHeaders(*msg);
+  }
   downstream_->sendHeaders(*msg);
 }
 
@@ -150,23 +266,34 @@ void ProxyHandler::onServerBody(std::unique_ptr<folly::IOBuf> chain) noexcept {
   CHECK(!clientTerminated_);
   LOG(INFO) << "Forwarding " <<
     ((chain) ? chain->computeChainDataLength() : 0) << " body bytes to client";
-  downstream_->sendBody(std::move(chain));
+  if (leader_ && fetch_ && chain) {
+    fetch_->onBody(*chain);
+  }
+  relay_->onBody(std::move(chain));
 }
 
 void ProxyHandler::onServerEOM() noexcept {
+  finishLeading(true);
   if (!clientTerminated_) {
     LOG(INFO) << "Forwarding server EOM to client";
-    downstream_->sendEOM();
+    if (upstreamSock_) {
+      downstream_->sendEOM();
+    } else {
+      // Once the body held for the client is sent
+      relay_->onEOM();
+    }
   }
 }
 
 void ProxyHandler::detachServerTransaction() noexcept {
   txn_ = nullptr;
+  finishLeading(false);
   checkForShutdown();
 }
 
 void ProxyHandler::onServerError(const HTTPException& error) noexcept {
   LOG(ERROR) << "Server error: " << error;
+  finishLeading(false);
   abortDownstream();
 }
 
@@ -190,6 +317,10 @@ void ProxyHandler::requestComplete() noexcept {
 void ProxyHandler::onError(ProxygenError err) noexcept {
   LOG(ERROR) << "Client error: " << proxygen::getErrorString(err);
   clientTerminated_ = true;
+  stopFollowing();
+  if (relay_) {
+    relay_->detach();
+  }
   if (txn_) {
     LOG(ERROR) << "Aborting server txn: " << *txn_;
     txn_->sendAbort();
@@ -200,29 +331,98 @@ void ProxyHandler::onError(ProxygenError err) noexcept {
 }
 
 void ProxyHandler::onEgressPaused() noexcept {
-  if (txn_) {
-    txn_->pauseIngress();
-  } else if (upstreamSock_) {
+  if (upstreamSock_) {
     upstreamSock_->setReadCB(nullptr);
+  } else {
+    // Including before txn_, for the server body to be held from the start
+    relay_->onEgressPaused();
   }
 }
 
 void ProxyHandler::onEgressResumed() noexcept {
+  if (upstreamSock_) {
+    upstreamSock_->setReadCB(this);
+  } else {
+    relay_->onEgressResumed();
+  }
+}
+
+void ProxyHandler::pauseSource() noexcept {
+  if (txn_) {
+    txn_->pauseIngress();
+  }
+}
+
+void ProxyHandler::resumeSource() noexcept {
   if (txn_) {
     txn_->resumeIngress();
-  } else if (upstreamSock_) {
-    upstreamSock_->setReadCB(this);
+  }
+}
+
+void ProxyHandler::onLeaderHeaders(const HTTPMessage& msg) noexcept {
+  followTimeout_.cancelTimeout();
+  if (!clientTerminated_) {
+    LOG(INFO) << "Forwarding coalesced " << msg.getStatusCode()
+              << " response to client";
+    HTTPMessage response(msg);
+    downstream_->sendHeaders(response);
+  }
+}
+
+void ProxyHandler::onLeaderBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+  if (!clientTerminated_) {
+    downstream_->sendBody(std::move(body));
+  }
+}
+
+void ProxyHandler::onLeaderEOM() noexcept {
+  fetch_.reset();
+  if (!clientTerminated_) {
+    downstream_->sendEOM();
+  }
+}
+
+void ProxyHandler::onLeaderError() noexcept {
+  bool headersSent = fetch_->hasHeaders();
+  fetch_.reset();
+  followTimeout_.cancelTimeout();
+  if (headersSent) {
+    abortDownstream();
+  } else if (!clientTerminated_) {
+    LOG(INFO) << "Coalesced request failed, fetching " << request_->getURL();
+    startFetch();
+  }
+}
+
+void ProxyHandler::stopFollowing() {
+  followTimeout_.cancelTimeout();
+  if (fetch_ && !leader_) {
+    fetch_->unfollow(this);
+    fetch_.reset();
+  }
+}
+
+void ProxyHandler::finishLeading(bool success) {
+  if (fetch_ && leader_) {
+    // Releases the fetch first, its followers may start their own
+    auto fetch = std::move(fetch_);
+    if (success) {
+      fetch->onEOM();
+    } else {
+      fetch->onError();
+    }
   }
 }
 
 void ProxyHandler::abortDownstream() {
   if (!clientTerminated_) {
+    relay_->detach();
     downstream_->sendAbort();
   }
 }
 
 bool ProxyHandler::checkForShutdown() {
-  if (clientTerminated_ && !txn_ &&
+  if (clientTerminated_ && !txn_ && !transferring_ &&
       (!upstreamSock_ || (sockStatus_ == CLOSED && !upstreamEgressPaused_))) {
     delete this;
     return true;
@@ -235,7 +435,15 @@ void ProxyHandler::connectSuccess() noexcept {
   ResponseBuilder(downstream_)
     .status(200, "OK")
     .send();
-  upstreamSock_->setReadCB(this);
+  if (FLAGS_proxy_splice_tunnels &&
+      downstream_->spliceTunnel(*upstreamSock_)) {
+    // The session relays the tunnel and ends the response once it closes
+    LOG(INFO) << "Splicing the tunnel to upstream";
+    upstreamSock_.reset();
+    spliced_ = true;
+  } else {
+    upstreamSock_->setReadCB(this);
+  }
   downstream_->resumeIngress();
 }
 
@@ -11,9 +11,12 @@
 
 #include <folly/Memory.h>
 #include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/httpserver/BodyRelay.h>
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/lib/http/HTTPConnector.h>
-#include "SessionWrapper.h"
+#include "RequestCoalescer.h"
+#include "UpstreamPools.h"
 
 namespace proxygen {
 class ResponseHandler;
@@ -27,9 +30,16 @@ class ProxyHandler : public proxygen::RequestHandler,
                      private proxygen::HTTPConnector::Callback,
                      private folly::AsyncSocket::ConnectCallback,
                      private folly::AsyncReader::ReadCallback,
-                     private folly::AsyncWriter::WriteCallback {
+                     private folly::AsyncWriter::WriteCallback,
+                     private proxygen::BodyRelay::Source,
+                     private RequestCoalescer::Follower {
  public:
-  ProxyHandler(ProxyStats* stats, folly::HHWheelTimer* timer);
+  // Takes the upstream sessions from the pools of the thread, and coalesces
+  // its identical requests with coalescer, if set
+  ProxyHandler(ProxyStats* stats,
+               folly::HHWheelTimer* timer,
+               UpstreamPools* pools,
+               RequestCoalescer* coalescer = nullptr);
 
   ~ProxyHandler() override;
 
@@ -124,24 +134,73 @@ class ProxyHandler : public proxygen::RequestHandler,
   void writeErr(size_t bytesWritten,
                 const folly::AsyncSocketException& ex) noexcept override;
 
+  // BodyRelay::Source, the server transaction
+  void pauseSource() noexcept override;
+  void resumeSource() noexcept override;
+
+  // RequestCoalescer::Follower
+  void onLeaderHeaders(const proxygen::HTTPMessage& msg) noexcept override;
+  void onLeaderBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
+  void onLeaderEOM() noexcept override;
+  void onLeaderError() noexcept override;
+
+  // Fetches the response of a follower itself once the leader is too slow
+  class FollowTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit FollowTimeout(ProxyHandler& parent) : parent_(parent) {}
+
+    void timeoutExpired() noexcept override {
+      parent_.stopFollowing();
+      parent_.startFetch();
+    }
+
+    void callbackCanceled() noexcept override {}
+
+   private:
+    ProxyHandler& parent_;
+  };
+
+  // Sends the request to its server, on a pooled session if any
+  void startFetch();
+  void onIdleSession(proxygen::HTTPSessionBase* session);
+  void connect();
+  void sendRequest();
+  void stopFollowing();
+  // Passes the end of the fetch this request leads, if any, to the followers
+  void finishLeading(bool success);
   void abortDownstream();
   bool checkForShutdown();
 
   ProxyStats* const stats_{nullptr};
+  folly::HHWheelTimer* const timer_{nullptr};
+  UpstreamPools* const pools_{nullptr};
+  RequestCoalescer* const coalescer_{nullptr};
   proxygen::HTTPConnector connector_;
   ServerTransactionHandler serverHandler_;
-  std::unique_ptr<SessionWrapper> session_;
+  folly::SocketAddress server_;
+  // Waiting for an idle session from another thread
+  bool transferring_{false};
   proxygen::HTTPTransaction* txn_{nullptr};
+  // Relays the response from txn_ to the client
+  std::unique_ptr<proxygen::BodyRelay> relay_;
   bool clientTerminated_{false};
+  bool clientEOM_{false};
 
   std::unique_ptr<proxygen::HTTPMessage> request_;
 
+  // The coalesced fetch this request leads or follows
+  std::shared_ptr<RequestCoalescer::Fetch> fetch_;
+  bool leader_{false};
+  FollowTimeout followTimeout_{*this};
+
   // Only for CONNECT
   std::shared_ptr<folly::AsyncSocket> upstreamSock_;
   uint8_t sockStatus_{0};
   folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
   bool downstreamIngressPaused_{false};
   bool upstreamEgressPaused_{false};
+  // Relayed by the session, from upstreamSock_'s descriptor
+  bool spliced_{false};
 };
 
 }
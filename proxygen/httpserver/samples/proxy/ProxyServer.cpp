@@ -15,6 +15,8 @@
 
 #include "ProxyHandler.h"
 #include "ProxyStats.h"
+#include "RequestCoalescer.h"
+#include "UpstreamPools.h"
 
 using namespace ProxyService;
 using namespace proxygen;
@@ -33,9 +35,25 @@ DEFINE_int32(threads, 0, "Number of threads to listen on. Numbers <= 0 "
              "will use the number of cores on this machine.");
 DEFINE_int32(server_timeout, 60,
              "How long to wait for a server response (sec)");
+DEFINE_int32(upstream_idle_sessions, 8,
+             "The idle sessions to a server kept per thread");
+DEFINE_int32(upstream_idle_timeout, 30000,
+             "How long idle sessions to servers are kept (ms)");
+DEFINE_int32(upstream_transferable_sessions, 8,
+             "The idle sessions to a server threads may take from others");
+DEFINE_bool(proxy_coalesce, true,
+            "Whether identical GET requests in flight on a thread share "
+            "a single server request");
+DEFINE_int32(proxy_coalesce_replay_bytes, 1024 * 1024,
+             "The response bytes kept to replay to coalesced requests "
+             "arriving late");
 
 class ProxyHandlerFactory : public RequestHandlerFactory {
  public:
+  explicit ProxyHandlerFactory(
+      std::shared_ptr<UpstreamPools::Controllers> controllers)
+      : controllers_(std::move(controllers)) {}
+
   void onServerStart(folly::EventBase* evb) noexcept override {
     stats_.reset(new ProxyStats);
     timer_->timer = HHWheelTimer::newTimer(
@@ -43,15 +61,27 @@ class ProxyHandlerFactory : public RequestHandlerFactory {
       std::chrono::milliseconds(HHWheelTimer::DEFAULT_TICK_INTERVAL),
       folly::AsyncTimeout::InternalEnum::NORMAL,
       std::chrono::seconds(FLAGS_server_timeout));
+    coalescer_.reset(new RequestCoalescer(FLAGS_proxy_coalesce_replay_bytes));
+    UpstreamPools::Options options;
+    options.maxIdleSessions = FLAGS_upstream_idle_sessions;
+    options.idleTimeout =
+      std::chrono::milliseconds(FLAGS_upstream_idle_timeout);
+    pools_.reset(new UpstreamPools(controllers_, options));
   }
 
   void onServerStop() noexcept override {
+    // The threads stop together, no more transfers once one does
+    controllers_->markForDeath();
+    // Drains the sessions, on their thread
+    pools_.reset();
+    coalescer_.reset();
     stats_.reset();
     timer_->timer.reset();
   }
 
   RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
-    return new ProxyHandler(stats_.get(), timer_->timer.get());
+    return new ProxyHandler(stats_.get(), timer_->timer.get(), pools_.get(),
+                            FLAGS_proxy_coalesce ? coalescer_.get() : nullptr);
   }
 
  private:
@@ -59,6 +89,9 @@ class ProxyHandlerFactory : public RequestHandlerFactory {
     HHWheelTimer::UniquePtr timer;
   };
   folly::ThreadLocalPtr<ProxyStats> stats_;
+  folly::ThreadLocalPtr<RequestCoalescer> coalescer_;
+  std::shared_ptr<UpstreamPools::Controllers> controllers_;
+  folly::ThreadLocalPtr<UpstreamPools> pools_;
   folly::ThreadLocal<TimerWrapper> timer_;
 };
 
@@ -83,7 +116,9 @@ int main(int argc, char* argv[]) {
   options.shutdownOn = {SIGINT, SIGTERM};
   options.enableContentCompression = false;
   options.handlerFactories = RequestHandlerChain()
-      .addThen<ProxyHandlerFactory>()
+      .addThen<ProxyHandlerFactory>(
+        std::make_shared<UpstreamPools::Controllers>(
+          FLAGS_upstream_transferable_sessions))
       .build();
   options.h2cEnabled = true;
   options.supportsConnect = true;
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "RequestCoalescer.h"
+
+#include <algorithm>
+#include <folly/Conv.h>
+
+using namespace proxygen;
+
+namespace ProxyService {
+
+std::string RequestCoalescer::getKey(const HTTPMessage& request) {
+  const auto& headers = request.getHeaders();
+  if (request.getMethod() != HTTPMethod::GET ||
+      headers.exists(HTTP_HEADER_AUTHORIZATION) ||
+      headers.exists(HTTP_HEADER_COOKIE) ||
+      headers.exists(HTTP_HEADER_CONTENT_LENGTH) ||
+      headers.exists(HTTP_HEADER_TRANSFER_ENCODING)) {
+    return "";
+  }
+  // Responses may vary by these
+  return folly::to<std::string>(
+    request.getURL(), '\n',
+    headers.getSingleOrEmpty(HTTP_HEADER_ACCEPT_ENCODING), '\n',
+    headers.getSingleOrEmpty(HTTP_HEADER_ACCEPT_LANGUAGE));
+}
+
+RequestCoalescer::~RequestCoalescer() {
+  // The fetches still in flight outlive the thread's coalescer
+  for (auto& fetch : fetches_) {
+    fetch.second->coalescer_ = nullptr;
+  }
+}
+
+std::shared_ptr<RequestCoalescer::Fetch> RequestCoalescer::find(
+    const std::string& key) const {
+  auto it = fetches_.find(key);
+  return it != fetches_.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<RequestCoalescer::Fetch> RequestCoalescer::lead(
+    const std::string& key) {
+  auto fetch = std::make_shared<Fetch>(*this, key);
+  fetches_[key] = fetch;
+  return fetch;
+}
+
+bool RequestCoalescer::Fetch::follow(Follower* follower) {
+  if (!coalescer_) {
+    return false;
+  }
+  if (headers_) {
+    follower->onLeaderHeaders(*headers_);
+    if (!body_.empty()) {
+      follower->onLeaderBody(body_.front()->clone());
+    }
+  }
+  followers_.push_back(follower);
+  return true;
+}
+
+void RequestCoalescer::Fetch::unfollow(Follower* follower) {
+  followers_.erase(std::remove(followers_.begin(), followers_.end(), follower),
+                   followers_.end());
+}
+
+void RequestCoalescer::Fetch::onHeaders(const HTTPMessage& msg) {
+  headers_ = std::make_unique<HTTPMessage>(msg);
+  // Followers may unfollow while called
+  auto followers = followers_;
+  for (auto follower : followers) {
+    follower->onLeaderHeaders(msg);
+  }
+}
+
+void RequestCoalescer::Fetch::onBody(const folly::IOBuf& body) {
+  if (coalescer_) {
+    body_.append(body.clone());
+    if (body_.chainLength() > coalescer_->maxReplayBytes_) {
+      close();
+    }
+  }
+  auto followers = followers_;
+  for (auto follower : followers) {
+    follower->onLeaderBody(body.clone());
+  }
+}
+
+void RequestCoalescer::Fetch::onEOM() {
+  close();
+  auto followers = std::move(followers_);
+  for (auto follower : followers) {
+    follower->onLeaderEOM();
+  }
+}
+
+void RequestCoalescer::Fetch::onError() {
+  close();
+  auto followers = std::move(followers_);
+  for (auto follower : followers) {
+    follower->onLeaderError();
+  }
+}
+
+void RequestCoalescer::Fetch::close() {
+  if (!coalescer_) {
+    return;
+  }
+  body_.move();
+  auto it = coalescer_->fetches_.find(key_);
+  if (it != coalescer_->fetches_.end() && it->second.get() == this) {
+    // Releases this once the leader and followers do
+    coalescer_->fetches_.erase(it);
+  }
+  coalescer_ = nullptr;
+}
+
+}
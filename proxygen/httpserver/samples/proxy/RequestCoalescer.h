@@ -0,0 +1,106 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <proxygen/lib/http/HTTPMessage.h>
+
+namespace ProxyService {
+
+/**
+ * Collapses the concurrent identical requests of a thread into one fetch
+ * from the server: the first request for a key (the leader) goes to the
+ * server, and the requests arriving while it is in flight (the followers)
+ * get its response, the body being shared through IOBuf clones.
+ *
+ * The body received so far is kept for the followers joining late, up to
+ * maxReplayBytes; past that the fetch takes no more followers.  Followers
+ * don't flow control the leader.
+ */
+class RequestCoalescer {
+ public:
+  class Follower {
+   public:
+    virtual ~Follower() {}
+
+    virtual void onLeaderHeaders(const proxygen::HTTPMessage& msg) noexcept = 0;
+    virtual void onLeaderBody(std::unique_ptr<folly::IOBuf> body) noexcept = 0;
+    virtual void onLeaderEOM() noexcept = 0;
+
+    /**
+     * The fetch failed, followers which haven't received the headers yet
+     * can fetch themselves.
+     */
+    virtual void onLeaderError() noexcept = 0;
+  };
+
+  class Fetch {
+   public:
+    Fetch(RequestCoalescer& coalescer, std::string key)
+        : coalescer_(&coalescer), key_(std::move(key)) {}
+
+    /**
+     * Passes what the leader received so far to follower, then the rest as
+     * received.  Returns false if the fetch takes no more followers.
+     */
+    bool follow(Follower* follower);
+    void unfollow(Follower* follower);
+
+    // From the leader
+    void onHeaders(const proxygen::HTTPMessage& msg);
+    void onBody(const folly::IOBuf& body);
+    void onEOM();
+    void onError();
+
+    bool hasHeaders() const {
+      return headers_ != nullptr;
+    }
+
+   private:
+    friend class RequestCoalescer;
+
+    // Takes no more followers
+    void close();
+
+    RequestCoalescer* coalescer_;
+    const std::string key_;
+    std::unique_ptr<proxygen::HTTPMessage> headers_;
+    folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+    std::vector<Follower*> followers_;
+  };
+
+  explicit RequestCoalescer(size_t maxReplayBytes)
+      : maxReplayBytes_(maxReplayBytes) {}
+
+  ~RequestCoalescer();
+
+  /**
+   * The key of request if identical requests can share its response (GETs
+   * without credentials nor cookies), empty otherwise.
+   */
+  static std::string getKey(const proxygen::HTTPMessage& request);
+
+  // The fetch of key in flight, if any
+  std::shared_ptr<Fetch> find(const std::string& key) const;
+
+  // Starts the fetch of key by its leader
+  std::shared_ptr<Fetch> lead(const std::string& key);
+
+ private:
+  const size_t maxReplayBytes_;
+  std::unordered_map<std::string, std::shared_ptr<Fetch>> fetches_;
+};
+
+}
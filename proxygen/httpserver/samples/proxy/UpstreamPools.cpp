@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "UpstreamPools.h"
+
+using namespace proxygen;
+
+namespace ProxyService {
+
+ServerIdleSessionController* UpstreamPools::Controllers::get(
+    const std::string& server) {
+  std::lock_guard<std::mutex> guard(lock_);
+  auto& controller = controllers_[server];
+  if (!controller) {
+    controller = std::make_unique<ServerIdleSessionController>(maxIdleCount_);
+  }
+  return controller.get();
+}
+
+void UpstreamPools::Controllers::markForDeath() {
+  std::lock_guard<std::mutex> guard(lock_);
+  for (auto& controller : controllers_) {
+    controller.second->markForDeath();
+  }
+}
+
+SessionPool& UpstreamPools::getPool(const folly::SocketAddress& server) {
+  auto key = server.describe();
+  auto& pool = pools_[key];
+  if (!pool) {
+    pool = std::make_unique<SessionPool>(nullptr,
+                                         options_.maxIdleSessions,
+                                         options_.idleTimeout,
+                                         options_.maxAge,
+                                         nullptr,
+                                         controllers_->get(key));
+  }
+  return *pool;
+}
+
+ServerIdleSessionController* UpstreamPools::getController(
+    const folly::SocketAddress& server) {
+  return controllers_->get(server.describe());
+}
+
+}
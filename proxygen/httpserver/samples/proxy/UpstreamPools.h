@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/SocketAddress.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <proxygen/lib/http/connpool/ServerIdleSessionController.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+
+namespace ProxyService {
+
+/**
+ * The upstream sessions of a thread, in a SessionPool per server, so that
+ * requests reuse the idle sessions of their server and share its HTTP/2
+ * sessions rather than connecting each time.
+ *
+ * The idle sessions of each server are also tracked across threads by a
+ * ServerIdleSessionController, shared by the UpstreamPools of all threads,
+ * so that a thread without a session to a server can take the one idle the
+ * longest on another thread.  Must be used and destroyed on its thread.
+ */
+class UpstreamPools {
+ public:
+  struct Options {
+    // Idle sessions kept per server and thread
+    uint32_t maxIdleSessions{8};
+    std::chrono::milliseconds idleTimeout{std::chrono::seconds(30)};
+    // 0 for sessions not to age out
+    std::chrono::milliseconds maxAge{0};
+  };
+
+  /**
+   * The ServerIdleSessionControllers of the servers, shared by threads.
+   */
+  class Controllers {
+   public:
+    // Offers up to maxIdleCount idle sessions per server to other threads
+    explicit Controllers(uint32_t maxIdleCount) : maxIdleCount_(maxIdleCount) {}
+
+    proxygen::ServerIdleSessionController* get(const std::string& server);
+
+    // Stops the transfers, once the threads stop
+    void markForDeath();
+
+   private:
+    const uint32_t maxIdleCount_;
+    std::mutex lock_;
+    std::unordered_map<std::string,
+                       std::unique_ptr<proxygen::ServerIdleSessionController>>
+      controllers_;
+  };
+
+  UpstreamPools(std::shared_ptr<Controllers> controllers,
+                const Options& options)
+      : controllers_(std::move(controllers)), options_(options) {}
+
+  /**
+   * The pool of the sessions to server on this thread.
+   */
+  proxygen::SessionPool& getPool(const folly::SocketAddress& server);
+
+  /**
+   * The controller of the idle sessions to server on all threads.
+   */
+  proxygen::ServerIdleSessionController* getController(
+      const folly::SocketAddress& server);
+
+ private:
+  std::shared_ptr<Controllers> controllers_;
+  const Options options_;
+  std::unordered_map<std::string, std::unique_ptr<proxygen::SessionPool>>
+    pools_;
+};
+
+}
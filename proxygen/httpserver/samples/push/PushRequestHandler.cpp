@@ -12,6 +12,7 @@
 #include "proxygen/httpserver/samples/push/PushStats.h"
 #include <folly/FileUtil.h>
 #include <proxygen/httpserver/PushHandler.h>
+#include <proxygen/httpserver/PushPolicy.h>
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
 
@@ -31,7 +32,8 @@ std::string createLargeBody() {
   return data;
 }
 
-PushRequestHandler::PushRequestHandler(PushStats* stats) : stats_(stats) {
+PushRequestHandler::PushRequestHandler(PushStats* stats, PushPolicy* policy)
+    : stats_(stats), policy_(policy) {
   if (gPushBody.empty()) {
     CHECK(folly::readFile(kPushFileName.c_str(), gPushBody))
       << "Failed to read push file=" << kPushFileName;
@@ -42,39 +44,30 @@ void PushRequestHandler::onRequest(
   std::unique_ptr<HTTPMessage> headers) noexcept {
   stats_->recordRequest();
   if (!headers->getHeaders().getSingleOrEmpty("X-PushIt").empty()) {
-    downstreamPush_ = downstream_->newPushedResponse(new PushHandler);
+    bool large = headers->getPath() == "/requestLargePush";
+    const std::string url = large ? "/largePush" : "/pusheen";
+    if (!policy_->shouldPush(*headers, url)) {
+      LOG(INFO) << "not pushing " << url;
+      return;
+    }
+    downstreamPush_ = downstream_->newPushedResponse(
+      new PushHandler(policy_, url));
     if (!downstreamPush_) {
       // can't push
       return;
     }
 
-    if(headers->getPath() == "/requestLargePush") {
-      LOG(INFO) << "sending large push ";
-
-      ResponseBuilder(downstreamPush_)
-          .promise("/largePush",
-                   headers->getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST),
-                   HTTPMethod::GET)
-          .send();
-
-      ResponseBuilder(downstreamPush_)
-        .status(200, "OK")
-        .body(createLargeBody())
-        .sendWithEOM();
-    } else {
-      LOG(INFO) << "sending small push ";
+    LOG(INFO) << "sending " << (large ? "large" : "small") << " push ";
+    ResponseBuilder(downstreamPush_)
+        .promise(url,
+                 headers->getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST),
+                 HTTPMethod::GET)
+        .send();
 
-      ResponseBuilder(downstreamPush_)
-          .promise("/pusheen",
-                   headers->getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST),
-                   HTTPMethod::GET)
-          .send();
-
-      ResponseBuilder(downstreamPush_)
-        .status(200, "OK")
-        .body(gPushBody)
-        .sendWithEOM();
-    }
+    ResponseBuilder(downstreamPush_)
+      .status(200, "OK")
+      .body(large ? createLargeBody() : gPushBody)
+      .sendWithEOM();
   }
 }
 
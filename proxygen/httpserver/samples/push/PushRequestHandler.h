@@ -13,6 +13,7 @@
 #include <proxygen/httpserver/RequestHandler.h>
 
 namespace proxygen {
+class PushPolicy;
 class ResponseHandler;
 }
 
@@ -22,7 +23,7 @@ class PushStats;
 
 class PushRequestHandler : public proxygen::RequestHandler {
  public:
-  explicit PushRequestHandler(PushStats* stats);
+  PushRequestHandler(PushStats* stats, proxygen::PushPolicy* policy);
 
   void onRequest(std::unique_ptr<proxygen::HTTPMessage> headers)
       noexcept override;
@@ -39,6 +40,7 @@ class PushRequestHandler : public proxygen::RequestHandler {
 
  private:
   PushStats* const stats_{nullptr};
+  proxygen::PushPolicy* const policy_{nullptr};
 
   std::unique_ptr<folly::IOBuf> body_;
 
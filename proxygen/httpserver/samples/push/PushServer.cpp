@@ -12,6 +12,7 @@
 #include <folly/portability/GFlags.h>
 #include <folly/portability/Unistd.h>
 #include <proxygen/httpserver/HTTPServer.h>
+#include <proxygen/httpserver/PushPolicy.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 
 #include "PushRequestHandler.h"
@@ -37,18 +38,21 @@ class PushRequestHandlerFactory : public RequestHandlerFactory {
  public:
   void onServerStart(folly::EventBase* /*evb*/) noexcept override {
     stats_.reset(new PushStats);
+    policy_.reset(new PushPolicy);
   }
 
   void onServerStop() noexcept override {
     stats_.reset();
+    policy_.reset();
   }
 
   RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
-    return new PushRequestHandler(stats_.get());
+    return new PushRequestHandler(stats_.get(), policy_.get());
   }
 
  private:
   folly::ThreadLocalPtr<PushStats> stats_;
+  folly::ThreadLocalPtr<PushPolicy> policy_;
 };
 
 int main(int argc, char* argv[]) {
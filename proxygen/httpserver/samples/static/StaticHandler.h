@@ -1,51 +0,0 @@
-/*
- *  Copyright (c) 2015-present, Facebook, Inc.
- *  All rights reserved.
- *
- *  This source code is licensed under the BSD-style license found in the
- *  LICENSE file in the root directory of this source tree. An additional grant
- *  of patent rights can be found in the PATENTS file in the same directory.
- *
- */
-#pragma once
-
-#include <folly/Memory.h>
-#include <folly/File.h>
-#include <proxygen/httpserver/RequestHandler.h>
-
-namespace proxygen {
-class ResponseHandler;
-}
-
-namespace StaticService {
-
-class StaticHandler : public proxygen::RequestHandler {
- public:
-  void onRequest(std::unique_ptr<proxygen::HTTPMessage> headers)
-      noexcept override;
-
-  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
-
-  void onEOM() noexcept override;
-
-  void onUpgrade(proxygen::UpgradeProtocol proto) noexcept override;
-
-  void requestComplete() noexcept override;
-
-  void onError(proxygen::ProxygenError err) noexcept override;
-
-  void onEgressPaused() noexcept override;
-
-  void onEgressResumed() noexcept override;
-
- private:
-  void readFile(folly::EventBase* evb);
-  bool checkForCompletion();
-
-  std::unique_ptr<folly::File> file_;
-  bool readFileScheduled_{false};
-  std::atomic<bool> paused_{false};
-  bool finished_{false};
-};
-
-}
@@ -9,18 +9,14 @@
  */
 
 #include <folly/Memory.h>
-#include <folly/executors/GlobalExecutor.h>
-#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/init/Init.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <folly/portability/GFlags.h>
 #include <folly/portability/Unistd.h>
 #include <proxygen/httpserver/HTTPServer.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/StaticFileHandler.h>
 
-#include "StaticHandler.h"
-
-using namespace StaticService;
 using namespace proxygen;
 
 using folly::EventBase;
@@ -34,18 +30,29 @@ DEFINE_int32(h2_port, 11002, "Port to listen on with HTTP/2 protocol");
 DEFINE_string(ip, "localhost", "IP/Hostname to bind to");
 DEFINE_int32(threads, 0, "Number of threads to listen on. Numbers <= 0 "
              "will use the number of cores on this machine.");
+DEFINE_string(root, ".", "Directory of the files to serve");
+DEFINE_int32(open_files, 1024, "Files kept open per thread");
 
 namespace {
 
 class StaticHandlerFactory : public RequestHandlerFactory {
  public:
+  StaticHandlerFactory() {
+    StaticFileCache::Options options;
+    options.maxEntriesPerThread = static_cast<size_t>(FLAGS_open_files);
+    cache_ = std::make_shared<StaticFileCache>(options);
+  }
+
   void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
 
   void onServerStop() noexcept override {}
 
   RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
-    return new StaticHandler;
+    return new StaticFileHandler(cache_, FLAGS_root);
   }
+
+ private:
+  std::shared_ptr<StaticFileCache> cache_;
 };
 
 }
@@ -73,11 +80,6 @@ int main(int argc, char* argv[]) {
       .build();
   options.h2cEnabled = true;
 
-  auto diskIOThreadPool = std::make_shared<folly::CPUThreadPoolExecutor>(
-    FLAGS_threads,
-    std::make_shared<folly::NamedThreadFactory>("StaticDiskIOThread"));
-  folly::setCPUExecutor(diskIOThreadPool);
-
   HTTPServer server(std::move(options));
   server.bind(IPs);
 
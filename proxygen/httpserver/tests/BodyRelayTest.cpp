@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/BodyRelay.h>
+#include <proxygen/httpserver/Mocks.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class MockSource : public BodyRelay::Source {
+ public:
+  GMOCK_METHOD0_(, noexcept, , pauseSource, void());
+  GMOCK_METHOD0_(, noexcept, , resumeSource, void());
+};
+
+std::unique_ptr<folly::IOBuf> makeBuf(size_t size) {
+  return folly::IOBuf::copyBuffer(std::string(size, 'x'));
+}
+
+}
+
+class BodyRelayTest : public Test {
+ public:
+  BodyRelayTest() {
+    options_.highWatermark = 100;
+    options_.lowWatermark = 40;
+    relay_ = std::make_unique<BodyRelay>(&sink_, &source_, options_);
+  }
+
+ protected:
+  BodyRelay::Options options_;
+  StrictMock<MockResponseHandler> sink_{nullptr};
+  StrictMock<MockSource> source_;
+  std::unique_ptr<BodyRelay> relay_;
+};
+
+TEST_F(BodyRelayTest, PassThrough) {
+  // Passed on as is while egress isn't paused
+  auto buf = makeBuf(1000);
+  auto data = buf->data();
+  EXPECT_CALL(sink_, sendBody(_))
+    .WillOnce(Invoke([data] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->data(), data);
+      }));
+  EXPECT_CALL(sink_, sendEOM());
+  relay_->onBody(std::move(buf));
+  relay_->onEOM();
+  EXPECT_EQ(relay_->getMaxBufferedBytes(), 0);
+}
+
+TEST_F(BodyRelayTest, PauseAndResumeSource) {
+  relay_->onEgressPaused();
+  relay_->onBody(makeBuf(60));
+  EXPECT_CALL(source_, pauseSource());
+  relay_->onBody(makeBuf(60));
+  Mock::VerifyAndClearExpectations(&source_);
+  // Still held while the source was pausing
+  relay_->onBody(makeBuf(60));
+  relay_->onEOM();
+  EXPECT_EQ(relay_->getBufferedBytes(), 180);
+
+  // A pause midway keeps the rest
+  EXPECT_CALL(sink_, sendBody(_))
+    .WillOnce(Invoke([this] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->computeChainDataLength(), 40);
+        relay_->onEgressPaused();
+      }));
+  relay_->onEgressResumed();
+  EXPECT_EQ(relay_->getBufferedBytes(), 140);
+  Mock::VerifyAndClearExpectations(&sink_);
+
+  size_t sent = 0;
+  EXPECT_CALL(sink_, sendBody(_))
+    .WillRepeatedly(Invoke([&] (std::shared_ptr<folly::IOBuf> body) {
+        sent += body->computeChainDataLength();
+      }));
+  EXPECT_CALL(source_, resumeSource());
+  EXPECT_CALL(sink_, sendEOM());
+  relay_->onEgressResumed();
+  EXPECT_EQ(sent, 140);
+  EXPECT_EQ(relay_->getMaxBufferedBytes(), 180);
+  EXPECT_EQ(relay_->getNumSourcePauses(), 1);
+}
+
+TEST_F(BodyRelayTest, Detach) {
+  relay_->onEgressPaused();
+  relay_->onBody(makeBuf(60));
+  relay_->detach();
+  // Nothing more sent
+  relay_->onBody(makeBuf(60));
+  relay_->onEgressResumed();
+  relay_->onEOM();
+  EXPECT_EQ(relay_->getBufferedBytes(), 0);
+}
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Portability.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/CoroRequestHandler.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+// Echoes the request body once egress isn't paused
+class EchoHandler : public CoroRequestHandler {
+ public:
+  EchoHandler(bool& destroyed, size_t maxBufferedBody)
+      : CoroRequestHandler(maxBufferedBody), destroyed_(destroyed) {}
+
+  ~EchoHandler() override {
+    destroyed_ = true;
+  }
+
+  folly::coro::Task<void> handleRequest(
+      std::unique_ptr<HTTPMessage> /*headers*/) override {
+    co_await waitForEgress();
+    folly::IOBufQueue body;
+    while (auto chunk = co_await readBody()) {
+      body.append(std::move(chunk));
+      reads++;
+    }
+    if (fail) {
+      throw std::runtime_error("failed");
+    }
+    ResponseBuilder(downstream_).status(200, "OK").send();
+    co_await sendBody(body.move());
+    ResponseBuilder(downstream_).sendWithEOM();
+  }
+
+  int reads{0};
+  bool fail{false};
+
+ private:
+  bool& destroyed_;
+};
+
+}
+
+class CoroRequestHandlerTest : public Test {
+ public:
+  void SetUp() override {
+    handler_ = new EchoHandler(destroyed_, 8);
+    downstream_ = std::make_unique<StrictMock<MockResponseHandler>>(handler_);
+    handler_->setResponseHandler(downstream_.get());
+  }
+
+ protected:
+  folly::EventBase* evb_{folly::EventBaseManager::get()->getEventBase()};
+  bool destroyed_{false};
+  EchoHandler* handler_;
+  std::unique_ptr<StrictMock<MockResponseHandler>> downstream_;
+};
+
+TEST_F(CoroRequestHandlerTest, Echo) {
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  evb_->loop();
+
+  // Each body resumes the reading coroutine at once
+  handler_->onBody(folly::IOBuf::copyBuffer("hello "));
+  handler_->onBody(folly::IOBuf::copyBuffer("world"));
+  EXPECT_EQ(handler_->reads, 2);
+
+  // The body waits for egress
+  handler_->onEgressPaused();
+  EXPECT_CALL(*downstream_, sendHeaders(_));
+  handler_->onEOM();
+  Mock::VerifyAndClearExpectations(downstream_.get());
+
+  EXPECT_CALL(*downstream_, sendBody(_))
+    .WillOnce(Invoke([] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->moveToFbString(), "hello world");
+      }));
+  EXPECT_CALL(*downstream_, sendEOM());
+  handler_->onEgressResumed();
+
+  handler_->requestComplete();
+  // Deleted once the coroutine is done too
+  EXPECT_FALSE(destroyed_);
+  evb_->loop();
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, PauseIngress) {
+  handler_->onEgressPaused();
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  evb_->loop();
+
+  // Over 8 bytes unread
+  EXPECT_CALL(*downstream_, pauseIngress());
+  handler_->onBody(folly::IOBuf::copyBuffer("hello "));
+  handler_->onBody(folly::IOBuf::copyBuffer("world"));
+  Mock::VerifyAndClearExpectations(downstream_.get());
+
+  EXPECT_CALL(*downstream_, resumeIngress());
+  handler_->onEgressResumed();
+  EXPECT_EQ(handler_->reads, 1);
+
+  EXPECT_CALL(*downstream_, sendHeaders(_));
+  EXPECT_CALL(*downstream_, sendBody(_));
+  EXPECT_CALL(*downstream_, sendEOM());
+  handler_->onEOM();
+  handler_->requestComplete();
+  evb_->loop();
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, Error) {
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  evb_->loop();
+
+  // The read throws, and nothing is sent
+  handler_->onError(kErrorTimeout);
+  EXPECT_FALSE(destroyed_);
+  evb_->loop();
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, HandlerThrows) {
+  handler_->fail = true;
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  evb_->loop();
+
+  handler_->onEOM();
+  EXPECT_CALL(*downstream_, sendAbort());
+  evb_->loop();
+  handler_->onError(kErrorStreamAbort);
+  EXPECT_TRUE(destroyed_);
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Fanout.h>
+#include <proxygen/httpserver/Mocks.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class MockFanoutCallback : public Fanout::Callback {
+ public:
+  GMOCK_METHOD1_(, noexcept, , onSubscriberDropped, void(ResponseHandler*));
+};
+
+std::string toString(const std::shared_ptr<folly::IOBuf>& body) {
+  return body->cloneAsValue().moveToFbString().toStdString();
+}
+
+}
+
+class FanoutTest : public Test {
+ public:
+  FanoutTest() {
+    options_.maxHeldBytes = 10;
+    fanout_ = std::make_unique<Fanout>(&evb_, options_, &callback_);
+    fanout_->subscribe(&first_);
+    fanout_->subscribe(&second_);
+  }
+
+ protected:
+  folly::EventBase evb_;
+  Fanout::Options options_;
+  StrictMock<MockFanoutCallback> callback_;
+  StrictMock<MockResponseHandler> first_{nullptr};
+  StrictMock<MockResponseHandler> second_{nullptr};
+  std::unique_ptr<Fanout> fanout_;
+};
+
+TEST_F(FanoutTest, BatchPerLoop) {
+  fanout_->publish(folly::IOBuf::copyBuffer("one "));
+  fanout_->publish(folly::IOBuf::copyBuffer("two"));
+  EXPECT_EQ(fanout_->getQueuedBytes(), 7);
+
+  // One sendBody each, sharing the coalesced buffer
+  const uint8_t* data = nullptr;
+  EXPECT_CALL(first_, sendBody(_))
+    .WillOnce(Invoke([&] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_FALSE(body->isChained());
+        EXPECT_EQ(toString(body), "one two");
+        data = body->data();
+      }));
+  EXPECT_CALL(second_, sendBody(_))
+    .WillOnce(Invoke([&] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->data(), data);
+      }));
+  evb_.loopOnce();
+  EXPECT_EQ(fanout_->getQueuedBytes(), 0);
+}
+
+TEST_F(FanoutTest, Unsubscribe) {
+  fanout_->unsubscribe(&first_);
+  EXPECT_EQ(fanout_->getNumSubscribers(), 1);
+  EXPECT_CALL(second_, sendBody(_))
+    .WillOnce(Invoke([&] (std::shared_ptr<folly::IOBuf> /*body*/) {
+        // From the delivery itself
+        fanout_->unsubscribe(&second_);
+      }));
+  fanout_->publish(folly::IOBuf::copyBuffer("msg"));
+  fanout_->flush();
+  EXPECT_EQ(fanout_->getNumSubscribers(), 0);
+  fanout_->publish(folly::IOBuf::copyBuffer("msg"));
+  evb_.loopOnce();
+}
+
+TEST_F(FanoutTest, PausedSubscriber) {
+  fanout_->onEgressPaused(&first_);
+  EXPECT_CALL(second_, sendBody(_)).Times(2);
+  fanout_->publish(folly::IOBuf::copyBuffer("held "));
+  fanout_->flush();
+  fanout_->publish(folly::IOBuf::copyBuffer("too"));
+  fanout_->flush();
+
+  EXPECT_CALL(first_, sendBody(_))
+    .WillOnce(Invoke([] (std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(toString(body), "held too");
+      }));
+  fanout_->onEgressResumed(&first_);
+
+  // Past maxHeldBytes, it's dropped
+  fanout_->onEgressPaused(&first_);
+  EXPECT_CALL(second_, sendBody(_)).Times(1);
+  EXPECT_CALL(callback_, onSubscriberDropped(&first_));
+  fanout_->publish(folly::IOBuf::copyBuffer("too long to hold"));
+  fanout_->flush();
+  EXPECT_EQ(fanout_->getNumSubscribers(), 1);
+}
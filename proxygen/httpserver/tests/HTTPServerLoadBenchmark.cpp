@@ -0,0 +1,444 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/init/Init.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/SSLContext.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/httpserver/HTTPServer.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/filters/DirectResponseHandler.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/utils/TestUtils.h>
+#include <proxygen/lib/utils/Time.h>
+#include <boost/thread.hpp>
+#include <iostream>
+#include <mutex>
+#include <sys/resource.h>
+#include <thread>
+
+using namespace folly;
+using namespace proxygen;
+
+// Load test of a whole HTTPServer: an in-process client drives it over
+// loopback with a fixed number of connections, each keeping concurrency
+// requests in flight, for duration seconds after a second of warmup.  One
+// line is printed, for perf jobs to parse and compare:
+//
+//   protocol=h2c handler=static rps=... p50_us=... p99_us=... p999_us=...
+//     server_cpu_us=... process_cpu_us=... errors=0
+//
+// server_cpu_us is the CPU time of the server threads per request,
+// process_cpu_us includes the client's.  The exit status is 1 if any request
+// failed.
+
+DEFINE_string(protocol, "h1", "h1, h2c, or h2 (over TLS)");
+DEFINE_string(handler, "static", "static: a PrebuiltResponse, "
+              "echo: a response with the request body");
+DEFINE_int32(server_threads, 2, "Server threads");
+DEFINE_int32(client_threads, 2, "Client threads");
+DEFINE_int32(connections, 8, "Connections per client thread");
+DEFINE_int32(concurrency, 1, "Requests in flight per connection, "
+             "1 for h1");
+DEFINE_int32(duration, 10, "Seconds measured");
+DEFINE_int32(request_size, 0, "Bytes of request body, POSTed if not 0");
+DEFINE_int32(response_size, 100, "Bytes of the static response body");
+
+namespace {
+
+const std::string kTestDir = getContainingDirectory(__FILE__).str();
+
+// CPU clocks of the server threads, registered as they start
+std::mutex serverClocksMutex;
+std::vector<clockid_t> serverClocks;
+
+std::chrono::nanoseconds getServerCpuTime() {
+  std::lock_guard<std::mutex> guard(serverClocksMutex);
+  std::chrono::nanoseconds total{0};
+  for (auto clock : serverClocks) {
+    timespec ts;
+    CHECK_EQ(clock_gettime(clock, &ts), 0);
+    total += std::chrono::seconds(ts.tv_sec) +
+      std::chrono::nanoseconds(ts.tv_nsec);
+  }
+  return total;
+}
+
+std::chrono::nanoseconds getProcessCpuTime() {
+  rusage usage;
+  CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+  auto toNanos = [] (const timeval& tv) {
+    return std::chrono::seconds(tv.tv_sec) +
+      std::chrono::microseconds(tv.tv_usec);
+  };
+  return toNanos(usage.ru_utime) + toNanos(usage.ru_stime);
+}
+
+class EchoHandler : public RequestHandler {
+ public:
+  void onRequest(std::unique_ptr<HTTPMessage> /*headers*/) noexcept override {}
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    body_.append(std::move(body));
+  }
+
+  void onEOM() noexcept override {
+    ResponseBuilder(downstream_)
+      .status(200, "OK")
+      .body(body_.move())
+      .sendWithEOM();
+  }
+
+  void onUpgrade(UpgradeProtocol /*prot*/) noexcept override {}
+
+  void requestComplete() noexcept override {
+    delete this;
+  }
+
+  void onError(ProxygenError /*err*/) noexcept override {
+    delete this;
+  }
+
+ private:
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+};
+
+class HandlerFactory : public RequestHandlerFactory {
+ public:
+  HandlerFactory()
+      : response_(PrebuiltResponse::create(
+                    200, "OK", HTTPHeaders(),
+                    folly::IOBuf::copyBuffer(
+                      std::string(FLAGS_response_size, 'x')))) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+    clockid_t clock;
+    CHECK_EQ(pthread_getcpuclockid(pthread_self(), &clock), 0);
+    std::lock_guard<std::mutex> guard(serverClocksMutex);
+    serverClocks.push_back(clock);
+  }
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
+    if (FLAGS_handler == "echo") {
+      return new EchoHandler;
+    }
+    return new DirectResponseHandler(response_);
+  }
+
+ private:
+  std::shared_ptr<const PrebuiltResponse> response_;
+};
+
+class Worker;
+
+class Connection : public HTTPConnector::Callback {
+ public:
+  class Request : public HTTPTransactionHandler {
+   public:
+    explicit Request(Connection& connection)
+        : connection_(connection), start_(getCurrentTime()) {}
+
+    void setTransaction(HTTPTransaction* /*txn*/) noexcept override {}
+
+    void detachTransaction() noexcept override {
+      connection_.onRequestDone(start_, ok_);
+      delete this;
+    }
+
+    void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept
+        override {
+      status_ = msg->getStatusCode();
+    }
+
+    void onBody(std::unique_ptr<folly::IOBuf> /*chain*/) noexcept override {}
+
+    void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept
+        override {}
+
+    void onEOM() noexcept override {
+      ok_ = status_ == 200;
+    }
+
+    void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {}
+
+    void onError(const HTTPException& /*error*/) noexcept override {
+      ok_ = false;
+    }
+
+    void onEgressPaused() noexcept override {}
+
+    void onEgressResumed() noexcept override {}
+
+   private:
+    Connection& connection_;
+    TimePoint start_;
+    uint16_t status_{0};
+    bool ok_{false};
+  };
+
+  explicit Connection(Worker& worker);
+
+  void connect(const folly::SocketAddress& address,
+               const std::shared_ptr<folly::SSLContext>& sslContext);
+
+  void connectSuccess(HTTPUpstreamSession* session) override;
+
+  void connectError(const folly::AsyncSocketException& ex) override {
+    LOG(FATAL) << "Failed to connect: " << ex.what();
+  }
+
+  void close() {
+    if (session_) {
+      session_->dropConnection();
+      session_ = nullptr;
+    }
+  }
+
+ private:
+  void sendRequest();
+  void onRequestDone(TimePoint start, bool ok);
+
+  Worker& worker_;
+  std::unique_ptr<HTTPConnector> connector_;
+  HTTPUpstreamSession* session_{nullptr};
+};
+
+/**
+ * A client thread and its connections.
+ */
+class Worker {
+ public:
+  Worker()
+      : timer_(HHWheelTimer::newTimer(
+                 &evb_,
+                 std::chrono::milliseconds(HHWheelTimer::DEFAULT_TICK_INTERVAL),
+                 AsyncTimeout::InternalEnum::NORMAL,
+                 std::chrono::milliseconds(5000))) {
+    for (int i = 0; i < FLAGS_connections; i++) {
+      connections_.push_back(std::make_unique<Connection>(*this));
+    }
+  }
+
+  void start(const folly::SocketAddress& address,
+             const std::shared_ptr<folly::SSLContext>& sslContext) {
+    thread_ = std::thread([this, address, sslContext] {
+        for (auto& connection : connections_) {
+          connection->connect(address, sslContext);
+        }
+        evb_.loopForever();
+      });
+    evb_.waitUntilRunning();
+  }
+
+  void stop() {
+    stopping_ = true;
+    evb_.runInEventBaseThreadAndWait([this] {
+        for (auto& connection : connections_) {
+          connection->close();
+        }
+      });
+    evb_.terminateLoopSoon();
+    thread_.join();
+    // The loop callbacks left, while the connections they use exist
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+
+  folly::EventBase evb_;
+  HHWheelTimer::UniquePtr timer_;
+  std::atomic<bool> recording_{false};
+  std::atomic<bool> stopping_{false};
+  // Of the requests completed while recording, owned by the worker thread
+  std::vector<uint32_t> latencies_;
+  uint64_t errors_{0};
+
+ private:
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::thread thread_;
+};
+
+Connection::Connection(Worker& worker)
+    : worker_(worker),
+      connector_(std::make_unique<HTTPConnector>(this, worker.timer_.get())) {
+}
+
+void Connection::connect(
+    const folly::SocketAddress& address,
+    const std::shared_ptr<folly::SSLContext>& sslContext) {
+  if (sslContext) {
+    connector_->connectSSL(&worker_.evb_, address, sslContext);
+  } else {
+    if (FLAGS_protocol == "h2c") {
+      connector_->setPlaintextProtocol(http2::kProtocolCleartextString);
+    }
+    connector_->connect(&worker_.evb_, address);
+  }
+}
+
+void Connection::connectSuccess(HTTPUpstreamSession* session) {
+  session_ = session;
+  auto concurrency = FLAGS_protocol == "h1" ? 1 : FLAGS_concurrency;
+  for (int i = 0; i < concurrency; i++) {
+    sendRequest();
+  }
+}
+
+void Connection::sendRequest() {
+  if (worker_.stopping_ || !session_) {
+    return;
+  }
+  auto request = new Request(*this);
+  auto txn = session_->newTransaction(request);
+  if (!txn) {
+    LOG(FATAL) << "Failed to open a transaction";
+  }
+  HTTPMessage msg;
+  msg.setMethod(FLAGS_request_size > 0 ? HTTPMethod::POST : HTTPMethod::GET);
+  msg.setURL("/");
+  msg.setHTTPVersion(1, 1);
+  msg.getHeaders().set(HTTP_HEADER_HOST, "localhost");
+  if (FLAGS_request_size > 0) {
+    msg.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                         folly::to<std::string>(FLAGS_request_size));
+    txn->sendHeaders(msg);
+    txn->sendBody(folly::IOBuf::copyBuffer(
+                    std::string(FLAGS_request_size, 'x')));
+  } else {
+    txn->sendHeaders(msg);
+  }
+  txn->sendEOM();
+}
+
+void Connection::onRequestDone(TimePoint start, bool ok) {
+  if (worker_.recording_.load(std::memory_order_relaxed)) {
+    if (ok) {
+      worker_.latencies_.push_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          getCurrentTime() - start).count());
+    } else if (!worker_.stopping_) {
+      worker_.errors_++;
+    }
+  }
+  // The session may not open the next HTTP/1.x transaction before it is
+  // done with this one
+  worker_.evb_.runInLoop([this] { sendRequest(); }, true);
+}
+
+std::shared_ptr<folly::SSLContext> makeClientSSLContext() {
+  auto context = std::make_shared<folly::SSLContext>();
+  context->setOptions(SSL_OP_NO_COMPRESSION);
+  context->setAdvertisedNextProtocols({"h2"});
+  return context;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv, true);
+  CHECK(FLAGS_protocol == "h1" || FLAGS_protocol == "h2c" ||
+        FLAGS_protocol == "h2") << "Unknown protocol " << FLAGS_protocol;
+
+  HTTPServer::IPConfig ipConfig{
+    folly::SocketAddress("127.0.0.1", 0),
+    FLAGS_protocol == "h1" ? HTTPServer::Protocol::HTTP :
+                             HTTPServer::Protocol::HTTP2};
+  std::shared_ptr<folly::SSLContext> sslContext;
+  if (FLAGS_protocol == "h2") {
+    wangle::SSLContextConfig sslConfig;
+    sslConfig.isDefault = true;
+    sslConfig.setCertificate(kTestDir + "certs/test_cert1.pem",
+                             kTestDir + "certs/test_key1.pem", "");
+    sslConfig.setNextProtocols({"h2"});
+    ipConfig.sslConfigs.push_back(sslConfig);
+    sslContext = makeClientSSLContext();
+  }
+
+  HTTPServerOptions options;
+  options.threads = static_cast<size_t>(FLAGS_server_threads);
+  options.idleTimeout = std::chrono::milliseconds(60000);
+  options.handlerFactories = RequestHandlerChain()
+      .addThen<HandlerFactory>()
+      .build();
+  HTTPServer server(std::move(options));
+  std::vector<HTTPServer::IPConfig> ips{ipConfig};
+  server.bind(ips);
+  auto barrier = std::make_shared<boost::barrier>(2);
+  std::thread serverThread([&server, barrier] {
+      server.start([barrier] { barrier->wait(); });
+    });
+  barrier->wait();
+  auto address = server.addresses().front().address;
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int i = 0; i < FLAGS_client_threads; i++) {
+    workers.push_back(std::make_unique<Worker>());
+    workers.back()->start(address, sslContext);
+  }
+
+  // Warmup: connections established, caches and free lists filled
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  auto serverCpuStart = getServerCpuTime();
+  auto processCpuStart = getProcessCpuTime();
+  auto start = getCurrentTime();
+  for (auto& worker : workers) {
+    worker->recording_ = true;
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(FLAGS_duration));
+  for (auto& worker : workers) {
+    worker->recording_ = false;
+  }
+  auto elapsed = getCurrentTime() - start;
+  auto serverCpu = getServerCpuTime() - serverCpuStart;
+  auto processCpu = getProcessCpuTime() - processCpuStart;
+
+  std::vector<uint32_t> latencies;
+  uint64_t errors = 0;
+  for (auto& worker : workers) {
+    worker->stop();
+    latencies.insert(latencies.end(), worker->latencies_.begin(),
+                     worker->latencies_.end());
+    errors += worker->errors_;
+  }
+  server.stop();
+  serverThread.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&] (double p) -> uint32_t {
+    if (latencies.empty()) {
+      return 0;
+    }
+    return latencies[std::min(latencies.size() - 1,
+                              size_t(p * latencies.size()))];
+  };
+  auto requests = std::max<size_t>(latencies.size(), 1);
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  std::cout << "protocol=" << FLAGS_protocol
+            << " handler=" << FLAGS_handler
+            << " rps=" << uint64_t(
+              latencies.size() * 1e6 /
+              std::max<int64_t>(
+                duration_cast<microseconds>(elapsed).count(), 1))
+            << " p50_us=" << percentile(0.5)
+            << " p99_us=" << percentile(0.99)
+            << " p999_us=" << percentile(0.999)
+            << " server_cpu_us="
+            << double(duration_cast<microseconds>(serverCpu).count()) /
+               requests
+            << " process_cpu_us="
+            << double(duration_cast<microseconds>(processCpu).count()) /
+               requests
+            << " errors=" << errors << std::endl;
+  return (errors > 0 || latencies.empty()) ? 1 : 0;
+}
@@ -22,6 +22,7 @@
 #include <proxygen/lib/http/HTTPConnector.h>
 #include <proxygen/lib/utils/TestUtils.h>
 #include <wangle/client/ssl/SSLSession.h>
+#include <sys/socket.h>
 
 using namespace folly;
 using namespace folly::ssl;
@@ -301,6 +302,41 @@ TEST(SSL, TestAllowInsecureOnSecureServer) {
   EXPECT_EQ(200, response->getStatusCode());
 }
 
+TEST(HTTPConnector, ConnectToSeveralAddresses) {
+  std::unique_ptr<HTTPServer> server;
+  std::unique_ptr<ServerThread> st;
+  std::tie(server, st) = setupServer(true);
+
+  // A port nothing listens on, which refuses the first attempt
+  folly::AsyncServerSocket::UniquePtr closed(new folly::AsyncServerSocket());
+  closed->bind(folly::SocketAddress("127.0.0.1", 0));
+  folly::SocketAddress refusedAddr;
+  closed->getAddress(&refusedAddr);
+  closed.reset();
+
+  folly::EventBase evb;
+  URL url(folly::to<std::string>(
+      "http://localhost:", server->addresses().front().address.getPort()));
+  HTTPHeaders headers;
+  CurlClient curl(&evb, HTTPMethod::GET, url, nullptr, headers, "");
+  curl.setFlowControlSettings(64 * 1024);
+  curl.setLogging(false);
+  HHWheelTimer::UniquePtr timer{new HHWheelTimer(
+      &evb,
+      std::chrono::milliseconds(HHWheelTimer::DEFAULT_TICK_INTERVAL),
+      AsyncTimeout::InternalEnum::NORMAL,
+      std::chrono::milliseconds(1000))};
+  HTTPConnector connector(&curl, timer.get());
+  connector.setConnectionAttemptDelay(std::chrono::milliseconds(50));
+  std::vector<folly::SocketAddress> addrs{
+    refusedAddr, server->addresses().front().address};
+  connector.connect(&evb, addrs, std::chrono::milliseconds(1000));
+  evb.loop();
+  auto response = curl.getResponse();
+  ASSERT_NE(nullptr, response);
+  EXPECT_EQ(200, response->getStatusCode());
+}
+
 TEST(SSL, DisallowInsecureOnSecureServer) {
   std::unique_ptr<HTTPServer> server;
   std::unique_ptr<ServerThread> st;
@@ -595,6 +631,115 @@ TEST(UseExistingSocket, TestWithMultipleSocketFds) {
   ASSERT_EQ(fdSocks[0], socketFd);
 }
 
+namespace {
+
+// Sends a keep-alive GET on a blocking socket and returns the response
+std::string blockingGet(int fd) {
+  const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  EXPECT_EQ(request.size(),
+            folly::writeFull(fd, request.data(), request.size()));
+  std::string response;
+  char buf[1024];
+  // The body of TestHandler ends the response
+  while (response.find("hello") == std::string::npos) {
+    auto n = folly::readNoInt(fd, buf, sizeof(buf));
+    if (n <= 0) {
+      break;
+    }
+    response.append(buf, n);
+  }
+  return response;
+}
+
+std::unique_ptr<HTTPServer> makeTakeoverServer() {
+  HTTPServerOptions options;
+  options.threads = 2;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+  return std::make_unique<HTTPServer>(std::move(options));
+}
+
+}
+
+TEST(SocketTakeover, HandOverSockets) {
+  auto oldServer = makeTakeoverServer();
+  oldServer->bind({{folly::SocketAddress("127.0.0.1", 0),
+                    HTTPServer::Protocol::HTTP}});
+  auto oldThread = std::make_unique<ServerThread>(oldServer.get());
+  ASSERT_TRUE(oldThread->start());
+  auto addresses = oldServer->addresses();
+  sockaddr_storage addr;
+  auto addrLen = addresses[0].address.getAddress(&addr);
+
+  // An idle keep-alive connection to hand over
+  int client = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(0, ::connect(client, reinterpret_cast<sockaddr*>(&addr), addrLen));
+  EXPECT_EQ(0, blockingGet(client).find("HTTP/1.1 200"));
+
+  int fds[2];
+  ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  std::thread handOver([&] {
+    oldServer->handOverSockets(fds[0], true);
+  });
+  auto newServer = makeTakeoverServer();
+  newServer->bind(addresses);
+  newServer->takeOverSockets(fds[1]);
+  handOver.join();
+  ::close(fds[0]);
+  ::close(fds[1]);
+  auto newThread = std::make_unique<ServerThread>(newServer.get());
+  ASSERT_TRUE(newThread->start());
+  oldThread.reset();
+
+  // The connection and the listening socket are served by the new server
+  EXPECT_EQ(0, blockingGet(client).find("HTTP/1.1 200"));
+  ::close(client);
+  client = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(0, ::connect(client, reinterpret_cast<sockaddr*>(&addr), addrLen));
+  EXPECT_EQ(0, blockingGet(client).find("HTTP/1.1 200"));
+  ::close(client);
+}
+
+TEST(HTTPServerWorkers, Resize) {
+  auto server = makeTakeoverServer();
+  server->bind({{folly::SocketAddress("127.0.0.1", 0),
+                 HTTPServer::Protocol::HTTP}});
+  ServerThread thread(server.get());
+  ASSERT_TRUE(thread.start());
+  EXPECT_EQ(2, server->getNumWorkers());
+  sockaddr_storage addr;
+  auto addrLen = server->addresses()[0].address.getAddress(&addr);
+
+  // Idle keep-alive connections, on either worker
+  std::vector<int> clients;
+  for (size_t i = 0; i < 4; i++) {
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(0,
+              ::connect(client, reinterpret_cast<sockaddr*>(&addr), addrLen));
+    EXPECT_EQ(0, blockingGet(client).find("HTTP/1.1 200"));
+    clients.push_back(client);
+  }
+
+  server->setNumWorkers(4);
+  EXPECT_EQ(4, server->getNumWorkers());
+  for (size_t i = 0; i < 4; i++) {
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(0,
+              ::connect(client, reinterpret_cast<sockaddr*>(&addr), addrLen));
+    EXPECT_EQ(0, blockingGet(client).find("HTTP/1.1 200"));
+    clients.push_back(client);
+  }
+
+  // The connections of the workers stopped move to the remaining one
+  server->setNumWorkers(1);
+  EXPECT_EQ(1, server->getNumWorkers());
+  for (auto client : clients) {
+    EXPECT_EQ(0, blockingGet(client).find("HTTP/1.1 200"));
+    ::close(client);
+  }
+  EXPECT_THROW(server->setNumWorkers(0), std::invalid_argument);
+}
+
 class ScopedServerTest : public testing::Test {
  public:
   void SetUp() override {
@@ -721,6 +866,25 @@ TEST_F(ScopedServerTest, StartSSLWithInsecure) {
   EXPECT_EQ(200, resp->getStatusCode());
 }
 
+class InlineServerTest : public ScopedServerTest {
+ protected:
+  HTTPServerOptions createDefaultOpts() override {
+    auto options = ScopedServerTest::createDefaultOpts();
+    options.threads = 0;
+    return options;
+  }
+};
+
+TEST_F(InlineServerTest, Start) {
+  auto server = createScopedServer();
+  auto client = connectPlainText();
+  auto resp = client->getResponse();
+  EXPECT_EQ(200, resp->getStatusCode());
+  client = connectPlainText();
+  resp = client->getResponse();
+  EXPECT_EQ(200, resp->getStatusCode());
+}
+
 class ConnectionFilterTest : public ScopedServerTest {
  protected:
   HTTPServerOptions createDefaultOpts() override {
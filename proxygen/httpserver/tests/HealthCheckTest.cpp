@@ -0,0 +1,58 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/HealthCheck.h>
+
+using namespace proxygen;
+using namespace testing;
+
+TEST(HealthCheckTest, CachedState) {
+  bool healthy = true;
+  int runs = 0;
+  HealthCheck healthCheck([&] {
+      runs++;
+      return healthy;
+    });
+  EXPECT_TRUE(healthCheck.isHealthy());
+  EXPECT_EQ(healthCheck.getPath(), "/health");
+
+  healthy = false;
+  // Probes don't run the check
+  EXPECT_EQ(healthCheck.getResponse()->getStatusCode(), 200);
+  EXPECT_EQ(runs, 0);
+
+  healthCheck.evaluate();
+  EXPECT_EQ(runs, 1);
+  EXPECT_FALSE(healthCheck.isHealthy());
+  auto response = healthCheck.getResponse();
+  EXPECT_EQ(response->getStatusCode(), 503);
+  EXPECT_EQ(response->getBody()->cloneAsValue().moveToFbString(), "Unhealthy");
+  // The same response for every probe
+  EXPECT_EQ(healthCheck.getResponse(), response);
+}
+
+TEST(HealthCheckTest, Draining) {
+  HealthCheck healthCheck([] { return true; });
+  healthCheck.evaluate();
+  healthCheck.setDraining(true);
+  EXPECT_FALSE(healthCheck.isHealthy());
+  healthCheck.evaluate();
+  EXPECT_EQ(healthCheck.getResponse()->getStatusCode(), 503);
+  healthCheck.setDraining(false);
+  EXPECT_EQ(healthCheck.getResponse()->getStatusCode(), 200);
+}
+
+TEST(HealthCheckTest, ThrowingCheck) {
+  HealthCheck healthCheck([]() -> bool {
+      throw std::runtime_error("no disk");
+    });
+  healthCheck.evaluate();
+  EXPECT_FALSE(healthCheck.isHealthy());
+}
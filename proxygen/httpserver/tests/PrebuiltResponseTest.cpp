@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/PrebuiltResponse.h>
+
+using namespace proxygen;
+using namespace testing;
+
+TEST(PrebuiltResponseTest, Send) {
+  HTTPHeaders headers;
+  headers.add(HTTP_HEADER_CONTENT_TYPE, "text/plain");
+  headers.add(HTTP_HEADER_CONNECTION, "close");
+  headers.add(HTTP_HEADER_CONTENT_LENGTH, "1000");
+  auto response = PrebuiltResponse::create(
+    200, "OK", headers, folly::IOBuf::copyBuffer("healthy"));
+
+  StrictMock<MockResponseHandler> handler(nullptr);
+  for (int i = 0; i < 2; i++) {
+    InSequence sequence;
+    EXPECT_CALL(handler, sendHeaders(_))
+      .WillOnce(Invoke([] (HTTPMessage& msg) {
+          EXPECT_EQ(msg.getStatusCode(), 200);
+          EXPECT_EQ(msg.getStatusMessage(), "OK");
+          // Templated, but not the per-hop header
+          ASSERT_NE(msg.getHeaderTemplate(), nullptr);
+          EXPECT_EQ(msg.getHeaderTemplate()->getHeaders().getSingleOrEmpty(
+                      HTTP_HEADER_CONTENT_TYPE), "text/plain");
+          EXPECT_EQ(msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONNECTION),
+                    "close");
+          EXPECT_EQ(msg.getHeaders().getSingleOrEmpty(
+                      HTTP_HEADER_CONTENT_LENGTH), "7");
+        }));
+    EXPECT_CALL(handler, sendBody(_))
+      .WillOnce(Invoke([&] (std::shared_ptr<folly::IOBuf> body) {
+          // Shared, not copied
+          EXPECT_EQ(body->data(), response->getBody()->data());
+          EXPECT_EQ(body->moveToFbString(), "healthy");
+        }));
+    EXPECT_CALL(handler, sendEOM());
+    response->send(&handler);
+    Mock::VerifyAndClearExpectations(&handler);
+  }
+}
+
+TEST(PrebuiltResponseTest, NoContent) {
+  auto response = PrebuiltResponse::create(204, "No Content");
+  StrictMock<MockResponseHandler> handler(nullptr);
+  EXPECT_CALL(handler, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& msg) {
+        EXPECT_EQ(msg.getStatusCode(), 204);
+        EXPECT_EQ(msg.getHeaderTemplate(), nullptr);
+        EXPECT_FALSE(msg.getHeaders().exists(HTTP_HEADER_CONTENT_LENGTH));
+      }));
+  EXPECT_CALL(handler, sendEOM());
+  response->send(&handler);
+}
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/PushPolicy.h>
+
+using namespace proxygen;
+using namespace testing;
+
+class PushPolicyTest : public Test {
+ public:
+  PushPolicyTest() {
+    options_.minPushes = 4;
+    options_.probeInterval = 3;
+    options_.maxPushes = 8;
+    policy_ = std::make_unique<PushPolicy>(options_);
+  }
+
+ protected:
+  HTTPMessage request_;
+  PushPolicy::Options options_;
+  std::unique_ptr<PushPolicy> policy_;
+};
+
+TEST_F(PushPolicyTest, SuppressCancelled) {
+  EXPECT_TRUE(policy_->shouldPush(request_, "/a"));
+  EXPECT_EQ(policy_->getStats("/a"), nullptr);
+  policy_->onPushComplete("/a", 100);
+  for (int i = 0; i < 3; i++) {
+    policy_->onPushCancelled("/a", 10);
+  }
+  auto stats = policy_->getStats("/a");
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->pushes, 4);
+  EXPECT_EQ(stats->cancels, 3);
+  EXPECT_EQ(stats->bytesPushed, 130);
+  EXPECT_EQ(stats->bytesCancelled, 30);
+
+  // Every third push still goes out
+  EXPECT_FALSE(policy_->shouldPush(request_, "/a"));
+  EXPECT_FALSE(policy_->shouldPush(request_, "/a"));
+  EXPECT_TRUE(policy_->shouldPush(request_, "/a"));
+  EXPECT_FALSE(policy_->shouldPush(request_, "/a"));
+  EXPECT_EQ(policy_->getNumSuppressed(), 3);
+  EXPECT_TRUE(policy_->shouldPush(request_, "/b"));
+
+  // Which lets it recover, as the older outcomes fade
+  for (int i = 0; i < 5; i++) {
+    policy_->onPushComplete("/a", 100);
+  }
+  EXPECT_EQ(stats->pushes, 4);
+  EXPECT_EQ(stats->cancels, 1);
+  EXPECT_TRUE(policy_->shouldPush(request_, "/a"));
+}
+
+TEST_F(PushPolicyTest, CacheDigest) {
+  policy_->setCacheDigestHook(
+    [] (const HTTPMessage& request, folly::StringPiece url) {
+      return request.getHeaders().exists("Cache-Digest") && url == "/a";
+    });
+  EXPECT_TRUE(policy_->shouldPush(request_, "/a"));
+  request_.getHeaders().add("Cache-Digest", "x");
+  EXPECT_FALSE(policy_->shouldPush(request_, "/a"));
+  EXPECT_TRUE(policy_->shouldPush(request_, "/b"));
+  EXPECT_EQ(policy_->getNumCacheDigestHits(), 1);
+  EXPECT_EQ(policy_->getNumSuppressed(), 1);
+}
+
+TEST_F(PushPolicyTest, MaxResources) {
+  options_.maxResources = 2;
+  policy_ = std::make_unique<PushPolicy>(options_);
+  policy_->onPushComplete("/a", 1);
+  policy_->onPushComplete("/b", 1);
+  policy_->onPushComplete("/c", 1);
+  EXPECT_EQ(policy_->getStats("/a"), nullptr);
+  EXPECT_NE(policy_->getStats("/b"), nullptr);
+  EXPECT_NE(policy_->getStats("/c"), nullptr);
+}
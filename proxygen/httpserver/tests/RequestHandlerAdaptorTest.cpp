@@ -62,3 +62,18 @@ TEST(RequestHandlerAdaptorTest, onError) {
   ex.setProxygenError(kErrorTimeout);
   txn.onError(ex);
 }
+
+TEST(RequestHandlerAdaptorTest, Recycling) {
+  NiceMock<MockRequestHandler> requestHandler;
+  setRequestHandlerRecycling(true);
+  auto adaptor = new RequestHandlerAdaptor(&requestHandler);
+  void* memory = adaptor;
+  delete adaptor;
+  // The memory of the last one freed on this thread
+  adaptor = new RequestHandlerAdaptor(&requestHandler);
+  EXPECT_EQ(adaptor, memory);
+  setRequestHandlerRecycling(false);
+  delete adaptor;
+  // Objects of derived classes aren't recycled, but freed all the same
+  delete new StubRequestHandlerAdaptor(&requestHandler);
+}
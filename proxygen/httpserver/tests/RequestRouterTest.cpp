@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/RequestRouter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+RequestRouter::HandlerFactory nullFactory() {
+  return [] (HTTPMessage*, const RouteParams&) -> RequestHandler* {
+    return nullptr;
+  };
+}
+
+}
+
+class RequestRouterTest : public Test {
+ public:
+  folly::Optional<size_t> find(folly::Optional<HTTPMethod> method,
+                               folly::StringPiece path,
+                               bool* pathMatched = nullptr) {
+    params_ = RouteParams();
+    return router_.findRoute(method, path, params_, pathMatched);
+  }
+
+ protected:
+  RequestRouter router_;
+  RouteParams params_;
+};
+
+TEST_F(RequestRouterTest, Precedence) {
+  auto root = router_.addRoute(HTTPMethod::GET, "/", nullFactory());
+  auto me = router_.addRoute(HTTPMethod::GET, "/users/me", nullFactory());
+  auto user = router_.addRoute(HTTPMethod::GET, "/users/:id", nullFactory());
+  auto files = router_.addRoute(HTTPMethod::GET, "/users/:id/files/*path",
+                                nullFactory());
+  auto rest = router_.addRoute(folly::none, "/users/*rest", nullFactory());
+  EXPECT_EQ(router_.getNumRoutes(), 5);
+  EXPECT_EQ(router_.getPattern(user), "/users/:id");
+
+  EXPECT_EQ(find(HTTPMethod::GET, "/"), root);
+  EXPECT_EQ(find(HTTPMethod::GET, "/users/me"), me);
+  EXPECT_EQ(params_.size(), 0);
+
+  EXPECT_EQ(find(HTTPMethod::GET, "/users/42"), user);
+  EXPECT_EQ(*params_.get("id"), "42");
+  EXPECT_FALSE(params_.get("path"));
+
+  EXPECT_EQ(find(HTTPMethod::GET, "/users/me/files/a/b.txt"), files);
+  EXPECT_EQ(*params_.get("id"), "me");
+  EXPECT_EQ(*params_.get("path"), "a/b.txt");
+
+  // Backtracks from the parameter to the wildcard
+  EXPECT_EQ(find(HTTPMethod::GET, "/users/42/other"), rest);
+  EXPECT_EQ(params_.size(), 1);
+  EXPECT_EQ(*params_.get("rest"), "42/other");
+  EXPECT_EQ(find(HTTPMethod::PUT, "/users/42"), rest);
+
+  // Parameters don't match empty segments
+  EXPECT_EQ(find(HTTPMethod::GET, "/users/"), rest);
+  EXPECT_FALSE(find(HTTPMethod::GET, "/users"));
+  EXPECT_FALSE(find(HTTPMethod::GET, "/other"));
+  EXPECT_FALSE(find(HTTPMethod::GET, "*"));
+}
+
+TEST_F(RequestRouterTest, Methods) {
+  auto get = router_.addRoute(HTTPMethod::GET, "/a", nullFactory());
+  auto post = router_.addRoute(HTTPMethod::POST, "/a", nullFactory());
+  EXPECT_EQ(find(HTTPMethod::GET, "/a"), get);
+  EXPECT_EQ(find(HTTPMethod::POST, "/a"), post);
+  bool pathMatched = false;
+  EXPECT_FALSE(find(HTTPMethod::DELETE, "/a", &pathMatched));
+  EXPECT_TRUE(pathMatched);
+  // Extension methods only match routes for any method
+  EXPECT_FALSE(find(folly::none, "/a", &pathMatched));
+  EXPECT_TRUE(pathMatched);
+  EXPECT_FALSE(find(HTTPMethod::GET, "/b", &pathMatched));
+  EXPECT_FALSE(pathMatched);
+}
+
+TEST_F(RequestRouterTest, InvalidPatterns) {
+  router_.addRoute(HTTPMethod::GET, "/a/:id", nullFactory());
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "a", nullFactory()),
+               std::invalid_argument);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "/a/:", nullFactory()),
+               std::invalid_argument);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "/*x/a", nullFactory()),
+               std::invalid_argument);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "/a/:name", nullFactory()),
+               std::invalid_argument);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "/a/:id", nullFactory()),
+               std::invalid_argument);
+  router_.addRoute(HTTPMethod::POST, "/a/:id", nullFactory());
+}
+
+TEST_F(RequestRouterTest, OnRequest) {
+  auto handler = new MockRequestHandler();
+  std::string id;
+  router_.addRoute(HTTPMethod::GET, "/items/:id",
+                   [&] (HTTPMessage*, const RouteParams& params) {
+                     id = params.get("id")->str();
+                     return handler;
+                   });
+
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::GET);
+  msg.setURL("/items/7?x=1");
+  EXPECT_EQ(router_.onRequest(nullptr, &msg), handler);
+  EXPECT_EQ(id, "7");
+  delete handler;
+
+  // Unrouted requests go down the chain, if there is one
+  MockRequestHandler upstream;
+  msg.setURL("/other");
+  EXPECT_EQ(router_.onRequest(&upstream, &msg), &upstream);
+
+  auto notFound = router_.onRequest(nullptr, &msg);
+  MockResponseHandler notFoundResponse(notFound);
+  EXPECT_CALL(notFoundResponse, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& response) {
+          EXPECT_EQ(response.getStatusCode(), 404);
+        }));
+  EXPECT_CALL(notFoundResponse, sendEOM());
+  notFound->setResponseHandler(&notFoundResponse);
+  notFound->onEOM();
+  notFound->requestComplete();
+
+  msg.setMethod(HTTPMethod::PUT);
+  msg.setURL("/items/7");
+  auto notAllowed = router_.onRequest(nullptr, &msg);
+  MockResponseHandler notAllowedResponse(notAllowed);
+  EXPECT_CALL(notAllowedResponse, sendHeaders(_))
+    .WillOnce(Invoke([] (HTTPMessage& response) {
+          EXPECT_EQ(response.getStatusCode(), 405);
+          ASSERT_NE(response.getHeaderTemplate(), nullptr);
+          EXPECT_EQ(response.getHeaderTemplate()->getHeaders()
+                    .getSingleOrEmpty(HTTP_HEADER_ALLOW), "GET");
+        }));
+  EXPECT_CALL(notAllowedResponse, sendEOM());
+  notAllowed->setResponseHandler(&notAllowedResponse);
+  notAllowed->onEOM();
+  notAllowed->requestComplete();
+}
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/TLSResumption.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+const std::chrono::seconds kInterval(3600);
+const std::chrono::system_clock::time_point kNow(
+  std::chrono::seconds(1570715736));
+
+}
+
+TEST(TLSResumptionTest, DerivedSeedsRotate) {
+  DerivedTicketSeedProvider provider("secret", kInterval);
+  auto seeds = provider.getSeedsAt(kNow);
+  ASSERT_EQ(seeds.oldSeeds.size(), 1);
+  ASSERT_EQ(seeds.currentSeeds.size(), 1);
+  ASSERT_EQ(seeds.newSeeds.size(), 1);
+  // 32 bytes, hex
+  EXPECT_EQ(seeds.currentSeeds[0].size(), 64);
+  EXPECT_NE(seeds.currentSeeds, seeds.newSeeds);
+
+  // Within the interval, the same seeds
+  EXPECT_EQ(provider.getSeedsAt(kNow + std::chrono::seconds(1)).currentSeeds,
+            seeds.currentSeeds);
+
+  auto next = provider.getSeedsAt(kNow + kInterval);
+  EXPECT_EQ(next.oldSeeds, seeds.currentSeeds);
+  EXPECT_EQ(next.currentSeeds, seeds.newSeeds);
+}
+
+TEST(TLSResumptionTest, DerivedSeedsShared) {
+  // Another host with the same secret
+  DerivedTicketSeedProvider provider("secret", kInterval);
+  DerivedTicketSeedProvider other("secret", kInterval);
+  DerivedTicketSeedProvider stranger("other secret", kInterval);
+  EXPECT_EQ(provider.getSeedsAt(kNow).currentSeeds,
+            other.getSeedsAt(kNow).currentSeeds);
+  EXPECT_NE(provider.getSeedsAt(kNow).currentSeeds,
+            stranger.getSeedsAt(kNow).currentSeeds);
+}
+
+TEST(TLSResumptionTest, SetSecret) {
+  DerivedTicketSeedProvider provider("secret", kInterval);
+  auto before = provider.getSeedsAt(kNow);
+  provider.setSecret("new secret");
+  auto after = provider.getSeedsAt(kNow);
+  EXPECT_NE(after.currentSeeds, before.currentSeeds);
+  // The tickets of the previous secret still decrypt
+  EXPECT_THAT(after.oldSeeds, Contains(before.currentSeeds[0]));
+  EXPECT_THAT(after.oldSeeds, Contains(before.oldSeeds[0]));
+}
+
+TEST(TLSResumptionTest, Stats) {
+  TLSResumptionStats stats;
+  EXPECT_EQ(stats.getHitRate(), 0);
+  stats.recordHandshake(wangle::SSLResumeEnum::HANDSHAKE);
+  stats.recordHandshake(wangle::SSLResumeEnum::RESUME_TICKET);
+  stats.recordHandshake(wangle::SSLResumeEnum::RESUME_TICKET);
+  stats.recordHandshake(wangle::SSLResumeEnum::RESUME_SESSION_ID);
+  stats.recordHandshake(wangle::SSLResumeEnum::NA);
+  EXPECT_EQ(stats.fullHandshakes, 1);
+  EXPECT_EQ(stats.ticketResumptions, 2);
+  EXPECT_DOUBLE_EQ(stats.getHitRate(), 0.75);
+}
@@ -0,0 +1,665 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/Baton.h>
+#include <proxygen/httpserver/HTTPServer.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/codec/TrafficCaptureFilter.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/utils/Time.h>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace folly;
+using namespace proxygen;
+
+// Replays the sessions of a traffic capture, written by a
+// TrafficCaptureWriter set in HTTPServerOptions::trafficCapture, against an
+// in-process HTTPServer or a target server, speed times faster than they
+// were captured.  The sessions are spread over the client threads, and
+// their requests keep the captured headers, body sizes and timings; the
+// in-process server answers each with as many bytes as the captured
+// response had.  One line is printed, for perf jobs to parse and compare:
+//
+//   sessions=... requests=... rps=... p50_us=... p99_us=... p999_us=...
+//     p99_slip_us=... errors=0
+//
+// The slip is how late the requests started, past their scaled capture
+// time: when it grows the replay can't keep up with the speed asked.  The
+// exit status is 1 if any request failed.
+
+DEFINE_string(capture, "", "The traffic capture file to replay");
+DEFINE_double(speed, 1.0, "How many times faster than captured to replay");
+DEFINE_string(target, "", "host:port of the server to replay against, "
+              "in place of an in-process HTTPServer");
+DEFINE_string(protocol, "captured", "captured: HTTP/1.1 or h2c as the "
+              "session was captured over, h1, or h2c");
+DEFINE_int32(server_threads, 2, "In-process server threads");
+DEFINE_int32(client_threads, 4, "Client threads");
+DEFINE_int32(max_sessions, 0, "Replays the first sessions only, if not 0");
+
+namespace {
+
+// Asks the in-process server for a response of that many bytes
+const std::string kResponseSizeHeader = "X-Replay-Response-Size";
+
+struct RequestScript {
+  struct Step {
+    uint32_t offsetUs;
+    CapturedEvent::Type type;
+    uint32_t length;
+  };
+
+  // Since the session started
+  uint32_t startUs{0};
+  std::shared_ptr<const HTTPMessage> msg;
+  std::vector<Step> steps;
+  uint64_t responseBytes{0};
+};
+
+struct SessionScript {
+  // Since the first session started
+  uint64_t startUs{0};
+  bool h2{false};
+  std::vector<RequestScript> requests;
+};
+
+std::vector<SessionScript> loadScripts(const std::string& path) {
+  std::string data;
+  CHECK(folly::readFile(path.c_str(), data)) << "Can't read " << path;
+  std::vector<CapturedSession> sessions;
+  CHECK(TrafficCaptureWriter::decode(
+          folly::ByteRange(folly::StringPiece(data)), sessions))
+    << path << " is not a traffic capture";
+  std::sort(sessions.begin(), sessions.end(),
+            [] (const CapturedSession& a, const CapturedSession& b) {
+              return a.startUs < b.startUs;
+            });
+
+  std::vector<SessionScript> scripts;
+  for (const auto& session : sessions) {
+    // Only the server side of the sessions has the requests as received
+    if (session.direction != TransportDirection::DOWNSTREAM) {
+      continue;
+    }
+    SessionScript script;
+    script.startUs = session.startUs - sessions.front().startUs;
+    // HTTP/2, SPDY and HTTP/3 sessions are all replayed as h2c
+    script.h2 = FLAGS_protocol == "h2c" ||
+      (FLAGS_protocol == "captured" &&
+       session.protocol != CodecProtocol::HTTP_1_1);
+    std::map<uint64_t, size_t> streams;
+    for (const auto& event : session.events) {
+      auto it = streams.find(event.streamID);
+      if (event.direction == CapturedEvent::INGRESS &&
+          event.type == CapturedEvent::HEADERS && event.msg &&
+          event.msg->isRequest() && it == streams.end()) {
+        streams[event.streamID] = script.requests.size();
+        script.requests.emplace_back();
+        script.requests.back().startUs = event.offsetUs;
+        script.requests.back().msg = event.msg;
+        continue;
+      }
+      if (it == streams.end()) {
+        continue;
+      }
+      auto& request = script.requests[it->second];
+      if (event.direction == CapturedEvent::INGRESS) {
+        request.steps.push_back({event.offsetUs, event.type, event.length});
+      } else if (event.type == CapturedEvent::BODY) {
+        request.responseBytes += event.length;
+      }
+    }
+    if (!script.requests.empty()) {
+      scripts.push_back(std::move(script));
+    }
+    if (FLAGS_max_sessions > 0 &&
+        scripts.size() >= static_cast<size_t>(FLAGS_max_sessions)) {
+      break;
+    }
+  }
+  return scripts;
+}
+
+std::chrono::microseconds scaled(uint64_t us) {
+  return std::chrono::microseconds(static_cast<int64_t>(us / FLAGS_speed));
+}
+
+std::chrono::milliseconds delayUntil(TimePoint when) {
+  auto now = getCurrentTime();
+  if (when <= now) {
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::duration_cast<std::chrono::milliseconds>(when - now);
+}
+
+class ReplayHandler : public RequestHandler {
+ public:
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override {
+    responseSize_ = folly::tryTo<size_t>(
+      headers->getHeaders().getSingleOrEmpty(kResponseSizeHeader))
+      .value_or(0);
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
+
+  void onEOM() noexcept override {
+    ResponseBuilder(downstream_)
+      .status(200, "OK")
+      .body(std::string(responseSize_, 'x'))
+      .sendWithEOM();
+  }
+
+  void onUpgrade(UpgradeProtocol /*prot*/) noexcept override {}
+
+  void requestComplete() noexcept override {
+    delete this;
+  }
+
+  void onError(ProxygenError /*err*/) noexcept override {
+    delete this;
+  }
+
+ private:
+  size_t responseSize_{0};
+};
+
+class HandlerFactory : public RequestHandlerFactory {
+ public:
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
+    return new ReplayHandler;
+  }
+};
+
+// Posted once the last session is replayed
+std::atomic<size_t> sessionsLeft{0};
+folly::Baton<> replayDone;
+
+class Worker;
+class SessionReplay;
+
+/**
+ * A request of a replayed session, which sends its steps as they come due.
+ */
+class Request : public HTTPTransactionHandler,
+                public HHWheelTimer::Callback {
+ public:
+  Request(SessionReplay& session, const RequestScript& script)
+      : session_(session), script_(script) {}
+
+  // Starts the request once due, or its next step
+  void timeoutExpired() noexcept override;
+
+  bool start(HTTPUpstreamSession* session);
+
+  void setTransaction(HTTPTransaction* /*txn*/) noexcept override {}
+
+  void detachTransaction() noexcept override;
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept
+      override {
+    status_ = msg->getStatusCode();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*chain*/) noexcept override {}
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept
+      override {}
+
+  void onEOM() noexcept override {
+    ok_ = status_ >= 200 && status_ < 400;
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {}
+
+  void onError(const HTTPException& /*error*/) noexcept override {
+    ok_ = false;
+    failed_ = true;
+    cancelTimeout();
+  }
+
+  void onEgressPaused() noexcept override {}
+
+  void onEgressResumed() noexcept override {}
+
+  const RequestScript& getScript() const {
+    return script_;
+  }
+
+  bool isStarted() const {
+    return timePointInitialized(started_);
+  }
+
+  TimePoint scheduled_;
+  TimePoint started_;
+  bool ok_{false};
+
+ private:
+  void runSteps();
+
+  SessionReplay& session_;
+  const RequestScript& script_;
+  HTTPTransaction* txn_{nullptr};
+  size_t nextStep_{0};
+  uint16_t status_{0};
+  bool eomSent_{false};
+  bool failed_{false};
+};
+
+/**
+ * A captured session replayed over a new connection.
+ */
+class SessionReplay : public HTTPConnector::Callback,
+                      public HHWheelTimer::Callback,
+                      private HTTPSessionBase::InfoCallback {
+ public:
+  SessionReplay(Worker& worker, const SessionScript& script);
+
+  ~SessionReplay() override {
+    close();
+  }
+
+  // Connects once the session is due, replaying from then
+  void schedule(TimePoint replayStart);
+
+  void timeoutExpired() noexcept override;
+
+  void connectSuccess(HTTPUpstreamSession* session) override;
+
+  void connectError(const folly::AsyncSocketException& ex) override {
+    LOG(ERROR) << "Failed to connect: " << ex.what();
+    errors_ += script_.requests.size();
+    finish();
+  }
+
+  // Starts request, now or once the session can take another transaction
+  void startRequest(Request* request);
+
+  void onRequestDone(Request* request);
+
+  HHWheelTimer& getTimer();
+
+  void close() {
+    if (session_) {
+      auto session = session_;
+      session_ = nullptr;
+      session->setInfoCallback(nullptr);
+      session->dropConnection();
+    }
+  }
+
+  std::vector<uint32_t> latencies_;
+  std::vector<uint32_t> slips_;
+  uint64_t errors_{0};
+
+ private:
+  void onDestroy(const HTTPSessionBase&) override;
+
+  void startPending();
+
+  void finish();
+
+  Worker& worker_;
+  const SessionScript& script_;
+  TimePoint start_;
+  std::unique_ptr<HTTPConnector> connector_;
+  HTTPUpstreamSession* session_{nullptr};
+  std::vector<std::unique_ptr<Request>> requests_;
+  std::deque<Request*> pending_;
+  size_t done_{0};
+  bool finished_{false};
+};
+
+/**
+ * A client thread and the sessions it replays.
+ */
+class Worker {
+ public:
+  Worker()
+      : timer_(HHWheelTimer::newTimer(
+                 &evb_,
+                 std::chrono::milliseconds(HHWheelTimer::DEFAULT_TICK_INTERVAL),
+                 AsyncTimeout::InternalEnum::NORMAL,
+                 std::chrono::milliseconds(5000))) {}
+
+  void add(const SessionScript& script) {
+    sessions_.push_back(std::make_unique<SessionReplay>(*this, script));
+  }
+
+  void start(TimePoint replayStart) {
+    thread_ = std::thread([this, replayStart] {
+        for (auto& session : sessions_) {
+          session->schedule(replayStart);
+        }
+        evb_.loopForever();
+      });
+  }
+
+  void stop() {
+    evb_.runInEventBaseThreadAndWait([this] {
+        for (auto& session : sessions_) {
+          session->close();
+        }
+      });
+    evb_.terminateLoopSoon();
+    thread_.join();
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+
+  std::vector<std::unique_ptr<SessionReplay>>& getSessions() {
+    return sessions_;
+  }
+
+  folly::EventBase evb_;
+  HHWheelTimer::UniquePtr timer_;
+  folly::SocketAddress h1Address_;
+  folly::SocketAddress h2Address_;
+
+ private:
+  std::vector<std::unique_ptr<SessionReplay>> sessions_;
+  std::thread thread_;
+};
+
+void Request::timeoutExpired() noexcept {
+  if (!txn_) {
+    session_.startRequest(this);
+  } else {
+    runSteps();
+  }
+}
+
+bool Request::start(HTTPUpstreamSession* session) {
+  txn_ = session->newTransaction(this);
+  if (!txn_) {
+    return false;
+  }
+  started_ = getCurrentTime();
+  HTTPMessage msg(*script_.msg);
+  msg.setHTTPVersion(1, 1);
+  auto& headers = msg.getHeaders();
+  if (!headers.exists(HTTP_HEADER_HOST)) {
+    headers.set(HTTP_HEADER_HOST, "localhost");
+  }
+  headers.set(kResponseSizeHeader,
+              folly::to<std::string>(script_.responseBytes));
+  bool hasBody = std::any_of(
+    script_.steps.begin(), script_.steps.end(),
+    [] (const RequestScript::Step& step) {
+      return step.type == CapturedEvent::BODY;
+    });
+  if (hasBody && !headers.exists(HTTP_HEADER_CONTENT_LENGTH)) {
+    msg.setIsChunked(true);
+  }
+  txn_->sendHeaders(msg);
+  runSteps();
+  return true;
+}
+
+void Request::runSteps() {
+  // Sending the EOM may detach the transaction
+  while (txn_ && !failed_ && nextStep_ < script_.steps.size()) {
+    const auto& step = script_.steps[nextStep_];
+    auto due = started_ + scaled(step.offsetUs > script_.startUs ?
+                                 step.offsetUs - script_.startUs : 0);
+    auto delay = delayUntil(due);
+    if (delay.count() > 0) {
+      session_.getTimer().scheduleTimeout(this, delay);
+      return;
+    }
+    nextStep_++;
+    switch (step.type) {
+      case CapturedEvent::BODY:
+        txn_->sendBody(folly::IOBuf::copyBuffer(
+                         std::string(step.length, 'x')));
+        break;
+      case CapturedEvent::EOM:
+        eomSent_ = true;
+        txn_->sendEOM();
+        break;
+      case CapturedEvent::ABORT:
+        eomSent_ = true;
+        txn_->sendAbort();
+        break;
+      case CapturedEvent::HEADERS:
+      case CapturedEvent::TRAILERS:
+        // Not replayed
+        break;
+    }
+  }
+  if (txn_ && !failed_ && !eomSent_) {
+    // The capture was cut short of the request's end
+    eomSent_ = true;
+    txn_->sendEOM();
+  }
+}
+
+void Request::detachTransaction() noexcept {
+  txn_ = nullptr;
+  cancelTimeout();
+  session_.onRequestDone(this);
+}
+
+SessionReplay::SessionReplay(Worker& worker, const SessionScript& script)
+    : worker_(worker),
+      script_(script),
+      connector_(std::make_unique<HTTPConnector>(this, worker.timer_.get())) {
+  for (const auto& request : script_.requests) {
+    requests_.push_back(std::make_unique<Request>(*this, request));
+  }
+}
+
+HHWheelTimer& SessionReplay::getTimer() {
+  return *worker_.timer_;
+}
+
+void SessionReplay::schedule(TimePoint replayStart) {
+  start_ = replayStart + scaled(script_.startUs);
+  worker_.timer_->scheduleTimeout(this, delayUntil(start_));
+}
+
+void SessionReplay::timeoutExpired() noexcept {
+  if (script_.h2) {
+    connector_->setPlaintextProtocol(http2::kProtocolCleartextString);
+    connector_->connect(&worker_.evb_, worker_.h2Address_);
+  } else {
+    connector_->connect(&worker_.evb_, worker_.h1Address_);
+  }
+}
+
+void SessionReplay::connectSuccess(HTTPUpstreamSession* session) {
+  session_ = session;
+  session_->setInfoCallback(this);
+  for (auto& request : requests_) {
+    request->scheduled_ = start_ + scaled(request->getScript().startUs);
+    worker_.timer_->scheduleTimeout(request.get(),
+                                    delayUntil(request->scheduled_));
+  }
+}
+
+void SessionReplay::startRequest(Request* request) {
+  pending_.push_back(request);
+  startPending();
+}
+
+void SessionReplay::startPending() {
+  while (session_ && !pending_.empty()) {
+    auto request = pending_.front();
+    if (!request->start(session_)) {
+      // HTTP/1.x: once the transaction in progress is done
+      return;
+    }
+    pending_.pop_front();
+    slips_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+        request->started_ - request->scheduled_).count());
+  }
+}
+
+void SessionReplay::onRequestDone(Request* request) {
+  if (request->ok_) {
+    latencies_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+        getCurrentTime() - request->started_).count());
+  } else {
+    errors_++;
+  }
+  if (++done_ == requests_.size()) {
+    worker_.evb_.runInLoop([this] {
+        close();
+        finish();
+      });
+    return;
+  }
+  // The session may not open the next HTTP/1.x transaction before it is
+  // done with this one
+  worker_.evb_.runInLoop([this] { startPending(); }, true);
+}
+
+void SessionReplay::onDestroy(const HTTPSessionBase&) {
+  session_ = nullptr;
+  if (done_ < requests_.size()) {
+    // The started requests were detached already, the others never will be
+    pending_.clear();
+    for (auto& request : requests_) {
+      if (!request->isStarted()) {
+        request->cancelTimeout();
+        errors_++;
+      }
+    }
+    finish();
+  }
+}
+
+void SessionReplay::finish() {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  if (--sessionsLeft == 0) {
+    replayDone.post();
+  }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv, true);
+  CHECK(!FLAGS_capture.empty()) << "--capture is required";
+  CHECK_GT(FLAGS_speed, 0);
+  CHECK(FLAGS_protocol == "captured" || FLAGS_protocol == "h1" ||
+        FLAGS_protocol == "h2c") << "Unknown protocol " << FLAGS_protocol;
+
+  auto scripts = loadScripts(FLAGS_capture);
+  CHECK(!scripts.empty()) << "No server side sessions in " << FLAGS_capture;
+  size_t numRequests = 0;
+  for (const auto& script : scripts) {
+    numRequests += script.requests.size();
+  }
+
+  std::unique_ptr<HTTPServer> server;
+  std::thread serverThread;
+  folly::SocketAddress h1Address;
+  folly::SocketAddress h2Address;
+  if (FLAGS_target.empty()) {
+    HTTPServerOptions options;
+    options.threads = static_cast<size_t>(FLAGS_server_threads);
+    options.idleTimeout = std::chrono::milliseconds(60000);
+    options.handlerFactories = RequestHandlerChain()
+        .addThen<HandlerFactory>()
+        .build();
+    server = std::make_unique<HTTPServer>(std::move(options));
+    std::vector<HTTPServer::IPConfig> ips{
+      {folly::SocketAddress("127.0.0.1", 0), HTTPServer::Protocol::HTTP},
+      {folly::SocketAddress("127.0.0.1", 0), HTTPServer::Protocol::HTTP2}};
+    server->bind(ips);
+    auto barrier = std::make_shared<boost::barrier>(2);
+    serverThread = std::thread([&server, barrier] {
+        server->start([barrier] { barrier->wait(); });
+      });
+    barrier->wait();
+    h1Address = server->addresses()[0].address;
+    h2Address = server->addresses()[1].address;
+  } else {
+    h1Address.setFromHostPort(FLAGS_target);
+    h2Address = h1Address;
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int i = 0; i < FLAGS_client_threads; i++) {
+    workers.push_back(std::make_unique<Worker>());
+    workers.back()->h1Address_ = h1Address;
+    workers.back()->h2Address_ = h2Address;
+  }
+  for (size_t i = 0; i < scripts.size(); i++) {
+    workers[i % workers.size()]->add(scripts[i]);
+  }
+  sessionsLeft = scripts.size();
+
+  // Leaves the threads time to start before the first session is due
+  auto start = getCurrentTime() + std::chrono::milliseconds(100);
+  for (auto& worker : workers) {
+    worker->start(start);
+  }
+  replayDone.wait();
+  auto elapsed = getCurrentTime() - start;
+
+  std::vector<uint32_t> latencies;
+  std::vector<uint32_t> slips;
+  uint64_t errors = 0;
+  for (auto& worker : workers) {
+    worker->stop();
+    for (auto& session : worker->getSessions()) {
+      latencies.insert(latencies.end(), session->latencies_.begin(),
+                       session->latencies_.end());
+      slips.insert(slips.end(), session->slips_.begin(),
+                   session->slips_.end());
+      errors += session->errors_;
+    }
+  }
+  if (server) {
+    server->stop();
+    serverThread.join();
+  }
+
+  auto percentile = [] (std::vector<uint32_t>& values,
+                        double p) -> uint32_t {
+    if (values.empty()) {
+      return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, size_t(p * values.size()))];
+  };
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  std::cout << "sessions=" << scripts.size()
+            << " requests=" << numRequests
+            << " speed=" << FLAGS_speed
+            << " rps=" << uint64_t(
+              latencies.size() * 1e6 /
+              std::max<int64_t>(
+                duration_cast<microseconds>(elapsed).count(), 1))
+            << " p50_us=" << percentile(latencies, 0.5)
+            << " p99_us=" << percentile(latencies, 0.99)
+            << " p999_us=" << percentile(latencies, 0.999)
+            << " p99_slip_us=" << percentile(slips, 0.99)
+            << " errors=" << errors << std::endl;
+  return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/HQConnector.h>
+
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <quic/client/QuicClientTransport.h>
+#include <quic/congestion_control/CongestionControllerFactory.h>
+
+namespace proxygen {
+
+HQConnector::HQConnector(Callback* callback,
+                         std::chrono::milliseconds transactionTimeout)
+    : cb_(CHECK_NOTNULL(callback)),
+      transactionTimeout_(transactionTimeout) {
+}
+
+HQConnector::~HQConnector() {
+  reset();
+}
+
+void HQConnector::reset() {
+  if (session_) {
+    auto session = session_;
+    session_ = nullptr;
+    session->setConnectCallback(nullptr);
+    session->dropConnection();
+  }
+}
+
+void HQConnector::connect(
+    folly::EventBase* eventBase,
+    const folly::SocketAddress& connectAddr,
+    std::shared_ptr<const fizz::client::FizzClientContext> context,
+    std::shared_ptr<const fizz::CertificateVerifier> verifier,
+    std::chrono::milliseconds timeoutMs,
+    const folly::SocketAddress& bindAddr,
+    const std::string& serverName) {
+  DCHECK(!isBusy());
+  CHECK(context);
+
+  auto quicClient = std::make_shared<quic::QuicClientTransport>(
+    eventBase, std::make_unique<folly::AsyncUDPSocket>(eventBase));
+  if (!serverName.empty()) {
+    quicClient->setHostname(serverName);
+  }
+  quicClient->setFizzClientContext(std::move(context));
+  quicClient->setCertificateVerifier(std::move(verifier));
+  quicClient->addNewPeerAddress(connectAddr);
+  if (bindAddr.isInitialized()) {
+    quicClient->setLocalAddress(bindAddr);
+  }
+  quicClient->setCongestionControllerFactory(
+    std::make_shared<quic::DefaultCongestionControllerFactory>());
+  quicClient->setTransportSettings(transportSettings_);
+  if (pskCache_) {
+    quicClient->setPskCache(pskCache_);
+  }
+
+  connectStart_ = getCurrentTime();
+  wangle::TransportInfo tinfo;
+  // For the sessions to age out of the pools as the TCP ones do
+  tinfo.acceptTime = connectStart_;
+  session_ = new HQUpstreamSession(transactionTimeout_,
+                                   timeoutMs,
+                                   nullptr, // controller
+                                   tinfo,
+                                   nullptr); // InfoCallback
+  session_->setSocket(quicClient);
+  session_->setConnectCallback(this);
+  session_->startNow();
+  quicClient->start(session_);
+}
+
+std::chrono::milliseconds HQConnector::timeElapsed() {
+  if (timePointInitialized(connectStart_)) {
+    return millisecondsSince(connectStart_);
+  }
+  return std::chrono::milliseconds(0);
+}
+
+void HQConnector::connectSuccess() {
+  // Handed over as soon as requests can be sent, before the handshake
+  // completes with 0-RTT: the session reports the later errors itself
+  auto session = session_;
+  session_ = nullptr;
+  session->setConnectCallback(nullptr);
+  cb_->connectSuccess(session);
+}
+
+void HQConnector::onReplaySafe() {
+  // Not reached, the session no longer calls back after connectSuccess()
+}
+
+void HQConnector::connectError(
+    std::pair<quic::QuicErrorCode, std::string> error) {
+  // The session drops the connection once this returns
+  session_ = nullptr;
+  cb_->connectError(std::move(error));
+}
+
+}
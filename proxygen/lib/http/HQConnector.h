@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <fizz/client/FizzClientContext.h>
+#include <fizz/protocol/CertificateVerifier.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/session/HQUpstreamSession.h>
+#include <proxygen/lib/utils/Time.h>
+#include <quic/client/handshake/QuicPskCache.h>
+#include <quic/state/TransportSettings.h>
+
+namespace proxygen {
+
+extern const std::string empty_string;
+
+/**
+ * This class establishes new HTTP/3 sessions, the QUIC counterpart of
+ * HTTPConnector, e.g. to fill a SessionPool with HQUpstreamSessions.  It
+ * can be reused, even to connect to different addresses, but it can only
+ * service setting up one session at a time.
+ *
+ * With a PSK cache (e.g. PersistentQuicPskCache, so that it survives
+ * restarts) and a context that sends early data, the sessions set up after
+ * the first resume with 0-RTT: connectSuccess() is invoked before the
+ * handshake completes, so a pool replacing a session that died can send
+ * its first requests right away.  The session is then not replay safe
+ * until the handshake completes, see HQUpstreamSession::isReplaySafe() and
+ * HTTPTransaction::addWaitingForReplaySafety().
+ */
+class HQConnector : private HQSession::ConnectCallback {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {}
+    virtual void connectSuccess(HQUpstreamSession* session) = 0;
+    virtual void connectError(
+      std::pair<quic::QuicErrorCode, std::string> error) = 0;
+  };
+
+  /**
+   * @param callback The interface on which to receive the result.
+   *                 Whatever object is passed here MUST outlive this
+   *                 connector and MUST NOT be null.
+   * @param transactionTimeout The timeout of the transactions opened on the
+   *                           sessions.
+   */
+  HQConnector(Callback* callback,
+              std::chrono::milliseconds transactionTimeout);
+
+  /**
+   * Clients may delete the connector at any time to cancel it. No
+   * callbacks will be received.
+   */
+  ~HQConnector() override;
+
+  /**
+   * Reset the object so that it can begin a new connection. No callbacks
+   * will be invoked as a result of executing this function. After this
+   * function returns, isBusy() will return false.
+   */
+  void reset();
+
+  void setTransportSettings(const quic::TransportSettings& settings) {
+    transportSettings_ = settings;
+  }
+
+  /**
+   * The PSKs of the sessions, for the next ones to the same servers to
+   * resume, with 0-RTT if the context sends early data.
+   */
+  void setQuicPskCache(std::shared_ptr<quic::QuicPskCache> pskCache) {
+    pskCache_ = std::move(pskCache);
+  }
+
+  /**
+   * Begin the process of getting an HTTP/3 session to the server specified
+   * by 'connectAddr'. This function immediately starts async work and may
+   * invoke functions on Callback immediately.
+   *
+   * @param eventBase The event base to put events on.
+   * @param connectAddr The address to connect to.
+   * @param context Fizz client context to use, with the ALPNs of the HQ
+   *                versions to offer. Must not be null.
+   * @param verifier Verifier of the server certificates.
+   * @param timeoutMs Optional. If this value is greater than zero, then a
+   *                  connect error will be given if no connection is
+   *                  established within this amount of time.
+   * @param bindAddr Optional address to bind to locally.
+   * @param serverName Optional server name to send, also the identity of
+   *                   the cached PSK.
+   */
+  void connect(
+    folly::EventBase* eventBase,
+    const folly::SocketAddress& connectAddr,
+    std::shared_ptr<const fizz::client::FizzClientContext> context,
+    std::shared_ptr<const fizz::CertificateVerifier> verifier,
+    std::chrono::milliseconds timeoutMs = std::chrono::milliseconds(0),
+    const folly::SocketAddress& bindAddr = folly::SocketAddress(),
+    const std::string& serverName = empty_string);
+
+  /**
+   * @returns the number of milliseconds since connecting began, or
+   * zero if connecting hasn't started yet.
+   */
+  std::chrono::milliseconds timeElapsed();
+
+  /**
+   * @returns true iff this connector is busy setting up a session. If
+   * this is false, it is safe to call connect() on it again.
+   */
+  bool isBusy() const {
+    return session_ != nullptr;
+  }
+
+ private:
+  void connectSuccess() override;
+  void onReplaySafe() override;
+  void connectError(
+    std::pair<quic::QuicErrorCode, std::string> error) override;
+
+  Callback* cb_;
+  std::chrono::milliseconds transactionTimeout_;
+  quic::TransportSettings transportSettings_;
+  std::shared_ptr<quic::QuicPskCache> pskCache_;
+  HQUpstreamSession* session_{nullptr};
+  TimePoint connectStart_;
+};
+
+}
@@ -56,6 +56,8 @@ std::string toString(HTTP3::ErrorCode code) {
       return "HTTP: Unexpected frame from client";
     case HTTP3::ErrorCode::HTTP_REQUEST_REJECTED:
       return "HTTP: Server did not process request";
+    case HTTP3::ErrorCode::HTTP_DATAGRAM_ERROR:
+      return "HTTP: Malformed datagram or datagrams not negotiated";
     case HTTP3::ErrorCode::HTTP_QPACK_DECOMPRESSION_FAILED:
       return "HTTP: QPACK decompression failed";
     case HTTP3::ErrorCode::HTTP_QPACK_DECODER_STREAM_ERROR:
@@ -38,6 +38,8 @@ enum ErrorCode : uint16_t {
   HTTP_MISSING_SETTINGS = 0x12,
   HTTP_UNEXPECTED_FRAME = 0x13,
   HTTP_REQUEST_REJECTED = 0x14,
+  // HTTP datagrams (RFC 9297)
+  HTTP_DATAGRAM_ERROR = 0x33,
   HTTP_GENERAL_PROTOCOL_ERROR = 0xFF,
   // Malformed Frames 0x100
   HTTP_MALFORMED_FRAME_DATA = 0x0100,
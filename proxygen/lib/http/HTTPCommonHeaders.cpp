@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/HTTPCommonHeaders.h>
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+using proxygen::HTTPCommonHeaders;
+using proxygen::detail::kHTTPCommonHeaderNames;
+
+static_assert(sizeof(kHTTPCommonHeaderNames) /
+              sizeof(kHTTPCommonHeaderNames[0]) ==
+              HTTPCommonHeaders::num_header_codes,
+              "A name for each header code");
+
+uint64_t loadWord(const char* p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+// Lowercases the 8 ASCII characters of c at once
+uint64_t toLowerAscii64(uint64_t c) {
+  // The high bit of each byte is set for 'A'...'Z' only
+  uint64_t upper = c & 0x7f7f7f7f7f7f7f7fULL;
+  upper += 0x2525252525252525ULL;
+  upper &= 0x7f7f7f7f7f7f7f7fULL;
+  upper += 0x1a1a1a1a1a1a1a1aULL;
+  upper &= ~c;
+  return c + ((upper >> 2) & 0x2020202020202020ULL);
+}
+
+#if defined(__SSE2__)
+bool equalsLowercase16(const char* name, const char* lowercase) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(name));
+  // Bytes >= 0x80 are negative, and never in range
+  __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), v));
+  v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+  __m128i expected =
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(lowercase));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, expected)) == 0xffff;
+}
+#endif
+
+// Whether name, lowercased, is lowercase; both are len long.  Longer names
+// end with a block overlapping the one before it.
+bool equalsLowercase(const char* name, const char* lowercase, size_t len) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  if (len >= 16) {
+    for (; len - i > 16; i += 16) {
+      if (!equalsLowercase16(name + i, lowercase + i)) {
+        return false;
+      }
+    }
+    return equalsLowercase16(name + len - 16, lowercase + len - 16);
+  }
+#endif
+  if (len >= 8) {
+    for (; len - i > 8; i += 8) {
+      if (toLowerAscii64(loadWord(name + i)) != loadWord(lowercase + i)) {
+        return false;
+      }
+    }
+    return toLowerAscii64(loadWord(name + len - 8)) ==
+      loadWord(lowercase + len - 8);
+  }
+  for (; i < len; ++i) {
+    if (proxygen::detail::toLowerAscii(name[i]) != lowercase[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}
+
+namespace proxygen {
+
+HTTPHeaderCode HTTPCommonHeaders::hash(const char* name, size_t len) {
+  uint8_t code = detail::kHTTPCommonHeaderTable.candidate(name, len);
+  const auto& entry = kHTTPCommonHeaderNames[code];
+  if (code == HTTP_HEADER_NONE || entry.length != len ||
+      !equalsLowercase(name, entry.lowercase, len)) {
+    return HTTP_HEADER_OTHER;
+  }
+  return static_cast<HTTPHeaderCode>(code);
+}
+
+std::string* HTTPCommonHeaders::initHeaderNames(
+    HTTPCommonHeaderTableType type) {
+  auto headerNames = new std::string[HTTPCommonHeaders::num_header_codes];
+  for (size_t code = HTTPHeaderCodeCommonOffset;
+       code < HTTPCommonHeaders::num_header_codes; ++code) {
+    const auto& entry = kHTTPCommonHeaderNames[code];
+    headerNames[code] =
+      type == TABLE_LOWERCASE ? entry.lowercase : entry.name;
+  }
+  return headerNames;
+}
+
+const std::string* HTTPCommonHeaders::getPointerToCommonHeaderTable(
+    HTTPCommonHeaderTableType type) {
+  // The actual common header tables are static and initialized here in source
+  // so as to prevent duplicate initializations that could occur through the
+  // use of inline semantics or compilation unit referencing if defined in a
+  // header
+  switch(type) {
+    case TABLE_CAMELCASE:
+      static const std::string* camelcaseTable = initHeaderNames(type);
+      return camelcaseTable;
+    case TABLE_LOWERCASE:
+      static const std::string* lowercaseTable = initHeaderNames(type);
+      return lowercaseTable;
+    default:
+      // Controlled abort here so its clear from a crash stack this method
+      // was called with a table type for which there is no current
+      // implementation
+      CHECK(false);
+      return nullptr;
+  }
+}
+
+} // proxygen
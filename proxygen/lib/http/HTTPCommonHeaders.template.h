@@ -48,6 +48,115 @@ enum HTTPCommonHeaderTableType: uint8_t {
   TABLE_LOWERCASE = 1,
 };
 
+namespace detail {
+
+struct HTTPCommonHeaderName {
+  const char* name;
+  const char* lowercase;
+  size_t length;
+};
+
+/* the following is a placeholder for the build script to generate a list
+ * of names from the list in HTTPCommonHeaders.txt, in the order of their
+ * codes, e.g. {"Content-Length", "content-length", 14},
+ */
+constexpr HTTPCommonHeaderName kHTTPCommonHeaderNames[] = {
+  {"", "", 0},
+  {"", "", 0},
+&&&&&
+};
+
+/**
+ * A perfect hash of the common header names, case insensitively, into a
+ * table of their codes.  Its seed is searched for at compile time, so the
+ * list of names can change freely; the hash reads only the first and last
+ * 8 characters of a name, folded to lowercase, and its length.
+ */
+class HTTPCommonHeaderTable {
+ public:
+  static constexpr size_t kBits = 11;
+  static constexpr size_t kMaxSeeds = 1000;
+
+  constexpr HTTPCommonHeaderTable() :
+      seed_(findSeed()), maxLength_(0), codes_() {
+    for (uint8_t code = HTTPHeaderCodeCommonOffset; code < kNumCodes;
+         ++code) {
+      const auto& entry = kHTTPCommonHeaderNames[code];
+      codes_[slot(entry.name, entry.length, seed_)] = code;
+      if (entry.length > maxLength_) {
+        maxLength_ = entry.length;
+      }
+    }
+  }
+
+  constexpr bool isPerfect() const {
+    return seed_ < kMaxSeeds;
+  }
+
+  // The only code that name may have, or HTTP_HEADER_NONE
+  constexpr uint8_t candidate(const char* name, size_t len) const {
+    return len <= maxLength_ ? codes_[slot(name, len, seed_)] : 0;
+  }
+
+ private:
+  static constexpr size_t kNumCodes =
+    sizeof(kHTTPCommonHeaderNames) / sizeof(kHTTPCommonHeaderNames[0]);
+
+  // Up to 8 characters of name, with the 0x20 bit set in each
+  static constexpr uint64_t foldedWord(const char* name, size_t len) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < len && i < 8; ++i) {
+      word |= uint64_t(static_cast<uint8_t>(name[i]) | 0x20) << (8 * i);
+    }
+    return word;
+  }
+
+  static constexpr size_t slot(const char* name, size_t len, uint64_t seed) {
+    uint64_t h = (foldedWord(name, len) ^ seed) * 0x9e3779b97f4a7c15ULL;
+    if (len > 8) {
+      h ^= (foldedWord(name + len - 8, 8) + len) * 0xc2b2ae3d27d4eb4fULL;
+    }
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h >> (64 - kBits);
+  }
+
+  // The first seed for which no two names share a slot, or kMaxSeeds
+  static constexpr uint64_t findSeed() {
+    uint64_t seed = 0;
+    for (; seed < kMaxSeeds; ++seed) {
+      bool used[1 << kBits] = {};
+      bool perfect = true;
+      for (size_t code = HTTPHeaderCodeCommonOffset;
+           code < kNumCodes && perfect; ++code) {
+        const auto& entry = kHTTPCommonHeaderNames[code];
+        size_t s = slot(entry.name, entry.length, seed);
+        perfect = !used[s];
+        used[s] = true;
+      }
+      if (perfect) {
+        break;
+      }
+    }
+    return seed;
+  }
+
+  uint64_t seed_;
+  size_t maxLength_;
+  uint8_t codes_[1 << kBits];
+};
+
+constexpr HTTPCommonHeaderTable kHTTPCommonHeaderTable;
+static_assert(kHTTPCommonHeaderTable.isPerfect(),
+              "No perfect hash of the common header names found, "
+              "raise HTTPCommonHeaderTable::kBits");
+
+constexpr char toLowerAscii(char c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+} // detail
+
 class HTTPCommonHeaders {
  public:
   // Perfect hash function to match common HTTP header names
@@ -57,6 +166,23 @@ class HTTPCommonHeaders {
     return hash(name.data(), name.length());
   }
 
+  // hash() at compile time, for a string literal
+  template <size_t N>
+  static constexpr HTTPHeaderCode hashLiteral(const char (&name)[N]) {
+    uint8_t code = detail::kHTTPCommonHeaderTable.candidate(name, N - 1);
+    if (code == HTTP_HEADER_NONE ||
+        detail::kHTTPCommonHeaderNames[code].length != N - 1) {
+      return HTTP_HEADER_OTHER;
+    }
+    for (size_t i = 0; i < N - 1; ++i) {
+      if (detail::toLowerAscii(name[i]) !=
+          detail::kHTTPCommonHeaderNames[code].lowercase[i]) {
+        return HTTP_HEADER_OTHER;
+      }
+    }
+    return static_cast<HTTPHeaderCode>(code);
+  }
+
   FB_EXPORT static std::string* initHeaderNames(HTTPCommonHeaderTableType type);
 $$$$$
 
@@ -16,6 +16,7 @@
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/utils/KernelTLS.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 
 
@@ -24,6 +25,35 @@ using namespace std;
 
 namespace proxygen {
 
+namespace {
+// Alternates the address families, starting with the first address's one
+// (RFC8305 section 4)
+std::deque<folly::SocketAddress> interleaveFamilies(
+    const std::vector<folly::SocketAddress>& addrs) {
+  std::deque<folly::SocketAddress> first;
+  std::deque<folly::SocketAddress> others;
+  for (const auto& addr : addrs) {
+    if (addr.getFamily() == addrs.front().getFamily()) {
+      first.push_back(addr);
+    } else {
+      others.push_back(addr);
+    }
+  }
+  std::deque<folly::SocketAddress> interleaved;
+  while (!first.empty() || !others.empty()) {
+    if (!first.empty()) {
+      interleaved.push_back(std::move(first.front()));
+      first.pop_front();
+    }
+    if (!others.empty()) {
+      interleaved.push_back(std::move(others.front()));
+      others.pop_front();
+    }
+  }
+  return interleaved;
+}
+}
+
 HTTPConnector::HTTPConnector(Callback* callback,
     folly::HHWheelTimer* timeoutSet)
     : HTTPConnector(callback, WheelTimerInstance(timeoutSet)) {
@@ -40,6 +70,7 @@ HTTPConnector::~HTTPConnector() {
 }
 
 void HTTPConnector::reset() {
+  cancelAttempts();
   if (socket_) {
     auto cb = cb_;
     cb_ = nullptr;
@@ -56,6 +87,19 @@ void HTTPConnector::setHTTPVersionOverride(bool enabled) {
   httpCodecFactory_->setForceHTTP1xCodecTo1_1(enabled);
 }
 
+void HTTPConnector::setEnableKernelTLS(bool enabled) {
+  enableKernelTLS_ = enabled;
+}
+
+void HTTPConnector::setEnableTCPFastOpen(bool enabled) {
+  enableTCPFastOpen_ = enabled;
+}
+
+void HTTPConnector::setConnectionAttemptDelay(
+    std::chrono::milliseconds delay) {
+  attemptDelay_ = delay;
+}
+
 void HTTPConnector::connect(
   EventBase* eventBase,
   const folly::SocketAddress& connectAddr,
@@ -66,7 +110,11 @@ void HTTPConnector::connect(
   DCHECK(!isBusy());
   transportInfo_ = wangle::TransportInfo();
   transportInfo_.secure = false;
+  fizzParams_.clear();
   auto sock = new AsyncSocket(eventBase);
+  if (enableTCPFastOpen_) {
+    sock->enableTFO();
+  }
   socket_.reset(sock);
   connectStart_ = getCurrentTime();
   sock->connect(this, connectAddr, timeoutMs.count(),
@@ -86,18 +134,216 @@ void HTTPConnector::connectSSL(
   DCHECK(!isBusy());
   transportInfo_ = wangle::TransportInfo();
   transportInfo_.secure = true;
+  fizzParams_.clear();
+  if (enableKernelTLS_ && !enableKernelTLS(*context)) {
+    VLOG(4) << "OpenSSL does not support kernel TLS";
+  }
   auto sslSock = new AsyncSSLSocket(context, eventBase);
   if (session) {
     sslSock->setSSLSession(session, true /* take ownership */);
   }
   sslSock->setServerName(serverName);
   sslSock->forceCacheAddrOnFailure(true);
+  if (enableTCPFastOpen_) {
+    sslSock->enableTFO();
+  }
   socket_.reset(sslSock);
   connectStart_ = getCurrentTime();
   sslSock->connect(this, connectAddr, timeoutMs.count(),
                    socketOptions, bindAddr);
 }
 
+void HTTPConnector::connectFizz(
+  EventBase* eventBase,
+  const folly::SocketAddress& connectAddr,
+  std::shared_ptr<const fizz::client::FizzClientContext> context,
+  std::shared_ptr<const fizz::CertificateVerifier> verifier,
+  std::chrono::milliseconds timeoutMs,
+  const AsyncSocket::OptionMap& socketOptions,
+  const folly::SocketAddress& bindAddr,
+  const std::string& serverName,
+  const std::string& pskIdentity) {
+
+  DCHECK(!isBusy());
+  CHECK(context);
+  transportInfo_ = wangle::TransportInfo();
+  transportInfo_.secure = true;
+  fizzParams_ = FizzParams{std::move(context), std::move(verifier), serverName,
+                           pskIdentity.empty() ? serverName : pskIdentity,
+                           timeoutMs};
+  fizzHandshakeStarted_ = false;
+  // The handshake starts once connected, in the SYN with TCP Fast Open
+  auto sock = new AsyncSocket(eventBase);
+  if (enableTCPFastOpen_) {
+    sock->enableTFO();
+  }
+  socket_.reset(sock);
+  connectStart_ = getCurrentTime();
+  sock->connect(this, connectAddr, timeoutMs.count(),
+                socketOptions, bindAddr);
+}
+
+void HTTPConnector::startFizzHandshake() {
+  fizzHandshakeStarted_ = true;
+  auto client = new fizz::client::AsyncFizzClient(std::move(socket_),
+                                                  fizzParams_->context);
+  // Only requests safe to replay are sent as early data, see
+  // HTTPSession::sendHeaders()
+  client->setEarlyDataRejectionPolicy(
+    fizz::client::EarlyDataRejectionPolicy::AutomaticResend);
+  socket_.reset(client);
+  folly::Optional<std::string> sni;
+  folly::Optional<std::string> pskIdentity;
+  if (!fizzParams_->serverName.empty()) {
+    sni = fizzParams_->serverName;
+  }
+  if (!fizzParams_->pskIdentity.empty()) {
+    pskIdentity = fizzParams_->pskIdentity;
+  }
+  client->connect(this, fizzParams_->verifier, std::move(sni),
+                  std::move(pskIdentity), fizzParams_->timeout);
+}
+
+void HTTPConnector::connect(
+  EventBase* eventBase,
+  const std::vector<folly::SocketAddress>& connectAddrs,
+  std::chrono::milliseconds timeoutMs,
+  const AsyncSocket::OptionMap& socketOptions,
+  const folly::SocketAddress& bindAddr) {
+
+  DCHECK(!isBusy());
+  transportInfo_ = wangle::TransportInfo();
+  transportInfo_.secure = false;
+  fizzParams_.clear();
+  startAttempts(connectAddrs,
+                [this, eventBase] {
+                  auto sock = new AsyncSocket(eventBase);
+                  if (enableTCPFastOpen_) {
+                    sock->enableTFO();
+                  }
+                  return sock;
+                },
+                timeoutMs, socketOptions, bindAddr);
+}
+
+void HTTPConnector::connectSSL(
+  EventBase* eventBase,
+  const std::vector<folly::SocketAddress>& connectAddrs,
+  const shared_ptr<SSLContext>& context,
+  SSL_SESSION* session,
+  std::chrono::milliseconds timeoutMs,
+  const AsyncSocket::OptionMap& socketOptions,
+  const folly::SocketAddress& bindAddr,
+  const std::string& serverName) {
+
+  DCHECK(!isBusy());
+  transportInfo_ = wangle::TransportInfo();
+  transportInfo_.secure = true;
+  fizzParams_.clear();
+  if (enableKernelTLS_ && !enableKernelTLS(*context)) {
+    VLOG(4) << "OpenSSL does not support kernel TLS";
+  }
+  // Each attempt takes a reference to the session
+  attemptSSLSession_.reset(session);
+  startAttempts(connectAddrs,
+                [this, eventBase, context, serverName] {
+                  auto sslSock = new AsyncSSLSocket(context, eventBase);
+                  if (attemptSSLSession_) {
+                    SSL_SESSION_up_ref(attemptSSLSession_.get());
+                    sslSock->setSSLSession(attemptSSLSession_.get(),
+                                           true /* take ownership */);
+                  }
+                  sslSock->setServerName(serverName);
+                  sslSock->forceCacheAddrOnFailure(true);
+                  if (enableTCPFastOpen_) {
+                    sslSock->enableTFO();
+                  }
+                  return sslSock;
+                },
+                timeoutMs, socketOptions, bindAddr);
+}
+
+void HTTPConnector::startAttempts(
+  const std::vector<folly::SocketAddress>& connectAddrs,
+  std::function<folly::AsyncSocket*()> makeSocket,
+  std::chrono::milliseconds timeoutMs,
+  const AsyncSocket::OptionMap& socketOptions,
+  const folly::SocketAddress& bindAddr) {
+
+  CHECK(!connectAddrs.empty());
+  pendingAddrs_ = interleaveFamilies(connectAddrs);
+  makeSocket_ = std::move(makeSocket);
+  attemptTimeout_ = timeoutMs;
+  attemptSocketOptions_ = socketOptions;
+  attemptBindAddr_ = bindAddr;
+  connectStart_ = getCurrentTime();
+  startNextAttempt();
+}
+
+void HTTPConnector::startNextAttempt() {
+  attemptDelayTimeout_.cancelTimeout();
+  if (pendingAddrs_.empty()) {
+    return;
+  }
+  auto addr = std::move(pendingAddrs_.front());
+  pendingAddrs_.pop_front();
+  attempts_.push_back(std::make_unique<ConnectAttempt>(this, makeSocket_()));
+  auto attempt = attempts_.back().get();
+  VLOG(4) << "Connecting to " << addr << ", attempts=" << attempts_.size();
+  if (!pendingAddrs_.empty()) {
+    timeout_.scheduleTimeout(&attemptDelayTimeout_, attemptDelay_);
+  }
+  // The attempt, and even this connector, may end within connect()
+  folly::DelayedDestruction::DestructorGuard dg(attempt->socket_.get());
+  attempt->socket_->connect(attempt, addr, attemptTimeout_.count(),
+                            attemptSocketOptions_, attemptBindAddr_);
+}
+
+void HTTPConnector::ConnectAttempt::connectSuccess() noexcept {
+  // Deletes this
+  connector_->attemptSucceeded(this);
+}
+
+void HTTPConnector::ConnectAttempt::connectErr(
+    const AsyncSocketException& ex) noexcept {
+  if (connector_) {
+    // Deletes this
+    connector_->attemptFailed(this, ex);
+  }
+}
+
+void HTTPConnector::attemptSucceeded(ConnectAttempt* attempt) noexcept {
+  socket_ = std::move(attempt->socket_);
+  cancelAttempts();
+  connectSuccess();
+}
+
+void HTTPConnector::attemptFailed(ConnectAttempt* attempt,
+                                  const AsyncSocketException& ex) noexcept {
+  VLOG(4) << "Connect attempt failed: " << ex.what();
+  attempts_.remove_if([attempt] (const std::unique_ptr<ConnectAttempt>& a) {
+      return a.get() == attempt;
+    });
+  if (!pendingAddrs_.empty()) {
+    // Do not wait for the delay after a failure
+    startNextAttempt();
+  } else if (attempts_.empty()) {
+    attemptSSLSession_.reset();
+    connectErr(ex);
+  }
+}
+
+void HTTPConnector::cancelAttempts() {
+  attemptDelayTimeout_.cancelTimeout();
+  pendingAddrs_.clear();
+  attemptSSLSession_.reset();
+  // Destroying the sockets invokes connectErr(), which is ignored
+  for (auto& attempt : attempts_) {
+    attempt->connector_ = nullptr;
+  }
+  attempts_.clear();
+}
+
 std::chrono::milliseconds HTTPConnector::timeElapsed() {
   if (timePointInitialized(connectStart_)) {
     return millisecondsSince(connectStart_);
@@ -111,6 +357,10 @@ void HTTPConnector::connectSuccess() noexcept {
   if (!cb_) {
     return;
   }
+  if (fizzParams_ && !fizzHandshakeStarted_) {
+    startFizzHandshake();
+    return;
+  }
 
   folly::SocketAddress localAddress;
   folly::SocketAddress peerAddress;
@@ -134,6 +384,25 @@ void HTTPConnector::connectSuccess() noexcept {
         nullptr;
       transportInfo_.sslVersion = sslSocket->getSSLVersion();
       transportInfo_.sslResume = wangle::SSLUtil::getResumeState(sslSocket);
+      if (enableKernelTLS_ && onKernelTLSHandshake(*sslSocket)) {
+        VLOG(4) << "TLS records are encrypted by the kernel";
+      }
+    }
+    auto fizzClient =
+      socket_->getUnderlyingTransport<fizz::client::AsyncFizzClient>();
+    if (fizzClient) {
+      transportInfo_.appProtocol =
+          std::make_shared<std::string>(socket_->getApplicationProtocol());
+      transportInfo_.sslSetupTime = millisecondsSince(connectStart_);
+      auto cipher = fizzClient->getCipher();
+      if (cipher) {
+        transportInfo_.sslCipher =
+          std::make_shared<std::string>(fizz::toString(*cipher));
+      }
+      transportInfo_.sslResume = fizzClient->pskResumed() ?
+        wangle::SSLResumeEnum::RESUMPTION_TICKET :
+        wangle::SSLResumeEnum::HANDSHAKE;
+      VLOG(4) << "fizz connected, replay safe=" << fizzClient->isReplaySafe();
     }
 
     protoCopy = socket_->getApplicationProtocol();
@@ -159,6 +428,9 @@ void HTTPConnector::connectSuccess() noexcept {
     timeout_,
     std::move(socket_), localAddress, peerAddress,
     std::move(codec), transportInfo_, nullptr);
+  if (fizzParams_) {
+    session->setHoldUnsafeRequestsUntilReplaySafe(true);
+  }
 
   cb_->connectSuccess(session);
 }
@@ -170,4 +442,16 @@ void HTTPConnector::connectErr(const AsyncSocketException& ex) noexcept {
   }
 }
 
+void HTTPConnector::fizzHandshakeSuccess(
+    fizz::client::AsyncFizzClient*) noexcept {
+  // With early data this is before the handshake completes
+  connectSuccess();
+}
+
+void HTTPConnector::fizzHandshakeError(
+    fizz::client::AsyncFizzClient*, folly::exception_wrapper ex) noexcept {
+  connectErr(AsyncSocketException(AsyncSocketException::SSL_ERROR,
+                                  ex.what().toStdString()));
+}
+
 }
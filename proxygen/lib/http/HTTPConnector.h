@@ -9,14 +9,18 @@
  */
 #pragma once
 
+#include <fizz/client/AsyncFizzClient.h>
 #include <wangle/acceptor/TransportInfo.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <proxygen/lib/utils/Time.h>
 #include <folly/io/async/AsyncSocket.h>
+#include <folly/ssl/OpenSSLPtrTypes.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/DefaultHTTPCodecFactory.h>
+#include <deque>
+#include <list>
 
 namespace proxygen {
 
@@ -29,7 +33,8 @@ extern const std::string empty_string;
  * service setting up one connection at a time.
  */
 class HTTPConnector:
-      protected folly::AsyncSocket::ConnectCallback {
+      protected folly::AsyncSocket::ConnectCallback,
+      private fizz::client::AsyncFizzClient::HandshakeCallback {
  public:
   /**
    * This class defines the pure virtual interface on which to receive the
@@ -83,6 +88,26 @@ class HTTPConnector:
    */
   void setHTTPVersionOverride(bool enabled);
 
+  /**
+   * Has the kernel encrypt the records of the sessions connectSSL()
+   * establishes, when it and OpenSSL support it.  See KernelTLS.h; this
+   * changes the contexts passed to connectSSL().
+   */
+  void setEnableKernelTLS(bool enabled);
+
+  /**
+   * Sends the first bytes of the connections, e.g. the TLS ClientHello, in
+   * the SYN when the kernel holds a TCP Fast Open cookie for the server.
+   */
+  void setEnableTCPFastOpen(bool enabled);
+
+  /**
+   * How long the connects to several addresses wait for an attempt before
+   * starting the next one (the Connection Attempt Delay of RFC8305), 250ms
+   * by default.
+   */
+  void setConnectionAttemptDelay(std::chrono::milliseconds delay);
+
   /**
    * Begin the process of getting a plaintext connection to the server
    * specified by 'connectAddr'. This function immediately starts async
@@ -132,6 +157,85 @@ class HTTPConnector:
     folly::AsyncSocket::anyAddress(),
     const std::string& serverName = empty_string);
 
+  /**
+   * Begin the process of getting a plaintext connection to one of the
+   * addresses of a server, racing attempts as RFC8305 (happy eyeballs)
+   * describes.  The addresses are tried alternating between IPv6 and IPv4,
+   * starting with the family of the first one, and an attempt starts once
+   * the previous one failed or the connection attempt delay passed.  The
+   * first connection established wins and the others are cancelled;
+   * connectError() reports the last error if all of them fail.
+   *
+   * The parameters are those of connect() above; timeoutMs applies to each
+   * attempt, and bindAddr must match all the address families if set.
+   */
+  void connect(
+    folly::EventBase* eventBase,
+    const std::vector<folly::SocketAddress>& connectAddrs,
+    std::chrono::milliseconds timeoutMs = std::chrono::milliseconds(0),
+    const folly::AsyncSocket::OptionMap& socketOptions =
+      folly::AsyncSocket::emptyOptionMap,
+    const folly::SocketAddress& bindAddr =
+      folly::AsyncSocket::anyAddress());
+
+  /**
+   * Begin the process of getting a secure connection to one of the
+   * addresses of a server, racing the attempts, including their handshakes,
+   * as the plaintext connect() to several addresses does.  The parameters
+   * are those of connectSSL() above.
+   */
+  void connectSSL(
+    folly::EventBase* eventBase,
+    const std::vector<folly::SocketAddress>& connectAddrs,
+    const std::shared_ptr<folly::SSLContext>& ctx,
+    SSL_SESSION* session = nullptr,
+    std::chrono::milliseconds timeoutMs = std::chrono::milliseconds(0),
+    const folly::AsyncSocket::OptionMap& socketOptions =
+      folly::AsyncSocket::emptyOptionMap,
+    const folly::SocketAddress& bindAddr =
+    folly::AsyncSocket::anyAddress(),
+    const std::string& serverName = empty_string);
+
+  /**
+   * Begin the process of getting a TLS 1.3 connection to the server
+   * specified by 'connectAddr', with fizz. This function immediately starts
+   * async work and may invoke functions on Callback immediately.
+   *
+   * When the context sends early data and holds a PSK for the server (see
+   * PersistentFizzPskCache), connectSuccess() is invoked before the
+   * handshake completes, so that the first requests are sent as early data.
+   * The session is then not replay safe until the handshake completes: it
+   * holds requests whose method is not safe until then (see
+   * HTTPSession::setHoldUnsafeRequestsUntilReplaySafe()), and
+   * HTTPTransaction::addWaitingForReplaySafety() notifies the handlers that
+   * need a replay safe transport.
+   *
+   * @param eventBase The event base to put events on.
+   * @param connectAddr The address to connect to.
+   * @param context Fizz client context to use. Must not be null.
+   * @param verifier Optional verifier of the server certificates.
+   * @param timeoutMs Optional. If this value is greater than zero, then a
+   *                  connect error will be given if no connection is
+   *                  established within this amount of time.
+   * @param socketOptions Optional socket options to set on the connection.
+   * @param bindAddr Optional address to bind to locally.
+   * @param serverName Optional server name to send, also the identity of
+   *                   the cached PSK unless pskIdentity is set.
+   * @param pskIdentity Optional identity of the cached PSK.
+   */
+  void connectFizz(
+    folly::EventBase* eventBase,
+    const folly::SocketAddress& connectAddr,
+    std::shared_ptr<const fizz::client::FizzClientContext> context,
+    std::shared_ptr<const fizz::CertificateVerifier> verifier = nullptr,
+    std::chrono::milliseconds timeoutMs = std::chrono::milliseconds(0),
+    const folly::AsyncSocket::OptionMap& socketOptions =
+      folly::AsyncSocket::emptyOptionMap,
+    const folly::SocketAddress& bindAddr =
+    folly::AsyncSocket::anyAddress(),
+    const std::string& serverName = empty_string,
+    const std::string& pskIdentity = empty_string);
+
   /**
    * @returns the number of milliseconds since connecting began, or
    * zero if connecting hasn't started yet.
@@ -142,7 +246,7 @@ class HTTPConnector:
    * @returns true iff this connector is busy setting up a connection. If
    * this is false, it is safe to call connect() or connectSSL() on it again.
    */
-  bool isBusy() const { return socket_.get(); }
+  bool isBusy() const { return socket_.get() || !attempts_.empty(); }
 
   void setHTTPCodecFactory(std::unique_ptr<DefaultHTTPCodecFactory> factory) {
     httpCodecFactory_ = std::move(factory);
@@ -153,6 +257,12 @@ class HTTPConnector:
   void connectErr(const folly::AsyncSocketException& ex)
     noexcept override;
 
+  void fizzHandshakeSuccess(
+    fizz::client::AsyncFizzClient* client) noexcept override;
+  void fizzHandshakeError(
+    fizz::client::AsyncFizzClient* client,
+    folly::exception_wrapper ex) noexcept override;
+
 
   Callback* cb_;
   WheelTimerInstance timeout_;
@@ -161,6 +271,71 @@ class HTTPConnector:
   std::string plaintextProtocol_;
   TimePoint connectStart_;
   std::unique_ptr<DefaultHTTPCodecFactory> httpCodecFactory_;
+  bool enableKernelTLS_{false};
+  bool enableTCPFastOpen_{false};
+
+  // The handshake connectFizz() starts once connected
+  struct FizzParams {
+    std::shared_ptr<const fizz::client::FizzClientContext> context;
+    std::shared_ptr<const fizz::CertificateVerifier> verifier;
+    std::string serverName;
+    std::string pskIdentity;
+    std::chrono::milliseconds timeout;
+  };
+  folly::Optional<FizzParams> fizzParams_;
+  bool fizzHandshakeStarted_{false};
+
+ private:
+  // One of the connections the connects to several addresses race
+  class ConnectAttempt : public folly::AsyncSocket::ConnectCallback {
+   public:
+    ConnectAttempt(HTTPConnector* connector, folly::AsyncSocket* socket)
+        : connector_(connector), socket_(socket) {}
+
+    void connectSuccess() noexcept override;
+    void connectErr(const folly::AsyncSocketException& ex)
+      noexcept override;
+
+    HTTPConnector* connector_;
+    folly::AsyncSocket::UniquePtr socket_;
+  };
+
+  class AttemptDelayTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit AttemptDelayTimeout(HTTPConnector* connector)
+        : connector_(connector) {}
+
+    void timeoutExpired() noexcept override {
+      connector_->startNextAttempt();
+    }
+
+   private:
+    HTTPConnector* connector_;
+  };
+
+  void startFizzHandshake();
+
+  void startAttempts(
+    const std::vector<folly::SocketAddress>& connectAddrs,
+    std::function<folly::AsyncSocket*()> makeSocket,
+    std::chrono::milliseconds timeoutMs,
+    const folly::AsyncSocket::OptionMap& socketOptions,
+    const folly::SocketAddress& bindAddr);
+  void startNextAttempt();
+  void attemptSucceeded(ConnectAttempt* attempt) noexcept;
+  void attemptFailed(ConnectAttempt* attempt,
+                     const folly::AsyncSocketException& ex) noexcept;
+  void cancelAttempts();
+
+  std::chrono::milliseconds attemptDelay_{250};
+  AttemptDelayTimeout attemptDelayTimeout_{this};
+  std::list<std::unique_ptr<ConnectAttempt>> attempts_;
+  std::deque<folly::SocketAddress> pendingAddrs_;
+  std::function<folly::AsyncSocket*()> makeSocket_;
+  std::chrono::milliseconds attemptTimeout_{0};
+  folly::AsyncSocket::OptionMap attemptSocketOptions_;
+  folly::SocketAddress attemptBindAddr_;
+  folly::ssl::SSLSessionUniquePtr attemptSSLSession_;
 };
 
 }
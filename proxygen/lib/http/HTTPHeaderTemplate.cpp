@@ -0,0 +1,72 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/HTTPHeaderTemplate.h>
+
+#include <glog/logging.h>
+
+namespace proxygen {
+
+bool HTTPHeaderTemplate::isTemplatable(HTTPHeaderCode code) {
+  if (HTTPHeaders::perHopHeaderCodes()[code]) {
+    return false;
+  }
+  switch (code) {
+    case HTTP_HEADER_NONE:
+    case HTTP_HEADER_CONTENT_LENGTH:
+    case HTTP_HEADER_DATE:
+    case HTTP_HEADER_SEC_WEBSOCKET_KEY:
+    case HTTP_HEADER_SEC_WEBSOCKET_ACCEPT:
+      return false;
+    default:
+      return true;
+  }
+}
+
+std::shared_ptr<const HTTPHeaderTemplate> HTTPHeaderTemplate::create(
+    const HTTPHeaders& headers) {
+  bool valid = true;
+  headers.forEachWithCode([&] (HTTPHeaderCode code,
+                               const std::string& name,
+                               const std::string& /*value*/) {
+    if (!isTemplatable(code)) {
+      VLOG(2) << "Header cannot be part of a template: " << name;
+      valid = false;
+    }
+  });
+  if (!valid) {
+    return nullptr;
+  }
+  return std::shared_ptr<const HTTPHeaderTemplate>(
+    new HTTPHeaderTemplate(headers));
+}
+
+HTTPHeaderTemplate::HTTPHeaderTemplate(const HTTPHeaders& headers) {
+  size_t len = 0;
+  headers.forEach([&] (const std::string& name, const std::string& value) {
+    len += name.size() + value.size() + 4; // 4 for ": " + CRLF
+  });
+  http1xBlock_ = folly::IOBuf::create(len);
+  char* dst = reinterpret_cast<char*>(http1xBlock_->writableTail());
+  headers.forEach([&] (const std::string& name, const std::string& value) {
+    memcpy(dst, name.data(), name.size());
+    dst += name.size();
+    *dst++ = ':';
+    *dst++ = ' ';
+    memcpy(dst, value.data(), value.size());
+    dst += value.size();
+    *dst++ = '\r';
+    *dst++ = '\n';
+  });
+  http1xBlock_->append(len);
+  DCHECK_EQ(dst, reinterpret_cast<const char*>(http1xBlock_->tail()));
+  headers.copyTo(headers_);
+}
+
+}
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <proxygen/lib/http/HTTPHeaders.h>
+
+namespace proxygen {
+
+/**
+ * An immutable set of headers that many messages share, e.g. the Server,
+ * Content-Type and Cache-Control headers of a given endpoint's responses.
+ *
+ * Attach one to an HTTPMessage with setHeaderTemplate().  The template's
+ * headers are emitted before the message's own headers.  HTTP/1.x codecs
+ * write the pre-rendered block (see getHTTP1xBlock()) as a shared IOBuf
+ * instead of serializing each header; other codecs see the headers merged
+ * into the message.
+ *
+ * Headers that codecs generate or rewrite per message (framing, per-hop,
+ * Date and websocket handshake headers) cannot be part of a template.
+ */
+class HTTPHeaderTemplate {
+ public:
+  /**
+   * Returns nullptr if any of the headers may not be templated.
+   */
+  static std::shared_ptr<const HTTPHeaderTemplate> create(
+    const HTTPHeaders& headers);
+
+  static bool isTemplatable(HTTPHeaderCode code);
+
+  const HTTPHeaders& getHeaders() const {
+    return headers_;
+  }
+
+  /**
+   * The headers rendered as "Name: value\r\n" lines.  Callers should append
+   * a clone, which marks the buffer shared so it is never written into.
+   */
+  const folly::IOBuf& getHTTP1xBlock() const {
+    return *http1xBlock_;
+  }
+
+ private:
+  explicit HTTPHeaderTemplate(const HTTPHeaders& headers);
+
+  HTTPHeaders headers_;
+  std::unique_ptr<folly::IOBuf> http1xBlock_;
+};
+
+}
@@ -44,15 +44,19 @@ bitset<256>& HTTPHeaders::perHopHeaderCodes() {
 
 HTTPHeaders::HTTPHeaders() :
   deletedCount_(0) {
-  codes_.reserve(kInitialVectorReserve);
-  headerNames_.reserve(kInitialVectorReserve);
-  headerValues_.reserve(kInitialVectorReserve);
 }
 
 void HTTPHeaders::add(folly::StringPiece name, folly::StringPiece value) {
   CHECK(name.size());
-  const HTTPHeaderCode code = HTTPCommonHeaders::hash(name.data(), name.size());
+  addWithCode(HTTPCommonHeaders::hash(name.data(), name.size()), name, value);
+}
+
+void HTTPHeaders::addWithCode(HTTPHeaderCode code,
+                              folly::StringPiece name,
+                              folly::StringPiece value) {
+  DCHECK_EQ(code, HTTPCommonHeaders::hash(name.data(), name.size()));
   codes_.push_back(code);
+  present_.set(code);
   headerNames_.push_back((code == HTTP_HEADER_OTHER)
       ? new std::string(name.data(), name.size())
       : HTTPCommonHeaders::getPointerToHeaderName(code));
@@ -74,14 +78,17 @@ void HTTPHeaders::rawAdd(const std::string& name, const std::string& value) {
   add(name, value);
 }
 
-void HTTPHeaders::addFromCodec(const char* str, size_t len, string&& value) {
+HTTPHeaderCode HTTPHeaders::addFromCodec(const char* str, size_t len,
+                                         folly::StringPiece value) {
   const HTTPHeaderCode code = HTTPCommonHeaders::hash(str, len);
   codes_.push_back(code);
+  present_.set(code);
   headerNames_.push_back((code == HTTP_HEADER_OTHER)
       ? new string(str, len)
       : HTTPCommonHeaders::getPointerToHeaderName(code));
-  headerValues_.emplace_back(
-      folly::rtrimWhitespace(std::move(value)).toString());
+  value = folly::rtrimWhitespace(value);
+  headerValues_.emplace_back(value.data(), value.size());
+  return code;
 }
 
 bool HTTPHeaders::exists(folly::StringPiece name) const {
@@ -96,8 +103,8 @@ bool HTTPHeaders::exists(folly::StringPiece name) const {
 }
 
 bool HTTPHeaders::exists(HTTPHeaderCode code) const {
-  if (codes_.data() == nullptr) {
-      return false;
+  if (!present_[code]) {
+    return false;
   }
   return memchr((void*)codes_.data(), code, codes_.size()) != nullptr;
 }
@@ -144,6 +151,7 @@ bool HTTPHeaders::remove(HTTPHeaderCode code) {
     removed = true;
     ++deletedCount_;
   });
+  present_.reset(code);
   return removed;
 }
 
@@ -178,6 +186,7 @@ HTTPHeaders::HTTPHeaders(const HTTPHeaders& hdrs) :
   codes_(hdrs.codes_),
   headerNames_(hdrs.headerNames_),
   headerValues_(hdrs.headerValues_),
+  present_(hdrs.present_),
   deletedCount_(hdrs.deletedCount_) {
   for (size_t i = 0; i < codes_.size(); ++i) {
     if (codes_[i] == HTTP_HEADER_OTHER) {
@@ -190,8 +199,10 @@ HTTPHeaders::HTTPHeaders(HTTPHeaders&& hdrs) noexcept :
     codes_(std::move(hdrs.codes_)),
     headerNames_(std::move(hdrs.headerNames_)),
     headerValues_(std::move(hdrs.headerValues_)),
+    present_(hdrs.present_),
     deletedCount_(hdrs.deletedCount_) {
-  hdrs.removeAll();
+  // Inline elements are moved rather than stolen, the names now belong to us
+  hdrs.clearMovedFrom();
 }
 
 HTTPHeaders& HTTPHeaders::operator= (const HTTPHeaders& hdrs) {
@@ -200,6 +211,7 @@ HTTPHeaders& HTTPHeaders::operator= (const HTTPHeaders& hdrs) {
     codes_ = hdrs.codes_;
     headerNames_ = hdrs.headerNames_;
     headerValues_ = hdrs.headerValues_;
+    present_ = hdrs.present_;
     deletedCount_ = hdrs.deletedCount_;
     for (size_t i = 0; i < codes_.size(); ++i) {
       if (codes_[i] == HTTP_HEADER_OTHER) {
@@ -212,12 +224,14 @@ HTTPHeaders& HTTPHeaders::operator= (const HTTPHeaders& hdrs) {
 
 HTTPHeaders& HTTPHeaders::operator= (HTTPHeaders&& hdrs) {
   if (this != &hdrs) {
+    disposeOfHeaderNames();
     codes_ = std::move(hdrs.codes_);
     headerNames_ = std::move(hdrs.headerNames_);
     headerValues_ = std::move(hdrs.headerValues_);
+    present_ = hdrs.present_;
     deletedCount_ = hdrs.deletedCount_;
 
-    hdrs.removeAll();
+    hdrs.clearMovedFrom();
   }
 
   return *this;
@@ -229,6 +243,15 @@ void HTTPHeaders::removeAll() {
   codes_.clear();
   headerNames_.clear();
   headerValues_.clear();
+  present_.reset();
+  deletedCount_ = 0;
+}
+
+void HTTPHeaders::clearMovedFrom() {
+  codes_.clear();
+  headerNames_.clear();
+  headerValues_.clear();
+  present_.reset();
   deletedCount_ = 0;
 }
 
@@ -245,6 +268,7 @@ HTTPHeaders::transferHeaderIfPresent(folly::StringPiece name,
   if (code == HTTP_HEADER_OTHER) {
     ITERATE_OVER_STRINGS(name, {
       strippedHeaders.codes_.push_back(HTTP_HEADER_OTHER);
+      strippedHeaders.present_.set(HTTP_HEADER_OTHER);
       // in the next line, ownership of pointer goes to strippedHeaders
       strippedHeaders.headerNames_.push_back(headerNames_[pos]);
       strippedHeaders.headerValues_.push_back(headerValues_[pos]);
@@ -255,6 +279,7 @@ HTTPHeaders::transferHeaderIfPresent(folly::StringPiece name,
   } else { // code != HTTP_HEADER_OTHER
     ITERATE_OVER_CODES(code, {
       strippedHeaders.codes_.push_back(code);
+      strippedHeaders.present_.set(code);
       strippedHeaders.headerNames_.push_back(headerNames_[pos]);
       strippedHeaders.headerValues_.push_back(headerValues_[pos]);
       codes_[pos] = HTTP_HEADER_NONE;
@@ -316,6 +341,7 @@ HTTPHeaders::stripPerHopHeaders(HTTPHeaders& strippedHeaders) {
   for (size_t i = 0; i < codes_.size(); ++i) {
     if (perHopHeaders[codes_[i]]) {
       strippedHeaders.codes_.push_back(codes_[i]);
+      strippedHeaders.present_.set(codes_[i]);
       strippedHeaders.headerNames_.push_back(headerNames_[i]);
       strippedHeaders.headerValues_.push_back(headerValues_[i]);
       codes_[i] = HTTP_HEADER_NONE;
@@ -329,6 +355,7 @@ void HTTPHeaders::copyTo(HTTPHeaders& hdrs) const {
   for (size_t i = 0; i < codes_.size(); ++i) {
     if (codes_[i] != HTTP_HEADER_NONE) {
       hdrs.codes_.push_back(codes_[i]);
+      hdrs.present_.set(codes_[i]);
       hdrs.headerNames_.push_back((codes_[i] == HTTP_HEADER_OTHER) ?
           new string(*headerNames_[i]) : headerNames_[i]);
       hdrs.headerValues_.push_back(headerValues_[i]);
@@ -9,9 +9,9 @@
  */
 #pragma once
 
-#include <folly/FBVector.h>
 #include <folly/Range.h>
 #include <folly/String.h>
+#include <folly/small_vector.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <proxygen/lib/utils/Export.h>
 #include <proxygen/lib/utils/UtilInl.h>
@@ -45,11 +45,15 @@ inline bool isLWS(char c) {
  * structure is optimized for real-life header collection sizes.
  *
  * Headers are stored as Name/Value pairs, in the order they are received on
- * the wire. We hash the names of all common HTTP headers (using a static
- * perfect hash function generated using gperf from HTTPCommonHeaders.gperf)
- * into 1-byte hashes (we call them "codes") and only store these. We search
+ * the wire. The first kInlineHeaders of them are stored inline, so a typical
+ * message allocates nothing for its headers beyond values too long for the
+ * string's own small buffer. We hash the names of all common HTTP headers
+ * (using a static perfect hash function built at compile time from
+ * HTTPCommonHeaders.txt) into 1-byte hashes (we call them "codes") and only
+ * store these. We search
  * them using memchr, which has an x86_64 assembly implementation with
- * complexity O(n/16) ;)
+ * complexity O(n/16) ;)  A bitmap of the codes that may be present answers
+ * lookups for absent headers without scanning at all.
  *
  * Instead of creating strings with header names, we point to a static array
  * of strings in HTTPCommonHeaders. If the header name is not in our set of
@@ -111,7 +115,21 @@ class HTTPHeaders {
   void add(headers_initializer_list l);
   void rawAdd(const std::string& name, const std::string& value);
 
-  void addFromCodec(const char* str, size_t len, std::string&& value);
+  /**
+   * Add a header parsed by a codec.  The value is right-trimmed and copied
+   * once, directly from the supplied range.  Returns the header's code, for
+   * the codec to validate it without looking it up again.
+   */
+  HTTPHeaderCode addFromCodec(const char* str, size_t len,
+                              folly::StringPiece value);
+
+  /**
+   * Add a header whose name the caller already hashed to code, with
+   * HTTPCommonHeaders::hash().  The value is copied as is.
+   */
+  void addWithCode(HTTPHeaderCode code,
+                   folly::StringPiece name,
+                   folly::StringPiece value);
 
   /**
    * For the header 'name', set its value to the single header 'value',
@@ -279,25 +297,31 @@ class HTTPHeaders {
    */
   static std::bitset<256>& perHopHeaderCodes();
 
+  /**
+   * Number of headers (including removed ones) held without allocating.
+   */
+  static const size_t kInlineHeaders = 16;
+
  private:
   // vector storing the 1-byte hashes of header names
-  folly::fbvector<HTTPHeaderCode> codes_;
+  folly::small_vector<HTTPHeaderCode, kInlineHeaders> codes_;
 
   /**
    * Vector storing pointers to header names; we own those pointers which
    * correspond to HTTP_HEADER_OTHER codes.
    */
-  folly::fbvector<const std::string *> headerNames_;
-
-  folly::fbvector<std::string> headerValues_;
+  folly::small_vector<const std::string *, kInlineHeaders> headerNames_;
 
-  size_t deletedCount_;
+  folly::small_vector<std::string, kInlineHeaders> headerValues_;
 
   /**
-   * The initial capacity of the three vectors, reserved right after
-   * construction.
+   * Bit c is set if a header with code c may be in codes_.  Set on every
+   * insertion and only cleared when all headers with that code are removed
+   * by code, so it can have false positives but no false negatives.
    */
-  static const size_t kInitialVectorReserve = 16;
+  std::bitset<256> present_;
+
+  size_t deletedCount_;
 
   /**
    * Moves the named header and values from this group to the destination
@@ -308,6 +332,9 @@ class HTTPHeaders {
 
   // deletes the strings in headerNames_ that we own
   void disposeOfHeaderNames();
+
+  // empties the vectors of headers whose names were handed to another object
+  void clearMovedFrom();
 };
 
 // Implementation follows - it has to be in the .h because of the templates
@@ -317,6 +344,7 @@ void HTTPHeaders::add(folly::StringPiece name, T&& value) {
   assert(name.size());
   const HTTPHeaderCode code = HTTPCommonHeaders::hash(name.data(), name.size());
   codes_.push_back(code);
+  present_.set(code);
   headerNames_.push_back((code == HTTP_HEADER_OTHER)
       ? new std::string(name.data(), name.size())
       : HTTPCommonHeaders::getPointerToHeaderName(code));
@@ -327,6 +355,7 @@ void HTTPHeaders::add(folly::StringPiece name, T&& value) {
 template <typename T> // T = string
 void HTTPHeaders::add(HTTPHeaderCode code, T&& value) {
   codes_.push_back(code);
+  present_.set(code);
   headerNames_.push_back(HTTPCommonHeaders::getPointerToHeaderName(code));
   auto s = folly::rtrimWhitespace(std::forward<T>(value));
   headerValues_.emplace_back(s);
@@ -335,7 +364,8 @@ void HTTPHeaders::add(HTTPHeaderCode code, T&& value) {
 // iterate over the positions (in vector) of all headers with given code
 #define ITERATE_OVER_CODES(Code, Block)                               \
   {                                                                   \
-    const HTTPHeaderCode* ptr = codes_.data();                        \
+    const HTTPHeaderCode* ptr =                                       \
+      present_[(Code)] ? codes_.data() : nullptr;                     \
     while (ptr) {                                                     \
       ptr = (HTTPHeaderCode*)memchr(                                  \
           (void*)ptr, (Code), codes_.size() - (ptr - codes_.data())); \
@@ -13,6 +13,8 @@
 #include <folly/Format.h>
 #include <folly/Range.h>
 #include <folly/SingletonThreadLocal.h>
+#include <proxygen/lib/utils/CoarseTime.h>
+#include <proxygen/lib/utils/RecyclingAllocator.h>
 #include <string>
 #include <vector>
 
@@ -62,14 +64,14 @@ void HTTPMessage::stripPerHopHeaders() {
 }
 
 HTTPMessage::HTTPMessage() :
-    startTime_(getCurrentTime()),
+    startTime_(getCoarseTime()),
     seqNo_(-1),
     localIP_(),
     versionStr_("1.0"),
     fields_(),
     version_(1,0),
     sslVersion_(0), sslCipher_(nullptr), protoStr_(nullptr), pri_(0),
-    parsedCookies_(false), parsedQueryParams_(false),
+    parsedQueryParams_(false),
     chunked_(false), upgraded_(false), wantsKeepalive_(true),
     trailersAllowed_(false), secure_(false), partiallyReliable_(false),
     upgradeWebsocket_(HTTPMessage::WebSocketUpgrade::NONE) {
@@ -78,6 +80,31 @@ HTTPMessage::HTTPMessage() :
 HTTPMessage::~HTTPMessage() {
 }
 
+namespace {
+struct MessageTag {};
+}
+
+using MessageFreeList = ThreadLocalFreeList<MessageTag, sizeof(HTTPMessage)>;
+
+void HTTPMessage::setRecycling(bool enabled) {
+  MessageFreeList::enable(enabled);
+}
+
+void* HTTPMessage::operator new(size_t size) {
+  if (size != sizeof(HTTPMessage)) {
+    return ::operator new(size);
+  }
+  return MessageFreeList::allocate();
+}
+
+void HTTPMessage::operator delete(void* p, size_t size) {
+  if (size != sizeof(HTTPMessage)) {
+    ::operator delete(p);
+    return;
+  }
+  MessageFreeList::deallocate(p);
+}
+
 HTTPMessage::HTTPMessage(const HTTPMessage& message) :
     startTime_(message.startTime_),
     seqNo_(message.seqNo_),
@@ -87,17 +114,17 @@ HTTPMessage::HTTPMessage(const HTTPMessage& message) :
     localIP_(message.localIP_),
     versionStr_(message.versionStr_),
     fields_(message.fields_),
-    cookies_(message.cookies_),
     queryParams_(message.queryParams_),
     version_(message.version_),
     headers_(message.headers_),
     strippedPerHopHeaders_(message.strippedPerHopHeaders_),
+    headerTemplate_(message.headerTemplate_),
+    huffmanLiterals_(message.huffmanLiterals_),
     sslVersion_(message.sslVersion_),
     sslCipher_(message.sslCipher_),
     protoStr_(message.protoStr_),
     pri_(message.pri_),
     h2Pri_(message.h2Pri_),
-    parsedCookies_(message.parsedCookies_),
     parsedQueryParams_(message.parsedQueryParams_),
     chunked_(message.chunked_),
     upgraded_(message.upgraded_),
@@ -120,18 +147,18 @@ HTTPMessage::HTTPMessage(HTTPMessage&& message) noexcept :
     localIP_(std::move(message.localIP_)),
     versionStr_(std::move(message.versionStr_)),
     fields_(std::move(message.fields_)),
-    cookies_(std::move(message.cookies_)),
     queryParams_(std::move(message.queryParams_)),
     version_(message.version_),
     headers_(std::move(message.headers_)),
     strippedPerHopHeaders_(std::move(message.strippedPerHopHeaders_)),
     trailers_(std::move(message.trailers_)),
+    headerTemplate_(std::move(message.headerTemplate_)),
+    huffmanLiterals_(std::move(message.huffmanLiterals_)),
     sslVersion_(message.sslVersion_),
     sslCipher_(message.sslCipher_),
     protoStr_(message.protoStr_),
     pri_(message.pri_),
     h2Pri_(message.h2Pri_),
-    parsedCookies_(message.parsedCookies_),
     parsedQueryParams_(message.parsedQueryParams_),
     chunked_(message.chunked_),
     upgraded_(message.upgraded_),
@@ -154,17 +181,17 @@ HTTPMessage& HTTPMessage::operator=(const HTTPMessage& message) {
   localIP_ = message.localIP_;
   versionStr_ = message.versionStr_;
   fields_ = message.fields_;
-  cookies_ = message.cookies_;
   queryParams_ = message.queryParams_;
   version_ = message.version_;
   headers_ = message.headers_;
   strippedPerHopHeaders_ = message.strippedPerHopHeaders_;
+  headerTemplate_ = message.headerTemplate_;
+  huffmanLiterals_ = message.huffmanLiterals_;
   sslVersion_ = message.sslVersion_;
   sslCipher_ = message.sslCipher_;
   protoStr_ = message.protoStr_;
   pri_ = message.pri_;
   h2Pri_ = message.h2Pri_;
-  parsedCookies_ = message.parsedCookies_;
   parsedQueryParams_ = message.parsedQueryParams_;
   chunked_ = message.chunked_;
   upgraded_ = message.upgraded_;
@@ -193,17 +220,17 @@ HTTPMessage& HTTPMessage::operator=(HTTPMessage&& message) {
   localIP_ = std::move(message.localIP_);
   versionStr_ = std::move(message.versionStr_);
   fields_ = std::move(message.fields_);
-  cookies_ = std::move(message.cookies_);
   queryParams_ = std::move(message.queryParams_);
   version_ = message.version_;
   headers_ = std::move(message.headers_);
   strippedPerHopHeaders_ = std::move(message.strippedPerHopHeaders_);
+  headerTemplate_ = std::move(message.headerTemplate_);
+  huffmanLiterals_ = std::move(message.huffmanLiterals_);
   sslVersion_ = message.sslVersion_;
   sslCipher_ = message.sslCipher_;
   protoStr_ = message.protoStr_;
   pri_ = message.pri_;
   h2Pri_ = message.h2Pri_;
-  parsedCookies_ = message.parsedCookies_;
   parsedQueryParams_ = message.parsedQueryParams_;
   chunked_ = message.chunked_;
   upgraded_ = message.upgraded_;
@@ -216,6 +243,17 @@ HTTPMessage& HTTPMessage::operator=(HTTPMessage&& message) {
   return *this;
 }
 
+void HTTPMessage::applyHeaderTemplate() {
+  if (!headerTemplate_) {
+    return;
+  }
+  HTTPHeaders merged;
+  headerTemplate_->getHeaders().copyTo(merged);
+  headers_.copyTo(merged);
+  headers_ = std::move(merged);
+  headerTemplate_.reset();
+}
+
 void HTTPMessage::setMethod(HTTPMethod method) {
   Request& req = request();
   req.method_ = method;
@@ -303,7 +341,7 @@ struct FormattedDate {
   time_t lastTime{0};
   string date;
 
-  string formatDate() {
+  const string& formatDate() {
     const auto now = std::chrono::system_clock::to_time_t(
       std::chrono::system_clock::now());
 
@@ -312,8 +350,10 @@ struct FormattedDate {
       tm timeTupple;
       gmtime_r(&now, &timeTupple);
 
-      strftime(buff, 1024, "%a, %d %b %Y %H:%M:%S %Z", &timeTupple);
-      date = std::string(buff);
+      auto len = strftime(buff, 1024, "%a, %d %b %Y %H:%M:%S %Z",
+                          &timeTupple);
+      // same length every second, so this does not reallocate
+      date.assign(buff, len);
       lastTime = now;
     }
     return date;
@@ -321,7 +361,7 @@ struct FormattedDate {
 };
 }
 
-string HTTPMessage::formatDateHeader() {
+const string& HTTPMessage::formatDateHeader() {
   struct DateTag {};
   auto& obj = folly::SingletonThreadLocal<FormattedDate, DateTag>::get();
   return obj.formatDate();
@@ -381,41 +421,15 @@ HTTPMessage::constructDirectResponse(const pair<uint8_t,uint8_t>& version,
   setIsUpgraded(false);
 }
 
-void HTTPMessage::parseCookies() const {
-  DCHECK(!parsedCookies_);
-  parsedCookies_ = true;
-
+const StringPiece HTTPMessage::getCookie(StringPiece name) const {
+  // The first cookie with that name wins
+  Optional<StringPiece> cookie;
   headers_.forEachValueOfHeader(HTTP_HEADER_COOKIE,
                                 [&](const string& headerval) {
-    splitNameValuePieces(headerval, ';', '=',
-        [this](StringPiece cookieName, StringPiece cookieValue) {
-          cookies_.emplace(cookieName, cookieValue);
-        });
-
-    return false; // continue processing "cookie" headers
+    cookie = findNameValuePiece(headerval, ';', '=', name, false);
+    return cookie.hasValue(); // stop at the first header with it
   });
-}
-
-void HTTPMessage::unparseCookies() const {
-  cookies_.clear();
-  parsedCookies_ = false;
-}
-
-const StringPiece HTTPMessage::getCookie(const string& name) const {
- // clear previous parsed cookies.  They might store raw pointers to a vector
-  // in headers_, which can resize on add()
-  // Parse the cookies if we haven't done so yet
-  unparseCookies();
-  if (!parsedCookies_) {
-    parseCookies();
-  }
-
-  auto it = cookies_.find(name);
-  if (it == cookies_.end()) {
-    return StringPiece();
-  } else {
-    return it->second;
-  }
+  return cookie.value_or(StringPiece());
 }
 
 void HTTPMessage::parseQueryParams() const {
@@ -460,8 +474,12 @@ const string* HTTPMessage::getQueryParamPtr(const string& name) const {
   return &it->second;
 }
 
+Optional<StringPiece> HTTPMessage::getQueryParamPiece(StringPiece name) const {
+  return findNameValuePiece(request().query_, '&', '=', name, true);
+}
+
 bool HTTPMessage::hasQueryParam(const string& name) const {
-  return getQueryParamPtr(name) != nullptr;
+  return getQueryParamPiece(name).hasValue();
 }
 
 const string& HTTPMessage::getQueryParam(const string& name) const {
@@ -470,7 +488,7 @@ const string& HTTPMessage::getQueryParam(const string& name) const {
 }
 
 int HTTPMessage::getIntQueryParam(const std::string& name) const {
-  return folly::to<int>(getQueryParam(name));
+  return folly::to<int>(getQueryParamPiece(name).value_or(StringPiece()));
 }
 
 int HTTPMessage::getIntQueryParam(const std::string& name, int defval) const {
@@ -483,7 +501,7 @@ int HTTPMessage::getIntQueryParam(const std::string& name, int defval) const {
 }
 
 std::string HTTPMessage::getDecodedQueryParam(const std::string& name) const {
-  auto val = getQueryParam(name);
+  auto val = getQueryParamPiece(name).value_or(StringPiece());
 
   std::string result;
   try {
@@ -619,6 +637,40 @@ void HTTPMessage::splitNameValuePieces(
   }
 }
 
+Optional<StringPiece> HTTPMessage::findNameValuePiece(StringPiece input,
+                                                     char pairDelim,
+                                                     char valueDelim,
+                                                     StringPiece name,
+                                                     bool last) {
+  // As splitNameValuePieces, comparing the names in place
+  Optional<StringPiece> result;
+  while (!input.empty()) {
+    size_t pairDelimPos = input.find(pairDelim);
+    StringPiece keyValue;
+    if (pairDelimPos == string::npos) {
+      keyValue = input;
+      input.advance(input.size());
+    } else {
+      keyValue = input.subpiece(0, pairDelimPos);
+      input.advance(pairDelimPos + 1);
+    }
+
+    if (keyValue.empty()) {
+      continue;
+    }
+    size_t valueDelimPos = keyValue.find(valueDelim);
+    if (trim(keyValue.subpiece(0, valueDelimPos)) != name) {
+      continue;
+    }
+    result = valueDelimPos == string::npos ?
+      StringPiece() : trim(keyValue.subpiece(valueDelimPos + 1));
+    if (!last) {
+      break;
+    }
+  }
+  return result;
+}
+
 StringPiece HTTPMessage::trim(StringPiece sp) {
   // TODO: use a library function from boost?
   for (; !sp.empty() && sp.front() == ' '; sp.pop_front()) {
@@ -19,6 +19,7 @@
 #include <map>
 #include <mutex>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
+#include <proxygen/lib/http/HTTPHeaderTemplate.h>
 #include <proxygen/lib/http/HTTPHeaders.h>
 #include <proxygen/lib/http/HTTPMethod.h>
 #include <proxygen/lib/utils/ParseURL.h>
@@ -27,6 +28,8 @@
 
 namespace proxygen {
 
+class HuffmanLiterals;
+
 /**
  * An HTTP request or response minus the body.
  *
@@ -52,6 +55,22 @@ class HTTPMessage {
   HTTPMessage& operator=(const HTTPMessage& message);
   HTTPMessage& operator=(HTTPMessage&& message);
 
+  /**
+   * When enabled, the memory of HTTPMessages deleted on a thread is kept on
+   * a free list for the next ones allocated with new on that thread, which
+   * is how codecs create every ingress message.  Headers are stored inline,
+   * so a recycled message comes with room for them too.  Off by default.
+   */
+  static void setRecycling(bool enabled);
+
+  static void* operator new(size_t size);
+  static void operator delete(void* p, size_t size);
+  // operator new above hides the placement form
+  static void* operator new(size_t, void* p) noexcept {
+    return p;
+  }
+  static void operator delete(void*, void*) noexcept {}
+
   // upgradeWebsocket_ can have three states, WebSocketUpgrade::NONE by
   // default. WebSocketUpgrade::INGRESS is used by the codec to indicate a
   // websocket upgrade request was received from downstream or a successful
@@ -183,18 +202,18 @@ class HTTPMessage {
   ParseURL setURL(T&& url) {
     VLOG(9) << "setURL: " << url;
 
-    // Set the URL, path, and query string parameters
-    ParseURL u(url);
+    // Set the URL, path, and query string parameters.  The stored URL is
+    // parsed, so that what is returned refers to it rather than to url.
+    request().url_ = std::forward<T>(url);
+    ParseURL u(request().url_);
     if (u.valid()) {
       VLOG(9) << "set path: " << u.path() << " query:" << u.query();
       request().path_ = u.path().str();
       request().query_ = u.query().str();
       unparseQueryParams();
     } else {
-      VLOG(4) << "Error in parsing URL: " << url;
+      VLOG(4) << "Error in parsing URL: " << request().url_;
     }
-
-    request().url_ = std::forward<T>(url);
     return u;
   }
   // The template function above doesn't work with char*,
@@ -281,6 +300,38 @@ class HTTPMessage {
     return std::move(headers_);
   }
 
+  /**
+   * Attach a shared set of pre-rendered headers that are sent before the
+   * message's own headers (fpres).  See HTTPHeaderTemplate.
+   */
+  void setHeaderTemplate(std::shared_ptr<const HTTPHeaderTemplate> tmpl) {
+    headerTemplate_ = std::move(tmpl);
+  }
+  const std::shared_ptr<const HTTPHeaderTemplate>& getHeaderTemplate() const {
+    return headerTemplate_;
+  }
+
+  /**
+   * Merge the template's headers into this message's headers, ahead of the
+   * existing ones, and detach the template.  Used for codecs that cannot
+   * send pre-rendered header blocks.
+   */
+  void applyHeaderTemplate();
+
+  /**
+   * The Huffman encoded literals of the header block this message was
+   * decoded from, when the codec was asked to keep them (see
+   * HTTP2Codec::setHeaderPassthrough).  A proxy that sends these headers
+   * on, as they are or modified, can set them on the outgoing message to
+   * have HPACK reuse the encoding of the unchanged ones.
+   */
+  void setHuffmanLiterals(std::shared_ptr<const HuffmanLiterals> literals) {
+    huffmanLiterals_ = std::move(literals);
+  }
+  const std::shared_ptr<const HuffmanLiterals>& getHuffmanLiterals() const {
+    return huffmanLiterals_;
+  }
+
   /**
    * Access the trailers
    */
@@ -334,9 +385,11 @@ class HTTPMessage {
   bool is5xxResponse() const { return (getStatusCode() / 100) == 5; }
 
   /**
-   * Formats the current time appropriately for a Date header
+   * Formats the current time appropriately for a Date header.  It is
+   * rendered at most once a second per thread; the returned string is owned
+   * by the thread and stays valid, though it may change on the next call.
    */
-  static std::string formatDateHeader();
+  static const std::string& formatDateHeader();
 
   /**
    * Ensures this HTTPMessage contains a host header, adding a default one
@@ -445,6 +498,18 @@ class HTTPMessage {
    */
   const std::string& getQueryParam(const std::string& name) const;
 
+  /**
+   * Get the query parameter with the specified name, looked up in the query
+   * string itself, without parsing it into the map getQueryParams() returns.
+   * Nothing is allocated.
+   *
+   * Returns folly::none if there is no parameter with the specified name.
+   * As with getQueryParam(), the last value of a repeated parameter wins.
+   * The returned value is only valid until the URL changes.
+   */
+  folly::Optional<folly::StringPiece> getQueryParamPiece(
+      folly::StringPiece name) const;
+
   /**
    * Get the query parameter with the specified name as int.
    *
@@ -504,10 +569,10 @@ class HTTPMessage {
    * Returns a StringPiece to the cookie value, or an empty StringPiece if
    * there is no cookie with the specified name.  The returned cookie is
    * only valid as long as the Cookie Header in HTTPMessage object exists.
-   * Applications should make sure they call unparseCookies() when editing
-   * the Cookie Header, so that the StringPiece references are cleared.
+   * The Cookie headers are searched on each call, stopping at the first
+   * cookie with that name, and nothing is allocated.
    */
-  const folly::StringPiece getCookie(const std::string& name) const;
+  const folly::StringPiece getCookie(folly::StringPiece name) const;
 
   /**
    * Print the message out.
@@ -640,14 +705,10 @@ class HTTPMessage {
                            bool caseSensitive) const;
 
   /**
-   * Forget about the parsed cookies.
-   *
-   * Ideally HTTPMessage should automatically forget about the current parsed
-   * cookie state whenever a Cookie header is changed.  However, at the moment
-   * callers have to explicitly call unparseCookies() after modifying the
-   * cookie headers.
+   * Formerly forgot about the parsed cookies.  getCookie() reads the Cookie
+   * headers on each call now, so there is nothing to forget.
    */
-  void unparseCookies() const;
+  void unparseCookies() const {}
 
   /**
    * Get the default reason string for a status code.
@@ -734,8 +795,6 @@ class HTTPMessage {
 
  private:
 
-  void parseCookies() const;
-
   void parseQueryParams() const;
   void unparseQueryParams();
 
@@ -749,6 +808,17 @@ class HTTPMessage {
    */
   static folly::StringPiece trim(folly::StringPiece sp);
 
+  /**
+   * The value of the first pair named name in input, split as with
+   * splitNameValuePieces(), or of the last one if last is set.
+   */
+  static folly::Optional<folly::StringPiece> findNameValuePiece(
+      folly::StringPiece input,
+      char pairDelim,
+      char valueDelim,
+      folly::StringPiece name,
+      bool last);
+
   /** The 12 standard fields for HTTP messages. Use accessors.
    * An HTTPMessage is either a Request or Response.
    * Once an accessor for either is used, that fixes the type of HTTPMessage.
@@ -819,12 +889,10 @@ class HTTPMessage {
   }
 
   /*
-   * Cookies and query parameters
-   * These are mutable since we parse them lazily in getCookie() and
-   * getQueryParam()
+   * Query parameters
+   * These are mutable since we parse them lazily in getQueryParam().
+   * getQueryParamPiece() and getCookie() look up the raw strings instead.
    */
-  mutable std::map<folly::StringPiece, folly::StringPiece> cookies_;
-  // TODO: use StringPiece for queryParams_ and delete splitNameValue()
   mutable std::map<std::string, std::string> queryParams_;
 
   std::pair<uint8_t, uint8_t> version_;
@@ -832,6 +900,8 @@ class HTTPMessage {
   HTTPHeaders strippedPerHopHeaders_;
   HTTPHeaderSize size_;
   std::unique_ptr<HTTPHeaders> trailers_;
+  std::shared_ptr<const HTTPHeaderTemplate> headerTemplate_;
+  std::shared_ptr<const HuffmanLiterals> huffmanLiterals_;
 
   int sslVersion_;
   const char* sslCipher_;
@@ -839,7 +909,6 @@ class HTTPMessage {
   uint8_t pri_;
   folly::Optional<HTTPPriority> h2Pri_;
 
-  mutable bool parsedCookies_:1;
   mutable bool parsedQueryParams_:1;
   bool chunked_:1;
   bool upgraded_:1;
@@ -0,0 +1,352 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/HTTPMessageSerializer.h>
+
+#include <folly/IPAddress.h>
+#include <folly/io/Cursor.h>
+#include <limits>
+
+using folly::ByteRange;
+using folly::StringPiece;
+using folly::io::QueueAppender;
+
+namespace proxygen {
+
+namespace {
+
+const uint8_t kNumHeaderCodes = HTTPCommonHeaders::num_header_codes;
+
+size_t varintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+void writeVarint(QueueAppender& appender, uint64_t value) {
+  while (value >= 0x80) {
+    appender.write<uint8_t>(0x80 | (value & 0x7f));
+    value >>= 7;
+  }
+  appender.write<uint8_t>(value);
+}
+
+void writeString(QueueAppender& appender, StringPiece str) {
+  writeVarint(appender, str.size());
+  appender.push(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+size_t headersSize(const HTTPHeaders& headers) {
+  size_t size = 0;
+  headers.forEachWithCode([&] (HTTPHeaderCode code,
+                               const std::string& name,
+                               const std::string& value) {
+      size += 1 + varintSize(value.size()) + value.size();
+      if (code == HTTP_HEADER_OTHER) {
+        size += varintSize(name.size()) + name.size();
+      }
+    });
+  return size;
+}
+
+void writeHeaders(QueueAppender& appender, const HTTPHeaders& headers) {
+  writeVarint(appender, headersSize(headers));
+  headers.forEachWithCode([&] (HTTPHeaderCode code,
+                               const std::string& name,
+                               const std::string& value) {
+      appender.write<uint8_t>(code);
+      if (code == HTTP_HEADER_OTHER) {
+        writeString(appender, name);
+      }
+      writeString(appender, value);
+    });
+}
+
+/**
+ * Reads from in, until it runs out: then ok is false and reads return
+ * nothing.
+ */
+struct Reader {
+  explicit Reader(ByteRange input) : in(input) {}
+
+  uint8_t readByte() {
+    if (in.empty()) {
+      ok = false;
+      return 0;
+    }
+    auto byte = in.front();
+    in.advance(1);
+    return byte;
+  }
+
+  uint64_t readVarint() {
+    uint64_t value = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+      auto byte = readByte();
+      value |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+    ok = false;
+    return 0;
+  }
+
+  ByteRange readBytes(uint64_t length) {
+    if (length > in.size()) {
+      ok = false;
+      in.clear();
+      return ByteRange();
+    }
+    auto bytes = in.subpiece(0, length);
+    in.advance(length);
+    return bytes;
+  }
+
+  StringPiece readString() {
+    auto bytes = readBytes(readVarint());
+    return StringPiece(reinterpret_cast<const char*>(bytes.data()),
+                       bytes.size());
+  }
+
+  ByteRange in;
+  bool ok{true};
+};
+
+// All that comes before the headers, pointing into the encoding
+struct Prologue {
+  uint8_t flags{0};
+  uint8_t major{0};
+  uint8_t minor{0};
+  uint8_t method{0};
+  StringPiece methodString;
+  StringPiece url;
+  uint16_t statusCode{0};
+  StringPiece statusMessage;
+  ByteRange address;
+  uint16_t port{0};
+};
+
+bool readPrologue(Reader& reader, Prologue& prologue) {
+  if (reader.readByte() != HTTPMessageSerializer::kVersion ||
+      reader.readByte() != kNumHeaderCodes) {
+    return false;
+  }
+  prologue.flags = reader.readByte();
+  prologue.major = reader.readByte();
+  prologue.minor = reader.readByte();
+  if (prologue.flags & HTTPMessageSerializer::kRequest) {
+    prologue.method = reader.readByte();
+    if (prologue.method > uint8_t(HTTPMethod::UNSUB) + 1) {
+      return false;
+    } else if (prologue.method == 0) {
+      prologue.methodString = reader.readString();
+    }
+    prologue.url = reader.readString();
+  } else {
+    auto status = reader.readVarint();
+    if (status > std::numeric_limits<uint16_t>::max()) {
+      return false;
+    }
+    prologue.statusCode = status;
+    prologue.statusMessage = reader.readString();
+  }
+  if (prologue.flags & HTTPMessageSerializer::kClientAddress) {
+    auto family = reader.readByte();
+    if (family != 4 && family != 6) {
+      return false;
+    }
+    prologue.address = reader.readBytes(family == 4 ? 4 : 16);
+    auto port = reader.readVarint();
+    if (port > std::numeric_limits<uint16_t>::max()) {
+      return false;
+    }
+    prologue.port = port;
+  }
+  return reader.ok;
+}
+
+/**
+ * Calls func(code, name, value) for each header of the next section, until
+ * it returns false.  name is empty for the common headers.  Returns false if
+ * the section is malformed.
+ */
+template <typename Func>
+bool readHeaders(Reader& reader, Func func) {
+  Reader section(reader.readBytes(reader.readVarint()));
+  if (!reader.ok) {
+    return false;
+  }
+  while (!section.in.empty()) {
+    auto code = HTTPHeaderCode(section.readByte());
+    StringPiece name;
+    if (code == HTTP_HEADER_OTHER) {
+      name = section.readString();
+    } else if (code < HTTPHeaderCodeCommonOffset || code >= kNumHeaderCodes) {
+      return false;
+    }
+    auto value = section.readString();
+    if (!section.ok) {
+      return false;
+    }
+    if (!func(code, name, value)) {
+      break;
+    }
+  }
+  return true;
+}
+
+template <typename Match>
+folly::Optional<StringPiece> findHeader(ByteRange in, Match match) {
+  Reader reader(in);
+  Prologue prologue;
+  if (!readPrologue(reader, prologue)) {
+    return folly::none;
+  }
+  folly::Optional<StringPiece> found;
+  readHeaders(reader, [&] (HTTPHeaderCode code,
+                           StringPiece name,
+                           StringPiece value) {
+      if (match(code, name)) {
+        found = value;
+        return false;
+      }
+      return true;
+    });
+  return found;
+}
+
+}
+
+const uint8_t HTTPMessageSerializer::kVersion;
+
+void HTTPMessageSerializer::serialize(const HTTPMessage& msg,
+                                      folly::IOBufQueue& out) {
+  QueueAppender appender(&out, 1024);
+  uint8_t flags = 0;
+  folly::Optional<folly::IPAddress> address;
+  if (msg.isRequest()) {
+    flags |= kRequest;
+    const auto& client = msg.getClientAddress();
+    if (client.isInitialized() && client.isFamilyInet()) {
+      flags |= kClientAddress;
+      address = client.getIPAddress();
+    }
+  }
+  if (msg.isSecure()) {
+    flags |= kSecure;
+  }
+  if (msg.getTrailers()) {
+    flags |= kTrailers;
+  }
+  appender.write<uint8_t>(kVersion);
+  appender.write<uint8_t>(kNumHeaderCodes);
+  appender.write<uint8_t>(flags);
+  appender.write<uint8_t>(msg.getHTTPVersion().first);
+  appender.write<uint8_t>(msg.getHTTPVersion().second);
+  if (msg.isRequest()) {
+    auto method = msg.getMethod();
+    if (method) {
+      appender.write<uint8_t>(uint8_t(*method) + 1);
+    } else {
+      appender.write<uint8_t>(0);
+      writeString(appender, msg.getMethodString());
+    }
+    writeString(appender, msg.getURL());
+  } else {
+    writeVarint(appender, msg.getStatusCode());
+    writeString(appender, msg.getStatusMessage());
+  }
+  if (address) {
+    appender.write<uint8_t>(address->isV4() ? 4 : 6);
+    appender.push(address->bytes(), address->byteCount());
+    writeVarint(appender, msg.getClientAddress().getPort());
+  }
+  writeHeaders(appender, msg.getHeaders());
+  if (msg.getTrailers()) {
+    writeHeaders(appender, *msg.getTrailers());
+  }
+}
+
+bool HTTPMessageSerializer::deserialize(ByteRange in, HTTPMessage& msg) {
+  Reader reader(in);
+  Prologue prologue;
+  if (!readPrologue(reader, prologue)) {
+    return false;
+  }
+  msg.setHTTPVersion(prologue.major, prologue.minor);
+  if (prologue.flags & kRequest) {
+    if (prologue.method > 0) {
+      msg.setMethod(HTTPMethod(prologue.method - 1));
+    } else {
+      msg.setMethod(prologue.methodString);
+    }
+    msg.setURL(prologue.url.str());
+  } else {
+    msg.setStatusCode(prologue.statusCode);
+    msg.setStatusMessage(prologue.statusMessage.str());
+  }
+  msg.setSecure(prologue.flags & kSecure);
+  if (prologue.flags & kClientAddress) {
+    try {
+      msg.setClientAddress(folly::SocketAddress(
+                             folly::IPAddress::fromBinary(prologue.address),
+                             prologue.port));
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  auto addTo = [] (HTTPHeaders& headers) {
+    return [&headers] (HTTPHeaderCode code,
+                       StringPiece name,
+                       StringPiece value) {
+      if (code == HTTP_HEADER_OTHER) {
+        headers.add(name, value);
+      } else {
+        headers.add(code, value.str());
+      }
+      return true;
+    };
+  };
+  if (!readHeaders(reader, addTo(msg.getHeaders()))) {
+    return false;
+  }
+  if (prologue.flags & kTrailers) {
+    auto trailers = std::make_unique<HTTPHeaders>();
+    if (!readHeaders(reader, addTo(*trailers))) {
+      return false;
+    }
+    msg.setTrailers(std::move(trailers));
+  }
+  return reader.in.empty();
+}
+
+folly::Optional<StringPiece> HTTPMessageSerializer::getHeader(
+    ByteRange in, HTTPHeaderCode code) {
+  return findHeader(in, [code] (HTTPHeaderCode c, StringPiece) {
+      return c == code;
+    });
+}
+
+folly::Optional<StringPiece> HTTPMessageSerializer::getHeader(
+    ByteRange in, StringPiece name) {
+  auto code = HTTPCommonHeaders::hash(name.data(), name.size());
+  if (code != HTTP_HEADER_OTHER) {
+    return getHeader(in, code);
+  }
+  return findHeader(in, [name] (HTTPHeaderCode c, StringPiece n) {
+      return c == HTTP_HEADER_OTHER && caseInsensitiveEqual(n, name);
+    });
+}
+
+}
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+namespace proxygen {
+
+/**
+ * A compact binary encoding of an HTTPMessage, to hand requests and
+ * responses over between processes running the same build, rather than
+ * printing them as HTTP/1.1 and parsing them again.  Common headers are
+ * written as their HTTPHeaderCode, so the encoding is only understood by a
+ * build with the same HTTPCommonHeaders; deserialize() checks that.
+ *
+ * The layout, where a number is a varint and a string a number of bytes
+ * followed by the bytes:
+ *   version, number of header codes, flags, HTTP major, HTTP minor (bytes)
+ *   request:  method (a byte, 0 for an extension method then its string),
+ *             url (string)
+ *   response: status code (number), status message (string)
+ *   if kClientAddress: family (4 or 6), address (4 or 16 bytes), port
+ *   headers, and trailers if kTrailers, each as the length of the section
+ *             (number) then for each header its code (byte), its name
+ *             (string) if the code is HTTP_HEADER_OTHER, and its value
+ *             (string)
+ * The section lengths let getHeader() skip to the header it looks for.
+ */
+class HTTPMessageSerializer {
+ public:
+  static const uint8_t kVersion = 1;
+
+  enum Flags : uint8_t {
+    kRequest = 0x01,
+    kSecure = 0x02,
+    kClientAddress = 0x04,
+    kTrailers = 0x08,
+  };
+
+  // Appends the encoding of msg to out
+  static void serialize(const HTTPMessage& msg, folly::IOBufQueue& out);
+
+  /**
+   * Decodes what serialize() wrote into msg, a new message.  Returns false
+   * if in isn't such an encoding, or comes from another version or build.
+   */
+  static bool deserialize(folly::ByteRange in, HTTPMessage& msg);
+
+  /**
+   * The value of the first header of the encoded message with the given
+   * code, or name, without decoding the rest of it.  Only the headers, not
+   * the trailers, are searched, and the value points into in.
+   */
+  static folly::Optional<folly::StringPiece> getHeader(folly::ByteRange in,
+                                                       HTTPHeaderCode code);
+  static folly::Optional<folly::StringPiece> getHeader(
+    folly::ByteRange in, folly::StringPiece name);
+};
+
+}
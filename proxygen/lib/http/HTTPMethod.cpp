@@ -48,6 +48,18 @@ const std::string& methodToString(HTTPMethod method) {
   return getMethodStrings()[static_cast<unsigned>(method)];
 }
 
+bool isSafeMethod(HTTPMethod method) {
+  switch (method) {
+    case HTTPMethod::GET:
+    case HTTPMethod::HEAD:
+    case HTTPMethod::OPTIONS:
+    case HTTPMethod::TRACE:
+      return true;
+    default:
+      return false;
+  }
+}
+
 std::ostream& operator <<(std::ostream& out, HTTPMethod method) {
   out << methodToString(method);
   return out;
@@ -68,6 +68,12 @@ extern folly::Optional<HTTPMethod> stringToMethod(folly::StringPiece method);
  */
 extern const std::string& methodToString(HTTPMethod method);
 
+/**
+ * Returns true for the methods RFC7231 4.2.1 defines as safe, whose
+ * requests may be replayed, e.g. when sent as TLS 1.3 early data (RFC8470).
+ */
+extern bool isSafeMethod(HTTPMethod method);
+
 std::ostream& operator<<(std::ostream& os, HTTPMethod method);
 
 }
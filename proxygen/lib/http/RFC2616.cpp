@@ -9,8 +9,10 @@
  */
 #include <proxygen/lib/http/RFC2616.h>
 
+#include <algorithm>
 #include <stdlib.h>
 
+#include <folly/Conv.h>
 #include <folly/String.h>
 #include <folly/ThreadLocal.h>
 #include <proxygen/lib/http/HTTPHeaders.h>
@@ -170,4 +172,61 @@ bool parseByteRangeSpec(
   return true;
 }
 
+ByteRange parseByteRangeRequest(
+    folly::StringPiece value,
+    unsigned long instanceLength,
+    unsigned long& outFirstByte,
+    unsigned long& outLastByte) {
+  value = folly::trimWhitespace(value);
+  if (!value.startsWith("bytes=")) {
+    return ByteRange::INVALID;
+  }
+  value.advance(6 /* strlen("bytes=") */);
+  value = folly::trimWhitespace(value);
+  // Only single ranges are served
+  auto dash = value.find('-');
+  if (dash == folly::StringPiece::npos || value.find(',') != value.npos) {
+    return ByteRange::INVALID;
+  }
+  // Short enough not to overflow
+  auto isDigits = [] (folly::StringPiece digits) {
+    return !digits.empty() && digits.size() < 20 &&
+      std::all_of(digits.begin(), digits.end(),
+                  [] (char c) { return c >= '0' && c <= '9'; });
+  };
+  auto first = folly::trimWhitespace(value.subpiece(0, dash));
+  auto last = folly::trimWhitespace(value.subpiece(dash + 1));
+
+  unsigned long firstByte;
+  unsigned long lastByte;
+  if (first.empty()) {
+    // suffix range, the last N bytes
+    if (!isDigits(last)) {
+      return ByteRange::INVALID;
+    }
+    auto suffixLength = folly::to<unsigned long>(last);
+    if (suffixLength == 0 || instanceLength == 0) {
+      return ByteRange::UNSATISFIABLE;
+    }
+    firstByte = instanceLength - std::min(suffixLength, instanceLength);
+    lastByte = instanceLength - 1;
+  } else {
+    if (!isDigits(first) || (!last.empty() && !isDigits(last))) {
+      return ByteRange::INVALID;
+    }
+    firstByte = folly::to<unsigned long>(first);
+    lastByte = last.empty() ? ULONG_MAX : folly::to<unsigned long>(last);
+    if (lastByte < firstByte) {
+      return ByteRange::INVALID;
+    }
+    if (firstByte >= instanceLength) {
+      return ByteRange::UNSATISFIABLE;
+    }
+    lastByte = std::min(lastByte, instanceLength - 1);
+  }
+  outFirstByte = firstByte;
+  outLastByte = lastByte;
+  return ByteRange::SATISFIABLE;
+}
+
 }}
@@ -90,4 +90,25 @@ bool parseByteRangeSpec(
     unsigned long& lastByte,
     unsigned long& instanceLength);
 
+/**
+ * Parse the value of a "Range" request header (RFC 7233 section 3.1) for a
+ * representation of instanceLength bytes, returning the first and last bytes
+ * to send of its single range: "bytes=A-B", "bytes=A-" or "bytes=-N" (the
+ * last N bytes).  lastByte is capped to instanceLength - 1.
+ *
+ * INVALID is returned for malformed values, other units and multiple ranges,
+ * which servers may ignore, sending the whole representation.  UNSATISFIABLE
+ * is for a range starting past the end, to be answered with a 416.
+ */
+enum class ByteRange {
+  SATISFIABLE,
+  UNSATISFIABLE,
+  INVALID,
+};
+ByteRange parseByteRangeRequest(
+    folly::StringPiece value,
+    unsigned long instanceLength,
+    unsigned long& firstByte,
+    unsigned long& lastByte);
+
 }}
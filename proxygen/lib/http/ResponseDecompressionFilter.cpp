@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/ResponseDecompressionFilter.h>
+
+#include <folly/io/IOBuf.h>
+#include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
+#include <proxygen/lib/utils/UtilInl.h>
+
+namespace proxygen {
+
+namespace {
+const std::string kFilterName = "ResponseDecompressionFilter";
+}
+
+CompressionType ResponseDecompressionFilter::getEncoding(
+    const HTTPMessage& msg) {
+  const auto& coding =
+    msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_ENCODING);
+  if (caseInsensitiveEqual(coding, "gzip") ||
+      caseInsensitiveEqual(coding, "x-gzip")) {
+    return CompressionType::GZIP;
+  } else if (caseInsensitiveEqual(coding, "deflate")) {
+    return CompressionType::DEFLATE;
+  } else if (caseInsensitiveEqual(coding, "zstd")) {
+    return CompressionType::ZSTD;
+  }
+  return CompressionType::NONE;
+}
+
+void ResponseDecompressionFilter::prepareRequest(HTTPMessage& request) const {
+  auto& headers = request.getHeaders();
+  if (headers.exists(HTTP_HEADER_ACCEPT_ENCODING)) {
+    return;
+  }
+  // What the client accepts is left encoded, so the server only needs to
+  // compress in those encodings
+  if (downstreamAcceptEncoding_ && !downstreamAcceptEncoding_->empty()) {
+    headers.set(HTTP_HEADER_ACCEPT_ENCODING, *downstreamAcceptEncoding_);
+  } else if (!options_.acceptEncoding.empty()) {
+    headers.set(HTTP_HEADER_ACCEPT_ENCODING, options_.acceptEncoding);
+  }
+}
+
+void ResponseDecompressionFilter::setPassthrough(
+    const HTTPMessage& downstreamRequest) {
+  downstreamAcceptEncoding_ = downstreamRequest.getHeaders().combine(
+    HTTP_HEADER_ACCEPT_ENCODING);
+}
+
+bool ResponseDecompressionFilter::isPassedThrough(
+    const HTTPMessage& msg) const {
+  if (!downstreamAcceptEncoding_) {
+    return false;
+  }
+  std::vector<RFC2616::TokenQPair> accepted;
+  if (!RFC2616::parseQvalues(*downstreamAcceptEncoding_, accepted)) {
+    return false;
+  }
+  const auto& coding =
+    msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_ENCODING);
+  // An explicit token overrides "*", and q=0 refuses the encoding
+  double qvalue = 0;
+  for (const auto& token : accepted) {
+    if (caseInsensitiveEqual(token.first, coding)) {
+      qvalue = token.second;
+      break;
+    }
+    if (token.first == "*") {
+      qvalue = token.second;
+    }
+  }
+  return qvalue > 0;
+}
+
+void ResponseDecompressionFilter::onHeadersComplete(
+    std::unique_ptr<HTTPMessage> msg) noexcept {
+  if (msg->is1xxResponse()) {
+    nextOnHeadersComplete(std::move(msg));
+    return;
+  }
+  auto type = getEncoding(*msg);
+  if (type != CompressionType::NONE && !isPassedThrough(*msg)) {
+    decompressor_ = StreamCodecPool::getDecompressor(type);
+    auto& headers = msg->getHeaders();
+    headers.remove(HTTP_HEADER_CONTENT_ENCODING);
+    headers.remove(HTTP_HEADER_CONTENT_LENGTH);
+  }
+  nextOnHeadersComplete(std::move(msg));
+}
+
+void ResponseDecompressionFilter::onBody(
+    std::unique_ptr<folly::IOBuf> chain) noexcept {
+  if (failed_) {
+    return;
+  }
+  if (!decompressor_) {
+    nextOnBody(std::move(chain));
+    return;
+  }
+  compressedSize_ += chain->computeChainDataLength();
+  auto decompressed = decompressor_->decompress(chain.get());
+  if (decompressor_->hasError()) {
+    fail("Error decompressing the response body");
+    return;
+  }
+  size_t length = decompressed ? decompressed->computeChainDataLength() : 0;
+  decompressedSize_ += length;
+  if (options_.maxSize > 0 && decompressedSize_ > options_.maxSize) {
+    fail("Decompressed response body too large");
+    return;
+  }
+  if (length > 0) {
+    nextOnBody(std::move(decompressed));
+  }
+}
+
+void ResponseDecompressionFilter::onChunkHeader(size_t length) noexcept {
+  // The chunks are those of the compressed body
+  if (!failed_ && !decompressor_) {
+    nextOnChunkHeader(length);
+  }
+}
+
+void ResponseDecompressionFilter::onChunkComplete() noexcept {
+  if (!failed_ && !decompressor_) {
+    nextOnChunkComplete();
+  }
+}
+
+void ResponseDecompressionFilter::onTrailers(
+    std::unique_ptr<HTTPHeaders> trailers) noexcept {
+  if (!failed_) {
+    nextOnTrailers(std::move(trailers));
+  }
+}
+
+void ResponseDecompressionFilter::onEOM() noexcept {
+  if (failed_) {
+    return;
+  }
+  // Responses without a body, e.g. to HEAD, have nothing to check
+  if (decompressor_ && compressedSize_ > 0 && !decompressor_->finished()) {
+    fail("Truncated compressed response body");
+    return;
+  }
+  // Back to the pool
+  decompressor_.reset();
+  nextOnEOM();
+}
+
+void ResponseDecompressionFilter::onError(const HTTPException& error) noexcept {
+  if (failed_) {
+    return;
+  }
+  failed_ = true;
+  decompressor_.reset();
+  nextOnError(error);
+}
+
+const std::string& ResponseDecompressionFilter::getFilterName() noexcept {
+  return kFilterName;
+}
+
+void ResponseDecompressionFilter::fail(const std::string& reason) {
+  VLOG(4) << reason << ", compressed=" << compressedSize_
+          << " decompressed=" << decompressedSize_;
+  failed_ = true;
+  decompressor_.reset();
+  HTTPException ex(HTTPException::Direction::INGRESS, reason);
+  ex.setProxygenError(kErrorParseBody);
+  nextOnError(ex);
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <proxygen/lib/http/HTTPMessageFilters.h>
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+namespace proxygen {
+
+/**
+ * A filter between an upstream transaction and its handler, decompressing
+ * the bodies of responses with a gzip, deflate or zstd Content-Encoding, so
+ * that the handler gets them decompressed, without the Content-Encoding and
+ * Content-Length headers.  The decompressors come from the per-thread pools
+ * of StreamCodecPool.
+ *
+ *   ResponseDecompressionFilter filter(options);
+ *   filter.setNextTransactionHandler(&handler);
+ *   auto txn = session->newTransaction(&filter);
+ *   filter.prepareRequest(request);
+ *   txn->sendHeaders(request);
+ *
+ * A proxy can pass on what its client accepts instead: with
+ * setPassthrough(), responses in an encoding the client accepts are left
+ * encoded, rather than decompressed and compressed again.
+ *
+ * Corrupt or truncated bodies, and bodies over maxSize decompressed, give
+ * the handler onError() and none of the rest of the response; the handler
+ * should then abort the transaction.  The filter is owned by the caller and
+ * serves one transaction.
+ */
+class ResponseDecompressionFilter : public HTTPMessageFilter {
+ public:
+  struct Options {
+    // Sent with the requests without Accept-Encoding
+    std::string acceptEncoding{"gzip, deflate, zstd"};
+    // Decompressed bytes allowed, 0 for no limit
+    uint64_t maxSize{0};
+  };
+
+  explicit ResponseDecompressionFilter(const Options& options)
+      : options_(options) {}
+
+  /**
+   * The type to decompress the body of msg with, NONE if its body isn't
+   * encoded, or with more than one content coding or an unsupported one.
+   */
+  static CompressionType getEncoding(const HTTPMessage& msg);
+
+  // Adds the Accept-Encoding of the options, unless request has one
+  void prepareRequest(HTTPMessage& request) const;
+
+  /**
+   * Leaves the responses encoded in an encoding the downstream request
+   * accepts, and forwards its Accept-Encoding upstream from
+   * prepareRequest().
+   */
+  void setPassthrough(const HTTPMessage& downstreamRequest);
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override;
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+  void onChunkHeader(size_t length) noexcept override;
+  void onChunkComplete() noexcept override;
+  void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override;
+  void onEOM() noexcept override;
+  void onError(const HTTPException& error) noexcept override;
+
+  std::unique_ptr<HTTPMessageFilter> clone() noexcept override {
+    return std::make_unique<ResponseDecompressionFilter>(options_);
+  }
+
+  const std::string& getFilterName() noexcept override;
+
+  // Whether the body of the response is being decompressed
+  bool isDecompressing() const {
+    return decompressor_ != nullptr;
+  }
+
+ private:
+  // Whether the downstream request accepts the encoding of msg
+  bool isPassedThrough(const HTTPMessage& msg) const;
+
+  void fail(const std::string& reason);
+
+  const Options options_;
+  // Of the downstream request, when passing through
+  folly::Optional<std::string> downstreamAcceptEncoding_;
+  std::shared_ptr<StreamDecompressor> decompressor_;
+  uint64_t compressedSize_{0};
+  uint64_t decompressedSize_{0};
+  bool failed_{false};
+};
+
+}
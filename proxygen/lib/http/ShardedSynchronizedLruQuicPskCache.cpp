@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/ShardedSynchronizedLruQuicPskCache.h>
+
+namespace proxygen {
+
+const size_t ShardedSynchronizedLruQuicPskCache::kDefaultNumShards;
+
+ShardedSynchronizedLruQuicPskCache::ShardedSynchronizedLruQuicPskCache(
+    uint64_t mapMax, size_t numShards) {
+  CHECK_GT(numShards, 0);
+  auto shardMax = std::max<uint64_t>(1, (mapMax + numShards - 1) / numShards);
+  shards_.reserve(numShards);
+  for (size_t i = 0; i < numShards; i++) {
+    shards_.push_back(std::make_unique<Shard>(shardMax));
+  }
+}
+
+ShardedSynchronizedLruQuicPskCache::Shard&
+ShardedSynchronizedLruQuicPskCache::getShard(const std::string& identity) {
+  return *shards_[std::hash<std::string>()(identity) % shards_.size()];
+}
+
+folly::Optional<quic::QuicCachedPsk>
+ShardedSynchronizedLruQuicPskCache::getPsk(const std::string& identity) {
+  // A find promotes the entry, so this is a write too
+  auto cacheMap = getShard(identity).cache.wlock();
+  auto result = cacheMap->find(identity);
+  if (result != cacheMap->end()) {
+    return result->second;
+  } else {
+    return folly::none;
+  }
+}
+
+void ShardedSynchronizedLruQuicPskCache::putPsk(const std::string& identity,
+                                                quic::QuicCachedPsk psk) {
+  auto cacheMap = getShard(identity).cache.wlock();
+  cacheMap->set(identity, std::move(psk));
+}
+
+void ShardedSynchronizedLruQuicPskCache::removePsk(
+    const std::string& identity) {
+  auto cacheMap = getShard(identity).cache.wlock();
+  cacheMap->erase(identity);
+}
+
+} // namespace proxygen
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <quic/client/handshake/QuicPskCache.h>
+
+#include <memory>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * SynchronizedLruQuicPskCache split into shards by the hash of the
+ * identity, each an LRU with a lock of its own, so that handshakes on
+ * different threads mostly take different locks.  The least recently used
+ * PSK is evicted per shard rather than globally.
+ */
+class ShardedSynchronizedLruQuicPskCache : public quic::QuicPskCache {
+ public:
+  static const size_t kDefaultNumShards = 16;
+
+  ~ShardedSynchronizedLruQuicPskCache() override = default;
+
+  // mapMax PSKs in total, split evenly between the shards
+  explicit ShardedSynchronizedLruQuicPskCache(
+      uint64_t mapMax, size_t numShards = kDefaultNumShards);
+
+  folly::Optional<quic::QuicCachedPsk> getPsk(
+      const std::string& identity) override;
+
+  void putPsk(const std::string& identity, quic::QuicCachedPsk psk) override;
+
+  void removePsk(const std::string& identity) override;
+
+ private:
+  using EvictingPskMap =
+      folly::EvictingCacheMap<std::string, quic::QuicCachedPsk>;
+
+  // Aligned so that the locks of neighbouring shards don't share a line
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    explicit Shard(uint64_t mapMax) : cache(EvictingPskMap(mapMax)) {
+    }
+
+    folly::Synchronized<EvictingPskMap> cache;
+  };
+
+  Shard& getShard(const std::string& identity);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace proxygen
@@ -13,6 +13,86 @@
 #include <proxygen/lib/http/RFC2616.h>
 #include <proxygen/lib/http/codec/HeaderConstants.h>
 
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__SSE2__)
+// The signed comparisons of SSE2 see bytes >= 0x80 as negative, so they are
+// never in an ASCII range
+
+__m128i load16(const uint8_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+__m128i inRange(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
+
+__m128i nonAscii(__m128i v) {
+  return _mm_cmplt_epi8(v, _mm_setzero_si128());
+}
+
+bool allSet(__m128i mask) {
+  return _mm_movemask_epi8(mask) == 0xffff;
+}
+
+bool isURL16(const uint8_t* p) {
+  __m128i v = load16(p);
+  // no controls or unescaped spaces
+  return allSet(_mm_or_si128(inRange(v, 0x21, 0x7e), nonAscii(v)));
+}
+
+bool isAlpha16(const uint8_t* p) {
+  __m128i v = _mm_or_si128(load16(p), _mm_set1_epi8(0x20));
+  return allSet(inRange(v, 'a', 'z'));
+}
+
+// Lowercase letters, digits, '-' and non-ASCII: the characters of nearly all
+// header names, a subset of the tokens
+bool isCommonToken16(const uint8_t* p) {
+  __m128i v = load16(p);
+  __m128i ok = _mm_or_si128(inRange(v, 'a', 'z'), inRange(v, '0', '9'));
+  ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+  return allSet(_mm_or_si128(ok, nonAscii(v)));
+}
+
+// Characters which leave the header value state machine as it is outside
+// of LWS and escapes: all but CTLs (HT is OK), quotes and backslashes
+bool isPlainValue16(const uint8_t* p) {
+  __m128i v = load16(p);
+  __m128i special = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+  __m128i ok = _mm_andnot_si128(special, inRange(v, 0x20, 0x7e));
+  ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+  return allSet(_mm_or_si128(ok, nonAscii(v)));
+}
+
+// Whether check holds for every 16 bytes of range, the last ones
+// overlapping those before them.  range must have 16 bytes or more.
+template <typename Check>
+bool all16(folly::ByteRange range, Check check) {
+  auto p = range.begin();
+  for (; range.end() - p > 16; p += 16) {
+    if (!check(p)) {
+      return false;
+    }
+  }
+  return check(range.end() - 16);
+}
+#endif
+
+bool isToken(uint8_t c) {
+  return c >= 0x80 || proxygen::CodecUtil::http_tokens[c] == char(c);
+}
+
+}
+
 namespace proxygen {
 
 /**
@@ -58,6 +138,131 @@ const char CodecUtil::http_tokens[256] = {
        'x',     'y',     'z',      0,      '|',     '}',     '~',       0
 };
 
+bool CodecUtil::validateURL(folly::ByteRange url) {
+#if defined(__SSE2__)
+  if (url.size() >= 16) {
+    return all16(url, isURL16);
+  }
+#endif
+  return proxygen::validateURL(url);
+}
+
+bool CodecUtil::validateMethod(folly::ByteRange method) {
+#if defined(__SSE2__)
+  if (method.size() >= 16) {
+    return all16(method, isAlpha16);
+  }
+#endif
+  for (auto p: method) {
+    if (!isalpha(p)) {
+      // methods are all characters
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CodecUtil::validateHeaderName(folly::ByteRange name) {
+  if (name.size() == 0) {
+    return false;
+  }
+  auto p = name.begin();
+#if defined(__SSE2__)
+  // Blocks with other characters are checked one by one
+  for (; name.end() - p >= 16; p += 16) {
+    if (!isCommonToken16(p) && !std::all_of(p, p + 16, isToken)) {
+      return false;
+    }
+  }
+#endif
+  return std::all_of(p, name.end(), isToken);
+}
+
+bool CodecUtil::validateHeaderValue(folly::ByteRange value,
+                                    CtlEscapeMode mode) {
+  bool escape = false;
+  bool quote = false;
+  enum { lws_none,
+         lws_expect_nl,
+         lws_expect_ws1,
+         lws_expect_ws2 } state = lws_none;
+
+  for (auto p = std::begin(value); p != std::end(value); ++p) {
+#if defined(__SSE2__)
+    if (state == lws_none && !escape) {
+      // Skip the blocks of characters nothing needs to be done for
+      while (std::end(value) - p >= 16 && isPlainValue16(p)) {
+        p += 16;
+      }
+      if (p == std::end(value)) {
+        break;
+      }
+    }
+#endif
+    if (escape) {
+      escape = false;
+      if (mode == COMPLIANT) {
+        // prev char escaped.  Turn off escape and go to next char
+        // COMPLIANT mode only
+        assert(quote);
+        continue;
+      }
+    }
+    switch (state) {
+      case lws_none:
+        switch (*p) {
+          case '\\':
+            if (quote) {
+              escape = true;
+            }
+            break;
+          case '\"':
+            quote = !quote;
+            break;
+          case '\r':
+            state = lws_expect_nl;
+            break;
+          default:
+            if ((*p < 0x20 || *p == 0x7f) && *p != '\t') {
+              // unexpected ctl per rfc2616, HT OK
+              return false;
+            }
+            break;
+        }
+        break;
+      case lws_expect_nl:
+        if (*p != '\n') {
+          // unescaped \r must be LWS
+          return false;
+        }
+        state = lws_expect_ws1;
+        break;
+      case lws_expect_ws1:
+        if (*p != ' ' && *p != '\t') {
+          // unescaped \r\n must be LWS
+          return false;
+        }
+        state = lws_expect_ws2;
+        break;
+      case lws_expect_ws2:
+        if (*p != ' ' && *p != '\t') {
+          // terminated LWS
+          state = lws_none;
+          // check this char again
+          p--;
+        }
+        break;
+    }
+  }
+  // Unterminated quotes are OK, since the value can be* TEXT which treats
+  // the " like any other char.
+  // Unterminated escapes are bad because it will escape the next character
+  // when converting to HTTP
+  // Unterminated LWS (dangling \r or \r\n) is bad because it could
+  // prematurely terminate the headers when converting to HTTP
+  return !escape && (state == lws_none || state == lws_expect_ws2);
+}
+
 bool CodecUtil::hasGzipAndDeflate(const std::string& value, bool& hasGzip,
                                  bool& hasDeflate) {
   static folly::ThreadLocal<std::vector<RFC2616::TokenQPair>> output;
@@ -93,9 +298,17 @@ std::vector<compress::Header> CodecUtil::prepareMessageForCompression(
       const std::string& method = msg.getMethodString();
       allHeaders.emplace_back(HTTP_HEADER_COLON_METHOD, method);
     }
+    // An extended CONNECT (RFC 8441) for any other protocol, which the
+    // stream then carries both ways
+    const std::string* protocol = msg.getUpgradeProtocol();
+    bool extendedConnect = !msg.isEgressWebsocketUpgrade() && protocol &&
+      msg.getMethod() == HTTPMethod::CONNECT;
+    if (extendedConnect) {
+      allHeaders.emplace_back(HTTP_HEADER_COLON_PROTOCOL, *protocol);
+    }
 
     if (msg.getMethod() != HTTPMethod::CONNECT ||
-        msg.isEgressWebsocketUpgrade()) {
+        msg.isEgressWebsocketUpgrade() || extendedConnect) {
       const std::string& scheme =
         (msg.isSecure() ? headers::kHttps : headers::kHttp);
       const std::string& path = msg.getURL();
@@ -122,8 +335,9 @@ std::vector<compress::Header> CodecUtil::prepareMessageForCompression(
       appendHeaders(msg.getHeaders(), allHeaders, HTTP_HEADER_DATE);
 
   if (msg.isResponse() && !hasDateHeader) {
-    temps.emplace_back(HTTPMessage::formatDateHeader());
-    allHeaders.emplace_back(HTTP_HEADER_DATE, temps.back());
+    // The thread's cached date, unchanged until it's next formatted here
+    allHeaders.emplace_back(HTTP_HEADER_DATE,
+                            HTTPMessage::formatDateHeader());
   }
   return allHeaders;
 }
@@ -9,6 +9,8 @@
  */
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
 
+#include <algorithm>
+
 namespace proxygen {
 
 namespace {
@@ -43,6 +45,12 @@ FlowControlFilter::FlowControlFilter(Callback& callback,
 
 void FlowControlFilter::setReceiveWindowSize(folly::IOBufQueue& writeBuf,
                                              uint32_t capacity) {
+  if (toShrink_ > 0) {
+    shrinkReceiveWindowSize(capacity);
+    if (toShrink_ > 0) {
+      return;
+    }
+  }
   if (capacity < recvWindow_.getCapacity()) {
     VLOG(4) << "Ignoring low conn-level recv window size of " << capacity;
     return;
@@ -66,8 +74,27 @@ void FlowControlFilter::setReceiveWindowSize(folly::IOBufQueue& writeBuf,
   }
 }
 
+void FlowControlFilter::shrinkReceiveWindowSize(uint32_t capacity) {
+  if (capacity >= recvWindow_.getCapacity()) {
+    toShrink_ = 0;
+    return;
+  }
+  VLOG(4) << "Shrinking conn-level recv window from "
+          << recvWindow_.getCapacity() << " to " << capacity;
+  toShrink_ = recvWindow_.getCapacity() - capacity;
+}
+
 bool FlowControlFilter::ingressBytesProcessed(folly::IOBufQueue& writeBuf,
                                               uint32_t delta) {
+  if (toShrink_ > 0) {
+    // The peer's view of the window stays the same: these bytes are no
+    // longer outstanding, and are not part of the capacity anymore
+    uint32_t shrink = std::min(toShrink_, delta);
+    CHECK(recvWindow_.free(shrink));
+    CHECK(recvWindow_.setCapacity(recvWindow_.getCapacity() - shrink));
+    toShrink_ -= shrink;
+    delta -= shrink;
+  }
   toAck_ += delta;
   bool willAck = (toAck_ > 0 &&
                   uint32_t(toAck_) > recvWindow_.getCapacity() / 2);
@@ -64,6 +64,25 @@ class FlowControlFilter:
    */
   void setReceiveWindowSize(folly::IOBufQueue& writeBuf, uint32_t capacity);
 
+  /**
+   * Shrink the session receive window.  The window granted to the peer
+   * cannot be taken back, so instead the next ingress bytes processed are
+   * not acknowledged, and the capacity drops by as many, until it reaches
+   * the new one.  Growing the window with setReceiveWindowSize cancels what
+   * is left of the shrink.
+   *
+   * @param capacity     The new size of the conn-level recv window.
+   */
+  void shrinkReceiveWindowSize(uint32_t capacity);
+
+  /**
+   * @returns the capacity of the conn-level recv window, which is above the
+   *          one it is shrinking to until the shrink completes
+   */
+  uint32_t getReceiveWindowCapacity() const {
+    return recvWindow_.getCapacity();
+  }
+
   /**
    * Notify the flow control filter that some ingress bytes were
    * processed. If the number of bytes to acknowledge exceeds half the
@@ -105,6 +124,8 @@ class FlowControlFilter:
   Window recvWindow_;
   Window sendWindow_;
   int32_t toAck_{0};
+  // bytes to withhold from the peer to shrink recvWindow_
+  uint32_t toShrink_{0};
   bool error_:1;
   bool sendsBlocked_:1;
 };
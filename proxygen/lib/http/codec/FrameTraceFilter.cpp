@@ -0,0 +1,284 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/FrameTraceFilter.h>
+
+#include <folly/Format.h>
+#include <folly/io/Cursor.h>
+#include <proxygen/lib/utils/Time.h>
+
+#include <limits>
+
+namespace proxygen {
+
+using http2::FrameType;
+
+namespace {
+const uint32_t kDumpMagic = 0x50584654; // "PXFT"
+const uint8_t kDumpVersion = 1;
+const size_t kDumpHeaderSize = 12;
+const size_t kDumpRecordSize = 24;
+
+uint8_t endStream(bool eom) {
+  return eom ? http2::END_STREAM : 0;
+}
+}
+
+FrameTraceFilter::FrameTraceFilter(size_t maxFrames)
+    : records_(maxFrames) {
+  CHECK_GT(maxFrames, 0);
+}
+
+void FrameTraceFilter::record(FrameTraceRecord::Direction direction,
+                              StreamID stream,
+                              uint8_t type,
+                              uint8_t flags,
+                              uint64_t length) {
+  auto& rec = records_[next_ % records_.size()];
+  rec.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    getCurrentTime<SystemClock>().time_since_epoch()).count();
+  rec.streamID = stream;
+  rec.length = static_cast<uint32_t>(
+    std::min<uint64_t>(length, std::numeric_limits<uint32_t>::max()));
+  rec.type = type;
+  rec.flags = flags;
+  rec.direction = direction;
+  next_++;
+}
+
+void FrameTraceFilter::recordEgress(StreamID stream,
+                                    FrameType type,
+                                    uint8_t flags,
+                                    uint64_t length) {
+  record(FrameTraceRecord::EGRESS, stream, static_cast<uint8_t>(type), flags,
+         length);
+}
+
+std::vector<FrameTraceRecord> FrameTraceFilter::getRecords() const {
+  std::vector<FrameTraceRecord> records;
+  uint64_t first = next_ > records_.size() ? next_ - records_.size() : 0;
+  records.reserve(next_ - first);
+  for (uint64_t i = first; i < next_; i++) {
+    records.push_back(records_[i % records_.size()]);
+  }
+  return records;
+}
+
+std::unique_ptr<folly::IOBuf> FrameTraceFilter::dump() const {
+  auto records = getRecords();
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  folly::io::QueueAppender appender(
+    &queue, kDumpHeaderSize + records.size() * kDumpRecordSize);
+  appender.writeBE<uint32_t>(kDumpMagic);
+  appender.writeBE<uint8_t>(kDumpVersion);
+  appender.writeBE<uint8_t>(static_cast<uint8_t>(getProtocol()));
+  appender.writeBE<uint16_t>(0);
+  appender.writeBE<uint32_t>(records.size());
+  for (const auto& rec : records) {
+    appender.writeBE<uint64_t>(rec.timestampUs);
+    appender.writeBE<uint64_t>(rec.streamID);
+    appender.writeBE<uint32_t>(rec.length);
+    appender.writeBE<uint8_t>(rec.type);
+    appender.writeBE<uint8_t>(rec.flags);
+    appender.writeBE<uint8_t>(rec.direction);
+    appender.writeBE<uint8_t>(0);
+  }
+  return queue.move();
+}
+
+bool FrameTraceFilter::decode(folly::ByteRange data,
+                              CodecProtocol& protocol,
+                              std::vector<FrameTraceRecord>& records) {
+  if (data.size() < kDumpHeaderSize) {
+    return false;
+  }
+  auto buf = folly::IOBuf::wrapBuffer(data);
+  folly::io::Cursor cursor(buf.get());
+  if (cursor.readBE<uint32_t>() != kDumpMagic ||
+      cursor.readBE<uint8_t>() != kDumpVersion) {
+    return false;
+  }
+  protocol = static_cast<CodecProtocol>(cursor.readBE<uint8_t>());
+  cursor.skip(2);
+  auto count = cursor.readBE<uint32_t>();
+  if (data.size() != kDumpHeaderSize + uint64_t(count) * kDumpRecordSize) {
+    return false;
+  }
+  records.clear();
+  records.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    FrameTraceRecord rec;
+    rec.timestampUs = cursor.readBE<uint64_t>();
+    rec.streamID = cursor.readBE<uint64_t>();
+    rec.length = cursor.readBE<uint32_t>();
+    rec.type = cursor.readBE<uint8_t>();
+    rec.flags = cursor.readBE<uint8_t>();
+    rec.direction = cursor.readBE<uint8_t>() == FrameTraceRecord::EGRESS ?
+      FrameTraceRecord::EGRESS : FrameTraceRecord::INGRESS;
+    cursor.skip(1);
+    records.push_back(rec);
+  }
+  return true;
+}
+
+std::string FrameTraceFilter::toString(const FrameTraceRecord& record,
+                                       CodecProtocol protocol) {
+  std::string type;
+  // SPDY frame types are not HTTP/2's, only egress records are normalized
+  if (record.direction == FrameTraceRecord::EGRESS ||
+      protocol == CodecProtocol::HTTP_2) {
+    type = http2::getFrameTypeString(static_cast<FrameType>(record.type));
+  } else {
+    type = folly::to<std::string>("type=", unsigned(record.type));
+  }
+  return folly::sformat(
+    "{}.{:06d} {} {} stream={} length={} flags=0x{:02x}",
+    record.timestampUs / 1000000,
+    record.timestampUs % 1000000,
+    record.direction == FrameTraceRecord::EGRESS ? "OUT" : "IN",
+    type,
+    record.streamID,
+    record.length,
+    unsigned(record.flags));
+}
+
+void FrameTraceFilter::onFrameHeader(StreamID stream,
+                                     uint8_t flags,
+                                     uint64_t length,
+                                     uint64_t type,
+                                     uint16_t version) {
+  record(FrameTraceRecord::INGRESS, stream, static_cast<uint8_t>(type),
+         flags, length);
+  callback_->onFrameHeader(stream, flags, length, type, version);
+}
+
+void FrameTraceFilter::generateHeader(folly::IOBufQueue& writeBuf,
+                                      StreamID stream,
+                                      const HTTPMessage& msg,
+                                      bool eom,
+                                      HTTPHeaderSize* size) {
+  auto before = writeBuf.chainLength();
+  call_->generateHeader(writeBuf, stream, msg, eom, size);
+  recordEgress(stream, FrameType::HEADERS, endStream(eom),
+               writeBuf.chainLength() - before);
+}
+
+void FrameTraceFilter::generatePushPromise(folly::IOBufQueue& writeBuf,
+                                           StreamID stream,
+                                           const HTTPMessage& msg,
+                                           StreamID assocStream,
+                                           bool eom,
+                                           HTTPHeaderSize* size) {
+  auto before = writeBuf.chainLength();
+  call_->generatePushPromise(writeBuf, stream, msg, assocStream, eom, size);
+  recordEgress(stream, FrameType::PUSH_PROMISE, endStream(eom),
+               writeBuf.chainLength() - before);
+}
+
+void FrameTraceFilter::generateExHeader(
+    folly::IOBufQueue& writeBuf,
+    StreamID stream,
+    const HTTPMessage& msg,
+    const HTTPCodec::ExAttributes& exAttributes,
+    bool eom,
+    HTTPHeaderSize* size) {
+  auto before = writeBuf.chainLength();
+  call_->generateExHeader(writeBuf, stream, msg, exAttributes, eom, size);
+  recordEgress(stream, FrameType::EX_HEADERS, endStream(eom),
+               writeBuf.chainLength() - before);
+}
+
+size_t FrameTraceFilter::generateBody(folly::IOBufQueue& writeBuf,
+                                      StreamID stream,
+                                      std::unique_ptr<folly::IOBuf> chain,
+                                      folly::Optional<uint8_t> padding,
+                                      bool eom) {
+  auto ret = call_->generateBody(writeBuf, stream, std::move(chain), padding,
+                                 eom);
+  recordEgress(stream, FrameType::DATA, endStream(eom), ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generateTrailers(folly::IOBufQueue& writeBuf,
+                                          StreamID stream,
+                                          const HTTPHeaders& trailers) {
+  auto ret = call_->generateTrailers(writeBuf, stream, trailers);
+  recordEgress(stream, FrameType::HEADERS, http2::END_STREAM, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generateEOM(folly::IOBufQueue& writeBuf,
+                                     StreamID stream) {
+  auto ret = call_->generateEOM(writeBuf, stream);
+  recordEgress(stream, FrameType::DATA, http2::END_STREAM, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generateRstStream(folly::IOBufQueue& writeBuf,
+                                           StreamID stream,
+                                           ErrorCode statusCode) {
+  auto ret = call_->generateRstStream(writeBuf, stream, statusCode);
+  recordEgress(stream, FrameType::RST_STREAM, 0, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generateGoaway(
+    folly::IOBufQueue& writeBuf,
+    StreamID lastStream,
+    ErrorCode statusCode,
+    std::unique_ptr<folly::IOBuf> debugData) {
+  auto ret = call_->generateGoaway(writeBuf, lastStream, statusCode,
+                                   std::move(debugData));
+  recordEgress(lastStream, FrameType::GOAWAY, 0, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generatePingRequest(folly::IOBufQueue& writeBuf) {
+  auto ret = call_->generatePingRequest(writeBuf);
+  recordEgress(0, FrameType::PING, 0, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generatePingReply(folly::IOBufQueue& writeBuf,
+                                           uint64_t uniqueID) {
+  auto ret = call_->generatePingReply(writeBuf, uniqueID);
+  recordEgress(0, FrameType::PING, http2::ACK, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generateSettings(folly::IOBufQueue& writeBuf) {
+  auto ret = call_->generateSettings(writeBuf);
+  recordEgress(0, FrameType::SETTINGS, 0, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generateSettingsAck(folly::IOBufQueue& writeBuf) {
+  auto ret = call_->generateSettingsAck(writeBuf);
+  recordEgress(0, FrameType::SETTINGS, http2::ACK, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generateWindowUpdate(folly::IOBufQueue& writeBuf,
+                                              StreamID stream,
+                                              uint32_t delta) {
+  auto ret = call_->generateWindowUpdate(writeBuf, stream, delta);
+  recordEgress(stream, FrameType::WINDOW_UPDATE, 0, ret);
+  return ret;
+}
+
+size_t FrameTraceFilter::generatePriority(
+    folly::IOBufQueue& writeBuf,
+    StreamID stream,
+    const HTTPMessage::HTTPPriority& pri) {
+  auto ret = call_->generatePriority(writeBuf, stream, pri);
+  recordEgress(stream, FrameType::PRIORITY, 0, ret);
+  return ret;
+}
+
+}
@@ -0,0 +1,165 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <proxygen/lib/http/codec/HTTP2Framer.h>
+#include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * A compact binary record of one frame parsed or generated by a codec.
+ */
+struct FrameTraceRecord {
+  enum Direction : uint8_t { INGRESS = 0, EGRESS = 1 };
+
+  // System clock, in microseconds since the epoch
+  uint64_t timestampUs;
+  uint64_t streamID;
+  // The frame payload length on ingress, the bytes generated on egress
+  uint32_t length;
+  // The codec's frame type on ingress, an http2::FrameType on egress
+  uint8_t type;
+  // The frame flags; on egress, only END_STREAM and ACK
+  uint8_t flags;
+  Direction direction;
+  uint8_t reserved{0};
+};
+
+/**
+ * A codec filter keeping the last frames going through it in a ring buffer
+ * of FrameTraceRecords, cheap enough to leave on in production in place of
+ * HTTPCodecPrinter.  Recording a frame copies a record, without allocating,
+ * formatting or locking; the trace is only formatted once dumped.
+ *
+ * Ingress frames are the ones the codec reports through onFrameHeader(),
+ * so only framed codecs have any.  Egress frames are recorded per generate
+ * call, which may be several frames on the wire, such as a large body.
+ *
+ * Like the codec, the filter may only be used from its session's thread.
+ */
+class FrameTraceFilter : public PassThroughHTTPCodecFilter {
+ public:
+  explicit FrameTraceFilter(size_t maxFrames);
+
+  // The records, oldest first
+  std::vector<FrameTraceRecord> getRecords() const;
+
+  // Frames recorded since the filter was created, including overwritten ones
+  uint64_t getNumFramesSeen() const {
+    return next_;
+  }
+
+  /**
+   * Serializes the records, oldest first, for decode(), possibly in
+   * another process.
+   */
+  std::unique_ptr<folly::IOBuf> dump() const;
+
+  /**
+   * Parses the output of dump().  Returns false if it is not one.
+   */
+  static bool decode(folly::ByteRange data,
+                     CodecProtocol& protocol,
+                     std::vector<FrameTraceRecord>& records);
+
+  // A line of text describing record, of a trace of protocol
+  static std::string toString(const FrameTraceRecord& record,
+                              CodecProtocol protocol);
+
+  // HTTPCodec::Callback methods
+  void onFrameHeader(StreamID stream,
+                     uint8_t flags,
+                     uint64_t length,
+                     uint64_t type,
+                     uint16_t version = 0) override;
+
+  // HTTPCodec methods
+  void generateHeader(folly::IOBufQueue& writeBuf,
+                      StreamID stream,
+                      const HTTPMessage& msg,
+                      bool eom,
+                      HTTPHeaderSize* size) override;
+
+  void generatePushPromise(folly::IOBufQueue& writeBuf,
+                           StreamID stream,
+                           const HTTPMessage& msg,
+                           StreamID assocStream,
+                           bool eom,
+                           HTTPHeaderSize* size) override;
+
+  void generateExHeader(folly::IOBufQueue& writeBuf,
+                        StreamID stream,
+                        const HTTPMessage& msg,
+                        const HTTPCodec::ExAttributes& exAttributes,
+                        bool eom,
+                        HTTPHeaderSize* size) override;
+
+  size_t generateBody(folly::IOBufQueue& writeBuf,
+                      StreamID stream,
+                      std::unique_ptr<folly::IOBuf> chain,
+                      folly::Optional<uint8_t> padding,
+                      bool eom) override;
+
+  size_t generateTrailers(folly::IOBufQueue& writeBuf,
+                          StreamID stream,
+                          const HTTPHeaders& trailers) override;
+
+  size_t generateEOM(folly::IOBufQueue& writeBuf,
+                     StreamID stream) override;
+
+  size_t generateRstStream(folly::IOBufQueue& writeBuf,
+                           StreamID stream,
+                           ErrorCode statusCode) override;
+
+  size_t generateGoaway(
+    folly::IOBufQueue& writeBuf,
+    StreamID lastStream,
+    ErrorCode statusCode,
+    std::unique_ptr<folly::IOBuf> debugData = nullptr) override;
+
+  size_t generatePingRequest(folly::IOBufQueue& writeBuf) override;
+
+  size_t generatePingReply(folly::IOBufQueue& writeBuf,
+                           uint64_t uniqueID) override;
+
+  size_t generateSettings(folly::IOBufQueue& writeBuf) override;
+
+  size_t generateSettingsAck(folly::IOBufQueue& writeBuf) override;
+
+  size_t generateWindowUpdate(folly::IOBufQueue& writeBuf,
+                              StreamID stream,
+                              uint32_t delta) override;
+
+  size_t generatePriority(folly::IOBufQueue& writeBuf,
+                          StreamID stream,
+                          const HTTPMessage::HTTPPriority& pri) override;
+
+ private:
+  void record(FrameTraceRecord::Direction direction,
+              StreamID stream,
+              uint8_t type,
+              uint8_t flags,
+              uint64_t length);
+
+  void recordEgress(StreamID stream,
+                    http2::FrameType type,
+                    uint8_t flags,
+                    uint64_t length);
+
+  std::vector<FrameTraceRecord> records_;
+  // The index of the next record, modulo records_.size()
+  uint64_t next_{0};
+};
+
+}
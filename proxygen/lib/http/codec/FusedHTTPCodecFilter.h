@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <initializer_list>
+#include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+
+namespace proxygen {
+
+/**
+ * The filter F with stateless checks fused into it at compile time, as one
+ * link of the FilterChain.  Each of Checks provides the static hooks
+ * HTTPChecks does, which run inline, in order, before F sees the headers;
+ * the other calls and callbacks are F's own.  In the dynamic chain every
+ * filter is a virtual hop for every frame, whether it looks at it or not.
+ *
+ *   using CheckedFlowControlFilter =
+ *     FusedHTTPCodecFilter<FlowControlFilter, HTTPChecks>;
+ *
+ * Filters that are only sometimes wanted are still added with addFilters().
+ */
+template <typename F, typename... Checks>
+class FusedHTTPCodecFilter final : public F {
+ public:
+  using F::F;
+
+  void onHeadersComplete(HTTPCodec::StreamID stream,
+                         std::unique_ptr<HTTPMessage> msg) override {
+    bool ok = true;
+    // Stops at the first check rejecting msg, which reports it through this
+    // filter as its own callback would
+    (void)std::initializer_list<int>{
+      (ok = ok && Checks::checkIngressHeaders(stream, *msg, *this), 0)...};
+    if (ok) {
+      F::onHeadersComplete(stream, std::move(msg));
+    }
+  }
+
+  void generateHeader(folly::IOBufQueue& writeBuf,
+                      HTTPCodec::StreamID stream,
+                      const HTTPMessage& msg,
+                      bool eom,
+                      HTTPHeaderSize* sizeOut) override {
+    (void)std::initializer_list<int>{
+      (Checks::checkEgressHeaders(msg), 0)...};
+    F::generateHeader(writeBuf, stream, msg, eom, sizeOut);
+  }
+};
+
+}
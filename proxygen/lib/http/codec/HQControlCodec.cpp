@@ -65,6 +65,18 @@ ParseResult HQControlCodec::parsePriority(Cursor& cursor,
                                           const FrameHeader& header) {
   PriorityUpdate outPriority;
   auto res = hq::parsePriority(cursor, header, outPriority);
+  // Placeholders and push streams are not prioritized
+  if (!res && callback_ &&
+      outPriority.prioritizedType == PriorityElementType::REQUEST_STREAM) {
+    auto dependency =
+        outPriority.dependencyType == PriorityElementType::REQUEST_STREAM
+            ? outPriority.elementDependencyId
+            : kSessionStreamId;
+    callback_->onPriority(
+        outPriority.prioritizedElementId,
+        HTTPMessage::HTTPPriority(
+            dependency, outPriority.exclusive, outPriority.weight));
+  }
   return res;
 }
 
@@ -91,6 +103,8 @@ ParseResult HQControlCodec::parseSettings(Cursor& cursor,
       case hq::SettingId::HEADER_TABLE_SIZE:
       case hq::SettingId::MAX_HEADER_LIST_SIZE:
       case hq::SettingId::QPACK_BLOCKED_STREAMS:
+      case hq::SettingId::H3_DATAGRAM:
+      case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
         break;
       case hq::SettingId::NUM_PLACEHOLDERS:
         if (transportDirection_ == TransportDirection::DOWNSTREAM) {
@@ -161,6 +175,8 @@ size_t HQControlCodec::generateSettings(folly::IOBufQueue& writeBuf) {
         case hq::SettingId::HEADER_TABLE_SIZE:
         case hq::SettingId::MAX_HEADER_LIST_SIZE:
         case hq::SettingId::QPACK_BLOCKED_STREAMS:
+        case hq::SettingId::H3_DATAGRAM:
+        case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
           break;
         case hq::SettingId::NUM_PLACEHOLDERS:
           CHECK_NE(setting.value, 0);
@@ -105,7 +105,8 @@ class HQControlCodec
   }
 
   bool peerHasWebsockets() const {
-    return false;
+    return isIngress() &&
+      settings_.getSetting(SettingsId::ENABLE_CONNECT_PROTOCOL);
   }
 
   void setHeaderCodecStats(HeaderCodec::Stats* /*hcStats*/) override {
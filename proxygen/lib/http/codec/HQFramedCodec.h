@@ -355,6 +355,10 @@ class HQFramedCodec : public HTTPCodec {
     return totalBytesParsed_;
   }
 
+  bool hasConnectionError() const {
+    return connError_ != folly::none;
+  }
+
   virtual bool transportSupportsPartialReliability() const {
     return false;
   }
@@ -177,6 +177,13 @@ decodeSettingValue(folly::io::Cursor& cursor,
     case SettingId::MAX_HEADER_LIST_SIZE:
     case SettingId::QPACK_BLOCKED_STREAMS:
       return value;
+    case SettingId::ENABLE_CONNECT_PROTOCOL:
+    case SettingId::H3_DATAGRAM:
+      if (value > 1) {
+        return folly::makeUnexpected(
+            HTTP3::ErrorCode::HTTP_MALFORMED_FRAME_SETTINGS);
+      }
+      return value;
   }
   return folly::none;
 }
@@ -290,6 +297,19 @@ WriteResult writeSimpleFrame(IOBufQueue& queue,
                              std::unique_ptr<folly::IOBuf> data) noexcept {
   DCHECK(data);
   auto payloadSize = data->computeChainDataLength();
+  auto typeSize = quic::getQuicIntegerSize(static_cast<uint64_t>(type));
+  auto lengthSize = quic::getQuicIntegerSize(payloadSize);
+  if (typeSize && lengthSize && queue.tailroom() < *typeSize + *lengthSize &&
+      !data->isSharedOne() && data->headroom() >= *typeSize + *lengthSize) {
+    // Rather than in a buffer of its own, write the header in the headroom the
+    // payload's producer left
+    data->prepend(*typeSize + *lengthSize);
+    RWPrivateCursor cursor(data.get());
+    quic::encodeQuicInteger(static_cast<uint64_t>(type), cursor);
+    quic::encodeQuicInteger(payloadSize, cursor);
+    queue.append(std::move(data));
+    return *typeSize + *lengthSize + payloadSize;
+  }
   auto headerSize = writeFrameHeader(queue, type, payloadSize);
   if (headerSize.hasError()) {
     return headerSize;
@@ -439,6 +459,35 @@ WriteResult writeMaxPushId(folly::IOBufQueue& writeBuf,
   return writeSimpleFrame(writeBuf, FrameType::MAX_PUSH_ID, queue.move());
 }
 
+WriteResult writeDatagram(folly::IOBufQueue& writeBuf,
+                          quic::StreamId streamId,
+                          std::unique_ptr<folly::IOBuf> payload) noexcept {
+  // Client initiated bidirectional streams only
+  DCHECK_EQ(streamId & 0x03, 0);
+  QueueAppender appender(&writeBuf, kMaxFrameHeaderSize);
+  auto streamIdRes = quic::encodeQuicInteger(streamId >> 2, appender);
+  if (streamIdRes.hasError()) {
+    return streamIdRes;
+  }
+  size_t payloadSize = 0;
+  if (payload) {
+    payloadSize = payload->computeChainDataLength();
+    appender.insert(std::move(payload));
+  }
+  return *streamIdRes + payloadSize;
+}
+
+ParseResult parseDatagram(folly::io::Cursor& cursor,
+                          quic::StreamId& outStreamId) noexcept {
+  auto quarterStreamId = quic::decodeQuicInteger(cursor);
+  if (!quarterStreamId ||
+      quarterStreamId->first > (quic::kEightByteLimit >> 2)) {
+    return HTTP3::ErrorCode::HTTP_DATAGRAM_ERROR;
+  }
+  outStreamId = quarterStreamId->first << 2;
+  return folly::none;
+}
+
 const char* getFrameTypeString(FrameType type) {
   switch (type) {
     case FrameType::DATA:
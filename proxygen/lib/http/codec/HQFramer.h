@@ -122,7 +122,11 @@ enum class SettingId : uint64_t {
   HEADER_TABLE_SIZE = 0x01,
   MAX_HEADER_LIST_SIZE = 0x06,
   QPACK_BLOCKED_STREAMS = 0x07,
+  // RFC 9220, 1 when the endpoint accepts extended CONNECT
+  ENABLE_CONNECT_PROTOCOL = 0x08,
   NUM_PLACEHOLDERS = 0x09,
+  // RFC 9297, 1 when the endpoint accepts HTTP datagrams
+  H3_DATAGRAM = 0x33,
 };
 
 using SettingValue = uint64_t;
@@ -386,4 +390,31 @@ WriteResult writeGoaway(folly::IOBufQueue& writeBuf,
 WriteResult writeMaxPushId(folly::IOBufQueue& writeBuf,
                            PushId maxPushId) noexcept;
 
+//// HTTP Datagrams (RFC 9297) ////
+
+/**
+ * Generate the payload of a QUIC DATAGRAM frame carrying an HTTP datagram:
+ * the quarter stream ID of its request stream, then the datagram.
+ *
+ * @param writeBuf The output queue to write to.
+ * @param streamId The request stream the datagram belongs to.
+ * @param payload The HTTP datagram payload, may be nullptr for an empty one
+ * @return The number of bytes written to writeBuf if successful, a quic error
+ * otherwise
+ */
+WriteResult writeDatagram(folly::IOBufQueue& writeBuf,
+                          quic::StreamId streamId,
+                          std::unique_ptr<folly::IOBuf> payload) noexcept;
+
+/**
+ * Parses the request stream of an HTTP datagram from the payload of a QUIC
+ * DATAGRAM frame, leaving the cursor at the HTTP datagram payload.
+ *
+ * @param cursor The cursor to pull data from.
+ * @param outStreamId The request stream ID.
+ * @return folly::none for successful parse or the quic application error code.
+ */
+ParseResult parseDatagram(folly::io::Cursor& cursor,
+                          quic::StreamId& outStreamId) noexcept;
+
 }} // namespace proxygen::hq
@@ -81,12 +81,30 @@ ParseResult HQStreamCodec::parseData(Cursor& cursor,
   // the HQSession can trap this and stop reading.
   // i.e we can immediately reset in onNewStream if we get a stream id
   // higher than MAXID advertised in the goaway
-  if (callback_ && (outData && !outData->empty())) {
-    callback_->onBody(streamId_, std::move(outData), 0);
+  //
+  // Consecutive DATA frames go to the callback together, at the end of
+  // onIngress() or before the next frame with a callback
+  if (outData && !outData->empty()) {
+    if (pendingBody_) {
+      pendingBody_->prependChain(std::move(outData));
+    } else {
+      pendingBody_ = std::move(outData);
+    }
   }
   return res;
 }
 
+void HQStreamCodec::deliverPendingBody() {
+  if (!pendingBody_) {
+    return;
+  }
+  auto body = std::move(pendingBody_);
+  // After a connection error the callback had onError() already
+  if (callback_ && !hasConnectionError()) {
+    callback_->onBody(streamId_, std::move(body), 0);
+  }
+}
+
 void HQStreamCodec::onIngressPartiallyReliableBodyStarted(
     uint64_t streamOffset) {
   CHECK(transportSupportsPartialReliability())
@@ -102,6 +120,8 @@ void HQStreamCodec::onIngressPartiallyReliableBodyStarted(
 
   partiallyReliable_ = true;
 
+  deliverPendingBody();
+
   if (callback_) {
     callback_->onUnframedBodyStarted(streamId_, streamOffset);
   }
@@ -128,6 +148,8 @@ ParseResult HQStreamCodec::parsePartiallyReliableData(Cursor& cursor) {
 
   ingressPrBodyTracker_.addBodyBytesProcessed(dataLength);
 
+  deliverPendingBody();
+
   if (callback_ && outData && !outData->empty()) {
     callback_->onBody(streamId_, std::move(outData), 0 /* padding */);
   }
@@ -136,6 +158,7 @@ ParseResult HQStreamCodec::parsePartiallyReliableData(Cursor& cursor) {
 
 ParseResult HQStreamCodec::parseHeaders(Cursor& cursor,
                                         const FrameHeader& header) {
+  deliverPendingBody();
   if (finalIngressHeadersSeen_) {
     // No Trailers for YOU!
     if (callback_) {
@@ -174,6 +197,7 @@ ParseResult HQStreamCodec::parseHeaders(Cursor& cursor,
 
 ParseResult HQStreamCodec::parsePushPromise(Cursor& cursor,
                                             const FrameHeader& header) {
+  deliverPendingBody();
   PushId outPushId;
   std::unique_ptr<IOBuf> outHeaderData;
   auto res = hq::parsePushPromise(cursor, header, outPushId, outHeaderData);
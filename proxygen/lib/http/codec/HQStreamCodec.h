@@ -68,7 +68,9 @@ class HQStreamCodec
   }
 
   size_t onIngress(const folly::IOBuf& buf) override {
-    return onFramedIngress(buf);
+    auto parsed = onFramedIngress(buf);
+    deliverPendingBody();
+    return parsed;
   }
 
   void onIngressEOF() override {
@@ -145,7 +147,7 @@ class HQStreamCodec
   }
 
   bool peerHasWebsockets() const {
-    return false;
+    return ingressSettings_.getSetting(SettingsId::ENABLE_CONNECT_PROTOCOL);
   }
 
   bool isRequest(StreamID /*id*/) const {
@@ -204,6 +206,12 @@ class HQStreamCodec
   size_t generatePartiallyReliableBodyImpl(folly::IOBufQueue& writeBuf,
                                            std::unique_ptr<folly::IOBuf> chain);
 
+  /**
+   * Passes on the payloads of the DATA frames parsed since the last call
+   * in a single onBody().
+   */
+  void deliverPendingBody();
+
   uint64_t getCodecTotalEgressBytes() const {
     return totalEgressBytes_;
   }
@@ -223,6 +231,9 @@ class HQStreamCodec
 
   uint64_t totalEgressBytes_{0};
 
+  // DATA payloads of the current onIngress() call, clones of its buffer
+  std::unique_ptr<folly::IOBuf> pendingBody_;
+
   // This tells the codec what it should do when receiving a DATA frame with
   // length == 0. If partial reliability is enabled on trasport - allow, if not
   // - do not allow len 0.
@@ -55,6 +55,7 @@ proxygen::ErrorCode hqToHttpErrorCode(HTTP3::ErrorCode err) {
     case HTTP3::ErrorCode::HTTP_EARLY_RESPONSE:
     case HTTP3::ErrorCode::HTTP_MISSING_SETTINGS:
     case HTTP3::ErrorCode::HTTP_UNEXPECTED_FRAME:
+    case HTTP3::ErrorCode::HTTP_DATAGRAM_ERROR:
       return ErrorCode::PROTOCOL_ERROR;
     case HTTP3::ErrorCode::HTTP_REQUEST_REJECTED:
       // Not sure this makes sense...
@@ -142,6 +143,10 @@ folly::Optional<hq::SettingId> httpToHqSettingsId(proxygen::SettingsId id) {
       return hq::SettingId::NUM_PLACEHOLDERS;
     case proxygen::SettingsId::_HQ_QPACK_BLOCKED_STREAMS:
       return hq::SettingId::QPACK_BLOCKED_STREAMS;
+    case proxygen::SettingsId::_HQ_DATAGRAM:
+      return hq::SettingId::H3_DATAGRAM;
+    case proxygen::SettingsId::ENABLE_CONNECT_PROTOCOL:
+      return hq::SettingId::ENABLE_CONNECT_PROTOCOL;
     default:
       return folly::none; // this setting has no meaning in HQ
   }
@@ -158,6 +163,10 @@ folly::Optional<proxygen::SettingsId> hqToHttpSettingsId(hq::SettingId id) {
       return proxygen::SettingsId::MAX_HEADER_LIST_SIZE;
     case hq::SettingId::QPACK_BLOCKED_STREAMS:
       return proxygen::SettingsId::_HQ_QPACK_BLOCKED_STREAMS;
+    case hq::SettingId::H3_DATAGRAM:
+      return proxygen::SettingsId::_HQ_DATAGRAM;
+    case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
+      return proxygen::SettingsId::ENABLE_CONNECT_PROTOCOL;
   }
   return folly::none;
 }
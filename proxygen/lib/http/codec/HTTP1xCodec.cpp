@@ -28,6 +28,10 @@ namespace {
 static const std::string kChunked = "chunked";
 const char CRLF[] = "\r\n";
 
+// The largest Content-Length body delivered with its headers and EOM, in one
+// onMessage(), when the whole request is in one read
+const uint64_t kMaxBatchedBodyLength = 16 * 1024;
+
 /**
  * Write an ASCII decimal representation of an integer value
  * @note This function does -not- append a trailing null byte.
@@ -103,12 +107,17 @@ HTTP1xCodec::HTTP1xCodec(TransportDirection direction, bool forceUpstream1_1)
       expectNoResponseBody_(false),
       mayChunkEgress_(false),
       is1xxResponse_(false),
+      http10Request_(false),
       inRecvLastChunk_(false),
       ingressUpgrade_(false),
       ingressUpgradeComplete_(false),
       egressUpgrade_(false),
       nativeUpgrade_(false),
-      headersComplete_(false) {
+      headersComplete_(false),
+      transferEncodingSeen_(false),
+      badTransferEncoding_(false),
+      multipleTransferEncodings_(false),
+      contentLengthMismatch_(false) {
   switch (direction) {
   case TransportDirection::DOWNSTREAM:
     http_parser_init(&parser_, HTTP_REQUEST);
@@ -219,6 +228,16 @@ HTTP1xCodec::onIngress(const IOBuf& buf) {
       currentHeaderName_.assign(currentHeaderNameStringPiece_.begin(),
                                 currentHeaderNameStringPiece_.size());
     }
+    if (currentHeaderValue_.empty() &&
+        !currentHeaderValueStringPiece_.empty()) {
+      // same as above, for a partially parsed header value
+      currentHeaderValue_.assign(currentHeaderValueStringPiece_.begin(),
+                                 currentHeaderValueStringPiece_.size());
+    }
+    if (pendingMsg_) {
+      // The rest of the body is for the next reads
+      flushPendingMessage();
+    }
     currentIngressBuf_ = nullptr;
     if (pendingEOF_) {
       onIngressEOF();
@@ -256,6 +275,7 @@ HTTP1xCodec::onIngressEOF() {
 
 void
 HTTP1xCodec::onParserError(const char* what) {
+  flushPendingMessage();
   inRecvLastChunk_ = false;
   http_errno parser_errno = HTTP_PARSER_ERRNO(&parser_);
   HTTPException error(HTTPException::Direction::INGRESS,
@@ -380,6 +400,18 @@ HTTP1xCodec::generateHeader(IOBufQueue& writeBuf,
     headRequest_ = (msg.getMethod() == HTTPMethod::HEAD);
     expectNoResponseBody_ = connectRequest_ || headRequest_;
   } else {
+    if (msg.is1xxResponse() && msg.getStatusCode() != 101 &&
+        !msg.isEgressWebsocketUpgrade() && http10Request_) {
+      // RFC7231 6.2: no 1xx for HTTP/1.0 clients, which would take it for
+      // the final response
+      VLOG(4) << "Dropping " << msg.getStatusCode() << " response to an "
+              << "HTTP/1.0 request";
+      if (size) {
+        size->compressed = 0;
+        size->uncompressed = 0;
+      }
+      return;
+    }
     // In HTTP, transactions must be egressed sequentially -- no out of order
     // responses.  So txn must be egressTxnID_ + 1.  Furthermore, we shouldn't
     // ever egress a response before we see a request, so txn can't
@@ -508,6 +540,13 @@ HTTP1xCodec::generateHeader(IOBufQueue& writeBuf,
   size_t lastConnectionToken = 0;
   bool egressWebsocketUpgrade = msg.isEgressWebsocketUpgrade();
   bool hasUpgradeTokeninConnection = false;
+  if (msg.getHeaderTemplate()) {
+    // Template headers never need the per-header processing below, so the
+    // pre-rendered block is shared into the output as is.
+    const auto& block = msg.getHeaderTemplate()->getHTTP1xBlock();
+    len += block.length();
+    writeBuf.append(block.clone());
+  }
   msg.getHeaders().forEachWithCode([&] (HTTPHeaderCode code,
                                         const string& header,
                                         const string& value) {
@@ -817,6 +856,11 @@ const std::string& HTTP1xCodec::getAllowedUpgradeProtocols() {
 int
 HTTP1xCodec::onMessageBegin() {
   headersComplete_ = false;
+  transferEncodingSeen_ = false;
+  badTransferEncoding_ = false;
+  multipleTransferEncodings_ = false;
+  contentLengthMismatch_ = false;
+  contentLength_.reset();
   headerSize_.uncompressed = 0;
   headerParseState_ = HeaderParseState::kParsingHeaderStart;
   msg_.reset(new HTTPMessage());
@@ -850,19 +894,56 @@ HTTP1xCodec::onReason(const char* buf, size_t len) {
 }
 
 void HTTP1xCodec::pushHeaderNameAndValue(HTTPHeaders& hdrs) {
+  // The value is copied exactly once, straight out of the ingress buffer
+  // when it was contiguous.  currentHeaderValue_ is cleared rather than moved
+  // from so its capacity is reused by the next header that needs it.
+  folly::StringPiece value = LIKELY(currentHeaderValue_.empty())
+    ? currentHeaderValueStringPiece_
+    : folly::StringPiece(currentHeaderValue_);
+  HTTPHeaderCode code;
   if (LIKELY(currentHeaderName_.empty())) {
-    hdrs.addFromCodec(currentHeaderNameStringPiece_.begin(),
-                      currentHeaderNameStringPiece_.size(),
-                      std::move(currentHeaderValue_));
+    code = hdrs.addFromCodec(currentHeaderNameStringPiece_.begin(),
+                             currentHeaderNameStringPiece_.size(),
+                             value);
   } else {
-    hdrs.add(currentHeaderName_,
-             std::move(currentHeaderValue_));
+    code = hdrs.addFromCodec(currentHeaderName_.data(),
+                             currentHeaderName_.size(),
+                             value);
     currentHeaderName_.clear();
   }
+  if (&hdrs == &msg_->getHeaders()) {
+    checkHeader(code, folly::rtrimWhitespace(value));
+  }
   currentHeaderNameStringPiece_.clear();
+  currentHeaderValueStringPiece_.clear();
   currentHeaderValue_.clear();
 }
 
+void HTTP1xCodec::checkHeader(HTTPHeaderCode code, folly::StringPiece value) {
+  // Records what onHeadersComplete() validates, as each header is added,
+  // rather than looking the headers up again there
+  switch (code) {
+    case HTTP_HEADER_TRANSFER_ENCODING:
+      if (transferEncodingSeen_) {
+        multipleTransferEncodings_ = true;
+      } else {
+        transferEncodingSeen_ = true;
+        badTransferEncoding_ =
+          !value.empty() && !caseInsensitiveEqual(value, kChunked);
+      }
+      break;
+    case HTTP_HEADER_CONTENT_LENGTH:
+      if (!contentLength_) {
+        contentLength_ = value.str();
+      } else if (*contentLength_ != value) {
+        contentLengthMismatch_ = true;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
 int
 HTTP1xCodec::onHeaderField(const char* buf, size_t len) {
   if (headerParseState_ == HeaderParseState::kParsingHeaderValue) {
@@ -919,7 +1000,20 @@ HTTP1xCodec::onHeaderValue(const char* buf, size_t len) {
   } else {
     headerParseState_ = HeaderParseState::kParsingTrailerValue;
   }
-  currentHeaderValue_.append(buf, len);
+  if (!currentHeaderValue_.empty()) {
+    // we had already fallen back to currentHeaderValue_ before
+    currentHeaderValue_.append(buf, len);
+  } else if (currentHeaderValueStringPiece_.empty()) {
+    // first chunk of the value; keep pointing into the ingress buffer
+    currentHeaderValueStringPiece_.reset(buf, len);
+  } else if (currentHeaderValueStringPiece_.end() == buf) {
+    currentHeaderValueStringPiece_.advance(len);
+  } else {
+    // discontiguous, e.g. the synthetic space for folded values
+    currentHeaderValue_.assign(currentHeaderValueStringPiece_.begin(),
+                               currentHeaderValueStringPiece_.size());
+    currentHeaderValue_.append(buf, len);
+  }
   return 0;
 }
 
@@ -932,31 +1026,17 @@ HTTP1xCodec::onHeadersComplete(size_t len) {
   // discard messages with folded or multiple valued Transfer-Encoding headers
   // ex : "chunked , zorg\r\n" or "\r\n chunked \r\n" (t12767790)
   HTTPHeaders& hdrs = msg_->getHeaders();
-  const std::string& headerVal =
-    hdrs.getSingleOrEmpty(HTTP_HEADER_TRANSFER_ENCODING);
-  if (!headerVal.empty() && !caseInsensitiveEqual(headerVal, kChunked)) {
-      LOG(ERROR) << "Invalid Transfer-Encoding header. Value =" << headerVal;
+  if (badTransferEncoding_ && !multipleTransferEncodings_) {
+      LOG(ERROR) << "Invalid Transfer-Encoding header. Value ="
+                 << hdrs.getSingleOrEmpty(HTTP_HEADER_TRANSFER_ENCODING);
       return -1;
   }
 
-  // discard messages with multiple content-length headers (t12767790)
-  if (hdrs.getNumberOfValues(HTTP_HEADER_CONTENT_LENGTH) > 1) {
-    // Only reject the message if the Content-Length headers have different
-    // values
-    folly::Optional<folly::StringPiece> contentLen;
-    bool error = hdrs.forEachValueOfHeader(
-        HTTP_HEADER_CONTENT_LENGTH, [&] (folly::StringPiece value) -> bool {
-      if (!contentLen.hasValue()) {
-        contentLen = value;
-        return false;
-      }
-      return (contentLen.value() != value);
-    });
-
-    if (error) {
-      LOG(ERROR) << "Invalid message, multiple Content-Length headers";
-      return -1;
-    }
+  // discard messages with multiple content-length headers (t12767790), but
+  // only if the Content-Length headers have different values
+  if (contentLengthMismatch_) {
+    LOG(ERROR) << "Invalid message, multiple Content-Length headers";
+    return -1;
   }
 
   // Update the HTTPMessage with the values parsed from the header
@@ -988,6 +1068,7 @@ HTTP1xCodec::onHeadersComplete(size_t len) {
     // If the client sent us an HTTP/1.x with x >= 1, we may send
     // chunked responses.
     mayChunkEgress_ = ((parser_.http_major == 1) && (parser_.http_minor >= 1));
+    http10Request_ = !mayChunkEgress_;
   } else {
     msg_->setStatusCode(parser_.status_code);
     msg_->setStatusMessage(std::move(reason_));
@@ -1133,7 +1214,16 @@ HTTP1xCodec::onHeadersComplete(size_t len) {
   if (userAgent_.empty()) {
     userAgent_ = msg_->getHeaders().getSingleOrEmpty(HTTP_HEADER_USER_AGENT);
   }
-  callback_->onHeadersComplete(ingressTxnID_, std::move(msg_));
+  if (transportDirection_ == TransportDirection::DOWNSTREAM &&
+      !upgradeRequest_ && !parser_.upgrade && !nativeUpgrade_ &&
+      !(parser_.flags & F_CHUNKED) && parser_.content_length > 0 &&
+      parser_.content_length <= kMaxBatchedBodyLength) {
+    // The body may well be in this read, to deliver all at once
+    pendingMsg_ = std::move(msg_);
+    pendingBodyLength_ = parser_.content_length;
+  } else {
+    callback_->onHeadersComplete(ingressTxnID_, std::move(msg_));
+  }
 
   // 1 is a magic value that tells the http_parser not to expect a
   // message body even if the message header implied the presence
@@ -1154,10 +1244,27 @@ HTTP1xCodec::onBody(const char* buf, size_t len) {
   clone->trimStart(buf - dataStart);
   clone->trimEnd(dataEnd - (buf + len));
   DCHECK_EQ(len, clone->computeChainDataLength());
+  if (pendingMsg_) {
+    if (len == pendingBodyLength_) {
+      pendingBody_ = std::move(clone);
+      return 0;
+    }
+    flushPendingMessage();
+  }
   callback_->onBody(ingressTxnID_, std::move(clone), 0);
   return 0;
 }
 
+void HTTP1xCodec::flushPendingMessage() {
+  if (!pendingMsg_) {
+    return;
+  }
+  callback_->onHeadersComplete(ingressTxnID_, std::move(pendingMsg_));
+  if (pendingBody_) {
+    callback_->onBody(ingressTxnID_, std::move(pendingBody_), 0);
+  }
+}
+
 int HTTP1xCodec::onChunkHeader(size_t len) {
   if (len > 0) {
     callback_->onChunkHeader(ingressTxnID_, len);
@@ -1211,6 +1318,14 @@ int HTTP1xCodec::onMessageComplete() {
     responsePending_ = is1xxResponse_;
   }
 
+  if (pendingMsg_) {
+    // Neither an upgrade nor chunked, so no trailers
+    DCHECK(!ingressUpgrade_);
+    callback_->onMessage(ingressTxnID_, std::move(pendingMsg_),
+                         std::move(pendingBody_));
+    return 0;
+  }
+
   // For downstream, always call onMessageComplete. If native upgrade,
   // pass upgrade=false. Else pass ingressUpgrade_.
   // For upstream, call onMessagComplete if not native upgrade.
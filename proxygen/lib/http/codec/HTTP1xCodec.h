@@ -57,6 +57,7 @@ class HTTP1xCodec : public HTTPCodec {
   bool closeOnEgressComplete() const override { return egressUpgrade_; }
   bool supportsParallelRequests() const override { return false; }
   bool supportsPushTransactions() const override { return false; }
+  bool supportsHeaderTemplates() const override { return true; }
   void generateHeader(folly::IOBufQueue& writeBuf,
                       StreamID txn,
                       const HTTPMessage& msg,
@@ -141,6 +142,7 @@ class HTTP1xCodec : public HTTPCodec {
 
   /** Push out header name-value pair to hdrs and clear currentHeader*_ */
   void pushHeaderNameAndValue(HTTPHeaders& hdrs);
+  void checkHeader(HTTPHeaderCode code, folly::StringPiece value);
 
   /** Serialize websocket headers into a buffer **/
   void serializeWebsocketHeader(folly::IOBufQueue& writeBuf, size_t& len,
@@ -158,6 +160,9 @@ class HTTP1xCodec : public HTTPCodec {
   int onChunkComplete();
   int onMessageComplete();
 
+  // Delivers the headers, and body, held for a batch that did not complete
+  void flushPendingMessage();
+
   HTTPCodec::Callback* callback_;
   StreamID ingressTxnID_;
   StreamID egressTxnID_;
@@ -165,14 +170,21 @@ class HTTP1xCodec : public HTTPCodec {
   const folly::IOBuf* currentIngressBuf_;
   std::unique_ptr<HTTPMessage> msg_;
   std::unique_ptr<HTTPMessage> upgradeRequest_;
+  // A request with a small body, held for onMessage() until the end of the
+  // read, if the body and EOM don't come with it
+  std::unique_ptr<HTTPMessage> pendingMsg_;
+  std::unique_ptr<folly::IOBuf> pendingBody_;
+  uint64_t pendingBodyLength_{0};
   std::unique_ptr<HTTPHeaders> trailers_;
   std::string currentHeaderName_;
   folly::StringPiece currentHeaderNameStringPiece_;
   std::string currentHeaderValue_;
+  folly::StringPiece currentHeaderValueStringPiece_;
   std::string url_;
   std::string userAgent_;
   std::string reason_;
   std::string upgradeHeader_; // last sent/received client upgrade header
+  folly::Optional<std::string> contentLength_; // first ingress Content-Length
   std::string allowedNativeUpgrades_; // DOWNSTREAM only
   HTTPHeaderSize headerSize_;
   HeaderParseState headerParseState_;
@@ -197,12 +209,18 @@ class HTTP1xCodec : public HTTPCodec {
   bool expectNoResponseBody_:1;
   bool mayChunkEgress_:1;
   bool is1xxResponse_:1;
+  // The request is HTTP/1.0, which can't be answered with 1xx responses
+  bool http10Request_:1;
   bool inRecvLastChunk_:1;
   bool ingressUpgrade_:1;
   bool ingressUpgradeComplete_:1;
   bool egressUpgrade_:1;
   bool nativeUpgrade_:1;
   bool headersComplete_:1;
+  bool transferEncodingSeen_:1;
+  bool badTransferEncoding_:1;
+  bool multipleTransferEncodings_:1;
+  bool contentLengthMismatch_:1;
 
   // C-callable wrappers for the http_parser callbacks
   static int onMessageBeginCB(http_parser* parser);
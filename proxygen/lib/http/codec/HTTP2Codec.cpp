@@ -17,6 +17,7 @@
 #include <folly/Random.h>
 #include <folly/ThreadLocal.h>
 #include <folly/io/Cursor.h>
+#include <folly/small_vector.h>
 #include <folly/tracing/ScopedTraceSection.h>
 #include <type_traits>
 
@@ -31,9 +32,8 @@ std::string base64url_encode(ByteRange range) {
   return proxygen::Base64::urlEncode(range);
 }
 
-std::string base64url_decode(const std::string& str) {
-  return proxygen::Base64::urlDecode(str);
-}
+// Settings in most HTTP2-Settings headers, decoded without an allocation
+constexpr size_t kInlineUpgradeSettings = 8;
 
 }
 
@@ -103,6 +103,10 @@ size_t HTTP2Codec::onIngress(const folly::IOBuf& buf) {
           VLOG(4) << "Excessively large frame len=" << curHeader_.length;
           connError = ErrorCode::FRAME_SIZE_ERROR;
         }
+        if (curHeader_.type != http2::FrameType::WINDOW_UPDATE &&
+            curHeader_.type != http2::FrameType::PING) {
+          flushWindowUpdates(curHeader_.stream);
+        }
 
         if (callback_) {
           callback_->onFrameHeader(
@@ -150,10 +154,42 @@ size_t HTTP2Codec::onIngress(const folly::IOBuf& buf) {
       }
     }
   }
+  flushWindowUpdates(0);
   checkConnectionError(connError, &buf);
   return parsed;
 }
 
+void HTTP2Codec::flushWindowUpdates(StreamID stream) {
+  if (pendingWindowUpdates_.empty()) {
+    return;
+  }
+  if (stream == 0) {
+    auto updates = std::move(pendingWindowUpdates_);
+    pendingWindowUpdates_.clear();
+    for (const auto& update : updates) {
+      deliverWindowUpdate(update.first, update.second);
+    }
+    return;
+  }
+  auto it = std::find_if(
+    pendingWindowUpdates_.begin(), pendingWindowUpdates_.end(),
+    [stream] (const std::pair<StreamID, uint32_t>& update) {
+      return update.first == stream;
+    });
+  if (it != pendingWindowUpdates_.end()) {
+    auto delta = it->second;
+    pendingWindowUpdates_.erase(it);
+    deliverWindowUpdate(stream, delta);
+  }
+}
+
+void HTTP2Codec::deliverWindowUpdate(StreamID stream, uint32_t delta) {
+  // if window exceeds 2^31-1, connection/stream error flow control error
+  // must be checked in session/txn
+  deliverCallbackIfAllowed(&HTTPCodec::Callback::onWindowUpdate,
+                           "onWindowUpdate", stream, delta);
+}
+
 ErrorCode HTTP2Codec::parseFrame(folly::io::Cursor& cursor) {
   FOLLY_SCOPED_TRACE_SECTION("HTTP2Codec - parseFrame");
   if (expectedContinuationStream_ != 0 &&
@@ -175,17 +211,16 @@ ErrorCode HTTP2Codec::parseFrame(folly::io::Cursor& cursor) {
     return ErrorCode::PROTOCOL_ERROR;
   }
   if (frameAffectsCompression(curHeader_.type) &&
-      curHeaderBlock_.chainLength() + curHeader_.length >
+      headerBlockSize_ + curHeader_.length >
       egressSettings_.getSetting(SettingsId::MAX_HEADER_LIST_SIZE, 0)) {
     // this may be off by up to the padding length (max 255), but
     // these numbers are already so generous, and we're comparing the
     // max-uncompressed to the actual compressed size.  Let's fail
     // before buffering.
 
-    // TODO(t6513634): it would be nicer to stream-process this header
-    // block to keep the connection state consistent without consuming
-    // memory, and fail just the request per the HTTP/2 spec (section
-    // 10.3)
+    // TODO(t6513634): it would be nicer to keep decoding this header
+    // block to keep the connection state consistent, and fail just the
+    // request per the HTTP/2 spec (section 10.3)
     goawayErrorMessage_ = folly::to<string>(
       "Failing connection due to excessively large headers");
     LOG(ERROR) << goawayErrorMessage_;
@@ -421,19 +456,18 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
     const folly::Optional<http2::PriorityUpdate>& priority,
     const folly::Optional<uint32_t>& promisedStream,
     const folly::Optional<ExAttributes>& exAttributes) {
-  curHeaderBlock_.append(std::move(headerBuf));
-  std::unique_ptr<HTTPMessage> msg;
-  if (curHeader_.flags & http2::END_HEADERS) {
-    auto errorCode =
-        parseHeadersDecodeFrames(priority, promisedStream, exAttributes, msg);
-    if (errorCode.hasValue()) {
-      return errorCode.value();
-    }
-  }
-
   // if we're not parsing CONTINUATION, then it's start of new header block
   if (curHeader_.type != http2::FrameType::CONTINUATION) {
     headerBlockFrameType_ = curHeader_.type;
+    parseHeadersBegin(priority, promisedStream, exAttributes);
+  }
+
+  headerBlockSize_ += headerBuf->computeChainDataLength();
+  curHeaderBlock_.append(std::move(headerBuf));
+  std::unique_ptr<HTTPMessage> msg;
+  auto errorCode = parseHeadersDecodeFrames(priority, msg);
+  if (errorCode.hasValue()) {
+    return errorCode.value();
   }
 
   // Report back what we've parsed
@@ -498,13 +532,10 @@ ErrorCode HTTP2Codec::parseHeadersImpl(
   return ErrorCode::NO_ERROR;
 }
 
-folly::Optional<ErrorCode> HTTP2Codec::parseHeadersDecodeFrames(
+void HTTP2Codec::parseHeadersBegin(
     const folly::Optional<http2::PriorityUpdate>& priority,
     const folly::Optional<uint32_t>& promisedStream,
-    const folly::Optional<ExAttributes>& exAttributes,
-    std::unique_ptr<HTTPMessage>& msg) {
-  // decompress headers
-  Cursor headerCursor(curHeaderBlock_.front());
+    const folly::Optional<ExAttributes>& exAttributes) {
   bool isReq = false;
   if (promisedStream) {
     isReq = true;
@@ -514,8 +545,29 @@ folly::Optional<ErrorCode> HTTP2Codec::parseHeadersDecodeFrames(
     isReq = transportDirection_ == TransportDirection::DOWNSTREAM;
   }
 
+  decodeInfo_.init(isReq, parsingDownstreamTrailers_);
+  if (priority) {
+    decodeInfo_.msg->setHTTP2Priority(
+        std::make_tuple(priority->streamDependency,
+                        priority->exclusive,
+                        priority->weight));
+  }
+  headerLiterals_.reset();
+  if (headerPassthrough_) {
+    headerLiterals_ = std::make_shared<HuffmanLiterals>();
+  }
+}
+
+folly::Optional<ErrorCode> HTTP2Codec::parseHeadersDecodeFrames(
+    const folly::Optional<http2::PriorityUpdate>& priority,
+    std::unique_ptr<HTTPMessage>& msg) {
+  bool endHeaders = curHeader_.flags & http2::END_HEADERS;
   // Validate circular dependencies.
-  if (priority && (curHeader_.stream == priority->streamDependency)) {
+  if (endHeaders && priority &&
+      (curHeader_.stream == priority->streamDependency)) {
+    curHeaderBlock_.move();
+    headerBlockSize_ = 0;
+    decodeInfo_.msg.reset();
     streamError(
         folly::to<string>("Circular dependency for txn=", curHeader_.stream),
         ErrorCode::PROTOCOL_ERROR,
@@ -523,19 +575,27 @@ folly::Optional<ErrorCode> HTTP2Codec::parseHeadersDecodeFrames(
     return ErrorCode::NO_ERROR;
   }
 
-  decodeInfo_.init(isReq, parsingDownstreamTrailers_);
-  if (priority) {
-    decodeInfo_.msg->setHTTP2Priority(
-        std::make_tuple(priority->streamDependency,
-                        priority->exclusive,
-                        priority->weight));
+  // decompress the headers that are complete so far
+  Cursor headerCursor(curHeaderBlock_.front());
+  huffmanLiterals = headerLiterals_.get();
+  auto consumed = headerCodec_.decodeStreamingPartial(
+      headerCursor, curHeaderBlock_.chainLength(), this, endHeaders);
+  huffmanLiterals = nullptr;
+  if (!endHeaders && decodeInfo_.decodeError == HPACK::DecodeError::NONE) {
+    // Keep what the next CONTINUATION completes
+    curHeaderBlock_.trimStart(consumed);
+    return folly::Optional<ErrorCode>();
   }
-
-  headerCodec_.decodeStreaming(
-      headerCursor, curHeaderBlock_.chainLength(), this);
   msg = std::move(decodeInfo_.msg);
+  auto literals = std::move(headerLiterals_);
+  if (msg && literals && !literals->empty()) {
+    msg->setHuffmanLiterals(std::move(literals));
+  }
   // Saving this in case we need to log it on error
-  auto g = folly::makeGuard([this] { curHeaderBlock_.move(); });
+  auto g = folly::makeGuard([this] {
+      curHeaderBlock_.move();
+      headerBlockSize_ = 0;
+    });
   // Check decoding error
   if (decodeInfo_.decodeError != HPACK::DecodeError::NONE) {
     static const std::string decodeErrorMessage =
@@ -922,10 +982,23 @@ ErrorCode HTTP2Codec::parseWindowUpdate(Cursor& cursor) {
       return ErrorCode::PROTOCOL_ERROR;
     }
   }
-  // if window exceeds 2^31-1, connection/stream error flow control error
-  // must be checked in session/txn
-  deliverCallbackIfAllowed(&HTTPCodec::Callback::onWindowUpdate,
-                           "onWindowUpdate", curHeader_.stream, delta);
+  // Held until the end of the buffer, or the next other frame of the stream,
+  // so that a read with many WINDOW_UPDATEs delivers one per stream
+  auto it = std::find_if(
+    pendingWindowUpdates_.begin(), pendingWindowUpdates_.end(),
+    [this] (const std::pair<StreamID, uint32_t>& update) {
+      return update.first == curHeader_.stream;
+    });
+  if (it == pendingWindowUpdates_.end()) {
+    pendingWindowUpdates_.emplace_back(curHeader_.stream, delta);
+  } else if (it->second + uint64_t(delta) > http2::kMaxWindowUpdateSize) {
+    // Not merged past a valid increment, for the overflow to be detected
+    auto pending = it->second;
+    it->second = delta;
+    deliverWindowUpdate(curHeader_.stream, pending);
+  } else {
+    it->second += delta;
+  }
   return ErrorCode::NO_ERROR;
 }
 
@@ -1024,22 +1097,27 @@ bool HTTP2Codec::onIngressUpgradeMessage(const HTTPMessage& msg) {
     return true;
   }
 
-  auto decoded = base64url_decode(settingsHeader);
-
-  // Must be well formed Base64Url and not too large
-  if (decoded.empty() || decoded.length() > http2::kMaxFramePayloadLength) {
+  // Must not be too large, and be well formed Base64Url
+  if (settingsHeader.size() >
+      Base64::urlEncodedSize(http2::kMaxFramePayloadLength)) {
+    VLOG(4) << __func__ << " HTTP2-Settings too large";
+    return false;
+  }
+  folly::small_vector<uint8_t, kInlineUpgradeSettings * 6> decoded(
+    Base64::decodedSizeBound(settingsHeader.size()));
+  auto decodedLen = Base64::urlDecode(
+    settingsHeader, folly::MutableByteRange(decoded.data(), decoded.size()));
+  if (!decodedLen || *decodedLen == 0 ||
+      *decodedLen > http2::kMaxFramePayloadLength) {
     VLOG(4) << __func__ << " failed to decode HTTP2-Settings";
     return false;
   }
-  std::unique_ptr<IOBuf> decodedBuf = IOBuf::wrapBuffer(decoded.data(),
-                                                        decoded.length());
-  IOBufQueue settingsQueue{IOBufQueue::cacheChainLength()};
-  settingsQueue.append(std::move(decodedBuf));
-  Cursor c(settingsQueue.front());
+  auto decodedBuf = IOBuf::wrapBufferAsValue(decoded.data(), *decodedLen);
+  Cursor c(&decodedBuf);
   std::deque<SettingPair> settings;
   // downcast is ok because of above length check
   http2::FrameHeader frameHeader{
-    (uint32_t)settingsQueue.chainLength(), 0, http2::FrameType::SETTINGS, 0, 0};
+    (uint32_t)*decodedLen, 0, http2::FrameType::SETTINGS, 0, 0};
   auto err = http2::parseSettings(c, frameHeader, settings);
   if (err != ErrorCode::NO_ERROR) {
     VLOG(4) << __func__ << " bad settings frame";
@@ -1141,7 +1219,8 @@ void HTTP2Codec::generateHeaderImpl(
 
   std::vector<std::string> temps;
   auto allHeaders = CodecUtil::prepareMessageForCompression(msg, temps);
-  auto out = encodeHeaders(msg.getHeaders(), allHeaders, size);
+  auto out = encodeHeaders(msg.getHeaders(), allHeaders, size,
+                           msg.getHuffmanLiterals().get());
   IOBufQueue queue(IOBufQueue::cacheChainLength());
   queue.append(std::move(out));
   auto maxFrameSize = maxSendFrameSize();
@@ -1219,13 +1298,18 @@ void HTTP2Codec::generateContinuation(folly::IOBufQueue& writeBuf,
 std::unique_ptr<folly::IOBuf> HTTP2Codec::encodeHeaders(
     const HTTPHeaders& headers,
     std::vector<compress::Header>& allHeaders,
-    HTTPHeaderSize* size) {
+    HTTPHeaderSize* size,
+    const HuffmanLiterals* huffmanLiterals) {
   headerCodec_.setEncodeHeadroom(http2::kFrameHeaderSize +
                                  http2::kFrameHeadersBaseMaxSize);
-  auto out = headerCodec_.encode(allHeaders);
+  auto out = headerCodec_.encode(allHeaders, huffmanLiterals);
   if (size) {
     *size = headerCodec_.getEncodedSize();
   }
+  auto cacheHit = headerCodec_.lastEncodeCacheHit();
+  if (cacheHit && callback_) {
+    callback_->onHeaderEncodeCache(*cacheHit);
+  }
 
   if (headerCodec_.getEncodedSize().uncompressed >
       ingressSettings_.getSetting(SettingsId::MAX_HEADER_LIST_SIZE,
@@ -1271,17 +1355,28 @@ size_t HTTP2Codec::generateBody(folly::IOBufQueue& writeBuf,
   IOBufQueue queue(IOBufQueue::cacheChainLength());
   queue.append(std::move(chain));
   size_t maxFrameSize = maxSendFrameSize();
-  while (queue.chainLength() > maxFrameSize) {
-    auto chunk = queue.split(maxFrameSize);
-    written += generateHeaderCallbackWrapper(
-                  stream,
-                  http2::FrameType::DATA,
-                  http2::writeData(writeBuf,
-                                   std::move(chunk),
-                                   stream,
-                                   padding,
-                                   false,
-                                   reuseIOBufHeadroomForData_));
+  if (queue.chainLength() > maxFrameSize) {
+    // Multiple frames: lay the frame headers out in one buffer instead of
+    // allocating (or stealing headroom) for each of them.
+    http2::DataFrameWriter frameWriter(
+      writeBuf, queue.chainLength() / maxFrameSize + 1);
+    while (queue.chainLength() > maxFrameSize) {
+      auto chunk = queue.split(maxFrameSize);
+      written += generateHeaderCallbackWrapper(
+                    stream,
+                    http2::FrameType::DATA,
+                    frameWriter.writeData(std::move(chunk),
+                                          stream,
+                                          padding,
+                                          false));
+    }
+    return written + generateHeaderCallbackWrapper(
+                        stream,
+                        http2::FrameType::DATA,
+                        frameWriter.writeData(queue.move(),
+                                              stream,
+                                              padding,
+                                              eom));
   }
 
   return written + generateHeaderCallbackWrapper(
@@ -17,6 +17,8 @@
 #include <proxygen/lib/http/codec/HTTPSettings.h>
 #include <proxygen/lib/http/codec/compress/HPACKCodec.h>
 
+#include <folly/small_vector.h>
+
 #include <bitset>
 #include <set>
 
@@ -135,6 +137,14 @@ public:
     headerCodec_.setStats(hcStats);
   }
 
+  void hibernate() override {
+    headerCodec_.hibernate();
+  }
+
+  size_t getMemoryUsage() const override {
+    return headerCodec_.getMemoryUsage();
+  }
+
   bool isRequest(StreamID id) const {
     return ((transportDirection_ == TransportDirection::DOWNSTREAM &&
              (id & 0x1) == 1) ||
@@ -175,6 +185,25 @@ public:
     return headerCodec_.getHeaderIndexingStrategy();
   }
 
+  // Memoize the HPACK encoding of up to size repeated header blocks, lookups
+  // are reported through Callback::onHeaderEncodeCache
+  void setHeaderEncodeCacheSize(size_t size) {
+    headerCodec_.setEncodeCacheSize(size);
+  }
+
+  // Share the encoding of static table only header blocks with the other
+  // codecs of this thread, see StaticBlockCache
+  void setUseStaticHeaderBlockCache(bool use) {
+    headerCodec_.setUseStaticBlockCache(use);
+  }
+
+  // Keep the Huffman encoded literals of each received header block with
+  // the decoded message, see HTTPMessage::getHuffmanLiterals.  For proxies
+  // that forward the headers over HTTP/2 again.
+  void setHeaderPassthrough(bool enabled) {
+    headerPassthrough_ = enabled;
+  }
+
  private:
   void generateHeaderImpl(folly::IOBufQueue& writeBuf,
                           StreamID stream,
@@ -186,7 +215,8 @@ public:
   std::unique_ptr<folly::IOBuf> encodeHeaders(
       const HTTPHeaders& headers,
       std::vector<compress::Header>& allHeaders,
-      HTTPHeaderSize* size);
+      HTTPHeaderSize* size,
+      const HuffmanLiterals* huffmanLiterals = nullptr);
 
   size_t generateHeaderCallbackWrapper(StreamID stream, http2::FrameType type, size_t length);
 
@@ -214,14 +244,20 @@ public:
     const folly::Optional<http2::PriorityUpdate>& priority,
     const folly::Optional<uint32_t>& promisedStream,
     const folly::Optional<ExAttributes>& exAttributes);
-  folly::Optional<ErrorCode> parseHeadersDecodeFrames(
+  void parseHeadersBegin(
       const folly::Optional<http2::PriorityUpdate>& priority,
       const folly::Optional<uint32_t>& promisedStream,
-      const folly::Optional<ExAttributes>& exAttributes,
+      const folly::Optional<ExAttributes>& exAttributes);
+  folly::Optional<ErrorCode> parseHeadersDecodeFrames(
+      const folly::Optional<http2::PriorityUpdate>& priority,
       std::unique_ptr<HTTPMessage>& msg);
   folly::Optional<ErrorCode> parseHeadersCheckConcurrentStreams(
       const folly::Optional<http2::PriorityUpdate>& priority);
 
+  // Delivers the WINDOW_UPDATEs held for stream, or all of them for 0
+  void flushWindowUpdates(StreamID stream);
+  void deliverWindowUpdate(StreamID stream, uint32_t delta);
+
   ErrorCode handleEndStream();
   ErrorCode checkNewStream(uint32_t stream, bool trailersAllowed);
   bool checkConnectionError(ErrorCode, const folly::IOBuf* buf);
@@ -252,7 +288,13 @@ public:
   folly::IOBufQueue curAuthenticatorBlock_{
       folly::IOBufQueue::cacheChainLength()};
 
+  // A header block is decoded as its frames arrive: curHeaderBlock_ only
+  // holds a header representation split across frames.  headerBlockSize_ is
+  // the size of the block so far, headerLiterals_ its Huffman literals when
+  // passing them through.
   folly::IOBufQueue curHeaderBlock_{folly::IOBufQueue::cacheChainLength()};
+  size_t headerBlockSize_{0};
+  std::shared_ptr<HuffmanLiterals> headerLiterals_;
   HTTPSettings ingressSettings_{
     { SettingsId::HEADER_TABLE_SIZE, 4096 },
     { SettingsId::ENABLE_PUSH, 1 },
@@ -277,6 +319,12 @@ public:
   FrameState frameState_:3;
   std::string userAgent_;
 
+  // The WINDOW_UPDATEs of the buffer being parsed, merged per stream and
+  // delivered before the next other frame of their stream, a connection
+  // level frame, or the end of the buffer.
+  folly::small_vector<std::pair<StreamID, uint32_t>, 8>
+    pendingWindowUpdates_;
+
   size_t pendingDataFrameBytes_{0};
   size_t pendingDataFramePaddingBytes_{0};
 
@@ -284,6 +332,7 @@ public:
   std::vector<StreamID> virtualPriorityNodes_;
   folly::Optional<uint32_t> pendingTableMaxSize_;
   bool reuseIOBufHeadroomForData_{true};
+  bool headerPassthrough_{false};
 
   // True if last parsed HEADERS frame was trailers.
   // Reset only when HEADERS frame is parsed, thus
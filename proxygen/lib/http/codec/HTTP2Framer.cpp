@@ -19,6 +19,7 @@ namespace proxygen { namespace http2 {
 const uint8_t kMinExperimentalFrameType = 0xf0;
 const Padding kNoPadding = folly::none;
 const PriorityUpdate DefaultPriority{0, false, 15};
+const size_t kDefaultDataFrameCopyThreshold = 256;
 
 namespace {
 
@@ -635,6 +636,90 @@ writeData(IOBufQueue& queue,
   return kFrameHeaderSize + frameLen;
 }
 
+DataFrameWriter::DataFrameWriter(IOBufQueue& writeBuf,
+                                 size_t numFrames,
+                                 size_t copyThreshold)
+    : writeBuf_(writeBuf),
+      framesLeft_(numFrames),
+      copyThreshold_(copyThreshold) {
+}
+
+DataFrameWriter::~DataFrameWriter() {
+  flush();
+}
+
+void DataFrameWriter::ensureTailroom(size_t needed) noexcept {
+  if (buf_ && buf_->tailroom() >= needed) {
+    return;
+  }
+  flush();
+  // Room for this frame plus the headers of the frames still expected
+  buf_ = IOBuf::create(needed + framesLeft_ * (kFrameHeaderSize + 1));
+  emitted_ = 0;
+}
+
+void DataFrameWriter::flush() noexcept {
+  if (!buf_ || buf_->length() == emitted_) {
+    return;
+  }
+  // Hand out a view of the new bytes.  buf_ becomes shared, so writeBuf_
+  // never writes into its tailroom, which stays ours for the next frames.
+  auto out = buf_->cloneOne();
+  out->trimStart(emitted_);
+  emitted_ = buf_->length();
+  writeBuf_.append(std::move(out));
+}
+
+size_t DataFrameWriter::writeData(std::unique_ptr<IOBuf> data,
+                                  uint32_t stream,
+                                  folly::Optional<uint8_t> padding,
+                                  bool endStream) noexcept {
+  DCHECK_NE(0, stream);
+  DCHECK_EQ(0, ~kUint31Mask & stream);
+  const uint64_t dataLen = data ? data->computeChainDataLength() : 0;
+  uint8_t flags = endStream ? END_STREAM : 0;
+  uint32_t length = dataLen;
+  size_t headerSize = kFrameHeaderSize;
+  size_t padLen = 0;
+  if (padding) {
+    flags |= PADDED;
+    padLen = *padding;
+    length += padLen + 1;
+    headerSize += 1;
+  }
+  DCHECK_EQ(0, ~kLengthMask & length);
+  if (framesLeft_ > 0) {
+    framesLeft_--;
+  }
+
+  const bool copyPayload = dataLen <= copyThreshold_;
+  ensureTailroom(headerSize + padLen + (copyPayload ? dataLen : 0));
+
+  Appender appender(buf_.get(), 0);
+  appender.writeBE<uint32_t>(
+    ((kLengthMask & length) << 8) | static_cast<uint8_t>(FrameType::DATA));
+  appender.writeBE<uint8_t>(flags);
+  appender.writeBE<uint32_t>(kUint31Mask & stream);
+  if (padding) {
+    appender.writeBE<uint8_t>(*padding);
+  }
+  if (data) {
+    if (copyPayload) {
+      for (auto range : *data) {
+        appender.push(range.data(), range.size());
+      }
+    } else {
+      flush();
+      writeBuf_.append(std::move(data));
+    }
+  }
+  if (padLen > 0) {
+    memset(buf_->writableTail(), 0, padLen);
+    buf_->append(padLen);
+  }
+  return kFrameHeaderSize + length;
+}
+
 size_t
 writeHeaders(IOBufQueue& queue,
              std::unique_ptr<IOBuf> headers,
@@ -11,6 +11,7 @@
 
 #include <cstdint>
 #include <deque>
+#include <memory>
 #include <folly/Optional.h>
 #include <folly/Range.h>
 #include <folly/io/Cursor.h>
@@ -405,6 +406,63 @@ writeData(folly::IOBufQueue& writeBuf,
           bool endStream,
           bool reuseIOBufHeadroom) noexcept;
 
+/**
+ * Payloads up to this many bytes are copied next to their frame header by
+ * DataFrameWriter rather than chained.
+ */
+extern const size_t kDefaultDataFrameCopyThreshold;
+
+/**
+ * Generates a run of DATA frames into one output queue.  Frame headers and
+ * padding are laid out contiguously in a buffer reserved once for the whole
+ * batch, and payloads of at most copyThreshold bytes are copied in between,
+ * so back to back small frames end up in a single IOBuf.  Larger payloads
+ * are chained without copying.
+ *
+ * Output is appended to writeBuf lazily: call flush() (or destroy the
+ * writer) before reading writeBuf.
+ */
+class DataFrameWriter {
+ public:
+  /**
+   * @param writeBuf The output queue to write to.
+   * @param numFrames Expected number of frames, used to size the
+   *                  reservation.  Exceeding it is allowed.
+   * @param copyThreshold Payloads of at most this size are copied.
+   */
+  DataFrameWriter(folly::IOBufQueue& writeBuf,
+                  size_t numFrames,
+                  size_t copyThreshold = kDefaultDataFrameCopyThreshold);
+
+  ~DataFrameWriter();
+
+  /**
+   * Generate an entire DATA frame, with the same constraints as
+   * http2::writeData().
+   *
+   * @return The number of bytes the frame occupies on the wire.
+   */
+  size_t writeData(std::unique_ptr<folly::IOBuf> data,
+                   uint32_t stream,
+                   folly::Optional<uint8_t> padding,
+                   bool endStream) noexcept;
+
+  /**
+   * Append everything generated so far to writeBuf.
+   */
+  void flush() noexcept;
+
+ private:
+  void ensureTailroom(size_t needed) noexcept;
+
+  folly::IOBufQueue& writeBuf_;
+  std::unique_ptr<folly::IOBuf> buf_;
+  // Bytes at the front of buf_ that were already appended to writeBuf_
+  size_t emitted_{0};
+  size_t framesLeft_;
+  const size_t copyThreshold_;
+};
+
 /**
  * Generate an entire HEADERS frame, including the common frame header. The
  * combined length of the data buffer and the padding and priority fields MUST
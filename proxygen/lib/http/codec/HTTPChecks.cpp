@@ -13,37 +13,60 @@
 
 namespace proxygen {
 
-void HTTPChecks::onHeadersComplete(StreamID stream,
-                                   std::unique_ptr<HTTPMessage> msg) {
-
-  if (msg->isRequest() && (RFC2616::isRequestBodyAllowed(msg->getMethod())
-                           == RFC2616::BodyAllowed::NOT_ALLOWED) &&
-      RFC2616::bodyImplied(msg->getHeaders())) {
+bool HTTPChecks::checkIngressHeaders(StreamID stream,
+                                     const HTTPMessage& msg,
+                                     HTTPCodec::Callback& callback) {
+  if (msg.isRequest() && (RFC2616::isRequestBodyAllowed(msg.getMethod())
+                          == RFC2616::BodyAllowed::NOT_ALLOWED) &&
+      RFC2616::bodyImplied(msg.getHeaders())) {
     HTTPException ex(
       HTTPException::Direction::INGRESS, "RFC2616: Request Body Not Allowed");
     ex.setProxygenError(kErrorParseHeader);
     // setting the status code means that the error is at the HTTP layer and
     // that parsing succeeded.
     ex.setHttpStatusCode(400);
-    callback_->onError(stream, ex, true);
-    return;
+    callback.onError(stream, ex, true);
+    return false;
   }
-
-  callback_->onHeadersComplete(stream, std::move(msg));
+  return true;
 }
 
-void HTTPChecks::generateHeader(folly::IOBufQueue& writeBuf,
-                                StreamID stream,
-                                const HTTPMessage& msg,
-                                bool eom,
-                                HTTPHeaderSize* sizeOut) {
+void HTTPChecks::checkEgressHeaders(const HTTPMessage& msg) {
   if (msg.isRequest() && RFC2616::bodyImplied(msg.getHeaders())) {
     CHECK(RFC2616::isRequestBodyAllowed(msg.getMethod()) !=
           RFC2616::BodyAllowed::NOT_ALLOWED);
     // We could also add a "strict" mode that disallows sending body on GET
     // requests here too.
   }
+}
+
+void HTTPChecks::onHeadersComplete(StreamID stream,
+                                   std::unique_ptr<HTTPMessage> msg) {
+  if (checkIngressHeaders(stream, *msg, *callback_)) {
+    callback_->onHeadersComplete(stream, std::move(msg));
+  }
+}
 
+void HTTPChecks::onMessage(StreamID stream,
+                           std::unique_ptr<HTTPMessage> msg,
+                           std::unique_ptr<folly::IOBuf> body) {
+  if (checkIngressHeaders(stream, *msg, *callback_)) {
+    callback_->onMessage(stream, std::move(msg), std::move(body));
+    return;
+  }
+  // As if they had come one by one
+  if (body) {
+    callback_->onBody(stream, std::move(body), 0);
+  }
+  callback_->onMessageComplete(stream, false);
+}
+
+void HTTPChecks::generateHeader(folly::IOBufQueue& writeBuf,
+                                StreamID stream,
+                                const HTTPMessage& msg,
+                                bool eom,
+                                HTTPHeaderSize* sizeOut) {
+  checkEgressHeaders(msg);
   call_->generateHeader(writeBuf, stream, msg, eom, sizeOut);
 }
 
@@ -21,11 +21,27 @@ namespace proxygen {
 
 class HTTPChecks: public PassThroughHTTPCodecFilter {
  public:
+  // The checks themselves, which FusedHTTPCodecFilter runs inline
+
+  /**
+   * Returns false, having reported the error to callback, if the ingress
+   * message must go no further.
+   */
+  static bool checkIngressHeaders(StreamID stream,
+                                  const HTTPMessage& msg,
+                                  HTTPCodec::Callback& callback);
+
+  static void checkEgressHeaders(const HTTPMessage& msg);
+
   // HTTPCodec::Callback methods
 
   void onHeadersComplete(StreamID stream,
                          std::unique_ptr<HTTPMessage> msg) override;
 
+  void onMessage(StreamID stream,
+                 std::unique_ptr<HTTPMessage> msg,
+                 std::unique_ptr<folly::IOBuf> body) override;
+
   // HTTPCodec methods
 
   void generateHeader(folly::IOBufQueue& writeBuf,
@@ -182,6 +182,27 @@ class HTTPCodec {
      */
     virtual void onMessageComplete(StreamID stream, bool upgrade) = 0;
 
+    /**
+     * Called instead of onHeadersComplete(), onBody() and
+     * onMessageComplete() for a whole message that was parsed at once,
+     * with no trailers nor upgrade, by codecs batching them (HTTP1xCodec
+     * does for requests with small Content-Length bodies).  Filters that
+     * look at the headers or body and forward the batch must override it;
+     * by default it makes the three calls.
+     * @param stream   The stream ID
+     * @param msg      The message
+     * @param body     All of the body, or null
+     */
+    virtual void onMessage(StreamID stream,
+                           std::unique_ptr<HTTPMessage> msg,
+                           std::unique_ptr<folly::IOBuf> body) {
+      onHeadersComplete(stream, std::move(msg));
+      if (body) {
+        onBody(stream, std::move(body), 0);
+      }
+      onMessageComplete(stream, false);
+    }
+
     /**
      * Called when a parsing or protocol error has occurred
      * @param stream   The stream ID
@@ -220,6 +241,12 @@ class HTTPCodec {
         uint64_t /* type */,
         uint16_t /* version */ = 0) {}
 
+    /**
+     * Called after a header block is generated with the header encode cache
+     * enabled, with whether the cached encoding was used.
+     */
+    virtual void onHeaderEncodeCache(bool /* hit */) {}
+
     /**
      * Called upon receipt of a goaway.
      * @param lastGoodStreamID  Last successful stream created by the receiver
@@ -385,6 +412,15 @@ class HTTPCodec {
     return false;
   }
 
+  /**
+   * Returns true iff generateHeader() emits a message's HTTPHeaderTemplate
+   * itself.  Otherwise the session merges the template into the headers
+   * before calling generateHeader().
+   */
+  virtual bool supportsHeaderTemplates() const {
+    return false;
+  }
+
   /**
    * Reserve a stream ID.
    * @return           A stream ID on success, or zero on error.
@@ -679,6 +715,18 @@ class HTTPCodec {
    */
   virtual void setHeaderCodecStats(HeaderCodec::Stats* /* stats */) {}
 
+  /**
+   * Release what memory the codec can rebuild while the connection is idle,
+   * such as header compression tables.  The connection keeps working,
+   * possibly compressing worse until the state is rebuilt.
+   */
+  virtual void hibernate() {}
+
+  /**
+   * Approximate heap bytes held by the codec's header compression state.
+   */
+  virtual size_t getMemoryUsage() const { return 0; }
+
   /**
    * Get the identifier of the last stream started by the remote.
    */
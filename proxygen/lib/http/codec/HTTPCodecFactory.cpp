@@ -11,6 +11,7 @@
 #include <proxygen/lib/http/codec/HTTP1xCodec.h>
 #include <proxygen/lib/http/codec/SPDYCodec.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
 
 namespace proxygen {
 
@@ -31,4 +32,21 @@ std::unique_ptr<HTTPCodec> HTTPCodecFactory::getCodec(
   }
 }
 
+folly::Optional<bool> HTTPCodecFactory::isHTTP2Preface(
+  const folly::IOBuf& firstRead) {
+  const auto& preface = http2::kConnectionPreface;
+  size_t matched = 0;
+  for (auto range : firstRead) {
+    auto len = std::min(range.size(), preface.size() - matched);
+    if (memcmp(range.data(), preface.data() + matched, len) != 0) {
+      return false;
+    }
+    matched += len;
+    if (matched == preface.size()) {
+      return true;
+    }
+  }
+  return folly::none;
+}
+
 }
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <folly/Optional.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/TransportDirection.h>
 
@@ -31,6 +32,13 @@ class HTTPCodecFactory {
 
   static std::unique_ptr<HTTPCodec> getCodec(CodecProtocol protocol,
                                              TransportDirection direction);
+
+  /**
+   * For plaintext connections with prior knowledge of HTTP/2 (RFC 7540,
+   * section 3.4): whether the first bytes read are the client connection
+   * preface, or none while they are only a prefix of it.
+   */
+  static folly::Optional<bool> isHTTP2Preface(const folly::IOBuf& firstRead);
 };
 
 } // proxygen
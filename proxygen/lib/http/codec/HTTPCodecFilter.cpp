@@ -136,6 +136,10 @@ void PassThroughHTTPCodecFilter::onGenerateFrameHeader(StreamID streamID,
    callback_->onGenerateFrameHeader(streamID, length, type, version);
 }
 
+void PassThroughHTTPCodecFilter::onHeaderEncodeCache(bool hit) {
+  callback_->onHeaderEncodeCache(hit);
+}
+
 void PassThroughHTTPCodecFilter::onCertificateRequest(
     uint16_t requestId, std::unique_ptr<folly::IOBuf> authRequest) {
   callback_->onCertificateRequest(requestId, std::move(authRequest));
@@ -179,6 +183,10 @@ bool PassThroughHTTPCodecFilter::supportsSessionFlowControl() const {
   return call_->supportsSessionFlowControl();
 }
 
+bool PassThroughHTTPCodecFilter::supportsHeaderTemplates() const {
+  return call_->supportsHeaderTemplates();
+}
+
 HTTPCodec::StreamID PassThroughHTTPCodecFilter::createStream() {
   return call_->createStream();
 }
@@ -378,6 +386,14 @@ void PassThroughHTTPCodecFilter::setHeaderCodecStats(
   call_->setHeaderCodecStats(stats);
 }
 
+void PassThroughHTTPCodecFilter::hibernate() {
+  call_->hibernate();
+}
+
+size_t PassThroughHTTPCodecFilter::getMemoryUsage() const {
+  return call_->getMemoryUsage();
+}
+
 HTTPCodec::StreamID
 PassThroughHTTPCodecFilter::getLastIncomingStreamID() const {
   return call_->getLastIncomingStreamID();
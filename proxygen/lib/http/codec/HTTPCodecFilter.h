@@ -101,6 +101,8 @@ class PassThroughHTTPCodecFilter: public HTTPCodecFilter {
                              uint64_t length,
                              uint16_t version) override;
 
+  void onHeaderEncodeCache(bool hit) override;
+
   void onCertificateRequest(uint16_t requestId,
                             std::unique_ptr<folly::IOBuf> authRequest) override;
 
@@ -124,6 +126,8 @@ class PassThroughHTTPCodecFilter: public HTTPCodecFilter {
 
   bool supportsSessionFlowControl() const override;
 
+  bool supportsHeaderTemplates() const override;
+
   StreamID createStream() override;
 
   void setCallback(HTTPCodec::Callback* callback) override;
@@ -233,6 +237,10 @@ class PassThroughHTTPCodecFilter: public HTTPCodecFilter {
 
   void setHeaderCodecStats(HeaderCodec::Stats* stats) override;
 
+  void hibernate() override;
+
+  size_t getMemoryUsage() const override;
+
   void enableDoubleGoawayDrain() override;
 
   HTTPCodec::StreamID getLastIncomingStreamID() const override;
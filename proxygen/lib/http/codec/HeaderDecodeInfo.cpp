@@ -81,19 +81,28 @@ bool HeaderDecodeInfo::onHeader(const folly::fbstring& name,
     }
   } else {
     regularHeaderSeen_ = true;
-    if (nameSp == "connection") {
-      parsingError = string("HTTP/2 Message with Connection header");
-      return false;
-    }
-    if (nameSp == "content-length") {
-      uint32_t cl = 0;
-      folly::tryTo<uint32_t>(valueSp).then(
-          [&cl](uint32_t num) { cl = num; });
-      if (contentLength_ && *contentLength_ != cl) {
-        parsingError = string("Multiple content-length headers");
+    // The name is hashed once, for these checks and for adding it
+    auto code = HTTPCommonHeaders::hash(nameSp.data(), nameSp.size());
+    switch (code) {
+      case HTTP_HEADER_CONNECTION:
+        parsingError = string("HTTP/2 Message with Connection header");
         return false;
+      case HTTP_HEADER_CONTENT_LENGTH: {
+        uint32_t cl = 0;
+        folly::tryTo<uint32_t>(valueSp).then(
+            [&cl](uint32_t num) { cl = num; });
+        if (contentLength_ && *contentLength_ != cl) {
+          parsingError = string("Multiple content-length headers");
+          return false;
+        }
+        contentLength_ = cl;
+        break;
       }
-      contentLength_ = cl;
+      case HTTP_HEADER_COOKIE:
+        numCookies_++;
+        break;
+      default:
+        break;
     }
     bool nameOk = CodecUtil::validateHeaderName(nameSp);
     bool valueOk = CodecUtil::validateHeaderValue(valueSp, CodecUtil::STRICT);
@@ -103,7 +112,7 @@ bool HeaderDecodeInfo::onHeader(const folly::fbstring& name,
       return false;
     }
     // Add the (name, value) pair to headers
-    msg->getHeaders().add(nameSp, valueSp);
+    msg->getHeaders().addWithCode(code, nameSp, valueSp);
   }
   return true;
 }
@@ -112,8 +121,9 @@ void HeaderDecodeInfo::onHeadersComplete(HTTPHeaderSize decodedSize) {
   HTTPHeaders& headers = msg->getHeaders();
 
   if (isRequest_ && !isRequestTrailers_) {
-    auto combinedCookie = headers.combine(HTTP_HEADER_COOKIE, "; ");
-    if (!combinedCookie.empty()) {
+    // Cookies split up for compression, RFC 7540 8.1.2.5
+    if (numCookies_ > 1) {
+      auto combinedCookie = headers.combine(HTTP_HEADER_COOKIE, "; ");
       headers.set(HTTP_HEADER_COOKIE, combinedCookie);
     }
     if (!verifier.validate()) {
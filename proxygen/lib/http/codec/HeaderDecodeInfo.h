@@ -25,6 +25,7 @@ class HeaderDecodeInfo {
     isRequestTrailers_ = isRequestTrailers;
     hasStatus_ = false;
     contentLength_ = folly::none;
+    numCookies_ = 0;
     regularHeaderSeen_ = false;
     pseudoHeaderSeen_ = false;
     parsingError = "";
@@ -52,6 +53,7 @@ class HeaderDecodeInfo {
   bool regularHeaderSeen_{false};
   bool pseudoHeaderSeen_{false};
   folly::Optional<uint32_t> contentLength_;
+  uint32_t numCookies_{0};
 };
 
 }
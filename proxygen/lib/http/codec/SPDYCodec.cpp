@@ -575,10 +575,9 @@ unique_ptr<IOBuf> SPDYCodec::serializeResponseHeaders(
   }
   allHeaders.emplace_back(HTTP_HEADER_COLON_STATUS, status);
   // See comment above regarding status
-  string date;
   if (!headers.exists(HTTP_HEADER_DATE)) {
-    date = HTTPMessage::formatDateHeader();
-    allHeaders.emplace_back(HTTP_HEADER_DATE, date);
+    allHeaders.emplace_back(HTTP_HEADER_DATE,
+                            HTTPMessage::formatDateHeader());
   }
 
   return encodeHeaders(msg, allHeaders, headroom, size);
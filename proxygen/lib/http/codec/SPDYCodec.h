@@ -124,6 +124,10 @@ public:
     headerCodec_.setStats(stats);
   }
 
+  size_t getMemoryUsage() const override {
+    return headerCodec_.getMemoryUsage();
+  }
+
   size_t addPriorityNodes(
       PriorityQueue& queue,
       folly::IOBufQueue& writeBuf,
@@ -116,6 +116,7 @@ folly::Optional<proxygen::spdy::SettingsId> httpToSpdySettingsId(
       return folly::none;
     case proxygen::SettingsId::_HQ_NUM_PLACEHOLDERS:
     case proxygen::SettingsId::_HQ_QPACK_BLOCKED_STREAMS:
+    case proxygen::SettingsId::_HQ_DATAGRAM:
     case proxygen::SettingsId::SETTINGS_HTTP_CERT_AUTH:
       return folly::none;
   }
@@ -53,6 +53,7 @@ enum class SettingsId : uint64_t {
   //_HQ_MAX_HEADER_LIST_SIZE = HQ_SETTINGS_MASK | 6, -- use MAX_HEADER_LIST_SIZE
   _HQ_QPACK_BLOCKED_STREAMS = HQ_SETTINGS_MASK | 7,
   _HQ_NUM_PLACEHOLDERS = HQ_SETTINGS_MASK | 8,
+  _HQ_DATAGRAM = HQ_SETTINGS_MASK | 0x33,
 };
 
 using SettingPair = std::pair<SettingsId, uint32_t>;
@@ -0,0 +1,315 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/TrafficCaptureFilter.h>
+
+#include <fcntl.h>
+#include <folly/FileUtil.h>
+#include <folly/Random.h>
+#include <folly/io/Cursor.h>
+#include <proxygen/lib/http/HTTPMessageSerializer.h>
+
+#include <limits>
+
+namespace proxygen {
+
+namespace {
+const uint32_t kCaptureMagic = 0x50585443; // "PXTC"
+const uint8_t kCaptureVersion = 1;
+const size_t kSessionHeaderSize = 20;
+const size_t kEventHeaderSize = 24;
+
+const HTTPHeaderCode kRedactedHeaders[] = {
+  HTTP_HEADER_AUTHORIZATION,
+  HTTP_HEADER_PROXY_AUTHORIZATION,
+  HTTP_HEADER_COOKIE,
+  HTTP_HEADER_SET_COOKIE,
+};
+
+uint32_t clampToUint32(uint64_t value) {
+  return static_cast<uint32_t>(
+    std::min<uint64_t>(value, std::numeric_limits<uint32_t>::max()));
+}
+
+std::shared_ptr<const HTTPMessage> redact(const HTTPMessage& msg) {
+  auto copy = std::make_shared<HTTPMessage>(msg);
+  copy->applyHeaderTemplate();
+  auto& headers = copy->getHeaders();
+  for (auto code : kRedactedHeaders) {
+    std::vector<std::string> values;
+    headers.forEachValueOfHeader(code, [&] (const std::string& value) {
+        values.emplace_back(value.size(), 'x');
+        return false;
+      });
+    if (!values.empty()) {
+      headers.remove(code);
+      for (auto& value : values) {
+        headers.add(code, std::move(value));
+      }
+    }
+  }
+  return copy;
+}
+}
+
+TrafficCaptureWriter::TrafficCaptureWriter(folly::File file,
+                                           double sampleRate,
+                                           uint64_t maxBytes)
+    : file_(std::move(file)),
+      sampleRate_(sampleRate),
+      maxBytes_(maxBytes) {
+  CHECK(sampleRate >= 0 && sampleRate <= 1) << sampleRate;
+}
+
+std::shared_ptr<TrafficCaptureWriter> TrafficCaptureWriter::open(
+    const std::string& path,
+    double sampleRate,
+    uint64_t maxBytes) {
+  return std::make_shared<TrafficCaptureWriter>(
+    folly::File(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC),
+    sampleRate,
+    maxBytes);
+}
+
+bool TrafficCaptureWriter::shouldSample() const {
+  if (sampleRate_ <= 0 ||
+      (maxBytes_ > 0 && getBytesWritten() >= maxBytes_)) {
+    return false;
+  }
+  return sampleRate_ >= 1 || folly::Random::randDouble01() < sampleRate_;
+}
+
+uint64_t TrafficCaptureWriter::getBytesWritten() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return bytesWritten_;
+}
+
+void TrafficCaptureWriter::write(const CapturedSession& session) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  serialize(session, queue);
+  auto buf = queue.move();
+  buf->coalesce();
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (maxBytes_ > 0 && bytesWritten_ >= maxBytes_) {
+    return;
+  }
+  if (folly::writeFull(file_.fd(), buf->data(), buf->length()) < 0) {
+    PLOG(ERROR) << "Failed to write a traffic capture";
+    return;
+  }
+  bytesWritten_ += buf->length();
+}
+
+void TrafficCaptureWriter::serialize(const CapturedSession& session,
+                                     folly::IOBufQueue& out) {
+  folly::io::QueueAppender appender(&out, kSessionHeaderSize);
+  appender.writeBE<uint32_t>(kCaptureMagic);
+  appender.writeBE<uint8_t>(kCaptureVersion);
+  appender.writeBE<uint8_t>(static_cast<uint8_t>(session.protocol));
+  appender.writeBE<uint8_t>(static_cast<uint8_t>(session.direction));
+  appender.writeBE<uint8_t>(session.truncated ? 1 : 0);
+  appender.writeBE<uint64_t>(session.startUs);
+  appender.writeBE<uint32_t>(session.events.size());
+  folly::IOBufQueue msgBuf{folly::IOBufQueue::cacheChainLength()};
+  for (const auto& event : session.events) {
+    if (event.msg) {
+      HTTPMessageSerializer::serialize(*event.msg, msgBuf);
+    }
+    appender.writeBE<uint32_t>(event.offsetUs);
+    appender.writeBE<uint64_t>(event.streamID);
+    appender.writeBE<uint32_t>(event.length);
+    appender.writeBE<uint8_t>(event.type);
+    appender.writeBE<uint8_t>(event.direction);
+    appender.writeBE<uint16_t>(0);
+    appender.writeBE<uint32_t>(msgBuf.chainLength());
+    if (!msgBuf.empty()) {
+      appender.insert(msgBuf.move());
+    }
+  }
+}
+
+bool TrafficCaptureWriter::decode(folly::ByteRange data,
+                                  std::vector<CapturedSession>& sessions) {
+  auto buf = folly::IOBuf::wrapBuffer(data);
+  folly::io::Cursor cursor(buf.get());
+  while (!cursor.isAtEnd()) {
+    if (!cursor.canAdvance(kSessionHeaderSize) ||
+        cursor.readBE<uint32_t>() != kCaptureMagic ||
+        cursor.readBE<uint8_t>() != kCaptureVersion) {
+      return false;
+    }
+    CapturedSession session;
+    session.protocol = static_cast<CodecProtocol>(cursor.readBE<uint8_t>());
+    session.direction =
+      static_cast<TransportDirection>(cursor.readBE<uint8_t>());
+    session.truncated = cursor.readBE<uint8_t>() != 0;
+    session.startUs = cursor.readBE<uint64_t>();
+    auto count = cursor.readBE<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+      if (!cursor.canAdvance(kEventHeaderSize)) {
+        return false;
+      }
+      CapturedEvent event;
+      event.offsetUs = cursor.readBE<uint32_t>();
+      event.streamID = cursor.readBE<uint64_t>();
+      event.length = cursor.readBE<uint32_t>();
+      auto type = cursor.readBE<uint8_t>();
+      if (type > CapturedEvent::ABORT) {
+        return false;
+      }
+      event.type = static_cast<CapturedEvent::Type>(type);
+      event.direction = cursor.readBE<uint8_t>() == CapturedEvent::EGRESS ?
+        CapturedEvent::EGRESS : CapturedEvent::INGRESS;
+      cursor.skip(2);
+      auto msgLength = cursor.readBE<uint32_t>();
+      if (msgLength > 0) {
+        if (!cursor.canAdvance(msgLength)) {
+          return false;
+        }
+        auto msg = std::make_shared<HTTPMessage>();
+        if (!HTTPMessageSerializer::deserialize(
+              folly::ByteRange(cursor.data(), msgLength), *msg)) {
+          return false;
+        }
+        cursor.skip(msgLength);
+        event.msg = std::move(msg);
+      }
+      session.events.push_back(std::move(event));
+    }
+    sessions.push_back(std::move(session));
+  }
+  return true;
+}
+
+TrafficCaptureFilter::TrafficCaptureFilter(
+    std::shared_ptr<TrafficCaptureWriter> writer,
+    CodecProtocol protocol,
+    TransportDirection direction,
+    size_t maxEvents)
+    : writer_(std::move(writer)),
+      maxEvents_(maxEvents),
+      start_(getCurrentTime()) {
+  session_.startUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    getCurrentTime<SystemClock>().time_since_epoch()).count();
+  session_.protocol = protocol;
+  session_.direction = direction;
+}
+
+TrafficCaptureFilter::~TrafficCaptureFilter() {
+  if (writer_ && !session_.events.empty()) {
+    writer_->write(session_);
+  }
+}
+
+void TrafficCaptureFilter::record(CapturedEvent::Direction direction,
+                                  CapturedEvent::Type type,
+                                  StreamID stream,
+                                  uint64_t length,
+                                  const HTTPMessage* msg) {
+  if (session_.events.size() >= maxEvents_) {
+    session_.truncated = true;
+    return;
+  }
+  CapturedEvent event;
+  event.offsetUs = clampToUint32(
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      getCurrentTime() - start_).count());
+  event.streamID = stream;
+  event.length = clampToUint32(length);
+  event.type = type;
+  event.direction = direction;
+  if (msg) {
+    event.msg = redact(*msg);
+  }
+  session_.events.push_back(std::move(event));
+}
+
+void TrafficCaptureFilter::onHeadersComplete(
+    StreamID stream,
+    std::unique_ptr<HTTPMessage> msg) {
+  record(CapturedEvent::INGRESS, CapturedEvent::HEADERS, stream, 0,
+         msg.get());
+  callback_->onHeadersComplete(stream, std::move(msg));
+}
+
+void TrafficCaptureFilter::onBody(StreamID stream,
+                                  std::unique_ptr<folly::IOBuf> chain,
+                                  uint16_t padding) {
+  record(CapturedEvent::INGRESS, CapturedEvent::BODY, stream,
+         chain ? chain->computeChainDataLength() : 0);
+  callback_->onBody(stream, std::move(chain), padding);
+}
+
+void TrafficCaptureFilter::onTrailersComplete(
+    StreamID stream,
+    std::unique_ptr<HTTPHeaders> trailers) {
+  record(CapturedEvent::INGRESS, CapturedEvent::TRAILERS, stream,
+         trailers ? trailers->size() : 0);
+  callback_->onTrailersComplete(stream, std::move(trailers));
+}
+
+void TrafficCaptureFilter::onMessageComplete(StreamID stream,
+                                             bool upgrade) {
+  record(CapturedEvent::INGRESS, CapturedEvent::EOM, stream);
+  callback_->onMessageComplete(stream, upgrade);
+}
+
+void TrafficCaptureFilter::onAbort(StreamID stream, ErrorCode code) {
+  record(CapturedEvent::INGRESS, CapturedEvent::ABORT, stream);
+  callback_->onAbort(stream, code);
+}
+
+void TrafficCaptureFilter::generateHeader(folly::IOBufQueue& writeBuf,
+                                          StreamID stream,
+                                          const HTTPMessage& msg,
+                                          bool eom,
+                                          HTTPHeaderSize* size) {
+  record(CapturedEvent::EGRESS, CapturedEvent::HEADERS, stream, 0, &msg);
+  if (eom) {
+    record(CapturedEvent::EGRESS, CapturedEvent::EOM, stream);
+  }
+  call_->generateHeader(writeBuf, stream, msg, eom, size);
+}
+
+size_t TrafficCaptureFilter::generateBody(folly::IOBufQueue& writeBuf,
+                                          StreamID stream,
+                                          std::unique_ptr<folly::IOBuf> chain,
+                                          folly::Optional<uint8_t> padding,
+                                          bool eom) {
+  record(CapturedEvent::EGRESS, CapturedEvent::BODY, stream,
+         chain ? chain->computeChainDataLength() : 0);
+  if (eom) {
+    record(CapturedEvent::EGRESS, CapturedEvent::EOM, stream);
+  }
+  return call_->generateBody(writeBuf, stream, std::move(chain), padding,
+                             eom);
+}
+
+size_t TrafficCaptureFilter::generateTrailers(folly::IOBufQueue& writeBuf,
+                                              StreamID stream,
+                                              const HTTPHeaders& trailers) {
+  record(CapturedEvent::EGRESS, CapturedEvent::TRAILERS, stream,
+         trailers.size());
+  return call_->generateTrailers(writeBuf, stream, trailers);
+}
+
+size_t TrafficCaptureFilter::generateEOM(folly::IOBufQueue& writeBuf,
+                                         StreamID stream) {
+  record(CapturedEvent::EGRESS, CapturedEvent::EOM, stream);
+  return call_->generateEOM(writeBuf, stream);
+}
+
+size_t TrafficCaptureFilter::generateRstStream(folly::IOBufQueue& writeBuf,
+                                               StreamID stream,
+                                               ErrorCode statusCode) {
+  record(CapturedEvent::EGRESS, CapturedEvent::ABORT, stream);
+  return call_->generateRstStream(writeBuf, stream, statusCode);
+}
+
+}
@@ -0,0 +1,180 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/utils/Time.h>
+
+#include <mutex>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * One message level event of a captured session.
+ */
+struct CapturedEvent {
+  enum Type : uint8_t {
+    HEADERS = 0,
+    BODY = 1,
+    TRAILERS = 2,
+    EOM = 3,
+    ABORT = 4,
+  };
+  enum Direction : uint8_t { INGRESS = 0, EGRESS = 1 };
+
+  // Since the session's capture started
+  uint32_t offsetUs{0};
+  uint64_t streamID{0};
+  // The body bytes of BODY, the number of fields of TRAILERS
+  uint32_t length{0};
+  Type type{HEADERS};
+  Direction direction{INGRESS};
+  // The message of HEADERS, with its credentials redacted
+  std::shared_ptr<const HTTPMessage> msg;
+};
+
+struct CapturedSession {
+  // System clock, in microseconds since the epoch
+  uint64_t startUs{0};
+  CodecProtocol protocol{CodecProtocol::HTTP_1_1};
+  TransportDirection direction{TransportDirection::DOWNSTREAM};
+  // The session had more events than the capture keeps
+  bool truncated{false};
+  std::vector<CapturedEvent> events;
+};
+
+/**
+ * Appends the sessions captured by TrafficCaptureFilters to a file, from
+ * any thread, for a replay tool to read back with decode().
+ *
+ * A session is written as its capture ends, with a blocking write under
+ * a lock: keep the sample rate low enough for that not to matter.
+ */
+class TrafficCaptureWriter {
+ public:
+  /**
+   * Captures sampleRate of the sessions, in [0, 1], until about maxBytes
+   * were written, unless 0.
+   */
+  TrafficCaptureWriter(folly::File file,
+                       double sampleRate,
+                       uint64_t maxBytes = 0);
+
+  // Appends to path, creating it if needed.  Throws if it can't be opened.
+  static std::shared_ptr<TrafficCaptureWriter> open(const std::string& path,
+                                                    double sampleRate,
+                                                    uint64_t maxBytes = 0);
+
+  // Whether to capture a new session
+  bool shouldSample() const;
+
+  void write(const CapturedSession& session);
+
+  uint64_t getBytesWritten() const;
+
+  // Appends the encoding of session to out
+  static void serialize(const CapturedSession& session,
+                        folly::IOBufQueue& out);
+
+  /**
+   * Appends the sessions of a capture file to sessions.  Returns false if
+   * data is not one, or was cut short.
+   */
+  static bool decode(folly::ByteRange data,
+                     std::vector<CapturedSession>& sessions);
+
+ private:
+  folly::File file_;
+  const double sampleRate_;
+  const uint64_t maxBytes_;
+  mutable std::mutex mutex_;
+  uint64_t bytesWritten_{0};
+};
+
+/**
+ * A codec filter capturing the shape of a session's traffic: when each
+ * message begins, with its headers, and the sizes and timing of its body
+ * pieces, trailers and end, in both directions.  The capture is handed to
+ * the writer once the filter is destroyed with its session.
+ *
+ * The values of Authorization, Proxy-Authorization, Cookie and Set-Cookie
+ * are replaced by as many 'x', keeping only their sizes.
+ */
+class TrafficCaptureFilter : public PassThroughHTTPCodecFilter {
+ public:
+  static const size_t kDefaultMaxEvents = 10000;
+
+  TrafficCaptureFilter(std::shared_ptr<TrafficCaptureWriter> writer,
+                       CodecProtocol protocol,
+                       TransportDirection direction,
+                       size_t maxEvents = kDefaultMaxEvents);
+
+  ~TrafficCaptureFilter() override;
+
+  const CapturedSession& getSession() const {
+    return session_;
+  }
+
+  // HTTPCodec::Callback methods
+  void onHeadersComplete(StreamID stream,
+                         std::unique_ptr<HTTPMessage> msg) override;
+
+  void onBody(StreamID stream,
+              std::unique_ptr<folly::IOBuf> chain,
+              uint16_t padding) override;
+
+  void onTrailersComplete(StreamID stream,
+                          std::unique_ptr<HTTPHeaders> trailers) override;
+
+  void onMessageComplete(StreamID stream, bool upgrade) override;
+
+  void onAbort(StreamID stream, ErrorCode code) override;
+
+  // HTTPCodec methods
+  void generateHeader(folly::IOBufQueue& writeBuf,
+                      StreamID stream,
+                      const HTTPMessage& msg,
+                      bool eom,
+                      HTTPHeaderSize* size) override;
+
+  size_t generateBody(folly::IOBufQueue& writeBuf,
+                      StreamID stream,
+                      std::unique_ptr<folly::IOBuf> chain,
+                      folly::Optional<uint8_t> padding,
+                      bool eom) override;
+
+  size_t generateTrailers(folly::IOBufQueue& writeBuf,
+                          StreamID stream,
+                          const HTTPHeaders& trailers) override;
+
+  size_t generateEOM(folly::IOBufQueue& writeBuf,
+                     StreamID stream) override;
+
+  size_t generateRstStream(folly::IOBufQueue& writeBuf,
+                           StreamID stream,
+                           ErrorCode statusCode) override;
+
+ private:
+  void record(CapturedEvent::Direction direction,
+              CapturedEvent::Type type,
+              StreamID stream,
+              uint64_t length = 0,
+              const HTTPMessage* msg = nullptr);
+
+  std::shared_ptr<TrafficCaptureWriter> writer_;
+  const size_t maxEvents_;
+  const TimePoint start_;
+  CapturedSession session_;
+};
+
+}
@@ -0,0 +1,557 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/WebSocketCodec.h>
+
+#include <cstring>
+#include <limits>
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/io/Cursor.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using folly::IOBuf;
+using folly::StringPiece;
+using std::unique_ptr;
+
+namespace {
+
+const uint8_t kFinBit = 0x80;
+const uint8_t kRsv1Bit = 0x40;
+const uint8_t kRsv2Bit = 0x20;
+const uint8_t kRsv3Bit = 0x10;
+const uint8_t kOpcodeMask = 0x0f;
+const uint8_t kControlBit = 0x08;
+const uint8_t kMaskBit = 0x80;
+const uint8_t kLengthMask = 0x7f;
+const uint8_t kLength16 = 126;
+const uint8_t kLength64 = 127;
+// The header of a masked frame with a 64-bit length
+const size_t kMaxHeaderSize = 14;
+
+// What a sync flush ends with, which permessage-deflate leaves out of
+// messages (RFC 7692 section 7.2.1)
+const uint8_t kDeflateTail[] = {0x00, 0x00, 0xff, 0xff};
+
+const StringPiece kPermessageDeflate("permessage-deflate");
+
+/**
+ * Unmasks the buffers of payload in place, or into a copy of those that
+ * are shared with something else, as the end of a read usually is.
+ */
+unique_ptr<IOBuf> unmask(unique_ptr<IOBuf> payload,
+                         const std::array<uint8_t, 4>& key) {
+  unique_ptr<IOBuf> result;
+  size_t offset = 0;
+  while (payload) {
+    auto rest = payload->pop();
+    if (payload->length() > 0) {
+      if (payload->isSharedOne()) {
+        auto copy = IOBuf::create(payload->length());
+        offset = proxygen::WebSocketCodec::applyMask(
+            payload->data(), copy->writableData(), payload->length(), key,
+            offset);
+        copy->append(payload->length());
+        payload = std::move(copy);
+      } else {
+        offset = proxygen::WebSocketCodec::applyMask(
+            payload->data(), payload->writableData(), payload->length(), key,
+            offset);
+      }
+    }
+    if (result) {
+      result->prependChain(std::move(payload));
+    } else {
+      result = std::move(payload);
+    }
+    payload = std::move(rest);
+  }
+  return result;
+}
+
+// A status code a CLOSE frame may carry (RFC 6455 section 7.4)
+bool isValidCloseCode(uint16_t code) {
+  return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011) ||
+         (code >= 3000 && code <= 4999);
+}
+
+StringPiece unquote(StringPiece value) {
+  if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+    value.advance(1);
+    value.pop_back();
+  }
+  return value;
+}
+
+}
+
+namespace proxygen {
+
+WebSocketCodec::WebSocketCodec(TransportDirection direction,
+                               const Options& options)
+    : direction_(direction), options_(options) {
+}
+
+WebSocketCodec::~WebSocketCodec() {
+}
+
+void WebSocketCodec::onIngress(unique_ptr<IOBuf> buf) {
+  if (error_ || closeReceived_) {
+    return;
+  }
+  ingress_.append(std::move(buf));
+  // parseFrame() returns false after the callbacks that may delete us
+  while (parseFrame()) {
+  }
+}
+
+bool WebSocketCodec::parseFrame() {
+  size_t available = ingress_.chainLength();
+  if (available < 2) {
+    return false;
+  }
+  folly::io::Cursor cursor(ingress_.front());
+  uint8_t firstByte = cursor.read<uint8_t>();
+  uint8_t secondByte = cursor.read<uint8_t>();
+  bool masked = secondByte & kMaskBit;
+  uint64_t length = secondByte & kLengthMask;
+  size_t headerSize = 2 + (masked ? 4 : 0);
+  if (length == kLength16) {
+    headerSize += 2;
+  } else if (length == kLength64) {
+    headerSize += 8;
+  }
+  if (available < headerSize) {
+    return false;
+  }
+  if (length == kLength16) {
+    length = cursor.readBE<uint16_t>();
+  } else if (length == kLength64) {
+    length = cursor.readBE<uint64_t>();
+  }
+  std::array<uint8_t, 4> key;
+  if (masked) {
+    cursor.pull(key.data(), key.size());
+  }
+
+  // Checked before the payload arrives, so that a bad frame fails early
+  auto opcode = Opcode(firstByte & kOpcodeMask);
+  bool fin = firstByte & kFinBit;
+  bool compressed = firstByte & kRsv1Bit;
+  bool control = firstByte & kControlBit;
+  if (firstByte & (kRsv2Bit | kRsv3Bit)) {
+    onError(CloseCode::PROTOCOL_ERROR, "reserved bits set");
+    return false;
+  }
+  if (masked != (direction_ == TransportDirection::DOWNSTREAM)) {
+    onError(CloseCode::PROTOCOL_ERROR,
+            masked ? "masked server frame" : "unmasked client frame");
+    return false;
+  }
+  if (control) {
+    if (opcode != Opcode::CLOSE && opcode != Opcode::PING &&
+        opcode != Opcode::PONG) {
+      onError(CloseCode::PROTOCOL_ERROR, "unknown opcode");
+      return false;
+    }
+    if (!fin || compressed || length > kMaxControlPayload) {
+      onError(CloseCode::PROTOCOL_ERROR, "invalid control frame");
+      return false;
+    }
+  } else {
+    if (opcode != Opcode::CONTINUATION && opcode != Opcode::TEXT &&
+        opcode != Opcode::BINARY) {
+      onError(CloseCode::PROTOCOL_ERROR, "unknown opcode");
+      return false;
+    }
+    if ((opcode == Opcode::CONTINUATION) != inMessage_) {
+      onError(CloseCode::PROTOCOL_ERROR,
+              inMessage_ ? "expected continuation" : "unexpected continuation");
+      return false;
+    }
+    if (compressed &&
+        (!options_.permessageDeflate || opcode == Opcode::CONTINUATION)) {
+      onError(CloseCode::PROTOCOL_ERROR, "unexpected RSV1");
+      return false;
+    }
+    if (length > options_.maxMessageSize - messageSize_) {
+      onError(CloseCode::MESSAGE_TOO_BIG, "message too big");
+      return false;
+    }
+  }
+  if (available - headerSize < length) {
+    return false;
+  }
+
+  ingress_.trimStart(headerSize);
+  auto payload = length > 0 ? ingress_.split(length) : IOBuf::create(0);
+  if (masked && length > 0) {
+    payload = unmask(std::move(payload), key);
+  }
+  if (control) {
+    return onControlFrame(opcode, std::move(payload));
+  }
+  return onDataFrame(opcode, fin, compressed, std::move(payload), length);
+}
+
+bool WebSocketCodec::onDataFrame(Opcode opcode,
+                                 bool fin,
+                                 bool compressed,
+                                 unique_ptr<IOBuf> payload,
+                                 size_t length) {
+  if (opcode != Opcode::CONTINUATION) {
+    message_ = std::move(payload);
+    messageOpcode_ = opcode;
+    messageCompressed_ = compressed;
+    inMessage_ = true;
+  } else {
+    message_->prependChain(std::move(payload));
+  }
+  messageSize_ += length;
+  if (!fin) {
+    return true;
+  }
+
+  auto message = std::move(message_);
+  inMessage_ = false;
+  messageSize_ = 0;
+  if (messageCompressed_) {
+    message = inflate(std::move(message));
+    if (!message) {
+      onError(CloseCode::INVALID_PAYLOAD, "inflate failed");
+      return false;
+    }
+    if (message->computeChainDataLength() > options_.maxMessageSize) {
+      onError(CloseCode::MESSAGE_TOO_BIG, "message too big");
+      return false;
+    }
+  }
+  callback_->onMessage(messageOpcode_, std::move(message));
+  return true;
+}
+
+bool WebSocketCodec::onControlFrame(Opcode opcode, unique_ptr<IOBuf> payload) {
+  switch (opcode) {
+    case Opcode::PING:
+      callback_->onPing(std::move(payload));
+      return true;
+    case Opcode::PONG:
+      callback_->onPong(std::move(payload));
+      return true;
+    case Opcode::CLOSE:
+      break;
+    default:
+      LOG(FATAL) << "Not a control opcode";
+  }
+
+  // Nothing after a CLOSE is parsed
+  ingress_.move();
+  auto length = payload->computeChainDataLength();
+  if (length == 0) {
+    closeReceived_ = true;
+    callback_->onClose(uint16_t(CloseCode::NO_STATUS), StringPiece());
+    return false;
+  }
+  if (length == 1) {
+    onError(CloseCode::PROTOCOL_ERROR, "invalid close payload");
+    return false;
+  }
+  payload->coalesce();
+  folly::io::Cursor cursor(payload.get());
+  auto code = cursor.readBE<uint16_t>();
+  if (!isValidCloseCode(code)) {
+    onError(CloseCode::PROTOCOL_ERROR, "invalid close code");
+    return false;
+  }
+  closeReceived_ = true;
+  callback_->onClose(
+      code,
+      StringPiece(reinterpret_cast<const char*>(payload->data()) + 2,
+                  length - 2));
+  return false;
+}
+
+void WebSocketCodec::onError(CloseCode code, StringPiece reason) {
+  VLOG(4) << "WebSocket protocol error: " << reason;
+  error_ = true;
+  ingress_.move();
+  message_.reset();
+  callback_->onError(code, reason);
+}
+
+unique_ptr<IOBuf> WebSocketCodec::inflate(unique_ptr<IOBuf> payload) {
+  if (!decompressor_) {
+    decompressor_ =
+        StreamCodecPool::getDecompressor(CompressionType::RAW_DEFLATE);
+  }
+  payload->prependChain(IOBuf::wrapBuffer(kDeflateTail, sizeof(kDeflateTail)));
+  auto out = decompressor_->decompress(payload.get());
+  if (!out || decompressor_->hasError() ||
+      options_.peerNoContextTakeover) {
+    // Back to the pool, unless it failed
+    decompressor_.reset();
+  }
+  return out;
+}
+
+unique_ptr<IOBuf> WebSocketCodec::deflate(const IOBuf& payload) {
+  if (!compressor_) {
+    compressor_ = StreamCodecPool::getCompressor(CompressionType::RAW_DEFLATE,
+                                                 options_.deflateLevel);
+    if (!compressor_) {
+      return nullptr;
+    }
+  }
+  auto out = compressor_->compress(&payload, false);
+  if (!out || compressor_->hasError() || options_.noContextTakeover) {
+    compressor_.reset();
+  }
+  if (!out) {
+    return nullptr;
+  }
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  queue.append(std::move(out));
+  queue.trimEnd(sizeof(kDeflateTail));
+  return queue.move();
+}
+
+void WebSocketCodec::generateMessage(folly::IOBufQueue& writeBuf,
+                                     Opcode opcode,
+                                     unique_ptr<IOBuf> payload,
+                                     size_t maxFrameSize) {
+  DCHECK(opcode == Opcode::TEXT || opcode == Opcode::BINARY);
+  if (!payload) {
+    payload = IOBuf::create(0);
+  }
+  size_t length = payload->computeChainDataLength();
+  uint8_t rsv1 = 0;
+  if (options_.permessageDeflate && length >= options_.minDeflateSize) {
+    auto compressed = deflate(*payload);
+    if (compressed) {
+      // Sent uncompressed if compression fails
+      payload = std::move(compressed);
+      length = payload->computeChainDataLength();
+      rsv1 = kRsv1Bit;
+    }
+  }
+  if (maxFrameSize == 0 || length <= maxFrameSize) {
+    writeFrame(writeBuf, kFinBit | rsv1 | uint8_t(opcode), std::move(payload),
+               length);
+    return;
+  }
+
+  folly::IOBufQueue fragments{folly::IOBufQueue::cacheChainLength()};
+  fragments.append(std::move(payload));
+  uint8_t firstByte = rsv1 | uint8_t(opcode);
+  while (fragments.chainLength() > maxFrameSize) {
+    writeFrame(writeBuf, firstByte, fragments.split(maxFrameSize),
+               maxFrameSize);
+    firstByte = uint8_t(Opcode::CONTINUATION);
+  }
+  length = fragments.chainLength();
+  writeFrame(writeBuf, kFinBit | firstByte,
+             length > 0 ? fragments.move() : IOBuf::create(0), length);
+}
+
+void WebSocketCodec::generatePing(folly::IOBufQueue& writeBuf,
+                                  unique_ptr<IOBuf> payload) {
+  size_t length = payload ? payload->computeChainDataLength() : 0;
+  CHECK_LE(length, kMaxControlPayload);
+  writeFrame(writeBuf, kFinBit | uint8_t(Opcode::PING), std::move(payload),
+             length);
+}
+
+void WebSocketCodec::generatePong(folly::IOBufQueue& writeBuf,
+                                  unique_ptr<IOBuf> payload) {
+  size_t length = payload ? payload->computeChainDataLength() : 0;
+  CHECK_LE(length, kMaxControlPayload);
+  writeFrame(writeBuf, kFinBit | uint8_t(Opcode::PONG), std::move(payload),
+             length);
+}
+
+void WebSocketCodec::generateClose(folly::IOBufQueue& writeBuf,
+                                   uint16_t code,
+                                   StringPiece reason) {
+  if (closeSent_) {
+    return;
+  }
+  closeSent_ = true;
+  unique_ptr<IOBuf> payload;
+  if (code != uint16_t(CloseCode::NO_STATUS)) {
+    reason = reason.subpiece(0, kMaxControlPayload - 2);
+    payload = IOBuf::create(2 + reason.size());
+    folly::io::Appender appender(payload.get(), 0);
+    appender.writeBE<uint16_t>(code);
+    appender.push(reinterpret_cast<const uint8_t*>(reason.data()),
+                  reason.size());
+  }
+  size_t length = payload ? payload->computeChainDataLength() : 0;
+  writeFrame(writeBuf, kFinBit | uint8_t(Opcode::CLOSE), std::move(payload),
+             length);
+}
+
+void WebSocketCodec::writeFrame(folly::IOBufQueue& writeBuf,
+                                uint8_t firstByte,
+                                unique_ptr<IOBuf> payload,
+                                size_t length) {
+  // Clients mask into a copy, since the payload may be shared
+  bool masked = direction_ == TransportDirection::UPSTREAM;
+  bool coalesce = masked || length <= kCoalesceSize;
+  folly::io::QueueAppender appender(&writeBuf, kMaxHeaderSize + kCoalesceSize);
+  appender.ensure(kMaxHeaderSize + (coalesce ? length : 0));
+
+  appender.write<uint8_t>(firstByte);
+  uint8_t maskBit = masked ? kMaskBit : 0;
+  if (length < kLength16) {
+    appender.write<uint8_t>(maskBit | uint8_t(length));
+  } else if (length <= std::numeric_limits<uint16_t>::max()) {
+    appender.write<uint8_t>(maskBit | kLength16);
+    appender.writeBE<uint16_t>(uint16_t(length));
+  } else {
+    appender.write<uint8_t>(maskBit | kLength64);
+    appender.writeBE<uint64_t>(length);
+  }
+  if (length == 0) {
+    if (masked) {
+      appender.writeBE<uint32_t>(folly::Random::rand32());
+    }
+    return;
+  }
+
+  if (!masked) {
+    if (coalesce) {
+      for (auto range : *payload) {
+        appender.push(range.data(), range.size());
+      }
+    } else {
+      writeBuf.append(std::move(payload));
+    }
+    return;
+  }
+  std::array<uint8_t, 4> key;
+  uint32_t random = folly::Random::rand32();
+  std::memcpy(key.data(), &random, key.size());
+  appender.push(key.data(), key.size());
+  size_t offset = 0;
+  for (auto range : *payload) {
+    // Masking needs contiguous room, which is always there on the first
+    appender.ensure(range.size());
+    offset = applyMask(range.data(), appender.writableData(), range.size(),
+                       key, offset);
+    appender.append(range.size());
+  }
+}
+
+size_t WebSocketCodec::applyMask(const uint8_t* in,
+                                 uint8_t* out,
+                                 size_t len,
+                                 const std::array<uint8_t, 4>& key,
+                                 size_t offset) {
+  // The key from offset, over a word; 16 and 8 byte steps keep its phase
+  uint8_t rotated[8];
+  for (size_t i = 0; i < sizeof(rotated); i++) {
+    rotated[i] = key[(offset + i) % 4];
+  }
+  uint64_t wordKey;
+  std::memcpy(&wordKey, rotated, sizeof(wordKey));
+
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i vectorKey = _mm_set1_epi64x(int64_t(wordKey));
+  for (; len - i >= 16; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_xor_si128(v, vectorKey));
+  }
+#endif
+  for (; len - i >= 8; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, in + i, sizeof(word));
+    word ^= wordKey;
+    std::memcpy(out + i, &word, sizeof(word));
+  }
+  for (; i < len; i++) {
+    out[i] = in[i] ^ rotated[i % 4];
+  }
+  return (offset + len) % 4;
+}
+
+folly::Optional<std::string> WebSocketCodec::acceptPermessageDeflate(
+    StringPiece offers, Options& options) {
+  std::vector<StringPiece> extensions;
+  folly::split(',', offers, extensions);
+  for (auto extension : extensions) {
+    std::vector<StringPiece> params;
+    folly::split(';', extension, params);
+    if (folly::trimWhitespace(params[0]) != kPermessageDeflate) {
+      continue;
+    }
+    bool acceptable = true;
+    bool serverNoContextTakeover = false;
+    bool clientNoContextTakeover = false;
+    bool serverMaxWindowBits = false;
+    bool clientMaxWindowBits = false;
+    for (size_t i = 1; i < params.size() && acceptable; i++) {
+      StringPiece name = folly::trimWhitespace(params[i]);
+      StringPiece value;
+      auto equals = name.find('=');
+      if (equals != StringPiece::npos) {
+        value = unquote(folly::trimWhitespace(name.subpiece(equals + 1)));
+        name = folly::trimWhitespace(name.subpiece(0, equals));
+      }
+      // Each at most once, as RFC 7692 section 7 requires
+      if (name == "server_no_context_takeover") {
+        acceptable = !serverNoContextTakeover && value.empty();
+        serverNoContextTakeover = true;
+      } else if (name == "client_no_context_takeover") {
+        acceptable = !clientNoContextTakeover && value.empty();
+        clientNoContextTakeover = true;
+      } else if (name == "client_max_window_bits") {
+        // Inflating with the largest window accepts any smaller one
+        auto bits = folly::tryTo<int>(value);
+        acceptable = !clientMaxWindowBits &&
+                     (value.empty() || (bits && *bits >= 8 && *bits <= 15));
+        clientMaxWindowBits = true;
+      } else if (name == "server_max_window_bits") {
+        // The pooled compressors always use the largest window
+        acceptable = !serverMaxWindowBits && value == "15";
+        serverMaxWindowBits = true;
+      } else {
+        acceptable = false;
+      }
+    }
+    if (!acceptable) {
+      continue;
+    }
+
+    std::string response = kPermessageDeflate.str();
+    if (serverNoContextTakeover) {
+      response += "; server_no_context_takeover";
+    }
+    if (clientNoContextTakeover) {
+      response += "; client_no_context_takeover";
+    }
+    if (serverMaxWindowBits) {
+      response += "; server_max_window_bits=15";
+    }
+    options.permessageDeflate = true;
+    options.noContextTakeover = serverNoContextTakeover;
+    options.peerNoContextTakeover = clientNoContextTakeover;
+    return response;
+  }
+  return folly::none;
+}
+
+}
@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/io/IOBufQueue.h>
+#include <memory>
+#include <proxygen/lib/http/codec/TransportDirection.h>
+#include <string>
+
+namespace proxygen {
+
+class StreamCompressor;
+class StreamDecompressor;
+
+/**
+ * The framing of RFC 6455, with the permessage-deflate extension of RFC
+ * 7692, for the body of a transaction upgraded to WebSocket.  onIngress()
+ * takes the bytes that follow the upgrade, and calls back with whole
+ * messages, unmasked and inflated; the generate functions append frames to
+ * a queue, for HTTPTransaction::sendBody().
+ *
+ * Payloads are split off the ingress rather than copied, and fragmented
+ * messages chained.  Masked payloads are unmasked in place, with SSE2 where
+ * the build targets it, unless their buffer is shared, in which case they
+ * are unmasked into a copy in the same pass.  Compression contexts come
+ * from StreamCodecPool, and go back to it after each message when the
+ * extension was negotiated without context takeover.
+ */
+class WebSocketCodec {
+ public:
+  enum class Opcode : uint8_t {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA,
+  };
+
+  // The status codes of CLOSE frames (RFC 6455 section 7.4.1)
+  enum class CloseCode : uint16_t {
+    NORMAL = 1000,
+    GOING_AWAY = 1001,
+    PROTOCOL_ERROR = 1002,
+    UNSUPPORTED_DATA = 1003,
+    NO_STATUS = 1005,
+    INVALID_PAYLOAD = 1007,
+    POLICY_VIOLATION = 1008,
+    MESSAGE_TOO_BIG = 1009,
+    INTERNAL_ERROR = 1011,
+  };
+
+  class Callback {
+   public:
+    virtual ~Callback() {}
+
+    // A whole TEXT or BINARY message
+    virtual void onMessage(Opcode opcode,
+                           std::unique_ptr<folly::IOBuf> payload) = 0;
+
+    virtual void onPing(std::unique_ptr<folly::IOBuf> payload) = 0;
+
+    virtual void onPong(std::unique_ptr<folly::IOBuf> /*payload*/) {}
+
+    // The peer's CLOSE, with NO_STATUS if it had no code
+    virtual void onClose(uint16_t code, folly::StringPiece reason) = 0;
+
+    /**
+     * The ingress broke the protocol, and the connection should be closed
+     * with code.  The codec parses nothing after this.
+     */
+    virtual void onError(CloseCode code, folly::StringPiece reason) = 0;
+  };
+
+  struct Options {
+    // Larger messages, after inflating, fail with MESSAGE_TOO_BIG
+    size_t maxMessageSize{1024 * 1024};
+    // Both ends agreed on permessage-deflate, see acceptPermessageDeflate()
+    bool permessageDeflate{false};
+    // Egress messages don't refer to earlier ones, nor ingress (resp.)
+    bool noContextTakeover{false};
+    bool peerNoContextTakeover{false};
+    // zlib's level, -1 for its default
+    int deflateLevel{-1};
+    // Smaller messages are sent uncompressed
+    size_t minDeflateSize{64};
+  };
+
+  // Payloads up to this size are copied after their frame's header
+  static constexpr size_t kCoalesceSize = 512;
+  static constexpr size_t kMaxControlPayload = 125;
+
+  WebSocketCodec(TransportDirection direction, const Options& options);
+  ~WebSocketCodec();
+
+  WebSocketCodec(const WebSocketCodec&) = delete;
+  WebSocketCodec& operator=(const WebSocketCodec&) = delete;
+
+  void setCallback(Callback* callback) {
+    callback_ = callback;
+  }
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+  /**
+   * Parses buf, after what's left of earlier calls, calling back for each
+   * message and control frame it completes.  The codec may be deleted from
+   * onClose() and onError(), which end the parsing, but not from the other
+   * callbacks.  TEXT payloads are not checked to be UTF-8.
+   */
+  void onIngress(std::unique_ptr<folly::IOBuf> buf);
+
+  bool hasError() const {
+    return error_;
+  }
+
+  /**
+   * Appends a TEXT or BINARY message to writeBuf, as frames of at most
+   * maxFrameSize bytes if that is not 0.  Payloads of up to kCoalesceSize
+   * bytes share their header's buffer, so that a batch of small messages
+   * stays a few IOBufs; larger ones are chained.
+   */
+  void generateMessage(folly::IOBufQueue& writeBuf,
+                       Opcode opcode,
+                       std::unique_ptr<folly::IOBuf> payload,
+                       size_t maxFrameSize = 0);
+
+  // Payloads of at most kMaxControlPayload bytes
+  void generatePing(folly::IOBufQueue& writeBuf,
+                    std::unique_ptr<folly::IOBuf> payload);
+  void generatePong(folly::IOBufQueue& writeBuf,
+                    std::unique_ptr<folly::IOBuf> payload);
+
+  // Only the first CLOSE is written; the reason is truncated to fit
+  void generateClose(folly::IOBufQueue& writeBuf,
+                     uint16_t code,
+                     folly::StringPiece reason = folly::StringPiece());
+
+  bool isCloseSent() const {
+    return closeSent_;
+  }
+
+  /**
+   * XORs len bytes from in into out, which may be the same, with key
+   * starting from its byte offset % 4.  Returns the offset to go on with.
+   */
+  static size_t applyMask(const uint8_t* in,
+                          uint8_t* out,
+                          size_t len,
+                          const std::array<uint8_t, 4>& key,
+                          size_t offset = 0);
+
+  /**
+   * The Sec-WebSocket-Extensions value a server responds with to the
+   * client's offers, the first acceptable permessage-deflate one, which it
+   * sets options to; none if there is no such offer.  Offers limiting the
+   * server's window below the default are declined.
+   */
+  static folly::Optional<std::string> acceptPermessageDeflate(
+      folly::StringPiece offers, Options& options);
+
+ private:
+  // Parses a frame off ingress_, false if it isn't all there
+  bool parseFrame();
+
+  // Both return false once parsing must stop
+  bool onDataFrame(Opcode opcode,
+                   bool fin,
+                   bool compressed,
+                   std::unique_ptr<folly::IOBuf> payload,
+                   size_t length);
+  bool onControlFrame(Opcode opcode, std::unique_ptr<folly::IOBuf> payload);
+
+  void onError(CloseCode code, folly::StringPiece reason);
+
+  std::unique_ptr<folly::IOBuf> inflate(std::unique_ptr<folly::IOBuf> payload);
+  std::unique_ptr<folly::IOBuf> deflate(const folly::IOBuf& payload);
+
+  void writeFrame(folly::IOBufQueue& writeBuf,
+                  uint8_t firstByte,
+                  std::unique_ptr<folly::IOBuf> payload,
+                  size_t length);
+
+  const TransportDirection direction_;
+  const Options options_;
+  Callback* callback_{nullptr};
+  folly::IOBufQueue ingress_{folly::IOBufQueue::cacheChainLength()};
+  // The fragments of the ingress message so far
+  std::unique_ptr<folly::IOBuf> message_;
+  size_t messageSize_{0};
+  Opcode messageOpcode_{Opcode::CONTINUATION};
+  bool messageCompressed_{false};
+  bool inMessage_{false};
+  bool error_{false};
+  bool closeReceived_{false};
+  bool closeSent_{false};
+  std::shared_ptr<StreamCompressor> compressor_;
+  std::shared_ptr<StreamDecompressor> decompressor_;
+};
+
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/compress/AdaptiveIndexingStrategy.h>
+
+#include <algorithm>
+#include <folly/hash/Hash.h>
+
+namespace proxygen {
+
+const uint32_t AdaptiveIndexingStrategy::kRecentValues;
+const uint32_t AdaptiveIndexingStrategy::kMinSamples;
+const uint32_t AdaptiveIndexingStrategy::kDecayInterval;
+const size_t AdaptiveIndexingStrategy::kMaxNames;
+
+bool AdaptiveIndexingStrategy::observe(NameStats& stats, uint32_t valueHash) {
+  // the value slots start zeroed, only compare the ones written so far
+  auto end = stats.recent.begin() + std::min(stats.seen, kRecentValues);
+  bool repeat = std::find(stats.recent.begin(), end, valueHash) != end;
+  if (!repeat) {
+    stats.recent[stats.next] = valueHash;
+    stats.next = (stats.next + 1) % kRecentValues;
+  }
+  if (stats.seen >= kDecayInterval) {
+    stats.seen /= 2;
+    stats.repeats /= 2;
+  }
+  stats.seen++;
+  stats.repeats += repeat ? 1 : 0;
+  return repeat;
+}
+
+bool AdaptiveIndexingStrategy::indexHeader(const HPACKHeader& header) const {
+  bool index = !base_ || base_->indexHeader(header);
+  if (!index) {
+    // nothing to learn, the base strategy never indexes it
+    return false;
+  }
+  auto it = names_.find(header.name);
+  if (it == names_.end()) {
+    if (names_.size() >= kMaxNames) {
+      return true;
+    }
+    it = names_.emplace(header.name, NameStats()).first;
+  }
+  auto& stats = it->second;
+  auto valueHash = uint32_t(
+    folly::hash::fnv32_buf(header.value.data(), header.value.size()));
+  observe(stats, valueHash);
+  if (stats.seen >= kMinSamples &&
+      stats.repeats < minReuseRate_ * stats.seen) {
+    suppressed_++;
+    return false;
+  }
+  return true;
+}
+
+double AdaptiveIndexingStrategy::getReuseRate(
+    const HPACKHeaderName& name) const {
+  auto it = names_.find(name);
+  if (it == names_.end() || it->second.seen == 0) {
+    return -1;
+  }
+  return double(it->second.repeats) / it->second.seen;
+}
+
+}
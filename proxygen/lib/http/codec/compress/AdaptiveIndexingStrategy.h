@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
+
+#include <array>
+
+namespace proxygen {
+
+/**
+ * Indexing strategy that learns, per header name, how often a value is sent
+ * again on the connection and stops indexing names whose values rarely
+ * repeat (request ids, trace headers, ...): inserting those only evicts
+ * entries that would have been referenced.
+ *
+ * A value counts as repeated when it matches one of the last kRecentValues
+ * values of its name.  Until a name has been seen kMinSamples times, and for
+ * names beyond the first kMaxNames, the base strategy decides.  Counts are
+ * halved every kDecayInterval occurrences so a name can start being indexed
+ * again when its values do.
+ *
+ * The statistics are mutated from the const indexHeader(): each encoder
+ * needs its own instance, which must outlive it.
+ */
+class AdaptiveIndexingStrategy : public HeaderIndexingStrategy {
+ public:
+  static const uint32_t kRecentValues = 4;
+  static const uint32_t kMinSamples = 8;
+  static const uint32_t kDecayInterval = 64;
+  static const size_t kMaxNames = 128;
+
+  explicit AdaptiveIndexingStrategy(
+    const HeaderIndexingStrategy* base =
+      HeaderIndexingStrategy::getDefaultInstance(),
+    double minReuseRate = 0.25)
+      : base_(base),
+        minReuseRate_(minReuseRate) {}
+
+  bool indexHeader(const HPACKHeader& header) const override;
+
+  /**
+   * Fraction of the occurrences of name that repeated a recent value, or -1
+   * if the name is not tracked
+   */
+  double getReuseRate(const HPACKHeaderName& name) const;
+
+  // Times indexHeader overrode the base strategy to refuse indexing
+  uint64_t getSuppressed() const {
+    return suppressed_;
+  }
+
+ private:
+  struct NameStats {
+    std::array<uint32_t, kRecentValues> recent{};
+    uint32_t next{0};
+    uint32_t seen{0};
+    uint32_t repeats{0};
+  };
+
+  // Returns whether the value repeats a recent one
+  static bool observe(NameStats& stats, uint32_t valueHash);
+
+  const HeaderIndexingStrategy* base_;
+  double minReuseRate_;
+  mutable folly::F14FastMap<HPACKHeaderName, NameStats> names_;
+  mutable uint64_t suppressed_{0};
+};
+
+}
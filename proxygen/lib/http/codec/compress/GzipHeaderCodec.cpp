@@ -36,6 +36,15 @@ namespace {
 // Maximum size of header names+values after expanding multi-value headers
 const size_t kMaxExpandedHeaderLineBytes = 80 * 1024;
 
+// Zero has inflate size its window from the zlib header of the peer's
+// stream, 2KB for our own deflater and Chrome's, rather than allocate the
+// largest one, 32KB, for every connection
+#if ZLIB_VERNUM >= 0x1235
+const int kInflateWindowBits = 0;
+#else
+const int kInflateWindowBits = MAX_WBITS;
+#endif
+
 // Pre-initialized compression contexts seeded with the
 // starting dictionary for different SPDY versions - cloning
 // one of these is faster than initializing and seeding a
@@ -140,7 +149,7 @@ static const ZlibContext* getZlibContext(SPDYVersionSettings versionSettings,
     // double it if necessary
     newContext->inflater.reserved = 0x01;
 #endif
-    r = inflateInit2(&(newContext->inflater), MAX_WBITS);
+    r = inflateInit2(&(newContext->inflater), kInflateWindowBits);
     CHECK_EQ(r, Z_OK);
 
     auto result = newContext.get();
@@ -155,12 +164,8 @@ namespace proxygen {
 
 GzipHeaderCodec::GzipHeaderCodec(int compressionLevel,
                                  const SPDYVersionSettings& versionSettings)
-    : versionSettings_(versionSettings) {
-  // Create compression and decompression contexts by cloning thread-local
-  // copies of the initial SPDY compression state
-  auto context = getZlibContext(versionSettings, compressionLevel);
-  deflateCopy(&deflater_, const_cast<z_stream*>(&(context->deflater)));
-  inflateCopy(&inflater_, const_cast<z_stream*>(&(context->inflater)));
+    : versionSettings_(versionSettings),
+      compressionLevel_(compressionLevel) {
 }
 
 GzipHeaderCodec::GzipHeaderCodec(int compressionLevel,
@@ -170,8 +175,54 @@ GzipHeaderCodec::GzipHeaderCodec(int compressionLevel,
         SPDYCodec::getVersionSettings(version)) {}
 
 GzipHeaderCodec::~GzipHeaderCodec() {
-  deflateEnd(&deflater_);
-  inflateEnd(&inflater_);
+  if (hasDeflater_) {
+    deflateEnd(&deflater_);
+  }
+  if (hasInflater_) {
+    inflateEnd(&inflater_);
+  }
+}
+
+// The contexts are cloned from thread-local copies of the initial SPDY
+// compression state when first needed, connections that never send or
+// receive a header block don't pay for them
+z_stream& GzipHeaderCodec::getDeflater() {
+  if (!hasDeflater_) {
+    auto context = getZlibContext(versionSettings_, compressionLevel_);
+    int r = deflateCopy(&deflater_,
+                        const_cast<z_stream*>(&(context->deflater)));
+    CHECK_EQ(r, Z_OK);
+    hasDeflater_ = true;
+  }
+  return deflater_;
+}
+
+z_stream& GzipHeaderCodec::getInflater() {
+  if (!hasInflater_) {
+    auto context = getZlibContext(versionSettings_, compressionLevel_);
+    int r = inflateCopy(&inflater_,
+                        const_cast<z_stream*>(&(context->inflater)));
+    CHECK_EQ(r, Z_OK);
+    hasInflater_ = true;
+  }
+  return inflater_;
+}
+
+size_t GzipHeaderCodec::getMemoryUsage() const {
+  // zlib's documented usage: (1 << (windowBits + 2)) + (1 << (memLevel + 9))
+  // for deflate with memLevel 1, and about 7KB of state for inflate, plus
+  // its window
+  size_t bytes = 0;
+  if (hasDeflater_) {
+    int windowBits = (compressionLevel_ == Z_NO_COMPRESSION) ? 8 : 11;
+    bytes += (1 << (windowBits + 2)) + (1 << 10);
+  }
+  if (hasInflater_) {
+    int windowBits = kInflateWindowBits ? kInflateWindowBits
+                                        : inflateWindowBits_;
+    bytes += 7 * 1024 + (windowBits ? (1 << windowBits) : 0);
+  }
+  return bytes;
 }
 
 folly::IOBuf& GzipHeaderCodec::getHeaderBuf() {
@@ -260,19 +311,20 @@ unique_ptr<IOBuf> GzipHeaderCodec::encode(vector<Header>& headers) noexcept {
 
   // Allocate a contiguous space big enough to hold the compressed headers,
   // plus any headroom requested by the caller.
-  size_t maxDeflatedSize = deflateBound(&deflater_, uncompressedLen);
+  auto& deflater = getDeflater();
+  size_t maxDeflatedSize = deflateBound(&deflater, uncompressedLen);
   unique_ptr<IOBuf> out(IOBuf::create(maxDeflatedSize + encodeHeadroom_));
   out->advance(encodeHeadroom_);
 
   // Compress
-  deflater_.next_in = uncompressed.writableData();
-  deflater_.avail_in = uncompressedLen;
-  deflater_.next_out = out->writableData();
-  deflater_.avail_out = maxDeflatedSize;
-  int r = deflate(&deflater_, Z_SYNC_FLUSH);
+  deflater.next_in = uncompressed.writableData();
+  deflater.avail_in = uncompressedLen;
+  deflater.next_out = out->writableData();
+  deflater.avail_out = maxDeflatedSize;
+  int r = deflate(&deflater, Z_SYNC_FLUSH);
   CHECK_EQ(r, Z_OK);
-  CHECK_EQ(deflater_.avail_in, 0);
-  out->append(maxDeflatedSize - deflater_.avail_out);
+  CHECK_EQ(deflater.avail_in, 0);
+  out->append(maxDeflatedSize - deflater.avail_out);
 
   VLOG(4) << "header size orig=" << uncompressedLen
           << ", max deflated=" << maxDeflatedSize
@@ -298,13 +350,22 @@ GzipHeaderCodec::decode(Cursor& cursor, uint32_t length) noexcept {
 
   // Get the thread local buffer space to use
   auto& uncompressed = getHeaderBuf();
+  if (!hasInflater_) {
+    // The window size from the CMF byte of the zlib header, for
+    // getMemoryUsage()
+    auto first = cursor.peekBytes();
+    if (!first.empty() && (first[0] & 0x0f) == Z_DEFLATED) {
+      inflateWindowBits_ = (first[0] >> 4) + 8;
+    }
+  }
+  auto& inflater = getInflater();
   uint32_t consumed = 0;
   // Decompress the headers
   while (length > 0) {
     auto next = cursor.peek();
     uint32_t chunkLen = std::min((uint32_t)next.second, length);
-    inflater_.avail_in = chunkLen;
-    inflater_.next_in = (uint8_t *)next.first;
+    inflater.avail_in = chunkLen;
+    inflater.next_in = (uint8_t *)next.first;
     do {
       if (uncompressed.tailroom() == 0) {
         // This code should not execute, since we throw an error if the
@@ -314,19 +375,19 @@ GzipHeaderCodec::decode(Cursor& cursor, uint32_t length) noexcept {
         uncompressed.reserve(0, uncompressed.capacity());
       }
 
-      inflater_.next_out = uncompressed.writableTail();
-      inflater_.avail_out = uncompressed.tailroom();
-      int r = inflate(&inflater_, Z_NO_FLUSH);
+      inflater.next_out = uncompressed.writableTail();
+      inflater.avail_out = uncompressed.tailroom();
+      int r = inflate(&inflater, Z_NO_FLUSH);
       if (r == Z_NEED_DICT) {
         // we cannot initialize the inflater dictionary before calling inflate()
         // as it checks the adler-32 checksum of the supplied dictionary
-        r = inflateSetDictionary(&inflater_, versionSettings_.dict,
+        r = inflateSetDictionary(&inflater, versionSettings_.dict,
                                  versionSettings_.dictSize);
         if (r != Z_OK) {
           LOG(ERROR) << "inflate set dictionary failed with error=" << r;
           return folly::makeUnexpected(GzipDecodeError::INFLATE_DICTIONARY);
         }
-        inflater_.avail_out = 0;
+        inflater.avail_out = 0;
         continue;
       }
       if (r != 0) {
@@ -334,12 +395,12 @@ GzipHeaderCodec::decode(Cursor& cursor, uint32_t length) noexcept {
         LOG(ERROR) << "inflate failed with error=" << r;
         return folly::makeUnexpected(GzipDecodeError::BAD_ENCODING);
       }
-      uncompressed.append(uncompressed.tailroom() - inflater_.avail_out);
+      uncompressed.append(uncompressed.tailroom() - inflater.avail_out);
       if (uncompressed.length() > maxUncompressed_) {
         LOG(ERROR) << "Decompressed headers too large";
         return folly::makeUnexpected(GzipDecodeError::HEADERS_TOO_LARGE);
       }
-    } while (inflater_.avail_in > 0 && inflater_.avail_out == 0);
+    } while (inflater.avail_in > 0 && inflater.avail_out == 0);
     length -= chunkLen;
     consumed += chunkLen;
     cursor.skip(chunkLen);
@@ -53,9 +53,16 @@ class GzipHeaderCodec : public HeaderCodec {
     return decodedSize_;
   }
 
+  // Approximate heap bytes held by the zlib contexts created so far
+  size_t getMemoryUsage() const;
+
  private:
   folly::IOBuf& getHeaderBuf();
 
+  // The contexts, created on first use
+  z_stream& getDeflater();
+  z_stream& getInflater();
+
   /**
    * Parse the decompressed name/value header block.
    */
@@ -64,8 +71,13 @@ class GzipHeaderCodec : public HeaderCodec {
                   uint32_t uncompressedLength) noexcept;
 
   const SPDYVersionSettings& versionSettings_;
+  int compressionLevel_;
   z_stream deflater_;
   z_stream inflater_;
+  bool hasDeflater_{false};
+  bool hasInflater_{false};
+  // Of the peer's stream, once its first header block is seen
+  uint8_t inflateWindowBits_{0};
   compress::HeaderPieceList outHeaders_;
   HTTPHeaderSize decodedSize_;
 };
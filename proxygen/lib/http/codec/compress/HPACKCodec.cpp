@@ -45,10 +45,12 @@ HPACKCodec::HPACKCodec(TransportDirection /*direction*/)
     : encoder_(true, HPACK::kTableSize),
       decoder_(HPACK::kTableSize, maxUncompressed_) {}
 
-unique_ptr<IOBuf> HPACKCodec::encode(vector<Header>& headers) noexcept {
+unique_ptr<IOBuf> HPACKCodec::encode(
+    vector<Header>& headers,
+    const HuffmanLiterals* huffmanLiterals) noexcept {
   auto prepared = compress::prepareHeaders(headers);
   encodedSize_.uncompressed = prepared.second;
-  auto buf = encoder_.encode(prepared.first, encodeHeadroom_);
+  auto buf = encoder_.encode(prepared.first, encodeHeadroom_, huffmanLiterals);
   recordCompressedSize(buf.get());
   return buf;
 }
@@ -74,6 +76,15 @@ void HPACKCodec::decodeStreaming(
   decoder_.decodeStreaming(cursor, length, streamingCb);
 }
 
+uint32_t HPACKCodec::decodeStreamingPartial(
+    Cursor& cursor,
+    uint32_t length,
+    HPACK::StreamingCallback* streamingCb,
+    bool last) noexcept {
+  streamingCb->stats = stats_;
+  return decoder_.decodeStreamingPartial(cursor, length, streamingCb, last);
+}
+
 void HPACKCodec::describe(std::ostream& stream) const {
   stream << "DecoderTable:\n" << decoder_;
   stream << "EncoderTable:\n" << encoder_;
@@ -43,14 +43,23 @@ class HPACKCodec : public HeaderCodec {
   explicit HPACKCodec(TransportDirection direction);
   ~HPACKCodec() override {}
 
+  // See HPACKEncoder::encode for huffmanLiterals
   std::unique_ptr<folly::IOBuf> encode(
-    std::vector<compress::Header>& headers) noexcept;
+    std::vector<compress::Header>& headers,
+    const HuffmanLiterals* huffmanLiterals = nullptr) noexcept;
 
   void decodeStreaming(
       folly::io::Cursor& cursor,
       uint32_t length,
       HPACK::StreamingCallback* streamingCb) noexcept;
 
+  // See HPACKDecoder::decodeStreamingPartial
+  uint32_t decodeStreamingPartial(
+      folly::io::Cursor& cursor,
+      uint32_t length,
+      HPACK::StreamingCallback* streamingCb,
+      bool last) noexcept;
+
   void setEncoderHeaderTableSize(uint32_t size) {
     encoder_.setHeaderTableSize(size);
   }
@@ -78,10 +87,38 @@ class HPACKCodec : public HeaderCodec {
   void setHeaderIndexingStrategy(const HeaderIndexingStrategy* indexingStrat) {
     encoder_.setHeaderIndexingStrategy(indexingStrat);
   }
+
+  /**
+   * Release compression state while the connection is idle: the encoder
+   * drops its dynamic table, telling the peer with the next block, and the
+   * decoder releases table slots without entries.
+   */
+  void hibernate() {
+    encoder_.clearTable();
+    decoder_.shrinkTable();
+  }
+
+  // Approximate heap bytes held by the encoder and decoder state
+  size_t getMemoryUsage() const {
+    return encoder_.getMemoryUsage() + decoder_.getTable().memoryUsage();
+  }
   const HeaderIndexingStrategy* getHeaderIndexingStrategy() const {
     return encoder_.getHeaderIndexingStrategy();
   }
 
+  // See HPACKEncoder::setEncodeCacheSize
+  void setEncodeCacheSize(size_t size) {
+    encoder_.setEncodeCacheSize(size);
+  }
+
+  folly::Optional<bool> lastEncodeCacheHit() const {
+    return encoder_.lastEncodeCacheHit();
+  }
+
+  void setUseStaticBlockCache(bool use) {
+    encoder_.setUseStaticBlockCache(use);
+  }
+
  protected:
   HPACKEncoder encoder_;
   HPACKDecoder decoder_;
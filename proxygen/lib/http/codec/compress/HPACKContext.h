@@ -63,6 +63,11 @@ class HPACKContext {
 
   void seedHeaderTable(std::vector<HPACKHeader>& headers);
 
+  // See HeaderTable::shrinkToFit
+  void shrinkTable() {
+    table_.shrinkToFit();
+  }
+
   void describe(std::ostream& os) const;
 
  protected:
@@ -9,6 +9,7 @@
  */
 #include <proxygen/lib/http/codec/compress/HPACKDecodeBuffer.h>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <proxygen/lib/http/codec/compress/Huffman.h>
@@ -50,12 +51,16 @@ uint8_t HPACKDecodeBuffer::peek() {
   return *cursor_.data();
 }
 
-DecodeError HPACKDecodeBuffer::decodeLiteral(folly::fbstring& literal) {
-  return decodeLiteral(7, literal);
+DecodeError HPACKDecodeBuffer::decodeLiteral(
+    folly::fbstring& literal,
+    HuffmanLiterals* huffmanLiterals) {
+  return decodeLiteral(7, literal, huffmanLiterals);
 }
 
-DecodeError HPACKDecodeBuffer::decodeLiteral(uint8_t nbit,
-                                             folly::fbstring& literal) {
+DecodeError HPACKDecodeBuffer::decodeLiteral(
+    uint8_t nbit,
+    folly::fbstring& literal,
+    HuffmanLiterals* huffmanLiterals) {
   literal.clear();
   if (remainingBytes_ == 0) {
     EOB_LOG("remainingBytes_ == 0");
@@ -71,15 +76,16 @@ DecodeError HPACKDecodeBuffer::decodeLiteral(uint8_t nbit,
     EOB_LOG("Could not decode literal size", result);
     return result;
   }
+  // Before waiting for the rest of a literal that is too large anyway
+  if (size > maxLiteralSize_) {
+    LOG(ERROR) << "Literal too large, size=" << size;
+    return DecodeError::LITERAL_TOO_LARGE;
+  }
   if (size > remainingBytes_) {
     EOB_LOG(folly::to<std::string>(
                 "size(", size, ") > remainingBytes_(", remainingBytes_, ")"));
     return DecodeError::BUFFER_UNDERFLOW;
   }
-  if (size > maxLiteralSize_) {
-    LOG(ERROR) << "Literal too large, size=" << size;
-    return DecodeError::LITERAL_TOO_LARGE;
-  }
   const uint8_t* data;
   unique_ptr<IOBuf> tmpbuf;
   // handle the case where the buffer spans multiple buffers
@@ -96,6 +102,11 @@ DecodeError HPACKDecodeBuffer::decodeLiteral(uint8_t nbit,
   if (huffman) {
     static auto& huffmanTree = huffman::huffTree();
     huffmanTree.decode(data, size, literal);
+    folly::ByteRange encoded(data, size);
+    if (huffmanLiterals &&
+        huffmanTree.isCanonicalEncoding(literal, encoded)) {
+      huffmanLiterals->add(literal, encoded);
+    }
   } else {
     literal.append((const char *)data, size);
   }
@@ -103,6 +114,40 @@ DecodeError HPACKDecodeBuffer::decodeLiteral(uint8_t nbit,
   return DecodeError::NONE;
 }
 
+DecodeError HPACKDecodeBuffer::decodeIntegerFrom(const uint8_t*& p,
+                                                  const uint8_t* end,
+                                                  uint8_t nbit,
+                                                  uint64_t& integer) {
+  DCHECK_LT(p, end);
+  uint8_t mask = HPACK::NBIT_MASKS[nbit];
+  uint8_t byte = *p++ & mask;
+  integer = byte;
+  if (byte != mask) {
+    return DecodeError::NONE;
+  }
+  uint64_t f = 1;
+  uint32_t fexp = 0;
+  while (p < end) {
+    byte = *p++;
+    if (fexp > 64) {
+      LOG(ERROR) << "overflow fexp=" << fexp;
+      return DecodeError::INTEGER_OVERFLOW;
+    }
+    uint64_t add = (byte & 127) * f;
+    if (std::numeric_limits<uint64_t>::max() - integer <= add) {
+      LOG(ERROR) << "overflow integer=" << integer << " add=" << add;
+      return DecodeError::INTEGER_OVERFLOW;
+    }
+    integer += add;
+    if (!(byte & 128)) {
+      return DecodeError::NONE;
+    }
+    f = f << 7;
+    fexp += 7;
+  }
+  return DecodeError::BUFFER_UNDERFLOW;
+}
+
 DecodeError HPACKDecodeBuffer::decodeInteger(uint64_t& integer) {
   return decodeInteger(8, integer);
 }
@@ -112,6 +157,21 @@ DecodeError HPACKDecodeBuffer::decodeInteger(uint8_t nbit, uint64_t& integer) {
     EOB_LOG("remainingBytes_ == 0");
     return DecodeError::BUFFER_UNDERFLOW;
   }
+  // Most integers end within the current buffer: decode them from a pointer
+  // and move the cursor once, rather than byte by byte
+  size_t length = std::min<size_t>(cursor_.length(), remainingBytes_);
+  if (length > 0) {
+    const uint8_t* begin = cursor_.data();
+    const uint8_t* end = begin + length;
+    const uint8_t* p = begin;
+    auto result = decodeIntegerFrom(p, end, nbit, integer);
+    if (result != DecodeError::BUFFER_UNDERFLOW) {
+      cursor_.skip(p - begin);
+      remainingBytes_ -= (p - begin);
+      return result;
+    }
+    // Continues in the next buffer, if any
+  }
   uint8_t byte = next();
   uint8_t mask = HPACK::NBIT_MASKS[nbit];
   // remove the first (8 - nbit) bits
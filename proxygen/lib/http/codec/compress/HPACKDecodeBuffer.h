@@ -15,6 +15,7 @@
 #include <folly/io/IOBuf.h>
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
 #include <proxygen/lib/http/codec/compress/Huffman.h>
+#include <proxygen/lib/http/codec/compress/HuffmanLiterals.h>
 
 namespace proxygen {
 
@@ -80,13 +81,29 @@ class HPACKDecodeBuffer {
   HPACK::DecodeError decodeInteger(uint64_t& integer);
 
   /**
-   * decode a literal starting from the current position
+   * decode a literal starting from the current position.  Huffman encoded
+   * literals are also added to huffmanLiterals, if given.
    */
-  HPACK::DecodeError decodeLiteral(folly::fbstring& literal);
+  HPACK::DecodeError decodeLiteral(
+    folly::fbstring& literal,
+    HuffmanLiterals* huffmanLiterals = nullptr);
 
-  HPACK::DecodeError decodeLiteral(uint8_t nbit, folly::fbstring& literal);
+  HPACK::DecodeError decodeLiteral(
+    uint8_t nbit,
+    folly::fbstring& literal,
+    HuffmanLiterals* huffmanLiterals = nullptr);
 
 private:
+  /**
+   * Decodes an integer from the contiguous bytes [p, end), with p moved
+   * past it.  BUFFER_UNDERFLOW if it doesn't end before end, in which case
+   * p and integer are meaningless.
+   */
+  static HPACK::DecodeError decodeIntegerFrom(const uint8_t*& p,
+                                              const uint8_t* end,
+                                              uint8_t nbit,
+                                              uint64_t& integer);
+
   void EOB_LOG(std::string msg,
                HPACK::DecodeError code=
                HPACK::DecodeError::BUFFER_UNDERFLOW) const;
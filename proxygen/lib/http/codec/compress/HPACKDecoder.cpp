@@ -41,6 +41,43 @@ void HPACKDecoder::decodeStreaming(
                  compressedSize, emittedSize);
 }
 
+uint32_t HPACKDecoder::decodeStreamingPartial(
+    Cursor& cursor,
+    uint32_t totalBytes,
+    HPACK::StreamingCallback* streamingCb,
+    bool last) {
+  HPACKDecodeBuffer dbuf(cursor, totalBytes, maxUncompressed_, last);
+  uint32_t consumed = 0;
+
+  while (!hasError() && !dbuf.empty()) {
+    uint32_t emitted = decodeHeader(dbuf, streamingCb, nullptr);
+    if (!last && err_ == HPACK::DecodeError::BUFFER_UNDERFLOW) {
+      // The rest of this representation is in the next piece.  Nothing was
+      // emitted or indexed for it yet.
+      err_ = HPACK::DecodeError::NONE;
+      break;
+    }
+    consumed = dbuf.consumedBytes();
+    partialEmittedSize_ += emitted;
+    if (partialEmittedSize_ > maxUncompressed_) {
+      LOG(ERROR) << "exceeded uncompressed size limit of "
+                 << maxUncompressed_ << " bytes";
+      err_ = HPACK::DecodeError::HEADERS_TOO_LARGE;
+      break;
+    }
+    partialEmittedSize_ += 2;
+  }
+  partialCompressedSize_ += consumed;
+  if (last || hasError()) {
+    completeDecode(HeaderCodec::Type::HPACK, streamingCb,
+                   partialCompressedSize_, partialCompressedSize_,
+                   partialEmittedSize_);
+    partialEmittedSize_ = 0;
+    partialCompressedSize_ = 0;
+  }
+  return consumed;
+}
+
 uint32_t HPACKDecoder::decodeLiteralHeader(
     HPACKDecodeBuffer& dbuf,
     HPACK::StreamingCallback* streamingCb,
@@ -48,6 +85,8 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
   uint8_t byte = dbuf.peek();
   bool indexing = byte & HPACK::LITERAL_INC_INDEX.code;
   HPACKHeader header;
+  HuffmanLiterals* huffmanLiterals =
+    streamingCb ? streamingCb->huffmanLiterals : nullptr;
   uint8_t indexMask = 0x3F;  // 0011 1111
   uint8_t length = HPACK::LITERAL_INC_INDEX.prefixLength;
   if (!indexing) {
@@ -74,7 +113,7 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
     // skip current byte
     dbuf.next();
     folly::fbstring headerName;
-    err_ = dbuf.decodeLiteral(headerName);
+    err_ = dbuf.decodeLiteral(headerName, huffmanLiterals);
     header.name = headerName;
     if (err_ != HPACK::DecodeError::NONE) {
       LOG(ERROR) << "Error decoding header name err_=" << err_;
@@ -82,7 +121,7 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
     }
   }
   // value
-  err_ = dbuf.decodeLiteral(header.value);
+  err_ = dbuf.decodeLiteral(header.value, huffmanLiterals);
   if (err_ != HPACK::DecodeError::NONE) {
     LOG(ERROR) << "Error decoding header value name=" << header.name
                << " err_=" << err_;
@@ -116,7 +155,7 @@ uint32_t HPACKDecoder::decodeIndexedHeader(
   }
 
   auto& header = getHeader(index);
-  return emit(header, streamingCb, emitted);
+  return emitIndexed(header, streamingCb, emitted);
 }
 
 bool HPACKDecoder::isValid(uint32_t index) {
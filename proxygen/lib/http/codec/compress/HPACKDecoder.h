@@ -36,6 +36,18 @@ class HPACKDecoder : public HPACKDecoderBase,
                        uint32_t totalBytes,
                        HPACK::StreamingCallback* streamingCb);
 
+  /**
+   * decodeStreaming() for a header block that arrives in pieces, such as
+   * HEADERS and CONTINUATION frames.  Decodes the header representations
+   * that are complete within totalBytes and returns the number of bytes it
+   * consumed; the caller passes the rest again, ahead of the next piece.
+   * last marks the final piece, which completes the decode.  The size limit
+   * applies to the block so far, so it fails before the block is complete.
+   */
+  uint32_t decodeStreamingPartial(folly::io::Cursor& cursor,
+                                  uint32_t totalBytes,
+                                  HPACK::StreamingCallback* streamingCb,
+                                  bool last);
 
   void setHeaderTableMaxSize(uint32_t maxSize) {
     HPACKDecoderBase::setHeaderTableMaxSize(table_, maxSize);
@@ -55,6 +67,10 @@ class HPACKDecoder : public HPACKDecoderBase,
   uint32_t decodeHeader(HPACKDecodeBuffer& dbuf,
                         HPACK::StreamingCallback* streamingCb,
                         headers_t* emitted);
+
+  // What decodeStreamingPartial() decoded of the current block
+  uint32_t partialEmittedSize_{0};
+  uint32_t partialCompressedSize_{0};
 };
 
 }
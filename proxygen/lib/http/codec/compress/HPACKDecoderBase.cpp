@@ -24,6 +24,18 @@ uint32_t HPACKDecoderBase::emit(const HPACKHeader& header,
   return header.realBytes();
 }
 
+uint32_t HPACKDecoderBase::emitIndexed(const HPACKHeader& header,
+                                       HPACK::StreamingCallback* streamingCb,
+                                       headers_t* emitted) {
+  auto internTable = streamingCb ? HeaderValueInternTable::get() : nullptr;
+  if (!internTable) {
+    return emit(header, streamingCb, emitted);
+  }
+  streamingCb->onInternedHeader(header.name.get(),
+                                internTable->intern(header.value));
+  return header.realBytes();
+}
+
 void HPACKDecoderBase::completeDecode(
     HeaderCodec::Type type,
     HPACK::StreamingCallback* streamingCb,
@@ -50,6 +50,11 @@ class HPACKDecoderBase {
                 HPACK::StreamingCallback* streamingCb,
                 headers_t* emitted);
 
+  // emit() for a header read from the static or dynamic table
+  uint32_t emitIndexed(const HPACKHeader& header,
+                       HPACK::StreamingCallback* streamingCb,
+                       headers_t* emitted);
+
   void completeDecode(
       HeaderCodec::Type type,
       HPACK::StreamingCallback* streamingCb,
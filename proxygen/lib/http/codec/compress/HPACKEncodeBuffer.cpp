@@ -120,6 +120,12 @@ uint32_t HPACKEncodeBuffer::encodeHuffman(uint8_t instruction, uint8_t nbit,
   return count;
 }
 
+uint32_t HPACKEncodeBuffer::encodeHuffmanEncoded(folly::ByteRange encoded) {
+  uint32_t count = encodeInteger(encoded.size(), uint8_t(1 << 7), 7);
+  buf_.push(encoded.data(), encoded.size());
+  return count + encoded.size();
+}
+
 uint32_t HPACKEncodeBuffer::encodeLiteral(folly::StringPiece literal) {
   return encodeLiteral(0, 7, literal);
 }
@@ -45,6 +45,10 @@ class HPACKEncodeBuffer {
    */
   void addHeadroom(uint32_t bytes);
 
+  bool huffmanEnabled() const {
+    return huffmanEnabled_;
+  }
+
   /**
    * Encode the integer value using variable-length layout and the given
    * instruction using an nbit prefix.  Per the spec, prefix is the portion
@@ -95,6 +99,12 @@ class HPACKEncodeBuffer {
   uint32_t encodeHuffman(uint8_t instruction, uint8_t nbit,
                          folly::StringPiece literal);
 
+  /**
+   * serializes a string that is already huffman encoded, e.g. the bytes
+   * of a received literal that is forwarded unchanged
+   */
+  uint32_t encodeHuffmanEncoded(folly::ByteRange encoded);
+
   /**
    * prints the content of an IOBuf in binary format. Useful for debugging.
    */
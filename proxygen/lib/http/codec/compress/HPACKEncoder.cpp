@@ -9,20 +9,114 @@
  */
 #include <proxygen/lib/http/codec/compress/HPACKEncoder.h>
 
+#include <proxygen/lib/http/codec/compress/StaticBlockCache.h>
+
 using std::vector;
 
 namespace proxygen {
 
 std::unique_ptr<folly::IOBuf>
-HPACKEncoder::encode(const vector<HPACKHeader>& headers, uint32_t headroom) {
+HPACKEncoder::encode(const vector<HPACKHeader>& headers,
+                     uint32_t headroom,
+                     const HuffmanLiterals* huffmanLiterals) {
+  bool cacheable = encodeCacheSize_ > 0 && !pendingContextUpdate_;
+  lastEncodeCacheHit_ = false;
+  if (cacheable) {
+    auto cached = encodeFromCache(headers, headroom);
+    if (cached) {
+      lastEncodeCacheHit_ = true;
+      encodeCacheHits_++;
+      return cached;
+    }
+    encodeCacheMisses_++;
+  }
+  bool useStaticCache = useStaticBlockCache_ && !pendingContextUpdate_ &&
+    headers.size() <= StaticBlockCache::kMaxHeaders;
+  bool noTable = table_.capacity() == 0 && table_.size() == 0;
+  if (useStaticCache) {
+    auto cached = StaticBlockCache::get().find(
+      StaticBlockCache::Format::HPACK, streamBuffer_.huffmanEnabled(), noTable,
+      headers);
+    if (cached) {
+      return folly::IOBuf::copyBuffer(*cached, headroom);
+    }
+  }
+  auto generation = table_.generation();
   if (headroom) {
     streamBuffer_.addHeadroom(headroom);
   }
   handlePendingContextUpdate(streamBuffer_, table_.capacity());
+  staticOnlyBlock_ = true;
+  if (streamBuffer_.huffmanEnabled() && huffmanLiterals &&
+      !huffmanLiterals->empty()) {
+    huffmanLiterals_ = huffmanLiterals;
+  }
   for (const auto& header : headers) {
     encodeHeader(header);
   }
-  return streamBuffer_.release();
+  huffmanLiterals_ = nullptr;
+  auto block = streamBuffer_.release();
+  if (cacheable && table_.generation() == generation && block) {
+    addToEncodeCache(headers, *block);
+  }
+  if (useStaticCache && (staticOnlyBlock_ || noTable) && block) {
+    StaticBlockCache::get().insert(
+      StaticBlockCache::Format::HPACK, streamBuffer_.huffmanEnabled(), noTable,
+      headers, *block);
+  }
+  return block;
+}
+
+std::unique_ptr<folly::IOBuf>
+HPACKEncoder::encodeFromCache(const vector<HPACKHeader>& headers,
+                              uint32_t headroom) {
+  for (const auto& entry : encodeCache_) {
+    if (entry.generation == table_.generation() &&
+        entry.headers == headers) {
+      return folly::IOBuf::copyBuffer(entry.block, headroom);
+    }
+  }
+  return nullptr;
+}
+
+void HPACKEncoder::addToEncodeCache(const vector<HPACKHeader>& headers,
+                                    const folly::IOBuf& block) {
+  EncodeCacheEntry entry;
+  entry.headers.reserve(headers.size());
+  for (const auto& header : headers) {
+    entry.headers.push_back(header.copy());
+  }
+  entry.block.reserve(block.computeChainDataLength());
+  for (auto range : block) {
+    entry.block.append(reinterpret_cast<const char*>(range.data()),
+                       range.size());
+  }
+  entry.generation = table_.generation();
+  if (encodeCache_.size() < encodeCacheSize_) {
+    encodeCache_.push_back(std::move(entry));
+    return;
+  }
+  // Prefer replacing an entry the table has moved on from
+  for (auto& old : encodeCache_) {
+    if (old.generation != entry.generation) {
+      old = std::move(entry);
+      return;
+    }
+  }
+  encodeCache_[nextCacheVictim_] = std::move(entry);
+  nextCacheVictim_ = (nextCacheVictim_ + 1) % encodeCacheSize_;
+}
+
+size_t HPACKEncoder::getMemoryUsage() const {
+  size_t bytes = table_.memoryUsage() +
+    encodeCache_.capacity() * sizeof(EncodeCacheEntry);
+  for (const auto& entry : encodeCache_) {
+    bytes += entry.block.capacity();
+    for (const auto& header : entry.headers) {
+      bytes += header.bytes();
+    }
+  }
+  return bytes;
 }
 
 bool HPACKEncoder::encodeAsLiteral(const HPACKHeader& header, bool indexing) {
@@ -54,10 +148,21 @@ void HPACKEncoder::encodeLiteral(const HPACKHeader& header,
     streamBuffer_.encodeInteger(nameIndex, instruction);
   } else {
     streamBuffer_.encodeInteger(0, instruction);
-    streamBuffer_.encodeLiteral(header.name.get());
+    encodeString(header.name.get());
   }
   // value
-  streamBuffer_.encodeLiteral(header.value);
+  encodeString(header.value);
+}
+
+void HPACKEncoder::encodeString(folly::StringPiece literal) {
+  if (huffmanLiterals_) {
+    auto encoded = huffmanLiterals_->find(literal);
+    if (encoded) {
+      streamBuffer_.encodeHuffmanEncoded(*encoded);
+      return;
+    }
+  }
+  streamBuffer_.encodeLiteral(literal);
 }
 
 void HPACKEncoder::encodeAsIndex(uint32_t index) {
@@ -83,8 +188,10 @@ void HPACKEncoder::encodeHeader(const HPACKHeader& header) {
 
   // Finally encode the header as determined above
   if (index) {
+    staticOnlyBlock_ &= isStatic(index);
     encodeAsIndex(index);
   } else {
+    staticOnlyBlock_ = false;
     encodeAsLiteral(header, indexable);
   }
 }
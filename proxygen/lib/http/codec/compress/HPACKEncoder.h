@@ -9,9 +9,12 @@
  */
 #pragma once
 
+#include <folly/Optional.h>
 #include <folly/io/IOBuf.h>
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncoderBase.h>
+#include <proxygen/lib/http/codec/compress/HuffmanLiterals.h>
+#include <string>
 #include <vector>
 
 namespace proxygen {
@@ -25,18 +28,87 @@ class HPACKEncoder : public HPACKEncoderBase, public HPACKContext {
       , HPACKContext(tableSize) {}
 
   /**
-   * Encode the given headers.
+   * Encode the given headers.  Literals found in huffmanLiterals are
+   * written with the Huffman encoding recorded there instead of being
+   * encoded again.
    */
 
   std::unique_ptr<folly::IOBuf> encode(
     const std::vector<HPACKHeader>& headers,
-    uint32_t headroom = 0);
+    uint32_t headroom = 0,
+    const HuffmanLiterals* huffmanLiterals = nullptr);
 
   void setHeaderTableSize(uint32_t size) {
     HPACKEncoderBase::setHeaderTableSize(table_, size);
   }
 
+  void setHeaderIndexingStrategy(const HeaderIndexingStrategy* indexingStrat) {
+    HPACKEncoderBase::setHeaderIndexingStrategy(indexingStrat);
+    encodeCache_.clear();
+  }
+
+  /**
+   * Drop the dynamic table and the encode cache and release their storage,
+   * for connections that sit idle.  The peer is told to drop its copy of
+   * the table with the next block.
+   */
+  void clearTable() {
+    HPACKEncoderBase::clearHeaderTable(table_);
+    table_.shrinkToFit();
+    encodeCache_.clear();
+    encodeCache_.shrink_to_fit();
+    nextCacheVictim_ = 0;
+  }
+
+  // Approximate heap bytes held by the table and the encode cache
+  size_t getMemoryUsage() const;
+
+  /**
+   * Remember the encoding of up to size header blocks and re-emit the bytes
+   * when the same block is encoded again.  Only blocks that did not modify
+   * the table are remembered, and an entry is only used while the table is
+   * unchanged, so the cached bytes refer to the same entries.  0 (the
+   * default) disables the cache.
+   */
+  void setEncodeCacheSize(size_t size) {
+    encodeCacheSize_ = size;
+    encodeCache_.clear();
+    encodeCache_.reserve(size);
+  }
+
+  /**
+   * Whether the last encode() was served from the encode cache, or none if
+   * the cache is disabled.
+   */
+  folly::Optional<bool> lastEncodeCacheHit() const {
+    if (encodeCacheSize_ == 0) {
+      return folly::none;
+    }
+    return lastEncodeCacheHit_;
+  }
+
+  uint64_t getEncodeCacheHits() const {
+    return encodeCacheHits_;
+  }
+
+  uint64_t getEncodeCacheMisses() const {
+    return encodeCacheMisses_;
+  }
+
  private:
+  struct EncodeCacheEntry {
+    std::vector<HPACKHeader> headers;
+    std::string block;
+    uint64_t generation;
+  };
+
+  std::unique_ptr<folly::IOBuf> encodeFromCache(
+    const std::vector<HPACKHeader>& headers,
+    uint32_t headroom);
+
+  void addToEncodeCache(const std::vector<HPACKHeader>& headers,
+                        const folly::IOBuf& block);
+
   void encodeAsIndex(uint32_t index);
 
   void encodeHeader(const HPACKHeader& header);
@@ -46,6 +118,17 @@ class HPACKEncoder : public HPACKEncoderBase, public HPACKContext {
   void encodeLiteral(const HPACKHeader& header,
                      uint32_t nameIndex,
                      const HPACK::Instruction& instruction);
+
+  void encodeString(folly::StringPiece literal);
+
+  std::vector<EncodeCacheEntry> encodeCache_;
+  size_t encodeCacheSize_{0};
+  size_t nextCacheVictim_{0};
+  bool lastEncodeCacheHit_{false};
+  uint64_t encodeCacheHits_{0};
+  uint64_t encodeCacheMisses_{0};
+  // Only set while encode() runs
+  const HuffmanLiterals* huffmanLiterals_{nullptr};
 };
 
 }
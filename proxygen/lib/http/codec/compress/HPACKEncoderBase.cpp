@@ -17,9 +17,16 @@ uint32_t HPACKEncoderBase::handlePendingContextUpdate(HPACKEncodeBuffer& buf,
     "Code assumes these are equal";
   uint32_t encoded = 0;
   if (pendingContextUpdate_) {
+    if (pendingMinCapacity_ < tableCapacity) {
+      // the peer evicts down to the minimum before growing back
+      VLOG(5) << "Encoding table size update size=" << pendingMinCapacity_;
+      encoded = buf.encodeInteger(pendingMinCapacity_,
+                                  HPACK::TABLE_SIZE_UPDATE);
+    }
     VLOG(5) << "Encoding table size update size=" << tableCapacity;
-    encoded = buf.encodeInteger(tableCapacity, HPACK::TABLE_SIZE_UPDATE);
+    encoded += buf.encodeInteger(tableCapacity, HPACK::TABLE_SIZE_UPDATE);
     pendingContextUpdate_ = false;
+    pendingMinCapacity_ = std::numeric_limits<uint32_t>::max();
   }
 
   return encoded;
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <limits>
+
 #include <proxygen/lib/http/codec/compress/HPACKContext.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
 #include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
@@ -40,6 +42,19 @@ class HPACKEncoderBase {
     }
   }
 
+  /**
+   * Evict every entry of the table, keeping its capacity.  The next block
+   * starts with a table size update to 0 and one back to the capacity, so
+   * the peer evicts them too.
+   */
+  void clearHeaderTable(HeaderTable& table) {
+    auto capacity = table.capacity();
+    CHECK(table.setCapacity(0));
+    CHECK(table.setCapacity(capacity));
+    pendingMinCapacity_ = 0;
+    pendingContextUpdate_ = true;
+  }
+
   void setHeaderIndexingStrategy(const HeaderIndexingStrategy* indexingStrat) {
     indexingStrat_ = indexingStrat;
   }
@@ -47,6 +62,14 @@ class HPACKEncoderBase {
     return indexingStrat_;
   }
 
+  /**
+   * Use the thread's StaticBlockCache for blocks that do not depend on the
+   * dynamic table.  Off by default.
+   */
+  void setUseStaticBlockCache(bool use) {
+    useStaticBlockCache_ = use;
+  }
+
  protected:
 
   uint32_t handlePendingContextUpdate(HPACKEncodeBuffer& buf,
@@ -55,6 +78,11 @@ class HPACKEncoderBase {
   const HeaderIndexingStrategy* indexingStrat_;
   HPACKEncodeBuffer streamBuffer_;
   bool pendingContextUpdate_{false};
+  // smallest capacity since the last update, if below the current one
+  uint32_t pendingMinCapacity_{std::numeric_limits<uint32_t>::max()};
+  bool useStaticBlockCache_{false};
+  // set while encoding a block, cleared by anything but a static reference
+  bool staticOnlyBlock_{false};
 };
 
 
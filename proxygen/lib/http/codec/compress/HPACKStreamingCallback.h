@@ -11,6 +11,8 @@
 
 #include <proxygen/lib/http/codec/compress/HeaderCodec.h>
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
+#include <proxygen/lib/http/codec/compress/HeaderValueInternTable.h>
+#include <proxygen/lib/http/codec/compress/HuffmanLiterals.h>
 
 namespace proxygen { namespace HPACK {
   class StreamingCallback {
@@ -19,10 +21,20 @@ namespace proxygen { namespace HPACK {
 
     virtual void onHeader(const folly::fbstring& name,
                           const folly::fbstring& value) = 0;
+    // A value read from the header table while interning is on, see
+    // HeaderValueInternTable.  Callbacks that don't keep the handle get the
+    // value copied by onHeader().
+    virtual void onInternedHeader(
+        const folly::fbstring& name,
+        const HeaderValueInternTable::Handle& value) {
+      onHeader(name, *value);
+    }
     virtual void onHeadersComplete(HTTPHeaderSize decodedSize,
                                    bool acknowledge) = 0;
     virtual void onDecodeError(HPACK::DecodeError decodeError) = 0;
     HeaderCodec::Stats* stats{nullptr};
+    // If set, the Huffman encoded literals of the block are added to it
+    HuffmanLiterals* huffmanLiterals{nullptr};
   };
 
 
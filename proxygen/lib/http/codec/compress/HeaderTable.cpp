@@ -9,28 +9,32 @@
  */
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
 
+#include <algorithm>
+
+#include <folly/tracing/StaticTracepoint.h>
 #include <glog/logging.h>
 
-using std::list;
 using std::pair;
 using std::string;
 
 namespace proxygen {
 
+const uint32_t HeaderTable::kNoEntry;
+
 void HeaderTable::init(uint32_t capacityVal) {
   bytes_ = 0;
   size_ = 0;
   head_ = 0;
   capacity_ = capacityVal;
-  uint32_t initLength = getMaxTableLength(capacity_) / 2;
-  table_.reserve(initLength);
-  for (uint32_t i = 0; i < initLength; i++) {
-    table_.emplace_back();
-  }
+  // The ring is allocated by the first add(), connections that never index
+  // a header don't pay for it
+  table_.clear();
+  nameLinks_.clear();
   names_.clear();
 }
 
 bool HeaderTable::add(HPACKHeader header) {
+  ++generation_;
   if (header.bytes() > capacity_) {
     // Per the RFC spec https://tools.ietf.org/html/rfc7541#page-11, we must
     // flush the underlying table if a request is made for a header that is
@@ -46,13 +50,24 @@ bool HeaderTable::add(HPACKHeader header) {
     }
   }
 
-  if (size_ == length()) {
+  if (length() == 0) {
+    increaseTableLengthTo(
+      std::max(getMaxTableLength(capacity_) / 2, uint32_t(1)));
+  } else if (size_ == length()) {
     increaseTableLengthTo(std::min((uint32_t)ceil(size_ * 1.5),
                                    getMaxTableLength(capacity_)));
   }
   head_ = next(head_);
-  // index name
-  names_[header.name].push_back(head_);
+  // index name, as the newest entry of its chain
+  auto& chain = names_[header.name];
+  nameLinks_[head_] = NameLinks{chain.newest, kNoEntry};
+  if (chain.count == 0) {
+    chain.oldest = head_;
+  } else {
+    nameLinks_[chain.newest].newer = head_;
+  }
+  chain.newest = head_;
+  chain.count++;
   bytes_ += header.bytes();
   table_[head_] = std::move(header);
 
@@ -71,9 +86,7 @@ uint32_t HeaderTable::getIndexImpl(const HPACKHeaderName& headerName,
   if (it == names_.end()) {
     return 0;
   }
-  for (auto indexIt = it->second.rbegin(); indexIt != it->second.rend();
-       ++indexIt) {
-    auto i = *indexIt;
+  for (auto i = it->second.newest; i != kNoEntry; i = nameLinks_[i].older) {
     if (nameOnly || table_[i].value == value) {
       return toExternal(i);
     }
@@ -103,16 +116,20 @@ uint32_t HeaderTable::getMaxTableLength(uint32_t capacityVal) const {
 }
 
 uint32_t HeaderTable::removeLast() {
+  ++generation_;
   auto t = tail();
   // remove the first element from the names index
   auto names_it = names_.find(table_[t].name);
   DCHECK(names_it != names_.end());
-  auto &ilist = names_it->second;
-  DCHECK_EQ(ilist.front(), t);
-  ilist.pop_front();
+  auto& chain = names_it->second;
+  DCHECK_EQ(chain.oldest, t);
+  chain.oldest = nameLinks_[t].newer;
+  if (chain.oldest != kNoEntry) {
+    nameLinks_[chain.oldest].older = kNoEntry;
+  }
 
   // remove the name if there are no indices associated with it
-  if (ilist.empty()) {
+  if (--chain.count == 0) {
     names_.erase(names_it);
   }
   const auto& header = table_[t];
@@ -125,6 +142,7 @@ uint32_t HeaderTable::removeLast() {
 }
 
 void HeaderTable::reset() {
+  ++generation_;
   names_.clear();
 
   bytes_ = 0;
@@ -148,14 +166,52 @@ bool HeaderTable::setCapacity(uint32_t newCapacity) {
     // resize is actually appropriate (to handle cases where the underlying
     // vector is still >= to the size related to the new capacity requested)
     uint32_t newLength = getMaxTableLength(newCapacity) / 2;
-    if (newLength > length()) {
+    // An unallocated ring is sized for the capacity by the first add()
+    if (length() > 0 && newLength > length()) {
       increaseTableLengthTo(newLength);
     }
   }
   capacity_ = newCapacity;
+  ++generation_;
   return true;
 }
 
+void HeaderTable::shrinkToFit() {
+  // An empty table releases the whole ring, until the next add()
+  uint32_t newLength = size_;
+  if (size_ > 0) {
+    uint32_t oldTail = tail();
+    auto oldLength = length();
+    rotateTable(oldTail);
+    auto update = [oldTail, oldLength] (uint32_t& idx) {
+      if (idx != kNoEntry) {
+        idx = (idx + oldLength - oldTail) % oldLength;
+      }
+    };
+    for (auto& names_it: names_) {
+      update(names_it.second.newest);
+      update(names_it.second.oldest);
+    }
+    for (auto& links: nameLinks_) {
+      update(links.older);
+      update(links.newer);
+    }
+    head_ = size_ - 1;
+  } else {
+    head_ = 0;
+  }
+  resizeTable(newLength);
+  table_.shrink_to_fit();
+  nameLinks_.shrink_to_fit();
+  ++generation_;
+}
+
+size_t HeaderTable::memoryUsage() const {
+  return table_.capacity() * sizeof(HPACKHeader) +
+    nameLinks_.capacity() * sizeof(NameLinks) +
+    names_.getAllocatedMemorySize() + bytes_;
+}
+
 void HeaderTable::increaseTableLengthTo(uint32_t newLength) {
   DCHECK_GE(newLength, length());
   uint32_t oldTail = (size_ > 0) ? tail() : 0;
@@ -168,36 +224,53 @@ void HeaderTable::increaseTableLengthTo(uint32_t newLength) {
     // of the now-larger table_
     updateResizedTable(oldTail, oldLength, newLength);
     // Update the names indecies that pointed to the old range
-    for (auto& names_it: names_) {
-      for (auto& idx: names_it.second) {
-        if (idx >= oldTail) {
-          DCHECK_LT(idx + (length() - oldLength), length());
-          idx += (length() - oldLength);
-        } else {
-          // remaining indecies in the list were smaller than oldTail, so
-          // should be indexed from 0
-          break;
-        }
+    uint32_t delta = length() - oldLength;
+    auto update = [oldTail, delta] (uint32_t& idx) {
+      if (idx != kNoEntry && idx >= oldTail) {
+        idx += delta;
       }
+    };
+    for (auto& names_it: names_) {
+      update(names_it.second.newest);
+      update(names_it.second.oldest);
+    }
+    for (auto& links: nameLinks_) {
+      update(links.older);
+      update(links.newer);
     }
   }
 }
 
 void HeaderTable::resizeTable(uint32_t newLength) {
   table_.resize(newLength);
+  nameLinks_.resize(newLength);
 }
 
 void HeaderTable::updateResizedTable(uint32_t oldTail, uint32_t oldLength,
                                      uint32_t newLength) {
   std::move_backward(table_.begin() + oldTail, table_.begin() + oldLength,
                      table_.begin() + newLength);
+  std::move_backward(nameLinks_.begin() + oldTail,
+                     nameLinks_.begin() + oldLength,
+                     nameLinks_.begin() + newLength);
+}
+
+void HeaderTable::rotateTable(uint32_t oldTail) {
+  std::rotate(table_.begin(), table_.begin() + oldTail, table_.end());
+  std::rotate(nameLinks_.begin(), nameLinks_.begin() + oldTail,
+              nameLinks_.end());
 }
 
 uint32_t HeaderTable::evict(uint32_t needed, uint32_t desiredCapacity) {
   uint32_t previousSize = size_;
+  uint32_t previousBytes = bytes_;
   while (size_ > 0 && (bytes_ + needed > desiredCapacity)) {
     removeLast();
   }
+  if (size_ != previousSize) {
+    FOLLY_SDT(proxygen, hpack_evict, previousSize - size_,
+              previousBytes - bytes_, desiredCapacity);
+  }
   return previousSize - size_;
 }
 
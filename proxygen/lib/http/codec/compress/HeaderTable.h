@@ -9,7 +9,7 @@
  */
 #pragma once
 
-#include <list>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -25,8 +25,24 @@ namespace proxygen {
 
 class HeaderTable {
  public:
-  // TODO: std::vector might be faster than std::list in the use case?
-  using names_map = folly::F14FastMap<HPACKHeaderName, std::list<uint32_t>>;
+  static const uint32_t kNoEntry = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * The entries sharing a name form a doubly linked chain through
+   * nameLinks_, which runs parallel to table_.  The names index only holds
+   * the two ends of each chain, so adding and evicting entries does not
+   * allocate.
+   */
+  struct NameChain {
+    uint32_t newest{kNoEntry};
+    uint32_t oldest{kNoEntry};
+    uint32_t count{0};
+
+    size_t size() const {
+      return count;
+    }
+  };
+  using names_map = folly::F14FastMap<HPACKHeaderName, NameChain>;
 
   explicit HeaderTable(uint32_t capacityVal) {
     init(capacityVal);
@@ -100,6 +116,29 @@ class HeaderTable {
    */
   virtual bool setCapacity(uint32_t capacity);
 
+  /**
+   * Release the slots not holding an entry, moving the entries to the front
+   * of a ring just long enough for them.  Entries keep their indices, and
+   * the ring grows again as entries are added.  Like a new table, an empty
+   * one holds no slots until the first add().
+   */
+  void shrinkToFit();
+
+  /**
+   * Approximate heap bytes held by the table: its slots, the names index and
+   * the entries themselves.
+   */
+  size_t memoryUsage() const;
+
+  /**
+   * Incremented whenever the contents or capacity of the table change, so
+   * anything derived from the table state (external indices, for one) can be
+   * checked for staleness.
+   */
+  uint64_t generation() const {
+    return generation_;
+  }
+
   /**
    * @return number of valid entries
    */
@@ -148,6 +187,11 @@ class HeaderTable {
   virtual void updateResizedTable(uint32_t oldTail, uint32_t oldLength,
                                   uint32_t newLength);
 
+  /*
+   * Rotate the ring so that oldTail moves to slot 0, for shrinkToFit
+   */
+  virtual void rotateTable(uint32_t oldTail);
+
   /**
    * Removes one header entry from the beginning of the header table.
    *
@@ -185,10 +229,19 @@ class HeaderTable {
    */
   uint32_t toInternal(uint32_t externalIndex) const;
 
+  uint64_t generation_{0};
   uint32_t capacity_{0};
   uint32_t bytes_{0};     // size in bytes of the current entries
   std::vector<HPACKHeader> table_;
 
+  // Internal indices of the next older and newer entries with the same
+  // name as the entry in table_ at the same position, or kNoEntry
+  struct NameLinks {
+    uint32_t older{kNoEntry};
+    uint32_t newer{kNoEntry};
+  };
+  std::vector<NameLinks> nameLinks_;
+
   uint32_t size_{0};    // how many entries we have in the table
   uint32_t head_{0};     // points to the first element of the ring
 
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/compress/HeaderValueInternTable.h>
+
+namespace proxygen {
+
+const size_t HeaderValueInternTable::kMaxValueLength;
+std::atomic<size_t> HeaderValueInternTable::maxEntries_{0};
+
+void HeaderValueInternTable::setMaxEntries(size_t maxEntries) {
+  maxEntries_.store(maxEntries, std::memory_order_relaxed);
+}
+
+HeaderValueInternTable* HeaderValueInternTable::get() {
+  if (getMaxEntries() == 0) {
+    return nullptr;
+  }
+  static thread_local HeaderValueInternTable table;
+  return &table;
+}
+
+HeaderValueInternTable::Handle HeaderValueInternTable::intern(
+    folly::StringPiece value) {
+  auto it = values_.find(value);
+  if (it != values_.end()) {
+    return it->second;
+  }
+  auto handle = std::make_shared<const folly::fbstring>(value.data(),
+                                                        value.size());
+  if (value.size() > kMaxValueLength) {
+    return handle;
+  }
+  if (values_.size() >= getMaxEntries()) {
+    values_.clear();
+  }
+  values_.emplace(folly::StringPiece(*handle), handle);
+  return handle;
+}
+
+}
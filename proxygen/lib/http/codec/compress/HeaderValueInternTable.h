@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/FBString.h>
+#include <folly/Range.h>
+#include <folly/container/F14Map.h>
+
+#include <atomic>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Header values the HPACK and QPACK decoders of a thread read from their
+ * static or dynamic tables, shared by all its connections.  Values such as
+ * "gzip, deflate, br" or a common user-agent then live once per thread, and
+ * a decoder hands out a refcounted handle to them (see
+ * HPACK::StreamingCallback::onInternedHeader) instead of a reference to its
+ * own table entry, which the next insert may evict.
+ *
+ * Each thread has its own instance, so lookups and inserts take no lock.
+ * The table is off unless setMaxEntries() set a limit.  When it is full it
+ * starts over empty rather than tracking which values are hot: the handles
+ * already given out stay valid, and the values still in use are interned
+ * again on their next decode.
+ */
+class HeaderValueInternTable {
+ public:
+  using Handle = std::shared_ptr<const folly::fbstring>;
+
+  // longer values, cookies say, rarely repeat across connections
+  static const size_t kMaxValueLength = 256;
+
+  /**
+   * Limit of the table of every thread, 0 (the default) turns it off.
+   */
+  static void setMaxEntries(size_t maxEntries);
+
+  static size_t getMaxEntries() {
+    return maxEntries_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * The calling thread's table, or nullptr if interning is off
+   */
+  static HeaderValueInternTable* get();
+
+  /**
+   * A handle to value, shared with the previous callers that interned the
+   * same value.  Values longer than kMaxValueLength get a handle of their
+   * own.
+   */
+  Handle intern(folly::StringPiece value);
+
+  size_t size() const {
+    return values_.size();
+  }
+
+  void clear() {
+    values_.clear();
+  }
+
+ private:
+  static std::atomic<size_t> maxEntries_;
+
+  // keyed by the bytes of the handle, which the handle keeps alive
+  folly::F14FastMap<folly::StringPiece, Handle> values_;
+};
+
+}
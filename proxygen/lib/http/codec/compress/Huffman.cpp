@@ -10,7 +10,6 @@
 #include <proxygen/lib/http/codec/compress/Huffman.h>
 
 #include <folly/Indestructible.h>
-#include <folly/portability/Sockets.h>
 
 using folly::IOBuf;
 using std::pair;
@@ -31,46 +30,72 @@ HuffTree::HuffTree(const HuffTree& tree) :
 bool HuffTree::decode(const uint8_t* buf, uint32_t size,
                       folly::fbstring& literal)
     const {
-  const SuperHuffNode* snode = &table_[0];
-  uint32_t w = 0;
-  uint32_t wbits = 0;
+  // codes are at least 5 bits long
+  literal.reserve(literal.size() + size * 8 / 5);
+  uint64_t w = 0;     // bit stream aligned to the MSB
+  uint32_t wbits = 0; // how many bits of the stream are in w
   uint32_t i = 0;
-  while (i < size || wbits > 0) {
-    // decide if we need to load more bits using an 8-bit chunk
-    if (i < size && wbits < 8) {
-      w = (w << 8) | buf[i];
+  while (true) {
+    while (wbits <= 56 && i < size) {
+      w |= uint64_t(buf[i++]) << (56 - wbits);
       wbits += 8;
-      i++;
     }
-    // key is used for performing the indexed lookup
-    uint32_t key;
-    if (wbits >= 8) {
-      key = w >> (wbits - 8);
-    } else {
-      // this the case we're at the end of the buffer
-      uint8_t xbits = 8 - wbits;
-      w = (w << xbits) | ((1 << xbits) - 1);
-      key = w;
-      wbits = 8;
+    if (wbits == 0) {
+      break;
     }
-    // perform the indexed lookup
-    const HuffNode& node = snode->index[key];
-    if (node.isLeaf()) {
-      // final node, we can emit the character
-      literal.push_back(node.data.ch);
-      wbits -= node.metadata.bits;
-      snode = &table_[0];
+    // at the end of the buffer pad with 1s, like the encoder does.  No code
+    // can be completed with padding bits.
+    uint64_t key = wbits >= 32 ? w : w | (~uint64_t(0) >> wbits);
+    const MultiSymbolEntry& entry =
+      multiSymbolTable_[key >> (64 - kMultiSymbolBits)];
+    uint8_t used;
+    if (entry.firstBits == 0) {
+      // longer code, use the indexed tree
+      uint8_t ch;
+      if (!peekCode(key, wbits, ch, used)) {
+        break;
+      }
+      literal.push_back(ch);
+    } else if (entry.totalBits <= wbits) {
+      literal.push_back(entry.symbols[0]);
+      if (entry.totalBits != entry.firstBits) {
+        literal.push_back(entry.symbols[1]);
+      }
+      used = entry.totalBits;
+    } else if (entry.firstBits <= wbits) {
+      literal.push_back(entry.symbols[0]);
+      used = entry.firstBits;
     } else {
-      // this is a branch, so we just need to move one level
-      wbits -= 8;
-      snode = &table_[node.data.superNodeIndex];
+      // only padding left
+      break;
     }
-    // remove what we've just used
-    w = w & ((1 << wbits) - 1);
+    w <<= used;
+    wbits -= used;
   }
   return true;
 }
 
+bool HuffTree::peekCode(uint64_t w, uint32_t avail, uint8_t& ch,
+                        uint8_t& bits) const {
+  const SuperHuffNode* snode = &table_[0];
+  uint32_t used = 0;
+  while (used < avail) {
+    const HuffNode& node = snode->index[(w << used) >> 56];
+    if (node.isLeaf()) {
+      // bits == 0 marks the all 1s (EOS) prefix which has no character
+      if (node.metadata.bits == 0 || used + node.metadata.bits > avail) {
+        return false;
+      }
+      ch = node.data.ch;
+      bits = used + node.metadata.bits;
+      return true;
+    }
+    used += 8;
+    snode = &table_[node.data.superNodeIndex];
+  }
+  return false;
+}
+
 /**
  * insert a new character into the tree, identified by an unique code,
  * a number of bits to represent it. The code is aligned at LSB.
@@ -128,53 +153,60 @@ void HuffTree::buildTree() {
   for (uint32_t i = 0; i < kTableSize; i++) {
     insert(codes_[i], bits_[i], i);
   }
+  buildMultiSymbolTable();
+}
+
+/**
+ * builds the multi-symbol table from the indexed tree
+ */
+void HuffTree::buildMultiSymbolTable() {
+  for (uint32_t key = 0; key < (1 << kMultiSymbolBits); key++) {
+    uint64_t w = uint64_t(key) << (64 - kMultiSymbolBits);
+    MultiSymbolEntry& entry = multiSymbolTable_[key];
+    entry = MultiSymbolEntry{{0, 0}, 0, 0};
+    uint8_t bits;
+    if (!peekCode(w, kMultiSymbolBits, entry.symbols[0], bits)) {
+      continue;
+    }
+    entry.firstBits = bits;
+    entry.totalBits = bits;
+    uint8_t bits2;
+    if (peekCode(w << bits, kMultiSymbolBits - bits, entry.symbols[1],
+                 bits2)) {
+      entry.totalBits += bits2;
+    }
+  }
 }
 
 uint32_t HuffTree::encode(folly::StringPiece literal,
                           folly::io::QueueAppender& buf) const {
-  uint32_t code;  // the huffman code of a given character
-  uint8_t bits;   // on how many bits code is represented
-  uint32_t w = 0; // 4-byte word used for packing bits and write it to memory
+  // codes are at most 30 bits long, so with less than 32 bits pending a whole
+  // code always fits in the 64-bit accumulator and is never split
+  uint64_t w = 0;     // bits not yet written, aligned to LSB
   uint8_t wbits = 0;  // how many bits we have in 'w'
   uint32_t totalBytes = 0;
   for (size_t i = 0; i < literal.size(); i++) {
     uint8_t ch = literal[i];
-    code = codes_[ch];
-    bits = bits_[ch];
-
-    if (wbits + bits < 32) {
-      w = (w << bits) | code;
-      wbits += bits;
-    } else {
-      uint8_t xbits = wbits + bits - 32;
-      w = (w << (bits - xbits)) | (code >> xbits);
-      // write the word into the buffer by converting to network order, which
-      // takes care of the endianness problems
-      buf.writeBE<uint32_t>(w);
+    w = (w << bits_[ch]) | codes_[ch];
+    wbits += bits_[ch];
+    if (wbits >= 32) {
+      wbits -= 32;
+      // writeBE takes care of the endianness
+      buf.writeBE<uint32_t>(uint32_t(w >> wbits));
       totalBytes += 4;
-      // carry for next batch
-      wbits = xbits;
-      w = code & ((1 << xbits) - 1);
     }
   }
-  // we might have some padding at the byte level
+  // pad the last byte with 1s
   if (wbits & 0x7) {
-    // padding bits
     uint8_t padbits = 8 - (wbits & 0x7);
     w = (w << padbits) | ((1 << padbits) - 1);
-
     wbits += padbits;
   }
-  // we need to write the leftover bytes, from 1 to 4 bytes
-  if (wbits > 0) {
-    uint8_t bytes = wbits >> 3;
-    // align the bits to the MSB
-    w = w << (32 - wbits);
-    // set the bytes in the network order and copy w[0], w[1]...
-    w = htonl(w);
-    // we need to use memcpy because we might write less than 4 bytes
-    buf.push((uint8_t*)&w, bytes);
-    totalBytes += bytes;
+  // the leftover bytes, from 0 to 4
+  while (wbits > 0) {
+    wbits -= 8;
+    buf.write<uint8_t>(uint8_t(w >> wbits));
+    totalBytes++;
   }
   return totalBytes;
 }
@@ -193,6 +225,20 @@ uint32_t HuffTree::getEncodeSize(folly::StringPiece literal) const {
   return size;
 }
 
+bool HuffTree::isCanonicalEncoding(folly::StringPiece literal,
+                                   folly::ByteRange buf) const {
+  uint32_t totalBits = 0;
+  for (size_t i = 0; i < literal.size(); i++) {
+    totalBits += bits_[uint8_t(literal[i])];
+  }
+  if (buf.size() != (totalBits + 7) >> 3) {
+    return false;
+  }
+  uint8_t padding = (8 - (totalBits & 0x07)) & 0x07;
+  uint8_t mask = uint8_t((1 << padding) - 1);
+  return padding == 0 || (buf.back() & mask) == mask;
+}
+
 pair<uint32_t, uint8_t> HuffTree::getCode(uint8_t ch) const {
   return std::make_pair(codes_[ch], bits_[ch]);
 }
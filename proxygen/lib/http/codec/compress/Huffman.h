@@ -51,6 +51,21 @@ struct SuperHuffNode {
   HuffNode index[256];
 };
 
+// how many bits of the stream are looked up at once when decoding
+const uint32_t kMultiSymbolBits = 12;
+
+/**
+ * entry of the multi-symbol decode table, for a given kMultiSymbolBits-bit
+ * prefix of the bit stream: the complete codes the prefix starts with.  Codes
+ * are at least 5 bits long so there are at most two.  firstBits == 0 means the
+ * prefix starts a code longer than kMultiSymbolBits.
+ */
+struct MultiSymbolEntry {
+  uint8_t symbols[2];
+  uint8_t firstBits;  // bits used by symbols[0]
+  uint8_t totalBits;  // bits used by both symbols, firstBits if just one
+};
+
 /**
  * Immutable Huffman tree used in the process of decoding. Traditionally the
  * huffman tree is binary, but using that approach leads to major inefficiencies
@@ -80,6 +95,11 @@ struct SuperHuffNode {
  * 3. we don't have enough bits, so we use paddding and we get a key of
  * 01011111, which points to '(' character, like any other node under the
  * subtree '010'.
+ *
+ * On top of that, decode() first looks up 12 bits at a time in a flat table
+ * built from the tree, which yields the one or two symbols whose codes fit
+ * in those bits.  Only codes longer than 12 bits, which are rare in headers,
+ * go through the 8-bit level tables.
  */
 class HuffTree {
  public:
@@ -121,6 +141,14 @@ class HuffTree {
    */
   uint32_t getEncodeSize(folly::StringPiece literal) const;
 
+  /**
+   * whether buf is exactly what encode() produces for literal: no extra
+   * bytes and all 1s padding.  Decoding is more lenient than this, so
+   * callers that forward received Huffman bytes check it first.
+   */
+  bool isCanonicalEncoding(folly::StringPiece literal,
+                           folly::ByteRange buf) const;
+
   /**
    * get the binary representation for a given character, as a 32-bit word and
    * a number of bits is represented on (<32). The code is aligned to LSB.
@@ -141,11 +169,19 @@ class HuffTree {
   void fillIndex(SuperHuffNode& snode, uint32_t code, uint8_t bits, uint8_t ch,
      uint8_t level);
   void buildTree();
+  void buildMultiSymbolTable();
   void insert(uint32_t code, uint8_t bits, uint8_t ch);
 
+  /**
+   * find the code at the start of the MSB aligned bit stream w, using the
+   * 8-bit level tables.  Fails if the code is longer than avail bits.
+   */
+  bool peekCode(uint64_t w, uint32_t avail, uint8_t& ch, uint8_t& bits) const;
+
   uint32_t nodes_{0};
   const uint32_t* codes_;
   const uint8_t* bits_;
+  MultiSymbolEntry multiSymbolTable_[1 << kMultiSymbolBits];
 
  protected:
   explicit HuffTree(const HuffTree& tree);
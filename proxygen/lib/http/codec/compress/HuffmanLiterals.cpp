@@ -0,0 +1,44 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/compress/HuffmanLiterals.h>
+
+#include <cstring>
+
+namespace proxygen {
+
+void HuffmanLiterals::add(folly::StringPiece literal,
+                          folly::ByteRange encoded) {
+  if (literal.empty() || find(literal)) {
+    return;
+  }
+  entries_.push_back({uint32_t(storage_.size()),
+                      uint32_t(literal.size()),
+                      uint32_t(encoded.size())});
+  storage_.append(literal.data(), literal.size());
+  storage_.append(reinterpret_cast<const char*>(encoded.data()),
+                  encoded.size());
+}
+
+folly::Optional<folly::ByteRange> HuffmanLiterals::find(
+    folly::StringPiece literal) const {
+  // A block has a few dozen literals at most, a scan beats hashing them
+  for (const auto& entry : entries_) {
+    if (entry.literalSize == literal.size() &&
+        memcmp(storage_.data() + entry.offset, literal.data(),
+               literal.size()) == 0) {
+      auto encoded = reinterpret_cast<const uint8_t*>(storage_.data()) +
+        entry.offset + entry.literalSize;
+      return folly::ByteRange(encoded, entry.encodedSize);
+    }
+  }
+  return folly::none;
+}
+
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * The Huffman encoded form of the literals of a decoded header block, so a
+ * proxy can forward the headers it does not change without encoding them
+ * again.  The decoder fills one in when the streaming callback asks for it
+ * (see HPACK::StreamingCallback::huffmanLiterals), HTTPMessage carries it
+ * and the encoder copies the bytes of any literal it finds here.
+ *
+ * Literals are looked up by their decoded value, so headers that were
+ * modified or added after decoding simply are not found.
+ */
+class HuffmanLiterals {
+ public:
+  // Remember encoded as the Huffman encoding of literal
+  void add(folly::StringPiece literal, folly::ByteRange encoded);
+
+  // The Huffman encoding of literal, if it was received in this block
+  folly::Optional<folly::ByteRange> find(folly::StringPiece literal) const;
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  bool empty() const {
+    return entries_.empty();
+  }
+
+  void clear() {
+    storage_.clear();
+    entries_.clear();
+  }
+
+ private:
+  // The literal followed by its encoding, at offset in storage_
+  struct Entry {
+    uint32_t offset;
+    uint32_t literalSize;
+    uint32_t encodedSize;
+  };
+
+  std::string storage_;
+  std::vector<Entry> entries_;
+};
+
+}
@@ -114,6 +114,22 @@ class QPACKCodec : public HeaderCodec {
   void setHeaderIndexingStrategy(const HeaderIndexingStrategy* indexingStrat) {
     encoder_.setHeaderIndexingStrategy(indexingStrat);
   }
+
+  /**
+   * Release table slots without entries while the connection is idle.
+   * Unlike HPACK, entries are kept: the peer may still reference them, and
+   * evicting is only safe for acknowledged entries.
+   */
+  void hibernate() {
+    encoder_.shrinkTable();
+    decoder_.shrinkTable();
+  }
+
+  // Approximate heap bytes held by the encoder and decoder tables
+  size_t getMemoryUsage() const {
+    return encoder_.getTable().memoryUsage() +
+      decoder_.getTable().memoryUsage();
+  }
   const HeaderIndexingStrategy* getHeaderIndexingStrategy() const {
     return encoder_.getHeaderIndexingStrategy();
   }
@@ -122,18 +138,48 @@ class QPACKCodec : public HeaderCodec {
     return decoder_.getHolBlockCount();
   }
 
+  std::chrono::microseconds getHolBlockTime() const {
+    return decoder_.getHolBlockTime();
+  }
+
   uint64_t getQueuedBytes() const {
     return decoder_.getQueuedBytes();
   }
 
+  uint64_t getQueuedBlocks() const {
+    return decoder_.getQueuedBlocks();
+  }
+
+  uint64_t getQueueMemory() const {
+    return decoder_.getQueueMemory();
+  }
+
   void setMaxVulnerable(uint32_t maxVulnerable) {
     encoder_.setMaxVulnerable(maxVulnerable);
   }
 
+  uint32_t getMaxVulnerable() const {
+    return encoder_.getMaxVulnerable();
+  }
+
+  // See QPACKEncoder::setVulnerableBudget
+  void setVulnerableBudget(uint32_t budget) {
+    encoder_.setVulnerableBudget(budget);
+  }
+
+  uint64_t getVulnerableBlockCount() const {
+    return encoder_.getVulnerableBlockCount();
+  }
+
   void setMaxBlocking(uint32_t maxBlocking) {
     decoder_.setMaxBlocking(maxBlocking);
   }
 
+  // See HPACKEncoderBase::setUseStaticBlockCache
+  void setUseStaticBlockCache(bool use) {
+    encoder_.setUseStaticBlockCache(use);
+  }
+
   void setMaxNumOutstandingBlocks(uint32_t value) {
     encoder_.setMaxNumOutstandingBlocks(value);
   }
@@ -44,6 +44,11 @@ class QPACKContext {
 
   void seedHeaderTable(std::vector<HPACKHeader>& headers);
 
+  // See HeaderTable::shrinkToFit
+  void shrinkTable() {
+    table_.shrinkToFit();
+  }
+
   void describe(std::ostream& os) const;
 
  protected:
@@ -40,12 +40,11 @@ void QPACKDecoder::decodeStreaming(
       err_ = HPACK::DecodeError::TOO_MANY_BLOCKING;
       completeDecode(HeaderCodec::Type::QPACK, streamingCb, 0, 0, 0, false);
     } else {
-      folly::IOBufQueue q;
-      q.append(std::move(block));
-      q.trimStart(dbuf.consumedBytes());
+      // cursor is past the prefix, the block is copied and freed on return
+      auto length = std::min<size_t>(totalBytes - dbuf.consumedBytes(),
+                                     cursor.totalLength());
       enqueueHeaderBlock(streamID, requiredInsertCount, baseIndex_,
-                         dbuf.consumedBytes(), q.move(),
-                         totalBytes - dbuf.consumedBytes(), streamingCb);
+                         dbuf.consumedBytes(), cursor, length, streamingCb);
     }
   } else {
     decodeStreamingImpl(requiredInsertCount, 0, dbuf, streamingCb);
@@ -337,7 +336,7 @@ uint32_t QPACKDecoder::decodeIndexedHeaderQ(
   }
 
   auto& header = getHeader(isStatic, index, baseIndex_, aboveBase);
-  return emit(header, streamingCb, emitted);
+  return emitIndexed(header, streamingCb, emitted);
 }
 
 bool QPACKDecoder::isValid(bool isStatic, uint64_t index, bool aboveBase) {
@@ -386,6 +385,9 @@ std::unique_ptr<folly::IOBuf> QPACKDecoder::encodeCancelStream(
   auto it = queue_.begin();
   while (it != queue_.end()) {
     if (it->second.streamID == streamId) {
+      DCHECK_LE(it->second.length, queuedBytes_);
+      queuedBytes_ -= it->second.length;
+      blockArena_.release(it->second.chunk);
       it = queue_.erase(it);
     } else {
       it++;
@@ -401,16 +403,18 @@ void QPACKDecoder::enqueueHeaderBlock(
   uint32_t requiredInsertCount,
   uint32_t baseIndex,
   uint32_t consumed,
-  std::unique_ptr<folly::IOBuf> block,
+  Cursor& cursor,
   size_t length,
   HPACK::StreamingCallback* streamingCb) {
   // TDOO: this queue is currently unbounded and has no timeouts
   CHECK_GT(requiredInsertCount, table_.getInsertCount());
+  const uint8_t* data = nullptr;
+  auto chunk = blockArena_.add(cursor, length, data);
   queue_.emplace(
     std::piecewise_construct,
     std::forward_as_tuple(requiredInsertCount),
     std::forward_as_tuple(streamID, baseIndex, length, consumed,
-                          std::move(block), streamingCb));
+                          data, chunk, streamingCb));
   holBlockCount_++;
   VLOG(5) << "queued block=" << requiredInsertCount << " len=" << length;
   queuedBytes_ += length;
@@ -420,7 +424,8 @@ bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
                                const PendingBlock& pending) {
   if (pending.length > 0) {
     VLOG(5) << "decodeBlock len=" << pending.length;
-    folly::io::Cursor cursor(pending.block.get());
+    auto block = IOBuf::wrapBufferAsValue(pending.data, pending.length);
+    folly::io::Cursor cursor(&block);
     HPACKDecodeBuffer dbuf(cursor, pending.length, maxUncompressed_);
     DCHECK_LE(pending.length, queuedBytes_);
     queuedBytes_ -= pending.length;
@@ -433,6 +438,7 @@ bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
       return true;
     }
   }
+  blockArena_.release(pending.chunk);
   return false;
 }
 
@@ -443,6 +449,7 @@ void QPACKDecoder::drainQueue() {
     auto id = it->first;
     PendingBlock block = std::move(it->second);
     queue_.erase(it);
+    holBlockTime_ += microsecondsBetween(getCurrentTime(), block.enqueued);
     if (decodeBlock(id, block)) {
       return;
     }
@@ -450,4 +457,58 @@ void QPACKDecoder::drainQueue() {
   }
 }
 
+const uint32_t QPACKDecoder::BlockArena::kChunkSize;
+const uint32_t QPACKDecoder::BlockArena::kMaxFreeChunks;
+
+uint32_t QPACKDecoder::BlockArena::add(Cursor& cursor, uint32_t length,
+                                       const uint8_t*& data) {
+  if (current_ >= chunks_.size() ||
+      chunks_[current_].capacity - chunks_[current_].used < length) {
+    if (current_ < chunks_.size() && chunks_[current_].live == 0) {
+      free_.push_back(current_);
+    }
+    uint32_t needed = std::max(kChunkSize, length);
+    if (!free_.empty()) {
+      current_ = free_.back();
+      free_.pop_back();
+    } else {
+      current_ = chunks_.size();
+      chunks_.emplace_back();
+    }
+    auto& chunk = chunks_[current_];
+    if (chunk.capacity < needed) {
+      reserved_ += needed - chunk.capacity;
+      chunk.data.reset(new uint8_t[needed]);
+      chunk.capacity = needed;
+    }
+    chunk.used = 0;
+  }
+  auto& chunk = chunks_[current_];
+  uint8_t* dst = chunk.data.get() + chunk.used;
+  cursor.pull(dst, length);
+  chunk.used += length;
+  chunk.live++;
+  data = dst;
+  return current_;
+}
+
+void QPACKDecoder::BlockArena::release(uint32_t index) {
+  DCHECK_LT(index, chunks_.size());
+  auto& chunk = chunks_[index];
+  DCHECK_GT(chunk.live, 0);
+  if (--chunk.live > 0) {
+    return;
+  }
+  chunk.used = 0;
+  if (index == current_) {
+    return;
+  }
+  if (free_.size() >= kMaxFreeChunks || chunk.capacity > kChunkSize) {
+    reserved_ -= chunk.capacity;
+    chunk.data.reset();
+    chunk.capacity = 0;
+  }
+  free_.push_back(index);
+}
+
 }
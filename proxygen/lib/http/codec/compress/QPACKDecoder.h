@@ -15,7 +15,11 @@
 #include <proxygen/lib/http/codec/compress/HPACKDecoderBase.h>
 #include <proxygen/lib/http/codec/compress/HPACKDecodeBuffer.h>
 #include <proxygen/lib/http/codec/compress/QPACKContext.h>
+#include <proxygen/lib/utils/Time.h>
 #include <folly/io/async/DestructorCheck.h>
+#include <limits>
+#include <map>
+#include <vector>
 
 namespace proxygen {
 
@@ -47,10 +51,25 @@ class QPACKDecoder : public HPACKDecoderBase,
     return holBlockCount_;
   }
 
+  // Total time the queued blocks waited for their inserts
+  std::chrono::microseconds getHolBlockTime() const {
+    return holBlockTime_;
+  }
+
   uint64_t getQueuedBytes() const {
     return queuedBytes_;
   }
 
+  // Number of header blocks currently waiting for their required insert count
+  uint64_t getQueuedBlocks() const {
+    return queue_.size();
+  }
+
+  // Memory held for the bytes of queued header blocks
+  uint64_t getQueueMemory() const {
+    return blockArena_.reserved();
+  }
+
   void setMaxBlocking(uint32_t maxBlocking) {
     maxBlocking_ = maxBlocking;
   }
@@ -98,25 +117,65 @@ class QPACKDecoder : public HPACKDecoderBase,
       uint32_t requiredInsertCount,
       uint32_t baseIndex,
       uint32_t consumed,
-      std::unique_ptr<folly::IOBuf> block,
+      folly::io::Cursor& cursor,
       size_t length,
       HPACK::StreamingCallback* streamingCb);
 
+  /**
+   * Storage for the bytes of queued header blocks.  Each block is copied
+   * into the newest chunk, so queued blocks do not pin the transport's read
+   * buffers nor cost an allocation each.  A chunk is recycled as a whole
+   * once every block in it has been decoded or cancelled; beyond
+   * kMaxFreeChunks, empty chunks are freed.
+   */
+  class BlockArena {
+   public:
+    static const uint32_t kChunkSize = 4096;
+    static const uint32_t kMaxFreeChunks = 2;
+
+    // Copies length bytes from cursor, returns the chunk holding them
+    uint32_t add(folly::io::Cursor& cursor, uint32_t length,
+                 const uint8_t*& data);
+
+    void release(uint32_t chunk);
+
+    uint64_t reserved() const {
+      return reserved_;
+    }
+
+   private:
+    struct Chunk {
+      std::unique_ptr<uint8_t[]> data;
+      uint32_t capacity{0};
+      uint32_t used{0};
+      uint32_t live{0};
+    };
+
+    std::vector<Chunk> chunks_;
+    // indices of chunks without live blocks, other than current_
+    std::vector<uint32_t> free_;
+    uint32_t current_{std::numeric_limits<uint32_t>::max()};
+    uint64_t reserved_{0};
+  };
+
   struct PendingBlock {
     PendingBlock(
         uint64_t sid,
         uint32_t bi, uint32_t l, uint32_t cons,
-        std::unique_ptr<folly::IOBuf> b,
+        const uint8_t* d, uint32_t ch,
         HPACK::StreamingCallback* c)
         : streamID(sid), baseIndex(bi), length(l), consumed(cons),
-          block(std::move(b)), cb(c)
+          data(d), chunk(ch), cb(c), enqueued(getCurrentTime())
       {}
     uint64_t streamID;
     uint32_t baseIndex;
     uint32_t length;
     uint32_t consumed;
-    std::unique_ptr<folly::IOBuf> block;
+    // in blockArena_
+    const uint8_t* data;
+    uint32_t chunk;
     HPACK::StreamingCallback* cb;
+    TimePoint enqueued;
   };
 
   // Returns true if this object was destroyed by its callback.  Callers
@@ -129,8 +188,10 @@ class QPACKDecoder : public HPACKDecoderBase,
   uint32_t baseIndex_{0};
   uint32_t lastAcked_{0};
   uint32_t holBlockCount_{0};
+  std::chrono::microseconds holBlockTime_{0};
   uint32_t pendingEncoderBytes_{0};
   uint64_t queuedBytes_{0};
+  BlockArena blockArena_;
   std::multimap<uint32_t, PendingBlock> queue_;
 
   // This holds the state of a partially decoded literal insert on the control
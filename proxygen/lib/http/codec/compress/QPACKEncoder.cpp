@@ -9,6 +9,7 @@
  */
 #include <proxygen/lib/http/codec/compress/QPACKEncoder.h>
 #include <proxygen/lib/http/codec/compress/HPACKDecodeBuffer.h>
+#include <proxygen/lib/http/codec/compress/StaticBlockCache.h>
 
 using std::vector;
 
@@ -28,13 +29,33 @@ QPACKEncoder::encode(const vector<HPACKHeader>& headers,
                      uint32_t headroom,
                      uint64_t streamId,
                      uint32_t maxEncoderStreamBytes) {
+  bool useStaticCache = useStaticBlockCache_ && !pendingContextUpdate_ &&
+    headers.size() <= StaticBlockCache::kMaxHeaders;
+  bool noTable = table_.capacity() == 0 && table_.size() == 0;
+  if (useStaticCache) {
+    auto cached = StaticBlockCache::get().find(
+      StaticBlockCache::Format::QPACK, streamBuffer_.huffmanEnabled(), noTable,
+      headers);
+    if (cached) {
+      // no dynamic references, so nothing to track for streamId
+      return {nullptr, folly::IOBuf::copyBuffer(*cached, headroom)};
+    }
+  }
   if (headroom) {
     streamBuffer_.addHeadroom(headroom);
   }
   maxEncoderStreamBytes_ = maxEncoderStreamBytes;
   maxEncoderStreamBytes_ -=
     handlePendingContextUpdate(controlBuffer_, table_.capacity());
-  return encodeQ(headers, streamId);
+  staticOnlyBlock_ = true;
+  auto result = encodeQ(headers, streamId);
+  if (useStaticCache && (staticOnlyBlock_ || noTable) && !result.control &&
+      result.stream) {
+    StaticBlockCache::get().insert(
+      StaticBlockCache::Format::QPACK, streamBuffer_.huffmanEnabled(), noTable,
+      headers, *result.stream);
+  }
+  return result;
 }
 
 QPACKEncoder::EncodeResult
@@ -80,6 +101,7 @@ QPACKEncoder::encodeQ(const vector<HPACKHeader>& headers, uint64_t streamId) {
     if (curOutstanding_->vulnerable) {
       DCHECK(allowVulnerable());
       numVulnerable_++;
+      vulnerableBlockCount_++;
     }
     numOutstandingBlocks_++;
     outstanding_[streamId].emplace_back(std::move(outstandingBlock));
@@ -101,6 +123,7 @@ void QPACKEncoder::encodeHeaderQ(
                                 HPACK::Q_INDEXED.prefixLength);
     return;
   }
+  staticOnlyBlock_ = false;
 
   bool indexable = shouldIndex(header);
   if (indexable) {
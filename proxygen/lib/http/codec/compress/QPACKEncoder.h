@@ -86,6 +86,30 @@ class QPACKEncoder : public HPACKEncoderBase, public QPACKContext {
     maxVulnerable_ = maxVulnerable;
   }
 
+  // The peer's limit (QPACK_BLOCKED_STREAMS)
+  uint32_t getMaxVulnerable() const {
+    return maxVulnerable_;
+  }
+
+  /**
+   * A local limit on the blocks with vulnerable references, below the
+   * peer's, for trading compression for fewer blocked streams when losses
+   * keep the encoder stream behind.  Entries are still inserted past it, and
+   * referenced once acknowledged.
+   */
+  void setVulnerableBudget(uint32_t budget) {
+    vulnerableBudget_ = budget;
+  }
+
+  uint32_t getVulnerableBudget() const {
+    return std::min(maxVulnerable_, vulnerableBudget_);
+  }
+
+  // Header blocks encoded with vulnerable references
+  uint64_t getVulnerableBlockCount() const {
+    return vulnerableBlockCount_;
+  }
+
   // This API is only for tests, and doesn't work correctly if the table is
   // already populated.
   void setMinFreeForTesting(uint32_t minFree) {
@@ -96,7 +120,7 @@ class QPACKEncoder : public HPACKEncoderBase, public QPACKContext {
 
  private:
   bool allowVulnerable() const {
-    return numVulnerable_ < maxVulnerable_;
+    return numVulnerable_ < getVulnerableBudget();
   }
 
   bool shouldIndex(const HPACKHeader& header) const;
@@ -166,7 +190,9 @@ class QPACKEncoder : public HPACKEncoderBase, public QPACKContext {
   OutstandingBlock* curOutstanding_{nullptr};
   uint32_t maxDepends_{0};
   uint32_t maxVulnerable_{HPACK::kDefaultBlocking};
+  uint32_t vulnerableBudget_{std::numeric_limits<uint32_t>::max()};
   uint32_t numVulnerable_{0};
+  uint64_t vulnerableBlockCount_{0};
   uint32_t maxTableSize_{0};
   int64_t maxEncoderStreamBytes_{0};
   folly::IOBufQueue decoderIngress_{folly::IOBufQueue::cacheChainLength()};
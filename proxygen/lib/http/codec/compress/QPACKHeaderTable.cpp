@@ -9,9 +9,10 @@
  */
 #include <proxygen/lib/http/codec/compress/QPACKHeaderTable.h>
 
+#include <algorithm>
+
 #include <glog/logging.h>
 
-using std::list;
 using std::pair;
 using std::string;
 
@@ -101,9 +102,7 @@ uint32_t QPACKHeaderTable::getIndexImpl(const HPACKHeaderName& headerName,
   bool encoderHasUnackedEntry = false;
   // Searching backwards gives smallest index, but more likely vulnerable
   // Searching forwards least likely vulnerable but could prevent eviction
-  for (auto indexIt = it->second.rbegin(); indexIt != it->second.rend();
-       ++indexIt) {
-    auto i = *indexIt;
+  for (auto i = it->second.newest; i != kNoEntry; i = nameLinks_[i].older) {
     if (nameOnly || table_[i].value == value) {
       // allow vulnerable or not vulnerable
       if (allowVulnerable || internalToAbsolute(i) <= ackedInsertCount_) {
@@ -181,6 +180,14 @@ void QPACKHeaderTable::updateResizedTable(
   }
 }
 
+void QPACKHeaderTable::rotateTable(uint32_t oldTail) {
+  HeaderTable::rotateTable(oldTail);
+  if (refCount_) {
+    std::rotate(refCount_->begin(), refCount_->begin() + oldTail,
+                refCount_->end());
+  }
+}
+
 uint32_t QPACKHeaderTable::evict(uint32_t needed, uint32_t desiredCapacity) {
   if (bytes_ + needed < desiredCapacity ||
       !canEvict(bytes_ + needed - desiredCapacity)) {
@@ -193,6 +193,8 @@ class QPACKHeaderTable : public HeaderTable {
 
   void updateResizedTable(uint32_t oldTail, uint32_t oldLength,
                           uint32_t newLength) override;
+
+  void rotateTable(uint32_t oldTail) override;
   /**
    * Removes one header entry from the beginning of the header table.
    */
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/compress/StaticBlockCache.h>
+
+#include <folly/hash/Hash.h>
+
+using std::vector;
+
+namespace proxygen {
+
+const size_t StaticBlockCache::kMaxEntries;
+const size_t StaticBlockCache::kMaxHeaders;
+
+StaticBlockCache& StaticBlockCache::get() {
+  static thread_local StaticBlockCache cache;
+  return cache;
+}
+
+uint64_t StaticBlockCache::hash(uint8_t flavor,
+                                const vector<HPACKHeader>& headers) {
+  uint64_t h = folly::hash::fnv64_buf(&flavor, sizeof(flavor));
+  for (const auto& header : headers) {
+    const auto& name = header.name.get();
+    // the lengths keep name/value boundaries from aliasing
+    uint32_t lengths[] = {uint32_t(name.size()), uint32_t(header.value.size())};
+    h = folly::hash::fnv64_buf(lengths, sizeof(lengths), h);
+    h = folly::hash::fnv64_buf(name.data(), name.size(), h);
+    h = folly::hash::fnv64_buf(header.value.data(), header.value.size(), h);
+  }
+  return h;
+}
+
+const std::string* StaticBlockCache::find(
+    Format format, bool huffman, bool noTable,
+    const vector<HPACKHeader>& headers) const {
+  if (entries_.empty()) {
+    return nullptr;
+  }
+  auto f = flavor(format, huffman, noTable);
+  auto it = entries_.find(hash(f, headers));
+  if (it == entries_.end() || it->second.flavor != f ||
+      it->second.headers != headers) {
+    return nullptr;
+  }
+  return &it->second.block;
+}
+
+void StaticBlockCache::insert(Format format, bool huffman, bool noTable,
+                              const vector<HPACKHeader>& headers,
+                              const folly::IOBuf& block) {
+  if (entries_.size() >= kMaxEntries || headers.size() > kMaxHeaders) {
+    return;
+  }
+  auto f = flavor(format, huffman, noTable);
+  auto res = entries_.emplace(hash(f, headers), Entry());
+  if (!res.second) {
+    return;
+  }
+  auto& entry = res.first->second;
+  entry.flavor = f;
+  entry.headers.reserve(headers.size());
+  for (const auto& header : headers) {
+    entry.headers.push_back(header.copy());
+  }
+  entry.block.reserve(block.computeChainDataLength());
+  for (auto range : block) {
+    entry.block.append(reinterpret_cast<const char*>(range.data()),
+                       range.size());
+  }
+}
+
+}
@@ -0,0 +1,91 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/io/IOBuf.h>
+#include <proxygen/lib/http/codec/compress/HPACKHeader.h>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Cache of encoded header blocks whose encoding does not depend on the
+ * dynamic table, shared by all the encoders of a thread.  That is
+ *
+ *  - blocks where every header is in the static table, which encode to
+ *    static references whatever the dynamic table holds
+ *  - any block, for encoders whose dynamic table is empty with a capacity of 0
+ *
+ * Each thread has its own instance, so lookups and inserts take no lock.
+ * Entries are never evicted and the cache stops growing when full: it is
+ * meant for the few blocks (":status: 200" with a fixed content-type, say)
+ * a server sends on every connection.
+ */
+class StaticBlockCache {
+ public:
+  enum class Format : uint8_t {
+    HPACK = 0,
+    QPACK = 1,
+  };
+
+  static const size_t kMaxEntries = 256;
+  // longer blocks, mostly requests, are unlikely to repeat exactly
+  static const size_t kMaxHeaders = 8;
+
+  /**
+   * The calling thread's cache
+   */
+  static StaticBlockCache& get();
+
+  /**
+   * Encoding of headers for the given encoder setup, or nullptr.  noTable
+   * selects the blocks encoded with an empty 0 capacity table.
+   */
+  const std::string* find(Format format, bool huffman, bool noTable,
+                          const std::vector<HPACKHeader>& headers) const;
+
+  /**
+   * Remember the encoding of headers.  The caller vouches it only depends
+   * on the static table (or, with noTable, on the 0 capacity table).
+   */
+  void insert(Format format, bool huffman, bool noTable,
+              const std::vector<HPACKHeader>& headers,
+              const folly::IOBuf& block);
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  void clear() {
+    entries_.clear();
+  }
+
+ private:
+  struct Entry {
+    uint8_t flavor;
+    std::vector<HPACKHeader> headers;
+    std::string block;
+  };
+
+  static uint8_t flavor(Format format, bool huffman, bool noTable) {
+    return static_cast<uint8_t>(format) | (huffman ? 2 : 0) |
+      (noTable ? 4 : 0);
+  }
+
+  static uint64_t hash(uint8_t flavor,
+                       const std::vector<HPACKHeader>& headers);
+
+  // keyed by hash, a colliding block is simply not cached
+  folly::F14FastMap<uint64_t, Entry> entries_;
+};
+
+}
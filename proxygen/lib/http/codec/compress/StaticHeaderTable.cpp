@@ -12,6 +12,7 @@
 #include <folly/Indestructible.h>
 
 #include <glog/logging.h>
+#include <limits>
 #include <list>
 
 using std::list;
@@ -124,6 +125,55 @@ StaticHeaderTable::StaticHeaderTable(
   for (auto& header : hlist) {
     add(std::move(header));
   }
+
+  // Counting sort of the entries by the code of their name
+  CHECK_LE(size, std::numeric_limits<uint8_t>::max());
+  codeOffsets_.fill(0);
+  for (uint32_t i = 1; i <= this->size(); ++i) {
+    auto code = getHeader(i).name.getHeaderCode();
+    if (code < HTTPHeaderCodeCommonOffset) {
+      hasOtherNames_ = true;
+    } else {
+      codeOffsets_[code + 1]++;
+    }
+  }
+  for (size_t code = 1; code < codeOffsets_.size(); ++code) {
+    codeOffsets_[code] += codeOffsets_[code - 1];
+  }
+  codeIndices_.resize(codeOffsets_.back());
+  auto next = codeOffsets_;
+  for (uint32_t i = 1; i <= this->size(); ++i) {
+    auto code = getHeader(i).name.getHeaderCode();
+    if (code >= HTTPHeaderCodeCommonOffset) {
+      codeIndices_[next[code]++] = i;
+    }
+  }
+}
+
+uint32_t StaticHeaderTable::getIndex(const HPACKHeader& header) const {
+  auto code = header.name.getHeaderCode();
+  if (code < HTTPHeaderCodeCommonOffset) {
+    return hasOtherNames_ ? HeaderTable::getIndex(header) : 0;
+  }
+  for (auto i = codeOffsets_[code]; i < codeOffsets_[code + 1]; ++i) {
+    uint32_t index = codeIndices_[i];
+    if (getHeader(index).value == header.value) {
+      return index;
+    }
+  }
+  return 0;
+}
+
+uint32_t StaticHeaderTable::nameIndex(
+    const HPACKHeaderName& headerName) const {
+  auto code = headerName.getHeaderCode();
+  if (code < HTTPHeaderCodeCommonOffset) {
+    return hasOtherNames_ ? HeaderTable::nameIndex(headerName) : 0;
+  }
+  if (codeOffsets_[code] == codeOffsets_[code + 1]) {
+    return 0;
+  }
+  return codeIndices_[codeOffsets_[code]];
 }
 
 const StaticHeaderTable& StaticHeaderTable::get() {
@@ -12,6 +12,8 @@
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 
+#include <array>
+
 namespace proxygen {
 
 class StaticHeaderTable : public HeaderTable {
@@ -22,6 +24,24 @@ class StaticHeaderTable : public HeaderTable {
   static const StaticHeaderTable& get();
 
   static bool isHeaderCodeInTableWithNonEmptyValue(HTTPHeaderCode headerCode);
+
+  /**
+   * The same as the HeaderTable lookups, but the entries of a common header
+   * name are found from its HTTPHeaderCode in one array access rather than
+   * by probing the names map, the map being left to the names outside of
+   * HTTPCommonHeaders.
+   */
+  uint32_t getIndex(const HPACKHeader& header) const;
+
+  uint32_t nameIndex(const HPACKHeaderName& headerName) const;
+
+ private:
+  // The external indices of the entries named by each HTTPHeaderCode, lowest
+  // first, are codeIndices_[codeOffsets_[code] .. codeOffsets_[code + 1])
+  std::array<uint8_t, HTTPCommonHeaders::num_header_codes + 1> codeOffsets_;
+  std::vector<uint8_t> codeIndices_;
+  // Whether some entry has a name outside of HTTPCommonHeaders
+  bool hasOtherNames_{false};
 };
 
 }
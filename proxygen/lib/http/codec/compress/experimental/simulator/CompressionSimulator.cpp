@@ -33,7 +33,7 @@ const std::string kTestDir = getContainingDirectory(__FILE__).str();
 
 namespace proxygen { namespace compress {
 
-bool CompressionSimulator::readInputFromFileAndSchedule(
+vector<HTTPMessage> CompressionSimulator::readInputFromFile(
     const string& filename) {
   unique_ptr<HTTPArchive> har;
   try {
@@ -41,8 +41,8 @@ bool CompressionSimulator::readInputFromFileAndSchedule(
   } catch (const std::exception& ex) {
     LOG(ERROR) << folly::exceptionStr(ex);
   }
-  if (!har || har->requests.size() == 0) {
-    return false;
+  if (!har) {
+    return {};
   }
   // Sort by start time (har ordered by finish time?)
   std::sort(har->requests.begin(),
@@ -50,24 +50,41 @@ bool CompressionSimulator::readInputFromFileAndSchedule(
             [](const HTTPMessage& a, const HTTPMessage& b) {
               return a.getStartTime() < b.getStartTime();
             });
-  TimePoint last = har->requests[0].getStartTime();
+  return std::move(har->requests);
+}
+
+bool CompressionSimulator::scheduleRequests(
+    const vector<HTTPMessage>& requests) {
+  if (requests.empty()) {
+    return false;
+  }
+  TimePoint last = requests[0].getStartTime();
   std::chrono::milliseconds cumulativeDelay(0);
   uint16_t index = 0;
-  for (HTTPMessage& msg : har->requests) {
+  for (const HTTPMessage& msg : requests) {
     auto delayFromPrevious = millisecondsBetween(msg.getStartTime(), last);
     // If there was a quiescent gap in the HAR of at least some value, shrink
     // it so the test doesn't last forever
-    if (delayFromPrevious > std::chrono::milliseconds(1000)) {
-      delayFromPrevious = std::chrono::milliseconds(1000);
+    if (delayFromPrevious > params_.maxGap) {
+      delayFromPrevious = params_.maxGap;
     }
     last = msg.getStartTime();
     cumulativeDelay += delayFromPrevious;
-    setupRequest(index++, std::move(msg), cumulativeDelay);
+    // Every shard keeps the timeline of the whole trace
+    if (params_.numShards > 1) {
+      auto key = connectionKey(msg.getHeaders().getSingleOrEmpty(
+                                 HTTP_HEADER_HOST));
+      if (std::hash<string>()(key.str()) % params_.numShards !=
+          params_.shard) {
+        continue;
+      }
+    }
+    setupRequest(index++, HTTPMessage(msg), cumulativeDelay);
   }
   for (auto& kv : domains_) {
     flushRequests(kv.second.get());
   }
-  return true;
+  return index > 0;
 }
 
 void CompressionSimulator::run() {
@@ -80,24 +97,42 @@ void CompressionSimulator::run() {
 
   LOG(INFO) << "Starting run";
   eventBase_.loop();
-  uint32_t holBlockCount = 0;
   for (auto& scheme : domains_) {
-    holBlockCount += scheme.second->getHolBlockCount();
+    stats_.holBlockCount += scheme.second->getHolBlockCount();
   }
+  stats_.blocks = requests_.size();
+  if (params_.numShards <= 1) {
+    logStats(params_, stats_);
+  }
+}
+
+void CompressionSimulator::logStats(const SimParams& params,
+                                    const SimStats& stats) {
+  auto perHeader = [&stats] (std::chrono::nanoseconds cpu) {
+    return stats.headers ? cpu.count() / stats.headers : 0;
+  };
   LOG(INFO) << "Complete"
             << "\nStats:"
                "\nSeed: "
-            << params_.seed << "\nBlocks sent: " << requests_.size()
-            << "\nAllowed OOO: " << stats_.allowedOOO
-            << "\nPackets: " << stats_.packets
-            << "\nPacket Losses: " << stats_.packetLosses
-            << "\nHOL Block Count: " << holBlockCount
-            << "\nHOL Delay (ms): " << stats_.holDelay.count()
-            << "\nMax Queue Buffer Bytes: " << stats_.maxQueueBufferBytes
-            << "\nUncompressed Bytes: " << stats_.uncompressed
-            << "\nCompressed Bytes: " << stats_.compressed
+            << params.seed << "\nBlocks sent: " << stats.blocks
+            << "\nAllowed OOO: " << stats.allowedOOO
+            << "\nPackets: " << stats.packets
+            << "\nPacket Losses: " << stats.packetLosses
+            << "\nHOL Block Count: " << stats.holBlockCount
+            << "\nHOL Delay (ms): " << stats.holDelay.count()
+            << "\nMax Queue Buffer Bytes: " << stats.maxQueueBufferBytes
+            << "\nUncompressed Bytes: " << stats.uncompressed
+            << "\nCompressed Bytes: " << stats.compressed
             << "\nCompression Ratio: "
-            << int(100 - double(100 * stats_.compressed) / stats_.uncompressed);
+            << int(100 - double(100 * stats.compressed) / stats.uncompressed)
+            << "\nEncode CPU (us): "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                 stats.encodeCpu).count()
+            << "\nDecode CPU (us): "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                 stats.decodeCpu).count()
+            << "\nEncode CPU per header (ns): " << perHeader(stats.encodeCpu)
+            << "\nDecode CPU per header (ns): " << perHeader(stats.decodeCpu);
 }
 
 void CompressionSimulator::flushRequests(CompressionScheme* scheme) {
@@ -249,13 +284,17 @@ void CompressionSimulator::flushSchemePackets(CompressionScheme* scheme) {
   CHECK(scheme->encodedBlocks.empty());
 }
 
-CompressionScheme* CompressionSimulator::getScheme(StringPiece domain) {
-  static string blended("\"Facebook\"");
+StringPiece CompressionSimulator::connectionKey(StringPiece domain) const {
+  static const string blended("\"Facebook\"");
   if (params_.blend &&
       (domain.endsWith("facebook.com") || domain.endsWith("fbcdn.net"))) {
-    domain = blended;
+    return blended;
   }
+  return domain;
+}
 
+CompressionScheme* CompressionSimulator::getScheme(StringPiece domain) {
+  domain = connectionKey(domain);
   auto it = domains_.find(domain.str());
   CompressionScheme* scheme = nullptr;
   if (it == domains_.end()) {
@@ -273,11 +312,13 @@ unique_ptr<CompressionScheme> CompressionSimulator::makeScheme() {
   switch (params_.type) {
     case SchemeType::QPACK:
       return make_unique<QPACKScheme>(this, params_.tableSize,
-                                      params_.maxBlocking);
+                                      params_.maxBlocking,
+                                      params_.adaptiveIndexing);
     case SchemeType::QMIN:
       return make_unique<QMINScheme>(this, params_.tableSize);
     case SchemeType::HPACK:
-      return make_unique<HPACKScheme>(this, params_.tableSize);
+      return make_unique<HPACKScheme>(this, params_.tableSize,
+                                      params_.adaptiveIndexing);
   }
   LOG(FATAL) << "Bad scheme";
   return nullptr;
@@ -292,7 +333,10 @@ std::pair<FrameFlags, unique_ptr<IOBuf>> CompressionSimulator::encode(
       requests_[index], cookies);
 
   auto before = stats_.uncompressed;
+  stats_.headers += allHeaders.size();
+  auto start = threadCpuTime();
   auto res = scheme->encode(newPacket, std::move(allHeaders), stats_);
+  stats_.encodeCpu += threadCpuTime() - start;
   VLOG(1) << "Encoded request=" << index << " for host="
           << requests_[index].getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST)
           << " orig size=" << (stats_.uncompressed - before)
@@ -307,7 +351,10 @@ void CompressionSimulator::decode(CompressionScheme* scheme,
                                   FrameFlags flags,
                                   unique_ptr<IOBuf> encodedReq,
                                   SimStreamingCallback& cb) {
+  // Blocks queued behind a missing one are decoded, and counted, later
+  auto start = threadCpuTime();
   scheme->decode(flags, std::move(encodedReq), stats_, cb);
+  stats_.decodeCpu += threadCpuTime() - start;
 }
 
 void CompressionSimulator::decodePacket(
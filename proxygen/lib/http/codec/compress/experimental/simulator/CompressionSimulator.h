@@ -25,9 +25,27 @@ class CompressionSimulator {
   explicit CompressionSimulator(SimParams p) : params_(p) {
   }
 
-  bool readInputFromFileAndSchedule(const std::string& filename);
+  // Requests of a HAR file, by start time, or none if it cannot be read
+  static std::vector<proxygen::HTTPMessage> readInputFromFile(
+      const std::string& filename);
+
+  // Schedule the requests of this simulator's shard.  Returns false if there
+  // are none.
+  bool scheduleRequests(const std::vector<proxygen::HTTPMessage>& requests);
+
+  bool readInputFromFileAndSchedule(const std::string& filename) {
+    return scheduleRequests(readInputFromFile(filename));
+  }
+
+  // Runs the simulation, and logs its stats when it has all the connections
   void run();
 
+  const SimStats& getStats() const {
+    return stats_;
+  }
+
+  static void logStats(const SimParams& params, const SimStats& stats);
+
   // Called from CompressionScheme::runLoopCallback
   void flushSchemePackets(CompressionScheme* scheme);
   void flushPacket(CompressionScheme* scheme);
@@ -37,6 +55,8 @@ class CompressionSimulator {
   void setupRequest(uint16_t seqn,
                     HTTPMessage&& msg,
                     std::chrono::milliseconds encodeDelay);
+  // The connection requests to host are sent on
+  folly::StringPiece connectionKey(folly::StringPiece host) const;
   CompressionScheme* getScheme(folly::StringPiece host);
   std::unique_ptr<CompressionScheme> makeScheme();
   std::pair<FrameFlags, std::unique_ptr<folly::IOBuf>> encode(
@@ -9,7 +9,9 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 
 namespace proxygen { namespace compress {
 enum class SchemeType { QPACK, QMIN, HPACK };
@@ -37,6 +39,13 @@ struct SimParams {
   bool samePacketCompression;
   uint32_t tableSize;
   uint32_t maxBlocking;
+  bool adaptiveIndexing;
+  // HAR gaps between requests are shortened to this
+  std::chrono::milliseconds maxGap;
+  // Connections are split across numShards simulators, this one runs those
+  // of shard
+  uint32_t numShards;
+  uint32_t shard;
 };
 
 struct SimStats {
@@ -47,5 +56,28 @@ struct SimStats {
   uint64_t uncompressed{0};
   uint64_t compressed{0};
   uint64_t packets{0};
+  uint64_t blocks{0};
+  uint64_t headers{0};
+  uint64_t holBlockCount{0};
+  // Thread CPU time spent in the schemes' encode and decode
+  std::chrono::nanoseconds encodeCpu{0};
+  std::chrono::nanoseconds decodeCpu{0};
+
+  // Accumulate the stats of another shard of the same run
+  void merge(const SimStats& other) {
+    allowedOOO += other.allowedOOO;
+    packetLosses += other.packetLosses;
+    maxQueueBufferBytes = std::max(maxQueueBufferBytes,
+                                   other.maxQueueBufferBytes);
+    holDelay += other.holDelay;
+    uncompressed += other.uncompressed;
+    compressed += other.compressed;
+    packets += other.packets;
+    blocks += other.blocks;
+    headers += other.headers;
+    holBlockCount += other.holBlockCount;
+    encodeCpu += other.encodeCpu;
+    decodeCpu += other.decodeCpu;
+  }
 };
 }} // namespace proxygen::compress
@@ -9,6 +9,7 @@
  */
 #include <proxygen/lib/http/codec/compress/experimental/simulator/CompressionUtils.h>
 
+#include <folly/portability/Time.h>
 #include <proxygen/lib/http/codec/HeaderConstants.h>
 
 using std::string;
@@ -127,6 +128,12 @@ std::vector<compress::Header> prepareMessageForCompression(
   return allHeaders;
 }
 
+std::chrono::nanoseconds threadCpuTime() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
 } // end compress
 
 bool operator==(const HTTPMessage& msg1, const HTTPMessage& msg2) {
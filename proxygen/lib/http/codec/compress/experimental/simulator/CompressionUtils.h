@@ -12,6 +12,7 @@
 #include <proxygen/lib/http/HTTPMessage.h>
 #include <proxygen/lib/http/codec/compress/Header.h>
 
+#include <chrono>
 #include <vector>
 #include <string>
 
@@ -23,6 +24,9 @@ std::vector<Header> prepareMessageForCompression(
     const HTTPMessage& msg,
     std::vector<std::string>& cookies);
 
+// CPU time consumed so far by the calling thread
+std::chrono::nanoseconds threadCpuTime();
+
 }
 
 // Compare two HTTPMessage's for equality
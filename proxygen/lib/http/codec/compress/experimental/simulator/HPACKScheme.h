@@ -12,6 +12,7 @@
 #include "proxygen/lib/http/codec/compress/experimental/simulator/CompressionScheme.h"
 #include <proxygen/lib/http/codec/compress/HPACKCodec.h>
 #include <proxygen/lib/http/codec/compress/HPACKQueue.h>
+#include <proxygen/lib/http/codec/compress/AdaptiveIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/NoPathIndexingStrategy.h>
 
 namespace proxygen { namespace compress {
@@ -21,10 +22,15 @@ namespace proxygen { namespace compress {
  */
 class HPACKScheme : public CompressionScheme {
  public:
-  explicit HPACKScheme(CompressionSimulator* sim, uint32_t tableSize)
+  explicit HPACKScheme(CompressionSimulator* sim, uint32_t tableSize,
+                       bool adaptiveIndexing = false)
       : CompressionScheme(sim) {
     client_.setEncodeHeadroom(2);
-    client_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
+    // Only the client encodes
+    client_.setHeaderIndexingStrategy(
+      adaptiveIndexing ? &adaptiveStrat_ :
+      static_cast<const HeaderIndexingStrategy*>(
+        NoPathIndexingStrategy::getInstance()));
     server_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
     client_.setEncoderHeaderTableSize(tableSize);
     server_.setDecoderHeaderTableMaxSize(tableSize);
@@ -80,6 +86,9 @@ class HPACKScheme : public CompressionScheme {
     return serverQueue_.getHolBlockCount();
   }
 
+  // Declared first, client_ holds a pointer to it
+  AdaptiveIndexingStrategy adaptiveStrat_{
+    NoPathIndexingStrategy::getInstance()};
   HPACKCodec client_{TransportDirection::UPSTREAM};
   HPACKCodec server_{TransportDirection::DOWNSTREAM};
   HPACKQueue serverQueue_{server_};
@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/init/Init.h>
 #include <folly/portability/GFlags.h>
 
@@ -29,6 +30,14 @@ DEFINE_int64(seed, 0, "RNG seed");
 DEFINE_bool(blend, true, "Blend all facebook.com and fbcdn.net domains");
 DEFINE_int32(max_blocking, 100,
              "Maximum number of vulnerable/blocking header blocks");
+DEFINE_bool(adaptive_indexing, false,
+            "Stop indexing header names whose values rarely repeat");
+DEFINE_int32(max_gap, 1000,
+             "Longest pause between requests (ms); shorter runs faster");
+DEFINE_int32(threads, 1, "Threads running simulations in parallel");
+DEFINE_int32(shards, 0,
+             "Groups of connections simulated independently, "
+             "0 for one per thread");
 DEFINE_bool(same_packet_compression,
             true,
             "Allow QPACK to compress across "
@@ -76,11 +85,49 @@ int main(int argc, char* argv[]) {
               FLAGS_blend,
               FLAGS_same_packet_compression,
               uint32_t(FLAGS_table_size),
-              uint32_t(FLAGS_max_blocking)};
-  CompressionSimulator sim(p);
-  if (sim.readInputFromFileAndSchedule(FLAGS_input)) {
-    sim.run();
+              uint32_t(FLAGS_max_blocking),
+              FLAGS_adaptive_indexing,
+              std::chrono::milliseconds(FLAGS_max_gap),
+              1,
+              0};
+  uint32_t shards = FLAGS_shards > 0 ? FLAGS_shards :
+    std::max(FLAGS_threads, 1);
+  if (shards == 1) {
+    CompressionSimulator sim(p);
+    if (sim.readInputFromFileAndSchedule(FLAGS_input)) {
+      sim.run();
+    }
+    return 0;
   }
 
+  // Each shard is a simulator of its own, with its own EventBase and a
+  // seed derived from the main one, running on one of the pool's threads
+  auto requests = CompressionSimulator::readInputFromFile(FLAGS_input);
+  if (requests.empty()) {
+    return 1;
+  }
+  std::vector<SimStats> shardStats(shards);
+  {
+    folly::CPUThreadPoolExecutor pool(std::max(FLAGS_threads, 1));
+    for (uint32_t i = 0; i < shards; i++) {
+      pool.add([&p, &requests, &shardStats, shards, i] {
+        SimParams shardParams = p;
+        shardParams.seed = p.seed + i;
+        shardParams.numShards = shards;
+        shardParams.shard = i;
+        CompressionSimulator sim(shardParams);
+        if (sim.scheduleRequests(requests)) {
+          sim.run();
+          shardStats[i] = sim.getStats();
+        }
+      });
+    }
+    pool.join();
+  }
+  SimStats stats;
+  for (const auto& s : shardStats) {
+    stats.merge(s);
+  }
+  CompressionSimulator::logStats(p, stats);
   return 0;
 }
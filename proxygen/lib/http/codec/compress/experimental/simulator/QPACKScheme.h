@@ -10,6 +10,7 @@
 #pragma once
 
 #include <proxygen/lib/http/codec/compress/QPACKCodec.h>
+#include <proxygen/lib/http/codec/compress/AdaptiveIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/NoPathIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/experimental/simulator/CompressionScheme.h>
 
@@ -18,9 +19,13 @@ namespace proxygen { namespace compress {
 class QPACKScheme : public CompressionScheme {
  public:
   explicit QPACKScheme(CompressionSimulator* sim, uint32_t tableSize,
-                       uint32_t maxBlocking)
+                       uint32_t maxBlocking, bool adaptiveIndexing = false)
       : CompressionScheme(sim) {
-    client_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
+    // Only the client encodes
+    client_.setHeaderIndexingStrategy(
+      adaptiveIndexing ? &adaptiveStrat_ :
+      static_cast<const HeaderIndexingStrategy*>(
+        NoPathIndexingStrategy::getInstance()));
     server_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
     client_.setEncoderHeaderTableSize(tableSize);
     server_.setDecoderHeaderTableMaxSize(tableSize);
@@ -165,6 +170,9 @@ class QPACKScheme : public CompressionScheme {
     return server_.getHolBlockCount();
   }
 
+  // Declared first, client_ holds a pointer to it
+  AdaptiveIndexingStrategy adaptiveStrat_{
+    NoPathIndexingStrategy::getInstance()};
   QPACKCodec client_;
   QPACKCodec server_;
   std::map<uint16_t, std::unique_ptr<folly::IOBuf>> controlQueue_;
@@ -0,0 +1,214 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/io/Cursor.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/codec/compress/HPACKCodec.h>
+#include <proxygen/lib/http/codec/compress/QPACKCodec.h>
+#include <proxygen/lib/http/codec/compress/test/HTTPArchive.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Replays the header blocks of a HAR file through one HPACKCodec and one
+// QPACKCodec encoder/decoder pair per table size, as a single connection
+// would, and reports encode and decode throughput of the uncompressed
+// headers, the cost per header and the compression ratio.
+//
+//   HARCompressionBenchmark --har_file=site.har --table_sizes=4096,65536
+
+DEFINE_string(har_file, "", "HAR file to replay");
+DEFINE_bool(har_public, false,
+            "The file uses the public HPACK test case format rather than HAR");
+DEFINE_string(table_sizes, "4096,16384,65536",
+              "Comma separated dynamic table sizes to run with");
+DEFINE_int32(rounds, 10,
+             "Times each message list is replayed, each on a fresh codec pair");
+
+using namespace proxygen;
+using std::string;
+using std::vector;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A header block with the std::string storage compress::Header points into
+struct Block {
+  vector<string> strings;
+  vector<compress::Header> headers;
+};
+
+vector<Block> makeBlocks(const vector<HTTPMessage>& msgs) {
+  auto converted = HTTPArchive::convertToHPACK(msgs);
+  vector<Block> blocks(converted.size());
+  for (size_t i = 0; i < converted.size(); i++) {
+    auto& block = blocks[i];
+    // reserved so pointers in headers stay valid
+    block.strings.reserve(converted[i].size() * 2);
+    for (const auto& header : converted[i]) {
+      block.strings.push_back(header.name.get());
+      auto& name = block.strings.back();
+      block.strings.push_back(header.value.toStdString());
+      block.headers.push_back(
+        compress::Header::makeHeaderForTest(name, block.strings.back()));
+    }
+  }
+  return blocks;
+}
+
+class CountingCallback : public HPACK::StreamingCallback {
+ public:
+  void onHeader(const folly::fbstring& /*name*/,
+                const folly::fbstring& /*value*/) override {
+    numHeaders++;
+  }
+  void onHeadersComplete(HTTPHeaderSize /*decodedSize*/,
+                         bool /*acknowledge*/) override {
+    complete = true;
+  }
+  void onDecodeError(HPACK::DecodeError decodeError) override {
+    LOG(FATAL) << "decode error=" << decodeError;
+  }
+
+  uint64_t numHeaders{0};
+  bool complete{false};
+};
+
+struct Result {
+  uint64_t numHeaders{0};
+  uint64_t uncompressed{0};
+  uint64_t compressed{0};
+  Clock::duration encodeTime{0};
+  Clock::duration decodeTime{0};
+};
+
+void replayHPACK(vector<Block>& blocks, uint32_t tableSize, Result& result) {
+  HPACKCodec client(TransportDirection::UPSTREAM);
+  HPACKCodec server(TransportDirection::DOWNSTREAM);
+  server.setDecoderHeaderTableMaxSize(tableSize);
+  client.setEncoderHeaderTableSize(tableSize);
+  for (auto& block : blocks) {
+    auto start = Clock::now();
+    auto encoded = client.encode(block.headers);
+    auto encodedAt = Clock::now();
+    CountingCallback cb;
+    if (encoded) {
+      folly::io::Cursor cursor(encoded.get());
+      server.decodeStreaming(cursor, cursor.totalLength(), &cb);
+    }
+    auto end = Clock::now();
+    CHECK(cb.complete || !encoded);
+    result.encodeTime += encodedAt - start;
+    result.decodeTime += end - encodedAt;
+    result.numHeaders += block.headers.size();
+    result.uncompressed += client.getEncodedSize().uncompressed;
+    result.compressed += client.getEncodedSize().compressed;
+  }
+}
+
+void replayQPACK(vector<Block>& blocks, uint32_t tableSize, Result& result) {
+  QPACKCodec client;
+  QPACKCodec server;
+  server.setDecoderHeaderTableMaxSize(tableSize);
+  CHECK(client.setEncoderHeaderTableSize(tableSize));
+  uint64_t streamId = 0;
+  for (auto& block : blocks) {
+    streamId++;
+    auto start = Clock::now();
+    auto encoded = client.encode(block.headers, streamId);
+    auto encodedAt = Clock::now();
+    auto compressed = encoded.stream->computeChainDataLength();
+    if (encoded.control) {
+      compressed += encoded.control->computeChainDataLength();
+      CHECK_EQ(server.decodeEncoderStream(std::move(encoded.control)),
+               HPACK::DecodeError::NONE);
+    }
+    CountingCallback cb;
+    auto length = encoded.stream->computeChainDataLength();
+    server.decodeStreaming(streamId, std::move(encoded.stream), length, &cb);
+    auto end = Clock::now();
+    // Blocks are delivered in order, nothing is ever blocked
+    CHECK(cb.complete);
+    // Acknowledged immediately, as on a connection with no loss
+    CHECK_EQ(client.decodeDecoderStream(server.encodeHeaderAck(streamId)),
+             HPACK::DecodeError::NONE);
+    result.encodeTime += encodedAt - start;
+    result.decodeTime += end - encodedAt;
+    result.numHeaders += block.headers.size();
+    result.uncompressed += client.getEncodedSize().uncompressed;
+    result.compressed += compressed;
+  }
+}
+
+void report(const char* codec, const char* msgType, uint32_t tableSize,
+            const Result& result) {
+  auto mbps = [&result] (Clock::duration time) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time);
+    return ns.count() ? (result.uncompressed * 1000.0) / ns.count() : 0.0;
+  };
+  auto nsPerHeader = [&result] (Clock::duration time) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time);
+    return result.numHeaders ? double(ns.count()) / result.numHeaders : 0.0;
+  };
+  printf("%-6s %-9s %6u %10.1f %10.1f %9.1f %9.1f %7.3f\n",
+         codec, msgType, tableSize,
+         mbps(result.encodeTime), mbps(result.decodeTime),
+         nsPerHeader(result.encodeTime), nsPerHeader(result.decodeTime),
+         result.uncompressed ?
+           double(result.compressed) / result.uncompressed : 0.0);
+}
+
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  if (FLAGS_har_file.empty()) {
+    LOG(ERROR) << "--har_file is required";
+    return 1;
+  }
+  auto har = FLAGS_har_public ? HTTPArchive::fromPublicFile(FLAGS_har_file) :
+    HTTPArchive::fromFile(FLAGS_har_file);
+  if (!har) {
+    LOG(ERROR) << "Failed to load " << FLAGS_har_file;
+    return 1;
+  }
+  vector<uint32_t> tableSizes;
+  folly::splitTo<uint32_t>(',', FLAGS_table_sizes,
+                           std::back_inserter(tableSizes), true);
+
+  std::pair<const char*, vector<Block>> msgLists[] = {
+    {"requests", makeBlocks(har->requests)},
+    {"responses", makeBlocks(har->responses)}
+  };
+  printf("%-6s %-9s %6s %10s %10s %9s %9s %7s\n",
+         "codec", "messages", "table", "enc MB/s", "dec MB/s",
+         "enc ns/h", "dec ns/h", "ratio");
+  for (auto tableSize : tableSizes) {
+    for (auto& msgList : msgLists) {
+      if (msgList.second.empty()) {
+        continue;
+      }
+      Result hpack;
+      Result qpack;
+      for (int32_t i = 0; i < FLAGS_rounds; i++) {
+        replayHPACK(msgList.second, tableSize, hpack);
+        replayQPACK(msgList.second, tableSize, qpack);
+      }
+      report("HPACK", msgList.first, tableSize, hpack);
+      report("QPACK", msgList.first, tableSize, qpack);
+    }
+  }
+  return 0;
+}
@@ -9,7 +9,9 @@
  */
 #include <proxygen/lib/http/codec/compress/test/TestUtil.h>
 #include <proxygen/lib/http/codec/compress/test/TestStreamingCallback.h>
+#include <proxygen/lib/http/codec/compress/HeaderTable.h>
 #include <folly/Benchmark.h>
+#include <folly/Conv.h>
 #include <folly/Range.h>
 
 #include <algorithm>
@@ -102,6 +104,32 @@ BENCHMARK(EncodeDecode2, iters) {
   encodeDecodeBench(2, iters);
 }
 
+// Dynamic table under header churn: every add evicts an old entry, and
+// lookups walk the entries sharing a name
+void tableChurnBench(uint32_t capacity, int iters) {
+  vector<HPACKHeader> churn;
+  BENCHMARK_SUSPEND {
+    static const char* names[] = {"cookie", "x-fb-debug", "etag",
+                                  "content-type", "x-request-id"};
+    for (int i = 0; i < 256; i++) {
+      churn.emplace_back(names[i % 5], folly::to<string>("value-", i * 7919));
+    }
+  }
+  HeaderTable table(capacity);
+  for (int i = 0; i < iters; i++) {
+    table.add(churn[i % churn.size()].copy());
+    folly::doNotOptimizeAway(table.getIndex(churn[(i * 31) % churn.size()]));
+  }
+}
+
+BENCHMARK(TableChurn4k, iters) {
+  tableChurnBench(4096, iters);
+}
+
+BENCHMARK(TableChurn64k, iters) {
+  tableChurnBench(65536, iters);
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
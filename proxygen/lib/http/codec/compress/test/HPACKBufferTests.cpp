@@ -205,6 +205,23 @@ TEST_F(HPACKBufferTests, DecodeMultiByte) {
   CHECK_EQ(decoder_.cursor().length(), 0);
 }
 
+TEST_F(HPACKBufferTests, DecodeIntegerMultiBuffer) {
+  // 1337 on a 5-bit prefix, then 10 on a 5-bit prefix, split at each byte
+  const uint8_t bytes[] = {31, 154, 10, 10};
+  for (size_t split = 1; split < sizeof(bytes); split++) {
+    auto buf = IOBuf::copyBuffer(bytes, split);
+    buf->appendChain(IOBuf::copyBuffer(bytes + split, sizeof(bytes) - split));
+    resetDecoder(buf.get());
+    uint64_t integer;
+    EXPECT_EQ(decoder_.decodeInteger(5, integer), DecodeError::NONE);
+    EXPECT_EQ(integer, 1337);
+    EXPECT_EQ(decoder_.consumedBytes(), 3);
+    EXPECT_EQ(decoder_.decodeInteger(5, integer), DecodeError::NONE);
+    EXPECT_EQ(integer, 10);
+    EXPECT_TRUE(decoder_.empty());
+  }
+}
+
 TEST_F(HPACKBufferTests, DecodeIntegerError) {
   buf_ = IOBuf::create(128);
   resetDecoder();
@@ -10,6 +10,7 @@
 #include <folly/Range.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
 #include <glog/logging.h>
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/codec/compress/HPACKCodec.h>
@@ -64,6 +65,26 @@ encodeDecode(HPACKCodec& encoder, HPACKCodec& decoder,
   return decode(decoder, c, c.totalLength());
 }
 
+// Decode encoded in pieces of pieceSize bytes, the way HTTP2Codec decodes a
+// header block split across CONTINUATION frames
+void decodeInPieces(HPACKCodec& codec, const IOBuf* encoded,
+                    size_t pieceSize, TestStreamingCallback& cb) {
+  IOBufQueue pending{IOBufQueue::cacheChainLength()};
+  Cursor input(encoded);
+  size_t remaining = encoded->computeChainDataLength();
+  while (remaining > 0 && !cb.hasError()) {
+    std::unique_ptr<IOBuf> piece;
+    auto len = std::min(pieceSize, remaining);
+    input.clone(piece, len);
+    pending.append(std::move(piece));
+    remaining -= len;
+    Cursor cursor(pending.front());
+    auto consumed = codec.decodeStreamingPartial(
+      cursor, pending.chainLength(), &cb, remaining == 0);
+    pending.trimStart(consumed);
+  }
+}
+
 uint64_t bufLen(const std::unique_ptr<IOBuf>& buf) {
   if (buf) {
     return buf->computeChainDataLength();
@@ -267,6 +288,55 @@ TEST_F(HPACKCodecTests, SizeLimitStats) {
   EXPECT_EQ(stats.tooLarge, 1);
 }
 
+TEST_F(HPACKCodecTests, PartialDecode) {
+  vector<vector<string>> headers = {
+    {":method", "GET"},
+    {":path", "/some/url"},
+    {"user-agent", "coolio"},
+    {"cookie", string(300, 'c')},
+    {"x-custom", "some value"},
+  };
+  auto encHeaders = headersFromArray(headers);
+  unique_ptr<IOBuf> encoded = client.encode(encHeaders);
+  // Representations split anywhere, including inside integers and literals
+  for (size_t pieceSize : {1, 7, 100}) {
+    HPACKCodec decoder(TransportDirection::DOWNSTREAM);
+    TestStreamingCallback cb;
+    decodeInPieces(decoder, encoded.get(), pieceSize, cb);
+    ASSERT_FALSE(cb.hasError());
+    auto decoded = cb.hpackHeaders();
+    ASSERT_EQ(decoded->size(), headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+      EXPECT_EQ((*decoded)[i].name.get(), headers[i][0]);
+      EXPECT_EQ((*decoded)[i].value, headers[i][1]);
+    }
+    EXPECT_EQ(cb.decodedSize_.compressed, encoded->computeChainDataLength());
+  }
+}
+
+TEST_F(HPACKCodecTests, PartialDecodeSizeLimit) {
+  vector<vector<string>> headers;
+  string contentLength = "Content-Length";
+  for (int i = 0; i < 10000; i++) {
+    headers.push_back({contentLength, folly::to<string>(i)});
+  }
+  auto encHeaders = headersFromArray(headers);
+  unique_ptr<IOBuf> encoded = client.encode(encHeaders);
+  TestStreamingCallback cb;
+  size_t decodedBytes = 0;
+  IOBufQueue pending{IOBufQueue::cacheChainLength()};
+  pending.append(encoded->clone());
+  while (!cb.hasError()) {
+    // Never the last piece: the limit fails the block before it is complete
+    Cursor cursor(pending.front());
+    auto consumed = server.decodeStreamingPartial(cursor, 1024, &cb, false);
+    pending.trimStart(consumed);
+    decodedBytes += consumed;
+    ASSERT_LT(decodedBytes, encoded->computeChainDataLength());
+  }
+  EXPECT_EQ(cb.error, HPACK::DecodeError::HEADERS_TOO_LARGE);
+}
+
 TEST_F(HPACKCodecTests, DefaultHeaderIndexingStrategy) {
   vector<Header> headers = basicHeaders();
   size_t headersIndexableSize = 4;
@@ -295,6 +365,78 @@ TEST_F(HPACKCodecTests, DefaultHeaderIndexingStrategy) {
     testCodec.getCompressionInfo().egressHeadersStored_, headersIndexableSize);
 }
 
+TEST_F(HPACKCodecTests, Hibernate) {
+  auto result = encodeDecode(client, server, basicHeaders());
+  EXPECT_FALSE(result.hasError());
+  EXPECT_EQ(client.getCompressionInfo().egressHeadersStored_, 4);
+  auto clientBytes = client.getMemoryUsage();
+  auto serverBytes = server.getMemoryUsage();
+  client.hibernate();
+  server.hibernate();
+  EXPECT_EQ(client.getCompressionInfo().egressHeadersStored_, 0);
+  EXPECT_LT(client.getMemoryUsage(), clientBytes);
+  // The decoder keeps its entries until told to drop them
+  EXPECT_EQ(server.getCompressionInfo().ingressHeadersStored_, 4);
+  EXPECT_LT(server.getMemoryUsage(), serverBytes);
+
+  // The table size updates empty the decoder's table before it is refilled
+  result = encodeDecode(client, server, basicHeaders());
+  EXPECT_FALSE(result.hasError());
+  EXPECT_EQ(result->headers.size(), 12);
+  EXPECT_EQ(server.getCompressionInfo().ingressHeadersStored_, 4);
+  EXPECT_EQ(server.getCompressionInfo().ingressBytesStored_,
+            client.getCompressionInfo().egressBytesStored_);
+  EXPECT_EQ(server.getCompressionInfo().ingressHeaderTableSize_,
+            client.getCompressionInfo().egressHeaderTableSize_);
+}
+
+
+TEST_F(HPACKCodecTests, HuffmanPassthrough) {
+  vector<vector<string>> headers = {
+    {":method", "GET"},
+    {":path", "/profile.php?id=1234"},
+    {"user-agent", "Mozilla/5.0 (Macintosh)"},
+    {"x-request-id", "0123456789abcdef"},
+    {"x-forwarded-for", "10.0.0.1"}
+  };
+  vector<Header> req = headersFromArray(headers);
+  auto encoded = client.encode(req);
+
+  HuffmanLiterals literals;
+  TestStreamingCallback cb;
+  cb.huffmanLiterals = &literals;
+  Cursor cursor(encoded.get());
+  server.decodeStreaming(cursor, cursor.totalLength(), &cb);
+  ASSERT_FALSE(cb.hasError());
+  EXPECT_EQ(cb.headers.size(), 10);
+  // Names and values sent as literals, but not those from the static table
+  EXPECT_TRUE(literals.find("Mozilla/5.0 (Macintosh)").hasValue());
+  EXPECT_TRUE(literals.find("x-request-id").hasValue());
+  EXPECT_TRUE(literals.find("10.0.0.1").hasValue());
+  EXPECT_FALSE(literals.find("user-agent").hasValue());
+  EXPECT_FALSE(literals.find("GET").hasValue());
+
+  // Forwarded with one header changed, the block is what encoding it from
+  // scratch gives
+  headers[4][1] = "10.0.0.1, 10.0.0.2";
+  vector<Header> forwarded = headersFromArray(headers);
+  HPACKCodec relay{TransportDirection::UPSTREAM};
+  HPACKCodec reference{TransportDirection::UPSTREAM};
+  auto relayed = relay.encode(forwarded, &literals);
+  auto expected = reference.encode(forwarded);
+  EXPECT_TRUE(folly::IOBufEqualTo()(*relayed, *expected));
+  EXPECT_EQ(relay.getEncodedSize().compressed,
+            reference.getEncodedSize().compressed);
+
+  // The recorded bytes are copied, not checked against the literal
+  HuffmanLiterals copied;
+  std::string bytes("\x01\x02\x03");
+  copied.add("10.0.0.1", ByteRange((const uint8_t*)bytes.data(), 3));
+  HPACKCodec copier{TransportDirection::UPSTREAM};
+  auto block = copier.encode(req, &copied);
+  EXPECT_NE(StringPiece(block->coalesce()).find("\x83\x01\x02\x03"),
+            std::string::npos);
+}
 
 class HPACKQueueTests : public testing::TestWithParam<int> {
  public:
@@ -14,9 +14,13 @@
 #include <proxygen/lib/http/codec/compress/HPACKContext.h>
 #include <proxygen/lib/http/codec/compress/HPACKDecoder.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncoder.h>
+#include <proxygen/lib/http/codec/compress/HeaderValueInternTable.h>
 #include <proxygen/lib/http/codec/compress/QPACKDecoder.h>
 #include <proxygen/lib/http/codec/compress/QPACKEncoder.h>
+#include <proxygen/lib/http/codec/compress/QPACKStaticHeaderTable.h>
 #include <proxygen/lib/http/codec/compress/Logging.h>
+#include <proxygen/lib/http/codec/compress/StaticBlockCache.h>
+#include <proxygen/lib/http/codec/compress/test/TestStreamingCallback.h>
 #include <proxygen/lib/http/codec/compress/test/TestUtil.h>
 
 using namespace folly;
@@ -79,7 +83,7 @@ TEST_F(HPACKContextTests, StaticTable) {
 
 TEST_F(HPACKContextTests, StaticTableHeaderNamesAreCommon) {
   auto& table = StaticHeaderTable::get();
-  for (std::pair<HPACKHeaderName, std::list<uint32_t>> entry : table.names()) {
+  for (const auto& entry : table.names()) {
     EXPECT_TRUE(entry.first.isCommonHeader());
   }
 }
@@ -96,6 +100,33 @@ TEST_F(HPACKContextTests,
   }
 }
 
+TEST_F(HPACKContextTests, StaticTableLookups) {
+  for (auto table : { &StaticHeaderTable::get(),
+                      &QPACKStaticHeaderTable::get() }) {
+    for (uint32_t i = 1; i <= table->size(); ++i) {
+      const HPACKHeader& header = table->getHeader(i);
+      EXPECT_EQ(table->getIndex(header), table->HeaderTable::getIndex(header));
+      EXPECT_EQ(table->nameIndex(header.name),
+                table->HeaderTable::nameIndex(header.name));
+    }
+    HPACKHeader status(":status", "299");
+    EXPECT_EQ(table->getIndex(status), 0);
+    auto index = table->nameIndex(status.name);
+    EXPECT_EQ(table->getHeader(index).name.get(), ":status");
+    // Common, but in neither table
+    EXPECT_EQ(table->nameIndex(HPACKHeaderName("x-forwarded-proto")), 0);
+  }
+
+  // Names outside of HTTPCommonHeaders
+  HPACKHeader purpose("purpose", "prefetch");
+  EXPECT_EQ(StaticHeaderTable::get().getIndex(purpose), 0);
+  auto& qpackTable = QPACKStaticHeaderTable::get();
+  auto index = qpackTable.getIndex(purpose);
+  EXPECT_EQ(qpackTable.getHeader(index), purpose);
+  EXPECT_EQ(qpackTable.nameIndex(purpose.name), index);
+  EXPECT_EQ(qpackTable.nameIndex(HPACKHeaderName("x-custom")), 0);
+}
+
 TEST_F(HPACKContextTests, StaticIndex) {
   TestContext context(HPACK::kTableSize);
   HPACKHeader authority(":authority", "");
@@ -124,6 +155,171 @@ TEST_F(HPACKContextTests, EncoderMultipleValues) {
   EXPECT_GT(encoded2->computeChainDataLength(), 0);
 }
 
+TEST_F(HPACKContextTests, EncodeCache) {
+  HPACKEncoder encoder(true);
+  HPACKDecoder decoder;
+  encoder.setEncodeCacheSize(4);
+  vector<HPACKHeader> resp;
+  resp.push_back(HPACKHeader(":status", "200"));
+  resp.push_back(HPACKHeader("content-type", "text/plain"));
+  resp.push_back(HPACKHeader("server", "proxygen"));
+
+  // the first encoding adds to the table, so it is not remembered
+  auto encoded = encoder.encode(resp);
+  EXPECT_EQ(encoder.lastEncodeCacheHit(), false);
+  EXPECT_EQ(*hpack::decode(decoder, encoded.get()), resp);
+  auto encoded2 = encoder.encode(resp);
+  EXPECT_EQ(encoder.lastEncodeCacheHit(), false);
+  EXPECT_EQ(*hpack::decode(decoder, encoded2.get()), resp);
+
+  // only indexed references now, re-sent from the cache
+  auto encoded3 = encoder.encode(resp, 9);
+  EXPECT_EQ(encoder.lastEncodeCacheHit(), true);
+  EXPECT_EQ(encoded3->headroom(), 9);
+  EXPECT_TRUE(IOBufEqualTo()(*encoded2, *encoded3));
+  EXPECT_EQ(*hpack::decode(decoder, encoded3.get()), resp);
+
+  // a table change shifts the indices and invalidates the entry
+  vector<HPACKHeader> other;
+  other.push_back(HPACKHeader("x-other", "1"));
+  auto otherEncoded = encoder.encode(other);
+  EXPECT_EQ(*hpack::decode(decoder, otherEncoded.get()), other);
+  auto encoded4 = encoder.encode(resp);
+  EXPECT_EQ(encoder.lastEncodeCacheHit(), false);
+  EXPECT_FALSE(IOBufEqualTo()(*encoded2, *encoded4));
+  EXPECT_EQ(*hpack::decode(decoder, encoded4.get()), resp);
+  encoder.encode(resp);
+  EXPECT_EQ(encoder.lastEncodeCacheHit(), true);
+
+  EXPECT_EQ(encoder.getEncodeCacheHits(), 2);
+  EXPECT_EQ(encoder.getEncodeCacheMisses(), 4);
+
+  encoder.setEncodeCacheSize(0);
+  encoder.encode(resp);
+  EXPECT_FALSE(encoder.lastEncodeCacheHit().hasValue());
+}
+
+TEST_F(HPACKContextTests, StaticBlockCache) {
+  StaticBlockCache::get().clear();
+  HPACKEncoder encoder1(true);
+  HPACKEncoder encoder2(true);
+  HPACKDecoder decoder;
+  encoder1.setUseStaticBlockCache(true);
+  encoder2.setUseStaticBlockCache(true);
+  vector<HPACKHeader> resp;
+  resp.push_back(HPACKHeader(":status", "200"));
+  resp.push_back(HPACKHeader("accept-encoding", "gzip, deflate"));
+
+  auto encoded1 = encoder1.encode(resp);
+  EXPECT_EQ(StaticBlockCache::get().size(), 1);
+  EXPECT_EQ(*hpack::decode(decoder, encoded1.get()), resp);
+  // another connection of the thread gets the same bytes
+  auto encoded2 = encoder2.encode(resp, 5);
+  EXPECT_EQ(encoded2->headroom(), 5);
+  EXPECT_TRUE(IOBufEqualTo()(*encoded1, *encoded2));
+  EXPECT_EQ(*hpack::decode(decoder, encoded2.get()), resp);
+
+  // literals depend on the connection's table, they are not shared
+  vector<HPACKHeader> other;
+  other.push_back(HPACKHeader(":status", "200"));
+  other.push_back(HPACKHeader("server", "proxygen"));
+  encoder1.encode(other);
+  EXPECT_EQ(StaticBlockCache::get().size(), 1);
+
+  // nor are blocks from encoders with a pending table size update
+  HPACKEncoder encoder3(true);
+  HPACKDecoder decoder3;
+  encoder3.setUseStaticBlockCache(true);
+  encoder3.setHeaderTableSize(1024);
+  auto encoded3 = encoder3.encode(resp);
+  EXPECT_FALSE(IOBufEqualTo()(*encoded1, *encoded3));
+  EXPECT_EQ(*hpack::decode(decoder3, encoded3.get()), resp);
+  StaticBlockCache::get().clear();
+}
+
+namespace {
+
+class InterningCallback : public TestStreamingCallback {
+ public:
+  void onInternedHeader(
+      const folly::fbstring& name,
+      const HeaderValueInternTable::Handle& value) override {
+    interned.push_back(value);
+    TestStreamingCallback::onInternedHeader(name, value);
+  }
+
+  vector<HeaderValueInternTable::Handle> interned;
+};
+
+vector<HeaderValueInternTable::Handle> decodeInterned(HPACKDecoder& decoder,
+                                                      const IOBuf* buffer) {
+  InterningCallback cb;
+  io::Cursor cursor(buffer);
+  decoder.decodeStreaming(cursor, cursor.totalLength(), &cb);
+  EXPECT_FALSE(cb.hasError());
+  return std::move(cb.interned);
+}
+
+}
+
+TEST_F(HPACKContextTests, HeaderValueInternTable) {
+  EXPECT_EQ(HeaderValueInternTable::get(), nullptr);
+  HeaderValueInternTable::setMaxEntries(2);
+  auto table = HeaderValueInternTable::get();
+  ASSERT_NE(table, nullptr);
+  table->clear();
+
+  auto gzip = table->intern("gzip");
+  EXPECT_EQ(table->intern("gzip"), gzip);
+  string cookie(HeaderValueInternTable::kMaxValueLength + 1, 'c');
+  auto longValue = table->intern(cookie);
+  EXPECT_NE(table->intern(cookie), longValue);
+  EXPECT_EQ(table->size(), 1);
+
+  // once full the table starts over, the handles given out stay valid
+  table->intern("br");
+  table->intern("deflate");
+  EXPECT_EQ(table->size(), 1);
+  EXPECT_NE(table->intern("gzip"), gzip);
+  EXPECT_EQ(*gzip, "gzip");
+
+  table->clear();
+  HeaderValueInternTable::setMaxEntries(0);
+}
+
+TEST_F(HPACKContextTests, InternIndexedValues) {
+  HeaderValueInternTable::setMaxEntries(16);
+  HeaderValueInternTable::get()->clear();
+  vector<HPACKHeader> req;
+  req.push_back(HPACKHeader(":method", "GET"));
+  req.push_back(HPACKHeader("accept-encoding", "gzip, deflate, br"));
+  // two connections of the thread
+  HPACKEncoder encoder1(true);
+  HPACKEncoder encoder2(true);
+  HPACKDecoder decoder1;
+  HPACKDecoder decoder2;
+
+  // the first block inserts accept-encoding, a literal is not interned
+  auto interned = decodeInterned(decoder1, encoder1.encode(req).get());
+  ASSERT_EQ(interned.size(), 1);
+  EXPECT_EQ(*interned[0], "GET");
+  decodeInterned(decoder2, encoder2.encode(req).get());
+
+  auto interned1 = decodeInterned(decoder1, encoder1.encode(req).get());
+  auto interned2 = decodeInterned(decoder2, encoder2.encode(req).get());
+  ASSERT_EQ(interned1.size(), 2);
+  ASSERT_EQ(interned2.size(), 2);
+  EXPECT_EQ(*interned1[1], "gzip, deflate, br");
+  EXPECT_EQ(interned1[0], interned2[0]);
+  EXPECT_EQ(interned1[1], interned2[1]);
+
+  // callbacks that don't keep the handle decode the same headers
+  EXPECT_EQ(*hpack::decode(decoder1, encoder1.encode(req).get()), req);
+
+  HeaderValueInternTable::get()->clear();
+  HeaderValueInternTable::setMaxEntries(0);
+}
+
 TEST_F(HPACKContextTests, DecoderLargeHeader) {
   // with this size basically the table will not be able to store any entry
   uint32_t size = 32;
@@ -7,11 +7,13 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/Conv.h>
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/codec/compress/HPACKHeader.h>
 
 #include <glog/logging.h>
 
+#include <proxygen/lib/http/codec/compress/AdaptiveIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
 #include <sstream>
 
@@ -68,6 +70,35 @@ TEST_F(HPACKHeaderTests, HeaderIndexingStrategyBasic) {
   EXPECT_TRUE(indexingStrat.indexHeader(data));
 }
 
+TEST_F(HPACKHeaderTests, AdaptiveIndexingStrategy) {
+  AdaptiveIndexingStrategy indexingStrat;
+  HPACKHeaderName requestId("x-request-id");
+  HPACKHeaderName userAgent("user-agent");
+  // indexed while there is too little to go on
+  for (uint32_t i = 0; i < AdaptiveIndexingStrategy::kMinSamples - 1; i++) {
+    HPACKHeader id("x-request-id", folly::to<std::string>(i));
+    EXPECT_TRUE(indexingStrat.indexHeader(id));
+    EXPECT_TRUE(indexingStrat.indexHeader(HPACKHeader("user-agent", "pxy")));
+  }
+  EXPECT_FALSE(indexingStrat.indexHeader(HPACKHeader("x-request-id", "a")));
+  EXPECT_TRUE(indexingStrat.indexHeader(HPACKHeader("user-agent", "pxy")));
+  EXPECT_EQ(indexingStrat.getReuseRate(requestId), 0);
+  EXPECT_GT(indexingStrat.getReuseRate(userAgent), 0.8);
+  EXPECT_EQ(indexingStrat.getReuseRate(HPACKHeaderName("x-other")), -1);
+  EXPECT_FALSE(indexingStrat.indexHeader(HPACKHeader("x-request-id", "42")));
+  EXPECT_EQ(indexingStrat.getSuppressed(), 2);
+
+  // the base strategy still applies
+  EXPECT_FALSE(indexingStrat.indexHeader(HPACKHeader("content-length", "1")));
+
+  // a name whose values start repeating is indexed again
+  bool indexed = false;
+  for (uint32_t i = 0; i < 2 * AdaptiveIndexingStrategy::kDecayInterval; i++) {
+    indexed = indexingStrat.indexHeader(HPACKHeader("x-request-id", "42"));
+  }
+  EXPECT_TRUE(indexed);
+}
+
 class HPACKHeaderNameTest : public testing::Test {
 };
 
@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/Conv.h>
 #include <folly/portability/GTest.h>
 #include <memory>
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
@@ -172,8 +173,7 @@ TEST_F(HeaderTableTests, IncreaseCapacity) {
   EXPECT_LE(table.length(), table.getMaxTableLength(capacity));
 
   // fill the table
-  uint32_t length = table.length() + 1;
-  for (size_t i = 0; i < length; i++) {
+  for (size_t i = 0; i < max; i++) {
     EXPECT_EQ(table.add(accept.copy()), true);
   }
   EXPECT_EQ(table.size(), max);
@@ -299,7 +299,7 @@ TEST_F(HeaderTableTests, IncreaseLengthOfFullTable) {
   HPACKHeader smallHeader("Accept", "All-Content");
 
   HeaderTable table(448);
-  CHECK_EQ(table.length(), 7);
+  CHECK_EQ(table.length(), 0);
 
   for (uint8_t count = 0; count < 3; count++) {
     table.add(largeHeader.copy());
@@ -323,6 +323,57 @@ TEST_F(HeaderTableTests, IncreaseLengthOfFullTable) {
   CHECK_EQ(table.getHeader(8), smallHeader);
 }
 
+TEST_F(HeaderTableTests, NameChainAfterResize) {
+  // Same layout as above, but with distinct values to check the name chains
+  // are rewired when the wrapped part of the table moves
+  HPACKHeader largeHeader("Access-Control-Allow-Credentials", "true");
+  HeaderTable table(448);
+  std::vector<HPACKHeader> smalls;
+  for (int i = 0; i < 6; i++) {
+    smalls.emplace_back("Accept", folly::to<std::string>("Content-", i));
+  }
+  for (uint8_t count = 0; count < 3; count++) {
+    table.add(largeHeader.copy());
+    table.add(smalls[count].copy());
+  }
+  table.add(smalls[3].copy());
+  table.add(smalls[4].copy());
+  table.add(smalls[5].copy()); // resize on this add
+  EXPECT_EQ(table.length(), 11);
+
+  EXPECT_EQ(table.names().find(smalls[0].name)->second.size(), 6);
+  for (int i = 0; i < 6; i++) {
+    EXPECT_EQ(table.getIndex(smalls[i]), i < 3 ? 8 - i * 2 : 6 - i);
+  }
+  EXPECT_EQ(table.nameIndex(smalls[0].name), 1);
+  EXPECT_EQ(table.getIndex(largeHeader), 5);
+
+  // Evicting everything empties the chains
+  table.setCapacity(0);
+  EXPECT_EQ(table.size(), 0);
+  EXPECT_EQ(table.names().size(), 0);
+}
+
+TEST_F(HeaderTableTests, LazyAllocation) {
+  // Nothing is allocated until the first entry
+  HeaderTable table(4096);
+  EXPECT_EQ(table.length(), 0);
+  EXPECT_EQ(table.memoryUsage(), 0);
+  HPACKHeader foo("Foo", "bar");
+  EXPECT_EQ(table.getIndex(foo), 0);
+  EXPECT_TRUE(table.setCapacity(8192));
+  EXPECT_EQ(table.length(), 0);
+
+  EXPECT_TRUE(table.add(foo.copy()));
+  EXPECT_EQ(table.length(), table.getMaxTableLength(8192) / 2);
+  EXPECT_EQ(table.getIndex(foo), 1);
+
+  // Even a table too small for 64 bytes gets its slot
+  HeaderTable tiny(40);
+  EXPECT_TRUE(tiny.add(foo.copy()));
+  EXPECT_EQ(tiny.length(), 1);
+}
+
 TEST_F(HeaderTableTests, SmallTable) {
   HeaderTable table(80);
   HPACKHeader foo("Foo", "bar");
@@ -332,4 +383,49 @@ TEST_F(HeaderTableTests, SmallTable) {
   EXPECT_EQ(table.length(), 2);
 }
 
+TEST_F(HeaderTableTests, ShrinkToFit) {
+  // 36 bytes each, alternating between two names
+  auto header = [] (int i) {
+    return HPACKHeader(i % 2 ? "x-b" : "x-a", folly::to<string>(i));
+  };
+  HeaderTable table(4 * 36);
+  for (int i = 0; i < 7; i++) {
+    EXPECT_TRUE(table.add(header(i)));
+  }
+  EXPECT_EQ(table.length(), 4);
+  // Keep 4, 5 and 6, wrapped around the end of the ring
+  table.setCapacity(3 * 36);
+  EXPECT_EQ(table.size(), 3);
+  auto bytes = table.memoryUsage();
+
+  table.shrinkToFit();
+  EXPECT_EQ(table.length(), 3);
+  EXPECT_LT(table.memoryUsage(), bytes);
+  for (int i = 4; i < 7; i++) {
+    EXPECT_EQ(table.getIndex(header(i)), 7 - i);
+  }
+  EXPECT_EQ(table.nameIndex(header(0).name), 1);
+  EXPECT_EQ(table.nameIndex(header(1).name), 2);
+
+  // Grows again, evicting in order
+  table.setCapacity(4 * 36);
+  EXPECT_TRUE(table.add(header(7)));
+  EXPECT_TRUE(table.add(header(8)));
+  EXPECT_EQ(table.size(), 4);
+  for (int i = 5; i < 9; i++) {
+    EXPECT_EQ(table.getIndex(header(i)), 9 - i);
+  }
+  EXPECT_EQ(table.getIndex(header(4)), 0);
+  EXPECT_EQ(table.names().find(header(0).name)->second.size(), 2);
+  EXPECT_EQ(table.names().find(header(1).name)->second.size(), 2);
+
+  // An empty table releases all its slots
+  table.setCapacity(0);
+  table.shrinkToFit();
+  EXPECT_EQ(table.length(), 0);
+  table.setCapacity(4 * 36);
+  EXPECT_TRUE(table.add(header(9)));
+  EXPECT_EQ(table.getIndex(header(9)), 1);
+}
+
 }
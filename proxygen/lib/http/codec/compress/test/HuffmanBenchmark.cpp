@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/codec/compress/Huffman.h>
+
+using namespace folly;
+using namespace proxygen;
+using namespace proxygen::huffman;
+
+// Huffman coding of header values of different shapes
+
+namespace {
+
+const fbstring kUserAgent(
+  "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_12_6) AppleWebKit/537.36 "
+  "(KHTML, like Gecko) Chrome/60.0.3100.0 Safari/537.36");
+
+const fbstring kCookie(
+  "datr=YmFzZTY0ZW5jb2RlZGNvb2tpZXZhbHVl; sb=AbCdEfGhIjKlMnOpQrStUvWx; "
+  "c_user=100001234567890; xs=28%3AaBcDeFgHiJkLmN%3A2%3A1512345678%3A12345");
+
+const fbstring kDate("Mon, 14 Oct 2026 12:34:56 GMT");
+
+// codes longer than the 12-bit decode table
+const fbstring kBinary(
+  "\x01\x7f\x80\x9c\xaa\xc3\xdf\xef\xff\x02\x10\x1f\x90\xb5\xe0\xfe");
+
+std::unique_ptr<IOBuf> encodeValue(const fbstring& value) {
+  IOBufQueue queue;
+  io::QueueAppender appender(&queue, 1024);
+  huffTree().encode(value, appender);
+  auto buf = queue.move();
+  buf->coalesce();
+  return buf;
+}
+
+void encodeBench(const fbstring& value, uint32_t iters) {
+  const auto& tree = huffTree();
+  IOBufQueue queue;
+  io::QueueAppender appender(&queue, 4000);
+  for (uint32_t i = 0; i < iters; i++) {
+    doNotOptimizeAway(tree.encode(value, appender));
+    if (queue.chainLength() > 64 * 1024) {
+      BENCHMARK_SUSPEND {
+        queue.move();
+      }
+    }
+  }
+}
+
+void decodeBench(const fbstring& value, uint32_t iters) {
+  const auto& tree = huffTree();
+  std::unique_ptr<IOBuf> encoded;
+  BENCHMARK_SUSPEND {
+    encoded = encodeValue(value);
+  }
+  fbstring decoded;
+  for (uint32_t i = 0; i < iters; i++) {
+    decoded.clear();
+    tree.decode(encoded->data(), encoded->length(), decoded);
+    doNotOptimizeAway(decoded.size());
+  }
+}
+
+}
+
+BENCHMARK(EncodeUserAgent, iters) {
+  encodeBench(kUserAgent, iters);
+}
+
+BENCHMARK(EncodeCookie, iters) {
+  encodeBench(kCookie, iters);
+}
+
+BENCHMARK(EncodeDate, iters) {
+  encodeBench(kDate, iters);
+}
+
+BENCHMARK(EncodeBinary, iters) {
+  encodeBench(kBinary, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecodeUserAgent, iters) {
+  decodeBench(kUserAgent, iters);
+}
+
+BENCHMARK(DecodeCookie, iters) {
+  decodeBench(kCookie, iters);
+}
+
+BENCHMARK(DecodeDate, iters) {
+  decodeBench(kDate, iters);
+}
+
+BENCHMARK(DecodeBinary, iters) {
+  decodeBench(kBinary, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -147,6 +147,27 @@ TEST_F(HuffmanTests, ExampleCom) {
   CHECK_EQ(example, decoded);
 }
 
+TEST_F(HuffmanTests, CanonicalEncoding) {
+  IOBufQueue bufQueue;
+  QueueAppender appender(&bufQueue, 512);
+  appender.ensure(512);
+
+  folly::fbstring example("www.example.com");
+  uint32_t size = tree_.encode(example, appender);
+  std::string encoded((const char*)bufQueue.front()->data(), size);
+  auto range = [] (const std::string& str) {
+    return ByteRange((const uint8_t*)str.data(), str.size());
+  };
+  EXPECT_TRUE(tree_.isCanonicalEncoding(example, range(encoded)));
+
+  // padding that is not all 1s, or trailing bytes
+  std::string padding = encoded;
+  padding.back() &= ~0x01;
+  EXPECT_FALSE(tree_.isCanonicalEncoding(example, range(padding)));
+  EXPECT_FALSE(tree_.isCanonicalEncoding(example, range(encoded + "\xff")));
+  EXPECT_FALSE(tree_.isCanonicalEncoding("www.example.org", range(encoded)));
+}
+
 TEST_F(HuffmanTests, UserAgent) {
   folly::fbstring user_agent(
     "Mozilla/5.0 (iPhone; CPU iPhone OS 7_0_4 like Mac OS X) AppleWebKit/537.51"
@@ -166,6 +187,31 @@ TEST_F(HuffmanTests, UserAgent) {
   CHECK_EQ(user_agent, decoded);
 }
 
+/*
+ * every character, with codes split at all offsets of the 32-bit words
+ * written by encode() and of the 12-bit decode table lookups
+ */
+TEST_F(HuffmanTests, RoundTripAllCharacters) {
+  for (uint32_t prefix = 0; prefix < 32; prefix++) {
+    folly::fbstring literal(prefix, 'e');
+    for (uint32_t ch = 0; ch < kTableSize; ch++) {
+      literal.push_back((char)ch);
+      literal.append("0a");
+    }
+    IOBufQueue bufQueue;
+    QueueAppender appender(&bufQueue, 512);
+    uint32_t size = tree_.encode(literal, appender);
+    EXPECT_EQ(size, tree_.getEncodeSize(literal));
+    auto encoded = bufQueue.move();
+    encoded->coalesce();
+    EXPECT_EQ(encoded->length(), size);
+
+    folly::fbstring decoded;
+    tree_.decode(encoded->data(), size, decoded);
+    EXPECT_EQ(literal, decoded);
+  }
+}
+
 /*
  * this test is verifying the CHECK for length at the end of huffman::encode()
  */
@@ -187,11 +187,46 @@ TEST_F(QPACKTests, TestWithQueue) {
   }
   // Skipping redundant table adds reduces the HOL block count
   EXPECT_EQ(server.getHolBlockCount(), 30);
+  EXPECT_EQ(server.getQueuedBlocks(), 0);
+  EXPECT_EQ(server.getQueuedBytes(), 0);
 
   EXPECT_GT(client.getCompressionInfo().egressHeadersStored_, 0);
   EXPECT_GT(server.getCompressionInfo().ingressHeadersStored_, 0);
 }
 
+TEST_F(QPACKTests, QueueMetrics) {
+  vector<Header> req = basicHeaders();
+  req.emplace_back(HTTP_HEADER_CONNECTION, "queued");
+  auto res1 = client.encode(req, 1);
+  auto res2 = client.encode(req, 2);
+  ASSERT_TRUE(res1.control);
+  TestStreamingCallback cb1;
+  TestStreamingCallback cb2;
+  auto len1 = res1.stream->computeChainDataLength();
+  auto len2 = res2.stream->computeChainDataLength();
+  server.decodeStreaming(1, std::move(res1.stream), len1, &cb1);
+  server.decodeStreaming(2, std::move(res2.stream), len2, &cb2);
+  EXPECT_EQ(server.getQueuedBlocks(), 2);
+  EXPECT_GT(server.getQueuedBytes(), 0);
+  EXPECT_LT(server.getQueuedBytes(), len1 + len2);
+  EXPECT_GT(server.getQueueMemory(), 0);
+
+  // A cancelled block gives its bytes back
+  auto queuedBytes = server.getQueuedBytes();
+  server.encodeCancelStream(2);
+  EXPECT_EQ(server.getQueuedBlocks(), 1);
+  EXPECT_LT(server.getQueuedBytes(), queuedBytes);
+
+  server.decodeEncoderStream(std::move(res1.control));
+  auto result = cb1.getResult();
+  EXPECT_TRUE(!result.hasError());
+  headersEq(req, result->headers);
+  EXPECT_EQ(server.getQueuedBlocks(), 0);
+  EXPECT_EQ(server.getQueuedBytes(), 0);
+  // The chunk is kept for the next blocked blocks
+  EXPECT_GT(server.getQueueMemory(), 0);
+}
+
 TEST_F(QPACKTests, HeaderCodecStats) {
   vector<vector<string>> headers = {
     {"Content-Length", "80"},
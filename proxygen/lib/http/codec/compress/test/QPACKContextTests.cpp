@@ -12,6 +12,7 @@
 #include <folly/portability/GTest.h>
 #include <folly/Format.h>
 #include <memory>
+#include <thread>
 #include <proxygen/lib/http/codec/compress/QPACKDecoder.h>
 #include <proxygen/lib/http/codec/compress/QPACKEncoder.h>
 #include <proxygen/lib/http/codec/compress/Logging.h>
@@ -192,6 +193,55 @@ TEST(QPACKContextTests, PostBaseNameIndexedLiteral) {
   verifyDecode(decoder, std::move(result), req);
 }
 
+TEST(QPACKContextTests, VulnerableBudget) {
+  QPACKEncoder encoder(false, 4096);
+  encoder.setMaxVulnerable(4);
+  EXPECT_EQ(encoder.getVulnerableBudget(), 4);
+  encoder.setVulnerableBudget(1);
+  EXPECT_EQ(encoder.getVulnerableBudget(), 1);
+
+  vector<HPACKHeader> req;
+  req.emplace_back("monkey", "banana");
+  // Within the budget, the insert is referenced at once
+  auto result = encoder.encode(req, 10, 1);
+  EXPECT_FALSE(stringInOutput(result.stream.get(), "banana"));
+  EXPECT_EQ(encoder.getVulnerableBlockCount(), 1);
+
+  // The next block is inserted but not referenced before its ack
+  req.clear();
+  req.emplace_back("banana", "monkey");
+  result = encoder.encode(req, 10, 2);
+  EXPECT_TRUE(stringInOutput(result.control.get(), "monkey"));
+  EXPECT_TRUE(stringInOutput(result.stream.get(), "monkey"));
+  EXPECT_EQ(encoder.getVulnerableBlockCount(), 1);
+
+  // No budget, no vulnerable references even with the peer's limit left
+  encoder.setVulnerableBudget(0);
+  req.clear();
+  req.emplace_back("apple", "orange");
+  result = encoder.encode(req, 10, 3);
+  EXPECT_TRUE(stringInOutput(result.stream.get(), "orange"));
+  EXPECT_EQ(encoder.getVulnerableBlockCount(), 1);
+}
+
+TEST(QPACKContextTests, HolBlockTime) {
+  QPACKEncoder encoder(false, 4096);
+  QPACKDecoder decoder(4096);
+  encoder.setMaxVulnerable(1);
+  vector<HPACKHeader> req;
+  req.emplace_back("monkey", "banana");
+  auto result = encoder.encode(req, 10, 1);
+  auto control = std::move(result.control);
+  auto done = verifyDecode(decoder, std::move(result), req);
+  EXPECT_FALSE(*done);
+  EXPECT_EQ(decoder.getHolBlockCount(), 1);
+  /* sleep override */ std::this_thread::sleep_for(
+    std::chrono::milliseconds(2));
+  decoder.decodeEncoderStream(std::move(control));
+  EXPECT_TRUE(*done);
+  EXPECT_GE(decoder.getHolBlockTime(), std::chrono::milliseconds(2));
+}
+
 TEST(QPACKContextTests, TestOutstandingListTooLong) {
   QPACKEncoder encoder(false, 4096);
   encoder.setMaxNumOutstandingBlocks(3);
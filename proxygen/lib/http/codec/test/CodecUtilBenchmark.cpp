@@ -0,0 +1,143 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <proxygen/lib/http/codec/CodecUtil.h>
+
+#include <iostream>
+
+using namespace folly;
+using namespace proxygen;
+
+// Validates the headers of a browser request and of a response, as the
+// HTTP/2 and HTTP/3 codecs do for each header they decode, with CodecUtil
+// and with the byte at a time loops it used before, kept here as Scalar.
+
+namespace {
+
+const std::vector<std::pair<std::string, std::string>> kHeaders{
+  {":method", "GET"},
+  {":scheme", "https"},
+  {":authority", "www.example.com"},
+  {":path", "/static/js/app.bundle.min.js?v=1a2b3c4d5e6f&locale=en_US"},
+  {"user-agent", "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_14_5) "
+                 "AppleWebKit/537.36 (KHTML, like Gecko) "
+                 "Chrome/75.0.3770.100 Safari/537.36"},
+  {"accept", "text/html,application/xhtml+xml,application/xml;q=0.9,"
+             "image/webp,image/apng,*/*;q=0.8"},
+  {"accept-encoding", "gzip, deflate, br"},
+  {"accept-language", "en-US,en;q=0.9"},
+  {"referer", "https://www.example.com/some/page/with/a/path?query=value"},
+  {"cookie", "session_id=8f14e45fceea167a5a36dedd4bea2543; "
+             "csrftoken=c9f0f895fb98ab9159f51fd0297e236d; "
+             "_ga=GA1.2.1234567890.1234567890; "
+             "preferences=%7B%22theme%22%3A%22dark%22%7D"},
+  {":status", "200"},
+  {"content-type", "application/javascript; charset=utf-8"},
+  {"content-length", "48213"},
+  {"cache-control", "public, max-age=31536000, immutable"},
+  {"date", "Mon, 01 Jul 2019 12:00:00 GMT"},
+  {"etag", "\"5d1a2b3c-bc55\""},
+  {"x-content-type-options", "nosniff"},
+  {"strict-transport-security", "max-age=31536000; includeSubDomains"},
+};
+
+ByteRange range(const std::string& s) {
+  return ByteRange(StringPiece(s));
+}
+
+bool scalarValidateHeaderName(ByteRange name) {
+  if (name.size() == 0) {
+    return false;
+  }
+  for (auto p: name) {
+    if (p < 0x80 && CodecUtil::http_tokens[(uint8_t)p] != p) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Without the quoted escapes and LWS, which the corpus has none of
+bool scalarValidateHeaderValue(ByteRange value) {
+  for (auto p: value) {
+    if ((p < 0x20 || p == 0x7f) && p != '\t') {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool scalarValidateURL(ByteRange url) {
+  for (auto p: url) {
+    if (p <= 0x20 || p == 0x7f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}
+
+BENCHMARK(ScalarHeaders, iters) {
+  size_t valid = 0;
+  for (size_t i = 0; i < iters; i++) {
+    for (const auto& header : kHeaders) {
+      auto name = range(header.first);
+      valid += (name[0] == ':' || scalarValidateHeaderName(name)) &&
+        scalarValidateHeaderValue(range(header.second));
+    }
+  }
+  doNotOptimizeAway(valid);
+}
+
+BENCHMARK_RELATIVE(Headers, iters) {
+  size_t valid = 0;
+  for (size_t i = 0; i < iters; i++) {
+    for (const auto& header : kHeaders) {
+      auto name = range(header.first);
+      valid += (name[0] == ':' || CodecUtil::validateHeaderName(name)) &&
+        CodecUtil::validateHeaderValue(range(header.second),
+                                       CodecUtil::STRICT);
+    }
+  }
+  doNotOptimizeAway(valid);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(ScalarURL, iters) {
+  size_t valid = 0;
+  for (size_t i = 0; i < iters; i++) {
+    valid += scalarValidateURL(range(kHeaders[3].second));
+    valid += scalarValidateURL(range(kHeaders[8].second));
+  }
+  doNotOptimizeAway(valid);
+}
+
+BENCHMARK_RELATIVE(URL, iters) {
+  size_t valid = 0;
+  for (size_t i = 0; i < iters; i++) {
+    valid += CodecUtil::validateURL(range(kHeaders[3].second));
+    valid += CodecUtil::validateURL(range(kHeaders[8].second));
+  }
+  doNotOptimizeAway(valid);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  size_t bytes = 0;
+  for (const auto& header : kHeaders) {
+    bytes += header.first.size() + header.second.size();
+  }
+  std::cout << kHeaders.size() << " headers, " << bytes << " bytes"
+            << std::endl;
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/codec/CodecUtil.h>
+
+using namespace proxygen;
+
+namespace {
+folly::ByteRange range(const std::string& s) {
+  return folly::ByteRange(folly::StringPiece(s));
+}
+}
+
+// Each length covers short inputs, whole 16 byte blocks and the overlapping
+// or scalar tails, with the bad byte at every position
+TEST(CodecUtilTest, ValidateEveryPosition) {
+  for (size_t len = 1; len <= 40; len++) {
+    std::string url(len, '/');
+    std::string method(len, 'G');
+    std::string name(len, 'x');
+    std::string value(len, 'v');
+    EXPECT_TRUE(CodecUtil::validateURL(range(url)));
+    EXPECT_TRUE(CodecUtil::validateMethod(range(method)));
+    EXPECT_TRUE(CodecUtil::validateHeaderName(range(name)));
+    EXPECT_TRUE(CodecUtil::validateHeaderValue(range(value),
+                                               CodecUtil::STRICT));
+    for (size_t i = 0; i < len; i++) {
+      auto badURL = url;
+      badURL[i] = ' ';
+      EXPECT_FALSE(CodecUtil::validateURL(range(badURL))) << len << " " << i;
+      auto badMethod = method;
+      badMethod[i] = '1';
+      EXPECT_FALSE(CodecUtil::validateMethod(range(badMethod)))
+        << len << " " << i;
+      auto badName = name;
+      badName[i] = 'X';
+      EXPECT_FALSE(CodecUtil::validateHeaderName(range(badName)))
+        << len << " " << i;
+      auto badValue = value;
+      badValue[i] = '\x01';
+      EXPECT_FALSE(CodecUtil::validateHeaderValue(range(badValue),
+                                                  CodecUtil::STRICT))
+        << len << " " << i;
+    }
+  }
+}
+
+TEST(CodecUtilTest, ValidateTokensAndValues) {
+  // Other tokens and non-ASCII bytes in blocks of common name characters
+  EXPECT_TRUE(CodecUtil::validateHeaderName(
+                range("x-forwarded-for-proxy!#$%&'*+.^_`|~")));
+  EXPECT_TRUE(CodecUtil::validateHeaderName(
+                range("x-custom-header-\xc3\xa9t\xc3\xa9")));
+  EXPECT_FALSE(CodecUtil::validateHeaderName(range("x-custom-header-name:")));
+  EXPECT_FALSE(CodecUtil::validateHeaderName(range("")));
+
+  // The state machine resumes the fast path after quotes and LWS
+  EXPECT_TRUE(CodecUtil::validateHeaderValue(
+                range("text/html; charset=\"utf-8\"\r\n  more text follows"),
+                CodecUtil::STRICT));
+  EXPECT_FALSE(CodecUtil::validateHeaderValue(
+                 range("a value long enough for a block\r\nno LWS"),
+                 CodecUtil::STRICT));
+  EXPECT_FALSE(CodecUtil::validateHeaderValue(
+                 range("a value long enough for a block\r"),
+                 CodecUtil::STRICT));
+  EXPECT_TRUE(CodecUtil::validateHeaderValue(
+                range("\"a quoted \\\x01 escape in a long value\""),
+                CodecUtil::COMPLIANT));
+  EXPECT_FALSE(CodecUtil::validateHeaderValue(
+                 range("\"a quoted \\\x01 escape in a long value\""),
+                 CodecUtil::STRICT));
+  EXPECT_TRUE(CodecUtil::validateHeaderValue(
+                range("caf\xc3\xa9 au lait with a\ttab, and more"),
+                CodecUtil::STRICT));
+}
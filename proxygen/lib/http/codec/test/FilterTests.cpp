@@ -12,7 +12,10 @@
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/HTTPMessage.h>
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
+#include <proxygen/lib/http/codec/FrameTraceFilter.h>
+#include <proxygen/lib/http/codec/FusedHTTPCodecFilter.h>
 #include <proxygen/lib/http/codec/HTTPChecks.h>
+#include <proxygen/lib/http/codec/TrafficCaptureFilter.h>
 #include <proxygen/lib/http/codec/test/MockHTTPCodec.h>
 #include <proxygen/lib/http/codec/test/TestUtils.h>
 #include <random>
@@ -49,11 +52,22 @@ class FilterTest : public testing::Test {
   folly::IOBufQueue writeBuf_{folly::IOBufQueue::cacheChainLength()};
 };
 
-class HTTPChecksTest: public FilterTest {
+// With HTTPChecks on its own, or fused into a FlowControlFilter
+class HTTPChecksTest: public FilterTest,
+                      public testing::WithParamInterface<bool> {
  public:
   void SetUp() override {
-    chain_.add<HTTPChecks>();
+    if (GetParam()) {
+      EXPECT_CALL(*codec_, getDefaultWindowSize())
+        .WillRepeatedly(Return(kInitialCapacity));
+      chain_.addFilters(std::make_unique<
+        FusedHTTPCodecFilter<FlowControlFilter, HTTPChecks>>(
+          flowCallback_, writeBuf_, codec_));
+    } else {
+      chain_.add<HTTPChecks>();
+    }
   }
+  StrictMock<MockFlowControlCallback> flowCallback_;
 };
 
 template <int initSize>
@@ -96,6 +110,25 @@ class FlowControlFilterTest: public FilterTest {
   int recvWindow_{initSize};
 };
 
+class FrameTraceTest: public FilterTest {
+ public:
+  void SetUp() override {
+    filter_ = new FrameTraceFilter(3);
+    chain_.addFilters(std::unique_ptr<FrameTraceFilter>(filter_));
+  }
+  FrameTraceFilter* filter_;
+};
+
+class TrafficCaptureTest: public FilterTest {
+ public:
+  void SetUp() override {
+    filter_ = new TrafficCaptureFilter(nullptr, CodecProtocol::HTTP_2,
+                                       TransportDirection::DOWNSTREAM);
+    chain_.addFilters(std::unique_ptr<TrafficCaptureFilter>(filter_));
+  }
+  TrafficCaptureFilter* filter_;
+};
+
 using DefaultFlowControl = FlowControlFilterTest<0>;
 using BigWindow = FlowControlFilterTest<1000000>;
 
@@ -176,6 +209,35 @@ TEST_F(BigWindow, RecvTooMuch) {
   ASSERT_FALSE(chain_->isReusable());
 }
 
+TEST_F(BigWindow, ShrinkWindow) {
+  InSequence enforceSequence;
+  EXPECT_CALL(callback_, onBody(_, _, _))
+    .WillRepeatedly(Return());
+
+  filter_->shrinkReceiveWindowSize(recvWindow_ / 2);
+  ASSERT_EQ(filter_->getReceiveWindowCapacity(), recvWindow_);
+
+  // The first half of the window processed is withheld, the rest is acked
+  // once it exceeds half the new capacity
+  callbackStart_->onBody(1, makeBuf(recvWindow_ * 6 / 10), 0);
+  ASSERT_FALSE(filter_->ingressBytesProcessed(writeBuf_,
+                                              recvWindow_ * 6 / 10));
+  ASSERT_EQ(filter_->getReceiveWindowCapacity(), recvWindow_ / 2);
+
+  // The peer can still send what it was granted
+  callbackStart_->onBody(1, makeBuf(recvWindow_ * 4 / 10), 0);
+  ASSERT_TRUE(chain_->isReusable());
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, recvWindow_ * 3 / 10));
+  ASSERT_TRUE(filter_->ingressBytesProcessed(writeBuf_,
+                                             recvWindow_ * 2 / 10));
+
+  // Growing cancels a pending shrink
+  filter_->shrinkReceiveWindowSize(recvWindow_ / 4);
+  filter_->setReceiveWindowSize(writeBuf_, recvWindow_ / 2);
+  ASSERT_FALSE(filter_->ingressBytesProcessed(writeBuf_, 1));
+  ASSERT_EQ(filter_->getReceiveWindowCapacity(), recvWindow_ / 2);
+}
+
 TEST_F(BigWindow, RemoteIncrease) {
   // The remote side sends us a window update for stream=0, increasing our
   // available window
@@ -212,7 +274,7 @@ TEST_F(BigWindow, RemoteIncrease) {
   ASSERT_FALSE(chain_->isReusable());
 }
 
-TEST_F(HTTPChecksTest, SendTraceBodyDeath) {
+TEST_P(HTTPChecksTest, SendTraceBodyDeath) {
   // It is NOT allowed to send a TRACE with a body.
 
   HTTPMessage msg = getPostRequest();
@@ -221,7 +283,7 @@ TEST_F(HTTPChecksTest, SendTraceBodyDeath) {
   EXPECT_DEATH_NO_CORE(chain_->generateHeader(writeBuf_, 0, msg), ".*");
 }
 
-TEST_F(HTTPChecksTest, SendGetBody) {
+TEST_P(HTTPChecksTest, SendGetBody) {
   // It is allowed to send a GET with a content-length. It is up to the
   // server to ignore it.
 
@@ -233,7 +295,7 @@ TEST_F(HTTPChecksTest, SendGetBody) {
   chain_->generateHeader(writeBuf_, 0, msg);
 }
 
-TEST_F(HTTPChecksTest, RecvTraceBody) {
+TEST_P(HTTPChecksTest, RecvTraceBody) {
   // In proxygen, we deal with receiving a TRACE with a body by 400'ing it
 
   EXPECT_CALL(callback_, onError(_, _, _))
@@ -252,3 +314,134 @@ TEST_F(HTTPChecksTest, RecvTraceBody) {
 
   callbackStart_->onHeadersComplete(0, std::move(msg));
 }
+
+TEST_P(HTTPChecksTest, RecvPostBody) {
+  EXPECT_CALL(callback_, onHeadersComplete(1, _));
+
+  callbackStart_->onHeadersComplete(1, makePostRequest());
+}
+
+INSTANTIATE_TEST_CASE_P(FilterTest,
+                        HTTPChecksTest,
+                        Values(false, true));
+
+TEST_F(FrameTraceTest, RecordsLastFrames) {
+  EXPECT_CALL(callback_, onFrameHeader(1, 0x4, 20, 1, 0));
+  EXPECT_CALL(*codec_, generateBody(_, 1, _, _, true))
+    .WillOnce(Return(109));
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, 1000))
+    .WillOnce(Return(13));
+  EXPECT_CALL(*codec_, generatePingReply(_, 5))
+    .WillOnce(Return(17));
+  EXPECT_CALL(*codec_, getProtocol())
+    .WillRepeatedly(Return(CodecProtocol::HTTP_2));
+
+  // HEADERS with END_HEADERS
+  callbackStart_->onFrameHeader(1, 0x4, 20, 1, 0);
+  chain_->generateBody(writeBuf_, 1, makeBuf(100), HTTPCodec::NoPadding,
+                       true);
+  chain_->generateWindowUpdate(writeBuf_, 0, 1000);
+  EXPECT_EQ(filter_->getRecords().size(), 3);
+  // overwrites the oldest record
+  chain_->generatePingReply(writeBuf_, 5);
+
+  EXPECT_EQ(filter_->getNumFramesSeen(), 4);
+  auto records = filter_->getRecords();
+  ASSERT_EQ(records.size(), 3);
+  EXPECT_EQ(records[0].direction, FrameTraceRecord::EGRESS);
+  EXPECT_EQ(records[0].type, uint8_t(http2::FrameType::DATA));
+  EXPECT_EQ(records[0].streamID, 1);
+  EXPECT_EQ(records[0].length, 109);
+  EXPECT_EQ(records[0].flags, http2::END_STREAM);
+  EXPECT_EQ(records[1].type, uint8_t(http2::FrameType::WINDOW_UPDATE));
+  EXPECT_EQ(records[1].streamID, 0);
+  EXPECT_EQ(records[2].type, uint8_t(http2::FrameType::PING));
+  EXPECT_EQ(records[2].flags, http2::ACK);
+  EXPECT_LE(records[0].timestampUs, records[2].timestampUs);
+
+  // round trips through dump
+  auto dump = filter_->dump();
+  CodecProtocol protocol;
+  std::vector<FrameTraceRecord> decoded;
+  ASSERT_TRUE(FrameTraceFilter::decode(dump->coalesce(), protocol, decoded));
+  EXPECT_EQ(protocol, CodecProtocol::HTTP_2);
+  ASSERT_EQ(decoded.size(), records.size());
+  for (size_t i = 0; i < decoded.size(); i++) {
+    EXPECT_EQ(FrameTraceFilter::toString(decoded[i], protocol),
+              FrameTraceFilter::toString(records[i], protocol));
+  }
+  auto line = FrameTraceFilter::toString(decoded[1], protocol);
+  EXPECT_NE(line.find("OUT WINDOW_UPDATE stream=0 length=13 flags=0x00"),
+            std::string::npos);
+
+  auto truncated = dump->coalesce();
+  truncated.pop_back();
+  EXPECT_FALSE(FrameTraceFilter::decode(truncated, protocol, decoded));
+}
+
+TEST_F(TrafficCaptureTest, CapturesMessages) {
+  EXPECT_CALL(callback_, onHeadersComplete(1, _))
+    .WillOnce(Invoke([] (HTTPCodec::StreamID,
+                         std::shared_ptr<HTTPMessage> msg) {
+          // The session still gets the credentials
+          EXPECT_EQ(msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_COOKIE),
+                    "secret");
+        }));
+  EXPECT_CALL(callback_, onBody(1, _, _));
+  EXPECT_CALL(callback_, onMessageComplete(1, false));
+  EXPECT_CALL(*codec_, generateHeader(_, 1, _, false, _));
+  EXPECT_CALL(*codec_, generateBody(_, 1, _, _, true))
+    .WillOnce(Return(109));
+
+  auto req = std::make_unique<HTTPMessage>(getPostRequest(10));
+  req->getHeaders().add(HTTP_HEADER_COOKIE, "secret");
+  callbackStart_->onHeadersComplete(1, std::move(req));
+  callbackStart_->onBody(1, makeBuf(10), 0);
+  callbackStart_->onMessageComplete(1, false);
+  chain_->generateHeader(writeBuf_, 1, getResponse(200, 100), false,
+                         nullptr);
+  chain_->generateBody(writeBuf_, 1, makeBuf(100), HTTPCodec::NoPadding,
+                       true);
+
+  const auto& session = filter_->getSession();
+  EXPECT_EQ(session.protocol, CodecProtocol::HTTP_2);
+  EXPECT_FALSE(session.truncated);
+  ASSERT_EQ(session.events.size(), 6);
+  EXPECT_EQ(session.events[0].type, CapturedEvent::HEADERS);
+  EXPECT_EQ(session.events[0].direction, CapturedEvent::INGRESS);
+  ASSERT_TRUE(session.events[0].msg);
+  EXPECT_EQ(session.events[0].msg->getHeaders().getSingleOrEmpty(
+              HTTP_HEADER_COOKIE), "xxxxxx");
+  EXPECT_EQ(session.events[1].type, CapturedEvent::BODY);
+  EXPECT_EQ(session.events[1].length, 10);
+  EXPECT_EQ(session.events[2].type, CapturedEvent::EOM);
+  EXPECT_EQ(session.events[3].direction, CapturedEvent::EGRESS);
+  EXPECT_EQ(session.events[3].msg->getStatusCode(), 200);
+  EXPECT_EQ(session.events[4].length, 100);
+  EXPECT_EQ(session.events[5].type, CapturedEvent::EOM);
+  EXPECT_LE(session.events[0].offsetUs, session.events[5].offsetUs);
+
+  // round trips through the capture format, one session after another
+  folly::IOBufQueue capture{folly::IOBufQueue::cacheChainLength()};
+  TrafficCaptureWriter::serialize(session, capture);
+  TrafficCaptureWriter::serialize(session, capture);
+  auto data = capture.move();
+  std::vector<CapturedSession> decoded;
+  ASSERT_TRUE(TrafficCaptureWriter::decode(data->coalesce(), decoded));
+  ASSERT_EQ(decoded.size(), 2);
+  EXPECT_EQ(decoded[1].startUs, session.startUs);
+  ASSERT_EQ(decoded[1].events.size(), session.events.size());
+  for (size_t i = 0; i < session.events.size(); i++) {
+    EXPECT_EQ(decoded[1].events[i].type, session.events[i].type);
+    EXPECT_EQ(decoded[1].events[i].length, session.events[i].length);
+    EXPECT_EQ(decoded[1].events[i].offsetUs, session.events[i].offsetUs);
+  }
+  EXPECT_EQ(decoded[1].events[0].msg->getURL(), "/");
+  EXPECT_EQ(decoded[1].events[0].msg->getHeaders().getSingleOrEmpty(
+              HTTP_HEADER_COOKIE), "xxxxxx");
+
+  auto truncated = data->coalesce();
+  truncated.pop_back();
+  decoded.clear();
+  EXPECT_FALSE(TrafficCaptureWriter::decode(truncated, decoded));
+}
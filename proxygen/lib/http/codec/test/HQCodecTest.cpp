@@ -210,6 +210,20 @@ TEST_F(HQCodecTest, DataFrame) {
   EXPECT_EQ(callbacks_.bodyLength, data->length());
 }
 
+TEST_F(HQCodecTest, DataFramesCoalesced) {
+  // DATA frames parsed together are passed on in one onBody
+  auto data = makeBuf(500);
+  for (auto i = 0; i < 3; i++) {
+    writeFrameHeaderManual(
+        queue_, static_cast<uint64_t>(FrameType::DATA), data->length());
+    queue_.append(data->clone());
+  }
+  parse();
+  EXPECT_EQ(callbacks_.headerFrames, 3);
+  EXPECT_EQ(callbacks_.bodyCalls, 1);
+  EXPECT_EQ(callbacks_.bodyLength, data->length() * 3);
+}
+
 TEST_F(HQPRCodecTest, DataFrameZeroLength) {
   const auto& ingressPrBodyTracker =
       downstreamCodec_->getIngressPrBodyTracker();
@@ -853,6 +867,33 @@ TEST_F(HQCodecTest, MultipleSettingsDownstream) {
   EXPECT_EQ(callbacks_.sessionErrors, 1);
 }
 
+TEST_F(HQCodecTest, PriorityFrame) {
+  writeValidFrame(queueCtrl_, FrameType::SETTINGS);
+  writePriority(queueCtrl_,
+                {PriorityElementType::REQUEST_STREAM,
+                 PriorityElementType::TREE_ROOT,
+                 false, // exclusive
+                 8,     // prioritizedElementId
+                 0,     // elementDependencyId
+                 30});  // weight
+  parseControl(CodecType::CONTROL_DOWNSTREAM);
+  EXPECT_EQ(callbacks_.headerFrames, 2);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+  EXPECT_EQ(callbacks_.priority,
+            HTTPMessage::HTTPPriority(kSessionStreamId, false, 30));
+
+  writePriority(queueCtrl_,
+                {PriorityElementType::REQUEST_STREAM,
+                 PriorityElementType::REQUEST_STREAM,
+                 true, // exclusive
+                 12,   // prioritizedElementId
+                 8,    // elementDependencyId
+                 200}); // weight
+  parseControl(CodecType::CONTROL_DOWNSTREAM);
+  EXPECT_EQ(callbacks_.headerFrames, 3);
+  EXPECT_EQ(callbacks_.priority, HTTPMessage::HTTPPriority(8, true, 200));
+}
+
 struct FrameAllowedParams {
   CodecType codecType;
   FrameType frameType;
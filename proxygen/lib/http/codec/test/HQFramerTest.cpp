@@ -84,6 +84,24 @@ TEST_F(HQFramerTest, TestWriteUnframedBytes) {
             queue_.front()->clone()->moveToFbString().toStdString());
 }
 
+TEST_F(HQFramerTest, WriteDataInHeadroom) {
+  auto data = IOBuf::create(100);
+  data->advance(kMaxFrameHeaderSize);
+  memset(data->writableData(), 'a', 64);
+  data->append(64);
+  auto payload = data.get();
+  auto res = writeData(queue_, std::move(data));
+  EXPECT_FALSE(res.hasError());
+  EXPECT_EQ(*res, 66);
+  // The header is in the payload's buffer
+  EXPECT_EQ(queue_.front(), payload);
+  EXPECT_EQ(queue_.front()->countChainElements(), 1);
+
+  IOBufQueue expected{IOBufQueue::cacheChainLength()};
+  writeData(expected, IOBuf::copyBuffer(std::string(64, 'a')));
+  EXPECT_TRUE(IOBufEqualTo()(queue_.front(), expected.front()));
+}
+
 TEST_F(HQFramerTest, DataFrameZeroLength) {
   writeFrameHeaderManual(
       queue_, static_cast<uint64_t>(proxygen::hq::FrameType::DATA), 0);
@@ -506,7 +524,13 @@ INSTANTIATE_TEST_CASE_P(
            (SettingsValuesParams){hq::SettingId::HEADER_TABLE_SIZE, 0, true},
            (SettingsValuesParams){hq::SettingId::HEADER_TABLE_SIZE,
                                   std::numeric_limits<uint32_t>::max(),
-                                  true}));
+                                  true},
+           (SettingsValuesParams){hq::SettingId::H3_DATAGRAM, 1, true},
+           (SettingsValuesParams){hq::SettingId::H3_DATAGRAM, 2, false},
+           (SettingsValuesParams){
+               hq::SettingId::ENABLE_CONNECT_PROTOCOL, 1, true},
+           (SettingsValuesParams){
+               hq::SettingId::ENABLE_CONNECT_PROTOCOL, 2, false}));
 
 TEST_F(HQFramerTest, SettingsFrameEmpty) {
   const deque<hq::SettingPair> settings = {};
@@ -567,6 +591,35 @@ TEST_F(HQFramerTest, SettingsFrameUnknownId) {
   ASSERT_TRUE(outSettings.empty());
 }
 
+TEST_F(HQFramerTest, Datagram) {
+  auto res = writeDatagram(queue_, 400, IOBuf::copyBuffer("datagram"));
+  ASSERT_FALSE(res.hasError());
+  // Quarter stream ID 100 takes 2 bytes
+  EXPECT_EQ(*res, 2 + 8);
+  auto buf = queue_.move();
+  folly::io::Cursor cursor(buf.get());
+  quic::StreamId streamId;
+  EXPECT_EQ(parseDatagram(cursor, streamId), folly::none);
+  EXPECT_EQ(streamId, 400);
+  EXPECT_EQ(cursor.readFixedString(cursor.totalLength()), "datagram");
+
+  // Empty payloads are allowed
+  res = writeDatagram(queue_, 0, nullptr);
+  ASSERT_FALSE(res.hasError());
+  EXPECT_EQ(*res, 1);
+  buf = queue_.move();
+  cursor.reset(buf.get());
+  EXPECT_EQ(parseDatagram(cursor, streamId), folly::none);
+  EXPECT_EQ(streamId, 0);
+  EXPECT_EQ(cursor.totalLength(), 0);
+
+  // Truncated quarter stream ID
+  auto truncated = IOBuf::copyBuffer("\x40");
+  cursor.reset(truncated.get());
+  EXPECT_EQ(parseDatagram(cursor, streamId),
+            HTTP3::ErrorCode::HTTP_DATAGRAM_ERROR);
+}
+
 TEST_F(HQFramerTest, DecoratedPushIds) {
   PushId testId = 10000;
   PushId internalTestId = testId | kPushIdMask;
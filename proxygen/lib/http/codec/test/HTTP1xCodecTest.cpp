@@ -452,6 +452,45 @@ TEST(HTTP1xCodecTest, Test1xxConnectionHeader) {
     "keep-alive");
 }
 
+TEST(HTTP1xCodecTest, TestEarlyHints) {
+  for (auto minor : {0, 1}) {
+    HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+    HTTP1xCodecCallback callbacks;
+    codec.setCallback(&callbacks);
+    auto txnID = codec.createStream();
+    auto reqBuf = folly::IOBuf::copyBuffer(folly::to<string>(
+        "GET / HTTP/1.", minor, "\r\nHost: www.facebook.com\r\n\r\n"));
+    codec.onIngress(*reqBuf);
+    EXPECT_EQ(callbacks.headersComplete, 1);
+
+    HTTPMessage hints;
+    hints.setHTTPVersion(1, 1);
+    hints.setStatusCode(103);
+    hints.setStatusMessage("Early Hints");
+    hints.getHeaders().add(HTTP_HEADER_LINK, "</a.css>; rel=preload");
+    folly::IOBufQueue respBuf(folly::IOBufQueue::cacheChainLength());
+    codec.generateHeader(respBuf, txnID, hints);
+    if (minor == 0) {
+      // HTTP/1.0 clients get no 1xx
+      EXPECT_TRUE(respBuf.empty());
+    } else {
+      auto respStr = respBuf.move()->moveToFbString();
+      EXPECT_EQ(respStr.find("HTTP/1.1 103 Early Hints\r\n"), 0);
+      EXPECT_NE(respStr.find("Link: </a.css>; rel=preload\r\n"),
+                string::npos);
+    }
+
+    // The final response goes out either way
+    HTTPMessage resp;
+    resp.setHTTPVersion(1, 1);
+    resp.setStatusCode(200);
+    resp.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH, "0");
+    codec.generateHeader(respBuf, txnID, resp, true);
+    auto respStr = respBuf.move()->moveToFbString();
+    EXPECT_EQ(respStr.find("HTTP/1.1 200"), 0);
+  }
+}
+
 TEST(HTTP1xCodecTest, TestChainedBody) {
   HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
   MockHTTPCodecCallback callbacks;
@@ -481,6 +520,58 @@ TEST(HTTP1xCodecTest, TestChainedBody) {
                                   *folly::IOBuf::copyBuffer("abcdefghij")));
 }
 
+namespace {
+
+class BatchCountingCallback : public FakeHTTPCodecCallback {
+ public:
+  void onMessage(HTTPCodec::StreamID stream,
+                 std::unique_ptr<HTTPMessage> msg,
+                 std::unique_ptr<folly::IOBuf> body) override {
+    batches++;
+    FakeHTTPCodecCallback::onMessage(stream, std::move(msg), std::move(body));
+  }
+
+  uint32_t batches{0};
+};
+
+}
+
+TEST(HTTP1xCodecTest, TestBatchedSmallBody) {
+  HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+  BatchCountingCallback callbacks;
+  codec.setCallback(&callbacks);
+
+  // The whole request in one read goes in one batch, the body cloned
+  auto reqBuf = folly::IOBuf::copyBuffer(
+      "POST /a HTTP/1.1\r\nHost: www.test.com\r\n"
+      "Content-Length: 5\r\n\r\nabcde");
+  codec.onIngress(*reqBuf);
+  EXPECT_EQ(callbacks.batches, 1);
+  EXPECT_EQ(callbacks.headersComplete, 1);
+  EXPECT_EQ(callbacks.bodyCalls, 1);
+  EXPECT_EQ(callbacks.bodyLength, 5);
+  EXPECT_EQ(callbacks.messageComplete, 1);
+  EXPECT_TRUE(reqBuf->isShared());
+
+  // Split across reads, the headers don't wait for the rest of the body
+  codec.onIngress(*folly::IOBuf::copyBuffer(
+      "POST /b HTTP/1.1\r\nHost: www.test.com\r\n"
+      "Content-Length: 5\r\n\r\nab"));
+  EXPECT_EQ(callbacks.headersComplete, 2);
+  EXPECT_EQ(callbacks.bodyCalls, 2);
+  codec.onIngress(*folly::IOBuf::copyBuffer("cde"));
+  EXPECT_EQ(callbacks.batches, 1);
+  EXPECT_EQ(callbacks.bodyCalls, 3);
+  EXPECT_EQ(callbacks.messageComplete, 2);
+
+  // No body, nothing to batch
+  codec.onIngress(*folly::IOBuf::copyBuffer(
+      "GET /c HTTP/1.1\r\nHost: www.test.com\r\n\r\n"));
+  EXPECT_EQ(callbacks.batches, 1);
+  EXPECT_EQ(callbacks.headersComplete, 3);
+  EXPECT_EQ(callbacks.messageComplete, 3);
+}
+
 TEST(HTTP1xCodecTest, TestIgnoreUpstreamUpgrade) {
   HTTP1xCodec codec(TransportDirection::UPSTREAM);
   FakeHTTPCodecCallback callbacks;
@@ -703,6 +794,53 @@ TEST(HTTP1xCodecTest, TestChunkResponseSerialization) {
   EXPECT_TRUE(upCallbacks.trailers_->exists("X-Test-Trailer"));
 }
 
+TEST(HTTP1xCodecTest, TestHeaderTemplate) {
+  HTTPHeaders common;
+  common.add(HTTP_HEADER_SERVER, "proxygen");
+  common.add(HTTP_HEADER_CONTENT_TYPE, "text/plain");
+  auto tmpl = HTTPHeaderTemplate::create(common);
+  ASSERT_NE(tmpl, nullptr);
+  const auto& block = tmpl->getHTTP1xBlock();
+  EXPECT_EQ(std::string((const char*)block.data(), block.length()),
+            "Server: proxygen\r\nContent-Type: text/plain\r\n");
+
+  HTTPHeaders framing;
+  framing.add(HTTP_HEADER_CONTENT_LENGTH, "5");
+  EXPECT_EQ(HTTPHeaderTemplate::create(framing), nullptr);
+
+  HTTPMessage resp;
+  resp.setHTTPVersion(1, 1);
+  resp.setStatusCode(200);
+  resp.setHeaderTemplate(tmpl);
+  resp.getHeaders().add("X-Custom-Header", "mac&cheese");
+  resp.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH, "0");
+
+  folly::IOBufQueue blob{folly::IOBufQueue::cacheChainLength()};
+  HTTP1xCodec downCodec = HTTP1xCodec::makeResponseCodec(
+      /*mayChunkEgress=*/true);
+  HTTPHeaderSize size;
+  downCodec.generateHeader(blob, downCodec.createStream(), resp, true, &size);
+  EXPECT_EQ(size.uncompressed, blob.chainLength());
+
+  HTTP1xCodec upCodec(TransportDirection::UPSTREAM);
+  HTTP1xCodecCallback upCallbacks;
+  upCodec.setCallback(&upCallbacks);
+  auto tmpBuf = blob.move();
+  while (tmpBuf) {
+    auto next = tmpBuf->pop();
+    upCodec.onIngress(*tmpBuf);
+    tmpBuf = std::move(next);
+  }
+
+  EXPECT_EQ(upCallbacks.headersComplete, 1);
+  EXPECT_EQ(upCallbacks.errors, 0);
+  const auto& headers = upCallbacks.msg_->getHeaders();
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_SERVER), "proxygen");
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE), "text/plain");
+  EXPECT_EQ(headers.getSingleOrEmpty("X-Custom-Header"), "mac&cheese");
+  EXPECT_TRUE(headers.exists(HTTP_HEADER_DATE));
+}
+
 TEST(HTTP1xCodecTest, TestHeaderValueWhiteSpaces) {
   HTTP1xCodecCallback callbacks;
   auto buf = folly::IOBuf::copyBuffer(
@@ -717,6 +855,26 @@ TEST(HTTP1xCodecTest, TestHeaderValueWhiteSpaces) {
   EXPECT_EQ(headers.getSingleOrEmpty("X-FB-HEADER"), "yay");
 }
 
+TEST(HTTP1xCodecTest, TestHeaderValueSplitAcrossIngress) {
+  HTTP1xCodecCallback callbacks;
+  HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+  codec.setCallback(&callbacks);
+
+  auto buf1 = folly::IOBuf::copyBuffer(
+      "GET / HTTP/1.1\r\nHost: www.face");
+  auto buf2 = folly::IOBuf::copyBuffer(
+      "book.com \r\nX-Folded: one\r\n two\r\nX-Empty:\r\n\r\n");
+  codec.onIngress(*buf1);
+  buf1.reset();
+  codec.onIngress(*buf2);
+  EXPECT_EQ(callbacks.headersComplete, 1);
+  const auto& headers = callbacks.msg_->getHeaders();
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_HOST), "www.facebook.com");
+  EXPECT_EQ(headers.getSingleOrEmpty("X-Folded"), "one two");
+  EXPECT_TRUE(headers.exists("X-Empty"));
+  EXPECT_EQ(headers.getSingleOrEmpty("X-Empty"), "");
+}
+
 class ConnectionHeaderTest:
     public TestWithParam<std::pair<std::list<string>, string>> {
  public:
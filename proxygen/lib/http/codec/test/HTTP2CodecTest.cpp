@@ -709,6 +709,25 @@ TEST_F(HTTP2CodecTest, BasicContinuationEndStream) {
   EXPECT_EQ(callbacks_.sessionErrors, 0);
 }
 
+TEST_F(HTTP2CodecTest, HeaderListSizeBeforeContinuation) {
+  HTTPMessage req = getGetRequest();
+  // Small once compressed, too large once decoded
+  for (int i = 0; i < 20000; i++) {
+    req.getHeaders().add("x-repeated", "same value");
+  }
+  auto prefaceSize = output_.chainLength();
+  upstreamCodec_.generateHeader(output_, 1, req);
+  // Only the HEADERS frame: the block is decoded, and fails, as it arrives
+  output_.trimEnd(output_.chainLength() - prefaceSize -
+                  http2::kFrameHeaderSize - http2::kMaxFramePayloadLengthMin);
+
+  parse();
+  EXPECT_EQ(callbacks_.messageBegin, 0);
+  EXPECT_EQ(callbacks_.headersComplete, 0);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 1);
+}
+
 TEST_F(HTTP2CodecTest, BadContinuation) {
   // CONTINUATION with no preceding HEADERS
   auto fakeHeaders = makeBuf(5);
@@ -1032,6 +1051,29 @@ TEST_F(HTTP2CodecTest, BasicWindow) {
   EXPECT_EQ(callbacks_.sessionErrors, 0);
 }
 
+TEST_F(HTTP2CodecTest, MergedWindowUpdates) {
+  upstreamCodec_.generateWindowUpdate(output_, 1, 10);
+  upstreamCodec_.generateWindowUpdate(output_, 3, 5);
+  upstreamCodec_.generateWindowUpdate(output_, 0, 7);
+  upstreamCodec_.generatePingRequest(output_);
+  upstreamCodec_.generateWindowUpdate(output_, 1, 20);
+  upstreamCodec_.generateWindowUpdate(output_, 0, 8);
+  // Another frame of the stream delivers its updates so far
+  upstreamCodec_.generateWindowUpdate(output_, 5, 1);
+  upstreamCodec_.generatePriority(output_, 5,
+                                  HTTPMessage::HTTPPriority(0, false, 1));
+  upstreamCodec_.generateWindowUpdate(output_, 5, 2);
+
+  parse();
+  EXPECT_EQ(callbacks_.windowUpdateCalls, 5);
+  EXPECT_EQ(callbacks_.windowUpdates[0], std::vector<uint32_t>({15}));
+  EXPECT_EQ(callbacks_.windowUpdates[1], std::vector<uint32_t>({30}));
+  EXPECT_EQ(callbacks_.windowUpdates[3], std::vector<uint32_t>({5}));
+  EXPECT_EQ(callbacks_.windowUpdates[5], std::vector<uint32_t>({1, 2}));
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
 TEST_F(HTTP2CodecTest, ZeroWindow) {
   auto streamID = HTTPCodec::StreamID(1);
   // First generate a frame with delta=1 so as to pass the checks, and then
@@ -1761,6 +1803,27 @@ TEST_F(HTTP2CodecTest, WebsocketUpgrade) {
   EXPECT_EQ(headers::kWebsocketString, *callbacks_.msg->getUpgradeProtocol());
 }
 
+TEST_F(HTTP2CodecTest, ExtendedConnect) {
+  const std::string kPath{"/.well-known/masque/udp/192.0.2.6/443/"};
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::CONNECT);
+  req.setURL(kPath);
+  req.setSecure(true);
+  req.setUpgradeProtocol("connect-udp");
+  req.getHeaders().add(HTTP_HEADER_HOST, "proxy.example");
+
+  upstreamCodec_.generateHeader(output_, 1, req, false);
+  parse();
+
+  callbacks_.expectMessage(false, 1, kPath);
+  EXPECT_EQ(HTTPMethod::CONNECT, callbacks_.msg->getMethod());
+  EXPECT_FALSE(callbacks_.msg->isIngressWebsocketUpgrade());
+  ASSERT_NE(nullptr, callbacks_.msg->getUpgradeProtocol());
+  EXPECT_EQ("connect-udp", *callbacks_.msg->getUpgradeProtocol());
+  EXPECT_EQ("proxy.example",
+            callbacks_.msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST));
+}
+
 TEST_F(HTTP2CodecTest, WebsocketBadHeader) {
   const std::string kConnect{"CONNECT"};
   const std::string kWebsocketPath{"/websocket"};
@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/codec/HTTP2Framer.h>
+
+#include <iostream>
+
+using namespace folly;
+using namespace proxygen;
+using namespace proxygen::http2;
+
+// Compares one writeData() call per frame against DataFrameWriter for a
+// batch of DATA frames, each on its own stream, as HTTPSession produces when
+// many small responses are pending.
+
+namespace {
+
+const size_t kNumFrames = 64;
+
+std::unique_ptr<IOBuf> makePayload(size_t size) {
+  auto buf = IOBuf::create(size);
+  memset(buf->writableData(), 'a', size);
+  buf->append(size);
+  return buf;
+}
+
+size_t writeEach(IOBufQueue& queue, const IOBuf& payload) {
+  size_t written = 0;
+  for (uint32_t i = 0; i < kNumFrames; i++) {
+    written += writeData(queue, payload.clone(), i * 2 + 1, kNoPadding,
+                         true, true);
+  }
+  return written;
+}
+
+size_t writeBatch(IOBufQueue& queue, const IOBuf& payload) {
+  size_t written = 0;
+  DataFrameWriter writer(queue, kNumFrames);
+  for (uint32_t i = 0; i < kNumFrames; i++) {
+    written += writer.writeData(payload.clone(), i * 2 + 1, kNoPadding, true);
+  }
+  return written;
+}
+
+template <typename WriteFn>
+void writeBench(WriteFn fn, size_t payloadSize, int iters) {
+  std::unique_ptr<IOBuf> payload;
+  BENCHMARK_SUSPEND {
+    payload = makePayload(payloadSize);
+  }
+  for (int i = 0; i < iters; i++) {
+    IOBufQueue queue(IOBufQueue::cacheChainLength());
+    doNotOptimizeAway(fn(queue, *payload));
+    doNotOptimizeAway(queue.move());
+  }
+}
+
+template <typename WriteFn>
+size_t countIovecs(WriteFn fn, size_t payloadSize) {
+  IOBufQueue queue(IOBufQueue::cacheChainLength());
+  auto payload = makePayload(payloadSize);
+  fn(queue, *payload);
+  return queue.front()->countChainElements();
+}
+
+}
+
+BENCHMARK(WriteEach16, iters) {
+  writeBench(writeEach, 16, iters);
+}
+
+BENCHMARK_RELATIVE(WriteBatch16, iters) {
+  writeBench(writeBatch, 16, iters);
+}
+
+BENCHMARK(WriteEach200, iters) {
+  writeBench(writeEach, 200, iters);
+}
+
+BENCHMARK_RELATIVE(WriteBatch200, iters) {
+  writeBench(writeBatch, 200, iters);
+}
+
+BENCHMARK(WriteEach4k, iters) {
+  writeBench(writeEach, 4096, iters);
+}
+
+BENCHMARK_RELATIVE(WriteBatch4k, iters) {
+  writeBench(writeBatch, 4096, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  for (size_t size : {16, 200, 4096}) {
+    std::cout << kNumFrames << " frames of " << size << " bytes: "
+              << countIovecs(writeEach, size) << " iovecs with writeData(), "
+              << countIovecs(writeBatch, size)
+              << " iovecs with DataFrameWriter"
+              << std::endl;
+  }
+  folly::runBenchmarks();
+  return 0;
+}
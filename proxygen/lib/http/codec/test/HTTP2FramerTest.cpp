@@ -182,6 +182,54 @@ TEST_F(HTTP2FramerTest, UseHeadroomOptimization) {
   EXPECT_LT(queueNode->headroom(), headRoomSize);
 }
 
+TEST_F(HTTP2FramerTest, DataFrameWriterBatch) {
+  auto small = makeBuf(20);
+  auto large = makeBuf(1000);
+  {
+    DataFrameWriter writer(queue_, 4);
+    EXPECT_EQ(writer.writeData(small->clone(), 1, kNoPadding, false),
+              kFrameHeaderSize + 20);
+    EXPECT_EQ(writer.writeData(small->clone(), 3, Padding(5), true),
+              kFrameHeaderSize + 26);
+    EXPECT_EQ(writer.writeData(nullptr, 5, kNoPadding, true),
+              kFrameHeaderSize);
+    // Nothing is visible until flushed
+    EXPECT_EQ(queue_.chainLength(), 0);
+    writer.flush();
+    // Small frames share one buffer
+    EXPECT_EQ(queue_.front()->countChainElements(), 1);
+    writer.writeData(large->clone(), 7, Padding(3), false);
+    writer.writeData(small->clone(), 9, kNoPadding, true);
+  }
+  // header, large payload (uncopied), padding + last frame
+  EXPECT_EQ(queue_.front()->countChainElements(), 4);
+
+  Cursor cursor(queue_.front());
+  auto check = [&cursor] (uint32_t stream, IOBuf* body, uint16_t padLen,
+                          bool endStream) {
+    FrameHeader header;
+    std::unique_ptr<IOBuf> outBuf;
+    uint16_t padding = 0;
+    ASSERT_EQ(parseFrameHeader(cursor, header), ErrorCode::NO_ERROR);
+    ASSERT_EQ(parseData(cursor, header, outBuf, padding), ErrorCode::NO_ERROR);
+    EXPECT_EQ(header.type, FrameType::DATA);
+    EXPECT_EQ(header.stream, stream);
+    EXPECT_EQ(bool(header.flags & END_STREAM), endStream);
+    EXPECT_EQ(padding, padLen);
+    if (body) {
+      EXPECT_EQ(outBuf->moveToFbString(), body->clone()->moveToFbString());
+    } else {
+      EXPECT_EQ(outBuf->computeChainDataLength(), 0);
+    }
+  };
+  check(1, small.get(), 0, false);
+  check(3, small.get(), 6, true);
+  check(5, nullptr, 0, true);
+  check(7, large.get(), 4, false);
+  check(9, small.get(), 0, true);
+  EXPECT_TRUE(cursor.isAtEnd());
+}
+
 TEST_F(HTTP2FramerTest, BadStreamId) {
   // We should crash on DBG builds if the stream id > 2^31 - 1
   EXPECT_DEATH_NO_CORE(writeRstStream(queue_,
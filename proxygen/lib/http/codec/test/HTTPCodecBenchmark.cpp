@@ -0,0 +1,322 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+
+#include <iostream>
+
+using namespace folly;
+using namespace proxygen;
+
+// Feeds batches of requests and responses through HTTP1xCodec and HTTP2Codec
+// as a session would: parsing with onIngress() and generating with the
+// generate*() methods.  Each benchmark handles kBatch messages on one
+// connection, so the times are per message; main() prints the bytes per
+// message of each case to turn them into bytes/s.
+//
+// The cases are a browser GET and a small response, a 64KB response, the same
+// in 4KB chunks (as chunked encoding on HTTP/1.1, DATA frames on HTTP/2), and
+// requests with 20KB of cookies, which take a CONTINUATION frame on HTTP/2.
+// On HTTP/2 the batch is kBatch concurrent streams.
+
+namespace {
+
+const size_t kBatch = 100;
+const size_t kLargeBody = 64 * 1024;
+const size_t kChunkSize = 4096;
+
+enum class Case { SMALL, LARGE, CHUNKED, LARGE_HEADERS };
+
+// Counts what the codec parsed, so that none of it is optimized away
+class NullCallback : public HTTPCodec::Callback {
+ public:
+  void onMessageBegin(HTTPCodec::StreamID, HTTPMessage*) override {}
+  void onHeadersComplete(HTTPCodec::StreamID,
+                         std::unique_ptr<HTTPMessage> msg) override {
+    headers += msg->getHeaders().size();
+  }
+  void onBody(HTTPCodec::StreamID, std::unique_ptr<IOBuf> chain,
+              uint16_t) override {
+    bodyBytes += chain->computeChainDataLength();
+  }
+  void onTrailersComplete(HTTPCodec::StreamID,
+                          std::unique_ptr<HTTPHeaders>) override {}
+  void onMessageComplete(HTTPCodec::StreamID, bool) override {
+    messages++;
+  }
+  void onError(HTTPCodec::StreamID, const HTTPException& error,
+               bool) override {
+    LOG(FATAL) << "Parse error: " << error.what();
+  }
+
+  size_t headers{0};
+  size_t bodyBytes{0};
+  size_t messages{0};
+};
+
+HTTPMessage makeRequest(Case c) {
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::GET);
+  req.setHTTPVersion(1, 1);
+  req.setURL("/static/js/app.min.js?v=20190301");
+  auto& headers = req.getHeaders();
+  headers.add(HTTP_HEADER_HOST, "www.example.com");
+  headers.add(HTTP_HEADER_USER_AGENT,
+              "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+              "(KHTML, like Gecko) Chrome/72.0.3626.121 Safari/537.36");
+  headers.add(HTTP_HEADER_ACCEPT, "*/*");
+  headers.add(HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate, br");
+  headers.add(HTTP_HEADER_ACCEPT_LANGUAGE, "en-US,en;q=0.9");
+  headers.add(HTTP_HEADER_REFERER, "https://www.example.com/");
+  if (c == Case::LARGE_HEADERS) {
+    for (int i = 0; i < 20; i++) {
+      headers.add(HTTP_HEADER_COOKIE, folly::to<std::string>(
+                    "c", i, "=", std::string(1000, 'a' + i)));
+    }
+  } else {
+    headers.add(HTTP_HEADER_COOKIE, "session=8f14e45fceea167a5a36dedd4bea2543;"
+                " prefs=lang%3Den%26tz%3DUTC");
+  }
+  return req;
+}
+
+HTTPMessage makeResponse(Case c) {
+  HTTPMessage resp;
+  resp.setHTTPVersion(1, 1);
+  resp.setStatusCode(200);
+  resp.setStatusMessage("OK");
+  auto& headers = resp.getHeaders();
+  headers.add(HTTP_HEADER_DATE, "Fri, 01 Mar 2019 12:00:00 GMT");
+  headers.add(HTTP_HEADER_SERVER, "proxygen");
+  headers.add(HTTP_HEADER_CONTENT_TYPE, "application/javascript");
+  headers.add(HTTP_HEADER_CACHE_CONTROL, "public, max-age=31536000");
+  headers.add(HTTP_HEADER_LAST_MODIFIED, "Thu, 28 Feb 2019 08:00:00 GMT");
+  if (c == Case::CHUNKED) {
+    resp.setIsChunked(true);
+    headers.add(HTTP_HEADER_TRANSFER_ENCODING, "chunked");
+  } else {
+    headers.add(HTTP_HEADER_CONTENT_LENGTH,
+                folly::to<std::string>(c == Case::LARGE ? kLargeBody : 100));
+  }
+  return resp;
+}
+
+std::unique_ptr<IOBuf> makeBody(size_t size) {
+  auto buf = IOBuf::create(size);
+  memset(buf->writableData(), 'a', size);
+  buf->append(size);
+  return buf;
+}
+
+void generateResponse(HTTPCodec& codec, IOBufQueue& writeBuf,
+                      HTTPCodec::StreamID stream, const HTTPMessage& resp,
+                      const IOBuf& body, Case c) {
+  codec.generateHeader(writeBuf, stream, resp);
+  if (c == Case::CHUNKED) {
+    for (size_t sent = 0; sent < body.length(); sent += kChunkSize) {
+      codec.generateChunkHeader(writeBuf, stream, kChunkSize);
+      auto chunk = body.clone();
+      chunk->trimStart(sent);
+      chunk->trimEnd(chunk->length() - kChunkSize);
+      codec.generateBody(writeBuf, stream, std::move(chunk), folly::none,
+                         false);
+      codec.generateChunkTerminator(writeBuf, stream);
+    }
+    codec.generateEOM(writeBuf, stream);
+  } else {
+    codec.generateBody(writeBuf, stream, body.clone(), folly::none, true);
+  }
+}
+
+std::unique_ptr<IOBuf> makeBody(Case c) {
+  return makeBody(c == Case::SMALL || c == Case::LARGE_HEADERS ?
+                  100 : kLargeBody);
+}
+
+std::unique_ptr<HTTPCodec> makeCodec(bool h2, TransportDirection direction) {
+  if (h2) {
+    return std::make_unique<HTTP2Codec>(direction);
+  }
+  return std::make_unique<HTTP1xCodec>(direction);
+}
+
+/**
+ * A client codec writing kBatch requests, after the connection preface on
+ * HTTP/2.
+ */
+void generateRequests(HTTPCodec& client, IOBufQueue& writeBuf, Case c) {
+  auto req = makeRequest(c);
+  client.generateConnectionPreface(writeBuf);
+  client.generateSettings(writeBuf);
+  for (size_t i = 0; i < kBatch; i++) {
+    client.generateHeader(writeBuf, client.createStream(), req, true);
+  }
+}
+
+/**
+ * A server codec writing the responses to the requests of
+ * generateRequests(), which it parses first.
+ */
+void generateResponses(HTTPCodec& server, IOBufQueue& writeBuf,
+                       const std::vector<HTTPCodec::StreamID>& streams,
+                       Case c) {
+  auto resp = makeResponse(c);
+  auto body = makeBody(c);
+  server.generateSettings(writeBuf);
+  for (auto stream : streams) {
+    generateResponse(server, writeBuf, stream, resp, *body, c);
+  }
+}
+
+// Records the stream IDs of the requests a server codec parses
+class StreamCallback : public NullCallback {
+ public:
+  void onMessageBegin(HTTPCodec::StreamID stream, HTTPMessage*) override {
+    streams.push_back(stream);
+  }
+
+  std::vector<HTTPCodec::StreamID> streams;
+};
+
+std::unique_ptr<IOBuf> getRequests(bool h2, Case c) {
+  auto client = makeCodec(h2, TransportDirection::UPSTREAM);
+  IOBufQueue writeBuf(IOBufQueue::cacheChainLength());
+  generateRequests(*client, writeBuf, c);
+  return writeBuf.move();
+}
+
+std::unique_ptr<IOBuf> getResponses(bool h2, Case c) {
+  auto server = makeCodec(h2, TransportDirection::DOWNSTREAM);
+  StreamCallback callback;
+  server->setCallback(&callback);
+  server->onIngress(*getRequests(h2, c));
+  IOBufQueue writeBuf(IOBufQueue::cacheChainLength());
+  generateResponses(*server, writeBuf, callback.streams, c);
+  return writeBuf.move();
+}
+
+// Parses one batch per iteration, with a new codec for each
+void parse(bool h2, TransportDirection direction, Case c, int iters) {
+  std::unique_ptr<IOBuf> input;
+  BENCHMARK_SUSPEND {
+    input = direction == TransportDirection::DOWNSTREAM ?
+      getRequests(h2, c) : getResponses(h2, c);
+    // One contiguous buffer, as the session reads from the socket
+    input->coalesce();
+  }
+  for (int i = 0; i < iters; i++) {
+    std::unique_ptr<HTTPCodec> codec;
+    NullCallback callback;
+    BENCHMARK_SUSPEND {
+      codec = makeCodec(h2, direction);
+      codec->setCallback(&callback);
+      if (direction == TransportDirection::UPSTREAM) {
+        // Sends the requests the responses are to, as a session would
+        IOBufQueue requests(IOBufQueue::cacheChainLength());
+        generateRequests(*codec, requests, c);
+      }
+    }
+    codec->onIngress(*input);
+    CHECK_EQ(callback.messages, kBatch);
+    doNotOptimizeAway(callback.headers + callback.bodyBytes);
+    BENCHMARK_SUSPEND {
+      codec.reset();
+    }
+  }
+}
+
+void generateRequestsBench(bool h2, Case c, int iters) {
+  for (int i = 0; i < iters; i++) {
+    std::unique_ptr<HTTPCodec> codec;
+    BENCHMARK_SUSPEND {
+      codec = makeCodec(h2, TransportDirection::UPSTREAM);
+    }
+    IOBufQueue writeBuf(IOBufQueue::cacheChainLength());
+    generateRequests(*codec, writeBuf, c);
+    doNotOptimizeAway(writeBuf.move());
+    BENCHMARK_SUSPEND {
+      codec.reset();
+    }
+  }
+}
+
+void generateResponsesBench(bool h2, Case c, int iters) {
+  for (int i = 0; i < iters; i++) {
+    std::unique_ptr<HTTPCodec> codec;
+    StreamCallback callback;
+    BENCHMARK_SUSPEND {
+      // HTTP/1.x codecs answer the requests they parsed, in order
+      codec = makeCodec(h2, TransportDirection::DOWNSTREAM);
+      codec->setCallback(&callback);
+      codec->onIngress(*getRequests(h2, c));
+    }
+    IOBufQueue writeBuf(IOBufQueue::cacheChainLength());
+    generateResponses(*codec, writeBuf, callback.streams, c);
+    doNotOptimizeAway(writeBuf.move());
+    BENCHMARK_SUSPEND {
+      codec.reset();
+    }
+  }
+}
+
+}
+
+#define CODEC_BENCHMARKS(proto, h2, name, c)                              \
+  BENCHMARK_MULTI(proto##ParseRequests##name, iters) {                    \
+    parse(h2, TransportDirection::DOWNSTREAM, c, iters);                  \
+    return iters * kBatch;                                                \
+  }                                                                       \
+  BENCHMARK_MULTI(proto##GenerateRequests##name, iters) {                 \
+    generateRequestsBench(h2, c, iters);                                  \
+    return iters * kBatch;                                                \
+  }                                                                       \
+  BENCHMARK_MULTI(proto##ParseResponses##name, iters) {                   \
+    parse(h2, TransportDirection::UPSTREAM, c, iters);                    \
+    return iters * kBatch;                                                \
+  }                                                                       \
+  BENCHMARK_MULTI(proto##GenerateResponses##name, iters) {                \
+    generateResponsesBench(h2, c, iters);                                 \
+    return iters * kBatch;                                                \
+  }
+
+CODEC_BENCHMARKS(HTTP1x, false, Small, Case::SMALL)
+CODEC_BENCHMARKS(HTTP2, true, Small, Case::SMALL)
+BENCHMARK_DRAW_LINE();
+CODEC_BENCHMARKS(HTTP1x, false, Large, Case::LARGE)
+CODEC_BENCHMARKS(HTTP2, true, Large, Case::LARGE)
+BENCHMARK_DRAW_LINE();
+CODEC_BENCHMARKS(HTTP1x, false, Chunked, Case::CHUNKED)
+CODEC_BENCHMARKS(HTTP2, true, Chunked, Case::CHUNKED)
+BENCHMARK_DRAW_LINE();
+CODEC_BENCHMARKS(HTTP1x, false, LargeHeaders, Case::LARGE_HEADERS)
+CODEC_BENCHMARKS(HTTP2, true, LargeHeaders, Case::LARGE_HEADERS)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  const std::vector<std::pair<const char*, Case>> cases{
+    {"Small", Case::SMALL}, {"Large", Case::LARGE},
+    {"Chunked", Case::CHUNKED}, {"LargeHeaders", Case::LARGE_HEADERS}};
+  for (bool h2 : {false, true}) {
+    for (const auto& c : cases) {
+      std::cout << (h2 ? "HTTP2" : "HTTP1x") << " " << c.first
+                << ": " << getRequests(h2, c.second)->computeChainDataLength() /
+                     kBatch
+                << " bytes/request, "
+                << getResponses(h2, c.second)->computeChainDataLength() /
+                     kBatch
+                << " bytes/response" << std::endl;
+    }
+  }
+  folly::runBenchmarks();
+  return 0;
+}
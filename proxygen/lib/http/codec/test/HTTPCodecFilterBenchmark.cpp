@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/codec/FlowControlFilter.h>
+#include <proxygen/lib/http/codec/FusedHTTPCodecFilter.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/codec/HTTPChecks.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// The cost of the codec filter chain HTTPSession sets up for HTTP/2, per
+// frame callback: HTTPChecks and FlowControlFilter as two filters, as on a
+// connection upgraded from HTTP/1.1, against the two fused into one.  The
+// frames are empty DATA frames handed to the chain as the codec would, so
+// what is measured is the dispatch through the filters.
+
+namespace {
+
+const size_t kNumFrames = 1000;
+
+// Exposes the callback the chain installed, where the codec calls it
+class BenchCodec : public HTTP2Codec {
+ public:
+  BenchCodec() : HTTP2Codec(TransportDirection::DOWNSTREAM) {}
+
+  HTTPCodec::Callback* getCallback() const {
+    return callback_;
+  }
+};
+
+class NoopFlowControlCallback : public FlowControlFilter::Callback {
+ public:
+  void onConnectionSendWindowOpen() override {}
+  void onConnectionSendWindowClosed() override {}
+};
+
+// Hands each body back for the next frame
+class BodySink : public FakeHTTPCodecCallback {
+ public:
+  void onBody(HTTPCodec::StreamID /*stream*/,
+              std::unique_ptr<IOBuf> chain,
+              uint16_t /*padding*/) override {
+    body = std::move(chain);
+  }
+
+  std::unique_ptr<IOBuf> body{IOBuf::create(0)};
+};
+
+template <typename AddFiltersFn>
+void onBodyBench(AddFiltersFn addFilters, int iters) {
+  NoopFlowControlCallback flowCallback;
+  BodySink sink;
+  IOBufQueue writeBuf(IOBufQueue::cacheChainLength());
+  HTTPCodec::Callback* callback = nullptr;
+  std::unique_ptr<HTTPCodecFilterChain> chain;
+  BENCHMARK_SUSPEND {
+    auto codec = new BenchCodec();
+    chain = std::make_unique<HTTPCodecFilterChain>(
+      std::unique_ptr<HTTPCodec>(codec));
+    addFilters(*chain, flowCallback, writeBuf, codec);
+    chain->setCallback(&sink);
+    callback = codec->getCallback();
+  }
+  for (int i = 0; i < iters; i++) {
+    for (size_t j = 0; j < kNumFrames; j++) {
+      callback->onBody(1, std::move(sink.body), 0);
+    }
+  }
+  BENCHMARK_SUSPEND {
+    chain.reset();
+  }
+}
+
+void addDynamic(HTTPCodecFilterChain& chain,
+                FlowControlFilter::Callback& flowCallback,
+                IOBufQueue& writeBuf,
+                HTTPCodec* codec) {
+  chain.add<HTTPChecks>();
+  chain.addFilters(std::make_unique<FlowControlFilter>(
+    flowCallback, writeBuf, codec));
+}
+
+void addFused(HTTPCodecFilterChain& chain,
+              FlowControlFilter::Callback& flowCallback,
+              IOBufQueue& writeBuf,
+              HTTPCodec* codec) {
+  chain.addFilters(std::make_unique<
+    FusedHTTPCodecFilter<FlowControlFilter, HTTPChecks>>(
+      flowCallback, writeBuf, codec));
+}
+
+}
+
+BENCHMARK(DynamicChainOnBody, iters) {
+  onBodyBench(addDynamic, iters);
+}
+
+BENCHMARK_RELATIVE(FusedChainOnBody, iters) {
+  onBodyBench(addFused, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -541,6 +541,31 @@ TEST(SPDYCodecTest, SupportsSessionFlowControl) {
   EXPECT_TRUE(spdy3_1.supportsSessionFlowControl());
 }
 
+TEST(SPDYCodecTest, LazyCompressionContexts) {
+  // No zlib state until the first header block each way
+  SPDYCodec egressCodec(TransportDirection::UPSTREAM, SPDYVersion::SPDY3_1);
+  SPDYCodec ingressCodec(TransportDirection::DOWNSTREAM,
+                         SPDYVersion::SPDY3_1);
+  EXPECT_EQ(egressCodec.getMemoryUsage(), 0);
+  EXPECT_EQ(ingressCodec.getMemoryUsage(), 0);
+
+  HTTPMessage req = getGetRequest();
+  auto syn = getSynStream(egressCodec, egressCodec.createStream(), req);
+  auto egressBytes = egressCodec.getMemoryUsage();
+  EXPECT_GT(egressBytes, 0);
+
+  FakeHTTPCodecCallback callbacks;
+  ingressCodec.setCallback(&callbacks);
+  ingressCodec.onIngress(*syn);
+  EXPECT_EQ(callbacks.headersComplete, 1);
+  EXPECT_GT(ingressCodec.getMemoryUsage(), 0);
+  EXPECT_EQ(egressCodec.getMemoryUsage(), egressBytes);
+#if ZLIB_VERNUM >= 0x1235
+  // The inflate window is sized to the 2KB of the deflater's
+  EXPECT_EQ(ingressCodec.getMemoryUsage(), 7 * 1024 + 2 * 1024);
+#endif
+}
+
 // Test serializing and deserializing a header that has many values
 TEST(SPDYCodecTest, HeaderWithManyValues) {
   const std::string kMultiValued = "X-Multi-Valued";
@@ -0,0 +1,293 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/IOBuf.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/codec/WebSocketCodec.h>
+#include <vector>
+
+using namespace folly;
+using namespace proxygen;
+using namespace std;
+
+using Opcode = WebSocketCodec::Opcode;
+using CloseCode = WebSocketCodec::CloseCode;
+
+namespace {
+
+class Recorder : public WebSocketCodec::Callback {
+ public:
+  void onMessage(Opcode opcode, unique_ptr<IOBuf> payload) override {
+    opcodes.push_back(opcode);
+    messages.push_back(payload->moveToFbString().toStdString());
+  }
+
+  void onPing(unique_ptr<IOBuf> payload) override {
+    pings.push_back(payload->moveToFbString().toStdString());
+  }
+
+  void onClose(uint16_t code, StringPiece reason) override {
+    closeCode = code;
+    closeReason = reason.str();
+  }
+
+  void onError(CloseCode code, StringPiece /*reason*/) override {
+    errors++;
+    errorCode = code;
+  }
+
+  vector<Opcode> opcodes;
+  vector<string> messages;
+  vector<string> pings;
+  uint16_t closeCode{0};
+  string closeReason;
+  uint32_t errors{0};
+  CloseCode errorCode{CloseCode::NORMAL};
+};
+
+class WebSocketCodecTest : public testing::Test {
+ public:
+  void SetUp() override {
+    setUp(WebSocketCodec::Options());
+  }
+
+  void setUp(const WebSocketCodec::Options& options) {
+    server_ = make_unique<WebSocketCodec>(TransportDirection::DOWNSTREAM,
+                                          options);
+    client_ = make_unique<WebSocketCodec>(TransportDirection::UPSTREAM,
+                                          options);
+    server_->setCallback(&serverRecorder_);
+    client_->setCallback(&clientRecorder_);
+  }
+
+  // Delivers the queue to codec a byte at a time, or in one read
+  void deliver(WebSocketCodec& codec, IOBufQueue& queue, bool bytewise) {
+    if (!bytewise) {
+      codec.onIngress(queue.move());
+      return;
+    }
+    while (!queue.empty()) {
+      codec.onIngress(queue.split(1));
+    }
+  }
+
+ protected:
+  unique_ptr<WebSocketCodec> server_;
+  unique_ptr<WebSocketCodec> client_;
+  Recorder serverRecorder_;
+  Recorder clientRecorder_;
+  IOBufQueue queue_{IOBufQueue::cacheChainLength()};
+};
+
+}
+
+TEST(WebSocketMaskTest, MatchesBytewise) {
+  std::array<uint8_t, 4> key{{0x37, 0xfa, 0x21, 0x3d}};
+  vector<uint8_t> input(200);
+  for (size_t i = 0; i < input.size(); i++) {
+    input[i] = uint8_t(i * 7 + 3);
+  }
+  for (size_t len = 0; len < input.size(); len += 13) {
+    for (size_t offset = 0; offset < 4; offset++) {
+      vector<uint8_t> out(len);
+      auto next = WebSocketCodec::applyMask(input.data(), out.data(), len,
+                                            key, offset);
+      EXPECT_EQ(next, (offset + len) % 4);
+      for (size_t i = 0; i < len; i++) {
+        ASSERT_EQ(out[i], input[i] ^ key[(offset + i) % 4]);
+      }
+      // In place, and back
+      WebSocketCodec::applyMask(out.data(), out.data(), len, key, offset);
+      EXPECT_TRUE(std::equal(out.begin(), out.end(), input.begin()));
+    }
+  }
+}
+
+TEST_F(WebSocketCodecTest, ClientToServer) {
+  string big(70000, 'b');
+  client_->generateMessage(queue_, Opcode::TEXT, IOBuf::copyBuffer("hello"));
+  client_->generateMessage(queue_, Opcode::BINARY, IOBuf::copyBuffer(big));
+  client_->generateMessage(queue_, Opcode::TEXT, IOBuf::create(0));
+  // Masked, so neither payload appears as sent
+  queue_.gather(queue_.chainLength());
+  string wire = queue_.front()->clone()->moveToFbString().toStdString();
+  EXPECT_EQ(wire.find("hello"), string::npos);
+
+  deliver(*server_, queue_, false);
+  EXPECT_EQ(serverRecorder_.errors, 0);
+  ASSERT_EQ(serverRecorder_.messages.size(), 3);
+  EXPECT_EQ(serverRecorder_.opcodes[0], Opcode::TEXT);
+  EXPECT_EQ(serverRecorder_.messages[0], "hello");
+  EXPECT_EQ(serverRecorder_.opcodes[1], Opcode::BINARY);
+  EXPECT_EQ(serverRecorder_.messages[1], big);
+  EXPECT_EQ(serverRecorder_.messages[2], "");
+}
+
+TEST_F(WebSocketCodecTest, FragmentedBytewise) {
+  server_->generateMessage(
+    queue_, Opcode::TEXT, IOBuf::copyBuffer("a fragmented message"), 6);
+  server_->generatePing(queue_, IOBuf::copyBuffer("ping"));
+  server_->generateMessage(queue_, Opcode::BINARY, IOBuf::copyBuffer("next"));
+  deliver(*client_, queue_, true);
+  EXPECT_EQ(clientRecorder_.errors, 0);
+  ASSERT_EQ(clientRecorder_.messages.size(), 2);
+  EXPECT_EQ(clientRecorder_.messages[0], "a fragmented message");
+  EXPECT_EQ(clientRecorder_.messages[1], "next");
+  EXPECT_EQ(clientRecorder_.pings, vector<string>{"ping"});
+}
+
+TEST_F(WebSocketCodecTest, SmallMessagesCoalesce) {
+  for (int i = 0; i < 10; i++) {
+    server_->generateMessage(queue_, Opcode::TEXT, IOBuf::copyBuffer("tick"));
+  }
+  EXPECT_EQ(queue_.front()->countChainElements(), 1);
+  EXPECT_EQ(queue_.chainLength(), 10 * 6);
+
+  // Large ones are chained rather than copied
+  auto large = IOBuf::copyBuffer(string(4096, 'x'));
+  auto data = large->data();
+  server_->generateMessage(queue_, Opcode::BINARY, std::move(large));
+  EXPECT_EQ(queue_.front()->prev()->data(), data);
+}
+
+TEST_F(WebSocketCodecTest, Close) {
+  client_->generateClose(queue_, uint16_t(CloseCode::GOING_AWAY), "bye");
+  EXPECT_TRUE(client_->isCloseSent());
+  // Later frames, and a second CLOSE, are not parsed
+  client_->generateClose(queue_, uint16_t(CloseCode::NORMAL));
+  client_->generateMessage(queue_, Opcode::TEXT, IOBuf::copyBuffer("late"));
+  deliver(*server_, queue_, false);
+  EXPECT_EQ(serverRecorder_.closeCode, uint16_t(CloseCode::GOING_AWAY));
+  EXPECT_EQ(serverRecorder_.closeReason, "bye");
+  EXPECT_TRUE(serverRecorder_.messages.empty());
+
+  server_->generateClose(queue_, uint16_t(CloseCode::NO_STATUS));
+  EXPECT_EQ(queue_.chainLength(), 2);
+  deliver(*client_, queue_, false);
+  EXPECT_EQ(clientRecorder_.closeCode, uint16_t(CloseCode::NO_STATUS));
+}
+
+TEST_F(WebSocketCodecTest, UnmaskedClientFrame) {
+  // A server frame sent to a server
+  server_->generateMessage(queue_, Opcode::TEXT, IOBuf::copyBuffer("hi"));
+  deliver(*server_, queue_, false);
+  EXPECT_EQ(serverRecorder_.errors, 1);
+  EXPECT_EQ(serverRecorder_.errorCode, CloseCode::PROTOCOL_ERROR);
+}
+
+TEST_F(WebSocketCodecTest, ProtocolErrors) {
+  // A continuation without a message, then a fragmented PING
+  const uint8_t continuation[] = {0x80, 0x00};
+  client_->onIngress(IOBuf::copyBuffer(continuation, sizeof(continuation)));
+  EXPECT_EQ(clientRecorder_.errors, 1);
+  EXPECT_EQ(clientRecorder_.errorCode, CloseCode::PROTOCOL_ERROR);
+
+  setUp(WebSocketCodec::Options());
+  const uint8_t ping[] = {0x09, 0x00};
+  client_->onIngress(IOBuf::copyBuffer(ping, sizeof(ping)));
+  EXPECT_EQ(clientRecorder_.errors, 2);
+}
+
+TEST_F(WebSocketCodecTest, MessageTooBig) {
+  WebSocketCodec::Options options;
+  options.maxMessageSize = 100;
+  setUp(options);
+  // Fails on the header of the frame that exceeds the limit
+  const uint8_t header[] = {0x02, 0x7e, 0x00, 0x65};
+  client_->onIngress(IOBuf::copyBuffer(header, sizeof(header)));
+  EXPECT_EQ(clientRecorder_.errors, 1);
+  EXPECT_EQ(clientRecorder_.errorCode, CloseCode::MESSAGE_TOO_BIG);
+}
+
+TEST_F(WebSocketCodecTest, DeflateExample) {
+  // "Hello", compressed, from RFC 7692 section 7.2.3.1
+  WebSocketCodec::Options options;
+  options.permessageDeflate = true;
+  setUp(options);
+  const uint8_t frame[] = {0xc1, 0x07, 0xf2, 0x48, 0xcd, 0xc9, 0xc9, 0x07,
+                           0x00};
+  client_->onIngress(IOBuf::copyBuffer(frame, sizeof(frame)));
+  EXPECT_EQ(clientRecorder_.messages, vector<string>{"Hello"});
+
+  // Without the extension, RSV1 is an error
+  setUp(WebSocketCodec::Options());
+  client_->onIngress(IOBuf::copyBuffer(frame, sizeof(frame)));
+  EXPECT_EQ(clientRecorder_.errors, 1);
+}
+
+TEST_F(WebSocketCodecTest, DeflateRoundTrip) {
+  for (bool noContextTakeover : {false, true}) {
+    WebSocketCodec::Options options;
+    options.permessageDeflate = true;
+    options.noContextTakeover = noContextTakeover;
+    options.peerNoContextTakeover = noContextTakeover;
+    setUp(options);
+    string text;
+    for (int i = 0; i < 50; i++) {
+      text += "a message that compresses rather well ";
+    }
+    IOBufQueue toClient{IOBufQueue::cacheChainLength()};
+    IOBufQueue toServer{IOBufQueue::cacheChainLength()};
+    for (int i = 0; i < 3; i++) {
+      server_->generateMessage(toClient, Opcode::TEXT,
+                               IOBuf::copyBuffer(text), 100);
+      client_->generateMessage(toServer, Opcode::TEXT,
+                               IOBuf::copyBuffer(text));
+    }
+    EXPECT_LT(toClient.chainLength(), text.size());
+    EXPECT_LT(toServer.chainLength(), text.size());
+    // Too small to compress
+    server_->generateMessage(toClient, Opcode::TEXT, IOBuf::copyBuffer("tiny"));
+    EXPECT_NE(toClient.front()->clone()->moveToFbString().find("tiny"),
+              fbstring::npos);
+
+    deliver(*client_, toClient, true);
+    deliver(*server_, toServer, false);
+    EXPECT_EQ(clientRecorder_.errors, 0);
+    EXPECT_EQ(serverRecorder_.errors, 0);
+    vector<string> expected(3, text);
+    EXPECT_EQ(serverRecorder_.messages, expected);
+    expected.push_back("tiny");
+    EXPECT_EQ(clientRecorder_.messages, expected);
+    clientRecorder_ = Recorder();
+    serverRecorder_ = Recorder();
+  }
+}
+
+TEST(WebSocketExtensionTest, AcceptPermessageDeflate) {
+  WebSocketCodec::Options options;
+  auto response = WebSocketCodec::acceptPermessageDeflate(
+    "permessage-deflate; client_max_window_bits", options);
+  ASSERT_TRUE(response.hasValue());
+  EXPECT_EQ(*response, "permessage-deflate");
+  EXPECT_TRUE(options.permessageDeflate);
+  EXPECT_FALSE(options.noContextTakeover);
+
+  // The first acceptable offer wins
+  options = WebSocketCodec::Options();
+  response = WebSocketCodec::acceptPermessageDeflate(
+    "x-webkit-deflate-frame, permessage-deflate; server_max_window_bits=10, "
+    "permessage-deflate; server_no_context_takeover; "
+    "client_no_context_takeover; server_max_window_bits=\"15\"",
+    options);
+  ASSERT_TRUE(response.hasValue());
+  EXPECT_EQ(*response,
+            "permessage-deflate; server_no_context_takeover; "
+            "client_no_context_takeover; server_max_window_bits=15");
+  EXPECT_TRUE(options.noContextTakeover);
+  EXPECT_TRUE(options.peerNoContextTakeover);
+
+  // Unknown or repeated parameters
+  options = WebSocketCodec::Options();
+  EXPECT_FALSE(WebSocketCodec::acceptPermessageDeflate(
+    "permessage-deflate; foo, "
+    "permessage-deflate; client_no_context_takeover; "
+    "client_no_context_takeover", options).hasValue());
+  EXPECT_FALSE(options.permessageDeflate);
+}
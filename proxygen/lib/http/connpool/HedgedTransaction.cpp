@@ -0,0 +1,244 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/http/connpool/HedgedTransaction.h"
+
+#include <algorithm>
+#include <limits>
+#include <proxygen/lib/utils/Time.h>
+
+namespace {
+// The times to headers between updates of the hedge delay
+const size_t kTimesPerUpdate = 16;
+}
+
+namespace proxygen {
+
+HedgingPolicy::HedgingPolicy(const Options& options)
+    : options_(options),
+      hedgeDelay_(std::min(std::max(options.defaultDelay, options.minDelay),
+                           options.maxDelay)),
+      budget_(options.hedgesPerSecond, options.hedgesBurst) {
+  options_.window = std::max<size_t>(options_.window, 1);
+  times_.reserve(options_.window);
+}
+
+void HedgingPolicy::addTimeToHeaders(std::chrono::milliseconds time) {
+  auto ms = uint32_t(std::min<int64_t>(std::max<int64_t>(time.count(), 0),
+                                       std::numeric_limits<uint32_t>::max()));
+  if (times_.size() < options_.window) {
+    times_.push_back(ms);
+  } else {
+    times_[nextTime_] = ms;
+    nextTime_ = (nextTime_ + 1) % options_.window;
+  }
+  // Sorting the window on every sample would cost more than the hedges
+  if (++timesSinceUpdate_ >= std::min(kTimesPerUpdate, options_.window)) {
+    updateHedgeDelay();
+    timesSinceUpdate_ = 0;
+  }
+}
+
+void HedgingPolicy::updateHedgeDelay() {
+  auto times = times_;
+  auto index = std::min(times.size() - 1,
+                        size_t(options_.percentile * times.size()));
+  std::nth_element(times.begin(), times.begin() + index, times.end());
+  hedgeDelay_ = std::min(
+    std::max(std::chrono::milliseconds(times[index]), options_.minDelay),
+    options_.maxDelay);
+}
+
+bool HedgingPolicy::tryHedge() {
+  if (budget_.consume(1)) {
+    numHedges_++;
+    return true;
+  }
+  numHedgesDenied_++;
+  return false;
+}
+
+/**
+ * Handles a transaction of the HedgedTransaction until it has headers or
+ * fails, and deletes itself once it no longer handles it.
+ */
+class HedgedTransaction::Attempt : public HTTPTransaction::Handler {
+ public:
+  explicit Attempt(HedgedTransaction* parent)
+      : parent_(parent), startTime_(getCurrentTime()) {
+  }
+
+  HTTPTransaction* getTransaction() const {
+    return txn_;
+  }
+
+  std::chrono::milliseconds getTimeSinceStart() const {
+    return millisecondsSince(startTime_);
+  }
+
+  // Aborts the transaction, whose detach deletes the attempt
+  void abandon() {
+    parent_ = nullptr;
+    if (txn_) {
+      txn_->sendAbort();
+    } else {
+      delete this;
+    }
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    if (parent_) {
+      parent_->removeAttempt(this);
+    }
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    auto parent = parent_;
+    parent_ = nullptr;
+    if (parent) {
+      // The handler took over the transaction
+      parent->onAttemptHeaders(this, std::move(msg));
+      delete this;
+    }
+  }
+
+  void onError(const HTTPException& error) noexcept override {
+    auto parent = parent_;
+    parent_ = nullptr;
+    if (parent && parent->onAttemptError(this, error)) {
+      delete this;
+    }
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {
+  }
+  void onEOM() noexcept override {
+  }
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  ~Attempt() override {
+  }
+
+  HedgedTransaction* parent_;
+  HTTPTransaction* txn_{nullptr};
+  TimePoint startTime_;
+};
+
+HedgedTransaction::HedgedTransaction(HTTPTransaction::Handler* handler,
+                                     HedgingPolicy& policy,
+                                     const WheelTimerInstance& timeout,
+                                     TransactionFactory factory)
+    : handler_(CHECK_NOTNULL(handler)),
+      policy_(policy),
+      timeout_(timeout),
+      factory_(std::move(factory)) {
+}
+
+HedgedTransaction::~HedgedTransaction() {
+  cancel();
+}
+
+bool HedgedTransaction::send(const HTTPMessage& request,
+                             std::unique_ptr<folly::IOBuf> body) {
+  CHECK(attempts_.empty() && !done_);
+  request_ = request;
+  body_ = std::move(body);
+  if (!startAttempt(false)) {
+    return false;
+  }
+  auto method = request_.getMethod();
+  if (!done_ && (policy_.getOptions().hedgeUnsafeMethods ||
+                 (method && isSafeMethod(*method)))) {
+    timeout_.scheduleTimeout(this, policy_.getHedgeDelay());
+  }
+  return true;
+}
+
+void HedgedTransaction::cancel() {
+  cancelTimeout();
+  done_ = true;
+  auto attempts = std::move(attempts_);
+  attempts_.clear();
+  for (auto attempt : attempts) {
+    attempt->abandon();
+  }
+  body_.reset();
+}
+
+void HedgedTransaction::timeoutExpired() noexcept {
+  if (!done_ && policy_.tryHedge()) {
+    VLOG(4) << "Hedging " << request_.getURL() << " after "
+            << policy_.getHedgeDelay().count() << "ms";
+    hedged_ = startAttempt(true);
+  }
+}
+
+bool HedgedTransaction::startAttempt(bool hedge) {
+  auto attempt = new Attempt(this);
+  auto txn = factory_(attempt, hedge);
+  if (!txn) {
+    attempt->abandon();
+    return false;
+  }
+  attempt->setTransaction(txn);
+  attempts_.push_back(attempt);
+  if (body_) {
+    txn->sendHeaders(request_);
+    txn->sendBody(body_->clone());
+    txn->sendEOM();
+  } else {
+    txn->sendHeadersWithEOM(request_);
+  }
+  return true;
+}
+
+void HedgedTransaction::onAttemptHeaders(Attempt* attempt,
+                                         std::unique_ptr<HTTPMessage> msg) {
+  removeAttempt(attempt);
+  policy_.addTimeToHeaders(attempt->getTimeSinceStart());
+  // The losers are aborted before the handler runs, which may destroy this
+  cancel();
+  auto txn = attempt->getTransaction();
+  auto handler = handler_;
+  txn->setHandler(handler);
+  handler->onHeadersComplete(std::move(msg));
+}
+
+bool HedgedTransaction::onAttemptError(Attempt* attempt,
+                                       const HTTPException& error) {
+  removeAttempt(attempt);
+  if (!attempts_.empty()) {
+    // The other transaction may still answer
+    return false;
+  }
+  cancel();
+  auto txn = attempt->getTransaction();
+  auto handler = handler_;
+  txn->setHandler(handler);
+  handler->onError(error);
+  return true;
+}
+
+void HedgedTransaction::removeAttempt(Attempt* attempt) {
+  attempts_.erase(std::remove(attempts_.begin(), attempts_.end(), attempt),
+                  attempts_.end());
+}
+
+} // namespace proxygen
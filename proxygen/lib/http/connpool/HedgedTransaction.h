@@ -0,0 +1,159 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/TokenBucket.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <functional>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/utils/WheelTimerInstance.h>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Decides when HedgedTransactions send their hedge: after a percentile of
+ * the recent times to response headers, and within a budget of hedges per
+ * second, so that a slow backend does not double its load.  A policy is
+ * shared by the hedged transactions of a thread, for one kind of request.
+ */
+class HedgingPolicy {
+ public:
+  struct Options {
+    // The percentile of the times to headers to wait for before hedging
+    double percentile{0.95};
+    std::chrono::milliseconds minDelay{1};
+    std::chrono::milliseconds maxDelay{1000};
+    // The delay until enough times to headers are known
+    std::chrono::milliseconds defaultDelay{100};
+    // The number of recent times to headers the percentile is taken of
+    size_t window{1000};
+    double hedgesPerSecond{10};
+    double hedgesBurst{10};
+    // Hedging requests that are not safe (see isSafeMethod()) may execute
+    // them twice
+    bool hedgeUnsafeMethods{false};
+  };
+
+  explicit HedgingPolicy(const Options& options);
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+  std::chrono::milliseconds getHedgeDelay() const {
+    return hedgeDelay_;
+  }
+
+  void addTimeToHeaders(std::chrono::milliseconds time);
+
+  /**
+   * Returns true and takes a hedge from the budget if there is one left.
+   */
+  bool tryHedge();
+
+  uint64_t getNumHedges() const {
+    return numHedges_;
+  }
+
+  uint64_t getNumHedgesDenied() const {
+    return numHedgesDenied_;
+  }
+
+ private:
+  void updateHedgeDelay();
+
+  Options options_;
+  std::vector<uint32_t> times_;
+  size_t nextTime_{0};
+  size_t timesSinceUpdate_{0};
+  std::chrono::milliseconds hedgeDelay_;
+  folly::TokenBucket budget_;
+  uint64_t numHedges_{0};
+  uint64_t numHedgesDenied_{0};
+};
+
+/**
+ * Sends a request, and sends it again on another transaction if no
+ * response headers arrived after the hedge delay of the policy.  The first
+ * transaction to get headers is handed to the handler, which sees it from
+ * setTransaction() on as if it made the request itself, and the other is
+ * aborted.  If a transaction fails while no other is open, the handler gets
+ * it with its error.
+ *
+ * The transaction factory opens the transactions with the handler it is
+ * given, e.g. with SessionPool::getTransaction(), and is told whether it
+ * opens the hedge, so that it can use another session pool or endpoint.
+ * The request is sent with its whole body, and is kept for the hedge until
+ * the handler gets a transaction.
+ *
+ * Destroying the HedgedTransaction before that aborts the transactions
+ * without calling the handler.  It must be used from the thread of the
+ * sessions.
+ */
+class HedgedTransaction : private folly::HHWheelTimer::Callback {
+ public:
+  using TransactionFactory =
+    std::function<HTTPTransaction*(HTTPTransaction::Handler*, bool hedge)>;
+
+  HedgedTransaction(HTTPTransaction::Handler* handler,
+                    HedgingPolicy& policy,
+                    const WheelTimerInstance& timeout,
+                    TransactionFactory factory);
+  ~HedgedTransaction() override;
+
+  /**
+   * Sends the request on a first transaction.  Returns false if the factory
+   * could not open one, in which case the handler is not called.
+   */
+  bool send(const HTTPMessage& request,
+            std::unique_ptr<folly::IOBuf> body = nullptr);
+
+  /**
+   * Aborts the transactions if the handler has none yet.
+   */
+  void cancel();
+
+  /**
+   * Returns true if the hedge was sent.
+   */
+  bool isHedged() const {
+    return hedged_;
+  }
+
+  /**
+   * Returns true once the handler got its transaction, or after cancel().
+   */
+  bool isDone() const {
+    return done_;
+  }
+
+ private:
+  class Attempt;
+
+  void timeoutExpired() noexcept override;
+  bool startAttempt(bool hedge);
+  void onAttemptHeaders(Attempt* attempt, std::unique_ptr<HTTPMessage> msg);
+  bool onAttemptError(Attempt* attempt, const HTTPException& error);
+  void removeAttempt(Attempt* attempt);
+
+  HTTPTransaction::Handler* handler_;
+  HedgingPolicy& policy_;
+  WheelTimerInstance timeout_;
+  TransactionFactory factory_;
+  HTTPMessage request_;
+  std::unique_ptr<folly::IOBuf> body_;
+  // The transactions waiting for headers
+  std::vector<Attempt*> attempts_;
+  bool hedged_{false};
+  bool done_{false};
+};
+
+} // namespace proxygen
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/http/connpool/OutlierDetector.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+OutlierDetector::OutlierDetector(const Options& options)
+    : options_(options) {
+}
+
+OutlierDetector::EndpointState& OutlierDetector::getState(
+    const Endpoint& endpoint) {
+  auto it = endpoints_.find(endpoint);
+  if (it == endpoints_.end()) {
+    it = endpoints_.emplace(endpoint, EndpointState()).first;
+  }
+  return it->second;
+}
+
+OutlierDetector::EndpointState* OutlierDetector::getSampledState(
+    const Endpoint& endpoint) {
+  auto& state = getState(endpoint);
+  // Ignores the requests in flight when the endpoint was ejected, so that
+  // it comes back with fresh averages
+  return isEjected(state, getCurrentTime()) ? nullptr : &state;
+}
+
+void OutlierDetector::onResponse(const Endpoint& endpoint, uint16_t status) {
+  auto state = getSampledState(endpoint);
+  if (!state) {
+    return;
+  }
+  auto a = options_.alpha;
+  state->errorRate = (1 - a) * state->errorRate;
+  state->rate5xx = a * (status >= 500 && status < 600) +
+    (1 - a) * state->rate5xx;
+  onSample(endpoint, *state);
+}
+
+void OutlierDetector::onError(const Endpoint& endpoint) {
+  auto state = getSampledState(endpoint);
+  if (!state) {
+    return;
+  }
+  state->errorRate = options_.alpha + (1 - options_.alpha) * state->errorRate;
+  onSample(endpoint, *state);
+}
+
+void OutlierDetector::onLatency(const Endpoint& endpoint,
+                                std::chrono::milliseconds latency) {
+  auto state = getSampledState(endpoint);
+  if (!state) {
+    return;
+  }
+  state->latencyMs = options_.alpha * latency.count() +
+    (1 - options_.alpha) * state->latencyMs;
+  onSample(endpoint, *state);
+}
+
+bool OutlierDetector::tryStartConnect(const Endpoint& endpoint) {
+  auto& state = getState(endpoint);
+  if (isEjected(state, getCurrentTime()) ||
+      (options_.maxPendingConnects > 0 &&
+       state.pendingConnects >= options_.maxPendingConnects)) {
+    return false;
+  }
+  state.pendingConnects++;
+  return true;
+}
+
+void OutlierDetector::onConnectFinished(const Endpoint& endpoint,
+                                        bool success) {
+  auto& state = getState(endpoint);
+  if (state.pendingConnects > 0) {
+    state.pendingConnects--;
+  }
+  if (!success) {
+    onError(endpoint);
+  }
+}
+
+bool OutlierDetector::isEjected(const Endpoint& endpoint) const {
+  auto it = endpoints_.find(endpoint);
+  return it != endpoints_.end() && isEjected(it->second, getCurrentTime());
+}
+
+bool OutlierDetector::isEjected(const EndpointState& state,
+                                TimePoint now) const {
+  return now < state.ejectedUntil;
+}
+
+void OutlierDetector::removeEndpoint(const Endpoint& endpoint) {
+  endpoints_.erase(endpoint);
+}
+
+uint32_t OutlierDetector::getNumEjected() const {
+  auto now = getCurrentTime();
+  return std::count_if(endpoints_.begin(), endpoints_.end(),
+                       [this, now] (const std::pair<const Endpoint,
+                                                    EndpointState>& entry) {
+                         return isEjected(entry.second, now);
+                       });
+}
+
+void OutlierDetector::onSample(const Endpoint& endpoint,
+                               EndpointState& state) {
+  if (++state.samples < options_.minSamples) {
+    return;
+  }
+  if ((options_.maxErrorRate > 0 &&
+       state.errorRate > options_.maxErrorRate) ||
+      (options_.max5xxRate > 0 && state.rate5xx > options_.max5xxRate) ||
+      (options_.maxLatency.count() > 0 &&
+       state.latencyMs > options_.maxLatency.count())) {
+    eject(endpoint, state, getCurrentTime());
+  }
+}
+
+void OutlierDetector::eject(const Endpoint& endpoint, EndpointState& state,
+                            TimePoint now) {
+  if (getNumEjected() + 1 >
+      std::min(endpoints_.size() - 1,
+               size_t(options_.maxEjectedFraction * endpoints_.size()))) {
+    // Spreading the load on too few endpoints would make them outliers too
+    return;
+  }
+  if (now - state.ejectedUntil > options_.maxEjectionTime) {
+    state.ejections = 0;
+  }
+  auto ejectionTime = options_.baseEjectionTime;
+  for (uint32_t i = 0; i < state.ejections &&
+         ejectionTime < options_.maxEjectionTime; ++i) {
+    ejectionTime *= 2;
+  }
+  ejectionTime = std::min(ejectionTime, options_.maxEjectionTime);
+  state.ejections++;
+  state.ejectedUntil = now + ejectionTime;
+  state.errorRate = 0;
+  state.rate5xx = 0;
+  state.latencyMs = 0;
+  state.samples = 0;
+  numEjections_++;
+  VLOG(3) << "Ejecting " << endpoint.getHostname() << ":"
+          << endpoint.getPort() << " for " << ejectionTime.count() << "ms";
+}
+
+} // namespace proxygen
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/http/connpool/Endpoint.h>
+#include <proxygen/lib/utils/Time.h>
+#include <unordered_map>
+
+namespace proxygen {
+
+/**
+ * Passive outlier detection for the endpoints of the session pools of a
+ * thread.  It keeps moving averages of the error rate, the 5xx rate and the
+ * latency of each endpoint, and ejects an endpoint whose averages cross a
+ * limit, for a time that doubles with each ejection in a row.  Ejected
+ * endpoints come back when their time is up, with fresh averages.
+ *
+ * A SessionPool given the detector reports the responses and the errors of
+ * its sessions, and drains the sessions of ejected endpoints instead of
+ * using them.  Callers report the latencies they measure and the results
+ * of their connects, which they should not start to ejected endpoints, and
+ * tryStartConnect() caps the connects pending to an endpoint.
+ *
+ * It is not thread-safe, and must outlive the pools using it.
+ */
+class OutlierDetector {
+ public:
+  struct Options {
+    // The weight of a new sample in the averages
+    double alpha{0.05};
+    // The limits of the averages, 0 disables the check
+    double maxErrorRate{0.5};
+    double max5xxRate{0.5};
+    std::chrono::milliseconds maxLatency{0};
+    // The samples since the endpoint was added or came back before it can
+    // be ejected
+    uint32_t minSamples{20};
+    std::chrono::milliseconds baseEjectionTime{10000};
+    std::chrono::milliseconds maxEjectionTime{300000};
+    // The largest share of the endpoints ejected at once; one endpoint at
+    // least is never ejected
+    double maxEjectedFraction{0.5};
+    // The connects pending to each endpoint, 0 for no limit
+    uint32_t maxPendingConnects{0};
+  };
+
+  explicit OutlierDetector(const Options& options);
+
+  void onResponse(const Endpoint& endpoint, uint16_t status);
+  void onError(const Endpoint& endpoint);
+  void onLatency(const Endpoint& endpoint, std::chrono::milliseconds latency);
+
+  /**
+   * Returns false if the endpoint is ejected or has too many connects
+   * pending, otherwise counts a pending connect, to be ended with
+   * onConnectFinished().
+   */
+  bool tryStartConnect(const Endpoint& endpoint);
+  void onConnectFinished(const Endpoint& endpoint, bool success);
+
+  bool isEjected(const Endpoint& endpoint) const;
+
+  /**
+   * Forgets an endpoint that is no longer used.
+   */
+  void removeEndpoint(const Endpoint& endpoint);
+
+  uint32_t getNumEjected() const;
+
+  uint64_t getNumEjections() const {
+    return numEjections_;
+  }
+
+ private:
+  struct EndpointState {
+    double errorRate{0};
+    double rate5xx{0};
+    double latencyMs{0};
+    uint32_t samples{0};
+    uint32_t pendingConnects{0};
+    // Ejections in a row, forgotten after maxEjectionTime back in use
+    uint32_t ejections{0};
+    TimePoint ejectedUntil;
+  };
+
+  EndpointState& getState(const Endpoint& endpoint);
+  EndpointState* getSampledState(const Endpoint& endpoint);
+  void onSample(const Endpoint& endpoint, EndpointState& state);
+  bool isEjected(const EndpointState& state, TimePoint now) const;
+  void eject(const Endpoint& endpoint, EndpointState& state, TimePoint now);
+
+  Options options_;
+  std::unordered_map<Endpoint, EndpointState, EndpointHash, EndpointEqual>
+    endpoints_;
+  uint64_t numEjections_{0};
+};
+
+} // namespace proxygen
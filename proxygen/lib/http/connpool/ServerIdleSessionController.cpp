@@ -9,19 +9,20 @@
  */
 #include "proxygen/lib/http/connpool/ServerIdleSessionController.h"
 
+#include <folly/hash/Hash.h>
+
 namespace proxygen {
 
-folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
-  folly::Promise<HTTPSessionBase*> promise;
-  folly::Future<HTTPSessionBase*> future = promise.getFuture();
-  SessionPool* maxPool = nullptr;
+constexpr size_t ServerIdleSessionController::kNumShards;
+constexpr uint64_t ServerIdleSessionController::kEmptyShard;
 
-  {
-    std::lock_guard<std::mutex> lock(lock_);
-    maxPool = popBestIdlePool();
-    if (markedForDeath_ || !maxPool || !maxPool->getEventBase()) {
-      return folly::makeFuture<HTTPSessionBase*>(nullptr);
-    }
+folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
+  if (isMarkedForDeath()) {
+    return folly::makeFuture<HTTPSessionBase*>(nullptr);
+  }
+  SessionPool* maxPool = popBestIdlePool();
+  if (!maxPool || !maxPool->getEventBase()) {
+    return folly::makeFuture<HTTPSessionBase*>(nullptr);
   }
 
   if (maxPool->getEventBase()->isInEventBaseThread()) {
@@ -29,6 +30,8 @@ folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
     return folly::makeFuture<HTTPSessionBase*>(nullptr);
   }
 
+  folly::Promise<HTTPSessionBase*> promise;
+  folly::Future<HTTPSessionBase*> future = promise.getFuture();
   maxPool->getEventBase()->runInEventBaseThread(
       [this, maxPool, promise = std::move(promise)]() mutable {
         // Caller (in this case Server::getTransaction()) needs to guarantee
@@ -45,45 +48,95 @@ folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
 
 void ServerIdleSessionController::addIdleSession(const HTTPSessionBase* session,
                                                  SessionPool* sessionPool) {
-  std::lock_guard<std::mutex> lock(lock_);
-  if (sessionMap_.find(session) != sessionMap_.end()) {
+  if (isMarkedForDeath()) {
+    return;
+  }
+  auto& shard = getShard(session);
+  std::lock_guard<std::mutex> lock(shard.lock);
+  if (shard.sessionMap.find(session) != shard.sessionMap.end()) {
     // removeIdleSession should've been called before re-adding
     LOG(ERROR) << "Session " << session << " already exists!";
     return;
   }
-  if (sessionsByIdleAge_.size() < maxIdleCount_) {
-    auto newIt = sessionsByIdleAge_.insert(sessionsByIdleAge_.end(),
-                                           {session, sessionPool});
-    sessionMap_[session] = newIt;
+  if (numIdle_.fetch_add(1, std::memory_order_relaxed) >= maxIdleCount_) {
+    numIdle_.fetch_sub(1, std::memory_order_relaxed);
+    return;
+  }
+  auto seqNo = nextIdleSeqNo_.fetch_add(1, std::memory_order_relaxed);
+  auto newIt = shard.sessionsByIdleAge.insert(shard.sessionsByIdleAge.end(),
+                                              {session, sessionPool, seqNo});
+  shard.sessionMap[session] = newIt;
+  if (newIt == shard.sessionsByIdleAge.begin()) {
+    shard.oldestSeqNo.store(seqNo, std::memory_order_release);
   }
 }
 
 void ServerIdleSessionController::removeIdleSession(
     const HTTPSessionBase* session) {
-  std::lock_guard<std::mutex> lock(lock_);
-  auto it = sessionMap_.find(session);
-  if (it != sessionMap_.end()) {
-    sessionsByIdleAge_.erase(it->second);
-    sessionMap_.erase(it);
+  auto& shard = getShard(session);
+  std::lock_guard<std::mutex> lock(shard.lock);
+  auto it = shard.sessionMap.find(session);
+  if (it != shard.sessionMap.end()) {
+    shard.erase(it->second);
+    shard.sessionMap.erase(it);
+    numIdle_.fetch_sub(1, std::memory_order_relaxed);
   }
 }
 
 void ServerIdleSessionController::markForDeath() {
-  std::lock_guard<std::mutex> lock(lock_);
-  markedForDeath_ = true;
-  sessionMap_.clear();
-  sessionsByIdleAge_.clear();
+  markedForDeath_.store(true, std::memory_order_release);
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    numIdle_.fetch_sub(shard.sessionMap.size(), std::memory_order_relaxed);
+    shard.sessionMap.clear();
+    shard.sessionsByIdleAge.clear();
+    shard.oldestSeqNo.store(kEmptyShard, std::memory_order_release);
+  }
 }
 
-// must be called under lock_
 SessionPool* FOLLY_NULLABLE ServerIdleSessionController::popBestIdlePool() {
-  if (!sessionsByIdleAge_.empty()) {
-    auto ret = *sessionsByIdleAge_.begin();
-    sessionsByIdleAge_.erase(sessionsByIdleAge_.begin());
-    sessionMap_.erase(ret.session);
-    return ret.sessionPool;
+  // The shard picked may be emptied by another thread before it is locked,
+  // then look again
+  for (size_t attempt = 0; attempt < kNumShards; ++attempt) {
+    Shard* best = nullptr;
+    uint64_t bestSeqNo = kEmptyShard;
+    for (auto& shard : shards_) {
+      auto seqNo = shard.oldestSeqNo.load(std::memory_order_acquire);
+      if (seqNo < bestSeqNo) {
+        best = &shard;
+        bestSeqNo = seqNo;
+      }
+    }
+    if (!best) {
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(best->lock);
+    if (!best->sessionsByIdleAge.empty()) {
+      auto ret = best->sessionsByIdleAge.front();
+      best->erase(best->sessionsByIdleAge.begin());
+      best->sessionMap.erase(ret.session);
+      numIdle_.fetch_sub(1, std::memory_order_relaxed);
+      return ret.sessionPool;
+    }
   }
   return nullptr;
 }
 
+ServerIdleSessionController::Shard& ServerIdleSessionController::getShard(
+    const HTTPSessionBase* session) {
+  auto hash = folly::hash::twang_mix64(reinterpret_cast<uintptr_t>(session));
+  return shards_[hash % kNumShards];
+}
+
+void ServerIdleSessionController::Shard::erase(IdleSessionListIter it) {
+  bool wasOldest = it == sessionsByIdleAge.begin();
+  sessionsByIdleAge.erase(it);
+  if (wasOldest) {
+    oldestSeqNo.store(sessionsByIdleAge.empty() ?
+                      kEmptyShard : sessionsByIdleAge.front().idleSeqNo,
+                      std::memory_order_release);
+  }
+}
+
 } // namespace proxygen
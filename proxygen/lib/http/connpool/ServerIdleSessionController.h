@@ -11,7 +11,13 @@
 
 #include "proxygen/lib/http/connpool/SessionPool.h"
 
+#include <array>
+#include <atomic>
 #include <folly/futures/Future.h>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace proxygen {
 
@@ -21,6 +27,11 @@ namespace proxygen {
  *
  * Server class uses it to move idle transactions between threads, if necessary.
  * All public methods are thread-safe.
+ *
+ * The sessions are spread over shards so that the threads adding and
+ * removing their sessions rarely contend; the oldest idle session of each
+ * shard is published in an atomic, so finding the oldest one overall takes
+ * no lock, and only the shard holding it is locked to take it.
  */
 class ServerIdleSessionController {
  public:
@@ -49,11 +60,36 @@ class ServerIdleSessionController {
   struct IdleSessionInfo {
     const HTTPSessionBase* session;
     SessionPool* sessionPool;
+    // order in which the sessions became idle
+    uint64_t idleSeqNo;
   };
 
   using IdleSessionList = std::list<IdleSessionInfo>;
   using IdleSessionListIter = IdleSessionList::iterator;
 
+  static constexpr size_t kNumShards = 32;
+  static constexpr uint64_t kEmptyShard = std::numeric_limits<uint64_t>::max();
+
+  struct Shard {
+    std::mutex lock;
+    /*
+     * List of idle sessions. Normally, addIdleSession() adds to the end and
+     * popBestIdlePool() removes from the beginning, thus keeping the list
+     * sorted by idle age.
+     * Additionally, we also support arbitrary removals if some session stops
+     * being idle or dies or gets re-used out of order if many threads attempt
+     * session transfer at the same time.
+     */
+    IdleSessionList sessionsByIdleAge;
+    // Store iterators in sessionsByIdleAge to be able to find sessions.
+    std::unordered_map<const HTTPSessionBase*, IdleSessionListIter> sessionMap;
+    // idleSeqNo of the front of sessionsByIdleAge, read without the lock
+    std::atomic<uint64_t> oldestSeqNo{kEmptyShard};
+
+    // must be called under lock
+    void erase(IdleSessionListIter it);
+  };
+
   /**
    * Find available session pool (thread) to tranfer an idle session from.
    * Remove it from the map.
@@ -61,23 +97,15 @@ class ServerIdleSessionController {
   SessionPool* FOLLY_NULLABLE popBestIdlePool();
 
   bool isMarkedForDeath() {
-    std::lock_guard<std::mutex> lock(lock_);
-    return markedForDeath_;
+    return markedForDeath_.load(std::memory_order_acquire);
   }
 
-  std::mutex lock_;
-  /*
-   * List of idle sessions. Normally, addIdleSession() adds to the end and
-   * popBestIdlePool() removes from the beginning, thus keeping the list sorted
-   * by idle age.
-   * Additionally, we also support arbitrary removals if some session stops
-   * being idle or dies or gets re-used out of order if many threads attempt
-   * session transfer at the same time.
-   */
-  IdleSessionList sessionsByIdleAge_;
-  // Store iterators in sessionsByIdleAge_ to be able to find sessions.
-  std::unordered_map<const HTTPSessionBase*, IdleSessionListIter> sessionMap_;
-  bool markedForDeath_{false};
+  Shard& getShard(const HTTPSessionBase* session);
+
+  std::array<Shard, kNumShards> shards_;
+  std::atomic<size_t> numIdle_{0};
+  std::atomic<uint64_t> nextIdleSeqNo_{0};
+  std::atomic<bool> markedForDeath_{false};
 
   const unsigned int maxIdleCount_;
 };
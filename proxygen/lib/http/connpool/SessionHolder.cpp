@@ -8,6 +8,7 @@
  *
  */
 #include "proxygen/lib/http/connpool/SessionHolder.h"
+#include "proxygen/lib/http/connpool/OutlierDetector.h"
 
 #include <folly/Random.h>
 #include <folly/io/async/AsyncSocket.h>
@@ -25,12 +26,14 @@ namespace proxygen {
 SessionHolder::SessionHolder(HTTPSessionBase* sess,
                              Callback* parent,
                              Stats* stats,
-                             Endpoint endpoint)
+                             Endpoint endpoint,
+                             OutlierDetector* outlierDetector)
     : session_(CHECK_NOTNULL(sess)),
       parent_(CHECK_NOTNULL(parent)),
       stats_(stats),
       jitter_(folly::Random::randDouble(-kJitterPct, kJitterPct)),
       endpoint_(std::move(endpoint)),
+      outlierDetector_(outlierDetector),
       originalSessionInfoCb_(sess->getInfoCallback()) {
   session_->setInfoCallback(this);
 }
@@ -159,6 +162,9 @@ void SessionHolder::onCreate(const HTTPSessionBase&) {
 
 void SessionHolder::onIngressError(const HTTPSessionBase& session,
                                    ProxygenError error) {
+  if (outlierDetector_) {
+    outlierDetector_->onError(endpoint_);
+  }
   if (originalSessionInfoCb_) {
     originalSessionInfoCb_->onIngressError(session, error);
   }
@@ -168,6 +174,7 @@ void SessionHolder::onRead(const HTTPSessionBase& session, size_t bytesRead) {
   if (stats_) {
     stats_->onRead(bytesRead);
   }
+  parent_->onBytesRead(this, bytesRead);
   if (originalSessionInfoCb_) {
     originalSessionInfoCb_->onRead(session, bytesRead);
   }
@@ -231,6 +238,9 @@ void SessionHolder::onDestroy(const HTTPSessionBase& session) {
 
 void SessionHolder::onIngressMessage(const HTTPSessionBase& session,
                                      const HTTPMessage& msg) {
+  if (outlierDetector_ && msg.isResponse() && msg.getStatusCode() >= 200) {
+    outlierDetector_->onResponse(endpoint_, msg.getStatusCode());
+  }
   if (originalSessionInfoCb_) {
     originalSessionInfoCb_->onIngressMessage(session, msg);
   }
@@ -293,6 +303,7 @@ void SessionHolder::onFlowControlWindowClosed(const HTTPSessionBase& session) {
   if (originalSessionInfoCb_) {
     originalSessionInfoCb_->onFlowControlWindowClosed(session);
   }
+  parent_->onFlowControlStall(this);
 }
 
 void SessionHolder::onEgressBuffered(const HTTPSessionBase& session) {
@@ -321,8 +332,10 @@ void SessionHolder::onSettingsAck(const HTTPSessionBase& sess) {
 }
 
 void SessionHolder::describe(std::ostream& os) const {
+  // HQ sessions have no transport
+  auto transport = session_->getTransport();
   const AsyncSocket* sock =
-      session_->getTransport()->getUnderlyingTransport<AsyncSocket>();
+      transport ? transport->getUnderlyingTransport<AsyncSocket>() : nullptr;
   if (sock) {
     os << "fd=" << sock->getNetworkSocket().toFd();
 
@@ -345,6 +358,11 @@ void SessionHolder::describe(std::ostream& os) const {
     } else {
       os << ",-";
     }
+  } else if (!transport &&
+             session_->getLocalAddress().isInitialized() &&
+             session_->getPeerAddress().isInitialized()) {
+    os << "fd=-1,lp=" << session_->getLocalAddress().getPort() << ","
+       << session_->getPeerAddress();
   } else {
     os << "fd=-1,lp=-1,-";
   }
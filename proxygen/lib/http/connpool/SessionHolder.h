@@ -23,6 +23,8 @@ class HTTPMessage;
  * encapsulates a single HTTPSessionBase and manages which list in the
  * SessionPool it should be a part of.
  */
+class OutlierDetector;
+
 class SessionHolder : private HTTPSessionBase::InfoCallback {
  public:
   class Callback {
@@ -36,6 +38,9 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
     virtual void attachPartiallyFilled(SessionHolder*) = 0;
     virtual void attachFilled(SessionHolder*) = 0;
     virtual void addDrainingSession(HTTPSessionBase*) = 0;
+    // The session's connection flow control window closed
+    virtual void onFlowControlStall(SessionHolder*) = 0;
+    virtual void onBytesRead(SessionHolder*, size_t bytesRead) = 0;
   };
 
   class Stats {
@@ -53,7 +58,8 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
   explicit SessionHolder(HTTPSessionBase*,
                          Callback*,
                          Stats* = nullptr,
-                         Endpoint = Endpoint("", 0, false));
+                         Endpoint = Endpoint("", 0, false),
+                         OutlierDetector* = nullptr);
   ~SessionHolder() override;
 
   HTTPSessionBase* release() {
@@ -104,7 +110,7 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
   bool shouldAgeOut(std::chrono::milliseconds maxAge) const;
   void describe(std::ostream& os) const;
 
-  Endpoint getEndpoint() {
+  const Endpoint& getEndpoint() const {
     return endpoint_;
   }
 
@@ -163,6 +169,7 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
   double jitter_;
   ListState state_{ListState::DETACHED};
   Endpoint endpoint_;
+  OutlierDetector* outlierDetector_;
   HTTPSessionBase::InfoCallback* originalSessionInfoCb_;
 };
 typedef folly::CountedIntrusiveList<SessionHolder, &SessionHolder::listHook>
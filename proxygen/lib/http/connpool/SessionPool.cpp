@@ -8,7 +8,9 @@
  *
  */
 #include "proxygen/lib/http/connpool/SessionPool.h"
+#include "proxygen/lib/http/connpool/OutlierDetector.h"
 #include "proxygen/lib/http/connpool/ServerIdleSessionController.h"
+#include "proxygen/lib/http/connpool/SessionSelectionPolicy.h"
 #include "proxygen/lib/http/connpool/ThreadIdleSessionController.h"
 
 #include <chrono>
@@ -78,16 +80,54 @@ uint32_t SessionPool::getNumSessions() const {
          fullSessionList_.size();
 }
 
+uint32_t SessionPool::getNumSessionsYoungerThan(
+    std::chrono::milliseconds age) const {
+  uint32_t num = 0;
+  for (const auto* list :
+         {&idleSessionList_, &unfilledSessionList_, &fullSessionList_}) {
+    for (const auto& holder : *list) {
+      if (millisecondsSince(
+            holder.getSession().getSetupTransportInfo().acceptTime) < age) {
+        num++;
+      }
+    }
+  }
+  return num;
+}
+
+uint64_t SessionPool::getNumOutgoingStreams() const {
+  uint64_t num = 0;
+  for (const auto* list : {&unfilledSessionList_, &fullSessionList_}) {
+    for (const auto& holder : *list) {
+      num += holder.getSession().getNumOutgoingStreams();
+    }
+  }
+  return num;
+}
+
+uint64_t SessionPool::getMaxConcurrentOutgoingStreams() const {
+  uint64_t num = 0;
+  for (const auto* list :
+         {&idleSessionList_, &unfilledSessionList_, &fullSessionList_}) {
+    for (const auto& holder : *list) {
+      num += holder.getSession().getMaxConcurrentOutgoingStreams();
+    }
+  }
+  return num;
+}
+
 bool SessionPool::empty() const {
   return idleSessionList_.empty() && unfilledSessionList_.empty() &&
          fullSessionList_.empty();
 }
 
-void SessionPool::putSession(HTTPSessionBase* session) {
+void SessionPool::putSession(HTTPSessionBase* session,
+                             const Endpoint& endpoint) {
   if (SessionHolder::isPoolable(session)) {
     // Constructing the session holder automatically puts it on the
     // correct list (one of [idle, unfilled, full])
-    auto holder = new SessionHolder(session, this, stats_);
+    auto holder = new SessionHolder(session, this, stats_, endpoint,
+                                    outlierDetector_);
     holder->link();
   } else {
     // this is equivalent to what happens in SessionHolder::link which is
@@ -101,14 +141,57 @@ void SessionPool::putSession(HTTPSessionBase* session) {
 
 HTTPTransaction* SessionPool::getTransaction(
     HTTPTransaction::Handler* upstreamHandler) {
-  auto txn = attemptOpenTransaction(upstreamHandler, unfilledSessionList_);
+  numTransactionRequests_++;
+  HTTPTransaction* txn = nullptr;
+  if (selectionPolicy_) {
+    txn = getTransactionWithPolicy(upstreamHandler);
+  } else {
+    txn = attemptOpenTransaction(upstreamHandler, unfilledSessionList_);
+    if (!txn) {
+      purgeExcessIdleSessions();
+      txn = attemptOpenTransaction(upstreamHandler, idleSessionList_);
+    }
+  }
   if (!txn) {
-    purgeExcessIdleSessions();
-    txn = attemptOpenTransaction(upstreamHandler, idleSessionList_);
+    numTransactionFailures_++;
   }
   return txn;
 }
 
+HTTPTransaction* SessionPool::getTransactionWithPolicy(
+    HTTPTransaction::Handler* upstreamHandler) {
+  purgeExcessIdleSessions();
+  while (!unfilledSessionList_.empty() || !idleSessionList_.empty()) {
+    SessionHolder* holder = selectSession();
+    if (shouldDrain(*holder)) {
+      holder->drain(); // implicit unlink and delete
+      continue;
+    }
+    auto txn = holder->newTransaction(upstreamHandler);
+    holder->unlink();
+    holder->link();
+    if (txn) {
+      return txn;
+    }
+    // As in attemptOpenTransaction(), the session moved to the full list
+  }
+  return nullptr;
+}
+
+SessionHolder* SessionPool::selectSession() {
+  // Idle sessions compete with the busy ones, so that the load spreads
+  // rather than filling the sessions one after the other
+  SessionHolder* unfilled = unfilledSessionList_.empty() ?
+    nullptr : selectionPolicy_->select(unfilledSessionList_);
+  SessionHolder* idle = idleSessionList_.empty() ?
+    nullptr : selectionPolicy_->select(idleSessionList_);
+  if (!unfilled || !idle) {
+    return unfilled ? unfilled : idle;
+  }
+  return selectionPolicy_->getCost(idle->getSession()) <
+    selectionPolicy_->getCost(unfilled->getSession()) ? idle : unfilled;
+}
+
 void SessionPool::purgeExcessIdleSessions() {
   auto thresh = std::chrono::steady_clock::now() - getTimeout();
 
@@ -163,7 +246,7 @@ HTTPTransaction* SessionPool::attemptOpenTransaction(
   SessionHolder* holder = nullptr;
   while (!list.empty()) {
     holder = &list.front();
-    if (holder->shouldAgeOut(maxAge_)) {
+    if (shouldDrain(*holder)) {
       holder->drain(); // implicit unlink and delete
       continue;
     }
@@ -179,6 +262,11 @@ HTTPTransaction* SessionPool::attemptOpenTransaction(
   return nullptr;
 }
 
+bool SessionPool::shouldDrain(const SessionHolder& holder) const {
+  return holder.shouldAgeOut(maxAge_) ||
+    (outlierDetector_ && outlierDetector_->isEjected(holder.getEndpoint()));
+}
+
 // SessionHolder::Callback methods
 
 void SessionPool::detachIdle(SessionHolder* sess) {
@@ -212,7 +300,10 @@ void SessionPool::attachIdle(SessionHolder* sess) {
     sess->drain();
   } else {
     idleSessionList_.push_back(*sess);
-    if (serverIdleSessionController_) {
+    // Only the sessions whose socket can move to another thread, e.g. not
+    // the HQ sessions with QUIC timers pending
+    if (serverIdleSessionController_ &&
+        sess->getSession().isDetachable(/*checkSocket=*/true)) {
       serverIdleSessionController_->addIdleSession(&sess->getSession(), this);
     }
     if (threadIdleSessionController_) {
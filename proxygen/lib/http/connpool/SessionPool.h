@@ -18,6 +18,8 @@ namespace proxygen {
 class HTTPTransaction;
 class ThreadIdleSessionController;
 class ServerIdleSessionController;
+class SessionSelectionPolicy;
+class OutlierDetector;
 
 /**
  * This class stores HTTPSessionBase objects. It simplifies a lot of
@@ -86,6 +88,13 @@ class SessionPool : private SessionHolder::Callback {
   void setTimeout(std::chrono::milliseconds);
   std::chrono::milliseconds getTimeout() const;
 
+  /**
+   * The maximum lifetime of the sessions, 0 when they do not age out.
+   */
+  std::chrono::milliseconds getMaxAge() const {
+    return maxAge_;
+  }
+
   /**
    * Returns the number of idle sessions. That is, sessions with no open
    * outgoing transactions.
@@ -115,6 +124,47 @@ class SessionPool : private SessionHolder::Callback {
    */
   uint32_t getNumSessions() const;
 
+  /**
+   * Returns the number of pooled sessions set up less than age ago.
+   */
+  uint32_t getNumSessionsYoungerThan(std::chrono::milliseconds age) const;
+
+  /**
+   * Returns the number of getTransaction() calls, successful or not, as a
+   * measure of the demand on the pool.
+   */
+  uint64_t getNumTransactionRequests() const {
+    return numTransactionRequests_;
+  }
+
+  /**
+   * Returns the number of getTransaction() calls that found no session
+   * able to take one more transaction.
+   */
+  uint64_t getNumTransactionFailures() const {
+    return numTransactionFailures_;
+  }
+
+  /**
+   * Returns the number of times the connection flow control window of a
+   * pooled session closed, and the bytes the pooled sessions read: whether
+   * more sessions would get more throughput out of the endpoint.
+   */
+  uint64_t getNumFlowControlStalls() const {
+    return numFlowControlStalls_;
+  }
+
+  uint64_t getBytesRead() const {
+    return bytesRead_;
+  }
+
+  /**
+   * Returns the outgoing transactions open on the pooled sessions, and the
+   * most they allow, as a measure of how saturated they are.
+   */
+  uint64_t getNumOutgoingStreams() const;
+  uint64_t getMaxConcurrentOutgoingStreams() const;
+
   /**
    * Returns true if this SessionPool has no sessions in it. This implies
    * getNumSessions() == 0
@@ -134,8 +184,10 @@ class SessionPool : private SessionHolder::Callback {
    * putting the session in the pool.
    *
    * @param session The session to put in the pool
+   * @param endpoint The endpoint of the session, for pools of several
    */
-  void putSession(HTTPSessionBase* session);
+  void putSession(HTTPSessionBase* session,
+                  const Endpoint& endpoint = Endpoint("", 0, false));
 
   /**
    * Gets a transaction from the first usable session in the session
@@ -149,9 +201,30 @@ class SessionPool : private SessionHolder::Callback {
    * This function checks 'unfilledSessionList_' first. If no sessions are
    * found, it checks idleSessionList_. If still no session is found,
    * nullptr is returned.
+   *
+   * With a selection policy set, the policy picks the session among those
+   * of both lists instead.
    */
   HTTPTransaction* getTransaction(HTTPTransaction::Handler*);
 
+  /**
+   * Picks the sessions getTransaction() uses by their load (see
+   * SessionSelectionPolicy), nullptr for the list order.
+   */
+  void setSelectionPolicy(
+      std::shared_ptr<const SessionSelectionPolicy> policy) {
+    selectionPolicy_ = std::move(policy);
+  }
+
+  /**
+   * Reports the responses and errors of the sessions put in the pool from
+   * now on to the detector, and drains the sessions of the endpoints it
+   * ejected instead of opening transactions on them.  nullptr to stop.
+   */
+  void setOutlierDetector(OutlierDetector* detector) {
+    outlierDetector_ = detector;
+  }
+
   /**
    * Remove oldest idle session from idleSessionList_.
    */
@@ -198,6 +271,20 @@ class SessionPool : private SessionHolder::Callback {
   HTTPTransaction* attemptOpenTransaction(
       HTTPTransaction::Handler* upstreamHandler, SessionList& list);
 
+  /**
+   * Returns true if the session should be drained rather than used: it is
+   * too old, or its endpoint is ejected by the outlier detector.
+   */
+  bool shouldDrain(const SessionHolder& holder) const;
+
+  /**
+   * getTransaction() with a selection policy: the policy picks the session
+   * among the partially filled and the idle ones.
+   */
+  HTTPTransaction* getTransactionWithPolicy(
+      HTTPTransaction::Handler* upstreamHandler);
+  SessionHolder* selectSession();
+
   // SessionHolder::Callback methods
   void detachIdle(SessionHolder*) override;
   void detachPartiallyFilled(SessionHolder*) override;
@@ -206,6 +293,12 @@ class SessionPool : private SessionHolder::Callback {
   void attachPartiallyFilled(SessionHolder*) override;
   void attachFilled(SessionHolder*) override;
   void addDrainingSession(HTTPSessionBase*) override;
+  void onFlowControlStall(SessionHolder*) override {
+    numFlowControlStalls_++;
+  }
+  void onBytesRead(SessionHolder*, size_t bytesRead) override {
+    bytesRead_ += bytesRead;
+  }
 
   SessionHolder::Stats* stats_{nullptr};
   // Max number of connections stored in the pool.
@@ -229,6 +322,12 @@ class SessionPool : private SessionHolder::Callback {
   ThreadIdleSessionController* threadIdleSessionController_{nullptr};
   // Manages idle sessions for the same server across threads.
   ServerIdleSessionController* serverIdleSessionController_{nullptr};
+  std::shared_ptr<const SessionSelectionPolicy> selectionPolicy_;
+  uint64_t numTransactionRequests_{0};
+  uint64_t numTransactionFailures_{0};
+  uint64_t numFlowControlStalls_{0};
+  uint64_t bytesRead_{0};
+  OutlierDetector* outlierDetector_{nullptr};
 
   folly::EventBase* const evb_{nullptr};
 };
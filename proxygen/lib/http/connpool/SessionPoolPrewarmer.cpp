@@ -0,0 +1,162 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/http/connpool/SessionPoolPrewarmer.h"
+
+#include <cmath>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+
+namespace {
+// Weight of the last interval in the smoothed request rate
+const double kRateAlpha = 0.3;
+}
+
+namespace proxygen {
+
+SessionPoolPrewarmer::SessionPoolPrewarmer(SessionPool& pool,
+                                           const WheelTimerInstance& timeout,
+                                           ConnectCallback connect,
+                                           const Options& options)
+    : folly::AsyncTimeout(CHECK_NOTNULL(pool.getEventBase())),
+      pool_(pool),
+      timeout_(timeout),
+      connect_(std::move(connect)),
+      options_(options),
+      lastRequests_(pool.getNumTransactionRequests()),
+      lastFailures_(pool.getNumTransactionFailures()),
+      lastStalls_(pool.getNumFlowControlStalls()),
+      lastBytesRead_(pool.getBytesRead()),
+      targetSessions_(options.minSessions) {
+  CHECK_LE(options_.minSessions, options_.maxSessions);
+}
+
+SessionPoolPrewarmer::~SessionPoolPrewarmer() {
+  stop();
+}
+
+void SessionPoolPrewarmer::start() {
+  timeoutExpired();
+}
+
+void SessionPoolPrewarmer::stop() {
+  cancelTimeout();
+  // Destroying the connectors cancels the connections without callbacks
+  connects_.clear();
+}
+
+void SessionPoolPrewarmer::timeoutExpired() noexcept {
+  updateTarget();
+  if (pool_.getMaxIdleSessions() < targetSessions_) {
+    pool_.setMaxIdleSessions(targetSessions_);
+  }
+
+  auto maxAge = pool_.getMaxAge();
+  auto renewAge = maxAge.count() > 0 ?
+    std::chrono::milliseconds(
+      int64_t(maxAge.count() * options_.renewAtAgeFraction)) :
+    std::chrono::milliseconds::max();
+  uint32_t warm = pool_.getNumSessionsYoungerThan(renewAge) + connects_.size();
+  VLOG(5) << "prewarming pool, warm=" << warm << " target=" << targetSessions_
+          << " rate=" << requestRate_;
+  for (; warm < targetSessions_; ++warm) {
+    connects_.emplace_back(*this, timeout_);
+    auto& connect = connects_.back();
+    connect.it_ = std::prev(connects_.end());
+    connect_(connect.connector_);
+  }
+  scheduleTimeout(options_.interval);
+}
+
+void SessionPoolPrewarmer::updateTarget() {
+  auto intervalMs = std::max<int64_t>(options_.interval.count(), 1);
+  auto requests = pool_.getNumTransactionRequests();
+  double rate = double(requests - lastRequests_) * 1000 / intervalMs;
+  lastRequests_ = requests;
+  requestRate_ = kRateAlpha * rate + (1 - kRateAlpha) * requestRate_;
+
+  auto bytesRead = pool_.getBytesRead();
+  throughput_ = kRateAlpha * (double(bytesRead - lastBytesRead_) * 1000 /
+                              intervalMs) +
+    (1 - kRateAlpha) * throughput_;
+  lastBytesRead_ = bytesRead;
+  auto failures = pool_.getNumTransactionFailures();
+  auto stalls = pool_.getNumFlowControlStalls();
+  bool saturated = isSaturated(failures - lastFailures_,
+                               stalls - lastStalls_);
+  lastFailures_ = failures;
+  lastStalls_ = stalls;
+
+  double needed = std::ceil(requestRate_ /
+                            std::max(options_.requestsPerSession, 1.0));
+  if (saturated) {
+    needed = std::max<double>(needed, targetSessions_ + 1);
+  }
+  auto wanted = uint32_t(std::min<double>(
+    std::max<double>(needed, options_.minSessions), options_.maxSessions));
+  if (wanted >= targetSessions_) {
+    targetSessions_ = wanted;
+    intervalsAboveNeed_ = 0;
+  } else if (wouldSaturate(targetSessions_ - 1)) {
+    intervalsAboveNeed_ = 0;
+  } else if (++intervalsAboveNeed_ >= options_.scaleDownIntervals) {
+    targetSessions_--;
+    intervalsAboveNeed_ = 0;
+    // Less load, the gains of more sessions are measured anew
+    throughputAtStallGrowth_ = 0;
+  }
+}
+
+bool SessionPoolPrewarmer::isSaturated(uint64_t failures, uint64_t stalls) {
+  if (options_.saturatedStreamsFraction > 0 &&
+      (failures > 0 || wouldSaturate(pool_.getNumSessions()))) {
+    return true;
+  }
+  if (options_.scaleOnFlowControlStalls && stalls > 0 &&
+      throughput_ >= throughputAtStallGrowth_ *
+                       (1 + options_.minThroughputGain)) {
+    throughputAtStallGrowth_ = throughput_;
+    return true;
+  }
+  return false;
+}
+
+bool SessionPoolPrewarmer::wouldSaturate(uint32_t numSessions) const {
+  auto sessions = pool_.getNumSessions();
+  if (options_.saturatedStreamsFraction <= 0 || sessions == 0) {
+    return false;
+  }
+  // At the average capacity of the sessions
+  double capacity = double(pool_.getMaxConcurrentOutgoingStreams()) *
+    numSessions / sessions;
+  return pool_.getNumOutgoingStreams() >=
+    options_.saturatedStreamsFraction * capacity;
+}
+
+void SessionPoolPrewarmer::onConnectDone(Connect* connect,
+                                         HTTPUpstreamSession* session) {
+  // The connector returns right after its callback
+  connects_.erase(connect->it_);
+  if (session) {
+    pool_.putSession(session);
+  }
+}
+
+void SessionPoolPrewarmer::Connect::connectSuccess(
+    HTTPUpstreamSession* session) {
+  prewarmer_.onConnectDone(this, session);
+}
+
+void SessionPoolPrewarmer::Connect::connectError(
+    const folly::AsyncSocketException& ex) {
+  VLOG(4) << "prewarming connection failed: " << ex.what();
+  // Retried at the next interval
+  prewarmer_.onConnectDone(this, nullptr);
+}
+
+} // namespace proxygen
@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/async/AsyncTimeout.h>
+#include <list>
+#include <proxygen/lib/http/HTTPConnector.h>
+
+#include "proxygen/lib/http/connpool/SessionPool.h"
+
+namespace proxygen {
+
+/**
+ * Keeps warm sessions in a SessionPool, so that requests do not wait for
+ * connection setup after a deploy or a traffic shift.
+ *
+ * Every interval, the prewarmer sets the number of sessions it wants from
+ * the rate of getTransaction() calls on the pool, within [minSessions,
+ * maxSessions], and opens the missing ones with the connect callback.
+ * Sessions close to the pool's maxAge do not count, so that replacements
+ * are ready before they age out.  The target grows as soon as the rate
+ * does, but only shrinks by one session after it stayed higher than needed
+ * for scaleDownIntervals, so it does not oscillate.
+ *
+ * For multiplexed sessions the request rate says little, so the target can
+ * also follow their saturation: it grows by one session per interval while
+ * the open streams reach saturatedStreamsFraction of what the sessions
+ * allow or getTransaction() found none, and while the connection flow
+ * control windows close, as long as the last session added for that raised
+ * the throughput read by minThroughputGain.  It only shrinks when the
+ * streams would not saturate the sessions left.
+ *
+ * The prewarmer raises the pool's maximum idle sessions up to the target;
+ * the pool's idle timeout should be longer than the interval, else warm
+ * sessions are purged and reopened.  It must be used from the thread of
+ * the pool, and destroyed before it.
+ */
+class SessionPoolPrewarmer : private folly::AsyncTimeout {
+ public:
+  struct Options {
+    uint32_t minSessions{1};
+    uint32_t maxSessions{16};
+    // The requests per second one session is expected to serve
+    double requestsPerSession{100};
+    std::chrono::milliseconds interval{1000};
+    // Sessions older than this share of the pool's maxAge are replaced
+    double renewAtAgeFraction{0.9};
+    uint32_t scaleDownIntervals{10};
+    // 0 not to scale on stream saturation, e.g. 0.8
+    double saturatedStreamsFraction{0};
+    bool scaleOnFlowControlStalls{false};
+    double minThroughputGain{0.1};
+  };
+
+  /**
+   * Starts a connection on the connector, e.g. with connect() or
+   * connectSSL() to the endpoint of the pool.
+   */
+  using ConnectCallback = std::function<void(HTTPConnector&)>;
+
+  SessionPoolPrewarmer(SessionPool& pool,
+                       const WheelTimerInstance& timeout,
+                       ConnectCallback connect,
+                       const Options& options);
+  ~SessionPoolPrewarmer() override;
+
+  /**
+   * Checks the pool now, then every interval.
+   */
+  void start();
+  void stop();
+
+  uint32_t getTargetSessions() const {
+    return targetSessions_;
+  }
+
+  uint32_t getNumConnecting() const {
+    return connects_.size();
+  }
+
+  // The smoothed bytes per second read by the pool's sessions
+  double getThroughput() const {
+    return throughput_;
+  }
+
+ private:
+  class Connect : public HTTPConnector::Callback {
+   public:
+    Connect(SessionPoolPrewarmer& prewarmer, const WheelTimerInstance& timeout)
+        : prewarmer_(prewarmer), connector_(this, timeout) {
+    }
+
+    void connectSuccess(HTTPUpstreamSession* session) override;
+    void connectError(const folly::AsyncSocketException& ex) override;
+
+    SessionPoolPrewarmer& prewarmer_;
+    HTTPConnector connector_;
+    std::list<Connect>::iterator it_;
+  };
+
+  void timeoutExpired() noexcept override;
+  void updateTarget();
+  // Whether the pool's sessions need one more
+  bool isSaturated(uint64_t failures, uint64_t stalls);
+  // Whether numSessions sessions would be saturated by the open streams
+  bool wouldSaturate(uint32_t numSessions) const;
+  void onConnectDone(Connect* connect, HTTPUpstreamSession* session);
+
+  SessionPool& pool_;
+  WheelTimerInstance timeout_;
+  ConnectCallback connect_;
+  Options options_;
+  std::list<Connect> connects_;
+  uint64_t lastRequests_{0};
+  double requestRate_{0};
+  uint64_t lastFailures_{0};
+  uint64_t lastStalls_{0};
+  uint64_t lastBytesRead_{0};
+  double throughput_{0};
+  // The throughput when a session was last added for flow control stalls
+  double throughputAtStallGrowth_{0};
+  uint32_t targetSessions_;
+  uint32_t intervalsAboveNeed_{0};
+};
+
+} // namespace proxygen
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/http/connpool/SessionSelectionPolicy.h"
+
+#include <algorithm>
+#include <folly/Random.h>
+#include <limits>
+
+namespace {
+// Keeps sessions without an RTT yet, or on loopback, comparable
+const std::chrono::microseconds kMinRtt{1000};
+}
+
+namespace proxygen {
+
+double SessionSelectionPolicy::getCost(const HTTPSessionBase& session) const {
+  if (session.getConnectionSendWindow() == 0) {
+    return std::numeric_limits<double>::max();
+  }
+  auto rtt = std::max(session.getRtt(), kMinRtt);
+  double cost = double(rtt.count()) * (session.getNumOutgoingStreams() + 1);
+  auto age = millisecondsSince(session.getSetupTransportInfo().acceptTime);
+  if (age < warmupAge_) {
+    cost *= 2;
+  }
+  return cost;
+}
+
+SessionHolder* LeastLoadedSessionPolicy::select(SessionList& sessions) const {
+  SessionHolder* best = nullptr;
+  double bestCost = 0;
+  for (auto& holder : sessions) {
+    auto cost = getCost(holder.getSession());
+    if (!best || cost < bestCost) {
+      best = &holder;
+      bestCost = cost;
+    }
+  }
+  return best;
+}
+
+SessionHolder* PowerOfTwoChoicesSessionPolicy::select(
+    SessionList& sessions) const {
+  auto size = sessions.size();
+  if (size <= 2) {
+    if (size == 2 &&
+        getCost(sessions.back().getSession()) <
+        getCost(sessions.front().getSession())) {
+      return &sessions.back();
+    }
+    return &sessions.front();
+  }
+  // Two distinct positions, in order, to find both in one pass
+  auto first = folly::Random::rand64(size);
+  auto second = folly::Random::rand64(size - 1);
+  if (second >= first) {
+    second++;
+  } else {
+    std::swap(first, second);
+  }
+  auto it = sessions.begin();
+  std::advance(it, first);
+  auto firstHolder = &*it;
+  std::advance(it, second - first);
+  auto secondHolder = &*it;
+  return getCost(secondHolder->getSession()) <
+    getCost(firstHolder->getSession()) ? secondHolder : firstHolder;
+}
+
+} // namespace proxygen
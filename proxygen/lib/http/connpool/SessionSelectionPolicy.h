@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "proxygen/lib/http/connpool/SessionHolder.h"
+
+namespace proxygen {
+
+/**
+ * Picks the session of a SessionPool list to open the next transaction on,
+ * instead of the list order (see SessionPool::setSelectionPolicy()).
+ *
+ * A pool only calls it from its thread, but a policy may be shared by the
+ * pools of several threads.
+ */
+class SessionSelectionPolicy {
+ public:
+  /**
+   * warmupAge is the age under which sessions, whose congestion window is
+   * still opening, cost twice as much.
+   */
+  explicit SessionSelectionPolicy(
+      std::chrono::milliseconds warmupAge = std::chrono::milliseconds(1000))
+      : warmupAge_(warmupAge) {
+  }
+
+  virtual ~SessionSelectionPolicy() {
+  }
+
+  /**
+   * Returns the session of the non empty list to use.
+   */
+  virtual SessionHolder* select(SessionList& sessions) const = 0;
+
+  /**
+   * The cost of opening a transaction on the session, lower is better: the
+   * round trip time scaled by the outstanding transactions, as peak EWMA
+   * load balancers do.  Sessions whose connection flow control window is
+   * closed cost the most.
+   */
+  virtual double getCost(const HTTPSessionBase& session) const;
+
+ protected:
+  std::chrono::milliseconds warmupAge_;
+};
+
+/**
+ * Scans the whole list for the session that costs the least.
+ */
+class LeastLoadedSessionPolicy : public SessionSelectionPolicy {
+ public:
+  using SessionSelectionPolicy::SessionSelectionPolicy;
+
+  SessionHolder* select(SessionList& sessions) const override;
+};
+
+/**
+ * Picks two sessions at random and uses the one that costs the least, which
+ * balances about as well as the least loaded without herding every
+ * transaction on the same session between updates of the costs.
+ */
+class PowerOfTwoChoicesSessionPolicy : public SessionSelectionPolicy {
+ public:
+  using SessionSelectionPolicy::SessionSelectionPolicy;
+
+  SessionHolder* select(SessionList& sessions) const override;
+};
+
+} // namespace proxygen
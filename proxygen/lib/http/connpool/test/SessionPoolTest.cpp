@@ -9,11 +9,16 @@
  */
 #include "proxygen/lib/http/connpool/test/SessionPoolTestFixture.h"
 
+#include "proxygen/lib/http/connpool/HedgedTransaction.h"
+#include "proxygen/lib/http/connpool/OutlierDetector.h"
 #include "proxygen/lib/http/connpool/ServerIdleSessionController.h"
 #include "proxygen/lib/http/connpool/SessionHolder.h"
 #include "proxygen/lib/http/connpool/SessionPool.h"
+#include "proxygen/lib/http/connpool/SessionPoolPrewarmer.h"
+#include "proxygen/lib/http/connpool/SessionSelectionPolicy.h"
 #include "proxygen/lib/http/connpool/ThreadIdleSessionController.h"
 
+#include <folly/io/async/AsyncServerSocket.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <wangle/acceptor/ConnectionManager.h>
 
@@ -229,6 +234,65 @@ TEST_F(SessionPoolFixture, ParallelPoolLists) {
   evb_.loop();
 }
 
+TEST_F(SessionPoolFixture, LeastLoadedSelection) {
+  // With a selection policy, the transactions spread over the sessions
+  // instead of filling the first one
+  SessionPool p(this, 2);
+  p.setSelectionPolicy(std::make_shared<LeastLoadedSessionPolicy>());
+  auto sess1 = makeParallelSession();
+  auto sess2 = makeParallelSession();
+  p.putSession(sess1);
+  p.putSession(sess2);
+
+  std::vector<HTTPTransaction*> txns;
+  for (int i = 0; i < 4; ++i) {
+    txns.push_back(CHECK_NOTNULL(p.getTransaction(this)));
+  }
+  EXPECT_EQ(sess1->getNumOutgoingStreams(), 2);
+  EXPECT_EQ(sess2->getNumOutgoingStreams(), 2);
+
+  // The session with the fewest transactions gets the next one
+  txns.front()->sendAbort();
+  txns.erase(txns.begin());
+  auto lessLoaded = sess1->getNumOutgoingStreams() == 1 ? sess1 : sess2;
+  txns.push_back(CHECK_NOTNULL(p.getTransaction(this)));
+  EXPECT_EQ(lessLoaded->getNumOutgoingStreams(), 2);
+
+  p.setMaxIdleSessions(0);
+  for (auto txn : txns) {
+    txn->sendAbort();
+  }
+  evb_.loop();
+  ASSERT_EQ(closed_, 2);
+}
+
+TEST_F(SessionPoolFixture, PowerOfTwoChoicesSelection) {
+  SessionPool p(this, 4);
+  p.setSelectionPolicy(std::make_shared<PowerOfTwoChoicesSessionPolicy>());
+  std::vector<HTTPUpstreamSession*> sessions;
+  for (int i = 0; i < 4; ++i) {
+    sessions.push_back(makeParallelSession());
+    p.putSession(sessions.back());
+  }
+
+  std::vector<HTTPTransaction*> txns;
+  for (int i = 0; i < 40; ++i) {
+    txns.push_back(CHECK_NOTNULL(p.getTransaction(this)));
+  }
+  // The load stays within a few transactions of even
+  for (auto session : sessions) {
+    EXPECT_GE(session->getNumOutgoingStreams(), 5);
+    EXPECT_LE(session->getNumOutgoingStreams(), 15);
+  }
+
+  p.setMaxIdleSessions(0);
+  for (auto txn : txns) {
+    txn->sendAbort();
+  }
+  evb_.loop();
+  ASSERT_EQ(closed_, 4);
+}
+
 TEST_F(SessionPoolFixture, OutstandingWrites) {
   auto codec = makeSerialCodec();
   EXPECT_CALL(*codec, generateHeader(_, _, _, _, _))
@@ -712,6 +776,233 @@ TEST_F(SessionPoolFixture, ThreadIdleSessionControllerTrackSessionPoolChanges) {
   EXPECT_EQ(p2.getNumIdleSessions(), 1);
 }
 
+TEST_F(SessionPoolFixture, PrewarmerKeepsMinSessions) {
+  // The pool runs in the event base of the thread
+  auto evb = folly::EventBaseManager::get()->getEventBase();
+  // Connections complete in the listen backlog, nothing reads them
+  auto server = folly::AsyncServerSocket::newSocket(evb);
+  server->bind(folly::SocketAddress("127.0.0.1", 0));
+  server->listen(16);
+  folly::SocketAddress addr;
+  server->getAddress(&addr);
+
+  SessionPool p(this, 1, std::chrono::milliseconds(10000));
+  SessionPoolPrewarmer::Options options;
+  options.minSessions = 2;
+  options.interval = std::chrono::milliseconds(10);
+  uint32_t connects = 0;
+  SessionPoolPrewarmer prewarmer(
+    p, WheelTimerInstance(std::chrono::milliseconds(1000), evb),
+    [&] (HTTPConnector& connector) {
+      connects++;
+      connector.connect(evb, addr);
+    },
+    options);
+  prewarmer.start();
+  EXPECT_EQ(connects, 2);
+  EXPECT_EQ(prewarmer.getNumConnecting(), 2);
+  EXPECT_EQ(p.getMaxIdleSessions(), 2);
+
+  while (p.getNumIdleSessions() < 2) {
+    evb->loopOnce();
+  }
+  EXPECT_EQ(prewarmer.getTargetSessions(), 2);
+  EXPECT_EQ(prewarmer.getNumConnecting(), 0);
+
+  // Warm sessions are not connected again
+  bool waiting = true;
+  evb->runAfterDelay([&] { waiting = false; }, 50);
+  while (waiting) {
+    evb->loopOnce();
+  }
+  EXPECT_EQ(connects, 2);
+  prewarmer.stop();
+}
+
+TEST_F(SessionPoolFixture, PrewarmerScalesOnSaturatedStreams) {
+  SessionPool p(this, 1, std::chrono::milliseconds(10000));
+  auto session = makeParallelSession();
+  session->setMaxConcurrentOutgoingStreams(2);
+  p.putSession(session);
+  HTTPTransaction* txns[2];
+  for (auto& txn : txns) {
+    txn = p.getTransaction(this);
+    ASSERT_NE(txn, nullptr);
+  }
+  EXPECT_EQ(p.getTransaction(this), nullptr);
+  EXPECT_EQ(p.getNumTransactionFailures(), 1);
+  EXPECT_EQ(p.getNumOutgoingStreams(), 2);
+  EXPECT_EQ(p.getMaxConcurrentOutgoingStreams(), 2);
+
+  SessionPoolPrewarmer::Options options;
+  options.saturatedStreamsFraction = 0.8;
+  uint32_t connects = 0;
+  SessionPoolPrewarmer prewarmer(
+    p, WheelTimerInstance(timeouts_.get()),
+    [&] (HTTPConnector&) { connects++; },
+    options);
+  prewarmer.start();
+  // One more session for the full one, though no request rate asks for it
+  EXPECT_EQ(prewarmer.getTargetSessions(), 2);
+  EXPECT_EQ(connects, 1);
+  prewarmer.stop();
+
+  p.setMaxIdleSessions(0);
+  for (auto txn : txns) {
+    txn->sendAbort();
+  }
+  evb_.loop();
+  EXPECT_EQ(closed_, 1);
+}
+
+TEST(HedgingPolicyTest, DelayAndBudget) {
+  HedgingPolicy::Options options;
+  options.percentile = 0.5;
+  options.window = 64;
+  options.defaultDelay = std::chrono::milliseconds(20);
+  options.hedgesPerSecond = 0.001;
+  options.hedgesBurst = 2;
+  HedgingPolicy policy(options);
+  EXPECT_EQ(policy.getHedgeDelay(), std::chrono::milliseconds(20));
+
+  for (int i = 1; i <= 64; ++i) {
+    policy.addTimeToHeaders(std::chrono::milliseconds(i));
+  }
+  EXPECT_EQ(policy.getHedgeDelay(), std::chrono::milliseconds(33));
+  // The window forgets the oldest times
+  for (int i = 0; i < 64; ++i) {
+    policy.addTimeToHeaders(std::chrono::milliseconds(5000));
+  }
+  EXPECT_EQ(policy.getHedgeDelay(), options.maxDelay);
+
+  EXPECT_TRUE(policy.tryHedge());
+  EXPECT_TRUE(policy.tryHedge());
+  EXPECT_FALSE(policy.tryHedge());
+  EXPECT_EQ(policy.getNumHedges(), 2);
+  EXPECT_EQ(policy.getNumHedgesDenied(), 1);
+}
+
+TEST_F(SessionPoolFixture, HedgedTransactionHedgeWins) {
+  SessionPool p1(this, 1);
+  SessionPool p2(this, 1);
+  HTTPCodec::Callback* cb2 = nullptr;
+  p1.putSession(makeParallelSession());
+  auto codec = makeParallelCodec();
+  EXPECT_CALL(*codec, setCallback(_)).WillRepeatedly(SaveArg<0>(&cb2));
+  p2.putSession(makeSession(std::move(codec)));
+
+  HedgingPolicy::Options options;
+  options.defaultDelay = std::chrono::milliseconds(10);
+  HedgingPolicy policy(options);
+  HTTPTransaction* txns[2] = {nullptr, nullptr};
+  HedgedTransaction hedged(
+    this, policy, WheelTimerInstance(timeouts_.get()),
+    [&] (HTTPTransaction::Handler* handler, bool hedge) {
+      auto txn = (hedge ? p2 : p1).getTransaction(handler);
+      txns[hedge] = txn;
+      return txn;
+    });
+
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::GET);
+  req.setURL("/");
+  EXPECT_TRUE(hedged.send(req));
+  EXPECT_FALSE(hedged.isHedged());
+  EXPECT_FALSE(attached_);
+  while (!hedged.isHedged()) {
+    evb_.loopOnce();
+  }
+  ASSERT_NE(txns[1], nullptr);
+  EXPECT_EQ(p1.getNumActiveSessions(), 1);
+  EXPECT_EQ(p2.getNumActiveSessions(), 1);
+
+  // The hedge answers first, the first transaction is aborted
+  auto resp = std::make_unique<HTTPMessage>();
+  resp->setStatusCode(200);
+  cb2->onMessageBegin(txns[1]->getID(), resp.get());
+  cb2->onHeadersComplete(txns[1]->getID(), std::move(resp));
+  EXPECT_TRUE(hedged.isDone());
+  EXPECT_TRUE(attached_);
+  EXPECT_EQ(txns[1]->getHandler(), this);
+  EXPECT_EQ(policy.getNumHedges(), 1);
+  evb_.loop();
+  EXPECT_EQ(p1.getNumActiveSessions(), 0);
+
+  txns[1]->sendAbort();
+  p1.setMaxIdleSessions(0);
+  p2.setMaxIdleSessions(0);
+  evb_.loop();
+  EXPECT_EQ(closed_, 2);
+}
+
+TEST(OutlierDetectorTest, EjectWithBackoff) {
+  OutlierDetector::Options options;
+  options.alpha = 0.5;
+  options.minSamples = 2;
+  options.baseEjectionTime = std::chrono::milliseconds(20);
+  options.maxPendingConnects = 1;
+  OutlierDetector detector(options);
+  Endpoint good("good", 80, false);
+  Endpoint bad("bad", 80, false);
+
+  // The only endpoint known is not ejected
+  detector.onError(bad);
+  detector.onError(bad);
+  EXPECT_FALSE(detector.isEjected(bad));
+
+  detector.onResponse(good, 200);
+  detector.onResponse(bad, 503);
+  detector.onError(bad);
+  EXPECT_TRUE(detector.isEjected(bad));
+  EXPECT_FALSE(detector.tryStartConnect(bad));
+  EXPECT_EQ(detector.getNumEjected(), 1);
+  // The other half of the endpoints stays
+  detector.onError(good);
+  detector.onError(good);
+  EXPECT_FALSE(detector.isEjected(good));
+
+  /* sleep override */ usleep(25000);
+  EXPECT_FALSE(detector.isEjected(bad));
+  EXPECT_TRUE(detector.tryStartConnect(bad));
+  EXPECT_FALSE(detector.tryStartConnect(bad));
+  detector.onConnectFinished(bad, false);
+  detector.onError(bad);
+  EXPECT_TRUE(detector.isEjected(bad));
+  EXPECT_EQ(detector.getNumEjections(), 2);
+
+  // Ejected twice in a row, for twice as long
+  /* sleep override */ usleep(25000);
+  EXPECT_TRUE(detector.isEjected(bad));
+  /* sleep override */ usleep(20000);
+  EXPECT_FALSE(detector.isEjected(bad));
+}
+
+TEST_F(SessionPoolFixture, OutlierDetectorDrainsEjectedSessions) {
+  OutlierDetector::Options options;
+  options.minSamples = 1;
+  options.alpha = 1;
+  OutlierDetector detector(options);
+  Endpoint good("good", 80, false);
+  Endpoint bad("bad", 80, false);
+  SessionPool p(this, 2);
+  p.setOutlierDetector(&detector);
+  p.putSession(makeSerialSession(), bad);
+  p.putSession(makeSerialSession(), good);
+
+  detector.onResponse(good, 200);
+  detector.onError(bad);
+  ASSERT_TRUE(detector.isEjected(bad));
+  auto txn = p.getTransaction(this);
+  ASSERT_NE(txn, nullptr);
+  EXPECT_EQ(p.getNumSessions(), 1);
+  EXPECT_EQ(p.getTransaction(this), nullptr);
+
+  txn->sendAbort();
+  p.setMaxIdleSessions(0);
+  evb_.loop();
+  EXPECT_EQ(closed_, 2);
+}
+
 // So we can have -v work
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
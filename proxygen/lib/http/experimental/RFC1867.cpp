@@ -231,8 +231,8 @@ IOBufQueue RFC1867Codec::readToBoundary(bool& foundBoundary) {
     uint64_t len = head->length();
     const uint8_t *ptr = head->data();
 
-    /* iterate through first character matches */
-    while (len > 0 && (ptr = (const uint8_t*)memchr(ptr, boundary_[0], len))) {
+    /* iterate through possible boundary starts */
+    while (len > 0 && (ptr = findBoundary(ptr, len))) {
       /* calculate length after match */
       uint64_t readlen = (ptr - head->data());
       len = head->length() - readlen;
@@ -296,6 +296,30 @@ IOBufQueue RFC1867Codec::readToBoundary(bool& foundBoundary) {
   return result;
 }
 
+const uint8_t* RFC1867Codec::findBoundary(const uint8_t* data,
+                                          size_t len) const {
+  // Boyer-Moore-Horspool over the windows within data, skipping most bytes
+  // of the field rather than stopping at every '\n' of text
+  const size_t boundaryLen = boundary_.length();
+  const uint8_t* ptr = data;
+  const uint8_t* end = data + len;
+  if (len >= boundaryLen) {
+    const uint8_t* lastStart = end - boundaryLen;
+    const uint8_t last = boundary_[boundaryLen - 1];
+    while (ptr <= lastStart) {
+      uint8_t ch = ptr[boundaryLen - 1];
+      if (ch == last && memcmp(ptr, boundary_.data(), boundaryLen - 1) == 0) {
+        return ptr;
+      }
+      ptr += skip_[ch];
+    }
+  }
+  // The skipped starts can't be the boundary, even cut short by the end of
+  // data.  Those left may be the start of a boundary ending in the next
+  // buffer.
+  return (const uint8_t*)memchr(ptr, boundary_[0], end - ptr);
+}
+
 void RFC1867Codec::onIngressEOM() {
   if (state_ == ParserState::FIELD_DATA) {
     LOG(WARNING) << "Field not terminated by boundary";
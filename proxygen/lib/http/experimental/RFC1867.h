@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <array>
 #include <folly/Conv.h>
 #include <proxygen/lib/http/codec/HTTP1xCodec.h>
 
@@ -48,6 +49,11 @@ class RFC1867Codec: HTTPCodec::Callback {
   explicit RFC1867Codec(const std::string& boundary) {
     CHECK(!boundary.empty());
     boundary_ = folly::to<std::string>("\n--", boundary);
+    // Boyer-Moore-Horspool shifts, by the last byte of the window
+    skip_.fill(boundary_.length());
+    for (size_t i = 0; i + 1 < boundary_.length(); i++) {
+      skip_[uint8_t(boundary_[i])] = boundary_.length() - 1 - i;
+    }
     headerParser_.setCallback(this);
   }
 
@@ -107,7 +113,15 @@ class RFC1867Codec: HTTPCodec::Callback {
 
   folly::IOBufQueue readToBoundary(bool& foundBoundary);
 
+  /**
+   * The first position in data where the boundary may start: where it is
+   * whole, or where its first byte is in its last length - 1 bytes, as it
+   * may go on in the next buffer.  nullptr if none.
+   */
+  const uint8_t* findBoundary(const uint8_t* data, size_t len) const;
+
   std::string boundary_;
+  std::array<size_t, 256> skip_;
   Callback* callback_{nullptr};
   ParserState state_{ParserState::START};
   HTTP1xCodec headerParser_{TransportDirection::DOWNSTREAM};
@@ -0,0 +1,172 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/experimental/RFC1867FileSink.h>
+
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/portability/Unistd.h>
+
+namespace proxygen {
+
+int RFC1867FileSink::onFieldStart(const std::string& name,
+                                  folly::Optional<std::string> filename,
+                                  std::unique_ptr<HTTPMessage> msg,
+                                  uint64_t /*postBytesProcessed*/) {
+  if (error_) {
+    return -1;
+  }
+  auto part = std::make_unique<Part>();
+  part->name = name;
+  part->headers = std::move(msg);
+  if (filename) {
+    part->filename = std::move(*filename);
+    std::string path = options_.directory + "/upload-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+      PLOG(ERROR) << "Failed to create a file in " << options_.directory;
+      fail();
+      return -1;
+    }
+    // Only reachable through the descriptor, and gone once closed
+    unlink(path.c_str());
+    part->file = std::make_shared<folly::File>(fd, true);
+  }
+  parts_.push_back(std::move(part));
+  return 0;
+}
+
+int RFC1867FileSink::onFieldData(std::unique_ptr<folly::IOBuf> data,
+                                 uint64_t /*postBytesProcessed*/) {
+  if (error_) {
+    return -1;
+  }
+  auto& part = *parts_.back();
+  part.data.append(std::move(data));
+  if (!part.file) {
+    if (part.data.chainLength() > options_.maxFieldSize) {
+      LOG(ERROR) << "Field " << part.name << " over "
+                 << options_.maxFieldSize << " bytes";
+      fail();
+      return -1;
+    }
+  } else if (part.data.chainLength() >= options_.writeSize) {
+    write(part);
+  }
+  return 0;
+}
+
+void RFC1867FileSink::onFieldEnd(bool endedOnBoundary,
+                                 uint64_t /*postBytesProcessed*/) {
+  if (error_) {
+    return;
+  }
+  if (!endedOnBoundary) {
+    fail();
+    return;
+  }
+  auto& part = *parts_.back();
+  part.ended = true;
+  if (part.file && !part.data.empty()) {
+    write(part);
+  }
+  deliverReady();
+}
+
+void RFC1867FileSink::onError() {
+  fail();
+}
+
+void RFC1867FileSink::onEOM() {
+  eom_ = true;
+  deliverReady();
+}
+
+void RFC1867FileSink::write(Part& part) {
+  auto length = part.data.chainLength();
+  std::shared_ptr<folly::IOBuf> data = part.data.move();
+  auto offset = part.size;
+  part.size += length;
+  part.pendingWrites++;
+  pendingBytes_ += length;
+  if (!paused_ && pendingBytes_ > options_.maxPendingBytes) {
+    paused_ = true;
+    callback_->pauseIngress();
+  }
+
+  std::weak_ptr<bool> alive = alive_;
+  auto partPtr = &part;
+  diskExecutor_->add(
+    [this, evb = evb_, alive, partPtr, file = part.file, data, offset,
+     length] {
+      auto iov = data->getIov();
+      auto written = folly::pwritevFull(file->fd(), iov.data(), iov.size(),
+                                        offset);
+      int error = (written < 0 || size_t(written) != length) ? errno : 0;
+      evb->runInEventBaseThread([this, alive, partPtr, length, error] {
+          // The part is still queued while it has writes in flight
+          if (alive.lock()) {
+            onWriteDone(partPtr, length, error);
+          }
+        });
+    });
+}
+
+void RFC1867FileSink::onWriteDone(Part* part, size_t length, int error) {
+  pendingBytes_ -= length;
+  part->pendingWrites--;
+  if (error_) {
+    return;
+  }
+  if (error != 0) {
+    LOG(ERROR) << "Failed to write " << length << " bytes of "
+               << part->filename << ": " << folly::errnoStr(error);
+    fail();
+    return;
+  }
+  if (paused_ && pendingBytes_ <= options_.maxPendingBytes / 2) {
+    paused_ = false;
+    callback_->resumeIngress();
+  }
+  deliverReady();
+}
+
+void RFC1867FileSink::deliverReady() {
+  while (!error_ && !parts_.empty() && parts_.front()->ended &&
+         parts_.front()->pendingWrites == 0) {
+    auto part = std::move(parts_.front());
+    parts_.pop_front();
+    if (part->file) {
+      // A copy of the descriptor, the writes are done with the shared one
+      folly::File file = part->file->dup();
+      lseek(file.fd(), 0, SEEK_SET);
+      callback_->onFile(part->name, part->filename, std::move(part->headers),
+                        std::move(file), part->size);
+    } else {
+      callback_->onField(part->name, std::move(part->headers),
+                         part->data.move());
+    }
+  }
+  if (!error_ && eom_ && parts_.empty()) {
+    eom_ = false;
+    callback_->onComplete();
+  }
+}
+
+void RFC1867FileSink::fail() {
+  if (error_) {
+    return;
+  }
+  error_ = true;
+  // Parts with writes in flight stay until their completions, dropped then
+  // with the sink
+  callback_->onError();
+}
+
+}
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <deque>
+#include <folly/Executor.h>
+#include <folly/File.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/experimental/RFC1867.h>
+
+namespace proxygen {
+
+/**
+ * An RFC1867Codec::Callback streaming the file parts of a multipart body
+ * (those with a filename) to temporary files, so that large uploads don't
+ * stay in memory.  The other parts are small form fields, held in memory
+ * up to maxFieldSize.
+ *
+ * The data of a file is batched up to writeSize bytes and written by tasks
+ * on the disk executor, the sink staying on its EventBase.  Once more than
+ * maxPendingBytes are waiting to be written, the sink asks to pause
+ * ingress, and to resume once half are written.  Parts are passed on in
+ * order, each file once all written, as an unlinked temporary file: the
+ * handler reads it, or copies it where it belongs.
+ *
+ * The writes in flight when the sink is destroyed complete without
+ * callbacks.
+ */
+class RFC1867FileSink : public RFC1867Codec::Callback {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {}
+
+    virtual void onField(const std::string& name,
+                         std::unique_ptr<HTTPMessage> headers,
+                         std::unique_ptr<folly::IOBuf> value) = 0;
+
+    /**
+     * file is open for reading and writing, at offset 0.
+     */
+    virtual void onFile(const std::string& name,
+                        const std::string& filename,
+                        std::unique_ptr<HTTPMessage> headers,
+                        folly::File file,
+                        uint64_t size) = 0;
+
+    // Once all the parts are passed on, after onEOM()
+    virtual void onComplete() = 0;
+
+    // Parse or write error, or a field over maxFieldSize.  Terminal.
+    virtual void onError() = 0;
+
+    virtual void pauseIngress() = 0;
+    virtual void resumeIngress() = 0;
+  };
+
+  struct Options {
+    std::string directory{"/tmp"};
+    size_t writeSize{256 * 1024};
+    size_t maxPendingBytes{4 * 1024 * 1024};
+    size_t maxFieldSize{64 * 1024};
+  };
+
+  RFC1867FileSink(Callback* callback,
+                  folly::EventBase* evb,
+                  folly::Executor* diskExecutor,
+                  const Options& options)
+      : callback_(callback),
+        evb_(evb),
+        diskExecutor_(diskExecutor),
+        options_(options) {}
+
+  /**
+   * Call after RFC1867Codec::onIngressEOM(), for onComplete() once the last
+   * file is written.
+   */
+  void onEOM();
+
+  // Bytes passed to the disk executor and not yet written
+  size_t getPendingBytes() const {
+    return pendingBytes_;
+  }
+
+  // RFC1867Codec::Callback
+  int onFieldStart(const std::string& name,
+                   folly::Optional<std::string> filename,
+                   std::unique_ptr<HTTPMessage> msg,
+                   uint64_t postBytesProcessed) override;
+  int onFieldData(std::unique_ptr<folly::IOBuf> data,
+                  uint64_t postBytesProcessed) override;
+  void onFieldEnd(bool endedOnBoundary, uint64_t postBytesProcessed) override;
+  void onError() override;
+
+ private:
+  struct Part {
+    std::string name;
+    std::string filename;
+    std::unique_ptr<HTTPMessage> headers;
+    // Set for file parts
+    std::shared_ptr<folly::File> file;
+    // The field value, or the file data not yet passed to be written
+    folly::IOBufQueue data{folly::IOBufQueue::cacheChainLength()};
+    uint64_t size{0};
+    uint32_t pendingWrites{0};
+    bool ended{false};
+  };
+
+  void write(Part& part);
+  void onWriteDone(Part* part, size_t length, int error);
+  void deliverReady();
+  void fail();
+
+  Callback* callback_;
+  folly::EventBase* evb_;
+  folly::Executor* diskExecutor_;
+  const Options options_;
+  std::deque<std::unique_ptr<Part>> parts_;
+  size_t pendingBytes_{0};
+  bool paused_{false};
+  bool eom_{false};
+  bool error_{false};
+  // For the write completions to know whether the sink still exists
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+};
+
+}
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/experimental/RFC1867.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// Parses a multipart POST holding one file of the given size, received in
+// 64KB buffers.  The text file has a line break every 40 bytes on average,
+// and some "\n-" sequences, which all stopped the previous memchr scan.
+
+namespace {
+
+const std::string kBoundary("-----------------------------9051914041544843365");
+const size_t kChunkSize = 64 * 1024;
+
+class NullCallback : public RFC1867Codec::Callback {
+ public:
+  int onFieldStart(const std::string& /*name*/,
+                   folly::Optional<std::string> /*filename*/,
+                   std::unique_ptr<HTTPMessage> /*msg*/,
+                   uint64_t /*postBytesProcessed*/) override {
+    return 0;
+  }
+  int onFieldData(std::unique_ptr<folly::IOBuf> data,
+                  uint64_t /*postBytesProcessed*/) override {
+    bytes += data->computeChainDataLength();
+    return 0;
+  }
+  void onFieldEnd(bool /*endedOnBoundary*/,
+                  uint64_t /*postBytesProcessed*/) override {}
+  void onError() override {
+    CHECK(false) << "parse error";
+  }
+
+  size_t bytes{0};
+};
+
+// One 64KB buffer of text, sent as many times as needed
+std::unique_ptr<IOBuf> makeTextChunk() {
+  std::string text;
+  uint32_t seed = 1;
+  while (text.size() < kChunkSize) {
+    seed = seed * 1103515245 + 12345;
+    auto r = (seed >> 16) % 64;
+    if (r < 2) {
+      text += "\n-";
+    } else if (r < 4) {
+      text += '\n';
+    } else {
+      text += char('a' + r % 26);
+    }
+  }
+  text.resize(kChunkSize);
+  return IOBuf::copyBuffer(text);
+}
+
+void parseUpload(size_t iters, size_t size) {
+  std::unique_ptr<IOBuf> head;
+  std::unique_ptr<IOBuf> chunk;
+  std::unique_ptr<IOBuf> tail;
+  BENCHMARK_SUSPEND {
+    head = IOBuf::copyBuffer(
+      "--" + kBoundary + "\r\n"
+      "Content-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n"
+      "Content-Type: text/plain\r\n"
+      "\r\n");
+    chunk = makeTextChunk();
+    tail = IOBuf::copyBuffer("\r\n--" + kBoundary + "--\r\n");
+  }
+  for (size_t i = 0; i < iters; i++) {
+    NullCallback callback;
+    RFC1867Codec codec(kBoundary);
+    codec.setCallback(&callback);
+    codec.onIngress(head->clone());
+    std::unique_ptr<IOBuf> unparsed;
+    for (size_t sent = 0; sent < size; sent += kChunkSize) {
+      // Buffers are passed as received, never coalesced
+      auto data = chunk->clone();
+      if (unparsed) {
+        unparsed->prependChain(std::move(data));
+        data = std::move(unparsed);
+      }
+      unparsed = codec.onIngress(std::move(data));
+    }
+    auto data = tail->clone();
+    if (unparsed) {
+      unparsed->prependChain(std::move(data));
+      data = std::move(unparsed);
+    }
+    codec.onIngress(std::move(data));
+    codec.onIngressEOM();
+    doNotOptimizeAway(callback.bytes);
+  }
+}
+
+}
+
+BENCHMARK_PARAM(parseUpload, 1 << 20)
+BENCHMARK_PARAM(parseUpload, 16 << 20)
+BENCHMARK_PARAM(parseUpload, 256 << 20)
+BENCHMARK_PARAM(parseUpload, 1 << 30)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/experimental/RFC1867FileSink.h>
+
+#include <folly/FileUtil.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using folly::IOBuf;
+
+namespace {
+
+const std::string kBoundary("abcdef");
+
+class TestCallback : public RFC1867FileSink::Callback {
+ public:
+  void onField(const std::string& name,
+               std::unique_ptr<HTTPMessage> /*headers*/,
+               std::unique_ptr<IOBuf> value) override {
+    fields[name] = value ? value->moveToFbString().toStdString() : "";
+  }
+  void onFile(const std::string& name,
+              const std::string& filename,
+              std::unique_ptr<HTTPMessage> /*headers*/,
+              folly::File file,
+              uint64_t size) override {
+    std::string contents;
+    CHECK(folly::readFile(file.fd(), contents));
+    EXPECT_EQ(size, contents.size());
+    files[name] = std::make_pair(filename, contents);
+  }
+  void onComplete() override {
+    complete = true;
+  }
+  void onError() override {
+    errors++;
+  }
+  void pauseIngress() override {
+    paused = true;
+  }
+  void resumeIngress() override {
+    paused = false;
+  }
+
+  std::map<std::string, std::string> fields;
+  std::map<std::string, std::pair<std::string, std::string>> files;
+  bool complete{false};
+  bool paused{false};
+  int errors{0};
+};
+
+std::string makePart(const std::string& name,
+                     const std::string& filename,
+                     const std::string& value) {
+  std::string part = "--" + kBoundary +
+    "\r\nContent-Disposition: form-data; name=\"" + name + "\"";
+  if (!filename.empty()) {
+    part += "; filename=\"" + filename + "\"";
+  }
+  return part + "\r\n\r\n" + value + "\r\n";
+}
+
+class RFC1867FileSinkTest : public testing::Test {
+ protected:
+  void parse(const std::string& body, size_t chunkSize) {
+    RFC1867Codec codec(kBoundary);
+    codec.setCallback(&sink_);
+    std::unique_ptr<IOBuf> unparsed;
+    for (size_t i = 0; i < body.size(); i += chunkSize) {
+      auto data = IOBuf::copyBuffer(body.substr(i, chunkSize));
+      if (unparsed) {
+        unparsed->prependChain(std::move(data));
+        data = std::move(unparsed);
+      }
+      unparsed = codec.onIngress(std::move(data));
+    }
+    codec.onIngressEOM();
+    sink_.onEOM();
+  }
+
+  void runWrites() {
+    disk_.drain();
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+
+  RFC1867FileSink::Options options() {
+    RFC1867FileSink::Options opts;
+    opts.writeSize = 1000;
+    opts.maxPendingBytes = 4000;
+    opts.maxFieldSize = 100;
+    return opts;
+  }
+
+  TestCallback callback_;
+  folly::EventBase evb_;
+  folly::ManualExecutor disk_;
+  RFC1867FileSink sink_{&callback_, &evb_, &disk_, options()};
+};
+
+}
+
+TEST_F(RFC1867FileSinkTest, FieldsAndFiles) {
+  std::string big(10000, 'x');
+  for (size_t i = 0; i < big.size(); i += 7) {
+    big[i] = char('a' + i % 26);
+  }
+  auto body = makePart("a", "", "1") + makePart("f", "f.txt", big) +
+    makePart("b", "", "2") + "--" + kBoundary + "--\r\n";
+  parse(body, 500);
+
+  // Nothing written yet: the first field only, ingress paused
+  EXPECT_EQ(callback_.fields.size(), 1);
+  EXPECT_TRUE(callback_.files.empty());
+  EXPECT_TRUE(callback_.paused);
+  EXPECT_FALSE(callback_.complete);
+  EXPECT_EQ(sink_.getPendingBytes(), big.size());
+
+  runWrites();
+  EXPECT_FALSE(callback_.paused);
+  EXPECT_EQ(sink_.getPendingBytes(), 0);
+  EXPECT_TRUE(callback_.complete);
+  EXPECT_EQ(callback_.errors, 0);
+  EXPECT_EQ(callback_.fields["a"], "1");
+  EXPECT_EQ(callback_.fields["b"], "2");
+  EXPECT_EQ(callback_.files["f"].first, "f.txt");
+  EXPECT_EQ(callback_.files["f"].second, big);
+}
+
+TEST_F(RFC1867FileSinkTest, FieldTooLarge) {
+  auto body = makePart("a", "", std::string(200, 'x')) + "--" + kBoundary +
+    "--\r\n";
+  parse(body, 50);
+  EXPECT_EQ(callback_.errors, 1);
+  EXPECT_FALSE(callback_.complete);
+}
+
+TEST_F(RFC1867FileSinkTest, DestroyedWithWritesInFlight) {
+  auto body = makePart("f", "f.txt", std::string(3000, 'x'));
+  {
+    TestCallback callback;
+    RFC1867FileSink sink(&callback, &evb_, &disk_, options());
+    RFC1867Codec codec(kBoundary);
+    codec.setCallback(&sink);
+    codec.onIngress(IOBuf::copyBuffer(body));
+  }
+  // The completions find the sink gone
+  runWrites();
+}
@@ -266,7 +266,10 @@ INSTANTIATE_TEST_CASE_P(
     // all \r\n
     string("\r\n\r\n\r\n\r\n", 8),
     // all \r
-    string("\r\r\r\r\r\r\r\r", 8)
+    string("\r\r\r\r\r\r\r\r", 8),
+    // near misses of the boundary, "\n--abcdef"
+    string("\n--abcdeX\r\n--abcde\n-\n--abcdf--abcdef\n--abcde"),
+    string("f\n--abcd\n\n--\n-abcdef-")
   ));
 
 
@@ -29,6 +29,12 @@ cat ${HEADERS_LIST?} | LC_ALL=C sort | uniq \
     };
     next
   }
+  $1 == "&&&&&" {
+    for (i = 1; i <= max; i++) {
+      print "  {\"" n[i] "\", \"" tolower(n[i]) "\", " length(n[i]) "},"
+    };
+    next
+  }
   $1 == "$$$$$" {
     print "  constexpr static uint64_t num_header_codes = " max+2 ";"
     next
@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/AdaptiveStreamLimit.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace proxygen {
+
+namespace {
+double usageRatio(const std::shared_ptr<SessionMemoryBudget>& budget) {
+  if (!budget || budget->getLimit() == 0) {
+    return 0;
+  }
+  return double(budget->getUsage()) / budget->getLimit();
+}
+}
+
+AdaptiveStreamLimit::AdaptiveStreamLimit(const Options& options,
+                                         uint32_t initial)
+    : options_(options),
+      limit_(clamp(initial)) {
+}
+
+uint32_t AdaptiveStreamLimit::update(double utilization) {
+  auto memoryRatio = getMemoryRatio();
+  if (utilization >= options_.highUtilization ||
+      memoryRatio >= options_.highMemoryRatio) {
+    limit_ = clamp(std::floor(limit_ * options_.decreaseFactor));
+  } else if (utilization <= options_.lowUtilization &&
+             memoryRatio <= options_.lowMemoryRatio) {
+    // At least one more, for small limits
+    limit_ = clamp(std::max(std::ceil(limit_ * options_.increaseFactor),
+                            limit_ + 1.0));
+  }
+  return limit_;
+}
+
+double AdaptiveStreamLimit::getMemoryRatio() const {
+  return std::max(usageRatio(options_.egressMemoryBudget),
+                  usageRatio(options_.ingressMemoryBudget));
+}
+
+uint32_t AdaptiveStreamLimit::clamp(double limit) const {
+  return uint32_t(std::min<double>(
+    std::max<double>(limit, options_.minStreams), options_.maxStreams));
+}
+
+}
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include <proxygen/lib/http/session/SessionMemoryBudget.h>
+
+namespace proxygen {
+
+/**
+ * The SETTINGS_MAX_CONCURRENT_STREAMS a worker's sessions advertise,
+ * following its load.  Every interval it is halved (decreaseFactor) while
+ * the worker's thread is busier than highUtilization or a memory budget is
+ * filled past highMemoryRatio, and raised by increaseFactor while both are
+ * under their low marks.  In between it stays put, so the limit doesn't
+ * flap around a single threshold.
+ *
+ * See HTTPSessionAcceptor::setAdaptiveStreamLimit().
+ */
+class AdaptiveStreamLimit {
+ public:
+  struct Options {
+    std::chrono::milliseconds interval{1000};
+    uint32_t minStreams{10};
+    uint32_t maxStreams{1000};
+    // The CPU time of the worker's thread over the interval, 0-1.0
+    double highUtilization{0.8};
+    double lowUtilization{0.5};
+    // The usage of the budgets set to their limit, 0-1.0
+    double highMemoryRatio{0.9};
+    double lowMemoryRatio{0.6};
+    double decreaseFactor{0.5};
+    double increaseFactor{1.25};
+    // Usually the acceptor's, see AcceptorConfiguration
+    std::shared_ptr<SessionMemoryBudget> egressMemoryBudget;
+    std::shared_ptr<SessionMemoryBudget> ingressMemoryBudget;
+  };
+
+  // initial is clamped to [minStreams, maxStreams]
+  AdaptiveStreamLimit(const Options& options, uint32_t initial);
+
+  /**
+   * Adjusts the limit to the utilization of the last interval and the
+   * current memory usage, and returns it.
+   */
+  uint32_t update(double utilization);
+
+  uint32_t getLimit() const {
+    return limit_;
+  }
+
+  /** The fullest budget's usage to its limit */
+  double getMemoryRatio() const;
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+ private:
+  uint32_t clamp(double limit) const;
+
+  const Options options_;
+  uint32_t limit_;
+};
+
+}
@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/BDPEstimator.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace proxygen {
+
+constexpr milliseconds BDPEstimator::kDefaultSampleInterval;
+constexpr uint32_t BDPEstimator::kShrinkSamples;
+
+BDPEstimator::BDPEstimator(uint32_t minWindow,
+                           uint32_t maxWindow,
+                           milliseconds sampleInterval)
+    : minWindow_(minWindow),
+      maxWindow_(std::max(minWindow, maxWindow)),
+      sampleInterval_(sampleInterval) {
+}
+
+bool BDPEstimator::onBytesReceived(uint64_t bytes, TimePoint now) {
+  if (sampling_) {
+    sampleBytes_ += bytes;
+    return false;
+  }
+  // these bytes arrived before the PING goes out, and are not counted
+  return !sampled_ || now - lastSampleTime_ >= sampleInterval_;
+}
+
+void BDPEstimator::onPingSent(TimePoint now) {
+  sampling_ = true;
+  pingTime_ = now;
+  sampleBytes_ = 0;
+}
+
+folly::Optional<uint32_t> BDPEstimator::onPingReply(TimePoint now,
+                                                    uint32_t window) {
+  if (!sampling_) {
+    return folly::none;
+  }
+  sampling_ = false;
+  sampled_ = true;
+  lastSampleTime_ = now;
+
+  auto rtt = std::max(
+    std::chrono::duration_cast<microseconds>(now - pingTime_),
+    microseconds(1));
+  srtt_ = (srtt_.count() == 0) ? rtt : (srtt_ * 7 + rtt) / 8;
+  double bandwidth = sampleBytes_ * 1000000.0 / rtt.count();
+  maxBandwidth_ = std::max(maxBandwidth_, bandwidth);
+  VLOG(4) << "BDP sample of " << sampleBytes_ << " bytes in "
+          << rtt.count() << "us, window=" << window;
+
+  if (sampleBytes_ >= uint64_t(window) * 2 / 3 &&
+      bandwidth >= maxBandwidth_) {
+    // the peer is limited by the window rather than the path
+    smallSamples_ = 0;
+    uint64_t target = std::min<uint64_t>(sampleBytes_ * 2, maxWindow_);
+    if (target > window) {
+      return uint32_t(target);
+    }
+  } else if (sampleBytes_ < window / 4) {
+    if (smallSamples_ == 0) {
+      smallSampleBytes_ = 0;
+    }
+    smallSampleBytes_ = std::max(smallSampleBytes_, sampleBytes_);
+    if (++smallSamples_ >= kShrinkSamples) {
+      // forget the old peak, so the smaller window can grow back
+      smallSamples_ = 0;
+      maxBandwidth_ = bandwidth;
+      uint64_t target = std::max<uint64_t>(smallSampleBytes_ * 2, minWindow_);
+      if (target < window) {
+        return uint32_t(target);
+      }
+    }
+  } else {
+    smallSamples_ = 0;
+  }
+  return folly::none;
+}
+
+}
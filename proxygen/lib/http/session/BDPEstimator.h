@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <proxygen/lib/utils/Time.h>
+
+#include <chrono>
+
+namespace proxygen {
+
+/**
+ * Estimates the bandwidth-delay product of a connection from the bytes it
+ * receives, to size its receive window.
+ *
+ * A sample starts with a PING sent as data arrives, and counts the bytes
+ * received until the reply: what the peer delivers in one round trip.  A
+ * sample filling most of the window means the window, not the path, is
+ * what limits the peer, and the window grows to twice the sample, as long
+ * as the bandwidth keeps up.  After several samples using only a small
+ * share of it, the window shrinks back to twice the largest of them.  The
+ * window stays within [minWindow, maxWindow].
+ */
+class BDPEstimator {
+ public:
+  static constexpr std::chrono::milliseconds kDefaultSampleInterval{100};
+  static constexpr uint32_t kShrinkSamples = 4;
+
+  /**
+   * sampleInterval is the least time between the end of a sample and the
+   * start of the next.
+   */
+  BDPEstimator(uint32_t minWindow,
+               uint32_t maxWindow,
+               std::chrono::milliseconds sampleInterval =
+                 kDefaultSampleInterval);
+
+  /**
+   * Counts bytes received.  Returns true when the caller should send a PING
+   * to start a sample, and call onPingSent.
+   */
+  bool onBytesReceived(uint64_t bytes, TimePoint now);
+
+  void onPingSent(TimePoint now);
+
+  bool isSampling() const {
+    return sampling_;
+  }
+
+  /**
+   * Ends the sample on the PING reply.  Returns the size the receive window,
+   * now window, should be changed to, if any.
+   */
+  folly::Optional<uint32_t> onPingReply(TimePoint now, uint32_t window);
+
+  /**
+   * Smoothed round trip time of the samples, 0 before the first.
+   */
+  std::chrono::microseconds getRtt() const {
+    return srtt_;
+  }
+
+ private:
+  uint32_t minWindow_;
+  uint32_t maxWindow_;
+  std::chrono::milliseconds sampleInterval_;
+
+  TimePoint pingTime_;
+  TimePoint lastSampleTime_;
+  std::chrono::microseconds srtt_{0};
+  uint64_t sampleBytes_{0};
+  // the highest bandwidth a sample has reached, in bytes per second
+  double maxBandwidth_{0};
+  // the largest of the consecutive small samples
+  uint64_t smallSampleBytes_{0};
+  uint32_t smallSamples_{0};
+  bool sampling_{false};
+  bool sampled_{false};
+};
+
+}
@@ -22,7 +22,7 @@ ByteEventTracker::~ByteEventTracker() {
 }
 
 void ByteEventTracker::absorb(ByteEventTracker&& other) {
-  byteEvents_ = std::move(other.byteEvents_);
+  byteEvents_ = std::move(takeByteEvents(other));
 }
 
 // The purpose of self is to represent shared ownership during
@@ -68,9 +68,9 @@ class ByteEventTracker {
   /**
    * The following methods add byte events for tracking
    */
-  void addPingByteEvent(size_t pingSize,
-                        TimePoint timestamp,
-                        uint64_t bytesScheduled);
+  virtual void addPingByteEvent(size_t pingSize,
+                                TimePoint timestamp,
+                                uint64_t bytesScheduled);
 
   virtual void addFirstBodyByteEvent(uint64_t offset,
                                      HTTPTransaction* txn);
@@ -119,9 +119,33 @@ class ByteEventTracker {
 
   virtual void setTTLBAStats(TTLBAStats* /* stats */) {}
 
+  /**
+   * Approximate heap bytes held by the pending events.
+   */
+  virtual size_t getMemoryUsage() const {
+    return byteEvents_.size() * sizeof(TransactionByteEvent);
+  }
+
  protected:
+  using ByteEventList =
+    folly::CountedIntrusiveList<ByteEvent, &ByteEvent::listHook>;
+
   // byteEvents_ is in the ascending order of ByteEvent::byteOffset_
-  folly::CountedIntrusiveList<ByteEvent, &ByteEvent::listHook> byteEvents_;
+  ByteEventList byteEvents_;
+
+  /**
+   * Moves any events kept outside of byteEvents_ into it, in order, so
+   * another tracker can absorb them.
+   */
+  virtual void spillByteEvents() {}
+
+  /**
+   * All the pending events of other, for absorb().
+   */
+  static ByteEventList& takeByteEvents(ByteEventTracker& other) {
+    other.spillByteEvents();
+    return other.byteEvents_;
+  }
 
   /**
    * Called when a FIRST_BYTE event is processed (som = start of message).
@@ -18,6 +18,7 @@ const char* const kTypeStrings[] =  {
   "LAST_BYTE",
   "PING_REPLY_SENT",
   "FIRST_HEADER_BYTE",
+  "TRACKED_BYTE",
 };
 
 std::ostream& operator<<(std::ostream& os, const ByteEvent& be) {
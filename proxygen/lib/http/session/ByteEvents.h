@@ -136,6 +136,8 @@ class AckByteEvent : public TransactionByteEvent {
         timeout(callback, byteNo) {}
 
   AckTimeout timeout;
+  // When the byte left the host, since the CLOCK_REALTIME epoch
+  std::chrono::nanoseconds sentTime{0};
 };
 
 class PingByteEvent : public ByteEvent {
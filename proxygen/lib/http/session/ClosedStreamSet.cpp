@@ -0,0 +1,41 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/ClosedStreamSet.h>
+
+namespace proxygen {
+
+void ClosedStreamSet::add(uint64_t streamID) {
+  uint64_t slot = streamID / 2;
+  if (empty_ || slot > highest_) {
+    // Moving the window forgets the streams that fall out of it
+    if (empty_ || slot - highest_ >= kWindow) {
+      words_.fill(0);
+    } else {
+      for (auto s = highest_ + 1; s <= slot; s++) {
+        clear(s);
+      }
+    }
+    highest_ = slot;
+    empty_ = false;
+  } else if (highest_ - slot >= kWindow) {
+    return;
+  }
+  words_[(slot % kWindow) / kWordBits] |= 1ull << (slot % kWordBits);
+}
+
+bool ClosedStreamSet::contains(uint64_t streamID) const {
+  uint64_t slot = streamID / 2;
+  if (empty_ || slot > highest_ || highest_ - slot >= kWindow) {
+    return false;
+  }
+  return words_[(slot % kWindow) / kWordBits] & (1ull << (slot % kWordBits));
+}
+
+}
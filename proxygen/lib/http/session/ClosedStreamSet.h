@@ -0,0 +1,44 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace proxygen {
+
+/**
+ * The recently closed streams opened by one endpoint, in a 256 byte bitmap.
+ * The stream IDs of an endpoint share their parity, so each bit is one of
+ * its streams: the kWindow streams up to the highest one added are known,
+ * older ones are forgotten.
+ */
+class ClosedStreamSet {
+ public:
+  static constexpr uint64_t kWindow = 2048;
+
+  void add(uint64_t streamID);
+
+  bool contains(uint64_t streamID) const;
+
+ private:
+  static constexpr uint64_t kWordBits = 64;
+
+  void clear(uint64_t slot) {
+    words_[(slot % kWindow) / kWordBits] &= ~(1ull << (slot % kWordBits));
+  }
+
+  std::array<uint64_t, kWindow / kWordBits> words_{};
+  // The slot (streamID / 2) of the highest stream added
+  uint64_t highest_{0};
+  bool empty_{true};
+};
+
+}
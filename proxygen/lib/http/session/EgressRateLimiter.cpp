@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/EgressRateLimiter.h>
+
+#include <limits>
+
+namespace proxygen {
+
+const uint64_t EgressRateLimiter::kWakeupBytes;
+
+EgressRateLimiter::EgressRateLimiter(
+    folly::HHWheelTimer& timer,
+    uint64_t bitsPerSecond,
+    uint64_t burstBytes,
+    std::shared_ptr<EgressRateLimiter> parent)
+    : timer_(timer),
+      parent_(std::move(parent)),
+      lastRefill_(getCurrentTime()) {
+  setRate(bitsPerSecond, burstBytes);
+  tokens_ = burstBytes_;
+}
+
+void EgressRateLimiter::setRate(uint64_t bitsPerSecond, uint64_t burstBytes) {
+  refill(getCurrentTime());
+  bytesPerSecond_ = bitsPerSecond / 8;
+  // Less than a packet would never wake anyone
+  burstBytes_ = std::max(burstBytes, kWakeupBytes);
+  tokens_ = std::min<int64_t>(tokens_, burstBytes_);
+  if (!waiters_.empty()) {
+    wakeupCallback_.cancelTimeout();
+    scheduleWakeup();
+  }
+}
+
+void EgressRateLimiter::refill(TimePoint now) {
+  if (bytesPerSecond_ == 0 || tokens_ >= int64_t(burstBytes_)) {
+    lastRefill_ = now;
+    return;
+  }
+  auto elapsedUs = microsecondsBetween(now, lastRefill_).count();
+  if (elapsedUs <= 0) {
+    return;
+  }
+  // Capped so that the product can't overflow
+  uint64_t maxUs =
+    (burstBytes_ - tokens_) * uint64_t(1000000) / bytesPerSecond_ + 1;
+  uint64_t earned =
+    std::min<uint64_t>(elapsedUs, maxUs) * bytesPerSecond_ / 1000000;
+  if (earned == 0) {
+    // Keep the fraction for the next time
+    return;
+  }
+  tokens_ = std::min<int64_t>(tokens_ + int64_t(earned), burstBytes_);
+  lastRefill_ = now;
+}
+
+uint64_t EgressRateLimiter::getAvailable() {
+  auto now = getCurrentTime();
+  uint64_t available = std::numeric_limits<uint64_t>::max();
+  for (auto bucket = this; bucket; bucket = bucket->parent_.get()) {
+    if (bucket->bytesPerSecond_ == 0) {
+      continue;
+    }
+    bucket->refill(now);
+    available = std::min<uint64_t>(available,
+                                   std::max<int64_t>(bucket->tokens_, 0));
+  }
+  return available;
+}
+
+void EgressRateLimiter::consume(uint64_t bytes) {
+  for (auto bucket = this; bucket; bucket = bucket->parent_.get()) {
+    if (bucket->bytesPerSecond_ > 0) {
+      bucket->tokens_ -= bytes;
+    }
+  }
+}
+
+void EgressRateLimiter::wait(HTTPTransaction& txn) {
+  EgressRateLimiter* emptiest = nullptr;
+  for (auto bucket = this; bucket; bucket = bucket->parent_.get()) {
+    if (bucket->bytesPerSecond_ > 0 &&
+        (!emptiest || bucket->tokens_ < emptiest->tokens_)) {
+      emptiest = bucket;
+    }
+  }
+  if (!emptiest) {
+    emptiest = this;
+  }
+  txn.rateLimiterHook_.unlink();
+  emptiest->waiters_.push_back(txn);
+  emptiest->scheduleWakeup();
+}
+
+void EgressRateLimiter::scheduleWakeup() {
+  if (wakeupCallback_.isScheduled()) {
+    return;
+  }
+  std::chrono::milliseconds delay(0);
+  if (bytesPerSecond_ > 0 && tokens_ < int64_t(kWakeupBytes)) {
+    // Rounded up, to not wake up before the tokens are there
+    uint64_t needed = kWakeupBytes - tokens_;
+    delay = std::chrono::milliseconds(
+      (needed * 1000 + bytesPerSecond_ - 1) / bytesPerSecond_);
+  }
+  timer_.scheduleTimeout(&wakeupCallback_, std::max(
+                           delay, std::chrono::milliseconds(1)));
+}
+
+void EgressRateLimiter::wakeupTimeoutExpired() {
+  // The last waiter may hold the last reference
+  auto self = shared_from_this();
+  refill(getCurrentTime());
+  if (bytesPerSecond_ > 0 && tokens_ < int64_t(kWakeupBytes)) {
+    scheduleWakeup();
+    return;
+  }
+  // Waiters limited by another bucket up the chain will wait there
+  WaiterList ready;
+  ready.swap(waiters_);
+  while (!ready.empty()) {
+    auto& txn = ready.front();
+    ready.pop_front();
+    txn.onEgressRateLimiterReady();
+  }
+}
+
+}
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IntrusiveList.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/utils/Time.h>
+
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * A token bucket limiting the egress of all the transactions given to it
+ * with HTTPTransaction::setEgressRateLimiter(), whatever their session: a
+ * bucket may stand for a session, a client IP address or a tenant.  With a
+ * parent, the bytes are taken from the parent's bucket too, so that the
+ * transactions of a client also share the limit of its tenant.
+ *
+ * A transaction finding no tokens up its chain leaves its session's egress
+ * queue and waits on the bucket that ran dry.  That bucket schedules one
+ * wheel timer timeout, for when it refilled kWakeupBytes, then returns all
+ * its waiters to their egress queues, where priorities decide who sends.
+ *
+ * Buckets are shared, make them with std::make_shared.  A bucket and its
+ * parents, and the transactions using them, must all live on the thread of
+ * the timer.
+ */
+class EgressRateLimiter
+    : public std::enable_shared_from_this<EgressRateLimiter> {
+ public:
+  // The tokens a waiting transaction is woken up for, about one packet
+  static const uint64_t kWakeupBytes = 1500;
+
+  /**
+   * A rate of 0 does not limit.  burstBytes is the most tokens the bucket
+   * holds, what an idle bucket lets go at once.
+   */
+  EgressRateLimiter(folly::HHWheelTimer& timer,
+                    uint64_t bitsPerSecond,
+                    uint64_t burstBytes,
+                    std::shared_ptr<EgressRateLimiter> parent = nullptr);
+
+  EgressRateLimiter(const EgressRateLimiter&) = delete;
+  EgressRateLimiter& operator=(const EgressRateLimiter&) = delete;
+
+  void setRate(uint64_t bitsPerSecond, uint64_t burstBytes);
+
+  const std::shared_ptr<EgressRateLimiter>& getParent() const {
+    return parent_;
+  }
+
+  // The bytes that this bucket and its parents all allow now
+  uint64_t getAvailable();
+
+  // Takes bytes sent from this bucket and its parents, which may go into debt
+  void consume(uint64_t bytes);
+
+  // The transactions waiting on this bucket, linear in their number
+  size_t getNumWaiters() const {
+    return waiters_.size();
+  }
+
+ private:
+  friend class HTTPTransaction;
+
+  class WakeupCallback : public folly::HHWheelTimer::Callback {
+   public:
+    explicit WakeupCallback(EgressRateLimiter& limiter)
+        : limiter_(limiter) {}
+
+    void timeoutExpired() noexcept override {
+      limiter_.wakeupTimeoutExpired();
+    }
+    void callbackCanceled() noexcept override {
+      // no op
+    }
+   private:
+    EgressRateLimiter& limiter_;
+  };
+
+  using WaiterList =
+    folly::IntrusiveList<HTTPTransaction, &HTTPTransaction::rateLimiterHook_>;
+
+  // Adds the tokens earned since the last refill
+  void refill(TimePoint now);
+
+  // Parks txn on the bucket up the chain with the fewest tokens
+  void wait(HTTPTransaction& txn);
+
+  void scheduleWakeup();
+
+  void wakeupTimeoutExpired();
+
+  folly::HHWheelTimer& timer_;
+  std::shared_ptr<EgressRateLimiter> parent_;
+  uint64_t bytesPerSecond_{0};
+  uint64_t burstBytes_{0};
+  int64_t tokens_{0};
+  TimePoint lastRefill_;
+  // Waiters unlink themselves when they go away
+  WaiterList waiters_;
+  WakeupCallback wakeupCallback_{*this};
+};
+
+}
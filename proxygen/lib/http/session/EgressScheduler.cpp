@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/EgressScheduler.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+const uint32_t EgressScheduler::kDefaultQuantum;
+
+EgressScheduler::Callback::~Callback() {
+  cancelScheduledEgress();
+  if (destroyed_) {
+    *destroyed_ = true;
+  }
+}
+
+void EgressScheduler::Callback::cancelScheduledEgress() {
+  if (hook_.is_linked()) {
+    hook_.unlink();
+  }
+}
+
+EgressScheduler::EgressScheduler(folly::EventBase* evb, uint32_t quantum)
+    : evb_(evb), quantum_(quantum > 0 ? quantum : kDefaultQuantum) {}
+
+EgressScheduler::~EgressScheduler() {
+  sparse_.clear();
+  bulk_.clear();
+}
+
+void EgressScheduler::schedule(Callback& callback) {
+  DCHECK(evb_->isInEventBaseThread());
+  if (callback.isEgressScheduled()) {
+    return;
+  }
+  (callback.bulk_ ? bulk_ : sparse_).push_back(callback);
+  if (!isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void EgressScheduler::runLoopCallback() noexcept {
+  // The last session may go away in its turn
+  auto self = shared_from_this();
+  // Callbacks scheduling themselves again wait for the next round
+  CallbackList sparse;
+  CallbackList bulk;
+  sparse.swap(sparse_);
+  bulk.swap(bulk_);
+  while (!sparse.empty()) {
+    auto& callback = sparse.front();
+    callback.deficit_ = quantum_;
+    runTurn(sparse, quantum_);
+  }
+  while (!bulk.empty()) {
+    auto& callback = bulk.front();
+    callback.deficit_ += quantum_;
+    runTurn(bulk, callback.deficit_ > 0 ? callback.deficit_ : 0);
+  }
+}
+
+void EgressScheduler::runTurn(CallbackList& list, uint64_t budget) {
+  auto& callback = list.front();
+  list.pop_front();
+  bool destroyed = false;
+  callback.destroyed_ = &destroyed;
+  uint64_t written = budget > 0 ? callback.runScheduledEgress(budget) : 0;
+  if (destroyed) {
+    return;
+  }
+  callback.destroyed_ = nullptr;
+  if (budget == 0) {
+    // Still paying off the last overshoot
+    schedule(callback);
+    return;
+  }
+  callback.deficit_ -= written;
+  if (written >= budget) {
+    // A bulk session from the next round, even if now blocked on a write
+    callback.bulk_ = true;
+    if (callback.isEgressScheduled()) {
+      callback.hook_.unlink();
+      bulk_.push_back(callback);
+    } else {
+      callback.deficit_ = std::min<int64_t>(callback.deficit_, 0);
+    }
+  } else if (!callback.isEgressScheduled() && written > 0) {
+    // It wrote all it had, and is sparse again
+    callback.bulk_ = false;
+    callback.deficit_ = 0;
+  }
+}
+
+}
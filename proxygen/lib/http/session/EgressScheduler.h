@@ -0,0 +1,106 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IntrusiveList.h>
+#include <folly/io/async/EventBase.h>
+
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Shares the egress of one EventBase fairly among its sessions: instead of
+ * each writing from its own loop callback, in whatever order the loop runs
+ * them and for as long as it has egress, the sessions given to the
+ * scheduler (see HTTPSession::setEgressScheduler()) write from its single
+ * loop callback, each at most its deficit of bytes per loop iteration.
+ *
+ * This is deficit round robin with the sparse flow class of FQ-CoDel: a
+ * session that was not backlogged gets a quantum and writes before all the
+ * others, so that small responses never queue behind bulk downloads.  One
+ * that used up its quantum and still has egress goes to the bulk class,
+ * where each round adds a quantum to its deficit, until it has no egress
+ * left at the end of a turn.
+ *
+ * Schedulers are shared by their sessions, make them with std::make_shared.
+ * One lives on the thread of its EventBase, like the sessions it schedules.
+ */
+class EgressScheduler
+    : public std::enable_shared_from_this<EgressScheduler>,
+      private folly::EventBase::LoopCallback {
+ public:
+  static const uint32_t kDefaultQuantum = 64 * 1024;
+
+  class Callback {
+   public:
+    virtual ~Callback();
+
+    /**
+     * Writes at most about budget bytes, frames and all, and returns the
+     * bytes written.  Calls schedule() again if some egress is left.
+     */
+    virtual uint64_t runScheduledEgress(uint64_t budget) noexcept = 0;
+
+    bool isEgressScheduled() const {
+      return hook_.is_linked();
+    }
+
+    // Takes the callback out of the current round, if it is in one
+    void cancelScheduledEgress();
+
+   private:
+    friend class EgressScheduler;
+
+    folly::IntrusiveListHook hook_;
+    // Set in its turn, for the scheduler to know it went away
+    bool* destroyed_{nullptr};
+    int64_t deficit_{0};
+    bool bulk_{false};
+  };
+
+  explicit EgressScheduler(folly::EventBase* evb,
+                           uint32_t quantum = kDefaultQuantum);
+
+  ~EgressScheduler() override;
+
+  EgressScheduler(const EgressScheduler&) = delete;
+  EgressScheduler& operator=(const EgressScheduler&) = delete;
+
+  folly::EventBase* getEventBase() const {
+    return evb_;
+  }
+
+  /**
+   * Gives callback a turn in the next round, in this loop iteration unless
+   * the round is already running.
+   */
+  void schedule(Callback& callback);
+
+  size_t getNumScheduled() const {
+    return sparse_.size() + bulk_.size();
+  }
+
+ private:
+  using CallbackList =
+    folly::IntrusiveList<Callback, &Callback::hook_>;
+
+  void runLoopCallback() noexcept override;
+
+  // Runs the turn of the callback at the front of list, with budget
+  void runTurn(CallbackList& list, uint64_t budget);
+
+  folly::EventBase* evb_;
+  const uint64_t quantum_;
+  CallbackList sparse_;
+  CallbackList bulk_;
+};
+
+}
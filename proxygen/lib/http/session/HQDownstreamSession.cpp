@@ -32,8 +32,10 @@ void HQDownstreamSession::onConnectionErrorHandler(
 
 void HQDownstreamSession::setupOnHeadersComplete(HTTPTransaction* txn,
                                                  HTTPMessage* msg) {
-  HTTPTransaction::Handler* handler =
-      getController()->getRequestHandler(*txn, msg);
+  HTTPTransaction::Handler* handler = getAdmissionRejectHandler();
+  if (!handler) {
+    handler = getController()->getRequestHandler(*txn, msg);
+  }
   CHECK(handler);
   txn->setHandler(handler);
   setNewTransactionPauseState(txn);
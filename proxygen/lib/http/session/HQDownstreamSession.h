@@ -58,9 +58,9 @@ class HQDownstreamSession : public HQSession {
 
   void detachThreadLocals(bool) override;
 
+  // False while the client's 0-RTT data is being received
   bool isReplaySafe() const override {
-    LOG(FATAL) << __func__ << " is an upstream interface";
-    return false;
+    return sock_ ? sock_->replaySafe() : false;
   }
 
  private:
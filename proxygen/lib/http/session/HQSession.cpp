@@ -18,6 +18,8 @@
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/http/session/RFC9218PriorityQueue.h>
+#include <proxygen/lib/utils/CoarseTime.h>
 
 #include <boost/cast.hpp>
 #include <folly/Format.h>
@@ -29,6 +31,7 @@
 #include <folly/io/async/DelayedDestructionBase.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/HHWheelTimer.h>
+#include <folly/tracing/StaticTracepoint.h>
 #include <wangle/acceptor/ConnectionManager.h>
 
 namespace {
@@ -37,6 +40,7 @@ static const std::string kNoProtocolString("");
 static const std::string kH1QV1ProtocolString("h1q-fb");
 static const std::string kH1QLigerProtocolString("h1q");
 static const std::string kH1QV2ProtocolString("h1q-fb-v2");
+static const std::string kPriorityHeader("priority");
 static const std::string kQUICProtocolName("QUIC");
 
 // handleSessionError is mostly setup to process application error codes
@@ -72,6 +76,9 @@ const http2::PriorityUpdate hqDefaultPriority{kSessionStreamId, false, 15};
 HQSession::~HQSession() {
   VLOG(3) << *this << " closing";
   CHECK_EQ(numberOfStreams(), 0);
+  if (sessionStats_ && versionUtils_) {
+    versionUtils_->recordQPACKStats(*sessionStats_);
+  }
   runDestroyCallbacks();
 }
 
@@ -82,6 +89,36 @@ void HQSession::setSessionStats(HTTPSessionStats* stats) {
   });
 }
 
+HTTPSessionMemoryUsage HQSession::getMemoryUsage() const {
+  auto usage = HTTPSessionBase::getMemoryUsage();
+  if (versionUtils_) {
+    usage.codec = versionUtils_->getMemoryUsage();
+  }
+  for (const auto& it : streams_) {
+    it.second.addMemoryUsage(usage);
+  }
+  for (const auto& it : egressPushStreams_) {
+    it.second.addMemoryUsage(usage);
+  }
+  for (const auto& it : ingressPushStreams_) {
+    it.second.addMemoryUsage(usage);
+  }
+  return usage;
+}
+
+void HQSession::hibernate() noexcept {
+  if (numberOfStreams() > 0 || !versionUtils_) {
+    return;
+  }
+  VLOG(4) << "Hibernating " << *this;
+  auto bytesBefore = getMemoryUsage().total();
+  versionUtils_->hibernate();
+  if (sessionStats_) {
+    sessionStats_->recordSessionHibernated(bytesBefore,
+                                           getMemoryUsage().total());
+  }
+}
+
 void HQSession::setPartiallyReliableCallbacks(quic::StreamId id) {
   sock_->setDataExpiredCallback(id, &unidirectionalReadDispatcher_);
   sock_->setDataRejectedCallback(id, &unidirectionalReadDispatcher_);
@@ -98,6 +135,13 @@ void HQSession::onNewBidirectionalStream(quic::StreamId id) noexcept {
   }
   auto hqStream = findNonDetachedStream(id);
   DCHECK(!hqStream);
+  if (getNumIncomingStreams() >= maxConcurrentIncomingStreams_) {
+    VLOG(3) << "Refusing streamID=" << id << " over the limit of "
+            << maxConcurrentIncomingStreams_ << " sess=" << *this;
+    sock_->stopSending(id, HTTP3::ErrorCode::HTTP_REQUEST_REJECTED);
+    sock_->resetStream(id, HTTP3::ErrorCode::HTTP_REQUEST_REJECTED);
+    return;
+  }
   hqStream = createStreamTransport(id);
   DCHECK(hqStream);
   sock_->setReadCallback(id, this);
@@ -202,6 +246,13 @@ bool HQSession::onTransportReadyCommon() noexcept {
   if (!versionUtils_->createEgressControlStreams()) {
     return false;
   }
+  if (datagramOptions_.enabled && version_ == HQVersion::HQ) {
+    auto res = sock_->setDatagramCallback(this);
+    if (res.hasError()) {
+      LOG(ERROR) << "Failed to set the datagram callback err=" << res.error()
+                 << " sess=" << *this;
+    }
+  }
   // Apply the default settings
   // TODO: 0-RTT settings
   versionUtils_->applySettings({});
@@ -547,6 +598,57 @@ bool HQSession::getCurrentTransportInfoWithoutUpdate(
   return true;
 }
 
+void HQSession::maybeTuneQPACKVulnerable() {
+  if (!qpackVulnerablePolicy_.adaptive || !sock_ || !versionUtils_) {
+    return;
+  }
+  auto now = getCoarseTime(getEventBase());
+  if (lastQPACKSampleTime_ &&
+      now - *lastQPACKSampleTime_ < qpackVulnerablePolicy_.sampleInterval) {
+    return;
+  }
+  auto quicInfo = sock_->getTransportInfo();
+  // Packets estimated from bytes, as the cwnd above
+  uint64_t packets = quicInfo.bytesSent / quic::kDefaultUDPSendPacketLen;
+  uint64_t retransmits = quicInfo.packetsRetransmitted;
+  if (!lastQPACKSampleTime_) {
+    lastQPACKSampleTime_ = now;
+    lastQPACKSamplePackets_ = packets;
+    lastQPACKSampleRetransmits_ = retransmits;
+    return;
+  }
+  auto sent = packets - lastQPACKSamplePackets_;
+  if (sent < std::max<uint64_t>(qpackVulnerablePolicy_.minPackets, 1)) {
+    return;
+  }
+  double lossRate =
+      static_cast<double>(retransmits - lastQPACKSampleRetransmits_) / sent;
+  lastQPACKSampleTime_ = now;
+  lastQPACKSamplePackets_ = packets;
+  lastQPACKSampleRetransmits_ = retransmits;
+
+  const auto& policy = qpackVulnerablePolicy_;
+  double fraction = 1.0;
+  if (lossRate >= policy.highLossRate) {
+    fraction = 0.0;
+  } else if (lossRate > policy.lowLossRate) {
+    fraction = (policy.highLossRate - lossRate) /
+               (policy.highLossRate - policy.lowLossRate);
+  }
+  if (quicInfo.srtt > policy.highRtt) {
+    fraction /= 2;
+  }
+  auto budget = versionUtils_->scaleQPACKVulnerable(fraction);
+  if (!budget) {
+    return;
+  }
+  VLOG(4) << "QPACK vulnerable budget=" << *budget << " loss=" << lossRate
+          << " srtt=" << quicInfo.srtt.count() << " sess=" << *this;
+  if (sessionStats_) {
+    sessionStats_->recordQPACKVulnerableBudget(*budget);
+  }
+}
+
 bool HQSession::getCurrentStreamTransportInfo(QuicStreamProtocolInfo* qspinfo,
                                               quic::StreamId streamId) {
   if (sock_) {
@@ -699,6 +801,9 @@ size_t HQSession::HQVersionUtils::sendSettings() {
         case hq::SettingId::NUM_PLACEHOLDERS:
           // TODO: priorities not implemented yet
           break;
+        case hq::SettingId::H3_DATAGRAM:
+        case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
+          break;
       }
     }
   }
@@ -775,6 +880,8 @@ void HQSession::dropConnectionWithError(
   }
   drainState_ = DrainState::DONE;
   cancelLoopCallback();
+  qpackFlushTimeout_.cancelTimeout();
+  hibernateTimer_.cancelTimeout();
   checkForShutdown();
   unidirectionalReadDispatcher_.invokeOnPendingStreamIDs(
       [&](quic::StreamId pendingStreamId) {
@@ -1103,8 +1210,10 @@ void HQSession::runLoopCallback() noexcept {
   // Then handle the writes
   // Write all the control streams first
   maxToSend_ -= writeControlStreams(maxToSend_);
+  // Then the datagrams, which are not flow controlled
+  writeDatagrams();
   // Then write the request streams
-  if (!txnEgressQueue_.empty() && maxToSend_ > 0) {
+  if (!txnEgressQueue_->empty() && maxToSend_ > 0) {
     // TODO: we could send FIN only?
     writeRequestStreams(maxToSend_);
   }
@@ -1112,13 +1221,13 @@ void HQSession::runLoopCallback() noexcept {
   // onWriteReady call
   maxToSend_ = 0;
 
-  if (!txnEgressQueue_.empty()) {
+  if (!txnEgressQueue_->empty() || !datagramEgress_.empty()) {
     scheduleWrite();
   }
 
   // Maybe schedule the next loop callback
   VLOG(4) << "sess=" << *this << " maybe schedule the next loop callback. "
-          << " pending writes: " << !txnEgressQueue_.empty()
+          << " pending writes: " << !txnEgressQueue_->empty()
           << " pending processing reads: " << pendingProcessReadSet_.size();
   if (!pendingProcessReadSet_.empty()) {
     scheduleLoopCallback(false);
@@ -1639,40 +1748,78 @@ void HQSession::readRequestStream(quic::StreamId id) noexcept {
 }
 
 void HQSession::processReadData() {
+  auto start = std::chrono::steady_clock::now();
+  size_t processed = 0;
+  auto outOfTime = [&] {
+    return readProcessingBudget_.count() > 0 && processed > 0 &&
+      std::chrono::steady_clock::now() - start >= readProcessingBudget_;
+  };
+
+  // The streams a previous budget left over first, so that none waits more
+  // than an iteration behind newly readable ones
+  std::vector<quic::StreamId> deferred;
+  deferred.swap(deferredProcessReads_);
+  for (size_t i = 0; i < deferred.size(); i++) {
+    if (outOfTime()) {
+      deferredProcessReads_.assign(deferred.begin() + i, deferred.end());
+      return;
+    }
+    if (pendingProcessReadSet_.find(deferred[i]) ==
+        pendingProcessReadSet_.end()) {
+      continue;
+    }
+    processReadData(deferred[i]);
+    // the codec may not have processed all the data, but we won't ask again
+    // until we get more
+    pendingProcessReadSet_.erase(deferred[i]);
+    processed++;
+  }
+
   for (auto it = pendingProcessReadSet_.begin();
        it != pendingProcessReadSet_.end();) {
+    if (outOfTime()) {
+      for (; it != pendingProcessReadSet_.end(); ++it) {
+        deferredProcessReads_.push_back(*it);
+      }
+      return;
+    }
     auto g = folly::makeGuard([&]() {
       // the codec may not have processed all the data, but we won't ask again
       // until we get more
       // TODO: set a timeout?
       it = pendingProcessReadSet_.erase(it);
     });
+    processReadData(*it);
+    processed++;
+  }
+}
 
-    HQStreamTransportBase* ingressStream =
-        findIngressStream(*it, true /* includeDetached */);
+void HQSession::processReadData(quic::StreamId id) {
+  HQStreamTransportBase* ingressStream =
+      findIngressStream(id, true /* includeDetached */);
 
-    if (!ingressStream) {
-      // ingress on a transaction may cause other transactions to get deleted
-      continue;
-    }
+  if (!ingressStream) {
+    // ingress on a transaction may cause other transactions to get deleted
+    return;
+  }
 
-    // Check whether the stream has been detached
-    if (ingressStream->detached_) {
-      VLOG(4) << __func__ << " killing pending read data for detached txn="
-              << ingressStream->txn_;
-      ingressStream->readBuf_.move();
-      ingressStream->readEOF_ = false;
-      continue;
-    }
+  // Check whether the stream has been detached
+  if (ingressStream->detached_) {
+    VLOG(4) << __func__ << " killing pending read data for detached txn="
+            << ingressStream->txn_;
+    ingressStream->readBuf_.move();
+    ingressStream->readEOF_ = false;
+    return;
+  }
 
-    // Feed it to the codec
-    auto blocked = ingressStream->processReadData();
-    if (!blocked) {
-      if (ingressStream->readEOF_) {
-        ingressStream->onIngressEOF();
-      }
-      continue;
-    }
+  // Feed it to the codec
+  auto blocked = ingressStream->processReadData();
+  if (!ingressStream->detached_) {
+    // Body the transaction coalesces is delivered once per read
+    ingressStream->txn_.flushIngressBody();
+  }
+  if (!blocked && ingressStream->readEOF_) {
+    ingressStream->onIngressEOF();
   }
 }
 
@@ -1698,7 +1845,7 @@ void HQSession::HQVersionUtils::headersComplete(HTTPMessage* /*msg*/) {
       session_.findControlStream(UnidirectionalStreamType::QPACK_DECODER);
 
   if (QPACKDecoderStream && !QPACKDecoderStream->writeBuf_.empty()) {
-    session_.scheduleWrite();
+    session_.scheduleQPACKDecoderStreamWrite(*QPACKDecoderStream);
   }
 }
 
@@ -1748,6 +1895,12 @@ void HQSession::HQVersionUtils::applySettings(const SettingsList& settings) {
           numPlaceholders = setting.value;
           (void)numPlaceholders;
           break;
+        case hq::SettingId::H3_DATAGRAM:
+          session_.peerDatagrams_ = setting.value == 1;
+          break;
+        case hq::SettingId::ENABLE_CONNECT_PROTOCOL:
+          // stored in ingressSettings_, see peerHasWebsockets
+          break;
       }
     }
   }
@@ -1765,6 +1918,23 @@ void HQSession::HQVersionUtils::onSettings(const SettingsList& settings) {
   }
 }
 
+void HQSession::onPriority(quic::StreamId streamId,
+                           const HTTPMessage::HTTPPriority& priority) {
+  if (!getHTTP2PrioritiesEnabled()) {
+    return;
+  }
+  auto stream = findNonDetachedStream(streamId);
+  if (!stream) {
+    VLOG(4) << "Ignoring PRIORITY for unknown streamID=" << streamId
+            << " sess=" << *this;
+    return;
+  }
+  // Streams are all children of the root: the dependency is dropped and
+  // only the weight is kept, which RFC9218PriorityQueue maps onto an urgency
+  stream->txn_.onPriorityUpdate(
+      {kSessionStreamId, false, std::get<2>(priority)});
+}
+
 void HQSession::onGoaway(uint64_t lastGoodStreamID,
                          ErrorCode code,
                          std::unique_ptr<folly::IOBuf> /* debugData */) {
@@ -1850,7 +2020,7 @@ void HQSession::onFlowControlUpdate(quic::StreamId id) noexcept {
                     stream->getStreamId(),
                     flowControl->sendWindowAvailable);
     if (stream->hasPendingEgress()) {
-      txnEgressQueue_.signalPendingEgress(stream->queueHandle_.getHandle());
+      txnEgressQueue_->signalPendingEgress(stream->queueHandle_.getHandle());
     }
     if (!stream->detached_ && txn.isEgressPaused()) {
       // txn might be paused
@@ -1876,6 +2046,109 @@ void HQSession::onConnectionWriteError(
   // Leave this as a no-op.  We will most likely get onConnectionError soon
 }
 
+uint16_t HQSession::getDatagramSizeLimit(quic::StreamId id) const {
+  if (!datagramOptions_.enabled || !peerDatagrams_ || !sock_ ||
+      !sock_->isClientStream(id) || !sock_->isBidirectionalStream(id)) {
+    return 0;
+  }
+  auto limit = sock_->getDatagramSizeLimit();
+  auto prefix = quic::getQuicIntegerSize(id >> 2);
+  if (prefix.hasError() || limit <= *prefix) {
+    return 0;
+  }
+  return limit - *prefix;
+}
+
+bool HQSession::sendDatagram(quic::StreamId id,
+                             std::unique_ptr<folly::IOBuf> datagram) {
+  auto size = datagram ? datagram->computeChainDataLength() : 0;
+  auto limit = getDatagramSizeLimit(id);
+  if (size > limit || limit == 0 || datagramEgressPaused_) {
+    VLOG(4) << "Dropping datagram size=" << size << " limit=" << limit
+            << " paused=" << datagramEgressPaused_ << " streamID=" << id
+            << " sess=" << *this;
+    return false;
+  }
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  auto res = hq::writeDatagram(queue, id, std::move(datagram));
+  if (res.hasError()) {
+    return false;
+  }
+  datagramEgressBytes_ += *res;
+  datagramEgress_.push_back(queue.move());
+  if (datagramEgressBytes_ >= datagramOptions_.maxBufferedBytes) {
+    VLOG(4) << "Datagram egress paused sess=" << *this;
+    datagramEgressPaused_ = true;
+    invokeOnAllStreams([](HQStreamTransportBase* stream) {
+      stream->txn_.onDatagramEgressPaused();
+    });
+  }
+  scheduleWrite();
+  return true;
+}
+
+void HQSession::writeDatagrams() {
+  while (!datagramEgress_.empty()) {
+    auto size = datagramEgress_.front()->computeChainDataLength();
+    auto res = sock_->writeDatagram(std::move(datagramEgress_.front()));
+    datagramEgress_.pop_front();
+    datagramEgressBytes_ -= size;
+    if (res.hasError()) {
+      // The transport's buffer is full or the datagram too large for it now
+      VLOG(4) << "Failed to write datagram err=" << res.error()
+              << " sess=" << *this;
+    }
+  }
+  if (datagramEgressPaused_ &&
+      datagramEgressBytes_ <= datagramOptions_.maxBufferedBytes / 2) {
+    VLOG(4) << "Datagram egress resumed sess=" << *this;
+    datagramEgressPaused_ = false;
+    invokeOnAllStreams([](HQStreamTransportBase* stream) {
+      stream->txn_.onDatagramEgressResumed();
+    });
+  }
+}
+
+void HQSession::onDatagramsAvailable() noexcept {
+  auto result = sock_->readDatagramBufs();
+  if (result.hasError()) {
+    LOG(ERROR) << "Failed to read datagrams err=" << result.error()
+               << " sess=" << *this;
+    return;
+  }
+  DestructorGuard dg(this);
+  for (auto& datagram : result.value()) {
+    if (!datagramOptions_.enabled || !peerDatagrams_) {
+      VLOG(3) << "Datagram before SETTINGS_H3_DATAGRAM sess=" << *this;
+      dropConnectionWithError(
+          std::make_pair(HTTP3::ErrorCode::HTTP_DATAGRAM_ERROR,
+                         "Datagrams not negotiated"),
+          kErrorMalformedInput);
+      return;
+    }
+    folly::io::Cursor cursor(datagram.get());
+    quic::StreamId streamId;
+    if (hq::parseDatagram(cursor, streamId)) {
+      dropConnectionWithError(
+          std::make_pair(HTTP3::ErrorCode::HTTP_DATAGRAM_ERROR,
+                         "Malformed datagram"),
+          kErrorMalformedInput);
+      return;
+    }
+    auto stream = findNonDetachedStream(streamId);
+    if (!stream) {
+      // Unknown, closed or yet to open: RFC 9297 lets us drop it
+      VLOG(4) << "Dropping datagram for streamID=" << streamId
+              << " sess=" << *this;
+      continue;
+    }
+    folly::IOBufQueue payload{folly::IOBufQueue::cacheChainLength()};
+    payload.append(std::move(datagram));
+    payload.trimStart(cursor.getCurrentPosition());
+    stream->txn_.onDatagram(payload.move());
+  }
+}
+
 uint64_t HQSession::writeControlStreams(uint64_t maxEgress) {
   uint64_t maxEgressOrig = maxEgress;
   // NOTE: process the control streams in the order they are stored
@@ -1884,6 +2157,14 @@ uint64_t HQSession::writeControlStreams(uint64_t maxEgress) {
     if (it.second.writeBuf_.empty()) {
       continue;
     }
+    if (it.first == UnidirectionalStreamType::QPACK_DECODER) {
+      if (!qpackDecoderStreamReady(it.second)) {
+        scheduleQPACKDecoderStreamWrite(it.second);
+        continue;
+      }
+      qpackFlushDue_ = false;
+      qpackFlushTimeout_.cancelTimeout();
+    }
     auto sent = controlStreamWriteImpl(&it.second, maxEgress);
     DCHECK_LE(sent, maxEgress);
     maxEgress -= sent;
@@ -1894,6 +2175,26 @@ uint64_t HQSession::writeControlStreams(uint64_t maxEgress) {
   return maxEgressOrig - maxEgress;
 }
 
+bool HQSession::qpackDecoderStreamReady(
+    const HQControlStream& decoderStream) const {
+  // Acks share packets with request stream data for free, and a draining
+  // session should not sit on them
+  return !qpackFlushPolicy_.batchDecoderStream || qpackFlushDue_ ||
+         !txnEgressQueue_->empty() || drainState_ != DrainState::NONE ||
+         decoderStream.writeBuf_.chainLength() >=
+             qpackFlushPolicy_.maxPendingBytes;
+}
+
+void HQSession::scheduleQPACKDecoderStreamWrite(
+    const HQControlStream& decoderStream) {
+  if (qpackDecoderStreamReady(decoderStream)) {
+    scheduleWrite();
+  } else if (!qpackFlushTimeout_.isScheduled() && getEventBase()) {
+    getEventBase()->timer().scheduleTimeout(&qpackFlushTimeout_,
+                                            qpackFlushPolicy_.maxDelay);
+  }
+}
+
 uint64_t HQSession::controlStreamWriteImpl(HQControlStream* ctrlStream,
                                            uint64_t maxEgress) {
   auto egressStreamId = ctrlStream->getEgressStreamId();
@@ -2027,7 +2328,7 @@ void HQSession::handleSessionError(HQStreamBase* stream,
 
 void HQSession::writeRequestStreams(uint64_t maxEgress) noexcept {
   // requestStreamWriteImpl may call txn->onWriteReady
-  txnEgressQueue_.nextEgress(nextEgressResults_);
+  txnEgressQueue_->nextEgress(nextEgressResults_);
   for (auto it = nextEgressResults_.begin(); it != nextEgressResults_.end();
        ++it) {
     auto& ratio = it->second;
@@ -2239,7 +2540,7 @@ uint64_t HQSession::requestStreamWriteImpl(HQStreamTransport* hqStream,
   if (hqStream->queueHandle_.isStreamTransportEnqueued() &&
       (!hqStream->hasPendingEgress() || flowControlBlocked)) {
     VLOG(4) << "clearPendingEgress for " << hqStream->txn_;
-    txnEgressQueue_.clearPendingEgress(hqStream->queueHandle_.getHandle());
+    txnEgressQueue_->clearPendingEgress(hqStream->queueHandle_.getHandle());
   }
   if (flowControlBlocked && !hqStream->txn_.isEgressComplete()) {
     VLOG(4) << __func__ << " txn flow control blocked, txn=" << hqStream->txn_;
@@ -2330,6 +2631,7 @@ HQSession::createStreamTransport(quic::StreamId streamId) {
     if (getConnectionManager()) {
       getConnectionManager()->onActivated(*this);
     }
+    hibernateTimer_.cancelTimeout();
   }
 
   // The transport should never call createStreamTransport before
@@ -2353,6 +2655,7 @@ HQSession::createStreamTransport(quic::StreamId streamId) {
 
   CHECK(matchPair.second) << "Emplacement failed, despite earlier "
                              "existence check.";
+  FOLLY_SDT(proxygen, hq_stream_open, streamId, numberOfStreams());
 
   if (versionUtils_ && drainState_ != DrainState::NONE) {
     versionUtils_->sendGoawayOnRequestStream(matchPair.first->second);
@@ -2431,6 +2734,12 @@ HQSession::HQStreamTransportBase::HQStreamTransportBase(
       byteEventTracker_(nullptr) {
   VLOG(4) << __func__ << " txn=" << txn_;
   byteEventTracker_.setTTLBAStats(session_.sessionStats_);
+  if (session_.isPhaseTimingsEnabled()) {
+    txn_.setPhaseTimingsEnabled(true, session_.getPhaseTimingsObserver());
+  }
+  if (session_.sampleCpuTime()) {
+    txn_.setCpuTimeAccounting(true);
+  }
   quicStreamProtocolInfo_ = std::make_shared<QuicStreamProtocolInfo>();
 }
 
@@ -2566,6 +2875,7 @@ void HQSession::detachStreamTransport(HQStreamTransportBase* hqStream) {
       clearStreamCallbacks(streamId);
     }
     eraseStream(streamId);
+    FOLLY_SDT(proxygen, hq_stream_close, streamId, numberOfStreams());
   } else {
     VLOG(4) << __func__ << " streamID=NA";
     auto hqPushIngressStream = dynamic_cast<HQIngressPushStream*>(hqStream);
@@ -2584,6 +2894,11 @@ void HQSession::detachStreamTransport(HQStreamTransportBase* hqStream) {
       getConnectionManager()->onDeactivated(*this);
     }
     resetTimeout();
+    if (hibernateTimeout_.count() > 0 && getEventBase() &&
+        !hibernateTimer_.isScheduled()) {
+      getEventBase()->timer().scheduleTimeout(&hibernateTimer_,
+                                              hibernateTimeout_);
+    }
   } else {
     if (infoCallback_) {
       infoCallback_->onTransactionDetached(*this);
@@ -2706,6 +3021,29 @@ void HQSession::HQStreamTransportBase::processDataRejected(
 //  - 1xx information header (e.g. 100 continue)
 // The method is safe to use in all the above scenarios
 // see specific comments in the method body
+void HQSession::HQStreamTransportBase::applyPriorityHeader(
+    const HTTPMessage& msg) {
+  if (!msg.isRequest() || !session_.getHTTP2PrioritiesEnabled()) {
+    return;
+  }
+  const auto& value = msg.getHeaders().getSingleOrEmpty(kPriorityHeader);
+  if (value.empty()) {
+    return;
+  }
+  uint8_t urgency;
+  bool incremental;
+  RFC9218PriorityQueue::parsePriorityField(value, urgency, incremental);
+  VLOG(4) << __func__ << " urgency=" << (uint32_t)urgency
+          << " incremental=" << incremental << " txn=" << txn_;
+  if (session_.usingRFC9218Priorities()) {
+    // HTTPTransaction priorities have no incremental flag
+    static_cast<RFC9218PriorityQueue&>(*session_.txnEgressQueue_)
+        .updatePriority(queueHandle_.getHandle(), urgency, incremental);
+  }
+  txn_.onPriorityUpdate(
+      RFC9218PriorityQueue::priorityFromUrgency(urgency, kSessionStreamId));
+}
+
 void HQSession::HQStreamTransportBase::onHeadersComplete(
     HTTPCodec::StreamID streamID, std::unique_ptr<HTTPMessage> msg) {
   VLOG(4) << __func__ << " txn=" << txn_;
@@ -2751,6 +3089,7 @@ void HQSession::HQStreamTransportBase::onHeadersComplete(
     onPushPromiseHeadersComplete(*ingressPushId_, streamID, std::move(msg));
     ingressPushId_ = folly::none;
   } else {
+    applyPriorityHeader(*msg);
     txn_.onIngressHeadersComplete(std::move(msg));
   }
 
@@ -2843,7 +3182,7 @@ void HQSession::HQVersionUtils::abortStream(quic::StreamId id) {
       session_.findControlStream(hq::UnidirectionalStreamType::QPACK_DECODER);
   DCHECK(QPACKDecoderStream);
   QPACKDecoderStream->writeBuf_.append(std::move(cancel));
-  session_.scheduleWrite();
+  session_.scheduleQPACKDecoderStreamWrite(*QPACKDecoderStream);
 }
 
 void HQSession::HQStreamTransportBase::sendHeaders(HTTPTransaction* txn,
@@ -2853,6 +3192,14 @@ void HQSession::HQStreamTransportBase::sendHeaders(HTTPTransaction* txn,
   VLOG(4) << __func__ << " txn=" << txn_;
   DCHECK(txn == &txn_);
 
+  if (headers.getHeaderTemplate() &&
+      !codecFilterChain->supportsHeaderTemplates()) {
+    HTTPMessage merged(headers);
+    merged.applyHeaderTemplate();
+    sendHeaders(txn, merged, size, includeEOM);
+    return;
+  }
+
   if (session_.versionUtils_) {
     // for h1q-fb-v1 initiate shutdown when sending a request
     // a good client should always wait for onTransportReady before sending
@@ -2860,6 +3207,7 @@ void HQSession::HQStreamTransportBase::sendHeaders(HTTPTransaction* txn,
     session_.versionUtils_->checkSendingGoaway(headers);
   }
 
+  session_.maybeTuneQPACKVulnerable();
   const uint64_t oldOffset = streamWriteByteOffset();
   auto g = folly::makeGuard(setActiveCodec(__func__));
   CHECK(codecStreamId_);
@@ -3020,7 +3368,7 @@ void HQSession::HQStreamTransportBase::abortEgress(bool checkForDetach) {
   pendingEOM_ = false;
   if (queueHandle_.isStreamTransportEnqueued()) {
     VLOG(4) << "clearPendingEgress for " << txn_;
-    session_.txnEgressQueue_.clearPendingEgress(queueHandle_.getHandle());
+    session_.txnEgressQueue_->clearPendingEgress(queueHandle_.getHandle());
   }
   if (checkForDetach) {
     HTTPTransaction::DestructorGuard dg(&txn_);
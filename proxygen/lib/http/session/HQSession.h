@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/DelayedDestructionBase.h>
@@ -25,15 +27,17 @@
 #include <proxygen/lib/http/codec/HTTPSettings.h>
 #include <proxygen/lib/http/codec/QPACKDecoderCodec.h>
 #include <proxygen/lib/http/codec/QPACKEncoderCodec.h>
-#include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/RingByteEventTracker.h>
 #include <proxygen/lib/http/session/HQStreamBase.h>
 #include <proxygen/lib/http/session/HQStreamLookup.h>
 #include <proxygen/lib/http/session/HQUnidirectionalCallbacks.h>
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
+#include <proxygen/lib/http/session/HTTPSessionStats.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <proxygen/lib/http/session/ServerPushLifecycle.h>
 #include <proxygen/lib/utils/ConditionalGate.h>
+#include <proxygen/lib/utils/RecyclingAllocator.h>
 #include <quic/api/QuicSocket.h>
 #include <quic/logging/QuicLogger.h>
 
@@ -119,6 +123,7 @@ class HQSession
     , public quic::QuicSocket::ReadCallback
     , public quic::QuicSocket::WriteCallback
     , public quic::QuicSocket::DeliveryCallback
+    , public quic::QuicSocket::DatagramCallback
     , public HTTPSessionBase
     , public folly::EventBase::LoopCallback
     , public HQUnidirStreamDispatcher::Callback {
@@ -194,8 +199,95 @@ class HQSession
     forceUpstream1_1_ = force;
   }
 
+  /**
+   * When the instructions on the QPACK decoder stream (header
+   * acknowledgements, insert count increments and stream cancellations) are
+   * written.  By default they go out on the write pass that follows them.
+   * With batchDecoderStream they are held until the session has request
+   * stream data to send alongside them, maxPendingBytes have accumulated or
+   * maxDelay has passed, so acks for many header blocks share a write.
+   */
+  struct QPACKFlushPolicy {
+    bool batchDecoderStream{false};
+    uint32_t maxPendingBytes{128};
+    std::chrono::milliseconds maxDelay{25};
+  };
+
+  void setQPACKFlushPolicy(const QPACKFlushPolicy& policy) {
+    qpackFlushPolicy_ = policy;
+  }
+
+  /**
+   * With adaptive, the QPACK encoder's budget of header blocks with
+   * vulnerable references (QPACKEncoder::setVulnerableBudget) follows the
+   * connection's packet loss, sampled at most every sampleInterval as headers
+   * are sent.  Up to lowLossRate it is the peer's QPACK_BLOCKED_STREAMS, from
+   * highLossRate 0, and in between proportionally less.  It is halved when
+   * the smoothed RTT exceeds highRtt, as an insert lost then blocks streams
+   * longer.  Intervals with fewer than minPackets sent keep the budget.
+   */
+  struct QPACKVulnerablePolicy {
+    bool adaptive{false};
+    double lowLossRate{0.01};
+    double highLossRate{0.1};
+    std::chrono::milliseconds highRtt{200};
+    std::chrono::milliseconds sampleInterval{1000};
+    uint64_t minPackets{20};
+  };
+
+  void setQPACKVulnerablePolicy(const QPACKVulnerablePolicy& policy) {
+    qpackVulnerablePolicy_ = policy;
+  }
+
+  /**
+   * HTTP datagrams (RFC 9297) in QUIC DATAGRAM frames, which the transport
+   * must be configured for.  Enabled before the transport is ready, the
+   * session advertises SETTINGS_H3_DATAGRAM and, if the peer does too, its
+   * transactions can send and receive datagrams (see
+   * HTTPTransaction::sendDatagram()).
+   *
+   * Datagrams sent wait for the session's next write, which hands them to
+   * the transport together so they share packets.  Past maxBufferedBytes
+   * waiting, sendDatagram() drops them and the transactions get
+   * onDatagramEgressPaused(), then onDatagramEgressResumed() once half of
+   * them are written.
+   */
+  struct DatagramOptions {
+    bool enabled{false};
+    uint32_t maxBufferedBytes{64 * 1024};
+  };
+
+  void setDatagramOptions(const DatagramOptions& options) {
+    datagramOptions_ = options;
+    if (options.enabled) {
+      egressSettings_.setSetting(SettingsId::_HQ_DATAGRAM, 1);
+    } else {
+      egressSettings_.unsetSetting(SettingsId::_HQ_DATAGRAM);
+    }
+  }
+
+  /**
+   * Bounds the time a loop iteration spends feeding buffered stream data to
+   * the codecs.  Streams left over go first in the next iteration, after
+   * this one's writes.  0, the default, processes every readable stream.
+   */
+  void setReadProcessingBudget(std::chrono::microseconds budget) {
+    readProcessingBudget_ = budget;
+  }
+
+  /**
+   * When enabled, the storage of request streams that finished on a thread
+   * is reused by the next ones opened on it, by any session.  Off by
+   * default.
+   */
+  static void setRecycleStreams(bool enabled) {
+    StreamAllocator::FreeList::enable(enabled);
+  }
+
   void setSessionStats(HTTPSessionStats* stats) override;
 
+  HTTPSessionMemoryUsage getMemoryUsage() const override;
+
   void onNewBidirectionalStream(quic::StreamId id) noexcept override;
 
   void onNewUnidirectionalStream(quic::StreamId id) noexcept override;
@@ -233,6 +325,9 @@ class HQSession
   // quic::QuicSocket::WriteCallback
   void onConnectionWriteReady(uint64_t maxToSend) noexcept override;
 
+  // quic::QuicSocket::DatagramCallback
+  void onDatagramsAvailable() noexcept override;
+
   void onConnectionWriteError(
       std::pair<quic::QuicErrorCode, folly::Optional<folly::StringPiece>>
           error) noexcept override;
@@ -268,6 +363,9 @@ class HQSession
 
   void onSettings(const SettingsList& settings);
 
+  void onPriority(quic::StreamId streamId,
+                  const HTTPMessage::HTTPPriority& priority);
+
   folly::AsyncTransportWrapper* getTransport() override {
     return nullptr;
   }
@@ -301,6 +399,17 @@ class HQSession
                                      : numberOfIngressStreams());
   }
 
+  // The transport's estimate, from its ACKs
+  std::chrono::microseconds getRtt() const override {
+    return sock_ && sock_->good() ? sock_->getTransportInfo().srtt :
+      HTTPSessionBase::getRtt();
+  }
+
+  std::chrono::microseconds getRttVar() const override {
+    return sock_ && sock_->good() ? sock_->getTransportInfo().rttvar :
+      HTTPSessionBase::getRttVar();
+  }
+
   CodecProtocol getCodecProtocol() const override {
     if (!versionUtils_) {
       // return a default protocol before alpn is set
@@ -349,8 +458,12 @@ class HQSession
     }
   }
 
-  void setMaxConcurrentIncomingStreams(uint32_t /*num*/) override {
-    // need transport API
+  /**
+   * The QUIC MAX_STREAMS credit is the transport's to give, so the request
+   * streams opened beyond num are refused with HTTP_REQUEST_REJECTED.
+   */
+  void setMaxConcurrentIncomingStreams(uint32_t num) override {
+    maxConcurrentIncomingStreams_ = num;
   }
 
   /**
@@ -697,6 +810,7 @@ class HQSession
   void readControlStream(HQControlStream* controlStream);
 
   void processReadData();
+  void processReadData(quic::StreamId id);
   void resumeReads(quic::StreamId id);
   void pauseReads(quic::StreamId id);
 
@@ -753,6 +867,12 @@ class HQSession
   uint64_t writeControlStreams(uint64_t maxEgress);
   uint64_t controlStreamWriteImpl(HQControlStream* ctrlStream,
                                   uint64_t maxEgress);
+
+  // Whether the pending QPACK decoder stream data should be written now,
+  // according to qpackFlushPolicy_
+  bool qpackDecoderStreamReady(const HQControlStream& decoderStream) const;
+  // Write the QPACK decoder stream now or once the flush policy allows it
+  void scheduleQPACKDecoderStreamWrite(const HQControlStream& decoderStream);
   void handleSessionError(HQStreamBase* stream,
                           hq::StreamDirection streamDir,
                           quic::QuicErrorCode err,
@@ -1033,6 +1153,11 @@ class HQSession
       session_.onSettings(settings);
     }
 
+    void onPriority(HTTPCodec::StreamID stream,
+                    const HTTPMessage::HTTPPriority& priority) override {
+      session_.onPriority(stream, priority);
+    }
+
     std::unique_ptr<hq::HQUnidirectionalCodec> ingressCodec_;
     bool readEOF_{false};
   };
@@ -1119,6 +1244,9 @@ class HQSession
     void onHeadersComplete(HTTPCodec::StreamID streamID,
                            std::unique_ptr<HTTPMessage> msg) override;
 
+    // Schedule the egress by the Priority header of a request, if any
+    void applyPriorityHeader(const HTTPMessage& msg);
+
     void onBody(HTTPCodec::StreamID /* streamID */,
                 std::unique_ptr<folly::IOBuf> chain,
                 uint16_t padding) override {
@@ -1442,6 +1570,14 @@ class HQSession
     folly::Expected<folly::Optional<uint64_t>, ErrorCode> rejectBodyTo(
         HTTPTransaction* txn, uint64_t nextBodyOffset) override;
 
+    uint16_t getDatagramSizeLimit() const noexcept override {
+      return session_.getDatagramSizeLimit(getStreamId());
+    }
+
+    bool sendDatagram(std::unique_ptr<folly::IOBuf> datagram) override {
+      return session_.sendDatagram(getStreamId(), std::move(datagram));
+    }
+
     uint64_t trimPendingEgressBody(uint64_t wireOffset);
 
     /**
@@ -1470,6 +1606,11 @@ class HQSession
         return egressQueueHandle_;
       }
 
+      // As init(), keeping the transaction enqueued state
+      void setHandle(HTTP2PriorityQueueBase::Handle handle) {
+        egressQueueHandle_ = handle;
+      }
+
       void clearHandle() {
         egressQueueHandle_ = nullptr;
       }
@@ -1505,7 +1646,7 @@ class HQSession
                                                   HTTPTransaction* txn,
                                                   bool permanent,
                                                   uint64_t* depth) override {
-      queueHandle_.init(session_.txnEgressQueue_.addTransaction(
+      queueHandle_.init(session_.txnEgressQueue_->addTransaction(
           id, pri, txn, permanent, depth));
       return &queueHandle_;
     }
@@ -1516,14 +1657,15 @@ class HQSession
         http2::PriorityUpdate pri,
         uint64_t* depth) override {
       CHECK_EQ(handle, &queueHandle_);
-      return session_.txnEgressQueue_.updatePriority(
-          queueHandle_.getHandle(), pri, depth);
+      queueHandle_.setHandle(session_.txnEgressQueue_->updatePriority(
+          queueHandle_.getHandle(), pri, depth));
+      return &queueHandle_;
     }
 
     // Remove the transaction from the priority tree
     void removeTransaction(HTTP2PriorityQueueBase::Handle handle) override {
       CHECK_EQ(handle, &queueHandle_);
-      session_.txnEgressQueue_.removeTransaction(queueHandle_.getHandle());
+      session_.txnEgressQueue_->removeTransaction(queueHandle_.getHandle());
       queueHandle_.clearHandle();
     }
 
@@ -1538,7 +1680,7 @@ class HQSession
       auto flowControl =
           session_.sock_->getStreamFlowControl(getEgressStreamId());
       if (!flowControl.hasError() && flowControl->sendWindowAvailable > 0) {
-        session_.txnEgressQueue_.signalPendingEgress(queueHandle_.getHandle());
+        session_.txnEgressQueue_->signalPendingEgress(queueHandle_.getHandle());
       } else {
         VLOG(4) << "Delay pending egress signal on blocked txn=" << txn_;
       }
@@ -1557,13 +1699,13 @@ class HQSession
       // The transaction has pending body data, but it decided to remove itself
       // from the egress queue since it's rate-limited
       if (queueHandle_.isStreamTransportEnqueued()) {
-        session_.txnEgressQueue_.clearPendingEgress(queueHandle_.getHandle());
+        session_.txnEgressQueue_->clearPendingEgress(queueHandle_.getHandle());
       }
     }
 
     void addPriorityNode(HTTPCodec::StreamID id,
                          HTTPCodec::StreamID parent) override {
-      session_.txnEgressQueue_.addPriorityNode(id, parent);
+      session_.txnEgressQueue_->addPriorityNode(id, parent);
     }
 
     /**
@@ -1582,6 +1724,14 @@ class HQSession
       return streamEgressCommittedByteOffset() + writeBuf_.chainLength();
     }
 
+    // Adds the stream's buffers, deferred body and byte events to usage
+    void addMemoryUsage(HTTPSessionMemoryUsage& usage) const {
+      usage.readBuffer += readBuf_.chainLength();
+      usage.writeBuffer += writeBuf_.chainLength();
+      usage.transactionEgress += txn_.getDeferredEgressBodyLength();
+      usage.byteEvents += byteEventTracker_.getMemoryUsage();
+    }
+
     void abortIngress();
 
     void abortEgress(bool checkForDetach);
@@ -1606,7 +1756,7 @@ class HQSession
 
     folly::Optional<HTTPCodec::StreamID> codecStreamId_;
 
-    ByteEventTracker byteEventTracker_;
+    RingByteEventTracker byteEventTracker_;
 
     // Stream + session protocol info
     std::shared_ptr<QuicStreamProtocolInfo> quicStreamProtocolInfo_;
@@ -1822,6 +1972,18 @@ class HQSession
     }
     virtual void setHeaderCodecStats(HeaderCodec::Stats*) {
     }
+    virtual void hibernate() {
+    }
+    virtual size_t getMemoryUsage() const {
+      return 0;
+    }
+    // Sets the QPACK vulnerable budget to this fraction of the peer's limit,
+    // returning it, if the version has QPACK
+    virtual folly::Optional<uint32_t> scaleQPACKVulnerable(double) {
+      return folly::none;
+    }
+    virtual void recordQPACKStats(HTTPSessionStats&) const {
+    }
     virtual bool isPartialReliabilityEnabled() const noexcept = 0;
     virtual folly::Expected<uint64_t, hq::UnframedBodyOffsetTrackerError>
     onIngressPeekDataAvailable(uint64_t /* streamOffset */) {
@@ -1963,6 +2125,27 @@ class HQSession
       qpackCodec_.setStats(stats);
     }
 
+    void hibernate() override {
+      qpackCodec_.hibernate();
+    }
+
+    size_t getMemoryUsage() const override {
+      return qpackCodec_.getMemoryUsage();
+    }
+
+    folly::Optional<uint32_t> scaleQPACKVulnerable(double fraction) override {
+      auto budget =
+          static_cast<uint32_t>(fraction * qpackCodec_.getMaxVulnerable());
+      qpackCodec_.setVulnerableBudget(budget);
+      return budget;
+    }
+
+    void recordQPACKStats(HTTPSessionStats& stats) const override {
+      stats.recordQPACKBlocking(qpackCodec_.getVulnerableBlockCount(),
+                                qpackCodec_.getHolBlockCount(),
+                                qpackCodec_.getHolBlockTime());
+    }
+
     bool isPartialReliabilityEnabled() const noexcept override {
       return session_.sock_ && session_.sock_->isPartiallyReliableTransport();
     }
@@ -2053,17 +2236,24 @@ class HQSession
    */
   HTTP2PriorityQueue::NextEgressResult nextEgressResults_;
 
-  // Bidirectional transport streams
-  std::unordered_map<quic::StreamId, HQStreamTransport> streams_;
+  struct StreamTag {};
+  using StreamAllocator = RecyclingAllocator<
+    StreamTag, std::pair<const quic::StreamId, HQStreamTransport>>;
+
+  // Bidirectional transport streams.  Node maps, so streams never move.
+  folly::F14NodeMap<quic::StreamId, HQStreamTransport,
+                    folly::f14::DefaultHasher<quic::StreamId>,
+                    folly::f14::DefaultKeyEqual<quic::StreamId>,
+                    StreamAllocator> streams_;
 
   // Incoming server push streams. Since the incoming push streams
   // can be created before transport stream
-  std::unordered_map<hq::PushId, HQIngressPushStream> ingressPushStreams_;
+  folly::F14NodeMap<hq::PushId, HQIngressPushStream> ingressPushStreams_;
 
   // Lookup maps for matching ingress push streams to push ids
   PushToStreamMap streamLookup_;
 
-  std::unordered_map<quic::StreamId, HQEgressPushStream> egressPushStreams_;
+  folly::F14NodeMap<quic::StreamId, HQEgressPushStream> egressPushStreams_;
 
   // Cleanup all pending streams. Invoked in session timeout
   size_t cleanupPendingStreams();
@@ -2079,8 +2269,78 @@ class HQSession
   // for session logic.
   ServerPushLifecycleCallback* serverPushLifecycleCb_{nullptr};
 
+  class QPACKFlushTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit QPACKFlushTimeout(HQSession& session) : session_(session) {
+    }
+
+    void timeoutExpired() noexcept override {
+      session_.qpackFlushDue_ = true;
+      session_.scheduleWrite();
+    }
+
+   private:
+    HQSession& session_;
+  };
+
+  class HibernateTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit HibernateTimeout(HQSession& session) : session_(session) {
+    }
+
+    void timeoutExpired() noexcept override {
+      session_.hibernate();
+    }
+
+   private:
+    HQSession& session_;
+  };
+
+  /**
+   * Release reclaimable memory once idle, see
+   * HTTPSessionBase::setHibernateTimeout
+   */
+  void hibernate() noexcept;
+
+  HibernateTimeout hibernateTimer_{*this};
+
+  QPACKFlushPolicy qpackFlushPolicy_;
+  QPACKFlushTimeout qpackFlushTimeout_{*this};
+  // Set when held QPACK decoder stream data has waited for maxDelay
+  bool qpackFlushDue_{false};
+
+  /**
+   * Updates the QPACK vulnerable budget from the losses since the last
+   * sample, per qpackVulnerablePolicy_.
+   */
+  void maybeTuneQPACKVulnerable();
+
+  QPACKVulnerablePolicy qpackVulnerablePolicy_;
+
+  // The payload limit of HTTP datagrams on the stream, 0 until both ends
+  // enabled them
+  uint16_t getDatagramSizeLimit(quic::StreamId id) const;
+  bool sendDatagram(quic::StreamId id, std::unique_ptr<folly::IOBuf> datagram);
+  void writeDatagrams();
+
+  DatagramOptions datagramOptions_;
+  // SETTINGS_H3_DATAGRAM from the peer
+  bool peerDatagrams_{false};
+  // Each with its quarter stream ID, for the next write
+  std::deque<std::unique_ptr<folly::IOBuf>> datagramEgress_;
+  uint64_t datagramEgressBytes_{0};
+  bool datagramEgressPaused_{false};
+  // The transport's counts at the last sample, none before the first
+  folly::Optional<TimePoint> lastQPACKSampleTime_;
+  uint64_t lastQPACKSamplePackets_{0};
+  uint64_t lastQPACKSampleRetransmits_{0};
+
   // Maximum Stream ID received so far
   quic::StreamId maxIncomingStreamId_{0};
+  // The request streams the peer may have open, see
+  // setMaxConcurrentIncomingStreams
+  uint32_t maxConcurrentIncomingStreams_{
+    std::numeric_limits<uint32_t>::max()};
   // Maximum Stream ID that we are allowed to open, according to the remote
   quic::StreamId maxAllowedStreamId_{quic::kEightByteLimit};
   // Whether SETTINGS have been received
@@ -2100,7 +2360,10 @@ class HQSession
 
   /** Reads in the current loop iteration */
   uint16_t readsPerLoop_{0};
-  std::unordered_set<quic::StreamId> pendingProcessReadSet_;
+  folly::F14FastSet<quic::StreamId> pendingProcessReadSet_;
+  // Streams of pendingProcessReadSet_ the budget left over, in order
+  std::vector<quic::StreamId> deferredProcessReads_;
+  std::chrono::microseconds readProcessingBudget_{0};
   std::shared_ptr<QuicProtocolInfo> quicInfo_;
   folly::Optional<HQVersion> version_;
   std::string alpn_;
@@ -121,7 +121,7 @@ void HQUpstreamSession::attachThreadLocals(folly::EventBase* eventBase,
                                            HTTPSessionController* controller) {
   // TODO: deal with control streams in h2q
   VLOG(4) << __func__ << " sess=" << *this;
-  txnEgressQueue_.attachThreadLocals(timeout);
+  txnEgressQueue_->attachThreadLocals(timeout);
   setController(controller);
   setSessionStats(stats);
   if (sock_) {
@@ -145,7 +145,7 @@ void HQUpstreamSession::detachThreadLocals(bool) {
     sock_->detachEventBase();
   }
 
-  txnEgressQueue_.detachThreadLocals();
+  txnEgressQueue_->detachThreadLocals();
   setController(nullptr);
   setSessionStats(nullptr);
   // The codec filters *shouldn't* be accessible while the socket is detached,
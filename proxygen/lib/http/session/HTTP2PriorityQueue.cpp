@@ -617,6 +617,12 @@ HTTP2PriorityQueue::clearPendingEgress(Handle handle) {
   pendingWeightChange_ = true;
 }
 
+size_t
+HTTP2PriorityQueue::getMemoryUsage() const {
+  // Each node is owned by a std::list node in its parent's children_
+  return nodes_.size() * (sizeof(Node) + 3 * sizeof(void*));
+}
+
 void
 HTTP2PriorityQueue::iterateBFS(
   const std::function<bool(HTTP2PriorityQueue&, HTTPCodec::StreamID,
@@ -641,6 +647,19 @@ HTTP2PriorityQueue::iterateBFS(
   }
 }
 
+void
+HTTP2PriorityQueue::iterateTransactions(
+    const std::function<void(HTTPTransaction*)>& fn,
+    const std::function<bool()>& stopFn) {
+  iterateBFS([&fn] (HTTP2PriorityQueue&, HTTPCodec::StreamID,
+                    HTTPTransaction *txn, double) {
+               if (txn) {
+                 fn(txn);
+               }
+               return false;
+             }, stopFn, true /* all */);
+}
+
 bool
 HTTP2PriorityQueue::nextEgressResult(HTTP2PriorityQueue& queue,
                                      HTTPCodec::StreamID,
@@ -66,7 +66,48 @@ class HTTP2PriorityQueueBase : public HTTPCodec::PriorityQueue {
   HTTPCodec::StreamID rootNodeId_{0};
 };
 
-class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
+/**
+ * The egress scheduler a session drives: HTTP2PriorityQueueBase plus the
+ * queries and bookkeeping HTTPSession and HQSession need.
+ */
+class HTTPEgressPriorityQueue : public HTTP2PriorityQueueBase {
+ public:
+  using NextEgressResult = std::vector<std::pair<HTTPTransaction*, double>>;
+
+  explicit HTTPEgressPriorityQueue(HTTPCodec::StreamID rootNodeId)
+    : HTTP2PriorityQueueBase(rootNodeId) {}
+
+  virtual void attachThreadLocals(const WheelTimerInstance& /*timeout*/) {}
+
+  virtual void detachThreadLocals() {}
+
+  // Create or reprioritize a node from a PRIORITY frame
+  virtual void addOrUpdatePriorityNode(HTTPCodec::StreamID id,
+                                       http2::PriorityUpdate pri) = 0;
+
+  // Remove the nodes added by addPriorityNode()
+  virtual void dropPriorityNodes() = 0;
+
+  // Returns true if there are no transaction with pending egress
+  virtual bool empty() const = 0;
+
+  // The number with pending egress
+  virtual uint64_t numPendingEgress() const = 0;
+
+  // Approximate heap bytes held by the nodes
+  virtual size_t getMemoryUsage() const = 0;
+
+  // Appends the transactions to serve next and their share of the egress
+  virtual void nextEgress(NextEgressResult& result, bool spdyMode = false) = 0;
+
+  // Calls fn for every transaction, enqueued or not, roughly in priority
+  // order.  stopFn is evaluated once per priority level.
+  virtual void iterateTransactions(
+    const std::function<void(HTTPTransaction*)>& fn,
+    const std::function<bool()>& stopFn) = 0;
+};
+
+class HTTP2PriorityQueue : public HTTPEgressPriorityQueue {
 
  private:
   class Node;
@@ -78,7 +119,7 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
  public:
 
   HTTP2PriorityQueue(HTTPCodec::StreamID rootNodeId = 0)
-      : HTTP2PriorityQueueBase(rootNodeId),
+      : HTTPEgressPriorityQueue(rootNodeId),
         nodes_(NodeMap::bucket_traits(nodeBuckets_, kNumBuckets)),
         root_(*this, nullptr, rootNodeId, 1, nullptr) {
     root_.setPermanent();
@@ -86,16 +127,16 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
 
   explicit HTTP2PriorityQueue(const WheelTimerInstance& timeout,
                               HTTPCodec::StreamID rootNodeId = 0)
-      : HTTP2PriorityQueueBase(rootNodeId),
+      : HTTPEgressPriorityQueue(rootNodeId),
         nodes_(NodeMap::bucket_traits(nodeBuckets_, kNumBuckets)),
         root_(*this, nullptr, rootNodeId, 1, nullptr),
         timeout_(timeout) {
     root_.setPermanent();
   }
 
-  void attachThreadLocals(const WheelTimerInstance& timeout);
+  void attachThreadLocals(const WheelTimerInstance& timeout) override;
 
-  void detachThreadLocals();
+  void detachThreadLocals() override;
 
   void setMaxVirtualNodes(uint32_t maxVirtualNodes) {
     maxVirtualNodes_ = maxVirtualNodes;
@@ -113,9 +154,9 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
   }
 
   void addOrUpdatePriorityNode(HTTPCodec::StreamID id,
-                               http2::PriorityUpdate pri);
+                               http2::PriorityUpdate pri) override;
 
-  void dropPriorityNodes() {
+  void dropPriorityNodes() override {
     root_.dropPriorityNodes();
   }
 
@@ -134,12 +175,12 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
   void removeTransaction(Handle handle) override;
 
   // Returns true if there are no transaction with pending egress
-  bool empty() const {
+  bool empty() const override {
     return activeCount_ == 0;
   }
 
   // The number with pending egress
-  uint64_t numPendingEgress() const {
+  uint64_t numPendingEgress() const override {
     return activeCount_;
   }
 
@@ -147,6 +188,8 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
     return numVirtualNodes_;
   }
 
+  size_t getMemoryUsage() const override;
+
   void iterate(const std::function<bool(HTTPCodec::StreamID,
                                         HTTPTransaction *, double)>& fn,
                const std::function<bool()>& stopFn, bool all) {
@@ -160,9 +203,10 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
                                            HTTPTransaction *, double)>& fn,
                   const std::function<bool()>& stopFn, bool all);
 
-  using NextEgressResult = std::vector<std::pair<HTTPTransaction*, double>>;
+  void nextEgress(NextEgressResult& result, bool spdyMode = false) override;
 
-  void nextEgress(NextEgressResult& result, bool spdyMode = false);
+  void iterateTransactions(const std::function<void(HTTPTransaction*)>& fn,
+                           const std::function<bool()>& stopFn) override;
 
   static void setNodeLifetime(std::chrono::milliseconds lifetime) {
     kNodeLifetime_ = lifetime;
@@ -0,0 +1,53 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace proxygen {
+
+/**
+ * Decides how much new work a server takes on, so it can shed load before
+ * it is overloaded.  HTTPSessionAcceptor asks it about every new connection,
+ * and HTTPDownstreamSession about every new request.
+ *
+ * The methods are called on the event base threads for every connection and
+ * request, so they must be cheap: read a cached state, never make a syscall.
+ */
+class HTTPAdmissionController {
+ public:
+  virtual ~HTTPAdmissionController() {}
+
+  /**
+   * Whether to accept a new downstream connection, it is closed right away
+   * otherwise.
+   */
+  virtual bool admitConnection() = 0;
+
+  /**
+   * The SETTINGS_MAX_CONCURRENT_STREAMS to advertise on a new connection,
+   * given the configured one.
+   */
+  virtual uint32_t getMaxConcurrentIncomingStreams(uint32_t configured) = 0;
+
+  /**
+   * Whether to process a new request, it is answered with a 503 without
+   * reaching its handler otherwise.
+   */
+  virtual bool admitRequest() = 0;
+
+  /**
+   * Whether a session rejecting a request should also start draining, so
+   * its client moves its next requests to another server.
+   */
+  virtual bool shouldDrainOnReject() = 0;
+};
+
+}
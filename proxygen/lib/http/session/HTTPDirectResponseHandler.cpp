@@ -18,13 +18,50 @@ using std::unique_ptr;
 
 namespace proxygen {
 
+HTTPDirectResponse::HTTPDirectResponse(unsigned statusCode,
+                                       const std::string& statusMsg,
+                                       const HTTPErrorPage* errorPage)
+    : statusCode_(statusCode),
+      statusMessage_(statusMsg.empty() ?
+                     HTTPMessage::getDefaultReason(statusCode) : statusMsg) {
+  if (errorPage) {
+    HTTPErrorPage::Page page = errorPage->generate(0, statusCode,
+        statusMsg, nullptr, empty_string);
+    HTTPHeaders headers;
+    headers.add(HTTP_HEADER_CONTENT_TYPE, page.contentType);
+    headers_ = HTTPHeaderTemplate::create(headers);
+    body_ = std::move(page.content);
+  }
+  contentLength_ = folly::to<string>(
+    body_ ? body_->computeChainDataLength() : 0);
+}
+
+void HTTPDirectResponse::prepare(HTTPMessage& response,
+                                 bool forceConnectionClose) const {
+  response.setHTTPVersion(1, 1);
+  response.setStatusCode(statusCode_);
+  response.setStatusMessage(statusMessage_);
+  if (headers_) {
+    response.setHeaderTemplate(headers_);
+  }
+  if (forceConnectionClose) {
+    response.getHeaders().add(HTTP_HEADER_CONNECTION, "close");
+  }
+  response.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH, contentLength_);
+}
+
 HTTPDirectResponseHandler::HTTPDirectResponseHandler(
     unsigned statusCode, const std::string& statusMsg,
     const HTTPErrorPage* errorPage):
+  HTTPDirectResponseHandler(
+    std::make_shared<const HTTPDirectResponse>(statusCode, statusMsg,
+                                               errorPage)) {
+}
+
+HTTPDirectResponseHandler::HTTPDirectResponseHandler(
+    std::shared_ptr<const HTTPDirectResponse> response):
   txn_(nullptr),
-  errorPage_(errorPage),
-  statusMessage_(statusMsg),
-  statusCode_(statusCode),
+  response_(std::move(response)),
   headersSent_(false),
   eomSent_(false),
   forceConnectionClose_(true) {
@@ -48,27 +85,9 @@ void HTTPDirectResponseHandler::onHeadersComplete(
   VLOG(4) << "processing request";
   headersSent_ = true;
   HTTPMessage response;
-  std::unique_ptr<folly::IOBuf> responseBody;
-  response.setHTTPVersion(1, 1);
-  response.setStatusCode(statusCode_);
-  if (!statusMessage_.empty()) {
-    response.setStatusMessage(statusMessage_);
-  } else {
-    response.setStatusMessage(HTTPMessage::getDefaultReason(statusCode_));
-  }
-  if (forceConnectionClose_) {
-    response.getHeaders().add(HTTP_HEADER_CONNECTION, "close");
-  }
-  if (errorPage_) {
-    HTTPErrorPage::Page page = errorPage_->generate(0, statusCode_,
-        statusMessage_, nullptr, empty_string);
-    VLOG(4) << "sending error page with type " << page.contentType;
-    response.getHeaders().add(HTTP_HEADER_CONTENT_TYPE, page.contentType);
-    responseBody = std::move(page.content);
-  }
-  response.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH, folly::to<string>(
-    responseBody ? responseBody->computeChainDataLength() : 0));
+  response_->prepare(response, forceConnectionClose_);
   txn_->sendHeaders(response);
+  auto responseBody = response_->cloneBody();
   if (responseBody) {
     txn_->sendBody(std::move(responseBody));
   }
@@ -15,11 +15,39 @@ namespace proxygen {
 
 class HTTPErrorPage;
 
+/**
+ * The response of HTTPDirectResponseHandlers, built once, error page
+ * included, and shared by the handlers sending it: e.g. the 400s, 408s or
+ * 503s sent in bulk under attack or overload.  The Content-Type goes in an
+ * HTTPHeaderTemplate, which HTTP/1.x codecs write as a shared buffer.
+ */
+class HTTPDirectResponse {
+ public:
+  HTTPDirectResponse(unsigned statusCode, const std::string& statusMsg,
+                     const HTTPErrorPage* errorPage = nullptr);
+
+  // Sets the status and headers of response
+  void prepare(HTTPMessage& response, bool forceConnectionClose) const;
+
+  std::unique_ptr<folly::IOBuf> cloneBody() const {
+    return body_ ? body_->clone() : nullptr;
+  }
+
+ private:
+  unsigned statusCode_;
+  std::string statusMessage_;
+  std::shared_ptr<const HTTPHeaderTemplate> headers_;
+  std::string contentLength_;
+  std::unique_ptr<folly::IOBuf> body_;
+};
+
 class HTTPDirectResponseHandler:
   public HTTPTransaction::Handler {
 public:
   HTTPDirectResponseHandler(unsigned statusCode, const std::string& statusMsg,
       const HTTPErrorPage* errorPage = nullptr);
+  explicit HTTPDirectResponseHandler(
+    std::shared_ptr<const HTTPDirectResponse> response);
 
   void forceConnectionClose(bool close) {
     forceConnectionClose_ = close;
@@ -41,9 +69,7 @@ private:
  ~HTTPDirectResponseHandler() override;
 
   HTTPTransaction* txn_;
-  const HTTPErrorPage* errorPage_;
-  std::string statusMessage_;
-  unsigned statusCode_;
+  std::shared_ptr<const HTTPDirectResponse> response_;
   bool headersSent_:1;
   bool eomSent_:1;
   bool forceConnectionClose_:1;
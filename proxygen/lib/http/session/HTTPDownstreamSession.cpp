@@ -25,7 +25,7 @@ HTTPDownstreamSession::startNow() {
   // Create virtual nodes should happen before startNow since ingress may come
   // before we can finish startNow. Since maxLevel = 0, this is a no-op unless
   // SPDY is used. And no frame will be sent to peer, so ignore returned value.
-  codec_->addPriorityNodes(txnEgressQueue_, writeBuf_, 0);
+  codec_->addPriorityNodes(*txnEgressQueue_, writeBuf_, 0);
   HTTPSession::startNow();
 }
 
@@ -50,9 +50,13 @@ HTTPDownstreamSession::setupOnHeadersComplete(HTTPTransaction* txn,
   // ingress and egress messages have completed (or failed).
   HTTPTransaction::Handler* handler = nullptr;
 
-  // In the general case, delegate to the handler factory to generate
-  // a handler for the transaction.
-  handler = getController()->getRequestHandler(*txn, msg);
+  // Shed the request early when overloaded, or else in the general case,
+  // delegate to the handler factory to generate a handler for the
+  // transaction.
+  handler = getAdmissionRejectHandler();
+  if (!handler) {
+    handler = getController()->getRequestHandler(*txn, msg);
+  }
   CHECK(handler);
 
   DestructorGuard dg(this);
@@ -137,7 +141,7 @@ HTTPDownstreamSession::onNativeProtocolUpgrade(
     bool ret = HTTPSession::onNativeProtocolUpgradeImpl(
       streamID, std::move(codec), protocolString);
     if (ret) {
-      codec_->addPriorityNodes(txnEgressQueue_, writeBuf_, 0);
+      codec_->addPriorityNodes(*txnEgressQueue_, writeBuf_, 0);
     }
     return ret;
   } else {
@@ -87,33 +87,14 @@ class HTTPDownstreamSession final: public HTTPSession {
 
 
   // Upstream methods.  Can implement when servers support making request
-  bool isDetachable(bool) const override {
-    LOG(FATAL) << __func__ << " is an upstream interface";
-    return false;
-  }
-
-  void attachThreadLocals(folly::EventBase*,
-                          folly::SSLContextPtr,
-                          const WheelTimerInstance&,
-                          HTTPSessionStats*,
-                          FilterIteratorFn,
-                          HeaderCodec::Stats*,
-                          HTTPSessionController*) override {
-    LOG(FATAL) << __func__ << " is an upstream interface";
-  }
-
-  void detachThreadLocals(bool) override {
-    LOG(FATAL) << __func__ << " is an upstream interface";
-  }
-
   HTTPTransaction* newTransaction(HTTPTransaction::Handler*) override {
     LOG(FATAL) << __func__ << " is an upstream interface";
     return nullptr;
   }
 
+  // False while the client's early data is being received
   bool isReplaySafe() const override {
-    LOG(FATAL) << __func__ << " is an upstream interface";
-    return false;
+    return sock_->isReplaySafe();
   }
 
   bool isReusable() const override {
@@ -40,6 +40,15 @@ public:
 
   virtual ~HTTPErrorPage() {}
 
+  /**
+   * True if the page generated depends on nothing but the status code and
+   * reason, so that it can be generated once for all the responses with
+   * them.
+   */
+  virtual bool isCacheable() const {
+    return false;
+  }
+
   virtual Page generate(uint64_t requestID,
                         unsigned httpStatusCode,
                         const std::string& reason,
@@ -62,6 +71,10 @@ public:
                 std::unique_ptr<folly::IOBuf> body,
                 const std::string& detailReason) const override;
 
+  bool isCacheable() const override {
+    return true;
+  }
+
 private:
   std::unique_ptr<folly::IOBuf> content_;
   std::string contentType_;
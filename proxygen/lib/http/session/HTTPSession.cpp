@@ -9,21 +9,36 @@
  */
 #include <proxygen/lib/http/session/HTTPSession.h>
 
+#include <algorithm>
 #include <chrono>
 #include <fizz/protocol/AsyncFizzBase.h>
 #include <folly/Conv.h>
 #include <folly/CppAttributes.h>
+#include <folly/File.h>
 #include <folly/Random.h>
+#include <folly/SingletonThreadLocal.h>
+#include <folly/json.h>
 #include <wangle/acceptor/ConnectionManager.h>
 #include <wangle/acceptor/SocketOptions.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
+#include <proxygen/lib/http/codec/FusedHTTPCodecFilter.h>
 #include <proxygen/lib/http/codec/HTTPChecks.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/http/session/RingByteEventTracker.h>
+#include <proxygen/lib/http/session/SocketTimestampByteEventTracker.h>
+#include <proxygen/lib/utils/KernelTLS.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/Cursor.h>
+#include <folly/portability/Sockets.h>
 #include <folly/tracing/ScopedTraceSection.h>
+#include <folly/tracing/StaticTracepoint.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 using fizz::AsyncFizzBase;
 using folly::AsyncSSLSocket;
@@ -52,14 +67,74 @@ static const uint32_t kWriteReadyMax = 65536;
 // Higher = lower latency, less prioritization
 static const uint32_t kMaxWritesPerLoop = 32;
 
+// The most one sendfile(2) of a file body writes
+static const size_t kMaxFileBodyWrite = 256 * 1024;
+
+// The streams of a session dumpConnectionState() logs
+static const size_t kMaxDumpedStreams = 16;
+
 static constexpr folly::StringPiece kClientLabel =
     "EXPORTER HTTP CERTIFICATE client";
 static constexpr folly::StringPiece kServerLabel =
     "EXPORTER HTTP CERTIFICATE server";
+
+// The bytes the buffers of queue can hold
+size_t queueCapacity(const IOBufQueue& queue) {
+  size_t bytes = 0;
+  auto head = queue.front();
+  if (!head) {
+    return 0;
+  }
+  auto buf = head;
+  do {
+    bytes += buf->capacity();
+    buf = buf->next();
+  } while (buf != head);
+  return bytes;
+}
+
+// Read buffers handed back by the sessions of a thread once all their data
+// was parsed, see HTTPSession::setReadBufferPoolSize()
+class ReadBufferPool {
+ public:
+  unique_ptr<IOBuf> take(size_t size, proxygen::BufferAllocator* allocator) {
+    while (!buffers_.empty()) {
+      auto buf = std::move(buffers_.back());
+      buffers_.pop_back();
+      // the read buffer size may have been changed since it was pooled
+      if (buf->capacity() >= size) {
+        return buf;
+      }
+    }
+    return allocator ? allocator->allocate(size) : IOBuf::create(size);
+  }
+
+  void give(unique_ptr<IOBuf> buf, size_t maxBuffers) {
+    if (buffers_.size() < maxBuffers) {
+      buf->clear();
+      buffers_.push_back(std::move(buf));
+    }
+  }
+
+  size_t size() const {
+    return buffers_.size();
+  }
+
+ private:
+  vector<unique_ptr<IOBuf>> buffers_;
+};
+
+ReadBufferPool& getReadBufferPool() {
+  struct PoolTag {};
+  return folly::SingletonThreadLocal<ReadBufferPool, PoolTag>::get();
+}
 } // anonymous namespace
 
 namespace proxygen {
 
+uint32_t HTTPSession::readBufferPoolSize_ = 0;
+std::shared_ptr<BufferAllocator> HTTPSession::bufferAllocator_;
+
 HTTPSession::WriteSegment::WriteSegment(
     HTTPSession* session,
     uint64_t length)
@@ -146,17 +221,19 @@ HTTPSession::HTTPSession(
     ingressError_(false),
     flowControlTimeout_(this),
     drainTimeout_(this),
+    hibernateTimer_(this),
+    rttProbeTimer_(this),
     reads_(SocketState::PAUSED),
     writes_(SocketState::UNPAUSED),
     ingressUpgraded_(false),
     resetSocketOnShutdown_(false),
-    inLoopCallback_(false) {
-  byteEventTracker_ = std::make_shared<ByteEventTracker>(this);
+    inLoopCallback_(false),
+    holdUnsafeRequests_(false),
+    egressHeldForReplaySafety_(false) {
+  byteEventTracker_ = std::make_shared<RingByteEventTracker>(this);
   initialReceiveWindow_ = receiveStreamWindowSize_ =
     receiveSessionWindowSize_ = codec_->getDefaultWindowSize();
 
-  codec_.add<HTTPChecks>();
-
   setupCodec();
 
   nextEgressResults_.reserve(maxConcurrentIncomingStreams_);
@@ -261,11 +338,25 @@ void HTTPSession::setupCodec() {
   codec_->generateConnectionPreface(writeBuf_);
 
   if (codec_->supportsSessionFlowControl() && !connFlowControl_) {
-    connFlowControl_ = new FlowControlFilter(*this, writeBuf_, codec_.call());
+    if (hasHTTPChecks_) {
+      // Upgraded to this codec, after HTTPChecks was added for the first
+      connFlowControl_ = new FlowControlFilter(*this, writeBuf_,
+                                               codec_.call());
+    } else {
+      // The usual chain, with one virtual hop for both filters
+      connFlowControl_ = new FusedHTTPCodecFilter<FlowControlFilter,
+                                                  HTTPChecks>(
+        *this, writeBuf_, codec_.call());
+      hasHTTPChecks_ = true;
+    }
     codec_.addFilters(std::unique_ptr<FlowControlFilter>(connFlowControl_));
     // if we really support switching from spdy <-> h2, we need to update
     // existing flow control filter
   }
+  if (!hasHTTPChecks_) {
+    codec_.add<HTTPChecks>();
+    hasHTTPChecks_ = true;
+  }
 
   codec_.setCallback(this);
 }
@@ -274,8 +365,8 @@ HTTPSession::~HTTPSession() {
   VLOG(4) << *this << " closing";
 
   CHECK(transactions_.empty());
-  txnEgressQueue_.dropPriorityNodes();
-  CHECK(txnEgressQueue_.empty());
+  txnEgressQueue_->dropPriorityNodes();
+  CHECK(txnEgressQueue_->empty());
   DCHECK(!sock_->getReadCallback());
 
   if (writeTimeout_.isScheduled()) {
@@ -286,6 +377,14 @@ HTTPSession::~HTTPSession() {
     flowControlTimeout_.cancelTimeout();
   }
 
+  if (hibernateTimer_.isScheduled()) {
+    hibernateTimer_.cancelTimeout();
+  }
+
+  if (rttProbeTimer_.isScheduled()) {
+    rttProbeTimer_.cancelTimeout();
+  }
+
   runDestroyCallbacks();
 }
 
@@ -296,6 +395,7 @@ void HTTPSession::startNow() {
   if (connFlowControl_) {
     connFlowControl_->setReceiveWindowSize(writeBuf_,
                                            receiveSessionWindowSize_);
+    connReceiveWindowSize_ = receiveSessionWindowSize_;
   }
   // For HTTP/2 if we are currently draining it means we got notified to
   // shutdown before we sent a SETTINGS frame, so we defer sending a GOAWAY
@@ -321,6 +421,40 @@ void HTTPSession::setByteEventTracker(
   }
 }
 
+bool HTTPSession::enableSocketTimestamps(std::chrono::milliseconds timeout) {
+  auto sock = sock_->getUnderlyingTransport<folly::AsyncSocket>();
+  if (!sock) {
+    return false;
+  }
+  // TX and ACK byte events are registered at raw socket offsets
+  sock_->setEorTracking(true);
+  if (!sock_->isEorTrackingEnabled()) {
+    return false;
+  }
+  auto tracker = std::make_shared<SocketTimestampByteEventTracker>(
+    this, sock_->getEventBase(), timeout);
+  if (!tracker->enableSocketTimestamps(sock)) {
+    sock_->setEorTracking(false);
+    return false;
+  }
+  setByteEventTracker(tracker);
+  return true;
+}
+
+bool HTTPSession::setEgressZeroCopyThreshold(size_t threshold) {
+  egressZeroCopyThreshold_ = 0;
+  // AsyncSSLSocket writes the records it encrypted, not our buffers
+  auto sock = dynamic_cast<AsyncSocket*>(sock_.get());
+  if (!sock || dynamic_cast<AsyncSSLSocket*>(sock)) {
+    return false;
+  }
+  if (!sock->setZeroCopy(threshold > 0)) {
+    return false;
+  }
+  egressZeroCopyThreshold_ = threshold;
+  return threshold > 0;
+}
+
 void HTTPSession::setSessionStats(HTTPSessionStats* stats) {
   HTTPSessionBase::setSessionStats(stats);
   if (byteEventTracker_) {
@@ -343,6 +477,119 @@ void HTTPSession::setFlowControl(size_t initialReceiveWindow,
   }
 }
 
+void HTTPSession::enableReceiveWindowAutotuning(
+    size_t maxReceiveSessionWindowSize,
+    size_t maxReceiveStreamWindowSize) {
+  size_t minSessionWindow = std::max<size_t>(receiveSessionWindowSize_,
+                                             codec_->getDefaultWindowSize());
+  bdpEstimator_ = std::make_unique<BDPEstimator>(
+    minSessionWindow, std::max(minSessionWindow, maxReceiveSessionWindowSize));
+  minReceiveStreamWindowSize_ = receiveStreamWindowSize_;
+  maxReceiveStreamWindowSize_ = std::max(receiveStreamWindowSize_,
+                                         maxReceiveStreamWindowSize);
+}
+
+void HTTPSession::fitReceiveWindowToBudget() {
+  size_t window = receiveSessionWindowSize_;
+  if (ingressMemoryBudget_ && ingressMemoryBudget_->isOverLimit()) {
+    window = std::min<size_t>(
+      window, std::max<size_t>(ingressMemoryBudget_->getShare(),
+                               codec_->getDefaultWindowSize()));
+  }
+  if (window == connReceiveWindowSize_) {
+    return;
+  }
+  VLOG(4) << *this << " fitting the receive session window of "
+          << receiveSessionWindowSize_ << " to " << window;
+  if (window > connReceiveWindowSize_) {
+    connFlowControl_->setReceiveWindowSize(writeBuf_, window);
+    scheduleWrite();
+  } else {
+    connFlowControl_->shrinkReceiveWindowSize(window);
+  }
+  connReceiveWindowSize_ = window;
+}
+
+void HTTPSession::enableRttProbes(std::chrono::milliseconds interval) {
+  rttProbeInterval_ = interval;
+  if (interval.count() <= 0) {
+    rttProbeTimer_.cancelTimeout();
+  } else if (!transactions_.empty()) {
+    scheduleRttProbe();
+  }
+}
+
+void HTTPSession::scheduleRttProbe() {
+  if (rttProbeInterval_.count() > 0 && !rttProbeTimer_.isScheduled()) {
+    timeout_.scheduleTimeout(&rttProbeTimer_, rttProbeInterval_);
+  }
+}
+
+void HTTPSession::rttProbeTimeoutExpired() noexcept {
+  // Scheduled again by the next transaction
+  if (transactions_.empty() || !sock_->good()) {
+    return;
+  }
+  if (!rttEstimator_.isPingOutstanding() && !writesShutdown() &&
+      sendPing() == 0) {
+#if defined(__linux__) || defined(__FreeBSD__)
+    // No PINGs in HTTP/1.x, the kernel's estimate is as good
+    TransportInfo tinfo;
+    if (readTransportInfo(&tinfo) && tinfo.tcpinfo.tcpi_rtt > 0) {
+      transportInfo_.tcpinfo.tcpi_rtt = tinfo.tcpinfo.tcpi_rtt;
+      transportInfo_.rtt = std::chrono::microseconds(tinfo.tcpinfo.tcpi_rtt);
+      transportInfo_.rtt_var = tinfo.tcpinfo.tcpi_rttvar;
+    }
+#endif
+  }
+  scheduleRttProbe();
+}
+
+void HTTPSession::enableFrameTrace(size_t maxFrames) {
+  if (!frameTrace_) {
+    frameTrace_ = new FrameTraceFilter(maxFrames);
+    codec_.addFilters(std::unique_ptr<FrameTraceFilter>(frameTrace_));
+  }
+}
+
+void HTTPSession::enableTrafficCapture(
+    std::shared_ptr<TrafficCaptureWriter> writer) {
+  if (!trafficCapture_) {
+    trafficCapture_ = new TrafficCaptureFilter(std::move(writer),
+                                               codec_->getProtocol(),
+                                               codec_->getTransportDirection());
+    codec_.addFilters(std::unique_ptr<TrafficCaptureFilter>(trafficCapture_));
+  }
+}
+
+void HTTPSession::sampleReceiveWindow(uint64_t bytes) {
+  if (bdpEstimator_->onBytesReceived(bytes, getCurrentTime()) &&
+      sendPing() > 0) {
+    bdpEstimator_->onPingSent(getCurrentTime());
+  }
+}
+
+void HTTPSession::resizeReceiveWindows(uint32_t sessionWindow) {
+  VLOG(4) << *this << " resizing the receive session window from "
+          << receiveSessionWindowSize_ << " to " << sessionWindow;
+  bool grow = sessionWindow > receiveSessionWindowSize_;
+  receiveSessionWindowSize_ = sessionWindow;
+  fitReceiveWindowToBudget();
+  HTTPSessionBase::setReadBufferLimit(sessionWindow);
+
+  receiveStreamWindowSize_ = std::min(
+    std::max<size_t>(sessionWindow, minReceiveStreamWindowSize_),
+    maxReceiveStreamWindowSize_);
+  if (grow) {
+    // Transactions refuse to shrink their windows, only new ones start
+    // smaller
+    for (auto& it : transactions_) {
+      it.second.setReceiveWindow(receiveStreamWindowSize_);
+    }
+  }
+  scheduleWrite();
+}
+
 void HTTPSession::setEgressSettings(const SettingsList& inSettings) {
   VLOG_IF(4, started_) << "Must flush egress settings to peer";
   HTTPSettings* settings = codec_->getEgressSettings();
@@ -350,17 +597,33 @@ void HTTPSession::setEgressSettings(const SettingsList& inSettings) {
     for (const auto& setting: inSettings) {
       settings->setSetting(setting.id, setting.value);
     }
+  } else if (h2cPriorKnowledge_) {
+    auto& egressSettings = h2cPriorKnowledge_->egressSettings;
+    egressSettings.insert(egressSettings.end(),
+                          inSettings.begin(), inSettings.end());
   }
 }
 
 void HTTPSession::setMaxConcurrentIncomingStreams(uint32_t num) {
-  CHECK(!started_);
-  if (codec_->supportsParallelRequests()) {
-    maxConcurrentIncomingStreams_ = num;
-    HTTPSettings* settings = codec_->getEgressSettings();
-    if (settings) {
-      settings->setSetting(SettingsId::MAX_CONCURRENT_STREAMS,
-                           maxConcurrentIncomingStreams_);
+  if (!codec_->supportsParallelRequests()) {
+    if (h2cPriorKnowledge_) {
+      h2cPriorKnowledge_->maxConcurrentIncomingStreams = num;
+    }
+    return;
+  }
+  if (started_ && num == maxConcurrentIncomingStreams_) {
+    return;
+  }
+  maxConcurrentIncomingStreams_ = num;
+  HTTPSettings* settings = codec_->getEgressSettings();
+  if (settings) {
+    settings->setSetting(SettingsId::MAX_CONCURRENT_STREAMS,
+                         maxConcurrentIncomingStreams_);
+    // A started session advertises the new limit right away.  The codec
+    // refuses the streams above it already, those the peer opened before
+    // it got the SETTINGS included.
+    if (started_ && !writesShutdown()) {
+      sendSettings();
     }
   }
 }
@@ -370,6 +633,120 @@ void HTTPSession::setEgressBytesLimit(uint64_t bytesLimit) {
   egressBytesLimit_ = bytesLimit;
 }
 
+void HTTPSession::setMaxPipelineBatch(uint32_t maxBatch) {
+  if (!codec_->supportsParallelRequests()) {
+    maxPipelineBatch_ = std::max(maxBatch, 1u);
+  }
+}
+
+void HTTPSession::setEgressChunkCoalescing(uint32_t maxLength) {
+  if (!codec_->supportsParallelRequests()) {
+    maxCoalescedChunk_ = maxLength;
+  }
+}
+
+void HTTPSession::setStreamResetLimit(uint32_t maxResets,
+                                      std::chrono::milliseconds interval) {
+  if (h2cPriorKnowledge_ && !codec_->supportsParallelRequests()) {
+    h2cPriorKnowledge_->maxStreamResets = maxResets;
+    h2cPriorKnowledge_->streamResetInterval = interval;
+  }
+  if (maxResets == 0 || isUpstream() || !codec_->supportsParallelRequests()) {
+    maxStreamResets_ = 0;
+    createPendingTransactions();
+    closedStreams_.reset();
+    return;
+  }
+  maxStreamResets_ = maxResets;
+  streamResetInterval_ = interval;
+  streamResets_ = 0;
+  if (!closedStreams_) {
+    closedStreams_ = std::make_unique<ClosedStreamSet>();
+  }
+}
+
+void HTTPSession::enableH2cPriorKnowledge() {
+  CHECK(!started_);
+  if (isUpstream() || transportInfo_.secure ||
+      codec_->supportsParallelRequests()) {
+    return;
+  }
+  h2cPriorKnowledge_ = std::make_unique<H2cPriorKnowledge>();
+}
+
+void HTTPSession::setEgressBatchPolicy(const EgressBatchPolicy& policy) {
+  egressBatchPolicy_ = policy;
+  egressBatchTarget_ = policy.targetBytesPerWrite;
+  setNotSentLowat(policy.notSentLowat);
+  if (trackNotSentLowat()) {
+    updateNotSentLowat();
+  }
+}
+
+void HTTPSession::setEgressScheduler(
+    std::shared_ptr<EgressScheduler> scheduler) {
+  CHECK(!scheduler || scheduler->getEventBase() == getEventBase());
+  cancelScheduledEgress();
+  egressScheduler_ = std::move(scheduler);
+  scheduleWrite();
+}
+
+uint64_t HTTPSession::runScheduledEgress(uint64_t budget) noexcept {
+  DestructorGuard dg(this);
+  inScheduledEgress_ = true;
+  egressBudgetLeft_ = budget;
+  runLoopCallback();
+  inScheduledEgress_ = false;
+  return budget - egressBudgetLeft_;
+}
+
+void HTTPSession::setNotSentLowat(uint32_t lowat) {
+  if (lowat == 0 || lowat == notSentLowat_ || !sock_) {
+    return;
+  }
+#ifdef TCP_NOTSENT_LOWAT
+  auto sock = sock_->getUnderlyingTransport<folly::AsyncSocket>();
+  if (sock) {
+    int value = lowat;
+    if (sock->setSockOpt(IPPROTO_TCP, TCP_NOTSENT_LOWAT, &value) != 0) {
+      VLOG(2) << *this << " failed to set TCP_NOTSENT_LOWAT";
+      return;
+    }
+    VLOG(4) << *this << " TCP_NOTSENT_LOWAT=" << lowat;
+    notSentLowat_ = lowat;
+  }
+#endif
+}
+
+void HTTPSession::updateNotSentLowat() {
+#if defined(__linux__) && defined(TCP_NOTSENT_LOWAT)
+  auto sock = sock_ ? sock_->getUnderlyingTransport<folly::AsyncSocket>() :
+    nullptr;
+  if (!sock) {
+    return;
+  }
+  struct tcp_info info;
+  socklen_t len = sizeof(info);
+  if (sock->getSockOpt(IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+    return;
+  }
+  // The bytes the connection can have in flight in one round trip
+  uint64_t bdp = uint64_t(info.tcpi_snd_cwnd) * info.tcpi_snd_mss;
+  bdp = std::max<uint64_t>(bdp, egressBatchPolicy_.notSentLowat);
+  setNotSentLowat(std::min<uint64_t>(bdp, egressBatchPolicy_.maxNotSentLowat));
+#endif
+}
+
+bool HTTPSession::egressBatchComplete(TimePoint batchStart) const {
+  if (writeBuf_.chainLength() >= egressBatchTarget_ ||
+      (trackNotSentLowat() && notSentLowat_ > 0 &&
+       writeBuf_.chainLength() >= notSentLowat_)) {
+    return true;
+  }
+  return egressBatchPolicy_.maxLatency.count() > 0 &&
+    getCurrentTime() - batchStart >= egressBatchPolicy_.maxLatency;
+}
+
 void
 HTTPSession::readTimeoutExpired() noexcept {
   VLOG(3) << "session-level timeout on " << *this;
@@ -409,13 +786,74 @@ void
 HTTPSession::writeTimeoutExpired() noexcept {
   VLOG(4) << "Write timeout for " << *this;
 
-  CHECK(!pendingWrites_.empty());
+  CHECK(!pendingWrites_.empty() || fileBodyWriter_.isHandlerRegistered());
   DestructorGuard g(this);
 
   setCloseReason(ConnectionCloseReason::TIMEOUT);
   shutdownTransportWithReset(kErrorWriteTimeout);
 }
 
+void
+HTTPSession::hibernate() noexcept {
+  if (!transactions_.empty() || writesShutdown()) {
+    return;
+  }
+  VLOG(4) << "Hibernating " << *this;
+  auto bytesBefore = getMemoryUsage().total();
+  codec_->hibernate();
+  // Nodes the peer created for priorities; ours are permanent and stay
+  txnEgressQueue_->dropPriorityNodes();
+  // Empty queues may still hold a buffer with tailroom
+  if (readBuf_.empty()) {
+    readBuf_.move();
+  }
+  if (writeBuf_.empty()) {
+    writeBuf_.move();
+  }
+  if (sessionStats_) {
+    sessionStats_->recordSessionHibernated(bytesBefore,
+                                           getMemoryUsage().total());
+  }
+}
+
+HTTPSessionMemoryUsage
+HTTPSession::getMemoryUsage() const {
+  auto usage = HTTPSessionBase::getMemoryUsage();
+  usage.codec = codec_->getMemoryUsage();
+  usage.readBuffer = queueCapacity(readBuf_);
+  usage.writeBuffer = queueCapacity(writeBuf_);
+  for (const auto& it : transactions_) {
+    usage.transactionEgress += it.second.getDeferredEgressBodyLength();
+  }
+  // The rest of the buffered egress was handed to the socket
+  auto pendingWrites = int64_t(pendingWriteSize_) + pendingWriteSizeDelta_;
+  if (pendingWrites > int64_t(usage.transactionEgress)) {
+    usage.writeBuffer += pendingWrites - usage.transactionEgress;
+  }
+  if (byteEventTracker_) {
+    usage.byteEvents = byteEventTracker_->getMemoryUsage();
+  }
+  return usage;
+}
+
+void HTTPSession::getStateSnapshot(HTTPSessionStateSnapshot& snapshot,
+                                   size_t maxStreams) const {
+  HTTPSessionBase::getStateSnapshot(snapshot, maxStreams);
+  if (connFlowControl_) {
+    snapshot.recvWindow = connFlowControl_->getReceiveWindowCapacity();
+  }
+  snapshot.compression = codec_->getCompressionInfo();
+  snapshot.numStreams = transactions_.size();
+  snapshot.streams.reserve(std::min(maxStreams, transactions_.size()));
+  for (const auto& it : transactions_) {
+    if (snapshot.streams.size() >= maxStreams) {
+      break;
+    }
+    snapshot.streams.emplace_back();
+    it.second.getStateSnapshot(snapshot.streams.back());
+  }
+}
+
 void
 HTTPSession::flowControlTimeoutExpired() noexcept {
   VLOG(4) << "Flow control timeout for " << *this;
@@ -475,6 +913,7 @@ void HTTPSession::immediateShutdown() {
   if (isLoopCallbackScheduled()) {
     cancelLoopCallback();
   }
+  cancelScheduledEgress();
   if (shutdownTransportCb_) {
     shutdownTransportCb_.reset();
   }
@@ -507,7 +946,15 @@ HTTPSession::dropConnection() {
   shutdownTransportWithReset(kErrorDropped);
 }
 
-void HTTPSession::dumpConnectionState(uint8_t /*loglevel*/) {}
+void HTTPSession::dumpConnectionState(uint8_t loglevel) {
+  // One line per session, and only when asked for at this level
+  if (!VLOG_IS_ON(loglevel)) {
+    return;
+  }
+  HTTPSessionStateSnapshot snapshot;
+  getStateSnapshot(snapshot, kMaxDumpedStreams);
+  VLOG(loglevel) << *this << " state=" << folly::toJson(snapshot.toDynamic());
+}
 
 bool HTTPSession::isUpstream() const {
   return codec_->getTransportDirection() == TransportDirection::UPSTREAM;
@@ -520,6 +967,18 @@ bool HTTPSession::isDownstream() const {
 void
 HTTPSession::getReadBuffer(void** buf, size_t* bufSize) {
   FOLLY_SCOPED_TRACE_SECTION("HTTPSession - getReadBuffer");
+  if (readBufferPoolSize_ > 0 && readBuf_.empty()) {
+    auto& pool = getReadBufferPool();
+    readBuf_.append(pool.take(HTTPSessionBase::maxReadBufferSize_,
+                              bufferAllocator_.get()));
+    if (sessionStats_) {
+      sessionStats_->recordReadBufferPoolOccupancy(pool.size());
+    }
+  } else if (bufferAllocator_ && readBuf_.tailroom() < kMinReadSize) {
+    // Rather than preallocate() from malloc
+    readBuf_.append(
+      bufferAllocator_->allocate(HTTPSessionBase::maxReadBufferSize_));
+  }
   pair<void*,uint32_t> readSpace =
     readBuf_.preallocate(kMinReadSize, HTTPSessionBase::maxReadBufferSize_);
   *buf = readSpace.first;
@@ -570,9 +1029,21 @@ void
 HTTPSession::processReadData() {
   FOLLY_SCOPED_TRACE_SECTION("HTTPSession - processReadData");
 
+  if (h2cPriorKnowledge_ && !readBuf_.empty() && !checkH2cPriorKnowledge()) {
+    // Not enough of the first bytes to tell yet
+    return;
+  }
+
   // Pass the ingress data through the codec to parse it. The codec
   // will invoke various methods of the HTTPSession as callbacks.
   while (!ingressError_ && readsUnpaused() && !readBuf_.empty()) {
+    if (pipelineBatchFull()) {
+      // Let the loop callback flush the batch; it resumes parsing after
+      if (!isLoopCallbackScheduled()) {
+        sock_->getEventBase()->runInLoop(this);
+      }
+      break;
+    }
     // Skip any 0 length buffers before invoking the codec. Since readBuf_ is
     // not empty, we are guaranteed to find a non-empty buffer.
     while (readBuf_.front()->length() == 0) {
@@ -587,7 +1058,93 @@ HTTPSession::processReadData() {
       // better get more.
       break;
     }
-    readBuf_.trimStart(bytesParsed);
+    if (readBufferPoolSize_ > 0 && bytesParsed == readBuf_.chainLength()) {
+      // Fully parsed, don't keep the buffer while the connection idles
+      recycleReadBuffer();
+    } else {
+      readBuf_.trimStart(bytesParsed);
+    }
+  }
+  createPendingTransactions();
+  flushHeldIngressBody();
+}
+
+bool HTTPSession::checkH2cPriorKnowledge() {
+  auto preface = HTTPCodecFactory::isHTTP2Preface(*readBuf_.front());
+  if (!preface) {
+    return false;
+  }
+  if (*preface) {
+    onH2cPriorKnowledge();
+  }
+  h2cPriorKnowledge_.reset();
+  return true;
+}
+
+void HTTPSession::onH2cPriorKnowledge() {
+  VLOG(4) << *this << " got the HTTP/2 connection preface";
+  auto priorKnowledge = std::move(h2cPriorKnowledge_);
+  maxConcurrentIncomingStreams_ =
+    priorKnowledge->maxConcurrentIncomingStreams > 0 ?
+    priorKnowledge->maxConcurrentIncomingStreams :
+    kDefaultMaxConcurrentIncomingStreams;
+  maxConcurrentOutgoingStreamsRemote_ =
+    kDefaultMaxConcurrentOutgoingStreamsRemote;
+  // Only HTTP/1.x pipelines and chunks
+  maxPipelineBatch_ = 1;
+  maxCoalescedChunk_ = 0;
+
+  // The new codec parses the preface itself
+  switchToParallelCodec(
+    HTTPCodecFactory::getCodec(CodecProtocol::HTTP_2,
+                               TransportDirection::DOWNSTREAM),
+    priorKnowledge->egressSettings);
+  codec_->addPriorityNodes(*txnEgressQueue_, writeBuf_, 0);
+  if (priorKnowledge->maxStreamResets > 0) {
+    setStreamResetLimit(priorKnowledge->maxStreamResets,
+                        priorKnowledge->streamResetInterval);
+  }
+  // As from startNow(), had the session been draining
+  if (draining_) {
+    codec_->generateGoaway(writeBuf_,
+                           getGracefulGoawayAck(),
+                           ErrorCode::NO_ERROR);
+    scheduleWrite();
+  }
+
+  if (!transportInfo_.appProtocol || transportInfo_.appProtocol->empty()) {
+    transportInfo_.appProtocol = std::make_shared<string>(
+      http2::kProtocolCleartextString);
+  }
+}
+
+void
+HTTPSession::flushHeldIngressBody() {
+  if (heldIngressBodyStreams_.empty()) {
+    return;
+  }
+  std::vector<HTTPCodec::StreamID> streams;
+  streams.swap(heldIngressBodyStreams_);
+  for (auto streamID : streams) {
+    // Delivering body may end other transactions
+    auto txn = findTransaction(streamID);
+    if (txn) {
+      txn->flushIngressBody();
+    }
+  }
+}
+
+void
+HTTPSession::recycleReadBuffer() {
+  auto buf = readBuf_.move();
+  // Buffers the codec cloned body data out of are still in use
+  if (buf->isChained() || buf->isShared()) {
+    return;
+  }
+  auto& pool = getReadBufferPool();
+  pool.give(std::move(buf), readBufferPoolSize_);
+  if (sessionStats_) {
+    sessionStats_->recordReadBufferPoolOccupancy(pool.size());
   }
 }
 
@@ -730,12 +1287,12 @@ HTTPSession::getMessagePriority(const HTTPMessage* msg) {
 void
 HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID, HTTPMessage* msg) {
   VLOG(4) << "processing new msg streamID=" << streamID << " " << *this;
-  if (infoCallback_) {
-    infoCallback_->onRequestBegin(*this);
-  }
-
+  FOLLY_SDT(proxygen, session_message_begin, streamID);
   HTTPTransaction* txn = findTransaction(streamID);
   if (txn) {
+    if (infoCallback_) {
+      infoCallback_->onRequestBegin(*this);
+    }
     if (isDownstream() && txn->isPushed()) {
       // Push streams are unidirectional (half-closed). If the downstream
       // attempts to send ingress, abort with STREAM_CLOSED error.
@@ -748,8 +1305,24 @@ HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID, HTTPMessage* msg) {
   }
 
   http2::PriorityUpdate messagePriority = getMessagePriority(msg);
-  txn = createTransaction(streamID, HTTPCodec::NoStream,
-                          HTTPCodec::NoExAttributes, messagePriority);
+  if (closedStreams_ && !findPendingStream(streamID)) {
+    // Wait for the end of the read to see if the stream is reset already
+    pendingStreams_.push_back({streamID, messagePriority, nullptr, false});
+    return;
+  }
+  startIngressTransaction(streamID, messagePriority);
+}
+
+void
+HTTPSession::startIngressTransaction(HTTPCodec::StreamID streamID,
+                                     const http2::PriorityUpdate& priority) {
+  if (infoCallback_) {
+    infoCallback_->onRequestBegin(*this);
+  }
+
+  HTTPTransaction* txn = createTransaction(streamID, HTTPCodec::NoStream,
+                                           HTTPCodec::NoExAttributes,
+                                           priority);
   if (!txn) {
     return;  // This could happen if the socket is bad.
   }
@@ -772,11 +1345,13 @@ HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID, HTTPMessage* msg) {
     // There must be at least two transactions (we just checked). The previous
     // txns haven't completed yet. Pause reads until they complete
     DCHECK_GE(transactions_.size(), 2);
-    for (auto it = ++transactions_.rbegin(); it != transactions_.rend(); ++it) {
-      DCHECK(it->second.isIngressEOMSeen());
-      it->second.pauseIngress();
+    auto ids = getSortedTransactionIds();
+    for (auto it = ++ids.rbegin(); it != ids.rend(); ++it) {
+      auto& txn = transactions_.at(*it);
+      DCHECK(txn.isIngressEOMSeen());
+      txn.pauseIngress();
     }
-    transactions_.rbegin()->second.pauseIngress();
+    transactions_.at(ids.back()).pauseIngress();
     DCHECK_EQ(liveTransactions_, 0);
     DCHECK(readsPaused());
   }
@@ -836,6 +1411,8 @@ HTTPSession::onExMessageBegin(HTTPCodec::StreamID streamID,
                               HTTPMessage* msg) {
   VLOG(4) << "processing new ExMessage=" << streamID
           << " on controlStream=" << controlStream << ", " << *this;
+  // The control stream may be one of them
+  createPendingTransactions();
   if (infoCallback_) {
     infoCallback_->onRequestBegin(*this);
   }
@@ -873,8 +1450,17 @@ HTTPSession::onHeadersComplete(HTTPCodec::StreamID streamID,
                                unique_ptr<HTTPMessage> msg) {
   // The codec's parser detected the end of an ingress message's
   // headers.
+  auto pending = findPendingStream(streamID);
+  if (pending && !pending->msg) {
+    pending->msg = std::move(msg);
+    return;
+  }
+  createPendingTransactions();
   VLOG(4) << "processing ingress headers complete for " << *this <<
       ", streamID=" << streamID;
+  FOLLY_SDT(proxygen, session_headers_complete, streamID,
+            msg->getIngressHeaderSize().compressed,
+            msg->getIngressHeaderSize().uncompressed);
 
   if (!codec_->isReusable()) {
     setCloseReason(ConnectionCloseReason::REQ_NOTREUSABLE);
@@ -944,23 +1530,35 @@ HTTPSession::onBody(HTTPCodec::StreamID streamID,
                     unique_ptr<IOBuf> chain, uint16_t padding) {
   FOLLY_SCOPED_TRACE_SECTION("HTTPSession - onBody");
   DestructorGuard dg(this);
+  createPendingTransactions();
   // The codec's parser detected part of the ingress message's
   // entity-body.
   uint64_t length = chain->computeChainDataLength();
+  if (bdpEstimator_ && connFlowControl_) {
+    sampleReceiveWindow(length + padding);
+  }
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
-    if (connFlowControl_ &&
-        connFlowControl_->ingressBytesProcessed(writeBuf_, length)) {
-      scheduleWrite();
-    }
+    connIngressBytesProcessed(length);
     invalidStream(streamID);
     return;
   }
 
+  bool wasHeld = txn->hasHeldIngressBody();
   if (HTTPSessionBase::onBodyImpl(std::move(chain), length, padding, txn)) {
     VLOG(4) << *this << " pausing due to read limit exceeded.";
     pauseReads();
   }
+  if (!wasHeld) {
+    // Coalesced body is delivered by the end of processReadData()
+    txn = findTransaction(streamID);
+    if (txn && txn->hasHeldIngressBody()) {
+      heldIngressBodyStreams_.push_back(streamID);
+    }
+  }
+  if (ingressMemoryBudget_ && connFlowControl_) {
+    fitReceiveWindowToBudget();
+  }
 }
 
 void HTTPSession::onChunkHeader(HTTPCodec::StreamID streamID,
@@ -980,6 +1578,7 @@ void HTTPSession::onChunkHeader(HTTPCodec::StreamID streamID,
   // In that scenario, we preserve the server's chunk boundaries when
   // sending the response to the client, in order to avoid possibly
   // making the egress packetization worse by rechunking.
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     invalidStream(streamID);
@@ -991,6 +1590,7 @@ void HTTPSession::onChunkHeader(HTTPCodec::StreamID streamID,
 void HTTPSession::onChunkComplete(HTTPCodec::StreamID streamID) {
   // The codec's parser detected the end of the message body chunk
   // associated with the most recent call to onChunkHeader().
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     invalidStream(streamID);
@@ -1002,6 +1602,7 @@ void HTTPSession::onChunkComplete(HTTPCodec::StreamID streamID) {
 void
 HTTPSession::onTrailersComplete(HTTPCodec::StreamID streamID,
                                 unique_ptr<HTTPHeaders> trailers) {
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     invalidStream(streamID);
@@ -1018,6 +1619,12 @@ HTTPSession::onMessageComplete(HTTPCodec::StreamID streamID,
   // this transaction.
   VLOG(4) << "processing ingress message complete for " << *this <<
     ", streamID=" << streamID;
+  auto pending = findPendingStream(streamID);
+  if (pending && pending->msg && !upgrade) {
+    pending->eom = true;
+    return;
+  }
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     invalidStream(streamID);
@@ -1093,10 +1700,13 @@ void HTTPSession::onError(HTTPCodec::StreamID streamID,
 
   if (!streamID) {
     ingressError_ = true;
+    // The streams waiting for a transaction go with the connection
+    pendingStreams_.clear();
     onSessionParseError(error);
     return;
   }
 
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     if (error.hasHttpStatusCode() && streamID != 0) {
@@ -1137,6 +1747,20 @@ void HTTPSession::onAbort(HTTPCodec::StreamID streamID,
                           ErrorCode code) {
   VLOG(4) << "stream abort on " << *this << ", streamID=" << streamID
           << ", code=" << getErrorCodeString(code);
+  DestructorGuard dg(this);
+  if (!onStreamReset(streamID)) {
+    return;
+  }
+  auto pending = findPendingStream(streamID);
+  if (pending) {
+    // Reset before anything needed it, so it never gets a transaction
+    VLOG(4) << *this << " abort for pending stream, streamID=" << streamID;
+    pendingStreams_.erase(pendingStreams_.begin() +
+                          (pending - pendingStreams_.data()));
+    closedStreams_->add(streamID);
+    return;
+  }
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     VLOG(4) << *this << " abort for unrecognized transaction, streamID= "
@@ -1148,7 +1772,6 @@ void HTTPSession::onAbort(HTTPCodec::StreamID streamID,
       streamID, ", code=", getErrorCodeString(code)));
   ex.setProxygenError(kErrorStreamAbort);
   ex.setCodecStatusCode(code);
-  DestructorGuard dg(this);
   if (isDownstream() && !txn->getAssocTxnId() && code == ErrorCode::CANCEL) {
     // Cancelling the assoc txn cancels all push txns
     for (auto it = txn->getPushedTransactions().begin();
@@ -1174,6 +1797,7 @@ void HTTPSession::onGoaway(uint64_t lastGoodStreamID,
                            std::unique_ptr<folly::IOBuf> debugData) {
   DestructorGuard g(this);
   VLOG(4) << "GOAWAY on " << *this << ", code=" << getErrorCodeString(code);
+  createPendingTransactions();
 
   setCloseReason(ConnectionCloseReason::GOAWAY);
 
@@ -1191,12 +1815,11 @@ void HTTPSession::onGoaway(uint64_t lastGoodStreamID,
   vector<HTTPCodec::StreamID> ids;
   auto firstStream = HTTPCodec::NoStream;
 
-  for (const auto& txn: transactions_) {
-    auto streamID = txn.first;
+  for (auto streamID: getSortedTransactionIds()) {
     if (((bool)(streamID & 0x01) == isUpstream()) &&
         (streamID > lastGoodStreamID)) {
       if (firstStream == HTTPCodec::NoStream) {
-        // transactions_ is a set so it should be sorted by stream id.
+        // The ids are sorted, so this is the lowest unacknowledged stream.
         // We will defer adding the firstStream to the id list until
         // we can determine whether we have a codec error code.
         firstStream = streamID;
@@ -1253,12 +1876,23 @@ void HTTPSession::onPingReply(uint64_t uniqueID) {
   if (infoCallback_) {
     infoCallback_->onPingReplyReceived();
   }
+  // Codecs pick the ids of our PINGs, so the reply to any of them ends the
+  // sample, if a bit early when it was not the sample's
+  rttEstimator_.onPingReply(getCurrentTime());
+  if (bdpEstimator_ && bdpEstimator_->isSampling()) {
+    auto window = bdpEstimator_->onPingReply(getCurrentTime(),
+                                             receiveSessionWindowSize_);
+    if (window && connFlowControl_) {
+      resizeReceiveWindows(*window);
+    }
+  }
 }
 
 void HTTPSession::onWindowUpdate(HTTPCodec::StreamID streamID,
                                  uint32_t amount) {
   VLOG(4) << *this << " got window update on streamID=" << streamID << " for "
           << amount << " bytes.";
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     // We MUST be using SPDY/3+ if we got WINDOW_UPDATE. The spec says that -
@@ -1274,6 +1908,7 @@ void HTTPSession::onWindowUpdate(HTTPCodec::StreamID streamID,
 
 void HTTPSession::onSettings(const SettingsList& settings) {
   DestructorGuard g(this);
+  createPendingTransactions();
   for (auto& setting : settings) {
     if (setting.id == SettingsId::INITIAL_WINDOW_SIZE) {
       onSetSendWindow(setting.value);
@@ -1300,6 +1935,16 @@ void HTTPSession::onSettingsAck() {
   }
 }
 
+void HTTPSession::onHeaderEncodeCache(bool hit) {
+  if (sessionStats_) {
+    if (hit) {
+      sessionStats_->recordHeaderEncodeCacheHit();
+    } else {
+      sessionStats_->recordHeaderEncodeCacheMiss();
+    }
+  }
+}
+
 void HTTPSession::onPriority(HTTPCodec::StreamID streamID,
                              const HTTPMessage::HTTPPriority& pri) {
   if (!getHTTP2PrioritiesEnabled()) {
@@ -1307,13 +1952,14 @@ void HTTPSession::onPriority(HTTPCodec::StreamID streamID,
   }
   http2::PriorityUpdate h2Pri{std::get<0>(pri), std::get<1>(pri),
       std::get<2>(pri)};
+  createPendingTransactions();
   HTTPTransaction* txn = findTransaction(streamID);
   if (txn) {
     // existing txn, change pri
     txn->onPriorityUpdate(h2Pri);
   } else {
     // virtual node
-    txnEgressQueue_.addOrUpdatePriorityNode(streamID, h2Pri);
+    txnEgressQueue_->addOrUpdatePriorityNode(streamID, h2Pri);
   }
 }
 
@@ -1405,6 +2051,29 @@ bool HTTPSession::onNativeProtocolUpgradeImpl(
   maxConcurrentOutgoingStreamsRemote_ =
     kDefaultMaxConcurrentOutgoingStreamsRemote;
 
+  switchToParallelCodec(std::move(codec), SettingsList());
+
+  // txn will be streamID=1, have to make a placeholder
+  (void)codec_->createStream();
+
+  // Convert the transaction that contained the Upgrade header
+  txn->reset(codec_->supportsStreamFlowControl(),
+             initialReceiveWindow_,
+             receiveStreamWindowSize_,
+             getCodecSendWindowSize());
+
+  if (!transportInfo_.secure &&
+      (!transportInfo_.appProtocol ||
+       transportInfo_.appProtocol->empty())) {
+    transportInfo_.appProtocol = std::make_shared<string>(
+      protocolString);
+  }
+
+  return true;
+}
+
+void HTTPSession::switchToParallelCodec(std::unique_ptr<HTTPCodec> codec,
+                                        const SettingsList& egressSettings) {
   // overwrite destination, delay current codec deletion until the end
   // of the event loop
   auto oldCodec = codec_.setDestination(std::move(codec));
@@ -1414,9 +2083,6 @@ bool HTTPSession::onNativeProtocolUpgradeImpl(
 
   setupCodec();
 
-  // txn will be streamID=1, have to make a placeholder
-  (void)codec_->createStream();
-
   // This can happen if flow control was not explicitly set, and it got the
   // HTTP1xCodec defaults.  Reset to the new codec default
   if (initialReceiveWindow_ == 0 || receiveStreamWindowSize_ == 0 ||
@@ -1428,6 +2094,9 @@ bool HTTPSession::onNativeProtocolUpgradeImpl(
   // trigger settings frame that would have gone out in startNow()
   HTTPSettings* settings = codec_->getEgressSettings();
   if (settings) {
+    for (const auto& setting: egressSettings) {
+      settings->setSetting(setting.id, setting.value);
+    }
     settings->setSetting(SettingsId::INITIAL_WINDOW_SIZE,
                          initialReceiveWindow_);
   }
@@ -1435,23 +2104,9 @@ bool HTTPSession::onNativeProtocolUpgradeImpl(
   if (connFlowControl_) {
     connFlowControl_->setReceiveWindowSize(writeBuf_,
                                            receiveSessionWindowSize_);
+    connReceiveWindowSize_ = receiveSessionWindowSize_;
     scheduleWrite();
   }
-
-  // Convert the transaction that contained the Upgrade header
-  txn->reset(codec_->supportsStreamFlowControl(),
-             initialReceiveWindow_,
-             receiveStreamWindowSize_,
-             getCodecSendWindowSize());
-
-  if (!transportInfo_.secure &&
-      (!transportInfo_.appProtocol ||
-       transportInfo_.appProtocol->empty())) {
-    transportInfo_.appProtocol = std::make_shared<string>(
-      protocolString);
-  }
-
-  return true;
 }
 
 void HTTPSession::onSetSendWindow(uint32_t windowSize) {
@@ -1560,6 +2215,12 @@ void HTTPSession::sendHeaders(HTTPTransaction* txn,
                               HTTPHeaderSize* size,
                               bool includeEOM) noexcept {
   CHECK(started_);
+  if (headers.getHeaderTemplate() && !codec_->supportsHeaderTemplates()) {
+    HTTPMessage merged(headers);
+    merged.applyHeaderTemplate();
+    sendHeaders(txn, merged, size, includeEOM);
+    return;
+  }
   unique_ptr<IOBuf> goawayBuf;
   if (shouldShutdown()) {
     // For HTTP/1.1, add Connection: close
@@ -1576,6 +2237,15 @@ void HTTPSession::sendHeaders(HTTPTransaction* txn,
       txn->onPriorityUpdate(pri);
     }
   }
+  if (holdUnsafeRequests_ && isUpstream() && headers.isRequest() &&
+      !egressHeldForReplaySafety_ && !sock_->isReplaySafe()) {
+    auto method = headers.getMethod();
+    if (!method || !isSafeMethod(*method)) {
+      // Keep the request out of the early data, which the network may replay
+      VLOG(4) << *this << " holding egress until the transport is replay safe";
+      egressHeldForReplaySafety_ = true;
+    }
+  }
 
   const bool wasReusable = codec_->isReusable();
   const uint64_t oldOffset = sessionByteOffset();
@@ -1675,6 +2345,63 @@ HTTPSession::sendBody(HTTPTransaction* txn,
   return encodedSize;
 }
 
+bool
+HTTPSession::canSendFileBody(const HTTPTransaction* /*txn*/) const noexcept {
+#ifdef __linux__
+  // sendfile(2) writes the body as is, so it needs HTTP/1.x framing and a
+  // socket that is plaintext or encrypted by the kernel.  The socket
+  // timestamps of EOR tracking are only taken on AsyncSocket writes.
+  if (codec_->getProtocol() != CodecProtocol::HTTP_1_1 ||
+      sock_->isEorTrackingEnabled()) {
+    return false;
+  }
+  auto sock = dynamic_cast<const AsyncSocket*>(sock_.get());
+  if (!sock) {
+    return false;
+  }
+  auto sslSock = dynamic_cast<const AsyncSSLSocket*>(sock);
+  return !sslSock || kernelTLSSendEnabled(*sslSock);
+#else
+  return false;
+#endif
+}
+
+size_t
+HTTPSession::sendFileBody(HTTPTransaction* txn,
+                          std::shared_ptr<folly::File> file,
+                          off_t offset,
+                          size_t length,
+                          bool includeEOM,
+                          bool trackLastByteFlushed) noexcept {
+  CHECK(inLoopCallback_);
+  DCHECK(canSendFileBody(txn));
+  uint64_t startOffset = sessionByteOffset();
+  size_t encodedSize = codec_->generateChunkHeader(writeBuf_,
+                                                   txn->getID(),
+                                                   length);
+  queueFileBody(std::move(file), offset, length);
+  encodedSize += length;
+  encodedSize += codec_->generateChunkTerminator(writeBuf_, txn->getID());
+  if (includeEOM) {
+    encodedSize += codec_->generateEOM(writeBuf_, txn->getID());
+  }
+  bodyBytesPerWriteBuf_ += length;
+  if (!txn->testAndSetFirstByteSent() && byteEventTracker_) {
+    byteEventTracker_->addFirstBodyByteEvent(startOffset + 1, txn);
+  }
+
+  if (trackLastByteFlushed && byteEventTracker_) {
+    byteEventTracker_->addTrackedByteEvent(txn, startOffset + encodedSize);
+  }
+
+  if (includeEOM) {
+    VLOG(5) << *this << " sending EOM in file body for streamID="
+            << txn->getID();
+    commonEom(txn, encodedSize, true);
+  }
+  return encodedSize;
+}
+
 size_t HTTPSession::sendChunkHeader(HTTPTransaction* txn,
     size_t length) noexcept {
   size_t encodedSize = codec_->generateChunkHeader(writeBuf_,
@@ -1704,6 +2431,9 @@ HTTPSession::onEgressMessageFinished(HTTPTransaction* txn, bool withRST) {
   }
   auto oldStreamCount = getPipelineStreamCount();
   decrementTransactionCount(txn, false, true);
+  if (maxPipelineBatch_ > 1) {
+    pipelineBatchCount_++;
+  }
 
   // We should shutdown reads if we are closing with RST or we aren't
   // interested in any further messages (ie if we are a downstream session).
@@ -1862,7 +2592,7 @@ HTTPSession::maybeResumePausedPipelinedTransaction(
   if (!codec_->supportsParallelRequests() && !transactions_.empty() &&
       getPipelineStreamCount() < oldStreamCount &&
       getPipelineStreamCount() == 1) {
-    auto& nextTxn = transactions_.rbegin()->second;
+    auto& nextTxn = getNewestTransaction();
     DCHECK_EQ(nextTxn.getSequenceNumber(), txnSeqn + 1);
     DCHECK(!nextTxn.isIngressComplete());
     DCHECK(nextTxn.isIngressPaused());
@@ -1878,8 +2608,7 @@ HTTPSession::detach(HTTPTransaction* txn) noexcept {
   DestructorGuard guard(this);
   HTTPCodec::StreamID streamID = txn->getID();
   auto txnSeqn = txn->getSequenceNumber();
-  auto it = transactions_.find(txn->getID());
-  DCHECK(it != transactions_.end());
+  DCHECK(transactions_.count(streamID));
 
   if (txn->isIngressPaused()) {
     // Someone detached a transaction that was paused.  Make the resumeIngress
@@ -1906,9 +2635,14 @@ HTTPSession::detach(HTTPTransaction* txn) noexcept {
     }
   }
 
+  if (closedStreams_ && txn->isRemoteInitiated()) {
+    closedStreams_->add(streamID);
+  }
+
   auto oldStreamCount = getPipelineStreamCount();
   decrementTransactionCount(txn, true, true);
-  transactions_.erase(it);
+  // by key, the callbacks above may have added transactions and rehashed
+  transactions_.erase(streamID);
 
   if (transactions_.empty()) {
     HTTPSessionBase::setLatestActive();
@@ -1936,6 +2670,10 @@ HTTPSession::detach(HTTPTransaction* txn) noexcept {
   if (liveTransactions_ == 0 && transactions_.empty() && !isScheduled()) {
     resetTimeout();
   }
+  if (transactions_.empty() && hibernateTimeout_.count() > 0 &&
+      !hibernateTimer_.isScheduled()) {
+    timeout_.scheduleTimeout(&hibernateTimer_, hibernateTimeout_);
+  }
 
   // It's possible that this is the last transaction in the session,
   // so check whether the conditions for shutdown are satisfied.
@@ -1956,11 +2694,21 @@ HTTPSession::detach(HTTPTransaction* txn) noexcept {
 size_t
 HTTPSession::sendWindowUpdate(HTTPTransaction* txn,
                               uint32_t bytes) noexcept {
-  size_t sent = codec_->generateWindowUpdate(writeBuf_, txn->getID(), bytes);
-  if (sent) {
-    scheduleWrite();
+  // Deferred to the loop callback, merged with the other updates of the
+  // stream and written along with the rest of the egress
+  auto id = txn->getID();
+  auto it = std::find_if(
+    pendingWindowUpdates_.begin(), pendingWindowUpdates_.end(),
+    [id] (const std::pair<HTTPCodec::StreamID, uint32_t>& update) {
+      return update.first == id;
+    });
+  if (it != pendingWindowUpdates_.end()) {
+    it->second += bytes;
+  } else {
+    pendingWindowUpdates_.emplace_back(id, bytes);
   }
-  return sent;
+  scheduleWrite();
+  return 0;
 }
 
 void
@@ -1968,12 +2716,38 @@ HTTPSession::notifyIngressBodyProcessed(uint32_t bytes) noexcept {
   if (HTTPSessionBase::notifyBodyProcessed(bytes)) {
     resumeReads();
   }
-  if (connFlowControl_ &&
-      connFlowControl_->ingressBytesProcessed(writeBuf_, bytes)) {
+  if (ingressMemoryBudget_ && connFlowControl_) {
+    fitReceiveWindowToBudget();
+  }
+  connIngressBytesProcessed(bytes);
+}
+
+void HTTPSession::connIngressBytesProcessed(uint32_t bytes) {
+  if (connFlowControl_) {
+    pendingConnBytesProcessed_ += bytes;
     scheduleWrite();
   }
 }
 
+void HTTPSession::flushWindowUpdates() {
+  if (pendingConnBytesProcessed_ > 0) {
+    if (connFlowControl_) {
+      connFlowControl_->ingressBytesProcessed(writeBuf_,
+                                              pendingConnBytesProcessed_);
+    }
+    pendingConnBytesProcessed_ = 0;
+  }
+  auto updates = std::move(pendingWindowUpdates_);
+  pendingWindowUpdates_.clear();
+  for (const auto& update : updates) {
+    // the stream may have been reset or detached since
+    auto txn = findTransaction(update.first);
+    if (txn && !txn->isIngressEOMSeen()) {
+      codec_->generateWindowUpdate(writeBuf_, update.first, update.second);
+    }
+  }
+}
+
 void
 HTTPSession::notifyEgressBodyBuffered(int64_t bytes) noexcept {
   if (HTTPSessionBase::notifyEgressBodyBuffered(bytes, true) &&
@@ -1984,6 +2758,10 @@ HTTPSession::notifyEgressBodyBuffered(int64_t bytes) noexcept {
 
 bool HTTPSession::getCurrentTransportInfoWithoutUpdate(
     TransportInfo* tinfo) const {
+  return transportInfoCache_.get(tinfo, sock_->good(), getCurrentTime());
+}
+
+bool HTTPSession::readTransportInfo(TransportInfo* tinfo) const {
   auto sock = sock_->getUnderlyingTransport<AsyncSocket>();
   if (sock) {
     tinfo->initWithSocket(sock);
@@ -2031,8 +2809,24 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* som, bool* eom) {
 
   // We always tack on at least one body packet to the current write buf
   // This ensures that a short HTTPS response will go out in a single SSL record
-  while (!txnEgressQueue_.empty()) {
+  TimePoint batchStart;
+  if (egressBatchTarget_ > 0) {
+    batchStart = getCurrentTime();
+  }
+  while (!txnEgressQueue_->empty()) {
     uint32_t toSend = kWriteReadyMax;
+    if (trackNotSentLowat() && notSentLowat_ > 0) {
+      // Any more would sit in a write, out of the priority queue's reach
+      toSend = std::min(toSend, notSentLowat_);
+    }
+    if (inScheduledEgress_) {
+      // The rest of this turn goes to the other sessions of the scheduler
+      auto buffered = writeBuf_.chainLength();
+      if (buffered >= egressBudgetLeft_) {
+        break;
+      }
+      toSend = std::min<uint64_t>(toSend, egressBudgetLeft_ - buffered);
+    }
     if (connFlowControl_) {
       if (connFlowControl_->getAvailableSend() == 0) {
         VLOG(4) << "Session-level send window is full, skipping remaining "
@@ -2041,8 +2835,8 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* som, bool* eom) {
       }
       toSend = std::min(toSend, connFlowControl_->getAvailableSend());
     }
-    txnEgressQueue_.nextEgress(nextEgressResults_,
-                               isSpdyCodecProtocol(codec_->getProtocol()));
+    txnEgressQueue_->nextEgress(nextEgressResults_,
+                                isSpdyCodecProtocol(codec_->getProtocol()));
     CHECK(!nextEgressResults_.empty()); // Queue was non empty, so this must be
     // The maximum we will send for any transaction in this loop
     uint32_t txnMaxToSend = toSend * nextEgressResults_.front().second;
@@ -2081,20 +2875,23 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* som, bool* eom) {
     nextEgressResults_.clear();
     // it can be empty because of HTTPTransaction rate limiting.  We should
     // change rate limiting to clearPendingEgress while waiting.
-    if (!writeBuf_.empty()) {
+    if (!writeBuf_.empty() && egressBatchComplete(batchStart)) {
       break;
     }
   }
   *som = false;
   *eom = false;
+  // Only the part of writeBuf_ before the next file body can be written now
+  const size_t writeBufLen = fileBodySegments_.empty() ?
+    writeBuf_.chainLength() : fileBodySegments_.front().writeBufBytes;
   if (byteEventTracker_) {
     uint64_t needed = byteEventTracker_->preSend(cork, som, eom, bytesWritten_);
     if (needed > 0) {
       VLOG(5) << *this << " writeBuf_.chainLength(): "
               << writeBuf_.chainLength() << " txnEgressQueue_.empty(): "
-              << txnEgressQueue_.empty();
+              << txnEgressQueue_->empty();
 
-      if (needed < writeBuf_.chainLength()) {
+      if (needed < writeBufLen) {
         // split the next SOM / EOM chunk
         VLOG(5) << *this << " splitting " << needed << " bytes out of a "
                 << writeBuf_.chainLength() << " bytes IOBuf";
@@ -2106,18 +2903,243 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork, bool* som, bool* eom) {
             sessionStats_->recordTTBTXIOBSplitBySom();
           }
         }
-        return writeBuf_.split(needed);
-      } else {
-        CHECK_EQ(needed, writeBuf_.chainLength());
+        return takeWriteBuf(needed);
+      } else if (needed > writeBufLen) {
+        // The byte is in or after a file body, whose writes are not
+        // timestamped
+        CHECK(!fileBodySegments_.empty());
+        *som = false;
+        *eom = false;
       }
     }
   }
 
   // cork if there are txns with pending egress and room to send them
-  *cork = !txnEgressQueue_.empty() && !isConnWindowFull();
+  *cork = (!txnEgressQueue_->empty() && !isConnWindowFull()) ||
+    !fileBodySegments_.empty();
+  return takeWriteBuf(writeBufLen);
+}
+
+unique_ptr<IOBuf> HTTPSession::takeWriteBuf(size_t length) {
+  // The result of getNextToSend(): the bytes written and those left behind
+  FOLLY_SDT(proxygen, session_next_to_send, length,
+            writeBuf_.chainLength() - length);
+  if (!fileBodySegments_.empty()) {
+    auto& segment = fileBodySegments_.front();
+    CHECK_LE(length, segment.writeBufBytes);
+    segment.writeBufBytes -= length;
+    if (length == 0) {
+      return nullptr;
+    }
+  }
+  if (length < writeBuf_.chainLength()) {
+    return writeBuf_.split(length);
+  }
   return writeBuf_.move();
 }
 
+void HTTPSession::queueFileBody(std::shared_ptr<folly::File> file,
+                                off_t offset,
+                                size_t length) {
+  size_t writeBufBytes = writeBuf_.chainLength();
+  for (const auto& segment : fileBodySegments_) {
+    writeBufBytes -= segment.writeBufBytes;
+  }
+  fileBodyBytes_ += length;
+  if (writeBufBytes == 0 && !fileBodySegments_.empty()) {
+    auto& last = fileBodySegments_.back();
+    if (last.file == file &&
+        last.offset + static_cast<off_t>(last.length) == offset) {
+      // the next part of the same body
+      last.length += length;
+      return;
+    }
+  }
+  fileBodySegments_.push_back(
+    FileBodySegment{std::move(file), offset, length, writeBufBytes});
+}
+
+bool HTTPSession::writeFileBody() {
+  if (fileBodySegments_.empty() || numActiveWrites_ > 0 || writesShutdown()) {
+    return false;
+  }
+#ifdef __linux__
+  // getNextToSend() wrote the bytes of writeBuf_ before it, and only
+  // sessions with a socket that canSendFileBody() queue file bodies
+  auto& segment = fileBodySegments_.front();
+  DCHECK_EQ(segment.writeBufBytes, 0);
+  auto sock = dynamic_cast<AsyncSocket*>(sock_.get());
+  CHECK(sock);
+  off_t offset = segment.offset;
+  ssize_t rc;
+  do {
+    rc = ::sendfile(sock->getNetworkSocket().toFd(),
+                    segment.file->fd(),
+                    &offset,
+                    std::min(segment.length, kMaxFileBodyWrite));
+  } while (rc < 0 && errno == EINTR);
+
+  if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    VLOG(4) << *this << " waiting to write " << segment.length
+            << " bytes of file body";
+    fileBodyWriter_.initHandler(sock->getEventBase(),
+                                sock->getNetworkSocket());
+    fileBodyWriter_.registerHandler(folly::EventHandler::WRITE);
+    numActiveWrites_++;
+    if (!writeTimeout_.isScheduled()) {
+      timeout_.scheduleTimeout(&writeTimeout_);
+    }
+    updateWriteCount();
+    return false;
+  }
+  if (rc <= 0) {
+    // 0 when the file is shorter than the body
+    onWriteError(0, rc < 0 ?
+                 AsyncSocketException(AsyncSocketException::INTERNAL_ERROR,
+                                      "sendfile() failed", errno) :
+                 AsyncSocketException(AsyncSocketException::END_OF_FILE,
+                                      "file body truncated"));
+    return false;
+  }
+
+  size_t written = static_cast<size_t>(rc);
+  VLOG(4) << *this << " wrote " << written << " bytes of file body";
+  segment.offset += written;
+  segment.length -= written;
+  fileBodyBytes_ -= written;
+  if (segment.length == 0) {
+    fileBodySegments_.pop_front();
+  }
+  // the write completed as it was issued
+  numActiveWrites_++;
+  bytesScheduled_ += written;
+  if (!writeTimeout_.isScheduled()) {
+    timeout_.scheduleTimeout(&writeTimeout_);
+  }
+  onWriteSuccess(written);
+  return true;
+#else
+  LOG(FATAL) << "file bodies are only written on linux";
+  __builtin_unreachable();
+#endif
+}
+
+void HTTPSession::onFileBodyWritable() {
+  DestructorGuard dg(this);
+  fileBodyWriter_.unregisterHandler();
+  numActiveWrites_--;
+  if (pendingWrites_.empty()) {
+    writeTimeout_.cancelTimeout();
+  }
+  updateWriteCount();
+  if (hasMoreWrites()) {
+    runLoopCallback();
+  }
+}
+
+bool HTTPSession::spliceTunnel(HTTPTransaction* txn,
+                               folly::AsyncSocket& upstream) noexcept {
+  // Relays the bytes as they are, so only plaintext HTTP/1.x tunnels, once
+  // the codec passes the ingress through as body, and plaintext upstreams
+  auto sock = sock_ ? sock_->getUnderlyingTransport<AsyncSocket>() : nullptr;
+  if (!sock || dynamic_cast<AsyncSSLSocket*>(sock) ||
+      dynamic_cast<AsyncSSLSocket*>(&upstream) || !upstream.good() ||
+      upstream.getRawBytesBuffered() > 0 ||
+      codec_->getProtocol() != CodecProtocol::HTTP_1_1 ||
+      !ingressUpgraded_ || readsShutdown() || transactions_.size() != 1 ||
+      spliceTunnel_) {
+    return false;
+  }
+  auto tunnel = std::make_unique<SpliceTunnel>(
+    getEventBase(), sock->getNetworkSocket(), upstream.getNetworkSocket(),
+    timeout_, &spliceTunnelCallback_);
+  if (!tunnel->init()) {
+    return false;
+  }
+  DestructorGuard dg(this);
+  VLOG(4) << *this << " splicing the tunnel of " << *txn;
+  pauseReadsImpl();
+  upstream.setReadCB(nullptr);
+  upstream.detachNetworkSocket();
+  // Ingress the transaction did not get yet goes to upstream first
+  if (!readBuf_.empty()) {
+    tunnel->addPendingUpstream(readBuf_.move());
+  }
+  spliceTunnel_ = std::move(tunnel);
+  spliceTunnelStream_ = txn->getID();
+  // The tunnel's idle timeout takes over from the transaction's
+  txn->cancelTimeout();
+  maybeStartSpliceTunnel();
+  return true;
+}
+
+void HTTPSession::maybeStartSpliceTunnel() {
+  if (!spliceTunnel_ || spliceTunnel_->isStarted() || hasMoreWrites()) {
+    return;
+  }
+  VLOG(4) << *this << " starting the spliced tunnel";
+  spliceTunnel_->start();
+}
+
+void HTTPSession::onSpliceTunnelClosed(ProxygenError err) {
+  DestructorGuard dg(this);
+  auto tunnel = std::move(spliceTunnel_);
+  auto bytesDownstream = tunnel->getBytesDownstream();
+  bytesWritten_ += bytesDownstream;
+  transportInfo_.totalBytes += bytesDownstream;
+  if (sessionStats_) {
+    sessionStats_->recordSplicedTunnel(tunnel->getBytesUpstream(),
+                                       bytesDownstream);
+  }
+  if (err != kErrorNone) {
+    setCloseReason(err == kErrorTimeout ? ConnectionCloseReason::TIMEOUT :
+                   err == kErrorWrite ? ConnectionCloseReason::IO_WRITE_ERROR :
+                   ConnectionCloseReason::IO_READ_ERROR);
+    shutdownTransportWithReset(err, "Spliced tunnel failed");
+    return;
+  }
+  auto txn = findTransaction(spliceTunnelStream_);
+  if (txn && !txn->isEgressEOMQueued()) {
+    // The tunnel already shut down the write side
+    txn->sendEOM();
+  }
+  // The client's EOF, which the tunnel read, ends the ingress
+  resumeReadsImpl();
+}
+
+void
+HTTPSession::appendPipelinedEgress(unique_ptr<IOBuf>& writeBuf,
+                                   bool* cork, bool* som, bool* eom) {
+  // Finishing a response in getNextToSend() resumes the next pipelined
+  // transaction, which may generate its response right away.  Pull that
+  // egress into the same write, up to maxPipelineBatch_ responses.
+  // preSend places its split relative to bytesWritten_, which does not
+  // count the egress already taken into this write
+  if (sock_->isEorTrackingEnabled()) {
+    return;
+  }
+  while (!pipelineBatchFull() && !*som && !*eom) {
+    auto finished = pipelineBatchCount_;
+    if (readsUnpaused() && !readBuf_.empty()) {
+      processReadData();
+    }
+    if (!writeBuf_.front() && txnEgressQueue_->empty()) {
+      break;
+    }
+    bool moreCork = true;
+    auto more = getNextToSend(&moreCork, som, eom);
+    if (!more) {
+      break;
+    }
+    writeBuf->prependChain(std::move(more));
+    *cork = moreCork;
+    if (pipelineBatchCount_ == finished) {
+      // no further response completed, the rest waits for the next write
+      break;
+    }
+  }
+}
+
 void
 HTTPSession::runLoopCallback() noexcept {
   // We schedule this callback to run at the end of an event
@@ -2130,16 +3152,30 @@ HTTPSession::runLoopCallback() noexcept {
       inLoopCallback_ = false;
       // This ScopeGuard needs to be under the above DestructorGuard
       updatePendingWrites();
+      maybeStartSpliceTunnel();
       checkForShutdown();
     });
   VLOG(5) << *this << " in loop callback";
 
-  for (uint32_t i = 0; i < kMaxWritesPerLoop; ++i) {
+  pipelineBatchCount_ = 0;
+  if (maxPipelineBatch_ > 1 && readsUnpaused() && !readBuf_.empty()) {
+    // Serve pipelined HTTP/1.x requests that are already buffered before
+    // writing, so that responses completed in this loop share one write.
+    processReadData();
+  }
+  flushWindowUpdates();
+
+  // With a scheduler, egress is only written in the turns it gives
+  bool writeNow = !egressScheduler_ || inScheduledEgress_;
+  for (uint32_t i = 0; i < kMaxWritesPerLoop && writeNow &&
+         !egressHeldForReplaySafety_ &&
+         (!inScheduledEgress_ || egressBudgetLeft_ > 0);
+       ++i) {
     bodyBytesPerWriteBuf_ = 0;
     if (isPrioritySampled()) {
       invokeOnAllTransactions(
         &HTTPTransaction::updateContentionsCount,
-        txnEgressQueue_.numPendingEgress());
+        txnEgressQueue_->numPendingEgress());
     }
 
     bool cork = true;
@@ -2148,8 +3184,14 @@ HTTPSession::runLoopCallback() noexcept {
     unique_ptr<IOBuf> writeBuf = getNextToSend(&cork, &som, &eom);
 
     if (!writeBuf) {
+      if (writeFileBody()) {
+        continue;
+      }
       break;
     }
+    if (maxPipelineBatch_ > 1) {
+      appendPipelinedEgress(writeBuf, &cork, &som, &eom);
+    }
     uint64_t len = writeBuf->computeChainDataLength();
     VLOG(11) << *this
              << " bytes of egress to be written: " << len
@@ -2169,6 +3211,10 @@ HTTPSession::runLoopCallback() noexcept {
     segment->setCork(cork);
     segment->setEOR(eom);
     segment->setTimestampTX(som || eom); // timestamp for buffers w/ som or eom
+    // the kernel reads zero copy buffers after the write returns
+    segment->setZeroCopy(egressZeroCopyThreshold_ > 0 &&
+                         len >= egressZeroCopyThreshold_ &&
+                         writeBuf->isManaged());
 
     pendingWrites_.push_back(*segment);
     if (!writeTimeout_.isScheduled()) {
@@ -2179,6 +3225,10 @@ HTTPSession::runLoopCallback() noexcept {
     VLOG(4) << *this << " writing " << len << ", activeWrites="
              << numActiveWrites_ << " cork=" << cork << " eom=" << eom;
     bytesScheduled_ += len;
+    if (inScheduledEgress_) {
+      egressBudgetLeft_ -= std::min(len, egressBudgetLeft_);
+    }
+    pipelineBatchCount_ = 0;
     sock_->writeChain(segment, std::move(writeBuf), segment->getFlags());
     if (numActiveWrites_ > 0) {
       updateWriteCount();
@@ -2188,7 +3238,8 @@ HTTPSession::runLoopCallback() noexcept {
     }
     // writeChain can result in a writeError and trigger the shutdown code path
   }
-  if (numActiveWrites_ == 0 && !writesShutdown() && hasMoreWrites() &&
+  if (numActiveWrites_ == 0 && !writesShutdown() &&
+      !egressHeldForReplaySafety_ && hasMoreWrites() &&
       (!connFlowControl_ || connFlowControl_->getAvailableSend())) {
     scheduleWrite();
   }
@@ -2210,8 +3261,15 @@ HTTPSession::scheduleWrite() {
   // the end of the current event loop iteration.  Writing in a
   // batch helps us packetize the network traffic more efficiently,
   // as well as saving a few system calls.
-  if (!isLoopCallbackScheduled() &&
-      (writeBuf_.front() || !txnEgressQueue_.empty())) {
+  if (!writeBuf_.front() && fileBodySegments_.empty() &&
+      txnEgressQueue_->empty() && pendingWindowUpdates_.empty() &&
+      pendingConnBytesProcessed_ == 0) {
+    return;
+  }
+  if (egressScheduler_) {
+    VLOG(5) << *this << " scheduling egress turn";
+    egressScheduler_->schedule(*this);
+  } else if (!isLoopCallbackScheduled()) {
     VLOG(5) << *this << " scheduling write callback";
     sock_->getEventBase()->runInLoop(this);
   }
@@ -2355,6 +3413,12 @@ void HTTPSession::shutdownTransportWithReset(
       pendingWrites_.front().detach();
       numActiveWrites_--;
     }
+    fileBodySegments_.clear();
+    fileBodyBytes_ = 0;
+    if (fileBodyWriter_.isHandlerRegistered()) {
+      fileBodyWriter_.unregisterHandler();
+      numActiveWrites_--;
+    }
     VLOG(4) << *this << " cancel write timer";
     writeTimeout_.cancelTimeout();
     resetSocketOnShutdown_ = true;
@@ -2374,6 +3438,7 @@ void HTTPSession::shutdownTransportWithReset(
   if (isLoopCallbackScheduled()) {
     cancelLoopCallback();
   }
+  cancelScheduledEgress();
   // onError() callbacks or drainByteEvents() could result in txns detaching
   // due to CallbackGuards going out of scope. Close the socket only after
   // the txns are detached.
@@ -2382,6 +3447,8 @@ void HTTPSession::shutdownTransportWithReset(
 
 void HTTPSession::shutdownRead() {
   VLOG(10) << *this << " shutting down reads";
+  // Stops polling the socket before it closes
+  spliceTunnel_.reset();
   sock_->setReadCB(nullptr);
   reads_ = SocketState::SHUTDOWN;
   // disable socket timestamp events as we're shutting down reads
@@ -2404,13 +3471,14 @@ HTTPSession::checkForShutdown() {
   //   * All writes have been finished.
   //   * There are no transactions remaining on the session.
   if (writesShutdown() && transactions_.empty() &&
-      !isLoopCallbackScheduled()) {
+      !isLoopCallbackScheduled() && !isEgressScheduled()) {
     VLOG(4) << "destroying " << *this;
     shutdownRead();
     auto asyncSocket = sock_->getUnderlyingTransport<folly::AsyncSocket>();
     if (asyncSocket) {
       asyncSocket->setBufferCallback(nullptr);
     }
+    transportInfoCache_.onClose(getCurrentTime());
     if (resetSocketOnShutdown_) {
       sock_->closeWithReset();
     } else {
@@ -2467,6 +3535,7 @@ bool HTTPSession::shouldShutdown() const {
 size_t HTTPSession::sendPing() {
   const size_t bytes = codec_->generatePingRequest(writeBuf_);
   if (bytes) {
+    rttEstimator_.onPingSent(getCurrentTime());
     scheduleWrite();
   }
   return bytes;
@@ -2485,7 +3554,7 @@ HTTPCodec::StreamID HTTPSession::sendPriority(http2::PriorityUpdate pri) {
 size_t HTTPSession::sendPriority(HTTPCodec::StreamID id,
                                  http2::PriorityUpdate pri) {
   auto res = sendPriorityImpl(id, pri);
-  txnEgressQueue_.addOrUpdatePriorityNode(id, pri);
+  txnEgressQueue_->addOrUpdatePriorityNode(id, pri);
   return res;
 }
 
@@ -2513,6 +3582,29 @@ HTTPSession::findTransaction(HTTPCodec::StreamID streamID) {
   }
 }
 
+std::vector<HTTPCodec::StreamID>
+HTTPSession::getSortedTransactionIds() const {
+  std::vector<HTTPCodec::StreamID> ids;
+  ids.reserve(transactions_.size());
+  for (const auto& txn: transactions_) {
+    ids.push_back(txn.first);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+HTTPTransaction&
+HTTPSession::getNewestTransaction() {
+  DCHECK(!transactions_.empty());
+  auto newest = transactions_.begin();
+  for (auto it = transactions_.begin(); it != transactions_.end(); ++it) {
+    if (it->first > newest->first) {
+      newest = it;
+    }
+  }
+  return newest->second;
+}
+
 HTTPTransaction*
 HTTPSession::createTransaction(
     HTTPCodec::StreamID streamID,
@@ -2533,6 +3625,8 @@ HTTPSession::createTransaction(
       getConnectionManager()->onActivated(*this);
     }
     HTTPSessionBase::onCreateTransaction();
+    hibernateTimer_.cancelTimeout();
+    scheduleRttProbe();
   }
 
   auto matchPair = transactions_.emplace(
@@ -2540,7 +3634,7 @@ HTTPSession::createTransaction(
     std::forward_as_tuple(streamID),
     std::forward_as_tuple(
       codec_->getTransportDirection(), streamID, getNumTxnServed(), *this,
-      txnEgressQueue_, timeout_.getWheelTimer(), timeout_.getDefaultTimeout(),
+      *txnEgressQueue_, timeout_.getWheelTimer(), timeout_.getDefaultTimeout(),
       sessionStats_,
       codec_->supportsStreamFlowControl(),
       initialReceiveWindow_,
@@ -2558,6 +3652,16 @@ HTTPSession::createTransaction(
   if (isPrioritySampled()) {
     txn->setPrioritySampled(true /* sampled */);
   }
+  if (isPhaseTimingsEnabled()) {
+    txn->setPhaseTimingsEnabled(true, getPhaseTimingsObserver());
+  }
+  if (sampleCpuTime()) {
+    txn->setCpuTimeAccounting(true);
+  }
+  if (maxCoalescedChunk_ > 0) {
+    txn->setEgressChunkCoalescing(maxCoalescedChunk_);
+  }
+  transportInfoCache_.onRequest();
 
   if (getNumTxnServed() > 0) {
     auto stats = txn->getSessionStats();
@@ -2637,6 +3741,7 @@ HTTPSession::onWriteSuccess(uint64_t bytesWritten) {
     if (numActiveWrites_ == 0 && hasMoreWrites()) {
       runLoopCallback();
     }
+    maybeStartSpliceTunnel();
   }
   onWriteCompleted();
 
@@ -2749,6 +3854,10 @@ HTTPSession::resumeReads() {
 }
 
 void HTTPSession::resumeReadsImpl() {
+  if (spliceTunnel_) {
+    // The tunnel reads the socket until it closes
+    return;
+  }
   VLOG(4) << *this << ": resuming reads";
   resetTimeout();
   reads_ = SocketState::UNPAUSED;
@@ -2764,21 +3873,18 @@ HTTPSession::hasMoreWrites() const {
     << " numActiveWrites_: " << numActiveWrites_
     << " pendingWrites_.empty(): " << pendingWrites_.empty()
     << " pendingWrites_.size(): " << pendingWrites_.size()
-    << " txnEgressQueue_.empty(): " << txnEgressQueue_.empty();
+    << " fileBodySegments_.size(): " << fileBodySegments_.size()
+    << " txnEgressQueue_.empty(): " << txnEgressQueue_->empty();
 
   return (numActiveWrites_ != 0) ||
     !pendingWrites_.empty() || writeBuf_.front() ||
-    !txnEgressQueue_.empty();
+    !fileBodySegments_.empty() || !txnEgressQueue_->empty();
 }
 
 void HTTPSession::errorOnAllTransactions(
     ProxygenError err,
     const std::string& errorMsg) {
-  std::vector<HTTPCodec::StreamID> ids;
-  for (const auto& txn: transactions_) {
-    ids.push_back(txn.first);
-  }
-  errorOnTransactionIds(ids, err, errorMsg);
+  errorOnTransactionIds(getSortedTransactionIds(), err, errorMsg);
 }
 
 void HTTPSession::errorOnTransactionIds(
@@ -2810,13 +3916,16 @@ void HTTPSession::errorOnTransactionId(
 }
 
 void HTTPSession::onConnectionSendWindowOpen() {
+  FOLLY_SDT(proxygen, session_send_window_open, getConnectionSendWindow());
   flowControlTimeout_.cancelTimeout();
   // We can write more now. Schedule a write.
   scheduleWrite();
 }
 
 void HTTPSession::onConnectionSendWindowClosed() {
-  if(!txnEgressQueue_.empty()) {
+  FOLLY_SDT(proxygen, session_send_window_closed,
+            txnEgressQueue_->numPendingEgress());
+  if(!txnEgressQueue_->empty()) {
     VLOG(4) << *this << " session stalled by flow control";
     if (sessionStats_) {
       sessionStats_->recordSessionStalled();
@@ -2850,6 +3959,11 @@ void HTTPSession::invalidStream(HTTPCodec::StreamID stream, ErrorCode code) {
     LOG(ERROR) << "Invalid stream on non-parallel codec.";
     return;
   }
+  if (closedStreams_ && closedStreams_->contains(stream)) {
+    // Frames the peer sent before it saw the stream close
+    VLOG(4) << *this << " ignoring frame for closed stream=" << stream;
+    return;
+  }
 
   HTTPException err(HTTPException::Direction::INGRESS_AND_EGRESS,
                     folly::to<std::string>("invalid stream=", stream));
@@ -2859,6 +3973,58 @@ void HTTPSession::invalidStream(HTTPCodec::StreamID stream, ErrorCode code) {
   onError(stream, err, true);
 }
 
+HTTPSession::PendingStream*
+HTTPSession::findPendingStream(HTTPCodec::StreamID streamID) {
+  for (auto& stream : pendingStreams_) {
+    if (stream.id == streamID) {
+      return &stream;
+    }
+  }
+  return nullptr;
+}
+
+void HTTPSession::createPendingTransactions() {
+  if (pendingStreams_.empty()) {
+    return;
+  }
+  DestructorGuard dg(this);
+  std::vector<PendingStream> streams;
+  streams.swap(pendingStreams_);
+  // Replay the callbacks they were held from, in the order they came in
+  for (auto& stream : streams) {
+    startIngressTransaction(stream.id, stream.priority);
+    if (stream.msg && findTransaction(stream.id)) {
+      onHeadersComplete(stream.id, std::move(stream.msg));
+    }
+    if (stream.eom && findTransaction(stream.id)) {
+      onMessageComplete(stream.id, false);
+    }
+  }
+}
+
+bool HTTPSession::onStreamReset(HTTPCodec::StreamID streamID) {
+  if (maxStreamResets_ == 0 || streamID == 0 || ingressError_) {
+    return true;
+  }
+  auto now = getCoarseTime(getEventBase());
+  if (now - streamResetIntervalStart_ >= streamResetInterval_) {
+    streamResetIntervalStart_ = now;
+    streamResets_ = 0;
+  }
+  if (++streamResets_ <= maxStreamResets_) {
+    return true;
+  }
+  VLOG(2) << *this << " got " << streamResets_ << " stream resets in "
+          << streamResetInterval_.count() << "ms, closing";
+  HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS,
+                   "Too many stream resets");
+  ex.setCodecStatusCode(ErrorCode::ENHANCE_YOUR_CALM);
+  ingressError_ = true;
+  pendingStreams_.clear();
+  onSessionParseError(ex);
+  return false;
+}
+
 void HTTPSession::onPingReplyLatency(int64_t latency) noexcept {
   if (infoCallback_ && latency >= 0) {
     infoCallback_->onPingReplySent(latency);
@@ -2872,12 +4038,21 @@ void HTTPSession::onDeleteTxnByteEvent() noexcept {
 }
 
 void HTTPSession::onEgressBuffered() {
+  if (trackNotSentLowat()) {
+    // The kernel holds back writes past the low water mark, resize it to
+    // the window the connection has now
+    updateNotSentLowat();
+  } else {
+    egressBatchTarget_ = uint64_t(egressBatchPolicy_.targetBytesPerWrite) *
+      std::max(egressBatchPolicy_.bufferedTargetMultiplier, 1u);
+  }
   if (infoCallback_) {
     infoCallback_->onEgressBuffered(*this);
   }
 }
 
 void HTTPSession::onEgressBufferCleared() {
+  egressBatchTarget_ = egressBatchPolicy_.targetBytesPerWrite;
   if (infoCallback_) {
     infoCallback_->onEgressBufferCleared(*this);
   }
@@ -2895,6 +4070,11 @@ void HTTPSession::onReplaySafe() noexcept {
     callback->onReplaySafe();
   }
   waitingForReplaySafety_.clear();
+
+  if (egressHeldForReplaySafety_) {
+    egressHeldForReplaySafety_ = false;
+    scheduleWrite();
+  }
 }
 
 void HTTPSession::onFirstByteEvent(HTTPTransaction* txn,
@@ -2935,9 +4115,92 @@ bool HTTPSession::isDetachable(bool checkSocket) const {
     return false;
   }
   return transactions_.size() == 0 && getNumIncomingStreams() == 0 &&
+    fileBodySegments_.empty() &&
     !writesPaused() && !flowControlTimeout_.isScheduled() &&
     !writeTimeout_.isScheduled() && !drainTimeout_.isScheduled();
 }
 
+void
+HTTPSession::attachThreadLocals(
+  folly::EventBase* eventBase,
+  folly::SSLContextPtr sslContext,
+  const WheelTimerInstance& timeout,
+  HTTPSessionStats* stats, FilterIteratorFn fn,
+  HeaderCodec::Stats* headerCodecStats,
+  HTTPSessionController* controller) {
+  txnEgressQueue_->attachThreadLocals(timeout);
+  timeout_ = timeout;
+  setController(controller);
+  setSessionStats(stats);
+  if (sock_) {
+    sock_->attachEventBase(eventBase);
+    maybeAttachSSLContext(sslContext);
+  }
+  codec_.foreach(fn);
+  codec_->setHeaderCodecStats(headerCodecStats);
+  resumeReadsImpl();
+  rescheduleLoopCallbacks();
+}
+
+void HTTPSession::maybeAttachSSLContext(
+    folly::SSLContextPtr sslContext) const {
+#ifndef NO_ASYNCSSLSOCKET
+  auto sslSocket = sock_->getUnderlyingTransport<folly::AsyncSSLSocket>();
+  if (sslSocket && sslContext) {
+    sslSocket->attachSSLContext(sslContext);
+  }
+#endif
+}
+
+void
+HTTPSession::detachThreadLocals(bool detachSSLContext) {
+  CHECK(transactions_.empty());
+  cancelLoopCallbacks();
+  egressScheduler_.reset();
+  cancelHibernateTimeout();
+  rttProbeTimer_.cancelTimeout();
+  pauseReadsImpl();
+  if (sock_) {
+    if (detachSSLContext) {
+      maybeDetachSSLContext();
+    }
+    sock_->detachEventBase();
+  }
+  txnEgressQueue_->detachThreadLocals();
+  setController(nullptr);
+  setSessionStats(nullptr);
+  // The codec filters *shouldn't* be accessible while the socket is detached,
+  // I hope
+  codec_->setHeaderCodecStats(nullptr);
+  auto cm = getConnectionManager();
+  if (cm) {
+    cm->removeConnection(this);
+  }
+}
+
+folly::NetworkSocket HTTPSession::releaseSocket() {
+  auto sock = sock_ ? sock_->getUnderlyingTransport<folly::AsyncSocket>()
+                    : nullptr;
+  if (!sock || dynamic_cast<folly::AsyncSSLSocket*>(sock) ||
+      !isDetachable(true)) {
+    return folly::NetworkSocket();
+  }
+  DestructorGuard dg(this);
+  // Otherwise detaching the socket reads an EOF
+  pauseReadsImpl();
+  auto fd = sock->detachNetworkSocket();
+  VLOG(4) << *this << " released its socket";
+  dropConnection();
+  return fd;
+}
+
+void HTTPSession::maybeDetachSSLContext() const {
+#ifndef NO_ASYNCSSLSOCKET
+  auto sslSocket = sock_->getUnderlyingTransport<folly::AsyncSSLSocket>();
+  if (sslSocket) {
+    sslSocket->detachSSLContext();
+  }
+#endif
+}
 
 } // proxygen
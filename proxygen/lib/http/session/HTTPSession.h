@@ -12,25 +12,38 @@
 #include <fizz/protocol/Certificate.h>
 #include <fizz/record/Types.h>
 #include <folly/IntrusiveList.h>
+#include <folly/container/F14Map.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <folly/Optional.h>
 #include <proxygen/lib/http/HTTPConstants.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
+#include <proxygen/lib/http/codec/FrameTraceFilter.h>
+#include <proxygen/lib/http/codec/TrafficCaptureFilter.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/http/session/BDPEstimator.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/ClosedStreamSet.h>
+#include <proxygen/lib/http/session/EgressScheduler.h>
 #include <proxygen/lib/http/session/HTTPEvent.h>
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/http/session/RttEstimator.h>
 #include <proxygen/lib/http/session/SecondaryAuthManagerBase.h>
+#include <proxygen/lib/http/session/SpliceTunnel.h>
+#include <proxygen/lib/http/session/TransportInfoCache.h>
+#include <deque>
 #include <queue>
 #include <set>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <vector>
+#include <proxygen/lib/utils/BufferAllocator.h>
+#include <proxygen/lib/utils/RecyclingAllocator.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 
 namespace proxygen {
@@ -51,11 +64,21 @@ class HTTPSession:
   private FlowControlFilter::Callback,
   private HTTPCodec::Callback,
   private folly::EventBase::LoopCallback,
+  private EgressScheduler::Callback,
   private folly::AsyncTransportWrapper::ReadCallback,
   private folly::AsyncTransport::ReplaySafetyCallback {
  public:
   using UniquePtr = std::unique_ptr<HTTPSession, Destructor>;
 
+  /**
+   * When enabled, the storage of transactions that finished on a thread is
+   * reused by the next transactions created on it, by any session.  Off by
+   * default.
+   */
+  static void setRecycleTransactions(bool enabled) {
+    TransactionAllocator::FreeList::enable(enabled);
+  }
+
   HTTPSessionBase::SessionType getType() const noexcept override {
     return HTTPSessionBase::SessionType::HTTP;
   }
@@ -83,6 +106,25 @@ class HTTPSession:
     return outgoingStreams_;
   }
 
+  uint32_t getConnectionSendWindow() const override {
+    return connFlowControl_ ? connFlowControl_->getAvailableSend() :
+      HTTPSessionBase::getConnectionSendWindow();
+  }
+
+  std::chrono::microseconds getRtt() const override {
+    if (rttEstimator_.getNumSamples() > 0) {
+      return rttEstimator_.getSrtt();
+    }
+    return HTTPSessionBase::getRtt();
+  }
+
+  std::chrono::microseconds getRttVar() const override {
+    if (rttEstimator_.getNumSamples() > 0) {
+      return rttEstimator_.getRttVar();
+    }
+    return HTTPSessionBase::getRttVar();
+  }
+
   uint32_t getNumIncomingStreams() const override {
     return incomingStreams_;
   }
@@ -91,6 +133,27 @@ class HTTPSession:
 
   void setByteEventTracker(std::shared_ptr<ByteEventTracker> byteEventTracker);
 
+  /**
+   * Reports when the first and last body bytes of responses are transmitted
+   * and when the last one is acknowledged, from kernel socket timestamps,
+   * see SocketTimestampByteEventTracker.  Timestamps not received within
+   * timeout are given up on.  Call before the session starts writing.
+   *
+   * Returns false if the transport is not a socket supporting timestamps.
+   */
+  bool enableSocketTimestamps(std::chrono::milliseconds timeout);
+
+  /**
+   * Writes of at least threshold bytes are sent with MSG_ZEROCOPY.  The
+   * socket holds on to their buffers until the kernel reports it is done
+   * with them, so writes of memory the session does not own are copied as
+   * usual.  0 turns it off.
+   *
+   * Returns false if the transport is not a plaintext socket supporting
+   * SO_ZEROCOPY.
+   */
+  bool setEgressZeroCopyThreshold(size_t threshold);
+
   void setSessionStats(HTTPSessionStats* stats) override;
   /**
    * Set flow control properties on the session.
@@ -108,6 +171,44 @@ class HTTPSession:
    size_t receiveStreamWindowSize,
    size_t receiveSessionWindowSize) override;
 
+  /**
+   * Tunes the receive windows to the bandwidth-delay product measured with
+   * PINGs while data is received, see BDPEstimator.  The session window
+   * grows up to maxReceiveSessionWindowSize, and the stream windows follow
+   * it up to maxReceiveStreamWindowSize; neither gets smaller than set by
+   * setFlowControl, which must be called first.  Only codecs with session
+   * flow control are tuned.
+   */
+  void enableReceiveWindowAutotuning(size_t maxReceiveSessionWindowSize,
+                                     size_t maxReceiveStreamWindowSize);
+
+  /**
+   * Measures the round trip time every interval while the session has
+   * transactions, for getRtt() and getRttVar().  Codecs with PINGs send
+   * one, unless one is outstanding; the replies to all the PINGs sent,
+   * e.g. by sendPing(), are samples, see RttEstimator.  For HTTP/1.x the
+   * kernel's estimate is read from TCP_INFO instead, where available.
+   */
+  void enableRttProbes(std::chrono::milliseconds interval);
+
+  /**
+   * Keeps the last maxFrames frames parsed and generated by the codec, see
+   * FrameTraceFilter, to inspect with getFrameTrace() when the connection
+   * misbehaves.
+   */
+  void enableFrameTrace(size_t maxFrames);
+
+  // nullptr unless enableFrameTrace() was called
+  const FrameTraceFilter* getFrameTrace() const {
+    return frameTrace_;
+  }
+
+  /**
+   * Captures the shape of the session's traffic for replay, see
+   * TrafficCaptureFilter, into writer once the session ends.
+   */
+  void enableTrafficCapture(std::shared_ptr<TrafficCaptureWriter> writer);
+
   /**
    * Set outgoing settings for this session
    */
@@ -136,6 +237,18 @@ class HTTPSession:
 
   bool getCurrentTransportInfo(wangle::TransportInfo* tinfo) override;
 
+  /**
+   * getCurrentTransportInfo() reads TCP_INFO and more from the socket, a few
+   * syscalls, each time.  Under a cache policy, the session serves what it
+   * read until the policy expires it, see TransportInfoCache.  The default
+   * of both limits 0 reads every time.
+   */
+  using TransportInfoCachePolicy = TransportInfoCache::Policy;
+
+  void setTransportInfoCachePolicy(const TransportInfoCachePolicy& policy) {
+    transportInfoCache_.setPolicy(policy);
+  }
+
   /**
    * Set the maximum number of transactions the remote can open at once.
    */
@@ -147,6 +260,120 @@ class HTTPSession:
    */
   void setEgressBytesLimit(uint64_t bytesLimit);
 
+  /**
+   * For protocols without parallel requests (HTTP/1.x), the maximum number
+   * of pipelined responses that may be coalesced into a single write.  When
+   * greater than 1, requests that are already buffered are parsed and served
+   * before the session writes, rather than one per event loop iteration.
+   * The default of 1 keeps strictly one-at-a-time processing.
+   */
+  void setMaxPipelineBatch(uint32_t maxBatch);
+
+  /**
+   * For HTTP/1.x, merges the explicit chunks of new transactions into
+   * chunks of up to maxLength bytes, see
+   * HTTPTransaction::setEgressChunkCoalescing().  0 disables it.
+   */
+  void setEgressChunkCoalescing(uint32_t maxLength);
+
+  /**
+   * For downstream sessions with parallel requests, guards against streams
+   * being opened and reset at a high rate.  A stream reset in the same read
+   * as its headers never gets a transaction, frames for recently closed
+   * streams are dropped without a reply, and more than maxResets streams
+   * reset by the peer within interval end the session with a GOAWAY
+   * (ENHANCE_YOUR_CALM).  A maxResets of 0 disables the limit.
+   */
+  void setStreamResetLimit(uint32_t maxResets,
+                           std::chrono::milliseconds interval);
+
+  /**
+   * For downstream plaintext HTTP/1.x sessions, accepts HTTP/2 with prior
+   * knowledge: if the first bytes read are the connection preface, the
+   * codec becomes HTTP/2 before any of them is parsed, without an Upgrade
+   * round trip.  The egress settings and stream limits set meanwhile, which
+   * HTTP/1.x has no use for, are kept for it.  Call before startNow().
+   */
+  void enableH2cPriorKnowledge();
+
+  /**
+   * For upstream sessions over a transport that sends early data (e.g. TLS
+   * 1.3 0-RTT), stops writing at the first request whose method is not safe
+   * (see isSafeMethod()) until the transport is replay safe, so that only
+   * requests that may be replayed are sent as early data.
+   */
+  void setHoldUnsafeRequestsUntilReplaySafe(bool hold) {
+    holdUnsafeRequests_ = hold;
+  }
+
+  HTTPSessionMemoryUsage getMemoryUsage() const override;
+
+  void getStateSnapshot(HTTPSessionStateSnapshot& snapshot,
+                        size_t maxStreams) const override;
+
+  /**
+   * Share read buffers between the sessions of a thread.  A session takes a
+   * buffer from its thread's pool when it reads data and hands it back once
+   * the codec has parsed all of it, so idle keep-alive connections do not
+   * hold read buffers.  Up to maxBuffers are pooled per thread, 0 (the
+   * default) disables pooling.  Only applies to reads through
+   * getReadBuffer(); transports that hand over their own buffers, like
+   * TLS, keep using those.
+   */
+  static void setReadBufferPoolSize(uint32_t maxBuffers) {
+    readBufferPoolSize_ = maxBuffers;
+  }
+
+  /**
+   * Where the sessions allocate their read buffers, e.g. an
+   * ArenaBufferAllocator for arenas per thread backed by huge pages;
+   * nullptr (the default) for malloc.  Set before any session reads, and
+   * the pooled buffers come from it too.
+   */
+  static void setBufferAllocator(std::shared_ptr<BufferAllocator> allocator) {
+    bufferAllocator_ = std::move(allocator);
+  }
+
+  /**
+   * How much egress is gathered into one socket write.  By default a write
+   * is cut as soon as one pass over the egress queue produced any bytes.
+   * With targetBytesPerWrite set, passes continue until that many bytes are
+   * buffered, the queue or the connection window runs dry, or maxLatency
+   * has been spent building the write (0 for no limit).
+   *
+   * While the socket is backed up (see onEgressBuffered) the target is
+   * multiplied by bufferedTargetMultiplier, the bytes would wait in the
+   * socket anyway; it drops back once the buffer clears.
+   *
+   * A non-zero notSentLowat is set as TCP_NOTSENT_LOWAT on the socket, so
+   * the kernel holds little unsent data and the session rather than the
+   * socket buffer decides what goes out next.
+   *
+   * With maxNotSentLowat above notSentLowat, the low water mark tracks
+   * about one bandwidth delay product: whenever the socket backs up, it is
+   * reset to the congestion window from TCP_INFO, clamped between the two.
+   * Writes are then capped at the mark and not grown while buffered, so the
+   * egress taken out of the priority queue ahead of the kernel stays near
+   * one BDP.
+   */
+  struct EgressBatchPolicy {
+    uint32_t targetBytesPerWrite{0};
+    std::chrono::microseconds maxLatency{200};
+    uint32_t bufferedTargetMultiplier{4};
+    uint32_t notSentLowat{0};
+    uint32_t maxNotSentLowat{0};
+  };
+
+  void setEgressBatchPolicy(const EgressBatchPolicy& policy);
+
+  /**
+   * Writes from the turns the scheduler gives, shared with the other
+   * sessions of this thread, rather than from this session's own loop
+   * callback.  The scheduler must be on the session's EventBase; it is
+   * dropped when the session detaches from it.  Null to write on its own.
+   */
+  void setEgressScheduler(std::shared_ptr<EgressScheduler> scheduler);
+
   /**
    * Start reading from the transport and send any introductory messages
    * to the remote side. This function must be called once per session to
@@ -236,6 +463,29 @@ class HTTPSession:
 
   bool isDetachable(bool checkSocket=true) const override;
 
+  /**
+   * Moves the session to eventBase, with the thread local state of that
+   * thread, e.g. to rebalance sessions across threads.  The session must be
+   * detachable and detached first.
+   */
+  void attachThreadLocals(folly::EventBase* eventBase,
+                          folly::SSLContextPtr sslContext,
+                          const WheelTimerInstance& timeout,
+                          HTTPSessionStats* stats,
+                          FilterIteratorFn fn,
+                          HeaderCodec::Stats* headerCodecStats,
+                          HTTPSessionController* controller) override;
+
+  void detachThreadLocals(bool detachSSLContext=false) override;
+
+  /**
+   * Detaches the socket of an idle plaintext session and drops the session
+   * without closing it, e.g. to hand the connection over to another process.
+   * Returns an invalid socket, and keeps the session, if it is not
+   * detachable or not on a plain AsyncSocket.
+   */
+  folly::NetworkSocket releaseSocket();
+
   /**
    * Returns true if this session is draining. This can happen if drain()
    * is called explicitly, if a GOAWAY frame is received, or during shutdown.
@@ -344,6 +594,13 @@ class HTTPSession:
                                    std::unique_ptr<HTTPCodec> codec,
                                    const std::string& protocolString);
 
+  /**
+   * Replaces the HTTP/1.x codec with codec, which supports parallel
+   * requests, and sends its settings with egressSettings.
+   */
+  void switchToParallelCodec(std::unique_ptr<HTTPCodec> codec,
+                             const SettingsList& egressSettings);
+
   virtual folly::Optional<const HTTPMessage::HTTPPriority> getHTTPPriority(
     uint8_t) override {
     return folly::none;
@@ -353,6 +610,12 @@ class HTTPSession:
   void writeTimeoutExpired() noexcept;
   void flowControlTimeoutExpired() noexcept;
 
+  /**
+   * Release reclaimable memory once idle, see
+   * HTTPSessionBase::setHibernateTimeout
+   */
+  void hibernate() noexcept;
+
   // AsyncTransportWrapper::ReadCallback methods
   void getReadBuffer(void** buf, size_t* bufSize) override;
   void readDataAvailable(size_t readSize) noexcept override;
@@ -397,6 +660,7 @@ class HTTPSession:
   void onWindowUpdate(HTTPCodec::StreamID stream, uint32_t amount) override;
   void onSettings(const SettingsList& settings) override;
   void onSettingsAck()  override;
+  void onHeaderEncodeCache(bool hit) override;
   void onPriority(HTTPCodec::StreamID stream,
                   const HTTPMessage::HTTPPriority&) override;
   void onCertificateRequest(uint16_t requestId,
@@ -407,7 +671,7 @@ class HTTPSession:
     return outgoingStreams_;
   }
   uint32_t numIncomingStreams() const override {
-    return incomingStreams_;
+    return incomingStreams_ + uint32_t(pendingStreams_.size());
   }
 
   // HTTPTransaction::Transport methods
@@ -420,6 +684,15 @@ class HTTPSession:
                    bool includeEOM) noexcept override;
   size_t sendBody(HTTPTransaction* txn, std::unique_ptr<folly::IOBuf>,
                   bool includeEOM, bool trackLastByteFlushed) noexcept override;
+  bool canSendFileBody(const HTTPTransaction* txn) const noexcept override;
+  size_t sendFileBody(HTTPTransaction* txn,
+                      std::shared_ptr<folly::File> file,
+                      off_t offset,
+                      size_t length,
+                      bool includeEOM,
+                      bool trackLastByteFlushed) noexcept override;
+  bool spliceTunnel(HTTPTransaction* txn,
+                    folly::AsyncSocket& upstream) noexcept override;
   size_t sendChunkHeader(HTTPTransaction* txn,
                          size_t length) noexcept override;
   size_t sendChunkTerminator(HTTPTransaction* txn) noexcept override;
@@ -504,6 +777,9 @@ class HTTPSession:
   // EventBase::LoopCallback methods
   void runLoopCallback() noexcept override;
 
+  // EgressScheduler::Callback methods
+  uint64_t runScheduledEgress(uint64_t budget) noexcept override;
+
   /**
    * Schedule a write to occur at the end of this event loop.
    */
@@ -520,9 +796,37 @@ class HTTPSession:
    * enqueued within the whole session.
    */
   inline uint64_t sessionByteOffset() {
-    return bytesScheduled_ + writeBuf_.chainLength();
+    return bytesScheduled_ + writeBuf_.chainLength() + fileBodyBytes_;
   }
 
+  /**
+   * Queue length bytes of file at offset as the next egress, following what
+   * is in writeBuf_.
+   */
+  void queueFileBody(std::shared_ptr<folly::File> file,
+                     off_t offset,
+                     size_t length);
+
+  /**
+   * Takes the first length bytes of writeBuf_ to write, which must not go
+   * past the next file body.
+   */
+  std::unique_ptr<folly::IOBuf> takeWriteBuf(size_t length);
+
+  /**
+   * Writes the file body due next with sendfile(2).  Returns whether it
+   * wrote all it could and more egress may be written right away.
+   */
+  bool writeFileBody();
+
+  /** Invoked once the socket is writable after writeFileBody() blocked. */
+  void onFileBodyWritable();
+
+  /** Starts the spliced tunnel once the egress before it went out. */
+  void maybeStartSpliceTunnel();
+
+  void onSpliceTunnelClosed(ProxygenError err);
+
   /**
    * Immediately shut down the session, by deleting the loop callbacks first
    */
@@ -540,6 +844,15 @@ class HTTPSession:
    */
   HTTPTransaction* findTransaction(HTTPCodec::StreamID streamID);
 
+  /** The IDs of all transactions, in increasing order */
+  std::vector<HTTPCodec::StreamID> getSortedTransactionIds() const;
+
+  /**
+   * The transaction with the highest stream ID, the most recent one on a
+   * pipelined HTTP/1.x connection.  There must be at least one.
+   */
+  HTTPTransaction& getNewestTransaction();
+
   /**
    * Create a new transaction.
    * @return pointer to the transaction on success, or else nullptr if it
@@ -595,10 +908,7 @@ class HTTPSession:
   void invokeOnAllTransactions(void (HTTPTransaction::*fn)(Args1...),
                                Args2&&... args) {
     DestructorGuard g(this);
-    std::vector<HTTPCodec::StreamID> ids;
-    for (const auto& txn: transactions_) {
-      ids.push_back(txn.first);
-    }
+    auto ids = getSortedTransactionIds();
     for (auto idit = ids.begin(); idit != ids.end() && !transactions_.empty();
          ++idit) {
       auto txn = findTransaction(*idit);
@@ -675,11 +985,23 @@ class HTTPSession:
     if (isLoopCallbackScheduled()) {
       cancelLoopCallback();
     }
+    cancelScheduledEgress();
     if (shutdownTransportCb_) {
       shutdownTransportCb_->cancelLoopCallback();
     }
   }
 
+  // For detachThreadLocals, the timer runs on the old EventBase
+  void cancelHibernateTimeout() {
+    hibernateTimer_.cancelTimeout();
+  }
+
+  void scheduleRttProbe();
+  void rttProbeTimeoutExpired() noexcept;
+
+  void maybeAttachSSLContext(folly::SSLContextPtr sslContext) const;
+  void maybeDetachSSLContext() const;
+
   // protected members
   class WriteTimeout :
       public folly::HHWheelTimer::Callback {
@@ -699,7 +1021,19 @@ class HTTPSession:
   /** Chain of ingress IOBufs */
   folly::IOBufQueue readBuf_{folly::IOBufQueue::cacheChainLength()};
 
-  std::map<HTTPCodec::StreamID, HTTPTransaction> transactions_;
+  struct TransactionTag {};
+  using TransactionAllocator = RecyclingAllocator<
+    TransactionTag, std::pair<const HTTPCodec::StreamID, HTTPTransaction>>;
+
+  /**
+   * Transactions by stream ID, for O(1) lookup of every frame's stream.
+   * A node map so transactions never move; it is unordered, callers that
+   * need stream order use getSortedTransactionIds().
+   */
+  folly::F14NodeMap<HTTPCodec::StreamID, HTTPTransaction,
+                    folly::f14::DefaultHasher<HTTPCodec::StreamID>,
+                    folly::f14::DefaultKeyEqual<HTTPCodec::StreamID>,
+                    TransactionAllocator> transactions_;
 
   /** Count of transactions awaiting input */
   uint32_t liveTransactions_{0};
@@ -884,6 +1218,14 @@ class HTTPSession:
       }
     }
 
+    void setZeroCopy(bool zeroCopy) {
+      if (zeroCopy) {
+        flags_ = flags_ | folly::WriteFlags::WRITE_MSG_ZEROCOPY;
+      } else {
+        unSet(flags_, folly::WriteFlags::WRITE_MSG_ZEROCOPY);
+      }
+    }
+
     void setTimestampTX(bool timestampTx) {
       if (timestampTx) {
         flags_ = flags_ | folly::WriteFlags::TIMESTAMP_TX;
@@ -929,11 +1271,113 @@ class HTTPSession:
     folly::IntrusiveList<WriteSegment, &WriteSegment::listHook>;
   WriteSegmentList pendingWrites_;
 
+  /**
+   * A file body queued by sendFileBody(), to be written after the
+   * writeBufBytes of writeBuf_ that are between it and the previous one.
+   */
+  struct FileBodySegment {
+    std::shared_ptr<folly::File> file;
+    off_t offset;
+    size_t length;
+    size_t writeBufBytes;
+  };
+  std::deque<FileBodySegment> fileBodySegments_;
+  // Bytes of the file bodies left to write
+  uint64_t fileBodyBytes_{0};
+
+  // Writes at least this long use MSG_ZEROCOPY, 0 if none do
+  size_t egressZeroCopyThreshold_{0};
+
+  /**
+   * Counts ingress body bytes for the receive window autotuning, starting a
+   * BDP sample when due.
+   */
+  void sampleReceiveWindow(uint64_t bytes);
+
+  /**
+   * Sets the session receive window to sessionWindow and scales the stream
+   * windows along.  The windows of existing streams only grow.
+   */
+  void resizeReceiveWindows(uint32_t sessionWindow);
+
+  /**
+   * Sets the session receive window granted to the peer to
+   * receiveSessionWindowSize_, or to the session's share of the ingress
+   * memory budget while that is over its limit, whichever is smaller.
+   */
+  void fitReceiveWindowToBudget();
+
+  /**
+   * Counts ingress bytes processed against the session window, acked in
+   * flushWindowUpdates.
+   */
+  void connIngressBytesProcessed(uint32_t bytes);
+
+  /**
+   * Writes the WINDOW_UPDATEs deferred since the last loop callback into
+   * writeBuf_, one per stream and at most one for the session.
+   */
+  void flushWindowUpdates();
+
+  // Stream WINDOW_UPDATEs to send, merged per stream, in order
+  std::vector<std::pair<HTTPCodec::StreamID, uint32_t>> pendingWindowUpdates_;
+  // Ingress bytes processed not yet reported to connFlowControl_
+  uint32_t pendingConnBytesProcessed_{0};
+
+  std::unique_ptr<BDPEstimator> bdpEstimator_;
+  RttEstimator rttEstimator_;
+  size_t minReceiveStreamWindowSize_{0};
+  size_t maxReceiveStreamWindowSize_{0};
+
+  // Owned by the codec chain
+  FrameTraceFilter* frameTrace_{nullptr};
+  TrafficCaptureFilter* trafficCapture_{nullptr};
+
+  /**
+   * Waits for the socket to be writable again once a sendfile(2) would
+   * block, which counts as an active write until then.
+   */
+  class FileBodyWriter : public folly::EventHandler {
+   public:
+    explicit FileBodyWriter(HTTPSession& session) : session_(session) {}
+
+    void handlerReady(uint16_t /*events*/) noexcept override {
+      session_.onFileBodyWritable();
+    }
+
+   private:
+    HTTPSession& session_;
+  };
+  FileBodyWriter fileBodyWriter_{*this};
+
+  /**
+   * The CONNECT tunnel spliceTunnel() relays in the kernel, and the
+   * transaction it belongs to.  Reads stay paused while it is set.
+   */
+  class SpliceTunnelCallback : public SpliceTunnel::Callback {
+   public:
+    explicit SpliceTunnelCallback(HTTPSession& session) : session_(session) {}
+
+    void onTunnelClosed(SpliceTunnel& /*tunnel*/,
+                        ProxygenError err) noexcept override {
+      session_.onSpliceTunnelClosed(err);
+    }
+
+   private:
+    HTTPSession& session_;
+  };
+  SpliceTunnelCallback spliceTunnelCallback_{*this};
+  std::unique_ptr<SpliceTunnel> spliceTunnel_;
+  HTTPCodec::StreamID spliceTunnelStream_{0};
+
   /**
    * Connection level flow control for SPDY >= 3.1 and HTTP/2
    */
   FlowControlFilter* connFlowControl_{nullptr};
 
+  // Whether codec_ has HTTPChecks, on its own or fused into connFlowControl_
+  bool hasHTTPChecks_{false};
+
   /**
    * The received setting for the maximum number of concurrent
    * transactions that this session may create. We may assume the
@@ -987,10 +1431,129 @@ class HTTPSession:
    */
   uint64_t egressBytesLimit_{0};
 
+  /**
+   * Pipelined response coalescing, see setMaxPipelineBatch().
+   * pipelineBatchCount_ counts messages whose egress finished since the
+   * last write.
+   */
+  uint32_t maxPipelineBatch_{1};
+  uint32_t pipelineBatchCount_{0};
+
+  // See setEgressChunkCoalescing()
+  uint32_t maxCoalescedChunk_{0};
+
+  // Reads tinfo from the socket, bypassing the cache
+  bool readTransportInfo(wangle::TransportInfo* tinfo) const;
+
+  // See setTransportInfoCachePolicy(), it is filled from const getters
+  mutable TransportInfoCache transportInfoCache_{
+    [this](wangle::TransportInfo* tinfo) { return readTransportInfo(tinfo); }};
+
+  /**
+   * Egress batching, see setEgressBatchPolicy().  egressBatchTarget_ is the
+   * current target, raised while the socket is backed up.
+   */
+  EgressBatchPolicy egressBatchPolicy_;
+  uint64_t egressBatchTarget_{0};
+  // The TCP_NOTSENT_LOWAT last set on the socket, 0 if none
+  uint32_t notSentLowat_{0};
+
+  bool trackNotSentLowat() const {
+    return egressBatchPolicy_.maxNotSentLowat > egressBatchPolicy_.notSentLowat;
+  }
+
+  // Sets TCP_NOTSENT_LOWAT if it isn't lowat already
+  void setNotSentLowat(uint32_t lowat);
+
+  // Resizes TCP_NOTSENT_LOWAT to the current congestion window
+  void updateNotSentLowat();
+
+  // Whether the egress gathered so far makes a big enough write
+  bool egressBatchComplete(TimePoint batchStart) const;
+
+  /**
+   * See setEgressScheduler().  egressBudgetLeft_ is what is left to write
+   * in the current turn, if inScheduledEgress_.
+   */
+  std::shared_ptr<EgressScheduler> egressScheduler_;
+  uint64_t egressBudgetLeft_{0};
+  bool inScheduledEgress_{false};
+
+  bool pipelineBatchFull() const {
+    return maxPipelineBatch_ > 1 && pipelineBatchCount_ >= maxPipelineBatch_;
+  }
+
+  // Return the fully parsed readBuf_ to the thread's pool
+  void recycleReadBuffer();
+
+  static uint32_t readBufferPoolSize_;
+  static std::shared_ptr<BufferAllocator> bufferAllocator_;
+
+  /**
+   * Append egress of pipelined responses that completed while building
+   * writeBuf, so they go out in the same write.
+   */
+  void appendPipelinedEgress(std::unique_ptr<folly::IOBuf>& writeBuf,
+                             bool* cork, bool* som, bool* eom);
+
+  /**
+   * Deliver the body transactions coalesce (see
+   * HTTPTransaction::setIngressBodyCoalescing) at the end of a read.
+   * heldIngressBodyStreams_ are the streams that started holding body
+   * during it.
+   */
+  void flushHeldIngressBody();
+  std::vector<HTTPCodec::StreamID> heldIngressBodyStreams_;
+
+  /**
+   * Rapid reset protection, see setStreamResetLimit().  Streams opened in
+   * the current read wait in pendingStreams_ with what was parsed for them
+   * so far, and only get a transaction if they are not reset by the end of
+   * it, or once another frame needs them to exist.
+   */
+  struct PendingStream {
+    HTTPCodec::StreamID id;
+    http2::PriorityUpdate priority;
+    std::unique_ptr<HTTPMessage> msg;
+    bool eom{false};
+  };
+
+  PendingStream* findPendingStream(HTTPCodec::StreamID streamID);
+  void createPendingTransactions();
+  void startIngressTransaction(HTTPCodec::StreamID streamID,
+                               const http2::PriorityUpdate& priority);
+  // Counts a reset from the peer, false if the session was ended for it
+  bool onStreamReset(HTTPCodec::StreamID streamID);
+
+  std::vector<PendingStream> pendingStreams_;
+  std::unique_ptr<ClosedStreamSet> closedStreams_;
+  uint32_t maxStreamResets_{0};
+  std::chrono::milliseconds streamResetInterval_{0};
+  TimePoint streamResetIntervalStart_;
+  uint32_t streamResets_{0};
+
+  /**
+   * HTTP/2 with prior knowledge, see enableH2cPriorKnowledge(): what was
+   * set for it until the first bytes are read, if they are the preface.
+   */
+  struct H2cPriorKnowledge {
+    SettingsList egressSettings;
+    uint32_t maxConcurrentIncomingStreams{0};
+    uint32_t maxStreamResets{0};
+    std::chrono::milliseconds streamResetInterval{0};
+  };
+
+  // False until enough of the first bytes were read to tell
+  bool checkH2cPriorKnowledge();
+  void onH2cPriorKnowledge();
+  std::unique_ptr<H2cPriorKnowledge> h2cPriorKnowledge_;
+
   // Flow control settings
   size_t initialReceiveWindow_{0};
   size_t receiveStreamWindowSize_{0};
   size_t receiveSessionWindowSize_{0};
+  // The session window connFlowControl_ has, or is shrinking to
+  size_t connReceiveWindowSize_{0};
 
   class ShutdownTransportCallback : public folly::EventBase::LoopCallback {
    public:
@@ -1049,6 +1612,33 @@ class HTTPSession:
   };
   DrainTimeout drainTimeout_;
 
+  class HibernateTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit HibernateTimeout(HTTPSession* session) : session_(session) {}
+    ~HibernateTimeout() override {}
+
+    void timeoutExpired() noexcept override {
+      session_->hibernate();
+    }
+   private:
+    HTTPSession* session_;
+  };
+  HibernateTimeout hibernateTimer_;
+
+  class RttProbeTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit RttProbeTimeout(HTTPSession* session) : session_(session) {}
+    ~RttProbeTimeout() override {}
+
+    void timeoutExpired() noexcept override {
+      session_->rttProbeTimeoutExpired();
+    }
+   private:
+    HTTPSession* session_;
+  };
+  RttProbeTimeout rttProbeTimer_;
+  std::chrono::milliseconds rttProbeInterval_{0};
+
   // secondary authentication manager
   std::unique_ptr<SecondaryAuthManagerBase> secondAuthManager_;
 
@@ -1068,6 +1658,9 @@ class HTTPSession:
   bool resetSocketOnShutdown_:1;
   // indicates a fatal error that prevents further ingress data processing
   bool inLoopCallback_:1;
+  bool holdUnsafeRequests_:1;
+  // a request that is not safe to replay waits for the end of the early data
+  bool egressHeldForReplaySafety_:1;
   bool inResume_:1;
   bool pendingPause_:1;
 };
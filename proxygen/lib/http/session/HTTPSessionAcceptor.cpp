@@ -12,8 +12,16 @@
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/HTTPDefaultSessionCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
+#include <proxygen/lib/http/session/HTTPSessionRebalancer.h>
+#include <proxygen/lib/utils/KernelTLS.h>
+#include <proxygen/lib/utils/Time.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <wangle/acceptor/ManagedConnection.h>
+#include <algorithm>
+#include <cmath>
 
 using folly::AsyncSocket;
+using folly::AsyncSSLSocket;
 using folly::SocketAddress;
 using std::list;
 using std::string;
@@ -21,6 +29,191 @@ using std::unique_ptr;
 
 namespace proxygen {
 
+namespace {
+// A gradual drain drains a share of the remaining sessions every step
+const int64_t kGradualDrainSteps = 50;
+const std::chrono::milliseconds kMinGradualDrainStep{10};
+}
+
+class HTTPSessionAcceptor::GradualDrain : public folly::AsyncTimeout {
+ public:
+  GradualDrain(HTTPSessionAcceptor& acceptor,
+               std::chrono::milliseconds window)
+      : folly::AsyncTimeout(acceptor.getEventBase()),
+        acceptor_(acceptor),
+        step_(std::max(window / kGradualDrainSteps, kMinGradualDrainStep)),
+        end_(std::chrono::steady_clock::now() + window) {
+  }
+
+  void timeoutExpired() noexcept override {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      end_ - std::chrono::steady_clock::now());
+    if (remaining <= step_) {
+      acceptor_.drainSessions(1.0);
+      acceptor_.drainFinished_ = true;
+      return;
+    }
+    // Spread the sessions left evenly over the time left, which also
+    // accounts for the sessions closing on their own meanwhile
+    acceptor_.drainSessions(double(step_.count()) / remaining.count());
+    scheduleTimeout(step_);
+  }
+
+ private:
+  HTTPSessionAcceptor& acceptor_;
+  const std::chrono::milliseconds step_;
+  const std::chrono::steady_clock::time_point end_;
+};
+
+class HTTPSessionAcceptor::StreamLimitUpdater : public folly::AsyncTimeout {
+ public:
+  StreamLimitUpdater(HTTPSessionAcceptor& acceptor,
+                     const AdaptiveStreamLimit::Options& options,
+                     uint32_t initial)
+      : folly::AsyncTimeout(acceptor.getEventBase()),
+        acceptor_(acceptor),
+        limit_(options, initial),
+        lastCpuTime_(getThreadCpuTime()),
+        lastSampleTime_(std::chrono::steady_clock::now()) {
+    scheduleTimeout(options.interval);
+  }
+
+  void timeoutExpired() noexcept override {
+    // The share of the interval the thread ran for, it serves the
+    // acceptor's event base only
+    auto cpuTime = getThreadCpuTime();
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - lastSampleTime_);
+    double utilization = elapsed.count() > 0 ?
+      double((cpuTime - lastCpuTime_).count()) / elapsed.count() : 0;
+    lastCpuTime_ = cpuTime;
+    lastSampleTime_ = now;
+
+    auto previous = limit_.getLimit();
+    auto limit = limit_.update(utilization);
+    if (limit != previous) {
+      VLOG(4) << "Stream limit " << previous << " -> " << limit
+              << " at utilization=" << utilization
+              << " memory=" << limit_.getMemoryRatio();
+      acceptor_.applyStreamLimit(limit);
+    }
+    scheduleTimeout(limit_.getOptions().interval);
+  }
+
+  uint32_t getLimit() const {
+    return limit_.getLimit();
+  }
+
+ private:
+  HTTPSessionAcceptor& acceptor_;
+  AdaptiveStreamLimit limit_;
+  std::chrono::nanoseconds lastCpuTime_;
+  std::chrono::steady_clock::time_point lastSampleTime_;
+};
+
+/**
+ * A connection accepted with deferSessionUntilData: the socket and the
+ * connection manager's idle timeout until the first bytes arrive, peeked
+ * so that the session reads them.
+ */
+class HTTPSessionAcceptor::DeferredConnection
+    : public wangle::ManagedConnection,
+      private folly::AsyncTransportWrapper::ReadCallback {
+ public:
+  DeferredConnection(HTTPSessionAcceptor& acceptor,
+                     AsyncSocket::UniquePtr sock,
+                     const SocketAddress& peerAddress,
+                     const string& nextProtocol,
+                     const wangle::TransportInfo& tinfo)
+      : acceptor_(acceptor),
+        sock_(std::move(sock)),
+        peerAddress_(peerAddress),
+        nextProtocol_(nextProtocol),
+        tinfo_(tinfo) {
+  }
+
+  void start() {
+    sock_->setPeek(true);
+    sock_->setReadCB(this);
+  }
+
+  // ManagedConnection
+  void timeoutExpired() noexcept override {
+    VLOG(4) << "No data from " << peerAddress_ << " before the idle timeout";
+    close();
+  }
+
+  void describe(std::ostream& os) const override {
+    os << "deferred connection, peer=" << peerAddress_;
+  }
+
+  bool isBusy() const override {
+    return false;
+  }
+
+  // Nothing to drain, the client sent no request yet
+  void notifyPendingShutdown() override {
+    close();
+  }
+
+  void closeWhenIdle() override {
+    close();
+  }
+
+  void dropConnection() override {
+    close();
+  }
+
+  void dumpConnectionState(uint8_t /*loglevel*/) override {}
+
+ private:
+  // Peeks a byte, only to learn that data arrived
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    *bufReturn = &peekByte_;
+    *lenReturn = sizeof(peekByte_);
+  }
+
+  void readDataAvailable(size_t /*len*/) noexcept override {
+    sock_->setReadCB(nullptr);
+    sock_->setPeek(false);
+    auto cm = getConnectionManager();
+    if (cm) {
+      cm->removeConnection(this);
+    }
+    acceptor_.createSession(std::move(sock_), &peerAddress_, nextProtocol_,
+                            tinfo_);
+    destroy();
+  }
+
+  void readEOF() noexcept override {
+    VLOG(4) << "Connection from " << peerAddress_ << " closed without data";
+    close();
+  }
+
+  void readErr(const folly::AsyncSocketException& ex) noexcept override {
+    VLOG(4) << "Connection from " << peerAddress_ << " failed: " << ex.what();
+    close();
+  }
+
+  void close() {
+    sock_->setReadCB(nullptr);
+    sock_->closeNow();
+    auto cm = getConnectionManager();
+    if (cm) {
+      cm->removeConnection(this);
+    }
+    destroy();
+  }
+
+  HTTPSessionAcceptor& acceptor_;
+  AsyncSocket::UniquePtr sock_;
+  SocketAddress peerAddress_;
+  string nextProtocol_;
+  wangle::TransportInfo tinfo_;
+  char peekByte_;
+};
+
 const SocketAddress HTTPSessionAcceptor::unknownSocketAddress_("0.0.0.0", 0);
 
 HTTPSessionAcceptor::HTTPSessionAcceptor(const AcceptorConfiguration& accConfig)
@@ -39,6 +232,68 @@ HTTPSessionAcceptor::HTTPSessionAcceptor(
 }
 
 HTTPSessionAcceptor::~HTTPSessionAcceptor() {
+  if (rebalancer_) {
+    rebalancer_->removeAcceptor(this);
+  }
+}
+
+void HTTPSessionAcceptor::setSessionRebalancer(
+    std::shared_ptr<HTTPSessionRebalancer> rebalancer) {
+  if (rebalancer_) {
+    rebalancer_->removeAcceptor(this);
+  }
+  rebalancer_ = std::move(rebalancer);
+  if (rebalancer_) {
+    rebalancer_->addAcceptor(this);
+  }
+}
+
+void HTTPSessionAcceptor::setAdaptiveStreamLimit(
+    AdaptiveStreamLimit::Options options) {
+  CHECK(getEventBase()->isInEventBaseThread());
+  if (!options.egressMemoryBudget) {
+    options.egressMemoryBudget = accConfig_.egressMemoryBudget;
+  }
+  if (!options.ingressMemoryBudget) {
+    options.ingressMemoryBudget = accConfig_.ingressMemoryBudget;
+  }
+  auto initial = accConfig_.maxConcurrentIncomingStreams ?
+    accConfig_.maxConcurrentIncomingStreams :
+    kDefaultMaxConcurrentIncomingStreams;
+  streamLimitUpdater_ =
+    std::make_unique<StreamLimitUpdater>(*this, options, initial);
+}
+
+uint32_t HTTPSessionAcceptor::getAdaptiveStreamLimit() const {
+  return streamLimitUpdater_ ? streamLimitUpdater_->getLimit() : 0;
+}
+
+void HTTPSessionAcceptor::applyStreamLimit(uint32_t limit) {
+  if (admissionController_) {
+    limit = admissionController_->getMaxConcurrentIncomingStreams(limit);
+  }
+  if (downstreamConnectionManager_) {
+    downstreamConnectionManager_->iterateConns(
+      [limit] (wangle::ManagedConnection* conn) {
+        auto session = dynamic_cast<HTTPSessionBase*>(conn);
+        if (session && !session->isDraining()) {
+          session->setMaxConcurrentIncomingStreams(limit);
+        }
+      });
+  }
+}
+
+AsyncSSLSocket::UniquePtr HTTPSessionAcceptor::makeNewAsyncSSLSocket(
+    const std::shared_ptr<folly::SSLContext>& ctx,
+    folly::EventBase* base,
+    int fd) {
+  if (accConfig_.enableKernelTLS && !enableKernelTLS(*ctx)) {
+    VLOG(4) << "OpenSSL does not support kernel TLS";
+  }
+  return AsyncSSLSocket::UniquePtr(
+      new AsyncSSLSocket(ctx, base, folly::NetworkSocket::fromFd(fd),
+                         true /* set server */,
+                         true /* defer the security negotiation */));
 }
 
 const HTTPErrorPage* HTTPSessionAcceptor::getErrorPage(
@@ -62,12 +317,40 @@ void HTTPSessionAcceptor::onNewConnection(
     wangle::SecureTransportType,
     const wangle::TransportInfo& tinfo) {
 
+  if (admissionController_ && !admissionController_->admitConnection()) {
+    VLOG(4) << "Dropping a connection from " << *peerAddress
+            << " while overloaded";
+    sock->closeNow();
+    onSessionCreationError(ProxygenError::kErrorDropped);
+    return;
+  }
+
+  if (accConfig_.deferSessionUntilData &&
+      sock->getSecurityProtocol().empty() &&
+      dynamic_cast<AsyncSocket*>(sock.get())) {
+    // The TLS connections already waited for the handshake
+    auto deferred = new DeferredConnection(
+      *this, AsyncSocket::UniquePtr(static_cast<AsyncSocket*>(sock.release())),
+      *peerAddress, nextProtocol, tinfo);
+    Acceptor::addConnection(deferred);
+    deferred->start();
+    return;
+  }
+  createSession(std::move(sock), peerAddress, nextProtocol, tinfo);
+}
+
+void HTTPSessionAcceptor::createSession(
+    folly::AsyncTransportWrapper::UniquePtr sock,
+    const SocketAddress* peerAddress,
+    const string& nextProtocol,
+    const wangle::TransportInfo& tinfo) {
+  // we assume if security protocol isn't empty, then it's TLS
+  bool isTLS = !sock->getSecurityProtocol().empty();
   unique_ptr<HTTPCodec> codec
       = codecFactory_->getCodec(
           nextProtocol,
           TransportDirection::DOWNSTREAM,
-          // we assume if security protocol isn't empty, then it's TLS
-          !sock->getSecurityProtocol().empty());
+          isTLS);
 
   if (!codec) {
     VLOG(2) << "codecFactory_ failed to provide codec";
@@ -75,6 +358,13 @@ void HTTPSessionAcceptor::onNewConnection(
     return;
   }
 
+  if (accConfig_.enableKernelTLS) {
+    auto sslSocket = sock->getUnderlyingTransport<AsyncSSLSocket>();
+    if (sslSocket && onKernelTLSHandshake(*sslSocket)) {
+      VLOG(4) << "TLS records are encrypted by the kernel";
+    }
+  }
+
   auto controller = getController();
   SocketAddress localAddress;
   try {
@@ -102,23 +392,109 @@ void HTTPSessionAcceptor::onNewConnection(
                               localAddress, *peerAddress,
                               controller, std::move(codec), tinfo,
                               sessionInfoCb);
-  if (accConfig_.maxConcurrentIncomingStreams) {
-    session->setMaxConcurrentIncomingStreams(
-        accConfig_.maxConcurrentIncomingStreams);
+  if (accConfig_.allowH2cPriorKnowledge && !isTLS) {
+    // Before what it would keep for HTTP/2
+    session->enableH2cPriorKnowledge();
+  }
+  uint32_t maxConcurrentIncomingStreams = streamLimitUpdater_ ?
+    streamLimitUpdater_->getLimit() : accConfig_.maxConcurrentIncomingStreams;
+  if (admissionController_) {
+    maxConcurrentIncomingStreams =
+      admissionController_->getMaxConcurrentIncomingStreams(
+        maxConcurrentIncomingStreams ? maxConcurrentIncomingStreams :
+                                       kDefaultMaxConcurrentIncomingStreams);
+    session->setAdmissionController(admissionController_.get());
+  }
+  if (maxConcurrentIncomingStreams) {
+    session->setMaxConcurrentIncomingStreams(maxConcurrentIncomingStreams);
+  }
+  if (accConfig_.maxPipelineBatch > 1) {
+    session->setMaxPipelineBatch(accConfig_.maxPipelineBatch);
+  }
+  if (accConfig_.maxCoalescedChunkSize > 0) {
+    session->setEgressChunkCoalescing(accConfig_.maxCoalescedChunkSize);
+  }
+  if (accConfig_.transportInfoCacheRequests > 0 ||
+      accConfig_.transportInfoCacheAge.count() > 0) {
+    HTTPSession::TransportInfoCachePolicy policy;
+    policy.maxRequests = accConfig_.transportInfoCacheRequests;
+    policy.maxAge = accConfig_.transportInfoCacheAge;
+    session->setTransportInfoCachePolicy(policy);
+  }
+  if (accConfig_.maxStreamResetsPerInterval > 0) {
+    session->setStreamResetLimit(accConfig_.maxStreamResetsPerInterval,
+                                 accConfig_.streamResetInterval);
+  }
+  if (accConfig_.egressTargetBytesPerWrite > 0 ||
+      accConfig_.tcpNotSentLowat > 0) {
+    HTTPSession::EgressBatchPolicy batchPolicy;
+    batchPolicy.targetBytesPerWrite = accConfig_.egressTargetBytesPerWrite;
+    batchPolicy.maxLatency = accConfig_.egressBatchMaxLatency;
+    batchPolicy.notSentLowat = accConfig_.tcpNotSentLowat;
+    session->setEgressBatchPolicy(batchPolicy);
+  }
+  if (accConfig_.egressSchedulerQuantum > 0) {
+    if (!egressScheduler_) {
+      egressScheduler_ = std::make_shared<EgressScheduler>(
+        getEventBase(), accConfig_.egressSchedulerQuantum);
+    }
+    session->setEgressScheduler(egressScheduler_);
+  }
+  session->setHibernateTimeout(accConfig_.hibernateTimeout);
+  if (accConfig_.socketTimestampTimeout.count() > 0 &&
+      !session->enableSocketTimestamps(accConfig_.socketTimestampTimeout)) {
+    VLOG(4) << "socket timestamps are not supported on this transport";
+  }
+  if (accConfig_.egressZeroCopyThreshold > 0 &&
+      !session->setEgressZeroCopyThreshold(
+        accConfig_.egressZeroCopyThreshold)) {
+    VLOG(4) << "zero copy writes are not supported on this transport";
   }
   session->setEgressSettings(accConfig_.egressSettings);
 
   // set HTTP2 priorities flag on session object
   auto HTTP2PrioritiesEnabled = getHttp2PrioritiesEnabled();
   session->setHTTP2PrioritiesEnabled(HTTP2PrioritiesEnabled);
+  if (accConfig_.useRFC9218Priorities) {
+    session->useRFC9218Priorities();
+  }
+  if (accConfig_.headerEncodeCacheSize > 0) {
+    session->setHeaderEncodeCacheSize(accConfig_.headerEncodeCacheSize);
+  }
+  if (accConfig_.useStaticHeaderBlockCache) {
+    session->setUseStaticHeaderBlockCache(true);
+  }
+  if (accConfig_.headerPassthrough) {
+    session->setHeaderPassthrough(true);
+  }
+  if (accConfig_.cpuTimeSampleRate > 0) {
+    session->setCpuTimeSampleRate(accConfig_.cpuTimeSampleRate);
+  }
 
   // set flow control parameters
   session->setFlowControl(accConfig_.initialReceiveWindow,
                           accConfig_.receiveStreamWindowSize,
                           accConfig_.receiveSessionWindowSize);
+  if (accConfig_.maxReceiveSessionWindowSize > 0) {
+    session->enableReceiveWindowAutotuning(
+      accConfig_.maxReceiveSessionWindowSize,
+      accConfig_.maxReceiveStreamWindowSize);
+  }
+  if (accConfig_.frameTraceSize > 0) {
+    session->enableFrameTrace(accConfig_.frameTraceSize);
+  }
+  if (accConfig_.trafficCapture && accConfig_.trafficCapture->shouldSample()) {
+    session->enableTrafficCapture(accConfig_.trafficCapture);
+  }
   if (accConfig_.writeBufferLimit > 0) {
     session->setWriteBufferLimit(accConfig_.writeBufferLimit);
   }
+  if (accConfig_.egressMemoryBudget) {
+    session->setEgressMemoryBudget(accConfig_.egressMemoryBudget);
+  }
+  if (accConfig_.ingressMemoryBudget) {
+    session->setIngressMemoryBudget(accConfig_.ingressMemoryBudget);
+  }
   session->setSessionStats(downstreamSessionStats_);
   Acceptor::addConnection(session);
   session->startNow();
@@ -130,4 +506,175 @@ size_t HTTPSessionAcceptor::dropIdleConnections(size_t num) {
   return downstreamConnectionManager_->dropIdleConnections(num);
 }
 
+void HTTPSessionAcceptor::drainGradually(std::chrono::milliseconds window) {
+  CHECK(getEventBase()->isInEventBaseThread());
+  drainedSessions_ = 0;
+  pendingSessions_ = 0;
+  drainFinished_ = false;
+  gradualDrain_ = std::make_unique<GradualDrain>(*this, window);
+  gradualDrain_->timeoutExpired();
+}
+
+HTTPSessionAcceptor::DrainProgress
+HTTPSessionAcceptor::getDrainProgress() const {
+  DrainProgress progress;
+  progress.drained = drainedSessions_;
+  progress.pending = pendingSessions_;
+  progress.finished = drainFinished_;
+  return progress;
+}
+
+void HTTPSessionAcceptor::drainSessions(double share) {
+  std::vector<HTTPSession*> sessions;
+  std::vector<HTTPSession*> busySessions;
+  if (downstreamConnectionManager_) {
+    downstreamConnectionManager_->iterateConns(
+      [&] (wangle::ManagedConnection* conn) {
+        auto session = dynamic_cast<HTTPSession*>(conn);
+        if (session && !session->isDraining()) {
+          (session->isBusy() ? busySessions : sessions).push_back(session);
+        }
+      });
+  }
+  std::stable_sort(busySessions.begin(), busySessions.end(),
+                   [] (const HTTPSession* a, const HTTPSession* b) {
+                     return a->getNumIncomingStreams() <
+                       b->getNumIncomingStreams();
+                   });
+  sessions.insert(sessions.end(), busySessions.begin(), busySessions.end());
+
+  auto toDrain = std::min(
+    sessions.size(), size_t(std::ceil(sessions.size() * share)));
+  VLOG(4) << "Draining " << toDrain << " of " << sessions.size()
+          << " sessions";
+  // Collected first, as draining an idle session closes it
+  for (size_t i = 0; i < toDrain; i++) {
+    sessions[i]->notifyPendingShutdown();
+  }
+  drainedSessions_ += toDrain;
+  pendingSessions_ = sessions.size() - toDrain;
+}
+
+std::vector<folly::NetworkSocket>
+HTTPSessionAcceptor::releaseIdleConnections() {
+  std::vector<HTTPSession*> sessions;
+  if (downstreamConnectionManager_) {
+    downstreamConnectionManager_->iterateConns(
+      [&] (wangle::ManagedConnection* conn) {
+        auto session = dynamic_cast<HTTPDownstreamSession*>(conn);
+        if (session && !session->isDraining() &&
+            session->getCodecProtocol() == CodecProtocol::HTTP_1_1 &&
+            session->isDetachable(true)) {
+          sessions.push_back(session);
+        }
+      });
+  }
+  // Collected first, releasing a socket drops its session
+  std::vector<folly::NetworkSocket> fds;
+  for (auto session : sessions) {
+    auto fd = session->releaseSocket();
+    if (fd != folly::NetworkSocket()) {
+      fds.push_back(fd);
+    }
+  }
+  return fds;
+}
+
+void HTTPSessionAcceptor::resumeConnection(folly::NetworkSocket fd) {
+  auto sock = makeNewAsyncSocket(getEventBase(), fd.toFd());
+  SocketAddress peerAddress;
+  try {
+    sock->getPeerAddress(&peerAddress);
+  } catch (const std::exception& ex) {
+    VLOG(2) << "Not resuming a closed connection: " << ex.what();
+    return;
+  }
+  wangle::TransportInfo tinfo;
+  onNewConnection(std::move(sock), &peerAddress, "http/1.1",
+                  wangle::SecureTransportType::NONE, tinfo);
+}
+
+HTTPSessionMemoryUsage
+HTTPSessionAcceptor::getMemoryUsage(size_t* sessions) const {
+  HTTPSessionMemoryUsage usage;
+  size_t numSessions = 0;
+  if (downstreamConnectionManager_) {
+    downstreamConnectionManager_->iterateConns(
+      [&] (wangle::ManagedConnection* conn) {
+        auto session = dynamic_cast<HTTPSessionBase*>(conn);
+        if (session) {
+          usage += session->getMemoryUsage();
+          numSessions++;
+        }
+      });
+  }
+  if (sessions) {
+    *sessions = numSessions;
+  }
+  return usage;
+}
+
+bool HTTPSessionAcceptor::getSessionStates(
+    std::vector<HTTPSessionStateSnapshot>& sessions,
+    size_t maxSessions,
+    size_t maxStreams,
+    std::chrono::milliseconds minInterval) {
+  auto now = getCurrentTime();
+  if (timePointInitialized(lastSessionStates_) &&
+      now - lastSessionStates_ < minInterval) {
+    return false;
+  }
+  lastSessionStates_ = now;
+  if (!downstreamConnectionManager_) {
+    return true;
+  }
+  size_t taken = 0;
+  downstreamConnectionManager_->iterateConns(
+    [&] (wangle::ManagedConnection* conn) {
+      auto session = dynamic_cast<HTTPSessionBase*>(conn);
+      if (session && taken < maxSessions) {
+        sessions.emplace_back();
+        session->getStateSnapshot(sessions.back(), maxStreams);
+        taken++;
+      }
+    });
+  return true;
+}
+
+std::vector<HTTPSession*> HTTPSessionAcceptor::releaseIdleSessions(
+    size_t maxSessions) {
+  std::vector<HTTPSession*> sessions;
+  if (!downstreamConnectionManager_) {
+    return sessions;
+  }
+  downstreamConnectionManager_->iterateConns(
+    [&] (wangle::ManagedConnection* conn) {
+      auto session = dynamic_cast<HTTPDownstreamSession*>(conn);
+      if (sessions.size() < maxSessions && session &&
+          !session->isDraining() && session->isDetachable(true)) {
+        sessions.push_back(session);
+      }
+    });
+  // Detaching removes the session from the connection manager
+  for (auto session : sessions) {
+    auto controller = session->getController();
+    if (controller) {
+      controller->detachSession(session);
+    }
+    session->detachThreadLocals();
+  }
+  return sessions;
+}
+
+void HTTPSessionAcceptor::adoptSession(HTTPSession* session) {
+  session->attachThreadLocals(getEventBase(), nullptr,
+                              getTransactionTimeoutSet(),
+                              downstreamSessionStats_,
+                              [] (HTTPCodecFilter*) {}, nullptr,
+                              getController());
+  getController()->attachSession(session);
+  session->setInfoCallback(getSessionInfoCallback());
+  Acceptor::addConnection(session);
+}
+
 } // proxygen
@@ -11,14 +11,19 @@
 
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/codec/SPDYCodec.h>
+#include <proxygen/lib/http/session/AdaptiveStreamLimit.h>
+#include <proxygen/lib/http/session/EgressScheduler.h>
+#include <proxygen/lib/http/session/HTTPAdmissionController.h>
 #include <proxygen/lib/http/session/HTTPDownstreamSession.h>
 #include <proxygen/lib/http/session/HTTPErrorPage.h>
 #include <proxygen/lib/http/session/SimpleController.h>
 #include <proxygen/lib/services/HTTPAcceptor.h>
 #include <folly/io/async/AsyncSSLSocket.h>
+#include <atomic>
 
 namespace proxygen {
 
+class HTTPSessionRebalancer;
 class HTTPSessionStats;
 
 /**
@@ -39,6 +44,7 @@ public:
    */
   void setDefaultErrorPage(std::unique_ptr<HTTPErrorPage> generator) {
     defaultErrorPage_ = std::move(generator);
+    simpleController_.clearErrorResponses();
   }
 
   /**
@@ -53,6 +59,7 @@ public:
    */
   void setDiagnosticErrorPage(std::unique_ptr<HTTPErrorPage> generator) {
     diagnosticErrorPage_ = std::move(generator);
+    simpleController_.clearErrorResponses();
   }
 
   /**
@@ -105,6 +112,101 @@ public:
     sessionInfoCb_ = cb;
   }
 
+  /**
+   * Set an HTTPAdmissionController shedding the new connections and
+   * requests, and scaling the streams allowed on new connections.
+   */
+  void setAdmissionController(
+      std::shared_ptr<HTTPAdmissionController> controller) {
+    admissionController_ = std::move(controller);
+  }
+
+  /**
+   * Set an HTTPSessionRebalancer moving idle sessions between this acceptor
+   * and the other ones, the acceptor must be initialized.
+   */
+  void setSessionRebalancer(std::shared_ptr<HTTPSessionRebalancer> rebalancer);
+
+  /**
+   * Adjusts the streams the downstream sessions allow every interval, to
+   * the CPU time of the acceptor's thread and the memory budgets, starting
+   * from the configured ones, see AdaptiveStreamLimit.  The budgets default
+   * to those of the AcceptorConfiguration.  Must be called in the
+   * acceptor's thread once it is initialized.
+   */
+  void setAdaptiveStreamLimit(AdaptiveStreamLimit::Options options);
+
+  /** The current adaptive stream limit, 0 unless one is set */
+  uint32_t getAdaptiveStreamLimit() const;
+
+  /**
+   * Detaches up to maxSessions downstream sessions which are not draining
+   * and are detachable, to hand them to adoptSession() on another acceptor.
+   */
+  std::vector<HTTPSession*> releaseIdleSessions(size_t maxSessions);
+
+  /**
+   * Attaches a session released by another acceptor to this acceptor's
+   * event base, thread local state, controller and session info callback.
+   * The onCreate() and onDestroy() of a moved session may then reach
+   * different info callbacks.
+   */
+  void adoptSession(HTTPSession* session);
+
+  /**
+   * Drains the downstream sessions gradually over window rather than all
+   * at once, so their clients don't all reconnect at the same moment.  The
+   * idle sessions are drained first and all of them by the end of window.
+   * Must be called in the acceptor's thread, e.g. before stopping.
+   */
+  void drainGradually(std::chrono::milliseconds window);
+
+  struct DrainProgress {
+    // The sessions drained so far
+    size_t drained{0};
+    // The sessions still to drain as of the last step
+    size_t pending{0};
+    // Whether all the sessions were drained
+    bool finished{false};
+  };
+
+  /**
+   * The progress of drainGradually(), from any thread.
+   */
+  DrainProgress getDrainProgress() const;
+
+  /**
+   * Releases the sockets of the idle plaintext HTTP/1.1 sessions, between
+   * requests, which hold no state beyond the socket, and drops the sessions.
+   * The caller owns the sockets, e.g. to hand them over to a new process.
+   */
+  std::vector<folly::NetworkSocket> releaseIdleConnections();
+
+  /**
+   * Serves a plaintext HTTP/1.1 connection released by
+   * releaseIdleConnections(), possibly in another process, like a new one.
+   */
+  void resumeConnection(folly::NetworkSocket fd);
+
+  /**
+   * The memory held by the acceptor's sessions together, for a summary of
+   * the worker.  sessions, if given, is set to how many there are.
+   */
+  HTTPSessionMemoryUsage getMemoryUsage(size_t* sessions = nullptr) const;
+
+  /**
+   * Appends the state of up to maxSessions downstream sessions, with up to
+   * maxStreams streams each, to sessions, for a diagnostics endpoint.  Call
+   * it on the acceptor's thread.  Returns false without taking any if the
+   * last snapshot was taken less than minInterval ago, so that polling the
+   * endpoint can't keep the worker busy walking its sessions.
+   */
+  bool getSessionStates(std::vector<HTTPSessionStateSnapshot>& sessions,
+                        size_t maxSessions = 1000,
+                        size_t maxStreams = 32,
+                        std::chrono::milliseconds minInterval =
+                          std::chrono::milliseconds(1000));
+
   virtual bool getHttp2PrioritiesEnabled() {
     return accConfig_.HTTP2PrioritiesEnabled;
   }
@@ -140,6 +242,11 @@ protected:
         new folly::AsyncSocket(base, folly::NetworkSocket::fromFd(fd)));
   }
 
+  folly::AsyncSSLSocket::UniquePtr makeNewAsyncSSLSocket(
+      const std::shared_ptr<folly::SSLContext>& ctx,
+      folly::EventBase* base,
+      int fd) override;
+
   virtual size_t dropIdleConnections(size_t num);
 
   virtual void onSessionCreationError(ProxygenError /*error*/) {}
@@ -148,6 +255,21 @@ protected:
   HTTPSessionAcceptor(const HTTPSessionAcceptor&) = delete;
   HTTPSessionAcceptor& operator=(const HTTPSessionAcceptor&) = delete;
 
+  // Drains share (0-1.0) of the sessions not draining yet, the idle ones
+  // and then those with the fewest streams first
+  void drainSessions(double share);
+
+  // Gives the sessions not draining a new adaptive stream limit
+  void applyStreamLimit(uint32_t limit);
+
+  // Builds the session of an accepted connection
+  void createSession(folly::AsyncTransportWrapper::UniquePtr sock,
+                     const folly::SocketAddress* peerAddress,
+                     const std::string& nextProtocol,
+                     const wangle::TransportInfo& tinfo);
+
+  class DeferredConnection;
+
   /** General-case error page generator */
   std::unique_ptr<HTTPErrorPage> defaultErrorPage_;
 
@@ -160,6 +282,26 @@ protected:
 
   HTTPSession::InfoCallback* sessionInfoCb_{nullptr};
 
+  std::shared_ptr<HTTPAdmissionController> admissionController_;
+
+  std::shared_ptr<HTTPSessionRebalancer> rebalancer_;
+
+  // Shared by the sessions of this acceptor if egressSchedulerQuantum is set
+  std::shared_ptr<EgressScheduler> egressScheduler_;
+
+  class StreamLimitUpdater;
+  std::unique_ptr<StreamLimitUpdater> streamLimitUpdater_;
+
+  class GradualDrain;
+  // Drains the next sessions over the drain window
+  std::unique_ptr<GradualDrain> gradualDrain_;
+  std::atomic<size_t> drainedSessions_{0};
+  std::atomic<size_t> pendingSessions_{0};
+  std::atomic<bool> drainFinished_{false};
+
+  // When getSessionStates() last took snapshots
+  TimePoint lastSessionStates_{};
+
   /**
    * 0.0.0.0:0, a valid address to use if getsockname() or getpeername() fails
    */
@@ -9,19 +9,76 @@
  */
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 
+#include <folly/SingletonThreadLocal.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/HTTPAdmissionController.h>
+#include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/http/session/RFC9218PriorityQueue.h>
+
+#include <sstream>
 
 using folly::SocketAddress;
 using wangle::TransportInfo;
 
 namespace proxygen {
+
+namespace {
+template <typename State>
+std::string stateName(State state) {
+  std::ostringstream os;
+  os << state;
+  return os.str();
+}
+}
+
+folly::dynamic HTTPSessionStateSnapshot::toDynamic() const {
+  folly::dynamic streamsArray = folly::dynamic::array;
+  for (const auto& stream : streams) {
+    streamsArray.push_back(folly::dynamic::object
+      ("id", stream.id)
+      ("ingressState", stateName(stream.ingressState))
+      ("egressState", stateName(stream.egressState))
+      ("sendWindow", stream.sendWindow)
+      ("recvWindow", stream.recvWindow)
+      ("egressBuffered", stream.egressBuffered)
+      ("ingressPaused", stream.ingressPaused)
+      ("egressPaused", stream.egressPaused)
+      ("enqueued", stream.enqueued)
+      ("dependency", stream.priority.streamDependency)
+      ("exclusive", stream.priority.exclusive)
+      ("weight", stream.priority.weight)
+      ("queueDepth", stream.queueDepth));
+  }
+  return folly::dynamic::object
+    ("protocol", getCodecProtocolString(protocol))
+    ("local", localAddress.describe())
+    ("peer", peerAddress.describe())
+    ("draining", draining)
+    ("idleMs", idleTime.count())
+    ("rttUs", rtt.count())
+    ("sendWindow", sendWindow)
+    ("recvWindow", recvWindow)
+    ("pendingWriteBytes", pendingWriteBytes)
+    ("egressQueueDepth", egressQueueDepth)
+    ("headerTableEgressBytes", compression.egressBytesStored_)
+    ("headerTableEgressSize", compression.egressHeaderTableSize_)
+    ("headerTableIngressBytes", compression.ingressBytesStored_)
+    ("headerTableIngressSize", compression.ingressHeaderTableSize_)
+    ("numStreams", numStreams)
+    ("streams", std::move(streamsArray));
+}
+
 uint32_t HTTPSessionBase::kDefaultReadBufLimit = 65536;
 uint32_t HTTPSessionBase::maxReadBufferSize_ = 4000;
 uint32_t HTTPSessionBase::egressBodySizeLimit_ = 4096;
 uint32_t HTTPSessionBase::kDefaultWriteBufLimit = 65536;
+std::shared_ptr<SessionMemoryBudget>
+  HTTPSessionBase::defaultEgressMemoryBudget_;
+std::shared_ptr<SessionMemoryBudget>
+  HTTPSessionBase::defaultIngressMemoryBudget_;
 
 
 HTTPSessionBase::HTTPSessionBase(
@@ -36,16 +93,20 @@ HTTPSessionBase::HTTPSessionBase(
     infoCallback_(infoCallback),
     transportInfo_(tinfo),
     codec_(std::move(codec)),
-    txnEgressQueue_(isHTTP2CodecProtocol(codec_->getProtocol()) ?
-                    WheelTimerInstance(timeout) :
-                    WheelTimerInstance(),
-                    rootNodeId),
+    txnEgressQueue_(std::make_unique<HTTP2PriorityQueue>(
+                      isHTTP2CodecProtocol(codec_->getProtocol()) ?
+                      WheelTimerInstance(timeout) :
+                      WheelTimerInstance(),
+                      rootNodeId)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
     prioritySample_(false),
     h2PrioritiesEnabled_(true),
+    rfc9218Priorities_(false),
     inResume_(false),
     pendingPause_(false),
+    egressLimitWasExceeded_(false),
+    ingressLimitWasExceeded_(false),
     exHeadersEnabled_(false) {
 
   // If we receive IPv4-mapped IPv6 addresses, convert them to IPv4.
@@ -53,6 +114,64 @@ HTTPSessionBase::HTTPSessionBase(
   peerAddr_.tryConvertToIPv4();
 
   setController(controller);
+  setEgressMemoryBudget(defaultEgressMemoryBudget_);
+  setIngressMemoryBudget(defaultIngressMemoryBudget_);
+}
+
+HTTPSessionBase::~HTTPSessionBase() {
+  if (egressMemoryBudget_) {
+    egressMemoryBudget_->removeSession(pendingWriteSize_);
+  }
+  if (ingressMemoryBudget_) {
+    ingressMemoryBudget_->removeSession(pendingReadSize_);
+  }
+}
+
+void HTTPSessionBase::setEgressMemoryBudget(
+    std::shared_ptr<SessionMemoryBudget> budget) {
+  if (egressMemoryBudget_) {
+    egressMemoryBudget_->removeSession(pendingWriteSize_);
+  }
+  egressMemoryBudget_ = std::move(budget);
+  if (egressMemoryBudget_) {
+    egressMemoryBudget_->addSession();
+    egressMemoryBudget_->update(pendingWriteSize_);
+  }
+}
+
+void HTTPSessionBase::setIngressMemoryBudget(
+    std::shared_ptr<SessionMemoryBudget> budget) {
+  if (ingressMemoryBudget_) {
+    ingressMemoryBudget_->removeSession(pendingReadSize_);
+  }
+  ingressMemoryBudget_ = std::move(budget);
+  if (ingressMemoryBudget_) {
+    ingressMemoryBudget_->addSession();
+    ingressMemoryBudget_->update(pendingReadSize_);
+  }
+}
+
+HTTPSessionMemoryUsage HTTPSessionBase::getMemoryUsage() const {
+  HTTPSessionMemoryUsage usage;
+  usage.priorityQueue = txnEgressQueue_->getMemoryUsage();
+  usage.transactionIngress = pendingReadSize_;
+  return usage;
+}
+
+void HTTPSessionBase::getStateSnapshot(HTTPSessionStateSnapshot& snapshot,
+                                       size_t /*maxStreams*/) const {
+  snapshot.protocol = getCodecProtocol();
+  snapshot.localAddress = localAddr_;
+  snapshot.peerAddress = peerAddr_;
+  snapshot.draining = isDraining();
+  snapshot.numStreams = getNumIncomingStreams() + getNumOutgoingStreams();
+  if (snapshot.numStreams == 0) {
+    snapshot.idleTime = getIdleTime();
+  }
+  snapshot.rtt = getRtt();
+  snapshot.sendWindow = getConnectionSendWindow();
+  snapshot.pendingWriteBytes = pendingWriteSize_;
+  snapshot.egressQueueDepth = txnEgressQueue_->numPendingEgress();
 }
 
 void HTTPSessionBase::runDestroyCallbacks() {
@@ -71,6 +190,7 @@ void HTTPSessionBase::onCodecChanged() {
   }
 
   initCodecHeaderIndexingStrategy();
+  initCodecHeaderEncodeCache();
 }
 
 void HTTPSessionBase::initCodecHeaderIndexingStrategy() {
@@ -84,11 +204,25 @@ void HTTPSessionBase::initCodecHeaderIndexingStrategy() {
   }
 }
 
+void HTTPSessionBase::initCodecHeaderEncodeCache() {
+  if ((headerEncodeCacheSize_ > 0 || useStaticHeaderBlockCache_ ||
+       headerPassthrough_) &&
+      isHTTP2CodecProtocol(codec_->getProtocol())) {
+    HTTP2Codec* h2Codec = static_cast<HTTP2Codec*>(codec_.getChainEndPtr());
+    h2Codec->setHeaderEncodeCacheSize(headerEncodeCacheSize_);
+    h2Codec->setUseStaticHeaderBlockCache(useStaticHeaderBlockCache_);
+    h2Codec->setHeaderPassthrough(headerPassthrough_);
+  }
+}
+
 bool HTTPSessionBase::onBodyImpl(std::unique_ptr<folly::IOBuf> chain, size_t length,
                                  uint16_t padding, HTTPTransaction* txn) {
   DestructorGuard dg(this);
   auto oldSize = pendingReadSize_;
   pendingReadSize_ += length + padding;
+  if (ingressMemoryBudget_) {
+    ingressMemoryBudget_->update(length + padding);
+  }
   txn->onIngressBody(std::move(chain), padding);
   if (oldSize < pendingReadSize_) {
     // Transaction must have buffered something and not called
@@ -96,8 +230,8 @@ bool HTTPSessionBase::onBodyImpl(std::unique_ptr<folly::IOBuf> chain, size_t len
     VLOG(4) << *this << " Enqueued ingress. Ingress buffer uses "
             << pendingReadSize_  << " of "  << readBufLimit_
             << " bytes.";
-    if (pendingReadSize_ > readBufLimit_ &&
-        oldSize <= readBufLimit_) {
+    if (ingressLimitExceeded() && !ingressLimitWasExceeded_) {
+      ingressLimitWasExceeded_ = true;
       if (infoCallback_) {
         infoCallback_->onIngressLimitExceeded(*this);
       }
@@ -109,13 +243,15 @@ bool HTTPSessionBase::onBodyImpl(std::unique_ptr<folly::IOBuf> chain, size_t len
 
 bool HTTPSessionBase::notifyBodyProcessed(uint32_t bytes) {
   CHECK_GE(pendingReadSize_, bytes);
-  auto oldSize = pendingReadSize_;
   pendingReadSize_ -= bytes;
+  if (ingressMemoryBudget_) {
+    ingressMemoryBudget_->update(-int64_t(bytes));
+  }
   VLOG(4) << *this << " Dequeued " << bytes << " bytes of ingress. "
     << "Ingress buffer uses " << pendingReadSize_  << " of "
     << readBufLimit_ << " bytes.";
-  if (oldSize > readBufLimit_ &&
-      pendingReadSize_ <= readBufLimit_) {
+  if (ingressLimitWasExceeded_ && !ingressLimitExceeded()) {
+    ingressLimitWasExceeded_ = false;
     return true;
   }
   return false;
@@ -141,11 +277,16 @@ HTTPSessionBase::updateWriteBufSize(int64_t delta) {
   // the sock_'s write buffer.
   delta += pendingWriteSizeDelta_;
   pendingWriteSizeDelta_ = 0;
-  bool wasExceeded = egressLimitExceeded();
+  bool wasExceeded = egressLimitWasExceeded_;
   DCHECK(delta >= 0 || uint64_t(-delta) <= pendingWriteSize_);
   pendingWriteSize_ += delta;
+  if (egressMemoryBudget_ && delta != 0) {
+    egressMemoryBudget_->update(delta);
+  }
+  bool exceeded = egressLimitExceeded();
+  egressLimitWasExceeded_ = exceeded;
 
-  if (egressLimitExceeded() && !wasExceeded) {
+  if (exceeded && !wasExceeded) {
     // Exceeded limit. Pause reading on the incoming stream.
     if (inResume_) {
       VLOG(3) << "Pausing txn egress for " << *this << " deferred";
@@ -154,7 +295,7 @@ HTTPSessionBase::updateWriteBufSize(int64_t delta) {
       VLOG(3) << "Pausing txn egress for " << *this;
       pauseTransactions();
     }
-  } else if (!egressLimitExceeded() && wasExceeded) {
+  } else if (!exceeded && wasExceeded) {
     // Dropped below limit. Resume reading on the incoming stream if needed.
     if (inResume_) {
       if (pendingPause_) {
@@ -170,6 +311,16 @@ HTTPSessionBase::updateWriteBufSize(int64_t delta) {
   }
 }
 
+void HTTPSessionBase::useRFC9218Priorities() {
+  if (rfc9218Priorities_) {
+    return;
+  }
+  CHECK(!hasActiveTransactions());
+  txnEgressQueue_ = std::make_unique<RFC9218PriorityQueue>(
+    txnEgressQueue_->getRootId());
+  rfc9218Priorities_ = true;
+}
+
 void HTTPSessionBase::updatePendingWrites() {
   if (pendingWriteSizeDelta_) {
     updateWriteBufSize(0);
@@ -180,18 +331,14 @@ void HTTPSessionBase::resumeTransactions() {
   CHECK(!inResume_);
   inResume_ = true;
   DestructorGuard g(this);
-  auto resumeFn = [] (HTTP2PriorityQueue&, HTTPCodec::StreamID,
-                      HTTPTransaction *txn, double) {
-    if (txn) {
-      txn->resumeEgress();
-    }
-    return false;
+  auto resumeFn = [] (HTTPTransaction *txn) {
+    txn->resumeEgress();
   };
   auto stopFn = [this] {
     return (!hasActiveTransactions() || egressLimitExceeded());
   };
 
-  txnEgressQueue_.iterateBFS(resumeFn, stopFn, true /* all */);
+  txnEgressQueue_->iterateTransactions(resumeFn, stopFn);
   inResume_ = false;
   if (pendingPause_) {
     VLOG(3) << "Pausing txn egress for " << *this;
@@ -257,6 +404,28 @@ void HTTPSessionBase::attachToSessionController() {
   }
 }
 
+HTTPTransaction::Handler* HTTPSessionBase::getAdmissionRejectHandler() {
+  if (!admissionController_ || admissionController_->admitRequest()) {
+    return nullptr;
+  }
+  VLOG(4) << "Rejecting a request of the overloaded session " << *this;
+  bool drain = admissionController_->shouldDrainOnReject();
+  if (drain) {
+    notifyPendingShutdown();
+  }
+  // Built once per thread, for the bursts of them under overload
+  struct RejectResponseTag {};
+  auto& response = folly::SingletonThreadLocal<
+    std::shared_ptr<const HTTPDirectResponse>, RejectResponseTag>::get();
+  if (!response) {
+    response = std::make_shared<const HTTPDirectResponse>(
+      503, "Service Unavailable");
+  }
+  auto handler = new HTTPDirectResponseHandler(response);
+  handler->forceConnectionClose(drain);
+  return handler;
+}
+
 void HTTPSessionBase::handleLastByteEvents(
   ByteEventTracker* byteEventTracker,
   HTTPTransaction* txn,
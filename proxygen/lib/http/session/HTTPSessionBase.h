@@ -10,15 +10,18 @@
 #pragma once
 
 #include <fizz/record/Types.h>
+#include <folly/dynamic.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/IOBuf.h>
 #include <wangle/acceptor/ManagedConnection.h>
 #include <wangle/acceptor/TransportInfo.h>
-#include <proxygen/lib/utils/Time.h>
+#include <proxygen/lib/utils/CoarseTime.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/http/session/SessionMemoryBudget.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 
 namespace proxygen {
+class HTTPAdmissionController;
 class HTTPSessionController;
 class HTTPSessionStats;
 class HTTPTransaction;
@@ -26,6 +29,73 @@ class ByteEventTracker;
 
 constexpr uint32_t kDefaultMaxConcurrentOutgoingStreams = 100;
 
+/**
+ * Approximate heap bytes held by a session, or summed over several, by
+ * what holds them.  Cheap enough to sample every second.
+ */
+struct HTTPSessionMemoryUsage {
+  // Connection and stream buffers, including the tailroom of their IOBufs
+  size_t readBuffer{0};
+  size_t writeBuffer{0};
+  // Header compression tables and other codec state
+  size_t codec{0};
+  // Egress priority queue nodes
+  size_t priorityQueue{0};
+  // Body transactions have received but not processed, and body they hold
+  // back from the transport
+  size_t transactionIngress{0};
+  size_t transactionEgress{0};
+  // Pending byte events
+  size_t byteEvents{0};
+
+  size_t total() const {
+    return readBuffer + writeBuffer + codec + priorityQueue +
+      transactionIngress + transactionEgress + byteEvents;
+  }
+
+  HTTPSessionMemoryUsage& operator+=(const HTTPSessionMemoryUsage& other) {
+    readBuffer += other.readBuffer;
+    writeBuffer += other.writeBuffer;
+    codec += other.codec;
+    priorityQueue += other.priorityQueue;
+    transactionIngress += other.transactionIngress;
+    transactionEgress += other.transactionEgress;
+    byteEvents += other.byteEvents;
+    return *this;
+  }
+};
+
+/**
+ * A structured view of what a session is doing, for diagnostics during
+ * incidents.  Taking one only reads the session's state: it logs nothing
+ * and costs about a copy of its streams, which getStateSnapshot() caps.
+ */
+struct HTTPSessionStateSnapshot {
+  CodecProtocol protocol{CodecProtocol::HTTP_1_1};
+  folly::SocketAddress localAddress;
+  folly::SocketAddress peerAddress;
+  bool draining{false};
+  // Since the session last became idle, 0 while it has streams
+  std::chrono::milliseconds idleTime{0};
+  std::chrono::microseconds rtt{0};
+  // The connection flow control windows, send available and receive
+  // capacity, 0 without connection flow control
+  uint32_t sendWindow{0};
+  uint32_t recvWindow{0};
+  // Egress handed to the transport and not written yet
+  uint64_t pendingWriteBytes{0};
+  // Streams with egress waiting in the priority queue
+  uint64_t egressQueueDepth{0};
+  // The header compression tables, HPACK or QPACK
+  CompressionInfo compression;
+  size_t numStreams{0};
+  // Up to the requested number of the streams
+  std::vector<HTTPTransaction::StateSnapshot> streams;
+
+  // For a diagnostics endpoint to serve as JSON
+  folly::dynamic toDynamic() const;
+};
+
 class HTTPPriorityMapFactoryProvider {
 public:
   virtual ~HTTPPriorityMapFactoryProvider() = default;
@@ -90,7 +160,7 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     const WheelTimerInstance& timeout,
     HTTPCodec::StreamID rootNodeId);
 
-  virtual ~HTTPSessionBase() {}
+  virtual ~HTTPSessionBase();
 
   /**
    * Set the read buffer limit to be used for all new HTTPSessionBase objects.
@@ -120,6 +190,26 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     kDefaultWriteBufLimit = max;
   }
 
+  /**
+   * Set the egress memory budget sessions created from now on share, see
+   * SessionMemoryBudget.  nullptr (the default) limits each session only by
+   * its write buffer limit.
+   */
+  static void setDefaultEgressMemoryBudget(
+      std::shared_ptr<SessionMemoryBudget> budget) {
+    defaultEgressMemoryBudget_ = std::move(budget);
+  }
+
+  /**
+   * Set the ingress memory budget sessions created from now on share.
+   * nullptr (the default) limits each session only by its read buffer
+   * limit.
+   */
+  static void setDefaultIngressMemoryBudget(
+      std::shared_ptr<SessionMemoryBudget> budget) {
+    defaultIngressMemoryBudget_ = std::move(budget);
+  }
+
   void setInfoCallback(InfoCallback* callback) {
     infoCallback_ = callback;
   }
@@ -132,6 +222,31 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     sessionStats_ = stats;
   }
 
+  /**
+   * Once the session has had no transactions for timeout, release the
+   * memory it can rebuild: header table storage, priority nodes and empty
+   * buffers.  The before and after sizes are reported to the session stats.
+   * 0 (the default) never hibernates.
+   */
+  void setHibernateTimeout(std::chrono::milliseconds timeout) {
+    hibernateTimeout_ = timeout;
+  }
+
+  /**
+   * Approximate heap bytes held by the session, see HTTPSessionMemoryUsage.
+   * Subclasses add their buffers, codec and byte events to what the base
+   * accounts for.
+   */
+  virtual HTTPSessionMemoryUsage getMemoryUsage() const;
+
+  /**
+   * Fills snapshot with the session's state and that of up to maxStreams
+   * of its streams.  Call it on the session's thread.  Subclasses add
+   * their codec and stream state to what the base knows.
+   */
+  virtual void getStateSnapshot(HTTPSessionStateSnapshot& snapshot,
+                                size_t maxStreams) const;
+
   virtual SessionType getType() const noexcept = 0;
 
   virtual folly::AsyncTransportWrapper* getTransport() = 0;
@@ -168,6 +283,29 @@ class HTTPSessionBase : public wangle::ManagedConnection {
 
   virtual uint32_t getMaxConcurrentOutgoingStreamsRemote() const = 0;
 
+  /**
+   * The bytes the session-level flow control lets the session send now,
+   * the maximum for sessions without session-level flow control.
+   */
+  virtual uint32_t getConnectionSendWindow() const {
+    return std::numeric_limits<uint32_t>::max();
+  }
+
+  /**
+   * The smoothed round trip time the session measured, or the one measured
+   * when the transport was set up until it has (0 if unknown).
+   */
+  virtual std::chrono::microseconds getRtt() const {
+    return transportInfo_.rtt;
+  }
+
+  /**
+   * The variation of the round trip time, as getRtt() (0 if unknown).
+   */
+  virtual std::chrono::microseconds getRttVar() const {
+    return std::chrono::microseconds(transportInfo_.rtt_var);
+  }
+
   uint32_t getMaxConcurrentOutgoingStreams() const {
     return std::min(maxConcurrentOutgoingStreamsConfig_,
                     getMaxConcurrentOutgoingStreamsRemote());
@@ -227,6 +365,45 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     return h2PrioritiesEnabled_;
   }
 
+  /**
+   * Schedule egress with RFC 9218 urgency buckets (RFC9218PriorityQueue)
+   * instead of the RFC 7540 dependency tree.  HTTP/2 priorities are mapped
+   * onto urgencies by weight.  Must be called before startNow().
+   */
+  void useRFC9218Priorities();
+
+  bool usingRFC9218Priorities() const {
+    return rfc9218Priorities_;
+  }
+
+  /**
+   * Memoize the HPACK encoding of up to size repeated header blocks on
+   * HTTP/2 codecs.  Lookups are recorded in HTTPSessionStats.  0 disables it.
+   */
+  void setHeaderEncodeCacheSize(size_t size) {
+    headerEncodeCacheSize_ = size;
+    initCodecHeaderEncodeCache();
+  }
+
+  /**
+   * Share the encoding of header blocks that only use the HPACK static table
+   * with the other HTTP/2 sessions of this thread.
+   */
+  void setUseStaticHeaderBlockCache(bool use) {
+    useStaticHeaderBlockCache_ = use;
+    initCodecHeaderEncodeCache();
+  }
+
+  /**
+   * Keep the Huffman encoding of the literals of received HTTP/2 header
+   * blocks with the messages (see HTTPMessage::getHuffmanLiterals), so a
+   * proxy forwarding the headers over HTTP/2 does not encode them again.
+   */
+  void setHeaderPassthrough(bool enabled) {
+    headerPassthrough_ = enabled;
+    initCodecHeaderEncodeCache();
+  }
+
   /**
    * Set the maximum number of outgoing transactions this session can open
    * at once. Note: you can only call function before startNow() is called
@@ -238,7 +415,8 @@ class HTTPSessionBase : public wangle::ManagedConnection {
   }
 
   /**
-   * Set the maximum number of transactions the remote can open at once.
+   * Set the maximum number of transactions the remote can open at once,
+   * also once the session started.
    */
   virtual void setMaxConcurrentIncomingStreams(uint32_t num) = 0;
 
@@ -255,10 +433,32 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     VLOG(4) << "write buffer limit: " << int(limit / 1000) << "KB";
   }
 
+  /**
+   * Get/Set the budget this session's egress buffers count against, in
+   * addition to its write buffer limit.
+   */
+  const std::shared_ptr<SessionMemoryBudget>& getEgressMemoryBudget() const {
+    return egressMemoryBudget_;
+  }
+
+  void setEgressMemoryBudget(std::shared_ptr<SessionMemoryBudget> budget);
+
   void setReadBufferLimit(uint32_t limit) {
     readBufLimit_ = limit;
   }
 
+  /**
+   * Get/Set the budget this session's ingress buffers count against, in
+   * addition to its read buffer limit.  While the budget is over its limit
+   * the session pauses reads above its share, and HTTP/2 shrinks its
+   * receive window to the share.
+   */
+  const std::shared_ptr<SessionMemoryBudget>& getIngressMemoryBudget() const {
+    return ingressMemoryBudget_;
+  }
+
+  void setIngressMemoryBudget(std::shared_ptr<SessionMemoryBudget> budget);
+
   /**
    * Start reading from the transport and send any introductory messages
    * to the remote side. This function must be called once per session to
@@ -317,6 +517,33 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     prioritySample_ = sampled;
   }
 
+  /**
+   * Records the HTTPTransaction::PhaseTimings of the transactions created
+   * from now on, and gives them as TraceEvents to observer, if set.
+   */
+  void setPhaseTimingsEnabled(bool enabled,
+                              TraceEventObserver* observer = nullptr) {
+    phaseTimingsEnabled_ = enabled;
+    phaseTimingsObserver_ = enabled ? observer : nullptr;
+  }
+
+  /**
+   * Accounts the thread CPU time of one in every rate transactions created
+   * from now on, see HTTPTransaction::setCpuTimeAccounting.  0 disables it.
+   */
+  void setCpuTimeSampleRate(uint32_t rate) {
+    cpuTimeSampleRate_ = rate;
+    cpuTimeSampleCount_ = 0;
+  }
+
+  /**
+   * Answers the new requests of a downstream session with a 503 when
+   * controller does not admit them, see HTTPAdmissionController.
+   */
+  void setAdmissionController(HTTPAdmissionController* controller) {
+    admissionController_ = controller;
+  }
+
   // public HTTPTransaction::Transport overrides
   const folly::SocketAddress& getLocalAddress()
     const noexcept /*override*/ {
@@ -479,11 +706,13 @@ class HTTPSessionBase : public wangle::ManagedConnection {
   bool notifyBodyProcessed(uint32_t bytes);
 
   void setLatestActive() {
-    latestActive_ = getCurrentTime();
+    latestActive_ = getCoarseTime(getEventBase());
   }
 
   bool ingressLimitExceeded() const {
-    return pendingReadSize_ > readBufLimit_;
+    return pendingReadSize_ > readBufLimit_ ||
+      (ingressMemoryBudget_ &&
+       ingressMemoryBudget_->isExceededBy(pendingReadSize_));
   }
   void onCreateTransaction() {
     if (transactionSeqNo_ >= 1) {
@@ -500,6 +729,26 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     return prioritySample_;
   }
 
+  bool isPhaseTimingsEnabled() const {
+    return phaseTimingsEnabled_;
+  }
+
+  TraceEventObserver* getPhaseTimingsObserver() const {
+    return phaseTimingsObserver_;
+  }
+
+  // Whether the next transaction is in the CPU time sample
+  bool sampleCpuTime() {
+    if (cpuTimeSampleRate_ == 0) {
+      return false;
+    }
+    if (++cpuTimeSampleCount_ < cpuTimeSampleRate_) {
+      return false;
+    }
+    cpuTimeSampleCount_ = 0;
+    return true;
+  }
+
   void onNewOutgoingStream(uint32_t outgoingStreams) {
     if (outgoingStreams > historicalMaxOutgoingStreams_) {
       historicalMaxOutgoingStreams_ = outgoingStreams;
@@ -535,20 +784,35 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   void initCodecHeaderIndexingStrategy();
 
+  /**
+   * Applies headerEncodeCacheSize_, useStaticHeaderBlockCache_ and
+   * headerPassthrough_ to the underlying codec, if H2.
+   */
+  void initCodecHeaderEncodeCache();
+
   /**
    * Attaches Session to RevproxyController instance if it's set
    */
   void attachToSessionController();
 
+  /**
+   * Returns a handler answering a new request with a 503 if the admission
+   * controller does not admit it, starting to drain if asked to, or else
+   * nullptr.
+   */
+  HTTPTransaction::Handler* getAdmissionRejectHandler();
+
   HTTPSessionStats* sessionStats_{nullptr};
 
+  std::chrono::milliseconds hibernateTimeout_{0};
+
   InfoCallback* infoCallback_{nullptr};  // maybe can move to protected
 
   wangle::TransportInfo transportInfo_;
 
   HTTPCodecFilterChain codec_;
 
-  HTTP2PriorityQueue txnEgressQueue_;
+  std::unique_ptr<HTTPEgressPriorityQueue> txnEgressQueue_;
 
   /**
    * Maximum number of ingress body bytes that can be buffered across all
@@ -572,6 +836,9 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   static uint32_t egressBodySizeLimit_;
 
+  static std::shared_ptr<SessionMemoryBudget> defaultEgressMemoryBudget_;
+  static std::shared_ptr<SessionMemoryBudget> defaultIngressMemoryBudget_;
+
   /** Address of this end of the connection */
   folly::SocketAddress localAddr_;
 
@@ -598,7 +865,9 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   bool egressLimitExceeded() const {
     // Changed to >
-    return pendingWriteSize_ > writeBufLimit_;
+    return pendingWriteSize_ > writeBufLimit_ ||
+      (egressMemoryBudget_ &&
+       egressMemoryBudget_->isExceededBy(pendingWriteSize_));
   }
 
   /**
@@ -654,16 +923,37 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   int64_t pendingWriteSizeDelta_{0};
 
+  std::shared_ptr<SessionMemoryBudget> egressMemoryBudget_;
+
   /**
    * Bytes of ingress data read from the socket, but not yet sent to a
    * transaction.
    */
   uint32_t pendingReadSize_{0};
 
+  std::shared_ptr<SessionMemoryBudget> ingressMemoryBudget_;
+
+  size_t headerEncodeCacheSize_{0};
+  bool useStaticHeaderBlockCache_{false};
+  bool headerPassthrough_{false};
+
+  bool phaseTimingsEnabled_{false};
+  TraceEventObserver* phaseTimingsObserver_{nullptr};
+  uint32_t cpuTimeSampleRate_{0};
+  uint32_t cpuTimeSampleCount_{0};
+
+  HTTPAdmissionController* admissionController_{nullptr};
+
   bool prioritySample_:1;
   bool h2PrioritiesEnabled_:1;
+  bool rfc9218Priorities_:1;
   bool inResume_:1;
   bool pendingPause_:1;
+  // egressLimitExceeded() as of the last updateWriteBufSize().  Other
+  // sessions move the budget in between.
+  bool egressLimitWasExceeded_:1;
+  // Likewise for ingressLimitExceeded()
+  bool ingressLimitWasExceeded_:1;
 
   /**
    * Indicates whether Ex Headers is supported in HTTPSession
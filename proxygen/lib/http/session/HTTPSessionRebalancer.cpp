@@ -0,0 +1,188 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HTTPSessionRebalancer.h>
+
+#include <algorithm>
+#include <folly/String.h>
+#include <folly/io/async/EventBase.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/session/HTTPSessionAcceptor.h>
+#include <pthread.h>
+
+namespace proxygen {
+
+namespace {
+// The transaction timeout of the sessions dropped for want of an acceptor
+const std::chrono::milliseconds kOrphanTimeout{1000};
+
+bool getCpuTime(clockid_t clockId, std::chrono::nanoseconds& cpuTime) {
+  struct timespec ts;
+  if (clock_gettime(clockId, &ts) != 0) {
+    return false;
+  }
+  cpuTime = std::chrono::seconds(ts.tv_sec) +
+    std::chrono::nanoseconds(ts.tv_nsec);
+  return true;
+}
+}
+
+bool HTTPSessionRebalancer::State::isRegistered(
+    HTTPSessionAcceptor* acceptor) const {
+  return std::any_of(workers.begin(), workers.end(),
+                     [acceptor] (const Worker& worker) {
+                       return worker.acceptor == acceptor;
+                     });
+}
+
+HTTPSessionRebalancer::HTTPSessionRebalancer(const Options& options)
+    : options_(options),
+      state_(std::make_shared<State>()) {
+}
+
+HTTPSessionRebalancer::~HTTPSessionRebalancer() {
+  stop();
+}
+
+void HTTPSessionRebalancer::start() {
+  if (scheduler_) {
+    return;
+  }
+  scheduler_.reset(new folly::FunctionScheduler());
+  scheduler_->setThreadName("rebalancer");
+  scheduler_->addFunction([this] { rebalance(); }, options_.interval,
+                          "rebalance");
+  scheduler_->start();
+}
+
+void HTTPSessionRebalancer::stop() {
+  scheduler_.reset();
+}
+
+void HTTPSessionRebalancer::addAcceptor(HTTPSessionAcceptor* acceptor) {
+  auto eventBase = acceptor->getEventBase();
+  CHECK(eventBase);
+  clockid_t clockId;
+  int err = 0;
+  eventBase->runImmediatelyOrRunInEventBaseThreadAndWait([&] {
+      err = pthread_getcpuclockid(pthread_self(), &clockId);
+    });
+  if (err != 0) {
+    LOG(WARNING) << "Not rebalancing a worker without CPU clock: "
+                 << folly::errnoStr(err);
+    return;
+  }
+
+  Worker worker{acceptor, eventBase, clockId};
+  getCpuTime(clockId, worker.lastCpuTime);
+  worker.lastSampleTime = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> guard(state_->mutex);
+  state_->workers.push_back(worker);
+}
+
+void HTTPSessionRebalancer::removeAcceptor(HTTPSessionAcceptor* acceptor) {
+  std::lock_guard<std::mutex> guard(state_->mutex);
+  auto& workers = state_->workers;
+  workers.erase(std::remove_if(workers.begin(), workers.end(),
+                               [acceptor] (const Worker& worker) {
+                                 return worker.acceptor == acceptor;
+                               }),
+                workers.end());
+}
+
+uint64_t HTTPSessionRebalancer::getNumSessionsMoved() const {
+  return state_->numSessionsMoved;
+}
+
+void HTTPSessionRebalancer::rebalance() {
+  std::lock_guard<std::mutex> guard(state_->mutex);
+  auto now = std::chrono::steady_clock::now();
+  Worker* hot = nullptr;
+  Worker* cold = nullptr;
+  for (auto& worker : state_->workers) {
+    std::chrono::nanoseconds cpuTime;
+    if (!getCpuTime(worker.cpuClockId, cpuTime)) {
+      continue;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - worker.lastSampleTime);
+    if (elapsed.count() > 0) {
+      worker.utilization = std::min(
+        1.0, double((cpuTime - worker.lastCpuTime).count()) / elapsed.count());
+    }
+    worker.lastCpuTime = cpuTime;
+    worker.lastSampleTime = now;
+    if (!hot || worker.utilization > hot->utilization) {
+      hot = &worker;
+    }
+    if (!cold || worker.utilization < cold->utilization) {
+      cold = &worker;
+    }
+  }
+  if (!hot || hot == cold || hot->utilization < options_.hotUtilization ||
+      hot->utilization - cold->utilization < options_.minImbalance) {
+    return;
+  }
+
+  VLOG(4) << "Moving sessions from a worker at " << hot->utilization
+          << " to one at " << cold->utilization;
+  auto state = state_;
+  auto from = hot->acceptor;
+  auto to = cold->acceptor;
+  auto maxSessions = options_.maxSessionsPerInterval;
+  hot->eventBase->runInEventBaseThread([state, from, to, maxSessions] {
+      releaseSessions(state, from, to, maxSessions);
+    });
+}
+
+void HTTPSessionRebalancer::releaseSessions(std::shared_ptr<State> state,
+                                            HTTPSessionAcceptor* from,
+                                            HTTPSessionAcceptor* to,
+                                            size_t maxSessions) {
+  std::lock_guard<std::mutex> guard(state->mutex);
+  if (!state->isRegistered(from)) {
+    return;
+  }
+  auto sessions = from->releaseIdleSessions(maxSessions);
+  if (sessions.empty()) {
+    return;
+  }
+  if (!state->isRegistered(to)) {
+    // The least busy worker stopped meanwhile
+    for (auto session : sessions) {
+      from->adoptSession(session);
+    }
+    return;
+  }
+
+  auto eventBase = to->getEventBase();
+  eventBase->runInEventBaseThread([state, to, eventBase, sessions] {
+      std::lock_guard<std::mutex> guard(state->mutex);
+      if (state->isRegistered(to)) {
+        for (auto session : sessions) {
+          to->adoptSession(session);
+        }
+        state->numSessionsMoved += sessions.size();
+        return;
+      }
+      // The acceptor stopped while the sessions were in flight, and its
+      // event base is being destroyed
+      for (auto session : sessions) {
+        session->attachThreadLocals(eventBase, nullptr,
+                                    WheelTimerInstance(kOrphanTimeout,
+                                                       eventBase),
+                                    nullptr, [] (HTTPCodecFilter*) {},
+                                    nullptr, nullptr);
+        session->setInfoCallback(nullptr);
+        session->dropConnection();
+      }
+    });
+}
+
+}
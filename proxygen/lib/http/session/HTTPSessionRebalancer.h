@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <folly/experimental/FunctionScheduler.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace folly {
+class EventBase;
+}
+
+namespace proxygen {
+
+class HTTPSessionAcceptor;
+
+/**
+ * Moves idle downstream sessions from the busiest worker thread to the
+ * least busy one.  Long lived connections otherwise stay on the worker
+ * which accepted them, and a few workers can end up serving most of the
+ * traffic while the others are idle.
+ *
+ * The utilization of a worker is the CPU time of its thread over the last
+ * interval.  Only sessions without transactions and with nothing to write
+ * (HTTPSession::isDetachable()) are moved, their next requests are served
+ * by the new worker.
+ *
+ * The acceptors register themselves, see
+ * HTTPSessionAcceptor::setSessionRebalancer().
+ */
+class HTTPSessionRebalancer {
+ public:
+  struct Options {
+    // How often to sample the workers and move sessions
+    std::chrono::milliseconds interval{1000};
+    // The utilization (0-1.0) of the busiest worker to start moving at
+    double hotUtilization{0.8};
+    // The minimum utilization gap between the busiest and least busy workers
+    double minImbalance{0.3};
+    // The maximum sessions moved per interval
+    size_t maxSessionsPerInterval{32};
+  };
+
+  explicit HTTPSessionRebalancer(const Options& options);
+  ~HTTPSessionRebalancer();
+
+  /**
+   * Starts rebalancing every interval in a background thread.
+   */
+  void start();
+
+  /**
+   * Stops the background thread, the sessions being moved still reach
+   * their new worker.
+   */
+  void stop();
+
+  /**
+   * Samples the workers and moves sessions once, from any thread.
+   */
+  void rebalance();
+
+  /**
+   * Registers an acceptor, must be called once its event base is set.
+   */
+  void addAcceptor(HTTPSessionAcceptor* acceptor);
+
+  /**
+   * Unregisters an acceptor, before it is destroyed.
+   */
+  void removeAcceptor(HTTPSessionAcceptor* acceptor);
+
+  uint64_t getNumSessionsMoved() const;
+
+ private:
+  struct Worker {
+    HTTPSessionAcceptor* acceptor;
+    folly::EventBase* eventBase;
+    clockid_t cpuClockId;
+    std::chrono::nanoseconds lastCpuTime{0};
+    std::chrono::steady_clock::time_point lastSampleTime;
+    double utilization{0};
+  };
+
+  // Shared with the moves in flight, which may outlive the rebalancer
+  struct State {
+    // Held while posting to a worker's event base and while using its
+    // acceptor, the acceptors unregister before they and their event base
+    // are destroyed
+    std::mutex mutex;
+    std::vector<Worker> workers;
+    std::atomic<uint64_t> numSessionsMoved{0};
+
+    bool isRegistered(HTTPSessionAcceptor* acceptor) const;
+  };
+
+  // Runs on the busy worker's thread
+  static void releaseSessions(std::shared_ptr<State> state,
+                              HTTPSessionAcceptor* from,
+                              HTTPSessionAcceptor* to,
+                              size_t maxSessions);
+
+  const Options options_;
+  std::shared_ptr<State> state_;
+  std::unique_ptr<folly::FunctionScheduler> scheduler_;
+};
+
+}
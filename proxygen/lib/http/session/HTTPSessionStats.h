@@ -27,6 +27,33 @@ class HTTPSessionStats : public TTLBAStats {
   virtual void recordSessionIdleTime(std::chrono::seconds) noexcept {}
   virtual void recordTransactionStalled() noexcept = 0;
   virtual void recordSessionStalled() noexcept = 0;
+  virtual void recordHeaderEncodeCacheHit() noexcept {}
+  virtual void recordHeaderEncodeCacheMiss() noexcept {}
+  // Approximate memory held by an idle session before and after hibernating
+  virtual void recordSessionHibernated(size_t /*bytesBefore*/,
+                                       size_t /*bytesAfter*/) noexcept {}
+  // Buffers in the thread's read buffer pool, after each take or give back
+  virtual void recordReadBufferPoolOccupancy(size_t /*buffers*/) noexcept {}
+  // Latencies of downstream transactions, from the start of their request:
+  // until its headers are parsed, until the first and last bytes of the
+  // response are written to the transport, and until the transaction is
+  // done with
+  virtual void recordHeaderParseTime(std::chrono::microseconds) noexcept {}
+  virtual void recordTimeToFirstByte(std::chrono::microseconds) noexcept {}
+  virtual void recordTimeToLastByte(std::chrono::microseconds) noexcept {}
+  virtual void recordRequestDuration(std::chrono::microseconds) noexcept {}
+  // QPACK: the encoder's budget of blocks with vulnerable references as it
+  // adapts to losses, and per session at its end the blocks encoded with
+  // vulnerable references and the blocks the decoder queued, with the time
+  // they waited
+  virtual void recordQPACKVulnerableBudget(uint32_t /*budget*/) noexcept {}
+  virtual void recordQPACKBlocking(
+      uint64_t /*vulnerableBlocks*/,
+      uint64_t /*blockedBlocks*/,
+      std::chrono::microseconds /*blockedTime*/) noexcept {}
+  // Bytes a spliced CONNECT tunnel relayed each way, once closed
+  virtual void recordSplicedTunnel(uint64_t /*bytesUpstream*/,
+                                   uint64_t /*bytesDownstream*/) noexcept {}
 };
 
 }
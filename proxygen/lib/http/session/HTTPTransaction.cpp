@@ -11,12 +11,19 @@
 
 #include <algorithm>
 #include <folly/Conv.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/Fcntl.h>
 #include <folly/tracing/ScopedTraceSection.h>
+#include <folly/tracing/StaticTracepoint.h>
 #include <glog/logging.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/http/session/EgressRateLimiter.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/utils/CoarseTime.h>
+#include <proxygen/lib/utils/TraceEventObserver.h>
 
 using folly::IOBuf;
 using std::unique_ptr;
@@ -26,6 +33,13 @@ namespace proxygen {
 namespace {
   const int64_t kApproximateMTU = 1400;
   const std::chrono::seconds kRateLimitMaxDelay(10);
+
+  // Records when a phase is first reached
+  void markPhase(TimePoint& phase) {
+    if (phase == TimePoint()) {
+      phase = getCoarseTime();
+    }
+  }
 }
 
 HTTPTransaction::HTTPTransaction(TransportDirection direction,
@@ -97,6 +111,7 @@ HTTPTransaction::HTTPTransaction(TransportDirection direction,
   refreshTimeout();
   if (stats_) {
     stats_->recordTransactionOpened();
+    startTime_ = getCurrentTime();
   }
 
   queueHandle_ = egressQueue_.addTransaction(id_, priority, this, false,
@@ -121,7 +136,15 @@ void HTTPTransaction::onDelayedDestroy(bool delayed) {
     handler_ = nullptr;
   }
   transportCallback_ = nullptr;
-  const auto bytesBuffered = recvWindow_.getOutstanding();
+  if (phaseTimingsObserver_) {
+    tracePhaseTimings();
+  }
+  if (stats_ && isDownstream()) {
+    stats_->recordRequestDuration(
+      microsecondsBetween(getCurrentTime(), startTime_));
+  }
+  const auto bytesBuffered =
+    recvWindow_.getOutstanding() + heldIngressBody_.chainLength();
   if (bytesBuffered) {
     transport_.notifyIngressBodyProcessed(bytesBuffered);
   }
@@ -130,6 +153,8 @@ void HTTPTransaction::onDelayedDestroy(bool delayed) {
 }
 
 HTTPTransaction::~HTTPTransaction() {
+  // Before egressRateLimiter_ may go away with it
+  rateLimiterHook_.unlink();
   // Cancel transaction timeout if still scheduled.
   if (isScheduled()) {
     cancelTimeout();
@@ -159,6 +184,7 @@ void HTTPTransaction::reset(bool useFlowControl,
 void HTTPTransaction::onIngressHeadersComplete(
   std::unique_ptr<HTTPMessage> msg) {
   DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
   msg->setSeqNo(seqNo_);
   if (isUpstream() && !isPushed() && msg->isResponse()) {
     lastResponseStatus_ = msg->getStatusCode();
@@ -167,8 +193,15 @@ void HTTPTransaction::onIngressHeadersComplete(
           HTTPTransactionIngressSM::Event::onHeaders)) {
     return;
   }
+  if (phaseTimings_) {
+    markPhase(phaseTimings_->headersComplete);
+  }
   if (msg->isRequest()) {
     headRequest_ = (msg->getMethod() == HTTPMethod::HEAD);
+    if (stats_ && isDownstream()) {
+      stats_->recordHeaderParseTime(
+        microsecondsBetween(getCurrentTime(), startTime_));
+    }
   }
 
   if ((msg->isRequest() && msg->getMethod() != HTTPMethod::CONNECT) ||
@@ -244,6 +277,7 @@ bool HTTPTransaction::updateContentLengthRemaining(size_t len) {
 void HTTPTransaction::onIngressBody(unique_ptr<IOBuf> chain, uint16_t padding) {
   FOLLY_SCOPED_TRACE_SECTION("HTTPTransaction - onIngressBody");
   DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
   if (isIngressEOMSeen()) {
     sendAbort(ErrorCode::STREAM_CLOSED);
     return;
@@ -295,6 +329,32 @@ void HTTPTransaction::processIngressBody(unique_ptr<IOBuf> chain, size_t len) {
     return;
   }
   refreshTimeout();
+  if (ingressBodyCoalesceThreshold_ > 0) {
+    heldIngressBody_.append(std::move(chain));
+    if (heldIngressBody_.chainLength() >= ingressBodyCoalesceThreshold_) {
+      flushIngressBody();
+    }
+    return;
+  }
+  deliverIngressBody(std::move(chain), len);
+}
+
+void HTTPTransaction::flushIngressBody() {
+  if (heldIngressBody_.empty() || (ingressPaused_ && !aborted_)) {
+    return;
+  }
+  auto len = heldIngressBody_.chainLength();
+  auto chain = heldIngressBody_.move();
+  if (aborted_) {
+    transport_.notifyIngressBodyProcessed(len);
+    return;
+  }
+  deliverIngressBody(std::move(chain), len);
+}
+
+void HTTPTransaction::deliverIngressBody(unique_ptr<IOBuf> chain,
+                                         size_t len) {
+  DestructorGuard g(this);
   transport_.notifyIngressBodyProcessed(len);
   auto chainLen = chain->computeChainDataLength();
   if (handler_) {
@@ -325,6 +385,9 @@ void HTTPTransaction::onIngressChunkHeader(size_t length) {
         HTTPTransactionIngressSM::Event::onChunkHeader)) {
     return;
   }
+  DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
+  flushIngressBody();
   if (mustQueueIngress()) {
     checkCreateDeferredIngress();
     deferredIngress_->emplace(id_, HTTPEvent::Type::CHUNK_HEADER, length);
@@ -351,6 +414,9 @@ void HTTPTransaction::onIngressChunkComplete() {
         HTTPTransactionIngressSM::Event::onChunkComplete)) {
     return;
   }
+  DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
+  flushIngressBody();
   if (mustQueueIngress()) {
     checkCreateDeferredIngress();
     deferredIngress_->emplace(id_, HTTPEvent::Type::CHUNK_COMPLETE);
@@ -377,6 +443,9 @@ void HTTPTransaction::onIngressTrailers(unique_ptr<HTTPHeaders> trailers) {
         HTTPTransactionIngressSM::Event::onTrailers)) {
     return;
   }
+  DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
+  flushIngressBody();
   if (mustQueueIngress()) {
     checkCreateDeferredIngress();
     deferredIngress_->emplace(id_, HTTPEvent::Type::TRAILERS_COMPLETE,
@@ -404,6 +473,9 @@ void HTTPTransaction::onIngressUpgrade(UpgradeProtocol protocol) {
         HTTPTransactionIngressSM::Event::onUpgrade)) {
     return;
   }
+  DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
+  flushIngressBody();
   if (mustQueueIngress()) {
     checkCreateDeferredIngress();
     deferredIngress_->emplace(id_, HTTPEvent::Type::UPGRADE, protocol);
@@ -458,6 +530,9 @@ void HTTPTransaction::onIngressEOM() {
   // expecting any more ingress, and the timer should be cancelled
   // immediately.  If we are expecting more, this will reset the timer.
   updateReadTimeout();
+  DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
+  flushIngressBody();
   if (mustQueueIngress()) {
     checkCreateDeferredIngress();
     deferredIngress_->emplace(id_, HTTPEvent::Type::MESSAGE_COMPLETE);
@@ -481,6 +556,9 @@ void HTTPTransaction::processIngressEOM() {
   }
   if (handler_) {
     if (!wasComplete) {
+      if (phaseTimings_) {
+        markPhase(phaseTimings_->ingressEOM);
+      }
       handler_->onEOM();
     }
   } else {
@@ -521,6 +599,8 @@ void HTTPTransaction::markEgressComplete() {
     transport_.notifyEgressBodyBuffered(-deferredEgressBodyBytes);
   }
   deferredEgressBody_.move();
+  deferredFileBody_.clear();
+  bodyProducer_ = nullptr;
   if (isEnqueued()) {
     dequeue();
   }
@@ -548,6 +628,7 @@ bool HTTPTransaction::validateIngressStateTransition(
 
 void HTTPTransaction::onError(const HTTPException& error) {
   DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
 
   const bool wasAborted = aborted_; // see comment below
   const bool wasEgressComplete = isEgressComplete();
@@ -638,6 +719,7 @@ void HTTPTransaction::onGoaway(ErrorCode code) {
 void HTTPTransaction::onIngressTimeout() {
   DestructorGuard g(this);
   VLOG(4) << "ingress timeout on " << *this;
+  FOLLY_SDT(proxygen, txn_ingress_timeout, id_);
   pauseIngress();
   bool windowUpdateTimeout = !isEgressComplete() && isExpectingWindowUpdate();
   if (handler_) {
@@ -697,6 +779,7 @@ void HTTPTransaction::onIngressSetSendWindow(const uint32_t newWindowSize) {
 void HTTPTransaction::onEgressTimeout() {
   DestructorGuard g(this);
   VLOG(4) << "egress timeout on " << *this;
+  FOLLY_SDT(proxygen, txn_egress_timeout, id_);
   if (handler_) {
     HTTPException ex(HTTPException::Direction::EGRESS,
       folly::to<std::string>("egress timeout, streamID=", id_));
@@ -709,6 +792,13 @@ void HTTPTransaction::onEgressTimeout() {
 
 void HTTPTransaction::onEgressHeaderFirstByte() {
   DestructorGuard g(this);
+  if (phaseTimings_) {
+    markPhase(phaseTimings_->firstByteWritten);
+  }
+  if (stats_ && isDownstream()) {
+    stats_->recordTimeToFirstByte(
+      microsecondsBetween(getCurrentTime(), startTime_));
+  }
   if (transportCallback_) {
     transportCallback_->firstHeaderByteFlushed();
   }
@@ -728,6 +818,14 @@ void HTTPTransaction::onEgressBodyFirstByte(
 void HTTPTransaction::onEgressBodyLastByte(
     const folly::Optional<uint64_t>& maybeByteOffset) {
   DestructorGuard g(this);
+  // Without an offset, this is the EOM being generated rather than written
+  if (stats_ && isDownstream() && maybeByteOffset) {
+    stats_->recordTimeToLastByte(
+      microsecondsBetween(getCurrentTime(), startTime_));
+  }
+  if (phaseTimings_ && maybeByteOffset) {
+    markPhase(phaseTimings_->lastByteWritten);
+  }
   if (transportCallback_) {
     if (maybeByteOffset) {
       transportCallback_->lastByteOffset(*maybeByteOffset);
@@ -759,6 +857,9 @@ void HTTPTransaction::onEgressTrackedByte() {
 
 void HTTPTransaction::onEgressLastByteAck(std::chrono::milliseconds latency) {
   DestructorGuard g(this);
+  if (phaseTimings_) {
+    markPhase(phaseTimings_->lastByteAcked);
+  }
   if (transportCallback_) {
     transportCallback_->lastByteAcked(latency);
   }
@@ -814,6 +915,8 @@ void HTTPTransaction::onIngressBodyRejected(uint64_t nextBodyOffset) {
 void HTTPTransaction::sendHeadersWithOptionalEOM(
     const HTTPMessage& headers,
     bool eom) {
+  DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
   CHECK(HTTPTransactionEgressSM::transit(
           egressState_, HTTPTransactionEgressSM::Event::sendHeaders));
   DCHECK(!isEgressComplete());
@@ -824,7 +927,7 @@ void HTTPTransaction::sendHeadersWithOptionalEOM(
     headRequest_ = (headers.getMethod() == HTTPMethod::HEAD);
   }
 
-  if (headers.isResponse() && !headRequest_) {
+  if (headers.isResponse() && !headers.is1xxResponse() && !headRequest_) {
     const auto& contentLen =
       headers.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH);
     if (!contentLen.empty()) {
@@ -867,14 +970,20 @@ void HTTPTransaction::sendHeaders(const HTTPMessage& header) {
 
 void HTTPTransaction::sendBody(std::unique_ptr<folly::IOBuf> body) {
   DestructorGuard guard(this);
+  CpuTimeScope cpuTime(*this);
   bool chunking =
     ((egressState_ == HTTPTransactionEgressSM::State::ChunkHeaderSent) &&
      !transport_.getCodec().supportsParallelRequests());  // see sendChunkHeader
 
   CHECK(HTTPTransactionEgressSM::transit(
       egressState_, HTTPTransactionEgressSM::Event::sendBody));
+  if (phaseTimings_) {
+    markPhase(phaseTimings_->firstSendBody);
+  }
 
+  CHECK(!bodyProducer_) << "sendBody() with a body producer";
   if (body) {
+    CHECK(!deferredFileBody_) << "sendBody() before the file body was sent";
     size_t bodyLen = body->computeChainDataLength();
     actualResponseLength_ = actualResponseLength_.value() + bodyLen;
 
@@ -894,27 +1003,119 @@ void HTTPTransaction::sendBody(std::unique_ptr<folly::IOBuf> body) {
   notifyTransportPendingEgress();
 }
 
+bool HTTPTransaction::spliceTunnel(folly::AsyncSocket& upstream) {
+  if (!isDownstream() || lastResponseStatus_ < 200 ||
+      lastResponseStatus_ >= 300 || isEgressEOMQueued() || hasPendingBody()) {
+    return false;
+  }
+  return transport_.spliceTunnel(this, upstream);
+}
+
+void HTTPTransaction::sendFileBody(std::shared_ptr<folly::File> file,
+                                   off_t offset,
+                                   size_t length) {
+  DestructorGuard guard(this);
+  CHECK(!deferredFileBody_) << "sendFileBody() before the last file was sent";
+  CHECK(chunkHeaders_.empty() && !partiallyReliable_);
+  CHECK(HTTPTransactionEgressSM::transit(
+      egressState_, HTTPTransactionEgressSM::Event::sendBody));
+  if (phaseTimings_) {
+    markPhase(phaseTimings_->firstSendBody);
+  }
+
+  if (length > 0) {
+    actualResponseLength_ = actualResponseLength_.value() + length;
+    // not buffered, so not reported through notifyEgressBodyBuffered
+    deferredFileBody_ = FileBody{std::move(file), offset, length};
+  }
+  notifyTransportPendingEgress();
+}
+
 bool HTTPTransaction::onWriteReady(const uint32_t maxEgress, double ratio) {
   DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
   DCHECK(isEnqueued());
   if (prioritySample_) {
     updateRelativeWeight(ratio);
   }
   cumulativeRatio_ += ratio;
   egressCalls_++;
+  if (isBodyProducerReady() && getDeferredEgressBodyLength() == 0) {
+    pullProducerBody(maxEgress);
+    if (getDeferredEgressBodyLength() == 0 && !isEgressEOMQueued()) {
+      // Nothing was ready, the producer will resume
+      return isEnqueued();
+    }
+  }
   sendDeferredBody(maxEgress);
   return isEnqueued();
 }
 
+void HTTPTransaction::pullProducerBody(uint32_t maxEgress) {
+  const int32_t windowAvailable = sendWindow_.getSize();
+  const uint32_t maxBytes = useFlowControl_ ? std::min<uint32_t>(
+    maxEgress, windowAvailable > 0 ? windowAvailable : 0) : maxEgress;
+  bool eom = false;
+  auto body = bodyProducer_->produceBody(maxBytes, eom);
+  size_t bodyLen = body ? body->computeChainDataLength() : 0;
+  DCHECK_LE(bodyLen, maxBytes);
+  if (bodyLen > 0) {
+    CHECK(HTTPTransactionEgressSM::transit(
+        egressState_, HTTPTransactionEgressSM::Event::sendBody));
+    actualResponseLength_ = actualResponseLength_.value() + bodyLen;
+    deferredEgressBody_.append(std::move(body));
+    // Taken back as it is sent
+    transport_.notifyEgressBodyBuffered(bodyLen);
+  }
+  if (eom) {
+    bodyProducer_ = nullptr;
+    // Queued behind the body, for sendDeferredBody()
+    sendEOM();
+  } else if (bodyLen == 0) {
+    bodyProducerReady_ = false;
+    notifyTransportPendingEgress();
+  }
+}
+
+void HTTPTransaction::coalesceChunks(size_t maxLength) {
+  // Only the front chunk may have been started, and its body comes first in
+  // deferredEgressBody_, so merged chunks stay in order
+  auto& front = chunkHeaders_.front();
+  auto next = std::next(chunkHeaders_.begin());
+  while (next != chunkHeaders_.end() &&
+         front.length + next->length <= maxLength) {
+    front.length += next->length;
+    next = chunkHeaders_.erase(next);
+  }
+}
+
+void HTTPTransaction::getStateSnapshot(StateSnapshot& snapshot) const {
+  snapshot.id = id_;
+  snapshot.ingressState = ingressState_;
+  snapshot.egressState = egressState_;
+  if (useFlowControl_) {
+    snapshot.sendWindow = sendWindow_.getSize();
+    snapshot.recvWindow = recvWindow_.getSize();
+  }
+  snapshot.egressBuffered = getDeferredEgressBodyLength();
+  snapshot.ingressPaused = ingressPaused_;
+  snapshot.egressPaused = handlerEgressPaused_;
+  snapshot.priority = priority_;
+  if (queueHandle_) {
+    snapshot.enqueued = queueHandle_->isEnqueued();
+    snapshot.queueDepth = queueHandle_->calculateDepth(false);
+  }
+}
+
 // Send up to maxEgress body bytes, including pendingEOM if appropriate
 size_t HTTPTransaction::sendDeferredBody(const uint32_t maxEgress) {
   const int32_t windowAvailable = sendWindow_.getSize();
-  const uint32_t sendWindow = useFlowControl_ ? std::min<uint32_t>(
+  uint32_t sendWindow = useFlowControl_ ? std::min<uint32_t>(
     maxEgress, windowAvailable > 0 ? windowAvailable : 0) : maxEgress;
 
   // We shouldn't be called if we have no pending body/EOM, egress is paused, or
   // the send window is closed
-  CHECK((deferredEgressBody_.chainLength() > 0 ||
+  CHECK((getDeferredEgressBodyLength() > 0 ||
          isEgressEOMQueued()) &&
         sendWindow > 0);
 
@@ -927,11 +1128,29 @@ size_t HTTPTransaction::sendDeferredBody(const uint32_t maxEgress) {
     return 0;
   }
 
+  if (egressRateLimiter_ && (bytesLeft > 0 || deferredFileBody_)) {
+    uint64_t allowed = checkEgressRateLimiter();
+    if (allowed == 0) {
+      // The limiter will call notifyTransportPendingEgress again
+      return 0;
+    }
+    sendWindow = std::min<uint64_t>(sendWindow, allowed);
+  }
+
   size_t curLen = 0;
   size_t nbytes = 0;
   bool willSendEOM = false;
 
-  if (chunkHeaders_.empty()) {
+  if (bytesLeft == 0 && deferredFileBody_) {
+    // the buffered body was all sent, continue with the file
+    curLen = std::min<size_t>(sendWindow, deferredFileBody_->length);
+    willSendEOM = curLen == deferredFileBody_->length && isEgressEOMQueued();
+    if (willSendEOM) {
+      dequeue();
+    }
+    nbytes = sendFileBodyNow(curLen, willSendEOM);
+    willSendEOM = false;
+  } else if (chunkHeaders_.empty()) {
     curLen = canSend;
     std::unique_ptr<IOBuf> body = deferredEgressBody_.split(curLen);
     willSendEOM = hasPendingEOM();
@@ -950,6 +1169,9 @@ size_t HTTPTransaction::sendDeferredBody(const uint32_t maxEgress) {
         << __func__ << ": chunking not supported in partially reliable mode.";
     while (!chunkHeaders_.empty() && canSend > 0) {
       Chunk& chunk = chunkHeaders_.front();
+      if (!chunk.headerSent && maxCoalescedChunk_ > 0) {
+        coalesceChunks(std::min<size_t>(canSend, maxCoalescedChunk_));
+      }
       if (!chunk.headerSent) {
         nbytes += transport_.sendChunkHeader(this, chunk.length);
         chunk.headerSent = true;
@@ -1035,6 +1257,30 @@ bool HTTPTransaction::maybeDelayForRateLimit() {
 }
 
 void HTTPTransaction::rateLimitTimeoutExpired() {
+  if (rateLimiterHook_.is_linked()) {
+    // Still waiting for the limiter's tokens
+    return;
+  }
+  egressRateLimited_ = false;
+  notifyTransportPendingEgress();
+}
+
+uint64_t HTTPTransaction::checkEgressRateLimiter() {
+  uint64_t allowed = egressRateLimiter_->getAvailable();
+  if (allowed > 0) {
+    return allowed;
+  }
+  egressRateLimited_ = true;
+  egressRateLimiter_->wait(*this);
+  notifyTransportPendingEgress();
+  return 0;
+}
+
+void HTTPTransaction::onEgressRateLimiterReady() {
+  if (rateLimitCallback_.isScheduled()) {
+    // Still delayed by setEgressRateLimit()
+    return;
+  }
   egressRateLimited_ = false;
   notifyTransportPendingEgress();
 }
@@ -1050,10 +1296,50 @@ size_t HTTPTransaction::sendEOMNow() {
   return nbytes;
 }
 
+size_t HTTPTransaction::sendFileBodyNow(size_t bodyLen, bool sendEom) {
+  DCHECK(deferredFileBody_);
+  FileBody fileBody{deferredFileBody_->file, deferredFileBody_->offset, bodyLen};
+  deferredFileBody_->offset += bodyLen;
+  deferredFileBody_->length -= bodyLen;
+  if (deferredFileBody_->length == 0) {
+    deferredFileBody_.clear();
+  }
+
+  if (transport_.canSendFileBody(this)) {
+    return sendBodyNow(nullptr, bodyLen, sendEom, &fileBody);
+  }
+
+  // Read only what may be sent now, so at most a write's worth of the file
+  // is in memory at a time
+  auto body = IOBuf::create(bodyLen);
+  auto rc = folly::preadFull(fileBody.file->fd(), body->writableData(),
+                             bodyLen, fileBody.offset);
+  if (rc != static_cast<ssize_t>(bodyLen)) {
+    LOG(ERROR) << "Failed to read " << bodyLen << " bytes of file body at "
+               << fileBody.offset << ", rc=" << rc << " " << *this;
+    sendAbort();
+    return 0;
+  }
+  body->append(bodyLen);
+#ifdef __linux__
+  if (deferredFileBody_) {
+    // Have the kernel read the next part while this one is sent, so that
+    // the next pread doesn't block the loop on the disk
+    posix_fadvise(fileBody.file->fd(), deferredFileBody_->offset,
+                  std::min(deferredFileBody_->length, 4 * bodyLen),
+                  POSIX_FADV_WILLNEED);
+  }
+#endif
+  // buffered until sendBodyNow() hands it to the transport
+  transport_.notifyEgressBodyBuffered(bodyLen);
+  return sendBodyNow(std::move(body), bodyLen, sendEom);
+}
+
 size_t HTTPTransaction::sendBodyNow(std::unique_ptr<folly::IOBuf> body,
-                                    size_t bodyLen, bool sendEom) {
+                                    size_t bodyLen, bool sendEom,
+                                    FileBody* fileBody) {
   static const std::string noneStr = "None";
-  DCHECK(body);
+  DCHECK(body || fileBody);
   DCHECK_GT(bodyLen, 0);
   size_t nbytes = 0;
   if (useFlowControl_) {
@@ -1068,7 +1354,9 @@ size_t HTTPTransaction::sendBodyNow(std::unique_ptr<folly::IOBuf> body,
                   : noneStr)
           << " trailers=" << ((trailers_) ? "yes" : "no") << " " << *this;
   DCHECK_LT(bodyLen, std::numeric_limits<int64_t>::max());
-  transport_.notifyEgressBodyBuffered(-static_cast<int64_t>(bodyLen));
+  if (body) {
+    transport_.notifyEgressBodyBuffered(-static_cast<int64_t>(bodyLen));
+  }
   if (sendEom && !trailers_) {
     CHECK(HTTPTransactionEgressSM::transit(
             egressState_, HTTPTransactionEgressSM::Event::eomFlushed));
@@ -1084,10 +1372,19 @@ size_t HTTPTransaction::sendBodyNow(std::unique_ptr<folly::IOBuf> body,
     return 0;
   }
   updateReadTimeout();
-  nbytes = transport_.sendBody(this,
-                               std::move(body),
-                               sendEom && !trailers_,
-                               enableLastByteFlushedTracking_);
+  if (fileBody) {
+    nbytes = transport_.sendFileBody(this,
+                                     std::move(fileBody->file),
+                                     fileBody->offset,
+                                     bodyLen,
+                                     sendEom && !trailers_,
+                                     enableLastByteFlushedTracking_);
+  } else {
+    nbytes = transport_.sendBody(this,
+                                 std::move(body),
+                                 sendEom && !trailers_,
+                                 enableLastByteFlushedTracking_);
+  }
   if (sendEom && trailers_) {
     sendEOMNow();
   }
@@ -1097,11 +1394,16 @@ size_t HTTPTransaction::sendBodyNow(std::unique_ptr<folly::IOBuf> body,
   if (egressLimitBytesPerMs_ > 0) {
     numLimitedBytesEgressed_ += nbytes;
   }
+  if (egressRateLimiter_) {
+    egressRateLimiter_->consume(nbytes);
+  }
   return nbytes;
 }
 
 void HTTPTransaction::sendEOM() {
   DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
+  CHECK(!bodyProducer_) << "sendEOM() with a body producer";
   CHECK(HTTPTransactionEgressSM::transit(
       egressState_, HTTPTransactionEgressSM::Event::sendEOM))
       << ", " << *this;
@@ -1115,7 +1417,7 @@ void HTTPTransaction::sendEOM() {
     LOG(ERROR) << errorMsg << " " << *this;
   }
 
-  if (deferredEgressBody_.chainLength() == 0 && chunkHeaders_.empty()) {
+  if (getDeferredEgressBodyLength() == 0 && chunkHeaders_.empty()) {
     // there is nothing left to send, egress the EOM directly.  For SPDY
     // this will jump the txn queue
     if (!isEnqueued()) {
@@ -1186,6 +1488,45 @@ void HTTPTransaction::trimDeferredEgressBody(uint64_t bodyOffset) {
   }
 }
 
+void HTTPTransaction::onDatagram(
+    std::unique_ptr<folly::IOBuf> datagram) noexcept {
+  FOLLY_SCOPED_TRACE_SECTION("HTTPTransaction - onDatagram");
+  // Datagrams arriving after the request stream closed are dropped
+  if (aborted_ || isIngressComplete()) {
+    VLOG(4) << "Dropping datagram on " << *this;
+    return;
+  }
+  DestructorGuard g(this);
+  if (handler_) {
+    handler_->onDatagram(std::move(datagram));
+  }
+}
+
+void HTTPTransaction::onDatagramEgressPaused() noexcept {
+  DestructorGuard g(this);
+  if (handler_ && !aborted_) {
+    handler_->onDatagramEgressPaused();
+  }
+}
+
+void HTTPTransaction::onDatagramEgressResumed() noexcept {
+  DestructorGuard g(this);
+  if (handler_ && !aborted_) {
+    handler_->onDatagramEgressResumed();
+  }
+}
+
+uint16_t HTTPTransaction::getDatagramSizeLimit() const noexcept {
+  return transport_.getDatagramSizeLimit();
+}
+
+bool HTTPTransaction::sendDatagram(std::unique_ptr<folly::IOBuf> datagram) {
+  if (aborted_) {
+    return false;
+  }
+  return transport_.sendDatagram(std::move(datagram));
+}
+
 folly::Expected<folly::Unit, ErrorCode> HTTPTransaction::peek(
     PeekCallback peekCallback) {
   return transport_.peek(peekCallback);
@@ -1274,6 +1615,7 @@ void HTTPTransaction::pauseIngress() {
 void HTTPTransaction::resumeIngress() {
   VLOG(4) << "resumeIngress request " << *this;
   DestructorGuard g(this);
+  CpuTimeScope cpuTime(*this);
   if (!ingressPaused_ || isIngressComplete()) {
     VLOG(4) << "can't resume ingress, ingressPaused=" << ingressPaused_
             << ", ingressComplete=" << isIngressComplete()
@@ -1298,6 +1640,12 @@ void HTTPTransaction::resumeIngress() {
   // the transaction.
   while (!ingressPaused_ && deferredIngress_ && !deferredIngress_->empty()) {
     HTTPEvent& callback(deferredIngress_->front());
+    if (callback.getEvent() != HTTPEvent::Type::BODY &&
+        hasHeldIngressBody()) {
+      // Deliver the body ahead of the event, which waits if that pauses
+      flushIngressBody();
+      continue;
+    }
     VLOG(5) << "Processing deferred ingress callback of type "
             << callback.getEvent() << " " << *this;
     switch (callback.getEvent()) {
@@ -1333,6 +1681,7 @@ void HTTPTransaction::resumeIngress() {
       deferredIngress_->pop();
     }
   }
+  flushIngressBody();
   updateReadTimeout();
   inResume_ = false;
 }
@@ -1368,11 +1717,44 @@ void HTTPTransaction::setEgressRateLimit(uint64_t bitsPerSecond) {
   numLimitedBytesEgressed_ = 0;
 }
 
+void HTTPTransaction::setEgressRateLimiter(
+    std::shared_ptr<EgressRateLimiter> limiter) {
+  bool waiting = rateLimiterHook_.is_linked();
+  rateLimiterHook_.unlink();
+  egressRateLimiter_ = std::move(limiter);
+  if (waiting) {
+    onEgressRateLimiterReady();
+  }
+}
+
+void HTTPTransaction::setBodyProducer(HTTPBodyProducer* producer) {
+  DestructorGuard guard(this);
+  if (producer) {
+    // After the headers, before the EOM
+    CHECK(egressState_ == HTTPTransactionEgressSM::State::HeadersSent ||
+          egressState_ == HTTPTransactionEgressSM::State::RegularBodySent)
+      << ", " << *this;
+    CHECK(chunkHeaders_.empty() && !partiallyReliable_);
+  }
+  bodyProducer_ = producer;
+  bodyProducerReady_ = true;
+  notifyTransportPendingEgress();
+}
+
+void HTTPTransaction::resumeBodyProducer() {
+  if (!bodyProducer_ || bodyProducerReady_) {
+    return;
+  }
+  DestructorGuard guard(this);
+  bodyProducerReady_ = true;
+  notifyTransportPendingEgress();
+}
+
 void HTTPTransaction::notifyTransportPendingEgress() {
   DestructorGuard guard(this);
   if (!egressRateLimited_ &&
-      (deferredEgressBody_.chainLength() > 0 ||
-       isEgressEOMQueued()) &&
+      (getDeferredEgressBodyLength() > 0 ||
+       isEgressEOMQueued() || isBodyProducerReady()) &&
       (!useFlowControl_ || sendWindow_.getSize() > 0)) {
     // Egress isn't paused, we have something to send, and flow
     // control isn't blocking us.
@@ -1394,7 +1776,7 @@ void HTTPTransaction::notifyTransportPendingEgress() {
 
 void HTTPTransaction::updateHandlerPauseState() {
   int64_t availWindow =
-    sendWindow_.getSize() - deferredEgressBody_.chainLength();
+    sendWindow_.getSize() - getDeferredEgressBodyLength();
   // do not count transaction stalled if no more bytes to send,
   // i.e. when availWindow == 0
   if (useFlowControl_ && availWindow < 0 && !flowControlPaused_) {
@@ -1403,7 +1785,15 @@ void HTTPTransaction::updateHandlerPauseState() {
       stats_->recordTransactionStalled();
     }
   }
-  flowControlPaused_ = useFlowControl_ && availWindow <= 0;
+  bool flowControlPaused = useFlowControl_ && availWindow <= 0;
+  if (flowControlPaused != flowControlPaused_) {
+    if (flowControlPaused) {
+      FOLLY_SDT(proxygen, txn_flow_control_blocked, id_, availWindow);
+    } else {
+      FOLLY_SDT(proxygen, txn_flow_control_unblocked, id_, availWindow);
+    }
+  }
+  flowControlPaused_ = flowControlPaused;
   bool handlerShouldBePaused = egressPaused_ || flowControlPaused_ ||
     egressRateLimited_;
 
@@ -1736,4 +2126,72 @@ bool HTTPTransaction::getPrioritySampleSummary(
   return false;
 }
 
+void HTTPTransaction::setPhaseTimingsEnabled(bool enabled,
+                                             TraceEventObserver* observer) {
+  if (enabled) {
+    if (!phaseTimings_) {
+      phaseTimings_ = std::make_unique<PhaseTimings>();
+      phaseTimings_->start = getCoarseTime();
+    }
+    phaseTimingsObserver_ = observer;
+  } else {
+    phaseTimings_.reset();
+    phaseTimingsObserver_ = nullptr;
+    cpuTimeAccounting_ = false;
+  }
+}
+
+void HTTPTransaction::setCpuTimeAccounting(bool enabled) {
+  if (enabled && !phaseTimings_) {
+    setPhaseTimingsEnabled(true);
+  }
+  cpuTimeAccounting_ = enabled;
+}
+
+HTTPTransaction::CpuTimeScope::CpuTimeScope(HTTPTransaction& txn) {
+  if (txn.cpuTimeAccounting_ && !txn.inCpuTimeScope_) {
+    txn_ = &txn;
+    txn.inCpuTimeScope_ = true;
+    start_ = getThreadCpuTime();
+  }
+}
+
+HTTPTransaction::CpuTimeScope::~CpuTimeScope() {
+  if (!txn_) {
+    return;
+  }
+  txn_->inCpuTimeScope_ = false;
+  if (txn_->phaseTimings_) {
+    txn_->phaseTimings_->cpuTime += getThreadCpuTime() - start_;
+  }
+}
+
+void HTTPTransaction::tracePhaseTimings() {
+  DCHECK(phaseTimings_);
+  const auto& timings = *phaseTimings_;
+  TraceEvent event(TraceEventType::TransactionPhases);
+  event.start(timings.start);
+  event.end(getCoarseTime());
+  event.addMeta(TraceFieldType::StreamID, id_);
+  // Each phase reached, in microseconds since the start
+  auto addPhase = [&] (TraceFieldType field, TimePoint phase) {
+    if (phase != TimePoint()) {
+      event.addMeta(field,
+                    microsecondsBetween(phase, timings.start).count());
+    }
+  };
+  addPhase(TraceFieldType::HeadersComplete, timings.headersComplete);
+  addPhase(TraceFieldType::IngressEOM, timings.ingressEOM);
+  addPhase(TraceFieldType::FirstSendBody, timings.firstSendBody);
+  addPhase(TraceFieldType::FirstByteWritten, timings.firstByteWritten);
+  addPhase(TraceFieldType::LastByteWritten, timings.lastByteWritten);
+  addPhase(TraceFieldType::LastByteAcked, timings.lastByteAcked);
+  if (cpuTimeAccounting_) {
+    event.addMeta(TraceFieldType::CpuTime,
+                  std::chrono::duration_cast<std::chrono::microseconds>(
+                    timings.cpuTime).count());
+  }
+  phaseTimingsObserver_->traceEventAvailable(std::move(event));
+}
+
 } // proxygen
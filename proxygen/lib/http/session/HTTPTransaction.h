@@ -10,12 +10,14 @@
 #pragma once
 
 #include <climits>
+#include <folly/IntrusiveList.h>
 #include <folly/Optional.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/async/AsyncTransport.h>
 #include <folly/io/async/DelayedDestructionBase.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <iosfwd>
+#include <memory>
 #include <wangle/acceptor/TransportInfo.h>
 #include <proxygen/lib/http/HTTPConstants.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
@@ -30,6 +32,12 @@
 #include <proxygen/lib/utils/Time.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 #include <set>
+#include <sys/types.h>
+
+namespace folly {
+class AsyncSocket;
+class File;
+}
 
 namespace proxygen {
 
@@ -127,8 +135,10 @@ class TransactionInfo {
   bool isCompleted{false};
 };
 
+class EgressRateLimiter;
 class HTTPSessionStats;
 class HTTPTransaction;
+struct TraceEventObserver;
 class HTTPTransactionHandler {
  public:
 
@@ -280,6 +290,21 @@ class HTTPTransactionHandler {
    */
   virtual void onBodyRejected(uint64_t /* offset */) noexcept {}
 
+  /**
+   * Inform the handler that an HTTP datagram (RFC 9297) for its transaction
+   * arrived.  Datagrams are unordered and may be lost.
+   */
+  virtual void onDatagram(
+      std::unique_ptr<folly::IOBuf> /* datagram */) noexcept {}
+
+  /**
+   * The session's buffer of datagrams to send filled up: until
+   * onDatagramEgressResumed(), sendDatagram() drops them.
+   */
+  virtual void onDatagramEgressPaused() noexcept {}
+
+  virtual void onDatagramEgressResumed() noexcept {}
+
   virtual ~HTTPTransactionHandler() {}
 };
 
@@ -361,6 +386,27 @@ class HTTPTransactionTransportCallback {
   virtual ~HTTPTransactionTransportCallback() {}
 };
 
+/**
+ * A source of egress body that a transaction pulls from only when its
+ * flow control window and the session's egress allowance let the bytes go
+ * out, see HTTPTransaction::setBodyProducer().  The body stays in its
+ * source, a cache, a file or an upstream, until it is sent.
+ */
+class HTTPBodyProducer {
+ public:
+  virtual ~HTTPBodyProducer() {}
+
+  /**
+   * Returns up to maxBytes of the next body bytes.  Setting eom ends the
+   * body with them, and the transaction sends the EOM and lets go of the
+   * producer.  Returning no bytes without eom means none are ready yet;
+   * the producer then calls HTTPTransaction::resumeBodyProducer() once
+   * there are.
+   */
+  virtual std::unique_ptr<folly::IOBuf> produceBody(size_t maxBytes,
+                                                    bool& eom) noexcept = 0;
+};
+
 class HTTPTransaction :
       public folly::HHWheelTimer::Callback,
       public folly::DelayedDestructionBase {
@@ -393,6 +439,34 @@ class HTTPTransaction :
                             bool eom,
                             bool trackLastByteFlushed) noexcept = 0;
 
+    /**
+     * Whether sendFileBody() can write body straight from a file for txn.
+     * Transports that can not get the file read into memory with sendBody().
+     */
+    virtual bool canSendFileBody(const HTTPTransaction* /*txn*/) const
+        noexcept {
+      return false;
+    }
+
+    virtual size_t sendFileBody(HTTPTransaction* /*txn*/,
+                                std::shared_ptr<folly::File> /*file*/,
+                                off_t /*offset*/,
+                                size_t /*length*/,
+                                bool /*eom*/,
+                                bool /*trackLastByteFlushed*/) noexcept {
+      LOG(FATAL) << __func__ << " not supported";
+      __builtin_unreachable();
+    }
+
+    /**
+     * Relays the tunnel of txn to upstream in the kernel; false if the
+     * transport can not.  See HTTPTransaction::spliceTunnel().
+     */
+    virtual bool spliceTunnel(HTTPTransaction* /*txn*/,
+                              folly::AsyncSocket& /*upstream*/) noexcept {
+      return false;
+    }
+
     virtual size_t sendChunkHeader(HTTPTransaction* txn,
                                    size_t length) noexcept = 0;
 
@@ -504,6 +578,18 @@ class HTTPTransaction :
       LOG(FATAL) << __func__ << " not supported";
       __builtin_unreachable();
     }
+
+    /**
+     * The largest HTTP datagram payload the transport can send, 0 if it
+     * cannot.
+     */
+    virtual uint16_t getDatagramSizeLimit() const noexcept {
+      return 0;
+    }
+
+    virtual bool sendDatagram(std::unique_ptr<folly::IOBuf> /* datagram */) {
+      return false;
+    }
   };
 
   using TransportCallback = HTTPTransactionTransportCallback;
@@ -653,6 +739,31 @@ class HTTPTransaction :
     return maxDeferredIngress_;
   }
 
+  /**
+   * Hold ingress body until at least threshold bytes arrived, the message
+   * ends or the session finishes processing a read, then deliver it with
+   * one onBody().  This saves handler and filter callbacks when the peer
+   * sends many small DATA frames.  The receive window is credited for the
+   * held bytes when they are delivered.  0 (the default) delivers each
+   * chunk as it is parsed.
+   */
+  void setIngressBodyCoalescing(size_t threshold) {
+    ingressBodyCoalesceThreshold_ = threshold;
+    if (threshold == 0) {
+      flushIngressBody();
+    }
+  }
+
+  bool hasHeldIngressBody() const {
+    return !heldIngressBody_.empty();
+  }
+
+  /**
+   * Deliver the body held by setIngressBodyCoalescing(), unless ingress is
+   * paused.  Invoked by the session at the end of each read.
+   */
+  void flushIngressBody();
+
   /**
    * Invoked by the session when the ingress headers are complete
    */
@@ -810,6 +921,19 @@ class HTTPTransaction :
    */
   void onIngressBodyRejected(uint64_t nextBodyOffset);
 
+  /**
+   * Invoked by the session when an HTTP datagram for this transaction
+   * arrives.
+   */
+  void onDatagram(std::unique_ptr<folly::IOBuf> datagram) noexcept;
+
+  /**
+   * Invoked by the session as its buffer of datagrams to send fills up and
+   * drains.
+   */
+  void onDatagramEgressPaused() noexcept;
+  void onDatagramEgressResumed() noexcept;
+
   /**
    * Invoked by the handlers that are interested in tracking
    * performance stats.
@@ -930,6 +1054,61 @@ class HTTPTransaction :
    */
   virtual void sendBody(std::unique_ptr<folly::IOBuf> body);
 
+  /**
+   * Pull the rest of the egress message body from producer, after the body
+   * already sent, rather than have it pushed with sendBody().  The session
+   * asks for at most what it can write to this transaction at the time,
+   * about one frame, so the transaction never buffers more than that.
+   * Once produceBody() returned eom, the transaction sends the EOM itself.
+   *
+   * The producer must outlive the transaction, or be replaced with nullptr
+   * before it goes away.  No body or EOM may be sent while it is set.
+   */
+  void setBodyProducer(HTTPBodyProducer* producer);
+
+  /**
+   * Tell the transaction that the producer, which last returned no bytes,
+   * has more.
+   */
+  void resumeBodyProducer();
+
+  HTTPBodyProducer* getBodyProducer() const {
+    return bodyProducer_;
+  }
+
+  /**
+   * Send length bytes of file, starting at offset, as the next part of the
+   * egress message body.  Transports that can, such as HTTP/1.x sessions
+   * over plaintext or kernel TLS sockets, write them with sendfile(2) and
+   * never copy them into user space.  The others have them read into
+   * memory as flow control allows, in the event base thread, so the file
+   * should be in the page cache.
+   *
+   * No other body may be sent until all of the file was, and it can not be
+   * combined with sendChunkHeader().  Flow control, rate limiting and byte
+   * events apply as they do to sendBody().
+   */
+  virtual void sendFileBody(std::shared_ptr<folly::File> file,
+                            off_t offset,
+                            size_t length);
+
+  /**
+   * Once the 2xx response to a CONNECT request was sent, hands the tunnel
+   * over to the transport, which relays it between its connection and the
+   * connected upstream socket with splice(2), without the bytes going
+   * through this transaction or user space.  Only HTTP/1.x sessions over a
+   * plaintext AsyncSocket can; returns false, leaving both as they were,
+   * otherwise, or if upstream has writes pending.
+   *
+   * The relay starts once the response went out, taking the upstream
+   * socket's descriptor and closing it when done.  The handler then sees no
+   * body either way; the transaction gets its egress EOM when the tunnel
+   * closes and then the ingress EOM from the client's EOF, or an error if
+   * either side failed, or neither sent a byte for the session's idle
+   * timeout.  No more body may be sent.
+   */
+  virtual bool spliceTunnel(folly::AsyncSocket& upstream);
+
   /**
    * Write any protocol framing required for the subsequent call(s)
    * to sendBody(). This method does not actually write the message out on
@@ -1057,6 +1236,29 @@ class HTTPTransaction :
    */
   void setEgressRateLimit(uint64_t bitsPerSecond);
 
+  /**
+   * Take the egress of this transaction from the token bucket of limiter,
+   * and those of its parents, which other transactions may share.  This
+   * applies on top of setEgressRateLimit().  nullptr removes the limiter.
+   */
+  void setEgressRateLimiter(std::shared_ptr<EgressRateLimiter> limiter);
+
+  const std::shared_ptr<EgressRateLimiter>& getEgressRateLimiter() const {
+    return egressRateLimiter_;
+  }
+
+  /**
+   * For HTTP/1.1, merge the explicit chunks (see sendChunkHeader()) whose
+   * bodies are all buffered when the transaction writes into chunks of up to
+   * maxLength bytes, so a handler sending many small chunks in one loop
+   * iteration pays for one chunk header and terminator.  Chunks are never
+   * held back waiting for more, so this adds no latency.  0, the default,
+   * keeps the chunk boundaries of the handler.
+   */
+  void setEgressChunkCoalescing(uint32_t maxLength) {
+    maxCoalescedChunk_ = maxLength;
+  }
+
   /**
    * @return true iff egress processing is paused for the handler
    */
@@ -1139,6 +1341,14 @@ class HTTPTransaction :
     return assocStreamId_.has_value();
   }
 
+  /**
+   * Body bytes handed to the session so far, not counting those still
+   * deferred in the transaction for flow control or rate limiting.
+   */
+  uint64_t getEgressBodyBytesSent() const {
+    return actualResponseLength_.value_or(0) - getDeferredEgressBodyLength();
+  }
+
   bool isExTransaction() const {
     return exAttributes_.has_value();
   }
@@ -1336,6 +1546,14 @@ class HTTPTransaction :
     return transport_.needToBlockForReplaySafety();
   }
 
+  /**
+   * Whether the transport is done with early data (TLS 1.3 or QUIC 0-RTT),
+   * so that what it carries now cannot be a replay.
+   */
+  virtual bool isReplaySafe() const {
+    return transport_.isReplaySafe();
+  }
+
   int32_t getRecvToAck() const;
 
   bool isPrioritySampled() const {
@@ -1361,10 +1579,87 @@ class HTTPTransaction :
 
   bool getPrioritySampleSummary(PrioritySampleSummary& summary) const;
 
+  /**
+   * What the transaction is doing, for HTTPSessionStateSnapshot.
+   */
+  struct StateSnapshot {
+    HTTPCodec::StreamID id{0};
+    HTTPTransactionIngressSM::State ingressState{
+      HTTPTransactionIngressSM::State::Start};
+    HTTPTransactionEgressSM::State egressState{
+      HTTPTransactionEgressSM::State::Start};
+    // The flow control windows, both 0 without stream flow control
+    int32_t sendWindow{0};
+    int32_t recvWindow{0};
+    // Body held back from the transport
+    size_t egressBuffered{0};
+    bool ingressPaused{false};
+    bool egressPaused{false};
+    // Whether it waits in the egress queue, and where it is in it
+    bool enqueued{false};
+    http2::PriorityUpdate priority{0, false, 0};
+    uint64_t queueDepth{0};
+  };
+
+  void getStateSnapshot(StateSnapshot& snapshot) const;
+
+  /**
+   * When each phase of the transaction was reached, to tell where its time
+   * went.  Phases not reached (yet) are left at TimePoint().
+   */
+  struct PhaseTimings {
+    // The transaction was created
+    TimePoint start;
+    // The ingress headers were parsed
+    TimePoint headersComplete;
+    // The ingress EOM was delivered to the handler
+    TimePoint ingressEOM;
+    // The handler called sendBody() the first time
+    TimePoint firstSendBody;
+    // The first egress header byte was written to the transport
+    TimePoint firstByteWritten;
+    // The last egress body byte was written to the transport
+    TimePoint lastByteWritten;
+    // The peer acknowledged the last egress body byte
+    TimePoint lastByteAcked;
+    // Thread CPU time spent in this transaction's ingress and egress
+    // processing, handler callbacks included, with setCpuTimeAccounting()
+    std::chrono::nanoseconds cpuTime{0};
+  };
+
+  bool isPhaseTimingsEnabled() const {
+    return phaseTimings_ != nullptr;
+  }
+
+  /**
+   * Records the PhaseTimings of this transaction from now on.  If observer
+   * is set, it is given a TransactionPhases TraceEvent with them when the
+   * transaction is destroyed.
+   */
+  void setPhaseTimingsEnabled(bool enabled,
+                              TraceEventObserver* observer = nullptr);
+
+  // nullptr unless phase timings are enabled
+  const PhaseTimings* getPhaseTimings() const {
+    return phaseTimings_.get();
+  }
+
+  /**
+   * Accumulate PhaseTimings::cpuTime, enabling phase timings if needed.
+   * Each ingress event, send call and egress write reads the thread CPU
+   * clock twice, so sessions only do this for a sample of transactions
+   * (see HTTPSessionBase::setCpuTimeSampleRate).
+   */
+  void setCpuTimeAccounting(bool enabled);
+
+  bool isCpuTimeAccounting() const {
+    return cpuTimeAccounting_;
+  }
+
   const CompressionInfo& getCompressionInfo() const;
 
   bool hasPendingBody() const {
-    return deferredEgressBody_.chainLength() > 0;
+    return getDeferredEgressBodyLength() > 0;
   }
 
   void setLastByteFlushedTrackingEnabled(bool enabled) {
@@ -1427,6 +1722,21 @@ class HTTPTransaction :
   folly::Expected<folly::Optional<uint64_t>, ErrorCode>
   rejectBodyTo(uint64_t nextBodyOffset);
 
+  /**
+   * The largest HTTP datagram (RFC 9297) payload sendDatagram() accepts, 0
+   * if the transport has no datagrams or the peer didn't negotiate them.
+   */
+  uint16_t getDatagramSizeLimit() const noexcept;
+
+  /**
+   * Sends an HTTP datagram tied to this transaction, unreliably and
+   * unordered.  Datagrams sent in the same event loop iteration share
+   * packets.  Returns false if the datagram was dropped: too large, not
+   * negotiated, the transaction aborted, or the session's datagram buffer
+   * full (see HTTPTransactionHandler::onDatagramEgressPaused()).
+   */
+  bool sendDatagram(std::unique_ptr<folly::IOBuf> datagram);
+
  private:
   HTTPTransaction(const HTTPTransaction&) = delete;
   HTTPTransaction& operator=(const HTTPTransaction&) = delete;
@@ -1463,6 +1773,7 @@ class HTTPTransaction :
   // that work whether the ingress events are immediate or deferred.
   void processIngressHeadersComplete(std::unique_ptr<HTTPMessage> msg);
   void processIngressBody(std::unique_ptr<folly::IOBuf> chain, size_t len);
+  void deliverIngressBody(std::unique_ptr<folly::IOBuf> chain, size_t len);
   void processIngressChunkHeader(size_t length);
   void processIngressChunkComplete();
   void processIngressTrailers(std::unique_ptr<HTTPHeaders> trailers);
@@ -1470,8 +1781,11 @@ class HTTPTransaction :
   void processIngressEOM();
 
   void sendBodyFlowControlled(std::unique_ptr<folly::IOBuf> body = nullptr);
+  struct FileBody;
+  // fileBody, with a null body, to have the transport send it from the file
   size_t sendBodyNow(std::unique_ptr<folly::IOBuf> body, size_t bodyLen,
-                     bool eom);
+                     bool eom, FileBody* fileBody = nullptr);
+  size_t sendFileBodyNow(size_t bodyLen, bool eom);
   size_t sendEOMNow();
   void onDeltaSendWindowSize(int32_t windowDelta);
 
@@ -1479,8 +1793,24 @@ class HTTPTransaction :
 
   size_t sendDeferredBody(uint32_t maxEgress);
 
+  // Merges the chunks after the front one into it, up to maxLength bytes
+  void coalesceChunks(size_t maxLength);
+
   bool maybeDelayForRateLimit();
 
+  // Whether bodyProducer_ may have body to pull
+  bool isBodyProducerReady() const {
+    return bodyProducer_ && bodyProducerReady_;
+  }
+
+  // Appends to deferredEgressBody_ what bodyProducer_ has, up to maxEgress
+  void pullProducerBody(uint32_t maxEgress);
+
+  // The bytes egressRateLimiter_ lets go now, 0 after parking this on it
+  uint64_t checkEgressRateLimiter();
+
+  void onEgressRateLimiterReady();
+
   bool isEnqueued() const { return queueHandle_->isEnqueued(); }
 
   void dequeue() {
@@ -1489,10 +1819,16 @@ class HTTPTransaction :
   }
 
   bool hasPendingEOM() const {
-    return deferredEgressBody_.chainLength() == 0 &&
+    return getDeferredEgressBodyLength() == 0 &&
       isEgressEOMQueued();
   }
 
+  // Body bytes buffered or left to send from the file
+  size_t getDeferredEgressBodyLength() const {
+    return deferredEgressBody_.chainLength() +
+      (deferredFileBody_ ? deferredFileBody_->length : 0);
+  }
+
   bool isExpectingIngress() const;
 
   bool isExpectingWindowUpdate() const;
@@ -1511,6 +1847,24 @@ class HTTPTransaction :
    */
   void markEgressComplete();
 
+  // Gives phaseTimingsObserver_ the TraceEvent of phaseTimings_
+  void tracePhaseTimings();
+
+  /**
+   * Adds the thread CPU time from its construction to its destruction to
+   * phaseTimings_->cpuTime, if accounting is on and no enclosing scope
+   * already counts it.  Declare it after the DestructorGuard.
+   */
+  class CpuTimeScope {
+   public:
+    explicit CpuTimeScope(HTTPTransaction& txn);
+    ~CpuTimeScope();
+
+   private:
+    HTTPTransaction* txn_{nullptr};
+    std::chrono::nanoseconds start_{0};
+  };
+
   /**
    * Validates the ingress state transition. Returns false and sends an
    * abort with PROTOCOL_ERROR if the transition fails. Otherwise it
@@ -1555,12 +1909,35 @@ class HTTPTransaction :
 
   uint32_t maxDeferredIngress_{0};
 
+  /**
+   * Body held until ingressBodyCoalesceThreshold_ bytes arrived, see
+   * setIngressBodyCoalescing().
+   */
+  folly::IOBufQueue heldIngressBody_{folly::IOBufQueue::cacheChainLength()};
+  size_t ingressBodyCoalesceThreshold_{0};
+
   /**
    * Queue to hold any body bytes to be sent out
    * while egress to the remote is supposed to be paused.
    */
   folly::IOBufQueue deferredEgressBody_{folly::IOBufQueue::cacheChainLength()};
 
+  /**
+   * The part of the file passed to sendFileBody() left to send, which
+   * follows deferredEgressBody_.
+   */
+  struct FileBody {
+    std::shared_ptr<folly::File> file;
+    off_t offset;
+    size_t length;
+  };
+  folly::Optional<FileBody> deferredFileBody_;
+
+  // See setBodyProducer(), pulled once deferredEgressBody_ and
+  // deferredFileBody_ are all sent
+  HTTPBodyProducer* bodyProducer_{nullptr};
+  bool bodyProducerReady_{false};
+
   const TransportDirection direction_;
   HTTPCodec::StreamID id_;
   uint32_t seqNo_;
@@ -1572,6 +1949,8 @@ class HTTPTransaction :
     HTTPTransactionIngressSM::getNewInstance()};
 
   HTTPSessionStats* stats_{nullptr};
+  // When the transaction started, kept for the latencies given to stats_
+  TimePoint startTime_;
 
   CompressionInfo tableInfo_;
 
@@ -1600,6 +1979,8 @@ class HTTPTransaction :
     bool headerSent;
   };
   std::list<Chunk> chunkHeaders_;
+  // See setEgressChunkCoalescing()
+  uint32_t maxCoalescedChunk_{0};
 
   /**
    * Reference to our priority queue
@@ -1694,6 +2075,11 @@ class HTTPTransaction :
   proxygen::TimePoint startRateLimit_;
   uint64_t numLimitedBytesEgressed_{0};
 
+  friend class EgressRateLimiter;
+  std::shared_ptr<EgressRateLimiter> egressRateLimiter_;
+  // Linked while waiting for tokens on egressRateLimiter_ or a parent
+  folly::IntrusiveListHook rateLimiterHook_;
+
   /**
    * Optional transaction timeout value.
    */
@@ -1704,6 +2090,11 @@ class HTTPTransaction :
   class PrioritySample;
   std::unique_ptr<PrioritySample> prioritySample_;
 
+  std::unique_ptr<PhaseTimings> phaseTimings_;
+  TraceEventObserver* phaseTimingsObserver_{nullptr};
+  bool cpuTimeAccounting_{false};
+  bool inCpuTimeScope_{false};
+
   // Signals if the transaction is partially reliable.
   // Set on first sendHeaders() call;
   bool partiallyReliable_{false};
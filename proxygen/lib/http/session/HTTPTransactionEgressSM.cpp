@@ -9,70 +9,10 @@
  */
 #include <proxygen/lib/http/session/HTTPTransactionEgressSM.h>
 
-#include <folly/Indestructible.h>
-#include <folly/container/F14Map.h>
-#include <folly/hash/Hash.h>
+#include <ostream>
 
 namespace proxygen {
 
-std::pair<HTTPTransactionEgressSMData::State, bool>
-HTTPTransactionEgressSMData::find(HTTPTransactionEgressSMData::State s,
-                                  HTTPTransactionEgressSMData::Event e) {
-  using State = HTTPTransactionEgressSMData::State;
-  using Event = HTTPTransactionEgressSMData::Event;
-  using TransitionTable =
-      folly::F14FastMap<std::pair<State, Event>, State, folly::Hash>;
-
-  //             +--> ChunkHeaderSent -> ChunkBodySent
-  //             |      ^                    v
-  //             |      |   ChunkTerminatorSent -> TrailersSent
-  //             |      |__________|        |          |
-  //             |                          |          v
-  // Start -> HeadersSent                   +----> EOMQueued --> SendingDone
-  //             |                                     ^
-  //             +------------> RegularBodySent -------+
-
-  static const folly::Indestructible<TransitionTable> transitions{
-    TransitionTable{
-      {{State::Start, Event::sendHeaders}, State::HeadersSent},
-
-      // For HTTP sending 100 response, then a regular response
-      {{State::HeadersSent, Event::sendHeaders}, State::HeadersSent},
-
-      {{State::HeadersSent, Event::sendBody}, State::RegularBodySent},
-      {{State::HeadersSent, Event::sendTrailers}, State::TrailersSent},
-      {{State::HeadersSent, Event::sendChunkHeader}, State::ChunkHeaderSent},
-      {{State::HeadersSent, Event::sendEOM}, State::EOMQueued},
-
-      {{State::RegularBodySent, Event::sendBody}, State::RegularBodySent},
-      {{State::RegularBodySent, Event::sendTrailers}, State::TrailersSent},
-      {{State::RegularBodySent, Event::sendEOM}, State::EOMQueued},
-
-      {{State::ChunkHeaderSent, Event::sendBody}, State::ChunkBodySent},
-
-      {{State::ChunkBodySent, Event::sendBody}, State::ChunkBodySent},
-      {{State::ChunkBodySent, Event::sendChunkTerminator},
-       State::ChunkTerminatorSent},
-
-      {{State::ChunkTerminatorSent, Event::sendChunkHeader},
-       State::ChunkHeaderSent},
-      {{State::ChunkTerminatorSent, Event::sendTrailers}, State::TrailersSent},
-      {{State::ChunkTerminatorSent, Event::sendEOM}, State::EOMQueued},
-
-      {{State::TrailersSent, Event::sendEOM}, State::EOMQueued},
-
-      {{State::EOMQueued, Event::eomFlushed}, State::SendingDone}
-    }
-  };
-
-  auto const &it = transitions->find(std::make_pair(s, e));
-  if (it == transitions->end()) {
-    return std::make_pair(s, false);
-  }
-
-  return std::make_pair(it->second, true);
-}
-
 std::ostream& operator<<(std::ostream& os,
                          HTTPTransactionEgressSMData::State s) {
   switch (s) {
@@ -28,6 +28,7 @@ class HTTPTransactionEgressSMData {
     EOMQueued,
     SendingDone
   };
+  static constexpr size_t kNumStates = size_t(State::SendingDone) + 1;
 
   enum class Event: uint8_t {
     // API accessible transitions
@@ -40,12 +41,55 @@ class HTTPTransactionEgressSMData {
     // Internal state transitions
     eomFlushed,
   };
+  static constexpr size_t kNumEvents = size_t(Event::eomFlushed) + 1;
 
   static State getInitialState() {
     return State::Start;
   }
 
-  static std::pair<State, bool> find(State s, Event e);
+  //             +--> ChunkHeaderSent -> ChunkBodySent
+  //             |      ^                    v
+  //             |      |   ChunkTerminatorSent -> TrailersSent
+  //             |      |__________|        |          |
+  //             |                          |          v
+  // Start -> HeadersSent                   +----> EOMQueued --> SendingDone
+  //             |                                     ^
+  //             +------------> RegularBodySent -------+
+  static std::pair<State, bool> find(State s, Event e) {
+    using Table = TransitionTable<State, Event, kNumStates, kNumEvents>;
+    static constexpr Table::Transition kTransitions[] = {
+      {State::Start, Event::sendHeaders, State::HeadersSent},
+
+      // For HTTP sending 100 response, then a regular response
+      {State::HeadersSent, Event::sendHeaders, State::HeadersSent},
+
+      {State::HeadersSent, Event::sendBody, State::RegularBodySent},
+      {State::HeadersSent, Event::sendTrailers, State::TrailersSent},
+      {State::HeadersSent, Event::sendChunkHeader, State::ChunkHeaderSent},
+      {State::HeadersSent, Event::sendEOM, State::EOMQueued},
+
+      {State::RegularBodySent, Event::sendBody, State::RegularBodySent},
+      {State::RegularBodySent, Event::sendTrailers, State::TrailersSent},
+      {State::RegularBodySent, Event::sendEOM, State::EOMQueued},
+
+      {State::ChunkHeaderSent, Event::sendBody, State::ChunkBodySent},
+
+      {State::ChunkBodySent, Event::sendBody, State::ChunkBodySent},
+      {State::ChunkBodySent, Event::sendChunkTerminator,
+       State::ChunkTerminatorSent},
+
+      {State::ChunkTerminatorSent, Event::sendChunkHeader,
+       State::ChunkHeaderSent},
+      {State::ChunkTerminatorSent, Event::sendTrailers, State::TrailersSent},
+      {State::ChunkTerminatorSent, Event::sendEOM, State::EOMQueued},
+
+      {State::TrailersSent, Event::sendEOM, State::EOMQueued},
+
+      {State::EOMQueued, Event::eomFlushed, State::SendingDone}
+    };
+    static constexpr Table kTable(kTransitions);
+    return kTable.find(s, e);
+  }
 
   static const std::string getName() {
     return "HTTPTransactionEgress";
@@ -9,7 +9,6 @@
  */
 #pragma once
 
-#include <map>
 #include <iosfwd>
 #include <proxygen/lib/utils/StateMachine.h>
 
@@ -30,6 +29,7 @@ class HTTPTransactionIngressSMData {
     EOMQueued,
     ReceivingDone,
   };
+  static constexpr size_t kNumStates = size_t(State::ReceivingDone) + 1;
 
   enum class Event: uint8_t {
     // API accessible transitions
@@ -43,12 +43,68 @@ class HTTPTransactionIngressSMData {
     // Internal state transitions
     eomFlushed,
   };
+  static constexpr size_t kNumEvents = size_t(Event::eomFlushed) + 1;
 
   static State getInitialState() {
     return State::Start;
   }
 
-  static std::pair<State, bool> find(State s, Event e);
+  //             +--> ChunkHeaderReceived -> ChunkBodyReceived
+  //             |        ^                     v
+  //             |        |          ChunkCompleted -> TrailersReceived
+  //             |        |_______________|     |      |
+  //             |                              v      v
+  // Start -> HeadersReceived ---------------> EOMQueued ---> ReceivingDone
+  //             |  |                             ^  ^
+  //             |  +-----> RegularBodyReceived --+  |
+  //             |                                   |
+  //             +---------> UpgradeComplete --------+
+  static std::pair<State, bool> find(State s, Event e) {
+    using Table = TransitionTable<State, Event, kNumStates, kNumEvents>;
+    static constexpr Table::Transition kTransitions[] = {
+      {State::Start, Event::onHeaders, State::HeadersReceived},
+
+      // For HTTP receiving 100 response, then a regular response
+      {State::HeadersReceived, Event::onHeaders, State::HeadersReceived},
+
+      {State::HeadersReceived, Event::onBody, State::RegularBodyReceived},
+      {State::HeadersReceived, Event::onChunkHeader,
+       State::ChunkHeaderReceived},
+      // special case - 0 byte body with trailers
+      {State::HeadersReceived, Event::onTrailers, State::TrailersReceived},
+      {State::HeadersReceived, Event::onUpgrade, State::UpgradeComplete},
+      {State::HeadersReceived, Event::onEOM, State::EOMQueued},
+
+      {State::RegularBodyReceived, Event::onBody, State::RegularBodyReceived},
+      // HTTP2 supports trailers and doesn't handle body as chunked events
+      {State::RegularBodyReceived, Event::onTrailers, State::TrailersReceived},
+      {State::RegularBodyReceived, Event::onEOM, State::EOMQueued},
+
+      {State::ChunkHeaderReceived, Event::onBody, State::ChunkBodyReceived},
+
+      {State::ChunkBodyReceived, Event::onBody, State::ChunkBodyReceived},
+      {State::ChunkBodyReceived, Event::onChunkComplete,
+       State::ChunkCompleted},
+
+      {State::ChunkCompleted, Event::onChunkHeader,
+       State::ChunkHeaderReceived},
+      // TODO: "trailers" may be received at any time due to the SPDY HEADERS
+      // frame coming at any time. We might want to have a
+      // TransactionStateMachineFactory that takes a codec and generates the
+      // appropriate transaction state machine from that.
+      {State::ChunkCompleted, Event::onTrailers, State::TrailersReceived},
+      {State::ChunkCompleted, Event::onEOM, State::EOMQueued},
+
+      {State::TrailersReceived, Event::onEOM, State::EOMQueued},
+
+      {State::UpgradeComplete, Event::onBody, State::UpgradeComplete},
+      {State::UpgradeComplete, Event::onEOM, State::EOMQueued},
+
+      {State::EOMQueued, Event::eomFlushed, State::ReceivingDone},
+    };
+    static constexpr Table kTable(kTransitions);
+    return kTable.find(s, e);
+  }
 
   static const std::string getName() {
     return "HTTPTransactionIngress";
@@ -10,8 +10,6 @@
 #include <proxygen/lib/http/session/HTTPUpstreamSession.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 
-#include <folly/io/async/AsyncSSLSocket.h>
-#include <wangle/acceptor/ConnectionManager.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 
@@ -78,7 +76,7 @@ void HTTPUpstreamSession::startNow() {
     // TODO/T17420249 Move this to the PriorityAdapter and remove it from the
     // codec.
     auto bytes = codec_->addPriorityNodes(
-        txnEgressQueue_,
+        *txnEgressQueue_,
         writeBuf_,
         maxVirtualPriorityLevel_);
     if (bytes) {
@@ -144,7 +142,7 @@ bool HTTPUpstreamSession::onNativeProtocolUpgrade(
                                          protocolString);
   if (ret) {
     auto bytes = codec_->addPriorityNodes(
-      txnEgressQueue_,
+      *txnEgressQueue_,
       writeBuf_,
       maxVirtualPriorityLevel_);
     if (bytes) {
@@ -161,68 +159,4 @@ void HTTPUpstreamSession::detachTransactions() {
   }
 }
 
-void
-HTTPUpstreamSession::attachThreadLocals(
-  folly::EventBase* eventBase,
-  folly::SSLContextPtr sslContext,
-  const WheelTimerInstance& timeout,
-  HTTPSessionStats* stats, FilterIteratorFn fn,
-  HeaderCodec::Stats* headerCodecStats,
-  HTTPSessionController* controller) {
-  txnEgressQueue_.attachThreadLocals(timeout);
-  timeout_ = timeout;
-  setController(controller);
-  setSessionStats(stats);
-  if (sock_) {
-    sock_->attachEventBase(eventBase);
-    maybeAttachSSLContext(sslContext);
-  }
-  codec_.foreach(fn);
-  codec_->setHeaderCodecStats(headerCodecStats);
-  resumeReadsImpl();
-  rescheduleLoopCallbacks();
-}
-
-void HTTPUpstreamSession::maybeAttachSSLContext(
-    folly::SSLContextPtr sslContext) const {
-#ifndef NO_ASYNCSSLSOCKET
-  auto sslSocket = sock_->getUnderlyingTransport<folly::AsyncSSLSocket>();
-  if (sslSocket && sslContext) {
-    sslSocket->attachSSLContext(sslContext);
-  }
-#endif
-}
-
-void
-HTTPUpstreamSession::detachThreadLocals(bool detachSSLContext) {
-  CHECK(transactions_.empty());
-  cancelLoopCallbacks();
-  pauseReadsImpl();
-  if (sock_) {
-    if (detachSSLContext) {
-      maybeDetachSSLContext();
-    }
-    sock_->detachEventBase();
-  }
-  txnEgressQueue_.detachThreadLocals();
-  setController(nullptr);
-  setSessionStats(nullptr);
-  // The codec filters *shouldn't* be accessible while the socket is detached,
-  // I hope
-  codec_->setHeaderCodecStats(nullptr);
-  auto cm = getConnectionManager();
-  if (cm) {
-    cm->removeConnection(this);
-  }
-}
-
-void HTTPUpstreamSession::maybeDetachSSLContext() const {
-#ifndef NO_ASYNCSSLSOCKET
-  auto sslSocket = sock_->getUnderlyingTransport<folly::AsyncSSLSocket>();
-  if (sslSocket) {
-    sslSocket->detachSSLContext();
-  }
-#endif
-}
-
 } // proxygen
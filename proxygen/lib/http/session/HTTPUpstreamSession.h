@@ -90,16 +90,6 @@ class HTTPUpstreamSession final: public HTTPSession {
 
   void detachTransactions();
 
-  void attachThreadLocals(folly::EventBase* eventBase,
-                          folly::SSLContextPtr sslContext,
-                          const WheelTimerInstance& timeout,
-                          HTTPSessionStats* stats,
-                          FilterIteratorFn fn,
-                          HeaderCodec::Stats* headerCodecStats,
-                          HTTPSessionController* controller) override;
-
-  void detachThreadLocals(bool detachSSLContext=false) override;
-
   void startNow() override;
 
   /**
@@ -166,9 +156,6 @@ class HTTPUpstreamSession final: public HTTPSession {
     const std::string& protocolString,
     HTTPMessage& msg) override;
 
-  void maybeAttachSSLContext(folly::SSLContextPtr sslContext) const;
-  void maybeDetachSSLContext() const;
-
   uint8_t maxVirtualPriorityLevel_{0};
 
   std::shared_ptr<const PriorityMapFactory> priorityMapFactory_;
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HistogramHTTPSessionStats.h>
+
+namespace proxygen {
+
+HistogramHTTPSessionStats::HistogramHTTPSessionStats()
+    : threads_([this] { return new ThreadHistograms(*this); }) {}
+
+HistogramHTTPSessionStats::ThreadHistograms::~ThreadHistograms() {
+  std::lock_guard<std::mutex> guard(parent_.exitedMutex_);
+  addTo(parent_.exited_);
+}
+
+void HistogramHTTPSessionStats::ThreadHistograms::addTo(
+    Snapshot& snapshot) const {
+  headerParseTime.addTo(snapshot.headerParseTime);
+  timeToFirstByte.addTo(snapshot.timeToFirstByte);
+  timeToLastByte.addTo(snapshot.timeToLastByte);
+  requestDuration.addTo(snapshot.requestDuration);
+}
+
+HistogramHTTPSessionStats::Snapshot
+HistogramHTTPSessionStats::getSnapshot() const {
+  Snapshot snapshot;
+  {
+    std::lock_guard<std::mutex> guard(exitedMutex_);
+    snapshot = exited_;
+  }
+  // Exiting threads take exitedMutex_ under the accessAllThreads lock, so
+  // it must not be held here
+  for (const auto& thread : threads_.accessAllThreads()) {
+    thread.addTo(snapshot);
+  }
+  return snapshot;
+}
+
+void HistogramHTTPSessionStats::recordHeaderParseTime(
+    std::chrono::microseconds latency) noexcept {
+  threads_->headerParseTime.addValue(latency.count());
+}
+
+void HistogramHTTPSessionStats::recordTimeToFirstByte(
+    std::chrono::microseconds latency) noexcept {
+  threads_->timeToFirstByte.addValue(latency.count());
+}
+
+void HistogramHTTPSessionStats::recordTimeToLastByte(
+    std::chrono::microseconds latency) noexcept {
+  threads_->timeToLastByte.addValue(latency.count());
+}
+
+void HistogramHTTPSessionStats::recordRequestDuration(
+    std::chrono::microseconds latency) noexcept {
+  threads_->requestDuration.addValue(latency.count());
+}
+
+}
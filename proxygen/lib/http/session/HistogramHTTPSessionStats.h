@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/utils/LatencyHistogram.h>
+
+#include <mutex>
+
+namespace proxygen {
+
+/**
+ * HTTPSessionStats keeping histograms of the transaction latencies, in
+ * microseconds, to be shared by the sessions of every thread.
+ *
+ * Each thread records into histograms of its own, without locks, and
+ * getSnapshot() merges them from any thread, reading the counts only, so
+ * it can be scraped frequently without slowing down the threads recording.
+ * The histograms of threads that exited are folded into the snapshots; one
+ * exiting while a snapshot is taken may be missed from it.
+ *
+ * The counters of HTTPSessionStats are ignored; subclasses may count them.
+ */
+class HistogramHTTPSessionStats : public HTTPSessionStats {
+ public:
+  struct Snapshot {
+    LatencyHistogram headerParseTime;
+    LatencyHistogram timeToFirstByte;
+    LatencyHistogram timeToLastByte;
+    LatencyHistogram requestDuration;
+  };
+
+  HistogramHTTPSessionStats();
+
+  Snapshot getSnapshot() const;
+
+  void recordHeaderParseTime(std::chrono::microseconds latency) noexcept
+    override;
+  void recordTimeToFirstByte(std::chrono::microseconds latency) noexcept
+    override;
+  void recordTimeToLastByte(std::chrono::microseconds latency) noexcept
+    override;
+  void recordRequestDuration(std::chrono::microseconds latency) noexcept
+    override;
+
+  void recordTransactionOpened() noexcept override {}
+  void recordTransactionClosed() noexcept override {}
+  void recordTransactionsServed(uint64_t) noexcept override {}
+  void recordSessionReused() noexcept override {}
+  void recordTransactionStalled() noexcept override {}
+  void recordSessionStalled() noexcept override {}
+
+  void recordTTLBAExceedLimit() noexcept override {}
+  void recordTTLBAIOBSplitByEom() noexcept override {}
+  void recordTTLBANotFound() noexcept override {}
+  void recordTTLBAReceived() noexcept override {}
+  void recordTTLBATimeout() noexcept override {}
+  void recordTTLBAEomPassed() noexcept override {}
+  void recordTTLBATracked() noexcept override {}
+  void recordTTBTXExceedLimit() noexcept override {}
+  void recordTTBTXIOBSplitBySom() noexcept override {}
+  void recordTTBTXReceived() noexcept override {}
+  void recordTTBTXTimeout() noexcept override {}
+  void recordTTBTXNotFound() noexcept override {}
+  void recordTTBTXTracked() noexcept override {}
+
+ private:
+  struct ThreadHistograms {
+    explicit ThreadHistograms(HistogramHTTPSessionStats& parent)
+        : parent_(parent) {}
+    ~ThreadHistograms();
+
+    void addTo(Snapshot& snapshot) const;
+
+    HistogramHTTPSessionStats& parent_;
+    ConcurrentLatencyHistogram headerParseTime;
+    ConcurrentLatencyHistogram timeToFirstByte;
+    ConcurrentLatencyHistogram timeToLastByte;
+    ConcurrentLatencyHistogram requestDuration;
+  };
+  struct Tag {};
+
+  // The histograms of the threads that exited, and its lock
+  mutable std::mutex exitedMutex_;
+  Snapshot exited_;
+
+  folly::ThreadLocal<ThreadHistograms, Tag> threads_;
+};
+
+}
@@ -0,0 +1,247 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/RFC9218PriorityQueue.h>
+
+#include <folly/Bits.h>
+#include <folly/String.h>
+
+namespace proxygen {
+
+const uint8_t RFC9218PriorityQueue::kNumUrgencies;
+const uint8_t RFC9218PriorityQueue::kDefaultUrgency;
+
+RFC9218PriorityQueue::~RFC9218PriorityQueue() {
+  for (auto& bucket : buckets_) {
+    bucket.sequential.clear();
+    bucket.incremental.clear();
+    bucket.members.clear_and_dispose([] (Node* n) { delete n; });
+  }
+}
+
+uint8_t
+RFC9218PriorityQueue::urgencyFromPriority(const http2::PriorityUpdate& pri) {
+  // One urgency per power of two of the weight: 1 -> 7, 16-31 -> 3 and
+  // 128-256 -> 0
+  uint32_t weight = uint32_t(pri.weight) + 1;
+  auto bits = folly::findLastSet(weight);
+  return bits >= kNumUrgencies ? 0 : kNumUrgencies - bits;
+}
+
+http2::PriorityUpdate
+RFC9218PriorityQueue::priorityFromUrgency(uint8_t urgency,
+                                          HTTPCodec::StreamID rootId) {
+  urgency = std::min<uint8_t>(urgency, kNumUrgencies - 1);
+  return {rootId, false, uint8_t((1u << (kNumUrgencies - 1 - urgency)) - 1)};
+}
+
+void
+RFC9218PriorityQueue::parsePriorityField(folly::StringPiece value,
+                                         uint8_t& urgency,
+                                         bool& incremental) {
+  urgency = kDefaultUrgency;
+  incremental = false;
+  // A structured field dictionary: comma separated key[=value] members,
+  // each with optional ;parameters
+  while (!value.empty()) {
+    auto member = folly::trimWhitespace(value.split_step(','));
+    member = folly::trimWhitespace(member.split_step(';'));
+    auto key = folly::trimWhitespace(member.split_step('='));
+    auto item = folly::trimWhitespace(member);
+    if (key == "u") {
+      if (item.size() == 1 && item[0] >= '0' &&
+          item[0] < '0' + kNumUrgencies) {
+        urgency = item[0] - '0';
+      }
+    } else if (key == "i") {
+      if (item.empty() || item == "?1") {
+        incremental = true;
+      } else if (item == "?0") {
+        incremental = false;
+      }
+    }
+  }
+}
+
+HTTP2PriorityQueueBase::Handle
+RFC9218PriorityQueue::addTransaction(HTTPCodec::StreamID id,
+                                     http2::PriorityUpdate pri,
+                                     HTTPTransaction *txn,
+                                     bool /*permanent*/,
+                                     uint64_t* depth) {
+  if (depth) {
+    *depth = 1;
+  }
+  return addTransaction(id, urgencyFromPriority(pri), false, txn);
+}
+
+HTTP2PriorityQueueBase::Handle
+RFC9218PriorityQueue::addTransaction(HTTPCodec::StreamID id,
+                                     uint8_t urgency,
+                                     bool incremental,
+                                     HTTPTransaction *txn) {
+  urgency = std::min<uint8_t>(urgency, kNumUrgencies - 1);
+  VLOG(4) << "Adding id=" << id << " with urgency=" << (uint32_t)urgency
+          << " incremental=" << incremental;
+  auto n = new Node(id, urgency, incremental, txn);
+  buckets_[urgency].members.push_back(*n);
+  numNodes_++;
+  return n;
+}
+
+HTTP2PriorityQueueBase::Handle
+RFC9218PriorityQueue::updatePriority(Handle handle,
+                                     http2::PriorityUpdate pri,
+                                     uint64_t* depth) {
+  if (depth) {
+    *depth = 1;
+  }
+  return updatePriority(handle, urgencyFromPriority(pri),
+                        node(handle)->incremental_);
+}
+
+HTTP2PriorityQueueBase::Handle
+RFC9218PriorityQueue::updatePriority(Handle handle,
+                                     uint8_t urgency,
+                                     bool incremental) {
+  auto n = node(handle);
+  urgency = std::min<uint8_t>(urgency, kNumUrgencies - 1);
+  if (n->urgency_ == urgency && n->incremental_ == incremental) {
+    return handle;
+  }
+  VLOG(4) << "Updating id=" << n->id_ << " to urgency=" << (uint32_t)urgency
+          << " incremental=" << incremental;
+  bool enqueued = n->isEnqueued();
+  if (enqueued) {
+    dequeue(n);
+  }
+  n->memberHook_.unlink();
+  n->urgency_ = urgency;
+  n->incremental_ = incremental;
+  buckets_[urgency].members.push_back(*n);
+  if (enqueued) {
+    enqueue(n);
+  }
+  return handle;
+}
+
+void
+RFC9218PriorityQueue::removeTransaction(Handle handle) {
+  auto n = node(handle);
+  if (n->isEnqueued()) {
+    dequeue(n);
+  }
+  // unlinks itself from members
+  delete n;
+  numNodes_--;
+}
+
+void
+RFC9218PriorityQueue::signalPendingEgress(Handle h) {
+  auto n = node(h);
+  if (!n->isEnqueued()) {
+    enqueue(n);
+  }
+}
+
+void
+RFC9218PriorityQueue::clearPendingEgress(Handle h) {
+  auto n = node(h);
+  if (n->isEnqueued()) {
+    dequeue(n);
+  }
+}
+
+void
+RFC9218PriorityQueue::enqueue(Node* n) {
+  auto& bucket = buckets_[n->urgency_];
+  if (n->incremental_) {
+    bucket.incremental.push_back(*n);
+    bucket.numIncremental++;
+  } else {
+    // Non-incremental streams are served in stream order.  New streams have
+    // the highest ID, so the search from the back is short.
+    auto it = bucket.sequential.end();
+    while (it != bucket.sequential.begin()) {
+      auto prev = std::prev(it);
+      if (prev->id_ < n->id_) {
+        break;
+      }
+      it = prev;
+    }
+    bucket.sequential.insert(it, *n);
+  }
+  pendingMask_ |= (1 << n->urgency_);
+  activeCount_++;
+}
+
+void
+RFC9218PriorityQueue::dequeue(Node* n) {
+  auto& bucket = buckets_[n->urgency_];
+  n->egressHook_.unlink();
+  if (n->incremental_) {
+    DCHECK_GT(bucket.numIncremental, 0);
+    bucket.numIncremental--;
+  }
+  if (bucket.sequential.empty() && bucket.incremental.empty()) {
+    pendingMask_ &= ~(1 << n->urgency_);
+  }
+  DCHECK_GT(activeCount_, 0);
+  activeCount_--;
+}
+
+void
+RFC9218PriorityQueue::nextEgress(NextEgressResult& result,
+                                 bool /*spdyMode*/) {
+  if (pendingMask_ == 0) {
+    return;
+  }
+  auto& bucket = buckets_[folly::findFirstSet(pendingMask_) - 1];
+  if (!bucket.sequential.empty()) {
+    result.emplace_back(bucket.sequential.front().txn_, 1.0);
+    return;
+  }
+  DCHECK_GT(bucket.numIncremental, 0);
+  double ratio = 1.0 / bucket.numIncremental;
+  result.reserve(result.size() + bucket.numIncremental);
+  for (auto& n : bucket.incremental) {
+    result.emplace_back(n.txn_, ratio);
+  }
+  if (bucket.numIncremental > 1) {
+    // Rotate, so a write that runs out of budget does not always favor the
+    // same stream
+    auto& front = bucket.incremental.front();
+    front.egressHook_.unlink();
+    bucket.incremental.push_back(front);
+  }
+}
+
+void
+RFC9218PriorityQueue::iterateTransactions(
+    const std::function<void(HTTPTransaction*)>& fn,
+    const std::function<bool()>& stopFn) {
+  std::vector<HTTPTransaction*> txns;
+  for (auto& bucket : buckets_) {
+    if (stopFn()) {
+      return;
+    }
+    // fn may reprioritize or remove nodes, so snapshot the level first
+    txns.clear();
+    for (auto& n : bucket.members) {
+      if (n.txn_) {
+        txns.push_back(n.txn_);
+      }
+    }
+    for (auto txn : txns) {
+      fn(txn);
+    }
+  }
+}
+
+}
@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IntrusiveList.h>
+#include <folly/Range.h>
+#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
+
+#include <array>
+
+namespace proxygen {
+
+/**
+ * Egress scheduler following the RFC 9218 extensible priority scheme.
+ * Streams are placed in one of eight urgency buckets, 0 being the most
+ * urgent.  Only the most urgent bucket with pending egress is served: its
+ * non-incremental streams one at a time in stream order, otherwise its
+ * incremental streams sharing the egress equally.
+ *
+ * There is no dependency tree, so adding, removing and (un)enqueueing a
+ * stream are all O(1) and nextEgress() does not walk idle streams.
+ *
+ * Priorities given as http2::PriorityUpdate (from PRIORITY frames or
+ * HTTPTransaction) are mapped onto urgencies by weight, with the default
+ * weight of 16 landing on the default urgency of 3 and the dependency
+ * ignored.
+ */
+class RFC9218PriorityQueue : public HTTPEgressPriorityQueue {
+ public:
+  static const uint8_t kNumUrgencies = 8;
+  static const uint8_t kDefaultUrgency = 3;
+
+  explicit RFC9218PriorityQueue(HTTPCodec::StreamID rootNodeId = 0)
+      : HTTPEgressPriorityQueue(rootNodeId) {}
+
+  ~RFC9218PriorityQueue() override;
+
+  // Urgency a RFC 7540 priority maps to, by weight only
+  static uint8_t urgencyFromPriority(const http2::PriorityUpdate& pri);
+
+  // RFC 7540 priority depending on rootId with the smallest weight that
+  // maps onto urgency
+  static http2::PriorityUpdate priorityFromUrgency(uint8_t urgency,
+                                                   HTTPCodec::StreamID rootId);
+
+  /**
+   * Urgency and incremental flag of a Priority header field value
+   * ("u=1, i").  Missing or invalid parameters keep their defaults of
+   * kDefaultUrgency and non incremental, unknown ones are ignored.
+   */
+  static void parsePriorityField(folly::StringPiece value, uint8_t& urgency,
+                                 bool& incremental);
+
+  Handle addTransaction(HTTPCodec::StreamID id, http2::PriorityUpdate pri,
+                        HTTPTransaction *txn, bool permanent = false,
+                        uint64_t* depth = nullptr) override;
+
+  Handle addTransaction(HTTPCodec::StreamID id, uint8_t urgency,
+                        bool incremental, HTTPTransaction *txn);
+
+  Handle updatePriority(Handle handle, http2::PriorityUpdate pri,
+                        uint64_t* depth = nullptr) override;
+
+  Handle updatePriority(Handle handle, uint8_t urgency, bool incremental);
+
+  void removeTransaction(Handle handle) override;
+
+  void signalPendingEgress(Handle h) override;
+
+  void clearPendingEgress(Handle h) override;
+
+  // There are no placeholder nodes, the tree structure is ignored
+  void addPriorityNode(HTTPCodec::StreamID, HTTPCodec::StreamID) override {}
+
+  void addOrUpdatePriorityNode(HTTPCodec::StreamID,
+                               http2::PriorityUpdate) override {}
+
+  void dropPriorityNodes() override {}
+
+  bool empty() const override {
+    return activeCount_ == 0;
+  }
+
+  uint64_t numPendingEgress() const override {
+    return activeCount_;
+  }
+
+  size_t getMemoryUsage() const override {
+    return numNodes_ * sizeof(Node);
+  }
+
+  // spdyMode is irrelevant, only one urgency is ever returned
+  void nextEgress(NextEgressResult& result, bool spdyMode = false) override;
+
+  void iterateTransactions(const std::function<void(HTTPTransaction*)>& fn,
+                           const std::function<bool()>& stopFn) override;
+
+ private:
+  class Node : public BaseNode {
+   public:
+    Node(HTTPCodec::StreamID id, uint8_t urgency, bool incremental,
+         HTTPTransaction* txn)
+        : id_(id), txn_(txn), urgency_(urgency), incremental_(incremental) {}
+
+    bool isEnqueued() const override {
+      return egressHook_.is_linked();
+    }
+
+    uint64_t calculateDepth(bool /*includeVirtual*/ = true) const override {
+      return 1;
+    }
+
+    HTTPCodec::StreamID id_;
+    HTTPTransaction* txn_;
+    uint8_t urgency_;
+    bool incremental_;
+    // In Bucket::members for its urgency, for the lifetime of the node
+    folly::IntrusiveListHook memberHook_;
+    // In Bucket::sequential or Bucket::incremental while enqueued
+    folly::IntrusiveListHook egressHook_;
+  };
+
+  using MemberList = folly::IntrusiveList<Node, &Node::memberHook_>;
+  using EgressList = folly::IntrusiveList<Node, &Node::egressHook_>;
+
+  struct Bucket {
+    MemberList members;
+    EgressList sequential;
+    EgressList incremental;
+    size_t numIncremental{0};
+  };
+
+  static Node* node(Handle h) {
+    return static_cast<Node*>(h);
+  }
+
+  void enqueue(Node* n);
+  void dequeue(Node* n);
+
+  std::array<Bucket, kNumUrgencies> buckets_;
+  // Bit u is set iff buckets_[u] has enqueued nodes
+  uint8_t pendingMask_{0};
+  uint64_t activeCount_{0};
+  size_t numNodes_{0};
+};
+
+}
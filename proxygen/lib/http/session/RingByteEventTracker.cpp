@@ -0,0 +1,201 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/RingByteEventTracker.h>
+
+#include <algorithm>
+
+namespace {
+const size_t kInitialRingSize = 16;
+}
+
+namespace proxygen {
+
+RingByteEventTracker::~RingByteEventTracker() {
+  drainByteEvents();
+}
+
+void RingByteEventTracker::absorb(ByteEventTracker&& other) {
+  DCHECK_EQ(size_, 0);
+  auto& events = takeByteEvents(other);
+  while (!events.empty()) {
+    ByteEvent& be = events.front();
+    Event event{be.byteOffset_, be.getTransaction(), TimePoint(),
+                be.eventType_, be.bufferWriteTracked_ != 0};
+    if (be.eventType_ == ByteEvent::PING_REPLY_SENT) {
+      auto ping = dynamic_cast<PingByteEvent*>(&be);
+      event.pingTime = ping ? ping->pingRequestReceivedTime_ :
+        getCurrentTime();
+    } else {
+      event.txn->incrementPendingByteEvents();
+    }
+    insert(size_, event);
+    // releases the transaction reference the event held
+    events.pop_front_and_dispose([](ByteEvent* e) { delete e; });
+  }
+}
+
+size_t RingByteEventTracker::drainByteEvents() {
+  size_t numEvents = ByteEventTracker::drainByteEvents();
+  while (size_ > 0) {
+    auto event = popFront();
+    if (event.txn) {
+      event.txn->decrementPendingByteEvents();
+    }
+    ++numEvents;
+  }
+  return numEvents;
+}
+
+bool RingByteEventTracker::processByteEvents(
+    std::shared_ptr<ByteEventTracker> self,
+    uint64_t bytesWritten) {
+  DCHECK(byteEvents_.empty());
+  bool advanceSOM = false;
+  bool advanceEOM = false;
+
+  while (size_ > 0 && at(0).offset <= bytesWritten) {
+    // Off the ring before any callback, which may add events or hand this
+    // tracker's events to another one
+    auto event = popFront();
+    auto txn = event.txn;
+
+    switch (event.type) {
+    case ByteEvent::FIRST_HEADER_BYTE:
+      txn->onEgressHeaderFirstByte();
+      break;
+    case ByteEvent::FIRST_BYTE:
+      txn->onEgressBodyFirstByte(event.offset);
+      if (callback_) {
+        callback_->onFirstByteEvent(
+            txn, event.offset, event.bufferWriteTracked);
+      }
+      advanceSOM = true;
+      break;
+    case ByteEvent::LAST_BYTE:
+      txn->onEgressBodyLastByte(event.offset);
+      if (callback_) {
+        callback_->onLastByteEvent(
+            txn, event.offset, event.bufferWriteTracked);
+      }
+      advanceEOM = true;
+      break;
+    case ByteEvent::TRACKED_BYTE:
+      txn->onEgressTrackedByte();
+      break;
+    case ByteEvent::PING_REPLY_SENT:
+      if (callback_) {
+        callback_->onPingReplyLatency(
+          millisecondsSince(event.pingTime).count());
+      }
+      break;
+    }
+
+    VLOG(5) << " removing ByteEvent " << ByteEvent(event.offset, event.type);
+    if (txn) {
+      txn->decrementPendingByteEvents();
+    }
+  }
+
+  if (advanceSOM) {
+    somEventProcessed();
+  }
+  if (advanceEOM) {
+    eomEventProcessed();
+  }
+  return self.use_count() == 1;
+}
+
+void RingByteEventTracker::addPingByteEvent(size_t pingSize,
+                                            TimePoint timestamp,
+                                            uint64_t bytesScheduled) {
+  // register a byte event on ping reply sent, and adjust the offset
+  // for others by one ping size
+  uint64_t offset = bytesScheduled + pingSize;
+  size_t pos = size_;
+  for (; pos > 0 && at(pos - 1).offset > bytesScheduled; pos--) {
+    at(pos - 1).offset += pingSize;
+  }
+  insert(pos, Event{offset, nullptr, timestamp,
+                    ByteEvent::PING_REPLY_SENT, false});
+}
+
+void RingByteEventTracker::addFirstBodyByteEvent(uint64_t offset,
+                                                 HTTPTransaction* txn) {
+  addTransactionEvent(offset, ByteEvent::FIRST_BYTE, txn);
+}
+
+void RingByteEventTracker::addFirstHeaderByteEvent(uint64_t offset,
+                                                   HTTPTransaction* txn) {
+  addTransactionEvent(offset, ByteEvent::FIRST_HEADER_BYTE, txn);
+}
+
+void RingByteEventTracker::addLastByteEvent(
+    HTTPTransaction* txn,
+    uint64_t byteNo) noexcept {
+  VLOG(5) << " adding last byte event for " << byteNo;
+  addTransactionEvent(byteNo, ByteEvent::LAST_BYTE, txn);
+}
+
+void RingByteEventTracker::addTrackedByteEvent(
+    HTTPTransaction* txn,
+    uint64_t byteNo) noexcept {
+  VLOG(5) << " adding tracked byte event for " << byteNo;
+  addTransactionEvent(byteNo, ByteEvent::TRACKED_BYTE, txn);
+}
+
+void RingByteEventTracker::spillByteEvents() {
+  while (size_ > 0) {
+    auto event = popFront();
+    ByteEvent* be;
+    if (event.type == ByteEvent::PING_REPLY_SENT) {
+      be = new PingByteEvent(event.offset, event.pingTime);
+    } else {
+      // takes its own reference before the ring's is released
+      be = new TransactionByteEvent(event.offset, event.type, event.txn);
+      event.txn->decrementPendingByteEvents();
+    }
+    be->bufferWriteTracked_ = event.bufferWriteTracked;
+    byteEvents_.push_back(*be);
+  }
+}
+
+void RingByteEventTracker::addTransactionEvent(uint64_t offset,
+                                               ByteEvent::EventType type,
+                                               HTTPTransaction* txn) {
+  txn->incrementPendingByteEvents();
+  insert(size_, Event{offset, txn, TimePoint(), type, false});
+}
+
+void RingByteEventTracker::insert(size_t pos, const Event& event) {
+  DCHECK_LE(pos, size_);
+  if (size_ == ring_.size()) {
+    std::vector<Event> ring(std::max(kInitialRingSize, ring_.size() * 2));
+    for (size_t i = 0; i < size_; i++) {
+      ring[i] = at(i);
+    }
+    ring_ = std::move(ring);
+    head_ = 0;
+  }
+  size_++;
+  for (size_t i = size_ - 1; i > pos; i--) {
+    at(i) = at(i - 1);
+  }
+  at(pos) = event;
+}
+
+RingByteEventTracker::Event RingByteEventTracker::popFront() {
+  DCHECK_GT(size_, 0);
+  auto event = at(0);
+  head_ = (head_ + 1) & (ring_.size() - 1);
+  size_--;
+  return event;
+}
+
+} // proxygen
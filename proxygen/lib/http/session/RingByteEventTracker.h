@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/http/session/ByteEventTracker.h>
+
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * A ByteEventTracker keeping its events by value in a ring rather than one
+ * heap allocated ByteEvent each.  The ring only grows, so once it has been
+ * sized by the session's busiest moment tracking allocates nothing, and
+ * processByteEvents consumes every event up to the written offset from
+ * contiguous storage.
+ *
+ * It tracks what the base class tracks: transport acceptance of the first
+ * header, first body and last bytes, tracked bytes and ping replies.
+ * Trackers timestamping bytes on the NIC or acknowledgement keep using the
+ * ByteEvent subclasses, and can absorb the events of this one.
+ */
+class RingByteEventTracker : public ByteEventTracker {
+ public:
+  explicit RingByteEventTracker(Callback* callback)
+      : ByteEventTracker(callback) {}
+
+  ~RingByteEventTracker() override;
+
+  void absorb(ByteEventTracker&& other) override;
+
+  size_t drainByteEvents() override;
+
+  bool processByteEvents(std::shared_ptr<ByteEventTracker> self,
+                         uint64_t bytesWritten) override;
+
+  void addPingByteEvent(size_t pingSize,
+                        TimePoint timestamp,
+                        uint64_t bytesScheduled) override;
+
+  void addFirstBodyByteEvent(uint64_t offset, HTTPTransaction* txn) override;
+
+  void addFirstHeaderByteEvent(uint64_t offset, HTTPTransaction* txn) override;
+
+  void addLastByteEvent(HTTPTransaction* txn, uint64_t byteNo) noexcept
+    override;
+
+  void addTrackedByteEvent(HTTPTransaction* txn, uint64_t byteNo) noexcept
+    override;
+
+  size_t numPendingByteEvents() const {
+    return size_;
+  }
+
+  size_t getMemoryUsage() const override {
+    return ByteEventTracker::getMemoryUsage() +
+      ring_.capacity() * sizeof(Event);
+  }
+
+ protected:
+  void spillByteEvents() override;
+
+ private:
+  struct Event {
+    uint64_t offset;
+    // null for PING_REPLY_SENT
+    HTTPTransaction* txn;
+    // when the ping was received, for PING_REPLY_SENT
+    TimePoint pingTime;
+    ByteEvent::EventType type;
+    bool bufferWriteTracked;
+  };
+
+  void addTransactionEvent(uint64_t offset, ByteEvent::EventType type,
+                           HTTPTransaction* txn);
+
+  Event& at(size_t i) {
+    return ring_[(head_ + i) & (ring_.size() - 1)];
+  }
+
+  void insert(size_t pos, const Event& event);
+
+  Event popFront();
+
+  // ring_.size() is 0 or a power of 2
+  std::vector<Event> ring_;
+  size_t head_{0};
+  size_t size_{0};
+};
+
+} // proxygen
@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/RttEstimator.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+using std::chrono::microseconds;
+
+namespace proxygen {
+
+void RttEstimator::addSample(microseconds rtt) {
+  rtt = std::max(rtt, microseconds(1));
+  if (samples_ == 0) {
+    srtt_ = rtt;
+    rttVar_ = rtt / 2;
+    minRtt_ = rtt;
+  } else {
+    auto deviation = srtt_ > rtt ? srtt_ - rtt : rtt - srtt_;
+    rttVar_ = (rttVar_ * 3 + deviation) / 4;
+    srtt_ = (srtt_ * 7 + rtt) / 8;
+    minRtt_ = std::min(minRtt_, rtt);
+  }
+  samples_++;
+  VLOG(5) << "RTT sample of " << rtt.count() << "us, srtt=" << srtt_.count()
+          << "us rttvar=" << rttVar_.count() << "us";
+}
+
+void RttEstimator::onPingSent(TimePoint now) {
+  if (pingOutstanding_) {
+    return;
+  }
+  pingOutstanding_ = true;
+  pingTime_ = now;
+}
+
+bool RttEstimator::onPingReply(TimePoint now) {
+  if (!pingOutstanding_) {
+    return false;
+  }
+  pingOutstanding_ = false;
+  addSample(std::chrono::duration_cast<microseconds>(now - pingTime_));
+  return true;
+}
+
+}
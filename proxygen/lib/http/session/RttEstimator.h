@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/utils/Time.h>
+
+#include <chrono>
+
+namespace proxygen {
+
+/**
+ * Smooths the round trip time samples of a connection as RFC6298 does for
+ * TCP: the smoothed RTT moves by 1/8 of each sample, and its variation by
+ * 1/4 of the sample's deviation from it.
+ *
+ * The samples come from addSample(), or from PINGs: onPingSent() starts a
+ * sample unless one is outstanding, and onPingReply() ends it.
+ */
+class RttEstimator {
+ public:
+  void addSample(std::chrono::microseconds rtt);
+
+  void onPingSent(TimePoint now);
+
+  /**
+   * Ends the outstanding PING sample, if any.  Returns whether it did.
+   */
+  bool onPingReply(TimePoint now);
+
+  bool isPingOutstanding() const {
+    return pingOutstanding_;
+  }
+
+  uint64_t getNumSamples() const {
+    return samples_;
+  }
+
+  // 0 before the first sample
+  std::chrono::microseconds getSrtt() const {
+    return srtt_;
+  }
+
+  std::chrono::microseconds getRttVar() const {
+    return rttVar_;
+  }
+
+  std::chrono::microseconds getMinRtt() const {
+    return minRtt_;
+  }
+
+ private:
+  TimePoint pingTime_;
+  std::chrono::microseconds srtt_{0};
+  std::chrono::microseconds rttVar_{0};
+  std::chrono::microseconds minRtt_{0};
+  uint64_t samples_{0};
+  bool pingOutstanding_{false};
+};
+
+}
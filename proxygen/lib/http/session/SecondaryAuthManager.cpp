@@ -14,6 +14,28 @@
 using namespace fizz;
 using folly::io::QueueAppender;
 
+namespace {
+
+std::vector<CertificateEntry> cloneCerts(
+    const std::vector<CertificateEntry>& certs) {
+  std::vector<CertificateEntry> result;
+  result.reserve(certs.size());
+  for (const auto& cert : certs) {
+    CertificateEntry entry;
+    entry.cert_data = cert.cert_data->clone();
+    for (const auto& ext : cert.extensions) {
+      Extension copy;
+      copy.extension_type = ext.extension_type;
+      copy.extension_data = ext.extension_data->clone();
+      entry.extensions.push_back(std::move(copy));
+    }
+    result.push_back(std::move(entry));
+  }
+  return result;
+}
+
+}
+
 namespace proxygen {
 
 SecondaryAuthManager::SecondaryAuthManager(
@@ -51,7 +73,18 @@ SecondaryAuthManager::getAuthenticator(
     TransportDirection dir,
     uint16_t requestId,
     std::unique_ptr<folly::IOBuf> authRequest) {
+  // A repeated request gets the same answer, without signing again
+  folly::IOBufEqualTo equalTo;
+  for (const auto& cached : authenticatorCache_) {
+    if (equalTo(*cached.authRequest, *authRequest)) {
+      numAuthenticatorsReused_++;
+      requestCertMap_.insert(std::make_pair(requestId, cached.certId));
+      return std::make_pair(cached.certId, cached.authenticator->clone());
+    }
+  }
+
   uint16_t certId = certIdCounter_++;
+  auto authRequestClone = authRequest->clone();
   std::unique_ptr<folly::IOBuf> authenticator;
   if (dir == TransportDirection::UPSTREAM) {
     authenticator = fizz::ExportedAuthenticator::getAuthenticator(
@@ -61,6 +94,13 @@ SecondaryAuthManager::getAuthenticator(
         transport, fizz::Direction::DOWNSTREAM, *cert_, std::move(authRequest));
   }
   requestCertMap_.insert(std::make_pair(requestId, certId));
+  if (authenticator) {
+    if (authenticatorCache_.size() == kMaxCachedExchanges) {
+      authenticatorCache_.pop_front();
+    }
+    authenticatorCache_.push_back(CachedAuthenticator{
+        std::move(authRequestClone), certId, authenticator->clone()});
+  }
   return std::make_pair(certId, std::move(authenticator));
 }
 
@@ -69,9 +109,22 @@ bool SecondaryAuthManager::validateAuthenticator(
     TransportDirection dir,
     uint16_t certId,
     std::unique_ptr<folly::IOBuf> authenticator) {
+  // The same authenticator again proves the same identity
+  folly::IOBufEqualTo equalTo;
+  for (const auto& cached : peerCertCache_) {
+    if (equalTo(*cached.authenticator, *authenticator)) {
+      numValidationsReused_++;
+      if (!cached.certs.empty()) {
+        receivedCerts_.insert(std::make_pair(certId, cloneCerts(cached.certs)));
+      }
+      return true;
+    }
+  }
+
   // Verify the certificate_request_context contains the Request-ID of a
   // previously-sent "CERTIFICATE_REQUEST".
   auto authClone = authenticator->clone();
+  auto cacheKey = authenticator->clone();
   auto authRequest = verifyContext(std::move(authClone));
   if (!authRequest) {
     return false;
@@ -93,7 +146,13 @@ bool SecondaryAuthManager::validateAuthenticator(
   }
   if (!certs) {
     return false;
-  } else if ((*certs).size() == 0) {
+  }
+  if (peerCertCache_.size() == kMaxCachedExchanges) {
+    peerCertCache_.pop_front();
+  }
+  peerCertCache_.push_back(
+      CachedPeerCert{std::move(cacheKey), cloneCerts(*certs)});
+  if ((*certs).size() == 0) {
     VLOG(4) << "Peer does not have appropriate certificate or does not want to "
                "provide one, empty authenticator received";
   } else {
@@ -110,13 +169,15 @@ SecondaryAuthManager::verifyContext(
           std::move(authenticator));
   folly::io::Cursor cursor(certRequestContext.get());
   uint16_t requestId = cursor.readBE<uint16_t>();
-  if (outstandingRequests_.find(requestId) == outstandingRequests_.end()) {
+  auto it = outstandingRequests_.find(requestId);
+  // Unknown, or already used by another authenticator
+  if (it == outstandingRequests_.end() || !it->second) {
     VLOG(4) << "No previous CERTIFICATE_REQUEST matches the the CERTIFICATE "
                "with Request-ID="
             << requestId;
     return folly::none;
   }
-  auto authRequest = std::move(outstandingRequests_[requestId]);
+  auto authRequest = std::move(it->second);
   return authRequest;
 }
 
@@ -9,13 +9,28 @@
  */
 #pragma once
 
+#include <deque>
 #include <fizz/protocol/Certificate.h>
 #include <proxygen/lib/http/session/SecondaryAuthManagerBase.h>
 
 namespace proxygen {
 
+/**
+ * Exported authenticators (and their requests) for the secondary
+ * certificate frames of a session.
+ *
+ * The last kMaxCachedExchanges authenticators generated, and peer
+ * certificate chains validated, are kept: an authenticator request the
+ * peer repeats is answered with the authenticator already signed for it,
+ * under the same Cert-ID, and an authenticator received again is accepted
+ * with the chain it had, without verifying its signature anew.  The keys
+ * are the exact bytes of the request (resp. authenticator), which bind the
+ * certificate_request_context, so nothing is reused across requests.
+ */
 class SecondaryAuthManager : public SecondaryAuthManagerBase {
  public:
+  static constexpr size_t kMaxCachedExchanges = 8;
+
   explicit SecondaryAuthManager(std::unique_ptr<fizz::SelfCert> cert);
 
   SecondaryAuthManager() = default;
@@ -49,7 +64,29 @@ class SecondaryAuthManager : public SecondaryAuthManagerBase {
   folly::Optional<std::vector<fizz::CertificateEntry>> getPeerCert(
       uint16_t certId);
 
+  // Exchanges answered from the caches
+  uint32_t getNumAuthenticatorsReused() const {
+    return numAuthenticatorsReused_;
+  }
+
+  uint32_t getNumValidationsReused() const {
+    return numValidationsReused_;
+  }
+
  private:
+  // An authenticator generated for a request
+  struct CachedAuthenticator {
+    std::unique_ptr<folly::IOBuf> authRequest;
+    uint16_t certId;
+    std::unique_ptr<folly::IOBuf> authenticator;
+  };
+
+  // The certificates of a peer authenticator validated
+  struct CachedPeerCert {
+    std::unique_ptr<folly::IOBuf> authenticator;
+    std::vector<fizz::CertificateEntry> certs;
+  };
+
   uint16_t requestIdCounter_{0};
   uint16_t certIdCounter_{0};
 
@@ -76,6 +113,12 @@ class SecondaryAuthManager : public SecondaryAuthManagerBase {
   // Locally cached certificates which authenticates the secondary identity of
   // the peer.
   std::map<uint16_t, std::vector<fizz::CertificateEntry>> receivedCerts_;
+
+  // Oldest first, at most kMaxCachedExchanges each
+  std::deque<CachedAuthenticator> authenticatorCache_;
+  std::deque<CachedPeerCert> peerCertCache_;
+  uint32_t numAuthenticatorsReused_{0};
+  uint32_t numValidationsReused_{0};
 };
 
 } // namespace proxygen
@@ -0,0 +1,43 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/SessionMemoryBudget.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+uint64_t SessionMemoryBudget::getShare() const {
+  // Some session is over it whenever they all are over the limit together
+  return getLimit() / std::max<uint64_t>(getNumSessions(), 1);
+}
+
+void SessionMemoryBudget::removeSession(uint64_t bytes) {
+  update(-static_cast<int64_t>(bytes));
+  auto prev = sessions_.fetch_sub(1, std::memory_order_relaxed);
+  DCHECK_GT(prev, 0);
+}
+
+void SessionMemoryBudget::update(int64_t delta) {
+  if (delta <= 0) {
+    auto prev = usage_.fetch_sub(uint64_t(-delta), std::memory_order_relaxed);
+    DCHECK_GE(prev, uint64_t(-delta));
+    return;
+  }
+  auto usage =
+    usage_.fetch_add(uint64_t(delta), std::memory_order_relaxed) + delta;
+  auto highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+  while (usage > highWaterMark &&
+         !highWaterMark_.compare_exchange_weak(highWaterMark, usage,
+                                               std::memory_order_relaxed)) {
+  }
+}
+
+}
@@ -0,0 +1,91 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace proxygen {
+
+/**
+ * A limit on the bytes a group of sessions buffer together in one
+ * direction.  For egress that is the body their transactions hold back and
+ * what sits in their sockets' write buffers, for ingress the body read but
+ * not yet processed by their transactions.  Sessions may share one per
+ * process or per worker, and from any thread.
+ *
+ * Each session still applies its own buffer limit.  Once the group is over
+ * the budget, the sessions buffering more than an even share of it pause
+ * too, so the biggest go first and the small ones keep going.  They resume
+ * as their buffers drain under the share, or the group's go under the
+ * budget.  Lowering the limit tightens it the same way.
+ */
+class SessionMemoryBudget {
+ public:
+  explicit SessionMemoryBudget(uint64_t limit) : limit_(limit) {}
+
+  uint64_t getLimit() const {
+    return limit_.load(std::memory_order_relaxed);
+  }
+
+  void setLimit(uint64_t limit) {
+    limit_.store(limit, std::memory_order_relaxed);
+  }
+
+  /** The bytes the sessions buffer now */
+  uint64_t getUsage() const {
+    return usage_.load(std::memory_order_relaxed);
+  }
+
+  /** The most bytes the sessions buffered since the last reset */
+  uint64_t getHighWaterMark() const {
+    return highWaterMark_.load(std::memory_order_relaxed);
+  }
+
+  void resetHighWaterMark() {
+    highWaterMark_.store(getUsage(), std::memory_order_relaxed);
+  }
+
+  uint64_t getNumSessions() const {
+    return sessions_.load(std::memory_order_relaxed);
+  }
+
+  bool isOverLimit() const {
+    return getUsage() > getLimit();
+  }
+
+  /** An even share of the limit between the sessions */
+  uint64_t getShare() const;
+
+  /**
+   * Returns true iff a session buffering bytes should stop.
+   */
+  bool isExceededBy(uint64_t bytes) const {
+    return isOverLimit() && bytes > getShare();
+  }
+
+  void addSession() {
+    sessions_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** Releases the bytes the session still buffers */
+  void removeSession(uint64_t bytes);
+
+  /** Accounts delta more (or fewer) bytes buffered by a session */
+  void update(int64_t delta);
+
+ private:
+  std::atomic<uint64_t> limit_;
+  std::atomic<uint64_t> usage_{0};
+  std::atomic<uint64_t> highWaterMark_{0};
+  std::atomic<uint64_t> sessions_{0};
+};
+
+}
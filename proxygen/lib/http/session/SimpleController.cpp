@@ -11,6 +11,7 @@
 
 #include <proxygen/lib/http/session/CodecErrorResponseHandler.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
+#include <proxygen/lib/http/session/HTTPErrorPage.h>
 #include <proxygen/lib/http/session/HTTPSessionAcceptor.h>
 
 namespace proxygen {
@@ -55,9 +56,18 @@ HTTPTransactionHandler* SimpleController::createErrorHandler(
     const std::string& statusMessage,
     const HTTPErrorPage* errorPage) {
 
-  return new HTTPDirectResponseHandler(statusCode,
-                                       statusMessage,
-                                       errorPage);
+  if (errorPage && !errorPage->isCacheable()) {
+    return new HTTPDirectResponseHandler(statusCode,
+                                         statusMessage,
+                                         errorPage);
+  }
+  auto& cached = errorResponses_[std::make_pair(statusCode, errorPage)];
+  if (!cached.response || cached.statusMessage != statusMessage) {
+    cached.statusMessage = statusMessage;
+    cached.response = std::make_shared<const HTTPDirectResponse>(
+      statusCode, statusMessage, errorPage);
+  }
+  return new HTTPDirectResponseHandler(cached.response);
 }
 
 std::chrono::milliseconds SimpleController::getGracefulShutdownTimeout() const {
@@ -9,11 +9,14 @@
  */
 #pragma once
 
+#include <map>
+#include <memory>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <string>
 
 namespace proxygen {
 
+class HTTPDirectResponse;
 class HTTPErrorPage;
 class HTTPSessionAcceptor;
 
@@ -55,13 +58,36 @@ class SimpleController : public HTTPSessionController {
   void detachSession(const HTTPSessionBase*) override;
 
   std::chrono::milliseconds getGracefulShutdownTimeout() const override;
+
+  /**
+   * Drops the error responses built so far, for a change of the acceptor's
+   * error pages.
+   */
+  void clearErrorResponses() {
+    errorResponses_.clear();
+  }
+
  protected:
+  /**
+   * The responses of the pages that are cacheable, or of no page, are
+   * built once and shared by the handlers sending them.
+   */
   HTTPTransactionHandler* createErrorHandler(
       uint32_t statusCode,
       const std::string& statusMessage,
       const HTTPErrorPage* errorPage);
 
   HTTPSessionAcceptor* const acceptor_{nullptr};
+
+ private:
+  struct ErrorResponse {
+    std::string statusMessage;
+    std::shared_ptr<const HTTPDirectResponse> response;
+  };
+
+  // By status code and error page
+  std::map<std::pair<uint32_t, const HTTPErrorPage*>, ErrorResponse>
+    errorResponses_;
 };
 
 }
@@ -0,0 +1,358 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/SocketTimestampByteEventTracker.h>
+
+#include <folly/String.h>
+#include <proxygen/lib/http/session/TTLBAStats.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
+
+namespace {
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+// Requested for the last byte of every write with WriteFlags::TIMESTAMP_TX
+const uint32_t kTimestampGenerationFlags =
+  SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_ACK;
+
+// Set on the socket: report software timestamps, identified by byte offset,
+// without looping back the payload
+const uint32_t kTimestampReportingFlags =
+  SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+  SOF_TIMESTAMPING_OPT_TSONLY;
+#endif
+
+std::chrono::nanoseconds realtimeNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch());
+}
+
+}
+
+namespace proxygen {
+
+SocketTimestampByteEventTracker::SocketTimestampByteEventTracker(
+    ByteEventTracker::Callback* callback,
+    folly::EventBase* eventBase,
+    std::chrono::milliseconds timeout,
+    uint32_t maxPendingEvents)
+    : ByteEventTracker(callback),
+      timeouts_(new AsyncTimeoutSet(eventBase, timeout)),
+      maxPendingEvents_(maxPendingEvents) {
+}
+
+SocketTimestampByteEventTracker::~SocketTimestampByteEventTracker() {
+  disableSocketTimestampEvents();
+}
+
+bool SocketTimestampByteEventTracker::enableSocketTimestamps(
+    folly::AsyncSocket* socket) {
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  DCHECK(!socket_);
+  uint32_t flags = kTimestampReportingFlags;
+  if (socket->setSockOpt(SOL_SOCKET, SO_TIMESTAMPING, &flags) != 0) {
+    VLOG(2) << "Failed to enable SO_TIMESTAMPING, err="
+            << folly::errnoStr(errno);
+    return false;
+  }
+  socket_ = socket;
+  socketBaseOffset_ = socket->getRawBytesWritten();
+  socket_->setErrMessageCB(this);
+  socket_->setSendMsgParamCB(this);
+  return true;
+#else
+  (void)socket;
+  return false;
+#endif
+}
+
+size_t SocketTimestampByteEventTracker::disableSocketTimestampEvents() {
+  if (socket_) {
+    // Only writes asking for it are timestamped, the option can stay set
+    socket_->setErrMessageCB(nullptr);
+    socket_->setSendMsgParamCB(nullptr);
+    socket_ = nullptr;
+  }
+  disabled_ = true;
+  pendingTimestamp_ = folly::none;
+  return drainTimestampEvents();
+}
+
+size_t SocketTimestampByteEventTracker::drainByteEvents() {
+  size_t numEvents = ByteEventTracker::drainByteEvents();
+  return numEvents + drainTimestampEvents();
+}
+
+size_t SocketTimestampByteEventTracker::drainTimestampEvents() {
+  size_t numEvents = 0;
+  // deleting an event cancels its timeout and releases its transaction
+  while (!txEvents_.empty()) {
+    txEvents_.pop_front_and_dispose([](ByteEvent* event) { delete event; });
+    ++numEvents;
+  }
+  while (!ackEvents_.empty()) {
+    ackEvents_.pop_front_and_dispose([](ByteEvent* event) { delete event; });
+    ++numEvents;
+  }
+  return numEvents;
+}
+
+uint64_t SocketTimestampByteEventTracker::preSend(bool* /*cork*/,
+                                                  bool* som,
+                                                  bool* eom,
+                                                  uint64_t bytesWritten) {
+  if (disabled_) {
+    return 0;
+  }
+  auto it = byteEvents_.begin();
+  for (; it != byteEvents_.end(); ++it) {
+    if (it->byteOffset_ <= std::max(bytesWritten, examinedOffset_) ||
+        (it->eventType_ != ByteEvent::FIRST_BYTE &&
+         it->eventType_ != ByteEvent::LAST_BYTE)) {
+      continue;
+    }
+    examinedOffset_ = it->byteOffset_;
+    if (!pendingLimitReached()) {
+      break;
+    }
+    if (stats_) {
+      if (it->eventType_ == ByteEvent::LAST_BYTE) {
+        stats_->recordTTLBAExceedLimit();
+      } else {
+        stats_->recordTTBTXExceedLimit();
+      }
+    }
+  }
+  if (it == byteEvents_.end()) {
+    return 0;
+  }
+
+  // End the write on this byte, timestamping everything it starts or ends
+  uint64_t offset = it->byteOffset_;
+  for (; it != byteEvents_.end() && it->byteOffset_ == offset; ++it) {
+    if (it->eventType_ == ByteEvent::FIRST_BYTE) {
+      *som = true;
+    } else if (it->eventType_ == ByteEvent::LAST_BYTE) {
+      *eom = true;
+    } else {
+      continue;
+    }
+    it->bufferWriteTracked_ = 1;
+  }
+  VLOG(5) << "tracking socket timestamps of the write ending at " << offset;
+  return offset - bytesWritten;
+}
+
+void SocketTimestampByteEventTracker::addTxByteEvent(
+    uint64_t offset,
+    ByteEvent::EventType eventType,
+    HTTPTransaction* txn) {
+  if (disabled_) {
+    return;
+  }
+  VLOG(5) << "adding TX byte event for raw offset " << offset;
+  auto event = new TxByteEvent(this, offset, eventType, txn);
+  txEvents_.push_back(*event);
+  timeouts_->scheduleTimeout(event);
+  if (stats_) {
+    stats_->recordTTBTXTracked();
+  }
+}
+
+void SocketTimestampByteEventTracker::addAckByteEvent(uint64_t offset,
+                                                      HTTPTransaction* txn) {
+  if (disabled_) {
+    return;
+  }
+  VLOG(5) << "adding ACK byte event for raw offset " << offset;
+  auto event = new AckByteEvent(this, offset, ByteEvent::LAST_BYTE, txn);
+  // until the TX timestamp arrives
+  event->sentTime = realtimeNow();
+  ackEvents_.push_back(*event);
+  timeouts_->scheduleTimeout(&event->timeout);
+  if (stats_) {
+    stats_->recordTTLBATracked();
+  }
+}
+
+void SocketTimestampByteEventTracker::onSocketTimestamp(
+    TimestampType type,
+    uint64_t rawOffset,
+    std::chrono::nanoseconds timestamp) {
+  // Timestamps arrive in byte order, so events before rawOffset are not
+  // getting theirs
+  auto& events = (type == TimestampType::TX) ? txEvents_ : ackEvents_;
+  bool found = false;
+  while (!events.empty() && events.front().byteOffset_ <= rawOffset) {
+    // off the list before any callback, which may drain the tracker
+    std::unique_ptr<ByteEvent> event(&events.front());
+    events.pop_front();
+    auto txn = event->getTransaction();
+
+    if (event->byteOffset_ < rawOffset) {
+      VLOG(4) << "no " << (type == TimestampType::TX ? "TX" : "ACK")
+              << " timestamp for raw offset " << event->byteOffset_;
+      if (stats_) {
+        if (type == TimestampType::TX) {
+          stats_->recordTTBTXNotFound();
+        } else {
+          stats_->recordTTLBAEomPassed();
+        }
+      }
+      continue;
+    }
+
+    found = true;
+    if (type == TimestampType::TX) {
+      if (stats_) {
+        stats_->recordTTBTXReceived();
+      }
+      if (event->eventType_ == ByteEvent::FIRST_BYTE) {
+        txn->onEgressBodyFirstByteTX();
+      } else {
+        for (auto& ackEvent : ackEvents_) {
+          if (ackEvent.byteOffset_ == rawOffset) {
+            static_cast<AckByteEvent&>(ackEvent).sentTime = timestamp;
+          }
+        }
+        txn->onEgressBodyLastByteTX();
+      }
+    } else {
+      if (stats_) {
+        stats_->recordTTLBAReceived();
+      }
+      auto sentTime = static_cast<AckByteEvent*>(event.get())->sentTime;
+      auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        timestamp - sentTime);
+      txn->onEgressLastByteAck(
+        std::max(latency, std::chrono::milliseconds(0)));
+    }
+  }
+
+  if (!found && type == TimestampType::ACK && stats_) {
+    stats_->recordTTLBANotFound();
+  }
+}
+
+void SocketTimestampByteEventTracker::txTimeoutExpired(
+    TxByteEvent* event) noexcept {
+  VLOG(4) << "TX timestamp timed out for raw offset " << event->byteOffset_;
+  txEvents_.erase(txEvents_.iterator_to(*event));
+  delete event;
+  if (stats_) {
+    stats_->recordTTBTXTimeout();
+  }
+}
+
+void SocketTimestampByteEventTracker::ackTimeoutExpired(
+    uint64_t byteNo) noexcept {
+  VLOG(4) << "ACK timestamp timed out for raw offset " << byteNo;
+  for (auto it = ackEvents_.begin(); it != ackEvents_.end();) {
+    if (it->byteOffset_ == byteNo) {
+      it = ackEvents_.erase_and_dispose(
+        it, [](ByteEvent* event) { delete event; });
+      if (stats_) {
+        stats_->recordTTLBATimeout();
+      }
+    } else {
+      ++it;
+    }
+  }
+}
+
+void SocketTimestampByteEventTracker::errMessage(
+    const cmsghdr& cmsg) noexcept {
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  if (cmsg.cmsg_level == SOL_SOCKET && cmsg.cmsg_type == SCM_TIMESTAMPING) {
+    auto tss = reinterpret_cast<const struct scm_timestamping*>(
+      CMSG_DATA(&cmsg));
+    pendingTimestamp_ = std::chrono::seconds(tss->ts[0].tv_sec) +
+      std::chrono::nanoseconds(tss->ts[0].tv_nsec);
+    return;
+  }
+  if (!(cmsg.cmsg_level == SOL_IP && cmsg.cmsg_type == IP_RECVERR) &&
+      !(cmsg.cmsg_level == SOL_IPV6 && cmsg.cmsg_type == IPV6_RECVERR)) {
+    return;
+  }
+  auto serr = reinterpret_cast<const struct sock_extended_err*>(
+    CMSG_DATA(&cmsg));
+  if (serr->ee_errno != ENOMSG ||
+      serr->ee_origin != SO_EE_ORIGIN_TIMESTAMPING || !pendingTimestamp_ ||
+      !socket_) {
+    return;
+  }
+  auto timestamp = *pendingTimestamp_;
+  pendingTimestamp_ = folly::none;
+
+  TimestampType type;
+  switch (serr->ee_info) {
+  case SCM_TSTAMP_SND:
+    type = TimestampType::TX;
+    break;
+  case SCM_TSTAMP_ACK:
+    type = TimestampType::ACK;
+    break;
+  default:
+    return;
+  }
+  // ee_data is the 32 bit id of the timestamped byte, counting from
+  // socketBaseOffset_; widen it from the number of bytes written since
+  uint64_t written = socket_->getRawBytesWritten() - socketBaseOffset_;
+  uint32_t behind = static_cast<uint32_t>(written) - serr->ee_data;
+  uint64_t rawOffset = socketBaseOffset_ + written - behind + 1;
+  onSocketTimestamp(type, rawOffset, timestamp);
+#else
+  (void)cmsg;
+#endif
+}
+
+void SocketTimestampByteEventTracker::errMessageError(
+    const folly::AsyncSocketException& ex) noexcept {
+  VLOG(2) << "Failed to read socket timestamps: " << ex.what();
+  pendingTimestamp_ = folly::none;
+}
+
+uint32_t SocketTimestampByteEventTracker::getAncillaryDataSize(
+    folly::WriteFlags flags) noexcept {
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  if (folly::isSet(flags, folly::WriteFlags::TIMESTAMP_TX)) {
+    return CMSG_SPACE(sizeof(kTimestampGenerationFlags));
+  }
+#else
+  (void)flags;
+#endif
+  return 0;
+}
+
+void SocketTimestampByteEventTracker::getAncillaryData(
+    folly::WriteFlags flags,
+    void* data) noexcept {
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  if (!folly::isSet(flags, folly::WriteFlags::TIMESTAMP_TX)) {
+    return;
+  }
+  auto cmsg = static_cast<cmsghdr*>(data);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SO_TIMESTAMPING;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(kTimestampGenerationFlags));
+  memcpy(CMSG_DATA(cmsg), &kTimestampGenerationFlags,
+         sizeof(kTimestampGenerationFlags));
+#else
+  (void)flags;
+  (void)data;
+#endif
+}
+
+} // proxygen
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/utils/AsyncTimeoutSet.h>
+
+#include <chrono>
+
+namespace proxygen {
+
+/**
+ * A ByteEventTracker that also reports when the first and last body bytes
+ * of a response left the host and when the peer acknowledged the last one,
+ * from the kernel's SO_TIMESTAMPING software TX and ACK timestamps.
+ *
+ * preSend ends each write on a first or last byte so that the kernel
+ * timestamps that write's last byte.  Once the write is accepted the
+ * session registers the raw socket offsets of those bytes through
+ * addTxByteEvent and addAckByteEvent, and the timestamps read from the
+ * socket error queue are matched against them:
+ *
+ *   TX  -> HTTPTransaction::onEgressBodyFirstByteTX / onEgressBodyLastByteTX
+ *   ACK -> HTTPTransaction::onEgressLastByteAck, with the time between the
+ *          TX and ACK timestamps of the last byte
+ *
+ * Events whose timestamp did not arrive within the timeout are dropped.
+ * The outcome of every tracked event is counted in the TTLBAStats.
+ *
+ * The tracker must stay on the EventBase it was created on, and
+ * disableSocketTimestampEvents() must be called before the socket goes away.
+ */
+class SocketTimestampByteEventTracker
+    : public ByteEventTracker
+    , private TxByteEvent::Callback
+    , private AckTimeout::Callback
+    , private folly::AsyncSocket::ErrMessageCallback
+    , private folly::AsyncSocket::SendMsgParamsCallback {
+ public:
+  enum class TimestampType {
+    TX,
+    ACK,
+  };
+
+  static const uint32_t kDefaultMaxPendingEvents = 100;
+
+  SocketTimestampByteEventTracker(
+    ByteEventTracker::Callback* callback,
+    folly::EventBase* eventBase,
+    std::chrono::milliseconds timeout,
+    uint32_t maxPendingEvents = kDefaultMaxPendingEvents);
+
+  ~SocketTimestampByteEventTracker() override;
+
+  /**
+   * Turns timestamping on for socket and starts reading its timestamps.
+   * Returns false if either is not supported, in which case the tracker
+   * still tracks what the base ByteEventTracker does.
+   *
+   * The kernel numbers timestamped bytes from the first unacknowledged one,
+   * so this must be called before anything is written, or once everything
+   * written has been acknowledged.
+   */
+  bool enableSocketTimestamps(folly::AsyncSocket* socket);
+
+  size_t disableSocketTimestampEvents() override;
+
+  size_t drainByteEvents() override;
+
+  void addTxByteEvent(uint64_t offset,
+                      ByteEvent::EventType eventType,
+                      HTTPTransaction* txn) override;
+
+  void addAckByteEvent(uint64_t offset, HTTPTransaction* txn) override;
+
+  uint64_t preSend(bool* cork, bool* som, bool* eom,
+                   uint64_t bytesWritten) override;
+
+  void setTTLBAStats(TTLBAStats* stats) override {
+    stats_ = stats;
+  }
+
+  /**
+   * Delivers a kernel timestamp for the byte ending at raw socket offset
+   * rawOffset.  timestamp is since the CLOCK_REALTIME epoch.
+   */
+  void onSocketTimestamp(TimestampType type,
+                         uint64_t rawOffset,
+                         std::chrono::nanoseconds timestamp);
+
+  size_t numPendingTxEvents() const {
+    return txEvents_.size();
+  }
+
+  size_t numPendingAckEvents() const {
+    return ackEvents_.size();
+  }
+
+ private:
+  // TxByteEvent::Callback
+  void txTimeoutExpired(TxByteEvent* event) noexcept override;
+
+  // AckTimeout::Callback
+  void ackTimeoutExpired(uint64_t byteNo) noexcept override;
+
+  // folly::AsyncSocket::ErrMessageCallback
+  void errMessage(const cmsghdr& cmsg) noexcept override;
+  void errMessageError(const folly::AsyncSocketException& ex) noexcept
+    override;
+
+  // folly::AsyncSocket::SendMsgParamsCallback
+  void getAncillaryData(folly::WriteFlags flags, void* data) noexcept
+    override;
+  uint32_t getAncillaryDataSize(folly::WriteFlags flags) noexcept override;
+
+  size_t drainTimestampEvents();
+
+  bool pendingLimitReached() const {
+    return txEvents_.size() + ackEvents_.size() >= maxPendingEvents_;
+  }
+
+  folly::AsyncSocket* socket_{nullptr};
+  // set once disableSocketTimestampEvents() was called
+  bool disabled_{false};
+  // Raw bytes written to socket_ when timestamping was enabled, which the
+  // kernel's timestamp ids count from
+  uint64_t socketBaseOffset_{0};
+  // The software timestamp of the error queue message being read, which
+  // precedes its sock_extended_err
+  folly::Optional<std::chrono::nanoseconds> pendingTimestamp_;
+
+  AsyncTimeoutSet::UniquePtr timeouts_;
+  uint32_t maxPendingEvents_;
+  // Session offset up to which preSend has decided what to track
+  uint64_t examinedOffset_{0};
+  TTLBAStats* stats_{nullptr};
+
+  // both in the ascending order of the raw socket offset
+  ByteEventList txEvents_;
+  ByteEventList ackEvents_;
+};
+
+} // proxygen
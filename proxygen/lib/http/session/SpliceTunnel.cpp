@@ -0,0 +1,236 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/SpliceTunnel.h>
+
+#include <folly/net/NetOps.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Sockets.h>
+#include <folly/portability/Unistd.h>
+
+namespace {
+// Splices per direction and event before yielding to the loop
+constexpr size_t kMaxSplicesPerPump = 16;
+
+bool wouldBlock(int err) {
+  return err == EAGAIN || err == EWOULDBLOCK;
+}
+}
+
+namespace proxygen {
+
+constexpr size_t SpliceTunnel::kPipeSize;
+
+SpliceTunnel::SpliceTunnel(folly::EventBase* evb,
+                           folly::NetworkSocket downstream,
+                           folly::NetworkSocket upstream,
+                           WheelTimerInstance idleTimeout,
+                           Callback* callback)
+    : downstream_(*this, evb, downstream),
+      upstream_(*this, evb, upstream),
+      timeout_(std::move(idleTimeout)),
+      callback_(callback) {
+}
+
+SpliceTunnel::~SpliceTunnel() {
+  if (initialized_ && !closed_) {
+    closed_ = true;
+    idleTimeout_.cancelTimeout();
+    downstream_.unregisterHandler();
+    upstream_.unregisterHandler();
+    closePipes();
+    folly::netops::close(upstream_.fd());
+  }
+}
+
+void SpliceTunnel::addPendingUpstream(std::unique_ptr<folly::IOBuf> buf) {
+  CHECK(!started_);
+  toUpstream_.pending.append(std::move(buf));
+}
+
+void SpliceTunnel::addPendingDownstream(std::unique_ptr<folly::IOBuf> buf) {
+  CHECK(!started_);
+  toDownstream_.pending.append(std::move(buf));
+}
+
+bool SpliceTunnel::init() {
+  CHECK(!initialized_);
+#ifdef __linux__
+  for (auto dir : {&toUpstream_, &toDownstream_}) {
+    if (::pipe2(dir->pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+      PLOG(ERROR) << "Failed to create a tunnel pipe";
+      closePipes();
+      return false;
+    }
+    // Splices from the socket move up to the pipe's capacity at once
+    ::fcntl(dir->pipe[1], F_SETPIPE_SZ, kPipeSize);
+  }
+  initialized_ = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SpliceTunnel::start() {
+  CHECK(initialized_ && !started_);
+  started_ = true;
+  // Waits for the first bytes rather than relaying any from here
+  downstream_.wantRead = true;
+  upstream_.wantRead = true;
+  downstream_.wantWrite = !toDownstream_.pending.empty();
+  upstream_.wantWrite = !toUpstream_.pending.empty();
+  updateEvents(downstream_);
+  updateEvents(upstream_);
+  timeout_.scheduleTimeout(&idleTimeout_);
+}
+
+void SpliceTunnel::pump() {
+  if (closed_) {
+    return;
+  }
+  bool moved = false;
+  ProxygenError err = kErrorNone;
+  if (!pumpDirection(toUpstream_, moved, err) ||
+      !pumpDirection(toDownstream_, moved, err)) {
+    close(err);
+    return;
+  }
+  if (toUpstream_.done && toDownstream_.done) {
+    close(kErrorNone);
+    return;
+  }
+  if (moved) {
+    timeout_.scheduleTimeout(&idleTimeout_);
+  }
+  updateEvents(downstream_);
+  updateEvents(upstream_);
+}
+
+bool SpliceTunnel::pumpDirection(Direction& dir,
+                                 bool& moved,
+                                 ProxygenError& err) {
+#ifdef __linux__
+  if (dir.done) {
+    return true;
+  }
+  dir.src.wantRead = false;
+  dir.dst.wantWrite = false;
+  for (size_t i = 0; i < kMaxSplicesPerPump; ++i) {
+    // What was read before the tunnel started goes first
+    while (!dir.pending.empty()) {
+      auto front = dir.pending.front();
+      if (front->length() == 0) {
+        dir.pending.pop_front();
+        continue;
+      }
+      auto n = folly::netops::send(dir.dst.fd(), front->data(),
+                                   front->length(), MSG_NOSIGNAL);
+      if (n < 0) {
+        if (wouldBlock(errno)) {
+          dir.dst.wantWrite = true;
+          return true;
+        }
+        err = kErrorWrite;
+        return false;
+      }
+      dir.pending.trimStart(n);
+      dir.bytes += n;
+      moved = true;
+    }
+    while (dir.inPipe > 0) {
+      auto n = ::splice(dir.pipe[0], nullptr, dir.dst.fd().toFd(), nullptr,
+                        dir.inPipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (n < 0) {
+        if (wouldBlock(errno)) {
+          dir.dst.wantWrite = true;
+          return true;
+        }
+        err = kErrorWrite;
+        return false;
+      }
+      dir.inPipe -= n;
+      dir.bytes += n;
+      moved = true;
+    }
+    if (dir.srcEOF) {
+      folly::netops::shutdown(dir.dst.fd(), SHUT_WR);
+      dir.done = true;
+      return true;
+    }
+    // Only with the pipe empty, so that 0 is the EOF
+    auto n = ::splice(dir.src.fd().toFd(), nullptr, dir.pipe[1], nullptr,
+                      kPipeSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n < 0) {
+      if (wouldBlock(errno)) {
+        dir.src.wantRead = true;
+        return true;
+      }
+      err = errno == ECONNRESET ? kErrorConnectionReset : kErrorRead;
+      return false;
+    }
+    if (n == 0) {
+      dir.srcEOF = true;
+      moved = true;
+    }
+    dir.inPipe += n;
+  }
+  // Yields with bytes in the pipe, which the destination being writable
+  // resumes with
+  dir.dst.wantWrite = true;
+  return true;
+#else
+  (void)dir;
+  (void)moved;
+  err = kErrorUnknown;
+  return false;
+#endif
+}
+
+void SpliceTunnel::updateEvents(Socket& sock) {
+  uint16_t events = (sock.wantRead ? folly::EventHandler::READ : 0) |
+    (sock.wantWrite ? folly::EventHandler::WRITE : 0);
+  if (events == 0) {
+    sock.unregisterHandler();
+    return;
+  }
+  events |= folly::EventHandler::PERSIST;
+  if (!sock.isHandlerRegistered() || sock.getRegisteredEvents() != events) {
+    sock.registerHandler(events);
+  }
+}
+
+void SpliceTunnel::close(ProxygenError err) {
+  if (closed_) {
+    return;
+  }
+  VLOG(4) << "Tunnel closed err=" << getErrorString(err)
+          << " bytesUpstream=" << toUpstream_.bytes
+          << " bytesDownstream=" << toDownstream_.bytes;
+  closed_ = true;
+  idleTimeout_.cancelTimeout();
+  downstream_.unregisterHandler();
+  upstream_.unregisterHandler();
+  closePipes();
+  folly::netops::close(upstream_.fd());
+  callback_->onTunnelClosed(*this, err);
+}
+
+void SpliceTunnel::closePipes() {
+  for (auto dir : {&toUpstream_, &toDownstream_}) {
+    for (auto& fd : dir->pipe) {
+      if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+  }
+}
+
+}
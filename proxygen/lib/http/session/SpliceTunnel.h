@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/net/NetworkSocket.h>
+#include <proxygen/lib/http/ProxygenErrorEnum.h>
+#include <proxygen/lib/utils/WheelTimerInstance.h>
+
+namespace proxygen {
+
+/**
+ * Relays the bytes of a tunnel between two connected, non-blocking TCP
+ * sockets with splice(2), through a pipe per direction, so they never
+ * reach user space.
+ *
+ * A direction ends when its source reads EOF, with the write side of its
+ * destination shut down once the pipe drained; the tunnel closes once both
+ * directions have, on the first error, or when idleTimeout passes without
+ * a byte moving either way.  Bytes already read from a socket before the
+ * tunnel started can be passed to it, and are written ahead of the rest.
+ *
+ * The tunnel does not own the downstream socket, which is only polled while
+ * it runs, but closes the upstream one.  Only on Linux; init() fails
+ * elsewhere.  splice(2) raises SIGPIPE on a reset socket, which the
+ * thread must block or ignore, as WorkerThread does.
+ */
+class SpliceTunnel {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {}
+
+    /**
+     * Both directions ended (kErrorNone), or the tunnel failed with err.
+     * The tunnel may be deleted from this callback.
+     */
+    virtual void onTunnelClosed(SpliceTunnel& tunnel,
+                                ProxygenError err) noexcept = 0;
+  };
+
+  static constexpr size_t kPipeSize = 64 * 1024;
+
+  SpliceTunnel(folly::EventBase* evb,
+               folly::NetworkSocket downstream,
+               folly::NetworkSocket upstream,
+               WheelTimerInstance idleTimeout,
+               Callback* callback);
+
+  ~SpliceTunnel();
+
+  SpliceTunnel(const SpliceTunnel&) = delete;
+  SpliceTunnel& operator=(const SpliceTunnel&) = delete;
+
+  /**
+   * Creates the pipes.  Returns false if it could not, and the upstream
+   * socket is still the caller's; otherwise it is the tunnel's, to be
+   * detached from any AsyncSocket.
+   */
+  bool init();
+
+  /**
+   * Bytes read from downstream (resp. upstream) before the tunnel started,
+   * to relay first.  Only before start().
+   */
+  void addPendingUpstream(std::unique_ptr<folly::IOBuf> buf);
+  void addPendingDownstream(std::unique_ptr<folly::IOBuf> buf);
+
+  /**
+   * Starts relaying, after init(), once neither socket has writes pending.
+   * The callback is never invoked from here.
+   */
+  void start();
+
+  bool isStarted() const {
+    return started_;
+  }
+
+  /** Bytes written to upstream, including the pending ones */
+  uint64_t getBytesUpstream() const {
+    return toUpstream_.bytes;
+  }
+
+  /** Bytes written to downstream, including the pending ones */
+  uint64_t getBytesDownstream() const {
+    return toDownstream_.bytes;
+  }
+
+ private:
+  // A socket, with the events the directions reading and writing it wait for
+  class Socket : public folly::EventHandler {
+   public:
+    Socket(SpliceTunnel& tunnel, folly::EventBase* evb,
+           folly::NetworkSocket fd)
+        : folly::EventHandler(evb, fd), tunnel_(tunnel), fd_(fd) {}
+
+    void handlerReady(uint16_t /*events*/) noexcept override {
+      tunnel_.pump();
+    }
+
+    folly::NetworkSocket fd() const {
+      return fd_;
+    }
+
+    bool wantRead{false};
+    bool wantWrite{false};
+
+   private:
+    SpliceTunnel& tunnel_;
+    folly::NetworkSocket fd_;
+  };
+
+  // One way of the tunnel, from src to dst through a pipe
+  struct Direction {
+    Direction(Socket& s, Socket& d) : src(s), dst(d) {}
+
+    Socket& src;
+    Socket& dst;
+    int pipe[2]{-1, -1};
+    // Bytes spliced into the pipe and not yet out of it
+    size_t inPipe{0};
+    folly::IOBufQueue pending{folly::IOBufQueue::cacheChainLength()};
+    uint64_t bytes{0};
+    bool srcEOF{false};
+    bool done{false};
+  };
+
+  class IdleTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit IdleTimeout(SpliceTunnel& tunnel) : tunnel_(tunnel) {}
+
+    void timeoutExpired() noexcept override {
+      tunnel_.close(kErrorTimeout);
+    }
+
+    void callbackCanceled() noexcept override {}
+
+   private:
+    SpliceTunnel& tunnel_;
+  };
+
+  /**
+   * Moves what it can in both directions, then waits for the sockets it
+   * could not read or write.
+   */
+  void pump();
+
+  // Returns false on an error, with err set
+  bool pumpDirection(Direction& dir, bool& moved, ProxygenError& err);
+
+  void updateEvents(Socket& sock);
+  void close(ProxygenError err);
+  void closePipes();
+
+  Socket downstream_;
+  Socket upstream_;
+  Direction toUpstream_{downstream_, upstream_};
+  Direction toDownstream_{upstream_, downstream_};
+  WheelTimerInstance timeout_;
+  IdleTimeout idleTimeout_{*this};
+  Callback* callback_;
+  bool initialized_{false};
+  bool started_{false};
+  bool closed_{false};
+};
+
+}
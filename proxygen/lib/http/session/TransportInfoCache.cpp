@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/TransportInfoCache.h>
+
+using wangle::TransportInfo;
+
+namespace proxygen {
+
+bool TransportInfoCache::get(TransportInfo* tinfo, bool socketGood,
+                             TimePoint now) {
+  if (!enabled()) {
+    return read_(tinfo);
+  }
+  if ((!cached_ || expired(socketGood, now)) && !refresh(now)) {
+    return false;
+  }
+  copySocketFields(*cached_, tinfo);
+  return true;
+}
+
+void TransportInfoCache::onClose(TimePoint now) {
+  if (enabled() && policy_.refreshOnClose) {
+    refresh(now);
+  }
+}
+
+bool TransportInfoCache::expired(bool socketGood, TimePoint now) const {
+  if (!socketGood) {
+    return false;
+  }
+  return (policy_.maxRequests > 0 && requests_ >= policy_.maxRequests) ||
+    (policy_.maxAge.count() > 0 && now - readTime_ >= policy_.maxAge);
+}
+
+bool TransportInfoCache::refresh(TimePoint now) {
+  TransportInfo tinfo;
+  if (!read_(&tinfo)) {
+    return false;
+  }
+  cached_ = std::move(tinfo);
+  readTime_ = now;
+  requests_ = 0;
+  return true;
+}
+
+void TransportInfoCache::copySocketFields(const TransportInfo& from,
+                                          TransportInfo* to) {
+  to->validTcpinfo = from.validTcpinfo;
+  to->tcpinfoErrno = from.tcpinfoErrno;
+  to->rtt = from.rtt;
+  to->rtt_var = from.rtt_var;
+  to->rtx = from.rtx;
+  to->rtx_tm = from.rtx_tm;
+  to->rto = from.rto;
+  to->cwnd = from.cwnd;
+  to->cwndBytes = from.cwndBytes;
+  to->mss = from.mss;
+  to->ssthresh = from.ssthresh;
+#if defined(__linux__) || defined(__FreeBSD__)
+  to->tcpinfo = from.tcpinfo;
+  to->caAlgo = from.caAlgo;
+  to->maxPacingRate = from.maxPacingRate;
+#endif // defined(__linux__) || defined(__FreeBSD__)
+}
+
+}
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/Optional.h>
+#include <proxygen/lib/utils/Time.h>
+#include <wangle/acceptor/TransportInfo.h>
+
+#include <chrono>
+
+namespace proxygen {
+
+/**
+ * Keeps what a session read from its socket into a TransportInfo (TCP_INFO,
+ * the congestion control and the pacing rate) and serves it again, so
+ * callers asking for the TransportInfo of every request do not each make
+ * the syscalls.
+ *
+ * The copy is read again once maxRequests more requests were counted with
+ * onRequest(), or once it is maxAge old, whichever is first; 0 disables
+ * either limit, and both 0 disables the cache.  Once the socket is shut down
+ * the copy no longer expires: a read would fail, so the last one is final.
+ */
+class TransportInfoCache {
+ public:
+  struct Policy {
+    uint32_t maxRequests{0};
+    std::chrono::milliseconds maxAge{0};
+    // read once more as the socket closes, see onClose()
+    bool refreshOnClose{true};
+  };
+
+  // Fills the socket fields of a TransportInfo, returns false if it can't
+  using ReadFn = folly::Function<bool(wangle::TransportInfo*)>;
+
+  explicit TransportInfoCache(ReadFn read)
+      : read_(std::move(read)) {}
+
+  void setPolicy(const Policy& policy) {
+    policy_ = policy;
+    cached_.reset();
+  }
+
+  const Policy& getPolicy() const {
+    return policy_;
+  }
+
+  bool enabled() const {
+    return policy_.maxRequests > 0 || policy_.maxAge.count() > 0;
+  }
+
+  void onRequest() {
+    requests_++;
+  }
+
+  /**
+   * Sets the socket fields of tinfo, from the copy unless it expired.
+   * Other fields of tinfo are left alone, as a direct read leaves them.
+   */
+  bool get(wangle::TransportInfo* tinfo, bool socketGood, TimePoint now);
+
+  /**
+   * To call before the socket is closed.  Under refreshOnClose, reads the
+   * socket one last time, so what is served from then on covers the whole
+   * connection.
+   */
+  void onClose(TimePoint now);
+
+  /**
+   * Copies what ReadFn sets, the fields of TransportInfo::initWithSocket(),
+   * readTcpCongestionControl() and readMaxPacingRate().
+   */
+  static void copySocketFields(const wangle::TransportInfo& from,
+                               wangle::TransportInfo* to);
+
+ private:
+  bool expired(bool socketGood, TimePoint now) const;
+  bool refresh(TimePoint now);
+
+  ReadFn read_;
+  Policy policy_;
+  folly::Optional<wangle::TransportInfo> cached_;
+  TimePoint readTime_;
+  uint32_t requests_{0};
+};
+
+}
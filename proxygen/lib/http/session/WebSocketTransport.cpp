@@ -0,0 +1,132 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/WebSocketTransport.h>
+
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+using folly::IOBuf;
+using std::unique_ptr;
+
+namespace proxygen {
+
+WebSocketTransport::WebSocketTransport(folly::EventBase* evb,
+                                       HTTPTransaction* txn,
+                                       const WebSocketCodec::Options& options,
+                                       Callback* callback)
+    : evb_(evb),
+      txn_(txn),
+      codec_(txn->isDownstream() ? TransportDirection::DOWNSTREAM
+                                 : TransportDirection::UPSTREAM,
+             options),
+      callback_(callback) {
+  codec_.setCallback(this);
+}
+
+WebSocketTransport::~WebSocketTransport() {
+  cancelLoopCallback();
+}
+
+void WebSocketTransport::onIngress(unique_ptr<IOBuf> buf) {
+  codec_.onIngress(std::move(buf));
+}
+
+void WebSocketTransport::sendMessage(WebSocketCodec::Opcode opcode,
+                                     unique_ptr<IOBuf> payload,
+                                     size_t maxFrameSize) {
+  if (!txn_ || codec_.isCloseSent()) {
+    return;
+  }
+  codec_.generateMessage(writeBuf_, opcode, std::move(payload), maxFrameSize);
+  scheduleFlush();
+}
+
+void WebSocketTransport::sendPing(unique_ptr<IOBuf> payload) {
+  if (!txn_ || codec_.isCloseSent()) {
+    return;
+  }
+  codec_.generatePing(writeBuf_, std::move(payload));
+  scheduleFlush();
+}
+
+void WebSocketTransport::close(uint16_t code, folly::StringPiece reason) {
+  if (!txn_ || codec_.isCloseSent()) {
+    return;
+  }
+  codec_.generateClose(writeBuf_, code, reason);
+  flush();
+}
+
+void WebSocketTransport::flush() {
+  cancelLoopCallback();
+  if (txn_ && !writeBuf_.empty()) {
+    txn_->sendBody(writeBuf_.move());
+  }
+}
+
+void WebSocketTransport::detachTransaction() {
+  cancelLoopCallback();
+  writeBuf_.move();
+  txn_ = nullptr;
+}
+
+void WebSocketTransport::onMessage(WebSocketCodec::Opcode opcode,
+                                   unique_ptr<IOBuf> payload) {
+  callback_->onMessage(opcode, std::move(payload));
+}
+
+void WebSocketTransport::onPing(unique_ptr<IOBuf> payload) {
+  if (!txn_ || codec_.isCloseSent()) {
+    return;
+  }
+  codec_.generatePong(writeBuf_, std::move(payload));
+  scheduleFlush();
+}
+
+void WebSocketTransport::onClose(uint16_t code, folly::StringPiece reason) {
+  if (txn_) {
+    codec_.generateClose(writeBuf_, code);
+  }
+  auto callback = callback_;
+  closeEgress();
+  callback->onClosed(code, reason);
+}
+
+void WebSocketTransport::onError(WebSocketCodec::CloseCode code,
+                                 folly::StringPiece reason) {
+  if (txn_) {
+    codec_.generateClose(writeBuf_, uint16_t(code));
+  }
+  auto callback = callback_;
+  closeEgress();
+  callback->onClosed(uint16_t(code), reason);
+}
+
+void WebSocketTransport::runLoopCallback() noexcept {
+  if (txn_ && !writeBuf_.empty()) {
+    txn_->sendBody(writeBuf_.move());
+  }
+}
+
+void WebSocketTransport::scheduleFlush() {
+  if (writeBuf_.chainLength() >= kMaxBatchSize) {
+    flush();
+  } else if (!isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void WebSocketTransport::closeEgress() {
+  flush();
+  if (txn_ && !txn_->isEgressEOMSeen()) {
+    txn_->sendEOM();
+  }
+}
+
+}
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/codec/WebSocketCodec.h>
+
+namespace proxygen {
+
+class HTTPTransaction;
+
+/**
+ * WebSocket messages over a transaction upgraded to WebSocket.  The
+ * transaction's handler passes the body it receives to onIngress(), and
+ * the messages sent go out as the transaction's body.
+ *
+ * Frames queued in the same loop of the event base are sent together, with
+ * one sendBody() once the loop's callbacks ran, or as soon as kMaxBatchSize
+ * bytes are queued.  PINGs are answered, and the peer's CLOSE with the same
+ * code; the EOM is sent once both ends have closed, or after the CLOSE sent
+ * for a protocol error.
+ */
+class WebSocketTransport
+    : private WebSocketCodec::Callback
+    , private folly::EventBase::LoopCallback {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {}
+
+    virtual void onMessage(WebSocketCodec::Opcode opcode,
+                           std::unique_ptr<folly::IOBuf> payload) noexcept = 0;
+
+    /**
+     * The peer closed with code, or the ingress broke the protocol and the
+     * transport closed with it, after the EOM was sent.  The transport may
+     * be deleted from here.
+     */
+    virtual void onClosed(uint16_t code,
+                          folly::StringPiece reason) noexcept = 0;
+  };
+
+  static constexpr size_t kMaxBatchSize = 16 * 1024;
+
+  WebSocketTransport(folly::EventBase* evb,
+                     HTTPTransaction* txn,
+                     const WebSocketCodec::Options& options,
+                     Callback* callback);
+
+  ~WebSocketTransport() override;
+
+  WebSocketTransport(const WebSocketTransport&) = delete;
+  WebSocketTransport& operator=(const WebSocketTransport&) = delete;
+
+  // The body the transaction received
+  void onIngress(std::unique_ptr<folly::IOBuf> buf);
+
+  /**
+   * Queues a TEXT or BINARY message, as frames of at most maxFrameSize
+   * bytes if that is not 0.  Dropped once closing.
+   */
+  void sendMessage(WebSocketCodec::Opcode opcode,
+                   std::unique_ptr<folly::IOBuf> payload,
+                   size_t maxFrameSize = 0);
+
+  void sendPing(std::unique_ptr<folly::IOBuf> payload);
+
+  // Queues a CLOSE; onClosed() follows the peer's
+  void close(uint16_t code, folly::StringPiece reason = folly::StringPiece());
+
+  // Sends what is queued without waiting for the end of the loop
+  void flush();
+
+  /**
+   * The transaction is going away, from its handler's detachTransaction()
+   * or onError(); what's queued is dropped.
+   */
+  void detachTransaction();
+
+  size_t getQueuedBytes() const {
+    return writeBuf_.chainLength();
+  }
+
+ private:
+  // WebSocketCodec::Callback
+  void onMessage(WebSocketCodec::Opcode opcode,
+                 std::unique_ptr<folly::IOBuf> payload) override;
+  void onPing(std::unique_ptr<folly::IOBuf> payload) override;
+  void onClose(uint16_t code, folly::StringPiece reason) override;
+  void onError(WebSocketCodec::CloseCode code,
+               folly::StringPiece reason) override;
+
+  // folly::EventBase::LoopCallback
+  void runLoopCallback() noexcept override;
+
+  void scheduleFlush();
+  void closeEgress();
+
+  folly::EventBase* evb_;
+  HTTPTransaction* txn_;
+  WebSocketCodec codec_;
+  Callback* callback_;
+  folly::IOBufQueue writeBuf_{folly::IOBufQueue::cacheChainLength()};
+};
+
+}
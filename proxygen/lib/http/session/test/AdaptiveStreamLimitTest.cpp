@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/AdaptiveStreamLimit.h>
+
+using namespace proxygen;
+
+TEST(AdaptiveStreamLimitTest, FollowsUtilization) {
+  AdaptiveStreamLimit::Options options;
+  options.minStreams = 10;
+  options.maxStreams = 200;
+  AdaptiveStreamLimit limit(options, 100);
+  EXPECT_EQ(limit.getLimit(), 100);
+
+  EXPECT_EQ(limit.update(0.9), 50);
+  EXPECT_EQ(limit.update(0.95), 25);
+  EXPECT_EQ(limit.update(0.9), 12);
+  EXPECT_EQ(limit.update(0.9), 10);
+  // Between the marks it stays
+  EXPECT_EQ(limit.update(0.7), 10);
+  EXPECT_EQ(limit.update(0.6), 10);
+
+  EXPECT_EQ(limit.update(0.2), 13);
+  EXPECT_EQ(limit.update(0.2), 17);
+  for (int i = 0; i < 20; i++) {
+    limit.update(0);
+  }
+  EXPECT_EQ(limit.getLimit(), 200);
+}
+
+TEST(AdaptiveStreamLimitTest, FollowsMemory) {
+  auto budget = std::make_shared<SessionMemoryBudget>(1000);
+  AdaptiveStreamLimit::Options options;
+  options.ingressMemoryBudget = budget;
+  AdaptiveStreamLimit limit(options, 100);
+
+  budget->addSession();
+  budget->update(950);
+  EXPECT_DOUBLE_EQ(limit.getMemoryRatio(), 0.95);
+  // However idle the thread
+  EXPECT_EQ(limit.update(0), 50);
+
+  // Under the high mark but not the low one
+  budget->update(-200);
+  EXPECT_EQ(limit.update(0), 50);
+
+  budget->update(-700);
+  EXPECT_EQ(limit.update(0), 63);
+  // The thread being busy is enough to come down
+  EXPECT_EQ(limit.update(0.85), 31);
+}
+
+TEST(AdaptiveStreamLimitTest, InitialClamped) {
+  AdaptiveStreamLimit::Options options;
+  options.minStreams = 20;
+  options.maxStreams = 50;
+  EXPECT_EQ(AdaptiveStreamLimit(options, 100).getLimit(), 50);
+  EXPECT_EQ(AdaptiveStreamLimit(options, 1).getLimit(), 20);
+}
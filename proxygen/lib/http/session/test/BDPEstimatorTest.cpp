@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/BDPEstimator.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+
+class BDPEstimatorTest : public testing::Test {
+ public:
+  // Runs a sample of bytes received over rtt, starting at now_
+  folly::Optional<uint32_t> sample(uint64_t bytes,
+                                   milliseconds rtt,
+                                   uint32_t window) {
+    EXPECT_TRUE(estimator_.onBytesReceived(1, now_));
+    estimator_.onPingSent(now_);
+    EXPECT_TRUE(estimator_.isSampling());
+    EXPECT_FALSE(estimator_.onBytesReceived(bytes, now_ + rtt / 2));
+    now_ += rtt;
+    auto result = estimator_.onPingReply(now_, window);
+    EXPECT_FALSE(estimator_.isSampling());
+    now_ += BDPEstimator::kDefaultSampleInterval;
+    return result;
+  }
+
+ protected:
+  const uint32_t kMinWindow{65536};
+  const uint32_t kMaxWindow{1 << 20};
+  BDPEstimator estimator_{kMinWindow, kMaxWindow};
+  TimePoint now_{getCurrentTime()};
+};
+
+TEST_F(BDPEstimatorTest, Grow) {
+  // a sample filling most of the window doubles it
+  auto window = sample(60000, milliseconds(10), kMinWindow);
+  ASSERT_TRUE(window.hasValue());
+  EXPECT_EQ(*window, 120000);
+  EXPECT_EQ(estimator_.getRtt(), milliseconds(10));
+
+  // a sample well within the window leaves it be
+  EXPECT_FALSE(sample(60000, milliseconds(10), *window).hasValue());
+
+  window = sample(110000, milliseconds(10), *window);
+  ASSERT_TRUE(window.hasValue());
+  EXPECT_EQ(*window, 220000);
+
+  // up to the max
+  window = sample(1000000, milliseconds(10), kMaxWindow / 2);
+  ASSERT_TRUE(window.hasValue());
+  EXPECT_EQ(*window, kMaxWindow);
+  EXPECT_FALSE(sample(kMaxWindow, milliseconds(10), kMaxWindow).hasValue());
+}
+
+TEST_F(BDPEstimatorTest, GrowOnlyWithBandwidth) {
+  auto window = sample(60000, milliseconds(10), kMinWindow);
+  ASSERT_TRUE(window.hasValue());
+
+  // the window filled, but over a longer round trip: the queues are filling
+  // rather than the path growing
+  EXPECT_FALSE(sample(100000, milliseconds(40), *window).hasValue());
+}
+
+TEST_F(BDPEstimatorTest, Shrink) {
+  auto window = sample(800000, milliseconds(10), 1000000);
+  ASSERT_TRUE(window.hasValue());
+  EXPECT_EQ(*window, kMaxWindow);
+
+  // shrinks after enough small samples, to twice the largest
+  for (uint32_t i = 1; i < BDPEstimator::kShrinkSamples; i++) {
+    EXPECT_FALSE(sample(100000 + i, milliseconds(10), *window).hasValue());
+  }
+  auto smaller = sample(100000, milliseconds(10), *window);
+  ASSERT_TRUE(smaller.hasValue());
+  EXPECT_EQ(*smaller, 2 * (100000 + BDPEstimator::kShrinkSamples - 1));
+
+  // a sample using enough of the window starts the count over
+  for (uint32_t i = 1; i < BDPEstimator::kShrinkSamples; i++) {
+    EXPECT_FALSE(sample(1000, milliseconds(10), *smaller).hasValue());
+  }
+  EXPECT_FALSE(sample(100000, milliseconds(10), *smaller).hasValue());
+  EXPECT_FALSE(sample(1000, milliseconds(10), *smaller).hasValue());
+
+  // but never below the min
+  for (uint32_t i = 2; i < BDPEstimator::kShrinkSamples; i++) {
+    EXPECT_FALSE(sample(1000, milliseconds(10), *smaller).hasValue());
+  }
+  smaller = sample(1000, milliseconds(10), *smaller);
+  ASSERT_TRUE(smaller.hasValue());
+  EXPECT_EQ(*smaller, kMinWindow);
+
+  // and grows back after
+  auto larger = sample(60000, milliseconds(10), kMinWindow);
+  ASSERT_TRUE(larger.hasValue());
+  EXPECT_EQ(*larger, 120000);
+}
+
+TEST_F(BDPEstimatorTest, SampleInterval) {
+  EXPECT_TRUE(estimator_.onBytesReceived(100, now_));
+  estimator_.onPingSent(now_);
+  EXPECT_FALSE(estimator_.onPingReply(now_ + milliseconds(5), kMinWindow));
+
+  // the next sample has to wait
+  now_ += milliseconds(5);
+  EXPECT_FALSE(estimator_.onBytesReceived(100, now_));
+  EXPECT_FALSE(estimator_.isSampling());
+  EXPECT_TRUE(estimator_.onBytesReceived(
+      100, now_ + BDPEstimator::kDefaultSampleInterval));
+
+  // replies without a sample are ignored
+  EXPECT_FALSE(estimator_.onPingReply(now_, kMinWindow));
+}
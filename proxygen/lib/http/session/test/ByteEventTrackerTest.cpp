@@ -11,6 +11,8 @@
 #include <folly/portability/GMock.h>
 
 #include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/RingByteEventTracker.h>
+#include <proxygen/lib/http/session/SocketTimestampByteEventTracker.h>
 #include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
 #include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
 
@@ -70,3 +72,216 @@ TEST_F(ByteEventTrackerTest, Ttlb) {
   EXPECT_CALL(transport_, detach(_));
   byteEventTracker_->processByteEvents(byteEventTracker_, 10);
 }
+
+class RingByteEventTrackerTest : public ByteEventTrackerTest {
+ public:
+  void SetUp() override {
+    ByteEventTrackerTest::SetUp();
+    ringTracker_ = std::make_shared<RingByteEventTracker>(&callback_);
+    byteEventTracker_ = ringTracker_;
+  }
+
+ protected:
+  void expectLastByte(uint64_t offset) {
+    EXPECT_CALL(transportCallback_, headerBytesGenerated(_));
+    txn_.sendAbort();
+    EXPECT_CALL(transportCallback_, lastByteFlushed());
+    EXPECT_CALL(callback_, onLastByteEvent(&txn_, offset, _));
+    EXPECT_CALL(transport_, detach(_));
+  }
+
+  std::shared_ptr<RingByteEventTracker> ringTracker_;
+};
+
+TEST_F(RingByteEventTrackerTest, Ping) {
+  byteEventTracker_->addPingByteEvent(10, proxygen::getCurrentTime(), 0);
+  EXPECT_CALL(callback_, onPingReplyLatency(_));
+  byteEventTracker_->processByteEvents(byteEventTracker_, 10);
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 0);
+}
+
+TEST_F(RingByteEventTrackerTest, Ttlb) {
+  byteEventTracker_->addLastByteEvent(&txn_, 10);
+  expectLastByte(10);
+  byteEventTracker_->processByteEvents(byteEventTracker_, 9);
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 1);
+  byteEventTracker_->processByteEvents(byteEventTracker_, 10);
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 0);
+}
+
+TEST_F(RingByteEventTrackerTest, PingShiftsLaterEvents) {
+  byteEventTracker_->addLastByteEvent(&txn_, 10);
+  // a 5 byte ping reply scheduled ahead of the body
+  byteEventTracker_->addPingByteEvent(5, proxygen::getCurrentTime(), 0);
+  EXPECT_CALL(callback_, onPingReplyLatency(_));
+  byteEventTracker_->processByteEvents(byteEventTracker_, 10);
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 1);
+  expectLastByte(15);
+  byteEventTracker_->processByteEvents(byteEventTracker_, 15);
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 0);
+}
+
+TEST_F(RingByteEventTrackerTest, Grow) {
+  const uint64_t kNumPings = 100;
+  for (uint64_t i = 0; i < kNumPings; i++) {
+    byteEventTracker_->addPingByteEvent(1, proxygen::getCurrentTime(), i);
+  }
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), kNumPings);
+  EXPECT_CALL(callback_, onPingReplyLatency(_)).Times(kNumPings / 2);
+  byteEventTracker_->processByteEvents(byteEventTracker_, kNumPings / 2);
+  for (uint64_t i = kNumPings; i < kNumPings * 2; i++) {
+    byteEventTracker_->addPingByteEvent(1, proxygen::getCurrentTime(), i);
+  }
+  EXPECT_CALL(callback_, onPingReplyLatency(_)).Times(kNumPings * 3 / 2);
+  byteEventTracker_->processByteEvents(byteEventTracker_, kNumPings * 2);
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 0);
+}
+
+TEST_F(RingByteEventTrackerTest, AbsorbList) {
+  auto listTracker = std::make_shared<ByteEventTracker>(&callback_);
+  listTracker->addPingByteEvent(10, proxygen::getCurrentTime(), 0);
+  listTracker->addLastByteEvent(&txn_, 20);
+  byteEventTracker_->absorb(std::move(*listTracker));
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 2);
+  listTracker.reset();
+  EXPECT_CALL(callback_, onPingReplyLatency(_));
+  expectLastByte(20);
+  byteEventTracker_->processByteEvents(byteEventTracker_, 20);
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 0);
+}
+
+TEST_F(RingByteEventTrackerTest, AbsorbedByList) {
+  byteEventTracker_->addPingByteEvent(10, proxygen::getCurrentTime(), 0);
+  byteEventTracker_->addLastByteEvent(&txn_, 20);
+  auto listTracker = std::make_shared<ByteEventTracker>(&callback_);
+  listTracker->absorb(std::move(*byteEventTracker_));
+  EXPECT_EQ(ringTracker_->numPendingByteEvents(), 0);
+  ringTracker_.reset();
+  byteEventTracker_.reset();
+  EXPECT_CALL(callback_, onPingReplyLatency(_));
+  expectLastByte(20);
+  listTracker->processByteEvents(listTracker, 20);
+}
+
+class CountingTTLBAStats : public DummyHTTPSessionStats {
+ public:
+  void recordTTLBAExceedLimit() noexcept override { ttlbaExceedLimit++; }
+  void recordTTLBAReceived() noexcept override { ttlbaReceived++; }
+  void recordTTLBAEomPassed() noexcept override { ttlbaEomPassed++; }
+  void recordTTLBANotFound() noexcept override { ttlbaNotFound++; }
+  void recordTTBTXReceived() noexcept override { ttbtxReceived++; }
+
+  uint32_t ttlbaExceedLimit{0};
+  uint32_t ttlbaReceived{0};
+  uint32_t ttlbaEomPassed{0};
+  uint32_t ttlbaNotFound{0};
+  uint32_t ttbtxReceived{0};
+};
+
+class SocketTimestampByteEventTrackerTest : public ByteEventTrackerTest {
+ public:
+  void SetUp() override {
+    ByteEventTrackerTest::SetUp();
+    resetTracker(SocketTimestampByteEventTracker::kDefaultMaxPendingEvents);
+  }
+
+ protected:
+  void resetTracker(uint32_t maxPendingEvents) {
+    tsTracker_ = std::make_shared<SocketTimestampByteEventTracker>(
+      &callback_, &eventBase_, std::chrono::milliseconds(1000),
+      maxPendingEvents);
+    tsTracker_->setTTLBAStats(&stats_);
+    byteEventTracker_ = tsTracker_;
+  }
+
+  CountingTTLBAStats stats_;
+  std::shared_ptr<SocketTimestampByteEventTracker> tsTracker_;
+};
+
+TEST_F(SocketTimestampByteEventTrackerTest, PreSendEndsWritesOnBoundaries) {
+  byteEventTracker_->addFirstBodyByteEvent(5, &txn_);
+  byteEventTracker_->addLastByteEvent(&txn_, 20);
+  bool cork = false;
+  bool som = false;
+  bool eom = false;
+  EXPECT_EQ(byteEventTracker_->preSend(&cork, &som, &eom, 0), 5);
+  EXPECT_TRUE(som);
+  EXPECT_FALSE(eom);
+
+  EXPECT_CALL(transportCallback_, firstByteFlushed());
+  EXPECT_CALL(callback_, onFirstByteEvent(&txn_, 5, true));
+  byteEventTracker_->processByteEvents(byteEventTracker_, 5);
+
+  som = false;
+  EXPECT_EQ(byteEventTracker_->preSend(&cork, &som, &eom, 5), 15);
+  EXPECT_FALSE(som);
+  EXPECT_TRUE(eom);
+  byteEventTracker_->drainByteEvents();
+}
+
+TEST_F(SocketTimestampByteEventTrackerTest, TxAndAckTimestamps) {
+  byteEventTracker_->addTxByteEvent(50, ByteEvent::FIRST_BYTE, &txn_);
+  byteEventTracker_->addTxByteEvent(100, ByteEvent::LAST_BYTE, &txn_);
+  byteEventTracker_->addAckByteEvent(100, &txn_);
+  EXPECT_EQ(tsTracker_->numPendingTxEvents(), 2);
+  EXPECT_EQ(tsTracker_->numPendingAckEvents(), 1);
+
+  const std::chrono::nanoseconds sent = std::chrono::seconds(1000);
+  EXPECT_CALL(transportCallback_, firstByteTX());
+  tsTracker_->onSocketTimestamp(
+    SocketTimestampByteEventTracker::TimestampType::TX, 50, sent);
+  EXPECT_CALL(transportCallback_, lastByteTX());
+  tsTracker_->onSocketTimestamp(
+    SocketTimestampByteEventTracker::TimestampType::TX, 100, sent);
+  EXPECT_EQ(tsTracker_->numPendingTxEvents(), 0);
+  EXPECT_EQ(stats_.ttbtxReceived, 2);
+
+  EXPECT_CALL(transportCallback_,
+              lastByteAcked(std::chrono::milliseconds(30)));
+  tsTracker_->onSocketTimestamp(
+    SocketTimestampByteEventTracker::TimestampType::ACK, 100,
+    sent + std::chrono::milliseconds(30));
+  EXPECT_EQ(tsTracker_->numPendingAckEvents(), 0);
+  EXPECT_EQ(stats_.ttlbaReceived, 1);
+}
+
+TEST_F(SocketTimestampByteEventTrackerTest, AckPassesEvents) {
+  byteEventTracker_->addAckByteEvent(100, &txn_);
+  byteEventTracker_->addAckByteEvent(200, &txn_);
+  EXPECT_CALL(transportCallback_, lastByteAcked(_));
+  tsTracker_->onSocketTimestamp(
+    SocketTimestampByteEventTracker::TimestampType::ACK, 200,
+    std::chrono::seconds(1000));
+  EXPECT_EQ(tsTracker_->numPendingAckEvents(), 0);
+  EXPECT_EQ(stats_.ttlbaEomPassed, 1);
+  EXPECT_EQ(stats_.ttlbaReceived, 1);
+
+  // nothing left to match
+  tsTracker_->onSocketTimestamp(
+    SocketTimestampByteEventTracker::TimestampType::ACK, 300,
+    std::chrono::seconds(1000));
+  EXPECT_EQ(stats_.ttlbaNotFound, 1);
+}
+
+TEST_F(SocketTimestampByteEventTrackerTest, PendingLimit) {
+  resetTracker(1);
+  byteEventTracker_->addAckByteEvent(10, &txn_);
+  byteEventTracker_->addLastByteEvent(&txn_, 20);
+  bool cork = false;
+  bool som = false;
+  bool eom = false;
+  EXPECT_EQ(byteEventTracker_->preSend(&cork, &som, &eom, 10), 0);
+  EXPECT_FALSE(eom);
+  EXPECT_EQ(byteEventTracker_->preSend(&cork, &som, &eom, 10), 0);
+  // counted once
+  EXPECT_EQ(stats_.ttlbaExceedLimit, 1);
+  EXPECT_EQ(byteEventTracker_->drainByteEvents(), 2);
+}
+
+TEST_F(SocketTimestampByteEventTrackerTest, Disable) {
+  byteEventTracker_->addTxByteEvent(100, ByteEvent::LAST_BYTE, &txn_);
+  byteEventTracker_->addAckByteEvent(100, &txn_);
+  EXPECT_EQ(byteEventTracker_->disableSocketTimestampEvents(), 2);
+  byteEventTracker_->addAckByteEvent(200, &txn_);
+  EXPECT_EQ(tsTracker_->numPendingAckEvents(), 0);
+}
@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/ClosedStreamSet.h>
+
+using namespace proxygen;
+
+TEST(ClosedStreamSetTest, AddAndContains) {
+  ClosedStreamSet closed;
+  EXPECT_FALSE(closed.contains(1));
+  closed.add(1);
+  closed.add(5);
+  EXPECT_TRUE(closed.contains(1));
+  EXPECT_FALSE(closed.contains(3));
+  EXPECT_TRUE(closed.contains(5));
+  // Not added yet
+  EXPECT_FALSE(closed.contains(7));
+  // Out of order
+  closed.add(3);
+  EXPECT_TRUE(closed.contains(3));
+}
+
+TEST(ClosedStreamSetTest, SlidingWindow) {
+  ClosedStreamSet closed;
+  closed.add(1);
+  closed.add(101);
+  auto window = ClosedStreamSet::kWindow;
+  // Stream 1 is still the oldest one in the window
+  closed.add(1 + 2 * (window - 1));
+  EXPECT_TRUE(closed.contains(1));
+  EXPECT_TRUE(closed.contains(101));
+  closed.add(1 + 2 * window);
+  EXPECT_FALSE(closed.contains(1));
+  EXPECT_TRUE(closed.contains(101));
+  // Too old to add
+  closed.add(1);
+  EXPECT_FALSE(closed.contains(1));
+
+  // Slots reused by the window start out clear
+  EXPECT_FALSE(closed.contains(3 + 2 * window));
+  closed.add(101 + 4 * window);
+  EXPECT_FALSE(closed.contains(101));
+  EXPECT_FALSE(closed.contains(1 + 2 * window));
+  EXPECT_TRUE(closed.contains(101 + 4 * window));
+}
@@ -0,0 +1,106 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/EgressScheduler.h>
+
+using namespace proxygen;
+
+namespace {
+
+using Turns = std::vector<std::pair<int, uint64_t>>;
+
+// Writes whatever its budget allows of its pending bytes
+class FakeSession : public EgressScheduler::Callback {
+ public:
+  FakeSession(EgressScheduler& scheduler, Turns& turns, int id)
+      : scheduler_(scheduler), turns_(turns), id_(id) {}
+
+  void addEgress(uint64_t bytes) {
+    pending_ += bytes;
+    scheduler_.schedule(*this);
+  }
+
+  uint64_t runScheduledEgress(uint64_t budget) noexcept override {
+    auto written = std::min(pending_, budget);
+    pending_ -= written;
+    turns_.emplace_back(id_, written);
+    if (pending_ > 0) {
+      scheduler_.schedule(*this);
+    }
+    return written;
+  }
+
+ private:
+  EgressScheduler& scheduler_;
+  Turns& turns_;
+  const int id_;
+  uint64_t pending_{0};
+};
+
+class SelfDeletingSession : public EgressScheduler::Callback {
+ public:
+  uint64_t runScheduledEgress(uint64_t budget) noexcept override {
+    delete this;
+    return budget;
+  }
+};
+
+}
+
+class EgressSchedulerTest : public testing::Test {
+ public:
+  Turns runRound() {
+    turns_.clear();
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+    return turns_;
+  }
+
+ protected:
+  folly::EventBase evb_;
+  std::shared_ptr<EgressScheduler> scheduler_{
+    std::make_shared<EgressScheduler>(&evb_, 1000)};
+  Turns turns_;
+};
+
+TEST_F(EgressSchedulerTest, SparseFirst) {
+  FakeSession bulk1(*scheduler_, turns_, 1);
+  FakeSession bulk2(*scheduler_, turns_, 2);
+  FakeSession small(*scheduler_, turns_, 3);
+  bulk1.addEgress(4000);
+  bulk2.addEgress(4000);
+  EXPECT_EQ(scheduler_->getNumScheduled(), 2);
+
+  // Each gets a quantum per round
+  EXPECT_EQ(runRound(), Turns({{1, 1000}, {2, 1000}}));
+
+  // The small response goes ahead of the bulk sessions
+  small.addEgress(300);
+  EXPECT_EQ(runRound(), Turns({{3, 300}, {1, 1000}, {2, 1000}}));
+  EXPECT_FALSE(small.isEgressScheduled());
+
+  // And does so again next time
+  small.addEgress(200);
+  EXPECT_EQ(runRound(), Turns({{3, 200}, {1, 1000}, {2, 1000}}));
+  EXPECT_EQ(runRound(), Turns({{1, 1000}, {2, 1000}}));
+  EXPECT_EQ(scheduler_->getNumScheduled(), 0);
+  EXPECT_TRUE(runRound().empty());
+}
+
+TEST_F(EgressSchedulerTest, SessionsGoing) {
+  auto session = std::make_unique<FakeSession>(*scheduler_, turns_, 1);
+  FakeSession other(*scheduler_, turns_, 2);
+  session->addEgress(5000);
+  scheduler_->schedule(*new SelfDeletingSession());
+  other.addEgress(5000);
+  session.reset();
+  EXPECT_EQ(scheduler_->getNumScheduled(), 2);
+  EXPECT_EQ(runRound(), Turns({{2, 1000}}));
+  EXPECT_EQ(scheduler_->getNumScheduled(), 1);
+}
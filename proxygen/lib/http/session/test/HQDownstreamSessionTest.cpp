@@ -13,6 +13,7 @@
 #include <proxygen/lib/http/codec/HQStreamCodec.h>
 #include <proxygen/lib/http/codec/HQUnidirectionalCodec.h>
 #include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/session/RFC9218PriorityQueue.h>
 #include <proxygen/lib/http/session/test/HQSessionTestCommon.h>
 #include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
 #include <proxygen/lib/http/session/test/HQSessionMocks.h>
@@ -34,6 +35,7 @@ using namespace std::chrono;
 
 constexpr quic::StreamId kQPACKEncoderIngressStreamId = 6;
 constexpr quic::StreamId kQPACKEncoderEgressStreamId = 7;
+constexpr quic::StreamId kQPACKDecoderEgressStreamId = 11;
 
 class TestTransportCallback : public HTTPTransactionTransportCallback {
  public:
@@ -400,6 +402,18 @@ TEST_P(HQDownstreamSessionTest, SimpleGet) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, RecycledStreams) {
+  HQSession::setRecycleStreams(true);
+  for (auto i = 0; i < 3; i++) {
+    // each request may reuse the storage of the one before
+    auto idh = checkRequest();
+    flushRequestsAndLoop();
+    EXPECT_TRUE(socketDriver_->streams_[idh.first].writeEOF);
+  }
+  hqSession_->closeWhenIdle();
+  HQSession::setRecycleStreams(false);
+}
+
 TEST_P(HQDownstreamSessionTest, GetStopSending) {
   auto id = sendRequest(getGetRequest());
   auto handler = addSimpleStrictHandler();
@@ -610,6 +624,31 @@ TEST_P(HQDownstreamSessionTest, Maxreadsperloop) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, ReadProcessingBudget) {
+  // Each loop processes a single stream's reads
+  hqSession_->setReadProcessingBudget(std::chrono::microseconds(1));
+  std::vector<std::unique_ptr<StrictMock<MockHTTPHandler>>> handlers;
+  for (auto n = 0; n < 10; n++) {
+    auto idh = checkRequest();
+    handlers.emplace_back(std::move(idh.second));
+  }
+
+  flushRequestsAndLoopN(1);
+  int responded = 0;
+  for (auto& req : requests_) {
+    responded += socketDriver_->streams_[req.first].writeEOF;
+  }
+  EXPECT_LT(responded, 10);
+
+  // The left over streams are processed in the following loops
+  eventBase_.loop();
+  for (auto& req : requests_) {
+    EXPECT_GT(socketDriver_->streams_[req.first].writeBuf.chainLength(), 110);
+    EXPECT_TRUE(socketDriver_->streams_[req.first].writeEOF);
+  }
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTest, OnFlowControlUpdate) {
   auto id = sendRequest();
   auto handler = addSimpleStrictHandler();
@@ -632,6 +671,37 @@ TEST_P(HQDownstreamSessionTest, OnFlowControlUpdate) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, PriorityHeader) {
+  hqSession_->useRFC9218Priorities();
+  auto id1 = sendRequest();
+  auto req = getGetRequest();
+  req.getHeaders().add("priority", "u=0");
+  auto id2 = sendRequest(req);
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM([&handler1] { handler1->sendReplyWithBody(200, 4000); });
+  handler1->expectDetachTransaction();
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders([&handler2] {
+    EXPECT_EQ(RFC9218PriorityQueue::urgencyFromPriority(
+                handler2->txn_->getPriority()), 0);
+  });
+  handler2->expectEOM([&handler2] { handler2->sendReplyWithBody(200, 4000); });
+  handler2->expectDetachTransaction();
+
+  // Less than a response: the urgent one gets it all
+  socketDriver_->setConnectionFlowControlWindow(2000);
+  flushRequestsAndLoop();
+  EXPECT_GT(socketDriver_->streams_[id2].writeBuf.chainLength(), 1000);
+  EXPECT_EQ(socketDriver_->streams_[id1].writeBuf.chainLength(), 0);
+
+  socketDriver_->getSocket()->setConnectionFlowControlWindow(20000);
+  CHECK(eventBase_.loop());
+  EXPECT_TRUE(socketDriver_->streams_[id1].writeEOF);
+  EXPECT_TRUE(socketDriver_->streams_[id2].writeEOF);
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTest, OnFlowControlUpdateOnUnknownStream) {
   auto id = sendRequest();
   auto handler = addSimpleStrictHandler();
@@ -1931,6 +2001,80 @@ TEST_P(HQDownstreamSessionTestHQ, QPACKEncoderLimited) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTestHQ, BatchedQPACKDecoderStream) {
+  HQSession::QPACKFlushPolicy policy;
+  policy.batchDecoderStream = true;
+  policy.maxDelay = std::chrono::milliseconds(50);
+  hqSession_->setQPACKFlushPolicy(policy);
+  auto& decoderStream = socketDriver_->streams_[kQPACKDecoderEgressStreamId];
+  auto offset = decoderStream.writeOffset;
+
+  auto req = getGetRequest();
+  req.getHeaders().add("X-FB-Debug", "rfccffgvtvnenjkbtitkfdufddnvbecu");
+  sendRequest(req);
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM();
+  flushRequests();
+  eventBase_.runAfterDelay([&] {
+    // nothing to share a write with, the acknowledgement is held
+    EXPECT_EQ(decoderStream.writeOffset, offset);
+  }, 5);
+  eventBase_.runAfterDelay([&] {
+    EXPECT_GT(decoderStream.writeOffset, offset);
+    handler->sendReplyWithBody(200, 100);
+  }, 150);
+  handler->expectDetachTransaction();
+  CHECK(eventBase_.loop());
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTestHQ, AdaptiveQPACKVulnerable) {
+  testing::NiceMock<MockHTTPSessionStats> stats;
+  hqSession_->setSessionStats(&stats);
+  HQSession::QPACKVulnerablePolicy policy;
+  policy.adaptive = true;
+  policy.sampleInterval = milliseconds(0);
+  policy.minPackets = 1;
+  hqSession_->setQPACKVulnerablePolicy(policy);
+
+  auto sendReply = [this] {
+    sendRequest();
+    auto handler = addSimpleStrictHandler();
+    handler->expectHeaders();
+    handler->expectEOM(
+        [hdlr = handler.get()] { hdlr->sendReplyWithBody(200, 100); });
+    handler->expectDetachTransaction();
+    flushRequestsAndLoop();
+  };
+  // The first reply takes the baseline sample
+  EXPECT_CALL(stats, recordQPACKVulnerableBudget(_)).Times(0);
+  sendReply();
+  Mock::VerifyAndClearExpectations(&stats);
+
+  // 20% of the packets since were retransmitted
+  auto lossy = transportInfo_;
+  lossy.bytesSent = 100 * quic::kDefaultUDPSendPacketLen;
+  lossy.packetsRetransmitted = 20;
+  EXPECT_CALL(*socketDriver_->getSocket(), getTransportInfo())
+      .WillRepeatedly(Return(lossy));
+  EXPECT_CALL(stats, recordQPACKVulnerableBudget(0));
+  sendReply();
+  Mock::VerifyAndClearExpectations(&stats);
+
+  // 2% since, between the thresholds
+  auto recovered = lossy;
+  recovered.bytesSent = 200 * quic::kDefaultUDPSendPacketLen;
+  recovered.packetsRetransmitted = 22;
+  EXPECT_CALL(*socketDriver_->getSocket(), getTransportInfo())
+      .WillRepeatedly(Return(recovered));
+  // 88 of the client's 100 QPACK_BLOCKED_STREAMS
+  EXPECT_CALL(stats, recordQPACKVulnerableBudget(88));
+  sendReply();
+  hqSession_->setSessionStats(nullptr);
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTestHQ, DelayedQPACKStopSendingReset) {
   auto req = getGetRequest();
   req.getHeaders().add("X-FB-Debug", "rfccffgvtvnenjkbtitkfdufddnvbecu");
@@ -1972,6 +2116,83 @@ TEST_P(HQDownstreamSessionBeforeTransportReadyTest, NotifyPendingShutdown) {
               ElementsAre(quic::kEightByteLimit, 0));
 }
 
+// Use this test class for hq only tests with datagrams
+using HQDownstreamSessionDatagramTest =
+    HQDownstreamSessionBeforeTransportReadyTest;
+
+TEST_P(HQDownstreamSessionDatagramTest, Datagrams) {
+  auto sock = socketDriver_->getSocket();
+  quic::QuicSocket::DatagramCallback* datagramCb = nullptr;
+  EXPECT_CALL(*sock, setDatagramCallback(_))
+      .WillOnce(DoAll(SaveArg<0>(&datagramCb), Return(folly::unit)));
+  EXPECT_CALL(*sock, getDatagramSizeLimit()).WillRepeatedly(Return(1200));
+  // Both ends advertise SETTINGS_H3_DATAGRAM
+  egressSettings_.setSetting(SettingsId::_HQ_DATAGRAM, 1);
+  HQSession::DatagramOptions options;
+  options.enabled = true;
+  options.maxBufferedBytes = 20;
+  hqSession_->setDatagramOptions(options);
+  SetUpOnTransportReady();
+  ASSERT_EQ(datagramCb, static_cast<quic::QuicSocket::DatagramCallback*>(
+                            hqSession_));
+
+  auto id = sendRequest(getPostRequest(10), false);
+  auto& request = getStream(id);
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  flushRequestsAndLoopN(1);
+  // The quarter stream ID takes a byte
+  EXPECT_EQ(handler->txn_->getDatagramSizeLimit(), 1199);
+  EXPECT_FALSE(handler->txn_->sendDatagram(makeBuf(1200)));
+
+  std::vector<std::string> written;
+  EXPECT_CALL(*sock, writeDatagram(_))
+      .WillRepeatedly(Invoke([&](const std::unique_ptr<folly::IOBuf>& buf) {
+        folly::io::Cursor cursor(buf.get());
+        quic::StreamId streamId;
+        EXPECT_EQ(hq::parseDatagram(cursor, streamId), folly::none);
+        EXPECT_EQ(streamId, id);
+        written.push_back(cursor.readFixedString(cursor.totalLength()));
+        return folly::unit;
+      }));
+  // Sent in the same loop, written together; the second fills the buffer
+  EXPECT_TRUE(handler->txn_->sendDatagram(folly::IOBuf::copyBuffer("hello")));
+  EXPECT_CALL(*handler, onDatagramEgressPaused());
+  EXPECT_TRUE(handler->txn_->sendDatagram(makeBuf(14)));
+  EXPECT_FALSE(handler->txn_->sendDatagram(makeBuf(1)));
+  EXPECT_CALL(*handler, onDatagramEgressResumed());
+  flushRequestsAndLoopN(1);
+  ASSERT_EQ(written.size(), 2);
+  EXPECT_EQ(written[0], "hello");
+
+  EXPECT_CALL(*sock, readDatagramBufs(_))
+      .WillOnce(Invoke([&](size_t) {
+        std::vector<std::unique_ptr<folly::IOBuf>> datagrams;
+        folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+        hq::writeDatagram(queue, id, folly::IOBuf::copyBuffer("world"));
+        datagrams.push_back(queue.move());
+        // Not a stream of ours, dropped
+        hq::writeDatagram(queue, id + 4, folly::IOBuf::copyBuffer("x"));
+        datagrams.push_back(queue.move());
+        return folly::Expected<std::vector<std::unique_ptr<folly::IOBuf>>,
+                               quic::LocalErrorCode>(std::move(datagrams));
+      }));
+  EXPECT_CALL(*handler, onDatagram(_))
+      .WillOnce(Invoke([](std::shared_ptr<folly::IOBuf> buf) {
+        EXPECT_EQ(buf->moveToFbString(), "world");
+      }));
+  datagramCb->onDatagramsAvailable();
+
+  request.codec->generateBody(
+      request.buf, request.id, makeBuf(10), HTTPCodec::NoPadding, true);
+  request.readEOF = true;
+  handler->expectBody();
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
 // NOTE: a failure for this test may cause an infinite loop in processReadData
 TEST_P(HQDownstreamSessionTest, ProcessReadDataOnDetachedStream) {
   auto id = sendRequest("/", 0, false);
@@ -2290,6 +2511,11 @@ INSTANTIATE_TEST_CASE_P(HQDownstreamSessionBeforeTransportReadyTest,
                                TestParams({.alpn_ = "h3"})),
                         paramsToTestName);
 
+INSTANTIATE_TEST_CASE_P(HQDownstreamSessionDatagramTest,
+                        HQDownstreamSessionDatagramTest,
+                        Values(TestParams({.alpn_ = "h3"})),
+                        paramsToTestName);
+
 // Instantiate h1q-fb-v1 only tests
 INSTANTIATE_TEST_CASE_P(HQDownstreamSessionTest,
                         HQDownstreamSessionTestH1qv1,
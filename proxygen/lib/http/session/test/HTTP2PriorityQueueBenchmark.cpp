@@ -0,0 +1,195 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
+#include <proxygen/lib/http/session/RFC9218PriorityQueue.h>
+
+#include <vector>
+
+using namespace folly;
+using namespace proxygen;
+
+// Cost of the egress queue operations HTTPSession performs, for
+// HTTP2PriorityQueue trees of different shapes and for RFC9218PriorityQueue
+// fed the same priorities.  Every benchmark is run with 10 to 10k streams.
+//
+//  flat:  every stream depends on the root with the default weight
+//  chain: every stream depends on the previous one
+//  excl:  every stream depends exclusively on the previous one, as Chrome
+//         does, weights cycling through its five priority levels
+
+namespace {
+
+enum class Shape { FLAT, CHAIN, EXCL };
+
+static char* fakeTxn = (char*)0xface0000;
+
+HTTPTransaction* makeFakeTxn(HTTPCodec::StreamID id) {
+  return (HTTPTransaction*)(fakeTxn + id);
+}
+
+HTTPCodec::StreamID streamID(size_t i) {
+  return i * 2 + 1;
+}
+
+http2::PriorityUpdate priorityFor(Shape shape, size_t i) {
+  // Chrome's weights for its five request priorities
+  static const uint8_t kChromeWeights[] = {255, 219, 182, 146, 109};
+  HTTPCodec::StreamID parent = i == 0 ? 0 : streamID(i - 1);
+  switch (shape) {
+    case Shape::FLAT:
+      return {0, false, 15};
+    case Shape::CHAIN:
+      return {parent, false, 15};
+    case Shape::EXCL:
+      return {parent, true, kChromeWeights[i % 5]};
+  }
+  return {0, false, 15};
+}
+
+using Handles = std::vector<HTTP2PriorityQueueBase::Handle>;
+
+void buildQueue(HTTP2PriorityQueueBase& queue, Shape shape, size_t n,
+                Handles& handles, bool enqueue) {
+  handles.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    auto id = streamID(i);
+    handles.push_back(queue.addTransaction(id, priorityFor(shape, i),
+                                           makeFakeTxn(id)));
+    if (enqueue) {
+      queue.signalPendingEgress(handles.back());
+    }
+  }
+}
+
+void clearQueue(HTTP2PriorityQueueBase& queue, Handles& handles) {
+  // Remove leaves first so chains are not reparented on every removal
+  for (auto it = handles.rbegin(); it != handles.rend(); ++it) {
+    queue.removeTransaction(*it);
+  }
+  handles.clear();
+}
+
+template <typename Queue>
+void addBench(Shape shape, uint32_t iters, size_t n) {
+  for (uint32_t i = 0; i < iters; i++) {
+    Queue queue;
+    Handles handles;
+    buildQueue(queue, shape, n, handles, false);
+    BENCHMARK_SUSPEND {
+      clearQueue(queue, handles);
+    }
+  }
+}
+
+template <typename Queue>
+void removeBench(Shape shape, uint32_t iters, size_t n) {
+  for (uint32_t i = 0; i < iters; i++) {
+    Queue queue;
+    Handles handles;
+    BENCHMARK_SUSPEND {
+      buildQueue(queue, shape, n, handles, true);
+    }
+    clearQueue(queue, handles);
+  }
+}
+
+template <typename Queue>
+void updateBench(Shape shape, uint32_t iters, size_t n) {
+  Queue queue;
+  Handles handles;
+  BENCHMARK_SUSPEND {
+    buildQueue(queue, shape, n, handles, true);
+  }
+  // Move streams between the front and the middle of the tree, keeping the
+  // parent a non-descendant so no cycle has to be broken
+  for (uint32_t i = 0; i < iters; i++) {
+    size_t idx = n / 2 + i % (n - n / 2);
+    size_t parentIdx = i % (n / 2 + 1);
+    HTTPCodec::StreamID parent = parentIdx == 0 ? 0 : streamID(parentIdx - 1);
+    handles[idx] = queue.updatePriority(
+      handles[idx],
+      {parent, shape == Shape::EXCL, uint8_t(i % 256)});
+  }
+  BENCHMARK_SUSPEND {
+    clearQueue(queue, handles);
+  }
+}
+
+template <typename Queue>
+void signalBench(Shape shape, uint32_t iters, size_t n) {
+  Queue queue;
+  Handles handles;
+  BENCHMARK_SUSPEND {
+    buildQueue(queue, shape, n, handles, true);
+  }
+  for (uint32_t i = 0; i < iters; i++) {
+    auto h = handles[(i * 7919) % n];
+    queue.clearPendingEgress(h);
+    queue.signalPendingEgress(h);
+  }
+  BENCHMARK_SUSPEND {
+    clearQueue(queue, handles);
+  }
+}
+
+template <typename Queue>
+void nextEgressBench(Shape shape, uint32_t iters, size_t n) {
+  Queue queue;
+  Handles handles;
+  HTTPEgressPriorityQueue::NextEgressResult result;
+  BENCHMARK_SUSPEND {
+    buildQueue(queue, shape, n, handles, true);
+  }
+  for (uint32_t i = 0; i < iters; i++) {
+    queue.nextEgress(result);
+    doNotOptimizeAway(result.size());
+    result.clear();
+  }
+  BENCHMARK_SUSPEND {
+    clearQueue(queue, handles);
+  }
+}
+
+}
+
+#define QUEUE_BENCHMARKS(op, shapeName, shape)                               \
+  void op##_##shapeName(uint32_t iters, size_t n) {                          \
+    op##Bench<HTTP2PriorityQueue>(shape, iters, n);                          \
+  }                                                                          \
+  void op##_##shapeName##_rfc9218(uint32_t iters, size_t n) {                \
+    op##Bench<RFC9218PriorityQueue>(shape, iters, n);                        \
+  }                                                                          \
+  BENCHMARK_PARAM(op##_##shapeName, 10)                                      \
+  BENCHMARK_PARAM(op##_##shapeName, 100)                                     \
+  BENCHMARK_PARAM(op##_##shapeName, 1000)                                    \
+  BENCHMARK_PARAM(op##_##shapeName, 10000)                                   \
+  BENCHMARK_PARAM(op##_##shapeName##_rfc9218, 10)                            \
+  BENCHMARK_PARAM(op##_##shapeName##_rfc9218, 100)                           \
+  BENCHMARK_PARAM(op##_##shapeName##_rfc9218, 1000)                          \
+  BENCHMARK_PARAM(op##_##shapeName##_rfc9218, 10000)                         \
+  BENCHMARK_DRAW_LINE();
+
+#define QUEUE_BENCHMARKS_ALL_SHAPES(op)                                      \
+  QUEUE_BENCHMARKS(op, flat, Shape::FLAT)                                    \
+  QUEUE_BENCHMARKS(op, chain, Shape::CHAIN)                                  \
+  QUEUE_BENCHMARKS(op, excl, Shape::EXCL)
+
+QUEUE_BENCHMARKS_ALL_SHAPES(add)
+QUEUE_BENCHMARKS_ALL_SHAPES(remove)
+QUEUE_BENCHMARKS_ALL_SHAPES(update)
+QUEUE_BENCHMARKS_ALL_SHAPES(signal)
+QUEUE_BENCHMARKS_ALL_SHAPES(nextEgress)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -11,6 +11,8 @@
 #include <vector>
 
 #include <folly/Conv.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
 #include <folly/Range.h>
 #include <folly/futures/Promise.h>
 #include <folly/io/Cursor.h>
@@ -18,17 +20,22 @@
 #include <folly/io/async/EventBaseManager.h>
 #include <folly/io/async/TimeoutManager.h>
 #include <folly/io/async/test/MockAsyncTransport.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/codec/test/TestUtils.h>
+#include <proxygen/lib/http/session/HTTPAdmissionController.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
+#include <proxygen/lib/http/session/EgressRateLimiter.h>
 #include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPErrorPage.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
 #include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
 #include <proxygen/lib/http/session/test/HTTPSessionTest.h>
 #include <proxygen/lib/http/session/test/MockByteEventTracker.h>
 #include <proxygen/lib/http/session/test/TestUtils.h>
 #include <proxygen/lib/test/TestAsyncTransport.h>
+#include <proxygen/lib/utils/TraceEventObserver.h>
 #include <wangle/acceptor/ConnectionManager.h>
 
 using namespace folly::io;
@@ -1127,6 +1134,231 @@ TEST_F(HTTPDownstreamSessionTest, HttpWithAckTimingPipeline) {
   gracefulShutdown();
 }
 
+TEST_F(HTTPDownstreamSessionTest, PipelineBatchWrite) {
+  // Pipelined requests that arrive together are answered in one write
+  InSequence enforceOrder;
+  httpSession_->setMaxPipelineBatch(4);
+
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM([&handler1] () {
+      handler1->sendReplyWithBody(200, 100);
+    });
+  handler1->expectDetachTransaction();
+  sendRequest();
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&handler2] () {
+      handler2->sendReplyWithBody(200, 100);
+    });
+  handler2->expectDetachTransaction();
+  sendRequest();
+  auto handler3 = addSimpleStrictHandler();
+  handler3->expectHeaders();
+  handler3->expectEOM([&handler3] () {
+      handler3->sendReplyWithBody(200, 100);
+    });
+  handler3->expectDetachTransaction();
+  sendRequest();
+
+  flushRequestsAndLoop();
+  EXPECT_EQ(transport_->getWriteEvents()->size(), 1);
+  expectResponses(3);
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, FileBody) {
+  // TestAsyncTransport is no AsyncSocket, so the file is read into memory,
+  // in more than one write allowance
+  InSequence enforceOrder;
+  std::string content;
+  for (int i = 0; content.size() < 100000; i++) {
+    content += folly::to<std::string>(i, ",");
+  }
+  folly::test::TemporaryFile tempFile;
+  folly::writeFull(tempFile.fd(), content.data(), content.size());
+  auto file = std::make_shared<folly::File>(tempFile.path().string());
+  const size_t offset = 10;
+  const size_t length = content.size() - 2 * offset;
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&] {
+      handler->sendHeaders(200, length);
+      handler->txn_->sendFileBody(file, offset, length);
+      EXPECT_TRUE(handler->txn_->hasPendingBody());
+      handler->txn_->sendEOM();
+    });
+  handler->expectDetachTransaction();
+  sendRequest();
+  flushRequestsAndLoop();
+
+  std::string body;
+  clientCodec_->setCallback(&callbacks_);
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _));
+  EXPECT_CALL(callbacks_, onBody(1, _, _))
+    .WillRepeatedly(Invoke([&] (HTTPCodec::StreamID,
+                                std::shared_ptr<folly::IOBuf> chain,
+                                uint8_t) {
+                             body += chain->moveToFbString().toStdString();
+                           }));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(body, content.substr(offset, length));
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, BodyProducer) {
+  struct StringProducer : public HTTPBodyProducer {
+    std::unique_ptr<folly::IOBuf> produceBody(size_t maxBytes,
+                                              bool& eom) noexcept override {
+      pulls++;
+      maxPull = std::max(maxPull, maxBytes);
+      if (!ready) {
+        return nullptr;
+      }
+      auto len = std::min(maxBytes, content.size() - offset);
+      auto body = folly::IOBuf::copyBuffer(content.data() + offset, len);
+      offset += len;
+      eom = offset == content.size();
+      return body;
+    }
+
+    std::string content;
+    size_t offset{0};
+    bool ready{false};
+    size_t pulls{0};
+    size_t maxPull{0};
+  };
+  StringProducer producer;
+  for (int i = 0; producer.content.size() < 200000; i++) {
+    producer.content += folly::to<std::string>(i, ",");
+  }
+
+  InSequence enforceOrder;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&] {
+      handler->sendHeaders(200, producer.content.size());
+      handler->txn_->setBodyProducer(&producer);
+      eventBase_.runInLoop([&] {
+          // Until now, pulls found nothing
+          producer.ready = true;
+          handler->txn_->resumeBodyProducer();
+        });
+    });
+  handler->expectDetachTransaction();
+  sendRequest();
+  flushRequestsAndLoop();
+
+  // Pulled in write allowances, not all at once
+  EXPECT_GT(producer.pulls, 3);
+  EXPECT_LT(producer.maxPull, producer.content.size());
+  std::string body;
+  clientCodec_->setCallback(&callbacks_);
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _));
+  EXPECT_CALL(callbacks_, onBody(1, _, _))
+    .WillRepeatedly(Invoke([&] (HTTPCodec::StreamID,
+                                std::shared_ptr<folly::IOBuf> chain,
+                                uint8_t) {
+                             body += chain->moveToFbString().toStdString();
+                           }));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(body, producer.content);
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, PhaseTimings) {
+  struct PhaseObserver : public TraceEventObserver {
+    void traceEventAvailable(TraceEvent event) noexcept override {
+      events.push_back(std::move(event));
+    }
+    std::vector<TraceEvent> events;
+  } observer;
+  httpSession_->setPhaseTimingsEnabled(true, &observer);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&] {
+      auto timings = handler->txn_->getPhaseTimings();
+      ASSERT_NE(timings, nullptr);
+      EXPECT_NE(timings->headersComplete, TimePoint());
+      EXPECT_EQ(timings->ingressEOM, TimePoint());
+    });
+  handler->expectEOM([&] {
+      handler->sendReplyWithBody(200, 100);
+      auto timings = handler->txn_->getPhaseTimings();
+      EXPECT_GE(timings->ingressEOM, timings->headersComplete);
+      EXPECT_GE(timings->firstSendBody, timings->ingressEOM);
+    });
+  handler->expectDetachTransaction();
+  sendRequest();
+  flushRequestsAndLoop();
+
+  ASSERT_EQ(observer.events.size(), 1);
+  const auto& event = observer.events[0];
+  EXPECT_EQ(event.getType(), TraceEventType::TransactionPhases);
+  int64_t streamID = 0;
+  EXPECT_TRUE(event.readIntMeta(TraceFieldType::StreamID, streamID));
+  EXPECT_EQ(streamID, 1);
+  int64_t headersComplete = -1;
+  int64_t lastByteWritten = -1;
+  int64_t lastByteAcked = -1;
+  EXPECT_TRUE(event.readIntMeta(TraceFieldType::HeadersComplete,
+                                headersComplete));
+  EXPECT_TRUE(event.readIntMeta(TraceFieldType::LastByteWritten,
+                                lastByteWritten));
+  EXPECT_GE(lastByteWritten, headersComplete);
+  EXPECT_GE(headersComplete, 0);
+  // no ACK timestamps on this transport
+  EXPECT_FALSE(event.readIntMeta(TraceFieldType::LastByteAcked,
+                                 lastByteAcked));
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, CpuTimeSampling) {
+  struct PhaseObserver : public TraceEventObserver {
+    void traceEventAvailable(TraceEvent event) noexcept override {
+      events.push_back(std::move(event));
+    }
+    std::vector<TraceEvent> events;
+  } observer;
+  httpSession_->setPhaseTimingsEnabled(true, &observer);
+  httpSession_->setCpuTimeSampleRate(2);
+  InSequence enforceOrder;
+
+  // Only every second transaction is accounted
+  for (auto sampled : {false, true}) {
+    auto handler = addSimpleStrictHandler();
+    handler->expectHeaders([&handler, sampled] {
+        EXPECT_EQ(handler->txn_->isCpuTimeAccounting(), sampled);
+      });
+    handler->expectEOM([&handler] {
+        // Burn some CPU in the handler
+        auto start = getThreadCpuTime();
+        while (getThreadCpuTime() - start < std::chrono::milliseconds(1)) {
+        }
+        handler->sendReplyWithBody(200, 100);
+      });
+    handler->expectDetachTransaction();
+    sendRequest();
+    flushRequestsAndLoop();
+  }
+
+  ASSERT_EQ(observer.events.size(), 2);
+  int64_t cpuTime = -1;
+  EXPECT_FALSE(observer.events[0].readIntMeta(TraceFieldType::CpuTime,
+                                              cpuTime));
+  EXPECT_TRUE(observer.events[1].readIntMeta(TraceFieldType::CpuTime,
+                                             cpuTime));
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  EXPECT_GE(cpuTime, 1000);
+#endif
+  gracefulShutdown();
+}
+
 /*
  * The sequence of streams are generated in the following order:
  * - [client --> server] regular request 1st stream (getGetRequest())
@@ -1524,6 +1756,178 @@ void HTTPDownstreamTest<C>::testChunks(bool trailers) {
   expectDetachSession();
 }
 
+TEST_F(HTTPDownstreamSessionTest, CoalescedChunks) {
+  // The chunks sent in one loop go out as one, up to the limit
+  httpSession_->setEgressChunkCoalescing(64);
+  InSequence enforceOrder;
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] () {
+      handler->sendChunkedReplyWithBody(200, 100, 17, false);
+    });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _));
+  // 3 chunks of 17 bytes, then the other 2 and the last 15 bytes
+  EXPECT_CALL(callbacks_, onChunkHeader(1, 51));
+  EXPECT_CALL(callbacks_, onBody(1, _, _));
+  EXPECT_CALL(callbacks_, onChunkComplete(1));
+  EXPECT_CALL(callbacks_, onChunkHeader(1, 49));
+  EXPECT_CALL(callbacks_, onBody(1, _, _));
+  EXPECT_CALL(callbacks_, onChunkComplete(1));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+
+  parseOutput(*clientCodec_);
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, StateSnapshot) {
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders([this, &handler] {
+      HTTPSessionStateSnapshot snapshot;
+      httpSession_->getStateSnapshot(snapshot, 10);
+      EXPECT_EQ(snapshot.protocol, CodecProtocol::HTTP_1_1);
+      EXPECT_EQ(snapshot.numStreams, 1);
+      ASSERT_EQ(snapshot.streams.size(), 1);
+      EXPECT_EQ(snapshot.streams[0].id, handler->txn_->getID());
+      EXPECT_EQ(snapshot.streams[0].ingressState,
+                HTTPTransactionIngressSM::State::HeadersReceived);
+      EXPECT_EQ(snapshot.streams[0].egressState,
+                HTTPTransactionEgressSM::State::Start);
+      auto dyn = snapshot.toDynamic();
+      EXPECT_EQ(dyn["numStreams"].asInt(), 1);
+      EXPECT_EQ(dyn["streams"].size(), 1);
+
+      // Streams past the limit are only counted
+      HTTPSessionStateSnapshot summary;
+      httpSession_->getStateSnapshot(summary, 0);
+      EXPECT_EQ(summary.numStreams, 1);
+      EXPECT_TRUE(summary.streams.empty());
+    });
+  handler->expectEOM([&handler] {
+      handler->sendReplyWithBody(200, 100);
+    });
+  handler->expectDetachTransaction();
+
+  sendRequest();
+  flushRequestsAndLoop();
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, AdmissionControllerRejects) {
+  struct OverloadedController : public HTTPAdmissionController {
+    bool admitConnection() override {
+      return true;
+    }
+    uint32_t getMaxConcurrentIncomingStreams(uint32_t configured) override {
+      return configured;
+    }
+    bool admitRequest() override {
+      return false;
+    }
+    bool shouldDrainOnReject() override {
+      return true;
+    }
+  } admission;
+  httpSession_->setAdmissionController(&admission);
+
+  EXPECT_CALL(mockController_, getRequestHandler(_, _)).Times(0);
+  expectDetachSession();
+  sendRequest();
+  flushRequestsAndLoop();
+
+  clientCodec_->setCallback(&callbacks_);
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _))
+    .WillOnce(Invoke([] (HTTPCodec::StreamID,
+                         std::shared_ptr<HTTPMessage> msg) {
+                       EXPECT_EQ(msg->getStatusCode(), 503);
+                       EXPECT_FALSE(msg->wantsKeepalive());
+                     }));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+  parseOutput(*clientCodec_);
+}
+
+TEST_F(HTTPDownstreamSessionTest, SharedDirectResponse) {
+  HTTPStaticErrorPage page(folly::IOBuf::copyBuffer("slow down"),
+                           "text/plain");
+  auto response = std::make_shared<const HTTPDirectResponse>(
+    429, "Too Many Requests", &page);
+
+  EXPECT_CALL(mockController_, getRequestHandler(_, _))
+    .WillOnce(Return(new HTTPDirectResponseHandler(response)));
+  expectDetachSession();
+  sendRequest();
+  flushRequestsAndLoop();
+
+  std::string body;
+  clientCodec_->setCallback(&callbacks_);
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _))
+    .WillOnce(Invoke([] (HTTPCodec::StreamID,
+                         std::shared_ptr<HTTPMessage> msg) {
+                       EXPECT_EQ(msg->getStatusCode(), 429);
+                       EXPECT_EQ(msg->getStatusMessage(), "Too Many Requests");
+                       EXPECT_EQ(msg->getHeaders().getSingleOrEmpty(
+                                   HTTP_HEADER_CONTENT_TYPE), "text/plain");
+                       EXPECT_EQ(msg->getHeaders().getSingleOrEmpty(
+                                   HTTP_HEADER_CONTENT_LENGTH), "9");
+                       EXPECT_FALSE(msg->wantsKeepalive());
+                     }));
+  EXPECT_CALL(callbacks_, onBody(1, _, _))
+    .WillRepeatedly(Invoke([&] (HTTPCodec::StreamID,
+                                std::shared_ptr<folly::IOBuf> chain,
+                                uint8_t) {
+                             body += chain->moveToFbString().toStdString();
+                           }));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(body, "slow down");
+  // The page itself is shared, not copied
+  EXPECT_TRUE(response->cloneBody()->isShared());
+}
+
+TEST_F(HTTPDownstreamSessionTest, DetachIdleSession) {
+  InSequence enforceOrder;
+
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM([&handler1] {
+      handler1->sendReplyWithBody(200, 100);
+    });
+  handler1->expectDetachTransaction();
+  sendRequest();
+  flushRequestsAndLoop();
+  expectResponse();
+
+  // Move the idle session like HTTPSessionRebalancer, to a new timer here
+  EXPECT_TRUE(httpSession_->isDetachable(true));
+  httpSession_->detachThreadLocals();
+  auto timer = makeTimeoutSet(&eventBase_);
+  uint64_t filterCount = 0;
+  httpSession_->attachThreadLocals(
+    &eventBase_, nullptr, WheelTimerInstance(timer.get()), nullptr,
+    [&filterCount] (HTTPCodecFilter*) { filterCount++; }, nullptr,
+    &mockController_);
+  EXPECT_GT(filterCount, 0);
+
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&handler2] {
+      handler2->sendReplyWithBody(200, 100);
+    });
+  handler2->expectDetachTransaction();
+  sendRequest();
+  flushRequestsAndLoop();
+  expectResponse();
+  gracefulShutdown();
+}
+
 TEST_F(HTTPDownstreamSessionTest, HttpDrain) {
   InSequence enforceOrder;
 
@@ -1711,6 +2115,46 @@ TEST_F(HTTPDownstreamSessionTest, HttpRateLimitNormal) {
   cleanup();
 }
 
+TEST_F(HTTPDownstreamSessionTest, SharedEgressRateLimiter) {
+  // An unlimited bucket under a 640kbps parent: the parent's limit applies
+  auto parent = std::make_shared<EgressRateLimiter>(
+    eventBase_.timer(), 640 * 1024, EgressRateLimiter::kWakeupBytes);
+  auto limiter = std::make_shared<EgressRateLimiter>(
+    eventBase_.timer(), 0, 0, parent);
+
+  sendRequest();
+
+  InSequence handlerSequence;
+  auto handler1 = addSimpleNiceHandler();
+  handler1->expectHeaders([&] {
+      handler1->txn_->setEgressRateLimiter(limiter);
+    });
+  handler1->expectEOM([&] {
+      // At 640kbps, this should take slightly over 1.2s
+      uint32_t rspLengthBytes = 100000;
+      handler1->sendHeaders(200, rspLengthBytes);
+      handler1->sendBody(rspLengthBytes);
+      handler1->txn_->sendEOM();
+    });
+  handler1->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  flushRequestsAndLoop();
+
+  proxygen::TimePoint timeFirstWrite =
+    transport_->getWriteEvents()->front()->getTime();
+  proxygen::TimePoint timeLastWrite =
+    transport_->getWriteEvents()->back()->getTime();
+  int64_t writeDuration =
+    (int64_t)millisecondsBetween(timeLastWrite, timeFirstWrite).count();
+  EXPECT_GE(writeDuration, 1000);
+  // No transaction is left waiting
+  EXPECT_EQ(limiter->getNumWaiters(), 0);
+  EXPECT_EQ(parent->getNumWaiters(), 0);
+
+  cleanup();
+}
+
 TEST_F(SPDY3DownstreamSessionTest, SpdyRateLimitNormal) {
   // The rate-limiting code grabs the event base from the EventBaseManager,
   // so we need to set it.
@@ -1923,6 +2367,84 @@ TEST_F(HTTPDownstreamSessionTest, BigExplcitChunkWrite) {
   EXPECT_GT(transport_->getWriteEvents()->size(), 250);
 }
 
+TEST_F(HTTPDownstreamSessionTest, EgressScheduler) {
+  // Under a scheduler, the session writes at most a quantum per round
+  auto scheduler = std::make_shared<EgressScheduler>(&eventBase_, 4096);
+  httpSession_->setEgressScheduler(scheduler);
+  sendRequest();
+
+  InSequence handlerSequence;
+  auto handler1 = addSimpleNiceHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM([&handler1] {
+      handler1->sendReplyWithBody(200, 32768);
+    });
+  handler1->expectDetachTransaction();
+
+  expectDetachSession();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  flushRequestsAndLoop();
+
+  EXPECT_GE(transport_->getWriteEvents()->size(), 8);
+  for (const auto& event : *transport_->getWriteEvents()) {
+    size_t len = 0;
+    for (size_t i = 0; i < event->getCount(); i++) {
+      len += event->getIoVec()[i].iov_len;
+    }
+    EXPECT_LE(len, 4096);
+  }
+  EXPECT_EQ(scheduler->getNumScheduled(), 0);
+}
+
+TEST_F(HTTPDownstreamSessionTest, BigChunkWriteBatched) {
+  // With a write target, egress passes are gathered into fewer, larger writes
+  HTTPSession::EgressBatchPolicy policy;
+  policy.targetBytesPerWrite = 256 * 1024;
+  policy.maxLatency = std::chrono::microseconds(0);
+  httpSession_->setEgressBatchPolicy(policy);
+  sendRequest();
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders([&handler] {
+      handler->sendHeaders(200, 100, false);
+      size_t len = 16 * 1024 * 1024;
+      handler->txn_->sendChunkHeader(len);
+      auto chunk = makeBuf(len);
+      handler->txn_->sendBody(std::move(chunk));
+      handler->txn_->sendChunkTerminator();
+      handler->txn_->sendEOM();
+    });
+  handler->expectDetachTransaction();
+
+  expectDetachSession();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  flushRequestsAndLoop();
+
+  EXPECT_LE(transport_->getWriteEvents()->size(), 65);
+}
+
+TEST_F(HTTPDownstreamSessionTest, ReadBufferPool) {
+  // Fully parsed read buffers go back to the thread's pool
+  HTTPSession::setReadBufferPoolSize(4);
+  NiceMock<MockHTTPSessionStats> stats;
+  httpSession_->setSessionStats(&stats);
+  EXPECT_CALL(stats, recordReadBufferPoolOccupancy(1)).Times(AtLeast(1));
+  sendRequest();
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] {
+      handler->sendReplyWithBody(200, 100);
+    });
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop();
+
+  httpSession_->setSessionStats(nullptr);
+  cleanup();
+  HTTPSession::setReadBufferPoolSize(0);
+}
 
 // ==== upgrade tests ====
 
@@ -2064,6 +2586,53 @@ TEST_F(HTTPDownstreamSessionUpgradeFlowControlTest, UpgradeH2Flowcontrol) {
   testSimpleUpgrade("h2c", CodecProtocol::HTTP_2, "h2c");
 }
 
+class HTTPDownstreamSessionPriorKnowledgeTest :
+      public HTTPDownstreamSessionTest {
+ public:
+  HTTPDownstreamSessionPriorKnowledgeTest()
+      : HTTPDownstreamSessionTest({-1, -1, -1}, false) {}
+};
+
+// HTTP/2 with prior knowledge on an HTTP/1.1 session, with the preface
+// split across reads
+TEST_F(HTTPDownstreamSessionPriorKnowledgeTest, H2cPriorKnowledge) {
+  httpSession_->enableH2cPriorKnowledge();
+  httpSession_->setEgressSettings({{ SettingsId::HEADER_TABLE_SIZE, 5555 }});
+  httpSession_->setMaxConcurrentIncomingStreams(50);
+  httpSession_->startNow();
+
+  auto handler = addSimpleStrictHandler();
+  HeaderIndexingStrategy testH2IndexingStrat;
+  EXPECT_CALL(mockController_, onSessionCodecChange(httpSession_));
+  EXPECT_CALL(mockController_, getHeaderIndexingStrategy())
+    .WillOnce(Return(&testH2IndexingStrat));
+  handler->expectHeaders();
+  handler->expectEOM([&handler] {
+      EXPECT_EQ(handler->txn_->getTransport().getCodec().getProtocol(),
+                CodecProtocol::HTTP_2);
+      EXPECT_EQ(*handler->txn_->getSetupTransportInfo().appProtocol, "h2c");
+      handler->sendReplyWithBody(200, 100);
+    });
+  handler->expectDetachTransaction();
+
+  clientCodec_ = HTTPCodecFactory::getCodec(CodecProtocol::HTTP_2,
+                                            TransportDirection::UPSTREAM);
+  clientCodec_->generateConnectionPreface(requests_);
+  clientCodec_->generateSettings(requests_);
+  sendRequest();
+  IOBufQueue preface{IOBufQueue::cacheChainLength()};
+  preface.append(requests_.split(10));
+  transport_->addReadEvent(preface, milliseconds(0));
+  flushRequestsAndLoop();
+
+  expectResponse();
+  // What was set before the preface
+  auto settings = clientCodec_->getIngressSettings();
+  EXPECT_EQ(settings->getSetting(SettingsId::HEADER_TABLE_SIZE, 0), 5555);
+  EXPECT_EQ(settings->getSetting(SettingsId::MAX_CONCURRENT_STREAMS, 0), 50);
+  gracefulShutdown();
+}
+
 // Upgrade to SPDY/3.1 with a non-native proto in the list
 TEST_F(HTTPDownstreamSessionTest, HttpUpgradeNativeUnknown) {
   // This is maybe weird, the client asked for non-native as first choice,
@@ -3558,6 +4127,178 @@ TEST_F(HTTPDownstreamSessionTest, HttpShortContentLength) {
 
 }
 
+TEST_F(HTTP2DownstreamSessionTest, Hibernate) {
+  // Once idle, the session releases its header tables and buffers
+  NiceMock<MockHTTPSessionStats> stats;
+  httpSession_->setSessionStats(&stats);
+  httpSession_->setHibernateTimeout(milliseconds(10));
+  size_t bytesBefore = 0;
+  size_t bytesAfter = 0;
+  EXPECT_CALL(stats, recordSessionHibernated(_, _))
+    .WillOnce(DoAll(SaveArg<0>(&bytesBefore), SaveArg<1>(&bytesAfter)));
+  sendRequest();
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] {
+      handler->sendReplyWithBody(200, 100);
+    });
+  handler->expectDetachTransaction();
+  expectDetachSession();
+  flushRequestsAndLoop();
+  EXPECT_GT(bytesBefore, 0);
+  EXPECT_LT(bytesAfter, bytesBefore);
+}
+
+TEST_F(HTTP2DownstreamSessionTest, MemoryUsage) {
+  sendRequest();
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([this, &handler] {
+      auto usage = httpSession_->getMemoryUsage();
+      // The header tables and the stream's priority node
+      EXPECT_GT(usage.codec, 0);
+      EXPECT_GT(usage.priorityQueue, 0);
+      EXPECT_EQ(usage.transactionEgress, 0);
+
+      handler->txn_->sendHeaders(getResponse(200, 0));
+      handler->txn_->sendBody(makeBuf(100));
+      usage = httpSession_->getMemoryUsage();
+      EXPECT_EQ(usage.transactionEgress, 100);
+
+      HTTPSessionMemoryUsage sum;
+      sum += usage;
+      sum += usage;
+      EXPECT_EQ(sum.total(), 2 * usage.total());
+      handler->txn_->sendEOM();
+    });
+  handler->expectDetachTransaction();
+  expectDetachSession();
+  flushRequestsAndLoop();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, CoalescedIngressBody) {
+  auto streamID = sendHeader();
+  for (auto i = 0; i < 3; i++) {
+    clientCodec_->generateBody(requests_, streamID, makeBuf(100),
+                               HTTPCodec::NoPadding, false);
+  }
+  // The transport makes a read of each buffer, send them in one
+  requests_.gather(requests_.chainLength());
+
+  auto handler = addSimpleStrictHandler();
+  std::vector<uint64_t> offsets;
+  std::vector<size_t> sizes;
+  InSequence handlerSequence;
+  handler->expectHeaders([&] {
+      handler->txn_->setIngressBodyCoalescing(400);
+    });
+  EXPECT_CALL(*handler, onBodyWithOffset(_, _))
+    .Times(3)
+    .WillRepeatedly(Invoke([&] (uint64_t offset,
+                                std::shared_ptr<folly::IOBuf> chain) {
+          offsets.push_back(offset);
+          sizes.push_back(chain->computeChainDataLength());
+        }));
+  handler->expectEOM([&] {
+      // All the body was delivered and credited back to the session
+      EXPECT_EQ(httpSession_->getMemoryUsage().transactionIngress, 0);
+      handler->sendReplyWithBody(200, 100);
+    });
+  handler->expectDetachTransaction();
+
+  flushRequestsAndLoop(false, milliseconds(0), milliseconds(0), [&] {
+      // A second read with enough body to reach the threshold
+      for (auto i = 0; i < 5; i++) {
+        clientCodec_->generateBody(requests_, streamID, makeBuf(100),
+                                   HTTPCodec::NoPadding, false);
+      }
+      clientCodec_->generateEOM(requests_, streamID);
+      requests_.gather(requests_.chainLength());
+      transport_->addReadEvent(requests_, milliseconds(0));
+    });
+  // The end of the first read, the threshold and the EOM
+  EXPECT_EQ(sizes, std::vector<size_t>({300, 400, 100}));
+  EXPECT_EQ(offsets, std::vector<uint64_t>({0, 300, 700}));
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, MaxConcurrentStreamsUpdate) {
+  eventBase_.loopOnce();
+  // Advertised again once the session started
+  httpSession_->setMaxConcurrentIncomingStreams(7);
+  eventBase_.loopOnce();
+
+  InSequence sequence;
+  EXPECT_CALL(callbacks_, onSettings(_));
+  EXPECT_CALL(callbacks_, onSettings(_))
+    .WillOnce(Invoke([] (const SettingsList& settings) {
+        bool found = false;
+        for (const auto& setting: settings) {
+          if (setting.id == SettingsId::MAX_CONCURRENT_STREAMS) {
+            EXPECT_EQ(setting.value, 7);
+            found = true;
+          }
+        }
+        EXPECT_TRUE(found);
+      }));
+  parseOutput(*clientCodec_);
+
+  cleanup();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, ResetBeforeTransaction) {
+  httpSession_->setStreamResetLimit(100, milliseconds(1000));
+  std::vector<HTTPCodec::StreamID> resetStreams;
+  for (auto i = 0; i < 10; i++) {
+    auto streamID = sendHeader();
+    clientCodec_->generateRstStream(requests_, streamID, ErrorCode::CANCEL);
+    resetStreams.push_back(streamID);
+  }
+  auto streamID = sendRequest();
+  // The transport makes a read of each buffer, send them in one
+  requests_.gather(requests_.chainLength());
+
+  // Only the last stream gets a transaction, and a handler
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&] {
+      EXPECT_EQ(handler->txn_->getID(), streamID);
+    });
+  handler->expectEOM([&handler] {
+      handler->sendReplyWithBody(200, 100);
+    });
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop(false, milliseconds(0), milliseconds(0), [&] {
+      // Late frames for the reset streams are dropped without a reply
+      clientCodec_->generateBody(requests_, resetStreams[0], makeBuf(10),
+                                 HTTPCodec::NoPadding, true);
+      transport_->addReadEvent(requests_, milliseconds(0));
+    });
+
+  EXPECT_CALL(callbacks_, onMessageBegin(streamID, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(streamID, _));
+  EXPECT_CALL(callbacks_, onBody(streamID, _, _));
+  EXPECT_CALL(callbacks_, onMessageComplete(streamID, _));
+  EXPECT_CALL(callbacks_, onAbort(_, _)).Times(0);
+  parseOutput(*clientCodec_);
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, StreamResetLimit) {
+  httpSession_->setStreamResetLimit(3, milliseconds(1000));
+  for (auto i = 0; i < 5; i++) {
+    auto streamID = sendHeader();
+    clientCodec_->generateRstStream(requests_, streamID, ErrorCode::CANCEL);
+  }
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  expectDetachSession();
+  flushRequestsAndLoop();
+  EXPECT_CALL(callbacks_, onGoaway(_, ErrorCode::ENHANCE_YOUR_CALM, _));
+  parseOutput(*clientCodec_);
+}
+
 TEST_F(HTTP2DownstreamSessionTest, TestSessionStallByFlowControl) {
   NiceMock<MockHTTPSessionStats> stats;
   // By default the send and receive windows are 64K each.
@@ -196,3 +196,73 @@ TEST_F(HTTPSessionAcceptorTestNPN, AcceptorConfigCapture) {
   acceptor_->connectionReady(
       std::move(sock), clientAddress, "", SecureTransportType::NONE, tinfo);
 }
+
+TEST_F(HTTPSessionAcceptorTestNPN, DrainGradually) {
+  config_->plaintextProtocol = "http/1.1";
+  newAcceptor();
+  acceptor_->expectedProto_ = "http/1.1";
+  for (int i = 0; i < 2; i++) {
+    AsyncSocket::UniquePtr sock(new AsyncSocket(&eventBase_));
+    SocketAddress clientAddress;
+    wangle::TransportInfo tinfo;
+    acceptor_->connectionReady(
+        std::move(sock), clientAddress, "", SecureTransportType::NONE, tinfo);
+  }
+  EXPECT_EQ(acceptor_->getNumConnections(), 2);
+
+  // The window is shorter than a step, both idle sessions drain right away
+  acceptor_->drainGradually(std::chrono::milliseconds(0));
+  auto progress = acceptor_->getDrainProgress();
+  EXPECT_EQ(progress.drained, 2);
+  EXPECT_EQ(progress.pending, 0);
+  EXPECT_TRUE(progress.finished);
+  eventBase_.loop();
+  EXPECT_EQ(acceptor_->getNumConnections(), 0);
+}
+
+TEST_F(HTTPSessionAcceptorTestNPN, DeferSessionUntilData) {
+  config_->plaintextProtocol = "http/1.1";
+  config_->deferSessionUntilData = true;
+  newAcceptor();
+  acceptor_->expectedProto_ = "http/1.1";
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  AsyncSocket::UniquePtr sock(
+    new AsyncSocket(&eventBase_, folly::NetworkSocket::fromFd(fds[0])));
+  SocketAddress clientAddress;
+  wangle::TransportInfo tinfo;
+  acceptor_->connectionReady(
+      std::move(sock), clientAddress, "", SecureTransportType::NONE, tinfo);
+  // Only the socket until data arrives
+  EXPECT_EQ(acceptor_->sessionsCreated_, 0);
+  EXPECT_EQ(acceptor_->getNumConnections(), 1);
+  eventBase_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(acceptor_->sessionsCreated_, 0);
+
+  ASSERT_EQ(3, write(fds[1], "GET", 3));
+  eventBase_.loopOnce();
+  EXPECT_EQ(acceptor_->sessionsCreated_, 1);
+  EXPECT_EQ(acceptor_->getNumConnections(), 1);
+  close(fds[1]);
+  eventBase_.loop();
+}
+
+TEST_F(HTTPSessionAcceptorTestNPN, DeferSessionClosedWithoutData) {
+  config_->plaintextProtocol = "http/1.1";
+  config_->deferSessionUntilData = true;
+  newAcceptor();
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  AsyncSocket::UniquePtr sock(
+    new AsyncSocket(&eventBase_, folly::NetworkSocket::fromFd(fds[0])));
+  SocketAddress clientAddress;
+  wangle::TransportInfo tinfo;
+  acceptor_->connectionReady(
+      std::move(sock), clientAddress, "", SecureTransportType::NONE, tinfo);
+  EXPECT_EQ(acceptor_->getNumConnections(), 1);
+
+  close(fds[1]);
+  eventBase_.loop();
+  EXPECT_EQ(acceptor_->sessionsCreated_, 0);
+  EXPECT_EQ(acceptor_->getNumConnections(), 0);
+}
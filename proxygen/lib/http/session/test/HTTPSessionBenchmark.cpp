@@ -0,0 +1,438 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPSessionController.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <wangle/acceptor/TransportInfo.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// Requests from an HTTPUpstreamSession to an HTTPDownstreamSession on the same
+// EventBase, over a pair of in-memory transports: what is measured is the
+// sessions, transactions and codecs (state machines, byte events, timeouts,
+// the egress queue), with no socket I/O.  Writes complete immediately and
+// are read by the peer in the next loop callback, one read per write batch
+// as with a socket.
+//
+// Each benchmark iteration is one request with a 100 byte response, or 16KB
+// for the Large ones; the HTTP/2 ones also run with 10 and 100 requests in
+// flight on the connection.
+
+namespace {
+
+/**
+ * One end of an in-memory connection.
+ */
+class PipeTransport : public AsyncTransportWrapper,
+                      private EventBase::LoopCallback {
+ public:
+  explicit PipeTransport(EventBase* evb)
+      : evb_(evb) {}
+
+  static void connect(PipeTransport* a, PipeTransport* b) {
+    a->peer_ = b;
+    b->peer_ = a;
+  }
+
+  void setReadCB(ReadCallback* callback) override {
+    readCallback_ = callback;
+    scheduleRead();
+  }
+  ReadCallback* getReadCallback() const override {
+    return readCallback_;
+  }
+
+  void write(WriteCallback* callback, const void* buf, size_t bytes,
+             WriteFlags flags = WriteFlags::NONE) override {
+    writeChain(callback, IOBuf::copyBuffer(buf, bytes), flags);
+  }
+  void writev(WriteCallback* callback, const iovec* vec, size_t count,
+              WriteFlags flags = WriteFlags::NONE) override {
+    IOBufQueue queue;
+    for (size_t i = 0; i < count; i++) {
+      queue.append(IOBuf::copyBuffer(vec[i].iov_base, vec[i].iov_len));
+    }
+    writeChain(callback, queue.move(), flags);
+  }
+  void writeChain(WriteCallback* callback, std::unique_ptr<IOBuf>&& iob,
+                  WriteFlags = WriteFlags::NONE) override {
+    if (writeClosed_ || !peer_) {
+      AsyncSocketException ex(AsyncSocketException::NOT_OPEN,
+                              "write on a closed PipeTransport");
+      if (callback) {
+        callback->writeErr(0, ex);
+      }
+      return;
+    }
+    peer_->readBuf_.append(std::move(iob));
+    peer_->scheduleRead();
+    if (callback) {
+      callback->writeSuccess();
+    }
+  }
+
+  void close() override {
+    closeNow();
+  }
+  void closeNow() override {
+    shutdownWriteNow();
+    if (readCallback_) {
+      auto callback = readCallback_;
+      readCallback_ = nullptr;
+      callback->readEOF();
+    }
+  }
+  void shutdownWrite() override {
+    shutdownWriteNow();
+  }
+  void shutdownWriteNow() override {
+    if (!writeClosed_) {
+      writeClosed_ = true;
+      if (peer_) {
+        peer_->readEOF_ = true;
+        peer_->scheduleRead();
+      }
+    }
+  }
+
+  void getPeerAddress(SocketAddress* addr) const override {
+    addr->setFromIpPort("127.0.0.1", 443);
+  }
+  void getLocalAddress(SocketAddress* addr) const override {
+    addr->setFromIpPort("127.0.0.1", 443);
+  }
+  bool good() const override {
+    return !writeClosed_ && !readEOF_;
+  }
+  bool readable() const override {
+    return !readBuf_.empty();
+  }
+  bool connecting() const override {
+    return false;
+  }
+  bool error() const override {
+    return false;
+  }
+  void attachEventBase(EventBase* evb) override {
+    evb_ = evb;
+  }
+  void detachEventBase() override {
+    cancelLoopCallback();
+    evb_ = nullptr;
+  }
+  bool isDetachable() const override {
+    return true;
+  }
+  EventBase* getEventBase() const override {
+    return evb_;
+  }
+  void setSendTimeout(uint32_t milliseconds) override {
+    sendTimeout_ = milliseconds;
+  }
+  uint32_t getSendTimeout() const override {
+    return sendTimeout_;
+  }
+  size_t getAppBytesWritten() const override { return 0; }
+  size_t getRawBytesWritten() const override { return 0; }
+  size_t getAppBytesReceived() const override { return 0; }
+  size_t getRawBytesReceived() const override { return 0; }
+  bool isEorTrackingEnabled() const override { return false; }
+  void setEorTracking(bool) override {}
+
+  void destroy() override {
+    closeNow();
+    AsyncTransportWrapper::destroy();
+  }
+
+ private:
+  ~PipeTransport() override {
+    if (peer_) {
+      peer_->peer_ = nullptr;
+    }
+  }
+
+  void scheduleRead() {
+    if (readCallback_ && evb_ && !isLoopCallbackScheduled() &&
+        (!readBuf_.empty() || readEOF_)) {
+      evb_->runInLoop(this);
+    }
+  }
+
+  void runLoopCallback() noexcept override {
+    DestructorGuard dg(this);
+    if (readCallback_ && !readBuf_.empty()) {
+      readCallback_->readBufferAvailable(readBuf_.move());
+    }
+    if (readCallback_ && readEOF_) {
+      auto callback = readCallback_;
+      readCallback_ = nullptr;
+      callback->readEOF();
+    }
+  }
+
+  EventBase* evb_;
+  PipeTransport* peer_{nullptr};
+  ReadCallback* readCallback_{nullptr};
+  IOBufQueue readBuf_{IOBufQueue::cacheChainLength()};
+  bool readEOF_{false};
+  bool writeClosed_{false};
+  uint32_t sendTimeout_{0};
+};
+
+class BaseHandler : public HTTPTransactionHandler {
+ public:
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void onBody(std::unique_ptr<IOBuf> chain) noexcept override {
+    doNotOptimizeAway(chain->computeChainDataLength());
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {}
+  void onUpgrade(UpgradeProtocol) noexcept override {}
+  void onError(const HTTPException& error) noexcept override {
+    LOG(FATAL) << "Transaction error: " << error.what();
+  }
+  void onEgressPaused() noexcept override {}
+  void onEgressResumed() noexcept override {}
+
+ protected:
+  HTTPTransaction* txn_{nullptr};
+};
+
+class ServerHandler : public BaseHandler {
+ public:
+  explicit ServerHandler(const IOBuf& body)
+      : body_(body) {}
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage>) noexcept override {}
+  void onEOM() noexcept override {
+    HTTPMessage resp;
+    resp.setHTTPVersion(1, 1);
+    resp.setStatusCode(200);
+    resp.setStatusMessage("OK");
+    resp.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH,
+                          folly::to<std::string>(body_.length()));
+    txn_->sendHeaders(resp);
+    txn_->sendBody(body_.clone());
+    txn_->sendEOM();
+  }
+  void detachTransaction() noexcept override {
+    delete this;
+  }
+
+ private:
+  const IOBuf& body_;
+};
+
+class Controller : public HTTPSessionController {
+ public:
+  explicit Controller(size_t responseSize)
+      : body_(IOBuf::CREATE, responseSize) {
+    memset(body_.writableData(), 'a', responseSize);
+    body_.append(responseSize);
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction&,
+                                            HTTPMessage*) override {
+    return new ServerHandler(body_);
+  }
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction*, const HTTPException& error,
+      const SocketAddress&) override {
+    LOG(FATAL) << "Parse error: " << error.what();
+    return nullptr;
+  }
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction*, const SocketAddress&) override {
+    LOG(FATAL) << "Transaction timeout";
+    return nullptr;
+  }
+  void attachSession(HTTPSessionBase*) override {}
+  void detachSession(const HTTPSessionBase*) override {
+    detached_ = true;
+  }
+
+  bool isDetached() const {
+    return detached_;
+  }
+
+ private:
+  IOBuf body_;
+  bool detached_{false};
+};
+
+/**
+ * Sends requests on a client session, keeping up to concurrency of them in
+ * flight until it has sent them all.
+ */
+class Client {
+ public:
+  Client(EventBase& evb, HTTPUpstreamSession* session, size_t concurrency)
+      : evb_(evb), session_(session), concurrency_(concurrency) {
+    request_.setMethod(HTTPMethod::GET);
+    request_.setHTTPVersion(1, 1);
+    request_.setURL("/index.html");
+    request_.getHeaders().add(HTTP_HEADER_HOST, "www.example.com");
+  }
+
+  // Sends requests and loops until they have all completed.  Not with
+  // loop(), which waits for the sessions' timeouts
+  void run(size_t requests) {
+    remaining_ = requests;
+    for (size_t i = 0; i < concurrency_ && remaining_ > 0; i++) {
+      sendRequest();
+    }
+    while (completed_ < requests) {
+      evb_.loopOnce();
+    }
+    completed_ = 0;
+  }
+
+ private:
+  class Handler : public BaseHandler {
+   public:
+    explicit Handler(Client& client)
+        : client_(client) {}
+
+    void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept
+        override {
+      CHECK_EQ(msg->getStatusCode(), 200);
+    }
+    void onEOM() noexcept override {}
+    void detachTransaction() noexcept override {
+      auto& client = client_;
+      delete this;
+      client.onComplete();
+    }
+
+   private:
+    Client& client_;
+  };
+
+  void sendRequest() {
+    remaining_--;
+    auto txn = session_->newTransaction(new Handler(*this));
+    CHECK(txn);
+    txn->sendHeaders(request_);
+    txn->sendEOM();
+  }
+
+  void onComplete() {
+    completed_++;
+    if (remaining_ > 0) {
+      // Not from the session's callback, as a client would
+      evb_.runInLoop([this] { sendRequest(); }, true);
+    }
+  }
+
+  EventBase& evb_;
+  HTTPUpstreamSession* session_;
+  size_t concurrency_;
+  HTTPMessage request_;
+  size_t remaining_{0};
+  size_t completed_{0};
+};
+
+std::unique_ptr<HTTPCodec> makeCodec(bool h2, TransportDirection direction) {
+  if (h2) {
+    return std::make_unique<HTTP2Codec>(direction);
+  }
+  return std::make_unique<HTTP1xCodec>(direction);
+}
+
+void sessionBench(bool h2, size_t concurrency, size_t responseSize,
+                  int iters) {
+  EventBase evb;
+  HHWheelTimer::UniquePtr timer;
+  std::unique_ptr<Controller> controller;
+  HTTPUpstreamSession* upstream = nullptr;
+  std::unique_ptr<Client> client;
+  BENCHMARK_SUSPEND {
+    timer = HHWheelTimer::newTimer(
+      &evb,
+      std::chrono::milliseconds(HHWheelTimer::DEFAULT_TICK_INTERVAL),
+      TimeoutManager::InternalEnum::INTERNAL,
+      std::chrono::milliseconds(5000));
+    controller = std::make_unique<Controller>(responseSize);
+    auto clientSock = new PipeTransport(&evb);
+    auto serverSock = new PipeTransport(&evb);
+    PipeTransport::connect(clientSock, serverSock);
+    SocketAddress addr("127.0.0.1", 443);
+    wangle::TransportInfo tinfo;
+    auto downstream = new HTTPDownstreamSession(
+      timer.get(), AsyncTransportWrapper::UniquePtr(serverSock), addr, addr,
+      controller.get(), makeCodec(h2, TransportDirection::DOWNSTREAM), tinfo,
+      nullptr);
+    downstream->startNow();
+    upstream = new HTTPUpstreamSession(
+      timer.get(), AsyncTransportWrapper::UniquePtr(clientSock), addr, addr,
+      makeCodec(h2, TransportDirection::UPSTREAM), tinfo, nullptr);
+    upstream->setMaxConcurrentOutgoingStreams(concurrency);
+    upstream->startNow();
+    client = std::make_unique<Client>(evb, upstream, concurrency);
+    // The settings exchange, first request and connection setup
+    client->run(1);
+  }
+  client->run(iters);
+  BENCHMARK_SUSPEND {
+    // Closes both sessions, which delete themselves
+    upstream->dropConnection();
+    while (!controller->isDetached()) {
+      evb.loopOnce();
+    }
+    client.reset();
+    timer.reset();
+  }
+}
+
+}
+
+BENCHMARK(HTTP1xSerial, iters) {
+  sessionBench(false, 1, 100, iters);
+}
+
+BENCHMARK(HTTP2Serial, iters) {
+  sessionBench(true, 1, 100, iters);
+}
+
+BENCHMARK(HTTP2Concurrent10, iters) {
+  sessionBench(true, 10, 100, iters);
+}
+
+BENCHMARK(HTTP2Concurrent100, iters) {
+  sessionBench(true, 100, 100, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(HTTP1xSerialLarge, iters) {
+  sessionBench(false, 1, 16 * 1024, iters);
+}
+
+BENCHMARK(HTTP2SerialLarge, iters) {
+  sessionBench(true, 1, 16 * 1024, iters);
+}
+
+BENCHMARK(HTTP2Concurrent10Large, iters) {
+  sessionBench(true, 10, 16 * 1024, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -210,6 +210,16 @@ class MockHTTPHandler
 
   GMOCK_NOEXCEPT_METHOD1(onBodyRejected, void(uint64_t));
 
+  void onDatagram(std::unique_ptr<folly::IOBuf> datagram) noexcept override {
+    onDatagram(std::shared_ptr<folly::IOBuf>(datagram.release()));
+  }
+  GMOCK_NOEXCEPT_METHOD1(onDatagram,
+                         void(std::shared_ptr<folly::IOBuf> datagram));
+
+  GMOCK_NOEXCEPT_METHOD0(onDatagramEgressPaused, void());
+
+  GMOCK_NOEXCEPT_METHOD0(onDatagramEgressResumed, void());
+
   void expectTransaction(std::function<void(HTTPTransaction* txn)> callback) {
     EXPECT_CALL(*this, setTransaction(testing::_))
         .WillOnce(testing::Invoke(callback))
@@ -503,6 +513,11 @@ class MockHTTPSessionStats : public DummyHTTPSessionStats {
   GMOCK_NOEXCEPT_METHOD1(recordSessionIdleTime, void(std::chrono::seconds));
   GMOCK_NOEXCEPT_METHOD0(recordTransactionStalled, void());
   GMOCK_NOEXCEPT_METHOD0(recordSessionStalled, void());
+  GMOCK_NOEXCEPT_METHOD1(recordReadBufferPoolOccupancy, void(size_t));
+  GMOCK_NOEXCEPT_METHOD2(recordSessionHibernated, void(size_t, size_t));
+  GMOCK_NOEXCEPT_METHOD1(recordQPACKVulnerableBudget, void(uint32_t));
+  GMOCK_NOEXCEPT_METHOD3(recordQPACKBlocking,
+                         void(uint64_t, uint64_t, std::chrono::microseconds));
 };
 
 } // namespace proxygen
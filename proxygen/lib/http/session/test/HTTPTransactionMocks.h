@@ -137,6 +137,16 @@ class MockHTTPTransactionTransport: public HTTPTransaction::Transport {
                folly::Expected<folly::Optional<uint64_t>, ErrorCode>(
                    HTTPTransaction*, uint64_t));
 
+  GMOCK_METHOD0_(, noexcept,, getDatagramSizeLimitNonConst, uint16_t());
+  uint16_t getDatagramSizeLimit() const noexcept override {
+    return const_cast<MockHTTPTransactionTransport*>(this)
+      ->getDatagramSizeLimitNonConst();
+  }
+  bool sendDatagram(std::unique_ptr<folly::IOBuf> datagram) override {
+    return sendDatagram(std::shared_ptr<folly::IOBuf>(datagram.release()));
+  }
+  MOCK_METHOD1(sendDatagram, bool(std::shared_ptr<folly::IOBuf>));
+
   MockHTTPCodec mockCodec_;
 };
 
@@ -273,6 +283,7 @@ class MockHTTPTransaction : public HTTPTransaction {
       void(folly::AsyncTransport::ReplaySafetyCallback*));
   MOCK_METHOD1(removeWaitingForReplaySafety,
       void(folly::AsyncTransport::ReplaySafetyCallback*));
+  MOCK_CONST_METHOD0(isReplaySafe, bool());
 
   void enablePush() {
     EXPECT_CALL(mockCodec_, supportsPushTransactions())
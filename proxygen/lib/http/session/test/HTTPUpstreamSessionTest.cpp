@@ -1063,6 +1063,40 @@ TEST_F(HTTPUpstreamSessionTest, 10Requests) {
   httpSession_->destroy();
 }
 
+TEST_F(HTTPUpstreamSessionTest, HoldUnsafeRequestUntilReplaySafe) {
+  EXPECT_CALL(*transport_, isReplaySafe())
+    .WillRepeatedly(Return(false));
+  httpSession_->setHoldUnsafeRequestsUntilReplaySafe(true);
+
+  // A safe request is sent as early data
+  testBasicRequest();
+  EXPECT_FALSE(writes_.empty());
+  writes_.move();
+
+  InSequence enforceOrder;
+  auto handler = openTransaction();
+  handler->expectHeaders();
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+
+  HTTPMessage req = getGetRequest();
+  req.setMethod(HTTPMethod::POST);
+  handler->sendRequest(req);
+  eventBase_.loop();
+  EXPECT_TRUE(writes_.empty());
+
+  ON_CALL(*transport_, isReplaySafe())
+    .WillByDefault(Return(true));
+  replaySafetyCallback_->onReplaySafe();
+  eventBase_.loop();
+  EXPECT_FALSE(writes_.empty());
+
+  readAndLoop("HTTP/1.1 200 OK\r\n"
+              "Transfer-Encoding: chunked\r\n\r\n"
+              "0\r\n\r\n");
+  httpSession_->destroy();
+}
+
 TEST_F(HTTPUpstreamSessionTest, TestFirstHeaderByteEventTracker) {
   auto byteEventTracker = setMockByteEventTracker();
 
@@ -2570,6 +2604,7 @@ TEST_F(MockHTTP2UpstreamTest, DelayUpstreamWindowUpdate) {
 
   HTTPMessage req = getGetRequest();
   handler->txn_->sendHeaders(req);
+  eventBase_.loopOnce();
   handler->expectDetachTransaction();
   handler->txn_->sendAbort();
   httpSession_->destroy();
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HistogramHTTPSessionStats.h>
+
+#include <thread>
+
+using namespace proxygen;
+using std::chrono::microseconds;
+
+TEST(HistogramHTTPSessionStatsTest, RecordAndSnapshot) {
+  HistogramHTTPSessionStats stats;
+  stats.recordHeaderParseTime(microseconds(10));
+  stats.recordTimeToFirstByte(microseconds(100));
+  stats.recordTimeToLastByte(microseconds(200));
+  stats.recordRequestDuration(microseconds(300));
+  stats.recordRequestDuration(microseconds(500));
+
+  auto snapshot = stats.getSnapshot();
+  EXPECT_EQ(snapshot.headerParseTime.getCount(), 1);
+  EXPECT_EQ(snapshot.headerParseTime.getMax(), 10);
+  EXPECT_EQ(snapshot.timeToFirstByte.getSum(), 100);
+  EXPECT_EQ(snapshot.timeToLastByte.getSum(), 200);
+  EXPECT_EQ(snapshot.requestDuration.getCount(), 2);
+  EXPECT_EQ(snapshot.requestDuration.getMax(), 500);
+}
+
+TEST(HistogramHTTPSessionStatsTest, MergesThreads) {
+  HistogramHTTPSessionStats stats;
+  const int kThreads = 4;
+  const int kValues = 1000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&stats] {
+        for (int v = 1; v <= kValues; v++) {
+          stats.recordTimeToFirstByte(microseconds(v));
+        }
+      });
+  }
+  // snapshots may be taken while the threads record
+  EXPECT_LE(stats.getSnapshot().timeToFirstByte.getCount(),
+            kThreads * kValues);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  stats.recordTimeToFirstByte(microseconds(kValues + 1));
+
+  // the values of the threads that exited are kept
+  auto snapshot = stats.getSnapshot();
+  EXPECT_EQ(snapshot.timeToFirstByte.getCount(), kThreads * kValues + 1);
+  EXPECT_EQ(snapshot.timeToFirstByte.getMax(), kValues + 1);
+  EXPECT_EQ(snapshot.timeToFirstByte.getSum(),
+            kThreads * kValues * (kValues + 1) / 2 + kValues + 1);
+  EXPECT_EQ(snapshot.requestDuration.getCount(), 0);
+}
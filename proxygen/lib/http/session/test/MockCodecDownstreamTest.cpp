@@ -757,6 +757,7 @@ TEST_F(MockCodecDownstreamTest, FlowControlAbort) {
   EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, spdy::kInitialWindow));
   codecCallback_->onBody(HTTPCodec::StreamID(1),
                          makeBuf(spdy::kInitialWindow), 0);
+  eventBase_.loopOnce();
   EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, spdy::kInitialWindow));
   codecCallback_->onBody(HTTPCodec::StreamID(1),
                          makeBuf(spdy::kInitialWindow), 0);
@@ -1106,9 +1107,9 @@ TEST_F(MockCodecDownstreamTest, UnpausedLargePost) {
 
   EXPECT_CALL(handler1, onHeadersComplete(_));
   for (unsigned i = 0; i < kNumChunks; ++i) {
-    EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, spdy::kInitialWindow));
     EXPECT_CALL(handler1,
                 onBodyWithOffset(_, PtrBufHasLen(spdy::kInitialWindow)));
+    EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, spdy::kInitialWindow));
     EXPECT_CALL(*codec_, generateWindowUpdate(_, 1, spdy::kInitialWindow));
   }
   EXPECT_CALL(handler1, onEOM());
@@ -1116,9 +1117,10 @@ TEST_F(MockCodecDownstreamTest, UnpausedLargePost) {
   codecCallback_->onMessageBegin(1, req1.get());
   codecCallback_->onHeadersComplete(1, std::move(req1));
   // Give kNumChunks chunks, each of the maximum window size. We should generate
-  // window update for each chunk
+  // window update for each chunk, at the end of the loop it was received in
   for (unsigned i = 0; i < kNumChunks; ++i) {
     codecCallback_->onBody(1, makeBuf(spdy::kInitialWindow), 0);
+    eventBase_.loopOnce();
   }
   codecCallback_->onMessageComplete(1, false);
 
@@ -1127,6 +1129,38 @@ TEST_F(MockCodecDownstreamTest, UnpausedLargePost) {
   httpSession_->dropConnection();
 }
 
+TEST_F(MockCodecDownstreamTest, CoalescedWindowUpdates) {
+  // Window updates due within one loop go out as one per stream and one for
+  // the session
+  InSequence enforceOrder;
+  NiceMock<MockHTTPHandler> handler1;
+  unsigned kNumChunks = 4;
+  auto chunkSize = spdy::kInitialWindow / kNumChunks;
+  auto req1 = makePostRequest(spdy::kInitialWindow * 2);
+
+  EXPECT_CALL(mockController_, getRequestHandler(_, _))
+    .WillOnce(Return(&handler1));
+  EXPECT_CALL(handler1, setTransaction(_))
+    .WillOnce(SaveArg<0>(&handler1.txn_));
+
+  EXPECT_CALL(handler1, onHeadersComplete(_));
+  EXPECT_CALL(handler1, onBodyWithOffset(_, PtrBufHasLen(chunkSize)))
+    .Times(kNumChunks);
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, spdy::kInitialWindow));
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 1, spdy::kInitialWindow));
+
+  codecCallback_->onMessageBegin(1, req1.get());
+  codecCallback_->onHeadersComplete(1, std::move(req1));
+  for (unsigned i = 0; i < kNumChunks; ++i) {
+    codecCallback_->onBody(1, makeBuf(chunkSize), 0);
+  }
+  eventBase_.loopOnce();
+
+  // Just tear everything down now.
+  EXPECT_CALL(mockController_, detachSession(_));
+  httpSession_->dropConnection();
+}
+
 TEST_F(MockCodecDownstreamTest, IngressPausedWindowUpdate) {
   // Test sending a large response body while the handler has ingress paused. We
   // should process the ingress window_updates and deliver the full body
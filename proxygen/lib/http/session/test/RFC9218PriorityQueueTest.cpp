@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) 2015-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <map>
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/RFC9218PriorityQueue.h>
+
+using namespace testing;
+
+namespace {
+static char* fakeTxn = (char*)0xface0000;
+
+proxygen::HTTPTransaction* makeFakeTxn(proxygen::HTTPCodec::StreamID id) {
+  return (proxygen::HTTPTransaction*)(fakeTxn + id);
+}
+
+proxygen::HTTPCodec::StreamID getTxnID(proxygen::HTTPTransaction* txn) {
+  return (proxygen::HTTPCodec::StreamID)((char*)txn - fakeTxn);
+}
+
+}
+
+namespace proxygen {
+
+using IDList = std::vector<std::pair<HTTPCodec::StreamID, double>>;
+
+class RFC9218QueueTest : public testing::Test {
+ protected:
+  void addTransaction(HTTPCodec::StreamID id, uint8_t urgency,
+                      bool incremental, bool enqueue = true) {
+    handles_[id] = q_.addTransaction(id, urgency, incremental,
+                                     makeFakeTxn(id));
+    if (enqueue) {
+      q_.signalPendingEgress(handles_[id]);
+    }
+  }
+
+  void removeTransaction(HTTPCodec::StreamID id) {
+    q_.removeTransaction(handles_[id]);
+    handles_.erase(id);
+  }
+
+  IDList nextEgress() {
+    HTTPEgressPriorityQueue::NextEgressResult result;
+    q_.nextEgress(result);
+    IDList ids;
+    for (auto& p : result) {
+      ids.emplace_back(getTxnID(p.first), p.second);
+    }
+    return ids;
+  }
+
+  RFC9218PriorityQueue q_;
+  std::map<HTTPCodec::StreamID, HTTP2PriorityQueueBase::Handle> handles_;
+};
+
+TEST_F(RFC9218QueueTest, UrgencyFromWeight) {
+  EXPECT_EQ(RFC9218PriorityQueue::urgencyFromPriority({0, false, 15}),
+            RFC9218PriorityQueue::kDefaultUrgency);
+  EXPECT_EQ(RFC9218PriorityQueue::urgencyFromPriority({0, false, 0}), 7);
+  EXPECT_EQ(RFC9218PriorityQueue::urgencyFromPriority({0, false, 127}), 0);
+  EXPECT_EQ(RFC9218PriorityQueue::urgencyFromPriority({0, false, 255}), 0);
+  EXPECT_EQ(RFC9218PriorityQueue::urgencyFromPriority({1, true, 63}), 1);
+}
+
+TEST_F(RFC9218QueueTest, UrgencyToWeight) {
+  for (uint8_t u = 0; u < RFC9218PriorityQueue::kNumUrgencies; u++) {
+    auto pri = RFC9218PriorityQueue::priorityFromUrgency(u, 1);
+    EXPECT_EQ(pri.streamDependency, 1);
+    EXPECT_EQ(RFC9218PriorityQueue::urgencyFromPriority(pri), u);
+  }
+  EXPECT_EQ(RFC9218PriorityQueue::priorityFromUrgency(
+              RFC9218PriorityQueue::kDefaultUrgency, 0).weight, 15);
+}
+
+TEST_F(RFC9218QueueTest, ParsePriorityField) {
+  uint8_t urgency;
+  bool incremental;
+  RFC9218PriorityQueue::parsePriorityField("u=1, i", urgency, incremental);
+  EXPECT_EQ(urgency, 1);
+  EXPECT_TRUE(incremental);
+  RFC9218PriorityQueue::parsePriorityField("i=?0,u=5", urgency, incremental);
+  EXPECT_EQ(urgency, 5);
+  EXPECT_FALSE(incremental);
+  RFC9218PriorityQueue::parsePriorityField("i=?1;p, x=2", urgency,
+                                           incremental);
+  EXPECT_EQ(urgency, RFC9218PriorityQueue::kDefaultUrgency);
+  EXPECT_TRUE(incremental);
+  // Out of range or non integer urgencies are ignored
+  RFC9218PriorityQueue::parsePriorityField("u=8", urgency, incremental);
+  EXPECT_EQ(urgency, RFC9218PriorityQueue::kDefaultUrgency);
+  RFC9218PriorityQueue::parsePriorityField("u=a, i=1", urgency, incremental);
+  EXPECT_EQ(urgency, RFC9218PriorityQueue::kDefaultUrgency);
+  EXPECT_FALSE(incremental);
+  RFC9218PriorityQueue::parsePriorityField("", urgency, incremental);
+  EXPECT_EQ(urgency, RFC9218PriorityQueue::kDefaultUrgency);
+  EXPECT_FALSE(incremental);
+}
+
+TEST_F(RFC9218QueueTest, MostUrgentFirst) {
+  addTransaction(1, 5, false);
+  addTransaction(3, 1, false);
+  addTransaction(5, 3, false);
+  EXPECT_EQ(q_.numPendingEgress(), 3);
+
+  EXPECT_EQ(nextEgress(), IDList({{3, 1.0}}));
+  q_.clearPendingEgress(handles_[3]);
+  EXPECT_EQ(nextEgress(), IDList({{5, 1.0}}));
+  removeTransaction(5);
+  EXPECT_EQ(nextEgress(), IDList({{1, 1.0}}));
+  removeTransaction(1);
+  EXPECT_TRUE(nextEgress().empty());
+  EXPECT_TRUE(q_.empty());
+}
+
+TEST_F(RFC9218QueueTest, SequentialInStreamOrder) {
+  addTransaction(1, 3, false);
+  addTransaction(3, 3, false);
+  addTransaction(5, 3, false);
+  EXPECT_EQ(nextEgress(), IDList({{1, 1.0}}));
+  // Re-enqueueing keeps stream order
+  q_.clearPendingEgress(handles_[1]);
+  EXPECT_EQ(nextEgress(), IDList({{3, 1.0}}));
+  q_.signalPendingEgress(handles_[1]);
+  EXPECT_EQ(nextEgress(), IDList({{1, 1.0}}));
+}
+
+TEST_F(RFC9218QueueTest, IncrementalShare) {
+  addTransaction(1, 3, true);
+  addTransaction(3, 3, true);
+  EXPECT_EQ(nextEgress(), IDList({{1, 0.5}, {3, 0.5}}));
+  // rotated for fairness
+  EXPECT_EQ(nextEgress(), IDList({{3, 0.5}, {1, 0.5}}));
+  // a non-incremental stream at the same urgency goes first
+  addTransaction(5, 3, false);
+  EXPECT_EQ(nextEgress(), IDList({{5, 1.0}}));
+  removeTransaction(5);
+  EXPECT_EQ(nextEgress().size(), 2);
+}
+
+TEST_F(RFC9218QueueTest, UpdatePriority) {
+  addTransaction(1, 3, false);
+  addTransaction(3, 4, false);
+  EXPECT_EQ(nextEgress(), IDList({{1, 1.0}}));
+  handles_[3] = q_.updatePriority(handles_[3], 0, false);
+  EXPECT_EQ(nextEgress(), IDList({{3, 1.0}}));
+  // Not enqueued nodes stay that way
+  q_.clearPendingEgress(handles_[3]);
+  handles_[3] = q_.updatePriority(handles_[3], 1, true);
+  EXPECT_FALSE(handles_[3]->isEnqueued());
+  EXPECT_EQ(nextEgress(), IDList({{1, 1.0}}));
+  EXPECT_EQ(q_.numPendingEgress(), 1);
+}
+
+TEST_F(RFC9218QueueTest, MemoryUsage) {
+  EXPECT_EQ(q_.getMemoryUsage(), 0);
+  addTransaction(1, 3, false);
+  addTransaction(3, 3, true, false);
+  auto bytes = q_.getMemoryUsage();
+  EXPECT_GT(bytes, 0);
+  removeTransaction(1);
+  EXPECT_EQ(q_.getMemoryUsage(), bytes / 2);
+  removeTransaction(3);
+  EXPECT_EQ(q_.getMemoryUsage(), 0);
+}
+
+TEST_F(RFC9218QueueTest, IterateAll) {
+  addTransaction(1, 6, false);
+  addTransaction(3, 2, false, false);
+  addTransaction(5, 2, true);
+  std::vector<HTTPCodec::StreamID> ids;
+  q_.iterateTransactions([&ids] (HTTPTransaction* txn) {
+                           ids.push_back(getTxnID(txn));
+                         }, [] { return false; });
+  EXPECT_EQ(ids, std::vector<HTTPCodec::StreamID>({3, 5, 1}));
+
+  ids.clear();
+  q_.iterateTransactions([&ids] (HTTPTransaction* txn) {
+                           ids.push_back(getTxnID(txn));
+                         }, [&ids] { return !ids.empty(); });
+  EXPECT_EQ(ids, std::vector<HTTPCodec::StreamID>({3, 5}));
+}
+
+}
@@ -0,0 +1,50 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/RttEstimator.h>
+
+using namespace proxygen;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+TEST(RttEstimatorTest, Smoothing) {
+  RttEstimator estimator;
+  EXPECT_EQ(0, estimator.getNumSamples());
+  EXPECT_EQ(microseconds(0), estimator.getSrtt());
+
+  estimator.addSample(microseconds(8000));
+  EXPECT_EQ(microseconds(8000), estimator.getSrtt());
+  EXPECT_EQ(microseconds(4000), estimator.getRttVar());
+
+  estimator.addSample(microseconds(16000));
+  // 7/8 * 8000 + 1/8 * 16000, 3/4 * 4000 + 1/4 * 8000
+  EXPECT_EQ(microseconds(9000), estimator.getSrtt());
+  EXPECT_EQ(microseconds(5000), estimator.getRttVar());
+  EXPECT_EQ(microseconds(8000), estimator.getMinRtt());
+  EXPECT_EQ(2, estimator.getNumSamples());
+}
+
+TEST(RttEstimatorTest, Pings) {
+  RttEstimator estimator;
+  auto now = getCurrentTime();
+  EXPECT_FALSE(estimator.onPingReply(now));
+
+  estimator.onPingSent(now);
+  EXPECT_TRUE(estimator.isPingOutstanding());
+  // The sample runs from the first PING outstanding
+  estimator.onPingSent(now + milliseconds(5));
+  EXPECT_TRUE(estimator.onPingReply(now + milliseconds(10)));
+  EXPECT_FALSE(estimator.isPingOutstanding());
+  EXPECT_EQ(milliseconds(10), estimator.getSrtt());
+
+  // The reply to the second PING
+  EXPECT_FALSE(estimator.onPingReply(now + milliseconds(15)));
+  EXPECT_EQ(1, estimator.getNumSamples());
+}
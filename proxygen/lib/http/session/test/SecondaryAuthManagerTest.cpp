@@ -123,3 +123,59 @@ TEST(SecondaryAuthManagerTest, Authenticator) {
             StringPiece(hexlify(((*peerCert)[0].cert_data)->coalesce())));
   EXPECT_TRUE(isValid);
 }
+
+TEST(SecondaryAuthManagerTest, RepeatedExchange) {
+  folly::ssl::init();
+  auto cert = fizz::test::getCert(kP256Certificate);
+  auto key = fizz::test::getPrivateKey(kP256Key);
+  std::vector<folly::ssl::X509UniquePtr> certs;
+  certs.push_back(std::move(cert));
+  SecondaryAuthManager authManager(
+      std::make_unique<SelfCertImpl<KeyType::P256>>(std::move(key),
+                                                    std::move(certs)));
+  fizz::SignatureAlgorithms sigAlgs;
+  sigAlgs.supported_signature_algorithms.push_back(
+      SignatureScheme::ecdsa_secp256r1_sha256);
+  std::vector<fizz::Extension> extensions;
+  extensions.push_back(encodeExtension(std::move(sigAlgs)));
+  auto authRequestPair = authManager.createAuthRequest(
+      folly::IOBuf::copyBuffer("0123456789abcdef"), std::move(extensions));
+  auto requestId = authRequestPair.first;
+  auto authRequest = std::move(authRequestPair.second);
+
+  MockAsyncFizzBase fizzBase;
+  EXPECT_CALL(fizzBase, getCipher()).WillRepeatedly(InvokeWithoutArgs([]() {
+    folly::Optional<CipherSuite> cipher = CipherSuite::TLS_AES_128_GCM_SHA256;
+    return cipher;
+  }));
+  EXPECT_CALL(fizzBase, getSupportedSigSchemes())
+      .WillRepeatedly(InvokeWithoutArgs([]() {
+        std::vector<SignatureScheme> schemes = {
+            SignatureScheme::ecdsa_secp256r1_sha256};
+        return schemes;
+      }));
+  EXPECT_CALL(fizzBase, getEkm(_, _, _)).WillRepeatedly(InvokeWithoutArgs([]() {
+    return folly::IOBuf::copyBuffer("exportedmaterial");
+  }));
+
+  // ECDSA signatures differ each time, so identical bytes were not re-signed
+  auto first = authManager.getAuthenticator(
+      fizzBase, TransportDirection::UPSTREAM, requestId, authRequest->clone());
+  auto second = authManager.getAuthenticator(
+      fizzBase, TransportDirection::UPSTREAM, requestId, authRequest->clone());
+  EXPECT_EQ(first.first, second.first);
+  EXPECT_TRUE(folly::IOBufEqualTo()(*first.second, *second.second));
+  EXPECT_EQ(authManager.getNumAuthenticatorsReused(), 1);
+
+  // The second one is accepted with the chain of the first, although its
+  // request was used up
+  EXPECT_TRUE(authManager.validateAuthenticator(
+      fizzBase, TransportDirection::UPSTREAM, 0, std::move(first.second)));
+  EXPECT_TRUE(authManager.validateAuthenticator(
+      fizzBase, TransportDirection::UPSTREAM, 1, std::move(second.second)));
+  EXPECT_EQ(authManager.getNumValidationsReused(), 1);
+  auto peerCert = authManager.getPeerCert(1);
+  ASSERT_TRUE(peerCert.hasValue());
+  EXPECT_EQ(expected_cert,
+            StringPiece(hexlify(((*peerCert)[0].cert_data)->coalesce())));
+}
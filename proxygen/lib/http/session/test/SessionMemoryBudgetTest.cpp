@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/SessionMemoryBudget.h>
+
+using namespace proxygen;
+
+TEST(SessionMemoryBudgetTest, UsageAndHighWaterMark) {
+  SessionMemoryBudget budget(1000);
+  budget.addSession();
+  budget.addSession();
+  budget.update(300);
+  budget.update(500);
+  EXPECT_EQ(budget.getUsage(), 800);
+  budget.update(-600);
+  EXPECT_EQ(budget.getUsage(), 200);
+  EXPECT_EQ(budget.getHighWaterMark(), 800);
+  budget.resetHighWaterMark();
+  EXPECT_EQ(budget.getHighWaterMark(), 200);
+
+  budget.removeSession(200);
+  EXPECT_EQ(budget.getUsage(), 0);
+  EXPECT_EQ(budget.getNumSessions(), 1);
+}
+
+TEST(SessionMemoryBudgetTest, BiggestPauseFirst) {
+  SessionMemoryBudget budget(1000);
+  for (int i = 0; i < 4; i++) {
+    budget.addSession();
+  }
+  // Under the budget no session pauses, however much it buffers
+  budget.update(900);
+  EXPECT_FALSE(budget.isExceededBy(900));
+
+  budget.update(200);
+  EXPECT_TRUE(budget.isOverLimit());
+  EXPECT_EQ(budget.getShare(), 250);
+  EXPECT_TRUE(budget.isExceededBy(900));
+  EXPECT_TRUE(budget.isExceededBy(251));
+  EXPECT_FALSE(budget.isExceededBy(250));
+  EXPECT_FALSE(budget.isExceededBy(200));
+
+  budget.update(-200);
+  EXPECT_FALSE(budget.isExceededBy(900));
+}
+
+TEST(SessionMemoryBudgetTest, Tighten) {
+  SessionMemoryBudget budget(1000);
+  budget.addSession();
+  budget.addSession();
+  budget.update(600);
+  EXPECT_FALSE(budget.isExceededBy(400));
+
+  budget.setLimit(500);
+  EXPECT_EQ(budget.getLimit(), 500);
+  EXPECT_TRUE(budget.isExceededBy(400));
+  EXPECT_FALSE(budget.isExceededBy(200));
+}
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Sockets.h>
+#include <proxygen/lib/http/session/SpliceTunnel.h>
+
+#ifdef __linux__
+
+using namespace proxygen;
+using folly::NetworkSocket;
+using std::chrono::milliseconds;
+
+class SpliceTunnelTest : public testing::Test,
+                         public SpliceTunnel::Callback {
+ public:
+  void SetUp() override {
+    // client <-> downstream, upstream <-> server
+    makePair(client_, downstream_);
+    makePair(upstream_, server_);
+  }
+
+  void TearDown() override {
+    tunnel_.reset();
+    for (auto fd : {client_, downstream_, server_}) {
+      folly::netops::close(fd);
+    }
+  }
+
+  void onTunnelClosed(SpliceTunnel& tunnel,
+                      ProxygenError err) noexcept override {
+    EXPECT_EQ(&tunnel, tunnel_.get());
+    closed_ = err;
+  }
+
+ protected:
+  static void makePair(NetworkSocket& a, NetworkSocket& b) {
+    NetworkSocket fds[2];
+    ASSERT_EQ(folly::netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    for (auto fd : fds) {
+      ASSERT_EQ(::fcntl(fd.toFd(), F_SETFL, O_NONBLOCK), 0);
+    }
+    a = fds[0];
+    b = fds[1];
+  }
+
+  void makeTunnel(milliseconds idleTimeout = milliseconds(1000)) {
+    tunnel_ = std::make_unique<SpliceTunnel>(
+      &evb_, downstream_, upstream_,
+      WheelTimerInstance(idleTimeout, &evb_), this);
+    ASSERT_TRUE(tunnel_->init());
+  }
+
+  void write(NetworkSocket fd, const std::string& data) {
+    ASSERT_EQ(folly::netops::send(fd, data.data(), data.size(), 0),
+              static_cast<ssize_t>(data.size()));
+  }
+
+  // Loops until size bytes could be read from fd, or an EOF with size 0
+  std::string read(NetworkSocket fd, size_t size) {
+    std::string result;
+    char buf[1024];
+    for (int i = 0; i < 100 && result.size() < size; i++) {
+      evb_.loopOnce(EVLOOP_NONBLOCK);
+      auto n = folly::netops::recv(fd, buf, sizeof(buf), 0);
+      if (n > 0) {
+        result.append(buf, n);
+      } else if (n == 0 && size == 0) {
+        break;
+      }
+    }
+    return result;
+  }
+
+  folly::EventBase evb_;
+  NetworkSocket client_;
+  NetworkSocket downstream_;
+  NetworkSocket upstream_;
+  NetworkSocket server_;
+  std::unique_ptr<SpliceTunnel> tunnel_;
+  folly::Optional<ProxygenError> closed_;
+};
+
+TEST_F(SpliceTunnelTest, Relay) {
+  makeTunnel();
+  tunnel_->addPendingUpstream(folly::IOBuf::copyBuffer("early "));
+  tunnel_->start();
+  write(client_, "hello");
+  EXPECT_EQ(read(server_, 11), "early hello");
+  write(server_, "world");
+  EXPECT_EQ(read(client_, 5), "world");
+  EXPECT_EQ(tunnel_->getBytesUpstream(), 11);
+  EXPECT_EQ(tunnel_->getBytesDownstream(), 5);
+
+  // Each direction ends with its EOF, then the tunnel closes
+  folly::netops::shutdown(client_, SHUT_WR);
+  EXPECT_EQ(read(server_, 0), "");
+  EXPECT_FALSE(closed_);
+  write(server_, "bye");
+  folly::netops::shutdown(server_, SHUT_WR);
+  EXPECT_EQ(read(client_, 3), "bye");
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_TRUE(closed_);
+  EXPECT_EQ(*closed_, kErrorNone);
+  EXPECT_EQ(tunnel_->getBytesDownstream(), 8);
+}
+
+TEST_F(SpliceTunnelTest, LargeTransfer) {
+  makeTunnel();
+  tunnel_->start();
+  // Several pipes' worth, past what the socket buffers hold
+  std::string data(4 * SpliceTunnel::kPipeSize, 'a');
+  size_t sent = 0;
+  std::string received;
+  char buf[16 * 1024];
+  for (int i = 0; i < 10000 && received.size() < data.size(); i++) {
+    if (sent < data.size()) {
+      auto n = folly::netops::send(client_, data.data() + sent,
+                                   data.size() - sent, 0);
+      if (n > 0) {
+        sent += n;
+      }
+    }
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+    auto n = folly::netops::recv(server_, buf, sizeof(buf), 0);
+    if (n > 0) {
+      received.append(buf, n);
+    }
+  }
+  EXPECT_EQ(received, data);
+  EXPECT_EQ(tunnel_->getBytesUpstream(), data.size());
+}
+
+TEST_F(SpliceTunnelTest, IdleTimeout) {
+  makeTunnel(milliseconds(10));
+  tunnel_->start();
+  evb_.runAfterDelay([this] { evb_.terminateLoopSoon(); }, 100);
+  evb_.loop();
+  ASSERT_TRUE(closed_);
+  EXPECT_EQ(*closed_, kErrorTimeout);
+}
+
+#endif
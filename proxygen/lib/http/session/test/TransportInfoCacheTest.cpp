@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/TransportInfoCache.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+using wangle::TransportInfo;
+
+class TransportInfoCacheTest : public testing::Test {
+ protected:
+  // Each read reports the number of reads so far as the retransmits
+  TransportInfoCache cache_{[this](TransportInfo* tinfo) {
+    if (!readable_) {
+      return false;
+    }
+    tinfo->rtx = ++reads_;
+    return true;
+  }};
+
+  int64_t getRtx(bool socketGood = true) {
+    TransportInfo tinfo;
+    EXPECT_TRUE(cache_.get(&tinfo, socketGood, now_));
+    return tinfo.rtx;
+  }
+
+  int64_t reads_{0};
+  bool readable_{true};
+  TimePoint now_{getCurrentTime()};
+};
+
+TEST_F(TransportInfoCacheTest, Disabled) {
+  EXPECT_FALSE(cache_.enabled());
+  EXPECT_EQ(1, getRtx());
+  EXPECT_EQ(2, getRtx());
+  cache_.onClose(now_);
+  EXPECT_EQ(2, reads_);
+}
+
+TEST_F(TransportInfoCacheTest, RequestLimit) {
+  TransportInfoCache::Policy policy;
+  policy.maxRequests = 2;
+  cache_.setPolicy(policy);
+  EXPECT_EQ(1, getRtx());
+  cache_.onRequest();
+  EXPECT_EQ(1, getRtx());
+  cache_.onRequest();
+  EXPECT_EQ(2, getRtx());
+  EXPECT_EQ(2, getRtx());
+}
+
+TEST_F(TransportInfoCacheTest, AgeLimit) {
+  TransportInfoCache::Policy policy;
+  policy.maxAge = milliseconds(10);
+  cache_.setPolicy(policy);
+  EXPECT_EQ(1, getRtx());
+  now_ += milliseconds(9);
+  EXPECT_EQ(1, getRtx());
+  now_ += milliseconds(1);
+  EXPECT_EQ(2, getRtx());
+  // The age runs from the last read
+  now_ += milliseconds(9);
+  EXPECT_EQ(2, getRtx());
+}
+
+TEST_F(TransportInfoCacheTest, RefreshOnClose) {
+  TransportInfoCache::Policy policy;
+  policy.maxRequests = 10;
+  cache_.setPolicy(policy);
+  EXPECT_EQ(1, getRtx());
+  cache_.onClose(now_);
+  EXPECT_EQ(2, getRtx(false));
+
+  policy.refreshOnClose = false;
+  cache_.setPolicy(policy);
+  EXPECT_EQ(3, getRtx());
+  cache_.onClose(now_);
+  EXPECT_EQ(3, getRtx(false));
+}
+
+TEST_F(TransportInfoCacheTest, ServeLastOnceShutDown) {
+  TransportInfoCache::Policy policy;
+  policy.maxRequests = 1;
+  policy.maxAge = milliseconds(10);
+  cache_.setPolicy(policy);
+  EXPECT_EQ(1, getRtx());
+  readable_ = false;
+  cache_.onRequest();
+  now_ += milliseconds(10);
+  // Expired twice over, but the socket can't be read anymore
+  EXPECT_EQ(1, getRtx(false));
+
+  // With nothing read yet there is nothing to serve
+  cache_.setPolicy(policy);
+  TransportInfo tinfo;
+  EXPECT_FALSE(cache_.get(&tinfo, false, now_));
+}
+
+TEST_F(TransportInfoCacheTest, CopiesSocketFieldsOnly) {
+  TransportInfoCache::Policy policy;
+  policy.maxRequests = 10;
+  cache_.setPolicy(policy);
+  TransportInfo tinfo;
+  tinfo.sslError = "kept";
+  tinfo.totalBytes = 42;
+  EXPECT_TRUE(cache_.get(&tinfo, true, now_));
+  EXPECT_TRUE(cache_.get(&tinfo, true, now_));
+  EXPECT_EQ(1, reads_);
+  EXPECT_EQ(1, tinfo.rtx);
+  EXPECT_EQ("kept", tinfo.sslError);
+  EXPECT_EQ(42, tinfo.totalBytes);
+}
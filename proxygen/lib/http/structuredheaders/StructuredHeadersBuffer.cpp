@@ -10,7 +10,7 @@
 
 #include "StructuredHeadersBuffer.h"
 
-#include <boost/lexical_cast.hpp>
+#include <folly/Conv.h>
 #include <glog/logging.h>
 
 #include "StructuredHeadersUtilities.h"// @manual=:utils
@@ -20,6 +20,16 @@ namespace proxygen {
 using namespace StructuredHeaders;
 
 DecodeError StructuredHeadersBuffer::parseItem(StructuredHeaderItem& result) {
+  StructuredHeaderItemPiece piece;
+  auto err = parseItem(piece);
+  if (err == DecodeError::OK) {
+    result = toItem(piece);
+  }
+  return err;
+}
+
+DecodeError StructuredHeadersBuffer::parseItem(
+  StructuredHeaderItemPiece& result) {
 
   removeOptionalWhitespace();
 
@@ -39,11 +49,12 @@ DecodeError StructuredHeadersBuffer::parseItem(StructuredHeaderItem& result) {
   }
 }
 
-DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
+DecodeError StructuredHeadersBuffer::parseNumber(
+  StructuredHeaderItemPiece& result) {
   auto type = StructuredHeaderItem::Type::INT64;
 
   bool positive = true;
-  std::string input;
+  const char* start = content_.begin();
 
   if (isEmpty()) {
     return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
@@ -52,7 +63,6 @@ DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
   if (peek() == '-') {
     advanceCursor();
     positive = false;
-    input.push_back('-');
   }
 
   if (isEmpty()) {
@@ -66,17 +76,15 @@ DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
   while (!isEmpty()) {
     char current = peek();
     if (std::isdigit(current)) {
-      input.push_back(current);
       advanceCursor();
     } else if (type == StructuredHeaderItem::Type::INT64 && current == '.') {
       type = StructuredHeaderItem::Type::DOUBLE;
-      input.push_back(current);
       advanceCursor();
     } else {
       break;
     }
 
-    int numDigits = input.length() - (positive ? 0 : 1);
+    int numDigits = (content_.begin() - start) - (positive ? 0 : 1);
     if (type == StructuredHeaderItem::Type::INT64 &&
        numDigits > StructuredHeaders::kMaxValidIntegerLength) {
       return handleDecodeError(DecodeError::VALUE_TOO_LONG);
@@ -86,6 +94,7 @@ DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
     }
   }
 
+  folly::StringPiece input(start, content_.begin());
   if (type == StructuredHeaderItem::Type::INT64) {
     return parseInteger(input, result);
   } else if (input.back() == '.') {
@@ -98,9 +107,8 @@ DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
 }
 
 DecodeError StructuredHeadersBuffer::parseBinaryContent(
-  StructuredHeaderItem& result) {
+  StructuredHeaderItemPiece& result) {
 
-  std::string outputString;
   if (isEmpty()) {
     return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
   }
@@ -110,29 +118,24 @@ DecodeError StructuredHeadersBuffer::parseBinaryContent(
   }
 
   advanceCursor();
+  const char* start = content_.begin();
 
   while (!isEmpty()) {
     char current = peek();
     advanceCursor();
     if (current == '*') {
-      if (!isValidEncodedBinaryContent(
-         outputString)) {
+      folly::StringPiece encoded(start, content_.begin() - 1);
+      if (!isValidEncodedBinaryContent(encoded) ||
+          !isCanonicalEncodedBinaryContent(encoded)) {
         return handleDecodeError(DecodeError::UNDECODEABLE_BINARY_CONTENT);
       }
 
-      std::string decodedContent = decodeBase64(outputString);
-      if (encodeBase64(decodedContent) != outputString) {
-        return handleDecodeError(DecodeError::UNDECODEABLE_BINARY_CONTENT);
-      }
-
-      result.value = std::move(decodedContent);
+      result.value = encoded;
       result.tag = StructuredHeaderItem::Type::BINARYCONTENT;
       return DecodeError::OK;
     } else if (!isValidEncodedBinaryContentChar(
         current)) {
       return handleDecodeError(DecodeError::INVALID_CHARACTER);
-    } else {
-      outputString.push_back(current);
     }
   }
 
@@ -142,14 +145,14 @@ DecodeError StructuredHeadersBuffer::parseBinaryContent(
 DecodeError StructuredHeadersBuffer::parseIdentifier(
   StructuredHeaderItem& result) {
 
-  std::string outputString;
+  folly::StringPiece identifier;
 
-  auto err = parseIdentifier(outputString);
+  auto err = parseIdentifier(identifier);
   if (err != DecodeError::OK) {
     return err;
   }
 
-  result.value = outputString;
+  result.value = identifier.str();
   result.tag = StructuredHeaderItem::Type::IDENTIFIER;
 
   return DecodeError::OK;
@@ -158,6 +161,21 @@ DecodeError StructuredHeadersBuffer::parseIdentifier(
 DecodeError StructuredHeadersBuffer::parseIdentifier(
   std::string& result) {
 
+  folly::StringPiece identifier;
+
+  auto err = parseIdentifier(identifier);
+  if (err != DecodeError::OK) {
+    return err;
+  }
+
+  result.append(identifier.data(), identifier.size());
+
+  return DecodeError::OK;
+}
+
+DecodeError StructuredHeadersBuffer::parseIdentifier(
+  folly::StringPiece& result) {
+
   if (isEmpty()) {
     return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
   }
@@ -166,46 +184,42 @@ DecodeError StructuredHeadersBuffer::parseIdentifier(
     return handleDecodeError(DecodeError::INVALID_CHARACTER);
   }
 
-  while (!isEmpty()) {
-    char current = peek();
-    if (!isValidIdentifierChar(current)) {
-      break;
-    } else {
-      advanceCursor();
-      result.push_back(current);
-    }
+  const char* start = content_.begin();
+  while (!isEmpty() && isValidIdentifierChar(peek())) {
+    advanceCursor();
   }
 
+  result = folly::StringPiece(start, content_.begin());
+
   return DecodeError::OK;
 }
 
-DecodeError StructuredHeadersBuffer::parseInteger(const std::string& input,
-  StructuredHeaderItem& result) {
+DecodeError StructuredHeadersBuffer::parseInteger(folly::StringPiece input,
+  StructuredHeaderItemPiece& result) {
 
-  try {
-    result.value = boost::lexical_cast<int64_t>(input);
-    result.tag = StructuredHeaderItem::Type::INT64;
-  } catch (boost::bad_lexical_cast &) {
+  auto value = folly::tryTo<int64_t>(input);
+  if (!value.hasValue()) {
     return handleDecodeError(DecodeError::UNPARSEABLE_NUMERIC_TYPE);
   }
+  result.value = value.value();
+  result.tag = StructuredHeaderItem::Type::INT64;
   return DecodeError::OK;
 }
 
-DecodeError StructuredHeadersBuffer::parseFloat(const std::string& input,
-  StructuredHeaderItem& result) {
+DecodeError StructuredHeadersBuffer::parseFloat(folly::StringPiece input,
+  StructuredHeaderItemPiece& result) {
 
-  try {
-    result.value = boost::lexical_cast<double>(input);
-    result.tag = StructuredHeaderItem::Type::DOUBLE;
-  } catch (boost::bad_lexical_cast &) {
+  auto value = folly::tryTo<double>(input);
+  if (!value.hasValue()) {
     return handleDecodeError(DecodeError::UNPARSEABLE_NUMERIC_TYPE);
   }
+  result.value = value.value();
+  result.tag = StructuredHeaderItem::Type::DOUBLE;
   return DecodeError::OK;
 }
 
-DecodeError StructuredHeadersBuffer::parseString(StructuredHeaderItem& result) {
-
-  std::string outputString;
+DecodeError StructuredHeadersBuffer::parseString(
+  StructuredHeaderItemPiece& result) {
 
   if (isEmpty()) {
     return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
@@ -216,6 +230,8 @@ DecodeError StructuredHeadersBuffer::parseString(StructuredHeaderItem& result) {
   }
 
   advanceCursor();
+  const char* start = content_.begin();
+  bool escaped = false;
 
   while (!isEmpty()) {
     char current = peek();
@@ -229,18 +245,18 @@ DecodeError StructuredHeadersBuffer::parseString(StructuredHeaderItem& result) {
         if (nextChar != '"' && nextChar != '\\') {
           return handleDecodeError(DecodeError::INVALID_CHARACTER);
         }
-        outputString.push_back(nextChar);
+        escaped = true;
       }
     } else if (current == '"') {
-      advanceCursor();
-      result.value = outputString;
+      result.value = folly::StringPiece(start, content_.begin());
       result.tag = StructuredHeaderItem::Type::STRING;
+      result.escaped = escaped;
+      advanceCursor();
       return DecodeError::OK;
     } else if (!isValidStringChar(current)) {
       return handleDecodeError(DecodeError::INVALID_CHARACTER);
     } else {
       advanceCursor();
-      outputString.push_back(current);
     }
   }
 
@@ -248,17 +264,17 @@ DecodeError StructuredHeadersBuffer::parseString(StructuredHeaderItem& result) {
 }
 
 DecodeError StructuredHeadersBuffer::removeOptionalWhitespace() {
-  while (peek() == ' ' || peek() == '\t') {
+  while (!isEmpty() && (peek() == ' ' || peek() == '\t')) {
     advanceCursor();
   }
   return DecodeError::OK;
 }
 
-DecodeError StructuredHeadersBuffer::removeSymbol(const std::string& symbol,
+DecodeError StructuredHeadersBuffer::removeSymbol(folly::StringPiece symbol,
   bool strict) {
 
   if (content_.startsWith(symbol)) {
-    content_.advance(symbol.length());
+    content_.advance(symbol.size());
     return DecodeError::OK;
   } else {
     if (strict) {
@@ -20,7 +20,7 @@ using namespace StructuredHeaders;
 class StructuredHeadersBuffer {
 public:
 
-  explicit StructuredHeadersBuffer(const std::string& s) :
+  explicit StructuredHeadersBuffer(folly::StringPiece s) :
     content_(s),
     originalContent_(s) {}
 
@@ -28,15 +28,22 @@ public:
    * helper functions used to extract various lower-level items from a sequence
    * of bytes. These will be called from higher level functions which parse
    * dictionaries, lists, and other data structures.
+   *
+   * The pieces they return point into the buffer's content; the other
+   * overloads copy them.
    */
 
   StructuredHeaders::DecodeError parseIdentifier(StructuredHeaderItem& result);
 
   StructuredHeaders::DecodeError parseIdentifier(std::string& result);
 
+  StructuredHeaders::DecodeError parseIdentifier(folly::StringPiece& result);
+
   StructuredHeaders::DecodeError parseItem(StructuredHeaderItem& result);
 
-  DecodeError removeSymbol(const std::string& symbol, bool strict);
+  StructuredHeaders::DecodeError parseItem(StructuredHeaderItemPiece& result);
+
+  DecodeError removeSymbol(folly::StringPiece symbol, bool strict);
 
   DecodeError removeOptionalWhitespace();
 
@@ -46,17 +53,17 @@ public:
 
 private:
 
-  DecodeError parseBinaryContent(StructuredHeaderItem& result);
+  DecodeError parseBinaryContent(StructuredHeaderItemPiece& result);
 
-  DecodeError parseNumber(StructuredHeaderItem& result);
+  DecodeError parseNumber(StructuredHeaderItemPiece& result);
 
-  DecodeError parseString(StructuredHeaderItem& result);
+  DecodeError parseString(StructuredHeaderItemPiece& result);
 
-  DecodeError parseInteger(const std::string& input,
-    StructuredHeaderItem& result);
+  DecodeError parseInteger(folly::StringPiece input,
+    StructuredHeaderItemPiece& result);
 
-  DecodeError parseFloat(const std::string& input,
-    StructuredHeaderItem& result);
+  DecodeError parseFloat(folly::StringPiece input,
+    StructuredHeaderItemPiece& result);
 
   char peek();
 
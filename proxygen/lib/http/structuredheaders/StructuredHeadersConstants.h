@@ -11,9 +11,10 @@
 
 #include <unordered_map>
 #include <map>
+#include <utility>
 #include <vector>
 #include <boost/variant.hpp>
-#include <vector>
+#include <folly/Range.h>
 
 namespace proxygen {
 
@@ -62,6 +63,41 @@ using ParameterisedList =
 
 using Dictionary = std::unordered_map<std::string, StructuredHeaderItem>;
 
+/*
+ * An item pointing into the header value it was decoded from, instead of
+ * holding a copy of it.  An IDENTIFIER is the identifier, a STRING the
+ * characters between the quotes, escape sequences included, and
+ * BINARYCONTENT the base64 between the asterisks.  toItem() (in
+ * StructuredHeadersUtilities.h) makes a StructuredHeaderItem of it.
+ */
+class StructuredHeaderItemPiece {
+public:
+  using Type = StructuredHeaderItem::Type;
+
+  Type tag{Type::NONE};
+  boost::variant<int64_t, double, folly::StringPiece> value;
+  // Whether a STRING has escape sequences in it
+  bool escaped{false};
+};
+
+/*
+ * The containers of the decoder's pieces.  Dictionaries and parameters keep
+ * the order of the header; they are small enough that finding a key by
+ * scanning them beats hashing it.  Reusing a container across headers
+ * reuses its storage.
+ */
+using ListPiece = std::vector<StructuredHeaderItemPiece>;
+
+using DictionaryPiece =
+  std::vector<std::pair<folly::StringPiece, StructuredHeaderItemPiece>>;
+
+struct ParameterisedIdentifierPiece {
+  folly::StringPiece identifier;
+  DictionaryPiece parameters;
+};
+
+using ParameterisedListPiece = std::vector<ParameterisedIdentifierPiece>;
+
 enum class DecodeError : uint8_t {
   OK = 0,
   VALUE_TOO_LONG = 1,
@@ -9,6 +9,7 @@
  */
 
 #include "StructuredHeadersDecoder.h"
+#include "StructuredHeadersUtilities.h" // @manual=:utils
 
 namespace proxygen {
 
@@ -24,12 +25,32 @@ DecodeError StructuredHeadersDecoder::decodeItem(
       DecodeError::OK : buf_.handleDecodeError(DecodeError::INVALID_CHARACTER);
 }
 
+DecodeError StructuredHeadersDecoder::decodeItem(
+  StructuredHeaderItemPiece& result) {
+    auto err = buf_.parseItem(result);
+    if (err != DecodeError::OK) {
+      return err;
+    }
+    return buf_.isEmpty() ?
+      DecodeError::OK : buf_.handleDecodeError(DecodeError::INVALID_CHARACTER);
+}
+
 DecodeError StructuredHeadersDecoder::decodeList(
    std::vector<StructuredHeaderItem>& result) {
 
+  ListPiece pieces;
+  auto err = decodeList(pieces);
+  for (const auto& piece : pieces) {
+    result.push_back(toItem(piece));
+  }
+  return err;
+}
+
+DecodeError StructuredHeadersDecoder::decodeList(ListPiece& result) {
+
   while (!buf_.isEmpty()) {
 
-    StructuredHeaderItem item;
+    StructuredHeaderItemPiece item;
     auto err = buf_.parseItem(item);
     if (err != DecodeError::OK) {
       return err;
@@ -59,15 +80,42 @@ DecodeError StructuredHeadersDecoder::decodeList(
 }
 
 DecodeError StructuredHeadersDecoder::decodeDictionary(Dictionary& result) {
+  DictionaryPiece pieces;
+  auto err = decodeDictionary(pieces);
+  for (const auto& entry : pieces) {
+    result[entry.first.str()] = toItem(entry.second);
+  }
+  return err;
+}
+
+DecodeError StructuredHeadersDecoder::decodeDictionary(
+  DictionaryPiece& result) {
   return decodeMap(result, MapType::DICTIONARY);
 }
 
 DecodeError StructuredHeadersDecoder::decodeParameterisedList(
   ParameterisedList& result) {
 
+  ParameterisedListPiece pieces;
+  auto err = decodeParameterisedList(pieces);
+  for (const auto& piece : pieces) {
+    ParameterisedIdentifier identifier;
+    identifier.identifier = piece.identifier.str();
+    for (const auto& parameter : piece.parameters) {
+      identifier.parameterMap[parameter.first.str()] =
+        toItem(parameter.second);
+    }
+    result.push_back(std::move(identifier));
+  }
+  return err;
+}
+
+DecodeError StructuredHeadersDecoder::decodeParameterisedList(
+  ParameterisedListPiece& result) {
+
   while (!buf_.isEmpty()) {
 
-    ParameterisedIdentifier primaryIdentifier;
+    ParameterisedIdentifierPiece primaryIdentifier;
 
     auto err = buf_.parseIdentifier(primaryIdentifier.identifier);
     if (err != DecodeError::OK) {
@@ -76,12 +124,12 @@ DecodeError StructuredHeadersDecoder::decodeParameterisedList(
 
     buf_.removeOptionalWhitespace();
 
-    err = decodeMap(primaryIdentifier.parameterMap, MapType::PARAMETERISED_MAP);
+    err = decodeMap(primaryIdentifier.parameters, MapType::PARAMETERISED_MAP);
     if (err != DecodeError::OK) {
       return err;
     }
 
-    result.emplace_back(primaryIdentifier);
+    result.push_back(std::move(primaryIdentifier));
 
     buf_.removeOptionalWhitespace();
 
@@ -102,10 +150,11 @@ DecodeError StructuredHeadersDecoder::decodeParameterisedList(
 }
 
 DecodeError StructuredHeadersDecoder::decodeMap(
-  std::unordered_map<std::string, StructuredHeaderItem>& result,
+  DictionaryPiece& result,
   MapType mapType) {
 
-  std::string delimiter = (mapType == MapType::PARAMETERISED_MAP) ? ";" : ",";
+  folly::StringPiece delimiter =
+    (mapType == MapType::PARAMETERISED_MAP) ? ";" : ",";
 
   buf_.removeOptionalWhitespace();
 
@@ -118,14 +167,16 @@ DecodeError StructuredHeadersDecoder::decodeMap(
 
     buf_.removeOptionalWhitespace();
 
-    std::string thisKey;
+    folly::StringPiece thisKey;
     auto err = buf_.parseIdentifier(thisKey);
     if (err != DecodeError::OK) {
       return err;
     }
 
-    if (result.find(thisKey) != result.end()) {
-      return buf_.handleDecodeError(DecodeError::DUPLICATE_KEY);
+    for (const auto& entry : result) {
+      if (entry.first == thisKey) {
+        return buf_.handleDecodeError(DecodeError::DUPLICATE_KEY);
+      }
     }
 
     err = buf_.removeSymbol("=", mapType == MapType::DICTIONARY);
@@ -133,18 +184,16 @@ DecodeError StructuredHeadersDecoder::decodeMap(
       if (mapType == MapType::DICTIONARY) {
         return err;
       } else {
-        StructuredHeaderItem value;
-        value.tag = StructuredHeaderItem::Type::NONE;
-        result[thisKey] = value;
+        result.emplace_back(thisKey, StructuredHeaderItemPiece());
       }
     } else {
-      StructuredHeaderItem value;
+      StructuredHeaderItemPiece value;
       err = buf_.parseItem(value);
       if (err != DecodeError::OK) {
         return err;
       }
 
-      result[thisKey] = value;
+      result.emplace_back(thisKey, value);
     }
 
     buf_.removeOptionalWhitespace();
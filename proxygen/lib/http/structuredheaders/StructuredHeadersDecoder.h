@@ -15,21 +15,35 @@
 
 namespace proxygen {
 
+/*
+ * Decodes the header value s, which must outlive the decoder.  The
+ * overloads taking pieces copy nothing: the strings in what they return
+ * point into s, so they are only valid as long as it is.
+ */
 class StructuredHeadersDecoder {
 public:
 
-  explicit StructuredHeadersDecoder(const std::string& s): buf_(s) {}
+  explicit StructuredHeadersDecoder(folly::StringPiece s): buf_(s) {}
 
   StructuredHeaders::DecodeError decodeItem(StructuredHeaderItem& result);
 
+  StructuredHeaders::DecodeError decodeItem(StructuredHeaderItemPiece& result);
+
   StructuredHeaders::DecodeError
     decodeList(std::vector<StructuredHeaderItem>& result);
 
+  StructuredHeaders::DecodeError decodeList(ListPiece& result);
+
   StructuredHeaders::DecodeError decodeDictionary(Dictionary& result);
 
+  StructuredHeaders::DecodeError decodeDictionary(DictionaryPiece& result);
+
   StructuredHeaders::DecodeError
     decodeParameterisedList(ParameterisedList& result);
 
+  StructuredHeaders::DecodeError
+    decodeParameterisedList(ParameterisedListPiece& result);
+
 private:
   enum class MapType {
     DICTIONARY = 0,
@@ -37,7 +51,7 @@ private:
   };
 
   StructuredHeaders::DecodeError decodeMap(
-    std::unordered_map<std::string, StructuredHeaderItem>& result,
+    DictionaryPiece& result,
     MapType mapType);
 
   StructuredHeadersBuffer buf_;
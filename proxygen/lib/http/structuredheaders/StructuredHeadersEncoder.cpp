@@ -9,12 +9,21 @@
  */
 
 #include "StructuredHeadersEncoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <typeinfo>
-#include <boost/lexical_cast.hpp>
 #include <boost/variant.hpp>
+#include <folly/Conv.h>
 #include <glog/logging.h>
+#include <proxygen/lib/utils/Base64.h>
 #include "StructuredHeadersUtilities.h" // @manual=:utils
 
+namespace {
+// The least a new buffer of the output queue holds
+const size_t kMinAllocation = 256;
+}
+
 namespace proxygen {
 
 using namespace StructuredHeaders;
@@ -33,7 +42,7 @@ EncodeError StructuredHeadersEncoder::encodeList(
     }
 
     if (std::next(it, 1)!= input.end()) {
-      outputStream_ << ", ";
+      append(", ");
     }
   }
 
@@ -53,7 +62,7 @@ EncodeError StructuredHeadersEncoder::encodeDictionary(
       return err;
     }
 
-    outputStream_ << "=";
+    append("=");
 
     err = encodeItem(it->second);
     if (err != EncodeError::OK) {
@@ -61,7 +70,7 @@ EncodeError StructuredHeadersEncoder::encodeDictionary(
     }
 
     if (std::next(it, 1) != input.end()) {
-      outputStream_ << ", ";
+      append(", ");
     }
   }
 
@@ -84,7 +93,7 @@ EncodeError StructuredHeadersEncoder::encodeParameterisedList(
     for (auto it2 = it1->parameterMap.begin();
       it2 != it1->parameterMap.end(); it2++) {
 
-      outputStream_ << "; ";
+      append("; ");
 
       err = encodeIdentifier(it2->first);
       if (err != EncodeError::OK) {
@@ -92,7 +101,7 @@ EncodeError StructuredHeadersEncoder::encodeParameterisedList(
       }
 
       if (it2->second.tag != StructuredHeaderItem::Type::NONE) {
-        outputStream_ << "=";
+        append("=");
         err = encodeItem(it2->second);
         if (err != EncodeError::OK) {
           return err;
@@ -101,7 +110,7 @@ EncodeError StructuredHeadersEncoder::encodeParameterisedList(
     }
 
     if (std::next(it1, 1) != input.end()) {
-      outputStream_ << ", ";
+      append(", ");
     }
   }
 
@@ -109,10 +118,13 @@ EncodeError StructuredHeadersEncoder::encodeParameterisedList(
 }
 
 StructuredHeadersEncoder::StructuredHeadersEncoder():
+   output_() {
+}
+
+StructuredHeadersEncoder::StructuredHeadersEncoder(
+  folly::IOBufQueue& output):
    output_(),
-   buf_(output_),
-   outputStream_(&buf_) {
-  outputStream_.precision(kMaxValidFloatLength - 1);
+   queue_(&output) {
 }
 
 EncodeError StructuredHeadersEncoder::encodeItem(
@@ -142,9 +154,14 @@ EncodeError StructuredHeadersEncoder::encodeItem(
 EncodeError StructuredHeadersEncoder::encodeBinaryContent(
    const std::string& input) {
 
-  outputStream_ << "*";
-  outputStream_ << encodeBase64(input);
-  outputStream_ << "*";
+  size_t len = Base64::encodedSize(input.size());
+  char* out = appendUninitialized(len + 2);
+  out[0] = '*';
+  Base64::encode(
+    folly::ByteRange(reinterpret_cast<const uint8_t*>(input.data()),
+                     input.size()),
+    folly::MutableStringPiece(out + 1, len));
+  out[len + 1] = '*';
 
   return EncodeError::OK;
 }
@@ -155,47 +172,77 @@ EncodeError StructuredHeadersEncoder::encodeString(const std::string& input) {
     return handleEncodeError(EncodeError::BAD_STRING, input);
   }
 
-  outputStream_ << "\"";
-  for (char c : input) {
-    if (c == '"' || c == '\\') {
-      outputStream_ << "\\";
+  append("\"");
+  // Appends the runs of characters between those to escape
+  const char* run = input.data();
+  const char* end = input.data() + input.size();
+  for (const char* c = run; c != end; c++) {
+    if (*c == '"' || *c == '\\') {
+      append(folly::StringPiece(run, c));
+      append("\\");
+      run = c;
     }
-    outputStream_ << c;
   }
-
-  outputStream_ << "\"";
+  append(folly::StringPiece(run, end));
+  append("\"");
 
   return EncodeError::OK;
 }
 
 EncodeError StructuredHeadersEncoder::encodeInteger(int64_t input) {
 
-  outputStream_ << input;
+  uint64_t magnitude = input < 0 ? 0 - static_cast<uint64_t>(input) : input;
+  char* out = appendUninitialized(
+    (input < 0 ? 1 : 0) + folly::digits10(magnitude));
+  if (input < 0) {
+    *out++ = '-';
+  }
+  folly::uint64ToBufferUnsafe(magnitude, out);
 
   return EncodeError::OK;
 }
 
 EncodeError StructuredHeadersEncoder::encodeFloat(double input) {
 
-  outputStream_ << input;
+  // As an ostream does with precision(kMaxValidFloatLength - 1)
+  char buf[32];
+  int len = snprintf(buf, sizeof(buf), "%.*g", kMaxValidFloatLength - 1,
+                     input);
+  append(folly::StringPiece(buf, len));
 
   return EncodeError::OK;
 }
 
 EncodeError StructuredHeadersEncoder::encodeIdentifier(
-  const std::string &input) {
+  folly::StringPiece input) {
 
   if (!isValidIdentifier(input)) {
     return handleEncodeError(EncodeError::BAD_IDENTIFIER, input);
   }
-  outputStream_ << input;
+  append(input);
   return EncodeError::OK;
 }
 
+char* StructuredHeadersEncoder::appendUninitialized(size_t len) {
+  if (queue_) {
+    auto space = queue_->preallocate(len, std::max(len, kMinAllocation));
+    queue_->postallocate(len);
+    return static_cast<char*>(space.first);
+  }
+  output_.resize(output_.size() + len);
+  return &output_[output_.size() - len];
+}
+
+void StructuredHeadersEncoder::append(folly::StringPiece s) {
+  if (!s.empty()) {
+    memcpy(appendUninitialized(s.size()), s.data(), s.size());
+  }
+}
+
 // Used to print an error when a string type (eg: a string or binary content)
 // was involved in the error
 EncodeError StructuredHeadersEncoder::handleEncodeError(EncodeError err,
-  const std::string &culprit) {
+  folly::StringPiece culprit) {
 
   LOG_EVERY_N(ERROR, 1000) << "Error message: " <<
     encodeErrorDescription.at(err) << " .The culprit was: " << culprit;
@@ -210,7 +257,6 @@ EncodeError StructuredHeadersEncoder::handleEncodeError(EncodeError err) {
 }
 
 std::string StructuredHeadersEncoder::get() {
-  outputStream_.flush();
   return std::move(output_);
 }
 
@@ -11,26 +11,27 @@
 #pragma once
 
 #include "StructuredHeadersConstants.h"
-#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/stream_buffer.hpp>
+#include <folly/io/IOBufQueue.h>
 
 namespace proxygen {
 
 using namespace StructuredHeaders;
 
-using string_buf = boost::iostreams::stream_buffer<
-  boost::iostreams::back_insert_device<std::string> >;
-
+/*
+ * Encodes into a string, which get() returns, or appends to an IOBufQueue,
+ * such as the one of an HPACKEncodeBuffer.
+ */
 class StructuredHeadersEncoder {
 
  public:
 
    StructuredHeadersEncoder();
 
+   explicit StructuredHeadersEncoder(folly::IOBufQueue& output);
+
    EncodeError encodeParameterisedList(const ParameterisedList& input);
 
    EncodeError encodeDictionary(const Dictionary& input);
@@ -39,8 +40,9 @@ class StructuredHeadersEncoder {
 
    EncodeError encodeItem(const StructuredHeaderItem& input);
 
-   EncodeError encodeIdentifier(const std::string& input);
+   EncodeError encodeIdentifier(folly::StringPiece input);
 
+   // What was encoded, when not encoding to an IOBufQueue
    std::string get();
 
  private:
@@ -49,18 +51,22 @@ class StructuredHeadersEncoder {
 
    EncodeError encodeString(const std::string& input);
 
+   // Space for len more characters of output
+   char* appendUninitialized(size_t len);
+
+   void append(folly::StringPiece s);
+
    EncodeError encodeInteger(int64_t input);
 
    EncodeError encodeFloat(double input);
 
    EncodeError handleEncodeError(EncodeError err,
-     const std::string& badContent);
+     folly::StringPiece badContent);
 
    EncodeError handleEncodeError(EncodeError err);
 
    std::string output_;
-   string_buf buf_;
-   std::ostream outputStream_;
+   folly::IOBufQueue* queue_{nullptr};
 
 };
 
@@ -13,6 +13,7 @@
 #include <boost/archive/iterators/base64_from_binary.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 #include "StructuredHeadersConstants.h"
+#include <proxygen/lib/utils/Base64.h>
 
 namespace proxygen {
 namespace StructuredHeaders {
@@ -42,7 +43,7 @@ bool isValidStringChar(char c) {
   return c >= 0x20 && c <= 0x7E;
 }
 
-bool isValidIdentifier(const std::string& s) {
+bool isValidIdentifier(folly::StringPiece s) {
   if (s.size() == 0 || !isLcAlpha(s[0])) {
     return false;
   }
@@ -56,7 +57,7 @@ bool isValidIdentifier(const std::string& s) {
   return true;
 }
 
-bool isValidString(const std::string& s) {
+bool isValidString(folly::StringPiece s) {
   for (char c : s) {
     if (!isValidStringChar(c)) {
       return false;
@@ -66,7 +67,7 @@ bool isValidString(const std::string& s) {
 }
 
 bool isValidEncodedBinaryContent(
-  const std::string& s) {
+  folly::StringPiece s) {
 
   if (s.size() % 4 != 0) {
     return false;
@@ -84,6 +85,33 @@ bool isValidEncodedBinaryContent(
   return true;
 }
 
+bool isCanonicalEncodedBinaryContent(folly::StringPiece s) {
+  size_t padding = 0;
+  while (s.endsWith('=')) {
+    s.pop_back();
+    padding++;
+  }
+  if (padding == 0) {
+    return true;
+  } else if (padding > 2 || s.empty()) {
+    return false;
+  }
+
+  // The last character holds 2 (resp. 4) bits past the end of the content
+  char last = s.back();
+  uint8_t bits;
+  if (last >= 'A' && last <= 'Z') {
+    bits = last - 'A';
+  } else if (last >= 'a' && last <= 'z') {
+    bits = last - 'a' + 26;
+  } else if (last >= '0' && last <= '9') {
+    bits = last - '0' + 52;
+  } else {
+    bits = last == '+' ? 62 : 63;
+  }
+  return (bits & (padding == 1 ? 0x3 : 0xf)) == 0;
+}
+
 bool itemTypeMatchesContent(
    const StructuredHeaderItem& input) {
   switch (input.tag) {
@@ -123,6 +151,54 @@ std::string decodeBase64(
   return decoded;
 }
 
+StructuredHeaderItem toItem(const StructuredHeaderItemPiece& piece) {
+  StructuredHeaderItem item;
+  item.tag = piece.tag;
+  switch (piece.tag) {
+    case StructuredHeaderItem::Type::INT64:
+      item.value = boost::get<int64_t>(piece.value);
+      break;
+    case StructuredHeaderItem::Type::DOUBLE:
+      item.value = boost::get<double>(piece.value);
+      break;
+    case StructuredHeaderItem::Type::IDENTIFIER:
+      item.value = boost::get<folly::StringPiece>(piece.value).str();
+      break;
+    case StructuredHeaderItem::Type::STRING: {
+      auto content = boost::get<folly::StringPiece>(piece.value);
+      if (!piece.escaped) {
+        item.value = content.str();
+        break;
+      }
+      std::string unescaped;
+      unescaped.reserve(content.size());
+      for (size_t i = 0; i < content.size(); i++) {
+        // The decoder only allows \" and \\, so the next character is it
+        if (content[i] == '\\') {
+          i++;
+        }
+        unescaped.push_back(content[i]);
+      }
+      item.value = std::move(unescaped);
+      break;
+    }
+    case StructuredHeaderItem::Type::BINARYCONTENT: {
+      auto encoded = boost::get<folly::StringPiece>(piece.value);
+      std::string decoded(Base64::decodedSizeBound(encoded.size()), '\0');
+      auto len = Base64::decode(
+        encoded,
+        folly::MutableByteRange(reinterpret_cast<uint8_t*>(&decoded[0]),
+                                decoded.size()));
+      decoded.resize(len.value_or(0));
+      item.value = std::move(decoded);
+      break;
+    }
+    case StructuredHeaderItem::Type::NONE:
+      break;
+  }
+  return item;
+}
+
 std::string encodeBase64(const std::string& input) {
   using namespace boost::archive::iterators;
   using b64it = base64_from_binary<transform_width<const char*, 6, 8>>;
@@ -23,14 +23,24 @@ bool isValidEncodedBinaryContentChar(char c);
 
 bool isValidStringChar(char c);
 
-bool isValidIdentifier(const std::string& s);
+bool isValidIdentifier(folly::StringPiece s);
 
-bool isValidString(const std::string& s);
+bool isValidString(folly::StringPiece s);
 
-bool isValidEncodedBinaryContent(const std::string& s);
+bool isValidEncodedBinaryContent(folly::StringPiece s);
+
+/*
+ * Whether s, which isValidEncodedBinaryContent(), is the only encoding of
+ * what it decodes to: it has at most two '=' and no bits set past the end
+ * of the content
+ */
+bool isCanonicalEncodedBinaryContent(folly::StringPiece s);
 
 bool itemTypeMatchesContent(const StructuredHeaderItem& input);
 
+// A copy of piece, with its string unescaped or its binary content decoded
+StructuredHeaderItem toItem(const StructuredHeaderItemPiece& piece);
+
 std::string decodeBase64(const std::string& encoded);
 
 std::string encodeBase64(const std::string& input);
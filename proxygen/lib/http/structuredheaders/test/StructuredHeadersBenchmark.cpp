@@ -0,0 +1,131 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBufQueue.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersDecoder.h>
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersEncoder.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// Decoding a header value into copies against decoding it into pieces of
+// the value, and encoding into a string against encoding into an IOBufQueue.
+
+namespace {
+
+const std::string kDictionary =
+  "urgency=3, progressive=1, etag=\"ab3f-1d\", "
+  "token=*aGVsbG8gd29ybGQ=*, weight=0.75";
+
+const std::string kParamList =
+  "text/html;q=1, application/json;q=0.9;charset=\"utf-8\", "
+  "image/webp, image/apng;q=0.8";
+
+void decodeDictionaryCopies(int iters) {
+  for (int i = 0; i < iters; i++) {
+    Dictionary dictionary;
+    StructuredHeadersDecoder decoder(kDictionary);
+    CHECK(decoder.decodeDictionary(dictionary) == DecodeError::OK);
+    doNotOptimizeAway(dictionary);
+  }
+}
+
+void decodeDictionaryPieces(int iters) {
+  DictionaryPiece dictionary;
+  for (int i = 0; i < iters; i++) {
+    dictionary.clear();
+    StructuredHeadersDecoder decoder(kDictionary);
+    CHECK(decoder.decodeDictionary(dictionary) == DecodeError::OK);
+    doNotOptimizeAway(dictionary);
+  }
+}
+
+void decodeParamListCopies(int iters) {
+  for (int i = 0; i < iters; i++) {
+    ParameterisedList list;
+    StructuredHeadersDecoder decoder(kParamList);
+    CHECK(decoder.decodeParameterisedList(list) == DecodeError::OK);
+    doNotOptimizeAway(list);
+  }
+}
+
+void decodeParamListPieces(int iters) {
+  ParameterisedListPiece list;
+  for (int i = 0; i < iters; i++) {
+    list.clear();
+    StructuredHeadersDecoder decoder(kParamList);
+    CHECK(decoder.decodeParameterisedList(list) == DecodeError::OK);
+    doNotOptimizeAway(list);
+  }
+}
+
+Dictionary getDictionary() {
+  Dictionary dictionary;
+  StructuredHeadersDecoder decoder(kDictionary);
+  CHECK(decoder.decodeDictionary(dictionary) == DecodeError::OK);
+  return dictionary;
+}
+
+const Dictionary kDecodedDictionary = getDictionary();
+
+void encodeString(int iters) {
+  for (int i = 0; i < iters; i++) {
+    StructuredHeadersEncoder encoder;
+    CHECK(encoder.encodeDictionary(kDecodedDictionary) == EncodeError::OK);
+    doNotOptimizeAway(encoder.get());
+  }
+}
+
+void encodeIOBufQueue(int iters) {
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  for (int i = 0; i < iters; i++) {
+    StructuredHeadersEncoder encoder(queue);
+    CHECK(encoder.encodeDictionary(kDecodedDictionary) == EncodeError::OK);
+    doNotOptimizeAway(queue.chainLength());
+    queue.trimStart(queue.chainLength());
+  }
+}
+
+}
+
+BENCHMARK(DecodeDictionaryCopies, iters) {
+  decodeDictionaryCopies(iters);
+}
+
+BENCHMARK_RELATIVE(DecodeDictionaryPieces, iters) {
+  decodeDictionaryPieces(iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecodeParamListCopies, iters) {
+  decodeParamListCopies(iters);
+}
+
+BENCHMARK_RELATIVE(DecodeParamListPieces, iters) {
+  decodeParamListPieces(iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EncodeDictionaryString, iters) {
+  encodeString(iters);
+}
+
+BENCHMARK_RELATIVE(EncodeDictionaryIOBufQueue, iters) {
+  encodeIOBufQueue(iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
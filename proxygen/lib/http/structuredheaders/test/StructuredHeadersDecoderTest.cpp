@@ -8,6 +8,7 @@
  *
  */
 #include <proxygen/lib/http/structuredheaders/StructuredHeadersDecoder.h>
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersUtilities.h>
 #include <string>
 #include <folly/portability/GTest.h>
 
@@ -222,4 +223,84 @@ TEST_F(StructuredHeadersDecoderTest, TestParamListNullValues) {
   EXPECT_EQ(pl[1].parameterMap["burger"].tag, StructuredHeaderItem::Type::NONE);
 }
 
+
+TEST_F(StructuredHeadersDecoderTest, TestListPieces) {
+  std::string input = "\"a \\\"b\\\"\", *ZWdncw==*, -12, 0.5";
+  StructuredHeadersDecoder shd(input);
+
+  ListPiece v;
+  EXPECT_EQ(shd.decodeList(v), DecodeError::OK);
+  ASSERT_EQ(v.size(), 4);
+
+  // The strings point into the input, as they are in it
+  auto str = boost::get<folly::StringPiece>(v[0].value);
+  EXPECT_EQ(v[0].tag, StructuredHeaderItem::Type::STRING);
+  EXPECT_TRUE(v[0].escaped);
+  EXPECT_EQ(str, "a \\\"b\\\"");
+  EXPECT_EQ(str.begin(), input.data() + 1);
+  EXPECT_EQ(toItem(v[0]), std::string("a \"b\""));
+
+  EXPECT_EQ(v[1].tag, StructuredHeaderItem::Type::BINARYCONTENT);
+  EXPECT_EQ(boost::get<folly::StringPiece>(v[1].value), "ZWdncw==");
+  EXPECT_EQ(toItem(v[1]), std::string("eggs"));
+
+  EXPECT_EQ(v[2].tag, StructuredHeaderItem::Type::INT64);
+  EXPECT_EQ(boost::get<int64_t>(v[2].value), -12);
+  EXPECT_EQ(v[3].tag, StructuredHeaderItem::Type::DOUBLE);
+  EXPECT_EQ(boost::get<double>(v[3].value), 0.5);
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestListPiecesIdentifier) {
+  std::string input = "foo";
+  StructuredHeadersDecoder shd(input);
+
+  // Lists hold items, which identifiers are not
+  ListPiece v;
+  EXPECT_NE(shd.decodeList(v), DecodeError::OK);
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestDictionaryPieces) {
+  std::string input = "en=\"Applepie\", de=*QXBmZWxzdHJ1ZGVsCg==*";
+  StructuredHeadersDecoder shd(input);
+
+  DictionaryPiece d;
+  EXPECT_EQ(shd.decodeDictionary(d), DecodeError::OK);
+  ASSERT_EQ(d.size(), 2);
+
+  EXPECT_EQ(d[0].first, "en");
+  EXPECT_EQ(d[0].first.begin(), input.data());
+  EXPECT_FALSE(d[0].second.escaped);
+  EXPECT_EQ(boost::get<folly::StringPiece>(d[0].second.value), "Applepie");
+  EXPECT_EQ(d[1].first, "de");
+  EXPECT_EQ(toItem(d[1].second), std::string("Apfelstrudel\n"));
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestDictionaryPiecesDuplicate) {
+  std::string input = "a=1, b=2, a=3";
+  StructuredHeadersDecoder shd(input);
+
+  DictionaryPiece d;
+  EXPECT_EQ(shd.decodeDictionary(d), DecodeError::DUPLICATE_KEY);
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestParamListPieces) {
+  std::string input = "beverages;water;juice=\"apple\", food";
+  StructuredHeadersDecoder shd(input);
+
+  ParameterisedListPiece pl;
+  EXPECT_EQ(shd.decodeParameterisedList(pl), DecodeError::OK);
+  ASSERT_EQ(pl.size(), 2);
+
+  EXPECT_EQ(pl[0].identifier, "beverages");
+  ASSERT_EQ(pl[0].parameters.size(), 2);
+  EXPECT_EQ(pl[0].parameters[0].first, "water");
+  EXPECT_EQ(pl[0].parameters[0].second.tag, StructuredHeaderItem::Type::NONE);
+  EXPECT_EQ(pl[0].parameters[1].first, "juice");
+  EXPECT_EQ(boost::get<folly::StringPiece>(pl[0].parameters[1].second.value),
+            "apple");
+
+  EXPECT_EQ(pl[1].identifier, "food");
+  EXPECT_EQ(pl[1].parameters.size(), 0);
+}
+
 }
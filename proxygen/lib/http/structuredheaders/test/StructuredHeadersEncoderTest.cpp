@@ -8,6 +8,7 @@
  *
  */
 #include <proxygen/lib/http/structuredheaders/StructuredHeadersEncoder.h>
+#include <limits>
 #include <unordered_map>
 #include <folly/portability/GTest.h>
 #include <folly/portability/GMock.h>
@@ -513,4 +514,30 @@ TEST_F(StructuredHeadersEncoderTest, TestParamListBadItems) {
   EXPECT_NE(err, EncodeError::OK);
 }
 
+
+TEST_F(StructuredHeadersEncoderTest, TestIOBufQueue) {
+  folly::IOBufQueue queue;
+  StructuredHeadersEncoder encoder(queue);
+
+  std::vector<StructuredHeaderItem> v;
+  StructuredHeaderItem item;
+  item.tag = StructuredHeaderItem::Type::STRING;
+  item.value = std::string("say \"hi\"");
+  v.push_back(item);
+  item.tag = StructuredHeaderItem::Type::BINARYCONTENT;
+  item.value = std::string("eggs");
+  v.push_back(item);
+  item.tag = StructuredHeaderItem::Type::INT64;
+  item.value = std::numeric_limits<int64_t>::min();
+  v.push_back(item);
+  item.tag = StructuredHeaderItem::Type::DOUBLE;
+  item.value = 2.5;
+  v.push_back(item);
+
+  EXPECT_EQ(encoder.encodeList(v), EncodeError::OK);
+  EXPECT_EQ(encoder.get(), "");
+  EXPECT_EQ(queue.move()->moveToFbString(),
+            "\"say \\\"hi\\\"\", *ZWdncw==*, -9223372036854775808, 2.5");
+}
+
 }
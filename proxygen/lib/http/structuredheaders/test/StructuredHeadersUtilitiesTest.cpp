@@ -121,6 +121,36 @@ TEST_F(StructuredHeadersUtilitiesTest, TestBadBinaryContent) {
   EXPECT_FALSE(isValidEncodedBinaryContent("=aGVsbG8"));
 }
 
+TEST_F(StructuredHeadersUtilitiesTest, TestCanonicalBinaryContent) {
+  EXPECT_TRUE(isCanonicalEncodedBinaryContent("aGVsbG8="));
+  EXPECT_TRUE(isCanonicalEncodedBinaryContent("ZA=="));
+  EXPECT_TRUE(isCanonicalEncodedBinaryContent(""));
+  // bits set past the end of the content
+  EXPECT_FALSE(isCanonicalEncodedBinaryContent("aGVsbG9="));
+  EXPECT_FALSE(isCanonicalEncodedBinaryContent("ZB=="));
+  EXPECT_FALSE(isCanonicalEncodedBinaryContent("Z==="));
+  EXPECT_FALSE(isCanonicalEncodedBinaryContent("===="));
+}
+
+TEST_F(StructuredHeadersUtilitiesTest, TestToItem) {
+  StructuredHeaderItemPiece piece;
+  piece.tag = StructuredHeaderItem::Type::STRING;
+  piece.value = folly::StringPiece("say \\\"hi\\\"");
+  piece.escaped = true;
+  EXPECT_EQ(toItem(piece), std::string("say \"hi\""));
+
+  piece.tag = StructuredHeaderItem::Type::BINARYCONTENT;
+  piece.value = folly::StringPiece("ZWdncw==");
+  piece.escaped = false;
+  auto item = toItem(piece);
+  EXPECT_EQ(item.tag, StructuredHeaderItem::Type::BINARYCONTENT);
+  EXPECT_EQ(item, std::string("eggs"));
+
+  piece.tag = StructuredHeaderItem::Type::INT64;
+  piece.value = int64_t(-7);
+  EXPECT_EQ(toItem(piece), int64_t(-7));
+}
+
 TEST_F(StructuredHeadersUtilitiesTest, Test_DecodeBinaryContent) {
   std::string input1 = "ZnJ1aXQ=";
   std::string input2 = "dG9tYXRv";
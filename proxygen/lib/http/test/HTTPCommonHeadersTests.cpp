@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <algorithm>
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 
@@ -30,6 +31,43 @@ TEST_F(HTTPCommonHeadersTests, TestHashing) {
   EXPECT_EQ(commonCode1, commonCode2);
 }
 
+TEST_F(HTTPCommonHeadersTests, TestHashingAllNames) {
+  for (uint64_t j = HTTPHeaderCodeCommonOffset;
+       j < HTTPCommonHeaders::num_header_codes; ++j) {
+    HTTPHeaderCode code = static_cast<HTTPHeaderCode>(j);
+    std::string name = *HTTPCommonHeaders::getPointerToHeaderName(code);
+    std::string lower =
+      *HTTPCommonHeaders::getPointerToHeaderName(code, TABLE_LOWERCASE);
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    EXPECT_EQ(HTTPCommonHeaders::hash(name), code);
+    EXPECT_EQ(HTTPCommonHeaders::hash(lower), code);
+    EXPECT_EQ(HTTPCommonHeaders::hash(upper), code);
+
+    // Names one character off, or one longer or shorter, are not common
+    for (size_t i = 0; i < name.size(); ++i) {
+      std::string changed(name);
+      changed[i] ^= 0x01;
+      EXPECT_EQ(HTTPCommonHeaders::hash(changed), HTTP_HEADER_OTHER) << changed;
+    }
+    EXPECT_EQ(HTTPCommonHeaders::hash(name + "s"), HTTP_HEADER_OTHER);
+    EXPECT_EQ(HTTPCommonHeaders::hash(name.substr(1)), HTTP_HEADER_OTHER);
+  }
+  EXPECT_EQ(HTTPCommonHeaders::hash(""), HTTP_HEADER_OTHER);
+}
+
+TEST_F(HTTPCommonHeadersTests, TestHashingLiterals) {
+  static_assert(HTTPCommonHeaders::hashLiteral("Content-Length") ==
+                HTTP_HEADER_CONTENT_LENGTH, "");
+  static_assert(HTTPCommonHeaders::hashLiteral("content-length") ==
+                HTTP_HEADER_CONTENT_LENGTH, "");
+  static_assert(HTTPCommonHeaders::hashLiteral("Content-Lengths") ==
+                HTTP_HEADER_OTHER, "");
+  static_assert(HTTPCommonHeaders::hashLiteral("") == HTTP_HEADER_OTHER, "");
+  EXPECT_EQ(HTTPCommonHeaders::hashLiteral("Uncommon"),
+            HTTPCommonHeaders::hash("Uncommon"));
+}
+
 TEST_F(HTTPCommonHeadersTests, TestTwoTablesInitialized) {
   std::string common("Content-Length");
   HTTPHeaderCode code = HTTPCommonHeaders::hash(common);
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <folly/Benchmark.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
+#include <proxygen/lib/http/HTTPHeaders.h>
 
 using namespace folly;
 using namespace proxygen;
@@ -55,8 +56,69 @@ static const std::vector<HTTPHeaderCode> testHeaderCodes = getTestHeaderCodes();
 static const std::vector<const std::string *> testHeaderStrings =
   getTestHeaderStrings();
 
+// A typical browser request, one header of which is not a common one
+void addRequestHeaders(HTTPHeaders& headers) {
+  headers.add(HTTP_HEADER_HOST, "www.example.com");
+  headers.add(HTTP_HEADER_USER_AGENT,
+              "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_12_6) "
+              "AppleWebKit/537.36 (KHTML, like Gecko) Chrome/60.0 Safari");
+  headers.add(HTTP_HEADER_ACCEPT,
+              "text/html,application/xhtml+xml,application/xml;q=0.9");
+  headers.add(HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate, br");
+  headers.add(HTTP_HEADER_ACCEPT_LANGUAGE, "en-US,en;q=0.9");
+  headers.add(HTTP_HEADER_CACHE_CONTROL, "no-cache");
+  headers.add(HTTP_HEADER_COOKIE, "c_user=100001234567890; xs=28%3AaBcD");
+  headers.add(HTTP_HEADER_REFERER, "https://www.example.com/");
+  headers.add(HTTP_HEADER_CONNECTION, "keep-alive");
+  headers.add("X-Requested-With", "XMLHttpRequest");
 }
 
+}
+
+BENCHMARK(HTTPHeadersAdd, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    HTTPHeaders headers;
+    addRequestHeaders(headers);
+    doNotOptimizeAway(headers.size());
+  }
+}
+
+BENCHMARK(HTTPHeadersGet, iters) {
+  HTTPHeaders headers;
+  BENCHMARK_SUSPEND {
+    addRequestHeaders(headers);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    doNotOptimizeAway(headers.getSingleOrEmpty(HTTP_HEADER_COOKIE).size());
+    doNotOptimizeAway(headers.getSingleOrEmpty("X-Requested-With").size());
+  }
+}
+
+BENCHMARK(HTTPHeadersCopy, iters) {
+  HTTPHeaders headers;
+  BENCHMARK_SUSPEND {
+    addRequestHeaders(headers);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    HTTPHeaders copy(headers);
+    doNotOptimizeAway(copy.size());
+  }
+}
+
+BENCHMARK(HTTPHeadersMove, iters) {
+  HTTPHeaders headers;
+  BENCHMARK_SUSPEND {
+    addRequestHeaders(headers);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    HTTPHeaders moved(std::move(headers));
+    headers = std::move(moved);
+    doNotOptimizeAway(headers.size());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
 void HTTPCommonHeadersHashBench(int iters) {
   for (int i = 0; i < iters; ++i) {
     for (auto const& testHeaderString: testHeaderStrings) {
@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/HTTPMessageSerializer.h>
+
+using namespace proxygen;
+
+namespace {
+
+std::string serialize(const HTTPMessage& msg) {
+  folly::IOBufQueue out{folly::IOBufQueue::cacheChainLength()};
+  HTTPMessageSerializer::serialize(msg, out);
+  return out.move()->moveToFbString().toStdString();
+}
+
+folly::ByteRange range(const std::string& str) {
+  return folly::ByteRange(folly::StringPiece(str));
+}
+
+}
+
+TEST(HTTPMessageSerializerTest, Request) {
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::POST);
+  msg.setURL("/upload?id=7");
+  msg.setHTTPVersion(1, 1);
+  msg.setSecure(true);
+  msg.setClientAddress(folly::SocketAddress("2001:db8::1", 4242));
+  msg.getHeaders().add(HTTP_HEADER_HOST, "www.example.com");
+  msg.getHeaders().add("X-Custom", "a");
+  msg.getHeaders().add("X-Custom", "b");
+  auto trailers = std::make_unique<HTTPHeaders>();
+  trailers->add("X-Checksum", "123");
+  msg.setTrailers(std::move(trailers));
+
+  auto encoded = serialize(msg);
+  HTTPMessage decoded;
+  ASSERT_TRUE(HTTPMessageSerializer::deserialize(range(encoded), decoded));
+  EXPECT_TRUE(decoded.isRequest());
+  EXPECT_EQ(decoded.getMethod(), HTTPMethod::POST);
+  EXPECT_EQ(decoded.getURL(), "/upload?id=7");
+  EXPECT_EQ(decoded.getPath(), "/upload");
+  EXPECT_EQ(decoded.getQueryParam("id"), "7");
+  EXPECT_EQ(decoded.getHTTPVersion(), std::make_pair<uint8_t, uint8_t>(1, 1));
+  EXPECT_TRUE(decoded.isSecure());
+  EXPECT_EQ(decoded.getClientAddress(), msg.getClientAddress());
+  EXPECT_EQ(decoded.getClientIP(), "2001:db8::1");
+  EXPECT_EQ(decoded.getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST),
+            "www.example.com");
+  EXPECT_EQ(decoded.getHeaders().combine("X-Custom"), "a, b");
+  ASSERT_NE(decoded.getTrailers(), nullptr);
+  EXPECT_EQ(decoded.getTrailers()->getSingleOrEmpty("X-Checksum"), "123");
+}
+
+TEST(HTTPMessageSerializerTest, Response) {
+  HTTPMessage msg;
+  msg.setStatusCode(404);
+  msg.setStatusMessage("Not Found");
+  msg.setHTTPVersion(1, 0);
+  msg.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH, "0");
+
+  auto encoded = serialize(msg);
+  HTTPMessage decoded;
+  ASSERT_TRUE(HTTPMessageSerializer::deserialize(range(encoded), decoded));
+  EXPECT_TRUE(decoded.isResponse());
+  EXPECT_EQ(decoded.getStatusCode(), 404);
+  EXPECT_EQ(decoded.getStatusMessage(), "Not Found");
+  EXPECT_FALSE(decoded.isSecure());
+  EXPECT_EQ(decoded.getTrailers(), nullptr);
+  EXPECT_EQ(decoded.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH),
+            "0");
+}
+
+TEST(HTTPMessageSerializerTest, ExtensionMethod) {
+  HTTPMessage msg;
+  msg.setMethod("PROPFIND");
+  msg.setURL("/dav");
+
+  auto encoded = serialize(msg);
+  HTTPMessage decoded;
+  ASSERT_TRUE(HTTPMessageSerializer::deserialize(range(encoded), decoded));
+  EXPECT_FALSE(decoded.getMethod());
+  EXPECT_EQ(decoded.getMethodString(), "PROPFIND");
+}
+
+TEST(HTTPMessageSerializerTest, GetHeader) {
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::GET);
+  msg.setURL("/");
+  msg.getHeaders().add(HTTP_HEADER_USER_AGENT, "curl");
+  msg.getHeaders().add("X-Tenant", "blue");
+  auto trailers = std::make_unique<HTTPHeaders>();
+  trailers->add("X-Late", "1");
+  msg.setTrailers(std::move(trailers));
+  auto encoded = serialize(msg);
+
+  EXPECT_EQ(HTTPMessageSerializer::getHeader(range(encoded),
+                                             HTTP_HEADER_USER_AGENT),
+            folly::StringPiece("curl"));
+  EXPECT_EQ(HTTPMessageSerializer::getHeader(range(encoded), "user-agent"),
+            folly::StringPiece("curl"));
+  EXPECT_EQ(HTTPMessageSerializer::getHeader(range(encoded), "x-tenant"),
+            folly::StringPiece("blue"));
+  EXPECT_FALSE(HTTPMessageSerializer::getHeader(range(encoded),
+                                                HTTP_HEADER_HOST));
+  // Trailers aren't searched
+  EXPECT_FALSE(HTTPMessageSerializer::getHeader(range(encoded), "X-Late"));
+}
+
+TEST(HTTPMessageSerializerTest, Malformed) {
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::GET);
+  msg.setURL("/");
+  msg.getHeaders().add("X-Tenant", "blue");
+  auto encoded = serialize(msg);
+
+  for (size_t len = 0; len < encoded.size(); len++) {
+    HTTPMessage decoded;
+    EXPECT_FALSE(HTTPMessageSerializer::deserialize(
+                   range(encoded.substr(0, len)), decoded)) << len;
+  }
+  auto other = encoded;
+  other[0] = HTTPMessageSerializer::kVersion + 1;
+  HTTPMessage decoded;
+  EXPECT_FALSE(HTTPMessageSerializer::deserialize(range(other), decoded));
+  EXPECT_FALSE(HTTPMessageSerializer::getHeader(range(other), "x-tenant"));
+}
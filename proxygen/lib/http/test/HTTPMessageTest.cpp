@@ -79,6 +79,40 @@ TEST(HTTPMessage, TestParseQueryParamsSimple) {
   EXPECT_ANY_THROW(msg.getIntQueryParam("second"));
 }
 
+TEST(HTTPMessage, TestParseCookiesDuplicate) {
+  HTTPMessage msg;
+
+  msg.getHeaders().add("Cookie", "a=1; same=first");
+  msg.getHeaders().add("Cookie", "same=second; b=2");
+  EXPECT_EQ(msg.getCookie("same"), "first");
+  EXPECT_EQ(msg.getCookie("b"), "2");
+  // Headers added after a lookup are seen by the next one
+  msg.getHeaders().add("Cookie", "c=3");
+  EXPECT_EQ(msg.getCookie("c"), "3");
+}
+
+TEST(HTTPMessage, TestQueryParamPiece) {
+  HTTPMessage msg;
+
+  msg.setURL("/test?seq=123&dup=1&dup=2&flag&empty=&=noname");
+  EXPECT_EQ(*msg.getQueryParamPiece("seq"), "123");
+  EXPECT_EQ(*msg.getQueryParamPiece("dup"), "2");
+  EXPECT_EQ(*msg.getQueryParamPiece("flag"), "");
+  EXPECT_EQ(*msg.getQueryParamPiece("empty"), "");
+  EXPECT_EQ(*msg.getQueryParamPiece(""), "noname");
+  EXPECT_FALSE(msg.getQueryParamPiece("missing"));
+  EXPECT_FALSE(msg.getQueryParamPiece("se"));
+  // The same answers as the parsed map
+  for (const auto& param : msg.getQueryParams()) {
+    EXPECT_EQ(*msg.getQueryParamPiece(param.first), param.second);
+  }
+
+  EXPECT_TRUE(msg.setQueryParam("seq", "456"));
+  EXPECT_EQ(*msg.getQueryParamPiece("seq"), "456");
+  EXPECT_TRUE(msg.removeQueryParam("flag"));
+  EXPECT_FALSE(msg.getQueryParamPiece("flag"));
+}
+
 TEST(HTTPMessage, TestParseQueryParamsComplex) {
   HTTPMessage msg;
   std::vector<std::vector<std::string>> input = {
@@ -429,6 +463,46 @@ TEST(HTTPHeaders, InitializerListStringPiece) {
   EXPECT_EQ("value", hdrs.getSingleOrEmpty(HTTP_HEADER_CONNECTION));
 }
 
+TEST(HTTPHeaders, PresenceAfterRemoval) {
+  HTTPHeaders hdrs;
+  EXPECT_FALSE(hdrs.exists(HTTP_HEADER_HOST));
+  hdrs.add(HTTP_HEADER_HOST, "a");
+  hdrs.add(HTTP_HEADER_HOST, "b");
+  hdrs.add(HTTP_HEADER_CONNECTION, "keep-alive");
+  hdrs.add("X-Custom", "c");
+  EXPECT_EQ(hdrs.getNumberOfValues(HTTP_HEADER_HOST), 2);
+  EXPECT_FALSE(hdrs.exists(HTTP_HEADER_SERVER));
+
+  EXPECT_TRUE(hdrs.remove(HTTP_HEADER_HOST));
+  EXPECT_FALSE(hdrs.exists(HTTP_HEADER_HOST));
+  EXPECT_FALSE(hdrs.remove(HTTP_HEADER_HOST));
+  hdrs.add(HTTP_HEADER_HOST, "d");
+  EXPECT_EQ("d", hdrs.getSingleOrEmpty(HTTP_HEADER_HOST));
+
+  // Removed by predicate, the code is still flagged but not found
+  hdrs.removeByPredicate([] (HTTPHeaderCode code, const string&,
+                             const string&) {
+    return code == HTTP_HEADER_CONNECTION;
+  });
+  EXPECT_FALSE(hdrs.exists(HTTP_HEADER_CONNECTION));
+
+  HTTPHeaders stripped;
+  hdrs.add(HTTP_HEADER_TE, "trailers");
+  hdrs.stripPerHopHeaders(stripped);
+  EXPECT_FALSE(hdrs.exists(HTTP_HEADER_TE));
+  EXPECT_EQ("trailers", stripped.getSingleOrEmpty(HTTP_HEADER_TE));
+
+  HTTPHeaders copy(hdrs);
+  EXPECT_TRUE(copy.exists("X-Custom"));
+  EXPECT_EQ("d", copy.getSingleOrEmpty(HTTP_HEADER_HOST));
+  HTTPHeaders moved(std::move(copy));
+  EXPECT_TRUE(moved.exists(HTTP_HEADER_HOST));
+  EXPECT_FALSE(copy.exists(HTTP_HEADER_HOST));
+  moved.removeAll();
+  EXPECT_FALSE(moved.exists(HTTP_HEADER_HOST));
+  EXPECT_FALSE(moved.exists("X-Custom"));
+}
+
 void testRemoveQueryParam(const string& url,
                           const string& queryParam,
                           const string& expectedUrl,
@@ -541,3 +615,50 @@ TEST(HttpMessage, TestExtractTrailers) {
   EXPECT_EQ(rawPointer, trailers2.get());
   EXPECT_EQ(nullptr, msg.getTrailers());
 }
+
+TEST(HttpMessage, TestApplyHeaderTemplate) {
+  HTTPHeaders common;
+  common.add(HTTP_HEADER_SERVER, "proxygen");
+  common.add("X-Common", "1");
+
+  HTTPMessage msg;
+  msg.setHeaderTemplate(HTTPHeaderTemplate::create(common));
+  msg.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH, "10");
+
+  HTTPMessage copy(msg);
+  EXPECT_EQ(copy.getHeaderTemplate(), msg.getHeaderTemplate());
+
+  msg.applyHeaderTemplate();
+  EXPECT_EQ(nullptr, msg.getHeaderTemplate());
+  std::vector<std::string> names;
+  msg.getHeaders().forEach([&] (const std::string& name,
+                                const std::string& /*value*/) {
+    names.push_back(name);
+  });
+  std::vector<std::string> expected{"Server", "X-Common", "Content-Length"};
+  EXPECT_EQ(expected, names);
+  // the template itself is untouched
+  EXPECT_EQ(2, copy.getHeaderTemplate()->getHeaders().size());
+}
+
+TEST(HttpMessage, TestRecycling) {
+  HTTPMessage::setRecycling(true);
+  auto msg = std::make_unique<HTTPMessage>();
+  msg->getHeaders().add(HTTP_HEADER_HOST, "www.foo.com");
+  auto storage = msg.get();
+  msg.reset();
+
+  msg = std::make_unique<HTTPMessage>();
+  EXPECT_EQ(msg.get(), storage);
+  EXPECT_EQ(msg->getHeaders().size(), 0);
+  HTTPMessage::setRecycling(false);
+}
+
+TEST(HttpMessage, TestFormatDateHeader) {
+  const auto& date = HTTPMessage::formatDateHeader();
+  // e.g. "Wed, 14 Oct 2026 12:34:56 GMT"
+  EXPECT_EQ(date.size(), 29);
+  EXPECT_EQ(date.substr(date.size() - 4), " GMT");
+  // rendered once into the thread's cache and handed out from there
+  EXPECT_EQ(&HTTPMessage::formatDateHeader(), &date);
+}
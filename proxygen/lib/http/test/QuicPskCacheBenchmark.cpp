@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/Optional.h>
+#include <proxygen/lib/http/ShardedSynchronizedLruQuicPskCache.h>
+#include <proxygen/lib/http/SynchronizedLruQuicPskCache.h>
+
+#include <thread>
+
+using namespace folly;
+using namespace proxygen;
+
+// Lookups, with a put on each miss, from threads sharing a PSK cache: iters
+// operations in total split between the threads.  Relative to the
+// single-lock SynchronizedLruQuicPskCache on as many threads.
+
+namespace {
+
+const uint64_t kCacheSize = 10000;
+// More identities than fit, for some evictions
+const uint64_t kNumIdentities = 12000;
+
+std::vector<std::string> identities;
+
+template <class Cache>
+void pskCacheBench(Cache& cache, size_t iters, size_t threads) {
+  std::vector<std::thread> workers;
+  BENCHMARK_SUSPEND {
+    if (identities.empty()) {
+      for (uint64_t i = 0; i < kNumIdentities; i++) {
+        identities.push_back(folly::to<std::string>("host", i, ".example.com"));
+      }
+    }
+    workers.reserve(threads);
+  }
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([&cache, iters, threads, t] {
+      // Each thread walks the identities with a different stride
+      uint64_t idx = t * 7919;
+      for (size_t i = t; i < iters; i += threads) {
+        idx = (idx + 104729) % kNumIdentities;
+        auto& identity = identities[idx];
+        auto psk = cache.getPsk(identity);
+        if (!psk) {
+          cache.putPsk(identity, quic::QuicCachedPsk());
+        }
+        folly::doNotOptimizeAway(psk);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void synchronizedLru(size_t iters, size_t threads) {
+  folly::Optional<SynchronizedLruQuicPskCache> cache;
+  BENCHMARK_SUSPEND {
+    cache.emplace(kCacheSize);
+  }
+  pskCacheBench(*cache, iters, threads);
+  BENCHMARK_SUSPEND {
+    cache.reset();
+  }
+}
+
+void shardedSynchronizedLru(size_t iters, size_t threads) {
+  folly::Optional<ShardedSynchronizedLruQuicPskCache> cache;
+  BENCHMARK_SUSPEND {
+    cache.emplace(kCacheSize);
+  }
+  pskCacheBench(*cache, iters, threads);
+  BENCHMARK_SUSPEND {
+    cache.reset();
+  }
+}
+
+}
+
+#define PSK_CACHE_BENCHMARKS(threads)                                        \
+  BENCHMARK_NAMED_PARAM(synchronizedLru, threads_##threads, threads)         \
+  BENCHMARK_RELATIVE_NAMED_PARAM(shardedSynchronizedLru, threads_##threads,  \
+                                 threads)                                    \
+  BENCHMARK_DRAW_LINE();
+
+PSK_CACHE_BENCHMARKS(1)
+PSK_CACHE_BENCHMARKS(4)
+PSK_CACHE_BENCHMARKS(16)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
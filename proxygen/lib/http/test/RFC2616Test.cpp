@@ -200,3 +200,68 @@ TEST(ByteRangeSpecTest, Invalids) {
   EXPECT_FALSE(parseByteRangeSpec(sp, dummy, dummy, dummy)) <<
     "Spec StringPiece ends before first byte in initial byte range";
 }
+
+TEST(ByteRangeRequestTest, Satisfiable) {
+  unsigned long firstByte = ULONG_MAX;
+  unsigned long lastByte = ULONG_MAX;
+  using RFC2616::ByteRange;
+  using RFC2616::parseByteRangeRequest;
+
+  EXPECT_EQ(ByteRange::SATISFIABLE,
+            parseByteRangeRequest("bytes=0-9", 100, firstByte, lastByte));
+  EXPECT_EQ(0, firstByte);
+  EXPECT_EQ(9, lastByte);
+
+  EXPECT_EQ(ByteRange::SATISFIABLE,
+            parseByteRangeRequest("bytes=90-", 100, firstByte, lastByte));
+  EXPECT_EQ(90, firstByte);
+  EXPECT_EQ(99, lastByte);
+
+  EXPECT_EQ(ByteRange::SATISFIABLE,
+            parseByteRangeRequest("bytes=50-500", 100, firstByte, lastByte));
+  EXPECT_EQ(50, firstByte);
+  EXPECT_EQ(99, lastByte);
+
+  EXPECT_EQ(ByteRange::SATISFIABLE,
+            parseByteRangeRequest("bytes=-10", 100, firstByte, lastByte));
+  EXPECT_EQ(90, firstByte);
+  EXPECT_EQ(99, lastByte);
+
+  EXPECT_EQ(ByteRange::SATISFIABLE,
+            parseByteRangeRequest("bytes=-1000", 100, firstByte, lastByte));
+  EXPECT_EQ(0, firstByte);
+  EXPECT_EQ(99, lastByte);
+}
+
+TEST(ByteRangeRequestTest, Unsatisfiable) {
+  unsigned long dummy;
+  using RFC2616::ByteRange;
+  using RFC2616::parseByteRangeRequest;
+
+  EXPECT_EQ(ByteRange::UNSATISFIABLE,
+            parseByteRangeRequest("bytes=100-", 100, dummy, dummy));
+  EXPECT_EQ(ByteRange::UNSATISFIABLE,
+            parseByteRangeRequest("bytes=-0", 100, dummy, dummy));
+  EXPECT_EQ(ByteRange::UNSATISFIABLE,
+            parseByteRangeRequest("bytes=-5", 0, dummy, dummy));
+}
+
+TEST(ByteRangeRequestTest, Invalids) {
+  unsigned long dummy;
+  using RFC2616::ByteRange;
+  using RFC2616::parseByteRangeRequest;
+
+  EXPECT_EQ(ByteRange::INVALID,
+            parseByteRangeRequest("items=0-9", 100, dummy, dummy));
+  EXPECT_EQ(ByteRange::INVALID,
+            parseByteRangeRequest("bytes=0-9,20-29", 100, dummy, dummy));
+  EXPECT_EQ(ByteRange::INVALID,
+            parseByteRangeRequest("bytes=9-0", 100, dummy, dummy));
+  EXPECT_EQ(ByteRange::INVALID,
+            parseByteRangeRequest("bytes=-", 100, dummy, dummy));
+  EXPECT_EQ(ByteRange::INVALID,
+            parseByteRangeRequest("bytes=0x-9", 100, dummy, dummy));
+  EXPECT_EQ(ByteRange::INVALID,
+            parseByteRangeRequest("bytes=99999999999999999999-", 100, dummy,
+                                  dummy));
+}
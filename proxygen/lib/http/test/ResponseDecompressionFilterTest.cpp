@@ -0,0 +1,167 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/ResponseDecompressionFilter.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+
+using namespace proxygen;
+
+namespace {
+
+// Records what the filter passes on
+class ResponseRecorder : public HTTPTransaction::Handler {
+ public:
+  void setTransaction(HTTPTransaction* /*txn*/) noexcept override {}
+  void detachTransaction() noexcept override {}
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    headers = std::move(msg);
+  }
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    body.append(std::move(chain));
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept override {
+  }
+  void onEOM() noexcept override {
+    eom = true;
+  }
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {}
+  void onError(const HTTPException& /*error*/) noexcept override {
+    errors++;
+  }
+  void onEgressPaused() noexcept override {}
+  void onEgressResumed() noexcept override {}
+
+  std::string getBody() {
+    auto buf = body.move();
+    return buf ? buf->moveToFbString().toStdString() : "";
+  }
+
+  std::unique_ptr<HTTPMessage> headers;
+  folly::IOBufQueue body{folly::IOBufQueue::cacheChainLength()};
+  bool eom{false};
+  uint32_t errors{0};
+};
+
+std::unique_ptr<HTTPMessage> makeResponse(const std::string& encoding) {
+  auto msg = std::make_unique<HTTPMessage>();
+  msg->setStatusCode(200);
+  msg->getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, encoding);
+  msg->getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, "100");
+  return msg;
+}
+
+std::unique_ptr<folly::IOBuf> gzip(const std::string& data) {
+  ZlibStreamCompressor compressor(CompressionType::GZIP, 6);
+  auto buf = folly::IOBuf::copyBuffer(data);
+  return compressor.compress(buf.get(), true);
+}
+
+}
+
+class ResponseDecompressionFilterTest : public testing::Test {
+ public:
+  void SetUp() override {
+    filter_.setNextTransactionHandler(&recorder_);
+  }
+
+ protected:
+  ResponseDecompressionFilter::Options options_;
+  ResponseDecompressionFilter filter_{options_};
+  ResponseRecorder recorder_;
+};
+
+TEST_F(ResponseDecompressionFilterTest, AcceptEncoding) {
+  HTTPMessage request;
+  filter_.prepareRequest(request);
+  EXPECT_EQ(options_.acceptEncoding,
+            request.getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT_ENCODING));
+
+  // Left as set by the caller
+  HTTPMessage identity;
+  identity.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "identity");
+  filter_.prepareRequest(identity);
+  EXPECT_EQ("identity", identity.getHeaders().getSingleOrEmpty(
+                          HTTP_HEADER_ACCEPT_ENCODING));
+}
+
+TEST_F(ResponseDecompressionFilterTest, Decompresses) {
+  std::string data(10000, 'a');
+  auto compressed = gzip(data);
+  filter_.onHeadersComplete(makeResponse("gzip"));
+  EXPECT_TRUE(filter_.isDecompressing());
+  ASSERT_TRUE(recorder_.headers);
+  EXPECT_FALSE(recorder_.headers->getHeaders().exists(
+                 HTTP_HEADER_CONTENT_ENCODING));
+  EXPECT_FALSE(recorder_.headers->getHeaders().exists(
+                 HTTP_HEADER_CONTENT_LENGTH));
+
+  // In two bodies
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  queue.append(std::move(compressed));
+  filter_.onBody(queue.split(queue.chainLength() / 2));
+  filter_.onBody(queue.move());
+  filter_.onEOM();
+  EXPECT_TRUE(recorder_.eom);
+  EXPECT_EQ(0, recorder_.errors);
+  EXPECT_EQ(data, recorder_.getBody());
+}
+
+TEST_F(ResponseDecompressionFilterTest, Truncated) {
+  auto compressed = gzip(std::string(10000, 'a'));
+  compressed->coalesce();
+  compressed->trimEnd(4);
+  filter_.onHeadersComplete(makeResponse("gzip"));
+  filter_.onBody(std::move(compressed));
+  filter_.onEOM();
+  EXPECT_FALSE(recorder_.eom);
+  EXPECT_EQ(1, recorder_.errors);
+}
+
+TEST_F(ResponseDecompressionFilterTest, Corrupt) {
+  filter_.onHeadersComplete(makeResponse("gzip"));
+  filter_.onBody(folly::IOBuf::copyBuffer("not gzip at all"));
+  filter_.onBody(folly::IOBuf::copyBuffer("more"));
+  filter_.onEOM();
+  EXPECT_FALSE(recorder_.eom);
+  EXPECT_EQ(1, recorder_.errors);
+  EXPECT_EQ("", recorder_.getBody());
+}
+
+TEST_F(ResponseDecompressionFilterTest, Passthrough) {
+  HTTPMessage downstream;
+  downstream.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "gzip, br;q=0");
+  filter_.setPassthrough(downstream);
+  HTTPMessage request;
+  filter_.prepareRequest(request);
+  EXPECT_EQ("gzip, br;q=0", request.getHeaders().getSingleOrEmpty(
+                              HTTP_HEADER_ACCEPT_ENCODING));
+
+  auto compressed = gzip("hello");
+  auto expected = compressed->cloneCoalesced()->moveToFbString();
+  filter_.onHeadersComplete(makeResponse("gzip"));
+  EXPECT_FALSE(filter_.isDecompressing());
+  EXPECT_EQ("gzip", recorder_.headers->getHeaders().getSingleOrEmpty(
+                      HTTP_HEADER_CONTENT_ENCODING));
+  filter_.onBody(std::move(compressed));
+  filter_.onEOM();
+  EXPECT_EQ(expected.toStdString(), recorder_.getBody());
+}
+
+TEST_F(ResponseDecompressionFilterTest, NotPassedThrough) {
+  HTTPMessage downstream;
+  downstream.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "br, gzip;q=0");
+  filter_.setPassthrough(downstream);
+  filter_.onHeadersComplete(makeResponse("gzip"));
+  EXPECT_TRUE(filter_.isDecompressing());
+  filter_.onBody(gzip("hello"));
+  filter_.onEOM();
+  EXPECT_EQ("hello", recorder_.getBody());
+}
@@ -14,15 +14,21 @@
 #include <folly/String.h>
 #include <wangle/acceptor/ServerSocketConfig.h>
 #include <list>
+#include <memory>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <proxygen/lib/http/codec/HTTPSettings.h>
+#include <proxygen/lib/http/session/SessionMemoryBudget.h>
 #include <zlib.h>
 
 namespace proxygen {
 
+class HandshakeOffloadPool;
+class LazyCertificateStore;
+class TrafficCaptureWriter;
+
 /**
  * Configuration for a single Acceptor.
  *
@@ -64,6 +70,13 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
    */
   std::list<std::string> allowedPlaintextUpgradeProtocols;
 
+  /**
+   * Whether HTTP/1.x connections that start with the HTTP/2 connection
+   * preface are served HTTP/2 (h2c with prior knowledge), see
+   * HTTPSession::enableH2cPriorKnowledge.
+   */
+  bool allowH2cPriorKnowledge{false};
+
   /**
    * HTTP/2 or SPDY settings for this acceptor
    */
@@ -75,6 +88,112 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
    */
   uint32_t maxConcurrentIncomingStreams{0};
 
+  /**
+   * The maximum number of pipelined HTTP/1.x responses that may be
+   * coalesced into one write.  1 disables batching.
+   */
+  uint32_t maxPipelineBatch{1};
+
+  /**
+   * Merge the explicit chunks of HTTP/1.1 responses into chunks of up to
+   * this many bytes, see HTTPSession::setEgressChunkCoalescing.  0
+   * disables it.
+   */
+  uint32_t maxCoalescedChunkSize{0};
+
+  /**
+   * Serve TransportInfo from a per session cache, see
+   * HTTPSession::setTransportInfoCachePolicy.  Both 0 read the socket for
+   * every call.
+   */
+  uint32_t transportInfoCacheRequests{0};
+  std::chrono::milliseconds transportInfoCacheAge{0};
+
+  /**
+   * More than this many streams reset by the client within
+   * streamResetInterval close an HTTP/2 connection, see
+   * HTTPSession::setStreamResetLimit.  0 disables the limit.
+   */
+  uint32_t maxStreamResetsPerInterval{0};
+  std::chrono::milliseconds streamResetInterval{1000};
+
+  /**
+   * Egress batching, see HTTPSession::EgressBatchPolicy.  A target of 0
+   * writes whatever one pass over the egress queue produced.
+   */
+  uint32_t egressTargetBytesPerWrite{0};
+  std::chrono::microseconds egressBatchMaxLatency{200};
+  uint32_t tcpNotSentLowat{0};
+
+  /**
+   * Bytes each session of a worker may write per round of the worker's
+   * EgressScheduler, see HTTPSession::setEgressScheduler.  0 lets every
+   * session write on its own.
+   */
+  uint32_t egressSchedulerQuantum{0};
+
+  /**
+   * Idle time after which sessions release reclaimable memory, see
+   * HTTPSessionBase::setHibernateTimeout.  0 disables it.
+   */
+  std::chrono::milliseconds hibernateTimeout{0};
+
+  /**
+   * Keeps the plaintext connections as their socket alone, with the
+   * connection idle timeout, until their first bytes arrive, then builds
+   * their session.  Idle preconnects and port scans then cost no codec or
+   * session buffers.
+   */
+  bool deferSessionUntilData{false};
+
+  /**
+   * How long to wait for kernel TX and ACK timestamps of response bytes,
+   * see HTTPSession::enableSocketTimestamps.  0 disables them.
+   */
+  std::chrono::milliseconds socketTimestampTimeout{0};
+
+  /**
+   * Hand the keys of OpenSSL sessions to the kernel, see KernelTLS.h.
+   */
+  bool enableKernelTLS{false};
+
+  /**
+   * Writes of at least this many bytes use MSG_ZEROCOPY, see
+   * HTTPSession::setEgressZeroCopyThreshold.  0 disables it.
+   */
+  size_t egressZeroCopyThreshold{0};
+
+  /**
+   * Schedule egress with RFC 9218 urgencies instead of the RFC 7540
+   * dependency tree.
+   */
+  bool useRFC9218Priorities{false};
+
+  /**
+   * Number of repeated header blocks whose HPACK encoding is memoized per
+   * HTTP/2 connection.  0 disables the cache.
+   */
+  size_t headerEncodeCacheSize{0};
+
+  /**
+   * Share the encoding of header blocks that only use the static table
+   * across the HTTP/2 connections of a thread.
+   */
+  bool useStaticHeaderBlockCache{false};
+
+  /**
+   * Keep the Huffman encoded literals of received HTTP/2 header blocks
+   * with the messages so proxies can forward them without encoding them
+   * again.  See HTTPMessage::getHuffmanLiterals.
+   */
+  bool headerPassthrough{false};
+
+  /**
+   * Account the thread CPU time of one in every cpuTimeSampleRate
+   * transactions in their PhaseTimings.  0 disables it.
+   */
+  uint32_t cpuTimeSampleRate{0};
+
   /**
    * Flow control parameters.
    *
@@ -90,12 +209,59 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
   size_t receiveStreamWindowSize{65536};
   size_t receiveSessionWindowSize{65536};
 
+  /**
+   * Upper bounds of the receive windows tuned to the bandwidth-delay
+   * product, see HTTPSession::enableReceiveWindowAutotuning.  0 disables
+   * the tuning.
+   */
+  size_t maxReceiveSessionWindowSize{0};
+  size_t maxReceiveStreamWindowSize{0};
+
+  /**
+   * The number of frames each session keeps a trace of, see
+   * HTTPSession::enableFrameTrace.  0 disables the trace.
+   */
+  size_t frameTraceSize{0};
+
+  /**
+   * If set, the sessions it samples have their traffic captured into it,
+   * see HTTPSession::enableTrafficCapture.
+   */
+  std::shared_ptr<TrafficCaptureWriter> trafficCapture;
+
   /**
    * These parameters control how many bytes HTTPSession's will buffer in user
    * space before applying backpressure to handlers.  -1 means use the
    * built-in HTTPSession default (64kb)
    */
   int64_t writeBufferLimit{-1};
+
+  /**
+   * The budget every session of the acceptor counts its egress buffers
+   * against, see SessionMemoryBudget.  Share one between acceptors for a
+   * process wide budget.  nullptr uses the HTTPSession default (none).
+   */
+  std::shared_ptr<SessionMemoryBudget> egressMemoryBudget;
+
+  /**
+   * Likewise for the sessions' ingress buffers, see
+   * HTTPSession::setIngressMemoryBudget.
+   */
+  std::shared_ptr<SessionMemoryBudget> ingressMemoryBudget;
+
+  /**
+   * Threads to sign the TLS 1.3 handshakes of the acceptor on, see
+   * HandshakeOffloadPool; needs fizzConfig.enableFizz.  Share one between
+   * acceptors.  nullptr signs on the acceptor's thread.
+   */
+  std::shared_ptr<HandshakeOffloadPool> handshakeOffloadPool;
+
+  /**
+   * Certificates for the SNI names sslContextConfigs doesn't have, loaded
+   * on first use, see LazyCertificateStore.  The sniNoMatchFn of
+   * sslContextConfigs must call its onNoMatch().
+   */
+  std::shared_ptr<LazyCertificateStore> lazyCertificates;
 };
 
 } // proxygen
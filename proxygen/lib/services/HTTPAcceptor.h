@@ -12,6 +12,8 @@
 #include <memory>
 #include <wangle/acceptor/Acceptor.h>
 #include <proxygen/lib/services/AcceptorConfiguration.h>
+#include <proxygen/lib/services/HandshakeOffloadPool.h>
+#include <proxygen/lib/services/LazyCertificateStore.h>
 #include <proxygen/lib/utils/AsyncTimeoutSet.h>
 #include <folly/io/async/AsyncServerSocket.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
@@ -24,6 +26,12 @@ class HTTPAcceptor : public wangle::Acceptor {
     : Acceptor(accConfig)
     , accConfig_(accConfig) {}
 
+  ~HTTPAcceptor() override {
+    if (accConfig_.lazyCertificates && sslCtxManager_) {
+      accConfig_.lazyCertificates->detach(sslCtxManager_.get());
+    }
+  }
+
   /**
    * Returns true if this server is internal to facebook
    */
@@ -44,6 +52,19 @@ class HTTPAcceptor : public wangle::Acceptor {
     timer_ = std::make_unique<WheelTimerInstance>(
         accConfig_.transactionIdleTimeout, eventBase);
     Acceptor::init(serverSocket, eventBase);
+    if (accConfig_.lazyCertificates && sslCtxManager_) {
+      accConfig_.lazyCertificates->attach(sslCtxManager_.get());
+    }
+  }
+
+  std::shared_ptr<fizz::server::FizzServerContext> createFizzContext()
+      override {
+    auto ctx = Acceptor::createFizzContext();
+    if (ctx && accConfig_.handshakeOffloadPool) {
+      offloadHandshakes(*ctx, accConfig_.sslContextConfigs,
+                        accConfig_.handshakeOffloadPool);
+    }
+    return ctx;
   }
 
   const AcceptorConfiguration& getConfig() const { return accConfig_; }
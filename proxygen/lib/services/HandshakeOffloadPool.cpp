@@ -0,0 +1,84 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/services/HandshakeOffloadPool.h>
+
+#include <fizz/protocol/CertUtils.h>
+#include <fizz/server/CertManager.h>
+#include <folly/FileUtil.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+HandshakeOffloadPool::HandshakeOffloadPool(const Options& options)
+    : options_(options),
+      executor_(std::max<size_t>(options.numThreads, 1),
+                std::make_shared<folly::NamedThreadFactory>("TLSOffload")) {}
+
+HandshakeOffloadPool::~HandshakeOffloadPool() {
+  executor_.join();
+}
+
+folly::Future<folly::Optional<fizz::Buf>> OffloadedSelfCert::signFuture(
+    fizz::SignatureScheme scheme,
+    fizz::CertificateVerifyContext context,
+    folly::ByteRange toBeSigned) const {
+  // toBeSigned is only valid for the duration of the call
+  auto cert = cert_;
+  auto data = folly::IOBuf::copyBuffer(toBeSigned);
+  auto signature = pool_->tryRun(
+    [cert, scheme, context, data = std::move(data)] {
+      return folly::Optional<fizz::Buf>(
+        cert->sign(scheme, context, data->coalesce()));
+    });
+  if (!signature) {
+    // Fails the handshake
+    return folly::makeFuture(folly::Optional<fizz::Buf>());
+  }
+  return std::move(*signature);
+}
+
+void offloadHandshakes(
+    fizz::server::FizzServerContext& ctx,
+    const std::vector<wangle::SSLContextConfig>& sslContextConfigs,
+    const std::shared_ptr<HandshakeOffloadPool>& pool) {
+  auto certManager = std::make_unique<fizz::server::CertManager>();
+  for (const auto& sslConfig : sslContextConfigs) {
+    for (const auto& certInfo : sslConfig.certificates) {
+      if (!certInfo.passwordPath.empty()) {
+        LOG(WARNING) << "Not offloading the handshakes of "
+                     << certInfo.certPath << ": its key has a password";
+        return;
+      }
+      std::string certData;
+      std::string keyData;
+      if (!folly::readFile(certInfo.certPath.c_str(), certData) ||
+          !folly::readFile(certInfo.keyPath.c_str(), keyData)) {
+        LOG(WARNING) << "Not offloading the handshakes of "
+                     << certInfo.certPath << ": can't read it or its key";
+        return;
+      }
+      try {
+        std::shared_ptr<fizz::SelfCert> cert =
+          fizz::CertUtils::makeSelfCert(certData, keyData);
+        certManager->addCert(
+          std::make_shared<OffloadedSelfCert>(std::move(cert), pool),
+          sslConfig.isDefault);
+      } catch (const std::exception& ex) {
+        LOG(WARNING) << "Not offloading the handshakes of "
+                     << certInfo.certPath << ": " << ex.what();
+        return;
+      }
+    }
+  }
+  ctx.setCertManager(std::move(certManager));
+}
+
+}
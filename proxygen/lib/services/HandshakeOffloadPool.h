@@ -0,0 +1,156 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <fizz/server/AsyncSelfCert.h>
+#include <fizz/server/FizzServerContext.h>
+#include <folly/Optional.h>
+#include <folly/ScopeGuard.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/functional/Invoke.h>
+#include <folly/futures/Future.h>
+#include <wangle/acceptor/ServerSocketConfig.h>
+
+#include <atomic>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Threads to run the private key operations of TLS handshakes on, so that a
+ * burst of full handshakes doesn't stall the worker EventBases serving
+ * requests.
+ *
+ * Admission is by queue depth: once maxQueueDepth operations are queued or
+ * running, tryRun() refuses more, and the handshakes needing them fail fast
+ * rather than waiting behind a backlog the clients will have given up on.
+ */
+class HandshakeOffloadPool {
+ public:
+  struct Options {
+    size_t numThreads{1};
+    size_t maxQueueDepth{1024};
+  };
+
+  explicit HandshakeOffloadPool(const Options& options);
+
+  // Waits for the queued operations
+  ~HandshakeOffloadPool();
+
+  HandshakeOffloadPool(const HandshakeOffloadPool&) = delete;
+  HandshakeOffloadPool& operator=(const HandshakeOffloadPool&) = delete;
+
+  /**
+   * Runs func on one of the pool's threads, and completes the returned
+   * future with its result there; or returns none if the pool is full.
+   */
+  template <typename F>
+  folly::Optional<folly::Future<folly::invoke_result_t<F>>> tryRun(F&& func) {
+    if (depth_.fetch_add(1, std::memory_order_relaxed) >=
+        options_.maxQueueDepth) {
+      depth_.fetch_sub(1, std::memory_order_relaxed);
+      rejected_.fetch_add(1, std::memory_order_relaxed);
+      return folly::none;
+    }
+    return folly::via(
+      &executor_, [this, f = std::forward<F>(func)]() mutable {
+        SCOPE_EXIT {
+          depth_.fetch_sub(1, std::memory_order_relaxed);
+          completed_.fetch_add(1, std::memory_order_relaxed);
+        };
+        return f();
+      });
+  }
+
+  // The operations queued or running
+  size_t getQueueDepth() const {
+    return depth_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t getNumRejected() const {
+    return rejected_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t getNumCompleted() const {
+    return completed_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  const Options options_;
+  std::atomic<size_t> depth_{0};
+  std::atomic<uint64_t> rejected_{0};
+  std::atomic<uint64_t> completed_{0};
+  folly::CPUThreadPoolExecutor executor_;
+};
+
+/**
+ * A fizz certificate whose signatures are computed on a
+ * HandshakeOffloadPool; fizz suspends the handshake until they are.
+ */
+class OffloadedSelfCert : public fizz::AsyncSelfCert {
+ public:
+  OffloadedSelfCert(std::shared_ptr<fizz::SelfCert> cert,
+                    std::shared_ptr<HandshakeOffloadPool> pool)
+      : cert_(std::move(cert)), pool_(std::move(pool)) {}
+
+  folly::Future<folly::Optional<fizz::Buf>> signFuture(
+    fizz::SignatureScheme scheme,
+    fizz::CertificateVerifyContext context,
+    folly::ByteRange toBeSigned) const override;
+
+  std::string getIdentity() const override {
+    return cert_->getIdentity();
+  }
+
+  std::vector<std::string> getAltIdentities() const override {
+    return cert_->getAltIdentities();
+  }
+
+  std::vector<fizz::SignatureScheme> getSigSchemes() const override {
+    return cert_->getSigSchemes();
+  }
+
+  fizz::CertificateMsg getCertMessage(
+    fizz::Buf certificateRequestContext = nullptr) const override {
+    return cert_->getCertMessage(std::move(certificateRequestContext));
+  }
+
+  fizz::CompressedCertificate getCompressedCert(
+    fizz::CertificateCompressionAlgorithm algo) const override {
+    return cert_->getCompressedCert(algo);
+  }
+
+  // Inline, for the callers that can't wait
+  fizz::Buf sign(fizz::SignatureScheme scheme,
+                 fizz::CertificateVerifyContext context,
+                 folly::ByteRange toBeSigned) const override {
+    return cert_->sign(scheme, context, toBeSigned);
+  }
+
+  folly::ssl::X509UniquePtr getX509() const override {
+    return cert_->getX509();
+  }
+
+ private:
+  std::shared_ptr<fizz::SelfCert> cert_;
+  std::shared_ptr<HandshakeOffloadPool> pool_;
+};
+
+/**
+ * Gives ctx a certificate manager with the certificates of
+ * sslContextConfigs as OffloadedSelfCerts.  Leaves ctx as is if one of them
+ * can't be loaded, e.g. as its key needs a password.
+ */
+void offloadHandshakes(
+  fizz::server::FizzServerContext& ctx,
+  const std::vector<wangle::SSLContextConfig>& sslContextConfigs,
+  const std::shared_ptr<HandshakeOffloadPool>& pool);
+
+}
@@ -0,0 +1,174 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/services/LazyCertificateStore.h>
+
+#include <folly/String.h>
+#include <folly/ssl/OpenSSLCertUtils.h>
+#include <folly/ssl/OpenSSLPtrTypes.h>
+#include <glog/logging.h>
+#include <openssl/pem.h>
+#include <wangle/ssl/PasswordInFile.h>
+
+namespace proxygen {
+
+namespace {
+
+std::vector<std::string> readNames(const std::string& certPath) {
+  folly::ssl::BioUniquePtr bio(BIO_new_file(certPath.c_str(), "r"));
+  if (!bio) {
+    throw std::runtime_error("Can't open certificate " + certPath);
+  }
+  folly::ssl::X509UniquePtr x509(
+    PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr));
+  if (!x509) {
+    throw std::runtime_error("Can't read certificate " + certPath);
+  }
+  auto names = folly::ssl::OpenSSLCertUtils::getSubjectAltNames(*x509);
+  if (names.empty()) {
+    auto commonName = folly::ssl::OpenSSLCertUtils::getCommonName(*x509);
+    if (commonName) {
+      names.push_back(std::move(*commonName));
+    }
+  }
+  for (auto& name : names) {
+    folly::toLowerAscii(name);
+  }
+  return names;
+}
+
+}
+
+LazyCertificateStore::LazyCertificateStore(
+    std::vector<wangle::SSLContextConfig> configs,
+    const Options& options)
+    : configs_(std::move(configs)),
+      options_(options),
+      contexts_(std::max<size_t>(options.maxContexts, 1)) {
+  for (size_t i = 0; i < configs_.size(); i++) {
+    for (const auto& cert : configs_[i].certificates) {
+      for (auto& name : readNames(cert.certPath)) {
+        // Like the acceptors, the first certificate with a name serves it
+        names_.emplace(std::move(name), i);
+      }
+    }
+  }
+}
+
+folly::Optional<size_t> LazyCertificateStore::findCertificate(
+    folly::StringPiece serverName) const {
+  auto name = serverName.str();
+  folly::toLowerAscii(name);
+  auto it = names_.find(name);
+  if (it != names_.end()) {
+    return it->second;
+  }
+  auto dot = name.find('.');
+  if (dot == std::string::npos) {
+    return folly::none;
+  }
+  it = names_.find("*" + name.substr(dot));
+  if (it != names_.end()) {
+    return it->second;
+  }
+  return folly::none;
+}
+
+std::shared_ptr<folly::SSLContext> LazyCertificateStore::getContext(
+    folly::StringPiece serverName) {
+  auto index = findCertificate(serverName);
+  if (!index) {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = contexts_.find(*index);
+    if (it != contexts_.end()) {
+      return it->second;
+    }
+  }
+  // Built without the lock, the handshakes of the other names don't wait;
+  // the rare concurrent builds of the same context are harmless
+  std::shared_ptr<folly::SSLContext> ctx;
+  try {
+    ctx = buildContext(configs_[*index]);
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Can't build the SSL context for " << serverName << ": "
+               << ex.what();
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  contexts_.set(*index, ctx);
+  built_++;
+  return ctx;
+}
+
+std::shared_ptr<folly::SSLContext> LazyCertificateStore::buildContext(
+    const wangle::SSLContextConfig& config) {
+  auto ctx = std::make_shared<folly::SSLContext>(config.sslVersion);
+  for (const auto& cert : config.certificates) {
+    if (!cert.passwordPath.empty()) {
+      ctx->passwordCollector(
+        std::make_shared<wangle::PasswordInFile>(cert.passwordPath));
+    }
+    ctx->loadCertificate(cert.certPath.c_str());
+    ctx->loadPrivateKey(cert.keyPath.c_str());
+  }
+  ctx->setCiphersOrThrow(config.sslCiphers);
+  if (!config.nextProtocols.empty()) {
+    ctx->setRandomizedAdvertisedNextProtocols(config.nextProtocols);
+  }
+  return ctx;
+}
+
+size_t LazyCertificateStore::getNumContexts() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return contexts_.size();
+}
+
+uint64_t LazyCertificateStore::getNumBuilt() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return built_;
+}
+
+void LazyCertificateStore::attach(wangle::SSLContextManager* manager) {
+  attachment_->manager = manager;
+  attachment_->names.clear();
+}
+
+void LazyCertificateStore::detach(wangle::SSLContextManager* manager) {
+  if (attachment_->manager == manager) {
+    attachment_->manager = nullptr;
+    attachment_->names.clear();
+  }
+}
+
+bool LazyCertificateStore::onNoMatch(const char* serverName) {
+  auto& attachment = *attachment_;
+  if (!attachment.manager) {
+    return false;
+  }
+  auto ctx = getContext(serverName);
+  if (!ctx) {
+    return false;
+  }
+  // The manager keeps its own reference, released with the oldest names so
+  // that contexts evicted from the store are eventually freed
+  attachment.manager->insertSSLCtxByDomainName(
+    serverName, strlen(serverName), std::move(ctx));
+  attachment.names.emplace_back(serverName);
+  if (attachment.names.size() > options_.maxContexts) {
+    wangle::DNString oldest(attachment.names.front().c_str());
+    attachment.manager->removeSSLContextConfig(wangle::SSLContextKey(oldest));
+    attachment.names.pop_front();
+  }
+  return true;
+}
+
+}
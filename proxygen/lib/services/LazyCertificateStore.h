@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/ThreadLocal.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/io/async/SSLContext.h>
+#include <wangle/ssl/SSLContextConfig.h>
+#include <wangle/ssl/SSLContextManager.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Certificates for many SNI names whose SSLContexts are only built once a
+ * handshake asks for one of their names, for servers with more
+ * certificates than they can afford to load on startup, or to keep loaded.
+ *
+ * On construction, only the names of the certificates are read.  The
+ * contexts built are shared by all the acceptors of the store, and the
+ * least recently used are released past maxContexts.
+ *
+ * An acceptor falls back to the store for the SNI names its own
+ * sslContextConfigs don't have, see HTTPAcceptor; those still need the
+ * default certificate.
+ */
+class LazyCertificateStore {
+ public:
+  struct Options {
+    size_t maxContexts{1024};
+  };
+
+  // Throws if a certificate can't be read
+  LazyCertificateStore(std::vector<wangle::SSLContextConfig> configs,
+                       const Options& options);
+
+  /**
+   * The context serving serverName, built on first use, or nullptr if no
+   * certificate has the name or its context can't be built.
+   */
+  std::shared_ptr<folly::SSLContext> getContext(folly::StringPiece serverName);
+
+  size_t getNumCertificates() const {
+    return configs_.size();
+  }
+
+  // The contexts currently built
+  size_t getNumContexts() const;
+
+  uint64_t getNumBuilt() const;
+
+  /**
+   * Called on the acceptor's thread: lookups of the handshakes of the thread
+   * that find no certificate in manager add the store's to it.  The
+   * acceptor must detach before destroying manager.
+   */
+  void attach(wangle::SSLContextManager* manager);
+  void detach(wangle::SSLContextManager* manager);
+
+  /**
+   * For the SSLContextConfig::sniNoMatchFn of the acceptor: adds the context
+   * of serverName to the thread's manager, and returns whether it did.
+   */
+  bool onNoMatch(const char* serverName);
+
+ private:
+  // The index in configs_ of the certificate for serverName
+  folly::Optional<size_t> findCertificate(folly::StringPiece serverName) const;
+
+  static std::shared_ptr<folly::SSLContext> buildContext(
+    const wangle::SSLContextConfig& config);
+
+  struct Attachment {
+    wangle::SSLContextManager* manager{nullptr};
+    // The names added to manager, oldest first, at most maxContexts
+    std::deque<std::string> names;
+  };
+
+  const std::vector<wangle::SSLContextConfig> configs_;
+  const Options options_;
+  // Lower case names and wildcards ("*.example.com") to configs_ indexes
+  std::unordered_map<std::string, size_t> names_;
+
+  mutable std::mutex mutex_;
+  folly::EvictingCacheMap<size_t, std::shared_ptr<folly::SSLContext>>
+    contexts_;
+  uint64_t built_{0};
+
+  folly::ThreadLocal<Attachment> attachment_;
+};
+
+}
@@ -21,6 +21,7 @@ RequestWorkerThread::RequestWorkerThread(
   FinishCallback& callback, uint8_t threadId, const std::string& evbName)
     : WorkerThread(folly::EventBaseManager::get(), evbName),
       nextRequestId_(static_cast<uint64_t>(threadId) << requestIdBits),
+      workerQueue_(std::make_shared<WorkerQueue>()),
       callback_(callback) {
 }
 
@@ -42,6 +43,40 @@ void RequestWorkerThread::flushStats() {
   }
 }
 
+void RequestWorkerThread::offload(folly::Function<void()> work,
+                                  folly::Function<void()> done) {
+  if (!offloadExecutor_) {
+    work();
+    done();
+    return;
+  }
+  offloadExecutor_->add([this, work = std::move(work),
+                         done = std::move(done)] () mutable {
+      work();
+      runInWorkerThread(std::move(done));
+    });
+}
+
+void RequestWorkerThread::runInWorkerThread(folly::Function<void()> func) {
+  workerQueue_->funcs.enqueue(std::move(func));
+  // Only the first function queued since the last drain wakes up the event
+  // base
+  if (!workerQueue_->drainScheduled.exchange(true)) {
+    getEventBase()->runInEventBaseThread([queue = workerQueue_] {
+        queue->drain();
+      });
+  }
+}
+
+void RequestWorkerThread::WorkerQueue::drain() {
+  // Cleared first, the functions queued from now on schedule another drain
+  drainScheduled = false;
+  folly::Function<void()> func;
+  while (funcs.try_dequeue(func)) {
+    func();
+  }
+}
+
 void RequestWorkerThread::setup() {
   WorkerThread::setup();
   callback_.workerStarted(this);
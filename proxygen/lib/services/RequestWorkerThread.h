@@ -9,8 +9,13 @@
  */
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <folly/Executor.h>
+#include <folly/Function.h>
+#include <folly/concurrency/UnboundedQueue.h>
 #include <map>
+#include <memory>
 #include <proxygen/lib/services/WorkerThread.h>
 
 namespace proxygen {
@@ -84,7 +89,40 @@ class RequestWorkerThread : public WorkerThread {
    */
   void flushStats();
 
+  /**
+   * Set an executor shared by the workers to run the CPU heavy request work
+   * on, e.g. a folly::CPUThreadPoolExecutor, so a burst on one connection
+   * doesn't block the other connections of this worker.  The executor must
+   * be joined before the workers are destroyed.
+   */
+  void setOffloadExecutor(std::shared_ptr<folly::Executor> executor) {
+    offloadExecutor_ = std::move(executor);
+  }
+
+  /**
+   * Runs work on the offload executor, or right away without one, then
+   * done (e.g. sending the response) on this worker's thread.
+   */
+  void offload(folly::Function<void()> work, folly::Function<void()> done);
+
+  /**
+   * Runs func on this worker's thread, from any thread.  The functions
+   * queued while the worker is busy run in one batch, waking up its event
+   * base once instead of once per function like runInEventBaseThread().
+   */
+  void runInWorkerThread(folly::Function<void()> func);
+
  private:
+  // The functions queued by runInWorkerThread(), shared with the event base
+  // callbacks draining them
+  struct WorkerQueue {
+    folly::UMPSCQueue<folly::Function<void()>, false> funcs;
+    // Whether a drain is queued to the event base
+    std::atomic<bool> drainScheduled{false};
+
+    void drain();
+  };
+
   void setup() override;
   void cleanup() override;
 
@@ -95,6 +133,9 @@ class RequestWorkerThread : public WorkerThread {
   // The ServiceWorkers executing in this worker
   std::map<Service*, ServiceWorker*> serviceWorkers_;
 
+  std::shared_ptr<folly::Executor> offloadExecutor_;
+  std::shared_ptr<WorkerQueue> workerQueue_;
+
   FinishCallback& callback_;
 };
 
@@ -9,14 +9,118 @@
  */
 #include <proxygen/lib/services/WorkerThread.h>
 
+#include <algorithm>
 #include <folly/Portability.h>
 #include <folly/String.h>
+#include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <glog/logging.h>
 #include <signal.h>
 
 namespace proxygen {
 
+/**
+ * Records the loop metrics of a WorkerThread.  Only the worker thread
+ * writes them, with relaxed atomics other threads can read.
+ */
+class WorkerLoopObserver : public folly::EventBaseObserver,
+                           private folly::AsyncTimeout {
+ public:
+  WorkerLoopObserver(folly::EventBase* eventBase,
+                     std::chrono::milliseconds lagProbeInterval)
+      : folly::AsyncTimeout(eventBase,
+                            folly::TimeoutManager::InternalEnum::INTERNAL),
+        eventBase_(eventBase),
+        lagProbeInterval_(lagProbeInterval) {
+  }
+
+  uint32_t getSampleRate() const override {
+    return 1;
+  }
+
+  void loopSample(int64_t busyTime, int64_t idleTime) override {
+    increment(loops_, 1);
+    increment(busyTime_, busyTime);
+    increment(idleTime_, idleTime);
+    updateMax(maxLoopTime_, busyTime);
+  }
+
+  // The probe is internal, it doesn't keep the loop from stopping when idle
+  void startLagProbe() {
+    scheduleLagProbe();
+  }
+
+  void stopLagProbe() {
+    cancelTimeout();
+  }
+
+  WorkerThread::LoopStats getStats() {
+    WorkerThread::LoopStats stats;
+    stats.loops = loops_.load(std::memory_order_relaxed);
+    stats.busyTime = std::chrono::microseconds(
+      busyTime_.load(std::memory_order_relaxed));
+    stats.idleTime = std::chrono::microseconds(
+      idleTime_.load(std::memory_order_relaxed));
+    stats.maxLoopTime = std::chrono::microseconds(
+      maxLoopTime_.exchange(0, std::memory_order_relaxed));
+    stats.timeoutLag = std::chrono::microseconds(
+      timeoutLag_.load(std::memory_order_relaxed));
+    stats.maxTimeoutLag = std::chrono::microseconds(
+      maxTimeoutLag_.exchange(0, std::memory_order_relaxed));
+    stats.queuedCallbacks = queuedCallbacks_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  // Single writer, no need for a read-modify-write
+  static void increment(std::atomic<uint64_t>& counter, int64_t delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta,
+                  std::memory_order_relaxed);
+  }
+
+  // A reset by getStats() racing with it may be lost, the maximum is then
+  // reported twice
+  static void updateMax(std::atomic<uint64_t>& max, int64_t value) {
+    if (value > 0 && uint64_t(value) > max.load(std::memory_order_relaxed)) {
+      max.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  void scheduleLagProbe() {
+    lagProbeDeadline_ = std::chrono::steady_clock::now() + lagProbeInterval_;
+    scheduleTimeout(lagProbeInterval_);
+  }
+
+  void timeoutExpired() noexcept override {
+    auto lag = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - lagProbeDeadline_).count();
+    lag = std::max<int64_t>(0, lag);
+    timeoutLag_.store(lag, std::memory_order_relaxed);
+    updateMax(maxTimeoutLag_, lag);
+    queuedCallbacks_.store(eventBase_->getNotificationQueueSize(),
+                           std::memory_order_relaxed);
+    scheduleLagProbe();
+  }
+
+  folly::EventBase* eventBase_;
+  const std::chrono::milliseconds lagProbeInterval_;
+  std::chrono::steady_clock::time_point lagProbeDeadline_;
+
+  std::atomic<uint64_t> loops_{0};
+  std::atomic<uint64_t> busyTime_{0};
+  std::atomic<uint64_t> idleTime_{0};
+  std::atomic<uint64_t> maxLoopTime_{0};
+  std::atomic<uint64_t> timeoutLag_{0};
+  std::atomic<uint64_t> maxTimeoutLag_{0};
+  std::atomic<uint64_t> queuedCallbacks_{0};
+};
+
+double WorkerThread::LoopStats::getUtilization(const LoopStats& since) const {
+  auto busy = (busyTime - since.busyTime).count();
+  auto total = busy + (idleTime - since.idleTime).count();
+  return total > 0 ? double(busy) / total : 0;
+}
+
 FOLLY_TLS WorkerThread* WorkerThread::currentWorker_ = nullptr;
 
 WorkerThread::WorkerThread(
@@ -34,6 +138,18 @@ WorkerThread::~WorkerThread() {
   CHECK(state_ == State::IDLE);
 }
 
+void WorkerThread::enableLoopStats(
+    std::chrono::milliseconds lagProbeInterval) {
+  CHECK(state_ == State::IDLE);
+  loopObserver_ = std::make_shared<WorkerLoopObserver>(&eventBase_,
+                                                       lagProbeInterval);
+  eventBase_.setObserver(loopObserver_);
+}
+
+WorkerThread::LoopStats WorkerThread::getLoopStats() {
+  return loopObserver_ ? loopObserver_->getStats() : LoopStats();
+}
+
 void WorkerThread::start() {
   CHECK(state_ == State::IDLE);
   state_ = State::STARTING;
@@ -138,6 +254,10 @@ void WorkerThread::runLoop() {
 
   VLOG(1) << "WorkerThread " << this << " starting";
 
+  if (loopObserver_) {
+    loopObserver_->startLagProbe();
+  }
+
   // Call loopForever().  This will only return after stopWhenIdle() or
   // forceStop() has been called.
   eventBase_.loopForever();
@@ -151,6 +271,9 @@ void WorkerThread::runLoop() {
   }
 
   CHECK(state_ == State::STOP_WHEN_IDLE || state_ == State::FORCE_STOP);
+  if (loopObserver_) {
+    loopObserver_->stopLagProbe();
+  }
   state_ = State::IDLE;
 
   VLOG(1) << "WorkerThread " << this << " terminated";
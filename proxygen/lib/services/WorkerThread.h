@@ -10,9 +10,11 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <folly/Portability.h>
 #include <folly/io/async/EventBase.h>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -22,6 +24,8 @@ class EventBaseManager;
 
 namespace proxygen {
 
+class WorkerLoopObserver;
+
 /**
  * A WorkerThread represents an independent event loop that runs in its own
  * thread.
@@ -32,6 +36,44 @@ class WorkerThread {
     folly::EventBaseManager* ebm, const std::string& evbName = std::string());
   virtual ~WorkerThread();
 
+  /**
+   * Event loop metrics of a worker, see getLoopStats().
+   */
+  struct LoopStats {
+    // The loops run, and their busy and idle (waiting for events) times
+    uint64_t loops{0};
+    std::chrono::microseconds busyTime{0};
+    std::chrono::microseconds idleTime{0};
+    // The busy time of the longest loop
+    std::chrono::microseconds maxLoopTime{0};
+    // How late the lag probe timeout fired, the last time and at most
+    std::chrono::microseconds timeoutLag{0};
+    std::chrono::microseconds maxTimeoutLag{0};
+    // The callbacks queued to the event base from other threads, e.g. with
+    // runInEventBaseThread(), when the lag probe fired
+    uint64_t queuedCallbacks{0};
+
+    /**
+     * The ratio (0-1.0) of busy time, over the loops since another
+     * LoopStats when given.
+     */
+    double getUtilization(const LoopStats& since = LoopStats()) const;
+  };
+
+  /**
+   * Record the metrics returned by getLoopStats(), with a lag probe timeout
+   * every lagProbeInterval.  Must be called before start().
+   */
+  void enableLoopStats(std::chrono::milliseconds lagProbeInterval =
+                         std::chrono::milliseconds(100));
+
+  /**
+   * The loop metrics, from any thread.  The totals keep growing, the
+   * maximums are those since the previous call.  All zeros unless
+   * enableLoopStats() was called.
+   */
+  LoopStats getLoopStats();
+
   /**
    * Begin execution of the worker.
    *
@@ -137,6 +179,9 @@ class WorkerThread {
   folly::EventBase eventBase_;
   folly::EventBaseManager* eventBaseManager_{nullptr};
 
+  // Only set with enableLoopStats(), updated by the worker thread alone
+  std::shared_ptr<WorkerLoopObserver> loopObserver_;
+
   // A thread-local pointer to the current WorkerThread for this thread
   static FOLLY_TLS WorkerThread* currentWorker_;
 };
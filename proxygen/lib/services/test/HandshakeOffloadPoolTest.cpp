@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/services/HandshakeOffloadPool.h>
+#include <folly/synchronization/Baton.h>
+#include <folly/portability/GTest.h>
+#include <thread>
+
+using namespace proxygen;
+
+TEST(HandshakeOffloadPoolTest, RunsOffThread) {
+  HandshakeOffloadPool pool(HandshakeOffloadPool::Options{});
+  auto caller = std::this_thread::get_id();
+  auto result = pool.tryRun([caller] {
+      return std::this_thread::get_id() != caller;
+    });
+  ASSERT_TRUE(result.hasValue());
+  EXPECT_TRUE(std::move(*result).get());
+  EXPECT_EQ(pool.getNumCompleted(), 1);
+  EXPECT_EQ(pool.getQueueDepth(), 0);
+}
+
+TEST(HandshakeOffloadPoolTest, AdmissionByQueueDepth) {
+  HandshakeOffloadPool::Options options;
+  options.numThreads = 1;
+  options.maxQueueDepth = 2;
+  HandshakeOffloadPool pool(options);
+
+  folly::Baton<> unblock;
+  auto running = pool.tryRun([&] {
+      unblock.wait();
+      return 1;
+    });
+  auto queued = pool.tryRun([] { return 2; });
+  ASSERT_TRUE(running.hasValue());
+  ASSERT_TRUE(queued.hasValue());
+  EXPECT_EQ(pool.getQueueDepth(), 2);
+
+  // Full: refused without queueing
+  EXPECT_FALSE(pool.tryRun([] { return 3; }).hasValue());
+  EXPECT_EQ(pool.getNumRejected(), 1);
+  EXPECT_EQ(pool.getQueueDepth(), 2);
+
+  unblock.post();
+  EXPECT_EQ(std::move(*running).get(), 1);
+  EXPECT_EQ(std::move(*queued).get(), 2);
+
+  // Admits again once drained
+  auto after = pool.tryRun([] { return 4; });
+  ASSERT_TRUE(after.hasValue());
+  EXPECT_EQ(std::move(*after).get(), 4);
+  EXPECT_EQ(pool.getNumCompleted(), 3);
+  EXPECT_EQ(pool.getNumRejected(), 1);
+}
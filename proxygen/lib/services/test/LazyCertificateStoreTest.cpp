@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/services/LazyCertificateStore.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/TestUtils.h>
+
+using namespace proxygen;
+
+namespace {
+
+const std::string kTestDir = getContainingDirectory(__FILE__).str();
+
+std::vector<wangle::SSLContextConfig> makeConfigs() {
+  std::vector<wangle::SSLContextConfig> configs(2);
+  // a.example.com and *.b.example.com
+  configs[0].setCertificate(kTestDir + "certs/sni_cert1.pem",
+                            kTestDir + "certs/sni_key1.pem", "");
+  // c.example.com, from its common name
+  configs[1].setCertificate(kTestDir + "certs/sni_cert2.pem",
+                            kTestDir + "certs/sni_key2.pem", "");
+  return configs;
+}
+
+}
+
+TEST(LazyCertificateStoreTest, BuildsOnFirstUse) {
+  LazyCertificateStore store(makeConfigs(), LazyCertificateStore::Options{});
+  EXPECT_EQ(store.getNumCertificates(), 2);
+  EXPECT_EQ(store.getNumContexts(), 0);
+
+  auto ctx = store.getContext("A.example.com");
+  ASSERT_NE(ctx, nullptr);
+  EXPECT_EQ(store.getNumBuilt(), 1);
+  // Same certificate, no new context
+  EXPECT_EQ(store.getContext("x.b.example.com"), ctx);
+  EXPECT_EQ(store.getNumBuilt(), 1);
+
+  EXPECT_NE(store.getContext("c.example.com"), nullptr);
+  EXPECT_EQ(store.getNumContexts(), 2);
+
+  EXPECT_EQ(store.getContext("b.example.com"), nullptr);
+  EXPECT_EQ(store.getContext("y.x.b.example.com"), nullptr);
+  EXPECT_EQ(store.getContext("unknown"), nullptr);
+  EXPECT_EQ(store.getNumBuilt(), 2);
+}
+
+TEST(LazyCertificateStoreTest, EvictsLeastRecentlyUsed) {
+  LazyCertificateStore::Options options;
+  options.maxContexts = 1;
+  LazyCertificateStore store(makeConfigs(), options);
+
+  auto a = store.getContext("a.example.com");
+  auto c = store.getContext("c.example.com");
+  EXPECT_EQ(store.getNumContexts(), 1);
+  // c is kept, a built again
+  EXPECT_EQ(store.getContext("c.example.com"), c);
+  EXPECT_NE(store.getContext("a.example.com"), a);
+  EXPECT_EQ(store.getNumBuilt(), 3);
+}
+
+TEST(LazyCertificateStoreTest, MissingCertificate) {
+  std::vector<wangle::SSLContextConfig> configs(1);
+  configs[0].setCertificate(kTestDir + "certs/missing.pem",
+                            kTestDir + "certs/missing.pem", "");
+  EXPECT_THROW(LazyCertificateStore(configs, LazyCertificateStore::Options{}),
+               std::runtime_error);
+}
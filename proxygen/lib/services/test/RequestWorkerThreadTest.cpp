@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/services/RequestWorkerThread.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/synchronization/Baton.h>
+#include <folly/portability/GTest.h>
+#include <thread>
+
+using namespace proxygen;
+
+namespace {
+
+class TestFinishCallback : public RequestWorkerThread::FinishCallback {
+ public:
+  void workerStarted(RequestWorkerThread*) override {}
+  void workerFinished(RequestWorkerThread*) override {}
+};
+
+}
+
+TEST(RequestWorkerThreadTest, OffloadInline) {
+  TestFinishCallback callback;
+  RequestWorkerThread worker(callback, 0);
+  bool worked = false;
+  bool done = false;
+  worker.offload([&] { worked = true; }, [&] { done = worked; });
+  EXPECT_TRUE(done);
+}
+
+TEST(RequestWorkerThreadTest, OffloadToExecutor) {
+  TestFinishCallback callback;
+  RequestWorkerThread worker(callback, 0);
+  auto executor = std::make_shared<folly::CPUThreadPoolExecutor>(2);
+  worker.setOffloadExecutor(executor);
+  worker.start();
+
+  const int kRequests = 100;
+  std::atomic<int> worked{0};
+  int done = 0;
+  folly::Baton<> allDone;
+  worker.getEventBase()->runInEventBaseThread([&] {
+      for (int i = 0; i < kRequests; i++) {
+        worker.offload(
+          [&] {
+            EXPECT_FALSE(worker.getEventBase()->isInEventBaseThread());
+            worked++;
+          },
+          [&] {
+            // Back on the worker, which owns done
+            EXPECT_TRUE(worker.getEventBase()->isInEventBaseThread());
+            if (++done == kRequests) {
+              allDone.post();
+            }
+          });
+      }
+    });
+  allDone.wait();
+  EXPECT_EQ(worked, kRequests);
+
+  executor->join();
+  worker.forceStop();
+  worker.wait();
+}
+
+TEST(RequestWorkerThreadTest, LoopStats) {
+  TestFinishCallback callback;
+  RequestWorkerThread worker(callback, 0);
+  worker.enableLoopStats(std::chrono::milliseconds(10));
+  worker.start();
+
+  folly::Baton<> busy;
+  worker.getEventBase()->runInEventBaseThread([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      busy.post();
+    });
+  busy.wait();
+  // Let the lag probe fire after the busy loop
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  auto stats = worker.getLoopStats();
+  EXPECT_GT(stats.loops, 0);
+  EXPECT_GE(stats.maxLoopTime, std::chrono::milliseconds(50));
+  EXPECT_GE(stats.busyTime, std::chrono::milliseconds(50));
+  EXPECT_GT(stats.maxTimeoutLag, std::chrono::milliseconds(0));
+  EXPECT_GT(stats.getUtilization(), 0);
+  // The maximums are reset by each call
+  EXPECT_LT(worker.getLoopStats().maxLoopTime, std::chrono::milliseconds(50));
+
+  worker.stopWhenIdle();
+  worker.wait();
+}
@@ -0,0 +1,163 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/statistics/CgroupResources.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <thread>
+#include <unistd.h>
+
+namespace proxygen {
+
+namespace {
+// The cgroup files read are all much shorter
+const size_t kReadBufSize = 1024;
+
+int openCgroupFile(const std::string& cgroupPath, const char* name) {
+  auto path = cgroupPath + "/" + name;
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    VLOG(2) << "Can't open " << path << ": " << strerror(errno);
+  }
+  return fd;
+}
+
+// Reads the whole file into buf as a C string, cgroup files must be read
+// from offset 0 to be regenerated
+bool readCgroupFile(int fd, char (&buf)[kReadBufSize]) {
+  if (fd < 0) {
+    return false;
+  }
+  auto n = ::pread(fd, buf, kReadBufSize - 1, 0);
+  if (n <= 0) {
+    return false;
+  }
+  buf[n] = '\0';
+  return true;
+}
+
+// Parses the number following key in buf, e.g. "usage_usec " in cpu.stat
+bool parseKey(const char* buf, const char* key, uint64_t& value) {
+  auto pos = strstr(buf, key);
+  if (!pos) {
+    return false;
+  }
+  value = strtoull(pos + strlen(key), nullptr, 10);
+  return true;
+}
+
+// Parses the limit files holding either a number or "max", false for "max"
+bool parseLimit(const char* buf, uint64_t& value) {
+  if (strncmp(buf, "max", 3) == 0) {
+    return false;
+  }
+  char* end = nullptr;
+  value = strtoull(buf, &end, 10);
+  return end != buf;
+}
+}
+
+std::unique_ptr<CgroupResources> CgroupResources::make(
+    const std::string& cgroupPath) {
+  std::unique_ptr<CgroupResources> resources(
+    new CgroupResources(cgroupPath));
+  if (resources->cpuStatFd_ < 0 || resources->memCurrentFd_ < 0) {
+    return nullptr;
+  }
+  return resources;
+}
+
+CgroupResources::CgroupResources(const std::string& cgroupPath)
+    : cpuStatFd_(openCgroupFile(cgroupPath, "cpu.stat")),
+      cpuMaxFd_(openCgroupFile(cgroupPath, "cpu.max")),
+      memCurrentFd_(openCgroupFile(cgroupPath, "memory.current")),
+      memMaxFd_(openCgroupFile(cgroupPath, "memory.max")),
+      memPressureFd_(openCgroupFile(cgroupPath, "memory.pressure")),
+      hostCpus_(std::max(1u, std::thread::hardware_concurrency())),
+      hostMemBytes_(uint64_t(sysconf(_SC_PHYS_PAGES)) *
+                    sysconf(_SC_PAGESIZE)) {
+}
+
+CgroupResources::~CgroupResources() {
+  for (auto fd : {cpuStatFd_, cpuMaxFd_, memCurrentFd_, memMaxFd_,
+                  memPressureFd_}) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+}
+
+double CgroupResources::getCpuLimit() {
+  // "$QUOTA $PERIOD", $QUOTA being "max" without limit
+  char buf[kReadBufSize];
+  if (!readCgroupFile(cpuMaxFd_, buf)) {
+    return hostCpus_;
+  }
+  char* end = nullptr;
+  auto quota = strtoull(buf, &end, 10);
+  auto period = strtoull(end, nullptr, 10);
+  if (end == buf || quota == 0 || period == 0) {
+    return hostCpus_;
+  }
+  return std::min(hostCpus_, double(quota) / period);
+}
+
+ResourceData CgroupResources::getCurrentData() {
+  ResourceData data;
+  char buf[kReadBufSize];
+
+  auto now = std::chrono::steady_clock::now();
+  uint64_t usageUsec = 0;
+  if (readCgroupFile(cpuStatFd_, buf) &&
+      parseKey(buf, "usage_usec ", usageUsec)) {
+    auto elapsedUsec = std::chrono::duration_cast<std::chrono::microseconds>(
+      now - lastSampleTime_).count();
+    // The first sample only sets the base of the next one
+    if (lastUsageUsec_ != 0 && elapsedUsec > 0 &&
+        usageUsec >= lastUsageUsec_) {
+      lastCpuRatioUtil_ = std::min(
+        1.0, (usageUsec - lastUsageUsec_) / (elapsedUsec * getCpuLimit()));
+    }
+    lastUsageUsec_ = usageUsec;
+    lastSampleTime_ = now;
+  }
+  // Softirqs are not accounted per cgroup, the per core utilizations only
+  // tell the number of CPUs
+  data.setCpuStats(lastCpuRatioUtil_, 0,
+                   std::vector<double>(size_t(hostCpus_), 0));
+
+  uint64_t usedMemBytes = 0;
+  if (readCgroupFile(memCurrentFd_, buf)) {
+    usedMemBytes = strtoull(buf, nullptr, 10);
+  }
+  uint64_t totalMemBytes = hostMemBytes_;
+  uint64_t memMax = 0;
+  if (readCgroupFile(memMaxFd_, buf) && parseLimit(buf, memMax) &&
+      memMax > 0) {
+    totalMemBytes = std::min(totalMemBytes, memMax);
+  }
+  data.setMemStats(usedMemBytes, totalMemBytes);
+
+  // "some avg10=$PCT avg60=$PCT avg300=$PCT total=$USEC"
+  if (readCgroupFile(memPressureFd_, buf)) {
+    auto pos = strstr(buf, "some avg10=");
+    if (pos) {
+      data.setMemPressureStats(strtod(pos + strlen("some avg10="), nullptr) /
+                               100);
+    }
+  }
+  return data;
+}
+
+}
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include "proxygen/lib/statistics/ResourceData.h"
+
+namespace proxygen {
+
+/**
+ * Resources reading the utilization of a cgroup v2 instead of the host's, so
+ * a containerized server sees its own limits.
+ *
+ * The cgroup files are opened once and read with pread() into a stack
+ * buffer, a refresh costs a few syscalls and no parsing of /proc, cheap
+ * enough to refresh ResourceStats every few ms:
+ *  - CPU from the usage_usec of cpu.stat, relative to the quota of cpu.max
+ *    or else to the CPUs available.
+ *  - Memory from memory.current, relative to memory.max or else to the
+ *    physical memory.
+ *  - Memory pressure from the "some avg10" of memory.pressure (PSI).
+ *
+ * The TCP and UDP memory stats are not accounted per cgroup and not set.
+ * Only ResourceStats' refresh thread may call getCurrentData().
+ */
+class CgroupResources : public Resources {
+ public:
+  /**
+   * Returns nullptr if cgroupPath is not a cgroup v2 exposing cpu.stat and
+   * memory.current, e.g. with cgroup v1 or no cgroup controllers.
+   */
+  static std::unique_ptr<CgroupResources> make(
+    const std::string& cgroupPath = "/sys/fs/cgroup");
+
+  ~CgroupResources() override;
+
+  ResourceData getCurrentData() override;
+
+ private:
+  explicit CgroupResources(const std::string& cgroupPath);
+
+  // The cgroup's CPU limit in CPUs, from cpu.max
+  double getCpuLimit();
+
+  int cpuStatFd_{-1};
+  int cpuMaxFd_{-1};
+  int memCurrentFd_{-1};
+  int memMaxFd_{-1};
+  int memPressureFd_{-1};
+
+  const double hostCpus_;
+  const uint64_t hostMemBytes_;
+
+  // The previous cpu.stat sample, to compute the utilization over intervals
+  uint64_t lastUsageUsec_{0};
+  std::chrono::steady_clock::time_point lastSampleTime_;
+  double lastCpuRatioUtil_{0};
+};
+
+}
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/statistics/ResourceAdmissionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace proxygen {
+
+namespace {
+// How far used is between the soft and hard limits, with no data (NaN)
+// counting as no load
+double getResourceLoad(double used, double soft, double hard) {
+  if (hard <= 0 || !(used >= soft)) {
+    return 0;
+  }
+  if (used >= hard || soft >= hard) {
+    return 1.0;
+  }
+  return (used - soft) / (hard - soft);
+}
+}
+
+ResourceAdmissionController::ResourceAdmissionController(
+  const ResourceStats& stats,
+  const Thresholds& thresholds)
+    : stats_(stats),
+      thresholds_(thresholds) {
+}
+
+double ResourceAdmissionController::getLoad() const {
+  const auto& data = stats_.getCurrentLoadData();
+  return std::max({
+      getResourceLoad(data.getCpuRatioUtil(), thresholds_.softCpuRatio,
+                      thresholds_.hardCpuRatio),
+      getResourceLoad(data.getUsedMemRatio(), thresholds_.softMemRatio,
+                      thresholds_.hardMemRatio),
+      getResourceLoad(data.getMemPressureRatio(),
+                      thresholds_.softMemPressureRatio,
+                      thresholds_.hardMemPressureRatio),
+      getResourceLoad(data.getTcpMemRatio(), thresholds_.softTcpMemRatio,
+                      thresholds_.hardTcpMemRatio)});
+}
+
+bool ResourceAdmissionController::admitConnection() {
+  return getLoad() < 1.0;
+}
+
+uint32_t ResourceAdmissionController::getMaxConcurrentIncomingStreams(
+    uint32_t configured) {
+  auto ratio = 1.0 - getLoad() * (1.0 - thresholds_.minStreamsRatio);
+  return std::max<uint32_t>(1, std::lround(configured * ratio));
+}
+
+bool ResourceAdmissionController::admitRequest() {
+  return getLoad() < 1.0;
+}
+
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "proxygen/lib/http/session/HTTPAdmissionController.h"
+#include "proxygen/lib/statistics/ResourceStats.h"
+
+namespace proxygen {
+
+/**
+ * HTTPAdmissionController shedding load based on the CPU and memory
+ * utilization sampled by a ResourceStats.  It only reads the data cached by
+ * ResourceStats::getCurrentLoadData(), the ResourceStats must be refreshing
+ * for it to see any load.
+ *
+ * Between the soft and hard limits, the advertised stream limit decreases
+ * linearly down to minStreamsRatio of the configured one.  Past any hard
+ * limit, new connections and requests are rejected.
+ */
+class ResourceAdmissionController : public HTTPAdmissionController {
+ public:
+  /**
+   * The utilization ratios (0-1.0) of ResourceData at which to shed load,
+   * a hard limit of 0 disables checking the resource.
+   */
+  struct Thresholds {
+    double softCpuRatio{0.8};
+    double hardCpuRatio{0.95};
+    double softMemRatio{0.85};
+    double hardMemRatio{0.95};
+    // Memory stall ratios, only collected by some Resources
+    double softMemPressureRatio{0};
+    double hardMemPressureRatio{0};
+    // Ratios to the maximum TCP memory limit
+    double softTcpMemRatio{0.7};
+    double hardTcpMemRatio{0.9};
+    double minStreamsRatio{0.1};
+    // Whether sessions rejecting a request start draining
+    bool drainOnReject{true};
+  };
+
+  ResourceAdmissionController(const ResourceStats& stats,
+                              const Thresholds& thresholds);
+
+  bool admitConnection() override;
+
+  uint32_t getMaxConcurrentIncomingStreams(uint32_t configured) override;
+
+  bool admitRequest() override;
+
+  bool shouldDrainOnReject() override {
+    return thresholds_.drainOnReject;
+  }
+
+  /**
+   * How far the most loaded resource is between its soft (0) and hard (1.0)
+   * limits, clamped to [0, 1.0].
+   */
+  double getLoad() const;
+
+ private:
+  const ResourceStats& stats_;
+  const Thresholds thresholds_;
+};
+
+}
@@ -0,0 +1,72 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/statistics/ResourceCompressionLevelSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace proxygen {
+
+constexpr int32_t ResourceCompressionLevelSelector::kMinCountedLevel;
+constexpr int32_t ResourceCompressionLevelSelector::kMaxCountedLevel;
+
+ResourceCompressionLevelSelector::ResourceCompressionLevelSelector(
+  const ResourceStats& stats,
+  const Options& options)
+    : stats_(stats),
+      options_(options) {
+  for (auto& counts : levelCounts_) {
+    for (auto& count : counts) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+int32_t ResourceCompressionLevelSelector::getLevel(CompressionType type,
+                                                   int32_t configured,
+                                                   size_t size) {
+  int32_t level = configured;
+  auto levels = options_.levels.find(type);
+  if (levels != options_.levels.end()) {
+    // How far the CPU is between the soft and hard limits, with no data
+    // (NaN) counting as idle
+    double cpu = stats_.getCurrentLoadData().getCpuRatioUtil();
+    double load = 0;
+    if (cpu >= options_.hardCpuRatio) {
+      load = 1.0;
+    } else if (cpu > options_.softCpuRatio) {
+      load = (cpu - options_.softCpuRatio) /
+        (options_.hardCpuRatio - options_.softCpuRatio);
+    }
+    if (size > 0 && size < options_.smallBodySize && load < 1.0) {
+      load = 0;
+    }
+    const auto& bounds = levels->second;
+    level = bounds.maxLevel -
+      std::lround(load * (bounds.maxLevel - bounds.minLevel));
+  }
+
+  auto index = std::min(std::max(level, kMinCountedLevel), kMaxCountedLevel) -
+    kMinCountedLevel;
+  levelCounts_[static_cast<size_t>(type)][index].fetch_add(
+    1, std::memory_order_relaxed);
+  return level;
+}
+
+std::vector<uint64_t> ResourceCompressionLevelSelector::getLevelCounts(
+    CompressionType type) const {
+  std::vector<uint64_t> counts;
+  for (const auto& count : levelCounts_[static_cast<size_t>(type)]) {
+    counts.push_back(count.load(std::memory_order_relaxed));
+  }
+  return counts;
+}
+
+}
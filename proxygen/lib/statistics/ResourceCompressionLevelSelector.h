@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "proxygen/lib/statistics/ResourceStats.h"
+#include "proxygen/lib/utils/CompressionLevelSelector.h"
+
+namespace proxygen {
+
+/**
+ * CompressionLevelSelector trading compression ratio for CPU as the CPU
+ * utilization sampled by a ResourceStats rises.  Like
+ * ResourceAdmissionController, it only reads the data cached by
+ * ResourceStats::getCurrentLoadData(), the ResourceStats must be refreshing.
+ *
+ * Under softCpuRatio responses get the maximum level of their type, and the
+ * level decreases linearly to the minimum at hardCpuRatio.  Bodies under
+ * smallBodySize are cheap to compress whatever the level, they keep the
+ * maximum level until hardCpuRatio.  Types without levels configured keep
+ * their configured level.
+ */
+class ResourceCompressionLevelSelector : public CompressionLevelSelector {
+ public:
+  struct Levels {
+    int32_t minLevel;
+    int32_t maxLevel;
+  };
+
+  struct Options {
+    double softCpuRatio{0.5};
+    double hardCpuRatio{0.9};
+    size_t smallBodySize{16 * 1024};
+    std::map<CompressionType, Levels> levels;
+  };
+
+  // The levels counted apart, the ones outside count as the closest
+  static constexpr int32_t kMinCountedLevel = -1;
+  static constexpr int32_t kMaxCountedLevel = 22;
+
+  ResourceCompressionLevelSelector(const ResourceStats& stats,
+                                   const Options& options);
+
+  int32_t getLevel(CompressionType type,
+                   int32_t configured,
+                   size_t size) override;
+
+  /**
+   * The number of responses compressed with each level of type so far,
+   * indexed by level - kMinCountedLevel, to export as a histogram.
+   */
+  std::vector<uint64_t> getLevelCounts(CompressionType type) const;
+
+ private:
+  static constexpr size_t kNumCountedLevels =
+    kMaxCountedLevel - kMinCountedLevel + 1;
+  static constexpr size_t kNumTypes =
+    static_cast<size_t>(CompressionType::RAW_DEFLATE) + 1;
+
+  const ResourceStats& stats_;
+  const Options options_;
+  std::array<std::array<std::atomic<uint64_t>, kNumCountedLevels>, kNumTypes>
+    levelCounts_;
+};
+
+}
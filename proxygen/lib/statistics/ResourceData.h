@@ -109,6 +109,14 @@ struct ResourceData {
     return ((double)usedMemBytes_) / totalMemBytes_;
   }
 
+  /**
+   * Gets the share of time (0-1.0) some tasks stalled on memory over the
+   * last 10s, from the pressure stall information (PSI) if collected.
+   */
+  double getMemPressureRatio() const {
+    return memPressureRatio_;
+  }
+
   // Returns current level of TCP memory consumption
   // measured in memory pages
   uint64_t getTcpMemPages() const {
@@ -258,6 +266,10 @@ struct ResourceData {
     totalMemBytes_ = totalMemBytes;
   }
 
+  void setMemPressureStats(double memPressureRatio) {
+    memPressureRatio_ = memPressureRatio;
+  }
+
   /**
    * Sets the structure fields describing TCP memory state.
    */
@@ -324,6 +336,7 @@ struct ResourceData {
   std::vector<double> softIrqCpuCoreRatioUtils_;
   uint64_t usedMemBytes_{0};
   uint64_t totalMemBytes_{0};
+  double memPressureRatio_{0};
   uint64_t tcpMemoryPages_{0};
   uint64_t maxTcpMemLimit_{0};
   uint64_t pressureTcpMemLimit_{0};
@@ -0,0 +1,188 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/transport/AppendOnlyFilePersistence.h>
+
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/json.h>
+#include <folly/system/MemoryMapping.h>
+
+#include <fcntl.h>
+#include <unordered_set>
+#include <vector>
+
+namespace proxygen {
+
+const size_t AppendOnlyFilePersistence::kDefaultCompactionFactor;
+
+AppendOnlyFilePersistence::AppendOnlyFilePersistence(std::string file,
+                                                     size_t compactionFactor)
+    : file_(std::move(file)), compactionFactor_(compactionFactor) {
+}
+
+bool AppendOnlyFilePersistence::persist(
+    const folly::dynamic& arrayOfKvPairs) noexcept {
+  std::lock_guard<std::mutex> g(mutex_);
+  try {
+    std::string records;
+    std::vector<std::pair<std::string, const folly::dynamic*>> changed;
+    std::vector<std::string> removed;
+    std::unordered_set<std::string> live;
+    for (const auto& kv : arrayOfKvPairs) {
+      auto key = folly::toJson(kv[0]);
+      auto it = persisted_.find(key);
+      if (it == persisted_.end() || it->second != kv[1]) {
+        records += folly::toJson(kv);
+        records += '\n';
+        changed.emplace_back(key, &kv[1]);
+      }
+      live.insert(std::move(key));
+    }
+    for (const auto& entry : persisted_) {
+      if (live.find(entry.first) == live.end()) {
+        records += '[';
+        records += entry.first;
+        records += "]\n";
+        removed.push_back(entry.first);
+      }
+    }
+    auto numRecords = changed.size() + removed.size();
+    if (numRecords == 0) {
+      return true;
+    }
+
+    auto limit = compactionFactor_ * std::max<size_t>(1, live.size());
+    if (numRecords_ + numRecords > limit) {
+      return compact(arrayOfKvPairs);
+    }
+    if (!append(records)) {
+      return false;
+    }
+    numRecords_ += numRecords;
+    for (auto& entry : changed) {
+      persisted_[std::move(entry.first)] = *entry.second;
+    }
+    for (const auto& key : removed) {
+      persisted_.erase(key);
+    }
+    return true;
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to persist to " << file_ << ": " << ex.what();
+    return false;
+  }
+}
+
+bool AppendOnlyFilePersistence::append(const std::string& records) noexcept {
+  try {
+    folly::File file(file_, O_WRONLY | O_APPEND | O_CREAT);
+    if (folly::writeFull(file.fd(), records.data(), records.size()) !=
+        ssize_t(records.size())) {
+      PLOG(ERROR) << "Failed to append to " << file_;
+      return false;
+    }
+    return true;
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to open " << file_ << ": " << ex.what();
+    return false;
+  }
+}
+
+bool AppendOnlyFilePersistence::compact(
+    const folly::dynamic& arrayOfKvPairs) noexcept {
+  try {
+    std::string records;
+    std::unordered_map<std::string, folly::dynamic> persisted;
+    for (const auto& kv : arrayOfKvPairs) {
+      records += folly::toJson(kv);
+      records += '\n';
+      persisted.emplace(folly::toJson(kv[0]), kv[1]);
+    }
+    folly::writeFileAtomic(file_, records);
+    VLOG(4) << "Compacted " << file_ << " from " << numRecords_ << " to "
+            << arrayOfKvPairs.size() << " records";
+    persisted_ = std::move(persisted);
+    numRecords_ = arrayOfKvPairs.size();
+    return true;
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to compact " << file_ << ": " << ex.what();
+    return false;
+  }
+}
+
+folly::Optional<folly::dynamic> AppendOnlyFilePersistence::load() noexcept {
+  std::lock_guard<std::mutex> g(mutex_);
+  persisted_.clear();
+  numRecords_ = 0;
+  try {
+    folly::MemoryMapping mapping(file_.c_str());
+    folly::StringPiece data(mapping.range());
+    // Keys in the order of their puts
+    std::vector<std::string> order;
+    while (!data.empty()) {
+      auto line = data.split_step('\n');
+      if (line.empty()) {
+        continue;
+      }
+      folly::dynamic record;
+      try {
+        record = folly::parseJson(line);
+      } catch (const std::exception& ex) {
+        LOG(ERROR) << "Skipping bad record in " << file_ << ": " << ex.what();
+        continue;
+      }
+      if (!record.isArray() || record.empty() || record.size() > 2) {
+        continue;
+      }
+      numRecords_++;
+      auto key = folly::toJson(record[0]);
+      if (record.size() == 1) {
+        persisted_.erase(key);
+      } else {
+        persisted_[key] = std::move(record[1]);
+        order.push_back(std::move(key));
+      }
+    }
+
+    // The live keys by their last put, most recent first
+    std::vector<const std::string*> latest;
+    std::unordered_set<std::string> seen;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+      if (persisted_.count(*it) && seen.insert(*it).second) {
+        latest.push_back(&*it);
+      }
+    }
+    // Least recent first, as they are set into the cache in order
+    folly::dynamic kvPairs = folly::dynamic::array;
+    for (auto it = latest.rbegin(); it != latest.rend(); ++it) {
+      kvPairs.push_back(
+          folly::dynamic::array(folly::parseJson(**it), persisted_[**it]));
+    }
+    return std::move(kvPairs);
+  } catch (const std::exception& ex) {
+    VLOG(4) << "Nothing loaded from " << file_ << ": " << ex.what();
+    return folly::none;
+  }
+}
+
+void AppendOnlyFilePersistence::clear() {
+  std::lock_guard<std::mutex> g(mutex_);
+  persisted_.clear();
+  numRecords_ = 0;
+  if (::unlink(file_.c_str()) != 0 && errno != ENOENT) {
+    PLOG(ERROR) << "Failed to remove " << file_;
+  }
+}
+
+size_t AppendOnlyFilePersistence::getNumRecords() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  return numRecords_;
+}
+
+} // namespace proxygen
@@ -0,0 +1,72 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/dynamic.h>
+#include <wangle/client/persistence/CachePersistence.h>
+#include <wangle/client/persistence/LRUPersistentCache.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace proxygen {
+
+/**
+ * Persistence for wangle::LRUPersistentCache appending to a log only the
+ * entries that changed since the previous sync, instead of rewriting the
+ * whole cache as FilePersistenceLayer does.  Each line of the file is a JSON
+ * record, [key, value] for a put and [key] for a removal.  Once the log has
+ * compactionFactor times more records than the cache has entries, it is
+ * rewritten (atomically) with just the live entries.
+ *
+ * Loading maps the file and replays it, skipping a torn last record.
+ */
+class AppendOnlyFilePersistence : public wangle::CachePersistence {
+ public:
+  static const size_t kDefaultCompactionFactor = 4;
+
+  explicit AppendOnlyFilePersistence(
+      std::string file, size_t compactionFactor = kDefaultCompactionFactor);
+
+  bool persist(const folly::dynamic& arrayOfKvPairs) noexcept override;
+
+  folly::Optional<folly::dynamic> load() noexcept override;
+
+  void clear() override;
+
+  // Records in the log, live or not
+  size_t getNumRecords() const;
+
+ private:
+  bool append(const std::string& records) noexcept;
+  bool compact(const folly::dynamic& arrayOfKvPairs) noexcept;
+
+  const std::string file_;
+  const size_t compactionFactor_;
+  mutable std::mutex mutex_;
+  // What the log holds, by JSON key
+  std::unordered_map<std::string, folly::dynamic> persisted_;
+  size_t numRecords_{0};
+};
+
+/**
+ * A PersistentCache with an AppendOnlyFilePersistence, synced in the
+ * background as configured.
+ */
+template <typename V>
+std::unique_ptr<wangle::PersistentCache<std::string, V>>
+makeAppendOnlyPersistentCache(const std::string& file,
+                              wangle::PersistentCacheConfig config) {
+  return std::make_unique<wangle::LRUPersistentCache<std::string, V>>(
+      std::move(config), std::make_unique<AppendOnlyFilePersistence>(file));
+}
+
+} // namespace proxygen
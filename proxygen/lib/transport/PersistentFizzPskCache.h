@@ -29,11 +29,28 @@ class PersistentFizzPskCache : public fizz::client::PskCache {
  public:
   ~PersistentFizzPskCache() override = default;
 
+  using Cache = wangle::PersistentCache<std::string, PersistentCachedPsk>;
+
   PersistentFizzPskCache(const std::string& filename,
                          wangle::PersistentCacheConfig config,
                          std::unique_ptr<fizz::Factory> factory =
                              std::make_unique<fizz::OpenSSLFactory>())
-      : cache_(filename, std::move(config)), factory_(std::move(factory)) {
+      : PersistentFizzPskCache(
+            std::make_unique<
+                wangle::FilePersistentCache<std::string, PersistentCachedPsk>>(
+                filename, std::move(config)),
+            std::move(factory)) {
+  }
+
+  /**
+   * Persisted by the given cache, for instance from
+   * makeAppendOnlyPersistentCache() to only write the PSKs changed since
+   * the previous sync.
+   */
+  explicit PersistentFizzPskCache(std::unique_ptr<Cache> cache,
+                                  std::unique_ptr<fizz::Factory> factory =
+                                      std::make_unique<fizz::OpenSSLFactory>())
+      : cache_(std::move(cache)), factory_(std::move(factory)) {
   }
 
   void setMaxPskUses(size_t maxUses) {
@@ -42,20 +59,20 @@ class PersistentFizzPskCache : public fizz::client::PskCache {
 
   folly::Optional<fizz::client::CachedPsk> getPsk(
       const std::string& identity) override {
-    auto serialized = cache_.get(identity);
+    auto serialized = cache_->get(identity);
     if (serialized) {
       try {
         auto deserialized = deserializePsk(serialized->serialized, *factory_);
         serialized->uses++;
         if (maxPskUses_ != 0 && serialized->uses >= maxPskUses_) {
-          cache_.remove(identity);
+          cache_->remove(identity);
         } else {
-          cache_.put(identity, *serialized);
+          cache_->put(identity, *serialized);
         }
         return std::move(deserialized);
       } catch (const std::exception& ex) {
         LOG(ERROR) << "Error deserializing PSK: " << ex.what();
-        cache_.remove(identity);
+        cache_->remove(identity);
       }
     }
     return folly::none;
@@ -66,15 +83,15 @@ class PersistentFizzPskCache : public fizz::client::PskCache {
     PersistentCachedPsk serialized;
     serialized.serialized = serializePsk(psk);
     serialized.uses = 0;
-    cache_.put(identity, std::move(serialized));
+    cache_->put(identity, std::move(serialized));
   }
 
   void removePsk(const std::string& identity) override {
-    cache_.remove(identity);
+    cache_->remove(identity);
   }
 
  private:
-  wangle::FilePersistentCache<std::string, PersistentCachedPsk> cache_;
+  std::unique_ptr<Cache> cache_;
 
   size_t maxPskUses_{5};
 
@@ -23,7 +23,16 @@ PersistentQuicPskCache::PersistentQuicPskCache(
     const std::string& filename,
     wangle::PersistentCacheConfig config,
     std::unique_ptr<fizz::Factory> factory)
-    : cache_(filename, std::move(config)), factory_(std::move(factory)) {
+    : PersistentQuicPskCache(
+          std::make_unique<wangle::FilePersistentCache<
+              std::string,
+              PersistentQuicCachedPsk>>(filename, std::move(config)),
+          std::move(factory)) {
+}
+
+PersistentQuicPskCache::PersistentQuicPskCache(
+    std::unique_ptr<Cache> cache, std::unique_ptr<fizz::Factory> factory)
+    : cache_(std::move(cache)), factory_(std::move(factory)) {
 }
 
 void PersistentQuicPskCache::setMaxPskUses(size_t maxUses) {
@@ -32,7 +41,7 @@ void PersistentQuicPskCache::setMaxPskUses(size_t maxUses) {
 
 folly::Optional<quic::QuicCachedPsk> PersistentQuicPskCache::getPsk(
     const std::string& identity) {
-  auto cachedPsk = cache_.get(identity);
+  auto cachedPsk = cache_->get(identity);
   if (!cachedPsk) {
     return folly::none;
   }
@@ -64,14 +73,14 @@ folly::Optional<quic::QuicCachedPsk> PersistentQuicPskCache::getPsk(
 
     cachedPsk->uses++;
     if (maxPskUses_ != 0 && cachedPsk->uses >= maxPskUses_) {
-      cache_.remove(identity);
+      cache_->remove(identity);
     } else {
-      cache_.put(identity, *cachedPsk);
+      cache_->put(identity, *cachedPsk);
     }
     return std::move(quicCachedPsk);
   } catch (const std::exception& ex) {
     LOG(ERROR) << "Error deserializing PSK: " << ex.what();
-    cache_.remove(identity);
+    cache_->remove(identity);
     return folly::none;
   }
 }
@@ -104,11 +113,11 @@ void PersistentQuicPskCache::putPsk(const std::string& identity,
       appender);
   cachedPsk.quicParams = quicParams->moveToFbString().toStdString();
   cachedPsk.uses = 0;
-  cache_.put(identity, std::move(cachedPsk));
+  cache_->put(identity, std::move(cachedPsk));
 }
 
 void PersistentQuicPskCache::removePsk(const std::string& identity) {
-  cache_.remove(identity);
+  cache_->remove(identity);
 }
 } // namespace proxygen
 
@@ -32,11 +32,22 @@ struct PersistentQuicCachedPsk {
 
 class PersistentQuicPskCache : public quic::QuicPskCache {
  public:
+  using Cache = wangle::PersistentCache<std::string, PersistentQuicCachedPsk>;
+
   PersistentQuicPskCache(const std::string& filename,
                          wangle::PersistentCacheConfig config,
                          std::unique_ptr<fizz::Factory> factory =
                              std::make_unique<fizz::OpenSSLFactory>());
 
+  /**
+   * Persisted by the given cache, for instance from
+   * makeAppendOnlyPersistentCache() to only write the PSKs changed since
+   * the previous sync.
+   */
+  explicit PersistentQuicPskCache(std::unique_ptr<Cache> cache,
+                                  std::unique_ptr<fizz::Factory> factory =
+                                      std::make_unique<fizz::OpenSSLFactory>());
+
   void setMaxPskUses(size_t maxUses);
 
   folly::Optional<quic::QuicCachedPsk> getPsk(
@@ -46,7 +57,7 @@ class PersistentQuicPskCache : public quic::QuicPskCache {
   void removePsk(const std::string& identity) override;
 
  private:
-  wangle::FilePersistentCache<std::string, PersistentQuicCachedPsk> cache_;
+  std::unique_ptr<Cache> cache_;
   size_t maxPskUses_{5};
   std::unique_ptr<fizz::Factory> factory_;
 };
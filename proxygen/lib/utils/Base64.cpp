@@ -11,118 +11,279 @@
 
 #include <glog/logging.h>
 
-#include <folly/Range.h>
-#include <folly/portability/OpenSSL.h>
-#include <openssl/buffer.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 
 namespace {
-struct BIODeleter {
- public:
-  void operator()(BIO* bio) const { BIO_free_all(bio); };
+
+const uint8_t kInvalid = 0xff;
+
+// One of the two alphabets, and its inverse
+struct Alphabet {
+  constexpr explicit Alphabet(const char* chars) : encode(), decode() {
+    for (size_t i = 0; i < 256; i++) {
+      decode[i] = kInvalid;
+    }
+    for (size_t i = 0; i < 64; i++) {
+      encode[i] = chars[i];
+      decode[static_cast<uint8_t>(chars[i])] = static_cast<uint8_t>(i);
+    }
+  }
+
+  char encode[64];
+  uint8_t decode[256];
 };
 
-}
+constexpr Alphabet kStandard(
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/");
+constexpr Alphabet kURL(
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_");
 
-namespace proxygen {
+#if defined(__SSSE3__)
+// Muła's and Lemire's SSSE3 base64: 12 bytes are spread over the low 6 bits
+// of 16 lanes, each of which is then offset into the alphabet, and back.
+// c62 and c63 are the alphabet's last two characters, the others are fixed.
 
-// Decodes a base64url encoded string
-std::string Base64::urlDecode(const std::string& urlB64message) {
-  std::unique_ptr<BIO, BIODeleter> bio, b64;
-  uint8_t padding = (4 - urlB64message.length() % 4) % 4;
-  if (padding == 3) {
-    return std::string();
+char* encodeBlocks(const uint8_t*& in, const uint8_t* end,
+                   char* out, char c62, char c63) {
+  const __m128i spread = _mm_setr_epi8(
+    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m128i offsets = _mm_setr_epi8(
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0);
+  // Loads 16 bytes for each 12 it encodes
+  for (; end - in >= 16; in += 12, out += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    v = _mm_shuffle_epi8(v, spread);
+    __m128i ac = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)),
+                                 _mm_set1_epi32(0x04000040));
+    __m128i bd = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)),
+                                 _mm_set1_epi32(0x01000010));
+    __m128i sextets = _mm_or_si128(ac, bd);
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+    __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), sextets);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    __m128i chars =
+      _mm_add_epi8(sextets, _mm_shuffle_epi8(offsets, range));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
   }
+  return out;
+}
+
+// The lanes of v between lo and hi, which bytes >= 0x80 never are
+inline __m128i inRange(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
 
-  std::string b64message(urlB64message.length() + padding, 0);
-  std::transform(
-    urlB64message.begin(), urlB64message.end(), b64message.begin(),
-    [](char c) {
-      if (c == '-') {
-        return '+';
-      } else if (c == '_') {
-        return '/';
-      }
-      return c;
-    });
-  for (auto i = urlB64message.length(); i < urlB64message.length() + padding;
-       i++) {
-    b64message[i] = '=';
+// Stops at the first block with a character not in the alphabet, for the
+// scalar decoder to report
+uint8_t* decodeBlocks(const char*& in, const char* end,
+                      uint8_t* out, const uint8_t* outEnd,
+                      char c62, char c63) {
+  const __m128i pack = _mm_setr_epi8(
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  // Stores 16 bytes for each 12 it decodes
+  for (; end - in >= 16 && outEnd - out >= 16; in += 16, out += 12) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i upper = inRange(v, 'A', 'Z');
+    __m128i lower = inRange(v, 'a', 'z');
+    __m128i digit = inRange(v, '0', '9');
+    __m128i is62 = _mm_cmpeq_epi8(v, _mm_set1_epi8(c62));
+    __m128i is63 = _mm_cmpeq_epi8(v, _mm_set1_epi8(c63));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                 _mm_or_si128(digit,
+                                              _mm_or_si128(is62, is63)));
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      break;
+    }
+    __m128i shift = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                   _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+      _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                   _mm_or_si128(_mm_and_si128(is62, _mm_set1_epi8(62 - c62)),
+                                _mm_and_si128(is63,
+                                              _mm_set1_epi8(63 - c63)))));
+    __m128i sextets = _mm_add_epi8(v, shift);
+    // 4 sextets -> 24 bits per 32-bit lane, then 12 contiguous bytes
+    __m128i pairs =
+      _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+    __m128i lanes = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     _mm_shuffle_epi8(lanes, pack));
   }
-  return decode(b64message, padding);
+  return out;
 }
+#endif
 
-std::string Base64::decode(const std::string& b64message, int padding) {
-  if (b64message.length() % 4 != 0 || padding >= 3) {
-    return std::string();
+size_t encodeImpl(folly::ByteRange buffer,
+                  folly::MutableStringPiece out,
+                  const Alphabet& alphabet,
+                  bool pad) {
+  const uint8_t* in = buffer.begin();
+  const uint8_t* end = buffer.end();
+  char* o = out.begin();
+#if defined(__SSSE3__)
+  o = encodeBlocks(in, end, o, alphabet.encode[62], alphabet.encode[63]);
+#endif
+  for (; end - in >= 3; in += 3, o += 4) {
+    uint32_t bits = (in[0] << 16) | (in[1] << 8) | in[2];
+    o[0] = alphabet.encode[bits >> 18];
+    o[1] = alphabet.encode[(bits >> 12) & 0x3f];
+    o[2] = alphabet.encode[(bits >> 6) & 0x3f];
+    o[3] = alphabet.encode[bits & 0x3f];
+  }
+  if (in != end) {
+    uint32_t bits = in[0] << 16;
+    if (end - in == 2) {
+      bits |= in[1] << 8;
+    }
+    *o++ = alphabet.encode[bits >> 18];
+    *o++ = alphabet.encode[(bits >> 12) & 0x3f];
+    if (end - in == 2) {
+      *o++ = alphabet.encode[(bits >> 6) & 0x3f];
+    } else if (pad) {
+      *o++ = '=';
+    }
+    if (pad) {
+      *o++ = '=';
+    }
   }
+  return o - out.begin();
+}
 
-  std::unique_ptr<BIO, BIODeleter> bio, b64;
-  size_t decodeLen = b64message.length() * 3/4 - padding;
-  std::string result(decodeLen, '\0');
+// b64message without its padding
+folly::Optional<size_t> decodeImpl(folly::StringPiece b64message,
+                                   folly::MutableByteRange out,
+                                   const Alphabet& alphabet) {
+  if (b64message.size() % 4 == 1) {
+    return folly::none;
+  }
+  CHECK_GE(out.size(),
+           proxygen::Base64::decodedSizeBound(b64message.size()));
+  const char* in = b64message.begin();
+  const char* end = b64message.end();
+  uint8_t* o = out.begin();
+#if defined(__SSSE3__)
+  o = decodeBlocks(in, end, o, out.end(),
+                   alphabet.encode[62], alphabet.encode[63]);
+#endif
+  const uint8_t* table = alphabet.decode;
+  for (; end - in >= 4; in += 4, o += 3) {
+    uint8_t a = table[static_cast<uint8_t>(in[0])];
+    uint8_t b = table[static_cast<uint8_t>(in[1])];
+    uint8_t c = table[static_cast<uint8_t>(in[2])];
+    uint8_t d = table[static_cast<uint8_t>(in[3])];
+    if ((a | b | c | d) == kInvalid) {
+      return folly::none;
+    }
+    uint32_t bits = (a << 18) | (b << 12) | (c << 6) | d;
+    o[0] = bits >> 16;
+    o[1] = (bits >> 8) & 0xff;
+    o[2] = bits & 0xff;
+  }
+  if (in != end) {
+    uint8_t a = table[static_cast<uint8_t>(in[0])];
+    uint8_t b = table[static_cast<uint8_t>(in[1])];
+    uint8_t c = end - in == 3 ? table[static_cast<uint8_t>(in[2])] : 0;
+    if ((a | b | c) == kInvalid) {
+      return folly::none;
+    }
+    uint32_t bits = (a << 18) | (b << 12) | (c << 6);
+    *o++ = bits >> 16;
+    if (end - in == 3) {
+      *o++ = (bits >> 8) & 0xff;
+    }
+  }
+  return o - out.begin();
+}
 
-  bio.reset(BIO_new_mem_buf((void*)b64message.data(), -1));
-  if (!bio) {
-    return std::string();
+// The message without the padding it must (resp. may) have
+folly::Optional<folly::StringPiece> stripPadding(folly::StringPiece b64message,
+                                                 bool required) {
+  if (b64message.size() % 4 != 0) {
+    if (required) {
+      return folly::none;
+    }
+    return b64message;
   }
-  b64.reset(BIO_new(BIO_f_base64()));
-  if (!b64) {
-    return std::string();
+  for (size_t i = 0; i < 2 && b64message.endsWith('='); i++) {
+    b64message.pop_back();
   }
-  bio.reset(BIO_push(b64.release(), bio.release()));
+  return b64message;
+}
 
-  // Do not use newlines to flush buffer
-  BIO_set_flags(bio.get(), BIO_FLAGS_BASE64_NO_NL);
-  BIO_read(bio.get(), (char*)result.data(), b64message.length());
-  DCHECK_LE(result.length(), decodeLen);
-  if (result.length() < decodeLen) {
+}
+
+namespace proxygen {
+
+size_t Base64::encode(folly::ByteRange buffer, folly::MutableStringPiece out) {
+  CHECK_GE(out.size(), encodedSize(buffer.size()));
+  return encodeImpl(buffer, out, kStandard, true);
+}
+
+size_t Base64::urlEncode(folly::ByteRange buffer,
+                         folly::MutableStringPiece out) {
+  CHECK_GE(out.size(), urlEncodedSize(buffer.size()));
+  return encodeImpl(buffer, out, kURL, false);
+}
+
+folly::Optional<size_t> Base64::decode(folly::StringPiece b64message,
+                                       folly::MutableByteRange out) {
+  auto data = stripPadding(b64message, true);
+  if (!data) {
+    return folly::none;
+  }
+  return decodeImpl(*data, out, kStandard);
+}
+
+folly::Optional<size_t> Base64::urlDecode(folly::StringPiece b64message,
+                                          folly::MutableByteRange out) {
+  return decodeImpl(*stripPadding(b64message, false), out, kURL);
+}
+
+// Decodes a base64url encoded string
+std::string Base64::urlDecode(const std::string& urlB64message) {
+  std::string result(decodedSizeBound(urlB64message.size()), '\0');
+  auto len = urlDecode(
+    urlB64message,
+    folly::MutableByteRange(reinterpret_cast<uint8_t*>(&result[0]),
+                            result.size()));
+  if (!len) {
     return std::string();
   }
+  result.resize(*len);
   return result;
 }
 
-std::string Base64::encode(folly::ByteRange buffer) {
-  std::unique_ptr<BIO, BIODeleter> bio, b64;
-  BUF_MEM* bufferPtr;
-
-  b64.reset(BIO_new(BIO_f_base64()));
-  if (!b64) {
-    throw std::bad_alloc();
+std::string Base64::decode(const std::string& b64message, int padding) {
+  if (b64message.length() % 4 != 0 || padding < 0 || padding >= 3) {
+    return std::string();
   }
-  bio.reset(BIO_new(BIO_s_mem()));
-  if (!bio) {
-    throw std::bad_alloc();
+  std::string result(decodedSizeBound(b64message.size()), '\0');
+  auto len = decode(
+    b64message,
+    folly::MutableByteRange(reinterpret_cast<uint8_t*>(&result[0]),
+                            result.size()));
+  if (!len || *len != result.size() - padding) {
+    return std::string();
   }
-  bio.reset(BIO_push(b64.release(), bio.release()));
-
-  // Ignore newlines - write everything in one line
-  BIO_set_flags(bio.get(), BIO_FLAGS_BASE64_NO_NL);
-  BIO_write(bio.get(), buffer.data(), buffer.size());
-  (void)BIO_flush(bio.get());
-  BIO_get_mem_ptr(bio.get(), &bufferPtr);
+  result.resize(*len);
+  return result;
+}
 
-  std::string result(bufferPtr->data, bufferPtr->length);
+std::string Base64::encode(folly::ByteRange buffer) {
+  std::string result(encodedSize(buffer.size()), '\0');
+  encode(buffer, folly::MutableStringPiece(&result[0], result.size()));
   return result;
 }
 
 // Encodes a binary safe base 64 string
 std::string Base64::urlEncode(folly::ByteRange buffer) {
-  std::string result = encode(buffer);
-  folly::StringPiece sp(result.data(), result.length());
-  uint8_t padding = 0;
-  std::transform(
-    sp.begin(), sp.end(), result.begin(),
-    [&padding](char c) {
-      if (c == '+') {
-        return '-';
-      } else if (c == '/') {
-        return '_';
-      } else if (c == '=') {
-        padding++;
-      }
-      return c;
-    });
-  DCHECK_LE(padding, result.length());
-  result.resize(result.length() - padding);
+  std::string result(urlEncodedSize(buffer.size()), '\0');
+  urlEncode(buffer, folly::MutableStringPiece(&result[0], result.size()));
   return result;
 }
 
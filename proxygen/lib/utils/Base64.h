@@ -10,15 +10,58 @@
 #pragma once
 
 #include <string>
+#include <folly/Optional.h>
 #include <folly/Range.h>
 
 namespace proxygen {
 
-// This is a wrapper around openssl base64 encoding.  It is a temporary wrapper
-// around openssl, until a more optimized version lands in folly
-
+/**
+ * Base64 (RFC 4648 section 4) and base64url (section 5) without line breaks.
+ * The encoded form of the former is padded with '=', that of the latter is
+ * not.  Blocks of input are translated with SSSE3 where the build targets
+ * it, with a table lookup per character otherwise.
+ *
+ * The range overloads write into the caller's buffer and never allocate;
+ * the string ones return an empty string for invalid input.
+ */
 class Base64 {
   public:
+    /** The number of characters encode() writes for len bytes */
+    static constexpr size_t encodedSize(size_t len) {
+      return (len + 2) / 3 * 4;
+    }
+
+    /** The number of characters urlEncode() writes for len bytes */
+    static constexpr size_t urlEncodedSize(size_t len) {
+      return len / 3 * 4 + (len % 3 == 0 ? 0 : len % 3 + 1);
+    }
+
+    /** The most bytes decode() or urlDecode() write for len characters */
+    static constexpr size_t decodedSizeBound(size_t len) {
+      return (len + 3) / 4 * 3;
+    }
+
+    /**
+     * Encode buffer into out, which must hold encodedSize(buffer.size())
+     * (resp. urlEncodedSize()) characters.  Returns the number written.
+     */
+    static size_t encode(folly::ByteRange buffer,
+                         folly::MutableStringPiece out);
+    static size_t urlEncode(folly::ByteRange buffer,
+                            folly::MutableStringPiece out);
+
+    /**
+     * Decode b64message into out, which must hold
+     * decodedSizeBound(b64message.size()) bytes.  Returns the number of
+     * bytes written, or none if b64message is not valid.  decode() requires
+     * the padding; urlDecode() accepts it, but does not need it.
+     */
+    static folly::Optional<size_t> decode(folly::StringPiece b64message,
+                                          folly::MutableByteRange out);
+    static folly::Optional<size_t> urlDecode(folly::StringPiece b64message,
+                                             folly::MutableByteRange out);
+
+    // padding is the number of '=' b64message ends with
     static std::string decode(const std::string& b64message, int padding);
     static std::string urlDecode(const std::string& b64message);
     static std::string encode(folly::ByteRange buffer);
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/BatchingTraceEventObserver.h>
+
+#include <algorithm>
+
+namespace proxygen {
+
+BatchingTraceEventObserver::BatchingTraceEventObserver(
+    TraceEventObserver& sink,
+    size_t queueSize,
+    std::chrono::milliseconds flushInterval,
+    size_t maxBatchSize)
+    : sink_(sink),
+      flushInterval_(flushInterval),
+      maxBatchSize_(std::max<size_t>(maxBatchSize, 1)),
+      // the queue holds one less than its size
+      queue_(queueSize + 1),
+      thread_([this] { run(); }) {}
+
+BatchingTraceEventObserver::~BatchingTraceEventObserver() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+void BatchingTraceEventObserver::traceEventAvailable(
+    TraceEvent event) noexcept {
+  if (!queue_.write(std::move(event))) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void BatchingTraceEventObserver::emitTraceEvents(
+    std::vector<TraceEvent> events) noexcept {
+  for (auto& event : events) {
+    traceEventAvailable(std::move(event));
+  }
+}
+
+void BatchingTraceEventObserver::run() {
+  bool stopping = false;
+  while (!stopping) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stopping = cv_.wait_for(lock, flushInterval_,
+                              [this] { return stopping_; });
+    }
+    drain();
+  }
+}
+
+void BatchingTraceEventObserver::drain() {
+  std::vector<TraceEvent> batch;
+  while (auto event = queue_.frontPtr()) {
+    if (batch.empty()) {
+      batch.reserve(maxBatchSize_);
+    }
+    batch.push_back(std::move(*event));
+    queue_.popFront();
+    if (batch.size() == maxBatchSize_) {
+      sink_.emitTraceEvents(std::move(batch));
+      batch.clear();
+    }
+  }
+  if (!batch.empty()) {
+    sink_.emitTraceEvents(std::move(batch));
+  }
+}
+
+}
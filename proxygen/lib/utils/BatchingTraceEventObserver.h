@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ProducerConsumerQueue.h>
+#include <proxygen/lib/utils/TraceEventObserver.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace proxygen {
+
+/**
+ * A TraceEventObserver handing the events to another observer from a
+ * background thread, in batches through emitTraceEvents(), so exporting
+ * them does not slow down the thread tracing.
+ *
+ * The events go through a bounded single producer single consumer queue:
+ * traceEventAvailable() takes no lock and never blocks, and drops the event
+ * when the queue is full.  There may only be one thread adding events, so
+ * a multi-threaded server uses one observer per thread.
+ */
+class BatchingTraceEventObserver : public TraceEventObserver {
+ public:
+  /**
+   * The events are given to sink every flushInterval, by batches of up to
+   * maxBatchSize, with up to queueSize waiting in between.
+   */
+  explicit BatchingTraceEventObserver(
+    TraceEventObserver& sink,
+    size_t queueSize = 4096,
+    std::chrono::milliseconds flushInterval = std::chrono::milliseconds(100),
+    size_t maxBatchSize = 256);
+
+  // Gives sink the events still queued, then stops the thread
+  ~BatchingTraceEventObserver() override;
+
+  void traceEventAvailable(TraceEvent event) noexcept override;
+
+  void emitTraceEvents(std::vector<TraceEvent> events) noexcept override;
+
+  // The events dropped because the queue was full
+  uint64_t getNumDropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void run();
+  void drain();
+
+  TraceEventObserver& sink_;
+  const std::chrono::milliseconds flushInterval_;
+  const size_t maxBatchSize_;
+  folly::ProducerConsumerQueue<TraceEvent> queue_;
+  std::atomic<uint64_t> dropped_{0};
+
+  // Only used to wait for the next flush, or to stop
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopping_{false};
+
+  std::thread thread_;
+};
+
+}
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/BoundedLoadHash.h>
+#include <glog/logging.h>
+#include <cmath>
+#include <limits>
+
+namespace proxygen {
+
+BoundedLoadHash::BoundedLoadHash(std::unique_ptr<ConsistentHash> hash,
+                                 double epsilon)
+    : hash_(std::move(hash)), epsilon_(epsilon) {
+  CHECK(hash_);
+  CHECK_GE(epsilon_, 0);
+}
+
+void BoundedLoadHash::build(std::vector<std::pair<
+                            std::string, uint64_t> >& nodes) {
+  weights_.clear();
+  totalWeight_ = 0;
+  for (auto& node : nodes) {
+    weights_.push_back(node.second);
+    totalWeight_ += node.second;
+  }
+  hash_->build(nodes);
+}
+
+size_t BoundedLoadHash::get(const uint64_t key, const size_t rank) const {
+  return hash_->get(key, rank);
+}
+
+size_t BoundedLoadHash::getBounded(const uint64_t key,
+                                   folly::Range<const uint64_t*> loads) const {
+  CHECK_EQ(loads.size(), weights_.size());
+  if (totalWeight_ == 0) {
+    return hash_->get(key);
+  }
+  // Counting the key, so that there is always room for it
+  uint64_t totalLoad = 1;
+  for (auto load : loads) {
+    totalLoad += load;
+  }
+  double boundPerWeight = (1 + epsilon_) * totalLoad / totalWeight_;
+
+  size_t leastLoaded = 0;
+  double leastLoad = std::numeric_limits<double>::max();
+  for (size_t rank = 0; rank < weights_.size(); ++rank) {
+    size_t node = hash_->get(key, rank);
+    if (weights_[node] == 0) {
+      continue;
+    }
+    if (loads[node] + 1 <= std::ceil(boundPerWeight * weights_[node])) {
+      return node;
+    }
+    double load = double(loads[node] + 1) / weights_[node];
+    if (load < leastLoad) {
+      leastLoaded = node;
+      leastLoad = load;
+    }
+  }
+  // Only if the ranks of the hash miss the nodes with room
+  return leastLoad < std::numeric_limits<double>::max() ?
+    leastLoaded : hash_->get(key);
+}
+
+double BoundedLoadHash::getMaxErrorRate() const {
+  return hash_->getMaxErrorRate();
+}
+
+} // proxygen
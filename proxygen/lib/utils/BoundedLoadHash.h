@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <proxygen/lib/utils/ConsistentHash.h>
+
+namespace proxygen {
+/*
+ * Consistent hashing with bounded loads (Mirrokni, Thorup and Zadimoghaddam)
+ * on top of any ConsistentHash.  getBounded() takes the live load of the
+ * nodes, e.g. the outgoing streams of their SessionPools, and walks the
+ * ranks of the key until a node stays within (1 + epsilon) times its share
+ * of the total load, counting the key.  Keys keep their node while it is
+ * not overloaded, and a hot key spills over to its next ranked nodes rather
+ * than to a random one.
+ *
+ * The smaller epsilon, the more even the loads and the more keys move.
+ */
+class BoundedLoadHash : public ConsistentHash {
+ public:
+  BoundedLoadHash(std::unique_ptr<ConsistentHash> hash, double epsilon);
+
+  double getMaxErrorRate() const override;
+
+  void build(std::vector<std::pair<std::string, uint64_t>>&) override;
+
+  // The node of the hash, whatever the loads
+  size_t get(const uint64_t key, const size_t rank = 0) const override;
+
+  /**
+   * The node for key given loads, the load of each node in the vector of
+   * build(): the first one ranked for the key with room for one more, else
+   * the least loaded for its weight.  Linear in the number of nodes.
+   */
+  size_t getBounded(const uint64_t key,
+                    folly::Range<const uint64_t*> loads) const;
+
+ private:
+  std::unique_ptr<ConsistentHash> hash_;
+  const double epsilon_;
+  std::vector<uint64_t> weights_;
+  uint64_t totalWeight_{0};
+};
+
+} // proxygen
@@ -0,0 +1,89 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/BrotliStreamCompressor.h>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+namespace {
+const size_t kOutBufMinSize = 1;
+const size_t kOutBufAllocSize = 16 * 1024;
+}
+
+void BrotliStreamCompressor::freeEncoder(BrotliEncoderState* state) {
+  BrotliEncoderDestroyInstance(state);
+}
+
+BrotliStreamCompressor::BrotliStreamCompressor(int level)
+    : state_(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr)) {
+  if (!state_ ||
+      !BrotliEncoderSetParameter(state_.get(), BROTLI_PARAM_QUALITY, level)) {
+    LOG(ERROR) << "error initializing brotli stream";
+    error_ = true;
+  }
+}
+
+bool BrotliStreamCompressor::compressStream(BrotliEncoderOperation op,
+                                            const uint8_t* data,
+                                            size_t length,
+                                            folly::IOBufQueue& out) {
+  // Flush and finish only complete once all their output was taken
+  do {
+    auto outpair = out.preallocate(kOutBufMinSize, kOutBufAllocSize);
+    size_t availOut = outpair.second;
+    auto nextOut = static_cast<uint8_t*>(outpair.first);
+    if (!BrotliEncoderCompressStream(state_.get(), op, &length, &data,
+                                     &availOut, &nextOut, nullptr)) {
+      return false;
+    }
+    out.postallocate(outpair.second - availOut);
+  } while (length > 0 || BrotliEncoderHasMoreOutput(state_.get()) ||
+           (op == BROTLI_OPERATION_FINISH &&
+            !BrotliEncoderIsFinished(state_.get())));
+  return true;
+}
+
+std::unique_ptr<folly::IOBuf> BrotliStreamCompressor::compress(
+    const folly::IOBuf* in, bool trailer) {
+  if (error_ || BrotliEncoderIsFinished(state_.get())) {
+    error_ = true;
+    return nullptr;
+  }
+
+  folly::IOBufQueue outqueue{folly::IOBufQueue::cacheChainLength()};
+  for (const folly::ByteRange range : *in) {
+    if (range.empty()) {
+      continue;
+    }
+    if (!compressStream(BROTLI_OPERATION_PROCESS, range.data(), range.size(),
+                        outqueue)) {
+      LOG(ERROR) << "brotli compression failed";
+      error_ = true;
+      return nullptr;
+    }
+  }
+  if (!compressStream(trailer ? BROTLI_OPERATION_FINISH
+                              : BROTLI_OPERATION_FLUSH,
+                      nullptr, 0, outqueue)) {
+    LOG(ERROR) << "brotli compression failed";
+    error_ = true;
+    return nullptr;
+  }
+
+  auto out = outqueue.move();
+  if (!out) {
+    out = folly::IOBuf::create(0);
+  }
+  return out;
+}
+} // namespace proxygen
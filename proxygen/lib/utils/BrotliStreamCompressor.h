@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <brotli/encode.h>
+#include <memory>
+
+#include <folly/Memory.h>
+
+#include <proxygen/lib/utils/StreamCompressor.h>
+
+namespace folly {
+class IOBufQueue;
+}
+
+namespace proxygen {
+
+/**
+ * Compresses a stream with brotli (RFC 7932), flushed after each compress()
+ * call.  Only built when PROXYGEN_HAVE_BROTLI is defined.
+ */
+class BrotliStreamCompressor : public StreamCompressor {
+ public:
+  // level is the brotli quality, 0 (fastest) to 11 (smallest)
+  explicit BrotliStreamCompressor(int level);
+
+  // May return nullptr on error.
+  std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf* in,
+                                         bool trailer = true) override;
+
+  bool hasError() override {
+    return error_;
+  }
+
+ private:
+  static void freeEncoder(BrotliEncoderState* state);
+
+  bool compressStream(BrotliEncoderOperation op,
+                      const uint8_t* data,
+                      size_t length,
+                      folly::IOBufQueue& out);
+
+  bool error_{false};
+
+  const std::unique_ptr<
+      BrotliEncoderState,
+      folly::static_function_deleter<BrotliEncoderState, freeEncoder>>
+      state_;
+};
+} // namespace proxygen
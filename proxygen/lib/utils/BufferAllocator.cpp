@@ -0,0 +1,201 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/BufferAllocator.h>
+
+#include <glog/logging.h>
+#include <sys/mman.h>
+
+namespace proxygen {
+
+namespace {
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+size_t roundUp(size_t size, size_t multiple) {
+  return (size + multiple - 1) / multiple * multiple;
+}
+
+void* mapMemory(size_t size, int flags) {
+  void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  return mem == MAP_FAILED ? nullptr : mem;
+}
+
+// Transparent huge pages need the mapping aligned on them
+char* mapAligned(size_t size) {
+  size_t padded = size + kHugePageSize;
+  auto raw = static_cast<char*>(mapMemory(padded, 0));
+  if (!raw) {
+    return nullptr;
+  }
+  auto aligned = reinterpret_cast<char*>(
+    roundUp(reinterpret_cast<uintptr_t>(raw), kHugePageSize));
+  if (aligned > raw) {
+    munmap(raw, aligned - raw);
+  }
+  size_t tail = (raw + padded) - (aligned + size);
+  if (tail > 0) {
+    munmap(aligned + size, tail);
+  }
+  return aligned;
+}
+}
+
+struct ArenaBufferAllocator::Arena {
+  explicit Arena(const Options& opts) : options(opts) {}
+
+  ~Arena() {
+    for (auto& chunk : chunks) {
+      munmap(chunk.first, chunk.second);
+    }
+  }
+
+  // Maps the next chunk, false past maxArenaSize or if it fails
+  bool mapChunk() {
+    if (mapped + options.chunkSize > options.maxArenaSize) {
+      return false;
+    }
+    char* chunk = nullptr;
+    bool huge = options.hugePages != HugePages::NONE;
+    size_t size = huge ? roundUp(options.chunkSize, kHugePageSize) :
+      options.chunkSize;
+#ifdef MAP_HUGETLB
+    if (options.hugePages == HugePages::EXPLICIT) {
+      chunk = static_cast<char*>(mapMemory(size, MAP_HUGETLB));
+      if (!chunk) {
+        hugePageFallbacks++;
+      }
+    }
+#endif
+    if (!chunk) {
+      chunk = huge ? mapAligned(size) : static_cast<char*>(mapMemory(size, 0));
+      if (!chunk) {
+        return false;
+      }
+#ifdef MADV_HUGEPAGE
+      if (huge) {
+        madvise(chunk, size, MADV_HUGEPAGE);
+      }
+#endif
+    }
+    chunks.emplace_back(chunk, size);
+    mapped += size;
+    next = chunk;
+    end = chunk + size;
+    return true;
+  }
+
+  // A copy, for the arenas that outlive the allocator
+  const Options options;
+  std::mutex mutex;
+  std::vector<char*> free;
+  std::vector<std::pair<char*, size_t>> chunks;
+  // What is left of the last chunk
+  char* next{nullptr};
+  char* end{nullptr};
+  size_t mapped{0};
+  size_t used{0};
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t hugePageFallbacks{0};
+  // The allocator is gone, the last buffer freed destroys the arena
+  bool orphaned{false};
+};
+
+ArenaBufferAllocator::ArenaBufferAllocator(const Options& options)
+    : options_(options) {
+  CHECK_GT(options_.bufferSize, 0);
+  CHECK_GE(options_.chunkSize, options_.bufferSize);
+}
+
+ArenaBufferAllocator::~ArenaBufferAllocator() {
+  for (auto arena : arenas_) {
+    bool inUse;
+    {
+      std::lock_guard<std::mutex> guard(arena->mutex);
+      inUse = arena->used > 0;
+      arena->orphaned = inUse;
+    }
+    if (!inUse) {
+      delete arena;
+    }
+  }
+}
+
+ArenaBufferAllocator::Arena& ArenaBufferAllocator::getArena() {
+  auto& slot = *slot_;
+  if (!slot.arena) {
+    // Kept for the buffers of the thread once it exits
+    slot.arena = new Arena(options_);
+    std::lock_guard<std::mutex> guard(mutex_);
+    arenas_.push_back(slot.arena);
+  }
+  return *slot.arena;
+}
+
+std::unique_ptr<folly::IOBuf> ArenaBufferAllocator::allocate(size_t size) {
+  auto& arena = getArena();
+  char* buf = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(arena.mutex);
+    if (size <= options_.bufferSize) {
+      if (!arena.free.empty()) {
+        buf = arena.free.back();
+        arena.free.pop_back();
+      } else if ((arena.end - arena.next >= ptrdiff_t(options_.bufferSize)) ||
+                 arena.mapChunk()) {
+        buf = arena.next;
+        arena.next += options_.bufferSize;
+      }
+    }
+    if (buf) {
+      arena.used += options_.bufferSize;
+      arena.hits++;
+    } else {
+      arena.misses++;
+    }
+  }
+  if (!buf) {
+    return folly::IOBuf::create(size);
+  }
+  return folly::IOBuf::takeOwnership(buf, options_.bufferSize, 0,
+                                     &ArenaBufferAllocator::freeBuffer,
+                                     &arena);
+}
+
+void ArenaBufferAllocator::freeBuffer(void* buf, void* userData) {
+  auto arena = static_cast<Arena*>(userData);
+  bool destroy;
+  {
+    std::lock_guard<std::mutex> guard(arena->mutex);
+    arena->free.push_back(static_cast<char*>(buf));
+    arena->used -= arena->options.bufferSize;
+    destroy = arena->orphaned && arena->used == 0;
+  }
+  if (destroy) {
+    delete arena;
+  }
+}
+
+ArenaBufferAllocator::Stats ArenaBufferAllocator::getStats() const {
+  Stats stats;
+  std::lock_guard<std::mutex> guard(mutex_);
+  stats.arenas = arenas_.size();
+  for (auto arena : arenas_) {
+    std::lock_guard<std::mutex> arenaGuard(arena->mutex);
+    stats.hits += arena->hits;
+    stats.misses += arena->misses;
+    stats.mappedBytes += arena->mapped;
+    stats.usedBytes += arena->used;
+    stats.hugePageFallbacks += arena->hugePageFallbacks;
+  }
+  return stats;
+}
+
+}
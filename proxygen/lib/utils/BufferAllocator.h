@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Where sessions allocate their buffers, see
+ * HTTPSession::setBufferAllocator().
+ */
+class BufferAllocator {
+ public:
+  virtual ~BufferAllocator() = default;
+
+  // An empty buffer with at least size bytes of tailroom, on any thread
+  virtual std::unique_ptr<folly::IOBuf> allocate(size_t size) = 0;
+};
+
+/**
+ * Buffers of bufferSize bytes carved out of large mappings of an arena per
+ * thread, so that the worker threads don't contend on malloc's arenas for
+ * their read buffers, and reuse memory that stays in their caches and TLBs.
+ * With huge pages, the mappings are backed by transparent or explicit
+ * (hugetlbfs) huge pages, falling back to regular pages if none are
+ * reserved.
+ *
+ * Freed buffers go back to the free list of the arena they came from,
+ * whatever the thread; arenas never unmap their memory, up to maxArenaSize
+ * each, past which buffers come from malloc.  Buffers may outlive the
+ * allocator.
+ */
+class ArenaBufferAllocator : public BufferAllocator {
+ public:
+  enum class HugePages { NONE, TRANSPARENT, EXPLICIT };
+
+  struct Options {
+    // The size of the arenas' buffers; larger ones come from malloc
+    size_t bufferSize{64 * 1024};
+    // Mapped at once by an arena
+    size_t chunkSize{2 * 1024 * 1024};
+    size_t maxArenaSize{64 * 1024 * 1024};
+    HugePages hugePages{HugePages::NONE};
+  };
+
+  struct Stats {
+    // Buffers served by the arenas, and by malloc instead
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t mappedBytes{0};
+    uint64_t usedBytes{0};
+    // Chunks mapped with regular pages, as no huge page was available
+    uint64_t hugePageFallbacks{0};
+    size_t arenas{0};
+
+    double getHitRate() const {
+      return hits + misses > 0 ? double(hits) / (hits + misses) : 0;
+    }
+
+    // The share of the memory mapped that no buffer uses
+    double getFragmentation() const {
+      return mappedBytes > 0 ? 1 - double(usedBytes) / mappedBytes : 0;
+    }
+  };
+
+  explicit ArenaBufferAllocator(const Options& options);
+  ~ArenaBufferAllocator() override;
+
+  ArenaBufferAllocator(const ArenaBufferAllocator&) = delete;
+  ArenaBufferAllocator& operator=(const ArenaBufferAllocator&) = delete;
+
+  std::unique_ptr<folly::IOBuf> allocate(size_t size) override;
+
+  // Of all the arenas
+  Stats getStats() const;
+
+ private:
+  struct Arena;
+  struct ArenaSlot {
+    Arena* arena{nullptr};
+  };
+
+  Arena& getArena();
+  static void freeBuffer(void* buf, void* arena);
+
+  const Options options_;
+  folly::ThreadLocal<ArenaSlot> slot_;
+  mutable std::mutex mutex_;
+  std::vector<Arena*> arenas_;
+};
+
+}
@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/CoarseTime.h>
+
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseManager.h>
+
+namespace {
+
+bool inLoop(folly::EventBase* evb) {
+  // isInEventBaseThread() also holds for an EventBase that is not running
+  return evb && evb->isRunning() && evb->isInEventBaseThread();
+}
+
+// The time of an EventBase the thread runs, cached while the callback, which
+// runs at the end of the loop iteration, is scheduled.  An EventBase runs
+// all of its loop callbacks when it is destroyed, so evb_ is valid then.
+class CoarseClock : public folly::EventBase::LoopCallback {
+ public:
+  bool cached(folly::EventBase* evb) const {
+    return isLoopCallbackScheduled() && evb == evb_;
+  }
+
+  bool cachedInLoop() const {
+    return isLoopCallbackScheduled() && inLoop(evb_);
+  }
+
+  proxygen::TimePoint time() const {
+    return time_;
+  }
+
+  proxygen::TimePoint refresh(folly::EventBase* evb) {
+    if (evb != evb_) {
+      cancelLoopCallback();
+      evb_ = evb;
+    }
+    time_ = proxygen::getCurrentTime();
+    if (!isLoopCallbackScheduled()) {
+      evb->runInLoop(this);
+    }
+    return time_;
+  }
+
+  void runLoopCallback() noexcept override {}
+
+ private:
+  folly::EventBase* evb_{nullptr};
+  proxygen::TimePoint time_;
+};
+
+thread_local CoarseClock coarseClock;
+
+}
+
+namespace proxygen {
+
+TimePoint getCoarseTime(folly::EventBase* evb) {
+  if (!inLoop(evb)) {
+    return getCurrentTime();
+  }
+  if (coarseClock.cached(evb)) {
+    return coarseClock.time();
+  }
+  return coarseClock.refresh(evb);
+}
+
+TimePoint getCoarseTime() {
+  if (coarseClock.cachedInLoop()) {
+    return coarseClock.time();
+  }
+  return getCoarseTime(folly::EventBaseManager::get()->getExistingEventBase());
+}
+
+TimePoint refreshCoarseTime(folly::EventBase* evb) {
+  if (!inLoop(evb)) {
+    return getCurrentTime();
+  }
+  return coarseClock.refresh(evb);
+}
+
+}
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/utils/Time.h>
+
+namespace folly {
+class EventBase;
+}
+
+namespace proxygen {
+
+/**
+ * getCurrentTime() as of the current loop iteration of evb: the clock is
+ * read by the first call in an iteration, and the following ones get the
+ * same time until the iteration ends.  For the many timestamps taken while
+ * handling one batch of events, where a difference smaller than a loop
+ * iteration does not matter.  Code that needs the time precisely, e.g. to
+ * measure a latency, still calls getCurrentTime().
+ *
+ * Outside of evb's loop, or with a null evb, this reads the clock.
+ */
+TimePoint getCoarseTime(folly::EventBase* evb);
+
+/**
+ * getCoarseTime() for the EventBase the thread is running, for code that
+ * does not know it.  On the first call of an iteration, that is the one
+ * folly::EventBaseManager has for the thread.
+ */
+TimePoint getCoarseTime();
+
+/**
+ * Reads the clock, and makes that the time of the current loop iteration of
+ * evb, for work that took long enough to matter, e.g. a blocking call.
+ */
+TimePoint refreshCoarseTime(folly::EventBase* evb);
+
+}
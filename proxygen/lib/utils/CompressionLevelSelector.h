@@ -0,0 +1,38 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+namespace proxygen {
+
+/**
+ * Chooses the compression level of each response, rather than a fixed one,
+ * for instance to compress less while the CPU is busy.  Called from the I/O
+ * threads, implementations must be thread-safe and cheap.
+ */
+class CompressionLevelSelector {
+ public:
+  virtual ~CompressionLevelSelector() = default;
+
+  /**
+   * The level to compress a response body of size bytes with, 0 if the size
+   * isn't known (chunked responses).  configured is the level the response
+   * would be compressed with otherwise.
+   */
+  virtual int32_t getLevel(CompressionType type,
+                           int32_t configured,
+                           size_t size) = 0;
+};
+
+}
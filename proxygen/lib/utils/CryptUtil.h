@@ -14,7 +14,7 @@
 
 namespace proxygen {
 
-// Base64 encode using openssl, may return empty string on allocation failure
+// Base64 encode, as Base64::encode()
 std::string base64Encode(folly::ByteRange text);
 
 // MD5 encode using openssl
@@ -0,0 +1,254 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/HierarchicalTimingWheel.h>
+
+#include <folly/ScopeGuard.h>
+#include <folly/io/async/Request.h>
+#include <folly/lang/Bits.h>
+
+using std::chrono::milliseconds;
+
+namespace proxygen {
+
+constexpr milliseconds HierarchicalTimingWheel::kDefaultTickInterval;
+constexpr uint32_t HierarchicalTimingWheel::kSlotBits;
+constexpr uint32_t HierarchicalTimingWheel::kSlots;
+constexpr uint64_t HierarchicalTimingWheel::kSlotMask;
+constexpr uint32_t HierarchicalTimingWheel::kLevels;
+
+namespace {
+
+const TimeUtil& getSteadyTimeUtil() {
+  static TimeUtil timeUtil;
+  return timeUtil;
+}
+
+}
+
+HierarchicalTimingWheel::Callback::~Callback() {
+  cancelTimeout();
+}
+
+void HierarchicalTimingWheel::Callback::cancelTimeout() {
+  if (wheel_ == nullptr) {
+    return;
+  }
+  // an emptied wheel stays armed, its timeout then finds nothing to run
+  wheel_->unlink(this);
+  context_.reset();
+}
+
+HierarchicalTimingWheel::HierarchicalTimingWheel(
+    folly::TimeoutManager* timeoutManager,
+    milliseconds tickInterval,
+    const TimeUtil* timeUtil)
+    : folly::AsyncTimeout(timeoutManager),
+      timeUtil_(timeUtil ? *timeUtil : getSteadyTimeUtil()),
+      start_(timeUtil_.now()),
+      tickInterval_(std::max(tickInterval, milliseconds(1))) {
+}
+
+HierarchicalTimingWheel::~HierarchicalTimingWheel() {
+  // DelayedDestruction should ensure we are never destroyed while running
+  // callbacks, and destroy() cancelled the rest
+  DCHECK(!inRunExpired_);
+  DCHECK_EQ(count_, 0);
+}
+
+void HierarchicalTimingWheel::destroy() {
+  auto cancelSlot = [] (Slot& slot) {
+    while (slot.head) {
+      slot.head->cancelTimeout();
+    }
+  };
+  for (auto& level : levels_) {
+    for (auto& slot : level) {
+      cancelSlot(slot);
+    }
+  }
+  cancelSlot(overflow_);
+  this->folly::AsyncTimeout::cancelTimeout();
+  DelayedDestruction::destroy();
+}
+
+uint64_t HierarchicalTimingWheel::msSinceStart() const {
+  return millisecondsBetween(timeUtil_.now(), start_).count();
+}
+
+void HierarchicalTimingWheel::scheduleTimeout(Callback* callback,
+                                              milliseconds timeout) {
+  callback->cancelTimeout();
+
+  uint64_t nowMs = msSinceStart();
+  uint64_t nowTick = nowMs / tickInterval_.count();
+  if (count_ == 0 && !inRunExpired_) {
+    // nothing to cascade, skip the ticks the wheel slept through
+    curTick_ = std::max(curTick_, nowTick);
+  }
+  // The first tick ending after the timeout, and never the one being run
+  uint64_t timeoutMs = std::max<int64_t>(timeout.count(), 0);
+  uint64_t expiration =
+    (nowMs + timeoutMs + tickInterval_.count() - 1) / tickInterval_.count();
+  callback->expiration_ = std::max(expiration, curTick_ + 1);
+  callback->context_ = folly::RequestContext::saveContext();
+  callback->wheel_ = this;
+  link(callback);
+  count_++;
+
+  if (!inRunExpired_ &&
+      (!this->folly::AsyncTimeout::isScheduled() ||
+       callback->expiration_ < wakeupTick_)) {
+    armTimeout(nowMs);
+  }
+}
+
+void HierarchicalTimingWheel::link(Callback* callback) {
+  // Callbacks go in the level of the highest slot index in which their
+  // expiration differs from the current tick, so each is moved down once
+  // per level, when the wheel below wraps around to its slot
+  uint64_t expiration = callback->expiration_;
+  Slot* slot = &overflow_;
+  uint32_t index = 0;
+  for (uint32_t level = 0; level < kLevels; level++) {
+    uint32_t shift = kSlotBits * (level + 1);
+    if ((expiration >> shift) == (curTick_ >> shift)) {
+      index = (expiration >> (kSlotBits * level)) & kSlotMask;
+      slot = &levels_[level][index];
+      if (level == 0) {
+        occupied_[index / 64] |= uint64_t(1) << (index % 64);
+      }
+      break;
+    }
+  }
+
+  callback->slot_ = slot;
+  callback->prev_ = slot->tail;
+  callback->next_ = nullptr;
+  if (slot->tail) {
+    slot->tail->next_ = callback;
+  } else {
+    slot->head = callback;
+  }
+  slot->tail = callback;
+}
+
+void HierarchicalTimingWheel::unlink(Callback* callback) {
+  auto slot = callback->slot_;
+  if (callback->prev_) {
+    callback->prev_->next_ = callback->next_;
+  } else {
+    slot->head = callback->next_;
+  }
+  if (callback->next_) {
+    callback->next_->prev_ = callback->prev_;
+  } else {
+    slot->tail = callback->prev_;
+  }
+  auto first = &levels_[0][0];
+  if (!slot->head && slot >= first && slot < first + kSlots) {
+    uint32_t index = slot - &levels_[0][0];
+    occupied_[index / 64] &= ~(uint64_t(1) << (index % 64));
+  }
+  callback->wheel_ = nullptr;
+  callback->slot_ = nullptr;
+  callback->prev_ = nullptr;
+  callback->next_ = nullptr;
+  count_--;
+}
+
+uint64_t HierarchicalTimingWheel::nextWorkTick() const {
+  uint32_t index = (curTick_ & kSlotMask) + 1;
+  uint64_t base = curTick_ & ~kSlotMask;
+  for (uint32_t word = index / 64; word < occupied_.size(); word++) {
+    uint64_t bits = occupied_[word];
+    if (word == index / 64) {
+      // only the slots after the current one
+      bits &= (index % 64) ? ~((uint64_t(1) << (index % 64)) - 1) : ~0ull;
+    }
+    if (bits) {
+      return base + word * 64 + folly::findFirstSet(bits) - 1;
+    }
+  }
+  return base + kSlots;
+}
+
+void HierarchicalTimingWheel::cascade() {
+  // Called as the first level wraps around to curTick_: bring down the
+  // callbacks of the slots of higher levels that curTick_ entered
+  for (uint32_t level = 1; level <= kLevels; level++) {
+    Slot* slot = &overflow_;
+    uint32_t index = 0;
+    if (level < kLevels) {
+      index = (curTick_ >> (kSlotBits * level)) & kSlotMask;
+      slot = &levels_[level][index];
+    }
+    Callback* callback = slot->head;
+    slot->head = slot->tail = nullptr;
+    while (callback) {
+      auto next = callback->next_;
+      link(callback);
+      callback = next;
+    }
+    if (index != 0) {
+      break;
+    }
+  }
+}
+
+void HierarchicalTimingWheel::expireCurrentTick() {
+  uint32_t index = curTick_ & kSlotMask;
+  Slot& slot = levels_[0][index];
+  while (slot.head) {
+    auto callback = slot.head;
+    DCHECK_EQ(callback->expiration_, curTick_);
+    auto context = std::move(callback->context_);
+    unlink(callback);
+    folly::RequestContextScopeGuard rctx(context);
+    callback->timeoutExpired();
+  }
+}
+
+void HierarchicalTimingWheel::runExpired() {
+  // If destroy() is called by a callback, delay destruction until we return
+  DestructorGuard dg(this);
+  DCHECK(!inRunExpired_);
+  inRunExpired_ = true;
+  SCOPE_EXIT { inRunExpired_ = false; };
+
+  uint64_t nowMs = msSinceStart();
+  uint64_t nowTick = nowMs / tickInterval_.count();
+  while (curTick_ < nowTick && count_ > 0) {
+    // jump over the empty ticks
+    curTick_ = std::min(nextWorkTick(), nowTick);
+    if ((curTick_ & kSlotMask) == 0) {
+      cascade();
+    }
+    expireCurrentTick();
+  }
+  if (count_ == 0) {
+    curTick_ = std::max(curTick_, nowTick);
+    this->folly::AsyncTimeout::cancelTimeout();
+  } else {
+    armTimeout(msSinceStart());
+  }
+}
+
+void HierarchicalTimingWheel::armTimeout(uint64_t nowMs) {
+  wakeupTick_ = nextWorkTick();
+  uint64_t wakeupMs = wakeupTick_ * tickInterval_.count();
+  this->folly::AsyncTimeout::scheduleTimeout(
+    milliseconds(wakeupMs > nowMs ? wakeupMs - nowMs : 0));
+}
+
+void HierarchicalTimingWheel::timeoutExpired() noexcept {
+  runExpired();
+}
+
+}
@@ -0,0 +1,179 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/DelayedDestruction.h>
+#include <proxygen/lib/utils/Time.h>
+
+#include <array>
+#include <chrono>
+#include <memory>
+
+namespace folly {
+class RequestContext;
+}
+
+namespace proxygen {
+
+/**
+ * A hierarchical timing wheel running callbacks of any duration off a
+ * single AsyncTimeout, meant to be shared by everything timing out on one
+ * EventBase.
+ *
+ * Time advances in ticks of a fixed interval, and every callback due in
+ * the same tick expires in one batch.  Callbacks are intrusive, and
+ * scheduling, rescheduling and cancelling them are O(1): a callback is
+ * linked into a slot of one of four levels of 256, the first a slot per
+ * tick and each next one a slot per rotation of the level below, and is
+ * moved down every time the wheel below it wraps around.  The timeout is
+ * armed for the next occupied tick or wrap only, so an idle wheel does not
+ * wake up every tick.
+ *
+ * Callbacks never expire early; they expire in the first tick that ends
+ * after their duration, late by up to one tick interval plus however long
+ * the loop was busy.
+ *
+ * Like AsyncTimeoutSet, the wheel must be used and destroyed in its
+ * EventBase thread, and destroying it cancels all its callbacks.
+ */
+class HierarchicalTimingWheel : private folly::AsyncTimeout,
+                                public folly::DelayedDestruction {
+ private:
+  struct Slot;
+
+ public:
+  using UniquePtr = std::unique_ptr<HierarchicalTimingWheel, Destructor>;
+
+  class Callback {
+   public:
+    Callback() {}
+
+    virtual ~Callback();
+
+    /**
+     * timeoutExpired() is invoked when the timeout has expired.
+     */
+    virtual void timeoutExpired() noexcept = 0;
+
+    /**
+     * Cancel the timeout, if it is scheduled.
+     */
+    void cancelTimeout();
+
+    bool isScheduled() const {
+      return wheel_ != nullptr;
+    }
+
+   private:
+    HierarchicalTimingWheel* wheel_{nullptr};
+    Slot* slot_{nullptr};
+    Callback* prev_{nullptr};
+    Callback* next_{nullptr};
+    // tick at which this callback expires
+    uint64_t expiration_{0};
+    std::shared_ptr<folly::RequestContext> context_;
+
+    friend class HierarchicalTimingWheel;
+  };
+
+  static constexpr std::chrono::milliseconds kDefaultTickInterval{10};
+
+  /**
+   * timeUtil, which defaults to the steady clock, must outlive the wheel.
+   */
+  explicit HierarchicalTimingWheel(
+    folly::TimeoutManager* timeoutManager,
+    std::chrono::milliseconds tickInterval = kDefaultTickInterval,
+    const TimeUtil* timeUtil = nullptr);
+
+  /**
+   * Cancels every scheduled callback without invoking it, and destroys the
+   * wheel once it is not running callbacks.
+   */
+  void destroy() override;
+
+  /**
+   * Schedules callback to expire after timeout, rescheduling it if it was
+   * already scheduled, on this or another wheel.
+   */
+  void scheduleTimeout(Callback* callback, std::chrono::milliseconds timeout);
+
+  /**
+   * Runs the callbacks due by now.  Done by the wheel's own timeout; for
+   * callers driving the wheel from another clock.
+   */
+  void runExpired();
+
+  std::chrono::milliseconds getTickInterval() const {
+    return tickInterval_;
+  }
+
+  /**
+   * Number of callbacks scheduled.
+   */
+  size_t count() const {
+    return count_;
+  }
+
+ protected:
+  /**
+   * Use destroy() instead.  See the comments in DelayedDestruction.
+   */
+  ~HierarchicalTimingWheel() override;
+
+ private:
+  static constexpr uint32_t kSlotBits = 8;
+  static constexpr uint32_t kSlots = 1 << kSlotBits;
+  static constexpr uint64_t kSlotMask = kSlots - 1;
+  static constexpr uint32_t kLevels = 4;
+
+  struct Slot {
+    Callback* head{nullptr};
+    Callback* tail{nullptr};
+  };
+
+  HierarchicalTimingWheel(const HierarchicalTimingWheel&) = delete;
+  HierarchicalTimingWheel& operator=(const HierarchicalTimingWheel&) = delete;
+
+  // folly::AsyncTimeout
+  void timeoutExpired() noexcept override;
+
+  uint64_t msSinceStart() const;
+
+  void link(Callback* callback);
+  void unlink(Callback* callback);
+  void cascade();
+  void expireCurrentTick();
+
+  // The next tick holding callbacks in the first level, or at which it wraps
+  uint64_t nextWorkTick() const;
+
+  void armTimeout(uint64_t nowMs);
+
+  const TimeUtil& timeUtil_;
+  TimePoint start_;
+  std::chrono::milliseconds tickInterval_;
+
+  // The last tick run; the wheel's levels are relative to it
+  uint64_t curTick_{0};
+  // The tick the AsyncTimeout is armed for
+  uint64_t wakeupTick_{0};
+  size_t count_{0};
+  bool inRunExpired_{false};
+
+  std::array<std::array<Slot, kSlots>, kLevels> levels_;
+  // Callbacks due beyond the last level, relinked when it wraps
+  Slot overflow_;
+  // Occupied slots of the first level
+  std::array<uint64_t, kSlots / 64> occupied_{};
+};
+
+}
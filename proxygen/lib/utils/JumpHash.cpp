@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/JumpHash.h>
+#include <folly/hash/Hash.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace proxygen {
+
+namespace {
+// Past these draws per rank, the nodes are taken in order, which only
+// happens with extremely skewed weights
+const uint64_t kMaxDraws = 256;
+// The keys sampled per node to measure the error rate, within bounds that
+// keep build() under a tenth of a second
+const size_t kErrorSamplesPerNode = 100;
+const size_t kMinErrorSamples = 100000;
+const size_t kMaxErrorSamples = 1000000;
+
+// Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm"
+size_t jumpConsistentHash(uint64_t key, size_t numBuckets) {
+  int64_t b = -1;
+  int64_t j = 0;
+  while (j < int64_t(numBuckets)) {
+    b = j;
+    key = key * 2862933555777941757ULL + 1;
+    j = int64_t((b + 1) * (double(1LL << 31) / double((key >> 33) + 1)));
+  }
+  return size_t(b);
+}
+}
+
+void JumpHash::build(std::vector<std::pair<
+                     std::string, uint64_t> >& nodes) {
+  weights_.clear();
+  maxWeight_ = 0;
+  numNodes_ = 0;
+  maxErrorRate_ = 0;
+  uint64_t totalWeight = 0;
+  for (auto& node : nodes) {
+    weights_.push_back(node.second);
+    maxWeight_ = std::max(maxWeight_, double(node.second));
+    totalWeight += node.second;
+    if (node.second > 0) {
+      numNodes_++;
+    }
+  }
+  if (numNodes_ == 0) {
+    return;
+  }
+
+  // There is no closed form for the error of the rejections, measure it
+  size_t samples = std::min(
+    kMaxErrorSamples,
+    std::max(kMinErrorSamples, kErrorSamplesPerNode * weights_.size()));
+  std::vector<size_t> distribution(weights_.size());
+  for (size_t i = 0; i < samples; ++i) {
+    distribution[get(folly::hash::twang_mix64(i))]++;
+  }
+  for (size_t i = 0; i < weights_.size(); ++i) {
+    double expected = double(weights_[i]) / totalWeight;
+    double actual = double(distribution[i]) / samples;
+    maxErrorRate_ = std::max(maxErrorRate_, std::fabs(expected - actual));
+  }
+}
+
+size_t JumpHash::draw(const uint64_t key, uint64_t n) const {
+  uint64_t hash = folly::hash::hash_128_to_64(key, n);
+  size_t node = jumpConsistentHash(hash, weights_.size());
+  // The scaled hash is independent of the jump, which uses the high bits
+  double scaledHash = double(folly::hash::twang_mix64(hash)) /
+    std::numeric_limits<uint64_t>::max();
+  return scaledHash * maxWeight_ < weights_[node] ? node : weights_.size();
+}
+
+size_t JumpHash::get(const uint64_t key, const size_t rank) const {
+  if (numNodes_ == 0) {
+    return 0;
+  }
+  return getNth(key, rank % numNodes_);
+}
+
+size_t JumpHash::getNth(const uint64_t key, const size_t modRank) const {
+  std::vector<size_t> found;
+  uint64_t maxDraws = kMaxDraws * (modRank + 1);
+  for (uint64_t n = 0; n < maxDraws; ++n) {
+    auto node = draw(key, n);
+    if (node == weights_.size()) {
+      continue;
+    }
+    if (modRank == 0) {
+      return node;
+    }
+    if (std::find(found.begin(), found.end(), node) == found.end()) {
+      if (found.size() == modRank) {
+        return node;
+      }
+      found.push_back(node);
+    }
+  }
+  for (size_t node = 0; node < weights_.size(); ++node) {
+    if (weights_[node] > 0 &&
+        std::find(found.begin(), found.end(), node) == found.end()) {
+      if (found.size() == modRank) {
+        return node;
+      }
+      found.push_back(node);
+    }
+  }
+  return found.back();
+}
+
+double JumpHash::getMaxErrorRate() const {
+  return maxErrorRate_;
+}
+
+}
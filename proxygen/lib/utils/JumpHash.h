@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <proxygen/lib/utils/ConsistentHash.h>
+
+namespace proxygen {
+/*
+ * Weighted jump consistent hash.  get() draws a node with jump consistent
+ * hash, whose cost grows with the log of the number of nodes, and keeps it
+ * with a probability of its weight over the largest weight, else draws
+ * again from a rehashed key.  It needs no memory besides the weights, but
+ * the nodes are identified by their index: nodes can only be added or
+ * removed at the end of the vector.  Lowering a weight only moves keys away
+ * from that node.
+ *
+ * The draws grow with the ratio of the largest weight to the average one.
+ */
+class JumpHash : public ConsistentHash {
+ public:
+  double getMaxErrorRate() const override;
+
+  void build(std::vector<std::pair<std::string, uint64_t>>&) override;
+
+  size_t get(const uint64_t key, const size_t rank = 0) const override;
+
+ private:
+  size_t getNth(const uint64_t key, const size_t modRank) const;
+  // The node of draw, nodes_.size() if rejected
+  size_t draw(const uint64_t key, uint64_t draw) const;
+
+  std::vector<uint64_t> weights_;
+  double maxWeight_{0};
+  // The nodes of non zero weight
+  size_t numNodes_{0};
+  double maxErrorRate_{0};
+};
+
+} // proxygen
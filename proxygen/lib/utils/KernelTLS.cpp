@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/KernelTLS.h>
+
+#include <folly/portability/OpenSSL.h>
+
+namespace proxygen {
+
+bool enableKernelTLS(folly::SSLContext& ctx) {
+#ifdef SSL_OP_ENABLE_KTLS
+  auto sslCtx = ctx.getSSLCtx();
+  // Contexts are shared by the acceptor threads, only write them once
+  if ((SSL_CTX_get_options(sslCtx) & SSL_OP_ENABLE_KTLS) == 0) {
+    SSL_CTX_set_options(sslCtx, SSL_OP_ENABLE_KTLS);
+    // Tickets are handshake records, which the BIO would send as data
+    SSL_CTX_set_num_tickets(sslCtx, 0);
+  }
+  return true;
+#else
+  (void)ctx;
+  return false;
+#endif
+}
+
+bool onKernelTLSHandshake(folly::AsyncSSLSocket& sslSocket) {
+#ifdef SSL_OP_ENABLE_KTLS
+  if (!kernelTLSSendEnabled(sslSocket)) {
+    return false;
+  }
+  // close_notify is an alert record, which the BIO would send as data
+  SSL_set_quiet_shutdown(const_cast<SSL*>(sslSocket.getSSL()), 1);
+  return true;
+#else
+  (void)sslSocket;
+  return false;
+#endif
+}
+
+bool kernelTLSSendEnabled(const folly::AsyncSSLSocket& sslSocket) {
+#ifdef SSL_OP_ENABLE_KTLS
+  auto ssl = sslSocket.getSSL();
+  return ssl && BIO_get_ktls_send(SSL_get_wbio(ssl));
+#else
+  (void)sslSocket;
+  return false;
+#endif
+}
+
+}
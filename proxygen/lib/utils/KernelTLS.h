@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/SSLContext.h>
+
+namespace proxygen {
+
+/**
+ * Kernel TLS offload of OpenSSL sessions.
+ *
+ * With it enabled on a context, OpenSSL hands the traffic keys of every
+ * session it completes to the kernel (TCP_ULP "tls"), which then encrypts
+ * and decrypts the records on the socket.  Whenever either the kernel or
+ * the cipher suite does not support it, OpenSSL silently keeps encrypting
+ * in user space.
+ *
+ * Writes still go through the socket's user space BIO once offloaded, which
+ * can only send application data.  Contexts with kernel TLS therefore do
+ * not issue TLS 1.3 session tickets after the handshake, and offloaded
+ * sessions are shut down without a close_notify.  Fizz sessions are not
+ * offloaded.
+ */
+
+/**
+ * Enables kernel TLS for the sessions of ctx that have yet to handshake.
+ * Returns false if OpenSSL was built without it.
+ */
+bool enableKernelTLS(folly::SSLContext& ctx);
+
+/**
+ * To call once the handshake of sslSocket completed; returns whether its
+ * writes are encrypted by the kernel.
+ */
+bool onKernelTLSHandshake(folly::AsyncSSLSocket& sslSocket);
+
+/**
+ * Whether the kernel encrypts the writes of sslSocket, so that it may also
+ * be written directly, as with sendfile(2).
+ */
+bool kernelTLSSendEnabled(const folly::AsyncSSLSocket& sslSocket);
+
+}
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/LatencyHistogram.h>
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace proxygen {
+
+constexpr uint32_t LatencyHistogram::kSubBucketBits;
+constexpr uint32_t LatencyHistogram::kMaxBits;
+constexpr size_t LatencyHistogram::kNumBuckets;
+
+namespace {
+const uint64_t kSubBuckets = uint64_t(1) << LatencyHistogram::kSubBucketBits;
+const uint64_t kMaxValue = (uint64_t(1) << LatencyHistogram::kMaxBits) - 1;
+}
+
+size_t LatencyHistogram::getBucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  value = std::min(value, kMaxValue);
+  // the first is a bucket per value, then a group of kSubBuckets per bit
+  uint32_t bits = folly::findLastSet(value);
+  uint32_t shift = bits - 1 - kSubBucketBits;
+  return ((shift + 1) << kSubBucketBits) + (value >> shift) - kSubBuckets;
+}
+
+uint64_t LatencyHistogram::getBucketMax(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  uint32_t shift = (index >> kSubBucketBits) - 1;
+  uint64_t first = (kSubBuckets + (index & (kSubBuckets - 1))) << shift;
+  return first + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::addValue(uint64_t value, uint64_t count) {
+  buckets_[getBucketIndex(value)] += count;
+  count_ += count;
+  sum_ += value * count;
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::getPercentile(double pct) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto rank = std::max<uint64_t>(
+    uint64_t(std::ceil(std::max(0.0, std::min(pct, 100.0)) / 100 * count_)),
+    1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(getBucketMax(i), max_);
+    }
+  }
+  return max_;
+}
+
+void ConcurrentLatencyHistogram::addValue(uint64_t value) {
+  increment(buckets_[LatencyHistogram::getBucketIndex(value)], 1);
+  increment(sum_, value);
+  if (value > max_.load(std::memory_order_relaxed)) {
+    max_.store(value, std::memory_order_relaxed);
+  }
+}
+
+void ConcurrentLatencyHistogram::addTo(LatencyHistogram& snapshot) const {
+  for (size_t i = 0; i < LatencyHistogram::kNumBuckets; i++) {
+    auto count = buckets_[i].load(std::memory_order_relaxed);
+    snapshot.buckets_[i] += count;
+    snapshot.count_ += count;
+  }
+  snapshot.sum_ += sum_.load(std::memory_order_relaxed);
+  snapshot.max_ = std::max(snapshot.max_,
+                           max_.load(std::memory_order_relaxed));
+}
+
+}
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace proxygen {
+
+/**
+ * An HDR-style histogram of non-negative values, such as latencies in
+ * microseconds.
+ *
+ * Values below 2^kSubBucketBits each have their own bucket, and every power
+ * of two above is split in 2^kSubBucketBits linear buckets, so a value is
+ * reported within 1/32 of itself whatever its magnitude.  Values of
+ * 2^kMaxBits and above are counted as the largest value below.
+ *
+ * This is the plain, single threaded, version, into which the
+ * ConcurrentLatencyHistograms of several threads are snapshotted.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr uint32_t kSubBucketBits = 5;
+  static constexpr uint32_t kMaxBits = 40;
+  static constexpr size_t kNumBuckets =
+    (kMaxBits - kSubBucketBits + 1) << kSubBucketBits;
+
+  static size_t getBucketIndex(uint64_t value);
+
+  // The largest value counted in bucket index
+  static uint64_t getBucketMax(size_t index);
+
+  void addValue(uint64_t value, uint64_t count = 1);
+
+  void merge(const LatencyHistogram& other);
+
+  uint64_t getCount() const {
+    return count_;
+  }
+
+  uint64_t getSum() const {
+    return sum_;
+  }
+
+  uint64_t getMax() const {
+    return max_;
+  }
+
+  double getAverage() const {
+    return count_ ? double(sum_) / count_ : 0;
+  }
+
+  /**
+   * The value pct percent of the values are at or below, with pct in
+   * [0, 100], up to the precision of the buckets.  0 when empty.
+   */
+  uint64_t getPercentile(double pct) const;
+
+  uint64_t getBucketCount(size_t index) const {
+    return buckets_[index];
+  }
+
+ private:
+  friend class ConcurrentLatencyHistogram;
+
+  std::array<uint64_t, kNumBuckets> buckets_{};
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t max_{0};
+};
+
+/**
+ * A LatencyHistogram a single thread adds values to, while any other can
+ * take snapshots of it.  Adding a value is a few relaxed loads and stores,
+ * without locked instructions or fences, and a snapshot only reads, so
+ * taking one does not slow down the writer.  A snapshot taken while values
+ * are added may miss the latest of them, or count one in its bucket and not
+ * in the sum yet.
+ */
+class ConcurrentLatencyHistogram {
+ public:
+  // Only one thread at a time may add values
+  void addValue(uint64_t value);
+
+  // Adds the values seen so far to snapshot
+  void addTo(LatencyHistogram& snapshot) const;
+
+ private:
+  static void increment(std::atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount,
+                  std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint64_t>, LatencyHistogram::kNumBuckets> buckets_{};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+}
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/MaglevHash.h>
+#include <folly/hash/Hash.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace proxygen {
+
+namespace {
+const size_t kSlotsPerNode = 100;
+const uint32_t kEmptySlot = std::numeric_limits<uint32_t>::max();
+// The table sizes, primes about doubling, so that the size and then most
+// of the slots do not change with one more or one less node
+const size_t kTableSizes[] = {
+  65537, 131071, 262139, 524287, 1048573, 2097143, 4194301, 8388593,
+  16777213, 33554393, 67108859,
+};
+
+size_t getTableSize(size_t minSize) {
+  for (auto size : kTableSizes) {
+    if (size >= minSize) {
+      return size;
+    }
+  }
+  return kTableSizes[sizeof(kTableSizes) / sizeof(kTableSizes[0]) - 1];
+}
+}
+
+MaglevHash::MaglevHash(size_t minTableSize)
+    : minTableSize_(minTableSize) {
+}
+
+void MaglevHash::build(std::vector<std::pair<
+                       std::string, uint64_t> >& nodes) {
+  table_.clear();
+  numNodes_ = 0;
+  maxErrorRate_ = 0;
+  uint64_t maxWeight = 0;
+  uint64_t totalWeight = 0;
+  for (auto& node : nodes) {
+    maxWeight = std::max(maxWeight, node.second);
+    totalWeight += node.second;
+  }
+  if (maxWeight == 0) {
+    return;
+  }
+
+  size_t size = getTableSize(std::max(minTableSize_,
+                                      kSlotsPerNode * nodes.size()));
+  // Each node walks the table from its offset by its skip, which visits
+  // every slot as the size is prime
+  struct Permutation {
+    uint64_t offset;
+    uint64_t skip;
+    uint64_t next;
+    double credit;
+  };
+  std::vector<Permutation> permutations;
+  permutations.reserve(nodes.size());
+  for (auto& node : nodes) {
+    uint64_t hash = folly::hash::fnv64_buf(node.first.data(),
+                                           node.first.size());
+    permutations.push_back({hash % size,
+                            folly::hash::twang_mix64(hash) % (size - 1) + 1,
+                            0, 0});
+  }
+
+  // The nodes take their next preferred free slot in turn, the lighter
+  // ones only every maxWeight / weight turns
+  table_.assign(size, kEmptySlot);
+  std::vector<size_t> slots(nodes.size());
+  size_t filled = 0;
+  while (filled < size) {
+    for (size_t i = 0; i < nodes.size() && filled < size; ++i) {
+      auto& perm = permutations[i];
+      perm.credit += double(nodes[i].second) / maxWeight;
+      if (perm.credit < 1) {
+        continue;
+      }
+      perm.credit -= 1;
+      size_t slot;
+      do {
+        slot = (perm.offset + perm.next * perm.skip) % size;
+        perm.next++;
+      } while (table_[slot] != kEmptySlot);
+      table_[slot] = uint32_t(i);
+      slots[i]++;
+      filled++;
+    }
+  }
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (slots[i] > 0) {
+      numNodes_++;
+    }
+    double expected = double(nodes[i].second) / totalWeight;
+    double actual = double(slots[i]) / size;
+    maxErrorRate_ = std::max(maxErrorRate_, std::fabs(expected - actual));
+  }
+}
+
+size_t MaglevHash::get(const uint64_t key, const size_t rank) const {
+  if (table_.empty()) {
+    return 0;
+  }
+  size_t slot = folly::hash::twang_mix64(key) % table_.size();
+  size_t modRank = rank % numNodes_;
+  if (modRank == 0) {
+    return table_[slot];
+  }
+  // The nodes found walking the table rank the key
+  std::vector<uint32_t> found;
+  found.reserve(modRank + 1);
+  while (true) {
+    auto node = table_[slot];
+    if (std::find(found.begin(), found.end(), node) == found.end()) {
+      if (found.size() == modRank) {
+        return node;
+      }
+      found.push_back(node);
+    }
+    slot = (slot + 1) % table_.size();
+  }
+}
+
+double MaglevHash::getMaxErrorRate() const {
+  return maxErrorRate_;
+}
+
+}
@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <proxygen/lib/utils/ConsistentHash.h>
+
+namespace proxygen {
+/*
+ * Weighted Maglev hash.  build() fills a lookup table, whose size is a prime
+ * much larger than the number of nodes, with the preferred slots of each
+ * node in turn, so that get() is a single table lookup.  Adding a node or
+ * changing a weight moves few keys besides those that must move, though
+ * slightly more than RendezvousHash does.
+ *
+ * get() with a rank walks the table from the slot of the key, so it is only
+ * fast for small ranks.
+ */
+class MaglevHash : public ConsistentHash {
+ public:
+  /**
+   * The table has at least minTableSize slots and 100 per node, up to 64M.
+   */
+  explicit MaglevHash(size_t minTableSize = 0);
+
+  double getMaxErrorRate() const override;
+
+  void build(std::vector<std::pair<std::string, uint64_t>>&) override;
+
+  size_t get(const uint64_t key, const size_t rank = 0) const override;
+
+ private:
+  size_t minTableSize_;
+  std::vector<uint32_t> table_;
+  // The nodes in the table
+  size_t numNodes_{0};
+  double maxErrorRate_{0};
+};
+
+} // proxygen
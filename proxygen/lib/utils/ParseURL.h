@@ -19,7 +19,8 @@
 namespace proxygen {
 
 // ParseURL can handle non-fully-formed URLs. This class must not persist beyond
-// the lifetime of the buffer underlying the input StringPiece
+// the lifetime of the buffer underlying the input StringPiece, which it never
+// copies: every component is a range of it.
 
 class ParseURL {
  public:
@@ -44,7 +45,7 @@ class ParseURL {
   }
 
   std::string authority() const {
-    return authority_;
+    return authority_.str();
   }
 
   bool hasHost() const {
@@ -101,7 +102,7 @@ class ParseURL {
 
   folly::StringPiece url_;
   folly::StringPiece scheme_;
-  std::string authority_;
+  folly::StringPiece authority_;
   folly::StringPiece host_;
   folly::StringPiece hostNoBrackets_;
   folly::StringPiece path_;
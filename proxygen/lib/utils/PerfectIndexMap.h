@@ -13,9 +13,17 @@
 
 #include <folly/FBVector.h>
 #include <folly/Optional.h>
+#include <folly/lang/Bits.h>
+#include <folly/small_vector.h>
 #include <proxygen/lib/utils/UtilInl.h>
 #include <string>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // TODO: consider changing API methods that take in an reference with versions
 // that don't so that callers can give up ownership if they like via std::move
 // operator (and subsequently we would use it as well).
@@ -40,13 +48,16 @@ namespace proxygen {
 //    duplicate keys.  It is mainly used for optimization purposes as the
 //    implementation of default handling adds additional useless work for such
 //    cases in which duplicates are not tolerated.
+// InlineEntries is the number of entries stored within the map itself, before
+//    any is allocated.
 template <
   typename Key,
   Key OtherKey,
   Key NoneKey,
   Key (*PerfectHashStrToKey)(const std::string&),
   bool AllowDuplicates,
-  bool CaseInsensitive>
+  bool CaseInsensitive,
+  size_t InlineEntries = 8>
 class PerfectIndexMap {
  public:
   static_assert(sizeof(Key) == 1, "Key must be of size 1 byte.");
@@ -140,17 +151,17 @@ class PerfectIndexMap {
   // implementation source.
 
   const std::string * getSingleKey(Key key) const {
-    const Key* data = keys_.data();
-    if (data) {
-      auto offset = searchForKey(key, data);
-      if (data) {
-        if (AllowDuplicates && searchForKey(key, ++data) != -1) {
-            return nullptr;
-        }
-        return &values_[offset];
+    const std::string* result = nullptr;
+    forEachKeyIndex(key, [&] (size_t index) {
+      if (result) {
+        // a second value is found
+        result = nullptr;
+        return false;
       }
-    }
-    return nullptr;
+      result = &values_[index];
+      return AllowDuplicates;
+    });
+    return result;
   }
   const std::string* getSingleOtherKey(const std::string &keyStr) const {
     size_t searchIndex = 0;
@@ -165,25 +176,16 @@ class PerfectIndexMap {
   }
 
   void setKey(Key key, const std::string &value) {
-    const Key* data = keys_.data();
     bool set = false;
-    std::ptrdiff_t offset;
-    while (data) {
-      offset = searchForKey(key, data);
-      if (data) {
-        if (!set) {
-          replaceKeyAtIndex(offset, key, value);
-          if (AllowDuplicates) {
-            set = true;
-          } else {
-            return;
-          }
-        } else {
-          removeAtIndex(offset);
-        }
-        ++data;
+    forEachKeyIndex(key, [&] (size_t index) {
+      if (!set) {
+        replaceKeyAtIndex(index, key, value);
+        set = true;
+      } else {
+        removeAtIndex(index);
       }
-    }
+      return AllowDuplicates;
+    });
     if (!set) {
       addKeyToIndex(key, value);
     }
@@ -210,20 +212,12 @@ class PerfectIndexMap {
   }
 
   bool removeKey(Key key) {
-    const Key* data = keys_.data();
     bool anyRemoved = false;
-    std::ptrdiff_t offset;
-    while (data) {
-      offset = searchForKey(key, data);
-      if (data) {
-        removeAtIndex(offset);
-        anyRemoved = true;
-        if (!AllowDuplicates) {
-          break;
-        }
-        ++data;
-      }
-    }
+    forEachKeyIndex(key, [&] (size_t index) {
+      removeAtIndex(index);
+      anyRemoved = true;
+      return AllowDuplicates;
+    });
     return anyRemoved;
   }
   bool removeOtherKey(const std::string &keyStr) {
@@ -240,20 +234,58 @@ class PerfectIndexMap {
     return anyRemoved;
   }
 
-  // Utility methods for searching our index.  The data pointer / start index
-  // are passed by reference so they can be updated by the search itself.  The
-  // methods return on the first occurrence found from the specified start
-  // searching position.
-  std::ptrdiff_t searchForKey(Key key, const Key* &data) const {
-    if (data) {
-      data = (Key*)memchr(
-        (void*)data, key, keys_.size() - (data - keys_.data()));
-      if (data) {
-        return data - keys_.data();
+  // Utility methods for searching our index.
+  //
+  // Calls fn with the index in keys_ of each occurrence of key, in order, for
+  // as long as it returns true.  The positions of a block of keys are all
+  // found by one vector compare, so fn may remove the ones it is given.
+  template <typename Fn>
+  void forEachKeyIndex(Key key, Fn fn) const {
+    const Key* data = keys_.data();
+    size_t size = keys_.size();
+    size_t i = 0;
+#if defined(__SSE2__)
+    // Gives fn the positions of the bits set in mask, from i
+    auto forEachBit = [&] (uint32_t mask) {
+      for (; mask != 0; mask &= mask - 1) {
+        if (!fn(i + folly::findFirstSet(mask) - 1)) {
+          return false;
+        }
+      }
+      return true;
+    };
+#endif
+#if defined(__AVX2__)
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(key));
+    for (; size - i >= 32; i += 32) {
+      __m256i block = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(data + i));
+      if (!forEachBit(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(block, needle)))) {
+        return;
+      }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i needle16 = _mm_set1_epi8(static_cast<char>(key));
+    for (; size - i >= 16; i += 16) {
+      __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(data + i));
+      if (!forEachBit(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16)))) {
+        return;
+      }
+    }
+#endif
+    for (; i < size; ++i) {
+      if (data[i] == key && !fn(i)) {
+        return;
       }
     }
-    return -1;
   }
+
+  // The start index is passed by reference so it can be updated by the
+  // search itself.  Returns on the first occurrence found from the specified
+  // start searching position.
   std::ptrdiff_t searchForOtherKey(
       const std::string &keyStr, size_t &startIndex) const {
     while (startIndex < otherKeyNamesKeysIndex_.size()) {
@@ -349,7 +381,7 @@ class PerfectIndexMap {
   // The total size of the map is thus always <= keys_.size().
   // The reason it is not always == is because the map supports removals and on
   // such operations, we do not resize this vector.
-  folly::fbvector<Key> keys_;
+  folly::small_vector<Key, InlineEntries> keys_;
 
   // A vector used to reverse lookup a particular OtherKey's entry
   // (in otherKeyNames_) position within keys_.
@@ -369,7 +401,7 @@ class PerfectIndexMap {
 
   // Storage for all values, OtherKey or other.
   // Thus values_.size() == keys_.size().
-  folly::fbvector<std::string> values_;
+  folly::small_vector<std::string, InlineEntries> values_;
 };
 
 } // proxygen
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace proxygen {
+
+namespace detail {
+// Shared by every list with the same Tag, whatever their block size
+template <typename Tag>
+struct FreeListSwitch {
+  static std::atomic<bool> enabled;
+};
+
+template <typename Tag>
+std::atomic<bool> FreeListSwitch<Tag>::enabled{false};
+}
+
+/**
+ * A per-thread cache of freed blocks of kBlockSize bytes, handed back out by
+ * the next allocations of that size on the same thread.  Since every
+ * EventBase runs on a thread of its own, this amounts to a free list per
+ * EventBase for objects allocated and freed in its loop.
+ *
+ * Recycling is off until enable(true) is called for the Tag.  Every block
+ * comes from ::operator new(kBlockSize) either way, so blocks can be freed
+ * with recycling on or off and on any thread; at most kMaxBlocks are kept
+ * per thread and the rest are returned to the allocator.
+ *
+ * Tag distinguishes lists of the same block size owned by unrelated types.
+ */
+template <typename Tag, size_t kBlockSize, size_t kMaxBlocks = 1024>
+class ThreadLocalFreeList {
+  static_assert(kBlockSize >= sizeof(void*), "Blocks must hold a pointer");
+
+ public:
+  static void enable(bool enabled) {
+    detail::FreeListSwitch<Tag>::enabled.store(enabled,
+                                               std::memory_order_relaxed);
+  }
+
+  static bool enabled() {
+    return detail::FreeListSwitch<Tag>::enabled.load(
+      std::memory_order_relaxed);
+  }
+
+  static void* allocate() {
+    auto& list = getList();
+    if (list.head) {
+      auto block = list.head;
+      list.head = block->next;
+      list.count--;
+      return block;
+    }
+    return ::operator new(kBlockSize);
+  }
+
+  static void deallocate(void* p) {
+    auto& list = getList();
+    if (!enabled() || list.count >= kMaxBlocks) {
+      ::operator delete(p);
+      return;
+    }
+    auto block = static_cast<Block*>(p);
+    block->next = list.head;
+    list.head = block;
+    list.count++;
+  }
+
+  // Number of blocks cached on the calling thread
+  static size_t cached() {
+    return getList().count;
+  }
+
+ private:
+  struct Block {
+    Block* next;
+  };
+
+  struct List {
+    ~List() {
+      while (head) {
+        auto next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+
+    Block* head{nullptr};
+    size_t count{0};
+  };
+
+  static List& getList() {
+    static thread_local List list;
+    return list;
+  }
+};
+
+/**
+ * Allocator serving single objects from a ThreadLocalFreeList, for the nodes
+ * of node based containers.  Arrays go straight to the global allocator.
+ * Containers rebind it to their node type, so recycling is switched with
+ * RecyclingAllocator<Tag, T>::FreeList::enable() for any T.
+ */
+template <typename Tag, typename T>
+class RecyclingAllocator {
+ public:
+  using value_type = T;
+  using FreeList = ThreadLocalFreeList<Tag, sizeof(T) < sizeof(void*) ?
+                                       sizeof(void*) : sizeof(T)>;
+
+  template <typename U>
+  struct rebind {
+    using other = RecyclingAllocator<Tag, U>;
+  };
+
+  RecyclingAllocator() = default;
+
+  template <typename U>
+  /* implicit */ RecyclingAllocator(const RecyclingAllocator<Tag, U>&) {}
+
+  T* allocate(size_t n) {
+    if (n == 1) {
+      return static_cast<T*>(FreeList::allocate());
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (n == 1) {
+      FreeList::deallocate(p);
+    } else {
+      ::operator delete(p);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const RecyclingAllocator<Tag, U>&) const {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const RecyclingAllocator<Tag, U>&) const {
+    return false;
+  }
+};
+
+}
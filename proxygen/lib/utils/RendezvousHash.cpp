@@ -17,12 +17,23 @@
 #include <math.h>       /* pow */
 
 namespace proxygen {
+
+namespace {
+// The ranks up to which the batched selection keeps the best nodes in
+// order rather than partitioning all of them
+const size_t kMaxInsertionRank = 32;
+}
+
 void RendezvousHash::build(std::vector<std::pair<
                            std::string, uint64_t> >&nodes) {
   for (auto it = nodes.begin(); it != nodes.end(); ++it) {
     std::string key = it->first;
     uint64_t weight = it->second;
     weights_.emplace_back(computeHash(key.c_str(), key.size()), weight);
+    nodeHashes_.push_back(weights_.back().first);
+    exponents_.push_back(weight == 0 ? 0 : (double)1 / weight);
+    uniformWeights_ = uniformWeights_ && weight != 0 &&
+      weight == weights_.front().second;
   }
 }
 
@@ -211,6 +222,102 @@ std::vector<size_t> RendezvousHash::selectNUnweighted(const uint64_t key,
   return selection;
 }
 
+void RendezvousHash::selectNUnweighted(folly::Range<const uint64_t*> keys,
+                                       const size_t rank,
+                                       std::vector<size_t>& selections) const {
+  if (rank >= weights_.size()) {
+    selections.reserve(selections.size() + keys.size() * weights_.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      for (size_t n = 0; n < weights_.size(); ++n) {
+        selections.push_back(n);
+      }
+    }
+    return;
+  }
+
+  selections.reserve(selections.size() +
+                     keys.size() * std::max<size_t>(rank, 1));
+  // The scores only need to rank the nodes as the scaled weights of
+  // getNthByWeightedHash() do.  With equal weights, the combined hashes
+  // themselves do, as pow() is increasing.  Otherwise log(h) / w does,
+  // and costs less than pow(h, 1 / w).
+  if (uniformWeights_) {
+    std::vector<uint64_t> scores(nodeHashes_.size());
+    std::vector<std::pair<uint64_t, size_t>> scratch;
+    for (auto key : keys) {
+      for (size_t i = 0; i < nodeHashes_.size(); ++i) {
+        scores[i] = computeHash(nodeHashes_[i] + key);
+      }
+      selectTop(scores, rank, scratch, selections);
+    }
+  } else {
+    std::vector<double> scores(nodeHashes_.size());
+    std::vector<std::pair<double, size_t>> scratch;
+    for (auto key : keys) {
+      for (size_t i = 0; i < nodeHashes_.size(); ++i) {
+        scores[i] = (double)computeHash(nodeHashes_[i] + key) /
+          std::numeric_limits<uint64_t>::max();
+      }
+      for (size_t i = 0; i < nodeHashes_.size(); ++i) {
+        scores[i] = exponents_[i] == 0 ?
+          -std::numeric_limits<double>::infinity() :
+          log(scores[i]) * exponents_[i];
+      }
+      selectTop(scores, rank, scratch, selections);
+    }
+  }
+}
+
+template <typename Score>
+void RendezvousHash::selectTop(
+    const std::vector<Score>& scores,
+    const size_t rank,
+    std::vector<std::pair<Score, size_t>>& scratch,
+    std::vector<size_t>& selections) {
+  if (rank == 0) {
+    // The first of the best, as getNthByWeightedHash() picks it
+    size_t best = 0;
+    for (size_t i = 1; i < scores.size(); ++i) {
+      if (scores[i] > scores[best]) {
+        best = i;
+      }
+    }
+    selections.push_back(best);
+    return;
+  }
+
+  scratch.clear();
+  if (rank > kMaxInsertionRank) {
+    for (size_t i = 0; i < scores.size(); ++i) {
+      scratch.emplace_back(scores[i], i);
+    }
+    std::nth_element(scratch.begin(), scratch.begin() + rank, scratch.end(),
+                     std::greater<std::pair<Score, size_t>>());
+    scratch.resize(rank);
+  } else {
+    // The best so far in order; most nodes are not better than the last
+    for (size_t i = 0; i < scores.size(); ++i) {
+      if (scratch.size() == rank) {
+        // Ties go to the later node, as with the pairs compared by
+        // nth_element()
+        if (scores[i] < scratch.back().first) {
+          continue;
+        }
+        scratch.pop_back();
+      }
+      auto pos = scratch.size();
+      scratch.emplace_back(scores[i], i);
+      while (pos > 0 && scratch[pos - 1].first <= scores[i]) {
+        std::swap(scratch[pos - 1], scratch[pos]);
+        pos--;
+      }
+    }
+  }
+  for (auto& entry : scratch) {
+    selections.push_back(entry.second);
+  }
+}
+
 uint64_t RendezvousHash::computeHash(const char* data, size_t len) const {
   return folly::hash::fnv64_buf(data, len);
 }
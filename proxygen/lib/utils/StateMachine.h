@@ -9,11 +9,62 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <folly/CPortability.h>
+#include <folly/Likely.h>
 #include <glog/logging.h>
 #include <tuple>
+#include <utility>
 
 namespace proxygen {
 
+/**
+ * The transitions of a state machine as a 2-D array indexed by state and
+ * event, built at compile time from the list of them, for T::find():
+ *
+ *   using Table = TransitionTable<State, Event, kNumStates, kNumEvents>;
+ *   static constexpr Table::Transition kTransitions[] = {
+ *     {State::Start, Event::onHeaders, State::HeadersReceived}, ...};
+ *   static constexpr Table kTable(kTransitions);
+ *   return kTable.find(s, e);
+ *
+ * State and Event are enums numbered from 0, with fewer than 255 states.
+ */
+template <typename State, typename Event, size_t kNumStates, size_t kNumEvents>
+class TransitionTable {
+ public:
+  static_assert(kNumStates < 255, "states must fit a uint8_t entry");
+
+  struct Transition {
+    State from;
+    Event event;
+    State to;
+  };
+
+  template <size_t N>
+  constexpr explicit TransitionTable(const Transition (&transitions)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+      next_[index(transitions[i].from)][index(transitions[i].event)] =
+        static_cast<uint8_t>(index(transitions[i].to) + 1);
+    }
+  }
+
+  // The state event leads to from s, and whether it is a valid transition
+  constexpr std::pair<State, bool> find(State s, Event e) const {
+    uint8_t next = next_[index(s)][index(e)];
+    return std::make_pair(next ? static_cast<State>(next - 1) : s, next != 0);
+  }
+
+ private:
+  template <typename E>
+  static constexpr size_t index(E e) {
+    return static_cast<size_t>(e);
+  }
+
+  // 0 where there is no transition, the next state + 1 otherwise
+  uint8_t next_[kNumStates][kNumEvents]{};
+};
+
 template <typename T>
 class StateMachine {
  public:
@@ -29,16 +80,12 @@ class StateMachine {
     State newState;
 
     std::tie(newState, ok) = T::find(state, event);
-    if (!ok) {
-      LOG(ERROR) << T::getName() << ": invalid transition tried: " << state
-                 << " " << event;
+    if (UNLIKELY(!ok)) {
+      logInvalidTransition(state, event);
       return false;
-    } else {
-      VLOG(6) << T::getName() << ": transitioning from " << state << " to "
-              << newState;
-      state = newState;
-      return true;
     }
+    state = newState;
+    return true;
   }
 
   static bool canTransit(const State state, Event event) {
@@ -47,6 +94,13 @@ class StateMachine {
     std::tie(std::ignore, ok) = T::find(state, event);
     return ok;
   }
+
+ private:
+  // Out of line, to keep transit() small enough to inline in every caller
+  FOLLY_NOINLINE static void logInvalidTransition(State state, Event event) {
+    LOG(ERROR) << T::getName() << ": invalid transition tried: " << state
+               << " " << event;
+  }
 };
 
 }
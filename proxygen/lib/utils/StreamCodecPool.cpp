@@ -0,0 +1,129 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/StreamCodecPool.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+#include <proxygen/lib/utils/ZstdStreamDecompressor.h>
+
+DEFINE_int32(stream_codec_pool_size, 16,
+             "Compressors and decompressors pooled per thread, type and "
+             "compression level");
+
+namespace proxygen {
+
+namespace {
+
+// Decompressors have no level
+const int kNoLevel = 0;
+
+struct Pools {
+  ~Pools();
+
+  using Key = std::pair<CompressionType, int>;
+  std::map<Key, std::vector<std::unique_ptr<StreamCompressor>>> compressors;
+  std::map<Key, std::vector<std::unique_ptr<StreamDecompressor>>>
+    decompressors;
+};
+
+thread_local Pools pools;
+// Codecs released during the thread's exit are destroyed
+thread_local bool poolsDestroyed = false;
+
+Pools::~Pools() {
+  poolsDestroyed = true;
+}
+
+template <typename Codec>
+std::unique_ptr<Codec> take(
+    std::map<Pools::Key, std::vector<std::unique_ptr<Codec>>>& pool,
+    const Pools::Key& key) {
+  auto it = pool.find(key);
+  if (it == pool.end() || it->second.empty()) {
+    return nullptr;
+  }
+  auto codec = std::move(it->second.back());
+  it->second.pop_back();
+  return codec;
+}
+
+std::map<Pools::Key, std::vector<std::unique_ptr<StreamCompressor>>>&
+getPool(StreamCompressor*) {
+  return pools.compressors;
+}
+
+std::map<Pools::Key, std::vector<std::unique_ptr<StreamDecompressor>>>&
+getPool(StreamDecompressor*) {
+  return pools.decompressors;
+}
+
+template <typename Codec>
+void release(Codec* codec, const Pools::Key& key) {
+  std::unique_ptr<Codec> owned(codec);
+  if (poolsDestroyed || owned->hasError() || !owned->reset()) {
+    return;
+  }
+  auto& free = getPool(codec)[key];
+  if (free.size() < size_t(std::max(FLAGS_stream_codec_pool_size, 0))) {
+    free.push_back(std::move(owned));
+  }
+}
+}
+
+std::shared_ptr<StreamCompressor> StreamCodecPool::getCompressor(
+    CompressionType type, int level) {
+  Pools::Key key(type, level);
+  auto compressor = poolsDestroyed ? nullptr : take(pools.compressors, key);
+  if (!compressor) {
+    compressor = makeStreamCompressor(type, level);
+    if (!compressor) {
+      return nullptr;
+    }
+  }
+  return std::shared_ptr<StreamCompressor>(
+    compressor.release(),
+    [key] (StreamCompressor* released) { release(released, key); });
+}
+
+std::shared_ptr<StreamDecompressor> StreamCodecPool::getDecompressor(
+    CompressionType type) {
+  Pools::Key key(type, kNoLevel);
+  auto decompressor =
+    poolsDestroyed ? nullptr : take(pools.decompressors, key);
+  if (!decompressor) {
+    if (type == CompressionType::ZSTD) {
+      decompressor = std::make_unique<ZstdStreamDecompressor>();
+    } else {
+      decompressor = std::make_unique<ZlibStreamDecompressor>(type);
+    }
+  }
+  return std::shared_ptr<StreamDecompressor>(
+    decompressor.release(),
+    [key] (StreamDecompressor* released) { release(released, key); });
+}
+
+size_t StreamCodecPool::getNumPooled() {
+  if (poolsDestroyed) {
+    return 0;
+  }
+  size_t numPooled = 0;
+  for (const auto& free : pools.compressors) {
+    numPooled += free.second.size();
+  }
+  for (const auto& free : pools.decompressors) {
+    numPooled += free.second.size();
+  }
+  return numPooled;
+}
+
+}
@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/portability/GFlags.h>
+#include <memory>
+
+#include <proxygen/lib/utils/StreamCompressor.h>
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+DECLARE_int32(stream_codec_pool_size);
+
+namespace proxygen {
+
+/**
+ * Per-thread pools of compressors and decompressors, reset rather than
+ * destroyed at the end of their stream so that each response doesn't
+ * allocate and initialize a new context (about 256KB for zlib).
+ *
+ * The codecs return to the pool of the thread releasing them, up to
+ * --stream_codec_pool_size per type and level.  Codecs with errors, or that
+ * can't be reset, are destroyed.
+ */
+class StreamCodecPool {
+ public:
+  /**
+   * A compressor of type at level, pooled or new.  Returns nullptr if the
+   * type is not supported.
+   */
+  static std::shared_ptr<StreamCompressor> getCompressor(CompressionType type,
+                                                         int level);
+
+  /**
+   * A decompressor of type (DEFLATE, RAW_DEFLATE, GZIP or ZSTD), pooled or
+   * new.
+   */
+  static std::shared_ptr<StreamDecompressor> getDecompressor(
+      CompressionType type);
+
+  // The codecs pooled by this thread
+  static size_t getNumPooled();
+};
+
+}
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/StreamCompressor.h>
+
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/ZstdStreamCompressor.h>
+#ifdef PROXYGEN_HAVE_BROTLI
+#include <proxygen/lib/utils/BrotliStreamCompressor.h>
+#endif
+
+namespace proxygen {
+
+bool isStreamCompressorSupported(CompressionType type) {
+  switch (type) {
+    case CompressionType::DEFLATE:
+    case CompressionType::GZIP:
+    case CompressionType::ZSTD:
+    case CompressionType::RAW_DEFLATE:
+      return true;
+    case CompressionType::BROTLI:
+#ifdef PROXYGEN_HAVE_BROTLI
+      return true;
+#else
+      return false;
+#endif
+    case CompressionType::NONE:
+      break;
+  }
+  return false;
+}
+
+std::unique_ptr<StreamCompressor> makeStreamCompressor(CompressionType type,
+                                                       int level) {
+  switch (type) {
+    case CompressionType::DEFLATE:
+    case CompressionType::GZIP:
+    case CompressionType::RAW_DEFLATE:
+      return std::make_unique<ZlibStreamCompressor>(type, level);
+    case CompressionType::ZSTD:
+      return std::make_unique<ZstdStreamCompressor>(level);
+    case CompressionType::BROTLI:
+#ifdef PROXYGEN_HAVE_BROTLI
+      return std::make_unique<BrotliStreamCompressor>(level);
+#else
+      break;
+#endif
+    case CompressionType::NONE:
+      break;
+  }
+  return nullptr;
+}
+
+}
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+namespace folly {
+class IOBuf;
+}
+
+namespace proxygen {
+
+/**
+ * Abstract base class for stream compressor implementations.
+ */
+class StreamCompressor {
+ public:
+  virtual ~StreamCompressor() = default;
+
+  /**
+   * Compresses in, flushing the output so that it can be decompressed as it
+   * is received.  trailer must be true on the last call, which ends the
+   * stream.  Returns nullptr on error.
+   */
+  virtual std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf* in,
+                                                 bool trailer = true) = 0;
+  virtual bool hasError() = 0;
+
+  /**
+   * Readies the compressor for a new stream with the same settings, keeping
+   * its memory, for StreamCodecPool.  Returns false if it can't be reset.
+   */
+  virtual bool reset() {
+    return false;
+  }
+};
+
+/**
+ * Whether this build has a compressor for type: DEFLATE, GZIP and ZSTD, and
+ * BROTLI when linked with libbrotlienc.
+ */
+bool isStreamCompressorSupported(CompressionType type);
+
+/**
+ * Creates a compressor of type at the compression level, which is specific
+ * to the type.  Returns nullptr if the type is not supported.
+ */
+std::unique_ptr<StreamCompressor> makeStreamCompressor(CompressionType type,
+                                                       int level);
+
+}
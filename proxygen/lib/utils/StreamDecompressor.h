@@ -17,7 +17,16 @@ class IOBuf;
 
 namespace proxygen {
 
-enum class CompressionType : int { NONE, DEFLATE, GZIP, ZSTD };
+// RAW_DEFLATE is DEFLATE without the zlib header and checksum, as
+// WebSocket's permessage-deflate (RFC 7692) uses it
+enum class CompressionType : int {
+  NONE,
+  DEFLATE,
+  GZIP,
+  ZSTD,
+  BROTLI,
+  RAW_DEFLATE
+};
 
 /**
  * Abstract base class for stream decompressor implementations.
@@ -28,5 +37,13 @@ class StreamDecompressor {
   virtual std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) = 0;
   virtual bool hasError() = 0;
   virtual bool finished() = 0;
+
+  /**
+   * Readies the decompressor for a new stream, keeping its memory, for
+   * StreamCodecPool.  Returns false if it can't be reset.
+   */
+  virtual bool reset() {
+    return false;
+  }
 };
 } // namespace proxygen
@@ -108,6 +108,22 @@ inline std::chrono::seconds secondsSince(std::chrono::time_point<ClockType> t) {
   return secondsBetween(getCurrentTime<ClockType>(), t);
 }
 
+/**
+ * The CPU time the calling thread has used, or 0 where the clock is not
+ * supported.  Unlike getCurrentTime() this is a system call on most
+ * platforms, so callers should sample.
+ */
+inline std::chrono::nanoseconds getThreadCpuTime() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    return std::chrono::seconds(ts.tv_sec) +
+      std::chrono::nanoseconds(ts.tv_nsec);
+  }
+#endif
+  return std::chrono::nanoseconds(0);
+}
+
 /**
  * Get the current date and time in string formats: %Y-%m-%d and %H:%M:%S.
  */
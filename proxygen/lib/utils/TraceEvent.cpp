@@ -69,15 +69,32 @@ bool TraceEvent::readBoolMeta(TraceFieldType key, bool& dest) const {
 bool TraceEvent::readStrMeta(TraceFieldType key, std::string& dest) const {
   return readMeta(key, dest);
 }
+constexpr size_t TraceEvent::kInlineMetaData;
+
+void TraceEvent::setMetaData(MetaDataMap&& input) {
+  metaData_ = std::move(input);
+  std::sort(metaData_.begin(), metaData_.end(),
+            [] (const MetaDataMap::value_type& a,
+                const MetaDataMap::value_type& b) {
+              return a.first < b.first;
+            });
+}
+
 bool TraceEvent::addMetaInternal(TraceFieldType key, MetaData&& value) {
-  auto rc = metaData_.emplace(key, value);
+  auto itr = std::lower_bound(
+    metaData_.begin(), metaData_.end(), key,
+    [] (const MetaDataMap::value_type& entry, TraceFieldType k) {
+      return entry.first < k;
+    });
 
   // replace if key already exist
-  if (!rc.second) {
-    rc.first->second = value;
+  if (itr != metaData_.end() && itr->first == key) {
+    itr->second = std::move(value);
+    return false;
   }
 
-  return rc.second;
+  metaData_.emplace(itr, key, std::move(value));
+  return true;
 }
 
 std::string TraceEvent::toString() const {
@@ -20,8 +20,9 @@
 
 #include <folly/Conv.h>
 #include <folly/lang/Exception.h>
+#include <folly/small_vector.h>
 
-#include <map>
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -38,6 +39,9 @@ namespace proxygen {
  */
 class TraceEvent {
  public:
+  // Fields stored without allocating; integers are kept in place
+  static constexpr size_t kInlineMetaData = 8;
+
   struct MetaData {
    public:
     using MetaDataType =
@@ -98,7 +102,9 @@ class TraceEvent {
     MetaDataType value_;
   };
 
-  using MetaDataMap = std::map<TraceFieldType, MetaData>;
+  // Sorted by field, one entry per field
+  using MetaDataMap = folly::small_vector<std::pair<TraceFieldType, MetaData>,
+                                          kInlineMetaData>;
 
   class Iterator {
    public:
@@ -194,19 +200,18 @@ class TraceEvent {
   }
 
   bool hasTraceField(TraceFieldType field) const {
-    return metaData_.count(field);
+    return findMeta(field) != metaData_.end();
   }
 
   template<typename T>
   T getTraceFieldDataAs(TraceFieldType field) const {
-    const auto itr = metaData_.find(field);
+    const auto itr = findMeta(field);
     CHECK(itr != metaData_.end());
     return itr->second.getValueAs<T>();
   }
 
-  void setMetaData(MetaDataMap&& input) {
-    metaData_ = input;
-  }
+  // input need not be sorted, but each field may appear only once
+  FB_EXPORT void setMetaData(MetaDataMap&& input);
 
   const MetaDataMap& getMetaData() const {
     return metaData_;
@@ -247,9 +252,19 @@ class TraceEvent {
   friend class Iterator;
 
  private:
+  MetaDataMap::const_iterator findMeta(TraceFieldType key) const {
+    auto itr = std::lower_bound(
+      metaData_.begin(), metaData_.end(), key,
+      [] (const MetaDataMap::value_type& entry, TraceFieldType k) {
+        return entry.first < k;
+      });
+    return (itr != metaData_.end() && itr->first == key) ?
+      itr : metaData_.end();
+  }
+
   template<typename T>
   bool readMeta(TraceFieldType key, T& dest) const {
-    const auto itr = metaData_.find(key);
+    const auto itr = findMeta(key);
     if (itr != metaData_.end()) {
       return folly::catch_exception<std::exception const&>(
           [&]() -> bool {
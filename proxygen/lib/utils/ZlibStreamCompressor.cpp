@@ -71,9 +71,11 @@ void ZlibStreamCompressor::init(CompressionType type, int32_t level) {
       << "Invalid Zlib compression level. level=" << level_;
 
   switch (type_) {
-    case CompressionType::GZIP: {
-      auto windowBits = type_ == CompressionType::GZIP ? GZIP_WINDOW_BITS
-                                                       : DEFLATE_WINDOW_BITS;
+    case CompressionType::GZIP:
+    case CompressionType::RAW_DEFLATE: {
+      auto windowBits = type_ == CompressionType::GZIP
+                            ? GZIP_WINDOW_BITS
+                            : RAW_DEFLATE_WINDOW_BITS;
       status_ = deflateInit2(&zlibStream_,
                              level_,
                              Z_DEFLATED,
@@ -99,6 +101,16 @@ ZlibStreamCompressor::ZlibStreamCompressor(CompressionType type, int level)
   init(type, level);
 }
 
+bool ZlibStreamCompressor::reset() {
+  if (type_ == CompressionType::NONE) {
+    return false;
+  }
+  status_ = deflateReset(&zlibStream_);
+  zlibStream_.next_out = Z_NULL;
+  zlibStream_.avail_out = 0;
+  return status_ == Z_OK;
+}
+
 ZlibStreamCompressor::~ZlibStreamCompressor() {
   if (type_ != CompressionType::NONE) {
     status_ = deflateEnd(&zlibStream_);
@@ -29,9 +29,13 @@ void ZlibStreamDecompressor::init(CompressionType type) {
   zlibStream_.avail_out = 0;
   zlibStream_.next_out = Z_NULL;
 
-  DCHECK(type == CompressionType::DEFLATE || type == CompressionType::GZIP);
-  auto windowBits =
-      type_ == CompressionType::GZIP ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
+  DCHECK(type == CompressionType::DEFLATE || type == CompressionType::GZIP ||
+         type == CompressionType::RAW_DEFLATE);
+  auto windowBits = type_ == CompressionType::GZIP
+                        ? GZIP_WINDOW_BITS
+                        : type_ == CompressionType::RAW_DEFLATE
+                              ? RAW_DEFLATE_WINDOW_BITS
+                              : DEFLATE_WINDOW_BITS;
   status_ = inflateInit2(&zlibStream_, windowBits);
 }
 
@@ -46,6 +50,14 @@ ZlibStreamDecompressor::ZlibStreamDecompressor(
   init(type);
 }
 
+bool ZlibStreamDecompressor::reset() {
+  if (type_ == CompressionType::NONE) {
+    return false;
+  }
+  status_ = inflateReset(&zlibStream_);
+  return status_ == Z_OK;
+}
+
 ZlibStreamDecompressor::~ZlibStreamDecompressor() {
   if (type_ != CompressionType::NONE) {
     status_ = inflateEnd(&zlibStream_);
@@ -30,6 +30,8 @@ constexpr uint64_t kZlibDecompressorBufferMinsizeDefault = 64;
  */
 constexpr int GZIP_WINDOW_BITS = 31;
 constexpr int DEFLATE_WINDOW_BITS = 15;
+// A negative window log means a raw deflate stream, with no zlib wrapper
+constexpr int RAW_DEFLATE_WINDOW_BITS = -15;
 } // namespace
 
 class ZlibStreamDecompressor : public StreamDecompressor {
@@ -60,6 +62,8 @@ class ZlibStreamDecompressor : public StreamDecompressor {
     return status_ == Z_STREAM_END;
   }
 
+  bool reset() override;
+
  private:
   CompressionType type_{CompressionType::NONE};
   uint64_t decompressor_buffer_growth_{kZlibDecompressorBufferGrowthDefault};
@@ -0,0 +1,32 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/ZstdDictionary.h>
+
+#include <stdexcept>
+
+namespace proxygen {
+
+void ZstdDictionary::freeCDict(ZSTD_CDict* cdict) {
+  ZSTD_freeCDict(cdict);
+}
+
+void ZstdDictionary::freeDDict(ZSTD_DDict* ddict) {
+  ZSTD_freeDDict(ddict);
+}
+
+ZstdDictionary::ZstdDictionary(folly::ByteRange dictionary, int level)
+    : cdict_(ZSTD_createCDict(dictionary.data(), dictionary.size(), level)),
+      ddict_(ZSTD_createDDict(dictionary.data(), dictionary.size())),
+      id_(ZSTD_getDictID_fromDict(dictionary.data(), dictionary.size())) {
+  if (!cdict_ || !ddict_) {
+    throw std::runtime_error("Failed to load zstd dictionary");
+  }
+}
+} // namespace proxygen
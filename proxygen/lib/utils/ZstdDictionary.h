@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <zstd.h>
+
+#include <folly/Memory.h>
+#include <folly/Range.h>
+
+namespace proxygen {
+
+/**
+ * A pre-trained zstd dictionary (e.g. from `zstd --train`), digested once for
+ * compression and decompression.  It is immutable, so a single instance can
+ * be shared by the compressors and decompressors of all connections and
+ * threads.  Both ends must use the same dictionary.
+ */
+class ZstdDictionary {
+ public:
+  /**
+   * Throws std::runtime_error if dictionary can't be loaded.  level is the
+   * compression level of the streams using it.
+   */
+  ZstdDictionary(folly::ByteRange dictionary, int level);
+
+  const ZSTD_CDict* getCDict() const {
+    return cdict_.get();
+  }
+
+  const ZSTD_DDict* getDDict() const {
+    return ddict_.get();
+  }
+
+  // The ID in the dictionary header, 0 for raw content dictionaries
+  uint32_t getID() const {
+    return id_;
+  }
+
+ private:
+  static void freeCDict(ZSTD_CDict* cdict);
+  static void freeDDict(ZSTD_DDict* ddict);
+
+  const std::unique_ptr<ZSTD_CDict,
+                        folly::static_function_deleter<ZSTD_CDict, freeCDict>>
+      cdict_;
+  const std::unique_ptr<ZSTD_DDict,
+                        folly::static_function_deleter<ZSTD_DDict, freeDDict>>
+      ddict_;
+  uint32_t id_{0};
+};
+} // namespace proxygen
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/ZstdStreamCompressor.h>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+void ZstdStreamCompressor::freeCCtx(ZSTD_CCtx* cctx) {
+  ZSTD_freeCCtx(cctx);
+}
+
+ZstdStreamCompressor::ZstdStreamCompressor(int level)
+    : cctx_(ZSTD_createCCtx()) {
+  if (!cctx_ || ZSTD_isError(ZSTD_CCtx_setParameter(
+                  cctx_.get(), ZSTD_c_compressionLevel, level))) {
+    LOG(ERROR) << "error initializing zstd stream";
+    error_ = true;
+  }
+}
+
+ZstdStreamCompressor::ZstdStreamCompressor(
+    std::shared_ptr<const ZstdDictionary> dictionary)
+    : cctx_(ZSTD_createCCtx()), dictionary_(std::move(dictionary)) {
+  CHECK(dictionary_);
+  if (!cctx_ ||
+      ZSTD_isError(ZSTD_CCtx_refCDict(cctx_.get(), dictionary_->getCDict()))) {
+    LOG(ERROR) << "error initializing zstd stream";
+    error_ = true;
+  }
+}
+
+bool ZstdStreamCompressor::reset() {
+  // Keeps the parameters and dictionary
+  if (!cctx_ ||
+      ZSTD_isError(ZSTD_CCtx_reset(cctx_.get(), ZSTD_reset_session_only))) {
+    return false;
+  }
+  error_ = false;
+  finished_ = false;
+  return true;
+}
+
+std::unique_ptr<folly::IOBuf> ZstdStreamCompressor::compress(
+    const folly::IOBuf* in, bool trailer) {
+  if (error_ || finished_) {
+    // Nothing may follow the end of the frame
+    error_ = true;
+    return nullptr;
+  }
+
+  const size_t outBufMinSize = 1;
+  const size_t outBufAllocSize = ZSTD_CStreamOutSize();
+  folly::IOBufQueue outqueue{folly::IOBufQueue::cacheChainLength()};
+
+  for (const folly::ByteRange range : *in) {
+    if (range.data() == nullptr) {
+      continue;
+    }
+    ZSTD_inBuffer ibuf = {range.data(), range.size(), 0};
+    while (ibuf.pos < ibuf.size) {
+      auto outpair = outqueue.preallocate(outBufMinSize, outBufAllocSize);
+      ZSTD_outBuffer obuf = {outpair.first, outpair.second, 0};
+      auto ret = ZSTD_compressStream2(cctx_.get(), &obuf, &ibuf,
+                                      ZSTD_e_continue);
+      outqueue.postallocate(obuf.pos);
+      if (ZSTD_isError(ret)) {
+        LOG(ERROR) << "zstd compression failed: " << ZSTD_getErrorName(ret);
+        error_ = true;
+        return nullptr;
+      }
+    }
+  }
+
+  // Flush, or end the frame, until zstd has nothing left to write
+  ZSTD_inBuffer ibuf = {nullptr, 0, 0};
+  size_t remaining;
+  do {
+    auto outpair = outqueue.preallocate(outBufMinSize, outBufAllocSize);
+    ZSTD_outBuffer obuf = {outpair.first, outpair.second, 0};
+    remaining = ZSTD_compressStream2(cctx_.get(), &obuf, &ibuf,
+                                     trailer ? ZSTD_e_end : ZSTD_e_flush);
+    outqueue.postallocate(obuf.pos);
+    if (ZSTD_isError(remaining)) {
+      LOG(ERROR) << "zstd compression failed: "
+                 << ZSTD_getErrorName(remaining);
+      error_ = true;
+      return nullptr;
+    }
+  } while (remaining != 0);
+  finished_ = trailer;
+
+  auto out = outqueue.move();
+  if (!out) {
+    out = folly::IOBuf::create(0);
+  }
+  return out;
+}
+} // namespace proxygen
@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <zstd.h>
+
+#include <folly/Memory.h>
+
+#include <proxygen/lib/utils/StreamCompressor.h>
+#include <proxygen/lib/utils/ZstdDictionary.h>
+
+namespace proxygen {
+
+/**
+ * Compresses a stream into a single zstd frame, flushed after each
+ * compress() call.
+ */
+class ZstdStreamCompressor : public StreamCompressor {
+ public:
+  explicit ZstdStreamCompressor(int level);
+
+  // Compresses with dictionary, at its level
+  explicit ZstdStreamCompressor(
+      std::shared_ptr<const ZstdDictionary> dictionary);
+
+  // May return nullptr on error.
+  std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf* in,
+                                         bool trailer = true) override;
+
+  bool hasError() override {
+    return error_;
+  }
+
+  bool reset() override;
+
+ private:
+  static void freeCCtx(ZSTD_CCtx* cctx);
+
+  bool error_{false};
+  bool finished_{false};
+
+  const std::unique_ptr<ZSTD_CCtx,
+                        folly::static_function_deleter<ZSTD_CCtx, freeCCtx>>
+      cctx_;
+  // Referenced by cctx_
+  std::shared_ptr<const ZstdDictionary> dictionary_;
+};
+} // namespace proxygen
@@ -24,6 +24,27 @@ ZstdStreamDecompressor::ZstdStreamDecompressor()
     : status_(ZstdStatusType::NONE), dctx_(ZSTD_createDCtx()) {
 }
 
+ZstdStreamDecompressor::ZstdStreamDecompressor(
+    std::shared_ptr<const ZstdDictionary> dictionary)
+    : status_(ZstdStatusType::NONE),
+      dctx_(ZSTD_createDCtx()),
+      dictionary_(std::move(dictionary)) {
+  if (!dictionary_ || !dctx_ ||
+      ZSTD_isError(ZSTD_DCtx_refDDict(dctx_.get(), dictionary_->getDDict()))) {
+    status_ = ZstdStatusType::ERROR;
+  }
+}
+
+bool ZstdStreamDecompressor::reset() {
+  // Keeps the dictionary
+  if (!dctx_ ||
+      ZSTD_isError(ZSTD_DCtx_reset(dctx_.get(), ZSTD_reset_session_only))) {
+    return false;
+  }
+  status_ = ZstdStatusType::NONE;
+  return true;
+}
+
 std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompress(
     const folly::IOBuf* in) {
   if (!dctx_) {
@@ -24,6 +24,7 @@
 #include <folly/Memory.h>
 
 #include <proxygen/lib/utils/StreamDecompressor.h>
+#include <proxygen/lib/utils/ZstdDictionary.h>
 
 namespace folly {
 class IOBuf;
@@ -35,6 +36,10 @@ class ZstdStreamDecompressor : public StreamDecompressor {
  public:
   explicit ZstdStreamDecompressor();
 
+  // Decompresses frames compressed with dictionary
+  explicit ZstdStreamDecompressor(
+      std::shared_ptr<const ZstdDictionary> dictionary);
+
   // May return nullptr on error / no output.
   std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override;
 
@@ -50,6 +55,8 @@ class ZstdStreamDecompressor : public StreamDecompressor {
     return status_ == ZstdStatusType::FINISHED;
   }
 
+  bool reset() override;
+
  private:
   static void freeDCtx(ZSTD_DCtx* dctx);
 
@@ -60,5 +67,7 @@ class ZstdStreamDecompressor : public StreamDecompressor {
   const std::unique_ptr<ZSTD_DCtx,
                         folly::static_function_deleter<ZSTD_DCtx, freeDCtx>>
       dctx_;
+  // Referenced by dctx_
+  std::shared_ptr<const ZstdDictionary> dictionary_;
 };
 } // namespace proxygen
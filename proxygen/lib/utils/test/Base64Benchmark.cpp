@@ -0,0 +1,193 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/portability/OpenSSL.h>
+#include <openssl/buffer.h>
+#include <proxygen/lib/utils/Base64.h>
+#include <vector>
+
+using namespace folly;
+using namespace proxygen;
+
+// Base64 against the OpenSSL BIO chain it used to wrap, for a 16 byte
+// websocket key, a typical HTTP2-Settings payload and a 4KB token.  Build
+// with -mssse3 (or a -march that implies it) for the vectorized path.
+
+namespace {
+
+std::string opensslEncode(ByteRange buffer) {
+  BIO* b64 = BIO_new(BIO_f_base64());
+  BIO* bio = BIO_push(b64, BIO_new(BIO_s_mem()));
+  BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
+  BIO_write(bio, buffer.data(), buffer.size());
+  (void)BIO_flush(bio);
+  BUF_MEM* bufferPtr;
+  BIO_get_mem_ptr(bio, &bufferPtr);
+  std::string result(bufferPtr->data, bufferPtr->length);
+  BIO_free_all(bio);
+  return result;
+}
+
+std::string opensslDecode(const std::string& b64message, int padding) {
+  std::string result(b64message.length() * 3 / 4 - padding, '\0');
+  BIO* b64 = BIO_new(BIO_f_base64());
+  BIO* bio = BIO_push(b64, BIO_new_mem_buf(b64message.data(), -1));
+  BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
+  BIO_read(bio, &result[0], result.size());
+  BIO_free_all(bio);
+  return result;
+}
+
+std::string makeInput(size_t len) {
+  std::string input(len, '\0');
+  for (size_t i = 0; i < len; i++) {
+    input[i] = static_cast<char>(i * 131 + 7);
+  }
+  return input;
+}
+
+const std::string kWebsocketKey = makeInput(16);
+const std::string kSettings = makeInput(36);
+const std::string kToken = makeInput(4096);
+
+ByteRange range(const std::string& str) {
+  return ByteRange(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+void encodeOpenSSL(const std::string& input, int iters) {
+  for (int i = 0; i < iters; i++) {
+    doNotOptimizeAway(opensslEncode(range(input)));
+  }
+}
+
+void encodeString(const std::string& input, int iters) {
+  for (int i = 0; i < iters; i++) {
+    doNotOptimizeAway(Base64::encode(range(input)));
+  }
+}
+
+void encodeRange(const std::string& input, int iters) {
+  std::string out(Base64::encodedSize(input.size()), '\0');
+  for (int i = 0; i < iters; i++) {
+    doNotOptimizeAway(
+      Base64::encode(range(input), MutableStringPiece(&out[0], out.size())));
+  }
+}
+
+void decodeOpenSSL(const std::string& input, int iters) {
+  std::string encoded;
+  BENCHMARK_SUSPEND {
+    encoded = Base64::encode(range(input));
+  }
+  int padding = (3 - input.size() % 3) % 3;
+  for (int i = 0; i < iters; i++) {
+    doNotOptimizeAway(opensslDecode(encoded, padding));
+  }
+}
+
+void decodeString(const std::string& input, int iters) {
+  std::string encoded;
+  BENCHMARK_SUSPEND {
+    encoded = Base64::encode(range(input));
+  }
+  int padding = (3 - input.size() % 3) % 3;
+  for (int i = 0; i < iters; i++) {
+    doNotOptimizeAway(Base64::decode(encoded, padding));
+  }
+}
+
+void decodeRange(const std::string& input, int iters) {
+  std::string encoded;
+  std::vector<uint8_t> out;
+  BENCHMARK_SUSPEND {
+    encoded = Base64::encode(range(input));
+    out.resize(Base64::decodedSizeBound(encoded.size()));
+  }
+  for (int i = 0; i < iters; i++) {
+    doNotOptimizeAway(
+      Base64::decode(encoded, MutableByteRange(out.data(), out.size())));
+  }
+}
+
+}
+
+BENCHMARK(EncodeOpenSSLWebsocketKey, iters) {
+  encodeOpenSSL(kWebsocketKey, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeStringWebsocketKey, iters) {
+  encodeString(kWebsocketKey, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeRangeWebsocketKey, iters) {
+  encodeRange(kWebsocketKey, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EncodeOpenSSLSettings, iters) {
+  encodeOpenSSL(kSettings, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeStringSettings, iters) {
+  encodeString(kSettings, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeRangeSettings, iters) {
+  encodeRange(kSettings, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EncodeOpenSSLToken, iters) {
+  encodeOpenSSL(kToken, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeStringToken, iters) {
+  encodeString(kToken, iters);
+}
+
+BENCHMARK_RELATIVE(EncodeRangeToken, iters) {
+  encodeRange(kToken, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecodeOpenSSLSettings, iters) {
+  decodeOpenSSL(kSettings, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeStringSettings, iters) {
+  decodeString(kSettings, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeRangeSettings, iters) {
+  decodeRange(kSettings, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecodeOpenSSLToken, iters) {
+  decodeOpenSSL(kToken, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeStringToken, iters) {
+  decodeString(kToken, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeRangeToken, iters) {
+  decodeRange(kToken, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
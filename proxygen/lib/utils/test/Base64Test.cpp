@@ -64,3 +64,57 @@ TEST(Base64, EncodeDecodeHighBits) {
   EXPECT_EQ(Base64::urlDecode("_--_"), std::string("\xff\xef\xbf", 3));
   EXPECT_EQ(Base64::urlEncode(range("\xff\xef\xbf", 3)), "_--_");
 }
+
+TEST(Base64, DecodeInvalid) {
+  EXPECT_EQ(Base64::decode("YQ=", 1), "");
+  EXPECT_EQ(Base64::decode("Y===", 2), "");
+  EXPECT_EQ(Base64::decode("YQ==", 1), "");
+  EXPECT_EQ(Base64::decode("YW*j", 0), "");
+  EXPECT_EQ(Base64::decode("YW_j", 0), "");
+  EXPECT_EQ(Base64::urlDecode("YW+j"), "");
+  EXPECT_EQ(Base64::urlDecode("Y"), "");
+}
+
+TEST(Base64, URLDecodePadded) {
+  EXPECT_EQ(Base64::urlDecode("YQ=="), "a");
+  EXPECT_EQ(Base64::urlDecode("YWE="), "aa");
+}
+
+TEST(Base64, Range) {
+  char encoded[Base64::encodedSize(5)];
+  EXPECT_EQ(Base64::encode(range("hello"),
+                           folly::MutableStringPiece(encoded, sizeof(encoded))),
+            8u);
+  EXPECT_EQ(string(encoded, 8), "aGVsbG8=");
+  EXPECT_EQ(Base64::urlEncode(range("hello"),
+                              folly::MutableStringPiece(encoded, 7)),
+            7u);
+  EXPECT_EQ(string(encoded, 7), "aGVsbG8");
+
+  uint8_t decoded[Base64::decodedSizeBound(8)];
+  auto len = Base64::decode("aGVsbG8=",
+                            folly::MutableByteRange(decoded, sizeof(decoded)));
+  ASSERT_TRUE(len.hasValue());
+  EXPECT_EQ(string(reinterpret_cast<char*>(decoded), *len), "hello");
+  len = Base64::urlDecode("aGVsbG8",
+                          folly::MutableByteRange(decoded, sizeof(decoded)));
+  ASSERT_TRUE(len.hasValue());
+  EXPECT_EQ(string(reinterpret_cast<char*>(decoded), *len), "hello");
+  EXPECT_FALSE(Base64::decode("aGVsbG8",
+                              folly::MutableByteRange(decoded, sizeof(decoded)))
+               .hasValue());
+}
+
+TEST(Base64, RoundTrip) {
+  // Long enough for whole vectorized blocks, and every tail length
+  string input;
+  for (size_t len = 0; len < 100; len++) {
+    string encoded = Base64::encode(range(input.data(), input.size()));
+    EXPECT_EQ(encoded.size(), Base64::encodedSize(len));
+    EXPECT_EQ(Base64::decode(encoded, (3 - len % 3) % 3), input);
+    string urlEncoded = Base64::urlEncode(range(input.data(), input.size()));
+    EXPECT_EQ(urlEncoded.size(), Base64::urlEncodedSize(len));
+    EXPECT_EQ(Base64::urlDecode(urlEncoded), input);
+    input.push_back(static_cast<char>(len * 37 + 251));
+  }
+}
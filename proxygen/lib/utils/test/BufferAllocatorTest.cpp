@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/BufferAllocator.h>
+#include <thread>
+
+using namespace proxygen;
+
+namespace {
+ArenaBufferAllocator::Options makeOptions() {
+  ArenaBufferAllocator::Options options;
+  options.bufferSize = 4096;
+  options.chunkSize = 4 * 4096;
+  options.maxArenaSize = 8 * 4096;
+  return options;
+}
+}
+
+TEST(ArenaBufferAllocatorTest, ReusesFreedBuffers) {
+  ArenaBufferAllocator allocator(makeOptions());
+  auto buf = allocator.allocate(1000);
+  EXPECT_EQ(0, buf->length());
+  EXPECT_GE(buf->tailroom(), 1000);
+  auto data = buf->writableData();
+  memset(buf->writableTail(), 'a', buf->tailroom());
+  buf.reset();
+
+  buf = allocator.allocate(4096);
+  EXPECT_EQ(data, buf->writableData());
+  auto stats = allocator.getStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(0, stats.misses);
+  EXPECT_EQ(1, stats.arenas);
+  EXPECT_EQ(4 * 4096, stats.mappedBytes);
+  EXPECT_EQ(4096, stats.usedBytes);
+  EXPECT_DOUBLE_EQ(0.75, stats.getFragmentation());
+}
+
+TEST(ArenaBufferAllocatorTest, FallsBackToMalloc) {
+  ArenaBufferAllocator allocator(makeOptions());
+  // Larger than the buffers
+  auto large = allocator.allocate(5000);
+  EXPECT_GE(large->tailroom(), 5000);
+
+  // Past maxArenaSize
+  std::vector<std::unique_ptr<folly::IOBuf>> bufs;
+  for (size_t i = 0; i < 10; i++) {
+    bufs.push_back(allocator.allocate(100));
+  }
+  auto stats = allocator.getStats();
+  EXPECT_EQ(8, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(8 * 4096, stats.mappedBytes);
+  EXPECT_DOUBLE_EQ(0, stats.getFragmentation());
+  EXPECT_DOUBLE_EQ(8.0 / 11, stats.getHitRate());
+
+  bufs.clear();
+  EXPECT_EQ(0, allocator.getStats().usedBytes);
+}
+
+TEST(ArenaBufferAllocatorTest, ArenaPerThread) {
+  ArenaBufferAllocator allocator(makeOptions());
+  auto buf = allocator.allocate(100);
+  std::unique_ptr<folly::IOBuf> other;
+  std::thread([&] { other = allocator.allocate(100); }).join();
+  EXPECT_EQ(2, allocator.getStats().arenas);
+  EXPECT_EQ(2 * 4 * 4096, allocator.getStats().mappedBytes);
+
+  // Back to the arena of the exited thread
+  other.reset();
+  EXPECT_EQ(4096, allocator.getStats().usedBytes);
+}
+
+TEST(ArenaBufferAllocatorTest, BuffersOutliveTheAllocator) {
+  std::unique_ptr<folly::IOBuf> buf;
+  {
+    ArenaBufferAllocator allocator(makeOptions());
+    buf = allocator.allocate(100);
+  }
+  buf->append(1);
+  buf.reset();
+}
+
+TEST(ArenaBufferAllocatorTest, HugePages) {
+  auto options = makeOptions();
+  options.chunkSize = 2 * 1024 * 1024;
+  options.maxArenaSize = options.chunkSize;
+  for (auto hugePages : {ArenaBufferAllocator::HugePages::TRANSPARENT,
+                         ArenaBufferAllocator::HugePages::EXPLICIT}) {
+    options.hugePages = hugePages;
+    ArenaBufferAllocator allocator(options);
+    // Regular pages without any huge page reserved
+    auto buf = allocator.allocate(100);
+    memset(buf->writableTail(), 'a', buf->tailroom());
+    EXPECT_EQ(1, allocator.getStats().hits);
+    EXPECT_EQ(options.chunkSize, allocator.getStats().mappedBytes);
+  }
+}
@@ -0,0 +1,53 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/CoarseTime.h>
+#include <thread>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+
+namespace {
+void sleepForAWhile() {
+  std::this_thread::sleep_for(milliseconds(2));
+}
+}
+
+TEST(CoarseTimeTest, CachedPerIteration) {
+  folly::EventBase evb;
+  TimePoint first;
+  evb.runInLoop([&] {
+    first = getCoarseTime(&evb);
+    sleepForAWhile();
+    EXPECT_EQ(getCoarseTime(&evb), first);
+    EXPECT_EQ(getCoarseTime(), first);
+
+    auto refreshed = refreshCoarseTime(&evb);
+    EXPECT_GT(refreshed, first);
+    EXPECT_EQ(getCoarseTime(&evb), refreshed);
+  });
+  evb.loopOnce();
+
+  // A later iteration reads the clock again
+  evb.runInLoop([&] {
+    sleepForAWhile();
+    EXPECT_GT(getCoarseTime(&evb), first);
+  });
+  evb.loopOnce();
+}
+
+TEST(CoarseTimeTest, OutsideLoop) {
+  folly::EventBase evb;
+  auto first = getCoarseTime(&evb);
+  sleepForAWhile();
+  EXPECT_GT(getCoarseTime(&evb), first);
+  EXPECT_GT(getCoarseTime(nullptr), first);
+}
@@ -0,0 +1,277 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/hash/Hash.h>
+#include <proxygen/lib/utils/JumpHash.h>
+#include <proxygen/lib/utils/MaglevHash.h>
+#include <proxygen/lib/utils/RendezvousHash.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <malloc.h>
+#include <memory>
+#include <new>
+#include <vector>
+
+using namespace folly;
+using namespace proxygen;
+
+// Compares the ConsistentHash implementations on pools of 10 to 10k nodes.
+// Before the lookup and build() timings, a report gives for each hasher and
+// pool size:
+//  - the build() time and the memory it allocates,
+//  - the imbalance: the largest ratio of a node's share of the keys to its
+//    share of the weight, under uniform and skewed weights (1 to 10),
+//  - the share of the keys remapped by adding a node, removing the last
+//    one and halving the weight of one, against the minimum that must move.
+//
+// ./consistent_hash_benchmark --bm_min_iters 100000
+
+DEFINE_bool(quality, true, "Print the distribution quality report");
+DEFINE_int32(keys_per_node, 100, "Keys sampled per node in the report");
+DEFINE_int32(max_rendezvous_nodes, 1000,
+             "Largest pool RendezvousHash is reported on, as its lookups "
+             "grow with the pool");
+
+namespace {
+
+// The bytes allocated and not freed, to measure what build() keeps
+std::atomic<int64_t> allocatedBytes{0};
+
+using Nodes = std::vector<std::pair<std::string, uint64_t>>;
+using HasherFactory = std::function<std::unique_ptr<ConsistentHash>()>;
+
+struct Hasher {
+  const char* name;
+  HasherFactory make;
+  size_t maxNodes;
+};
+
+std::vector<Hasher> getHashers() {
+  return {
+    {"RendezvousHash",
+     [] { return std::make_unique<RendezvousHash>(); },
+     size_t(FLAGS_max_rendezvous_nodes)},
+    {"MaglevHash", [] { return std::make_unique<MaglevHash>(); }, SIZE_MAX},
+    {"JumpHash", [] { return std::make_unique<JumpHash>(); }, SIZE_MAX},
+  };
+}
+
+const size_t kPoolSizes[] = {10, 100, 1000, 10000};
+
+Nodes makeNodes(size_t numNodes, bool skewed) {
+  Nodes nodes;
+  nodes.reserve(numNodes);
+  for (size_t i = 0; i < numNodes; ++i) {
+    nodes.emplace_back(folly::to<std::string>("node", i),
+                       skewed ? 1 + i % 10 : 1);
+  }
+  return nodes;
+}
+
+uint64_t getKey(uint64_t i) {
+  return folly::hash::twang_mix64(i);
+}
+
+std::unique_ptr<ConsistentHash> build(const Hasher& hasher, Nodes nodes) {
+  auto hash = hasher.make();
+  hash->build(nodes);
+  return hash;
+}
+
+std::vector<size_t> getMapping(const ConsistentHash& hash, size_t numKeys) {
+  std::vector<size_t> mapping(numKeys);
+  for (size_t i = 0; i < numKeys; ++i) {
+    mapping[i] = hash.get(getKey(i));
+  }
+  return mapping;
+}
+
+double getImbalance(const Nodes& nodes, const std::vector<size_t>& mapping) {
+  std::vector<size_t> keys(nodes.size());
+  for (auto node : mapping) {
+    keys[node]++;
+  }
+  double totalWeight = 0;
+  for (auto& node : nodes) {
+    totalWeight += node.second;
+  }
+  double imbalance = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    double expected = nodes[i].second / totalWeight;
+    double actual = double(keys[i]) / mapping.size();
+    imbalance = std::max(imbalance, actual / expected);
+  }
+  return imbalance;
+}
+
+double getRemapped(const std::vector<size_t>& before,
+                   const std::vector<size_t>& after) {
+  size_t remapped = 0;
+  for (size_t i = 0; i < before.size(); ++i) {
+    remapped += before[i] != after[i];
+  }
+  return double(remapped) / before.size();
+}
+
+void printReport() {
+  printf("%-16s %6s %10s %10s %9s %9s %9s %9s %9s\n",
+         "hasher", "nodes", "build(us)", "bytes", "imbal", "imbal-skw",
+         "add", "remove", "halve");
+  printf("%-16s %6s %10s %10s %9s %9s %9s %9s %9s\n",
+         "", "", "", "", "", "", "(min)", "(min)", "(min)");
+  for (auto& hasher : getHashers()) {
+    for (auto numNodes : kPoolSizes) {
+      if (numNodes > hasher.maxNodes) {
+        continue;
+      }
+      size_t numKeys = FLAGS_keys_per_node * numNodes;
+      auto nodes = makeNodes(numNodes, false);
+
+      auto bytesBefore = allocatedBytes.load();
+      auto start = std::chrono::steady_clock::now();
+      auto hash = build(hasher, nodes);
+      auto buildTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+      auto bytes = allocatedBytes.load() - bytesBefore;
+
+      auto mapping = getMapping(*hash, numKeys);
+      auto imbalance = getImbalance(nodes, mapping);
+      auto skewedNodes = makeNodes(numNodes, true);
+      auto skewed = getImbalance(
+        skewedNodes, getMapping(*build(hasher, skewedNodes), numKeys));
+
+      auto added = nodes;
+      added.emplace_back(folly::to<std::string>("node", numNodes), 1);
+      auto removed = nodes;
+      removed.pop_back();
+      auto halved = makeNodes(numNodes, false);
+      for (auto& node : halved) {
+        node.second = 2;
+      }
+      auto doubled = halved;
+      halved[numNodes / 2].second = 1;
+
+      printf("%-16s %6zu %10lld %10lld %9.3f %9.3f %9.4f %9.4f %9.4f\n",
+             hasher.name, numNodes, (long long)buildTime.count(),
+             (long long)bytes, imbalance, skewed,
+             getRemapped(mapping, getMapping(*build(hasher, added), numKeys)),
+             getRemapped(mapping,
+                         getMapping(*build(hasher, removed), numKeys)),
+             getRemapped(getMapping(*build(hasher, doubled), numKeys),
+                         getMapping(*build(hasher, halved), numKeys)));
+      printf("%-16s %6s %10s %10s %9s %9s %9.4f %9.4f %9.4f\n",
+             "", "", "", "", "", "", 1.0 / (numNodes + 1), 1.0 / numNodes,
+             double(numNodes - 1) / (numNodes * (2 * numNodes - 1)));
+    }
+  }
+  printf("\n");
+}
+
+template <typename T>
+void lookupBench(int iters, size_t numNodes) {
+  T hash;
+  BENCHMARK_SUSPEND {
+    auto nodes = makeNodes(numNodes, true);
+    hash.build(nodes);
+  }
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(hash.get(getKey(i)));
+  }
+}
+
+template <typename T>
+void buildBench(int iters, size_t numNodes) {
+  Nodes nodes;
+  BENCHMARK_SUSPEND {
+    nodes = makeNodes(numNodes, true);
+  }
+  for (int i = 0; i < iters; ++i) {
+    T hash;
+    hash.build(nodes);
+    folly::doNotOptimizeAway(hash.get(i));
+  }
+}
+
+void rendezvousLookup(int iters, size_t numNodes) {
+  lookupBench<RendezvousHash>(iters, numNodes);
+}
+void maglevLookup(int iters, size_t numNodes) {
+  lookupBench<MaglevHash>(iters, numNodes);
+}
+void jumpLookup(int iters, size_t numNodes) {
+  lookupBench<JumpHash>(iters, numNodes);
+}
+void rendezvousBuild(int iters, size_t numNodes) {
+  buildBench<RendezvousHash>(iters, numNodes);
+}
+void maglevBuild(int iters, size_t numNodes) {
+  buildBench<MaglevHash>(iters, numNodes);
+}
+void jumpBuild(int iters, size_t numNodes) {
+  buildBench<JumpHash>(iters, numNodes);
+}
+
+}
+
+void* operator new(size_t size) {
+  void* p = malloc(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  allocatedBytes += malloc_usable_size(p);
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  if (p) {
+    allocatedBytes -= malloc_usable_size(p);
+    free(p);
+  }
+}
+
+BENCHMARK_PARAM(rendezvousLookup, 10)
+BENCHMARK_RELATIVE_PARAM(maglevLookup, 10)
+BENCHMARK_RELATIVE_PARAM(jumpLookup, 10)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(rendezvousLookup, 100)
+BENCHMARK_RELATIVE_PARAM(maglevLookup, 100)
+BENCHMARK_RELATIVE_PARAM(jumpLookup, 100)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(rendezvousLookup, 1000)
+BENCHMARK_RELATIVE_PARAM(maglevLookup, 1000)
+BENCHMARK_RELATIVE_PARAM(jumpLookup, 1000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(rendezvousLookup, 10000)
+BENCHMARK_RELATIVE_PARAM(maglevLookup, 10000)
+BENCHMARK_RELATIVE_PARAM(jumpLookup, 10000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(rendezvousBuild, 10)
+BENCHMARK_RELATIVE_PARAM(maglevBuild, 10)
+BENCHMARK_RELATIVE_PARAM(jumpBuild, 10)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(rendezvousBuild, 1000)
+BENCHMARK_RELATIVE_PARAM(maglevBuild, 1000)
+BENCHMARK_RELATIVE_PARAM(jumpBuild, 1000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(rendezvousBuild, 10000)
+BENCHMARK_RELATIVE_PARAM(maglevBuild, 10000)
+BENCHMARK_RELATIVE_PARAM(jumpBuild, 10000)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_quality) {
+    printReport();
+  }
+  folly::runBenchmarks();
+  return 0;
+}
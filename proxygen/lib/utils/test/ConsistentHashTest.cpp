@@ -0,0 +1,185 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include <proxygen/lib/utils/BoundedLoadHash.h>
+#include <proxygen/lib/utils/JumpHash.h>
+#include <proxygen/lib/utils/MaglevHash.h>
+#include <proxygen/lib/utils/RendezvousHash.h>
+
+using namespace proxygen;
+
+template <typename T>
+class ConsistentHashTest : public testing::Test {
+ public:
+  using Nodes = std::vector<std::pair<std::string, uint64_t>>;
+
+  static Nodes makeNodes(int numNodes) {
+    Nodes nodes;
+    for (int i = 0; i < numNodes; ++i) {
+      nodes.emplace_back(folly::to<std::string>("key", i), 1);
+    }
+    return nodes;
+  }
+
+  static std::map<uint64_t, size_t> getMapping(const Nodes& nodes) {
+    T hashes;
+    auto copy = nodes;
+    hashes.build(copy);
+    std::map<uint64_t, size_t> mapping;
+    for (uint64_t i = 0; i < 10000; ++i) {
+      mapping[i] = hashes.get(i);
+    }
+    return mapping;
+  }
+};
+
+using HashTypes = testing::Types<MaglevHash, JumpHash>;
+TYPED_TEST_CASE(ConsistentHashTest, HashTypes);
+
+TYPED_TEST(ConsistentHashTest, Consistency) {
+  TypeParam hashes;
+  auto nodes = TestFixture::makeNodes(10);
+  hashes.build(nodes);
+
+  for (size_t rank = 0; rank < nodes.size() + 2; rank++) {
+    std::map<uint64_t, size_t> mapping;
+    for (int i = 0; i < 1000; ++i) {
+      mapping[i] = hashes.get(i, rank);
+    }
+    for (auto& entry : mapping) {
+      EXPECT_EQ(entry.second, hashes.get(entry.first, rank));
+    }
+  }
+  // The ranks of a key are distinct nodes
+  for (uint64_t key = 0; key < 100; ++key) {
+    std::vector<bool> seen(nodes.size());
+    for (size_t rank = 0; rank < nodes.size(); rank++) {
+      auto node = hashes.get(key, rank);
+      EXPECT_FALSE(seen[node]);
+      seen[node] = true;
+    }
+  }
+}
+
+TYPED_TEST(ConsistentHashTest, ConsistencyWithNewNode) {
+  int numNodes = 100;
+  auto nodes = TestFixture::makeNodes(numNodes);
+  auto mapping = TestFixture::getMapping(nodes);
+  nodes.emplace_back(folly::to<std::string>("key", numNodes), 1);
+  auto newMapping = TestFixture::getMapping(nodes);
+
+  size_t moved = 0;
+  size_t movedToNew = 0;
+  for (auto& entry : mapping) {
+    auto id = newMapping[entry.first];
+    if (id != entry.second) {
+      moved++;
+      movedToNew += id == size_t(numNodes);
+    }
+  }
+  // About 1% of the keys must move to the new node, Maglev moves a few more
+  EXPECT_GT(movedToNew, 50);
+  EXPECT_LT(moved, 500);
+}
+
+TYPED_TEST(ConsistentHashTest, ConsistencyWithZeroWeight) {
+  auto nodes = TestFixture::makeNodes(100);
+  auto mapping = TestFixture::getMapping(nodes);
+  nodes[42].second = 0;
+  auto newMapping = TestFixture::getMapping(nodes);
+
+  size_t moved = 0;
+  for (auto& entry : mapping) {
+    auto id = newMapping[entry.first];
+    EXPECT_NE(id, size_t(42));
+    moved += id != entry.second;
+  }
+  EXPECT_LT(moved, 500);
+}
+
+TYPED_TEST(ConsistentHashTest, DistributionAccuracy) {
+  std::vector<std::string> keys =
+    {"ash_proxy", "prn_proxy", "snc_proxy", "frc_proxy"};
+  std::vector<std::vector<uint64_t>> weights = {
+    {248, 342, 2, 384},
+    {10, 10, 10, 10},
+    {100, 5, 5, 5},
+    {922337203685, 12395828300, 50192385101, 59293845010}
+  };
+
+  for (auto& weight : weights) {
+    TypeParam hashes;
+    std::vector<std::pair<std::string, uint64_t>> nodes;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      nodes.emplace_back(keys[i], weight[i]);
+    }
+    hashes.build(nodes);
+    // The measured error of the hashing space itself
+    EXPECT_LE(hashes.getMaxErrorRate(), 0.005);
+
+    std::vector<uint64_t> distribution(keys.size());
+    for (uint64_t i = 0; i < 21000; ++i) {
+      distribution[hashes.get(i)]++;
+    }
+    uint64_t totalWeight = 0;
+    for (auto w : weight) {
+      totalWeight += w;
+    }
+    double maxError = 0.0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      double expected = 100.0 * weight[i] / totalWeight;
+      double actual = 100.0 * distribution[i] / 21000;
+      maxError = std::max(maxError, fabs(expected - actual));
+    }
+    EXPECT_LE(maxError, 1.0);
+  }
+}
+
+TEST(BoundedLoadHashTest, KeepsAffinityUnderTheBound) {
+  BoundedLoadHash bounded(std::make_unique<RendezvousHash>(), 0.25);
+  RendezvousHash hash;
+  auto nodes = ConsistentHashTest<RendezvousHash>::makeNodes(10);
+  auto copy = nodes;
+  bounded.build(nodes);
+  hash.build(copy);
+
+  std::vector<uint64_t> loads(nodes.size(), 5);
+  for (uint64_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(bounded.getBounded(i, folly::range(loads)), hash.get(i));
+  }
+}
+
+TEST(BoundedLoadHashTest, CapsHotKeys) {
+  const double epsilon = 0.25;
+  BoundedLoadHash bounded(std::make_unique<RendezvousHash>(), epsilon);
+  auto nodes = ConsistentHashTest<RendezvousHash>::makeNodes(10);
+  bounded.build(nodes);
+
+  // Half of the requests are for one key
+  std::vector<uint64_t> loads(nodes.size());
+  uint64_t moved = 0;
+  for (uint64_t i = 0; i < 10000; ++i) {
+    uint64_t key = i % 2 ? 42 : i;
+    size_t node = bounded.getBounded(key, folly::range(loads));
+    if (node != bounded.get(key)) {
+      moved++;
+    }
+    loads[node]++;
+    EXPECT_LE(loads[node], std::ceil((1 + epsilon) * (i + 1) / nodes.size()));
+  }
+  // The hot key spills over, most of the others stay
+  EXPECT_GT(moved, 3000);
+  EXPECT_LT(moved, 6000);
+}
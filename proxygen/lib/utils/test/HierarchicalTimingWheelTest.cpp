@@ -0,0 +1,266 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/HierarchicalTimingWheel.h>
+#include <proxygen/lib/utils/test/MockTime.h>
+
+#include <functional>
+#include <vector>
+
+using namespace proxygen;
+using std::chrono::hours;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+class TestTimeout : public HierarchicalTimingWheel::Callback {
+ public:
+  explicit TestTimeout(const MockTimeUtil& timeUtil) : timeUtil_(timeUtil) {}
+
+  void timeoutExpired() noexcept override {
+    timestamps.push_back(timeUtil_.now());
+    if (fn) {
+      fn();
+    }
+  }
+
+  std::vector<TimePoint> timestamps;
+  std::function<void()> fn;
+
+ private:
+  const MockTimeUtil& timeUtil_;
+};
+
+class HierarchicalTimingWheelTest : public testing::Test {
+ public:
+  void SetUp() override {
+    start_ = timeUtil_.now();
+    wheel_.reset(new HierarchicalTimingWheel(
+        &eventBase_, milliseconds(10), &timeUtil_));
+  }
+
+  // Moves the clock and runs the wheel the way its timeout would
+  void advance(milliseconds ms) {
+    timeUtil_.advance(ms);
+    wheel_->runExpired();
+  }
+
+  milliseconds elapsed(TimePoint t) const {
+    return millisecondsBetween(t, start_);
+  }
+
+ protected:
+  folly::EventBase eventBase_;
+  MockTimeUtil timeUtil_;
+  TimePoint start_;
+  HierarchicalTimingWheel::UniquePtr wheel_;
+};
+
+TEST_F(HierarchicalTimingWheelTest, FireInTicks) {
+  TestTimeout t1(timeUtil_);
+  TestTimeout t2(timeUtil_);
+  TestTimeout t3(timeUtil_);
+
+  wheel_->scheduleTimeout(&t1, milliseconds(5));
+  wheel_->scheduleTimeout(&t2, milliseconds(10));
+  wheel_->scheduleTimeout(&t3, milliseconds(15));
+  EXPECT_EQ(wheel_->count(), 3);
+
+  advance(milliseconds(9));
+  EXPECT_TRUE(t1.timestamps.empty());
+  EXPECT_TRUE(t2.timestamps.empty());
+
+  // both due within the first tick expire together
+  advance(milliseconds(1));
+  ASSERT_EQ(t1.timestamps.size(), 1);
+  ASSERT_EQ(t2.timestamps.size(), 1);
+  EXPECT_EQ(elapsed(t1.timestamps[0]), milliseconds(10));
+  EXPECT_FALSE(t1.isScheduled());
+  EXPECT_TRUE(t3.timestamps.empty());
+  EXPECT_EQ(wheel_->count(), 1);
+
+  advance(milliseconds(9));
+  EXPECT_TRUE(t3.timestamps.empty());
+  advance(milliseconds(1));
+  ASSERT_EQ(t3.timestamps.size(), 1);
+  EXPECT_EQ(elapsed(t3.timestamps[0]), milliseconds(20));
+  EXPECT_EQ(wheel_->count(), 0);
+}
+
+TEST_F(HierarchicalTimingWheelTest, NeverEarly) {
+  TestTimeout t1(timeUtil_);
+
+  // scheduled mid tick, the timeout may not expire at the end of its 5th
+  advance(milliseconds(3));
+  wheel_->scheduleTimeout(&t1, milliseconds(50));
+  advance(milliseconds(49));
+  EXPECT_TRUE(t1.timestamps.empty());
+  advance(milliseconds(8));
+  ASSERT_EQ(t1.timestamps.size(), 1);
+  EXPECT_EQ(elapsed(t1.timestamps[0]), milliseconds(60));
+}
+
+TEST_F(HierarchicalTimingWheelTest, LateRun) {
+  TestTimeout t1(timeUtil_);
+  TestTimeout t2(timeUtil_);
+  TestTimeout t3(timeUtil_);
+
+  wheel_->scheduleTimeout(&t1, milliseconds(10));
+  wheel_->scheduleTimeout(&t2, seconds(3));
+  wheel_->scheduleTimeout(&t3, seconds(10));
+
+  // a busy loop runs everything that came due since
+  advance(seconds(5));
+  EXPECT_EQ(t1.timestamps.size(), 1);
+  EXPECT_EQ(t2.timestamps.size(), 1);
+  EXPECT_TRUE(t3.timestamps.empty());
+
+  advance(seconds(5));
+  EXPECT_EQ(t3.timestamps.size(), 1);
+}
+
+TEST_F(HierarchicalTimingWheelTest, CancelTimeout) {
+  TestTimeout t1(timeUtil_);
+  TestTimeout t2(timeUtil_);
+
+  wheel_->scheduleTimeout(&t1, milliseconds(50));
+  wheel_->scheduleTimeout(&t2, milliseconds(50));
+  t1.cancelTimeout();
+  EXPECT_FALSE(t1.isScheduled());
+  EXPECT_EQ(wheel_->count(), 1);
+  // cancelling twice is harmless
+  t1.cancelTimeout();
+
+  advance(milliseconds(50));
+  EXPECT_TRUE(t1.timestamps.empty());
+  EXPECT_EQ(t2.timestamps.size(), 1);
+
+  {
+    // destroying a scheduled callback cancels it
+    TestTimeout t3(timeUtil_);
+    wheel_->scheduleTimeout(&t3, milliseconds(50));
+  }
+  EXPECT_EQ(wheel_->count(), 0);
+  advance(milliseconds(50));
+}
+
+TEST_F(HierarchicalTimingWheelTest, Reschedule) {
+  TestTimeout t1(timeUtil_);
+
+  wheel_->scheduleTimeout(&t1, milliseconds(30));
+  advance(milliseconds(20));
+  wheel_->scheduleTimeout(&t1, milliseconds(100));
+  EXPECT_EQ(wheel_->count(), 1);
+
+  advance(milliseconds(20));
+  EXPECT_TRUE(t1.timestamps.empty());
+  advance(milliseconds(80));
+  ASSERT_EQ(t1.timestamps.size(), 1);
+  EXPECT_EQ(elapsed(t1.timestamps[0]), milliseconds(120));
+
+  // sooner this time
+  wheel_->scheduleTimeout(&t1, seconds(10));
+  wheel_->scheduleTimeout(&t1, milliseconds(10));
+  advance(milliseconds(10));
+  EXPECT_EQ(t1.timestamps.size(), 2);
+  EXPECT_EQ(wheel_->count(), 0);
+}
+
+TEST_F(HierarchicalTimingWheelTest, ScheduleFromCallback) {
+  TestTimeout t1(timeUtil_);
+  TestTimeout t2(timeUtil_);
+
+  // a callback scheduled while running expires in a later tick, even when
+  // due immediately
+  t1.fn = [&] {
+    wheel_->scheduleTimeout(&t2, milliseconds(0));
+  };
+  t2.fn = [&] {
+    if (t2.timestamps.size() < 3) {
+      wheel_->scheduleTimeout(&t2, milliseconds(0));
+    }
+  };
+  wheel_->scheduleTimeout(&t1, milliseconds(10));
+
+  advance(milliseconds(10));
+  EXPECT_EQ(t1.timestamps.size(), 1);
+  EXPECT_TRUE(t2.timestamps.empty());
+  EXPECT_TRUE(t2.isScheduled());
+
+  advance(milliseconds(10));
+  EXPECT_EQ(t2.timestamps.size(), 1);
+  advance(milliseconds(100));
+  ASSERT_EQ(t2.timestamps.size(), 3);
+  EXPECT_EQ(wheel_->count(), 0);
+}
+
+TEST_F(HierarchicalTimingWheelTest, LongTimeouts) {
+  // One per level of the wheel: seconds, minutes, hours and days
+  std::vector<milliseconds> timeouts{
+    milliseconds(1500), seconds(600), hours(10), hours(24 * 30)};
+  std::vector<std::unique_ptr<TestTimeout>> callbacks;
+  for (auto timeout : timeouts) {
+    callbacks.emplace_back(std::make_unique<TestTimeout>(timeUtil_));
+    wheel_->scheduleTimeout(callbacks.back().get(), timeout);
+  }
+
+  milliseconds now(0);
+  for (size_t i = 0; i < timeouts.size(); i++) {
+    advance(timeouts[i] - milliseconds(1) - now);
+    EXPECT_TRUE(callbacks[i]->timestamps.empty());
+    EXPECT_EQ(wheel_->count(), timeouts.size() - i);
+    advance(milliseconds(1));
+    ASSERT_EQ(callbacks[i]->timestamps.size(), 1);
+    EXPECT_EQ(elapsed(callbacks[i]->timestamps[0]), timeouts[i]);
+    now = timeouts[i];
+  }
+  EXPECT_EQ(wheel_->count(), 0);
+}
+
+TEST_F(HierarchicalTimingWheelTest, EmptyWheelCatchesUp) {
+  TestTimeout t1(timeUtil_);
+
+  // the idle wheel is not run, scheduling bases the timeout off now
+  timeUtil_.advance(hours(5));
+  wheel_->scheduleTimeout(&t1, milliseconds(20));
+  advance(milliseconds(19));
+  EXPECT_TRUE(t1.timestamps.empty());
+  advance(milliseconds(1));
+  EXPECT_EQ(t1.timestamps.size(), 1);
+}
+
+TEST_F(HierarchicalTimingWheelTest, DestroyWheel) {
+  TestTimeout t1(timeUtil_);
+  TestTimeout t2(timeUtil_);
+
+  wheel_->scheduleTimeout(&t1, milliseconds(10));
+  wheel_->scheduleTimeout(&t2, hours(1));
+  wheel_.reset();
+  EXPECT_FALSE(t1.isScheduled());
+  EXPECT_FALSE(t2.isScheduled());
+}
+
+TEST_F(HierarchicalTimingWheelTest, DestroyFromCallback) {
+  TestTimeout t1(timeUtil_);
+  TestTimeout t2(timeUtil_);
+
+  // the wheel lives until the callbacks return, and runs no others
+  t1.fn = [&] {
+    wheel_.reset();
+  };
+  auto wheel = wheel_.get();
+  wheel_->scheduleTimeout(&t1, milliseconds(10));
+  wheel_->scheduleTimeout(&t2, milliseconds(10));
+  timeUtil_.advance(milliseconds(10));
+  wheel->runExpired();
+  EXPECT_EQ(t1.timestamps.size(), 1);
+  EXPECT_TRUE(t2.timestamps.empty());
+  EXPECT_FALSE(t2.isScheduled());
+}
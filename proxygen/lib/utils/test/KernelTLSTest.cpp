@@ -0,0 +1,37 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/OpenSSL.h>
+#include <proxygen/lib/utils/KernelTLS.h>
+
+using namespace proxygen;
+
+TEST(KernelTLSTest, EnableOnContext) {
+  folly::SSLContext ctx;
+#ifdef SSL_OP_ENABLE_KTLS
+  EXPECT_TRUE(enableKernelTLS(ctx));
+  EXPECT_NE(SSL_CTX_get_options(ctx.getSSLCtx()) & SSL_OP_ENABLE_KTLS, 0);
+  EXPECT_EQ(SSL_CTX_get_num_tickets(ctx.getSSLCtx()), 0);
+  // again is a no-op
+  EXPECT_TRUE(enableKernelTLS(ctx));
+#else
+  EXPECT_FALSE(enableKernelTLS(ctx));
+#endif
+}
+
+TEST(KernelTLSTest, NoHandshake) {
+  folly::EventBase evb;
+  auto ctx = std::make_shared<folly::SSLContext>();
+  enableKernelTLS(*ctx);
+  folly::AsyncSSLSocket::UniquePtr sock(new folly::AsyncSSLSocket(ctx, &evb));
+  EXPECT_FALSE(kernelTLSSendEnabled(*sock));
+  EXPECT_FALSE(onKernelTLSHandshake(*sock));
+}
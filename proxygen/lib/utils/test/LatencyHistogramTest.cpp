@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/LatencyHistogram.h>
+
+#include <thread>
+
+using namespace proxygen;
+
+TEST(LatencyHistogramTest, Buckets) {
+  // exact below 2^kSubBucketBits
+  for (uint64_t v = 0; v < 64; v++) {
+    EXPECT_EQ(LatencyHistogram::getBucketIndex(v), v);
+    EXPECT_EQ(LatencyHistogram::getBucketMax(v), v);
+  }
+  // then every bucket holds the values up to its max, and within 1/32 of it
+  uint64_t prevMax = 63;
+  for (size_t i = 64; i < LatencyHistogram::kNumBuckets; i++) {
+    auto max = LatencyHistogram::getBucketMax(i);
+    EXPECT_EQ(LatencyHistogram::getBucketIndex(prevMax + 1), i);
+    EXPECT_EQ(LatencyHistogram::getBucketIndex(max), i);
+    EXPECT_LE(max - prevMax, (prevMax + 1) / 32);
+    prevMax = max;
+  }
+  EXPECT_EQ(prevMax, (uint64_t(1) << LatencyHistogram::kMaxBits) - 1);
+  // larger values are clamped
+  EXPECT_EQ(LatencyHistogram::getBucketIndex(uint64_t(1) << 50),
+            LatencyHistogram::kNumBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.getPercentile(50), 0);
+
+  for (uint64_t v = 1; v <= 1000; v++) {
+    histogram.addValue(v * 1000);
+  }
+  EXPECT_EQ(histogram.getCount(), 1000);
+  EXPECT_EQ(histogram.getSum(), 500500000);
+  EXPECT_EQ(histogram.getMax(), 1000000);
+  EXPECT_DOUBLE_EQ(histogram.getAverage(), 500500);
+
+  for (double pct : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+    double expected = pct * 10000;
+    auto value = histogram.getPercentile(pct);
+    EXPECT_GE(value, expected);
+    EXPECT_LE(value, expected * 33 / 32);
+  }
+  // the max of the smallest value's bucket, 1000 to 1007
+  EXPECT_EQ(histogram.getPercentile(0), 1007);
+  EXPECT_EQ(histogram.getPercentile(100), 1000000);
+}
+
+TEST(LatencyHistogramTest, Merge) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  a.addValue(10, 3);
+  b.addValue(2000);
+  b.addValue(10);
+  a.merge(b);
+  EXPECT_EQ(a.getCount(), 5);
+  EXPECT_EQ(a.getSum(), 2040);
+  EXPECT_EQ(a.getMax(), 2000);
+  EXPECT_EQ(a.getBucketCount(10), 4);
+  EXPECT_EQ(a.getPercentile(80), 10);
+}
+
+TEST(LatencyHistogramTest, ConcurrentSnapshot) {
+  ConcurrentLatencyHistogram histogram;
+  const uint64_t kValues = 100000;
+  std::thread writer([&] {
+      for (uint64_t v = 0; v < kValues; v++) {
+        histogram.addValue(v);
+      }
+    });
+  // snapshots taken meanwhile never see more than was added
+  for (int i = 0; i < 100; i++) {
+    LatencyHistogram snapshot;
+    histogram.addTo(snapshot);
+    EXPECT_LE(snapshot.getCount(), kValues);
+  }
+  writer.join();
+
+  LatencyHistogram snapshot;
+  histogram.addTo(snapshot);
+  EXPECT_EQ(snapshot.getCount(), kValues);
+  EXPECT_EQ(snapshot.getSum(), kValues * (kValues - 1) / 2);
+  EXPECT_EQ(snapshot.getMax(), kValues - 1);
+}
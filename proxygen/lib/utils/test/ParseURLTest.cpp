@@ -159,3 +159,31 @@ TEST(ParseURL, IsHostIPAddress) {
   testHostIsIpAddress("", false);
   testHostIsIpAddress("127.0.0.1:80/foo#bar?qqq", false);
 }
+
+TEST(ParseURL, LongURL) {
+  // Components and invalid bytes on both sides of 16 byte blocks
+  string path = "/" + string(40, 'p');
+  string query = string(20, 'q') + "=/#";
+  testParseURL("localhost:8080" + path + "?" + query, "", path,
+               string(20, 'q') + "=/", "localhost", 8080, "localhost:8080");
+  testParseURL(path + "/" + path, "", path + "/" + path, "", "", 0, "");
+  testParseURL(path + "?" + string(30, 'q'), "", path, string(30, 'q'),
+               "", 0, "");
+  testParseURL(path + "#" + string(30, 'f') + "?", "", "", "", "", 0, "",
+               false);
+  testParseURL(path + " " + query, "", "", "", "", 0, "", false);
+  testParseURL(path + "\x7f", "", "", "", "", 0, "", false);
+  testParseURL(path + "\x01" + query, "", "", "", "", 0, "", false);
+}
+
+TEST(ParseURL, Copy) {
+  // Every component refers to the URL, not to the ParseURL
+  string url = "localhost:80/foo?bar";
+  auto u = std::make_unique<ParseURL>(url);
+  ParseURL copy(*u);
+  u.reset();
+  EXPECT_TRUE(copy.valid());
+  EXPECT_EQ("localhost", copy.host());
+  EXPECT_EQ("localhost:80", copy.authority());
+  EXPECT_EQ("/foo", copy.path());
+}
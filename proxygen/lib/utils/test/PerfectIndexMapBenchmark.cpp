@@ -85,6 +85,15 @@ typedef PerfectIndexMap<
     false>
   DefaultPerfectIndexMap;
 
+typedef PerfectIndexMap<
+    HTTPHeaderCode,
+    HTTP_HEADER_OTHER,
+    HTTP_HEADER_NONE,
+    HTTPCommonHeaders::hash,
+    true,
+    false>
+  DuplicatesPerfectIndexMap;
+
 }
 
 void UnorderedMapInsertBench(
@@ -227,6 +236,58 @@ BENCHMARK(PerfectIndexMapUniqueGetsOtherString, iters) {
     bPerfectIndexMapUniqueGetsOtherStringMap, testHeadersOtherStrings, iters);
 }
 
+// Maps the size of a request's headers, of 5 to 50 entries, built afresh per
+// iteration and then searched for each of their keys.  The smaller ones fit
+// in the map's inline storage.
+
+template <typename Map>
+void PerfectIndexMapSizedInsertBench(size_t size, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    Map map;
+    for (size_t j = 0; j < size; ++j) {
+      map.add(testHeaderCodes[j], *testHeadersCodeStrings[j]);
+    }
+    doNotOptimizeAway(map.size());
+  }
+}
+
+template <typename Map>
+void PerfectIndexMapSizedGetBench(size_t size, int iters) {
+  Map map;
+  BENCHMARK_SUSPEND {
+    for (size_t j = 0; j < size; ++j) {
+      map.add(testHeaderCodes[j], *testHeadersCodeStrings[j]);
+    }
+  }
+  for (int i = 0; i < iters; ++i) {
+    for (size_t j = 0; j < size; ++j) {
+      CHECK(map.getSingleOrNone(testHeaderCodes[j]) != folly::none);
+    }
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+#define SIZED_BENCHMARKS(size)                                              \
+  BENCHMARK(PerfectIndexMapInserts##size, iters) {                          \
+    PerfectIndexMapSizedInsertBench<DefaultPerfectIndexMap>(size, iters);   \
+  }                                                                         \
+  BENCHMARK_RELATIVE(PerfectIndexMapDuplicatesInserts##size, iters) {       \
+    PerfectIndexMapSizedInsertBench<DuplicatesPerfectIndexMap>(size, iters);\
+  }                                                                         \
+  BENCHMARK(PerfectIndexMapGets##size, iters) {                             \
+    PerfectIndexMapSizedGetBench<DefaultPerfectIndexMap>(size, iters);      \
+  }                                                                         \
+  BENCHMARK_RELATIVE(PerfectIndexMapDuplicatesGets##size, iters) {          \
+    PerfectIndexMapSizedGetBench<DuplicatesPerfectIndexMap>(size, iters);   \
+  }                                                                         \
+  BENCHMARK_DRAW_LINE();
+
+SIZED_BENCHMARKS(5)
+SIZED_BENCHMARKS(10)
+SIZED_BENCHMARKS(25)
+SIZED_BENCHMARKS(50)
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -7,10 +7,12 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <algorithm>
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <proxygen/lib/utils/PerfectIndexMap.h>
 #include <string>
+#include <vector>
 
 using namespace folly;
 using namespace proxygen;
@@ -231,3 +233,45 @@ TYPED_TEST(PerfectIndexMapTests, OtherStringCaseSensitivity) {
     }
   }
 }
+
+TYPED_TEST(PerfectIndexMapTests, KeysAcrossSearchBlocks) {
+  typedef typename TypeParam::TKey Key;
+  Key key = static_cast<Key>(TypeParam::TKeyCommonOffset);
+  Key filler = static_cast<Key>(TypeParam::TKeyCommonOffset + 1);
+
+  // More entries than the map stores inline and than one vector compare
+  // covers, with the key among them at either end and past the first block
+  const std::vector<size_t> positions{0, 7, 15, 16, 31, 32, 47, 60};
+  size_t numEntries = 61;
+  std::string lastValue;
+  for (size_t j = 0; j < numEntries; ++j) {
+    if (std::find(positions.begin(), positions.end(), j) != positions.end()) {
+      lastValue = std::to_string(j);
+      if (TypeParam::TAllowDuplicates) {
+        this->testMap_.add(key, lastValue);
+      } else {
+        this->testMap_.set(key, lastValue);
+      }
+    } else if (TypeParam::TAllowDuplicates) {
+      this->testMap_.add(filler, std::to_string(j));
+    }
+  }
+
+  if (TypeParam::TAllowDuplicates) {
+    EXPECT_EQ(this->testMap_.size(), numEntries);
+    EXPECT_FALSE(this->testMap_.getSingleOrNone(key).hasValue());
+
+    // Leaves only the first occurrence, with the new value
+    this->testMap_.set(key, lastValue);
+    EXPECT_EQ(this->testMap_.size(), numEntries - positions.size() + 1);
+  } else {
+    EXPECT_EQ(this->testMap_.size(), 1);
+  }
+  auto optional = this->testMap_.getSingleOrNone(key);
+  ASSERT_TRUE(optional.hasValue());
+  EXPECT_EQ(optional.value(), lastValue);
+
+  EXPECT_TRUE(this->testMap_.remove(key));
+  EXPECT_FALSE(this->testMap_.getSingleOrNone(key).hasValue());
+  EXPECT_FALSE(this->testMap_.remove(key));
+}
@@ -10,6 +10,7 @@
 #include <folly/Conv.h>
 #include <folly/container/Foreach.h>
 #include <folly/portability/GTest.h>
+#include <algorithm>
 #include <map>
 #include <vector>
 
@@ -301,3 +302,38 @@ TEST(RendezvousHash, selectNUnweighted) {
     EXPECT_GT(different, 0);
   }
 }
+
+TEST(RendezvousHash, selectNUnweightedBatch) {
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < 200; ++i) {
+    keys.push_back(91484253 + i * 7919);
+  }
+  // Uniform weights take another path than the others
+  for (auto uniform : {true, false}) {
+    RendezvousHash hashes;
+    std::vector<std::pair<std::string, uint64_t>> nodes;
+    int size = 50;
+    for (int i = 0; i < size; ++i) {
+      nodes.emplace_back(folly::to<std::string>("key", i),
+                         uniform ? 3 : 1 + i % 4);
+    }
+    hashes.build(nodes);
+
+    for (size_t rank : {0, 1, 10, 49, 50, 60}) {
+      std::vector<size_t> selections;
+      hashes.selectNUnweighted(folly::range(keys), rank, selections);
+      size_t perKey = rank == 0 ? 1 : std::min<size_t>(rank, size);
+      ASSERT_EQ(selections.size(), keys.size() * perKey);
+      for (size_t i = 0; i < keys.size(); ++i) {
+        auto expected = rank == 0 ?
+          std::vector<size_t>{hashes.get(keys[i])} :
+          hashes.selectNUnweighted(keys[i], rank);
+        std::vector<size_t> actual(selections.begin() + i * perKey,
+                                   selections.begin() + (i + 1) * perKey);
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(expected, actual);
+      }
+    }
+  }
+}
@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/utils/AsyncTimeoutSet.h>
+#include <proxygen/lib/utils/HierarchicalTimingWheel.h>
+#include <proxygen/lib/utils/WheelTimerInstance.h>
+
+#include <vector>
+
+using namespace folly;
+using namespace proxygen;
+using std::chrono::milliseconds;
+
+// Schedules and cancels, or reschedules, kCallbacks timeouts on an EventBase
+// that is never looped, so only the bookkeeping of each timer is measured.
+// The HierarchicalTimingWheel and HHWheelTimer timeouts are spread over a
+// minute; an AsyncTimeoutSet only has the one duration.
+
+namespace {
+
+const size_t kCallbacks = 1000;
+const milliseconds kTimeout(60000);
+
+milliseconds getTimeout(size_t i) {
+  return milliseconds(1 + (i * 7919) % kTimeout.count());
+}
+
+class WheelCallback : public HierarchicalTimingWheel::Callback {
+ public:
+  void timeoutExpired() noexcept override {}
+};
+
+class SetCallback : public AsyncTimeoutSet::Callback {
+ public:
+  void timeoutExpired() noexcept override {}
+};
+
+class TimerCallback : public HHWheelTimer::Callback {
+ public:
+  void timeoutExpired() noexcept override {}
+  void callbackCanceled() noexcept override {}
+};
+
+template <typename Schedule, typename Callback>
+void scheduleCancelBench(int iters,
+                         std::vector<Callback>& callbacks,
+                         Schedule schedule) {
+  for (int i = 0; i < iters; ++i) {
+    for (size_t j = 0; j < callbacks.size(); ++j) {
+      schedule(&callbacks[j], getTimeout(j));
+    }
+    for (auto& callback : callbacks) {
+      callback.cancelTimeout();
+    }
+  }
+}
+
+template <typename Schedule, typename Callback>
+void rescheduleBench(int iters,
+                     std::vector<Callback>& callbacks,
+                     Schedule schedule) {
+  BENCHMARK_SUSPEND {
+    for (size_t j = 0; j < callbacks.size(); ++j) {
+      schedule(&callbacks[j], getTimeout(j));
+    }
+  }
+  for (int i = 0; i < iters; ++i) {
+    for (size_t j = 0; j < callbacks.size(); ++j) {
+      schedule(&callbacks[j], getTimeout(j + i));
+    }
+  }
+  BENCHMARK_SUSPEND {
+    for (auto& callback : callbacks) {
+      callback.cancelTimeout();
+    }
+  }
+}
+
+EventBase evb;
+
+HierarchicalTimingWheel::UniquePtr wheel(new HierarchicalTimingWheel(&evb));
+std::vector<WheelCallback> wheelCallbacks(kCallbacks);
+
+AsyncTimeoutSet::UniquePtr timeoutSet(new AsyncTimeoutSet(&evb, kTimeout));
+std::vector<SetCallback> setCallbacks(kCallbacks);
+
+HHWheelTimer::UniquePtr wheelTimer(
+  HHWheelTimer::newTimer(&evb, milliseconds(10)));
+WheelTimerInstance timerInstance(wheelTimer.get());
+std::vector<TimerCallback> timerCallbacks(kCallbacks);
+
+}
+
+BENCHMARK(HierarchicalTimingWheelScheduleCancel, iters) {
+  scheduleCancelBench(iters, wheelCallbacks,
+                      [] (WheelCallback* cb, milliseconds timeout) {
+                        wheel->scheduleTimeout(cb, timeout);
+                      });
+}
+
+BENCHMARK_RELATIVE(AsyncTimeoutSetScheduleCancel, iters) {
+  scheduleCancelBench(iters, setCallbacks,
+                      [] (SetCallback* cb, milliseconds) {
+                        timeoutSet->scheduleTimeout(cb);
+                      });
+}
+
+BENCHMARK_RELATIVE(WheelTimerInstanceScheduleCancel, iters) {
+  scheduleCancelBench(iters, timerCallbacks,
+                      [] (TimerCallback* cb, milliseconds timeout) {
+                        timerInstance.scheduleTimeout(cb, timeout);
+                      });
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(HierarchicalTimingWheelReschedule, iters) {
+  rescheduleBench(iters, wheelCallbacks,
+                  [] (WheelCallback* cb, milliseconds timeout) {
+                    wheel->scheduleTimeout(cb, timeout);
+                  });
+}
+
+BENCHMARK_RELATIVE(AsyncTimeoutSetReschedule, iters) {
+  rescheduleBench(iters, setCallbacks,
+                  [] (SetCallback* cb, milliseconds) {
+                    timeoutSet->scheduleTimeout(cb);
+                  });
+}
+
+BENCHMARK_RELATIVE(WheelTimerInstanceReschedule, iters) {
+  rescheduleBench(iters, timerCallbacks,
+                  [] (TimerCallback* cb, milliseconds timeout) {
+                    timerInstance.scheduleTimeout(cb, timeout);
+                  });
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <proxygen/lib/utils/BatchingTraceEventObserver.h>
 #include <proxygen/lib/utils/Exception.h>
 #include <proxygen/lib/utils/TraceEvent.h>
 #include <proxygen/lib/utils/TraceEventType.h>
@@ -15,6 +16,7 @@
 #include <folly/portability/GTest.h>
 #include <folly/portability/GMock.h>
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -247,3 +249,87 @@ TEST(TraceEventTest, StringArrayValueToString) {
 
   ASSERT_EQ(out.str(), traceEvent.toString());
 }
+
+TEST(TraceEventTest, MetaDataSortedAndReplaced) {
+  TraceEvent traceEvent(TraceEventType::TotalRequest);
+  ASSERT_TRUE(traceEvent.addMeta(TraceFieldType::Uri, "/"));
+  ASSERT_TRUE(traceEvent.addMeta(TraceFieldType::Protocol, 1));
+  ASSERT_TRUE(traceEvent.addMeta(TraceFieldType::CallPath, "a"));
+  ASSERT_FALSE(traceEvent.addMeta(TraceFieldType::Protocol, 2));
+
+  ASSERT_EQ(traceEvent.getMetaData().size(), 3);
+  ASSERT_EQ(2,
+      traceEvent.getTraceFieldDataAs<int64_t>(TraceFieldType::Protocol));
+  ASSERT_FALSE(traceEvent.hasTraceField(TraceFieldType::StatusCode));
+  auto prev = traceEvent.getMetaData().front().first;
+  for (const auto& entry : traceEvent.getMetaData()) {
+    ASSERT_LE(prev, entry.first);
+    prev = entry.first;
+  }
+
+  TraceEvent::MetaDataMap input;
+  input.emplace_back(TraceFieldType::Uri, "/a");
+  input.emplace_back(TraceFieldType::CallPath, 3);
+  traceEvent.setMetaData(std::move(input));
+  int64_t intData = 0;
+  std::string strData;
+  ASSERT_TRUE(traceEvent.readIntMeta(TraceFieldType::CallPath, intData));
+  ASSERT_EQ(intData, 3);
+  ASSERT_TRUE(traceEvent.readStrMeta(TraceFieldType::Uri, strData));
+  ASSERT_EQ(strData, "/a");
+  ASSERT_FALSE(traceEvent.hasTraceField(TraceFieldType::Protocol));
+}
+
+namespace {
+class CollectingObserver : public TraceEventObserver {
+ public:
+  void emitTraceEvents(std::vector<TraceEvent> events) noexcept override {
+    std::lock_guard<std::mutex> guard(mutex_);
+    batches_++;
+    for (auto& event : events) {
+      events_.push_back(std::move(event));
+    }
+  }
+
+  std::mutex mutex_;
+  size_t batches_{0};
+  std::vector<TraceEvent> events_;
+};
+}
+
+TEST(TraceEventTest, BatchingObserver) {
+  CollectingObserver sink;
+  std::vector<uint32_t> ids;
+  {
+    BatchingTraceEventObserver observer(
+      sink, 100, std::chrono::milliseconds(1), 4);
+    for (int i = 0; i < 10; i++) {
+      TraceEvent event(TraceEventType::TotalRequest);
+      event.addMeta(TraceFieldType::Protocol, i);
+      ids.push_back(event.getID());
+      observer.traceEventAvailable(std::move(event));
+    }
+    EXPECT_EQ(observer.getNumDropped(), 0);
+  }
+  // everything is delivered by the time the observer is gone, in order
+  ASSERT_EQ(sink.events_.size(), 10);
+  EXPECT_GE(sink.batches_, 3);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(sink.events_[i].getID(), ids[i]);
+    EXPECT_EQ(i, sink.events_[i].getTraceFieldDataAs<int64_t>(
+                TraceFieldType::Protocol));
+  }
+}
+
+TEST(TraceEventTest, BatchingObserverDropsWhenFull) {
+  CollectingObserver sink;
+  {
+    // never flushed before being destroyed
+    BatchingTraceEventObserver observer(sink, 2, std::chrono::hours(1));
+    for (int i = 0; i < 5; i++) {
+      observer.traceEventAvailable(TraceEvent(TraceEventType::TotalRequest));
+    }
+    EXPECT_EQ(observer.getNumDropped(), 3);
+  }
+  EXPECT_EQ(sink.events_.size(), 2);
+}
@@ -8,8 +8,12 @@
  *
  */
 #include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/RecyclingAllocator.h>
 #include <proxygen/lib/utils/UtilInl.h>
 
+#include <map>
+#include <thread>
+
 using namespace proxygen;
 
 TEST(UtilTest, CaseInsensitiveEqual) {
@@ -19,3 +23,45 @@ TEST(UtilTest, CaseInsensitiveEqual) {
   ASSERT_FALSE(caseInsensitiveEqual("fo", "FOO"));
   ASSERT_FALSE(caseInsensitiveEqual("FO", "FOO"));
 }
+
+namespace {
+struct TestTag {};
+}
+
+TEST(UtilTest, ThreadLocalFreeList) {
+  using FreeList = ThreadLocalFreeList<TestTag, 64, 2>;
+  FreeList::deallocate(FreeList::allocate());
+  EXPECT_EQ(FreeList::cached(), 0);
+
+  FreeList::enable(true);
+  auto a = FreeList::allocate();
+  auto b = FreeList::allocate();
+  auto c = FreeList::allocate();
+  FreeList::deallocate(a);
+  FreeList::deallocate(b);
+  FreeList::deallocate(c);
+  // Capped at two blocks, the last of which is handed out first
+  EXPECT_EQ(FreeList::cached(), 2);
+  b = FreeList::allocate();
+  EXPECT_EQ(FreeList::cached(), 1);
+
+  // Blocks freed on another thread are cached there
+  std::thread([b] {
+      FreeList::deallocate(b);
+      EXPECT_EQ(FreeList::cached(), 1);
+    }).join();
+  EXPECT_EQ(FreeList::cached(), 1);
+  FreeList::enable(false);
+}
+
+TEST(UtilTest, RecyclingAllocator) {
+  using Allocator = RecyclingAllocator<TestTag, std::pair<const int, int>>;
+  std::map<int, int, std::less<int>, Allocator> m;
+  Allocator::FreeList::enable(true);
+  m[1] = 1;
+  auto node = &*m.begin();
+  m.clear();
+  m[2] = 2;
+  EXPECT_EQ(&*m.begin(), node);
+  Allocator::FreeList::enable(false);
+}
@@ -13,6 +13,7 @@
 #include <folly/io/IOBuf.h>
 #include <folly/portability/GTest.h>
 #include <glog/logging.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
 #include <proxygen/lib/utils/ZlibStreamCompressor.h>
 #include <proxygen/lib/utils/ZlibStreamDecompressor.h>
 
@@ -148,3 +149,25 @@ TEST_F(ZlibTests, CompressDecompressSmallBuffer) {
     compressThenDecompress(CompressionType::GZIP, 4, makeBuf(127));
   });
 }
+
+// Pooled codecs are reset for their next stream, also when released midway
+TEST_F(ZlibTests, PooledCodecs) {
+  StreamCompressor* reused = nullptr;
+  for (int i = 0; i < 3; i++) {
+    auto compressor = StreamCodecPool::getCompressor(CompressionType::GZIP, 4);
+    auto decompressor = StreamCodecPool::getDecompressor(CompressionType::GZIP);
+    if (reused) {
+      EXPECT_EQ(compressor.get(), reused);
+    }
+    reused = compressor.get();
+
+    auto buf = makeBuf(2000);
+    auto compressed = compressor->compress(buf.get(), i != 1);
+    ASSERT_FALSE(compressor->hasError());
+    auto decompressed = decompressor->decompress(compressed.get());
+    ASSERT_FALSE(decompressor->hasError());
+    IOBufEqualTo eq;
+    EXPECT_TRUE(eq(buf, decompressed));
+  }
+  EXPECT_EQ(StreamCodecPool::getNumPooled(), 2);
+}
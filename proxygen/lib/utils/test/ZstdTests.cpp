@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/Conv.h>
 #include <folly/Random.h>
 #include <folly/ScopeGuard.h>
 #include <folly/compression/Compression.h>
@@ -14,6 +15,7 @@
 #include <folly/io/IOBuf.h>
 #include <folly/portability/GTest.h>
 #include <glog/logging.h>
+#include <proxygen/lib/utils/ZstdStreamCompressor.h>
 #include <proxygen/lib/utils/ZstdStreamDecompressor.h>
 
 using namespace folly;
@@ -163,3 +165,64 @@ TEST_F(ZstdTests, CompressDecompressStreaming) {
   ASSERT_NO_FATAL_FAILURE(
       { compressThenDecompressPieces(std::move(input_pieces)); });
 }
+
+// Each compressed piece decompresses to its input as soon as it is received
+TEST_F(ZstdTests, StreamCompressorFlushes) {
+  ZstdStreamCompressor compressor(3);
+  ZstdStreamDecompressor decompressor;
+  IOBufEqualTo eq;
+  std::vector<std::unique_ptr<IOBuf>> pieces;
+  pieces.push_back(makeBuf(38));
+  pieces.push_back(makeBuf(200 * 1024));
+  pieces.push_back(makeBuf(0));
+  for (size_t i = 0; i < pieces.size(); i++) {
+    auto compressed = compressor.compress(pieces[i].get(),
+                                          i + 1 == pieces.size());
+    ASSERT_FALSE(compressor.hasError());
+    auto decompressed = decompressor.decompress(compressed.get());
+    ASSERT_FALSE(decompressor.hasError());
+    if (pieces[i]->empty()) {
+      EXPECT_TRUE(!decompressed || decompressed->empty());
+    } else {
+      EXPECT_TRUE(eq(pieces[i], decompressed));
+    }
+  }
+  EXPECT_TRUE(decompressor.finished());
+
+  // Nothing follows the end of the stream
+  auto buf = makeBuf(10);
+  EXPECT_EQ(compressor.compress(buf.get()), nullptr);
+  EXPECT_TRUE(compressor.hasError());
+}
+
+TEST_F(ZstdTests, StreamCompressorDictionary) {
+  std::string samples;
+  for (int i = 0; i < 100; i++) {
+    samples += folly::to<std::string>(
+      "{\"id\":", i, ",\"name\":\"service\",\"status\":\"healthy\"}");
+  }
+  auto dictionary = std::make_shared<const ZstdDictionary>(
+    folly::ByteRange(folly::StringPiece(samples)), 3);
+  auto payload = IOBuf::copyBuffer(
+    "{\"id\":7,\"name\":\"service\",\"status\":\"healthy\"}");
+
+  ZstdStreamCompressor compressor(dictionary);
+  auto compressed = compressor.compress(payload.get());
+  ASSERT_FALSE(compressor.hasError());
+  // Much smaller than without the dictionary
+  ZstdStreamCompressor plainCompressor(3);
+  EXPECT_LT(compressed->computeChainDataLength(),
+            plainCompressor.compress(payload.get())->computeChainDataLength());
+
+  ZstdStreamDecompressor decompressor(dictionary);
+  auto decompressed = decompressor.decompress(compressed.get());
+  ASSERT_FALSE(decompressor.hasError());
+  EXPECT_TRUE(decompressor.finished());
+  IOBufEqualTo eq;
+  EXPECT_TRUE(eq(payload, decompressed));
+
+  // Not without the dictionary
+  ZstdStreamDecompressor noDictionary;
+  noDictionary.decompress(compressed.get());
+  EXPECT_TRUE(noDictionary.hasError());
+}